@@ -57,6 +57,8 @@
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/socket_utils/sockets.h"
+#include "osi/include/time.h"
+#include "udrv/include/uipc_shm.h"
 
 #include "audio_a2dp_hw.h"
 
@@ -82,6 +84,7 @@ static char a2dp_hal_imp[PROPERTY_VALUE_MAX] = "false";
 #define USEC_PER_SEC 1000000L
 #define SOCK_SEND_TIMEOUT_MS 2000 /* Timeout for sending */
 #define SOCK_RECV_TIMEOUT_MS 5000 /* Timeout for receiving */
+#define AUDIO_SHM_SETUP_TIMEOUT_MS 50 /* Timeout for the shared memory */
 #define SOCK_RECV_TIMEOUT_MS_2 3000 /* Timeout for receiving */
 #define CASE_RETURN_STR(const) case const: return #const;
 
@@ -146,6 +149,7 @@ struct a2dp_stream_common {
   std::recursive_mutex* mutex;  // See note below on mutex acquisition order.
   int ctrl_fd;
   int audio_fd;
+  tUIPC_SHM audio_shm;  // ring the stack offered on the audio socket, if any
   size_t buffer_sz;
   struct a2dp_config cfg;
   a2dp_state_t state;
@@ -409,6 +413,59 @@ static int skt_disconnect(int fd) {
   return 0;
 }
 
+// Writes to the shared memory ring of the audio channel when the stack
+// offered one, to the audio socket otherwise. Like skt_write(), it waits up
+// to SOCK_SEND_TIMEOUT_MS for room. Called without the stream lock held, it
+// only takes the lock to use the ring.
+static int audio_write(struct a2dp_stream_common* common, const void* p,
+                       size_t len) {
+  if (common->audio_shm.hdr == NULL)
+    return skt_write(common->audio_fd, p, len);
+
+  ts_log("audio_write", len, NULL);
+
+  uint32_t deadline_ms = time_get_os_boottime_ms() + SOCK_SEND_TIMEOUT_MS;
+  size_t count = 0;
+  while (true) {
+    int room_fd;
+    int audio_fd;
+    {
+      std::lock_guard<std::recursive_mutex> lock(*common->mutex);
+      if (common->audio_shm.hdr == NULL) return -1;
+
+      count += uipc_shm_write(&common->audio_shm, (const uint8_t*)p + count,
+                              len - count);
+      if (count == len) return (int)count;
+      if (!uipc_shm_wait_begin(&common->audio_shm, true, len - count))
+        continue;
+      room_fd = common->audio_shm.room_fd;
+      audio_fd = common->audio_fd;
+    }
+
+    int32_t timeout_ms = deadline_ms - time_get_os_boottime_ms();
+    int ret = 0;
+    if (timeout_ms > 0) ret = uipc_shm_wait(room_fd, audio_fd, timeout_ms);
+
+    std::lock_guard<std::recursive_mutex> lock(*common->mutex);
+    if (common->audio_shm.hdr == NULL) return -1;
+    uipc_shm_wait_end(&common->audio_shm, true);
+    if (ret == 0) {
+      WARN("write timeout exceeded, sent %zu bytes", count);
+      return -1;
+    }
+    if (ret < 0) {
+      ERROR("audio channel closed by the stack");
+      return -1;
+    }
+  }
+}
+
+static void audio_disconnect(struct a2dp_stream_common* common) {
+  uipc_shm_close(&common->audio_shm);
+  skt_disconnect(common->audio_fd);
+  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+}
+
 /*****************************************************************************
  *
  *  AUDIO CONTROL PATH
@@ -913,6 +970,7 @@ static void a2dp_stream_common_init(struct a2dp_stream_common* common) {
 
   common->ctrl_fd = AUDIO_SKT_DISCONNECTED;
   common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  uipc_shm_init(&common->audio_shm);
   common->state = AUDIO_A2DP_STATE_STOPPED;
 
   /* manages max capacity of socket pipe */
@@ -984,6 +1042,12 @@ static int start_audio_datapath(struct a2dp_stream_common* common) {
         goto error;
       }
     }
+    if (common->audio_fd >= 0 &&
+        uipc_shm_receive_setup(&common->audio_shm, common->audio_fd,
+                               AUDIO_SHM_SETUP_TIMEOUT_MS)) {
+      INFO("writing audio to %u bytes of shared memory",
+           common->audio_shm.size);
+    }
   }
   common->state = (a2dp_state_t)AUDIO_A2DP_STATE_STARTED;
   /* update initial sink latency after start stream */
@@ -1017,8 +1081,7 @@ static int stop_audio_datapath(struct a2dp_stream_common* common) {
   common->state = (a2dp_state_t)AUDIO_A2DP_STATE_STOPPED;
 
   /* disconnect audio path */
-  skt_disconnect(common->audio_fd);
-  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  audio_disconnect(common);
 
   return 0;
 }
@@ -1044,9 +1107,7 @@ static int suspend_audio_datapath(struct a2dp_stream_common* common,
     common->state = AUDIO_A2DP_STATE_SUSPENDED;
 
   /* disconnect audio path */
-  skt_disconnect(common->audio_fd);
-
-  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  audio_disconnect(common);
   return 0;
 }
 
@@ -1114,7 +1175,7 @@ static ssize_t out_write(struct audio_stream_out* stream, const void* buffer,
       ATRACE_BEGIN(trace_buf);
   }
   #endif
-  sent = skt_write(out->common.audio_fd, buffer, write_bytes);
+  sent = audio_write(&out->common, buffer, write_bytes);
   #ifdef BT_AUDIO_SYSTRACE_LOG
   if (PERF_SYSTRACE)
   {
@@ -1130,8 +1191,7 @@ static ssize_t out_write(struct audio_stream_out* stream, const void* buffer,
       ERROR("ignore data write failure");
     }
 
-    skt_disconnect(out->common.audio_fd);
-    out->common.audio_fd = AUDIO_SKT_DISCONNECTED;
+    audio_disconnect(&out->common);
     if ((out->common.state != AUDIO_A2DP_STATE_SUSPENDED) &&
             (out->common.state != AUDIO_A2DP_STATE_STOPPING)) {
       out->common.state = AUDIO_A2DP_STATE_STOPPED;
@@ -1528,6 +1588,16 @@ static int out_set_volume(UNUSED_ATTR struct audio_stream_out* stream,
   return -ENOSYS;
 }
 
+// Frames written that are still to be played when the stack reads from the
+// shared memory ring: the frames it did not read yet and the sink latency.
+static uint64_t out_ring_latency_frames(struct a2dp_stream_out* out) {
+  size_t frame_size = audio_stream_out_frame_size(&out->stream);
+  if (out->common.cfg.is_stereo_to_mono) frame_size /= 2;
+
+  return uipc_shm_used(&out->common.audio_shm) / frame_size +
+         (uint64_t)out->common.sink_latency * out->common.cfg.rate / 1000;
+}
+
 static int out_get_presentation_position(const struct audio_stream_out* stream,
                                          uint64_t* frames,
                                          struct timespec* timestamp) {
@@ -1540,6 +1610,8 @@ static int out_get_presentation_position(const struct audio_stream_out* stream,
   uint64_t latency_frames =
       (uint64_t)out_get_latency(stream) * out->common.cfg.rate / 1000;
   std::lock_guard<std::recursive_mutex> lock(*out->common.mutex);
+  if (out->common.audio_shm.hdr != NULL)
+    latency_frames = out_ring_latency_frames(out);
   if (out->frames_presented >= latency_frames) {
     *frames = out->frames_presented - latency_frames;
     clock_gettime(CLOCK_MONOTONIC,
@@ -1559,6 +1631,8 @@ static int out_get_render_position(const struct audio_stream_out* stream,
   uint64_t latency_frames =
       (uint64_t)out_get_latency(stream) * out->common.cfg.rate / 1000;
   std::lock_guard<std::recursive_mutex> lock(*out->common.mutex);
+  if (out->common.audio_shm.hdr != NULL)
+    latency_frames = out_ring_latency_frames(out);
   if (out->frames_rendered >= latency_frames) {
     *dsp_frames = (uint32_t)(out->frames_rendered - latency_frames);
   } else {
@@ -1689,8 +1763,7 @@ static ssize_t in_read(struct audio_stream_in* stream, void* buffer,
   read = skt_read(in->common.audio_fd, buffer, bytes);
   lock.lock();
   if (read == -1) {
-    skt_disconnect(in->common.audio_fd);
-    in->common.audio_fd = AUDIO_SKT_DISCONNECTED;
+    audio_disconnect(&in->common);
     if ((in->common.state != AUDIO_A2DP_STATE_SUSPENDED) &&
         (in->common.state != AUDIO_A2DP_STATE_STOPPING)) {
       in->common.state = AUDIO_A2DP_STATE_STOPPED;
@@ -1350,8 +1350,9 @@ void ack_stream_suspended(const tA2DP_CTRL_ACK& ack) {
 }
 
 // Read from the FMQ of BluetoothAudio HAL
-size_t read(uint8_t* p_buf, uint32_t len) {
+size_t read(uint8_t* p_buf, uint32_t len, bool* p_overrun) {
   std::unique_lock<std::mutex> guard(internal_mutex_);
+  if (p_overrun != nullptr) *p_overrun = false;
   if (!is_hal_2_0_enabled()) {
     LOG(ERROR) << __func__ << ": BluetoothAudio HAL is not enabled";
     return 0;
@@ -1360,7 +1361,7 @@ size_t read(uint8_t* p_buf, uint32_t len) {
                << " is not A2DP_SOFTWARE_ENCODING_DATAPATH";
     return 0;
   }
-  return a2dp_hal_clientif->ReadAudioData(p_buf, len);
+  return a2dp_hal_clientif->ReadAudioData(p_buf, len, p_overrun);
 }
 
 // Update A2DP delay report to BluetoothAudio HAL
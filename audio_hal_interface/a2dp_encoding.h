@@ -53,8 +53,9 @@ void update_pending_command(tA2DP_CTRL_CMD cmd);
 void ack_stream_started(const tA2DP_CTRL_ACK& status);
 void ack_stream_suspended(const tA2DP_CTRL_ACK& status);
 
-// Read from the FMQ of BluetoothAudio HAL
-size_t read(uint8_t* p_buf, uint32_t len);
+// Read from the FMQ of BluetoothAudio HAL. |p_overrun|, when set, tells
+// whether the FMQ was full before this read.
+size_t read(uint8_t* p_buf, uint32_t len, bool* p_overrun = nullptr);
 
 // Update A2DP delay report to BluetoothAudio HAL
 void set_remote_delay(uint16_t delay_report);
@@ -424,7 +424,9 @@ int BluetoothAudioClientInterface::EndSession() {
 }
 
 size_t BluetoothAudioClientInterface::ReadAudioData(uint8_t* p_buf,
-                                                    uint32_t len) {
+                                                    uint32_t len,
+                                                    bool* p_queue_full) {
+  if (p_queue_full != nullptr) *p_queue_full = false;
   if (provider_ == nullptr) {
     LOG(ERROR) << __func__ << ": BluetoothAudioHal nullptr";
     return 0;
@@ -437,6 +439,10 @@ size_t BluetoothAudioClientInterface::ReadAudioData(uint8_t* p_buf,
     if (mDataMQ == nullptr || !mDataMQ->isValid()) break;
 
     size_t avail_to_read = mDataMQ->availableToRead();
+    if (total_read == 0 && p_queue_full != nullptr &&
+        avail_to_read == mDataMQ->getQuantumCount()) {
+      *p_queue_full = true;
+    }
     if (avail_to_read) {
       if (avail_to_read > len - total_read) {
         avail_to_read = len - total_read;
@@ -162,8 +162,10 @@ class BluetoothAudioClientInterface {
 
   int EndSession();
 
-  // Read data from audio  HAL through fmq
-  size_t ReadAudioData(uint8_t* p_buf, uint32_t len);
+  // Read data from audio  HAL through fmq. |p_queue_full|, when set, tells
+  // whether the fmq was full, so the audio HAL producer had to wait.
+  size_t ReadAudioData(uint8_t* p_buf, uint32_t len,
+                       bool* p_queue_full = nullptr);
 
   // Write data to audio HAL through fmq
   size_t WriteAudioData(uint8_t* p_buf, uint32_t len);
@@ -41,6 +41,8 @@
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/socket_utils/sockets.h"
+#include "osi/include/time.h"
+#include "udrv/include/uipc_shm.h"
 
 #include "audio_hearing_aid_hw.h"
 
@@ -52,6 +54,7 @@
 #define USEC_PER_SEC 1000000L
 #define SOCK_SEND_TIMEOUT_MS 2000 /* Timeout for sending */
 #define SOCK_RECV_TIMEOUT_MS 5000 /* Timeout for receiving */
+#define AUDIO_SHM_SETUP_TIMEOUT_MS 50 /* Timeout for the shared memory */
 
 // set WRITE_POLL_MS to 0 for blocking sockets, nonzero for polled non-blocking
 // sockets
@@ -109,6 +112,7 @@ struct ha_stream_common {
   std::recursive_mutex* mutex;  // See note below on mutex acquisition order.
   int ctrl_fd;
   int audio_fd;
+  tUIPC_SHM audio_shm;  // ring the stack offered on the audio socket, if any
   size_t buffer_sz;
   struct ha_config cfg;
   ha_state_t state;
@@ -326,6 +330,59 @@ static int skt_disconnect(int fd) {
   return 0;
 }
 
+// Writes to the shared memory ring of the audio channel when the stack
+// offered one, to the audio socket otherwise. Like skt_write(), it waits up
+// to SOCK_SEND_TIMEOUT_MS for room. Called without the stream lock held, it
+// only takes the lock to use the ring.
+static int audio_write(struct ha_stream_common* common, const void* p,
+                       size_t len) {
+  if (common->audio_shm.hdr == NULL)
+    return skt_write(common->audio_fd, p, len);
+
+  ts_log("audio_write", len, NULL);
+
+  uint32_t deadline_ms = time_get_os_boottime_ms() + SOCK_SEND_TIMEOUT_MS;
+  size_t count = 0;
+  while (true) {
+    int room_fd;
+    int audio_fd;
+    {
+      std::lock_guard<std::recursive_mutex> lock(*common->mutex);
+      if (common->audio_shm.hdr == NULL) return -1;
+
+      count += uipc_shm_write(&common->audio_shm, (const uint8_t*)p + count,
+                              len - count);
+      if (count == len) return (int)count;
+      if (!uipc_shm_wait_begin(&common->audio_shm, true, len - count))
+        continue;
+      room_fd = common->audio_shm.room_fd;
+      audio_fd = common->audio_fd;
+    }
+
+    int32_t timeout_ms = deadline_ms - time_get_os_boottime_ms();
+    int ret = 0;
+    if (timeout_ms > 0) ret = uipc_shm_wait(room_fd, audio_fd, timeout_ms);
+
+    std::lock_guard<std::recursive_mutex> lock(*common->mutex);
+    if (common->audio_shm.hdr == NULL) return -1;
+    uipc_shm_wait_end(&common->audio_shm, true);
+    if (ret == 0) {
+      WARN("write timeout exceeded, sent %zu bytes", count);
+      return -1;
+    }
+    if (ret < 0) {
+      ERROR("audio channel closed by the stack");
+      return -1;
+    }
+  }
+}
+
+static void audio_disconnect(struct ha_stream_common* common) {
+  uipc_shm_close(&common->audio_shm);
+  skt_disconnect(common->audio_fd);
+  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+}
+
 /*****************************************************************************
  *
  *  AUDIO CONTROL PATH
@@ -776,6 +833,7 @@ static void ha_stream_common_init(struct ha_stream_common* common) {
 
   common->ctrl_fd = AUDIO_SKT_DISCONNECTED;
   common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  uipc_shm_init(&common->audio_shm);
   common->state = AUDIO_HA_STATE_STOPPED;
 
   /* manages max capacity of socket pipe */
@@ -811,6 +869,12 @@ static int start_audio_datapath(struct ha_stream_common* common) {
       ERROR("Audiopath start failed - error opening data socket");
       goto error;
     }
+    if (common->audio_fd >= 0 &&
+        uipc_shm_receive_setup(&common->audio_shm, common->audio_fd,
+                               AUDIO_SHM_SETUP_TIMEOUT_MS)) {
+      INFO("writing audio to %u bytes of shared memory",
+           common->audio_shm.size);
+    }
   }
   common->state = (ha_state_t)AUDIO_HA_STATE_STARTED;
   return 0;
@@ -838,8 +902,7 @@ static int stop_audio_datapath(struct ha_stream_common* common) {
   common->state = (ha_state_t)AUDIO_HA_STATE_STOPPED;
 
   /* disconnect audio path */
-  skt_disconnect(common->audio_fd);
-  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  audio_disconnect(common);
 
   return 0;
 }
@@ -858,9 +921,7 @@ static int suspend_audio_datapath(struct ha_stream_common* common,
     common->state = AUDIO_HA_STATE_SUSPENDED;
 
   /* disconnect audio path */
-  skt_disconnect(common->audio_fd);
-
-  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  audio_disconnect(common);
 
   return 0;
 }
@@ -911,12 +972,11 @@ static ssize_t out_write(struct audio_stream_out* stream, const void* buffer,
   }
 
   lock.unlock();
-  sent = skt_write(out->common.audio_fd, buffer, write_bytes);
+  sent = audio_write(&out->common, buffer, write_bytes);
   lock.lock();
 
   if (sent == -1) {
-    skt_disconnect(out->common.audio_fd);
-    out->common.audio_fd = AUDIO_SKT_DISCONNECTED;
+    audio_disconnect(&out->common);
     if ((out->common.state != AUDIO_HA_STATE_SUSPENDED) &&
         (out->common.state != AUDIO_HA_STATE_STOPPING)) {
       out->common.state = AUDIO_HA_STATE_STOPPED;
@@ -1463,8 +1523,7 @@ static ssize_t in_read(struct audio_stream_in* stream, void* buffer,
   read = skt_read(in->common.audio_fd, buffer, bytes);
   lock.lock();
   if (read == -1) {
-    skt_disconnect(in->common.audio_fd);
-    in->common.audio_fd = AUDIO_SKT_DISCONNECTED;
+    audio_disconnect(&in->common);
     if ((in->common.state != AUDIO_HA_STATE_SUSPENDED) &&
         (in->common.state != AUDIO_HA_STATE_STOPPING)) {
       in->common.state = AUDIO_HA_STATE_STOPPED;
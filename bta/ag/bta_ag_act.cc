@@ -781,11 +781,17 @@ void bta_ag_rfc_data(tBTA_AG_SCB* p_scb, UNUSED_ATTR tBTA_AG_DATA* p_data) {
     if (len == 0) {
       break;
     }
+    buf[len] = 0;
 
-    if (strstr(buf, "AT+IPHONEACCEV") != NULL) {
+    /* Checked before parsing, which can split the arguments in buf */
+    bool accev = (strstr(buf, "AT+IPHONEACCEV") != NULL);
+    bool call_cmd = (strstr(buf, "AT+CHUP") != NULL ||
+                     strstr(buf, "ATA") != NULL || strstr(buf, "ATD") != NULL ||
+                     strstr(buf, "AT+BLDN") != NULL);
+
+    if (accev) {
         APPL_TRACE_IMP("%s: AT+IPHONEACCEV received, not coming out of sniff", __func__);
-    } else if (strstr(buf, "AT+CHUP") != NULL || strstr(buf, "ATA") != NULL ||
-               strstr(buf, "ATD") != NULL || strstr(buf, "AT+BLDN") != NULL) {
+    } else if (call_cmd) {
         APPL_TRACE_IMP("%s: AT+CHUP/ATA/ATD/AT+BLDN received, not coming out of sniff", __func__);
     } else {
         APPL_TRACE_IMP("%s: setting sys busy", __func__);
@@ -798,10 +804,9 @@ void bta_ag_rfc_data(tBTA_AG_SCB* p_scb, UNUSED_ATTR tBTA_AG_DATA* p_data) {
       APPL_TRACE_IMP("%s change link policy for SCO", __func__);
       bta_sys_sco_open(BTA_ID_AG, p_scb->app_id, p_scb->peer_addr);
     } else {
-      if (strstr(buf, "AT+IPHONEACCEV") != NULL) {
+      if (accev) {
           APPL_TRACE_IMP("%s: AT+IPHONEACCEV received, not setting idle", __func__);
-      } else if (strstr(buf, "AT+CHUP") != NULL || strstr(buf, "ATA") != NULL ||
-                 strstr(buf, "ATD") != NULL || strstr(buf, "AT+BLDN") != NULL) {
+      } else if (call_cmd) {
           APPL_TRACE_IMP("%s: AT+CHUP/ATA/ATD/AT+BLDN received, not setting idle", __func__);
       } else {
           APPL_TRACE_IMP("%s: resetting idle timer", __func__);
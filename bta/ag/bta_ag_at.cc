@@ -33,6 +33,145 @@
  *  Constants
  ****************************************************************************/
 
+/* Nodes of the command trie of one AT command table */
+#define BTA_AG_AT_TRIE_MAX_NODES 255
+
+/* AT command tables with a command trie */
+#define BTA_AG_AT_MAX_TRIES 4
+
+/* No command ends at a trie node */
+#define BTA_AG_AT_NO_CMD 0xFFFF
+
+/*****************************************************************************
+ *  Data types
+ ****************************************************************************/
+
+/* One character of the commands in a command trie */
+typedef struct {
+  char c;          /* upper case command character */
+  uint8_t child;   /* first node of the next character, 0 if none */
+  uint8_t sibling; /* next node for the same prefix, 0 if none */
+  uint16_t cmd;    /* first table entry ending here, or BTA_AG_AT_NO_CMD */
+} tBTA_AG_AT_NODE;
+
+/* Command trie of an AT command table, node 0 is the empty prefix */
+typedef struct {
+  const tBTA_AG_AT_CMD* p_at_tbl;
+  uint16_t end_idx; /* index of the end-of-table marker */
+  uint16_t num_nodes;
+  tBTA_AG_AT_NODE nodes[BTA_AG_AT_TRIE_MAX_NODES];
+} tBTA_AG_AT_TRIE;
+
+static tBTA_AG_AT_TRIE bta_ag_at_tries[BTA_AG_AT_MAX_TRIES];
+
+/******************************************************************************
+ *
+ * Function         bta_ag_at_trie_build
+ *
+ * Description      Build the command trie of AT command table |p_at_tbl|
+ *                  into |p_trie|.
+ *
+ *
+ * Returns          false if the table has too many characters for a trie.
+ *
+ *****************************************************************************/
+static bool bta_ag_at_trie_build(tBTA_AG_AT_TRIE* p_trie,
+                                 const tBTA_AG_AT_CMD* p_at_tbl) {
+  memset(p_trie, 0, sizeof(*p_trie));
+  p_trie->num_nodes = 1;
+  p_trie->nodes[0].cmd = BTA_AG_AT_NO_CMD;
+
+  uint16_t idx;
+  for (idx = 0; p_at_tbl[idx].p_cmd[0] != 0; idx++) {
+    uint8_t node = 0;
+    for (const char* p = p_at_tbl[idx].p_cmd; *p != 0; p++) {
+      uint8_t child = p_trie->nodes[node].child;
+      while (child != 0 && p_trie->nodes[child].c != *p)
+        child = p_trie->nodes[child].sibling;
+
+      if (child == 0) {
+        if (p_trie->num_nodes == BTA_AG_AT_TRIE_MAX_NODES) return false;
+        child = p_trie->num_nodes++;
+        p_trie->nodes[child].c = *p;
+        p_trie->nodes[child].cmd = BTA_AG_AT_NO_CMD;
+        p_trie->nodes[child].sibling = p_trie->nodes[node].child;
+        p_trie->nodes[node].child = child;
+      }
+      node = child;
+    }
+
+    /* Earlier entries win, as with a scan of the table */
+    if (p_trie->nodes[node].cmd == BTA_AG_AT_NO_CMD)
+      p_trie->nodes[node].cmd = idx;
+  }
+
+  p_trie->end_idx = idx;
+  p_trie->p_at_tbl = p_at_tbl;
+  return true;
+}
+
+/******************************************************************************
+ *
+ * Function         bta_ag_at_trie_get
+ *
+ * Description      Get the command trie of AT command table |p_at_tbl|,
+ *                  building it on first use.
+ *
+ *
+ * Returns          The trie, NULL if the table has none.
+ *
+ *****************************************************************************/
+static const tBTA_AG_AT_TRIE* bta_ag_at_trie_get(
+    const tBTA_AG_AT_CMD* p_at_tbl) {
+  for (tBTA_AG_AT_TRIE& trie : bta_ag_at_tries) {
+    if (trie.p_at_tbl == p_at_tbl) return &trie;
+    if (trie.p_at_tbl == NULL) {
+      if (!bta_ag_at_trie_build(&trie, p_at_tbl)) {
+        memset(&trie, 0, sizeof(trie));
+        return NULL;
+      }
+      return &trie;
+    }
+  }
+  return NULL;
+}
+
+/******************************************************************************
+ *
+ * Function         bta_ag_at_find_cmd
+ *
+ * Description      Find the first entry of AT command table |p_at_tbl| that
+ *                  is a prefix of |p_cmd|, ignoring the case of |p_cmd|.
+ *
+ *
+ * Returns          Index of the entry, or of the end-of-table marker.
+ *
+ *****************************************************************************/
+static uint16_t bta_ag_at_find_cmd(const tBTA_AG_AT_CMD* p_at_tbl,
+                                   const char* p_cmd) {
+  const tBTA_AG_AT_TRIE* p_trie = bta_ag_at_trie_get(p_at_tbl);
+  uint16_t idx;
+
+  if (p_trie == NULL) {
+    for (idx = 0; p_at_tbl[idx].p_cmd[0] != 0; idx++) {
+      if (!utl_strucmp(p_at_tbl[idx].p_cmd, p_cmd)) break;
+    }
+    return idx;
+  }
+
+  idx = p_trie->end_idx;
+  uint8_t node = 0;
+  for (const char* p = p_cmd; *p != 0; p++) {
+    char c = (*p >= 'a' && *p <= 'z') ? *p - 0x20 : *p;
+    node = p_trie->nodes[node].child;
+    while (node != 0 && p_trie->nodes[node].c != c)
+      node = p_trie->nodes[node].sibling;
+    if (node == 0) break;
+    if (p_trie->nodes[node].cmd < idx) idx = p_trie->nodes[node].cmd;
+  }
+  return idx;
+}
+
 /******************************************************************************
  *
  * Function         bta_ag_at_init
@@ -69,30 +208,26 @@ void bta_ag_at_reinit(tBTA_AG_AT_CB* p_cb) {
  *
  * Function         bta_ag_process_at
  *
- * Description      Parse AT commands.  This function will take the input
- *                  character string and parse it for AT commands according to
+ * Description      Process the AT command |p_cmd|, without its "AT" prefix
+ *                  and ending with a null character at |p_end|, according to
  *                  the AT command table passed in the control block.
  *
  *
  * Returns          void
  *
  *****************************************************************************/
-void bta_ag_process_at(tBTA_AG_AT_CB* p_cb, char* p_end) {
+static void bta_ag_process_at(tBTA_AG_AT_CB* p_cb, char* p_cmd, char* p_end) {
   uint16_t idx;
   uint8_t arg_type;
   char* p_arg;
   int16_t int_arg = 0;
-  /* loop through at command table looking for match */
-  for (idx = 0; p_cb->p_at_tbl[idx].p_cmd[0] != 0; idx++) {
-    if (!utl_strucmp(p_cb->p_at_tbl[idx].p_cmd, p_cb->p_cmd_buf)) {
-      break;
-    }
-  }
+
+  idx = bta_ag_at_find_cmd(p_cb->p_at_tbl, p_cmd);
 
   /* if there is a match; verify argument type */
   if (p_cb->p_at_tbl[idx].p_cmd[0] != 0) {
     /* start of argument is p + strlen matching command */
-    p_arg = p_cb->p_cmd_buf + strlen(p_cb->p_at_tbl[idx].p_cmd);
+    p_arg = p_cmd + strlen(p_cb->p_at_tbl[idx].p_cmd);
     if (p_arg > p_end) {
       (*p_cb->p_err_cback)((tBTA_AG_SCB*)p_cb->p_user, false, NULL);
       android_errorWriteLog(0x534e4554, "112860487");
@@ -154,10 +289,45 @@ void bta_ag_process_at(tBTA_AG_AT_CB* p_cb, char* p_end) {
   }
   /* else no match call error callback */
   else {
-    (*p_cb->p_err_cback)((tBTA_AG_SCB*)p_cb->p_user, true, p_cb->p_cmd_buf);
+    (*p_cb->p_err_cback)((tBTA_AG_SCB*)p_cb->p_user, true, p_cmd);
   }
 }
 
+/******************************************************************************
+ *
+ * Function         bta_ag_at_parse_in_place
+ *
+ * Description      Parse the AT command starting at |p_buf|, if all of it is
+ *                  in the |len| characters of |p_buf|.  The command is
+ *                  parsed where it is, without a copy to the command buffer.
+ *                  |p_buf| is restored before returning.
+ *
+ *
+ * Returns          Number of characters parsed, 0 if the command has to go
+ *                  through the command buffer.
+ *
+ *****************************************************************************/
+static uint16_t bta_ag_at_parse_in_place(tBTA_AG_AT_CB* p_cb, char* p_buf,
+                                         uint16_t len) {
+  /* Same limit as in the command buffer */
+  if (len > p_cb->cmd_max_len - 1) len = p_cb->cmd_max_len - 1;
+
+  for (uint16_t pos = 0; pos < len; pos++) {
+    char c = p_buf[pos];
+    if (c == 0x1A || c == 0x1B) return 0;
+    if (c != '\r' && c != '\n') continue;
+
+    if ((pos > 2) && (p_buf[0] == 'A' || p_buf[0] == 'a') &&
+        (p_buf[1] == 'T' || p_buf[1] == 't')) {
+      p_buf[pos] = 0;
+      bta_ag_process_at(p_cb, p_buf + 2, p_buf + pos);
+      p_buf[pos] = c;
+    }
+    return pos + 1;
+  }
+  return 0;
+}
+
 /******************************************************************************
  *
  * Function         bta_ag_at_parse
@@ -165,6 +335,10 @@ void bta_ag_process_at(tBTA_AG_AT_CB* p_cb, char* p_end) {
  * Description      Parse AT commands.  This function will take the input
  *                  character string and parse it for AT commands according to
  *                  the AT command table passed in the control block.
+ *                  Complete commands are parsed in |p_buf|, which is left
+ *                  as it was apart from changes made by the callbacks.
+ *                  The command table must stay valid and unchanged, its
+ *                  lookup trie is kept for later use.
  *
  *
  * Returns          void
@@ -172,7 +346,6 @@ void bta_ag_process_at(tBTA_AG_AT_CB* p_cb, char* p_end) {
  *****************************************************************************/
 void bta_ag_at_parse(tBTA_AG_AT_CB* p_cb, char* p_buf, uint16_t len) {
   int i = 0;
-  char* p_save;
 
   if (p_cb->p_cmd_buf == NULL) {
     p_cb->p_cmd_buf = (char*)osi_malloc(p_cb->cmd_max_len);
@@ -180,6 +353,17 @@ void bta_ag_at_parse(tBTA_AG_AT_CB* p_cb, char* p_buf, uint16_t len) {
   }
 
   for (i = 0; i < len;) {
+    /* Complete commands are parsed straight from the RFCOMM data */
+    while (p_cb->cmd_pos == 0 && i < len) {
+      if (p_buf[i] == 0) {
+        i++;
+        continue;
+      }
+      uint16_t parsed = bta_ag_at_parse_in_place(p_cb, p_buf + i, len - i);
+      if (parsed == 0) break;
+      i += parsed;
+    }
+
     while (p_cb->cmd_pos < p_cb->cmd_max_len - 1 && i < len) {
       /* Skip null characters between AT commands. */
       if ((p_cb->cmd_pos == 0) && (p_buf[i] == 0)) {
@@ -194,20 +378,19 @@ void bta_ag_at_parse(tBTA_AG_AT_CB* p_cb, char* p_buf, uint16_t len) {
         if ((p_cb->cmd_pos > 2) &&
             (p_cb->p_cmd_buf[0] == 'A' || p_cb->p_cmd_buf[0] == 'a') &&
             (p_cb->p_cmd_buf[1] == 'T' || p_cb->p_cmd_buf[1] == 't')) {
-          p_save = p_cb->p_cmd_buf;
-          char* p_end = p_cb->p_cmd_buf + p_cb->cmd_pos;
-          p_cb->p_cmd_buf += 2;
-          bta_ag_process_at(p_cb, p_end);
-          p_cb->p_cmd_buf = p_save;
+          bta_ag_process_at(p_cb, p_cb->p_cmd_buf + 2,
+                            p_cb->p_cmd_buf + p_cb->cmd_pos);
         }
 
         p_cb->cmd_pos = 0;
+        break;
 
       } else if (p_cb->p_cmd_buf[p_cb->cmd_pos] == 0x1A ||
                  p_cb->p_cmd_buf[p_cb->cmd_pos] == 0x1B) {
         p_cb->p_cmd_buf[++p_cb->cmd_pos] = 0;
         (*p_cb->p_err_cback)((tBTA_AG_SCB*)p_cb->p_user, true, p_cb->p_cmd_buf);
         p_cb->cmd_pos = 0;
+        break;
       } else {
         ++p_cb->cmd_pos;
       }
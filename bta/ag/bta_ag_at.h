@@ -112,6 +112,10 @@ extern void bta_ag_at_reinit(tBTA_AG_AT_CB* p_cb);
  * Description      Parse AT commands.  This function will take the input
  *                  character string and parse it for AT commands according to
  *                  the AT command table passed in the control block.
+ *                  Complete commands are parsed in |p_buf|, which is left
+ *                  as it was apart from changes made by the callbacks.
+ *                  The command table must stay valid and unchanged, its
+ *                  lookup trie is kept for later use.
  *
  *
  * Returns          void
@@ -93,6 +93,21 @@ bool sco_init_rmt_xfer = false;
 #define BTA_AG_XSCO_COLLISION_TIMEOUT_MS (2 * 1000) /* 2 seconds */
 #endif
 
+/* Peers whose last AG initiated SCO/eSCO settings are remembered */
+#ifndef BTA_AG_SCO_SETTINGS_CACHE_SIZE
+#define BTA_AG_SCO_SETTINGS_CACHE_SIZE 8
+#endif
+
+/* Settings of the last AG initiated SCO/eSCO connection opened to a peer */
+typedef struct {
+  RawAddress peer_addr;
+  tBTA_AG_PEER_CODEC codec;                /* CVSD or mSBC */
+  tBTA_AG_SCO_MSBC_SETTINGS msbc_settings; /* T2 or T1 if mSBC */
+} tBTA_AG_SCO_SETTINGS;
+
+static tBTA_AG_SCO_SETTINGS bta_ag_sco_settings[BTA_AG_SCO_SETTINGS_CACHE_SIZE];
+static uint8_t bta_ag_sco_settings_next;
+
 static bool sco_allowed = true;
 static RawAddress active_device_addr;
 
@@ -130,6 +145,96 @@ bool bta_ag_sco_is_active_device(const RawAddress& bd_addr) {
 
 static void bta_ag_create_pending_sco(tBTA_AG_SCB* p_scb, bool is_local);
 
+/*******************************************************************************
+ *
+ * Function         bta_ag_sco_settings_find
+ *
+ * Description      Find the cached SCO/eSCO settings of a peer.
+ *
+ *
+ * Returns          The settings, NULL if none are cached.
+ *
+ ******************************************************************************/
+static tBTA_AG_SCO_SETTINGS* bta_ag_sco_settings_find(
+    const RawAddress& peer_addr) {
+  if (peer_addr.IsEmpty()) return NULL;
+
+  for (tBTA_AG_SCO_SETTINGS& settings : bta_ag_sco_settings) {
+    if (settings.peer_addr == peer_addr) return &settings;
+  }
+  return NULL;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_ag_sco_settings_save
+ *
+ * Description      Remember the codec and mSBC settings with which an AG
+ *                  initiated SCO/eSCO connection opened, replacing the
+ *                  oldest peer if the cache is full.
+ *
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_ag_sco_settings_save(tBTA_AG_SCB* p_scb) {
+  if (p_scb->inuse_codec != BTA_AG_CODEC_CVSD &&
+      p_scb->inuse_codec != BTA_AG_CODEC_MSBC)
+    return;
+#if (SWB_ENABLED == TRUE)
+  if (p_scb->is_swb_codec) return;
+#endif
+
+  tBTA_AG_SCO_SETTINGS* p_settings = bta_ag_sco_settings_find(p_scb->peer_addr);
+  if (p_settings == NULL) {
+    if (p_scb->peer_addr.IsEmpty()) return;
+    p_settings = &bta_ag_sco_settings[bta_ag_sco_settings_next];
+    bta_ag_sco_settings_next =
+        (bta_ag_sco_settings_next + 1) % BTA_AG_SCO_SETTINGS_CACHE_SIZE;
+    p_settings->peer_addr = p_scb->peer_addr;
+  }
+
+  p_settings->codec = p_scb->inuse_codec;
+  p_settings->msbc_settings = p_scb->codec_msbc_settings;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_ag_sco_settings_apply
+ *
+ * Description      Start a new AG initiated SCO/eSCO connection with the
+ *                  settings that last worked with the peer, rather than
+ *                  failing through the settings that did not again. Nothing
+ *                  changes once a fallback has started.
+ *
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_ag_sco_settings_apply(tBTA_AG_SCB* p_scb) {
+  const tBTA_AG_SCO_SETTINGS* p_settings =
+      bta_ag_sco_settings_find(p_scb->peer_addr);
+  if (p_settings == NULL || p_scb->codec_fallback ||
+      p_scb->sco_codec != BTA_AG_CODEC_MSBC ||
+      p_scb->codec_msbc_settings != BTA_AG_SCO_MSBC_SETTINGS_T2)
+    return;
+#if (SWB_ENABLED == TRUE)
+  if (p_scb->is_swb_codec) return;
+#endif
+
+  APPL_TRACE_DEBUG("%s: device %s, cached codec %d, msbc_settings %d",
+                   __func__, p_scb->peer_addr.ToString().c_str(),
+                   p_settings->codec, p_settings->msbc_settings);
+
+  if (p_settings->codec == BTA_AG_CODEC_CVSD) {
+    /* mSBC failed with this peer, negotiate CVSD right away */
+    p_scb->sco_codec = BTA_AG_CODEC_CVSD;
+    p_scb->codec_updated = true;
+  } else {
+    p_scb->codec_msbc_settings = p_settings->msbc_settings;
+  }
+}
+
 /*******************************************************************************
  *
  * Function         bta_ag_sco_conn_cback
@@ -942,6 +1047,9 @@ void bta_ag_codec_negotiate(tBTA_AG_SCB* p_scb) {
   }
 #endif
 
+  if (p_scb->peer_features & BTA_AG_PEER_FEAT_CODEC)
+    bta_ag_sco_settings_apply(p_scb);
+
   if (((p_scb->codec_updated || p_scb->codec_fallback) &&
       (p_scb->peer_features & BTA_AG_PEER_FEAT_CODEC))
 #if (SWB_ENABLED == TRUE)
@@ -2417,6 +2525,9 @@ void bta_ag_sco_conn_open(tBTA_AG_SCB* p_scb,
     p_scb->no_of_xsco_trials = 0;
     alarm_cancel(p_scb->xsco_conn_collision_timer);
 
+    /* start the next AG initiated connection with these settings */
+    if (bta_ag_cb.sco.is_local) bta_ag_sco_settings_save(p_scb);
+
     /* reset to mSBC T2 settings as the preferred */
     p_scb->codec_msbc_settings = BTA_AG_SCO_MSBC_SETTINGS_T2;
 
@@ -109,6 +109,20 @@
 #define BTA_AV_RECONFIG_RETRY 6
 #endif
 
+/* Key of the cached stream discovery results in the peer config section */
+#define BTA_AV_SEP_CACHE_CONFIG_KEY "A2dpSepCache"
+
+/* Format of the cached stream discovery results: a header of the format,
+ * the avdt version and the number of SEPs, then for each SEP its
+ * tAVDT_SEP_INFO and a flag telling if its tAVDT_CFG capabilities follow
+ * at the end. */
+#define BTA_AV_SEP_CACHE_FORMAT 1
+#define BTA_AV_SEP_CACHE_HDR_SIZE 4
+#define BTA_AV_SEP_CACHE_MAX_SIZE              \
+  (BTA_AV_SEP_CACHE_HDR_SIZE +                 \
+   BTA_AV_NUM_SEPS *                           \
+       (sizeof(tAVDT_SEP_INFO) + 1 + sizeof(tAVDT_CFG)))
+
 /* ACL quota we are letting FW use for A2DP Offload Tx. */
 #define BTA_AV_A2DP_OFFLOAD_XMIT_QUOTA 4
 
@@ -426,6 +440,137 @@ static void bta_av_st_rc_timer(tBTA_AV_SCB* p_scb,
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_av_sep_cache_save
+ *
+ * Description      Stores the stream discovery results recorded while opening
+ *                  the stream, to replay them on the next connection to the
+ *                  peer.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_av_sep_cache_save(tBTA_AV_SCB* p_scb) {
+  tBTA_AV_SEP_CACHE* p_cache = p_scb->p_sep_cache;
+  uint8_t* p_buf = (uint8_t*)osi_malloc(BTA_AV_SEP_CACHE_MAX_SIZE);
+  uint8_t* p = p_buf;
+  uint8_t i;
+
+  UINT8_TO_STREAM(p, BTA_AV_SEP_CACHE_FORMAT);
+  UINT16_TO_STREAM(p, p_cache->avdt_version);
+  UINT8_TO_STREAM(p, p_cache->num_seps);
+  for (i = 0; i < p_cache->num_seps; i++) {
+    ARRAY_TO_STREAM(p, (uint8_t*)&p_cache->sep_info[i],
+                    (int)sizeof(tAVDT_SEP_INFO));
+    UINT8_TO_STREAM(p, p_cache->has_caps[i]);
+  }
+  for (i = 0; i < p_cache->num_seps; i++) {
+    if (!p_cache->has_caps[i]) continue;
+    ARRAY_TO_STREAM(p, (uint8_t*)&p_cache->caps[i], (int)sizeof(tAVDT_CFG));
+  }
+
+  btif_config_set_bin(p_scb->peer_addr.ToString().c_str(),
+                      BTA_AV_SEP_CACHE_CONFIG_KEY, p_buf, p - p_buf);
+  APPL_TRACE_DEBUG("%s: peer_addr=%s num_seps=%d avdt_version=0x%x", __func__,
+                   p_scb->peer_addr.ToString().c_str(), p_cache->num_seps,
+                   p_cache->avdt_version);
+  osi_free(p_buf);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_sep_cache_load
+ *
+ * Description      Loads the stream discovery results of the peer stored by
+ *                  an earlier connection into p_scb->p_sep_cache. They are
+ *                  only used if the peer has kept the same avdt version.
+ *
+ * Returns          true if cached results are loaded, false otherwise.
+ *
+ ******************************************************************************/
+static bool bta_av_sep_cache_load(tBTA_AV_SCB* p_scb) {
+  std::string addrstr = p_scb->peer_addr.ToString();
+  const char* bdstr = addrstr.c_str();
+  tBTA_AV_SEP_CACHE* p_cache = p_scb->p_sep_cache;
+  size_t len = btif_config_get_bin_length(bdstr, BTA_AV_SEP_CACHE_CONFIG_KEY);
+  uint8_t format = 0, num_seps = 0, i;
+  uint16_t avdt_version = 0;
+  bool loaded = true;
+
+  if (len < BTA_AV_SEP_CACHE_HDR_SIZE || len > BTA_AV_SEP_CACHE_MAX_SIZE)
+    return false;
+
+  uint8_t* p_buf = (uint8_t*)osi_malloc(len);
+  uint8_t* p = p_buf;
+  uint8_t* p_end = p_buf + len;
+  if (btif_config_get_bin(bdstr, BTA_AV_SEP_CACHE_CONFIG_KEY, p_buf, &len)) {
+    STREAM_TO_UINT8(format, p);
+    STREAM_TO_UINT16(avdt_version, p);
+    STREAM_TO_UINT8(num_seps, p);
+  }
+  if (format != BTA_AV_SEP_CACHE_FORMAT ||
+      avdt_version != p_scb->avdt_version || num_seps == 0 ||
+      num_seps > BTA_AV_NUM_SEPS ||
+      (size_t)(p_end - p) < num_seps * (sizeof(tAVDT_SEP_INFO) + 1)) {
+    osi_free(p_buf);
+    return false;
+  }
+
+  p_cache->avdt_version = avdt_version;
+  p_cache->num_seps = num_seps;
+  for (i = 0; i < num_seps; i++) {
+    STREAM_TO_ARRAY((uint8_t*)&p_cache->sep_info[i], p,
+                    (int)sizeof(tAVDT_SEP_INFO));
+    /* the SEP was free when it was discovered */
+    p_cache->sep_info[i].in_use = false;
+    STREAM_TO_UINT8(p_cache->has_caps[i], p);
+  }
+  for (i = 0; i < num_seps; i++) {
+    if (!p_cache->has_caps[i]) continue;
+    if ((size_t)(p_end - p) < sizeof(tAVDT_CFG)) {
+      loaded = false;
+      break;
+    }
+    STREAM_TO_ARRAY((uint8_t*)&p_cache->caps[i], p, (int)sizeof(tAVDT_CFG));
+  }
+  osi_free(p_buf);
+
+  if (!loaded) {
+    APPL_TRACE_ERROR("%s: truncated cache for peer_addr=%s", __func__, bdstr);
+    btif_config_remove(bdstr, BTA_AV_SEP_CACHE_CONFIG_KEY);
+    return false;
+  }
+  APPL_TRACE_DEBUG("%s: peer_addr=%s num_seps=%d avdt_version=0x%x", __func__,
+                   bdstr, num_seps, avdt_version);
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_sep_cache_post
+ *
+ * Description      Sends the stream event of a discovery step replayed from
+ *                  p_scb->p_sep_cache, in place of the AVDTP confirmation.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_av_sep_cache_post(tBTA_AV_SCB* p_scb, uint16_t event,
+                                  uint8_t avdt_event) {
+  tBTA_AV_STR_MSG* p_msg =
+      (tBTA_AV_STR_MSG*)osi_calloc(sizeof(tBTA_AV_STR_MSG));
+
+  p_msg->hdr.event = event;
+  p_msg->hdr.layer_specific = p_scb->hndl;
+  p_msg->bd_addr = p_scb->peer_addr;
+  p_msg->handle = p_scb->avdt_handle;
+  p_msg->avdt_event = avdt_event;
+  p_msg->msg.discover_cfm.num_seps = p_scb->p_sep_cache->num_seps;
+  p_msg->msg.discover_cfm.p_sep_info = p_scb->sep_info;
+  bta_sys_sendmsg(p_msg);
+}
+
 /*******************************************************************************
  *
  * Function         bta_av_next_getcap
@@ -462,6 +607,16 @@ static bool bta_av_next_getcap(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
         p_scb->p_cap = (tAVDT_CFG*)osi_malloc(sizeof(tAVDT_CFG));
       }
 
+      if (p_scb->sep_cache_replay && p_scb->p_sep_cache->has_caps[i]) {
+        APPL_TRACE_DEBUG("%s: cached capabilities of seid %d", __func__,
+                         p_scb->sep_info[i].seid);
+        memcpy(p_scb->p_cap, &p_scb->p_sep_cache->caps[i], sizeof(tAVDT_CFG));
+        bta_av_sep_cache_post(p_scb, BTA_AV_STR_GETCAP_OK_EVT,
+                              AVDT_GETCAP_CFM_EVT);
+        sent_cmd = true;
+        break;
+      }
+
       if ((p_scb->avdt_version >= AVDT_VERSION_SYNC) &&
           (A2DP_GetAvdtpVersion() >= AVDT_VERSION_SYNC)) {
         p_req = AVDT_GetAllCapReq;
@@ -676,6 +831,8 @@ void bta_av_sink_data_cback(uint8_t handle, BT_HDR* p_pkt, uint32_t time_stamp,
     return;
   }
   p_pkt->event = BTA_AV_SINK_MEDIA_DATA_EVT;
+  /* use the offset area for the time stamp, as on the source path */
+  *(uint32_t*)(p_pkt + 1) = time_stamp;
   p_scb->seps[p_scb->sep_idx].p_app_sink_data_cback(BTA_AV_SINK_MEDIA_DATA_EVT,
                                                     (tBTA_AV_MEDIA*)p_pkt, p_scb->peer_addr);
   /* Free the buffer: a copy of the packet has been delivered */
@@ -1248,6 +1405,8 @@ void bta_av_cleanup(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
 
   /* free any buffers */
   osi_free_and_reset((void**)&p_scb->p_cap);
+  osi_free_and_reset((void**)&p_scb->p_sep_cache);
+  p_scb->sep_cache_replay = false;
   p_scb->sdp_discovery_started = false;
   p_scb->avdt_version = 0;
 
@@ -1664,6 +1823,11 @@ void bta_av_set_tws_chn_mode(tBTA_AV_SCB *p_scb, bool adjust) {
 }
 #endif
 
+OSI_CACHED_PROPERTY(pts_force_abort_property, "bluetooth.pts.force_a2dp_abort",
+                    false);
+OSI_CACHED_PROPERTY(pts_force_start_property, "bluetooth.pts.force_a2dp_start",
+                    false);
+
 /*******************************************************************************
  *
  * Function         bta_av_str_opened
@@ -1680,6 +1844,12 @@ void bta_av_str_opened(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   uint8_t cur_role;
 
   last_sent_vsc_cmd = 0;
+  if (p_scb->p_sep_cache != NULL) {
+    if (!p_scb->sep_cache_replay) bta_av_sep_cache_save(p_scb);
+    osi_free_and_reset((void**)&p_scb->p_sep_cache);
+    p_scb->sep_cache_replay = false;
+  }
+
   msg.hdr.layer_specific = p_scb->hndl;
   msg.is_up = true;
   msg.peer_addr = p_scb->peer_addr;
@@ -1699,6 +1869,7 @@ void bta_av_str_opened(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   APPL_TRACE_DEBUG("%s:updated mtu: %d", __func__, mtu);
   /* Set the media channel as high priority */
   L2CA_SetTxPriority(p_scb->l2c_cid, L2CAP_CHNL_PRIORITY_HIGH);
+  L2CA_SetChnlLatencyCritical(p_scb->l2c_cid, true);
   L2CA_SetChnlFlushability(p_scb->l2c_cid, true);
 
   bta_sys_conn_open(BTA_ID_AV, bta_av_cb.audio_open_cnt, p_scb->peer_addr);
@@ -1808,16 +1979,13 @@ void bta_av_str_opened(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   }
 
   // This code is used to pass PTS TC for AVDTP ABORT
-  char value[PROPERTY_VALUE_MAX] = {0};
-  if ((osi_property_get("bluetooth.pts.force_a2dp_abort", value, "false")) &&
-      (!strcmp(value, "true"))) {
+  if (osi_cached_property_get_bool(&pts_force_abort_property)) {
     APPL_TRACE_ERROR("%s: Calling AVDT_AbortReq", __func__);
     AVDT_AbortReq(p_scb->avdt_handle);
   }
 
   //To pass SNK AVDTP PTS, AVDTP/SNK/INT/SIG/SMG/BV-19-C
-  if ((osi_property_get("bluetooth.pts.force_a2dp_start", value, "false")) &&
-      (!strcmp(value, "true"))) {
+  if (osi_cached_property_get_bool(&pts_force_start_property)) {
     APPL_TRACE_ERROR("%s: Calling AVDT_StartReq", __func__);
     AVDT_StartReq(&p_scb->avdt_handle, 1);
   }
@@ -1993,6 +2161,16 @@ void bta_av_disc_results(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   APPL_TRACE_DEBUG("%s: initiator UUID 0x%x, num_seps = %d",
                  __func__, uuid_int, p_scb->num_seps);
 
+  if (p_scb->p_sep_cache != NULL && !p_scb->sep_cache_replay) {
+    /* record the results to replay them on the next connection */
+    p_scb->p_sep_cache->avdt_version = p_scb->avdt_version;
+    p_scb->p_sep_cache->num_seps = p_scb->num_seps;
+    memcpy(p_scb->p_sep_cache->sep_info, p_scb->sep_info,
+           sizeof(p_scb->sep_info));
+    memset(p_scb->p_sep_cache->has_caps, 0,
+           sizeof(p_scb->p_sep_cache->has_caps));
+  }
+
   for (i = 0; i < p_scb->num_seps; i++) {
     /* steam not in use, is a sink, and is audio */
     if ((p_scb->sep_info[i].in_use == false) &&
@@ -2229,6 +2407,21 @@ void bta_av_open_failed(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
 
   APPL_TRACE_ERROR("%s: peer_addr=%s", __func__,
                    p_scb->peer_addr.ToString().c_str());
+
+  if (p_scb->sep_cache_replay) {
+    /* the peer does not accept its cached stream endpoints any more, drop
+     * them and discover the stream endpoints again */
+    APPL_TRACE_WARNING("%s: cached discovery results failed, rediscovering",
+                       __func__);
+    btif_config_remove(p_scb->peer_addr.ToString().c_str(),
+                       BTA_AV_SEP_CACHE_CONFIG_KEY);
+    p_scb->sep_cache_replay = false;
+    p_scb->state = BTA_AV_OPENING_SST;
+    AVDT_UpdateServiceBusyState(true);
+    bta_av_discover_req(p_scb, p_data);
+    return;
+  }
+
   p_scb->open_status = BTA_AV_FAIL_STREAM;
   bta_av_cco_close(p_scb, p_data);
 
@@ -2308,6 +2501,13 @@ void bta_av_getcap_results(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
     return;
   }
 
+  if (p_scb->p_sep_cache != NULL && !p_scb->sep_cache_replay &&
+      p_scb->sep_info_idx < BTA_AV_NUM_SEPS) {
+    /* record the capabilities to replay them on the next connection */
+    p_scb->p_sep_cache->has_caps[p_scb->sep_info_idx] = true;
+    memcpy(&p_scb->p_sep_cache->caps[p_scb->sep_info_idx], p_scb->p_cap,
+           sizeof(tAVDT_CFG));
+  }
 
   media_type = A2DP_GetMediaType(p_scb->p_cap->codec_info);
   codec_type = A2DP_GetCodecType(p_scb->p_cap->codec_info);
@@ -2458,6 +2658,27 @@ void bta_av_setconfig_rej(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
  *
  ******************************************************************************/
 void bta_av_discover_req(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
+  /* on the first open of the stream, replay the discovery results cached by
+   * the last connection to the peer, or record them */
+  if (p_scb->state == BTA_AV_OPENING_SST) {
+    if (p_scb->p_sep_cache == NULL) {
+      p_scb->p_sep_cache =
+          (tBTA_AV_SEP_CACHE*)osi_calloc(sizeof(tBTA_AV_SEP_CACHE));
+      if (bta_av_sep_cache_load(p_scb)) {
+        APPL_TRACE_DEBUG("%s: replay cached discovery results", __func__);
+        p_scb->sep_cache_replay = true;
+        memcpy(p_scb->sep_info, p_scb->p_sep_cache->sep_info,
+               sizeof(p_scb->sep_info));
+        bta_av_sep_cache_post(p_scb, BTA_AV_STR_DISC_OK_EVT,
+                              AVDT_DISCOVER_CFM_EVT);
+        return;
+      }
+    }
+  } else {
+    osi_free_and_reset((void**)&p_scb->p_sep_cache);
+    p_scb->sep_cache_replay = false;
+  }
+
   /* send avdtp discover request */
   if (AVDT_DiscoverReq(p_scb->peer_addr, p_scb->sep_info,
       BTA_AV_NUM_SEPS, bta_av_dt_cback[p_scb->hdi]) != AVDT_SUCCESS) {
@@ -2947,7 +3168,8 @@ void bta_av_data_path(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
         size_t fragment_len = data_end - data_begin;
         if (fragment_len > p_scb->stream_mtu) fragment_len = p_scb->stream_mtu;
 
-        BT_HDR* p_buf2 = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+        BT_HDR* p_buf2 =
+            (BT_HDR*)osi_malloc(BT_HDR_SIZE + p_buf->offset + fragment_len);
         p_buf2->offset = p_buf->offset;
         p_buf2->len = 0;
         p_buf2->layer_specific = 0;
@@ -2957,7 +3179,10 @@ void bta_av_data_path(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
         p_buf2->len += fragment_len;
         extra_fragments.push_back(p_buf2);
         p_buf->len -= fragment_len;
+        bta_av_cb.media_stats.copies++;
+        bta_av_cb.media_stats.copied_bytes += fragment_len;
       }
+      bta_av_cb.media_stats.packets += 1 + extra_fragments.size();
 
       if (p_scb->current_codec->useRtpHeaderMarkerBit()) {
         m_pt |= AVDT_MARKER_SET;
@@ -1739,11 +1739,12 @@ void bta_av_api_disconnect(tBTA_AV_DATA* p_data) {
   alarm_cancel(bta_av_cb.browsing_channel_open_timer);
 }
 
+OSI_CACHED_PROPERTY(pts_certification_property, "vendor.bt.pts.certification",
+                    false);
+
 static uint16_t bta_sink_time_out() {
-  char value[PROPERTY_VALUE_MAX] = {0};
   uint16_t pts_bta_accept_timeout = 5000;
-  osi_property_get("vendor.bt.pts.certification", value, "false");
-  if(!strcmp(value, "true")){
+  if (osi_cached_property_get_bool(&pts_certification_property)) {
       return pts_bta_accept_timeout; // increase timeout value to pass PTS;
   }
   return BTA_AV_ACCEPT_SIGNALLING_TIMEOUT_MS;
@@ -302,6 +302,19 @@ void BTA_AvOffloadStartRsp(tBTA_AV_HNDL hndl, tBTA_AV_STATUS status) {
   bta_sys_sendmsg(p_buf);
 }
 
+/*******************************************************************************
+ *
+ * Function         BTA_AvGetMediaStats
+ *
+ * Description      Gets the copy counters of the A2DP source media data path.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTA_AvGetMediaStats(tBTA_AV_MEDIA_STATS* p_stats) {
+  *p_stats = bta_av_cb.media_stats;
+}
+
 /*******************************************************************************
  *
  * Function         BTA_AvStop
@@ -632,6 +632,15 @@ typedef union {
 #define BTA_AV_COLL_SETCONFIG_IND \
   0x04 /* SetConfig indication has been called by remote */
 
+/* Stream discovery results of a peer, replayed on the next connection */
+typedef struct {
+  uint16_t avdt_version; /* the avdt version of peer device when discovered */
+  uint8_t num_seps;
+  tAVDT_SEP_INFO sep_info[BTA_AV_NUM_SEPS];
+  bool has_caps[BTA_AV_NUM_SEPS];
+  tAVDT_CFG caps[BTA_AV_NUM_SEPS];
+} tBTA_AV_SEP_CACHE;
+
 /* type for AV stream control block */
 struct tBTA_AV_SCB {
   const tBTA_AV_ACT* p_act_tbl; /* the action table for stream state machine */
@@ -642,6 +651,8 @@ struct tBTA_AV_SCB {
   list_t* a2dp_list; /* used for audio channels only */
   tBTA_AV_Q_INFO q_info;
   tAVDT_SEP_INFO sep_info[BTA_AV_NUM_SEPS]; /* stream discovery results */
+  tBTA_AV_SEP_CACHE* p_sep_cache; /* discovery results of the peer */
+  bool sep_cache_replay; /* true if p_sep_cache replaces the discovery */
   tAVDT_CFG cfg;                            /* local SEP configuration */
   alarm_t* avrc_ct_timer;                   /* delay timer for AVRC CT */
   RawAddress peer_addr;                     /* peer BD address */
@@ -774,6 +785,7 @@ typedef struct {
   bool sco_occupied; /* true if SCO is being used or call is in progress */
   uint8_t audio_streams; /* handle mask of streaming audio channels */
   uint8_t video_streams; /* handle mask of streaming video channels */
+  tBTA_AV_MEDIA_STATS media_stats; /* media data path copy counters */
 } tBTA_AV_CB;
 
 /* SPLITA2DP */
@@ -67,6 +67,7 @@
 
 #include "bta_av_co.h"
 #include "bta_av_int.h"
+#include "bta_sys_sm.h"
 #include "btm_int.h"
 #include "btif/include/btif_av_co.h"
 #include "l2c_api.h"
@@ -147,7 +148,7 @@ const tBTA_AV_ACTION bta_av_action[] = {
 #define BTA_AV_NUM_COLS 2   /* number of columns in state tables */
 
 /* state table for init state */
-static const uint8_t bta_av_st_init[][BTA_AV_NUM_COLS] = {
+static constexpr uint8_t bta_av_st_init[][BTA_AV_NUM_COLS] = {
     /* Event                     Action 1                   Next state */
     /* API_DISABLE_EVT */ {BTA_AV_DISABLE, BTA_AV_INIT_ST},
     /* API_REMOTE_CMD_EVT */ {BTA_AV_IGNORE, BTA_AV_INIT_ST},
@@ -161,7 +162,7 @@ static const uint8_t bta_av_st_init[][BTA_AV_NUM_COLS] = {
 };
 
 /* state table for open state */
-static const uint8_t bta_av_st_open[][BTA_AV_NUM_COLS] = {
+static constexpr uint8_t bta_av_st_open[][BTA_AV_NUM_COLS] = {
     /* Event                     Action 1                   Next state */
     /* API_DISABLE_EVT */ {BTA_AV_DISABLE, BTA_AV_INIT_ST},
     /* API_REMOTE_CMD_EVT */ {BTA_AV_RC_REMOTE_CMD, BTA_AV_OPEN_ST},
@@ -174,11 +175,11 @@ static const uint8_t bta_av_st_open[][BTA_AV_NUM_COLS] = {
     /* AVRC_NONE_EVT */ {BTA_AV_IGNORE, BTA_AV_INIT_ST},
 };
 
-/* type for state table */
-typedef const uint8_t (*tBTA_AV_ST_TBL)[BTA_AV_NUM_COLS];
-
 /* state table */
-static const tBTA_AV_ST_TBL bta_av_st_tbl[] = {bta_av_st_init, bta_av_st_open};
+static constexpr BtaSysStateTables<BTA_AV_OPEN_ST + 1,
+                                   BTA_AV_LAST_SM_EVT - BTA_AV_FIRST_SM_EVT + 1,
+                                   BTA_AV_NUM_COLS - 1>
+    bta_av_st_tbl(BTA_AV_NUM_ACTIONS, bta_av_st_init, bta_av_st_open);
 
 typedef void (*tBTA_AV_NSM_ACT)(tBTA_AV_DATA* p_data);
 static void bta_av_api_enable(tBTA_AV_DATA* p_data);
@@ -433,6 +434,7 @@ void bta_av_free_scb(tBTA_AV_SCB* p_scb) {
   CHECK(p_scb == bta_av_cb.p_scb[scb_index]);
   bta_av_cb.p_scb[scb_index] = nullptr;
   alarm_free(p_scb->avrc_ct_timer);
+  osi_free(p_scb->p_sep_cache);
   osi_free(p_scb);
 }
 
@@ -1514,6 +1516,7 @@ void bta_av_dup_audio_buf(tBTA_AV_SCB* p_scb, BT_HDR* p_buf) {
     return;
   }
 
+  /* the offset area holds the time stamp and the AVDT/L2CAP headroom */
   uint16_t copy_size = BT_HDR_SIZE + p_buf->len + p_buf->offset;
   for (int i = 0; i < BTA_AV_NUM_STRS; i++) {
     tBTA_AV_SCB* p_scbi = bta_av_cb.p_scb[i];
@@ -1524,10 +1527,28 @@ void bta_av_dup_audio_buf(tBTA_AV_SCB* p_scb, BT_HDR* p_buf) {
     if (!(bta_av_cb.conn_audio & BTA_AV_HNDL_TO_MSK(i)))
       continue; /* Audio is not connected */
 
+    /* The packet was encoded once for the configuration of p_scb, the other
+     * sinks can only decode it with the same codec, rate and channels */
+    if (!A2DP_CodecTypeEquals(p_scb->cfg.codec_info, p_scbi->cfg.codec_info) ||
+        A2DP_GetTrackSampleRate(p_scb->cfg.codec_info) !=
+            A2DP_GetTrackSampleRate(p_scbi->cfg.codec_info) ||
+        A2DP_GetTrackChannelCount(p_scb->cfg.codec_info) !=
+            A2DP_GetTrackChannelCount(p_scbi->cfg.codec_info)) {
+      if (bta_av_cb.media_stats.fanout_mismatches++ == 0) {
+        APPL_TRACE_WARNING("%s: hndl 0x%x codec %s differs from %s", __func__,
+                           p_scbi->hndl,
+                           A2DP_CodecName(p_scbi->cfg.codec_info),
+                           A2DP_CodecName(p_scb->cfg.codec_info));
+      }
+    }
+
     /* Enqueue the data */
     BT_HDR* p_new = (BT_HDR*)osi_malloc(copy_size);
     memcpy(p_new, p_buf, copy_size);
     list_append(p_scbi->a2dp_list, p_new);
+    bta_av_cb.media_stats.copies++;
+    bta_av_cb.media_stats.copied_bytes += p_buf->len;
+    bta_av_cb.media_stats.fanout_packets++;
 
     if (list_length(p_scbi->a2dp_list) > p_bta_av_cfg->audio_mqs) {
       // Drop the oldest packet
@@ -1550,24 +1571,24 @@ void bta_av_dup_audio_buf(tBTA_AV_SCB* p_scb, BT_HDR* p_buf) {
  *
  ******************************************************************************/
 void bta_av_sm_execute(tBTA_AV_CB* p_cb, uint16_t event, tBTA_AV_DATA* p_data) {
-  tBTA_AV_ST_TBL state_table;
+  const uint8_t* entry;
   uint8_t action;
 
   APPL_TRACE_EVENT("%s: AV event=0x%x(%s) state=%d(%s)", __func__, event,
                    bta_av_evt_code(event), p_cb->state,
                    bta_av_st_code(p_cb->state));
 
-  /* look up the state table for the current state */
-  state_table = bta_av_st_tbl[p_cb->state];
-
   event &= 0x00FF;
 
+  /* look up the state table entry for the current state and the event */
+  entry = bta_av_st_tbl.Row(p_cb->state, event);
+
   /* set next state */
-  p_cb->state = state_table[event][BTA_AV_NEXT_STATE];
+  p_cb->state = entry[BTA_AV_NEXT_STATE];
   APPL_TRACE_EVENT("next state=%d event offset:%d", p_cb->state, event);
 
   /* execute action functions */
-  action = state_table[event][BTA_AV_ACTION_COL];
+  action = entry[BTA_AV_ACTION_COL];
   if (action != BTA_AV_IGNORE) {
     APPL_TRACE_EVENT("%s action executed %d", __func__, action);
     (*bta_av_action[action])(p_cb, p_data);
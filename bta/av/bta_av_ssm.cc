@@ -30,6 +30,7 @@
 #include "bt_target.h"
 #include "bta_av_co.h"
 #include "bta_av_int.h"
+#include "bta_sys_sm.h"
 
 /*****************************************************************************
  * Constants and types
@@ -111,7 +112,7 @@ enum {
 #define BTA_AV_NUM_COLS 3    /* number of columns in state tables */
 
 /* state table for init state */
-static const uint8_t bta_av_sst_init[][BTA_AV_NUM_COLS] = {
+static constexpr uint8_t bta_av_sst_init[][BTA_AV_NUM_COLS] = {
     /* Event                     Action 1               Action 2 Next state */
     /* AP_OPEN_EVT */ {BTA_AV_DO_DISC, BTA_AV_SIGNORE, BTA_AV_OPENING_SST},
     /* AP_CLOSE_EVT */ {BTA_AV_CLEANUP, BTA_AV_SIGNORE, BTA_AV_INIT_SST},
@@ -161,7 +162,7 @@ static const uint8_t bta_av_sst_init[][BTA_AV_NUM_COLS] = {
     /* COLLISION_EVT */ {BTA_AV_SIGNORE, BTA_AV_SIGNORE, BTA_AV_INIT_SST}};
 
 /* state table for incoming state */
-static const uint8_t bta_av_sst_incoming[][BTA_AV_NUM_COLS] = {
+static constexpr uint8_t bta_av_sst_incoming[][BTA_AV_NUM_COLS] = {
     /* Event                     Action 1               Action 2 Next state */
     /* AP_OPEN_EVT */ {BTA_AV_OPEN_AT_INC, BTA_AV_SIGNORE, BTA_AV_INCOMING_SST},
     /* AP_CLOSE_EVT */ {BTA_AV_CCO_CLOSE, BTA_AV_DISCONNECT_REQ,
@@ -232,7 +233,7 @@ static const uint8_t bta_av_sst_incoming[][BTA_AV_NUM_COLS] = {
     /* COLLISION_EVT */ {BTA_AV_SIGNORE, BTA_AV_SIGNORE, BTA_AV_INCOMING_SST}};
 
 /* state table for opening state */
-static const uint8_t bta_av_sst_opening[][BTA_AV_NUM_COLS] = {
+static constexpr uint8_t bta_av_sst_opening[][BTA_AV_NUM_COLS] = {
     /* Event                     Action 1               Action 2 Next state */
     /* AP_OPEN_EVT */ {BTA_AV_SIGNORE, BTA_AV_SIGNORE, BTA_AV_OPENING_SST},
     /* AP_CLOSE_EVT */ {BTA_AV_DO_CLOSE, BTA_AV_STR_CLOSED, BTA_AV_INIT_SST},
@@ -301,7 +302,7 @@ static const uint8_t bta_av_sst_opening[][BTA_AV_NUM_COLS] = {
     /* COLLISION_EVT */ {BTA_AV_HANDLE_COLLISION, BTA_AV_SIGNORE, BTA_AV_INIT_SST}};
 
 /* state table for open state */
-static const uint8_t bta_av_sst_open[][BTA_AV_NUM_COLS] = {
+static constexpr uint8_t bta_av_sst_open[][BTA_AV_NUM_COLS] = {
     /* Event                     Action 1               Action 2 Next state */
     /* AP_OPEN_EVT */ {BTA_AV_SIGNORE, BTA_AV_SIGNORE, BTA_AV_OPEN_SST},
     /* AP_CLOSE_EVT */ {BTA_AV_DO_CLOSE, BTA_AV_SIGNORE, BTA_AV_CLOSING_SST},
@@ -359,7 +360,7 @@ static const uint8_t bta_av_sst_open[][BTA_AV_NUM_COLS] = {
     /* COLLISION_EVT */ {BTA_AV_SIGNORE, BTA_AV_SIGNORE, BTA_AV_OPEN_SST}};
 
 /* state table for reconfig state */
-static const uint8_t bta_av_sst_rcfg[][BTA_AV_NUM_COLS] = {
+static constexpr uint8_t bta_av_sst_rcfg[][BTA_AV_NUM_COLS] = {
     /* Event                     Action 1               Action 2 Next state */
     /* AP_OPEN_EVT */ {BTA_AV_SIGNORE, BTA_AV_SIGNORE, BTA_AV_RCFG_SST},
     /* AP_CLOSE_EVT */ {BTA_AV_DISCONNECT_REQ, BTA_AV_SIGNORE,
@@ -417,7 +418,7 @@ static const uint8_t bta_av_sst_rcfg[][BTA_AV_NUM_COLS] = {
     /* COLLISION_EVT */ {BTA_AV_SIGNORE, BTA_AV_SIGNORE, BTA_AV_RCFG_SST}};
 
 /* state table for closing state */
-static const uint8_t bta_av_sst_closing[][BTA_AV_NUM_COLS] = {
+static constexpr uint8_t bta_av_sst_closing[][BTA_AV_NUM_COLS] = {
     /* Event                     Action 1               Action 2 Next state */
     /* AP_OPEN_EVT */ {BTA_AV_SIGNORE, BTA_AV_SIGNORE, BTA_AV_CLOSING_SST},
     /* AP_CLOSE_EVT */ {BTA_AV_DISCONNECT_REQ, BTA_AV_STR_CLOSED,
@@ -482,13 +483,13 @@ static const uint8_t bta_av_sst_closing[][BTA_AV_NUM_COLS] = {
                                      BTA_AV_CLOSING_SST},
     /* COLLISION_EVT */ {BTA_AV_SIGNORE, BTA_AV_SIGNORE, BTA_AV_CLOSING_SST}};
 
-/* type for state table */
-typedef const uint8_t (*tBTA_AV_SST_TBL)[BTA_AV_NUM_COLS];
-
 /* state table */
-static const tBTA_AV_SST_TBL bta_av_sst_tbl[] = {
-    bta_av_sst_init, bta_av_sst_incoming, bta_av_sst_opening,
-    bta_av_sst_open, bta_av_sst_rcfg,     bta_av_sst_closing};
+static constexpr BtaSysStateTables<BTA_AV_CLOSING_SST + 1,
+                                   BTA_AV_FIRST_NSM_EVT - BTA_AV_FIRST_SSM_EVT,
+                                   BTA_AV_SACTIONS>
+    bta_av_sst_tbl(BTA_AV_NUM_SACTIONS, bta_av_sst_init, bta_av_sst_incoming,
+                   bta_av_sst_opening, bta_av_sst_open, bta_av_sst_rcfg,
+                   bta_av_sst_closing);
 
 static const char* bta_av_sst_code(uint8_t state);
 
@@ -524,7 +525,7 @@ bool bta_av_is_rcfg_sst(tBTA_AV_SCB* p_scb) {
  ******************************************************************************/
 void bta_av_ssm_execute(tBTA_AV_SCB* p_scb, uint16_t event,
                         tBTA_AV_DATA* p_data) {
-  tBTA_AV_SST_TBL state_table;
+  const uint8_t* entry;
   uint8_t action;
   int i, xx;
 
@@ -557,13 +558,13 @@ void bta_av_ssm_execute(tBTA_AV_SCB* p_scb, uint16_t event,
                      p_scb->hndl, event, bta_av_evt_code(event), p_scb->state,
                      bta_av_sst_code(p_scb->state));
 
-  /* look up the state table for the current state */
-  state_table = bta_av_sst_tbl[p_scb->state];
-
   event -= BTA_AV_FIRST_SSM_EVT;
 
+  /* look up the state table entry for the current state and the event */
+  entry = bta_av_sst_tbl.Row(p_scb->state, event);
+
   if ((p_scb->state != BTA_AV_OPENING_SST) &&
-      (state_table[event][BTA_AV_SNEXT_STATE] == BTA_AV_OPENING_SST)) {
+      (entry[BTA_AV_SNEXT_STATE] == BTA_AV_OPENING_SST)) {
     AVDT_UpdateServiceBusyState(true);
   } else if(AVDT_GetServiceBusyState() == true) {
     bool keep_busy = true;
@@ -580,8 +581,7 @@ void bta_av_ssm_execute(tBTA_AV_SCB* p_scb, uint16_t event,
           break;
         } else if ((bta_av_cb.p_scb[xx]->state == BTA_AV_OPENING_SST) &&
                     (bta_av_cb.p_scb[xx] == p_scb) &&
-                    (state_table[event][BTA_AV_SNEXT_STATE] !=
-                     BTA_AV_OPENING_SST)) {
+                    (entry[BTA_AV_SNEXT_STATE] != BTA_AV_OPENING_SST)) {
           keep_busy = false;
         }
       }
@@ -591,11 +591,11 @@ void bta_av_ssm_execute(tBTA_AV_SCB* p_scb, uint16_t event,
   }
 
   /* set next state */
-  p_scb->state = state_table[event][BTA_AV_SNEXT_STATE];
+  p_scb->state = entry[BTA_AV_SNEXT_STATE];
 
   /* execute action functions */
   for (i = 0; i < BTA_AV_SACTIONS; i++) {
-    action = state_table[event][i];
+    action = entry[i];
     if (action != BTA_AV_SIGNORE) {
       (*p_scb->p_act_tbl[action])(p_scb, p_data);
     } else
@@ -28,7 +28,13 @@
 #include <base/bind.h>
 #include <base/callback.h>
 #include <base/logging.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#include <map>
+#include <string>
+#include <vector>
 
 #include "bt_common.h"
 #include "bt_target.h"
@@ -124,6 +130,14 @@ static void bta_dm_bond_cancel_complete_cback(tBTM_STATUS result);
 static bool bta_dm_read_remote_device_name(const RawAddress& bd_addr,
                                            tBT_TRANSPORT transport);
 static void bta_dm_discover_device(const RawAddress& remote_bd_addr);
+static bool bta_dm_sdp_cache_read(const RawAddress& bd_addr);
+static void bta_dm_sdp_cache_write(const RawAddress& bd_addr,
+                                   const std::vector<Uuid>& uuid_list);
+static void bta_dm_sdp_cache_remove(const RawAddress& bd_addr);
+static bool bta_dm_inq_res_is_repeat(const tBTA_DM_INQ_RES* p_res);
+static bool bta_dm_sdp_next_start(const RawAddress& bd_addr);
+static bool bta_dm_sdp_next_take(void);
+static void bta_dm_sdp_next_abandon(void);
 
 static void bta_dm_sys_hw_cback(tBTA_SYS_HW_EVT status);
 static void bta_dm_disable_search_and_disc(void);
@@ -153,6 +167,57 @@ static void bta_dm_ctrl_features_rd_cmpl_cback(tBTM_STATUS result);
 #define EDR_TECH_VALUE 0x01
 #define BLE_TECH_VALUE 0x02
 
+/* Time (in seconds) a full service discovery of a bonded device is answered
+ * from the stored result, 0 disables the cache */
+#ifndef BTA_DM_SDP_CACHE_TTL_SEC
+#define BTA_DM_SDP_CACHE_TTL_SEC (7 * 24 * 60 * 60)
+#endif
+
+/* Runs the L2CAP search of a full service discovery along with the PnP
+ * search, on a second SDP channel */
+#ifndef BTA_DM_SDP_PIPELINE
+#define BTA_DM_SDP_PIPELINE TRUE
+#endif
+
+/* States of the L2CAP search run along with the PnP search */
+enum {
+  BTA_DM_SDP_NEXT_NONE,
+  BTA_DM_SDP_NEXT_PENDING, /* Started */
+  BTA_DM_SDP_NEXT_WAITING, /* Started, and the PnP search is done */
+  BTA_DM_SDP_NEXT_DONE     /* Complete, the PnP search is not done */
+};
+
+/* Devices whose last inquiry result is remembered during a search, so that
+ * unchanged repeats are not sent up again. 0 forwards every result. */
+#ifndef BTA_DM_INQ_DEDUP_MAX_DEVICES
+#define BTA_DM_INQ_DEDUP_MAX_DEVICES 256
+#endif
+
+/* RSSI change (in dB) that makes a repeated inquiry result worth sending */
+#ifndef BTA_DM_INQ_DEDUP_RSSI_DELTA
+#define BTA_DM_INQ_DEDUP_RSSI_DELTA 8
+#endif
+
+/* What a device reported last in the current search */
+typedef struct {
+  DEV_CLASS dev_class;
+  int8_t rssi;
+  uint8_t inq_result_type;
+  uint8_t device_type;
+  uint8_t flag;
+  uint16_t eir_len;
+  uint32_t eir_hash;
+  bool name_known; /* The application knows the name from this result */
+} tBTA_DM_INQ_SEEN;
+
+static std::map<RawAddress, tBTA_DM_INQ_SEEN> bta_dm_inq_seen;
+static uint32_t bta_dm_inq_res_dropped;
+
+/* Config keys of the stored service discovery result */
+#define BTA_DM_SDP_CACHE_TIME_KEY "SdpCacheTime"
+#define BTA_DM_SDP_CACHE_SERVICES_KEY "SdpCacheServices"
+#define BTA_DM_SDP_CACHE_UUIDS_KEY "SdpCacheUuids"
+
 /* Disable timer interval (in milliseconds) */
 #ifndef BTA_DM_DISABLE_TIMER_MS
 #define BTA_DM_DISABLE_TIMER_MS 5000
@@ -1378,6 +1443,8 @@ void bta_dm_search_start(tBTA_DM_MSG* p_data) {
   }
 
   BTM_ClearInqDb(NULL);
+  bta_dm_inq_seen.clear();
+  bta_dm_inq_res_dropped = 0;
   /* save search params */
   bta_dm_search_cb.p_search_cback = p_data->search.p_cback;
   bta_dm_search_cb.services = p_data->search.services;
@@ -1485,6 +1552,7 @@ void bta_dm_discover(tBTA_DM_MSG* p_data) {
 
   bta_dm_search_cb.name_discover_done = false;
   bta_dm_search_cb.uuid = p_data->discover.uuid;
+  bta_dm_sdp_next_abandon();
   bta_dm_discover_device(p_data->discover.bd_addr);
 }
 
@@ -1650,7 +1718,9 @@ static bool bta_dm_read_remote_device_name(const RawAddress& bd_addr,
 void bta_dm_inq_cmpl(tBTA_DM_MSG* p_data) {
   tBTA_DM_SEARCH data;
 
-  APPL_TRACE_DEBUG("bta_dm_inq_cmpl");
+  APPL_TRACE_DEBUG("bta_dm_inq_cmpl: %zu devices, %u repeated results dropped",
+                   bta_dm_inq_seen.size(), bta_dm_inq_res_dropped);
+  bta_dm_inq_seen.clear();
 
   data.inq_cmpl.num_resps = p_data->inq_cmpl.num;
   bta_dm_search_cb.p_search_cback(BTA_DM_INQ_CMPL_EVT, &data);
@@ -1859,6 +1929,140 @@ void bta_dm_store_di_info(tSDP_DISC_REC* sdp_rec, uint16_t vendor_id,
    btif_config_save();
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_dm_sdp_cache_remove
+ *
+ * Description      Removes the stored service discovery result of a device
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_dm_sdp_cache_remove(const RawAddress& bd_addr) {
+  std::string bdstr = bd_addr.ToString();
+
+  if (!btif_config_exist(bdstr.c_str(), BTA_DM_SDP_CACHE_TIME_KEY)) return;
+
+  APPL_TRACE_DEBUG("%s %s", __func__, bdstr.c_str());
+  btif_config_remove(bdstr.c_str(), BTA_DM_SDP_CACHE_TIME_KEY);
+  btif_config_remove(bdstr.c_str(), BTA_DM_SDP_CACHE_SERVICES_KEY);
+  btif_config_remove(bdstr.c_str(), BTA_DM_SDP_CACHE_UUIDS_KEY);
+  btif_config_save();
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_dm_sdp_cache_write
+ *
+ * Description      Stores the result of a full service discovery of a bonded
+ *                  device, so that the next ones are answered without SDP
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_dm_sdp_cache_write(const RawAddress& bd_addr,
+                                   const std::vector<Uuid>& uuid_list) {
+  if (BTA_DM_SDP_CACHE_TTL_SEC == 0 || !btm_sec_is_a_bonded_dev(bd_addr))
+    return;
+
+  std::string bdstr = bd_addr.ToString();
+  std::vector<uint8_t> uuids;
+  for (const Uuid& uuid : uuid_list) {
+    const Uuid::UUID128Bit& bytes = uuid.To128BitBE();
+    uuids.insert(uuids.end(), bytes.begin(), bytes.end());
+  }
+
+  btif_config_set_uint64(bdstr.c_str(), BTA_DM_SDP_CACHE_SERVICES_KEY,
+                         bta_dm_search_cb.services_found);
+  btif_config_set_bin(bdstr.c_str(), BTA_DM_SDP_CACHE_UUIDS_KEY, uuids.data(),
+                      uuids.size());
+  btif_config_set_uint64(bdstr.c_str(), BTA_DM_SDP_CACHE_TIME_KEY,
+                         (uint64_t)time(NULL));
+  btif_config_save();
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_dm_sdp_cache_read
+ *
+ * Description      Answers a full service discovery of a bonded device from
+ *                  its stored result, if the result has not expired and the
+ *                  EIR of the device does not list any other service.
+ *
+ * Returns          true if the discovery result was sent, else false
+ *
+ ******************************************************************************/
+static bool bta_dm_sdp_cache_read(const RawAddress& bd_addr) {
+  std::string bdstr = bd_addr.ToString();
+  uint64_t cache_time;
+  tBTA_SERVICE_MASK services;
+
+  if (BTA_DM_SDP_CACHE_TTL_SEC == 0 || !btm_sec_is_a_bonded_dev(bd_addr) ||
+      !btif_config_get_uint64(bdstr.c_str(), BTA_DM_SDP_CACHE_TIME_KEY,
+                              &cache_time) ||
+      !btif_config_get_uint64(bdstr.c_str(), BTA_DM_SDP_CACHE_SERVICES_KEY,
+                              &services))
+    return false;
+
+  uint64_t now = (uint64_t)time(NULL);
+  if (now < cache_time || now - cache_time > BTA_DM_SDP_CACHE_TTL_SEC) {
+    APPL_TRACE_DEBUG("%s %s: expired", __func__, bdstr.c_str());
+    bta_dm_sdp_cache_remove(bd_addr);
+    return false;
+  }
+
+  /* The device has changed its services since they were stored */
+  if (bta_dm_search_cb.p_btm_inq_info != NULL) {
+    tBTA_SERVICE_MASK eir_to_search = BTA_ALL_SERVICE_MASK;
+    tBTA_SERVICE_MASK eir_found = 0;
+    bta_dm_eir_search_services(&bta_dm_search_cb.p_btm_inq_info->results,
+                               &eir_to_search, &eir_found);
+    if (eir_found & ~services) {
+      APPL_TRACE_DEBUG("%s %s: EIR services 0x%" PRIx64 " not stored",
+                       __func__, bdstr.c_str(), eir_found & ~services);
+      bta_dm_sdp_cache_remove(bd_addr);
+      return false;
+    }
+  }
+
+  size_t len = btif_config_get_bin_length(bdstr.c_str(),
+                                          BTA_DM_SDP_CACHE_UUIDS_KEY);
+  if (len % Uuid::kNumBytes128 != 0) {
+    bta_dm_sdp_cache_remove(bd_addr);
+    return false;
+  }
+
+  tBTA_DM_MSG* p_msg = (tBTA_DM_MSG*)osi_malloc(sizeof(tBTA_DM_MSG));
+  p_msg->hdr.event = BTA_DM_DISCOVERY_RESULT_EVT;
+  memset(&(p_msg->disc_result.result), 0, sizeof(tBTA_DM_DISC_RES));
+  p_msg->disc_result.result.disc_res.result = BTA_SUCCESS;
+  p_msg->disc_result.result.disc_res.services = services;
+  p_msg->disc_result.result.disc_res.bd_addr = bd_addr;
+  strlcpy((char*)p_msg->disc_result.result.disc_res.bd_name,
+          bta_dm_get_remname(), BD_NAME_LEN + 1);
+
+  if (len > 0) {
+    std::vector<uint8_t> uuids(len);
+    btif_config_get_bin(bdstr.c_str(), BTA_DM_SDP_CACHE_UUIDS_KEY, uuids.data(),
+                        &len);
+    uint16_t num_uuids = len / Uuid::kNumBytes128;
+    Uuid* p_uuid_list = (Uuid*)osi_malloc(num_uuids * sizeof(Uuid));
+    for (uint16_t i = 0; i < num_uuids; i++) {
+      p_uuid_list[i] = Uuid::From128BitBE(&uuids[i * Uuid::kNumBytes128]);
+    }
+    p_msg->disc_result.result.disc_res.num_uuids = num_uuids;
+    p_msg->disc_result.result.disc_res.p_uuid_list = p_uuid_list;
+  }
+
+  APPL_TRACE_EVENT("%s %s: services 0x%" PRIx64 ", %d UUIDs", __func__,
+                   bdstr.c_str(), services,
+                   p_msg->disc_result.result.disc_res.num_uuids);
+  bta_dm_search_cb.services_found = services;
+  bta_dm_search_cb.wait_disc = false;
+  bta_sys_sendmsg(p_msg);
+  return true;
+}
+
 /*******************************************************************************
  *
  * Function         bta_dm_sdp_result
@@ -2069,6 +2273,10 @@ void bta_dm_sdp_result(tBTA_DM_MSG* p_data) {
       strlcpy((char*)p_msg->disc_result.result.disc_res.bd_name,
               bta_dm_get_remname(), BD_NAME_LEN + 1);
 
+      if (bta_dm_search_cb.services == BTA_ALL_SERVICE_MASK &&
+          !bta_dm_search_cb.sdp_search)
+        bta_dm_sdp_cache_write(bta_dm_search_cb.peer_bdaddr, uuid_list);
+
       bta_sys_sendmsg(p_msg);
     }
   } else {
@@ -2082,6 +2290,10 @@ void bta_dm_sdp_result(tBTA_DM_MSG* p_data) {
     if (bta_dm_search_cb.p_sdp_db)
       osi_free_and_reset((void**)&bta_dm_search_cb.p_sdp_db);
 
+    /* Do not answer the next discovery from a result that may be stale */
+    bta_dm_sdp_cache_remove(bta_dm_search_cb.peer_bdaddr);
+    bta_dm_sdp_next_abandon();
+
     BTM_SecDeleteRmtNameNotifyCallback(&bta_dm_service_search_remname_cback);
 
     p_msg = (tBTA_DM_MSG*)osi_malloc(sizeof(tBTA_DM_MSG));
@@ -2286,6 +2498,7 @@ void bta_dm_search_cancel_cmpl(UNUSED_ATTR tBTA_DM_MSG* p_data) {
  ******************************************************************************/
 void bta_dm_search_cancel_transac_cmpl(UNUSED_ATTR tBTA_DM_MSG* p_data) {
   osi_free_and_reset((void**)&bta_dm_search_cb.p_sdp_db);
+  bta_dm_sdp_next_abandon();
   bta_dm_search_cancel_notify(NULL);
 }
 
@@ -2320,6 +2533,13 @@ void bta_dm_search_cancel_notify(UNUSED_ATTR tBTA_DM_MSG* p_data) {
  *
  ******************************************************************************/
 static void bta_dm_find_services(const RawAddress& bd_addr) {
+  /* the L2CAP search may already have been started with the PnP search */
+  if (bta_dm_search_cb.sdp_next_state != BTA_DM_SDP_NEXT_NONE &&
+      bta_dm_search_cb.services == BTA_ALL_SERVICE_MASK &&
+      bta_dm_search_cb.services_to_search != 0 &&
+      !(bta_dm_search_cb.services_to_search & BTA_RES_SERVICE_MASK) &&
+      bta_dm_sdp_next_take())
+    return;
 
   while (bta_dm_search_cb.service_index < BTA_MAX_SERVICE_ID) {
     Uuid uuid = Uuid::kEmpty;
@@ -2381,10 +2601,19 @@ static void bta_dm_find_services(const RawAddress& bd_addr) {
       SDP_InitDiscoveryDb(bta_dm_search_cb.p_sdp_db, BTA_DM_SDP_DB_SIZE, 1,
                           &uuid, 0, NULL);
 
-      memset(g_disc_raw_data_buf, 0, sizeof(g_disc_raw_data_buf));
-      bta_dm_search_cb.p_sdp_db->raw_data = g_disc_raw_data_buf;
-
-      bta_dm_search_cb.p_sdp_db->raw_size = MAX_DISC_RAW_DATA_BUF;
+      /* the raw data of the PnP search is never reported, leave the buffer
+       * to the L2CAP search if it runs along */
+      bool start_next = BTA_DM_SDP_PIPELINE == TRUE &&
+                        bta_dm_search_cb.services == BTA_ALL_SERVICE_MASK &&
+                        bta_dm_search_cb.services_to_search != 0 &&
+                        uuid == Uuid::From16Bit(
+                                    bta_service_id_to_uuid_lkup_tbl[0]);
+      if (!start_next) {
+        memset(g_disc_raw_data_buf, 0, sizeof(g_disc_raw_data_buf));
+        bta_dm_search_cb.p_sdp_db->raw_data = g_disc_raw_data_buf;
+
+        bta_dm_search_cb.p_sdp_db->raw_size = MAX_DISC_RAW_DATA_BUF;
+      }
 
       if (!SDP_ServiceSearchAttributeRequest(bd_addr, bta_dm_search_cb.p_sdp_db,
                                              &bta_dm_sdp_callback)) {
@@ -2396,6 +2625,7 @@ static void bta_dm_find_services(const RawAddress& bd_addr) {
         bta_dm_search_cb.service_index = BTA_MAX_SERVICE_ID;
 
       } else {
+        if (start_next) bta_dm_sdp_next_start(bd_addr);
         if (uuid == Uuid::From16Bit(UUID_PROTOCOL_L2CAP)) {
           if (sdpu_is_pbap_0102_enabled()) {
             LOG_DEBUG(LOG_TAG, "%s SDP search for PBAP Client ", __func__);
@@ -2531,6 +2761,14 @@ static void bta_dm_discover_device(const RawAddress& remote_bd_addr) {
     bta_dm_search_cb.services_found = 0;
     bta_dm_search_cb.services_to_search = bta_dm_search_cb.services;
     bta_dm_search_cb.uuid_to_search = bta_dm_search_cb.num_uuid;
+
+    /* a bonded device discovered before is answered without SDP */
+    if (transport == BT_TRANSPORT_BR_EDR &&
+        bta_dm_search_cb.services == BTA_ALL_SERVICE_MASK &&
+        !bta_dm_search_cb.sdp_search &&
+        bta_dm_sdp_cache_read(bta_dm_search_cb.peer_bdaddr))
+      return;
+
     if ((bta_dm_search_cb.p_btm_inq_info != NULL) &&
         bta_dm_search_cb.services != BTA_USER_SERVICE_MASK &&
         (bta_dm_search_cb.sdp_search == false)) {
@@ -2616,6 +2854,142 @@ static void bta_dm_sdp_callback(uint16_t sdp_status) {
   bta_sys_sendmsg(p_msg);
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_dm_sdp_next_callback
+ *
+ * Description      Callback from sdp with the result of the L2CAP search run
+ *                  along with the PnP search
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_dm_sdp_next_callback(uint16_t sdp_status, void* user_data) {
+  tSDP_DISCOVERY_DB* p_db = (tSDP_DISCOVERY_DB*)user_data;
+
+  /* the discovery it was started for is over */
+  if (p_db != bta_dm_search_cb.p_sdp_db_next) {
+    osi_free(p_db);
+    return;
+  }
+
+  APPL_TRACE_DEBUG("%s sdp_status:0x%x state:%d", __func__, sdp_status,
+                   bta_dm_search_cb.sdp_next_state);
+  bta_dm_search_cb.sdp_next_result = sdp_status;
+  if (bta_dm_search_cb.sdp_next_state == BTA_DM_SDP_NEXT_PENDING) {
+    bta_dm_search_cb.sdp_next_state = BTA_DM_SDP_NEXT_DONE;
+    return;
+  }
+
+  /* the PnP search is done, continue the discovery */
+  bta_dm_search_cb.sdp_next_state = BTA_DM_SDP_NEXT_DONE;
+  if (!bta_dm_sdp_next_take()) {
+    if (bta_dm_search_cb.state == BTA_DM_DISCOVER_ACTIVE) {
+      bta_dm_find_services(bta_dm_search_cb.peer_bdaddr);
+    } else {
+      /* let the cancelled discovery complete */
+      bta_dm_sdp_callback(sdp_status);
+    }
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_dm_sdp_next_start
+ *
+ * Description      Starts the L2CAP search of a full service discovery while
+ *                  the PnP search is in progress. SDP opens a second channel on
+ *                  the same ACL link for it.
+ *
+ * Returns          true if started, else false
+ *
+ ******************************************************************************/
+static bool bta_dm_sdp_next_start(const RawAddress& bd_addr) {
+  Uuid uuid = Uuid::From16Bit(UUID_PROTOCOL_L2CAP);
+  tSDP_DISCOVERY_DB* p_db = (tSDP_DISCOVERY_DB*)osi_malloc(BTA_DM_SDP_DB_SIZE);
+
+  bta_dm_sdp_next_abandon();
+
+  SDP_InitDiscoveryDb(p_db, BTA_DM_SDP_DB_SIZE, 1, &uuid, 0, NULL);
+  memset(g_disc_raw_data_buf, 0, sizeof(g_disc_raw_data_buf));
+  p_db->raw_data = g_disc_raw_data_buf;
+  p_db->raw_size = MAX_DISC_RAW_DATA_BUF;
+
+  bta_dm_search_cb.p_sdp_db_next = p_db;
+  bta_dm_search_cb.sdp_next_state = BTA_DM_SDP_NEXT_PENDING;
+  if (!SDP_ServiceSearchAttributeRequest2(bd_addr, p_db,
+                                          &bta_dm_sdp_next_callback, p_db)) {
+    bta_dm_search_cb.p_sdp_db_next = NULL;
+    bta_dm_search_cb.sdp_next_state = BTA_DM_SDP_NEXT_NONE;
+    osi_free(p_db);
+    return false;
+  }
+
+  if (sdpu_is_pbap_0102_enabled()) {
+    LOG_DEBUG(LOG_TAG, "%s SDP search for PBAP Client ", __func__);
+    BTA_SdpSearch(bd_addr, Uuid::From16Bit(UUID_SERVCLASS_PBAP_PCE));
+  }
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_dm_sdp_next_take
+ *
+ * Description      Continues a full service discovery, after the PnP search,
+ *                  with the L2CAP search run along with it. Waits for the
+ *                  search if it is in progress.
+ *
+ * Returns          true if the discovery goes on with it, false if the L2CAP
+ *                  search has to be started
+ *
+ ******************************************************************************/
+static bool bta_dm_sdp_next_take(void) {
+  if (bta_dm_search_cb.sdp_next_state == BTA_DM_SDP_NEXT_PENDING ||
+      bta_dm_search_cb.sdp_next_state == BTA_DM_SDP_NEXT_WAITING) {
+    bta_dm_search_cb.sdp_next_state = BTA_DM_SDP_NEXT_WAITING;
+    return true;
+  }
+
+  uint16_t result = bta_dm_search_cb.sdp_next_result;
+  if (bta_dm_search_cb.sdp_next_state != BTA_DM_SDP_NEXT_DONE ||
+      (result != SDP_SUCCESS && result != SDP_NO_RECS_MATCH &&
+       result != SDP_DB_FULL)) {
+    /* a second channel may have been refused, search again on its own */
+    bta_dm_sdp_next_abandon();
+    return false;
+  }
+
+  osi_free(bta_dm_search_cb.p_sdp_db);
+  bta_dm_search_cb.p_sdp_db = bta_dm_search_cb.p_sdp_db_next;
+  bta_dm_search_cb.p_sdp_db_next = NULL;
+  bta_dm_search_cb.sdp_next_state = BTA_DM_SDP_NEXT_NONE;
+
+  /* as if the L2CAP search was started now, see bta_dm_find_services */
+  bta_dm_search_cb.services_to_search = 0;
+  bta_dm_search_cb.service_index++;
+  bta_dm_sdp_callback(result);
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_dm_sdp_next_abandon
+ *
+ * Description      Drops the L2CAP search run along with the PnP search. If it
+ *                  is in progress, its database is freed by its callback.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_dm_sdp_next_abandon(void) {
+  if (bta_dm_search_cb.sdp_next_state == BTA_DM_SDP_NEXT_DONE)
+    osi_free(bta_dm_search_cb.p_sdp_db_next);
+
+  bta_dm_search_cb.p_sdp_db_next = NULL;
+  bta_dm_search_cb.sdp_next_state = BTA_DM_SDP_NEXT_NONE;
+}
+
 /*******************************************************************************
  *
  * Function         bta_dm_inq_results_cb
@@ -2654,9 +3028,20 @@ static void bta_dm_inq_results_cb(tBTM_INQ_RESULTS* p_inq, uint8_t* p_eir,
     result.inq_res.remt_name_not_required = false;
   }
 
+  if (bta_dm_inq_res_is_repeat(&result.inq_res)) {
+    /* What the application learnt from the first report still holds */
+    if (p_inq_info && bta_dm_inq_seen[p_inq->remote_bd_addr].name_known)
+      p_inq_info->appl_knows_rem_name = true;
+    return;
+  }
+
   if (bta_dm_search_cb.p_search_cback)
     bta_dm_search_cb.p_search_cback(BTA_DM_INQ_RES_EVT, &result);
 
+  auto seen = bta_dm_inq_seen.find(p_inq->remote_bd_addr);
+  if (seen != bta_dm_inq_seen.end())
+    seen->second.name_known = result.inq_res.remt_name_not_required;
+
   if (p_inq_info) {
     /* application indicates if it knows the remote name, inside the callback
      copy that to the inquiry data base*/
@@ -2665,6 +3050,57 @@ static void bta_dm_inq_results_cb(tBTM_INQ_RESULTS* p_inq, uint8_t* p_eir,
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_dm_inq_res_is_repeat
+ *
+ * Description      Checks whether an inquiry result only repeats what the
+ *                  device reported last in this search: same class, result
+ *                  and device type, flags and EIR, and an RSSI within
+ *                  BTA_DM_INQ_DEDUP_RSSI_DELTA. Otherwise the result is
+ *                  remembered as the last one reported, as long as fewer than
+ *                  BTA_DM_INQ_DEDUP_MAX_DEVICES devices are remembered.
+ *
+ * Returns          true if the result can be dropped
+ *
+ ******************************************************************************/
+static bool bta_dm_inq_res_is_repeat(const tBTA_DM_INQ_RES* p_res) {
+  tBTA_DM_INQ_SEEN seen;
+
+  memset(&seen, 0, sizeof(seen));
+  memcpy(seen.dev_class, p_res->dev_class, DEV_CLASS_LEN);
+  seen.rssi = p_res->rssi;
+  seen.inq_result_type = p_res->inq_result_type;
+  seen.device_type = p_res->device_type;
+  seen.flag = p_res->flag;
+  seen.eir_len = p_res->p_eir ? p_res->eir_len : 0;
+  /* FNV-1a, only the EIR of the last report is needed to detect a change */
+  seen.eir_hash = 2166136261u;
+  for (uint16_t i = 0; i < seen.eir_len; i++)
+    seen.eir_hash = (seen.eir_hash ^ p_res->p_eir[i]) * 16777619u;
+
+  auto it = bta_dm_inq_seen.find(p_res->bd_addr);
+  if (it == bta_dm_inq_seen.end()) {
+    if (bta_dm_inq_seen.size() < BTA_DM_INQ_DEDUP_MAX_DEVICES)
+      bta_dm_inq_seen[p_res->bd_addr] = seen;
+    return false;
+  }
+
+  tBTA_DM_INQ_SEEN* p_last = &it->second;
+  if (memcmp(p_last->dev_class, seen.dev_class, DEV_CLASS_LEN) == 0 &&
+      p_last->inq_result_type == seen.inq_result_type &&
+      p_last->device_type == seen.device_type && p_last->flag == seen.flag &&
+      p_last->eir_len == seen.eir_len && p_last->eir_hash == seen.eir_hash &&
+      abs(p_last->rssi - seen.rssi) < BTA_DM_INQ_DEDUP_RSSI_DELTA) {
+    bta_dm_inq_res_dropped++;
+    return true;
+  }
+
+  seen.name_known = p_last->name_known;
+  *p_last = seen;
+  return false;
+}
+
 /*******************************************************************************
  *
  * Function         bta_dm_inq_cmpl_cb
@@ -2981,6 +3417,9 @@ static uint8_t bta_dm_new_link_key_cback(const RawAddress& bd_addr,
 
   /* Not AMP Key type */
   if (key_type != HCI_LKEY_TYPE_AMP_WIFI && key_type != HCI_LKEY_TYPE_AMP_UWB) {
+    /* The services of a newly paired device are discovered again */
+    bta_dm_sdp_cache_remove(bd_addr);
+
     event = BTA_DM_AUTH_CMPL_EVT;
     p_auth_cmpl = &sec_event.auth_cmpl;
 
@@ -3626,6 +4065,9 @@ void bta_dm_acl_change(tBTA_DM_MSG* p_data) {
     bta_dm_cb.device_list.peer_device[i].pref_role = BTA_ANY_ROLE;
     conn.link_up.bd_addr = p_bda;
     bta_dm_cb.device_list.peer_device[i].info = BTA_DM_DI_NONE;
+    if (p_data->acl_change.transport == BT_TRANSPORT_BR_EDR &&
+        BTM_IsPeerSniffRefused(p_bda))
+      bta_dm_cb.device_list.peer_device[i].pm_mode_failed |= BTA_DM_PM_SNIFF;
     conn.link_up.link_type = p_data->acl_change.transport;
     bta_dm_cb.device_list.peer_device[i].transport =
         p_data->acl_change.transport;
@@ -3972,6 +4414,11 @@ static void bta_dm_adjust_roles(bool delay_role_switch) {
       if (bta_dm_cb.device_list.peer_device[i].conn_state == BTA_DM_CONNECTED &&
           bta_dm_cb.device_list.peer_device[i].transport ==
               BT_TRANSPORT_BR_EDR) {
+        /* no switch, nor delay timer, for a peer known to refuse it */
+        if (BTM_IsPeerRoleSwitchRefused(
+                bta_dm_cb.device_list.peer_device[i].peer_bdaddr))
+          continue;
+
         if (!set_master_role &&
             (bta_dm_cb.device_list.peer_device[i].pref_role != BTA_ANY_ROLE) &&
             (p_bta_dm_rm_cfg[0].cfg == BTA_DM_PARTIAL_SCATTERNET)) {
@@ -4003,7 +4450,11 @@ static void bta_dm_adjust_roles(bool delay_role_switch) {
           }
         } else if ((br_count == 1) &&
                    (bta_dm_cb.device_list.peer_device[i].pref_role ==
-                    BTA_MASTER_ROLE_PREF)) {
+                    BTA_MASTER_ROLE_PREF) &&
+                   (BTM_GetPeerPreferredRole(
+                        bta_dm_cb.device_list.peer_device[i].peer_bdaddr) !=
+                    HCI_ROLE_SLAVE)) {
+          /* only a preference: leave the role to a peer that picked it */
           BTM_SwitchRole(bta_dm_cb.device_list.peer_device[i].peer_bdaddr,
                          HCI_ROLE_MASTER, NULL);
         }
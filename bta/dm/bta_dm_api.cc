@@ -1322,6 +1322,8 @@ void BTA_VendorCleanup(void) {
 #endif
   }
 
+  btm_ble_host_filter_cleanup();
+
   if (cmn_ble_vsc_cb.tot_scan_results_strg > 0) btm_ble_batchscan_cleanup();
 
   if (cmn_ble_vsc_cb.adv_inst_max > 0) btm_ble_multi_adv_cleanup();
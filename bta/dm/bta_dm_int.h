@@ -599,6 +599,47 @@ typedef uint8_t tBTA_DM_CONN_STATE;
 #define BTA_DM_DI_ACP_SNIFF 0x04 /* set this bit if peer init sniff */
 typedef uint8_t tBTA_DM_DEV_INFO;
 
+/* A sniff mode ended by traffic sooner than this is an early wake, which
+ * raises the burst level of the link */
+#ifndef BTA_DM_PM_EARLY_WAKE_MS
+#define BTA_DM_PM_EARLY_WAKE_MS 10000
+#endif
+
+/* A sniff mode lasting longer than this lowers the burst level of the link */
+#ifndef BTA_DM_PM_LONG_IDLE_MS
+#define BTA_DM_PM_LONG_IDLE_MS 60000
+#endif
+
+/* Highest burst level; each level doubles the sniff timeout of the link */
+#ifndef BTA_DM_PM_BURST_LEVEL_MAX
+#define BTA_DM_PM_BURST_LEVEL_MAX 3
+#endif
+
+/* ACL packet rate at which a link entering sniff uses a shorter interval */
+#ifndef BTA_DM_PM_BUSY_PKTS_PER_MIN
+#define BTA_DM_PM_BUSY_PKTS_PER_MIN 600
+#endif
+
+/* Minimum SSR local and remote timeouts (slots) at the first burst level */
+#ifndef BTA_DM_PM_SSR_BURST_TO
+#define BTA_DM_PM_SSR_BURST_TO 800
+#endif
+
+/* Traffic of a link as seen by the adaptive power mode policy */
+typedef struct {
+  uint32_t tx_pkts;        /* L2CAP ACL packet counts at the last sample */
+  uint32_t rx_pkts;
+  period_ms_t sample_ms;   /* When the counts were sampled, 0 if never */
+  uint32_t pkts_per_min;   /* ACL packet rate between the last two samples */
+  period_ms_t sniff_ms;    /* When the link entered sniff, 0 if not in sniff */
+  period_ms_t avg_idle_ms; /* Average time in sniff before traffic ended it */
+  uint8_t burst_level;     /* 0 to BTA_DM_PM_BURST_LEVEL_MAX */
+  uint16_t sniff_entries;
+  uint16_t early_wakes;
+  uint16_t timeouts_extended; /* Sniff timers lengthened by the burst level */
+  uint16_t short_intervals;   /* Sniff modes using a shorter max interval */
+} tBTA_DM_PM_TRAFFIC;
+
 /* set power mode request type */
 #define BTA_DM_PM_RESTART 1
 #define BTA_DM_PM_NEW_REQ 2
@@ -621,6 +662,7 @@ typedef struct {
   bool remove_dev_pending;
   uint16_t conn_handle;
   tBT_TRANSPORT transport;
+  tBTA_DM_PM_TRAFFIC traffic;
 } tBTA_DM_PEER_DEVICE;
 
 /* structure to store list of
@@ -736,6 +778,9 @@ typedef struct {
   tBTA_SERVICE_MASK services_to_search;
   tBTA_SERVICE_MASK services_found;
   tSDP_DISCOVERY_DB* p_sdp_db;
+  tSDP_DISCOVERY_DB* p_sdp_db_next; /* L2CAP search run with the PnP one */
+  uint16_t sdp_next_result;         /* Result of the L2CAP search */
+  uint8_t sdp_next_state;           /* State of the L2CAP search */
   uint16_t state;
   RawAddress peer_bdaddr;
   bool name_discover_done;
@@ -24,8 +24,10 @@
  ******************************************************************************/
 
 #include <base/logging.h>
+#include <inttypes.h>
 #include <string.h>
 
+#include <algorithm>
 #include <mutex>
 
 #include "bt_common.h"
@@ -35,8 +37,10 @@
 #include "bta_ag_int.h"
 #include "bta_sys.h"
 #include "btm_api.h"
+#include "l2c_api.h"
 
 #include "device/include/interop.h"
+#include "osi/include/time.h"
 
 extern fixed_queue_t* btu_bta_alarm_queue;
 
@@ -58,6 +62,8 @@ static void bta_dm_pm_set_sniff_policy(tBTA_DM_PEER_DEVICE* p_dev,
                                        bool bDisable);
 static void bta_dm_pm_stop_timer_by_index(tBTA_PM_TIMER* p_timer,
                                           uint8_t timer_idx);
+static void bta_dm_pm_traffic_sample(tBTA_DM_PEER_DEVICE* p_dev);
+static void bta_dm_pm_traffic_wake(tBTA_DM_PEER_DEVICE* p_dev);
 
 #if (BTM_SSR_INCLUDED == TRUE)
 #if (BTA_HH_INCLUDED == TRUE)
@@ -656,6 +662,13 @@ static void bta_dm_pm_set_mode(const RawAddress& peer_addr,
       }
     }
   }
+  /* links that keep waking from sniff wait longer before the next one */
+  if ((pm_req != BTA_DM_PM_EXECUTE) && (timeout_ms > 0) &&
+      (pm_action & BTA_DM_PM_SNIFF) && p_peer_device->traffic.burst_level) {
+    timeout_ms <<= p_peer_device->traffic.burst_level;
+    p_peer_device->traffic.timeouts_extended++;
+  }
+
   /* if need to start a timer */
   if ((pm_req != BTA_DM_PM_EXECUTE) && (timeout_ms > 0)) {
     for (i = 0; i < BTA_DM_NUM_PM_TIMER; i++) {
@@ -794,6 +807,15 @@ static bool bta_dm_pm_sniff(tBTA_DM_PEER_DEVICE* p_peer_dev, uint8_t index) {
     /* if the current mode is not sniff, issue the sniff command.
      * If sniff, but SSR is not used in this link, still issue the command */
     memcpy(&pwr_md, &p_bta_dm_pm_md[index], sizeof(tBTM_PM_PWR_MD));
+
+    /* a busy link gets a shorter interval, for less first packet latency */
+    bta_dm_pm_traffic_sample(p_peer_dev);
+    if (p_peer_dev->traffic.pkts_per_min >= BTA_DM_PM_BUSY_PKTS_PER_MIN &&
+        pwr_md.max > pwr_md.min) {
+      pwr_md.max = std::max<uint16_t>(pwr_md.min, pwr_md.max / 2);
+      p_peer_dev->traffic.short_intervals++;
+    }
+
     if (p_peer_dev->info & BTA_DM_DI_INT_SNIFF) {
       pwr_md.mode |= BTM_PM_MD_FORCE;
     }
@@ -902,9 +924,19 @@ static void bta_dm_pm_ssr(const RawAddress& peer_addr) {
       }
     }
 
+    /* bursty links stay in plain sniff a while before subrating */
+    uint16_t min_rmt_to = p_spec->min_rmt_to;
+    uint16_t min_loc_to = p_spec->min_loc_to;
+    tBTA_DM_PEER_DEVICE* p_dev = bta_dm_find_peer_device(peer_addr);
+    if (p_dev != NULL && p_dev->traffic.burst_level) {
+      uint16_t burst_to = BTA_DM_PM_SSR_BURST_TO
+                          << (p_dev->traffic.burst_level - 1);
+      min_rmt_to = std::max(min_rmt_to, burst_to);
+      min_loc_to = std::max(min_loc_to, burst_to);
+    }
+
     /* set the SSR parameters. */
-    BTM_SetSsrParams(peer_addr, p_spec->max_lat, p_spec->min_rmt_to,
-                     p_spec->min_loc_to);
+    BTM_SetSsrParams(peer_addr, p_spec->max_lat, min_rmt_to, min_loc_to);
   }
 }
 #endif
@@ -1028,6 +1060,11 @@ void bta_dm_pm_btm_status(tBTA_DM_MSG* p_data) {
         p_dev->info &=
             ~(BTA_DM_DI_INT_SNIFF | BTA_DM_DI_ACP_SNIFF | BTA_DM_DI_SET_SNIFF);
 
+        if ((p_dev->pm_mode_attempted & BTA_DM_PM_SNIFF) &&
+            (p_data->pm_status.hci_status == HCI_ERR_UNSUPPORTED_REM_FEATURE ||
+             p_data->pm_status.hci_status == HCI_ERR_UNSUPPORTED_LMP_FEATURE))
+          BTM_SetPeerSniffRefused(p_data->pm_status.bd_addr);
+
         if (p_dev->pm_mode_attempted & (BTA_DM_PM_PARK | BTA_DM_PM_SNIFF)) {
           p_dev->pm_mode_failed |=
               ((BTA_DM_PM_PARK | BTA_DM_PM_SNIFF) & p_dev->pm_mode_attempted);
@@ -1037,6 +1074,7 @@ void bta_dm_pm_btm_status(tBTA_DM_MSG* p_data) {
                              BTA_DM_PM_RESTART);
         }
       } else {
+        bta_dm_pm_traffic_wake(p_dev);
 #if (BTM_SSR_INCLUDED == TRUE)
         if (p_dev->prev_low) {
           /* need to send the SSR paramaters to controller again */
@@ -1078,6 +1116,11 @@ void bta_dm_pm_btm_status(tBTA_DM_MSG* p_data) {
          * in sniff mode from host side.
          */
         bta_dm_pm_stop_timer(p_data->pm_status.bd_addr);
+        if (p_dev->traffic.sniff_ms == 0) {
+          p_dev->traffic.sniff_ms = time_get_os_boottime_ms();
+          p_dev->traffic.sniff_entries++;
+          bta_dm_pm_traffic_sample(p_dev);
+        }
       } else {
         p_dev->info &=
             ~(BTA_DM_DI_SET_SNIFF | BTA_DM_DI_INT_SNIFF | BTA_DM_DI_ACP_SNIFF);
@@ -1113,6 +1156,103 @@ void bta_dm_pm_timer(tBTA_DM_MSG* p_data) {
                      BTA_DM_PM_EXECUTE);
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_dm_pm_traffic_sample
+ *
+ * Description      Samples the L2CAP ACL packet counts of a BR/EDR link and
+ *                  updates its packet rate since the previous sample.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_dm_pm_traffic_sample(tBTA_DM_PEER_DEVICE* p_dev) {
+  tBTA_DM_PM_TRAFFIC* p_traffic = &p_dev->traffic;
+  uint32_t tx_pkts, rx_pkts;
+
+  if (!L2CA_GetLinkPacketCounts(p_dev->peer_bdaddr, &tx_pkts, &rx_pkts))
+    return;
+
+  period_ms_t now_ms = time_get_os_boottime_ms();
+  if (p_traffic->sample_ms != 0 && now_ms > p_traffic->sample_ms) {
+    uint64_t pkts = (uint64_t)(uint32_t)(tx_pkts - p_traffic->tx_pkts) +
+                    (uint32_t)(rx_pkts - p_traffic->rx_pkts);
+    p_traffic->pkts_per_min = pkts * 60000 / (now_ms - p_traffic->sample_ms);
+  }
+  p_traffic->tx_pkts = tx_pkts;
+  p_traffic->rx_pkts = rx_pkts;
+  p_traffic->sample_ms = now_ms;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_dm_pm_traffic_wake
+ *
+ * Description      Called when a link goes back to active mode. A link woken
+ *                  soon after it entered sniff raises its burst level, one
+ *                  that stayed idle for long lowers it.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_dm_pm_traffic_wake(tBTA_DM_PEER_DEVICE* p_dev) {
+  tBTA_DM_PM_TRAFFIC* p_traffic = &p_dev->traffic;
+
+  if (p_traffic->sniff_ms == 0) return;
+
+  period_ms_t idle_ms = time_get_os_boottime_ms() - p_traffic->sniff_ms;
+  p_traffic->sniff_ms = 0;
+  p_traffic->avg_idle_ms = (p_traffic->avg_idle_ms == 0)
+                               ? idle_ms
+                               : (p_traffic->avg_idle_ms * 3 + idle_ms) / 4;
+
+  if (idle_ms < BTA_DM_PM_EARLY_WAKE_MS) {
+    p_traffic->early_wakes++;
+    if (p_traffic->burst_level < BTA_DM_PM_BURST_LEVEL_MAX)
+      p_traffic->burst_level++;
+  } else if (idle_ms > BTA_DM_PM_LONG_IDLE_MS && p_traffic->burst_level) {
+    p_traffic->burst_level--;
+  }
+  APPL_TRACE_DEBUG("%s: %s idle %" PRIu64 " ms, burst level %d", __func__,
+                   p_dev->peer_bdaddr.ToString().c_str(), idle_ms,
+                   p_traffic->burst_level);
+}
+
+/*******************************************************************************
+ *
+ * Function         BTA_DmPmDumpStatistics
+ *
+ * Description      Dumps the traffic and the power mode decisions of the
+ *                  connected BR/EDR links
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTA_DmPmDumpStatistics(int fd) {
+  dprintf(fd, "\nDM power mode policy:\n");
+  for (int i = 0; i < bta_dm_cb.device_list.count; i++) {
+    const tBTA_DM_PEER_DEVICE* p_dev = &bta_dm_cb.device_list.peer_device[i];
+    const tBTA_DM_PM_TRAFFIC* p_traffic = &p_dev->traffic;
+    if (p_dev->conn_state != BTA_DM_CONNECTED ||
+        p_dev->transport != BT_TRANSPORT_BR_EDR)
+      continue;
+
+    dprintf(fd, "  %s, %s, burst level: %d\n",
+            p_dev->peer_bdaddr.ToString().c_str(),
+            p_traffic->sniff_ms ? "sniff" : "active", p_traffic->burst_level);
+    dprintf(fd,
+            "    ACL packets (tx/rx): %u / %u, rate: %u packets/min, "
+            "avg idle: %" PRIu64 " ms\n",
+            p_traffic->tx_pkts, p_traffic->rx_pkts, p_traffic->pkts_per_min,
+            p_traffic->avg_idle_ms);
+    dprintf(fd,
+            "    sniff entries: %u, early wakes: %u, timeouts extended: %u, "
+            "short intervals: %u\n",
+            p_traffic->sniff_entries, p_traffic->early_wakes,
+            p_traffic->timeouts_extended, p_traffic->short_intervals);
+  }
+}
+
 /*******************************************************************************
  *
  * Function         bta_dm_find_peer_device
@@ -26,6 +26,7 @@
 #define LOG_TAG "bt_bta_gattc"
 
 #include <string.h>
+#include <algorithm>
 
 #include <base/callback.h>
 #include "bt_common.h"
@@ -117,6 +118,7 @@ static const char* bta_gattc_op_code_name[] = {
  ****************************************************************************/
 
 void bta_gattc_reset_discover_st(tBTA_GATTC_SERV* p_srcb, tGATT_STATUS status);
+void bta_gattc_set_discover_st(tBTA_GATTC_SERV* p_srcb);
 
 /** Enables GATTC module */
 static void bta_gattc_enable() {
@@ -504,7 +506,11 @@ void bta_gattc_conn(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data) {
       p_clcb->p_srcb->state != BTA_GATTC_SERV_IDLE) {
     if (p_clcb->p_srcb->state == BTA_GATTC_SERV_IDLE) {
       p_clcb->p_srcb->state = BTA_GATTC_SERV_LOAD;
-      if (bta_gattc_cache_load(p_clcb)) {
+      if (bta_gattc_read_database_hash(p_clcb)) {
+        /* the Database Hash selects the cache, wait for it like for a
+         * discovery */
+        bta_gattc_set_discover_st(p_clcb->p_srcb);
+      } else if (bta_gattc_cache_load(p_clcb)) {
         p_clcb->p_srcb->state = BTA_GATTC_SERV_IDLE;
         bta_gattc_reset_discover_st(p_clcb->p_srcb, GATT_SUCCESS);
       } else {
@@ -676,10 +682,16 @@ void bta_gattc_start_discover(tBTA_GATTC_CLCB* p_clcb,
     p_clcb->auto_update = BTA_GATTC_NO_SCHEDULE;
 
     if (p_clcb->p_srcb != NULL) {
+      /* the Database Hash is only known to match a discovery started right
+       * after reading it */
+      if (p_clcb->p_srcb->state != BTA_GATTC_SERV_DISC)
+        p_clcb->p_srcb->has_database_hash = false;
+
       /* clear the service change mask */
       p_clcb->p_srcb->srvc_hdl_chg = false;
       p_clcb->p_srcb->update_count = 0;
       p_clcb->p_srcb->state = BTA_GATTC_SERV_DISC_ACT;
+      bta_gattc_cb.cache_stats.discoveries++;
 
       if (p_clcb->transport == BTA_TRANSPORT_LE) {
         if (!interop_match_addr_or_name(INTEROP_DISABLE_LE_CONN_UPDATES, &p_clcb->p_srcb->server_bda)) {
@@ -690,9 +702,25 @@ void bta_gattc_start_discover(tBTA_GATTC_CLCB* p_clcb,
       /* set all srcb related clcb into discovery ST */
       bta_gattc_set_discover_st(p_clcb->p_srcb);
 
-      bta_gattc_init_cache(p_clcb->p_srcb);
-      p_clcb->status = bta_gattc_discover_pri_service(
-          p_clcb->bta_conn_id, p_clcb->p_srcb, GATT_DISC_SRVC_ALL);
+      /* after a service changed indication, only the services of its range
+       * are discovered again over LE, the rest of the database is kept */
+      uint16_t chg_s_handle = p_clcb->p_srcb->chg_s_handle;
+      uint16_t chg_e_handle = p_clcb->p_srcb->chg_e_handle;
+      p_clcb->p_srcb->chg_s_handle = 0;
+      p_clcb->p_srcb->chg_e_handle = 0;
+
+      if (chg_s_handle != 0 && p_clcb->transport == BTA_TRANSPORT_LE &&
+          !p_clcb->p_srcb->gatt_database.IsEmpty() &&
+          (chg_s_handle != gatt::HANDLE_MIN ||
+           chg_e_handle != gatt::HANDLE_MAX)) {
+        bta_gattc_cb.cache_stats.range_discoveries++;
+        p_clcb->status = bta_gattc_discover_range(
+            p_clcb->bta_conn_id, p_clcb->p_srcb, chg_s_handle, chg_e_handle);
+      } else {
+        bta_gattc_init_cache(p_clcb->p_srcb);
+        p_clcb->status = bta_gattc_discover_pri_service(
+            p_clcb->bta_conn_id, p_clcb->p_srcb, GATT_DISC_SRVC_ALL);
+      }
       if (p_clcb->status != GATT_SUCCESS) {
         LOG(ERROR) << "discovery on server failed";
         bta_gattc_reset_discover_st(p_clcb->p_srcb, p_clcb->status);
@@ -715,6 +743,7 @@ void bta_gattc_start_discover(tBTA_GATTC_CLCB* p_clcb,
 void bta_gattc_disc_cmpl(tBTA_GATTC_CLCB* p_clcb,
                          UNUSED_ATTR tBTA_GATTC_DATA* p_data) {
   tBTA_GATTC_DATA* p_q_cmd = p_clcb->p_q_cmd;
+  bool mtu_pending = p_clcb->disc_mtu_pending;
 
   VLOG(1) << __func__ << ": conn_id=" << loghex(p_clcb->bta_conn_id);
 
@@ -730,6 +759,7 @@ void bta_gattc_disc_cmpl(tBTA_GATTC_CLCB* p_clcb,
     p_clcb->p_srcb->state = BTA_GATTC_SERV_IDLE;
   }
   p_clcb->disc_active = false;
+  p_clcb->disc_mtu_pending = false;
 
   if (p_clcb->status != GATT_SUCCESS) {
     /* clean up cache */
@@ -749,8 +779,9 @@ void bta_gattc_disc_cmpl(tBTA_GATTC_CLCB* p_clcb,
     p_clcb->auto_update = BTA_GATTC_REQ_WAITING;
     bta_gattc_sm_execute(p_clcb, BTA_GATTC_INT_DISCOVER_EVT, NULL);
   }
-  /* get any queued command to proceed */
-  else if (p_q_cmd != NULL) {
+  /* get any queued command to proceed, an MTU configuration sent during the
+   * discovery completes as any other command */
+  else if (p_q_cmd != NULL && !mtu_pending) {
     p_clcb->p_q_cmd = NULL;
     /* execute pending operation of link block still present */
     if (p_clcb->p_srcb &&
@@ -954,6 +985,43 @@ void bta_gattc_cfg_mtu_cmpl(tBTA_GATTC_CLCB* p_clcb,
   (*p_clcb->p_rcb->p_cback)(BTA_GATTC_CFG_MTU_EVT, &cb_data);
 }
 
+/** Send the MTU configuration queued during the discovery, between two of its
+ * procedures of type |disc_type|, so that the rest of the discovery benefits
+ * from the larger MTU. Returns true if the discovery is to be resumed once
+ * the MTU configuration completes.
+ */
+bool bta_gattc_disc_cfg_mtu(tBTA_GATTC_CLCB* p_clcb,
+                            tGATT_DISC_TYPE disc_type) {
+  tBTA_GATTC_DATA* p_q_cmd = p_clcb->p_q_cmd;
+  if (p_clcb->transport != BTA_TRANSPORT_LE || p_q_cmd == NULL ||
+      p_q_cmd->hdr.event != BTA_GATTC_API_CFG_MTU_EVT)
+    return false;
+
+  /* if failed, the command stays queued until the discovery is done */
+  tGATT_STATUS status =
+      GATTC_ConfigureMTU(p_clcb->bta_conn_id, p_q_cmd->api_mtu.mtu);
+  if (status != GATT_SUCCESS && status != GATT_CMD_STARTED) return false;
+
+  VLOG(1) << __func__ << ": discovery paused, conn_id="
+          << loghex(p_clcb->bta_conn_id);
+  p_clcb->disc_mtu_pending = true;
+  p_clcb->disc_resume_type = disc_type;
+  return true;
+}
+
+/** MTU configuration sent during the discovery completed */
+static void bta_gattc_disc_cfg_mtu_cmpl(tBTA_GATTC_CLCB* p_clcb,
+                                        tBTA_GATTC_OP_CMPL* p_data) {
+  /* the discovery status is not the one of the MTU configuration */
+  tGATT_STATUS disc_status = p_clcb->status;
+  p_clcb->disc_mtu_pending = false;
+  bta_gattc_cfg_mtu_cmpl(p_clcb, p_data);
+  p_clcb->status = disc_status;
+
+  bta_gattc_disc_cmpl_cback(p_clcb->bta_conn_id, p_clcb->disc_resume_type,
+                            GATT_SUCCESS);
+}
+
 /** operation completed */
 void bta_gattc_op_cmpl(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data) {
   uint8_t op = (uint8_t)p_data->op_cmpl.op_code;
@@ -1016,8 +1084,21 @@ void bta_gattc_op_cmpl(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data) {
 }
 
 /** operation completed */
-void bta_gattc_ignore_op_cmpl(UNUSED_ATTR tBTA_GATTC_CLCB* p_clcb,
+void bta_gattc_ignore_op_cmpl(tBTA_GATTC_CLCB* p_clcb,
                               tBTA_GATTC_DATA* p_data) {
+  if (p_clcb->p_srcb &&
+      p_clcb->p_srcb->state == BTA_GATTC_SERV_READ_HASH &&
+      p_data->op_cmpl.op_code == GATTC_OPTYPE_READ) {
+    bta_gattc_read_database_hash_cmpl(p_clcb, &p_data->op_cmpl);
+    return;
+  }
+
+  if (p_clcb->disc_mtu_pending &&
+      p_data->op_cmpl.op_code == GATTC_OPTYPE_CONFIG) {
+    bta_gattc_disc_cfg_mtu_cmpl(p_clcb, &p_data->op_cmpl);
+    return;
+  }
+
   /* receive op complete when discovery is started, ignore the response,
       and wait for discovery finish and resent */
   VLOG(1) << __func__ << ": op = " << +p_data->hdr.layer_specific;
@@ -1164,6 +1245,7 @@ void bta_gattc_process_api_refresh(const RawAddress& remote_bda) {
     /* in all other cases, mark it and delete the cache */
 
     p_srvc_cb->gatt_database.Clear();
+    bta_gattc_srcb_clear_idle_database(p_srvc_cb);
   }
 
   /* used to reset cache in application */
@@ -1202,7 +1284,19 @@ bool bta_gattc_process_srvc_chg_ind(uint16_t conn_id, tBTA_GATTC_RCB* p_clrcb,
   LOG(ERROR) << __func__ << ": service changed s_handle=" << loghex(s_handle)
              << ", e_handle=" << loghex(e_handle);
 
-  /* mark service handle change pending */
+  /* mark service handle change pending, the rediscovery covers the ranges of
+   * all the indications received meanwhile */
+  if (s_handle == 0 || s_handle > e_handle) {
+    s_handle = gatt::HANDLE_MIN;
+    e_handle = gatt::HANDLE_MAX;
+  }
+  if (p_srcb->chg_s_handle == 0) {
+    p_srcb->chg_s_handle = s_handle;
+    p_srcb->chg_e_handle = e_handle;
+  } else {
+    p_srcb->chg_s_handle = std::min(p_srcb->chg_s_handle, s_handle);
+    p_srcb->chg_e_handle = std::max(p_srcb->chg_e_handle, e_handle);
+  }
   p_srcb->srvc_hdl_chg = true;
   /* clear up all notification/indication registration */
   bta_gattc_clear_notif_registration(p_srcb, conn_id, s_handle, e_handle);
@@ -24,6 +24,7 @@
 
 #include "bt_target.h"
 
+#include <stdio.h>
 #include <string.h>
 
 #include <base/bind.h>
@@ -737,3 +738,16 @@ void BTA_GATTC_Refresh(const RawAddress& remote_bda) {
   do_in_bta_thread(FROM_HERE,
                    base::Bind(&bta_gattc_process_api_refresh, remote_bda));
 }
+
+void BTA_GATTC_DumpStatistics(int fd) {
+  const tBTA_GATTC_CACHE_STATS* p_stats = &bta_gattc_cb.cache_stats;
+  dprintf(fd, "\nGATT client server cache:\n");
+  dprintf(fd,
+          "  Databases (in memory/from disk/discovered): %zu / %zu / %zu\n",
+          p_stats->memory_hits, p_stats->disk_hits, p_stats->discoveries);
+  dprintf(fd, "  Discoveries limited to a service change range: %zu\n",
+          p_stats->range_discoveries);
+  dprintf(fd, "  Kept in memory: %zu bytes of %d, evictions: %zu\n",
+          p_stats->memory_usage, BTA_GATTC_CACHE_MEM_BUDGET,
+          p_stats->evictions);
+}
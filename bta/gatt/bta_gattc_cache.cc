@@ -28,17 +28,28 @@
 #include "bt_target.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
 #include <sstream>
+#include <string>
+
+#include <base/bind.h>
 
 #include "bt_common.h"
 #include "bta_gattc_int.h"
 #include "bta_sys.h"
+#include "btif/include/btif_debug_conn.h"
 #include "btm_api.h"
 #include "btm_ble_api.h"
 #include "btm_int.h"
+#include "common/thread_pool.h"
 #include "database.h"
 #include "database_builder.h"
 #include "osi/include/log.h"
@@ -62,8 +73,11 @@ constexpr static std::pair<uint16_t, uint16_t> EXPLORE_END =
         std::make_pair(0xFFFF, 0xFFFF);
 #endif
 
-static void bta_gattc_cache_write(const RawAddress& server_bda,
+static void bta_gattc_cache_write(const char* fname,
                                   const std::vector<StoredAttribute>& attr);
+static void bta_gattc_cache_write_files(std::vector<std::string> fnames,
+                                        std::vector<StoredAttribute> attr,
+                                        uint32_t reset_count);
 static tGATT_STATUS bta_gattc_sdp_service_disc(uint16_t conn_id,
                                                tBTA_GATTC_SERV* p_server_cb);
 const Descriptor* bta_gattc_get_descriptor_srcb(tBTA_GATTC_SERV* p_srcb,
@@ -72,12 +86,44 @@ const Characteristic* bta_gattc_get_characteristic_srcb(tBTA_GATTC_SERV* p_srcb,
                                                         uint16_t handle);
 static void bta_gattc_explore_srvc_finished(uint16_t conn_id,
                                             tBTA_GATTC_SERV* p_srvc_cb);
+static void bta_gattc_notify_range_changed(tBTA_GATTC_SERV* p_srvc_cb);
 
 #define BTA_GATT_SDP_DB_SIZE 4096
 
 #define GATT_CACHE_PREFIX "/data/misc/bluetooth/gatt_cache_"
+#define GATT_HASH_CACHE_PREFIX "/data/misc/bluetooth/gatt_hash_cache_"
 #define GATT_CACHE_VERSION 5
 
+/* The cache files are written in the thread pool. |cache_file_lock| keeps a
+ * load from reading a file while it is being written, and each reset counted
+ * in |cache_reset_count| drops the writes posted before it. */
+static std::mutex cache_file_lock;
+static uint32_t cache_reset_count;
+
+/* Number of cache files whose database is kept once loaded */
+#ifndef BTA_GATTC_LOADED_CACHE_MAX
+#define BTA_GATTC_LOADED_CACHE_MAX 4
+#endif
+
+/* A database loaded from a cache file, valid as long as the file is unchanged.
+ * Reconnections, and servers sharing a Database Hash cache, take a copy
+ * instead of reading and deserializing the file again. */
+typedef struct {
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  struct timespec mtime;
+  uint32_t last_used;
+  Database database;
+} tBTA_GATTC_LOADED_CACHE;
+
+/* Guarded by |cache_file_lock|, keyed by file name */
+static std::map<std::string, tBTA_GATTC_LOADED_CACHE> loaded_caches;
+static uint32_t loaded_cache_uses;
+
+/* Cache file header, followed by the attributes */
+#define GATT_CACHE_HEADER_LEN (2 * sizeof(uint16_t))
+
 static void bta_gattc_generate_cache_file_name(char* buffer, size_t buffer_len,
                                                const RawAddress& bda) {
   snprintf(buffer, buffer_len, "%s%02x%02x%02x%02x%02x%02x", GATT_CACHE_PREFIX,
@@ -85,6 +131,19 @@ static void bta_gattc_generate_cache_file_name(char* buffer, size_t buffer_len,
            bda.address[4], bda.address[5]);
 }
 
+/* Servers with the same Database Hash have the same database, handles
+ * included, so their cache is stored once under the hash */
+static void bta_gattc_generate_hash_cache_file_name(char* buffer,
+                                                    size_t buffer_len,
+                                                    const uint8_t* hash) {
+  int len = snprintf(buffer, buffer_len, "%s", GATT_HASH_CACHE_PREFIX);
+  for (int i = 0; i < BTA_GATTC_DATABASE_HASH_LEN && len > 0 &&
+                  (size_t)len < buffer_len;
+       i++) {
+    len += snprintf(buffer + len, buffer_len - len, "%02x", hash[i]);
+  }
+}
+
 /*****************************************************************************
  *  Constants and data types
  ****************************************************************************/
@@ -122,16 +181,38 @@ static void bta_gattc_display_explore_record(const DatabaseBuilder& database) {
 void bta_gattc_init_cache(tBTA_GATTC_SERV* p_srvc_cb) {
   p_srvc_cb->gatt_database = gatt::Database();
   p_srvc_cb->pending_discovery.Clear();
+  p_srvc_cb->disc_range_only = false;
+  p_srvc_cb->disc_s_handle = gatt::HANDLE_MIN;
+  p_srvc_cb->disc_e_handle = gatt::HANDLE_MAX;
 }
 
-const Service* bta_gattc_find_matching_service(
-    const std::vector<Service>& services, uint16_t handle) {
-  for (const Service& service : services) {
-    if (handle >= service.handle && handle <= service.end_handle)
-      return &service;
+/** Start the discovery of the services in the |start_handle| to |end_handle|
+ * range only, to be spliced into the database of the server once explored */
+tGATT_STATUS bta_gattc_discover_range(uint16_t conn_id,
+                                      tBTA_GATTC_SERV* p_srvc_cb,
+                                      uint16_t start_handle,
+                                      uint16_t end_handle) {
+  tBTA_GATTC_CLCB* p_clcb = bta_gattc_find_clcb_by_conn_id(conn_id);
+  if (!p_clcb) return GATT_ERROR;
+
+  /* a service partly in the range is discovered again as a whole */
+  for (const Service& service : p_srvc_cb->gatt_database.Services()) {
+    if (service.end_handle < start_handle || service.handle > end_handle)
+      continue;
+    start_handle = std::min(start_handle, service.handle);
+    end_handle = std::max(end_handle, service.end_handle);
   }
 
-  return nullptr;
+  LOG(INFO) << __func__ << ": s_handle=" << loghex(start_handle)
+            << ", e_handle=" << loghex(end_handle);
+
+  p_srvc_cb->pending_discovery.Clear();
+  p_srvc_cb->disc_range_only = true;
+  p_srvc_cb->disc_s_handle = start_handle;
+  p_srvc_cb->disc_e_handle = end_handle;
+
+  btif_debug_conn_milestone(p_clcb->bda, BTIF_DEBUG_CONN_DISCOVERY_START);
+  return GATTC_Discover(conn_id, GATT_DISC_SRVC_ALL, start_handle, end_handle);
 }
 
 /** Start primary service discovery */
@@ -141,6 +222,7 @@ tGATT_STATUS bta_gattc_discover_pri_service(uint16_t conn_id,
   tBTA_GATTC_CLCB* p_clcb = bta_gattc_find_clcb_by_conn_id(conn_id);
   if (!p_clcb) return GATT_ERROR;
 
+  btif_debug_conn_milestone(p_clcb->bda, BTIF_DEBUG_CONN_DISCOVERY_START);
   if (p_clcb->transport == BTA_TRANSPORT_LE) {
     return GATTC_Discover(conn_id, disc_type, 0x0001, 0xFFFF);
   }
@@ -181,8 +263,16 @@ static void bta_gattc_explore_srvc_finished(uint16_t conn_id,
 
   /* no service found at all, the end of server discovery*/
   LOG(INFO) << __func__ << ": service discovery finished";
-
-  p_srvc_cb->gatt_database = p_srvc_cb->pending_discovery.Build();
+  btif_debug_conn_milestone(p_clcb->bda, BTIF_DEBUG_CONN_DISCOVERY_END);
+
+  if (p_srvc_cb->disc_range_only) {
+    /* keep the services outside of the changed range */
+    p_srvc_cb->gatt_database.ReplaceRange(p_srvc_cb->disc_s_handle,
+                                          p_srvc_cb->disc_e_handle,
+                                          p_srvc_cb->pending_discovery.Build());
+  } else {
+    p_srvc_cb->gatt_database = p_srvc_cb->pending_discovery.Build();
+  }
 
 #if (BTA_GATT_DEBUG == TRUE)
   bta_gattc_display_cache_server(p_srvc_cb->gatt_database);
@@ -191,13 +281,58 @@ static void bta_gattc_explore_srvc_finished(uint16_t conn_id,
   p_clcb->p_srcb->state = BTA_GATTC_SERV_SAVE;
 
   if (btm_sec_is_a_bonded_dev(p_srvc_cb->server_bda)) {
-    bta_gattc_cache_write(p_clcb->p_srcb->server_bda,
-                          p_clcb->p_srcb->gatt_database.Serialize());
+    char fname[255] = {0};
+    std::vector<std::string> fnames;
+    std::vector<StoredAttribute> attr =
+        p_clcb->p_srcb->gatt_database.Serialize();
+
+    bta_gattc_generate_cache_file_name(fname, sizeof(fname),
+                                       p_srvc_cb->server_bda);
+    fnames.push_back(fname);
+
+    if (p_srvc_cb->has_database_hash) {
+      bta_gattc_generate_hash_cache_file_name(fname, sizeof(fname),
+                                              p_srvc_cb->database_hash);
+      fnames.push_back(fname);
+    }
+
+    uint32_t reset_count;
+    {
+      std::lock_guard<std::mutex> lock(cache_file_lock);
+      reset_count = cache_reset_count;
+    }
+    if (!bluetooth::common::PostToPool(
+            FROM_HERE, base::BindOnce(&bta_gattc_cache_write_files, fnames,
+                                      attr, reset_count))) {
+      bta_gattc_cache_write_files(fnames, std::move(attr), reset_count);
+    }
+  }
+
+  if (p_srvc_cb->disc_range_only) {
+    p_srvc_cb->disc_range_only = false;
+    bta_gattc_notify_range_changed(p_srvc_cb);
   }
 
   bta_gattc_reset_discover_st(p_clcb->p_srcb, GATT_SUCCESS);
 }
 
+/** Tell the clients of |p_srvc_cb| which handle range was discovered again */
+static void bta_gattc_notify_range_changed(tBTA_GATTC_SERV* p_srvc_cb) {
+  for (size_t i = 0; i < BTA_GATTC_CLCB_MAX; i++) {
+    tBTA_GATTC_CLCB* p_clcb = &bta_gattc_cb.clcb[i];
+    if (!p_clcb->in_use || p_clcb->p_srcb != p_srvc_cb ||
+        !p_clcb->p_rcb->p_cback)
+      continue;
+
+    tBTA_GATTC cb_data;
+    cb_data.srvc_chg_range.conn_id = p_clcb->bta_conn_id;
+    cb_data.srvc_chg_range.remote_bda = p_srvc_cb->server_bda;
+    cb_data.srvc_chg_range.start_handle = p_srvc_cb->disc_s_handle;
+    cb_data.srvc_chg_range.end_handle = p_srvc_cb->disc_e_handle;
+    (*p_clcb->p_rcb->p_cback)(BTA_GATTC_SRVC_CHG_RANGE_EVT, &cb_data);
+  }
+}
+
 /** Start discovery for characteristic descriptor */
 void bta_gattc_start_disc_char_dscp(uint16_t conn_id,
                                     tBTA_GATTC_SERV* p_srvc_cb) {
@@ -380,11 +515,26 @@ void bta_gattc_disc_cmpl_cback(uint16_t conn_id, tGATT_DISC_TYPE disc_type,
   tBTA_GATTC_SERV* p_srvc_cb = bta_gattc_find_scb_by_cid(conn_id);
   if (!p_srvc_cb) return;
 
+  /* an MTU configuration requested meanwhile goes first */
+  if (p_clcb && bta_gattc_disc_cfg_mtu(p_clcb, disc_type)) return;
+
   switch (disc_type) {
     case GATT_DISC_SRVC_ALL:
-    case GATT_DISC_SRVC_BY_UUID:
 // definition of all services are discovered, now it's time to discover
-// their content
+// their content. Over LE, the content of all of them is discovered at once.
+#if (BTA_GATT_DEBUG == TRUE)
+      bta_gattc_display_explore_record(p_srvc_cb->pending_discovery);
+#endif
+      if (p_clcb && p_clcb->transport == BTA_TRANSPORT_LE &&
+          p_srvc_cb->pending_discovery.StartDatabaseExploration(
+              p_srvc_cb->disc_s_handle, p_srvc_cb->disc_e_handle)) {
+        auto& range = p_srvc_cb->pending_discovery.CurrentlyExploredService();
+        GATTC_Discover(conn_id, GATT_DISC_INC_SRVC, range.first, range.second);
+        break;
+      }
+      bta_gattc_explore_next_service(conn_id, p_srvc_cb);
+      break;
+    case GATT_DISC_SRVC_BY_UUID:
 #if (BTA_GATT_DEBUG == TRUE)
       bta_gattc_display_explore_record(p_srvc_cb->pending_discovery);
 #endif
@@ -452,31 +602,25 @@ const std::vector<Service>* bta_gattc_get_services(uint16_t conn_id) {
 
 const Service* bta_gattc_get_service_for_handle_srcb(tBTA_GATTC_SERV* p_srcb,
                                                      uint16_t handle) {
-  const std::vector<Service>* services = bta_gattc_get_services_srcb(p_srcb);
-  if (services == NULL) return NULL;
-  return bta_gattc_find_matching_service(*services, handle);
+  if (!p_srcb) return NULL;
+
+  return p_srcb->gatt_database.FindService(handle);
 }
 
 const Service* bta_gattc_get_service_for_handle(uint16_t conn_id,
                                                 uint16_t handle) {
-  const std::vector<Service>* services = bta_gattc_get_services(conn_id);
-  if (services == NULL) return NULL;
+  tBTA_GATTC_CLCB* p_clcb = bta_gattc_find_clcb_by_conn_id(conn_id);
+
+  if (p_clcb == NULL) return NULL;
 
-  return bta_gattc_find_matching_service(*services, handle);
+  return bta_gattc_get_service_for_handle_srcb(p_clcb->p_srcb, handle);
 }
 
 const Characteristic* bta_gattc_get_characteristic_srcb(tBTA_GATTC_SERV* p_srcb,
                                                         uint16_t handle) {
-  const Service* service =
-      bta_gattc_get_service_for_handle_srcb(p_srcb, handle);
+  if (!p_srcb) return NULL;
 
-  if (!service) return NULL;
-
-  for (const Characteristic& charac : service->characteristics) {
-    if (handle == charac.value_handle) return &charac;
-  }
-
-  return NULL;
+  return p_srcb->gatt_database.FindCharacteristic(handle);
 }
 
 const Characteristic* bta_gattc_get_characteristic(uint16_t conn_id,
@@ -491,20 +635,9 @@ const Characteristic* bta_gattc_get_characteristic(uint16_t conn_id,
 
 const Descriptor* bta_gattc_get_descriptor_srcb(tBTA_GATTC_SERV* p_srcb,
                                                 uint16_t handle) {
-  const Service* service =
-      bta_gattc_get_service_for_handle_srcb(p_srcb, handle);
-
-  if (!service) {
-    return NULL;
-  }
+  if (!p_srcb) return NULL;
 
-  for (const Characteristic& charac : service->characteristics) {
-    for (const Descriptor& desc : charac.descriptors) {
-      if (handle == desc.handle) return &desc;
-    }
-  }
-
-  return NULL;
+  return p_srcb->gatt_database.FindDescriptor(handle);
 }
 
 const Descriptor* bta_gattc_get_descriptor(uint16_t conn_id, uint16_t handle) {
@@ -518,18 +651,9 @@ const Descriptor* bta_gattc_get_descriptor(uint16_t conn_id, uint16_t handle) {
 
 const Characteristic* bta_gattc_get_owning_characteristic_srcb(
     tBTA_GATTC_SERV* p_srcb, uint16_t handle) {
-  const Service* service =
-      bta_gattc_get_service_for_handle_srcb(p_srcb, handle);
-
-  if (!service) return NULL;
-
-  for (const Characteristic& charac : service->characteristics) {
-    for (const Descriptor& desc : charac.descriptors) {
-      if (handle == desc.handle) return &charac;
-    }
-  }
+  if (!p_srcb) return NULL;
 
-  return NULL;
+  return p_srcb->gatt_database.FindOwningCharacteristic(handle);
 }
 
 const Characteristic* bta_gattc_get_owning_characteristic(uint16_t conn_id,
@@ -712,6 +836,136 @@ void bta_gattc_get_gatt_db(uint16_t conn_id, uint16_t start_handle,
                              count);
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_is_loaded
+ *
+ * Description      Check if |cache| was loaded from the current content of
+ *                  the file described by |st|.
+ *
+ * Returns          true if the file is unchanged since, false otherwise
+ *
+ ******************************************************************************/
+static bool bta_gattc_cache_is_loaded(const tBTA_GATTC_LOADED_CACHE& cache,
+                                      const struct stat& st) {
+  return cache.dev == st.st_dev && cache.ino == st.st_ino &&
+         cache.size == st.st_size &&
+         cache.mtime.tv_sec == st.st_mtim.tv_sec &&
+         cache.mtime.tv_nsec == st.st_mtim.tv_nsec;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_keep_loaded
+ *
+ * Description      Keep the database loaded from file |fname|, described by
+ *                  |st|, dropping the one used least recently if there are
+ *                  BTA_GATTC_LOADED_CACHE_MAX already.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_gattc_cache_keep_loaded(const char* fname,
+                                        const struct stat& st,
+                                        const Database& database) {
+  if (loaded_caches.find(fname) == loaded_caches.end() &&
+      loaded_caches.size() >= BTA_GATTC_LOADED_CACHE_MAX) {
+    auto oldest = loaded_caches.begin();
+    for (auto it = loaded_caches.begin(); it != loaded_caches.end(); it++) {
+      if (it->second.last_used < oldest->second.last_used) oldest = it;
+    }
+    loaded_caches.erase(oldest);
+  }
+
+  tBTA_GATTC_LOADED_CACHE& cache = loaded_caches[fname];
+  cache.dev = st.st_dev;
+  cache.ino = st.st_ino;
+  cache.size = st.st_size;
+  cache.mtime = st.st_mtim;
+  cache.last_used = ++loaded_cache_uses;
+  cache.database = database;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_load_file
+ *
+ * Description      Load GATT cache from file |fname| into the database of
+ *                  |p_srcb|. The file is mapped and its attributes are
+ *                  deserialized in place, unless the database loaded from
+ *                  the same file content is still kept.
+ *
+ * Returns          true on success, false otherwise
+ *
+ ******************************************************************************/
+static bool bta_gattc_cache_load_file(const char* fname,
+                                      tBTA_GATTC_SERV* p_srcb) {
+  std::lock_guard<std::mutex> lock(cache_file_lock);
+  int fd = open(fname, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG(ERROR) << __func__ << ": can't open GATT cache file " << fname
+               << " for reading, error: " << strerror(errno);
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    LOG(ERROR) << __func__ << ": can't stat GATT cache file " << fname
+               << ", error: " << strerror(errno);
+    close(fd);
+    return false;
+  }
+
+  auto loaded = loaded_caches.find(fname);
+  if (loaded != loaded_caches.end()) {
+    if (bta_gattc_cache_is_loaded(loaded->second, st)) {
+      close(fd);
+      loaded->second.last_used = ++loaded_cache_uses;
+      p_srcb->gatt_database = loaded->second.database;
+      return true;
+    }
+    loaded_caches.erase(loaded);
+  }
+
+  if (st.st_size < (off_t)GATT_CACHE_HEADER_LEN) {
+    LOG(ERROR) << __func__ << ": can't read GATT cache version from: " << fname;
+    close(fd);
+    return false;
+  }
+
+  void* p_map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p_map == MAP_FAILED) {
+    LOG(ERROR) << __func__ << ": can't map GATT cache file " << fname
+               << ", error: " << strerror(errno);
+    return false;
+  }
+
+  const uint8_t* p = (const uint8_t*)p_map;
+  uint16_t cache_ver;
+  uint16_t num_attr;
+  bool success = false;
+  memcpy(&cache_ver, p, sizeof(uint16_t));
+  memcpy(&num_attr, p + sizeof(uint16_t), sizeof(uint16_t));
+
+  if (cache_ver != GATT_CACHE_VERSION) {
+    LOG(ERROR) << __func__ << ": wrong GATT cache version: " << fname;
+  } else if ((size_t)st.st_size !=
+             GATT_CACHE_HEADER_LEN + num_attr * sizeof(StoredAttribute)) {
+    LOG(ERROR) << __func__ << ": can't read GATT attributes: " << fname;
+  } else {
+    static_assert(GATT_CACHE_HEADER_LEN % alignof(StoredAttribute) == 0,
+                  "the header must keep the attributes aligned");
+    p_srcb->gatt_database = gatt::Database::Deserialize(
+        (const StoredAttribute*)(p + GATT_CACHE_HEADER_LEN), num_attr,
+        &success);
+    if (success) bta_gattc_cache_keep_loaded(fname, st, p_srcb->gatt_database);
+  }
+
+  munmap(p_map, st.st_size);
+  return success;
+}
+
 /*******************************************************************************
  *
  * Function         bta_gattc_cache_load
@@ -724,51 +978,98 @@ void bta_gattc_get_gatt_db(uint16_t conn_id, uint16_t start_handle,
  *
  ******************************************************************************/
 bool bta_gattc_cache_load(tBTA_GATTC_CLCB* p_clcb) {
+  if (bta_gattc_srcb_reuse_database(p_clcb->p_srcb, NULL)) return true;
+
   char fname[255] = {0};
   bta_gattc_generate_cache_file_name(fname, sizeof(fname),
                                      p_clcb->p_srcb->server_bda);
 
-  FILE* fd = fopen(fname, "rb");
-  if (!fd) {
-    LOG(ERROR) << __func__ << ": can't open GATT cache file " << fname
-               << " for reading, error: " << strerror(errno);
+  if (!bta_gattc_cache_load_file(fname, p_clcb->p_srcb)) return false;
+
+  bta_gattc_cb.cache_stats.disk_hits++;
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_read_database_hash
+ *
+ * Description      Read the Database Hash characteristic of the server by
+ *                  type, which needs no discovered handle. Completion is
+ *                  handled by bta_gattc_read_database_hash_cmpl.
+ *
+ * Returns          true if the read was started, false otherwise
+ *
+ ******************************************************************************/
+bool bta_gattc_read_database_hash(tBTA_GATTC_CLCB* p_clcb) {
+  tGATT_READ_PARAM read_param;
+  memset(&read_param, 0, sizeof(tGATT_READ_BY_TYPE));
+
+  read_param.char_type.s_handle = 0x0001;
+  read_param.char_type.e_handle = 0xFFFF;
+  read_param.char_type.uuid = Uuid::From16Bit(GATT_UUID_DATABASE_HASH);
+  read_param.char_type.auth_req = GATT_AUTH_REQ_NONE;
+
+  p_clcb->p_srcb->has_database_hash = false;
+  if (GATTC_Read(p_clcb->bta_conn_id, GATT_READ_BY_TYPE, &read_param) !=
+      GATT_SUCCESS)
     return false;
-  }
 
-  uint16_t cache_ver = 0;
-  bool success = false;
-  uint16_t num_attr = 0;
+  p_clcb->p_srcb->state = BTA_GATTC_SERV_READ_HASH;
+  return true;
+}
 
-  if (fread(&cache_ver, sizeof(uint16_t), 1, fd) != 1) {
-    LOG(ERROR) << __func__ << ": can't read GATT cache version from: " << fname;
-    goto done;
-  }
+/*******************************************************************************
+ *
+ * Function         bta_gattc_read_database_hash_cmpl
+ *
+ * Description      Use the cache shared by servers with the same Database
+ *                  Hash, or the cache of this server if it has no hash, and
+ *                  fall back to a full discovery.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_gattc_read_database_hash_cmpl(tBTA_GATTC_CLCB* p_clcb,
+                                       const tBTA_GATTC_OP_CMPL* p_data) {
+  tBTA_GATTC_SERV* p_srcb = p_clcb->p_srcb;
+  bool loaded;
 
-  if (cache_ver != GATT_CACHE_VERSION) {
-    LOG(ERROR) << __func__ << ": wrong GATT cache version: " << fname;
-    goto done;
+  if (p_data->status == GATT_SUCCESS && p_data->p_cmpl &&
+      p_data->p_cmpl->att_value.len == BTA_GATTC_DATABASE_HASH_LEN) {
+    memcpy(p_srcb->database_hash, p_data->p_cmpl->att_value.value,
+           BTA_GATTC_DATABASE_HASH_LEN);
+    p_srcb->has_database_hash = true;
   }
 
-  if (fread(&num_attr, sizeof(uint16_t), 1, fd) != 1) {
-    LOG(ERROR) << __func__
-               << ": can't read number of GATT attributes: " << fname;
-    goto done;
+  /* a Service Changed indication received meanwhile voids the hash */
+  if (p_clcb->auto_update == BTA_GATTC_DISC_WAITING)
+    p_srcb->has_database_hash = false;
+
+  p_srcb->state = BTA_GATTC_SERV_LOAD;
+  if (p_srcb->has_database_hash) {
+    loaded = bta_gattc_srcb_reuse_database(p_srcb, p_srcb->database_hash);
+    if (!loaded) {
+      char fname[255] = {0};
+      bta_gattc_generate_hash_cache_file_name(fname, sizeof(fname),
+                                              p_srcb->database_hash);
+      loaded = bta_gattc_cache_load_file(fname, p_srcb);
+      if (loaded) bta_gattc_cb.cache_stats.disk_hits++;
+    }
+  } else {
+    loaded = bta_gattc_cache_load(p_clcb);
   }
 
-  {
-    std::vector<StoredAttribute> attr(num_attr);
-
-    if (fread(attr.data(), sizeof(StoredAttribute), num_attr, fd) != num_attr) {
-      LOG(ERROR) << __func__ << "s: can't read GATT attributes: " << fname;
-      goto done;
-    }
+  VLOG(1) << __func__ << ": has_database_hash=" << p_srcb->has_database_hash
+          << " cache loaded=" << loaded;
 
-    p_clcb->p_srcb->gatt_database = gatt::Database::Deserialize(attr, &success);
+  if (loaded) {
+    p_srcb->state = BTA_GATTC_SERV_IDLE;
+    bta_gattc_reset_discover_st(p_srcb, GATT_SUCCESS);
+  } else {
+    p_srcb->state = BTA_GATTC_SERV_DISC;
+    bta_gattc_start_discover(p_clcb, NULL);
   }
-
-done:
-  fclose(fd);
-  return success;
 }
 
 /*******************************************************************************
@@ -778,15 +1079,14 @@ done:
  * Description      This callout function is executed by GATT when a server
  *                  cache is available to save.
  *
- * Parameter        server_bda: server bd address of this cache belongs to
+ * Parameter        fname: cache file to write.
  *                  attr: attributes to save.
  * Returns
  *
  ******************************************************************************/
-static void bta_gattc_cache_write(const RawAddress& server_bda,
+static void bta_gattc_cache_write(const char* fname,
                                   const std::vector<StoredAttribute>& attr) {
-  char fname[255] = {0};
-  bta_gattc_generate_cache_file_name(fname, sizeof(fname), server_bda);
+  loaded_caches.erase(fname);
 
   FILE* fd = fopen(fname, "wb");
   if (!fd) {
@@ -819,6 +1119,33 @@ static void bta_gattc_cache_write(const RawAddress& server_bda,
   fclose(fd);
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_write_files
+ *
+ * Description      Runs in the thread pool to save the cache of a server to
+ *                  each of |fnames|, unless a cache was reset since the
+ *                  cache was serialized.
+ *
+ * Parameter        fnames: cache files to write.
+ *                  attr: attributes to save.
+ *                  reset_count: cache_reset_count when attr was serialized.
+ * Returns
+ *
+ ******************************************************************************/
+static void bta_gattc_cache_write_files(std::vector<std::string> fnames,
+                                        std::vector<StoredAttribute> attr,
+                                        uint32_t reset_count) {
+  std::lock_guard<std::mutex> lock(cache_file_lock);
+  if (reset_count != cache_reset_count) {
+    VLOG(1) << __func__ << ": cache reset meanwhile, not saved";
+    return;
+  }
+
+  for (const std::string& fname : fnames)
+    bta_gattc_cache_write(fname.c_str(), attr);
+}
+
 /*******************************************************************************
  *
  * Function         bta_gattc_cache_reset
@@ -835,5 +1162,9 @@ void bta_gattc_cache_reset(const RawAddress& server_bda) {
   VLOG(1) << __func__;
   char fname[255] = {0};
   bta_gattc_generate_cache_file_name(fname, sizeof(fname), server_bda);
+
+  std::lock_guard<std::mutex> lock(cache_file_lock);
+  cache_reset_count++;
+  loaded_caches.erase(fname);
   unlink(fname);
 }
@@ -36,6 +36,8 @@
 #include <base/logging.h>
 #include <base/strings/stringprintf.h>
 
+#include <list>
+
 using bluetooth::Uuid;
 
 /*****************************************************************************
@@ -73,11 +75,17 @@ typedef uint16_t tBTA_GATTC_INT_EVT;
 #define BTA_GATTC_CL_MAX 32
 #endif
 
-/* max known devices GATTC can support */
+/* max known devices GATTC can support, and disconnected servers kept
+ * without a database in memory */
 #ifndef BTA_GATTC_KNOWN_SR_MAX
 #define BTA_GATTC_KNOWN_SR_MAX 10
 #endif
 
+/* memory the databases of disconnected servers can hold, in bytes */
+#ifndef BTA_GATTC_CACHE_MEM_BUDGET
+#define BTA_GATTC_CACHE_MEM_BUDGET (64 * 1024)
+#endif
+
 #define BTA_GATTC_CONN_MAX GATT_MAX_PHY_CHANNEL
 
 #ifndef BTA_GATTC_CLCB_MAX
@@ -198,6 +206,8 @@ enum {
 };
 typedef uint8_t tBTA_GATTC_STATE;
 
+#define BTA_GATTC_DATABASE_HASH_LEN 16
+
 typedef struct {
   bool in_use;
   RawAddress server_bda;
@@ -208,6 +218,7 @@ typedef struct {
 #define BTA_GATTC_SERV_SAVE 2
 #define BTA_GATTC_SERV_DISC 3
 #define BTA_GATTC_SERV_DISC_ACT 4
+#define BTA_GATTC_SERV_READ_HASH 5
 
   uint8_t state;
 
@@ -220,9 +231,40 @@ typedef struct {
   uint8_t srvc_hdl_chg; /* service handle change indication pending */
   uint16_t attr_index;  /* cahce NV saving/loading attribute index */
 
+  /* handle range of the pending service changed indications, 0 if none */
+  uint16_t chg_s_handle;
+  uint16_t chg_e_handle;
+  /* handle range of the running discovery, the services found replace that
+   * range of gatt_database only when disc_range_only is set */
+  bool disc_range_only;
+  uint16_t disc_s_handle;
+  uint16_t disc_e_handle;
+
   uint16_t mtu;
+
+  /* Database Hash read from the server on this connection, it selects the
+   * shared cache for servers with the same database */
+  bool has_database_hash;
+  uint8_t database_hash[BTA_GATTC_DATABASE_HASH_LEN];
+
+  /* Database kept since the server disconnected, to be used again on the
+   * next connection instead of the cache file */
+  gatt::Database idle_database;
+  size_t idle_database_size;
+  bool idle_has_database_hash;
+  uint8_t idle_database_hash[BTA_GATTC_DATABASE_HASH_LEN];
 } tBTA_GATTC_SERV;
 
+/* Where the database of a connecting server came from */
+typedef struct {
+  size_t memory_hits; /* kept in memory since the last connection */
+  size_t disk_hits;   /* loaded from a cache file */
+  size_t discoveries; /* discovered from the server */
+  size_t range_discoveries; /* limited to the range of a service change */
+  size_t evictions;   /* kept databases dropped for the memory budget */
+  size_t memory_usage; /* memory held by the kept databases, in bytes */
+} tBTA_GATTC_CACHE_STATS;
+
 #ifndef BTA_GATTC_NOTIF_REG_MAX
 #define BTA_GATTC_NOTIF_REG_MAX 15
 #endif
@@ -259,6 +301,8 @@ typedef struct {
 
   uint8_t auto_update; /* auto update is waiting */
   bool disc_active;
+  bool disc_mtu_pending; /* MTU exchange sent in the middle of the discovery */
+  tGATT_DISC_TYPE disc_resume_type; /* discovery to resume after the MTU */
   bool in_use;
   tBTA_GATTC_STATE state;
   tGATT_STATUS status;
@@ -301,7 +345,8 @@ typedef struct {
   tBTA_GATTC_RCB cl_rcb[BTA_GATTC_CL_MAX];
 
   tBTA_GATTC_CLCB clcb[BTA_GATTC_CLCB_MAX];
-  tBTA_GATTC_SERV known_server[BTA_GATTC_KNOWN_SR_MAX];
+  std::list<tBTA_GATTC_SERV> known_server; /* most recently used first */
+  tBTA_GATTC_CACHE_STATS cache_stats;
 
   int gatt_skt_fd;
   bool is_gatt_skt_connected;
@@ -385,6 +430,8 @@ extern void bta_gattc_send_open_cback(tBTA_GATTC_RCB* p_clreg,
                                       tBTA_TRANSPORT transport, uint16_t mtu);
 extern void bta_gattc_process_api_refresh(const RawAddress& remote_bda);
 extern void bta_gattc_cfg_mtu(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data);
+extern bool bta_gattc_disc_cfg_mtu(tBTA_GATTC_CLCB* p_clcb,
+                                   tGATT_DISC_TYPE disc_type);
 extern void bta_gattc_listen(tBTA_GATTC_DATA* p_msg);
 extern void bta_gattc_broadcast(tBTA_GATTC_DATA* p_msg);
 
@@ -403,6 +450,9 @@ extern tBTA_GATTC_CLCB* bta_gattc_find_alloc_clcb(tGATT_IF client_if,
 extern tBTA_GATTC_RCB* bta_gattc_cl_get_regcb(uint8_t client_if);
 extern tBTA_GATTC_SERV* bta_gattc_find_srcb(const RawAddress& bda);
 extern tBTA_GATTC_SERV* bta_gattc_srcb_alloc(const RawAddress& bda);
+extern bool bta_gattc_srcb_reuse_database(tBTA_GATTC_SERV* p_srcb,
+                                          const uint8_t* p_hash);
+extern void bta_gattc_srcb_clear_idle_database(tBTA_GATTC_SERV* p_srcb);
 extern tBTA_GATTC_SERV* bta_gattc_find_scb_by_cid(uint16_t conn_id);
 extern tBTA_GATTC_CLCB* bta_gattc_find_int_conn_clcb(tBTA_GATTC_DATA* p_msg);
 extern tBTA_GATTC_CLCB* bta_gattc_find_int_disconn_clcb(tBTA_GATTC_DATA* p_msg);
@@ -454,6 +504,10 @@ extern void bta_gattc_get_gatt_db(uint16_t conn_id, uint16_t start_handle,
                                   uint16_t end_handle, btgatt_db_element_t** db,
                                   int* count);
 extern void bta_gattc_init_cache(tBTA_GATTC_SERV* p_srvc_cb);
+extern tGATT_STATUS bta_gattc_discover_range(uint16_t conn_id,
+                                             tBTA_GATTC_SERV* p_srvc_cb,
+                                             uint16_t start_handle,
+                                             uint16_t end_handle);
 extern void bta_gattc_reset_discover_st(tBTA_GATTC_SERV* p_srcb,
                                         tGATT_STATUS status);
 
@@ -463,6 +517,9 @@ extern tBTA_GATTC_CONN* bta_gattc_conn_find_alloc(const RawAddress& remote_bda);
 extern bool bta_gattc_conn_dealloc(const RawAddress& remote_bda);
 
 extern bool bta_gattc_cache_load(tBTA_GATTC_CLCB* p_clcb);
+extern bool bta_gattc_read_database_hash(tBTA_GATTC_CLCB* p_clcb);
+extern void bta_gattc_read_database_hash_cmpl(tBTA_GATTC_CLCB* p_clcb,
+                                              const tBTA_GATTC_OP_CMPL* p_data);
 extern void bta_gattc_cache_reset(const RawAddress& server_bda);
 
 #endif /* BTA_GATTC_INT_H */
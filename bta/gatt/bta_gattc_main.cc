@@ -28,6 +28,7 @@
 
 #include "bt_common.h"
 #include "bta_gattc_int.h"
+#include "bta_sys_sm.h"
 
 using base::StringPrintf;
 
@@ -102,7 +103,7 @@ const tBTA_GATTC_ACTION bta_gattc_action[] = {
 #define BTA_GATTC_NUM_COLS 2   /* number of columns in state tables */
 
 /* state table for idle state */
-static const uint8_t bta_gattc_st_idle[][BTA_GATTC_NUM_COLS] = {
+static constexpr uint8_t bta_gattc_st_idle[][BTA_GATTC_NUM_COLS] = {
     /* Event                            Action 1                  Next state */
     /* BTA_GATTC_API_OPEN_EVT           */ {BTA_GATTC_OPEN,
                                             BTA_GATTC_W4_CONN_ST},
@@ -138,7 +139,7 @@ static const uint8_t bta_gattc_st_idle[][BTA_GATTC_NUM_COLS] = {
 };
 
 /* state table for wait for open state */
-static const uint8_t bta_gattc_st_w4_conn[][BTA_GATTC_NUM_COLS] = {
+static constexpr uint8_t bta_gattc_st_w4_conn[][BTA_GATTC_NUM_COLS] = {
     /* Event                            Action 1 Next state */
     /* BTA_GATTC_API_OPEN_EVT           */ {BTA_GATTC_OPEN,
                                             BTA_GATTC_W4_CONN_ST},
@@ -181,7 +182,7 @@ static const uint8_t bta_gattc_st_w4_conn[][BTA_GATTC_NUM_COLS] = {
 };
 
 /* state table for open state */
-static const uint8_t bta_gattc_st_connected[][BTA_GATTC_NUM_COLS] = {
+static constexpr uint8_t bta_gattc_st_connected[][BTA_GATTC_NUM_COLS] = {
     /* Event                            Action 1 Next state */
     /* BTA_GATTC_API_OPEN_EVT           */ {BTA_GATTC_OPEN, BTA_GATTC_CONN_ST},
     /* BTA_GATTC_INT_OPEN_FAIL_EVT      */ {BTA_GATTC_IGNORE,
@@ -220,7 +221,7 @@ static const uint8_t bta_gattc_st_connected[][BTA_GATTC_NUM_COLS] = {
 };
 
 /* state table for discover state */
-static const uint8_t bta_gattc_st_discover[][BTA_GATTC_NUM_COLS] = {
+static constexpr uint8_t bta_gattc_st_discover[][BTA_GATTC_NUM_COLS] = {
     /* Event                            Action 1 Next state */
     /* BTA_GATTC_API_OPEN_EVT           */ {BTA_GATTC_OPEN,
                                             BTA_GATTC_DISCOVER_ST},
@@ -262,16 +263,15 @@ static const uint8_t bta_gattc_st_discover[][BTA_GATTC_NUM_COLS] = {
 
 };
 
-/* type for state table */
-typedef const uint8_t (*tBTA_GATTC_ST_TBL)[BTA_GATTC_NUM_COLS];
-
 /* state table */
-const tBTA_GATTC_ST_TBL bta_gattc_st_tbl[] = {
-    bta_gattc_st_idle,      /* BTA_GATTC_IDLE_ST */
-    bta_gattc_st_w4_conn,   /* BTA_GATTC_W4_CONN_ST */
-    bta_gattc_st_connected, /* BTA_GATTC_CONN_ST */
-    bta_gattc_st_discover   /* BTA_GATTC_DISCOVER_ST */
-};
+static constexpr BtaSysStateTables<
+    BTA_GATTC_DISCOVER_ST + 1,
+    BTA_GATTC_INT_DISCONN_EVT - BTA_GATTC_API_OPEN_EVT + 1, BTA_GATTC_ACTIONS>
+    bta_gattc_st_tbl(BTA_GATTC_IGNORE,
+                     bta_gattc_st_idle,      /* BTA_GATTC_IDLE_ST */
+                     bta_gattc_st_w4_conn,   /* BTA_GATTC_W4_CONN_ST */
+                     bta_gattc_st_connected, /* BTA_GATTC_CONN_ST */
+                     bta_gattc_st_discover); /* BTA_GATTC_DISCOVER_ST */
 
 /*****************************************************************************
  * Global data
@@ -296,7 +296,7 @@ static const char* gattc_state_code(tBTA_GATTC_STATE state_code);
  ******************************************************************************/
 bool bta_gattc_sm_execute(tBTA_GATTC_CLCB* p_clcb, uint16_t event,
                           tBTA_GATTC_DATA* p_data) {
-  tBTA_GATTC_ST_TBL state_table;
+  const uint8_t* entry;
   uint8_t action;
   int i;
   bool rt = true;
@@ -306,17 +306,17 @@ bool bta_gattc_sm_execute(tBTA_GATTC_CLCB* p_clcb, uint16_t event,
                           in_state, gattc_state_code(in_state), in_event,
                           gattc_evt_code(in_event));
 
-  /* look up the state table for the current state */
-  state_table = bta_gattc_st_tbl[p_clcb->state];
-
   event &= 0x00FF;
 
+  /* look up the state table entry for the current state and the event */
+  entry = bta_gattc_st_tbl.Row(p_clcb->state, event);
+
   /* set next state */
-  p_clcb->state = state_table[event][BTA_GATTC_NEXT_STATE];
+  p_clcb->state = entry[BTA_GATTC_NEXT_STATE];
 
   /* execute action functions */
   for (i = 0; i < BTA_GATTC_ACTIONS; i++) {
-    action = state_table[event][i];
+    action = entry[i];
     if (action != BTA_GATTC_IGNORE) {
       (*bta_gattc_action[action])(p_clcb, p_data);
       if (p_clcb->p_q_cmd == p_data) {
@@ -16,25 +16,40 @@
 
 #include "bta_gatt_queue.h"
 
+#include <base/logging.h>
 #include <list>
 #include <unordered_map>
 #include <unordered_set>
 
 using gatt_operation = BtaGattQueue::gatt_operation;
+using gatt_op_stats = BtaGattQueue::gatt_op_stats;
+using gatt_op_result = BtaGattQueue::gatt_op_result;
 
 constexpr uint8_t GATT_READ_CHAR = 1;
 constexpr uint8_t GATT_READ_DESC = 2;
 constexpr uint8_t GATT_WRITE_CHAR = 3;
 constexpr uint8_t GATT_WRITE_DESC = 4;
 
-struct gatt_read_op_data {
+struct gatt_read_op_cb {
   GATT_READ_OP_CB cb;
   void* cb_data;
 };
 
+struct gatt_read_op_data {
+  /* callbacks of all the queued reads served by this read */
+  std::vector<gatt_read_op_cb> callbacks;
+};
+
 std::unordered_map<uint16_t, std::list<gatt_operation>>
     BtaGattQueue::gatt_op_queue;
 std::unordered_set<uint16_t> BtaGattQueue::gatt_op_queue_executing;
+std::unordered_map<uint16_t, gatt_op_stats> BtaGattQueue::gatt_op_queue_stats;
+std::unordered_map<uint32_t, BtaGattQueue::gatt_batch>
+    BtaGattQueue::gatt_batches;
+std::unordered_map<uint32_t, BtaGattQueue::gatt_batch_op>
+    BtaGattQueue::gatt_batch_ops;
+uint32_t BtaGattQueue::gatt_batch_next_id = 1;
+uint32_t BtaGattQueue::gatt_batch_next_op_id = 1;
 
 void BtaGattQueue::mark_as_not_executing(uint16_t conn_id) {
   gatt_op_queue_executing.erase(conn_id);
@@ -44,20 +59,21 @@ void BtaGattQueue::gatt_read_op_finished(uint16_t conn_id, tGATT_STATUS status,
                                          uint16_t handle, uint16_t len,
                                          uint8_t* value, void* data) {
   gatt_read_op_data* tmp = (gatt_read_op_data*)data;
-  GATT_READ_OP_CB tmp_cb = tmp->cb;
-  void* tmp_cb_data = tmp->cb_data;
+  std::vector<gatt_read_op_cb> callbacks = std::move(tmp->callbacks);
 
-  APPL_TRACE_DEBUG("%s: conn_id=0x%x handle=%d status=%d len=%d", __func__,
-    conn_id, handle, status, len);
+  APPL_TRACE_DEBUG("%s: conn_id=0x%x handle=%d status=%d len=%d callbacks=%zu",
+                   __func__, conn_id, handle, status, len, callbacks.size());
 
-  osi_free(data);
+  delete tmp;
+
+  if (status == GATT_SUCCESS) gatt_op_queue_stats[conn_id].bytes_read += len;
 
   mark_as_not_executing(conn_id);
   gatt_execute_next_op(conn_id);
 
-  if (tmp_cb) {
-    tmp_cb(conn_id, status, handle, len, value, tmp_cb_data);
-    return;
+  for (const gatt_read_op_cb& read_cb : callbacks) {
+    if (read_cb.cb)
+      read_cb.cb(conn_id, status, handle, len, value, read_cb.cb_data);
   }
 }
 
@@ -110,30 +126,38 @@ void BtaGattQueue::gatt_execute_next_op(uint16_t conn_id) {
   std::list<gatt_operation>& gatt_ops = map_ptr->second;
 
   gatt_operation& op = gatt_ops.front();
+  gatt_op_stats& stats = gatt_op_queue_stats[conn_id];
+  stats.ops_executed++;
 
   APPL_TRACE_DEBUG("%s: op.type=%d, handle=%d", __func__, op.type,
     op.handle);
-  if (op.type == GATT_READ_CHAR) {
-    gatt_read_op_data* data =
-        (gatt_read_op_data*)osi_malloc(sizeof(gatt_read_op_data));
-    data->cb = op.read_cb;
-    data->cb_data = op.read_cb_data;
-    BTA_GATTC_ReadCharacteristic(conn_id, op.handle, GATT_AUTH_REQ_NONE,
-                                 gatt_read_op_finished, data);
-
-  } else if (op.type == GATT_READ_DESC) {
-    gatt_read_op_data* data =
-        (gatt_read_op_data*)osi_malloc(sizeof(gatt_read_op_data));
-    data->cb = op.read_cb;
-    data->cb_data = op.read_cb_data;
-    BTA_GATTC_ReadCharDescr(conn_id, op.handle, GATT_AUTH_REQ_NONE,
-                            gatt_read_op_finished, data);
+  if (op.type == GATT_READ_CHAR || op.type == GATT_READ_DESC) {
+    gatt_read_op_data* data = new gatt_read_op_data;
+    data->callbacks.push_back({op.read_cb, op.read_cb_data});
+
+    /* Serve the following reads of the same attribute with this read, there
+     * is no write in between that could change the value */
+    auto next = std::next(gatt_ops.begin());
+    while (next != gatt_ops.end() && next->type == op.type &&
+           next->handle == op.handle) {
+      data->callbacks.push_back({next->read_cb, next->read_cb_data});
+      next = gatt_ops.erase(next);
+      stats.reads_coalesced++;
+    }
+
+    if (op.type == GATT_READ_CHAR)
+      BTA_GATTC_ReadCharacteristic(conn_id, op.handle, GATT_AUTH_REQ_NONE,
+                                   gatt_read_op_finished, data);
+    else
+      BTA_GATTC_ReadCharDescr(conn_id, op.handle, GATT_AUTH_REQ_NONE,
+                              gatt_read_op_finished, data);
 
   } else if (op.type == GATT_WRITE_CHAR) {
     gatt_write_op_data* data =
         (gatt_write_op_data*)osi_malloc(sizeof(gatt_write_op_data));
     data->cb = op.write_cb;
     data->cb_data = op.write_cb_data;
+    stats.bytes_written += op.value.size();
     BTA_GATTC_WriteCharValue(conn_id, op.handle, op.write_type,
                              std::move(op.value), GATT_AUTH_REQ_NONE,
                              gatt_write_op_finished, data);
@@ -143,6 +167,7 @@ void BtaGattQueue::gatt_execute_next_op(uint16_t conn_id) {
         (gatt_write_op_data*)osi_malloc(sizeof(gatt_write_op_data));
     data->cb = op.write_cb;
     data->cb_data = op.write_cb_data;
+    stats.bytes_written += op.value.size();
     BTA_GATTC_WriteCharDescr(conn_id, op.handle, std::move(op.value),
                              GATT_AUTH_REQ_NONE, gatt_write_op_finished, data);
   }
@@ -153,8 +178,35 @@ void BtaGattQueue::gatt_execute_next_op(uint16_t conn_id) {
 void BtaGattQueue::Clean(uint16_t conn_id) {
   APPL_TRACE_DEBUG("%s: conn_id=0x%x", __func__, conn_id);
 
+  auto stats = gatt_op_queue_stats.find(conn_id);
+  if (stats != gatt_op_queue_stats.end()) {
+    APPL_TRACE_DEBUG(
+        "%s: conn_id=0x%x ops=%u coalesced reads=%u read=%llu written=%llu "
+        "bytes",
+        __func__, conn_id, stats->second.ops_executed,
+        stats->second.reads_coalesced,
+        (unsigned long long)stats->second.bytes_read,
+        (unsigned long long)stats->second.bytes_written);
+    gatt_op_queue_stats.erase(stats);
+  }
+
   gatt_op_queue.erase(conn_id);
   gatt_op_queue_executing.erase(conn_id);
+
+  /* An operation in progress may still complete, it is then ignored */
+  for (auto op = gatt_batch_ops.begin(); op != gatt_batch_ops.end();) {
+    auto batch = gatt_batches.find(op->second.batch_id);
+    if (batch == gatt_batches.end() || batch->second.conn_id == conn_id)
+      op = gatt_batch_ops.erase(op);
+    else
+      op++;
+  }
+  for (auto batch = gatt_batches.begin(); batch != gatt_batches.end();) {
+    if (batch->second.conn_id == conn_id)
+      batch = gatt_batches.erase(batch);
+    else
+      batch++;
+  }
 }
 
 void BtaGattQueue::ReadCharacteristic(uint16_t conn_id, uint16_t handle,
@@ -200,3 +252,115 @@ void BtaGattQueue::WriteDescriptor(uint16_t conn_id, uint16_t handle,
                                     .value = std::move(value)});
   gatt_execute_next_op(conn_id);
 }
+
+void* BtaGattQueue::batch_add_op(uint16_t conn_id, uint32_t batch_id,
+                                 uint16_t handle, size_t* index) {
+  /* Recreated if the connection was cleaned since the batch was created */
+  gatt_batch& batch = gatt_batches[batch_id];
+  batch.conn_id = conn_id;
+  *index = batch.results.size();
+  batch.results.push_back({.status = GATT_ERROR, .handle = handle});
+  batch.pending++;
+
+  uint32_t op_id = gatt_batch_next_op_id++;
+  gatt_batch_ops[op_id] = {.batch_id = batch_id, .index = *index};
+  return (void*)(uintptr_t)op_id;
+}
+
+void BtaGattQueue::batch_read_op_finished(uint16_t conn_id,
+                                          tGATT_STATUS status, uint16_t handle,
+                                          uint16_t len, uint8_t* value,
+                                          void* data) {
+  auto op = gatt_batch_ops.find((uint32_t)(uintptr_t)data);
+  if (op == gatt_batch_ops.end()) return;
+
+  uint32_t batch_id = op->second.batch_id;
+  gatt_batch& batch = gatt_batches[batch_id];
+  gatt_op_result& result = batch.results[op->second.index];
+  result.status = status;
+  if (status == GATT_SUCCESS && value != NULL)
+    result.value.assign(value, value + len);
+  gatt_batch_ops.erase(op);
+
+  batch.pending--;
+  batch_complete_if_done(batch_id);
+}
+
+void BtaGattQueue::batch_write_op_finished(uint16_t conn_id,
+                                           tGATT_STATUS status,
+                                           uint16_t handle, void* data) {
+  batch_read_op_finished(conn_id, status, handle, 0, NULL, data);
+}
+
+void BtaGattQueue::batch_complete_if_done(uint32_t batch_id) {
+  auto it = gatt_batches.find(batch_id);
+  if (it == gatt_batches.end()) return;
+  if (!it->second.joined || it->second.pending != 0) return;
+
+  gatt_batch batch = std::move(it->second);
+  gatt_batches.erase(it);
+
+  APPL_TRACE_DEBUG("%s: conn_id=0x%x batch=%u ops=%zu", __func__,
+                   batch.conn_id, batch_id, batch.results.size());
+  if (batch.cb) batch.cb(batch.conn_id, batch.results, batch.cb_data);
+}
+
+BtaGattQueue::Batch::Batch(uint16_t conn_id)
+    : conn_id_(conn_id), batch_id_(gatt_batch_next_id++), joined_(false) {
+  gatt_batches[batch_id_].conn_id = conn_id;
+}
+
+BtaGattQueue::Batch::~Batch() {
+  if (!joined_) Join(nullptr, nullptr);
+}
+
+size_t BtaGattQueue::Batch::ReadCharacteristic(uint16_t handle) {
+  CHECK(!joined_);
+  size_t index;
+  void* data = batch_add_op(conn_id_, batch_id_, handle, &index);
+  BtaGattQueue::ReadCharacteristic(conn_id_, handle, batch_read_op_finished,
+                                   data);
+  return index;
+}
+
+size_t BtaGattQueue::Batch::ReadDescriptor(uint16_t handle) {
+  CHECK(!joined_);
+  size_t index;
+  void* data = batch_add_op(conn_id_, batch_id_, handle, &index);
+  BtaGattQueue::ReadDescriptor(conn_id_, handle, batch_read_op_finished, data);
+  return index;
+}
+
+size_t BtaGattQueue::Batch::WriteCharacteristic(uint16_t handle,
+                                                std::vector<uint8_t> value,
+                                                tGATT_WRITE_TYPE write_type) {
+  CHECK(!joined_);
+  size_t index;
+  void* data = batch_add_op(conn_id_, batch_id_, handle, &index);
+  BtaGattQueue::WriteCharacteristic(conn_id_, handle, std::move(value),
+                                    write_type, batch_write_op_finished, data);
+  return index;
+}
+
+size_t BtaGattQueue::Batch::WriteDescriptor(uint16_t handle,
+                                            std::vector<uint8_t> value,
+                                            tGATT_WRITE_TYPE write_type) {
+  CHECK(!joined_);
+  size_t index;
+  void* data = batch_add_op(conn_id_, batch_id_, handle, &index);
+  BtaGattQueue::WriteDescriptor(conn_id_, handle, std::move(value), write_type,
+                                batch_write_op_finished, data);
+  return index;
+}
+
+void BtaGattQueue::Batch::Join(GATT_BATCH_CB cb, void* cb_data) {
+  CHECK(!joined_);
+  joined_ = true;
+
+  auto it = gatt_batches.find(batch_id_);
+  if (it == gatt_batches.end()) return;
+  it->second.joined = true;
+  it->second.cb = cb;
+  it->second.cb_data = cb_data;
+  batch_complete_if_done(batch_id_);
+}
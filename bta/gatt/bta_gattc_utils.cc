@@ -35,6 +35,10 @@
 #include "l2c_api.h"
 #include "utl.h"
 
+static void bta_gattc_srcb_trim(void);
+static void bta_gattc_srcb_use(tBTA_GATTC_SERV* p_srcb);
+static void bta_gattc_srcb_keep_database(tBTA_GATTC_SERV* p_srcb);
+
 /*******************************************************************************
  *
  * Function         bta_gattc_cl_get_regcb
@@ -142,6 +146,8 @@ tBTA_GATTC_CLCB* bta_gattc_clcb_alloc(tGATT_IF client_if,
       p_clcb->p_srcb = bta_gattc_find_srcb(remote_bda);
       if (p_clcb->p_srcb == NULL)
         p_clcb->p_srcb = bta_gattc_srcb_alloc(remote_bda);
+      else
+        bta_gattc_srcb_use(p_clcb->p_srcb);
 
       if (p_clcb->p_rcb != NULL && p_clcb->p_srcb != NULL) {
         p_clcb->p_srcb->num_clcb++;
@@ -199,18 +205,60 @@ void bta_gattc_clcb_dealloc(tBTA_GATTC_CLCB* p_clcb) {
 
   /* if the srcb is no longer needed, reset the state */
   if (p_srcb->num_clcb == 0) {
+    bool complete = (p_srcb->state == BTA_GATTC_SERV_IDLE);
     p_srcb->connected = false;
     p_srcb->state = BTA_GATTC_SERV_IDLE;
     p_srcb->mtu = 0;
 
-    // clear reallocating
-    p_srcb->gatt_database.Clear();
+    /* a database only partly loaded or discovered is not kept */
+    if (complete) {
+      bta_gattc_srcb_keep_database(p_srcb);
+    } else {
+      // clear reallocating
+      p_srcb->gatt_database.Clear();
+    }
   }
 
   osi_free_and_reset((void**)&p_clcb->p_q_cmd);
   memset(p_clcb, 0, sizeof(tBTA_GATTC_CLCB));
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_gattc_srcb_trim
+ *
+ * Description      drop the kept databases of the least recently used
+ *                  disconnected servers over BTA_GATTC_CACHE_MEM_BUDGET, and
+ *                  forget the disconnected servers without one over
+ *                  BTA_GATTC_KNOWN_SR_MAX
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_gattc_srcb_trim(void) {
+  std::list<tBTA_GATTC_SERV>& known = bta_gattc_cb.known_server;
+  tBTA_GATTC_CACHE_STATS* p_stats = &bta_gattc_cb.cache_stats;
+  size_t count = known.size();
+
+  auto it = known.end();
+  while (it != known.begin()) {
+    it--;
+    if (it->connected || it->num_clcb != 0) continue;
+
+    if (p_stats->memory_usage > BTA_GATTC_CACHE_MEM_BUDGET &&
+        !it->idle_database.IsEmpty()) {
+      bta_gattc_srcb_clear_idle_database(&*it);
+      p_stats->evictions++;
+    }
+
+    if (count > BTA_GATTC_KNOWN_SR_MAX && it->idle_database.IsEmpty()) {
+      it->pending_discovery.Clear();
+      it = known.erase(it);
+      count--;
+    }
+  }
+}
+
 /*******************************************************************************
  *
  * Function         bta_gattc_find_srcb
@@ -221,11 +269,8 @@ void bta_gattc_clcb_dealloc(tBTA_GATTC_CLCB* p_clcb) {
  *
  ******************************************************************************/
 tBTA_GATTC_SERV* bta_gattc_find_srcb(const RawAddress& bda) {
-  tBTA_GATTC_SERV* p_srcb = &bta_gattc_cb.known_server[0];
-  uint8_t i;
-
-  for (i = 0; i < BTA_GATTC_KNOWN_SR_MAX; i++, p_srcb++) {
-    if (p_srcb->in_use && p_srcb->server_bda == bda) return p_srcb;
+  for (tBTA_GATTC_SERV& srcb : bta_gattc_cb.known_server) {
+    if (srcb.in_use && srcb.server_bda == bda) return &srcb;
   }
   return NULL;
 }
@@ -240,11 +285,8 @@ tBTA_GATTC_SERV* bta_gattc_find_srcb(const RawAddress& bda) {
  *
  ******************************************************************************/
 tBTA_GATTC_SERV* bta_gattc_find_srvr_cache(const RawAddress& bda) {
-  tBTA_GATTC_SERV* p_srcb = &bta_gattc_cb.known_server[0];
-  uint8_t i;
-
-  for (i = 0; i < BTA_GATTC_KNOWN_SR_MAX; i++, p_srcb++) {
-    if (p_srcb->server_bda == bda) return p_srcb;
+  for (tBTA_GATTC_SERV& srcb : bta_gattc_cb.known_server) {
+    if (srcb.server_bda == bda) return &srcb;
   }
   return NULL;
 }
@@ -275,35 +317,101 @@ tBTA_GATTC_SERV* bta_gattc_find_scb_by_cid(uint16_t conn_id) {
  *
  ******************************************************************************/
 tBTA_GATTC_SERV* bta_gattc_srcb_alloc(const RawAddress& bda) {
-  tBTA_GATTC_SERV *p_tcb = &bta_gattc_cb.known_server[0], *p_recycle = NULL;
-  bool found = false;
-  uint8_t i;
+  bta_gattc_srcb_trim();
 
-  for (i = 0; i < BTA_GATTC_KNOWN_SR_MAX; i++, p_tcb++) {
-    if (!p_tcb->in_use) {
-      found = true;
-      break;
-    } else if (!p_tcb->connected) {
-      p_recycle = p_tcb;
-    }
+  bta_gattc_cb.known_server.emplace_front();
+  tBTA_GATTC_SERV* p_tcb = &bta_gattc_cb.known_server.front();
+  p_tcb->in_use = true;
+  p_tcb->server_bda = bda;
+  return p_tcb;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_srcb_use
+ *
+ * Description      make a server cache control block the most recently used
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_gattc_srcb_use(tBTA_GATTC_SERV* p_srcb) {
+  std::list<tBTA_GATTC_SERV>& known = bta_gattc_cb.known_server;
+  for (auto it = known.begin(); it != known.end(); it++) {
+    if (&*it != p_srcb) continue;
+    known.splice(known.begin(), known, it);
+    return;
   }
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_srcb_clear_idle_database
+ *
+ * Description      drop the database kept since the server disconnected
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_gattc_srcb_clear_idle_database(tBTA_GATTC_SERV* p_srcb) {
+  bta_gattc_cb.cache_stats.memory_usage -= p_srcb->idle_database_size;
+  p_srcb->idle_database_size = 0;
+  p_srcb->idle_database.Clear();
+}
 
-  /* if not found, try to recycle one known device */
-  if (!found && !p_recycle)
-    p_tcb = NULL;
-  else if (!found && p_recycle)
-    p_tcb = p_recycle;
+/*******************************************************************************
+ *
+ * Function         bta_gattc_srcb_reuse_database
+ *
+ * Description      use the database kept since the server disconnected, if
+ *                  it was kept with the Database Hash |p_hash|, or without a
+ *                  hash if |p_hash| is NULL. The kept database is dropped
+ *                  otherwise.
+ *
+ * Returns          true if the database was reused, false otherwise
+ *
+ ******************************************************************************/
+bool bta_gattc_srcb_reuse_database(tBTA_GATTC_SERV* p_srcb,
+                                   const uint8_t* p_hash) {
+  bool match = !p_srcb->idle_database.IsEmpty();
+  if (p_hash == NULL)
+    match = match && !p_srcb->idle_has_database_hash;
+  else
+    match = match && p_srcb->idle_has_database_hash &&
+            memcmp(p_srcb->idle_database_hash, p_hash,
+                   BTA_GATTC_DATABASE_HASH_LEN) == 0;
 
-  if (p_tcb != NULL) {
-    // clear reallocating
-    p_tcb->gatt_database.Clear();
-    p_tcb->pending_discovery.Clear();
-    *p_tcb = tBTA_GATTC_SERV();
+  if (match) {
+    p_srcb->gatt_database = std::move(p_srcb->idle_database);
+    bta_gattc_cb.cache_stats.memory_hits++;
+  }
+  bta_gattc_srcb_clear_idle_database(p_srcb);
+  return match;
+}
 
-    p_tcb->in_use = true;
-    p_tcb->server_bda = bda;
+/*******************************************************************************
+ *
+ * Function         bta_gattc_srcb_keep_database
+ *
+ * Description      keep the database of a server that disconnected in
+ *                  memory, for its next connection
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_gattc_srcb_keep_database(tBTA_GATTC_SERV* p_srcb) {
+  bta_gattc_srcb_clear_idle_database(p_srcb);
+  if (!p_srcb->gatt_database.IsEmpty()) {
+    p_srcb->idle_database = std::move(p_srcb->gatt_database);
+    p_srcb->idle_database_size = p_srcb->idle_database.MemoryUsage();
+    p_srcb->idle_has_database_hash = p_srcb->has_database_hash;
+    memcpy(p_srcb->idle_database_hash, p_srcb->database_hash,
+           BTA_GATTC_DATABASE_HASH_LEN);
+    bta_gattc_cb.cache_stats.memory_usage += p_srcb->idle_database_size;
   }
-  return p_tcb;
+  p_srcb->gatt_database.Clear();
+
+  bta_gattc_srcb_trim();
 }
 /*******************************************************************************
  *
@@ -21,6 +21,7 @@
 #include "stack/include/gattdefs.h"
 
 #include <base/logging.h>
+#include <algorithm>
 #include <memory>
 #include <sstream>
 
@@ -48,6 +49,95 @@ Service* FindService(std::vector<Service>& services, uint16_t handle) {
   return nullptr;
 }
 
+void Database::BuildIndex() {
+  std::vector<Attribute> index;
+
+  for (size_t s = 0; s < services.size(); s++) {
+    const std::vector<Characteristic>& chars = services[s].characteristics;
+    for (size_t c = 0; c < chars.size(); c++) {
+      index.push_back({chars[c].value_handle, (uint16_t)s, (uint16_t)c, VALUE});
+      for (size_t d = 0; d < chars[c].descriptors.size(); d++) {
+        index.push_back({chars[c].descriptors[d].handle, (uint16_t)s,
+                         (uint16_t)c, (uint16_t)d});
+      }
+    }
+  }
+
+  // A misbehaving remote may report the same handle twice; keep discovery
+  // order among equal handles, so the first one wins like in a linear search
+  std::stable_sort(index.begin(), index.end(),
+                   [](const Attribute& a, const Attribute& b) {
+                     return a.handle < b.handle;
+                   });
+  attributes.swap(index);
+}
+
+const Database::Attribute* Database::FindAttribute(uint16_t handle,
+                                                   bool is_descriptor) const {
+  auto it = std::lower_bound(
+      attributes.begin(), attributes.end(), handle,
+      [](const Attribute& a, uint16_t handle) { return a.handle < handle; });
+
+  for (; it != attributes.end() && it->handle == handle; it++) {
+    if ((it->descriptor != VALUE) == is_descriptor) return &(*it);
+  }
+
+  return nullptr;
+}
+
+const Service* Database::FindService(uint16_t handle) const {
+  // services are sorted by handle and do not overlap
+  auto it = std::upper_bound(
+      services.begin(), services.end(), handle,
+      [](uint16_t handle, const Service& s) { return handle < s.handle; });
+  if (it == services.begin()) return nullptr;
+
+  it--;
+  return HandleInRange(*it, handle) ? &(*it) : nullptr;
+}
+
+const Characteristic* Database::FindCharacteristic(
+    uint16_t value_handle) const {
+  const Attribute* attr = FindAttribute(value_handle, false);
+  if (!attr) return nullptr;
+
+  return &CharacteristicAt(*attr);
+}
+
+const Descriptor* Database::FindDescriptor(uint16_t handle) const {
+  const Attribute* attr = FindAttribute(handle, true);
+  if (!attr) return nullptr;
+
+  return &CharacteristicAt(*attr).descriptors[attr->descriptor];
+}
+
+const Characteristic* Database::FindOwningCharacteristic(
+    uint16_t handle) const {
+  const Attribute* attr = FindAttribute(handle, true);
+  if (!attr) return nullptr;
+
+  return &CharacteristicAt(*attr);
+}
+
+void Database::ReplaceRange(uint16_t start, uint16_t end,
+                            const Database& other) {
+  auto in_range = [start, end](const Service& svc) {
+    return svc.handle >= start && svc.handle <= end;
+  };
+
+  services.erase(std::remove_if(services.begin(), services.end(), in_range),
+                 services.end());
+  for (const Service& service : other.services) {
+    if (in_range(service)) services.push_back(service);
+  }
+  std::sort(services.begin(), services.end(),
+            [](const Service& a, const Service& b) {
+              return a.handle < b.handle;
+            });
+
+  BuildIndex();
+}
+
 std::string Database::ToString() const {
   std::stringstream tmp;
 
@@ -78,6 +168,18 @@ std::string Database::ToString() const {
   return tmp.str();
 }
 
+size_t Database::MemoryUsage() const {
+  size_t size = services.capacity() * sizeof(Service) +
+                attributes.capacity() * sizeof(Attribute);
+  for (const Service& service : services) {
+    size += service.included_services.capacity() * sizeof(IncludedService) +
+            service.characteristics.capacity() * sizeof(Characteristic);
+    for (const Characteristic& c : service.characteristics)
+      size += c.descriptors.capacity() * sizeof(Descriptor);
+  }
+  return size;
+}
+
 std::vector<StoredAttribute> Database::Serialize() const {
   std::vector<StoredAttribute> nv_attr;
 
@@ -119,11 +221,17 @@ std::vector<StoredAttribute> Database::Serialize() const {
 
 Database Database::Deserialize(const std::vector<StoredAttribute>& nv_attr,
                                bool* success) {
+  return Deserialize(nv_attr.data(), nv_attr.size(), success);
+}
+
+Database Database::Deserialize(const StoredAttribute* nv_attr, size_t count,
+                               bool* success) {
   // clear reallocating
   Database result;
-  auto it = nv_attr.cbegin();
+  const StoredAttribute* it = nv_attr;
+  const StoredAttribute* end = nv_attr + count;
 
-  for (; it != nv_attr.cend(); ++it) {
+  for (; it != end; ++it) {
     const auto& attr = *it;
     if (attr.type != PRIMARY_SERVICE && attr.type != SECONDARY_SERVICE) break;
     result.services.emplace_back(
@@ -134,7 +242,7 @@ Database Database::Deserialize(const std::vector<StoredAttribute>& nv_attr,
   }
 
   auto current_service_it = result.services.begin();
-  for (; it != nv_attr.cend(); it++) {
+  for (; it != end; it++) {
     const auto& attr = *it;
 
     // go to the service this attribute belongs to; attributes are stored in
@@ -153,8 +261,8 @@ Database Database::Deserialize(const std::vector<StoredAttribute>& nv_attr,
     }
 
     if (attr.type == INCLUDE) {
-      Service* included_service =
-          FindService(result.services, attr.value.included_service.handle);
+      const Service* included_service =
+          result.FindService(attr.value.included_service.handle);
       if (!included_service) {
         LOG(ERROR) << __func__ << ": Non-existing included service!";
         *success = false;
@@ -178,6 +286,7 @@ Database Database::Deserialize(const std::vector<StoredAttribute>& nv_attr,
           Descriptor{.handle = attr.handle, .uuid = attr.type});
     }
   }
+  result.BuildIndex();
   *success = true;
   return result;
 }
@@ -101,22 +101,75 @@ class Database {
 
   /* Clear the GATT database. This method forces relocation to ensure no extra
    * space is used unnecesarly */
-  void Clear() { std::vector<Service>().swap(services); }
+  void Clear() {
+    std::vector<Service>().swap(services);
+    std::vector<Attribute>().swap(attributes);
+  }
 
   /* Return list of services available in this database */
   const std::vector<Service>& Services() const { return services; }
 
+  /* Return the service that contains |handle|, or nullptr */
+  const Service* FindService(uint16_t handle) const;
+
+  /* Return the characteristic whose value handle is |value_handle|, or
+   * nullptr */
+  const Characteristic* FindCharacteristic(uint16_t value_handle) const;
+
+  /* Return the descriptor with |handle|, or nullptr */
+  const Descriptor* FindDescriptor(uint16_t handle) const;
+
+  /* Return the characteristic that owns the descriptor with |handle|, or
+   * nullptr */
+  const Characteristic* FindOwningCharacteristic(uint16_t handle) const;
+
   std::string ToString() const;
 
+  /* Replace the services starting in the |start| to |end| handle range with
+   * the services of |other| starting in that range, such as the result of a
+   * discovery of that range only */
+  void ReplaceRange(uint16_t start, uint16_t end, const Database& other);
+
+  /* Return the heap memory held by this database, in bytes */
+  size_t MemoryUsage() const;
+
   std::vector<gatt::StoredAttribute> Serialize() const;
 
   static Database Deserialize(const std::vector<gatt::StoredAttribute>& nv_attr,
                               bool* success);
 
+  /* Same as above, for |count| attributes stored at |nv_attr|, such as a
+   * mapped cache file */
+  static Database Deserialize(const gatt::StoredAttribute* nv_attr,
+                              size_t count, bool* success);
+
   friend class DatabaseBuilder;
 
  private:
+  /* Entry of the handle lookup index, pointing at a characteristic value or a
+   * descriptor by position, so that it stays valid when the database is
+   * copied */
+  struct Attribute {
+    uint16_t handle;
+    uint16_t service;        /* position in services */
+    uint16_t characteristic; /* position in Service::characteristics */
+    uint16_t descriptor;     /* position in Characteristic::descriptors, or
+                                VALUE for the characteristic value */
+  };
+  static constexpr uint16_t VALUE = 0xffff;
+
+  /* Rebuild the handle lookup index. Must be called once the services are
+   * complete, services must not change afterwards. */
+  void BuildIndex();
+
+  const Attribute* FindAttribute(uint16_t handle, bool is_descriptor) const;
+  const Characteristic& CharacteristicAt(const Attribute& attr) const {
+    return services[attr.service].characteristics[attr.characteristic];
+  }
+
   std::vector<Service> services;
+  /* characteristic values and descriptors, sorted by handle */
+  std::vector<Attribute> attributes;
 };
 
 /* Find a service that should contain handle. Helper method for internal use
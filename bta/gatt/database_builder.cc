@@ -51,7 +51,8 @@ void DatabaseBuilder::AddService(uint16_t handle, uint16_t end_handle,
                             .uuid = uuid});
   }
 
-  services_to_discover.insert({handle, end_handle});
+  // The whole database is explored at once, there is no service left
+  if (!exploring_database) services_to_discover.insert({handle, end_handle});
 }
 
 void DatabaseBuilder::AddIncludedService(uint16_t handle, const Uuid& uuid,
@@ -59,22 +60,43 @@ void DatabaseBuilder::AddIncludedService(uint16_t handle, const Uuid& uuid,
                                          uint16_t end_handle) {
   Service* service = FindService(database.services, handle);
   if (!service) {
+    /* When exploring all the services at once, the definition might be in a
+     * secondary service that a later definition includes */
+    if (exploring_database) {
+      pending_included_services.push_back(IncludedService{
+          .handle = handle,
+          .uuid = uuid,
+          .start_handle = start_handle,
+          .end_handle = end_handle,
+      });
+      return;
+    }
     LOG(ERROR) << "Illegal action to add to non-existing service!";
     return;
   }
 
-  /* We discover all Primary Services first. If included service was not seen
-   * before, it must be a Secondary Service */
-  if (!FindService(database.services, start_handle)) {
-    AddService(start_handle, end_handle, uuid, false /* not primary */);
-  }
-
   service->included_services.push_back(IncludedService{
       .handle = handle,
       .uuid = uuid,
       .start_handle = start_handle,
       .end_handle = end_handle,
   });
+
+  /* We discover all Primary Services first. If included service was not seen
+   * before, it must be a Secondary Service */
+  if (!FindService(database.services, start_handle)) {
+    AddService(start_handle, end_handle, uuid, false /* not primary */);
+    AddPendingIncludedServices();
+  }
+}
+
+void DatabaseBuilder::AddPendingIncludedServices() {
+  std::vector<IncludedService> pending;
+  pending.swap(pending_included_services);
+  for (const IncludedService& included : pending) {
+    AddIncludedService(included.handle, included.uuid, included.start_handle,
+                       included.end_handle);
+  }
 }
 
 void DatabaseBuilder::AddCharacteristic(uint16_t handle, uint16_t value_handle,
@@ -137,37 +159,50 @@ bool DatabaseBuilder::StartNextServiceExploration() {
   return false;
 }
 
+bool DatabaseBuilder::StartDatabaseExploration(uint16_t start, uint16_t end) {
+  if (database.services.empty()) return false;
+
+  services_to_discover.clear();
+  exploring_database = true;
+  pending_service = {start, end};
+  pending_characteristic = HANDLE_MIN;
+  return true;
+}
+
 const std::pair<uint16_t, uint16_t>&
 DatabaseBuilder::CurrentlyExploredService() {
   return pending_service;
 }
 
 std::pair<uint16_t, uint16_t> DatabaseBuilder::NextDescriptorRangeToExplore() {
-  Service* service = FindService(database.services, pending_service.first);
-  if (!service || service->characteristics.empty()) {
-    return {HANDLE_MAX, HANDLE_MAX};
-  }
-
-  for (auto it = service->characteristics.cbegin();
-       it != service->characteristics.cend(); it++) {
-    if (it->declaration_handle > pending_characteristic) {
-      auto next = std::next(it);
-
-      /* Characteristic Declaration is followed by Characteristic Value
-       * Declaration, first descriptor is after that, see BT Spect 5.0 Vol 3,
-       * Part G 3.3.2 and 3.3.3 */
-      uint16_t start = it->declaration_handle + 2;
-      uint16_t end;
-      if (next != service->characteristics.end())
-        end = next->declaration_handle - 1;
-      else
-        end = service->end_handle;
-
-      // No place for descriptor - skip to next characteristic
-      if (start > end) continue;
-
-      pending_characteristic = start;
-      return {start, end};
+  // Every service in the explored range, all of them when exploring the whole
+  // database
+  for (const Service& service : database.services) {
+    if (service.handle < pending_service.first ||
+        service.handle > pending_service.second)
+      continue;
+
+    for (auto it = service.characteristics.cbegin();
+         it != service.characteristics.cend(); it++) {
+      if (it->declaration_handle > pending_characteristic) {
+        auto next = std::next(it);
+
+        /* Characteristic Declaration is followed by Characteristic Value
+         * Declaration, first descriptor is after that, see BT Spect 5.0 Vol 3,
+         * Part G 3.3.2 and 3.3.3 */
+        uint16_t start = it->declaration_handle + 2;
+        uint16_t end;
+        if (next != service.characteristics.end())
+          end = next->declaration_handle - 1;
+        else
+          end = service.end_handle;
+
+        // No place for descriptor - skip to next characteristic
+        if (start > end) continue;
+
+        pending_characteristic = start;
+        return {start, end};
+      }
     }
   }
 
@@ -178,12 +213,21 @@ std::pair<uint16_t, uint16_t> DatabaseBuilder::NextDescriptorRangeToExplore() {
 bool DatabaseBuilder::InProgress() const { return !database.services.empty(); }
 
 Database DatabaseBuilder::Build() {
+  if (!pending_included_services.empty())
+    LOG(ERROR) << __func__ << ": " << pending_included_services.size()
+               << " included services outside of any service dropped";
+
   Database tmp = database;
-  database.Clear();
+  tmp.BuildIndex();
+  Clear();
   return tmp;
 }
 
-void DatabaseBuilder::Clear() { database.Clear(); }
+void DatabaseBuilder::Clear() {
+  database.Clear();
+  exploring_database = false;
+  pending_included_services.clear();
+}
 
 std::string DatabaseBuilder::ToString() const { return database.ToString(); }
 
@@ -42,6 +42,16 @@ class DatabaseBuilder {
    * more services to explore. */
   bool StartNextServiceExploration();
 
+  /* Starts the exploration of all the services at once, returns false if
+   * there is no service to explore. The included services and the
+   * characteristics are then discovered on the whole handle range returned by
+   * CurrentlyExploredService(), saving the requests ending the discovery of
+   * each service, and the descriptors are explored service after service.
+   * Only the services starting in the |start| to |end| handle range are
+   * explored, when only that range is discovered again. */
+  bool StartDatabaseExploration(uint16_t start = HANDLE_MIN,
+                                uint16_t end = HANDLE_MAX);
+
   /* Return pair with start and end handle of the currently explored service.
    */
   const std::pair<uint16_t, uint16_t>& CurrentlyExploredService();
@@ -79,6 +89,14 @@ class DatabaseBuilder {
   /* sorted, unique set of start_handle, end_handle pair of all services that
    * have not yet been discovered */
   std::set<std::pair<uint16_t, uint16_t>> services_to_discover;
+
+  /* True when all the services are explored at once */
+  bool exploring_database = false;
+  /* Included services found while exploring all the services, in a secondary
+   * service not known yet */
+  std::vector<IncludedService> pending_included_services;
+
+  void AddPendingIncludedServices();
 };
 
 }  // namespace gatt
@@ -27,13 +27,16 @@
 
 #if defined(BTA_HD_INCLUDED) && (BTA_HD_INCLUDED == TRUE)
 
+#include <base/bind.h>
 #include <log/log.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "bta_closure_api.h"
 #include "bta_hd_api.h"
 #include "bta_hd_int.h"
+#include "osi/include/time.h"
 
 /*****************************************************************************
  *  Constants
@@ -193,6 +196,60 @@ extern void BTA_HdSendReport(tBTA_HD_REPORT* p_report) {
   bta_sys_sendmsg(p_buf);
 }
 
+/*******************************************************************************
+ *
+ * Function         BTA_HdSendInputReport
+ *
+ * Description      This function is called when input report is to be sent on
+ *                  the interrupt channel
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTA_HdSendInputReport(uint8_t id, uint16_t len, const uint8_t* p_data) {
+  APPL_TRACE_VERBOSE("%s", __func__);
+
+  if (len > BTA_HD_REPORT_LEN) {
+    APPL_TRACE_WARNING(
+        "%s, report len (%d) > MTU len (%d), can't send report."
+        " Increase value of HID_DEV_MTU_SIZE to send larger reports",
+        __func__, len, BTA_HD_REPORT_LEN);
+    return;
+  }
+
+  /* laid out for L2CAP, in a buffer of the allocator pools */
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc(HID_INTERRUPT_BUF_SIZE);
+  p_buf->offset = HID_DEV_INPUT_REPORT_OFFSET;
+  p_buf->len = len;
+  p_buf->layer_specific = id;
+  memcpy((uint8_t*)(p_buf + 1) + p_buf->offset, p_data, len);
+
+  do_in_bta_thread(FROM_HERE, base::Bind(&bta_hd_send_input_report, p_buf,
+                                         time_get_os_boottime_us()));
+}
+
+/*******************************************************************************
+ *
+ * Function         BTA_HdDumpStatistics
+ *
+ * Description      Dump the statistics of the input reports sent
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTA_HdDumpStatistics(int fd) {
+  const tHID_DEV_RPT_STATS* p_stats = HID_DevGetReportStats();
+
+  dprintf(fd, "\nHID Device input reports:\n");
+  if (p_stats->count == 0) return;
+
+  dprintf(fd, "  Reports (sent/coalesced/dropped): %zu / %zu / %zu\n",
+          p_stats->count, p_stats->coalesced_count, p_stats->dropped_count);
+  dprintf(fd, "  Send latency (avg/max): %llu / %llu us\n",
+          (unsigned long long)(p_stats->total_latency_us / p_stats->count),
+          (unsigned long long)p_stats->max_latency_us);
+}
+
 /*******************************************************************************
  *
  * Function         BTA_HdVirtualCableUnplug
@@ -164,6 +164,7 @@ extern void bta_hd_disconnect_act(tBTA_HD_DATA* p_data);
 extern void bta_hd_add_device_act(tBTA_HD_DATA* p_data);
 extern void bta_hd_remove_device_act(tBTA_HD_DATA* p_data);
 extern void bta_hd_send_report_act(tBTA_HD_DATA* p_data);
+extern void bta_hd_send_input_report(BT_HDR* p_buf, uint64_t timestamp_us);
 extern void bta_hd_report_error_act(tBTA_HD_DATA* p_data);
 extern void bta_hd_vc_unplug_act(tBTA_HD_DATA* p_data);
 
@@ -304,6 +304,40 @@ bool bta_hd_hdl_event(BT_HDR* p_msg) {
   return (TRUE);
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_hd_send_input_report
+ *
+ * Description      Sends input report of BTA_HdSendInputReport, outside of the
+ *                  state machine. Reports are sent in the states handling
+ *                  BTA_HD_API_SEND_REPORT_EVT.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_hd_send_input_report(BT_HDR* p_buf, uint64_t timestamp_us) {
+  uint8_t report_id;
+
+  APPL_TRACE_VERBOSE("%s", __func__);
+
+  if (bta_hd_cb.state != BTA_HD_IDLE_ST && bta_hd_cb.state != BTA_HD_CONN_ST) {
+    APPL_TRACE_WARNING("%s: ignored in state %s", __func__,
+                       bta_hd_state_code(bta_hd_cb.state));
+    osi_free(p_buf);
+    return;
+  }
+
+  report_id = (bta_hd_cb.use_report_id || bta_hd_cb.boot_mode)
+                  ? (uint8_t)p_buf->layer_specific
+                  : 0x00;
+
+  HID_DevSendInputReport(report_id, p_buf, timestamp_us);
+
+  /* trigger PM */
+  bta_sys_busy(BTA_ID_HD, 1, bta_hd_cb.bd_addr);
+  bta_sys_idle(BTA_ID_HD, 1, bta_hd_cb.bd_addr);
+}
+
 static const char* bta_hd_evt_code(tBTA_HD_INT_EVT evt_code) {
   switch (evt_code) {
     case BTA_HD_API_REGISTER_APP_EVT:
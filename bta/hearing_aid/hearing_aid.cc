@@ -109,16 +109,18 @@ void encryption_callback(const RawAddress*, tGATT_TRANSPORT, void*,
                          tBTM_STATUS);
 void read_rssi_cb(void* p_void);
 
+// The room for the SDU length lets L2CAP send single PDU SDUs without a copy
 inline BT_HDR* malloc_l2cap_buf(uint16_t len) {
-  BT_HDR* msg = (BT_HDR*)osi_malloc(BT_HDR_SIZE + L2CAP_MIN_OFFSET +
-                                    len /* LE-only, no need for FCS here */);
-  msg->offset = L2CAP_MIN_OFFSET;
+  // From the buffer pool, as a packet per side is sent every interval
+  BT_HDR* msg = (BT_HDR*)osi_pool_malloc(
+      BT_HDR_SIZE + L2CAP_LCC_OFFSET + len /* LE-only, no need for FCS here */);
+  msg->offset = L2CAP_LCC_OFFSET;
   msg->len = len;
   return msg;
 }
 
 inline uint8_t* get_l2cap_sdu_start_ptr(BT_HDR* msg) {
-  return (uint8_t*)(msg) + BT_HDR_SIZE + L2CAP_MIN_OFFSET;
+  return (uint8_t*)(msg) + BT_HDR_SIZE + L2CAP_LCC_OFFSET;
 }
 
 class HearingAidImpl;
@@ -238,6 +240,46 @@ inline void encoder_state_release() {
   }
 }
 
+// How far apart the two sides of a binaural pair drift, as seen from the
+// packets each side still had queued at an interval and the packets dropped
+// on one side only.
+struct BinauralSkew {
+  size_t intervals;
+  size_t skewed_intervals;
+  size_t max_queue_skew;
+  size_t max_seq_skew;
+  // Packets in a row sent to one side and dropped on the other one
+  size_t seq_skew;
+
+  BinauralSkew() { Reset(); }
+
+  void Reset() {
+    intervals = 0;
+    skewed_intervals = 0;
+    max_queue_skew = 0;
+    max_seq_skew = 0;
+    seq_skew = 0;
+  }
+
+  void AddInterval(uint16_t late_left, uint16_t late_right) {
+    intervals++;
+    size_t skew = late_left > late_right ? late_left - late_right
+                                         : late_right - late_left;
+    if (skew == 0) return;
+    skewed_intervals++;
+    max_queue_skew = std::max(max_queue_skew, skew);
+  }
+
+  void AddPacket(bool sent_left, bool sent_right) {
+    if (sent_left == sent_right) {
+      seq_skew = 0;
+      return;
+    }
+    seq_skew++;
+    max_seq_skew = std::max(max_seq_skew, seq_skew);
+  }
+};
+
 class HearingAidImpl : public HearingAid {
  private:
   // Keep track of whether the Audio Service has resumed audio playback
@@ -318,8 +360,9 @@ class HearingAidImpl : public HearingAid {
       min_ce_len = overwrite_min_ce_len;
     }
 
-    L2CA_UpdateBleConnParams(address, connection_interval, connection_interval,
-                             0x000A, 0x0064 /*1s*/, min_ce_len, min_ce_len);
+    L2CA_RequestBleConnParams(address, L2CA_BLE_CONN_USER_HEARING_AID,
+                              connection_interval, connection_interval, 0x000A,
+                              0x0064 /*1s*/, min_ce_len, min_ce_len);
     return connection_interval;
   }
 
@@ -1000,6 +1043,7 @@ class HearingAidImpl : public HearingAid {
     if (encoder_state_left == nullptr) {
       encoder_state_init();
       seq_counter = 0;
+      binaural_skew.Reset();
 
       // use the best codec avaliable for this pair of devices.
       uint16_t codecs = hearingDevice.codecs;
@@ -1069,6 +1113,7 @@ class HearingAidImpl : public HearingAid {
     encoder_state_release();
     encoder_state_init();
     seq_counter = 0;
+    binaural_skew.Reset();
 
     for (auto& device : hearingDevices.devices) {
       if (!device.accepting_audio) continue;
@@ -1172,99 +1217,44 @@ class HearingAidImpl : public HearingAid {
       return;
     }
 
-    std::vector<uint16_t> chan_left;
-    std::vector<uint16_t> chan_right;
-    if (left == nullptr || right == nullptr) {
-      for (int i = 0; i < num_samples; i++) {
-        const uint8_t* sample = data.data() + i * 4;
-
-        int16_t left = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-
-        sample += 2;
-        int16_t right = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-
-        int32_t mono_data = (int32_t)((left + right) >> 1);
-        chan_left.push_back(uint16_t(mono_data));
-        chan_right.push_back(uint16_t(mono_data));
-      }
-    } else {
-      for (int i = 0; i < num_samples; i++) {
-        const uint8_t* sample = data.data() + i * 4;
-
-        uint16_t left = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-        chan_left.push_back(left);
-
-        sample += 2;
-        uint16_t right = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-        chan_right.push_back(right);
-      }
+    // Both channels are split in one pass over the interleaved samples,
+    // into buffers kept across intervals.
+    chan_left.resize(num_samples);
+    chan_right.resize(num_samples);
+    const uint8_t* sample = data.data();
+    bool mono = left == nullptr || right == nullptr;
+    for (int i = 0; i < num_samples; i++, sample += 4) {
+      int16_t l = (int16_t)((sample[1] << 8) | sample[0]) >> 1;
+      int16_t r = (int16_t)((sample[3] << 8) | sample[2]) >> 1;
+      if (mono) l = r = (int16_t)((l + r) >> 1);
+      chan_left[i] = l;
+      chan_right[i] = r;
     }
 
     // TODO: monural, binarual check
 
     // divide encoded data into packets, add header, send.
-
-    // TODO: make those buffers static and global to prevent constant
-    // reallocations
-    // TODO: this should basically fit the encoded data, tune the size later
-    std::vector<uint8_t> encoded_data_left;
+    size_t encoded_size_left = 0;
+    uint16_t late_left = 0;
     if (left) {
-      // TODO: instead of a magic number, we need to figure out the correct
-      // buffer size
-      encoded_data_left.resize(4000);
-      int encoded_size = 0;
-      if (chan_left.size() > 0) {
-          encoded_size = g722_encode(encoder_state_left, encoded_data_left.data(),
-                      (const int16_t*)chan_left.data(), chan_left.size());
-      } else {
-        LOG(ERROR) << "Error: No chan_left data to encode";
-      }
-      encoded_data_left.resize(encoded_size);
-
-      uint16_t cid = GAP_ConnGetL2CAPCid(left->gap_handle);
-      uint16_t packets_to_flush = L2CA_FlushChannel(cid, L2CAP_FLUSH_CHANS_GET);
-      if (packets_to_flush) {
-        VLOG(2) << left->address << " skipping " << packets_to_flush
-                << " packets";
-        left->audio_stats.packet_flush_count += packets_to_flush;
-        left->audio_stats.frame_flush_count++;
-        hearingDevices.StartRssiLog();
-      }
-      // flush all packets stuck in queue
-      L2CA_FlushChannel(cid, 0xffff);
-      check_and_do_rssi_read(left);
+      encoded_size_left = EncodeAndFlush(left, encoder_state_left, chan_left,
+                                         encoded_data_left, &late_left);
     }
 
-    std::vector<uint8_t> encoded_data_right;
+    size_t encoded_size_right = 0;
+    uint16_t late_right = 0;
     if (right) {
-      // TODO: instead of a magic number, we need to figure out the correct
-      // buffer size
-      encoded_data_right.resize(4000);
-      int encoded_size = 0;
-      if (chan_right.size() > 0) {
-          encoded_size = g722_encode(encoder_state_right, encoded_data_right.data(),
-                      (const int16_t*)chan_right.data(), chan_right.size());
-      } else {
-        LOG(ERROR) << "Error: No chan_right data to encode";
-      }
-      encoded_data_right.resize(encoded_size);
-
-      uint16_t cid = GAP_ConnGetL2CAPCid(right->gap_handle);
-      uint16_t packets_to_flush = L2CA_FlushChannel(cid, L2CAP_FLUSH_CHANS_GET);
-      if (packets_to_flush) {
-        VLOG(2) << right->address << " skipping " << packets_to_flush
-                << " packets";
-        right->audio_stats.packet_flush_count += packets_to_flush;
-        right->audio_stats.frame_flush_count++;
-        hearingDevices.StartRssiLog();
-      }
-      // flush all packets stuck in queue
-      L2CA_FlushChannel(cid, 0xffff);
-      check_and_do_rssi_read(right);
+      encoded_size_right = EncodeAndFlush(right, encoder_state_right,
+                                          chan_right, encoded_data_right,
+                                          &late_right);
     }
+    if (left && right) binaural_skew.AddInterval(late_left, late_right);
 
-    size_t encoded_data_size =
-        std::max(encoded_data_left.size(), encoded_data_right.size());
+    // Only the side that lags behind drops audio, the other one keeps going
+    bool behind_left = late_left != 0 || (left && left->congested);
+    bool behind_right = late_right != 0 || (right && right->congested);
+
+    size_t encoded_data_size = std::max(encoded_size_left, encoded_size_right);
 
     VLOG(2) << "encoded_data_size : " << encoded_data_size;
     uint16_t packet_size =
@@ -1272,29 +1262,86 @@ class HearingAidImpl : public HearingAid {
     if (encoded_data_size != 0 && packet_size > encoded_data_size)
       packet_size = encoded_data_size;
     VLOG(2) << "packet_size : " << packet_size;
+    bool dropped_left = false;
+    bool dropped_right = false;
     for (size_t i = 0; i < encoded_data_size; i += packet_size) {
+      bool sent_left = true;
+      bool sent_right = true;
       if (left) {
-        left->audio_stats.packet_send_count++;
-        SendAudio(encoded_data_left.data() + i, packet_size, left);
+        sent_left = SendAudio(encoded_data_left.data() + i, packet_size, left,
+                              behind_left);
+        if (sent_left) left->audio_stats.packet_send_count++;
       }
       if (right) {
-        right->audio_stats.packet_send_count++;
-        SendAudio(encoded_data_right.data() + i, packet_size, right);
+        sent_right = SendAudio(encoded_data_right.data() + i, packet_size,
+                               right, behind_right);
+        if (sent_right) right->audio_stats.packet_send_count++;
       }
+      if (left && right) binaural_skew.AddPacket(sent_left, sent_right);
+      dropped_left |= !sent_left;
+      dropped_right |= !sent_right;
       seq_counter++;
     }
     if (left) left->audio_stats.frame_send_count++;
     if (right) right->audio_stats.frame_send_count++;
-  }
-
-  void SendAudio(uint8_t* encoded_data, uint16_t packet_size,
-                 HearingDevice* hearingAid) {
+    if (dropped_left) left->audio_stats.frame_drop_count++;
+    if (dropped_right) right->audio_stats.frame_drop_count++;
+  }
+
+  // Encodes the samples of one side into |encoded| and returns the encoded
+  // size. The packets still queued from the previous interval are late, they
+  // are flushed and their number is returned in |late|.
+  size_t EncodeAndFlush(HearingDevice* device, g722_encode_state_t* encoder,
+                        const std::vector<int16_t>& chan,
+                        std::vector<uint8_t>& encoded, uint16_t* late) {
+    // G.722 at 64 kbit/s packs two samples in one octet
+    encoded.resize(chan.size());
+    int encoded_size = 0;
+    if (chan.size() > 0) {
+      encoded_size =
+          g722_encode(encoder, encoded.data(), chan.data(), chan.size());
+    } else {
+      LOG(ERROR) << "Error: No channel data to encode";
+    }
+
+    uint16_t cid = GAP_ConnGetL2CAPCid(device->gap_handle);
+    uint16_t packets_to_flush = L2CA_FlushChannel(cid, L2CAP_FLUSH_CHANS_GET);
+    *late = packets_to_flush;
+    if (packets_to_flush) {
+      VLOG(2) << device->address << " skipping " << packets_to_flush
+              << " packets";
+      device->audio_stats.packet_flush_count += packets_to_flush;
+      device->audio_stats.frame_flush_count++;
+      device->audio_stats.queue_depth_max =
+          std::max<size_t>(device->audio_stats.queue_depth_max,
+                           packets_to_flush);
+      hearingDevices.StartRssiLog();
+    }
+    // flush all packets stuck in queue
+    L2CA_FlushChannel(cid, 0xffff);
+    check_and_do_rssi_read(device);
+    return encoded_size;
+  }
+
+  // Returns false when the packet is dropped: a device that is |behind|
+  // and has no credits left would only get it after the next interval, when
+  // it is flushed, while it would hold ACL buffers the other side needs.
+  bool SendAudio(uint8_t* encoded_data, uint16_t packet_size,
+                 HearingDevice* hearingAid, bool behind) {
     if (!hearingAid->playback_started || !hearingAid->command_acked) {
       VLOG(2) << __func__
               << ": Playback stalled, device=" << hearingAid->address
               << ", cmd send=" << hearingAid->playback_started
               << ", cmd acked=" << hearingAid->command_acked;
-      return;
+      return true;
+    }
+
+    if (behind &&
+        L2CA_GetPeerLECocCredit(GAP_ConnGetL2CAPCid(hearingAid->gap_handle)) ==
+            0) {
+      VLOG(2) << __func__ << ": no credits, device=" << hearingAid->address;
+      hearingAid->audio_stats.packet_drop_count++;
+      return false;
     }
 
     BT_HDR* audio_packet = malloc_l2cap_buf(packet_size + 1);
@@ -1310,6 +1357,7 @@ class HearingAidImpl : public HearingAid {
     if (result != BT_PASS) {
       LOG(ERROR) << " Error sending data: " << loghex(result);
     }
+    return true;
   }
 
   void GapCallback(uint16_t gap_handle, uint16_t event, tGAP_CB_DATA* data) {
@@ -1340,6 +1388,7 @@ class HearingAidImpl : public HearingAid {
         hearingDevice->gap_handle = 0;
         hearingDevice->playback_started = false;
         hearingDevice->command_acked = false;
+        hearingDevice->congested = false;
         break;
       case GAP_EVT_CONN_DATA_AVAIL: {
         DVLOG(2) << "GAP_EVT_CONN_DATA_AVAIL";
@@ -1377,16 +1426,13 @@ class HearingAidImpl : public HearingAid {
         break;
       case GAP_EVT_CONN_CONGESTED:
         DVLOG(2) << "GAP_EVT_CONN_CONGESTED";
-
-        // TODO: make it into function
-        HearingAidAudioSource::Stop();
-        // TODO: kill the encoder only if all hearing aids are down.
-        // g722_encode_release(encoder_state);
-        // encoder_state_left = nulllptr;
-        // encoder_state_right = nulllptr;
+        // Rather than stopping the audio of both sides, only the audio of
+        // this side is dropped until it catches up.
+        hearingDevice->congested = true;
         break;
       case GAP_EVT_CONN_UNCONGESTED:
         DVLOG(2) << "GAP_EVT_CONN_UNCONGESTED";
+        hearingDevice->congested = false;
         break;
 
       case GAP_EVT_LE_COC_CREDITS: {
@@ -1459,10 +1505,21 @@ class HearingAidImpl : public HearingAid {
           << device.audio_stats.packet_flush_count
           << "\n    Frame counts (enqueued/flushed)                         : "
           << device.audio_stats.frame_send_count << " / "
-          << device.audio_stats.frame_flush_count << std::endl;
+          << device.audio_stats.frame_flush_count
+          << "\n    Packet/frame counts (dropped, no credits)               : "
+          << device.audio_stats.packet_drop_count << " / "
+          << device.audio_stats.frame_drop_count << std::endl;
 
       DumpRssi(fd, device);
     }
+    if (binaural_skew.intervals != 0) {
+      stream << "  Binaural skew (intervals/one side late/max late)       : "
+             << binaural_skew.intervals << " / "
+             << binaural_skew.skewed_intervals << " / "
+             << binaural_skew.max_queue_skew
+             << "\n  Binaural skew (max packets missed by one side)         : "
+             << binaural_skew.max_seq_skew << std::endl;
+    }
     dprintf(fd, "%s", stream.str().c_str());
   }
 
@@ -1592,6 +1649,14 @@ class HearingAidImpl : public HearingAid {
 
   HearingDevices hearingDevices;
 
+  BinauralSkew binaural_skew;
+
+  /* audio buffers, kept across the intervals */
+  std::vector<int16_t> chan_left;
+  std::vector<int16_t> chan_right;
+  std::vector<uint8_t> encoded_data_left;
+  std::vector<uint8_t> encoded_data_right;
+
   void find_server_changed_ccc_handle(uint16_t conn_id,
                                       const gatt::Service* service) {
     HearingDevice* hearingDevice = hearingDevices.FindByConnId(conn_id);
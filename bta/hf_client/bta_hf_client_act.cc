@@ -413,7 +413,7 @@ void bta_hf_client_rfc_data(tBTA_HF_CLIENT_DATA* p_data) {
   }
 
   uint16_t len;
-  char buf[BTA_HF_CLIENT_RFC_READ_MAX];
+  char buf[BTA_HF_CLIENT_RFC_READ_MAX + 1];
   memset(buf, 0, sizeof(buf));
   /* read data from rfcomm; if bad status, we're done */
   while (PORT_ReadData(client_cb->conn_handle, buf, BTA_HF_CLIENT_RFC_READ_MAX,
@@ -423,6 +423,9 @@ void bta_hf_client_rfc_data(tBTA_HF_CLIENT_DATA* p_data) {
       break;
     }
 
+    /* terminate the data so the parser can work on it in place */
+    buf[len] = 0;
+
     bta_hf_client_at_parse(client_cb, buf, len);
 
     /* no more data to read, we're done */
@@ -23,6 +23,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <base/logging.h>
+
 #include "bta_hf_client_api.h"
 #include "bta_hf_client_int.h"
 #include "osi/include/log.h"
@@ -1491,32 +1493,149 @@ static char* bta_hf_client_process_unknown(tBTA_HF_CLIENT_CB* client_cb,
  */
 typedef char* (*tBTA_HF_CLIENT_PARSER_CALLBACK)(tBTA_HF_CLIENT_CB*, char*);
 
-static const tBTA_HF_CLIENT_PARSER_CALLBACK bta_hf_client_parser_cb[] = {
-    bta_hf_client_parse_ok,          bta_hf_client_parse_error,
-    bta_hf_client_parse_ring,        bta_hf_client_parse_brsf,
-    bta_hf_client_parse_cind,        bta_hf_client_parse_ciev,
-    bta_hf_client_parse_chld,        bta_hf_client_parse_bcs,
-    bta_hf_client_parse_bsir,        bta_hf_client_parse_cmeerror,
-    bta_hf_client_parse_vgm,         bta_hf_client_parse_vgme,
-    bta_hf_client_parse_vgs,         bta_hf_client_parse_vgse,
-    bta_hf_client_parse_bvra,        bta_hf_client_parse_clip,
-    bta_hf_client_parse_ccwa,        bta_hf_client_parse_cops,
-    bta_hf_client_parse_binp,        bta_hf_client_parse_clcc,
-    bta_hf_client_parse_cnum,        bta_hf_client_parse_btrh,
-    bta_hf_client_parse_busy,        bta_hf_client_parse_delayed,
-    bta_hf_client_parse_no_carrier,  bta_hf_client_parse_no_answer,
-    bta_hf_client_parse_blacklisted, bta_hf_client_process_unknown};
+/* Event parser and the event it matches after the leading <cr><lf> */
+typedef struct {
+  const char* p_event;
+  tBTA_HF_CLIENT_PARSER_CALLBACK p_parser;
+} tBTA_HF_CLIENT_PARSER;
+
+/* Parsers in the order they are tried, the last one takes any event */
+static const tBTA_HF_CLIENT_PARSER bta_hf_client_parser_cb[] = {
+    {"OK", bta_hf_client_parse_ok},
+    {"ERROR", bta_hf_client_parse_error},
+    {"RING", bta_hf_client_parse_ring},
+    {"+BRSF:", bta_hf_client_parse_brsf},
+    {"+CIND:", bta_hf_client_parse_cind},
+    {"+CIEV:", bta_hf_client_parse_ciev},
+    {"+CHLD:", bta_hf_client_parse_chld},
+    {"+BCS:", bta_hf_client_parse_bcs},
+    {"+BSIR:", bta_hf_client_parse_bsir},
+    {"+CME ERROR:", bta_hf_client_parse_cmeerror},
+    {"+VGM:", bta_hf_client_parse_vgm},
+    {"+VGM=", bta_hf_client_parse_vgme},
+    {"+VGS:", bta_hf_client_parse_vgs},
+    {"+VGS=", bta_hf_client_parse_vgse},
+    {"+BVRA:", bta_hf_client_parse_bvra},
+    {"+CLIP:", bta_hf_client_parse_clip},
+    {"+CCWA:", bta_hf_client_parse_ccwa},
+    {"+COPS:", bta_hf_client_parse_cops},
+    {"+BINP:", bta_hf_client_parse_binp},
+    {"+CLCC:", bta_hf_client_parse_clcc},
+    {"+CNUM:", bta_hf_client_parse_cnum},
+    {"+BTRH:", bta_hf_client_parse_btrh},
+    {"BUSY", bta_hf_client_parse_busy},
+    {"DELAYED", bta_hf_client_parse_delayed},
+    {"NO CARRIER", bta_hf_client_parse_no_carrier},
+    {"NO ANSWER", bta_hf_client_parse_no_answer},
+    {"BLACKLISTED", bta_hf_client_parse_blacklisted},
+    {"", bta_hf_client_process_unknown}};
 
 /* calculate supported event list length */
 static const uint16_t bta_hf_client_parser_cb_count =
     sizeof(bta_hf_client_parser_cb) / sizeof(bta_hf_client_parser_cb[0]);
 
+/* Nodes of the event trie of the parsers */
+#define BTA_HF_CLIENT_AT_TRIE_MAX_NODES 255
+
+/* One character of the events in the event trie */
+typedef struct {
+  char c;          /* event character */
+  uint8_t child;   /* first node of the next character, 0 if none */
+  uint8_t sibling; /* next node for the same prefix, 0 if none */
+  uint8_t parser;  /* first parser of the event ending here */
+} tBTA_HF_CLIENT_AT_NODE;
+
+/* Event trie of the parsers, node 0 is the empty event */
+typedef struct {
+  bool built;
+  uint16_t num_nodes;
+  tBTA_HF_CLIENT_AT_NODE nodes[BTA_HF_CLIENT_AT_TRIE_MAX_NODES];
+} tBTA_HF_CLIENT_AT_TRIE;
+
+static tBTA_HF_CLIENT_AT_TRIE bta_hf_client_at_trie;
+
+/*******************************************************************************
+ *
+ * Function         bta_hf_client_at_trie_build
+ *
+ * Description      Build the event trie of the parsers, so that the parser of
+ *                  an event is found in one pass over it.
+ *
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_hf_client_at_trie_build(void) {
+  tBTA_HF_CLIENT_AT_TRIE* p_trie = &bta_hf_client_at_trie;
+  uint8_t unknown = bta_hf_client_parser_cb_count - 1;
+
+  memset(p_trie, 0, sizeof(*p_trie));
+  p_trie->num_nodes = 1;
+  p_trie->nodes[0].parser = unknown;
+
+  for (uint8_t i = 0; i < unknown; i++) {
+    uint8_t node = 0;
+    for (const char* p = bta_hf_client_parser_cb[i].p_event; *p != '\0'; p++) {
+      uint8_t child = p_trie->nodes[node].child;
+      while (child != 0 && p_trie->nodes[child].c != *p)
+        child = p_trie->nodes[child].sibling;
+
+      if (child == 0) {
+        CHECK(p_trie->num_nodes < BTA_HF_CLIENT_AT_TRIE_MAX_NODES);
+        child = p_trie->num_nodes++;
+        p_trie->nodes[child].c = *p;
+        p_trie->nodes[child].parser = unknown;
+        p_trie->nodes[child].sibling = p_trie->nodes[node].child;
+        p_trie->nodes[node].child = child;
+      }
+      node = child;
+    }
+
+    /* Earlier parsers win, as with a scan of the table */
+    if (p_trie->nodes[node].parser > i) p_trie->nodes[node].parser = i;
+  }
+
+  p_trie->built = true;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_hf_client_at_find_parser
+ *
+ * Description      Find the first parser whose event is a prefix of the AT
+ *                  event at |buf|.
+ *
+ *
+ * Returns          Index of the parser, that of the unknown event parser if
+ *                  no other matches.
+ *
+ ******************************************************************************/
+static uint8_t bta_hf_client_at_find_parser(const char* buf) {
+  const tBTA_HF_CLIENT_AT_TRIE* p_trie = &bta_hf_client_at_trie;
+  uint8_t parser = bta_hf_client_parser_cb_count - 1;
+
+  if (!p_trie->built) bta_hf_client_at_trie_build();
+
+  if (buf[0] != '\r' || buf[1] != '\n') return parser;
+
+  uint8_t node = 0;
+  for (const char* p = buf + 2; *p != '\0'; p++) {
+    node = p_trie->nodes[node].child;
+    while (node != 0 && p_trie->nodes[node].c != *p)
+      node = p_trie->nodes[node].sibling;
+    if (node == 0) break;
+    if (p_trie->nodes[node].parser < parser)
+      parser = p_trie->nodes[node].parser;
+  }
+  return parser;
+}
+
 #ifdef BTA_HF_CLIENT_AT_DUMP
-static void bta_hf_client_dump_at(tBTA_HF_CLIENT_CB* client_cb) {
+static void bta_hf_client_dump_at(tBTA_HF_CLIENT_CB* client_cb, char* buf) {
   char dump[(4 * BTA_HF_CLIENT_AT_PARSER_MAX_LEN) + 1];
   char *p1, *p2;
 
-  p1 = client_cb->at_cb.buf;
+  p1 = buf;
   p2 = dump;
 
   while (*p1 != '\0') {
@@ -1539,21 +1658,22 @@ static void bta_hf_client_dump_at(tBTA_HF_CLIENT_CB* client_cb) {
 }
 #endif
 
-static void bta_hf_client_at_parse_start(tBTA_HF_CLIENT_CB* client_cb) {
-  char* buf = client_cb->at_cb.buf;
-
+static void bta_hf_client_at_parse_start(tBTA_HF_CLIENT_CB* client_cb,
+                                         char* buf) {
   APPL_TRACE_DEBUG("%s", __func__);
 
 #ifdef BTA_HF_CLIENT_AT_DUMP
-  bta_hf_client_dump_at(client_cb);
+  bta_hf_client_dump_at(client_cb, buf);
 #endif
 
   while (*buf != '\0') {
     int i;
     char* tmp = NULL;
 
-    for (i = 0; i < bta_hf_client_parser_cb_count; i++) {
-      tmp = bta_hf_client_parser_cb[i](client_cb, buf);
+    /* parsers before the one found do not match, so skip them */
+    for (i = bta_hf_client_at_find_parser(buf);
+         i < bta_hf_client_parser_cb_count; i++) {
+      tmp = bta_hf_client_parser_cb[i].p_parser(client_cb, buf);
       if (tmp == NULL) {
         APPL_TRACE_ERROR("HFPCient: AT event/reply parsing failed, skipping");
         tmp = bta_hf_client_skip_unknown(client_cb, buf);
@@ -1609,6 +1729,8 @@ static void bta_hf_client_at_clear_buf(tBTA_HF_CLIENT_CB* client_cb) {
  *
  *          MAIN PARSING FUNCTION
  *
+ *  |buf| holds a nul after its |len| bytes, so that a read of complete events
+ *  is parsed without a copy.
  *
  ******************************************************************************/
 void bta_hf_client_at_parse(tBTA_HF_CLIENT_CB* client_cb, char* buf,
@@ -1652,7 +1774,7 @@ void bta_hf_client_at_parse(tBTA_HF_CLIENT_CB* client_cb, char* buf,
     client_cb->at_cb.buf[client_cb->at_cb.offset] = '\0';
 
     /* parse */
-    bta_hf_client_at_parse_start(client_cb);
+    bta_hf_client_at_parse_start(client_cb, client_cb->at_cb.buf);
     bta_hf_client_at_clear_buf(client_cb);
 
     /* TODO: recover cut data */
@@ -1665,12 +1787,19 @@ void bta_hf_client_at_parse(tBTA_HF_CLIENT_CB* client_cb, char* buf,
     return;
   }
 
+  /* Complete events in |buf| alone are parsed where they are */
+  if (client_cb->at_cb.offset == 0 && len >= BTA_HF_CLIENT_AT_EVENT_MIN_LEN &&
+      buf[len - 2] == '\r' && buf[len - 1] == '\n' && buf[len] == '\0') {
+    bta_hf_client_at_parse_start(client_cb, buf);
+    return;
+  }
+
   memcpy(client_cb->at_cb.buf + client_cb->at_cb.offset, buf, len);
   client_cb->at_cb.offset += len;
 
   /* If last event is complete, parsing can be started */
   if (bta_hf_client_check_at_complete(client_cb) == true) {
-    bta_hf_client_at_parse_start(client_cb);
+    bta_hf_client_at_parse_start(client_cb, client_cb->at_cb.buf);
     bta_hf_client_at_clear_buf(client_cb);
   }
 }
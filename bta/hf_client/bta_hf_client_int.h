@@ -259,6 +259,7 @@ extern void bta_hf_client_cback_sco(tBTA_HF_CLIENT_CB* client_cb,
                                     uint8_t event);
 
 /* AT command functions */
+/* |buf| must hold a nul after its |len| bytes, for parsing them in place */
 extern void bta_hf_client_at_parse(tBTA_HF_CLIENT_CB* client_cb, char* buf,
                                    unsigned int len);
 extern void bta_hf_client_send_at_brsf(tBTA_HF_CLIENT_CB* client_cb,
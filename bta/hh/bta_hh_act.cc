@@ -35,6 +35,7 @@
 #include "btm_api.h"
 #include "l2c_api.h"
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 #include "utl.h"
 
 /*****************************************************************************
@@ -634,6 +635,8 @@ void bta_hh_data_act(tBTA_HH_DEV_CB* p_cb, tBTA_HH_DATA* p_data) {
                  p_cb->dscp_info.ctry_code, p_cb->addr, p_cb->app_id);
 
   osi_free_and_reset((void**)&pdata);
+
+  bta_hh_update_rpt_stats(&p_cb->rpt_stats, p_data->hid_cback.timestamp_us);
 }
 
 /*******************************************************************************
@@ -1202,6 +1205,26 @@ static void bta_hh_cback(uint8_t dev_handle, const RawAddress& addr,
       break;
   }
 
+  /* Input reports of a connected device are handed to the call-out right
+   * away, this callback already runs on the BTA thread */
+  if (sm_event == BTA_HH_INT_DATA_EVT) {
+    uint8_t index = bta_hh_dev_handle_to_cb_idx(dev_handle);
+    if (index < BTA_HH_MAX_DEVICE &&
+        bta_hh_cb.kdev[index].state == BTA_HH_CONN_ST) {
+      tBTA_HH_CBACK_DATA cback_data;
+      cback_data.hdr.event = sm_event;
+      cback_data.hdr.layer_specific = (uint16_t)dev_handle;
+      cback_data.data = data;
+      cback_data.addr = addr;
+      cback_data.p_data = pdata;
+      cback_data.timestamp_us = time_get_os_boottime_us();
+
+      bta_hh_cb.kdev[index].rpt_stats.direct_count++;
+      bta_hh_data_act(&bta_hh_cb.kdev[index], (tBTA_HH_DATA*)&cback_data);
+      return;
+    }
+  }
+
   if (sm_event != BTA_HH_INVALID_EVT) {
     tBTA_HH_CBACK_DATA* p_buf = (tBTA_HH_CBACK_DATA*)osi_malloc(
         sizeof(tBTA_HH_CBACK_DATA) + sizeof(BT_HDR));
@@ -1210,6 +1233,7 @@ static void bta_hh_cback(uint8_t dev_handle, const RawAddress& addr,
     p_buf->data = data;
     p_buf->addr = addr;
     p_buf->p_data = pdata;
+    p_buf->timestamp_us = time_get_os_boottime_us();
 
     bta_sys_sendmsg(p_buf);
   }
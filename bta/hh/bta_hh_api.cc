@@ -391,6 +391,34 @@ void BTA_HhUpdateLeScanParam(uint8_t dev_handle, uint16_t scan_int, uint16_t sca
 }
 #endif
 
+/*******************************************************************************
+ *
+ * Function         BTA_HhDumpStatistics
+ *
+ * Description      Dump the input report statistics of the connected devices
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTA_HhDumpStatistics(int fd) {
+  dprintf(fd, "\nHID Host input reports:\n");
+  for (uint8_t xx = 0; xx < BTA_HH_MAX_DEVICE; xx++) {
+    const tBTA_HH_DEV_CB* p_cb = &bta_hh_cb.kdev[xx];
+    const tBTA_HH_RPT_STATS* p_stats = &p_cb->rpt_stats;
+    if (!p_cb->in_use || p_stats->count == 0) continue;
+
+    dprintf(fd, "  %s handle %d\n", p_cb->addr.ToString().c_str(),
+            p_cb->hid_handle);
+    dprintf(fd, "    Reports (total/not posted): %zu / %zu\n", p_stats->count,
+            p_stats->direct_count);
+    dprintf(fd, "    Delivery latency (avg/max): %llu / %llu us\n",
+            (unsigned long long)(p_stats->total_latency_us / p_stats->count),
+            (unsigned long long)p_stats->max_latency_us);
+    dprintf(fd, "    Shortest report interval: %llu us\n",
+            (unsigned long long)p_stats->min_interval_us);
+  }
+}
+
 /*******************************************************************************/
 /*                          Utility Function                                   */
 /*******************************************************************************/
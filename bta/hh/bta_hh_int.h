@@ -127,6 +127,7 @@ typedef struct {
   RawAddress addr;
   uint32_t data;
   BT_HDR* p_data;
+  uint64_t timestamp_us; /* time the HID callback was called */
 } tBTA_HH_CBACK_DATA;
 
 typedef struct {
@@ -223,6 +224,26 @@ typedef struct {
 #define BTA_HH_IS_LE_DEV_HDL_VALID(x) (((x) >> 4) <= BTA_HH_MAX_DEVICE)
 #endif
 
+/* input reports delivered to the HH call-out */
+typedef struct {
+  size_t count;              /* reports delivered */
+  size_t direct_count;       /* reports not posted through BTA */
+  uint64_t total_latency_us; /* total time until the call-out returned */
+  uint64_t max_latency_us;
+  uint64_t last_report_us;   /* time of the last report */
+  uint64_t min_interval_us;  /* shortest time between two reports */
+} tBTA_HH_RPT_STATS;
+
+#if (BTA_HH_LE_INCLUDED == TRUE)
+/* report of a characteristic value handle */
+typedef struct {
+  uint16_t handle;
+  tBTA_HH_LE_RPT* p_rpt;
+} tBTA_HH_LE_RPT_HANDLE;
+
+#define BTA_HH_LE_RPT_HANDLE_MAX (BTA_HH_LE_HID_SRVC_MAX * BTA_HH_LE_RPT_MAX)
+#endif
+
 /* device control block */
 typedef struct {
   tBTA_HH_DEV_DSCP_INFO dscp_info; /* report descriptor and DI information */
@@ -269,9 +290,15 @@ typedef struct {
 #define BTA_HH_LE_SCPS_NOTIFY_SPT 0x01
 #define BTA_HH_LE_SCPS_NOTIFY_ENB 0x02
   uint8_t scps_notify; /* scan refresh supported/notification enabled */
+
+  /* reports of the discovered characteristics, sorted by handle */
+  uint8_t num_rpt_handles;
+  tBTA_HH_LE_RPT_HANDLE rpt_handles[BTA_HH_LE_RPT_HANDLE_MAX];
+  bool rpt_cache_valid; /* reports restored from the persisted cache */
 #endif
 
   bool security_pending;
+  tBTA_HH_RPT_STATS rpt_stats; /* interrupt channel input reports */
 } tBTA_HH_DEV_CB;
 
 /* key board parsing control block */
@@ -354,6 +381,8 @@ extern void bta_hh_update_di_info(tBTA_HH_DEV_CB* p_cb, uint16_t vendor_id,
 extern void bta_hh_cleanup_disable(tBTA_HH_STATUS status);
 
 extern uint8_t bta_hh_dev_handle_to_cb_idx(uint8_t dev_handle);
+extern void bta_hh_update_rpt_stats(tBTA_HH_RPT_STATS* p_stats,
+                                    uint64_t received_us);
 
 /* action functions used outside state machine */
 extern void bta_hh_api_enable(tBTA_HH_DATA* p_data);
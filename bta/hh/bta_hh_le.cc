@@ -37,6 +37,7 @@
 #include "btm_int.h"
 #include "device/include/interop.h"
 #include "osi/include/log.h"
+#include "osi/include/time.h"
 #include "srvc_api.h"
 #include "stack/include/l2c_api.h"
 #include "utl.h"
@@ -74,11 +75,6 @@ static void bta_hh_le_register_scpp_notif(tBTA_HH_DEV_CB *p_dev_cb,
 static void bta_hh_le_register_scpp_notif_cmpl(tBTA_HH_DEV_CB *p_dev_cb,
                                               tGATT_STATUS status);
 
-// TODO(jpawlowski): uncomment when fixed
-// static void bta_hh_process_cache_rpt (tBTA_HH_DEV_CB *p_cb,
-//                                       tBTA_HH_RPT_CACHE_ENTRY *p_rpt_cache,
-//                                       uint8_t num_rpt);
-
 #if (BTA_HH_DEBUG == TRUE)
 static const char* bta_hh_le_rpt_name[4] = {"UNKNOWN", "INPUT", "OUTPUT",
                                             "FEATURE"};
@@ -531,14 +527,6 @@ void bta_hh_le_save_report_ref(tBTA_HH_DEV_CB* p_dev_cb, tBTA_HH_LE_RPT* p_rpt,
 #if (BTA_HH_DEBUG == TRUE)
     APPL_TRACE_DEBUG("%s: report ID: %d", __func__, p_rpt->rpt_id);
 #endif
-    tBTA_HH_RPT_CACHE_ENTRY rpt_entry;
-    rpt_entry.rpt_id = p_rpt->rpt_id;
-    rpt_entry.rpt_type = p_rpt->rpt_type;
-    rpt_entry.rpt_uuid = p_rpt->uuid;
-    rpt_entry.srvc_inst_id = p_rpt->srvc_inst_id;
-    rpt_entry.char_inst_id = p_rpt->char_inst_id;
-
-    bta_hh_le_co_rpt_info(p_dev_cb->addr, &rpt_entry, p_dev_cb->app_id);
   }
 
   if (p_rpt->index < BTA_HH_LE_RPT_MAX - 1)
@@ -691,6 +679,35 @@ bool bta_hh_le_write_ccc(tBTA_HH_DEV_CB* p_cb, uint8_t char_handle,
   return true;
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_hh_le_save_rpt_cache
+ *
+ * Description      Hand the report table of a discovered device to the
+ *                  application, to be loaded back on the next connection.
+ *
+ ******************************************************************************/
+static void bta_hh_le_save_rpt_cache(tBTA_HH_DEV_CB* p_cb) {
+  bta_hh_le_co_reset_rpt_cache(p_cb->addr, p_cb->app_id);
+
+  for (uint8_t i = 0; i < BTA_HH_LE_HID_SRVC_MAX && p_cb->hid_srvc[i].in_use;
+       i++) {
+    tBTA_HH_LE_RPT* p_rpt = &p_cb->hid_srvc[i].report[0];
+
+    for (uint8_t j = 0; j < BTA_HH_LE_RPT_MAX && p_rpt->in_use; j++, p_rpt++) {
+      tBTA_HH_RPT_CACHE_ENTRY rpt_entry;
+      rpt_entry.rpt_id = p_rpt->rpt_id;
+      rpt_entry.rpt_type = p_rpt->rpt_type;
+      rpt_entry.rpt_uuid = p_rpt->uuid;
+      rpt_entry.srvc_inst_id = p_rpt->srvc_inst_id;
+      rpt_entry.char_inst_id = p_rpt->char_inst_id;
+      rpt_entry.clt_cfg_value = p_rpt->client_cfg_value;
+
+      bta_hh_le_co_rpt_info(p_cb->addr, &rpt_entry, p_cb->app_id);
+    }
+  }
+}
+
 bool bta_hh_le_write_rpt_clt_cfg(tBTA_HH_DEV_CB* p_cb);
 
 static void write_rpt_ctl_cfg_cb(uint16_t conn_id, tGATT_STATUS status,
@@ -754,7 +771,9 @@ bool bta_hh_le_write_rpt_clt_cfg(tBTA_HH_DEV_CB* p_cb) {
   for (i = p_cb->clt_cfg_idx; i < BTA_HH_LE_RPT_MAX && p_rpt->in_use;
        i++, p_rpt++) {
     /* enable notification for all input report, regardless mode */
-    if (p_rpt->rpt_type == BTA_HH_RPTT_INPUT) {
+    if (p_rpt->rpt_type == BTA_HH_RPTT_INPUT &&
+        /* a bonded device keeps the configuration across connections */
+        p_rpt->client_cfg_value != GATT_CLT_CONFIG_NOTIFICATION) {
 //      p_cb->cur_srvc_index = srvc_inst_id;
       APPL_TRACE_ERROR("curent hid instance: %d",p_cb->cur_srvc_index );
       if (bta_hh_le_write_ccc(p_cb, p_rpt->char_inst_id,
@@ -777,6 +796,7 @@ bool bta_hh_le_write_rpt_clt_cfg(tBTA_HH_DEV_CB* p_cb) {
   if (p_cb->state == BTA_HH_W4_CONN_ST) {
     p_cb->disc_active &= ~BTA_HH_LE_DISC_HIDS;
 
+    if (!p_cb->rpt_cache_valid) bta_hh_le_save_rpt_cache(p_cb);
     bta_hh_le_open_cmpl(p_cb);
   }
   return false;
@@ -980,12 +1000,22 @@ void bta_hh_le_dis_cback(const RawAddress& addr, tDIS_VALUE* p_dis_value) {
  *
  ******************************************************************************/
 void bta_hh_le_pri_service_discovery(tBTA_HH_DEV_CB* p_cb) {
-  bta_hh_le_co_reset_rpt_cache(p_cb->addr, p_cb->app_id);
+  uint8_t num_rpt = 0;
 
-  p_cb->disc_active |= (BTA_HH_LE_DISC_HIDS | BTA_HH_LE_DISC_DIS);
+  /* the report map and the PnP ID of a bonded device are in its HID info, the
+   * rest of the reads is skipped for the reports found in the cache */
+  p_cb->rpt_cache_valid =
+      p_cb->dscp_info.descriptor.dl_len != 0 &&
+      bta_hh_le_co_cache_load(p_cb->addr, &num_rpt, p_cb->app_id) != NULL;
+
+  p_cb->disc_active |= BTA_HH_LE_DISC_HIDS;
+  if (!p_cb->rpt_cache_valid) p_cb->disc_active |= BTA_HH_LE_DISC_DIS;
 
   /* read DIS info */
-  if (!DIS_ReadDISInfo(p_cb->addr, bta_hh_le_dis_cback, DIS_ATTR_PNP_ID_BIT)) {
+  if (p_cb->rpt_cache_valid) {
+    APPL_TRACE_DEBUG("%s: %d reports cached", __func__, num_rpt);
+  } else if (!DIS_ReadDISInfo(p_cb->addr, bta_hh_le_dis_cback,
+                              DIS_ATTR_PNP_ID_BIT)) {
     APPL_TRACE_ERROR("read DIS failed");
     p_cb->disc_active &= ~BTA_HH_LE_DISC_DIS;
   }
@@ -1039,19 +1069,6 @@ void bta_hh_security_cmpl(tBTA_HH_DEV_CB* p_cb,
                           UNUSED_ATTR tBTA_HH_DATA* p_buf) {
   APPL_TRACE_DEBUG("%s", __func__);
   if (p_cb->status == BTA_HH_OK) {
-    if (!p_cb->hid_srvc[0].in_use) {
-      APPL_TRACE_DEBUG("bta_hh_security_cmpl no reports loaded, try to load");
-
-      /* start loading the cache if not in stack */
-      // TODO(jpawlowski): cache storage is broken, fix it
-      // tBTA_HH_RPT_CACHE_ENTRY     *p_rpt_cache;
-      // uint8_t                       num_rpt = 0;
-      // if ((p_rpt_cache = bta_hh_le_co_cache_load(p_cb->addr, &num_rpt,
-      // p_cb->app_id)) != NULL)
-      // {
-      //     bta_hh_process_cache_rpt(p_cb, p_rpt_cache, num_rpt);
-      // }
-    }
     /*  discovery has been done for HID service */
     if (p_cb->app_id != 0 && p_cb->hid_srvc[0].in_use) {
       APPL_TRACE_DEBUG("%s: discovery has been done for HID service", __func__);
@@ -1107,6 +1124,7 @@ void bta_hh_clear_service_cache(tBTA_HH_DEV_CB* p_cb) {
   p_cb->app_id = 0;
   p_cb->total_srvc = 0;
   p_cb->dscp_info.descriptor.dsc_list = NULL;
+  p_cb->num_rpt_handles = 0;
 
   for (int i = 0; i < BTA_HH_LE_HID_SRVC_MAX; i ++) {
      p_hid_srvc = &p_cb->hid_srvc[i];
@@ -1449,8 +1467,33 @@ void read_pref_conn_params_cb(uint16_t conn_id, tGATT_STATUS status,
 
   BTM_BleSetPrefConnParams(p_dev_cb->addr, min_interval, max_interval, latency,
                            timeout);
-  L2CA_UpdateBleConnParams(p_dev_cb->addr, min_interval, max_interval, latency,
-                           timeout);
+  L2CA_RequestBleConnParams(p_dev_cb->addr, L2CA_BLE_CONN_USER_HID,
+                            min_interval, max_interval, latency, timeout, 0, 0);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_hh_le_load_cached_rpt
+ *
+ * Description      Restore a report from the persisted report cache.
+ *
+ * Returns          true if the report was found in the cache.
+ *
+ ******************************************************************************/
+static bool bta_hh_le_load_cached_rpt(tBTA_HH_LE_RPT* p_rpt,
+                                      const tBTA_HH_RPT_CACHE_ENTRY* p_cache,
+                                      uint8_t num_rpt) {
+  for (uint8_t i = 0; i < num_rpt; i++, p_cache++) {
+    if (p_cache->rpt_uuid == p_rpt->uuid &&
+        p_cache->srvc_inst_id == p_rpt->srvc_inst_id &&
+        p_cache->char_inst_id == p_rpt->char_inst_id) {
+      p_rpt->rpt_id = p_cache->rpt_id;
+      p_rpt->rpt_type = p_cache->rpt_type;
+      p_rpt->client_cfg_value = p_cache->clt_cfg_value;
+      return true;
+    }
+  }
+  return false;
 }
 
 /*******************************************************************************
@@ -1458,14 +1501,18 @@ void read_pref_conn_params_cb(uint16_t conn_id, tGATT_STATUS status,
  * Function         bta_hh_le_search_hid_chars
  *
  * Description      This function discover all characteristics a service and
- *                  all descriptors available.
+ *                  all descriptors available. The values found in the report
+ *                  cache |p_cache| are not read again.
  *
  * Parameters:
  *
  ******************************************************************************/
 static void bta_hh_le_search_hid_chars(tBTA_HH_DEV_CB* p_dev_cb,
-                                       const gatt::Service* service) {
+                                       const gatt::Service* service,
+                                       const tBTA_HH_RPT_CACHE_ENTRY* p_cache,
+                                       uint8_t num_rpt) {
   tBTA_HH_LE_RPT* p_rpt;
+  tBTA_HH_LE_HID_SRVC* p_srvc = &p_dev_cb->hid_srvc[p_dev_cb->cur_srvc_index];
 
   for (const gatt::Characteristic& charac : service->characteristics) {
     if (!charac.uuid.Is16Bit()) continue;
@@ -1479,11 +1526,25 @@ static void bta_hh_le_search_hid_chars(tBTA_HH_DEV_CB* p_dev_cb,
         p_dev_cb->hid_srvc[p_dev_cb->cur_srvc_index].control_point_handle = charac.value_handle;
         break;
       case GATT_UUID_HID_INFORMATION:
+        /* stored with the report map */
+        if (p_cache != NULL) break;
+
         /* only one instance per HID service */
         BtaGattQueue::ReadCharacteristic(p_dev_cb->conn_id, charac.value_handle,
                                          read_hid_info_cb, p_dev_cb);
         break;
       case GATT_UUID_HID_REPORT_MAP:
+        if (p_cache != NULL) {
+          osi_free_and_reset((void**)&p_srvc->rpt_map);
+          p_srvc->rpt_map =
+              (uint8_t*)osi_malloc(p_dev_cb->dscp_info.descriptor.dl_len);
+          memcpy(p_srvc->rpt_map, p_dev_cb->dscp_info.descriptor.dsc_list,
+                 p_dev_cb->dscp_info.descriptor.dl_len);
+          p_srvc->descriptor.dl_len = p_dev_cb->dscp_info.descriptor.dl_len;
+          p_srvc->descriptor.dsc_list = p_srvc->rpt_map;
+          break;
+        }
+
         /* only one instance per HID service */
         BtaGattQueue::ReadCharacteristic(p_dev_cb->conn_id, charac.value_handle,
                                          read_hid_report_map_cb, p_dev_cb);
@@ -1502,6 +1563,10 @@ static void bta_hh_le_search_hid_chars(tBTA_HH_DEV_CB* p_dev_cb,
           break;
         }
 
+        if (bta_hh_le_load_cached_rpt(p_rpt, p_cache, num_rpt)) break;
+        /* the report reference of a new report is read below */
+        p_dev_cb->rpt_cache_valid = false;
+
         if (p_rpt->rpt_type != BTA_HH_RPTT_INPUT) break;
 
         bta_hh_le_read_char_descriptor(p_dev_cb, charac.value_handle,
@@ -1513,9 +1578,13 @@ static void bta_hh_le_search_hid_chars(tBTA_HH_DEV_CB* p_dev_cb,
       case GATT_UUID_HID_BT_KB_OUTPUT:
       case GATT_UUID_HID_BT_MOUSE_INPUT:
       case GATT_UUID_HID_BT_KB_INPUT:
-        if (bta_hh_le_find_alloc_report_entry(p_dev_cb, service->handle, uuid16,
-                                              charac.value_handle) == NULL)
+        p_rpt = bta_hh_le_find_alloc_report_entry(p_dev_cb, service->handle,
+                                                  uuid16, charac.value_handle);
+        if (p_rpt == NULL) {
           APPL_TRACE_ERROR("%s: Add report entry failed !!!", __func__);
+        } else if (!bta_hh_le_load_cached_rpt(p_rpt, p_cache, num_rpt)) {
+          p_dev_cb->rpt_cache_valid = false;
+        }
 
         break;
 
@@ -1535,6 +1604,61 @@ static void bta_hh_le_search_hid_chars(tBTA_HH_DEV_CB* p_dev_cb,
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_hh_le_index_reports
+ *
+ * Description      Record the report of every characteristic value handle, as
+ *                  bta_hh_le_input_rpt_notify would look it up, so that a
+ *                  notification is resolved with a binary search.
+ *
+ ******************************************************************************/
+static void bta_hh_le_index_reports(
+    tBTA_HH_DEV_CB* p_dev_cb, const std::vector<gatt::Service>* services) {
+  p_dev_cb->num_rpt_handles = 0;
+  for (const gatt::Service& service : *services) {
+    for (const gatt::Characteristic& charac : service.characteristics) {
+      tBTA_HH_LE_RPT* p_rpt = bta_hh_le_find_report_entry(
+          p_dev_cb, p_dev_cb->hid_srvc[0].srvc_inst_id, charac.uuid.As16Bit(),
+          charac.value_handle);
+      if (p_rpt == NULL ||
+          p_dev_cb->num_rpt_handles == BTA_HH_LE_RPT_HANDLE_MAX)
+        continue;
+
+      uint8_t xx = p_dev_cb->num_rpt_handles++;
+      for (; xx > 0 &&
+             p_dev_cb->rpt_handles[xx - 1].handle > charac.value_handle;
+           xx--)
+        p_dev_cb->rpt_handles[xx] = p_dev_cb->rpt_handles[xx - 1];
+      p_dev_cb->rpt_handles[xx].handle = charac.value_handle;
+      p_dev_cb->rpt_handles[xx].p_rpt = p_rpt;
+    }
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_hh_le_find_rpt_by_handle
+ *
+ * Description      find the report of a characteristic value handle
+ *
+ ******************************************************************************/
+static tBTA_HH_LE_RPT* bta_hh_le_find_rpt_by_handle(tBTA_HH_DEV_CB* p_dev_cb,
+                                                    uint16_t handle) {
+  uint8_t low = 0, high = p_dev_cb->num_rpt_handles;
+  while (low < high) {
+    uint8_t mid = (low + high) / 2;
+    if (p_dev_cb->rpt_handles[mid].handle < handle)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  if (low < p_dev_cb->num_rpt_handles &&
+      p_dev_cb->rpt_handles[low].handle == handle)
+    return p_dev_cb->rpt_handles[low].p_rpt;
+  return NULL;
+}
+
 /*******************************************************************************
  *
  * Function         bta_hh_le_srvc_search_cmpl
@@ -1561,6 +1685,12 @@ void bta_hh_le_srvc_search_cmpl(tBTA_GATTC_SEARCH_CMPL* p_data) {
       BTA_GATTC_GetServices(p_data->conn_id);
   uint8_t srvc_index = p_dev_cb->cur_srvc_index;
 
+  tBTA_HH_RPT_CACHE_ENTRY* p_rpt_cache = NULL;
+  uint8_t num_rpt = 0;
+  if (p_dev_cb->rpt_cache_valid)
+    p_rpt_cache =
+        bta_hh_le_co_cache_load(p_dev_cb->addr, &num_rpt, p_dev_cb->app_id);
+
   bool have_hid = false;
   tBTA_HH_LE_RPT* p_rpt;
   for (const gatt::Service& service : *services) {
@@ -1575,7 +1705,7 @@ void bta_hh_le_srvc_search_cmpl(tBTA_GATTC_SEARCH_CMPL* p_data) {
       p_dev_cb->hid_srvc[srvc_index].proto_mode_handle = 0;
       p_dev_cb->hid_srvc[srvc_index].control_point_handle = 0;
 
-      bta_hh_le_search_hid_chars(p_dev_cb, &service);
+      bta_hh_le_search_hid_chars(p_dev_cb, &service, p_rpt_cache, num_rpt);
       if (p_dev_cb->cur_srvc_index < BTA_HH_LE_HID_SRVC_MAX-1) {
          p_dev_cb->cur_srvc_index++;
          APPL_TRACE_DEBUG("%s: current service instance  %d", __func__,
@@ -1637,31 +1767,24 @@ void bta_hh_le_srvc_search_cmpl(tBTA_GATTC_SEARCH_CMPL* p_data) {
     }
   }
 
+  bta_hh_le_index_reports(p_dev_cb, services);
   bta_hh_le_gatt_disc_cmpl(p_dev_cb, p_dev_cb->status);
 }
 
 /*******************************************************************************
  *
- * Function         bta_hh_le_input_rpt_notify
+ * Function         bta_hh_le_find_report_by_char
  *
- * Description      process the notificaton event, most likely for input report.
+ * Description      find the report of a notification through the GATT
+ *                  database, handles the scan refresh notification.
  *
- * Parameters:
+ * Returns          the report, NULL if the notification is not for a report
  *
  ******************************************************************************/
-void bta_hh_le_input_rpt_notify(tBTA_GATTC_NOTIFY* p_data) {
-  tBTA_HH_DEV_CB* p_dev_cb = bta_hh_le_find_dev_cb_by_conn_id(p_data->conn_id);
-  uint8_t app_id;
-  uint8_t* p_buf;
+static tBTA_HH_LE_RPT* bta_hh_le_find_report_by_char(
+    tBTA_HH_DEV_CB* p_dev_cb, tBTA_GATTC_NOTIFY* p_data) {
   tBTA_HH_LE_RPT* p_rpt;
 
-  if (p_dev_cb == NULL) {
-    APPL_TRACE_ERROR(
-        "%s: notification received from Unknown device, conn_id: 0x%04x",
-        __func__, p_data->conn_id);
-    return;
-  }
-
   const gatt::Characteristic* p_char =
       BTA_GATTC_GetCharacteristic(p_dev_cb->conn_id, p_data->handle);
   if (p_char == NULL) {
@@ -1669,16 +1792,14 @@ void bta_hh_le_input_rpt_notify(tBTA_GATTC_NOTIFY* p_data) {
         "%s: notification received for Unknown Characteristic, conn_id: "
         "0x%04x, handle: 0x%04x",
         __func__, p_dev_cb->conn_id, p_data->handle);
-    return;
+    return NULL;
   }
 
-  app_id = p_dev_cb->app_id;
-
   if (p_char->uuid.As16Bit()== GATT_UUID_SCAN_REFRESH) {
       APPL_TRACE_DEBUG("Notification received for scan refresh parameters");
       BTA_HhUpdateLeScanParam(p_dev_cb->hid_handle,BTM_BLE_SCAN_SLOW_INT_1,
                                              BTM_BLE_SCAN_SLOW_WIN_1);
-     return;
+     return NULL;
   }
   p_rpt = bta_hh_le_find_report_entry(p_dev_cb, p_dev_cb->hid_srvc[0].srvc_inst_id,
                                       p_char->uuid.As16Bit(), p_char->value_handle);
@@ -1687,12 +1808,45 @@ void bta_hh_le_input_rpt_notify(tBTA_GATTC_NOTIFY* p_data) {
         "%s: notification received for Unknown Report, uuid: %s, handle: "
         "0x%04x",
         __func__, p_char->uuid.ToString().c_str(), p_char->value_handle);
+    return NULL;
+  }
+
+  return p_rpt;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_hh_le_input_rpt_notify
+ *
+ * Description      process the notificaton event, most likely for input report.
+ *
+ * Parameters:
+ *
+ ******************************************************************************/
+void bta_hh_le_input_rpt_notify(tBTA_GATTC_NOTIFY* p_data) {
+  uint64_t received_us = time_get_os_boottime_us();
+  tBTA_HH_DEV_CB* p_dev_cb = bta_hh_le_find_dev_cb_by_conn_id(p_data->conn_id);
+  uint8_t app_id;
+  uint8_t* p_buf;
+  tBTA_HH_LE_RPT* p_rpt;
+
+  if (p_dev_cb == NULL) {
+    APPL_TRACE_ERROR(
+        "%s: notification received from Unknown device, conn_id: 0x%04x",
+        __func__, p_data->conn_id);
     return;
   }
 
-  if (p_char->uuid == Uuid::From16Bit(GATT_UUID_HID_BT_MOUSE_INPUT))
+  app_id = p_dev_cb->app_id;
+
+  /* reports found by the service search need no GATT database lookup */
+  p_rpt = bta_hh_le_find_rpt_by_handle(p_dev_cb, p_data->handle);
+  if (p_rpt == NULL) p_rpt = bta_hh_le_find_report_by_char(p_dev_cb, p_data);
+  if (p_rpt == NULL) return;
+
+  if (p_rpt->uuid == GATT_UUID_HID_BT_MOUSE_INPUT)
     app_id = BTA_HH_APP_ID_MI;
-  else if (p_char->uuid == Uuid::From16Bit(GATT_UUID_HID_BT_KB_INPUT))
+  else if (p_rpt->uuid == GATT_UUID_HID_BT_KB_INPUT)
     app_id = BTA_HH_APP_ID_KB;
 
   APPL_TRACE_DEBUG("%s Notification received on report ID: %d, conn_id: 0x%04x"
@@ -1714,6 +1868,9 @@ void bta_hh_le_input_rpt_notify(tBTA_GATTC_NOTIFY* p_data) {
                  p_dev_cb->dscp_info.ctry_code, p_dev_cb->addr, app_id);
 
   if (p_buf != p_data->value) osi_free(p_buf);
+
+  p_dev_cb->rpt_stats.direct_count++;
+  bta_hh_update_rpt_stats(&p_dev_cb->rpt_stats, received_us);
 }
 
 /*******************************************************************************
@@ -2447,61 +2604,4 @@ static void bta_hh_le_register_scpp_notif_cmpl(tBTA_HH_DEV_CB *p_dev_cb, tGATT_S
   (* bta_hh_cb.p_cback)(cb_evt, (tBTA_HH *)&cback_data);
 }
 
-/*******************************************************************************
- *
- * Function         bta_hh_process_cache_rpt
- *
- * Description      Process the cached reports
- *
- * Parameters:
- *
- ******************************************************************************/
-// TODO(jpawlowski): uncomment when fixed
-// static void bta_hh_process_cache_rpt (tBTA_HH_DEV_CB *p_cb,
-//                                       tBTA_HH_RPT_CACHE_ENTRY *p_rpt_cache,
-//                                       uint8_t num_rpt)
-// {
-//     uint8_t                       i = 0;
-//     tBTA_HH_LE_RPT              *p_rpt;
-
-//     if (num_rpt != 0)  /* no cache is found */
-//     {
-//         p_cb->hid_srvc.in_use = true;
-
-//         /* set the descriptor info */
-//         p_cb->hid_srvc.descriptor.dl_len =
-//                 p_cb->dscp_info.descriptor.dl_len;
-//         p_cb->hid_srvc.descriptor.dsc_list =
-//                     p_cb->dscp_info.descriptor.dsc_list;
-
-//         for (; i <num_rpt; i ++, p_rpt_cache ++)
-//         {
-//             if ((p_rpt = bta_hh_le_find_alloc_report_entry (p_cb,
-//                                                p_rpt_cache->srvc_inst_id,
-//                                                p_rpt_cache->rpt_uuid,
-//                                                p_rpt_cache->char_inst_id,
-//                                                p_rpt_cache->prop))  == NULL)
-//             {
-//                 APPL_TRACE_ERROR("bta_hh_process_cache_rpt: allocation report
-//                 entry failure");
-//                 break;
-//             }
-//             else
-//             {
-//                 p_rpt->rpt_type =  p_rpt_cache->rpt_type;
-//                 p_rpt->rpt_id   =  p_rpt_cache->rpt_id;
-
-//                 if (p_rpt->uuid == GATT_UUID_HID_BT_KB_INPUT ||
-//                     p_rpt->uuid == GATT_UUID_HID_BT_MOUSE_INPUT ||
-//                     (p_rpt->uuid == GATT_UUID_HID_REPORT && p_rpt->rpt_type
-//                     == BTA_HH_RPTT_INPUT))
-//                 {
-//                     p_rpt->client_cfg_value =
-//                     GATT_CLT_CONFIG_NOTIFICATION;
-//                 }
-//             }
-//         }
-//     }
-// }
-
 #endif
@@ -22,6 +22,7 @@
 
 #include "bta_hh_int.h"
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 #include "device/include/interop.h"
 #include "device/include/interop_config.h"
 
@@ -503,6 +504,30 @@ uint8_t bta_hh_dev_handle_to_cb_idx(uint8_t dev_handle) {
 
   return index;
 }
+/*******************************************************************************
+ *
+ * Function         bta_hh_update_rpt_stats
+ *
+ * Description      Account for an input report received at |received_us| and
+ *                  just delivered to the call-out
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_hh_update_rpt_stats(tBTA_HH_RPT_STATS* p_stats,
+                             uint64_t received_us) {
+  uint64_t latency_us = time_get_os_boottime_us() - received_us;
+  uint64_t interval_us = received_us - p_stats->last_report_us;
+  if (p_stats->count > 0 &&
+      (p_stats->min_interval_us == 0 || interval_us < p_stats->min_interval_us))
+    p_stats->min_interval_us = interval_us;
+  p_stats->count++;
+  p_stats->total_latency_us += latency_us;
+  if (latency_us > p_stats->max_latency_us)
+    p_stats->max_latency_us = latency_us;
+  p_stats->last_report_us = received_us;
+}
+
 #if (BTA_HH_DEBUG == TRUE)
 /*******************************************************************************
  *
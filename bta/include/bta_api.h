@@ -1898,5 +1898,17 @@ extern void BTA_VendorCleanup(void);
  ******************************************************************************/
 extern void BTA_DmProcessQueuedServiceDiscovery(void);
 
+/*******************************************************************************
+ *
+ * Function         BTA_DmPmDumpStatistics
+ *
+ * Description      Dump the traffic and the power mode decisions of the
+ *                  connected BR/EDR links
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTA_DmPmDumpStatistics(int fd);
+
 
 #endif /* BTA_API_H */
@@ -588,6 +588,17 @@ typedef struct {
   char avrc_target_name[BTA_SERVICE_NAME_LEN]; /* Default AVRCP target name*/
 } tBTA_AV_CFG;
 
+/* Copy counters of the A2DP source media data path. The encoders write each
+ * frame once in place, the data path only copies RTP fragments and the
+ * duplicates for the other multicast sinks. */
+typedef struct {
+  size_t packets;      /* media packets written to AVDTP */
+  size_t copies;       /* packets the data path had to copy */
+  size_t copied_bytes; /* payload bytes of the copied packets */
+  size_t fanout_packets;    /* multicast duplicates of an encoded packet */
+  size_t fanout_mismatches; /* duplicates to a sink with another codec */
+} tBTA_AV_MEDIA_STATS;
+
 /*****************************************************************************
  *  External Function Declarations
  ****************************************************************************/
@@ -951,6 +962,17 @@ void BTA_AvOffloadStart(tBTA_AV_HNDL hndl, bool do_scrambling);
  *
  ******************************************************************************/
 void BTA_AvOffloadStartRsp(tBTA_AV_HNDL hndl, tBTA_AV_STATUS status);
+
+/*******************************************************************************
+ *
+ * Function         BTA_AvGetMediaStats
+ *
+ * Description      Gets the copy counters of the A2DP source media data path.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTA_AvGetMediaStats(tBTA_AV_MEDIA_STATS* p_stats);
 void BTA_AvUpdateTWSDevice(bool isTwsDevice, tBTA_AV_HNDL hndl);
 void BTA_AVSetEarbudState(uint8_t state, tBTA_AV_HNDL hndl);
 void BTA_AVSetEarbudRole(uint8_t role, tBTA_AV_HNDL hndl);
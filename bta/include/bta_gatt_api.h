@@ -65,6 +65,7 @@ typedef struct {
 #define BTA_GATTC_CONGEST_EVT 24     /* Congestion event */
 #define BTA_GATTC_PHY_UPDATE_EVT 25  /* PHY change event */
 #define BTA_GATTC_CONN_UPDATE_EVT 26 /* Connection parameters update event */
+#define BTA_GATTC_SRVC_CHG_RANGE_EVT 27 /* services changed in a range */
 
 typedef uint8_t tBTA_GATTC_EVT;
 
@@ -201,6 +202,15 @@ typedef struct {
   tGATT_STATUS status;
 } tBTA_GATTC_CONN_UPDATE;
 
+/* Services of the handle range of a service changed indication discovered
+ * again, the rest of the database was kept */
+typedef struct {
+  uint16_t conn_id;
+  RawAddress remote_bda;
+  uint16_t start_handle;
+  uint16_t end_handle;
+} tBTA_GATTC_SRVC_CHG_RANGE;
+
 typedef union {
   tGATT_STATUS status;
 
@@ -219,6 +229,7 @@ typedef union {
   tBTA_GATTC_CONGEST congest;
   tBTA_GATTC_PHY_UPDATE phy_update;
   tBTA_GATTC_CONN_UPDATE conn_update;
+  tBTA_GATTC_SRVC_CHG_RANGE srvc_chg_range;
 } tBTA_GATTC;
 
 /* GATTC enable callback function */
@@ -750,6 +761,18 @@ extern void BTA_GATTC_ReadMultiple(uint16_t conn_id,
  ******************************************************************************/
 extern void BTA_GATTC_Refresh(const RawAddress& remote_bda);
 
+/*******************************************************************************
+ *
+ * Function         BTA_GATTC_DumpStatistics
+ *
+ * Description      Dump where the databases of the connecting servers came
+ *                  from, and the memory the kept databases hold
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTA_GATTC_DumpStatistics(int fd);
+
 /*******************************************************************************
  *
  * Function         BTA_GATTC_ConfigureMTU
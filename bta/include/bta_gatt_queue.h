@@ -31,6 +31,14 @@
  *
  * If you decide to use those methods in your app, make sure to not mix it with
  * existing BTA_GATTC_* API.
+ *
+ * Reads of the same attribute queued one after another are served by a single
+ * read, whose result is passed to each of their callbacks.
+ *
+ * A procedure made of independent operations can add them to a Batch instead
+ * of issuing each from the callback of the previous one. They are all queued
+ * at once and run back to back, and the procedure is called back once with
+ * all of their results.
  */
 class BtaGattQueue {
  public:
@@ -62,7 +70,73 @@ class BtaGattQueue {
     std::vector<uint8_t> value;
   };
 
+  /* Per connection counters, reported when the queue is cleaned */
+  struct gatt_op_stats {
+    uint32_t ops_executed;
+    uint32_t reads_coalesced;
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+  };
+
+  /* Result of an operation of a batch */
+  struct gatt_op_result {
+    tGATT_STATUS status;
+    uint16_t handle;
+    std::vector<uint8_t> value; /* value read, empty for a write */
+  };
+
+  /* Called once all the operations of a batch completed, with their results
+   * in the order the operations were added */
+  typedef void (*GATT_BATCH_CB)(uint16_t conn_id,
+                                std::vector<gatt_op_result>& results,
+                                void* cb_data);
+
+  /* Independent operations on one connection, queued as soon as they are
+   * added and joined into one callback. Batches of several connections run
+   * concurrently.
+   *
+   * Clean() drops the batches of the connection without calling them back,
+   * like the other queued operations.
+   */
+  class Batch {
+   public:
+    explicit Batch(uint16_t conn_id);
+    /* The results of a batch not joined are discarded */
+    ~Batch();
+
+    /* Each returns the index of the result of the operation */
+    size_t ReadCharacteristic(uint16_t handle);
+    size_t ReadDescriptor(uint16_t handle);
+    size_t WriteCharacteristic(uint16_t handle, std::vector<uint8_t> value,
+                               tGATT_WRITE_TYPE write_type);
+    size_t WriteDescriptor(uint16_t handle, std::vector<uint8_t> value,
+                           tGATT_WRITE_TYPE write_type);
+
+    /* Calls |cb| once the operations added completed, right away if they
+     * already did. No operation can be added after. */
+    void Join(GATT_BATCH_CB cb, void* cb_data);
+
+   private:
+    uint16_t conn_id_;
+    uint32_t batch_id_;
+    bool joined_;
+  };
+
  private:
+  struct gatt_batch {
+    uint16_t conn_id;
+    std::vector<gatt_op_result> results;
+    size_t pending;
+    bool joined;
+    GATT_BATCH_CB cb;
+    void* cb_data;
+  };
+
+  struct gatt_batch_op {
+    uint32_t batch_id;
+    size_t index;
+  };
+
   static void mark_as_not_executing(uint16_t conn_id);
   static void gatt_execute_next_op(uint16_t conn_id);
   static void gatt_read_op_finished(uint16_t conn_id, tGATT_STATUS status,
@@ -70,9 +144,25 @@ class BtaGattQueue {
                                     uint8_t* value, void* data);
   static void gatt_write_op_finished(uint16_t conn_id, tGATT_STATUS status,
                                      uint16_t handle, void* data);
+  static void* batch_add_op(uint16_t conn_id, uint32_t batch_id,
+                            uint16_t handle, size_t* index);
+  static void batch_read_op_finished(uint16_t conn_id, tGATT_STATUS status,
+                                     uint16_t handle, uint16_t len,
+                                     uint8_t* value, void* data);
+  static void batch_write_op_finished(uint16_t conn_id, tGATT_STATUS status,
+                                      uint16_t handle, void* data);
+  static void batch_complete_if_done(uint32_t batch_id);
 
   // maps connection id to operations waiting for execution
   static std::unordered_map<uint16_t, std::list<gatt_operation>> gatt_op_queue;
   // contain connection ids that currently execute operations
   static std::unordered_set<uint16_t> gatt_op_queue_executing;
+  // maps connection id to its operation counters
+  static std::unordered_map<uint16_t, gatt_op_stats> gatt_op_queue_stats;
+  // maps batch id to its results
+  static std::unordered_map<uint32_t, gatt_batch> gatt_batches;
+  // maps the id of a batch operation, its callback data, to its result
+  static std::unordered_map<uint32_t, gatt_batch_op> gatt_batch_ops;
+  static uint32_t gatt_batch_next_id;
+  static uint32_t gatt_batch_next_op_id;
 };
\ No newline at end of file
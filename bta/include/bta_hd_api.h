@@ -194,6 +194,32 @@ extern void BTA_HdUnregisterApp(void);
  ******************************************************************************/
 extern void BTA_HdSendReport(tBTA_HD_REPORT* p_report);
 
+/*******************************************************************************
+ *
+ * Function         BTA_HdSendInputReport
+ *
+ * Description      This function is called when input report is to be sent on
+ *                  the interrupt channel. The report is copied once into a
+ *                  buffer given to L2CAP, superseding a report of the same ID
+ *                  not yet sent while the channel is congested.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTA_HdSendInputReport(uint8_t id, uint16_t len,
+                                  const uint8_t* p_data);
+
+/*******************************************************************************
+ *
+ * Function         BTA_HdDumpStatistics
+ *
+ * Description      Dump the statistics of the input reports sent
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTA_HdDumpStatistics(int fd);
+
 /*******************************************************************************
  *
  * Function         BTA_HdVirtualCableUnplug
@@ -59,6 +59,11 @@ struct AudioStats {
   size_t packet_send_count;
   size_t frame_flush_count;
   size_t frame_send_count;
+  // Not enqueued as the device was behind and out of LE CoC credits
+  size_t packet_drop_count;
+  size_t frame_drop_count;
+  // Most packets found still queued from the previous interval
+  size_t queue_depth_max;
   std::deque<rssi_log> rssi_history;
 
   AudioStats() { Reset(); }
@@ -68,6 +73,9 @@ struct AudioStats {
     packet_send_count = 0;
     frame_flush_count = 0;
     frame_send_count = 0;
+    packet_drop_count = 0;
+    frame_drop_count = 0;
+    queue_depth_max = 0;
   }
 };
 
@@ -129,6 +137,9 @@ struct HearingDevice {
   /* This tracks whether the last command to Hearing Aids device is
    * ACKnowledged. */
   bool command_acked;
+  /* Set while L2CAP reports the channel congested. The new audio of a
+   * congested device is dropped, while the other side keeps streaming. */
+  bool congested;
 
   /* When read_rssi_count is > 0, then read the rssi. The interval between rssi
      reads is tracked by num_intervals_since_last_rssi_read. */
@@ -162,6 +173,7 @@ struct HearingDevice {
         codecs(codecs),
         playback_started(false),
         command_acked(false),
+        congested(false),
         read_rssi_count(0) {}
 
   HearingDevice(const RawAddress& address, bool first_connection)
@@ -184,6 +196,7 @@ struct HearingDevice {
         codecs(0),
         playback_started(false),
         command_acked(false),
+        congested(false),
         read_rssi_count(0) {}
 
   HearingDevice() : HearingDevice(RawAddress::kEmpty, false) {}
@@ -485,6 +485,17 @@ extern void BTA_HhSendData(uint8_t dev_handle, const RawAddress& dev_bda,
  ******************************************************************************/
 extern void BTA_HhGetDscpInfo(uint8_t dev_handle);
 
+/*******************************************************************************
+ *
+ * Function         BTA_HhDumpStatistics
+ *
+ * Description      Dump the input report statistics of the connected devices
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTA_HhDumpStatistics(int fd);
+
 /*******************************************************************************
  * Function         BTA_HhAddDev
  *
@@ -32,6 +32,7 @@ typedef struct {
   tBTA_HH_RPT_TYPE rpt_type;
   uint8_t srvc_inst_id;
   uint8_t char_inst_id;
+  uint16_t clt_cfg_value; /* client configuration kept by the bonded device */
 } tBTA_HH_RPT_CACHE_ENTRY;
 
 /*******************************************************************************
@@ -28,6 +28,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <unordered_map>
+
 #include "avct_api.h"
 #include "btu.h"
 #include "avdt_api.h"
@@ -81,6 +83,8 @@ struct fc_channel {
 static struct fc_client* fc_clients;
 static struct fc_channel* fc_channels;
 static uint32_t fc_next_id;
+/* the clients of fc_clients, by id */
+static std::unordered_map<uint32_t, struct fc_client*> fc_clients_by_id;
 
 static void fcchan_conn_chng_cbk(uint16_t chan, const RawAddress& bd_addr,
                                  bool connected, uint16_t reason,
@@ -91,6 +95,8 @@ static void fcchan_data_cbk(uint16_t chan, const RawAddress& bd_addr,
 static tBTA_JV_PCB* bta_jv_add_rfc_port(tBTA_JV_RFC_CB* p_cb,
                                         tBTA_JV_PCB* p_pcb_open);
 static tBTA_JV_STATUS bta_jv_free_set_pm_profile_cb(uint32_t jv_handle);
+static tBTA_JV_PM_CB** bta_jv_pm_cb_link(uint32_t jv_handle,
+                                         tBTA_JV_PCB** pp_pcb);
 static void bta_jv_pm_conn_busy(tBTA_JV_PM_CB* p_cb);
 static void bta_jv_pm_conn_congested(tBTA_JV_PM_CB* p_cb);
 static void bta_jv_pm_conn_idle(tBTA_JV_PM_CB* p_cb);
@@ -456,36 +462,13 @@ static tBTA_JV_STATUS bta_jv_free_set_pm_profile_cb(uint32_t jv_handle) {
         bta_jv_clear_pm_cb(&bta_jv_cb.pm_cb[i], false);
       }
 
-      if (BTA_JV_RFCOMM_MASK & jv_handle) {
-        uint32_t hi =
-            ((jv_handle & BTA_JV_RFC_HDL_MASK) & ~BTA_JV_RFCOMM_MASK) - 1;
-        uint32_t si = BTA_JV_RFC_HDL_TO_SIDX(jv_handle);
-        if (hi < BTA_JV_MAX_RFC_CONN && bta_jv_cb.rfc_cb[hi].p_cback &&
-            si < BTA_JV_MAX_RFC_SR_SESSION &&
-            bta_jv_cb.rfc_cb[hi].rfc_hdl[si]) {
-          tBTA_JV_PCB* p_pcb =
-              bta_jv_rfc_port_to_pcb(bta_jv_cb.rfc_cb[hi].rfc_hdl[si]);
-          if (p_pcb) {
-            if (NULL == p_pcb->p_pm_cb)
-              APPL_TRACE_WARNING(
-                  "%s(jv_handle:"
-                  " 0x%x):port_handle: 0x%x, p_pm_cb: %d: no link to "
-                  "pm_cb?",
-                  __func__, jv_handle, p_pcb->port_handle, i);
-            p_cb = &p_pcb->p_pm_cb;
-          }
-        }
-      } else {
-        if (jv_handle < BTA_JV_MAX_L2C_CONN) {
-          tBTA_JV_L2C_CB* p_l2c_cb = &bta_jv_cb.l2c_cb[jv_handle];
-          if (NULL == p_l2c_cb->p_pm_cb)
-            APPL_TRACE_WARNING(
-                "%s(jv_handle: "
-                "0x%x): p_pm_cb: %d: no link to pm_cb?",
-                __func__, jv_handle, i);
-          p_cb = &p_l2c_cb->p_pm_cb;
-        }
-      }
+      tBTA_JV_PCB* p_pcb;
+      p_cb = bta_jv_pm_cb_link(jv_handle, &p_pcb);
+      if (p_cb && NULL == *p_cb)
+        APPL_TRACE_WARNING(
+            "%s(jv_handle: "
+            "0x%x): p_pm_cb: %d: no link to pm_cb?",
+            __func__, jv_handle, i);
       if (p_cb) {
         *p_cb = NULL;
         status = BTA_JV_SUCCESS;
@@ -495,6 +478,36 @@ static tBTA_JV_STATUS bta_jv_free_set_pm_profile_cb(uint32_t jv_handle) {
   return status;
 }
 
+/*******************************************************************************
+ *
+ * Function    bta_jv_pm_cb_link
+ *
+ * Description find the link to the PM profile control block of the RFCOMM
+ *             port or L2CAP connection of the given JV handle. The handle
+ *             holds the index of its control block, no search is needed.
+ *
+ * Returns     pointer to the link or NULL if the handle is not in use.
+ *             RFCOMM ports are also returned in pp_pcb, NULL otherwise.
+ *
+ ******************************************************************************/
+static tBTA_JV_PM_CB** bta_jv_pm_cb_link(uint32_t jv_handle,
+                                         tBTA_JV_PCB** pp_pcb) {
+  *pp_pcb = NULL;
+
+  if (BTA_JV_RFCOMM_MASK & jv_handle) {
+    uint32_t hi = ((jv_handle & BTA_JV_RFC_HDL_MASK) & ~BTA_JV_RFCOMM_MASK) - 1;
+    uint32_t si = BTA_JV_RFC_HDL_TO_SIDX(jv_handle);
+    if (hi < BTA_JV_MAX_RFC_CONN && bta_jv_cb.rfc_cb[hi].p_cback &&
+        si < BTA_JV_MAX_RFC_SR_SESSION && bta_jv_cb.rfc_cb[hi].rfc_hdl[si]) {
+      *pp_pcb = bta_jv_rfc_port_to_pcb(bta_jv_cb.rfc_cb[hi].rfc_hdl[si]);
+      if (*pp_pcb) return &(*pp_pcb)->p_pm_cb;
+    }
+  } else if (jv_handle < BTA_JV_MAX_L2C_CONN) {
+    return &bta_jv_cb.l2c_cb[jv_handle].p_pm_cb;
+  }
+  return NULL;
+}
+
 /*******************************************************************************
  *
  * Function    bta_jv_alloc_set_pm_profile_cb
@@ -508,45 +521,38 @@ static tBTA_JV_PM_CB* bta_jv_alloc_set_pm_profile_cb(uint32_t jv_handle,
                                                      tBTA_JV_PM_ID app_id) {
   bool bRfcHandle = (jv_handle & BTA_JV_RFCOMM_MASK) != 0;
   RawAddress peer_bd_addr;
-  int i, j;
+  int i;
   tBTA_JV_PM_CB** pp_cb;
+  tBTA_JV_PCB* p_pcb;
 
   for (i = 0; i < BTA_JV_PM_MAX_NUM; i++) {
-    pp_cb = NULL;
-    if (bta_jv_cb.pm_cb[i].state == BTA_JV_PM_FREE_ST) {
-      /* rfc handle bd addr retrieval requires core stack handle */
-      if (bRfcHandle) {
-        for (j = 0; j < BTA_JV_MAX_RFC_CONN; j++) {
-          if (jv_handle == bta_jv_cb.port_cb[j].handle) {
-            pp_cb = &bta_jv_cb.port_cb[j].p_pm_cb;
-            if (PORT_SUCCESS !=
-                PORT_CheckConnection(bta_jv_cb.port_cb[j].port_handle,
-                                     peer_bd_addr, NULL))
-              i = BTA_JV_PM_MAX_NUM;
-            break;
-          }
-        }
-      } else {
-        /* use jv handle for l2cap bd address retrieval */
-        for (j = 0; j < BTA_JV_MAX_L2C_CONN; j++) {
-          if (jv_handle == bta_jv_cb.l2c_cb[j].handle) {
-            pp_cb = &bta_jv_cb.l2c_cb[j].p_pm_cb;
-            const RawAddress* p_bd_addr =
-                GAP_ConnGetRemoteAddr((uint16_t)jv_handle);
-            if (p_bd_addr)
-              peer_bd_addr = *p_bd_addr;
-            else
-              i = BTA_JV_PM_MAX_NUM;
-            break;
-          }
-        }
+    if (bta_jv_cb.pm_cb[i].state == BTA_JV_PM_FREE_ST) break;
+  }
+
+  pp_cb = bta_jv_pm_cb_link(jv_handle, &p_pcb);
+  if (i != BTA_JV_PM_MAX_NUM && NULL != pp_cb) {
+    /* rfc handle bd addr retrieval requires core stack handle */
+    if (bRfcHandle) {
+      if (p_pcb->handle != jv_handle) {
+        pp_cb = NULL;
+      } else if (PORT_SUCCESS != PORT_CheckConnection(p_pcb->port_handle,
+                                                      peer_bd_addr, NULL)) {
+        i = BTA_JV_PM_MAX_NUM;
       }
-      APPL_TRACE_API(
-          "bta_jv_alloc_set_pm_profile_cb(handle 0x%2x, app_id %d): "
-          "idx: %d, (BTA_JV_PM_MAX_NUM: %d), pp_cb: 0x%x",
-          jv_handle, app_id, i, BTA_JV_PM_MAX_NUM, pp_cb);
-      break;
+    } else {
+      /* use jv handle for l2cap bd address retrieval */
+      const RawAddress* p_bd_addr = GAP_ConnGetRemoteAddr((uint16_t)jv_handle);
+      if (jv_handle != bta_jv_cb.l2c_cb[jv_handle].handle)
+        pp_cb = NULL;
+      else if (p_bd_addr)
+        peer_bd_addr = *p_bd_addr;
+      else
+        i = BTA_JV_PM_MAX_NUM;
     }
+    APPL_TRACE_API(
+        "bta_jv_alloc_set_pm_profile_cb(handle 0x%2x, app_id %d): "
+        "idx: %d, (BTA_JV_PM_MAX_NUM: %d), pp_cb: 0x%x",
+        jv_handle, app_id, i, BTA_JV_PM_MAX_NUM, pp_cb);
   }
 
   if ((i != BTA_JV_PM_MAX_NUM) && (NULL != pp_cb)) {
@@ -1453,6 +1459,9 @@ static int bta_jv_port_data_co_cback(uint16_t port_handle, uint8_t* buf,
         return bta_co_rfc_data_outgoing_size(p_pcb->rfcomm_slot_id, (int*)buf);
       case DATA_CO_CALLBACK_TYPE_OUTGOING:
         return bta_co_rfc_data_outgoing(p_pcb->rfcomm_slot_id, buf, len);
+      case DATA_CO_CALLBACK_TYPE_OUTGOING_VEC:
+        return bta_co_rfc_data_outgoing_vec(p_pcb->rfcomm_slot_id,
+                                            (const struct iovec*)buf, len);
       default:
         APPL_TRACE_ERROR("unknown callout type:%d", type);
         break;
@@ -2318,11 +2327,8 @@ static struct fc_client* fcclient_find_by_addr(struct fc_client* start,
 }
 
 static struct fc_client* fcclient_find_by_id(uint32_t id) {
-  struct fc_client* t = fc_clients;
-
-  while (t && t->id != id) t = t->next_all_list;
-
-  return t;
+  auto it = fc_clients_by_id.find(id);
+  return it == fc_clients_by_id.end() ? NULL : it->second;
 }
 
 static struct fc_client* fcclient_alloc(uint16_t chan, char server,
@@ -2357,6 +2363,7 @@ static struct fc_client* fcclient_alloc(uint16_t chan, char server,
   // Link it in to global list
   t->next_all_list = fc_clients;
   fc_clients = t;
+  fc_clients_by_id[t->id] = t;
 
   // Link it in to channel list
   t->next_chan_list = fc->clients;
@@ -2381,6 +2388,7 @@ static void fcclient_free(struct fc_client* fc) {
     t->next_all_list = fc->next_all_list;
   else
     fc_clients = fc->next_all_list;
+  fc_clients_by_id.erase(fc->id);
 
   // remove from channel list
   if (tc) {
@@ -2501,17 +2509,19 @@ static void fcchan_data_cbk(uint16_t chan, const RawAddress& bd_addr,
     t = fcclient_find_by_addr(tc->clients, &bd_addr);
   }
 
-  if (!t) {
+  if (!t || !t->p_cback) {
     // no socket -> drop it
+    osi_free(p_buf);
     return;
   }
 
+  // The socket callback takes the ownership of the buffer
   sock_cback = t->p_cback;
   sock_id = t->l2cap_socket_id;
   evt_data.le_data_ind.handle = t->id;
   evt_data.le_data_ind.p_buf = p_buf;
 
-  if (sock_cback) sock_cback(BTA_JV_L2CAP_DATA_IND_EVT, &evt_data, sock_id);
+  sock_cback(BTA_JV_L2CAP_DATA_IND_EVT, &evt_data, sock_id);
 }
 
 /*******************************************************************************
@@ -227,6 +227,9 @@ extern uint16_t bta_sys_get_sys_features(void);
 extern void bta_sys_sendmsg(void* p_msg);
 extern void do_in_bta_thread(const base::Location& from_here,
                              const base::Closure& task);
+extern void do_in_bta_thread_direct(const base::Location& from_here,
+                                    const base::Closure& task);
+extern void bta_sys_debug_dump(int fd);
 extern void bta_sys_start_timer(alarm_t* alarm, period_ms_t interval,
                                 uint16_t event, uint16_t layer_specific);
 extern void bta_sys_disable(tBTA_SYS_HW_MODULE module);
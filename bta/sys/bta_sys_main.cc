@@ -27,9 +27,13 @@
 #include <base/bind.h>
 #include <base/logging.h>
 #include <base/threading/thread.h>
+#include <inttypes.h>
 #include <pthread.h>
+#include <stdio.h>
 #include <string.h>
 
+#include <atomic>
+
 #include "bt_common.h"
 #include "bta_api.h"
 #include "bta_sys.h"
@@ -40,6 +44,7 @@
 #include "osi/include/fixed_queue.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/task_stats.h"
 #include "osi/include/thread.h"
 #include "utl.h"
 
@@ -60,6 +65,12 @@ uint8_t audio_latency_trace_level = BT_TRACE_LEVEL_WARNING;
 
 static const tBTA_SYS_REG bta_sys_hw_reg = {bta_sys_sm_execute, NULL};
 
+/* Counts of the events and closures sent to the bta thread, by whether they
+ * were posted to it, posted from it, or run right away on it */
+static std::atomic<uint64_t> bta_sys_posted_count;
+static std::atomic<uint64_t> bta_sys_posted_on_thread_count;
+static std::atomic<uint64_t> bta_sys_direct_count;
+
 /* type for action functions */
 typedef void (*tBTA_SYS_ACTION)(tBTA_SYS_HW_MSG* p_data);
 
@@ -515,6 +526,22 @@ void bta_sys_deregister(uint8_t id) { bta_sys_cb.is_reg[id] = false; }
  ******************************************************************************/
 bool bta_sys_is_register(uint8_t id) { return bta_sys_cb.is_reg[id]; }
 
+/*******************************************************************************
+ *
+ * Function         bta_sys_count_post
+ *
+ * Description      Count an event or a closure posted to the bta thread.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_sys_count_post(base::MessageLoop* bta_message_loop) {
+  if (bta_message_loop->task_runner()->BelongsToCurrentThread())
+    bta_sys_posted_on_thread_count++;
+  else
+    bta_sys_posted_count++;
+}
+
 /*******************************************************************************
  *
  * Function         bta_sys_sendmsg
@@ -538,8 +565,13 @@ void bta_sys_sendmsg(void* p_msg) {
     return;
   }
 
+  /* Still posted when sent from the bta thread: the sender may be in the
+   * middle of the state machine that would handle the event. */
+  bta_sys_count_post(bta_message_loop);
   bta_message_loop->task_runner()->PostTask(
-      FROM_HERE, base::Bind(&bta_sys_event, static_cast<BT_HDR*>(p_msg)));
+      FROM_HERE,
+      task_stats_wrap(BTU_MESSAGE_LOOP_NAME, FROM_HERE,
+                      base::Bind(&bta_sys_event, static_cast<BT_HDR*>(p_msg))));
 }
 
 /*******************************************************************************
@@ -560,7 +592,55 @@ void do_in_bta_thread(const base::Location& from_here,
     return;
   }
 
-  bta_message_loop->task_runner()->PostTask(from_here, task);
+  bta_sys_count_post(bta_message_loop);
+  bta_message_loop->task_runner()->PostTask(
+      from_here, task_stats_wrap(BTU_MESSAGE_LOOP_NAME, from_here, task));
+}
+
+/*******************************************************************************
+ *
+ * Function         do_in_bta_thread_direct
+ *
+ * Description      Run a closure right away when called on the bta thread,
+ *                  post it to the bta thread otherwise. Only for closures
+ *                  that do not need the caller to finish first.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void do_in_bta_thread_direct(const base::Location& from_here,
+                             const base::Closure& task) {
+  base::MessageLoop* bta_message_loop = get_message_loop();
+
+  if (!bta_message_loop || !bta_message_loop->task_runner().get()) {
+    APPL_TRACE_ERROR("%s: MessageLooper not initialized", __func__);
+    return;
+  }
+
+  if (bta_message_loop->task_runner()->BelongsToCurrentThread()) {
+    bta_sys_direct_count++;
+    task.Run();
+    return;
+  }
+
+  bta_sys_posted_count++;
+  bta_message_loop->task_runner()->PostTask(
+      from_here, task_stats_wrap(BTU_MESSAGE_LOOP_NAME, from_here, task));
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_sys_timer_cback
+ *
+ * Description      Handle the event of an expired protocol timer. The alarm
+ *                  callback already runs on the bta thread, on its own.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_sys_timer_cback(void* data) {
+  bta_sys_direct_count++;
+  bta_sys_event(static_cast<BT_HDR*>(data));
 }
 
 /*******************************************************************************
@@ -580,7 +660,7 @@ void bta_sys_start_timer(alarm_t* alarm, period_ms_t interval, uint16_t event,
   p_buf->event = event;
   p_buf->layer_specific = layer_specific;
 
-  alarm_set_on_mloop(alarm, interval, bta_sys_sendmsg, p_buf);
+  alarm_set_on_mloop(alarm, interval, bta_sys_timer_cback, p_buf);
 }
 
 /*******************************************************************************
@@ -639,3 +719,25 @@ void bta_sys_set_trace_level(uint8_t level) { appl_trace_level = level; }
  *
  ******************************************************************************/
 uint16_t bta_sys_get_sys_features(void) { return bta_sys_cb.sys_features; }
+
+/*******************************************************************************
+ *
+ * Function         bta_sys_debug_dump
+ *
+ * Description      Dump how the events and closures reached the bta thread.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_sys_debug_dump(int fd) {
+  uint64_t posted = bta_sys_posted_count;
+  uint64_t posted_on_thread = bta_sys_posted_on_thread_count;
+  uint64_t direct = bta_sys_direct_count;
+  uint64_t total = posted + posted_on_thread + direct;
+
+  dprintf(fd, "\nBTA Dispatch:\n");
+  dprintf(fd, "  Posted to the bta thread: %" PRIu64 "\n", posted);
+  dprintf(fd, "  Posted from the bta thread: %" PRIu64 "\n", posted_on_thread);
+  dprintf(fd, "  Run without a hop: %" PRIu64 " (%" PRIu64 "%%)\n", direct,
+          total ? direct * 100 / total : 0);
+}
@@ -0,0 +1,91 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Compile time state tables for the BTA state machines.
+ *
+ ******************************************************************************/
+#ifndef BTA_SYS_SM_H
+#define BTA_SYS_SM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <type_traits>
+
+/* Only called when a state table entry is out of range. Being a call to a
+ * function that is not constexpr, it stops the compilation of the tables. */
+inline void bta_sys_sm_invalid_entry() {}
+
+/*******************************************************************************
+ *
+ * Class            BtaSysStateTables
+ *
+ * Description      The state tables of a state machine with |kStates| states
+ *                  and |kEvents| events, in one array built at compile time.
+ *                  Each state table has a row per event, in the order of the
+ *                  events, with |kActions| actions followed by the next state.
+ *                  The first action equal to the ignore value, the number of
+ *                  actions, ends the actions of a row.
+ *
+ *                  The tables must be constexpr: the number of rows of each
+ *                  table and the range of each entry are checked when they
+ *                  are built, and a bad table fails the compilation.
+ *
+ ******************************************************************************/
+template <size_t kStates, size_t kEvents, size_t kActions>
+class BtaSysStateTables {
+ public:
+  static constexpr size_t kCols = kActions + 1;
+
+  template <typename... Tables>
+  constexpr BtaSysStateTables(uint8_t num_actions, const Tables&... tables)
+      : rows_{} {
+    static_assert(sizeof...(Tables) == kStates, "one state table per state");
+    size_t state = 0;
+    int unused[] = {(Add(state++, num_actions, tables), 0)...};
+    (void)unused;
+  }
+
+  /* The row of |event| in the table of |state| */
+  constexpr const uint8_t* Row(uint8_t state, uint16_t event) const {
+    return rows_[state][event];
+  }
+
+ private:
+  template <typename Table>
+  constexpr void Add(size_t state, uint8_t num_actions, const Table& table) {
+    static_assert(std::extent<Table, 0>::value == kEvents,
+                  "one state table row per event");
+    static_assert(std::extent<Table, 1>::value == kCols,
+                  "one state table column per action and the next state");
+    for (size_t event = 0; event < kEvents; event++) {
+      for (size_t col = 0; col < kActions; col++) {
+        if (table[event][col] > num_actions) bta_sys_sm_invalid_entry();
+        rows_[state][event][col] = table[event][col];
+      }
+      if (table[event][kActions] >= kStates) bta_sys_sm_invalid_entry();
+      rows_[state][event][kActions] = table[event][kActions];
+    }
+  }
+
+  uint8_t rows_[kStates][kEvents][kCols];
+};
+
+#endif /* BTA_SYS_SM_H */
@@ -0,0 +1,121 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "bta/ag/bta_ag_at.h"
+#include "osi/include/osi.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// The commands of the HFP AG table, in its order
+const tBTA_AG_AT_CMD hfp_cmd_tbl[] = {
+    {"A", 1, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
+    {"D", 2, BTA_AG_AT_NONE | BTA_AG_AT_FREE, BTA_AG_AT_STR, 0, 0},
+    {"+VGS", 3, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 15},
+    {"+VGM", 4, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 15},
+    {"+CCWA", 5, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 1},
+    {"+CHLD", 6, BTA_AG_AT_SET | BTA_AG_AT_TEST, BTA_AG_AT_STR, 0, 4},
+    {"+CHUP", 7, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
+    {"+CIND", 8, BTA_AG_AT_READ | BTA_AG_AT_TEST, BTA_AG_AT_STR, 0, 0},
+    {"+CLIP", 9, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 1},
+    {"+CMER", 10, BTA_AG_AT_SET, BTA_AG_AT_STR, 0, 0},
+    {"+VTS", 11, BTA_AG_AT_SET, BTA_AG_AT_STR, 0, 0},
+    {"+BINP", 12, BTA_AG_AT_SET, BTA_AG_AT_INT, 1, 1},
+    {"+BLDN", 13, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
+    {"+BVRA", 14, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 1},
+    {"+BRSF", 15, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 32767},
+    {"+NREC", 16, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 0},
+    {"+CNUM", 17, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
+    {"+BTRH", 18, BTA_AG_AT_READ | BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 2},
+    {"+CLCC", 19, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
+    {"+COPS", 20, BTA_AG_AT_READ | BTA_AG_AT_SET, BTA_AG_AT_STR, 0, 0},
+    {"+CMEE", 21, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 1},
+    {"+BIA", 22, BTA_AG_AT_SET, BTA_AG_AT_STR, 0, 20},
+    {"+CBC", 23, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 100},
+    {"+BCC", 24, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
+    {"+BCS", 25, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 32767},
+    {"+BIND", 26, BTA_AG_AT_SET | BTA_AG_AT_READ | BTA_AG_AT_TEST,
+     BTA_AG_AT_STR, 0, 0},
+    {"+BIEV", 27, BTA_AG_AT_SET, BTA_AG_AT_STR, 0, 0},
+    {"+BAC", 28, BTA_AG_AT_SET, BTA_AG_AT_STR, 0, 0},
+    {"", 0, 0, 0, 0, 0}};
+
+// Traffic of a hands-free unit connecting and handling a call
+const char* const hf_traffic[] = {
+    "AT+BRSF=959\r", "AT+BAC=1,2\r", "AT+CIND=?\r", "AT+CIND?\r",
+    "AT+CMER=3,0,0,1\r", "AT+CHLD=?\r", "AT+BIND=1,2\r", "AT+BIND=?\r",
+    "AT+BIND?\r", "AT+VGS=9\r", "AT+VGM=9\r", "AT+BIA=0,1,1,1,0,1,0\r",
+    "AT+CLIP=1\r", "AT+CCWA=1\r", "AT+CMEE=1\r", "AT+XAPL=ABCD-1234-0100,10\r",
+    "AT+IPHONEACCEV=2,1,7,2,0\r", "ATD5551234;\r", "AT+CLCC\r", "AT+BCS=2\r",
+    "ATA\r", "AT+VGS=12\r", "AT+BIEV=2,80\r", "AT+CHUP\r", "AT+CLCC\r",
+};
+
+size_t commands;
+
+void cmd_cback(UNUSED_ATTR tBTA_AG_SCB* p_user, UNUSED_ATTR uint16_t cmd,
+               UNUSED_ATTR uint8_t arg_type, UNUSED_ATTR char* p_arg,
+               UNUSED_ATTR char* p_end, UNUSED_ATTR int16_t int_arg) {
+  commands++;
+}
+
+void err_cback(UNUSED_ATTR tBTA_AG_SCB* p_user, UNUSED_ATTR bool unknown,
+               UNUSED_ATTR char* p_arg) {
+  commands++;
+}
+
+}  // namespace
+
+// Parses the HF traffic from RFCOMM reads of up to |state.range(0)| bytes,
+// so that from a few to all of the commands arrive in one read.
+static void BM_AgAtParse(State& state) {
+  size_t read_size = state.range(0);
+  std::string traffic;
+  for (const char* cmd : hf_traffic) traffic += cmd;
+  std::vector<char> buf(traffic.begin(), traffic.end());
+
+  tBTA_AG_AT_CB cb;
+  memset(&cb, 0, sizeof(cb));
+  cb.p_at_tbl = (tBTA_AG_AT_CMD*)hfp_cmd_tbl;
+  cb.p_cmd_cback = cmd_cback;
+  cb.p_err_cback = err_cback;
+  cb.cmd_max_len = 512;
+  bta_ag_at_init(&cb);
+
+  commands = 0;
+  for (auto _ : state) {
+    for (size_t pos = 0; pos < buf.size(); pos += read_size) {
+      bta_ag_at_parse(&cb, buf.data() + pos,
+                      std::min(read_size, buf.size() - pos));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * buf.size());
+  state.SetItemsProcessed(commands);
+  bta_ag_at_reinit(&cb);
+}
+BENCHMARK(BM_AgAtParse)->Arg(1)->Arg(7)->Arg(32)->Arg(127)->Arg(512);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,184 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "bta/ag/bta_ag_at.h"
+#include "osi/include/osi.h"
+
+namespace {
+
+enum { CMD_A = 1, CMD_D, CMD_VGS, CMD_CIND, CMD_CLCC, CMD_CL, CMD_BIA };
+
+const tBTA_AG_AT_CMD test_cmd_tbl[] = {
+    {"A", CMD_A, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
+    {"D", CMD_D, BTA_AG_AT_NONE | BTA_AG_AT_FREE, BTA_AG_AT_STR, 0, 0},
+    {"+VGS", CMD_VGS, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 15},
+    {"+CIND", CMD_CIND, BTA_AG_AT_READ | BTA_AG_AT_TEST, BTA_AG_AT_STR, 0, 0},
+    {"+CLCC", CMD_CLCC, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
+    {"+CL", CMD_CL, BTA_AG_AT_SET, BTA_AG_AT_STR, 0, 0},
+    {"+BIA", CMD_BIA, BTA_AG_AT_SET, BTA_AG_AT_STR, 0, 20},
+    {"", 0, 0, 0, 0, 0}};
+
+// The same commands with the shorter one first, which then always wins
+const tBTA_AG_AT_CMD prefix_first_cmd_tbl[] = {
+    {"+CL", CMD_CL, BTA_AG_AT_SET | BTA_AG_AT_FREE, BTA_AG_AT_STR, 0, 0},
+    {"+CLCC", CMD_CLCC, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
+    {"", 0, 0, 0, 0, 0}};
+
+// Traffic of a hands-free unit connecting and handling a call
+const char* const hf_traffic[] = {
+    "AT+BRSF=959\r", "AT+BAC=1,2\r", "AT+CIND=?\r", "AT+CIND?\r",
+    "AT+CMER=3,0,0,1\r", "AT+CHLD=?\r", "AT+VGS=9\r", "AT+VGM=9\r",
+    "AT+BIA=0,1,1,1,0,1,0\r", "AT+CLIP=1\r", "AT+CCWA=1\r", "AT+CMEE=1\r",
+    "ATD5551234;\r", "AT+CLCC\r", "AT+BIND=1,2\r", "ATA\r", "AT+CHUP\r",
+    "at+vgs=3\r", "AT+XAPL=ABCD-1234-0100,10\r",
+};
+
+std::vector<std::string> events;
+
+void cmd_cback(UNUSED_ATTR tBTA_AG_SCB* p_user, uint16_t command_id,
+               uint8_t arg_type, char* p_arg, char* p_end, int16_t int_arg) {
+  EXPECT_EQ(0, *p_end);
+  events.push_back(std::to_string(command_id) + "/" +
+                   std::to_string(arg_type) + "/" + p_arg + "/" +
+                   std::to_string(int_arg));
+}
+
+void err_cback(UNUSED_ATTR tBTA_AG_SCB* p_user, bool unknown, char* p_arg) {
+  events.push_back(std::string("error/") + (unknown ? "unknown/" : "bad/") +
+                   (p_arg ? p_arg : ""));
+}
+
+}  // namespace
+
+class BtaAgAtTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    events.clear();
+    memset(&cb_, 0, sizeof(cb_));
+    cb_.p_at_tbl = (tBTA_AG_AT_CMD*)test_cmd_tbl;
+    cb_.p_cmd_cback = cmd_cback;
+    cb_.p_err_cback = err_cback;
+    cb_.cmd_max_len = 64;
+    bta_ag_at_init(&cb_);
+  }
+
+  void TearDown() override { bta_ag_at_reinit(&cb_); }
+
+  void parse(std::string data) {
+    std::vector<char> buf(data.begin(), data.end());
+    bta_ag_at_parse(&cb_, buf.data(), buf.size());
+    // The commands are parsed in place, but the data is left as it was
+    EXPECT_EQ(data, std::string(buf.begin(), buf.end()));
+  }
+
+  tBTA_AG_AT_CB cb_;
+};
+
+TEST_F(BtaAgAtTest, parses_pipelined_commands) {
+  parse("AT+VGS=5\rAT+CIND?\r\nATD123;\rATA\r");
+  std::vector<std::string> expected = {"3/2/5/5", "4/4/?/0", "2/16/123;/0",
+                                       "1/1//0"};
+  EXPECT_EQ(expected, events);
+}
+
+TEST_F(BtaAgAtTest, parses_commands_split_over_reads) {
+  parse("AT+V");
+  parse("GS=1");
+  EXPECT_TRUE(events.empty());
+  parse("1\rAT+CI");
+  parse("ND=?\r");
+  std::vector<std::string> expected = {"3/2/11/11", "4/8/=?/0"};
+  EXPECT_EQ(expected, events);
+}
+
+TEST_F(BtaAgAtTest, matches_commands_ignoring_case) {
+  parse("at+vgs=2\raT+cLcC\r");
+  std::vector<std::string> expected = {"3/2/2/2", "5/1//0"};
+  EXPECT_EQ(expected, events);
+}
+
+TEST_F(BtaAgAtTest, reports_errors) {
+  parse("AT+XYZ=1\rAT+VGS=16\rAT+VGS?\rAT+CL\x1A");
+  std::vector<std::string> expected = {"error/unknown/+XYZ=1", "error/bad/",
+                                       "error/bad/", "error/unknown/AT+CL\x1A"};
+  EXPECT_EQ(expected, events);
+}
+
+TEST_F(BtaAgAtTest, first_table_entry_wins) {
+  parse("AT+CLCC\rAT+CL=1\r");
+  std::vector<std::string> expected = {"5/1//0", "6/2/1/0"};
+  EXPECT_EQ(expected, events);
+
+  events.clear();
+  cb_.p_at_tbl = (tBTA_AG_AT_CMD*)prefix_first_cmd_tbl;
+  parse("AT+CLCC\rAT+CL=1\r");
+  expected = {"6/16/CC/0", "6/2/1/0"};
+  EXPECT_EQ(expected, events);
+}
+
+TEST_F(BtaAgAtTest, too_long_commands_are_dropped) {
+  parse("AT+BIA=" + std::string(100, '1') + "\rAT+VGS=4\r");
+  EXPECT_EQ("3/2/4/4", events.back());
+}
+
+TEST_F(BtaAgAtTest, random_reads_parse_as_single_characters) {
+  uint32_t seed = 1;
+  auto next = [&seed]() {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+  };
+
+  for (int round = 0; round < 200; round++) {
+    std::string data;
+    while (data.size() < 400) {
+      uint32_t r = next();
+      if (r % 8 == 0) {
+        // Noise, with line ends, nulls and control characters
+        for (uint32_t n = next() % 8; n > 0; n--) {
+          const char noise[] = "AT+=?,;\r\n\x1A\x1B\0aZ9";
+          data += noise[next() % (sizeof(noise) - 1)];
+        }
+      } else {
+        data += hf_traffic[r % (sizeof(hf_traffic) / sizeof(hf_traffic[0]))];
+      }
+    }
+
+    // One character at a time never holds a whole command to parse in place
+    SetUp();
+    for (char c : data) parse(std::string(1, c));
+    std::vector<std::string> expected = events;
+    TearDown();
+
+    SetUp();
+    for (size_t pos = 0; pos < data.size();) {
+      size_t len = std::min<size_t>(1 + next() % 128, data.size() - pos);
+      parse(data.substr(pos, len));
+      pos += len;
+    }
+    EXPECT_EQ(expected, events) << "round " << round;
+    TearDown();
+  }
+}
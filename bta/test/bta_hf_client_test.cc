@@ -18,6 +18,9 @@
 
 #include <gtest/gtest.h>
 
+#include <string>
+#include <vector>
+
 #include "bta/hf_client/bta_hf_client_int.h"
 #include "bta/include/bta_hf_client_api.h"
 
@@ -30,6 +33,28 @@ base::MessageLoop* get_message_loop() { return NULL; }
 namespace {
 const RawAddress bdaddr1({0x11, 0x22, 0x33, 0x44, 0x55, 0x66});
 const RawAddress bdaddr2({0x66, 0x55, 0x44, 0x33, 0x22, 0x11});
+
+std::vector<std::string> events;
+
+void record_event(tBTA_HF_CLIENT_EVT event, tBTA_HF_CLIENT* p_data) {
+  std::string evt = std::to_string(event);
+  switch (event) {
+    case BTA_HF_CLIENT_CLIP_EVT:
+      evt += std::string("/") + p_data->number.number;
+      break;
+    case BTA_HF_CLIENT_CLCC_EVT:
+      evt += "/" + std::to_string(p_data->clcc.idx) + "/" +
+             p_data->clcc.number;
+      break;
+    case BTA_HF_CLIENT_UNKNOWN_EVT:
+      evt += std::string("/") + p_data->unknown.event_string;
+      break;
+    default:
+      evt += "/" + std::to_string(p_data->val.value);
+      break;
+  }
+  events.push_back(evt);
+}
 }  // namespace
 
 // TODO(jpawlowski): there is some weird dependency issue in tests, and the
@@ -92,3 +117,70 @@ TEST_F(BtaHfClientTest, test_allocate_block_diff_device) {
   EXPECT_GT(p_handle_second, 0);
   EXPECT_NE(p_handle_first, p_handle_second);
 }
+
+class BtaHfClientAtTest : public BtaHfClientTest {
+ protected:
+  void SetUp() override {
+    BtaHfClientTest::SetUp();
+    events.clear();
+    bta_hf_client_cb_arr.p_cback = record_event;
+    client_cb_ = &bta_hf_client_cb_arr.cb[0];
+    client_cb_->svc_conn = true;
+  }
+
+  // Passes |data| to the parser as read from RFCOMM, nul terminated
+  void parse(std::string data) {
+    std::vector<char> buf(data.begin(), data.end());
+    buf.push_back('\0');
+    bta_hf_client_at_parse(client_cb_, buf.data(), data.size());
+    EXPECT_EQ(data, std::string(buf.data(), data.size()));
+  }
+
+  tBTA_HF_CLIENT_CB* client_cb_;
+};
+
+const char* const at_events[] = {
+    "\r\nRING\r\n",
+    "\r\n+VGS: 7\r\n",
+    "\r\n+VGM=3\r\n",
+    "\r\n+CLIP: \"5551234\",129\r\n",
+    "\r\n+BSIR: 1\r\n",
+    "\r\n+CLCC: 1,1,4,0,0,\"5551234\",129\r\n",
+    "\r\n+CLCC: 2,0,1,0,0,\"5554321\",129\r\n",
+    "\r\n+XYZ: 1\r\n",
+    "\r\n+VGSX\r\n",
+};
+
+// Test that all the events of one read are dispatched to their parsers
+TEST_F(BtaHfClientAtTest, test_parse_events_of_one_read) {
+  std::string data;
+  for (const char* event : at_events) data += event;
+  parse(data);
+  std::vector<std::string> expected = {
+      std::to_string(BTA_HF_CLIENT_RING_INDICATION) + "/0",
+      std::to_string(BTA_HF_CLIENT_SPK_EVT) + "/7",
+      std::to_string(BTA_HF_CLIENT_MIC_EVT) + "/3",
+      std::to_string(BTA_HF_CLIENT_CLIP_EVT) + "/5551234",
+      std::to_string(BTA_HF_CLIENT_BSIR_EVT) + "/1",
+      std::to_string(BTA_HF_CLIENT_CLCC_EVT) + "/1/5551234",
+      std::to_string(BTA_HF_CLIENT_CLCC_EVT) + "/2/5554321",
+      std::to_string(BTA_HF_CLIENT_UNKNOWN_EVT) + "/+XYZ: 1",
+      std::to_string(BTA_HF_CLIENT_UNKNOWN_EVT) + "/+VGSX"};
+  EXPECT_EQ(expected, events);
+}
+
+// Test that events split over reads are parsed as those of one read
+TEST_F(BtaHfClientAtTest, test_parse_events_split_over_reads) {
+  std::string data;
+  for (const char* event : at_events) data += event;
+  parse(data);
+  std::vector<std::string> expected = events;
+
+  events.clear();
+  for (const char* event : at_events) {
+    std::string evt(event);
+    parse(evt.substr(0, evt.size() / 2));
+    parse(evt.substr(evt.size() / 2));
+  }
+  EXPECT_EQ(expected, events);
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <vector>
+
+#include "bta_gatt_queue.h"
+
+using gatt_op_result = BtaGattQueue::gatt_op_result;
+
+uint8_t appl_trace_level = BT_TRACE_LEVEL_NONE;
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+
+namespace {
+
+// Operations sent to BTA, completed by the tests in order
+struct bta_op {
+  uint16_t conn_id;
+  uint16_t handle;
+  GATT_READ_OP_CB read_cb;
+  GATT_WRITE_OP_CB write_cb;
+  void* cb_data;
+};
+std::deque<bta_op> bta_ops;
+
+void complete_op(tGATT_STATUS status, std::vector<uint8_t> value = {}) {
+  bta_op op = bta_ops.front();
+  bta_ops.pop_front();
+  if (op.read_cb)
+    op.read_cb(op.conn_id, status, op.handle, value.size(), value.data(),
+               op.cb_data);
+  else
+    op.write_cb(op.conn_id, status, op.handle, op.cb_data);
+}
+
+size_t batch_calls;
+std::vector<gatt_op_result> batch_results;
+
+void batch_cb(uint16_t conn_id, std::vector<gatt_op_result>& results,
+              void* cb_data) {
+  batch_calls++;
+  batch_results = results;
+}
+
+}  // namespace
+
+void BTA_GATTC_ReadCharacteristic(uint16_t conn_id, uint16_t handle,
+                                  tGATT_AUTH_REQ auth_req,
+                                  GATT_READ_OP_CB callback, void* cb_data) {
+  bta_ops.push_back({conn_id, handle, callback, nullptr, cb_data});
+}
+
+void BTA_GATTC_ReadCharDescr(uint16_t conn_id, uint16_t handle,
+                             tGATT_AUTH_REQ auth_req, GATT_READ_OP_CB callback,
+                             void* cb_data) {
+  bta_ops.push_back({conn_id, handle, callback, nullptr, cb_data});
+}
+
+void BTA_GATTC_WriteCharValue(uint16_t conn_id, uint16_t handle,
+                              tGATT_WRITE_TYPE write_type,
+                              std::vector<uint8_t> value,
+                              tGATT_AUTH_REQ auth_req,
+                              GATT_WRITE_OP_CB callback, void* cb_data) {
+  bta_ops.push_back({conn_id, handle, nullptr, callback, cb_data});
+}
+
+void BTA_GATTC_WriteCharDescr(uint16_t conn_id, uint16_t handle,
+                              std::vector<uint8_t> value,
+                              tGATT_AUTH_REQ auth_req,
+                              GATT_WRITE_OP_CB callback, void* cb_data) {
+  bta_ops.push_back({conn_id, handle, nullptr, callback, cb_data});
+}
+
+class BtaGattQueueBatchTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    bta_ops.clear();
+    batch_calls = 0;
+    batch_results.clear();
+  }
+
+  void TearDown() override {
+    BtaGattQueue::Clean(1);
+    BtaGattQueue::Clean(2);
+  }
+};
+
+TEST_F(BtaGattQueueBatchTest, test_joins_results_in_order) {
+  BtaGattQueue::Batch batch(1);
+  EXPECT_EQ(0u, batch.ReadCharacteristic(0x10));
+  EXPECT_EQ(1u, batch.ReadDescriptor(0x20));
+  EXPECT_EQ(2u, batch.WriteCharacteristic(0x30, {0x01}, GATT_WRITE));
+  batch.Join(batch_cb, nullptr);
+
+  // The queue still runs one operation at a time on the connection
+  ASSERT_EQ(1u, bta_ops.size());
+  complete_op(GATT_SUCCESS, {0xaa, 0xbb});
+  complete_op(GATT_INSUF_AUTHENTICATION);
+  EXPECT_EQ(0u, batch_calls);
+  complete_op(GATT_SUCCESS);
+
+  EXPECT_EQ(1u, batch_calls);
+  ASSERT_EQ(3u, batch_results.size());
+  EXPECT_EQ(GATT_SUCCESS, batch_results[0].status);
+  EXPECT_EQ(0x10, batch_results[0].handle);
+  EXPECT_EQ(std::vector<uint8_t>({0xaa, 0xbb}), batch_results[0].value);
+  EXPECT_EQ(GATT_INSUF_AUTHENTICATION, batch_results[1].status);
+  EXPECT_TRUE(batch_results[1].value.empty());
+  EXPECT_EQ(GATT_SUCCESS, batch_results[2].status);
+  EXPECT_EQ(0x30, batch_results[2].handle);
+}
+
+TEST_F(BtaGattQueueBatchTest, test_batches_run_concurrently) {
+  BtaGattQueue::Batch first(1);
+  BtaGattQueue::Batch second(2);
+  first.ReadCharacteristic(0x10);
+  second.ReadCharacteristic(0x10);
+  first.Join(batch_cb, nullptr);
+  second.Join(batch_cb, nullptr);
+
+  // One operation of each connection is in progress
+  ASSERT_EQ(2u, bta_ops.size());
+  EXPECT_EQ(1, bta_ops[0].conn_id);
+  EXPECT_EQ(2, bta_ops[1].conn_id);
+  complete_op(GATT_SUCCESS);
+  complete_op(GATT_SUCCESS);
+  EXPECT_EQ(2u, batch_calls);
+}
+
+TEST_F(BtaGattQueueBatchTest, test_joins_right_away_when_done) {
+  BtaGattQueue::Batch batch(1);
+  batch.ReadCharacteristic(0x10);
+  complete_op(GATT_SUCCESS, {0x01});
+  EXPECT_EQ(0u, batch_calls);
+
+  batch.Join(batch_cb, nullptr);
+  EXPECT_EQ(1u, batch_calls);
+  ASSERT_EQ(1u, batch_results.size());
+  EXPECT_EQ(std::vector<uint8_t>({0x01}), batch_results[0].value);
+}
+
+TEST_F(BtaGattQueueBatchTest, test_clean_drops_batch) {
+  BtaGattQueue::Batch batch(1);
+  batch.ReadCharacteristic(0x10);
+  batch.ReadCharacteristic(0x20);
+  batch.Join(batch_cb, nullptr);
+
+  BtaGattQueue::Clean(1);
+  ASSERT_EQ(1u, bta_ops.size());
+  complete_op(GATT_SUCCESS);
+
+  EXPECT_EQ(0u, batch_calls);
+  EXPECT_TRUE(bta_ops.empty());
+}
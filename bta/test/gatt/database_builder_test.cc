@@ -162,4 +162,76 @@ TEST(DatabaseBuilderTest, SecondaryServiceOutOfOrderTest) {
   EXPECT_EQ(result.Services()[4].is_primary, true);
 }
 
+/* This test verifies that DatabaseBuilder explores all services at once,
+ * resolving the included services whose definition comes before the secondary
+ * service holding it is known. */
+TEST(DatabaseBuilderTest, DatabaseExplorationTest) {
+  DatabaseBuilder builder;
+
+  EXPECT_FALSE(builder.StartDatabaseExploration());
+
+  builder.AddService(0x0001, 0x000f, SERVICE_1_UUID, true);
+  builder.AddService(0x0030, 0x003f, SERVICE_3_UUID, true);
+
+  EXPECT_TRUE(builder.StartDatabaseExploration());
+  EXPECT_EQ(builder.CurrentlyExploredService(), make_pair_u16(0x0001, 0xffff));
+
+  // Included services come in handle order, the first one is in a secondary
+  // service defined by the second one
+  builder.AddIncludedService(0x0021, SERVICE_4_UUID, 0x0040, 0x004f);
+  builder.AddIncludedService(0x0031, SERVICE_2_UUID, 0x0020, 0x002f);
+
+  builder.AddCharacteristic(0x0002, 0x0003, SERVICE_1_CHAR_1_UUID, 0x02);
+  builder.AddCharacteristic(0x0022, 0x0023, SERVICE_1_CHAR_1_UUID, 0x02);
+  builder.AddCharacteristic(0x0042, 0x0043, SERVICE_1_CHAR_1_UUID, 0x02);
+
+  // Descriptors are explored in all services
+  EXPECT_EQ(builder.NextDescriptorRangeToExplore(),
+            make_pair_u16(0x0004, 0x000f));
+  EXPECT_EQ(builder.NextDescriptorRangeToExplore(),
+            make_pair_u16(0x0024, 0x002f));
+  EXPECT_EQ(builder.NextDescriptorRangeToExplore(),
+            make_pair_u16(0x0044, 0x004f));
+  EXPECT_EQ(builder.NextDescriptorRangeToExplore(),
+            DatabaseBuilder::EXPLORE_END);
+
+  // Secondary services are not explored again
+  EXPECT_FALSE(builder.StartNextServiceExploration());
+
+  Database result = builder.Build();
+  ASSERT_EQ(result.Services().size(), 4u);
+  EXPECT_EQ(result.Services()[1].handle, 0x0020);
+  EXPECT_EQ(result.Services()[1].is_primary, false);
+  ASSERT_EQ(result.Services()[1].included_services.size(), 1u);
+  EXPECT_EQ(result.Services()[1].included_services[0].start_handle, 0x0040);
+  EXPECT_EQ(result.Services()[2].included_services[0].start_handle, 0x0020);
+  EXPECT_EQ(result.Services()[3].handle, 0x0040);
+  EXPECT_EQ(result.Services()[3].characteristics[0].value_handle, 0x0043);
+}
+
+/* This test verifies that exploring the services of a handle range only, as
+ * after a service changed indication, leaves the other services out. */
+TEST(DatabaseBuilderTest, DatabaseRangeExplorationTest) {
+  DatabaseBuilder builder;
+
+  builder.AddService(0x0010, 0x001f, SERVICE_1_UUID, true);
+  builder.AddService(0x0020, 0x002f, SERVICE_3_UUID, true);
+
+  EXPECT_TRUE(builder.StartDatabaseExploration(0x0010, 0x002f));
+  EXPECT_EQ(builder.CurrentlyExploredService(), make_pair_u16(0x0010, 0x002f));
+
+  // A secondary service out of the range is included
+  builder.AddIncludedService(0x0021, SERVICE_2_UUID, 0x0040, 0x004f);
+  builder.AddCharacteristic(0x0012, 0x0013, SERVICE_1_CHAR_1_UUID, 0x02);
+  builder.AddCharacteristic(0x0022, 0x0023, SERVICE_1_CHAR_1_UUID, 0x02);
+
+  // Only the descriptors of the services in the range are explored
+  EXPECT_EQ(builder.NextDescriptorRangeToExplore(),
+            make_pair_u16(0x0014, 0x001f));
+  EXPECT_EQ(builder.NextDescriptorRangeToExplore(),
+            make_pair_u16(0x0024, 0x002f));
+  EXPECT_EQ(builder.NextDescriptorRangeToExplore(),
+            DatabaseBuilder::EXPLORE_END);
+}
+
 }  // namespace gatt
\ No newline at end of file
@@ -84,6 +84,108 @@ TEST(GattDatabaseTest, serialize_deserialize_binary_test) {
   EXPECT_EQ(serialized[4].type, SERVICE_1_CHAR_1_DESC_1_UUID);
 }
 
+/* This test makes sure that a database is restored the same from attributes
+ * in place, as they are in a mapped cache file, and that it is copied whole */
+TEST(GattDatabaseTest, deserialize_in_place_test) {
+  DatabaseBuilder builder;
+  builder.AddService(0x0001, 0x000f, SERVICE_1_UUID, true);
+  builder.AddCharacteristic(0x0003, 0x0004, SERVICE_1_CHAR_1_UUID, 0x02);
+  builder.AddDescriptor(0x0005, SERVICE_1_CHAR_1_DESC_1_UUID);
+
+  Database built = builder.Build();
+  std::vector<StoredAttribute> serialized = built.Serialize();
+  bool success = false;
+  Database restored =
+      Database::Deserialize(serialized.data(), serialized.size(), &success);
+  EXPECT_TRUE(success);
+  EXPECT_EQ(restored.ToString(), built.ToString());
+
+  Database copy = restored;
+  restored.Clear();
+  ASSERT_EQ(copy.Services().size(), 1UL);
+  EXPECT_EQ(copy.FindDescriptor(0x0005),
+            &copy.Services()[0].characteristics[0].descriptors[0]);
+}
+
+/* This test makes sure that handle lookups find the right attribute, both in a
+ * built database and in a deserialized one */
+TEST(GattDatabaseTest, find_by_handle_test) {
+  DatabaseBuilder builder;
+  builder.AddService(0x0001, 0x000f, SERVICE_1_UUID, true);
+  builder.AddService(0x0020, 0x002f, SERVICE_2_UUID, true);
+  builder.AddCharacteristic(0x0003, 0x0004, SERVICE_1_CHAR_1_UUID, 0x02);
+  builder.AddDescriptor(0x0005, SERVICE_1_CHAR_1_DESC_1_UUID);
+  builder.AddCharacteristic(0x0021, 0x0022, SERVICE_1_CHAR_1_UUID, 0x10);
+  builder.AddDescriptor(0x0023, SERVICE_1_CHAR_1_DESC_1_UUID);
+  builder.AddDescriptor(0x0024, SERVICE_1_CHAR_1_DESC_1_UUID);
+
+  Database built = builder.Build();
+  bool success = false;
+  Database restored = Database::Deserialize(built.Serialize(), &success);
+  EXPECT_TRUE(success);
+
+  for (const Database* db : {&built, &restored}) {
+    const std::vector<Service>& services = db->Services();
+    ASSERT_EQ(services.size(), 2UL);
+
+    EXPECT_EQ(db->FindService(0x0001), &services[0]);
+    EXPECT_EQ(db->FindService(0x000f), &services[0]);
+    EXPECT_EQ(db->FindService(0x0010), nullptr);
+    EXPECT_EQ(db->FindService(0x0024), &services[1]);
+    EXPECT_EQ(db->FindService(0x0030), nullptr);
+
+    const Characteristic& char_2 = services[1].characteristics[0];
+    EXPECT_EQ(db->FindCharacteristic(0x0004),
+              &services[0].characteristics[0]);
+    EXPECT_EQ(db->FindCharacteristic(0x0022), &char_2);
+    EXPECT_EQ(db->FindCharacteristic(0x0021), nullptr);
+    EXPECT_EQ(db->FindCharacteristic(0x0023), nullptr);
+
+    EXPECT_EQ(db->FindDescriptor(0x0023), &char_2.descriptors[0]);
+    EXPECT_EQ(db->FindDescriptor(0x0024), &char_2.descriptors[1]);
+    EXPECT_EQ(db->FindDescriptor(0x0022), nullptr);
+    EXPECT_EQ(db->FindOwningCharacteristic(0x0024), &char_2);
+    EXPECT_EQ(db->FindOwningCharacteristic(0x0004), nullptr);
+  }
+
+  built.Clear();
+  EXPECT_EQ(built.FindService(0x0001), nullptr);
+  EXPECT_EQ(built.FindCharacteristic(0x0004), nullptr);
+}
+
+/* This test makes sure that replacing a handle range keeps the services
+ * outside of it, and that lookups find the services spliced in */
+TEST(GattDatabaseTest, replace_range_test) {
+  DatabaseBuilder builder;
+  builder.AddService(0x0001, 0x000f, SERVICE_1_UUID, true);
+  builder.AddService(0x0010, 0x001f, SERVICE_2_UUID, true);
+  builder.AddService(0x0030, 0x003f, SERVICE_1_UUID, true);
+  builder.AddCharacteristic(0x0031, 0x0032, SERVICE_1_CHAR_1_UUID, 0x02);
+  Database database = builder.Build();
+
+  // The second service moved, another one is added after it. The service
+  // outside of the range is dropped.
+  builder.AddService(0x0001, 0x000f, SERVICE_2_UUID, true);
+  builder.AddService(0x0018, 0x001f, SERVICE_2_UUID, true);
+  builder.AddService(0x0020, 0x002f, SERVICE_1_UUID, true);
+  builder.AddCharacteristic(0x0021, 0x0022, SERVICE_1_CHAR_1_UUID, 0x10);
+  database.ReplaceRange(0x0010, 0x002f, builder.Build());
+
+  const std::vector<Service>& services = database.Services();
+  ASSERT_EQ(services.size(), 4UL);
+  EXPECT_EQ(services[0].uuid, SERVICE_1_UUID);
+  EXPECT_EQ(services[1].handle, 0x0018);
+  EXPECT_EQ(services[2].handle, 0x0020);
+  EXPECT_EQ(services[3].handle, 0x0030);
+
+  EXPECT_EQ(database.FindService(0x0010), nullptr);
+  EXPECT_EQ(database.FindService(0x0025), &services[2]);
+  EXPECT_EQ(database.FindCharacteristic(0x0022),
+            &services[2].characteristics[0]);
+  EXPECT_EQ(database.FindCharacteristic(0x0032),
+            &services[3].characteristics[0]);
+}
+
 /* This test makes sure that Service represented in StoredAttribute have proper
  * binary format. */
 TEST(GattCacheTest, stored_attribute_to_binary_service_test) {
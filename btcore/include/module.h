@@ -19,6 +19,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "osi/include/future.h"
 #include "osi/include/thread.h"
@@ -57,6 +58,20 @@ void module_shut_down(const module_t* module);
 // If not initialized, does nothing.
 void module_clean_up(const module_t* module);
 
+// Initialize the |count| provided |modules| concurrently, each one on its own
+// thread once the modules of |modules| named in its dependencies are
+// initialized. Returns false if any of them failed to initialize or their
+// dependencies are circular; the modules initialized stay so.
+bool module_init_parallel(const module_t* const* modules, size_t count);
+// Start up the |count| provided |modules| concurrently, each one on its own
+// thread once the modules of |modules| named in its dependencies are started.
+// Returns false if any of them failed to start up or their dependencies are
+// circular; the modules started stay so.
+bool module_start_up_parallel(const module_t* const* modules, size_t count);
+
+// Dumps how long the lifecycle functions of each module took to |fd|.
+void module_debug_dump(int fd);
+
 // Temporary callbacked wrapper for module start up, so real modules can be
 // spliced into the current janky startup sequence. Runs on a separate thread,
 // which terminates when the module start up has finished. When module startup
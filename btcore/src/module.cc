@@ -22,13 +22,19 @@
 #include <dlfcn.h>
 #include <string.h>
 
+#include <inttypes.h>
+#include <stdio.h>
+
 #include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "btcore/include/module.h"
 #include "osi/include/allocator.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 
 typedef enum {
   MODULE_STATE_NONE = 0,
@@ -41,12 +47,28 @@ typedef enum {
 
 static std::unordered_map<const module_t*, module_state_t> metadata;
 
+// How long the last lifecycle calls of a module took, kept across
+// module_management_stop for the dumpsys
+typedef struct {
+  const char* name;
+  period_ms_t init_ms;
+  period_ms_t start_up_ms;
+  period_ms_t shut_down_ms;
+  size_t start_ups;
+} module_timing_t;
+
+static std::vector<module_timing_t> timings;
+static std::mutex timings_mutex;
+
 // TODO(jamuraa): remove this lock after the startup sequence is clean
 static std::mutex metadata_mutex;
 
 static bool call_lifecycle_function(module_lifecycle_fn function);
 static module_state_t get_module_state(const module_t* module);
 static void set_module_state(const module_t* module, module_state_t state);
+static bool call_timed_lifecycle_function(const module_t* module,
+                                          module_lifecycle_fn function,
+                                          period_ms_t module_timing_t::*field);
 
 void module_management_start(void) {}
 
@@ -64,7 +86,8 @@ bool module_init(const module_t* module) {
   CHECK(module != NULL);
   CHECK(get_module_state(module) == MODULE_STATE_NONE);
 
-  if (!call_lifecycle_function(module->init)) {
+  if (!call_timed_lifecycle_function(module, module->init,
+                                     &module_timing_t::init_ms)) {
     LOG_ERROR(LOG_TAG, "%s Failed to initialize module \"%s\"", __func__,
               module->name);
     return false;
@@ -86,7 +109,8 @@ bool module_start_up(const module_t* module) {
 
   LOG_INFO(LOG_TAG, "%s Starting module \"%s\"", __func__, module->name);
   set_module_state(module, MODULE_STATE_STARTING);
-  if (!call_lifecycle_function(module->start_up)) {
+  if (!call_timed_lifecycle_function(module, module->start_up,
+                                     &module_timing_t::start_up_ms)) {
     LOG_ERROR(LOG_TAG, "%s Failed to start up module \"%s\"", __func__,
               module->name);
     set_module_state(module, MODULE_STATE_STARTUP_ERROR);
@@ -109,7 +133,8 @@ void module_shut_down(const module_t* module) {
   }
   LOG_INFO(LOG_TAG, "%s Shutting down module \"%s\"", __func__, module->name);
   set_module_state(module, MODULE_STATE_SHUTTINGDOWN);
-  if (!call_lifecycle_function(module->shut_down)) {
+  if (!call_timed_lifecycle_function(module, module->shut_down,
+                                     &module_timing_t::shut_down_ms)) {
     LOG_ERROR(LOG_TAG,
               "%s Failed to shutdown module \"%s\". Continuing anyway.",
               __func__, module->name);
@@ -152,6 +177,107 @@ static bool call_lifecycle_function(module_lifecycle_fn function) {
   return future_await(future);
 }
 
+// Runs |step| on each of the |count| |modules|, in waves of the modules whose
+// dependencies within |modules| have gone through |step| already. The
+// modules of a wave run concurrently, one thread each.
+static bool run_parallel(const module_t* const* modules, size_t count,
+                         bool (*step)(const module_t*)) {
+  std::vector<bool> done(count, false);
+  size_t num_done = 0;
+  bool success = true;
+
+  while (num_done < count) {
+    std::vector<size_t> wave;
+    for (size_t i = 0; i < count; i++) {
+      if (done[i]) continue;
+
+      bool ready = true;
+      for (size_t d = 0; ready && d < BTCORE_MAX_MODULE_DEPENDENCIES &&
+                         modules[i]->dependencies[d];
+           d++) {
+        for (size_t j = 0; j < count; j++) {
+          if (!done[j] &&
+              !strcmp(modules[j]->name, modules[i]->dependencies[d])) {
+            ready = false;
+            break;
+          }
+        }
+      }
+      if (ready) wave.push_back(i);
+    }
+
+    if (wave.empty()) {
+      LOG_ERROR(LOG_TAG, "%s circular dependencies between %zu modules",
+                __func__, count - num_done);
+      return false;
+    }
+
+    std::vector<std::thread> threads;
+    std::vector<char> results(wave.size(), false);
+    for (size_t w = 1; w < wave.size(); w++) {
+      threads.emplace_back([step, modules, &wave, &results, w]() {
+        results[w] = step(modules[wave[w]]);
+      });
+    }
+    // The first module of the wave runs on the calling thread
+    results[0] = step(modules[wave[0]]);
+    for (std::thread& thread : threads) thread.join();
+
+    for (size_t w = 0; w < wave.size(); w++) {
+      if (!results[w]) success = false;
+      done[wave[w]] = true;
+    }
+    num_done += wave.size();
+  }
+
+  return success;
+}
+
+bool module_init_parallel(const module_t* const* modules, size_t count) {
+  CHECK(modules != NULL || count == 0);
+  return run_parallel(modules, count, module_init);
+}
+
+bool module_start_up_parallel(const module_t* const* modules, size_t count) {
+  CHECK(modules != NULL || count == 0);
+  return run_parallel(modules, count, module_start_up);
+}
+
+void module_debug_dump(int fd) {
+  std::lock_guard<std::mutex> lock(timings_mutex);
+
+  dprintf(fd, "\nModule lifecycle timings (ms):\n");
+  dprintf(fd, "  %-24s %8s %8s %8s %8s\n", "module", "init", "start_up",
+          "shut_down", "starts");
+  for (const module_timing_t& timing : timings) {
+    dprintf(fd,
+            "  %-24s %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8zu\n",
+            timing.name, timing.init_ms, timing.start_up_ms,
+            timing.shut_down_ms, timing.start_ups);
+  }
+}
+
+static bool call_timed_lifecycle_function(const module_t* module,
+                                          module_lifecycle_fn function,
+                                          period_ms_t module_timing_t::*field) {
+  uint32_t start_ms = time_get_os_boottime_ms();
+  bool success = call_lifecycle_function(function);
+  uint32_t elapsed_ms = time_get_os_boottime_ms() - start_ms;
+
+  std::lock_guard<std::mutex> lock(timings_mutex);
+  module_timing_t* p_timing = NULL;
+  for (module_timing_t& timing : timings) {
+    if (!strcmp(timing.name, module->name)) p_timing = &timing;
+  }
+  if (p_timing == NULL) {
+    timings.push_back({module->name, 0, 0, 0, 0});
+    p_timing = &timings.back();
+  }
+  p_timing->*field = elapsed_ms;
+  if (field == &module_timing_t::start_up_ms) p_timing->start_ups++;
+  return success;
+}
+
 static module_state_t get_module_state(const module_t* module) {
   std::lock_guard<std::mutex> lock(metadata_mutex);
   auto map_ptr = metadata.find(module);
@@ -0,0 +1,138 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "btcore/include/module.h"
+
+namespace {
+
+std::atomic<int> sequence;
+int first_init_order;
+int second_init_order;
+int dependent_init_order;
+std::atomic<int> running;
+std::atomic<int> max_running;
+
+void run_for_a_while() {
+  int now_running = ++running;
+  int max = max_running;
+  while (now_running > max &&
+         !max_running.compare_exchange_weak(max, now_running)) {
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  running--;
+}
+
+future_t* first_init() {
+  run_for_a_while();
+  first_init_order = sequence++;
+  return NULL;
+}
+
+future_t* second_init() {
+  run_for_a_while();
+  second_init_order = sequence++;
+  return NULL;
+}
+
+future_t* dependent_init() {
+  dependent_init_order = sequence++;
+  return NULL;
+}
+
+future_t* failing_start_up() { return future_new_immediate(FUTURE_FAIL); }
+
+const module_t first_module = {.name = "first_module",
+                               .init = first_init,
+                               .start_up = NULL,
+                               .shut_down = NULL,
+                               .clean_up = NULL,
+                               .dependencies = {NULL}};
+
+const module_t second_module = {.name = "second_module",
+                                .init = second_init,
+                                .start_up = failing_start_up,
+                                .shut_down = NULL,
+                                .clean_up = NULL,
+                                .dependencies = {NULL}};
+
+const module_t dependent_module = {
+    .name = "dependent_module",
+    .init = dependent_init,
+    .start_up = NULL,
+    .shut_down = NULL,
+    .clean_up = NULL,
+    .dependencies = {"first_module", "second_module", NULL}};
+
+const module_t loop_a_module = {.name = "loop_a_module",
+                                .init = NULL,
+                                .start_up = NULL,
+                                .shut_down = NULL,
+                                .clean_up = NULL,
+                                .dependencies = {"loop_b_module", NULL}};
+
+const module_t loop_b_module = {.name = "loop_b_module",
+                                .init = NULL,
+                                .start_up = NULL,
+                                .shut_down = NULL,
+                                .clean_up = NULL,
+                                .dependencies = {"loop_a_module", NULL}};
+
+}  // namespace
+
+class ModuleTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    module_management_start();
+    sequence = 0;
+    running = 0;
+    max_running = 0;
+  }
+
+  void TearDown() override { module_management_stop(); }
+};
+
+TEST_F(ModuleTest, init_parallel_runs_independent_modules_together) {
+  // Listed before its dependencies on purpose
+  const module_t* modules[] = {&dependent_module, &first_module,
+                               &second_module};
+
+  EXPECT_TRUE(module_init_parallel(modules, 3));
+  EXPECT_EQ(2, max_running);
+  EXPECT_EQ(2, dependent_init_order);
+  EXPECT_LT(first_init_order, 2);
+  EXPECT_LT(second_init_order, 2);
+}
+
+TEST_F(ModuleTest, start_up_parallel_reports_failures) {
+  const module_t* modules[] = {&first_module, &second_module};
+
+  ASSERT_TRUE(module_init_parallel(modules, 2));
+  EXPECT_FALSE(module_start_up_parallel(modules, 2));
+}
+
+TEST_F(ModuleTest, init_parallel_rejects_circular_dependencies) {
+  const module_t* modules[] = {&loop_a_module, &loop_b_module};
+
+  EXPECT_FALSE(module_init_parallel(modules, 2));
+}
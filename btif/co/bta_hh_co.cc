@@ -41,7 +41,7 @@ const char* dev_path = "/dev/uhid";
 
 #if (BTA_HH_LE_INCLUDED == TRUE)
 #include "btif_config.h"
-#define BTA_HH_NV_LOAD_MAX 16
+#define BTA_HH_NV_LOAD_MAX 20
 static tBTA_HH_RPT_CACHE_ENTRY sReportCache[BTA_HH_NV_LOAD_MAX];
 #endif
 #define BT_HID_RPT_OFFSET 9
@@ -828,15 +828,15 @@ void bta_hh_le_co_rpt_info(const RawAddress& remote_bda,
   std::string addrstr = remote_bda.ToString();
   const char* bdstr = addrstr.c_str();
 
-  size_t len = btif_config_get_bin_length(bdstr, "HidReport");
+  size_t len = btif_config_get_bin_length(bdstr, "HidReportCache");
   if (len >= sizeof(tBTA_HH_RPT_CACHE_ENTRY) && len <= sizeof(sReportCache)) {
-    btif_config_get_bin(bdstr, "HidReport", (uint8_t*)sReportCache, &len);
+    btif_config_get_bin(bdstr, "HidReportCache", (uint8_t*)sReportCache, &len);
     idx = len / sizeof(tBTA_HH_RPT_CACHE_ENTRY);
   }
 
   if (idx < BTA_HH_NV_LOAD_MAX) {
     memcpy(&sReportCache[idx++], p_entry, sizeof(tBTA_HH_RPT_CACHE_ENTRY));
-    btif_config_set_bin(bdstr, "HidReport", (const uint8_t*)sReportCache,
+    btif_config_set_bin(bdstr, "HidReportCache", (const uint8_t*)sReportCache,
                         idx * sizeof(tBTA_HH_RPT_CACHE_ENTRY));
     BTIF_TRACE_DEBUG("%s() - Saving report; dev=%s, idx=%d", __func__, bdstr,
                      idx);
@@ -865,11 +865,13 @@ tBTA_HH_RPT_CACHE_ENTRY* bta_hh_le_co_cache_load(const RawAddress& remote_bda,
   std::string addrstr = remote_bda.ToString();
   const char* bdstr = addrstr.c_str();
 
-  size_t len = btif_config_get_bin_length(bdstr, "HidReport");
-  if (!p_num_rpt || len < sizeof(tBTA_HH_RPT_CACHE_ENTRY)) return NULL;
+  size_t len = btif_config_get_bin_length(bdstr, "HidReportCache");
+  if (!p_num_rpt || len < sizeof(tBTA_HH_RPT_CACHE_ENTRY) ||
+      len % sizeof(tBTA_HH_RPT_CACHE_ENTRY) != 0)
+    return NULL;
 
   if (len > sizeof(sReportCache)) len = sizeof(sReportCache);
-  btif_config_get_bin(bdstr, "HidReport", (uint8_t*)sReportCache, &len);
+  btif_config_get_bin(bdstr, "HidReportCache", (uint8_t*)sReportCache, &len);
   *p_num_rpt = len / sizeof(tBTA_HH_RPT_CACHE_ENTRY);
 
   BTIF_TRACE_DEBUG("%s() - Loaded %d reports; dev=%s", __func__, *p_num_rpt,
@@ -894,6 +896,8 @@ void bta_hh_le_co_reset_rpt_cache(const RawAddress& remote_bda,
   std::string addrstr = remote_bda.ToString();
   const char* bdstr = addrstr.c_str();
 
+  btif_config_remove(bdstr, "HidReportCache");
+  /* written by the releases which never loaded it back */
   btif_config_remove(bdstr, "HidReport");
 
   BTIF_TRACE_DEBUG("%s() - Reset cache for bda %s", __func__, bdstr);
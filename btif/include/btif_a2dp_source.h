@@ -55,6 +55,7 @@
 
 #include <stdbool.h>
 
+#include "a2dp_link_policy.h"
 #include "bta_av_api.h"
 
 typedef struct {
@@ -66,6 +67,14 @@ typedef struct {
   bool start_reset;
 } tBTIF_A2DP_SOURCE_VSC;
 
+// Bucket i of the scheduling jitter histogram counts the deviations below
+// (100 << i) us, the last bucket counts the larger ones.
+#define BTIF_A2DP_SOURCE_JITTER_BUCKETS 10
+
+// Bucket i of the TX queue age histogram counts the packets sent after less
+// than (1 << i) ms in the queue, the last bucket counts the older ones.
+#define BTIF_A2DP_SOURCE_QUEUE_AGE_BUCKETS 10
+
 typedef struct {
   // Counter for total updates
   size_t total_updates;
@@ -96,6 +105,9 @@ typedef struct {
 
   // Accumulated and counted scheduling time (in us)
   uint64_t total_scheduling_time_us;
+
+  // Histogram of the scheduling deviations, for the jitter percentiles
+  size_t jitter_histogram[BTIF_A2DP_SOURCE_JITTER_BUCKETS];
 } scheduling_stats_t;
 
 typedef struct {
@@ -110,6 +122,8 @@ typedef struct {
 
   uint64_t tx_queue_total_queueing_time_us;
   uint64_t tx_queue_max_queueing_time_us;
+  // Histogram of the queueing times of the sent packets
+  size_t tx_queue_age_histogram[BTIF_A2DP_SOURCE_QUEUE_AGE_BUCKETS];
 
   size_t tx_queue_total_readbuf_calls;
   uint64_t tx_queue_last_readbuf_us;
@@ -120,10 +134,16 @@ typedef struct {
   size_t tx_queue_max_dropped_messages;
   size_t tx_queue_dropouts;
   uint64_t tx_queue_last_dropouts_us;
+  // Packets dropped for being older than the latency target
+  size_t tx_queue_total_expired_messages;
+  uint64_t tx_queue_last_expired_us;
 
   size_t media_read_total_underflow_bytes;
   size_t media_read_total_underflow_count;
   uint64_t media_read_last_underflow_us;
+
+  size_t media_read_total_overrun_count;
+  uint64_t media_read_last_overrun_us;
 } btif_media_stats_t;
 
 typedef struct {
@@ -136,6 +156,18 @@ typedef struct {
   alarm_t *remote_start_alarm;
   const tA2DP_ENCODER_INTERFACE* encoder_interface;
   period_ms_t encoder_interval_ms; /* Local copy of the encoder interval */
+  /* What the encoder was last initialized with, see encoder_init_event */
+  const A2dpCodecConfig* encoder_codec_config;
+  btav_a2dp_codec_config_t encoder_config;
+  uint8_t encoder_codec_info[AVDT_CODEC_SIZE];
+  tA2DP_ENCODER_INIT_PEER_PARAMS encoder_peer_params;
+  bool tick_pll_enabled;    /* Encoder ticks follow the tick clock below */
+  uint64_t tick_clock_ns;   /* Tick clock, jitter filtered boottime */
+  uint64_t tick_period_ns;  /* Estimated period of the media alarm */
+  uint64_t last_link_quality_read_us; /* Last link read for ABR and policy */
+  bool link_policy_enabled; /* Adapt the packet types and flush timeout */
+  tA2DP_LINK_POLICY link_policy;
+  RawAddress link_policy_peer; /* Peer the link policy decides for */
   btif_media_stats_t stats;
   btif_media_stats_t accumulated_stats;
   int last_remote_started_index;
@@ -178,6 +210,12 @@ void btif_a2dp_source_cancel_unblock_audio_start(void);
 // This function should be called prior to starting A2DP streaming.
 bt_status_t btif_a2dp_source_setup_codec(tBTA_AV_HNDL handle);
 
+// Prepare the encoder of the A2DP Source codec ahead of the stream start, so
+// that it is ready when btif_a2dp_source_setup_codec() is called.
+// This function should be called when reconfiguring the codec of a stream
+// about to restart, while the start is negotiated with the peer.
+void btif_a2dp_source_encoder_prepare(tBTA_AV_HNDL handle);
+
 // Process a request to start the A2DP audio encoding task.
 void btif_a2dp_source_start_audio_req(void);
 
@@ -508,4 +508,15 @@ bt_status_t btif_config_hci_snoop_log(uint8_t enable);
  ******************************************************************************/
 void btif_debug_bond_event_dump(int fd);
 
+/*******************************************************************************
+ *
+ * Function         btif_debug_discovery_dump
+ *
+ * Description     Dump the time taken to find devices in the last discovery
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btif_debug_discovery_dump(int fd);
+
 #endif /* BTIF_API_H */
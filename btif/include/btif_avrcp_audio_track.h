@@ -42,6 +42,13 @@ void* BtifAvrcpAudioTrackCreate(int trackFreq, int channelType);
  */
 int BtifAvrcpAudioTrackLatency(void* handle);
 
+/**
+ * Gets the number of frames written to the audio track that it has not played
+ * yet, as seen from its playback position. Returns -1 while the position is
+ * not known.
+ */
+int BtifAvrcpAudioTrackGetBufferedFrames(void* handle);
+
 /**
  * Starts the audio track.
  */
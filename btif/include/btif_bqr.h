@@ -81,6 +81,13 @@ static constexpr int8_t kCriWarnRssi = -80;
 static constexpr uint8_t kCriWarnUnusedCh = 55;
 // The queue size of recording the BQR events.
 static constexpr uint8_t kBqrEventQueueSize = 25;
+// The number of in-stack link quality subscribers.
+static constexpr uint8_t kMaxLinkQualityCallbacks = 4;
+// The number of connections with rolling link quality aggregates.
+static constexpr uint8_t kMaxLinkQualityAggregates = 8;
+// Time (in ms) without report after which the aggregates of a connection
+// start over, so that a reused connection handle does not inherit them.
+static constexpr uint32_t kLinkQualityAggregateExpiryMs = 30000;
 // The Property of BQR event mask configuration.
 static constexpr const char* kpPropertyEventMask =
     "persist.bluetooth.bqr.event_mask";
@@ -240,6 +247,69 @@ class BqrVseSubEvt {
   bool IsEvtToBeParsed(uint8_t quality_report_id);
 };
 
+// Parsed Bluetooth Quality Report delivered to the in-stack subscribers.
+struct BqrLinkQuality {
+  uint8_t quality_report_id;
+  uint8_t packet_types;
+  uint16_t connection_handle;
+  int8_t rssi;
+  uint8_t snr;
+  uint8_t unused_afh_channel_count;
+  uint8_t afh_select_unideal_channel_count;
+  // Counts since the previous report of the connection.
+  uint32_t retransmission_count;
+  uint32_t no_rx_count;
+  uint32_t nak_count;
+  uint32_t flow_off_count;
+  uint32_t buffer_overflow_bytes;
+  uint32_t buffer_underflow_bytes;
+  // Boot time of receiving the report.
+  uint64_t timestamp_ms;
+  // The report meets the RSSI or the unused AFH channel warning criteria.
+  bool warning;
+};
+
+// Rolling aggregates of the reports of one connection. The averages move by
+// 1/8 of the difference with each new report.
+struct BqrLinkQualityAggregate {
+  uint16_t connection_handle;
+  uint32_t report_count;
+  uint32_t warning_count;
+  uint32_t a2dp_choppy_count;
+  uint32_t sco_choppy_count;
+  int8_t rssi_average;
+  uint8_t snr_average;
+  uint8_t unused_afh_channel_average;
+  // Average counts per report.
+  uint32_t retransmission_average;
+  uint32_t nak_average;
+  uint64_t first_report_ms;
+  uint64_t last_report_ms;
+};
+
+// Called on the thread receiving the vendor event of each parsed report, with
+// the aggregates of its connection updated with it. It must be quick and may
+// not (un)register subscribers.
+typedef void (*BqrLinkQualityCallback)(
+    const BqrLinkQuality& report, const BqrLinkQualityAggregate& aggregate,
+    void* context);
+
+// Subscribe |callback| with |context| to the parsed reports.
+//
+// @return false If there is no room for another subscriber.
+bool RegisterLinkQualityCallback(BqrLinkQualityCallback callback,
+                                 void* context);
+
+// Unsubscribe |callback| registered with |context|.
+void UnregisterLinkQualityCallback(BqrLinkQualityCallback callback,
+                                   void* context);
+
+// Get the rolling aggregates of the connection |connection_handle|.
+//
+// @return false If the connection had no recent report.
+bool GetLinkQualityAggregate(uint16_t connection_handle,
+                             BqrLinkQualityAggregate* p_aggregate);
+
 // Get a string representation of the Quality Report ID.
 //
 // @param quality_report_id The quality report ID to convert.
@@ -26,6 +26,8 @@
 #include <base/location.h>
 #include <hardware/bluetooth.h>
 
+#include <memory>
+
 #include "bt_types.h"
 #include "bta_api.h"
 #include "osi/include/log.h"
@@ -177,6 +179,19 @@ typedef struct {
 extern bt_status_t do_in_jni_thread(const base::Closure& task);
 extern bt_status_t do_in_jni_thread(const base::Location& from_here,
                                     const base::Closure& task);
+/**
+ * This template moves |payload| to the jni thread and runs |task| with it
+ * there. Unlike btif_transfer_context, the payload is handed over as is, so
+ * whatever it owns is not copied.
+ */
+template <typename T>
+bt_status_t do_in_jni_thread(const base::Location& from_here,
+                             void (*task)(std::unique_ptr<T>),
+                             std::unique_ptr<T> payload) {
+  return do_in_jni_thread(from_here,
+                          base::Bind(task, base::Passed(std::move(payload))));
+}
+
 /**
  * This template wraps callback into callback that will be executed on jni
  * thread
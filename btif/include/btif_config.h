@@ -61,6 +61,11 @@ bool btif_config_remove(const char* section, const char* key);
 
 size_t btif_config_get_bin_length(const char* section, const char* key);
 
+// Reads all the keys stored in the keystore, so that they are cached before
+// they are needed. Must be called on the JNI thread, once the keystore is
+// ready.
+void btif_config_load_encrypted_keys(void);
+
 const btif_config_section_iter_t* btif_config_section_begin(void);
 const btif_config_section_iter_t* btif_config_section_end(void);
 const btif_config_section_iter_t* btif_config_section_next(
@@ -32,4 +32,29 @@ void btif_debug_conn_state(const RawAddress& bda,
                            const btif_debug_conn_state_t state,
                            const tGATT_DISCONN_REASON disconnect_reason);
 
+// Milestones of a connection setup, in the order they usually happen
+typedef enum {
+  BTIF_DEBUG_CONN_ACL_CREATE = 0,
+  BTIF_DEBUG_CONN_ACL_CONNECTED,
+  BTIF_DEBUG_CONN_REMOTE_FEATURES,
+  BTIF_DEBUG_CONN_ENCRYPTED,
+  BTIF_DEBUG_CONN_DISCOVERY_START,
+  BTIF_DEBUG_CONN_DISCOVERY_END,
+  BTIF_DEBUG_CONN_PROFILE_CONNECTED,
+  BTIF_DEBUG_CONN_MILESTONE_MAX
+} btif_debug_conn_milestone_t;
+
+// Report a connection setup milestone of the link to |bda|.
+// BTIF_DEBUG_CONN_ACL_CREATE, or BTIF_DEBUG_CONN_ACL_CONNECTED for a link
+// the peer created, starts the timeline of a link. The other milestones are
+// only recorded the first time they happen on that timeline.
+void btif_debug_conn_milestone(const RawAddress& bda,
+                               const btif_debug_conn_milestone_t milestone);
+
+// Report a change of the ACL packet types and of the automatic flush timeout
+// (in ms) of the link to |bda|, made by the link policy named |policy|, a
+// string that must outlive the process.
+void btif_debug_conn_link_policy(const RawAddress& bda, const char* policy,
+                                 uint16_t pkt_types, uint16_t flush_tout);
+
 void btif_debug_conn_dump(int fd);
@@ -71,6 +71,18 @@ typedef struct {
   RawAddress eth_addr;
 } btpan_conn_t;
 
+typedef struct {
+  size_t tap_read_frames;    // Frames read from the TAP driver
+  size_t tap_read_bytes;     // Ethernet payload bytes of those frames
+  size_t tap_read_batches;   // Wakeups of the TAP reader with a frame
+  size_t tap_read_max_batch; // Most frames read in a single wakeup
+  size_t tap_read_dropped;   // Frames not forwarded to any connection
+  size_t tap_read_congested; // Frames refused by a full BNEP queue
+  size_t tap_write_frames;   // Frames written to the TAP driver
+  size_t tap_write_bytes;    // Ethernet payload bytes of those frames
+  size_t tap_write_errors;   // Frames the TAP driver did not take
+} btpan_stats_t;
+
 typedef struct {
   int btl_if_handle;
   int btl_if_handle_panu;
@@ -79,8 +91,7 @@ typedef struct {
   int open_count;
   int flow;  // 1: outbound data flow on; 0: outbound data flow off
   btpan_conn_t conns[MAX_PAN_CONNS];
-  int congest_packet_size;
-  unsigned char congest_packet[1600];  // max ethernet packet size
+  btpan_stats_t stats;
 } btpan_cb_t;
 
 /*******************************************************************************
@@ -34,6 +34,32 @@ void uid_set_destroy(uid_set_t* set);
 void uid_set_add_tx(uid_set_t* set, int32_t app_uid, uint64_t bytes);
 void uid_set_add_rx(uid_set_t* set, int32_t app_uid, uint64_t bytes);
 
+/**
+ * Traffic of one socket of a UID, counted without taking the lock of the UID
+ * set. The counters are folded into the set by uid_set_read_and_clear().
+ */
+struct uid_set_counter_t;
+typedef struct uid_set_counter_t uid_set_counter_t;
+
+/**
+ * Returns a counter for a socket of |app_uid| in |set|, or NULL if the
+ * traffic of |app_uid| is not tracked. The counter must be released with
+ * uid_set_counter_release() before |set| is destroyed.
+ */
+uid_set_counter_t* uid_set_counter_create(uid_set_t* set, int32_t app_uid);
+
+/**
+ * Folds what |counter| counted into its UID set and frees it. |counter| may
+ * be NULL.
+ */
+void uid_set_counter_release(uid_set_counter_t* counter);
+
+/**
+ * Add |bytes| to |counter|, which may be NULL. Safe to call from any thread.
+ */
+void uid_set_counter_add_tx(uid_set_counter_t* counter, uint64_t bytes);
+void uid_set_counter_add_rx(uid_set_counter_t* counter, uint64_t bytes);
+
 /**
  * Returns an array of bt_uid_traffic_t structs, where the end of the array
  * is signaled by an element with app_uid == -1.
@@ -54,12 +54,18 @@
 #include <hardware/bt_ba.h>
 #include <hardware/bt_vendor_rc.h>
 #include "bt_utils.h"
+#include "bta/include/bta_gatt_api.h"
+#include "bta/include/bta_hd_api.h"
 #include "bta/include/bta_hearing_aid_api.h"
 #include "bta/include/bta_hf_client_api.h"
+#include "bta/include/bta_hh_api.h"
+#include "bta/sys/bta_sys.h"
+#include "btcore/include/module.h"
 #include "btif/include/btif_debug_btsnoop.h"
 #include "btif/include/btif_debug_conn.h"
 #include "btif_a2dp.h"
 #include "btif_hf.h"
+#include "btif_pan.h"
 #include "btif_api.h"
 #include "btif_bqr.h"
 #include "btif_config.h"
@@ -72,18 +78,32 @@
 #include "btsnoop_mem.h"
 #include "common/address_obfuscator.h"
 #include "device/include/interop.h"
+#include "hci/include/hci_layer.h"
 #include "osi/include/alarm.h"
 #include "osi/include/allocation_tracker.h"
 #include "osi/include/log.h"
+#include "osi/include/memory_governor.h"
 #include "osi/include/metrics.h"
 #include "osi/include/osi.h"
+#include "osi/include/task_stats.h"
 #include "osi/include/wakelock.h"
 #include "stack/gatt/connection_manager.h"
+#include "stack/include/btm_ble_api.h"
+#include "stack/include/btu.h"
+#include "stack/include/l2c_api.h"
+#include "stack/include/port_api.h"
 #include "stack_manager.h"
 
 
 using bluetooth::hearing_aid::HearingAidInterface;
 
+/* Time the wakelock stays held after its last user released it, so that
+ * alarms and profiles waking up soon after do not cost an OS release and
+ * acquire each */
+#ifndef BTIF_WAKELOCK_RELEASE_HOLDOFF_MS
+#define BTIF_WAKELOCK_RELEASE_HOLDOFF_MS 500
+#endif
+
 /*******************************************************************************
  *  Static variables
  ******************************************************************************/
@@ -172,6 +192,7 @@ static int init(bt_callbacks_t* callbacks, bool start_restricted,
 
   bt_hal_cbacks = callbacks;
   restricted_mode = start_restricted;
+  wakelock_set_release_holdoff(BTIF_WAKELOCK_RELEASE_HOLDOFF_MS);
   is_local_device_atv = is_atv;
   niap_mode = is_niap_mode;
   niap_config_compare_result = config_compare_result;
@@ -356,18 +377,36 @@ static void dump(int fd, const char** arguments) {
   }
   btif_debug_conn_dump(fd);
   btif_debug_bond_event_dump(fd);
+  btif_debug_discovery_dump(fd);
   btif_debug_a2dp_dump(fd);
+  btif_pan_debug_dump(fd);
   btif_debug_config_dump(fd);
 #if (BT_IOT_LOGGING_ENABLED == TRUE)
   device_debug_iot_config_dump(fd);
 #endif
   BTA_HfClientDumpStatistics(fd);
+  BTA_HhDumpStatistics(fd);
+  BTA_HdDumpStatistics(fd);
+  BTA_GATTC_DumpStatistics(fd);
+  BTA_DmPmDumpStatistics(fd);
   wakelock_debug_dump(fd);
   osi_allocator_debug_dump(fd);
+  memory_governor_debug_dump(fd);
   alarm_debug_dump(fd);
+  task_stats_dump(fd);
+  btu_le_data_debug_dump(fd);
+  bta_sys_debug_dump(fd);
   HearingAid::DebugDump(fd);
   connection_manager::dump(fd);
+  BTM_BleRpaCacheDump(fd);
+  BTM_BleBgConnDump(fd);
+  PORT_DebugDump(fd);
+  L2CA_LinkDebugDump(fd);
+  hci_layer_debug_dump(fd);
+  L2CA_LeCocDebugDump(fd);
+  module_debug_dump(fd);
   bluetooth::bqr::DebugDump(fd);
+  bte_binary_log_dump(fd);
 #if (BTSNOOP_MEM == TRUE)
   btif_debug_btsnoop_dump(fd);
 #endif
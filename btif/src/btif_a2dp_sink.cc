@@ -25,6 +25,10 @@
 
 #include <string.h>
 
+#include <atomic>
+#include <mutex>
+
+#include "a2dp_sbc.h"
 #include "bt_common.h"
 #include "btif_a2dp.h"
 #include "btif_a2dp_sink.h"
@@ -35,7 +39,9 @@
 #include "osi/include/fixed_queue.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 #include "osi/include/thread.h"
+#include "osi/include/time.h"
 
 #include "oi_codec_sbc.h"
 #include "oi_status.h"
@@ -53,11 +59,55 @@
 
 #define BTIF_SINK_MEDIA_TIME_TICK_MS 20
 
-/* In case of A2DP Sink, we will delay start by 5 AVDTP Packets */
-#define MAX_A2DP_DELAYED_START_FRAME_COUNT 5
+/* Playout delay used until the inter-arrival jitter is known */
+#ifndef BTIF_A2DP_SINK_INITIAL_DELAY_MS
+#define BTIF_A2DP_SINK_INITIAL_DELAY_MS 100
+#endif
+
+/* Bounds of the adaptive playout delay */
+#ifndef BTIF_A2DP_SINK_MIN_DELAY_MS
+#define BTIF_A2DP_SINK_MIN_DELAY_MS 40
+#endif
+#ifndef BTIF_A2DP_SINK_MAX_DELAY_MS
+#define BTIF_A2DP_SINK_MAX_DELAY_MS 300
+#endif
+
+/* The playout delay covers this many times the inter-arrival jitter */
+#ifndef BTIF_A2DP_SINK_JITTER_FACTOR
+#define BTIF_A2DP_SINK_JITTER_FACTOR 4
+#endif
+
+/* Packets received before the jitter estimate sets the playout delay */
+#define BTIF_A2DP_SINK_JITTER_MIN_PACKETS 16
+
+/* A gap in the stream longer than this restarts the jitter estimate */
+#define BTIF_A2DP_SINK_JITTER_RESET_MS 1000
+
+/* Buffered audio above the playout delay that makes the oldest packet drop */
+#define BTIF_A2DP_SINK_TRIM_MARGIN_MS (2 * BTIF_SINK_MEDIA_TIME_TICK_MS)
+
+/* Clean ticks before an underrun raised delay floor decays by 1 ms */
+#define BTIF_A2DP_SINK_FLOOR_DECAY_TICKS 50
+
+/* Ticks the AudioTrack takes to settle before its buffer level is tracked,
+ * and ticks between two drift corrections */
+#define BTIF_A2DP_SINK_DRIFT_SETTLE_TICKS 50
+#define BTIF_A2DP_SINK_DRIFT_HOLD_TICKS 32
 
 #define MAX_SINK_MEDIA_WORKQUEUE_COUNT 1024
 
+/* Decoded ticks the decoding may run ahead of the AudioTrack writes, unless
+ * set by the property */
+#ifndef BTIF_A2DP_SINK_DECODE_AHEAD_TICKS
+#define BTIF_A2DP_SINK_DECODE_AHEAD_TICKS 2
+#endif
+#define BTIF_A2DP_SINK_DECODE_AHEAD_MAX_TICKS 8
+#define BTIF_A2DP_SINK_DECODE_AHEAD_PROPERTY \
+  "persist.bluetooth.a2dp_sink.decode_ahead"
+
+#define BTIF_A2DP_SINK_PCM_BLOCK_SAMPLES \
+  (15 * SBC_MAX_SAMPLES_PER_FRAME * SBC_MAX_CHANNELS)
+
 enum {
   BTIF_A2DP_SINK_STATE_OFF,
   BTIF_A2DP_SINK_STATE_STARTING_UP,
@@ -91,6 +141,68 @@ typedef struct {
   uint64_t enque_ns;
 } tBT_SBC_HDR;
 
+/* Adaptive jitter buffer state of the rx_audio_queue */
+typedef struct {
+  /* Updated by btif_a2dp_sink_enqueue_buf */
+  uint64_t last_arrival_us;
+  uint32_t last_rtp_timestamp;
+  uint16_t last_seq_num;
+  uint8_t last_num_frames;
+  uint32_t jitter_q4_us; /* RFC 3550 inter-arrival jitter, scaled by 16 */
+  uint32_t max_jitter_us;
+  size_t jitter_packets; /* packets in the current jitter estimate */
+  size_t total_packets;
+  size_t lost_packets;
+
+  /* Updated by the decoding tick */
+  uint32_t target_delay_us;
+  uint32_t floor_delay_us; /* raised by each underrun */
+  uint32_t clean_ticks;
+  bool rebuffering;
+  size_t underruns;
+  size_t trimmed_packets;
+  int32_t track_filtered_q5; /* AudioTrack buffered frames, scaled by 32 */
+  int32_t track_reference;
+  uint32_t track_ticks;
+  size_t extra_frames;
+  size_t deferred_frames;
+
+  /* Set by the decoder update */
+  uint32_t frame_samples;
+  uint32_t frame_duration_us;
+} tBTIF_A2DP_SINK_JITTER_BUFFER;
+
+/* PCM of one decoding tick, passed from the decoding to the rendering */
+typedef struct {
+  uint32_t generation; /* of the PCM ring when decoded */
+  uint32_t len;        /* in bytes */
+  int16_t data[BTIF_A2DP_SINK_PCM_BLOCK_SAMPLES];
+} tBTIF_A2DP_SINK_PCM_BLOCK;
+
+/* Decoding and rendering stages. The decoding tick decodes into a free block
+ * and queues it to the render thread, which writes it to the AudioTrack and
+ * gives it back. A slow AudioTrack write only delays the decoding once all
+ * the blocks are waiting to be rendered. */
+typedef struct {
+  thread_t* render_thread;
+  fixed_queue_t* free_queue;   /* blocks to decode into, from the render */
+  fixed_queue_t* render_queue; /* blocks to render, from the decoding */
+  size_t ahead_ticks;          /* number of blocks */
+
+  /* Updated by the decoding */
+  size_t decoded_blocks;
+  size_t ring_full_ticks; /* ticks skipped as all blocks were in flight */
+  uint64_t decode_us_total;
+  uint32_t decode_us_max;
+
+  /* Updated by the rendering */
+  size_t rendered_blocks;
+  size_t flushed_blocks;
+  size_t render_underruns; /* AudioTrack found empty when writing */
+  uint64_t render_us_total;
+  uint32_t render_us_max;
+} tBTIF_A2DP_SINK_PIPELINE;
+
 extern uint64_t btif_update_reported_delay(uint64_t inst_delay);
 extern bool btif_is_sink_delay_report_supported();
 
@@ -107,17 +219,23 @@ typedef struct {
   btif_a2dp_sink_focus_state_t rx_focus_state; /* audio focus state */
   void* audio_track;
   uint32_t latency; /* latency of rendering Audio samples at MMAudio */
+  tBTIF_A2DP_SINK_JITTER_BUFFER jitter_buffer;
+  tBTIF_A2DP_SINK_PIPELINE pipeline;
 } tBTIF_A2DP_SINK_CB;
 
 static tBTIF_A2DP_SINK_CB btif_a2dp_sink_cb;
 
+/* Changed to drop the blocks in flight to the render thread */
+static std::atomic<uint32_t> btif_a2dp_sink_pcm_generation;
+
+/* The AudioTrack is written by the render thread */
+static std::mutex btif_a2dp_sink_track_lock;
+
 static int btif_a2dp_sink_state = BTIF_A2DP_SINK_STATE_OFF;
 
 static OI_CODEC_SBC_DECODER_CONTEXT btif_a2dp_sink_context;
 static uint32_t btif_a2dp_sink_context_data[CODEC_DATA_WORDS(
     2, SBC_CODEC_FAST_FILTER_BUFFERS)];
-static int16_t
-    btif_a2dp_sink_pcm_data[15 * SBC_MAX_SAMPLES_PER_FRAME * SBC_MAX_CHANNELS];
 
 static void btif_a2dp_sink_startup_delayed(void* context);
 static void btif_a2dp_sink_shutdown_delayed(void* context);
@@ -128,7 +246,12 @@ static void btif_a2dp_sink_audio_handle_start_decoding(void);
 static void btif_a2dp_sink_avk_handle_timer(UNUSED_ATTR void* context);
 static void btif_a2dp_sink_audio_rx_flush_req(void);
 /* Handle incoming media packets A2DP SINK streaming */
-static void btif_a2dp_sink_handle_inc_media(tBT_SBC_HDR* p_msg);
+static void btif_a2dp_sink_handle_inc_media(tBT_SBC_HDR* p_msg,
+                                            tBTIF_A2DP_SINK_PCM_BLOCK* p_pcm);
+static bool btif_a2dp_sink_pipeline_startup(void);
+static void btif_a2dp_sink_pipeline_shutdown(void);
+static void btif_a2dp_sink_pipeline_flush(void);
+static void btif_a2dp_sink_render_ready(fixed_queue_t* queue, void* context);
 static void btif_a2dp_sink_decoder_update_event(
     tBTIF_MEDIA_SINK_DECODER_UPDATE* p_buf);
 static void btif_a2dp_sink_clear_track_event(void);
@@ -136,6 +259,9 @@ static void btif_a2dp_sink_set_focus_state_event(
     btif_a2dp_sink_focus_state_t state);
 static void btif_a2dp_sink_audio_rx_flush_event(void);
 static void btif_a2dp_sink_clear_track_event_req(void);
+static void btif_a2dp_sink_update_jitter(uint32_t rtp_timestamp,
+                                         uint16_t seq_num, uint8_t num_frames);
+static uint32_t btif_a2dp_sink_queued_us(void);
 
 UNUSED_ATTR static const char* dump_media_event(uint16_t event) {
   switch (event) {
@@ -173,6 +299,16 @@ bool btif_a2dp_sink_startup(void) {
   btif_a2dp_sink_cb.audio_track = NULL;
   btif_a2dp_sink_cb.rx_audio_queue = fixed_queue_new(SIZE_MAX);
 
+  if (!btif_a2dp_sink_pipeline_startup()) {
+    APPL_TRACE_ERROR("%s: unable to start up render thread", __func__);
+    fixed_queue_free(btif_a2dp_sink_cb.rx_audio_queue, NULL);
+    btif_a2dp_sink_cb.rx_audio_queue = NULL;
+    thread_free(btif_a2dp_sink_cb.worker_thread);
+    btif_a2dp_sink_cb.worker_thread = NULL;
+    btif_a2dp_sink_state = BTIF_A2DP_SINK_STATE_OFF;
+    return false;
+  }
+
   btif_a2dp_sink_cb.cmd_msg_queue = fixed_queue_new(SIZE_MAX);
   fixed_queue_register_dequeue(
       btif_a2dp_sink_cb.cmd_msg_queue,
@@ -217,6 +353,8 @@ void btif_a2dp_sink_shutdown(void) {
               NULL);
   thread_free(btif_a2dp_sink_cb.worker_thread);
   btif_a2dp_sink_cb.worker_thread = NULL;
+
+  btif_a2dp_sink_pipeline_shutdown();
 }
 
 static void btif_a2dp_sink_shutdown_delayed(UNUSED_ATTR void* context) {
@@ -226,6 +364,95 @@ static void btif_a2dp_sink_shutdown_delayed(UNUSED_ATTR void* context) {
   btif_a2dp_sink_state = BTIF_A2DP_SINK_STATE_OFF;
 }
 
+static void btif_a2dp_sink_render_startup(UNUSED_ATTR void* context) {
+  raise_priority_a2dp(TASK_HIGH_MEDIA);
+}
+
+/* Starts the render thread with the blocks of the PCM ring */
+static bool btif_a2dp_sink_pipeline_startup(void) {
+  tBTIF_A2DP_SINK_PIPELINE* p_pl = &btif_a2dp_sink_cb.pipeline;
+
+  int32_t ahead = osi_property_get_int32(BTIF_A2DP_SINK_DECODE_AHEAD_PROPERTY,
+                                         BTIF_A2DP_SINK_DECODE_AHEAD_TICKS);
+  if (ahead < 1) ahead = 1;
+  if (ahead > BTIF_A2DP_SINK_DECODE_AHEAD_MAX_TICKS) {
+    ahead = BTIF_A2DP_SINK_DECODE_AHEAD_MAX_TICKS;
+  }
+  p_pl->ahead_ticks = ahead;
+
+  p_pl->render_thread = thread_new("btif_a2dp_sink_render_thread");
+  if (p_pl->render_thread == NULL) return false;
+
+  /* The decoding is the only producer of the render queue and the only
+   * consumer of the free queue, the rendering the other way around */
+  p_pl->free_queue = fixed_queue_new_spsc(p_pl->ahead_ticks);
+  p_pl->render_queue = fixed_queue_new_spsc(p_pl->ahead_ticks);
+  for (size_t i = 0; i < p_pl->ahead_ticks; i++) {
+    fixed_queue_enqueue(p_pl->free_queue,
+                        osi_malloc(sizeof(tBTIF_A2DP_SINK_PCM_BLOCK)));
+  }
+  fixed_queue_register_dequeue(p_pl->render_queue,
+                               thread_get_reactor(p_pl->render_thread),
+                               btif_a2dp_sink_render_ready, NULL);
+  thread_post(p_pl->render_thread, btif_a2dp_sink_render_startup, NULL);
+  return true;
+}
+
+static void btif_a2dp_sink_pipeline_shutdown(void) {
+  tBTIF_A2DP_SINK_PIPELINE* p_pl = &btif_a2dp_sink_cb.pipeline;
+
+  if (p_pl->render_thread == NULL) return;
+  fixed_queue_unregister_dequeue(p_pl->render_queue);
+  thread_free(p_pl->render_thread);
+  p_pl->render_thread = NULL;
+
+  fixed_queue_free(p_pl->render_queue, osi_free);
+  p_pl->render_queue = NULL;
+  fixed_queue_free(p_pl->free_queue, osi_free);
+  p_pl->free_queue = NULL;
+}
+
+/* Drops the decoded audio not rendered yet */
+static void btif_a2dp_sink_pipeline_flush(void) {
+  btif_a2dp_sink_pcm_generation++;
+}
+
+static void btif_a2dp_sink_render_ready(fixed_queue_t* queue,
+                                        UNUSED_ATTR void* context) {
+  tBTIF_A2DP_SINK_PIPELINE* p_pl = &btif_a2dp_sink_cb.pipeline;
+  tBTIF_A2DP_SINK_PCM_BLOCK* p_pcm =
+      (tBTIF_A2DP_SINK_PCM_BLOCK*)fixed_queue_try_dequeue(queue);
+  if (p_pcm == NULL) return;
+
+  if (p_pcm->generation != btif_a2dp_sink_pcm_generation) {
+    p_pl->flushed_blocks++;
+    fixed_queue_enqueue(p_pl->free_queue, p_pcm);
+    return;
+  }
+
+  uint64_t start_us = time_get_os_boottime_us();
+#ifndef OS_GENERIC
+  {
+    std::lock_guard<std::mutex> lock(btif_a2dp_sink_track_lock);
+    if (btif_a2dp_sink_cb.audio_track != NULL) {
+      if (p_pl->rendered_blocks != 0 &&
+          BtifAvrcpAudioTrackGetBufferedFrames(btif_a2dp_sink_cb.audio_track) ==
+              0) {
+        p_pl->render_underruns++;
+      }
+      BtifAvrcpAudioTrackWriteData(btif_a2dp_sink_cb.audio_track,
+                                   (void*)p_pcm->data, p_pcm->len);
+    }
+  }
+#endif
+  uint32_t render_us = time_get_os_boottime_us() - start_us;
+  p_pl->rendered_blocks++;
+  p_pl->render_us_total += render_us;
+  if (render_us > p_pl->render_us_max) p_pl->render_us_max = render_us;
+
+  fixed_queue_enqueue(p_pl->free_queue, p_pcm);
+}
+
 tA2DP_SAMPLE_RATE btif_a2dp_sink_get_sample_rate(void) {
   return btif_a2dp_sink_cb.sample_rate;
 }
@@ -308,7 +535,9 @@ static void btif_a2dp_sink_audio_handle_stop_decoding(void) {
 
   alarm_free(btif_a2dp_sink_cb.decode_alarm);
   btif_a2dp_sink_cb.decode_alarm = NULL;
+  btif_a2dp_sink_pipeline_flush();
 #ifndef OS_GENERIC
+  std::lock_guard<std::mutex> lock(btif_a2dp_sink_track_lock);
   BtifAvrcpAudioTrackPause(btif_a2dp_sink_cb.audio_track);
 #endif
 }
@@ -323,6 +552,8 @@ static void btif_decode_alarm_cb(UNUSED_ATTR void* context) {
 static void btif_a2dp_sink_clear_track_event(void) {
   APPL_TRACE_DEBUG("%s", __func__);
 
+  btif_a2dp_sink_pipeline_flush();
+  std::lock_guard<std::mutex> lock(btif_a2dp_sink_track_lock);
 #ifndef OS_GENERIC
   BtifAvrcpAudioTrackStop(btif_a2dp_sink_cb.audio_track);
   BtifAvrcpAudioTrackDelete(btif_a2dp_sink_cb.audio_track);
@@ -335,6 +566,9 @@ static void btif_a2dp_sink_audio_handle_start_decoding(void) {
   if (btif_a2dp_sink_cb.decode_alarm != NULL)
     return;  // Already started decoding
 
+  btif_a2dp_sink_cb.jitter_buffer.rebuffering = false;
+  btif_a2dp_sink_cb.jitter_buffer.track_ticks = 0;
+
 #ifndef OS_GENERIC
   BtifAvrcpAudioTrackStart(btif_a2dp_sink_cb.audio_track);
 #endif
@@ -349,16 +583,17 @@ static void btif_a2dp_sink_audio_handle_start_decoding(void) {
   APPL_TRACE_DEBUG("Track Started and decode_alarm is set");
 }
 
-static void btif_a2dp_sink_handle_inc_media(tBT_SBC_HDR* p_msg) {
+/* Decodes the frames of |p_msg| to process after the PCM in |p_pcm| */
+static void btif_a2dp_sink_handle_inc_media(tBT_SBC_HDR* p_msg,
+                                            tBTIF_A2DP_SINK_PCM_BLOCK* p_pcm) {
   uint8_t* sbc_start_frame = ((uint8_t*)(p_msg + 1) + p_msg->offset + 1);
   int count;
   uint32_t pcmBytes, availPcmBytes;
-  int16_t* pcmDataPointer =
-      btif_a2dp_sink_pcm_data; /* Will be overwritten on next packet receipt */
+  int16_t* pcmDataPointer = p_pcm->data + p_pcm->len / 2;
   OI_STATUS status;
   int num_sbc_frames = p_msg->num_frames_to_be_processed;
   uint32_t sbc_frame_len = p_msg->len - 1;
-  availPcmBytes = sizeof(btif_a2dp_sink_pcm_data);
+  availPcmBytes = sizeof(p_pcm->data) - p_pcm->len;
 
   if ((btif_av_get_peer_sep() == AVDT_TSEP_SNK) ||
       (btif_a2dp_sink_cb.rx_flush)) {
@@ -381,26 +616,161 @@ static void btif_a2dp_sink_handle_inc_media(tBT_SBC_HDR* p_msg) {
     }
     availPcmBytes -= pcmBytes;
     pcmDataPointer += pcmBytes / 2;
+    p_pcm->len += pcmBytes;
     p_msg->offset += (p_msg->len - 1) - sbc_frame_len;
     p_msg->len = sbc_frame_len + 1;
   }
+}
+
+static void btif_a2dp_sink_update_jitter(uint32_t rtp_timestamp,
+                                         uint16_t seq_num, uint8_t num_frames) {
+  tBTIF_A2DP_SINK_JITTER_BUFFER* p_jb = &btif_a2dp_sink_cb.jitter_buffer;
+  uint64_t now_us = time_get_os_boottime_us();
+
+  p_jb->total_packets++;
+  if (p_jb->last_arrival_us == 0 || btif_a2dp_sink_cb.sample_rate == 0 ||
+      now_us - p_jb->last_arrival_us > BTIF_A2DP_SINK_JITTER_RESET_MS * 1000) {
+    /* First packet of the stream, or the stream has been suspended */
+    p_jb->jitter_q4_us = 0;
+    p_jb->jitter_packets = 0;
+  } else {
+    uint16_t seq_delta = seq_num - p_jb->last_seq_num;
+    if (seq_delta > 1 && seq_delta < 0x8000) {
+      p_jb->lost_packets += seq_delta - 1;
+    }
+
+    /* Media time between the two packets, from the RTP time stamps. Some
+     * sources do not count the time stamps in samples, use the SBC frames of
+     * the previous packets for those. */
+    uint32_t rtp_delta = rtp_timestamp - p_jb->last_rtp_timestamp;
+    int64_t media_us =
+        (int64_t)rtp_delta * 1000000 / btif_a2dp_sink_cb.sample_rate;
+    int64_t frames_us = (int64_t)p_jb->last_num_frames *
+                        p_jb->frame_duration_us * (seq_delta & 0x7fff);
+    if (media_us > 2 * frames_us || 2 * media_us < frames_us) {
+      media_us = frames_us;
+    }
+
+    /* RFC 3550 A.8: J += (|D| - J) / 16 */
+    int64_t d = (int64_t)(now_us - p_jb->last_arrival_us) - media_us;
+    if (d < 0) d = -d;
+    if (d > BTIF_A2DP_SINK_JITTER_RESET_MS * 1000) {
+      d = BTIF_A2DP_SINK_JITTER_RESET_MS * 1000;
+    }
+    p_jb->jitter_q4_us += (uint32_t)d - ((p_jb->jitter_q4_us + 8) >> 4);
+    p_jb->jitter_packets++;
+    if ((p_jb->jitter_q4_us >> 4) > p_jb->max_jitter_us) {
+      p_jb->max_jitter_us = p_jb->jitter_q4_us >> 4;
+    }
+  }
+
+  p_jb->last_arrival_us = now_us;
+  p_jb->last_rtp_timestamp = rtp_timestamp;
+  p_jb->last_seq_num = seq_num;
+  p_jb->last_num_frames = num_frames;
+}
+
+/* Audio buffered in the rx_audio_queue, in microseconds */
+static uint32_t btif_a2dp_sink_queued_us(void) {
+  tBTIF_A2DP_SINK_JITTER_BUFFER* p_jb = &btif_a2dp_sink_cb.jitter_buffer;
+
+  return fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue) *
+         p_jb->last_num_frames * p_jb->frame_duration_us;
+}
+
+/* Sizes the playout delay from the inter-arrival jitter and the underruns */
+static void btif_a2dp_sink_update_target_delay(void) {
+  tBTIF_A2DP_SINK_JITTER_BUFFER* p_jb = &btif_a2dp_sink_cb.jitter_buffer;
+  uint32_t delay_us = BTIF_A2DP_SINK_INITIAL_DELAY_MS * 1000;
+
+  if (p_jb->jitter_packets >= BTIF_A2DP_SINK_JITTER_MIN_PACKETS) {
+    delay_us = BTIF_A2DP_SINK_JITTER_FACTOR * (p_jb->jitter_q4_us >> 4) +
+               BTIF_SINK_MEDIA_TIME_TICK_MS * 1000;
+  }
+  if (delay_us < p_jb->floor_delay_us) delay_us = p_jb->floor_delay_us;
+  if (delay_us < BTIF_A2DP_SINK_MIN_DELAY_MS * 1000) {
+    delay_us = BTIF_A2DP_SINK_MIN_DELAY_MS * 1000;
+  }
+  if (delay_us > BTIF_A2DP_SINK_MAX_DELAY_MS * 1000) {
+    delay_us = BTIF_A2DP_SINK_MAX_DELAY_MS * 1000;
+  }
+  p_jb->target_delay_us = delay_us;
+}
+
+/* Stops the playout until the queue holds the playout delay again */
+static void btif_a2dp_sink_on_underrun(void) {
+  tBTIF_A2DP_SINK_JITTER_BUFFER* p_jb = &btif_a2dp_sink_cb.jitter_buffer;
+
+  if (p_jb->rebuffering) return;
+  p_jb->rebuffering = true;
+  p_jb->underruns++;
+  p_jb->clean_ticks = 0;
+  /* The AudioTrack drains as well, its level settles again */
+  p_jb->track_ticks = 0;
+  p_jb->floor_delay_us += BTIF_SINK_MEDIA_TIME_TICK_MS * 1000;
+  if (p_jb->floor_delay_us > BTIF_A2DP_SINK_MAX_DELAY_MS * 1000) {
+    p_jb->floor_delay_us = BTIF_A2DP_SINK_MAX_DELAY_MS * 1000;
+  }
+  APPL_TRACE_WARNING("%s: underrun, playout delay floor %u ms", __func__,
+                     p_jb->floor_delay_us / 1000);
+}
 
+/* Compares the AudioTrack buffer level with the level it settled at, and
+ * returns the number of SBC frames to decode on top of the tick: -1 when the
+ * AudioTrack plays slower than the tick rate, +1 when faster. */
+static int btif_a2dp_sink_track_drift_adjust(void) {
 #ifndef OS_GENERIC
-  BtifAvrcpAudioTrackWriteData(
-      btif_a2dp_sink_cb.audio_track, (void*)btif_a2dp_sink_pcm_data,
-      (sizeof(btif_a2dp_sink_pcm_data) - availPcmBytes));
+  tBTIF_A2DP_SINK_JITTER_BUFFER* p_jb = &btif_a2dp_sink_cb.jitter_buffer;
+  int buffered =
+      BtifAvrcpAudioTrackGetBufferedFrames(btif_a2dp_sink_cb.audio_track);
+  if (buffered < 0 || p_jb->frame_samples == 0) return 0;
+
+  if (p_jb->track_ticks++ == 0) {
+    p_jb->track_filtered_q5 = buffered << 5;
+  } else {
+    p_jb->track_filtered_q5 += buffered - (p_jb->track_filtered_q5 >> 5);
+  }
+  int32_t level = p_jb->track_filtered_q5 >> 5;
+  if (p_jb->track_ticks < BTIF_A2DP_SINK_DRIFT_SETTLE_TICKS) return 0;
+  if (p_jb->track_ticks == BTIF_A2DP_SINK_DRIFT_SETTLE_TICKS) {
+    p_jb->track_reference = level;
+    return 0;
+  }
+  if ((p_jb->track_ticks - BTIF_A2DP_SINK_DRIFT_SETTLE_TICKS) %
+          BTIF_A2DP_SINK_DRIFT_HOLD_TICKS !=
+      0) {
+    return 0;
+  }
+
+  int32_t frame_samples = p_jb->frame_samples;
+  if (level > p_jb->track_reference + frame_samples) {
+    p_jb->deferred_frames++;
+    return -1;
+  }
+  if (level + frame_samples < p_jb->track_reference) {
+    p_jb->extra_frames++;
+    return 1;
+  }
 #endif
+  return 0;
 }
 
 static void btif_a2dp_sink_avk_handle_timer(UNUSED_ATTR void* context) {
+  tBTIF_A2DP_SINK_JITTER_BUFFER* p_jb = &btif_a2dp_sink_cb.jitter_buffer;
+  tBTIF_A2DP_SINK_PIPELINE* p_pl = &btif_a2dp_sink_cb.pipeline;
+  tBTIF_A2DP_SINK_PCM_BLOCK* p_pcm;
   tBT_SBC_HDR* p_msg;
   int num_sbc_frames;
   int num_frames_to_process;
+  uint32_t queued_us;
   uint64_t inst_delay = 0;       /* avg delay incurred per frame in 20 ms */
   uint64_t inst_delay_total = 0; /* sum of delay for all frames processed till now */
 
+  btif_a2dp_sink_update_target_delay();
+
   if (fixed_queue_is_empty(btif_a2dp_sink_cb.rx_audio_queue)) {
     APPL_TRACE_DEBUG("%s: empty queue", __func__);
+    if (!btif_a2dp_sink_cb.rx_flush) btif_a2dp_sink_on_underrun();
     return;
   }
 
@@ -416,13 +786,44 @@ static void btif_a2dp_sink_avk_handle_timer(UNUSED_ATTR void* context) {
     return;
   }
 
-  num_frames_to_process = btif_a2dp_sink_cb.frames_to_process;
+  queued_us = btif_a2dp_sink_queued_us();
+  if (p_jb->rebuffering) {
+    if (queued_us < p_jb->target_delay_us) return;
+    p_jb->rebuffering = false;
+  }
+
+  /* Trim the latency the jitter no longer needs, e.g. after a burst */
+  if (queued_us >
+          p_jb->target_delay_us + BTIF_A2DP_SINK_TRIM_MARGIN_MS * 1000 &&
+      fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue) > 1) {
+    osi_free(fixed_queue_try_dequeue(btif_a2dp_sink_cb.rx_audio_queue));
+    p_jb->trimmed_packets++;
+  }
+
+  if (++p_jb->clean_ticks >= BTIF_A2DP_SINK_FLOOR_DECAY_TICKS) {
+    p_jb->clean_ticks = 0;
+    if (p_jb->floor_delay_us >= 1000) p_jb->floor_delay_us -= 1000;
+  }
+
+  /* The rendering is behind by all the blocks, the rx_audio_queue buffers
+   * the audio meanwhile */
+  p_pcm = (tBTIF_A2DP_SINK_PCM_BLOCK*)fixed_queue_try_dequeue(p_pl->free_queue);
+  if (p_pcm == NULL) {
+    p_pl->ring_full_ticks++;
+    return;
+  }
+  p_pcm->generation = btif_a2dp_sink_pcm_generation;
+  p_pcm->len = 0;
+  uint64_t decode_start_us = time_get_os_boottime_us();
+
+  num_frames_to_process =
+      btif_a2dp_sink_cb.frames_to_process + btif_a2dp_sink_track_drift_adjust();
   APPL_TRACE_DEBUG(" Process Frames + ");
 
   do {
     p_msg = (tBT_SBC_HDR*)fixed_queue_try_peek_first(
         btif_a2dp_sink_cb.rx_audio_queue);
-    if (p_msg == NULL) return;
+    if (p_msg == NULL) break;
     /* Number of frames in queue packets */
     num_sbc_frames = p_msg->num_frames_to_be_processed;
     APPL_TRACE_DEBUG("Frames left in topmost packet %d", num_sbc_frames);
@@ -434,7 +835,7 @@ static void btif_a2dp_sink_avk_handle_timer(UNUSED_ATTR void* context) {
     if (num_sbc_frames > num_frames_to_process) {
       /* Queue packet has more frames */
       p_msg->num_frames_to_be_processed = num_frames_to_process;
-      btif_a2dp_sink_handle_inc_media(p_msg);
+      btif_a2dp_sink_handle_inc_media(p_msg, p_pcm);
       if (btif_is_sink_delay_report_supported()) {
         struct timespec ts_now;
         uint64_t curr_time;
@@ -450,7 +851,7 @@ static void btif_a2dp_sink_avk_handle_timer(UNUSED_ATTR void* context) {
       break;
     }
     /* Queue packet has less frames */
-    btif_a2dp_sink_handle_inc_media(p_msg);
+    btif_a2dp_sink_handle_inc_media(p_msg, p_pcm);
     p_msg =
         (tBT_SBC_HDR*)fixed_queue_try_dequeue(btif_a2dp_sink_cb.rx_audio_queue);
     if (p_msg == NULL) {
@@ -462,6 +863,16 @@ static void btif_a2dp_sink_avk_handle_timer(UNUSED_ATTR void* context) {
     osi_free(p_msg);
   } while (num_frames_to_process > 0);
 
+  if (p_pcm->len != 0) {
+    uint32_t decode_us = time_get_os_boottime_us() - decode_start_us;
+    p_pl->decoded_blocks++;
+    p_pl->decode_us_total += decode_us;
+    if (decode_us > p_pl->decode_us_max) p_pl->decode_us_max = decode_us;
+    fixed_queue_enqueue(p_pl->render_queue, p_pcm);
+  } else {
+    fixed_queue_enqueue(p_pl->free_queue, p_pcm);
+  }
+
   if (btif_is_sink_delay_report_supported()) {
     inst_delay = inst_delay_total / btif_a2dp_sink_cb.frames_to_process;
     btif_update_reported_delay(inst_delay);
@@ -481,6 +892,7 @@ static void btif_a2dp_sink_audio_rx_flush_event(void) {
   APPL_TRACE_DEBUG("%s", __func__);
 
   fixed_queue_flush(btif_a2dp_sink_cb.rx_audio_queue, osi_free);
+  btif_a2dp_sink_pipeline_flush();
 }
 
 static void btif_a2dp_sink_decoder_update_event(
@@ -527,12 +939,15 @@ static void btif_a2dp_sink_decoder_update_event(
   }
 
   APPL_TRACE_DEBUG("%s: A2dpSink: SBC create track", __func__);
-  btif_a2dp_sink_cb.audio_track =
+  {
+    std::lock_guard<std::mutex> lock(btif_a2dp_sink_track_lock);
+    btif_a2dp_sink_cb.audio_track =
 #ifndef OS_GENERIC
-      BtifAvrcpAudioTrackCreate(sample_rate, channel_type);
+        BtifAvrcpAudioTrackCreate(sample_rate, channel_type);
 #else
-      NULL;
+        NULL;
 #endif
+  }
   if (btif_a2dp_sink_cb.audio_track == NULL) {
     APPL_TRACE_ERROR("%s: A2dpSink: Track creation failed", __func__);
     return;
@@ -549,6 +964,27 @@ static void btif_a2dp_sink_decoder_update_event(
     APPL_TRACE_ERROR("%s: Cannot compute the number of frames to process",
                      __func__);
   }
+
+  tBTIF_A2DP_SINK_JITTER_BUFFER* p_jb = &btif_a2dp_sink_cb.jitter_buffer;
+  p_jb->frame_samples = 0;
+  if (A2DP_GetCodecType(p_buf->codec_info) == A2DP_MEDIA_CT_SBC) {
+    int num_blocks = A2DP_GetNumberOfBlocksSbc(p_buf->codec_info);
+    int num_subbands = A2DP_GetNumberOfSubbandsSbc(p_buf->codec_info);
+    if (num_blocks > 0 && num_subbands > 0) {
+      p_jb->frame_samples = num_blocks * num_subbands;
+    }
+  }
+  if (p_jb->frame_samples != 0) {
+    p_jb->frame_duration_us = p_jb->frame_samples * 1000000 / sample_rate;
+  } else if (btif_a2dp_sink_cb.frames_to_process != 0) {
+    p_jb->frame_duration_us = BTIF_SINK_MEDIA_TIME_TICK_MS * 1000 /
+                              btif_a2dp_sink_cb.frames_to_process;
+  }
+  p_jb->last_arrival_us = 0;
+  p_jb->floor_delay_us = 0;
+  p_jb->target_delay_us = BTIF_A2DP_SINK_INITIAL_DELAY_MS * 1000;
+  APPL_TRACE_DEBUG("%s: SBC frame of %u samples, %u us", __func__,
+                   p_jb->frame_samples, p_jb->frame_duration_us);
 }
 
 uint32_t get_audiotrack_latency() {
@@ -561,7 +997,7 @@ uint8_t btif_a2dp_sink_enqueue_buf(BT_HDR* p_pkt) {
   if (btif_a2dp_sink_cb.rx_flush) /* Flush enabled, do not enqueue */
     return fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue);
 
-  if (fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue) ==
+  if (fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue) >=
       MAX_INPUT_A2DP_FRAME_QUEUE_SZ) {
     uint8_t ret = fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue);
     osi_free(fixed_queue_try_dequeue(btif_a2dp_sink_cb.rx_audio_queue));
@@ -579,6 +1015,8 @@ uint8_t btif_a2dp_sink_enqueue_buf(BT_HDR* p_pkt) {
   p_msg->len = p_pkt->len;
   p_msg->offset = 0;
   p_msg->layer_specific = p_pkt->layer_specific;
+  btif_a2dp_sink_update_jitter(*(uint32_t*)(p_pkt + 1), p_pkt->layer_specific,
+                               p_msg->num_frames_to_be_processed);
 
   if (btif_is_sink_delay_report_supported()) {
     struct timespec ts_now;
@@ -589,8 +1027,9 @@ uint8_t btif_a2dp_sink_enqueue_buf(BT_HDR* p_pkt) {
   BTIF_TRACE_VERBOSE("%s: frames to process %d, len %d", __func__,
                      p_msg->num_frames_to_be_processed, p_msg->len);
   fixed_queue_enqueue(btif_a2dp_sink_cb.rx_audio_queue, p_msg);
-  if (fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue) ==
-      MAX_A2DP_DELAYED_START_FRAME_COUNT) {
+  if (btif_a2dp_sink_cb.decode_alarm == NULL &&
+      btif_a2dp_sink_queued_us() >=
+          btif_a2dp_sink_cb.jitter_buffer.target_delay_us) {
     BTIF_TRACE_DEBUG("%s: Initiate decoding", __func__);
     btif_a2dp_sink_audio_handle_start_decoding();
   }
@@ -609,8 +1048,71 @@ void btif_a2dp_sink_audio_rx_flush_req(void) {
   fixed_queue_enqueue(btif_a2dp_sink_cb.cmd_msg_queue, p_buf);
 }
 
-void btif_a2dp_sink_debug_dump(UNUSED_ATTR int fd) {
-  // Nothing to do
+void btif_a2dp_sink_debug_dump(int fd) {
+  tBTIF_A2DP_SINK_JITTER_BUFFER* p_jb = &btif_a2dp_sink_cb.jitter_buffer;
+
+  dprintf(fd, "\nA2DP Sink State:\n");
+  dprintf(fd, "  Jitter buffer:\n");
+
+  dprintf(fd,
+          "  Counts (received/lost/trimmed packets)                  : %zu / "
+          "%zu / %zu\n",
+          p_jb->total_packets, p_jb->lost_packets, p_jb->trimmed_packets);
+
+  dprintf(fd,
+          "  Inter-arrival jitter in us (current/max)                : %u / "
+          "%u\n",
+          p_jb->jitter_q4_us >> 4, p_jb->max_jitter_us);
+
+  dprintf(fd,
+          "  Playout delay in ms (target/underrun floor/queued)      : %u / "
+          "%u / %u\n",
+          p_jb->target_delay_us / 1000, p_jb->floor_delay_us / 1000,
+          (btif_a2dp_sink_cb.rx_audio_queue != NULL)
+              ? btif_a2dp_sink_queued_us() / 1000
+              : 0);
+
+  dprintf(fd,
+          "  Underruns (total/rebuffering)                           : %zu / "
+          "%s\n",
+          p_jb->underruns, p_jb->rebuffering ? "yes" : "no");
+
+  dprintf(fd,
+          "  AudioTrack drift frames (extra/deferred)                : %zu / "
+          "%zu\n",
+          p_jb->extra_frames, p_jb->deferred_frames);
+
+  tBTIF_A2DP_SINK_PIPELINE* p_pl = &btif_a2dp_sink_cb.pipeline;
+  dprintf(fd, "  Decoding and rendering (%zu ticks ahead):\n",
+          p_pl->ahead_ticks);
+
+  dprintf(fd,
+          "  Blocks (decoded/rendered/flushed)                       : %zu / "
+          "%zu / %zu\n",
+          p_pl->decoded_blocks, p_pl->rendered_blocks, p_pl->flushed_blocks);
+
+  dprintf(fd,
+          "  Stalls (decoding on full ring/AudioTrack underruns)     : %zu / "
+          "%zu\n",
+          p_pl->ring_full_ticks, p_pl->render_underruns);
+
+  dprintf(fd,
+          "  Decoding time per tick in us (avg/max)                  : %llu / "
+          "%u\n",
+          (p_pl->decoded_blocks != 0)
+              ? (unsigned long long)(p_pl->decode_us_total /
+                                     p_pl->decoded_blocks)
+              : 0ULL,
+          p_pl->decode_us_max);
+
+  dprintf(fd,
+          "  Rendering time per tick in us (avg/max)                 : %llu / "
+          "%u\n",
+          (p_pl->rendered_blocks != 0)
+              ? (unsigned long long)(p_pl->render_us_total /
+                                     p_pl->rendered_blocks)
+              : 0ULL,
+          p_pl->render_us_max);
 }
 
 void btif_a2dp_sink_set_focus_state_req(btif_a2dp_sink_focus_state_t state) {
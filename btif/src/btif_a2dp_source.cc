@@ -33,8 +33,11 @@
 #include <limits.h>
 #include <string.h>
 #include <algorithm>
+#include <atomic>
 
 #if (OFF_TARGET_TEST_ENABLED == FALSE)
+#include "a2dp_abr.h"
+#include "a2dp_link_policy.h"
 #include "audio_hal_interface/a2dp_encoding.h"
 #include "audio_a2dp_hw/include/audio_a2dp_hw.h"
 #endif
@@ -46,20 +49,29 @@ using ::bluetooth::audio::a2dp::SessionType;
 #endif
 
 #include "bt_common.h"
+#include "bt_trace_span.h"
 #include "bta_av_ci.h"
+#include "bta_closure_api.h"
 #include "btif_a2dp.h"
 #include "btif_a2dp_control.h"
 #include "btif_a2dp_source.h"
 #include "btif_av.h"
 #include "btif_av_co.h"
+#include "btif_bqr.h"
+#include "btif_debug_conn.h"
 #include "btif_util.h"
+#include "btm_api.h"
+#include "l2c_api.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/log.h"
+#include "osi/include/memory_governor.h"
 #include "osi/include/metrics.h"
 #include "osi/include/mutex.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 #include "osi/include/thread.h"
 #include "osi/include/time.h"
+#include "stack_config.h"
 #include "uipc.h"
 #include "btif_a2dp_audio_interface.h"
 #include "btif_bat.h"
@@ -77,6 +89,16 @@ using system_bt_osi::A2dpSessionMetrics;
 #define MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ (MAX_PCM_FRAME_NUM_PER_TICK * 2)
 #define BTIF_UNBLOCK_AUDIO_START_TOUT 3000
 #define BTIF_REMOTE_START_TOUT 3000
+/* Link quality sampling period for the encoder adaptive bit rate and the
+ * link policy */
+#define A2DP_SOURCE_LINK_QUALITY_INTERVAL_MS 2000
+/* Property enabling the link policy, see a2dp_link_policy.h */
+#define A2DP_SOURCE_LINK_POLICY_PROPERTY "persist.bluetooth.a2dp_link_policy"
+/* Longest time a media packet may wait in the TX queue before it is dropped
+ * instead of being sent, 0 for no limit */
+#define A2DP_SOURCE_TX_LATENCY_TARGET_MS 200
+#define A2DP_SOURCE_TX_LATENCY_TARGET_PROPERTY \
+  "persist.bluetooth.a2dp_tx_latency_target_ms"
 enum {
   BTIF_A2DP_SOURCE_STATE_OFF,
   BTIF_A2DP_SOURCE_STATE_STARTING_UP,
@@ -120,6 +142,18 @@ tBTIF_A2DP_SOURCE_CB btif_a2dp_source_cb;
 tBTIF_A2DP_SOURCE_VSC btif_a2dp_src_vsc;
 
 static int btif_a2dp_source_state = BTIF_A2DP_SOURCE_STATE_OFF;
+
+// Connection handle of the streaming link, read by the quality report callback
+static std::atomic<uint16_t> btif_a2dp_source_bqr_handle(HCI_INVALID_HANDLE);
+
+// Bytes of the TX queue, and its limit in frames set from the memory pressure
+static memory_client_t* btif_a2dp_source_memory;
+static std::atomic<size_t> btif_a2dp_source_tx_queue_limit{
+    MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ};
+
+// Latency target of the TX queue, read at each start and used by readbuf
+static std::atomic<uint64_t> btif_a2dp_source_tx_latency_target_us{
+    A2DP_SOURCE_TX_LATENCY_TARGET_MS * 1000};
 extern bool enc_update_in_progress;
 extern bool reconfig_a2dp;
 extern bool tx_enc_update_initiated;
@@ -142,12 +176,28 @@ static void btif_a2dp_source_audio_handle_timer(void* context);
 static uint32_t btif_a2dp_source_read_callback(uint8_t* p_buf, uint32_t len);
 static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
                                               uint32_t bytes_read);
+static void btif_a2dp_source_free_tx_buf(void* p_buf);
+static size_t btif_a2dp_source_tx_buf_size(const BT_HDR* p_buf);
+static void btif_a2dp_source_stamp_tx_buf(BT_HDR* p_buf, uint64_t now_us);
+static bool btif_a2dp_source_tx_buf_age_us(const BT_HDR* p_buf, uint64_t now_us,
+                                           uint64_t* p_age_us);
+static void update_queue_age_stats(btif_media_stats_t* stats,
+                                   uint64_t age_us);
+static void btif_a2dp_source_memory_pressure(memory_pressure_t pressure,
+                                             void* context);
 static void log_tstamps_us(const char* comment, uint64_t timestamp_us);
+static uint64_t btif_a2dp_source_tick_pll_update(uint64_t now_us);
 static void update_scheduling_stats(scheduling_stats_t* stats, uint64_t now_us,
                                     uint64_t expected_delta);
 static void btm_read_rssi_cb(void* data);
 static void btm_read_failed_contact_counter_cb(void* data);
 static void btm_read_automatic_flush_timeout_cb(void* data);
+static void btif_a2dp_source_read_link_quality(uint64_t timestamp_us);
+static void btif_a2dp_source_apply_link_policy(const RawAddress& peer_bda,
+                                               bool robust);
+static void btif_a2dp_source_link_quality_cb(
+    const bluetooth::bqr::BqrLinkQuality& report,
+    const bluetooth::bqr::BqrLinkQualityAggregate& aggregate, void* context);
 static void btm_read_tx_power_cb(void* data);
 static void btif_a2dp_source_unblock_audio_start_timeout(void* context);
 static void btif_a2dp_source_remote_start_timeout(void* context);
@@ -204,6 +254,8 @@ void btif_a2dp_source_accumulate_scheduling_stats(scheduling_stats_t* src,
                src->max_premature_scheduling_delta_us);
   dst->exact_scheduling_count += src->exact_scheduling_count;
   dst->total_scheduling_time_us += src->total_scheduling_time_us;
+  for (int i = 0; i < BTIF_A2DP_SOURCE_JITTER_BUCKETS; i++)
+    dst->jitter_histogram[i] += src->jitter_histogram[i];
 }
 
 void btif_a2dp_source_accumulate_stats(btif_media_stats_t* src,
@@ -214,6 +266,8 @@ void btif_a2dp_source_accumulate_stats(btif_media_stats_t* src,
   dst->tx_queue_total_queueing_time_us += src->tx_queue_total_queueing_time_us;
   dst->tx_queue_max_queueing_time_us = std::max(
       dst->tx_queue_max_queueing_time_us, src->tx_queue_max_queueing_time_us);
+  for (int i = 0; i < BTIF_A2DP_SOURCE_QUEUE_AGE_BUCKETS; i++)
+    dst->tx_queue_age_histogram[i] += src->tx_queue_age_histogram[i];
   dst->tx_queue_total_readbuf_calls += src->tx_queue_total_readbuf_calls;
   dst->tx_queue_last_readbuf_us = src->tx_queue_last_readbuf_us;
   dst->tx_queue_total_flushed_messages += src->tx_queue_total_flushed_messages;
@@ -223,11 +277,15 @@ void btif_a2dp_source_accumulate_stats(btif_media_stats_t* src,
       dst->tx_queue_max_dropped_messages, src->tx_queue_max_dropped_messages);
   dst->tx_queue_dropouts += src->tx_queue_dropouts;
   dst->tx_queue_last_dropouts_us = src->tx_queue_last_dropouts_us;
+  dst->tx_queue_total_expired_messages += src->tx_queue_total_expired_messages;
+  dst->tx_queue_last_expired_us = src->tx_queue_last_expired_us;
   dst->media_read_total_underflow_bytes +=
       src->media_read_total_underflow_bytes;
   dst->media_read_total_underflow_count +=
       src->media_read_total_underflow_count;
   dst->media_read_last_underflow_us = src->media_read_last_underflow_us;
+  dst->media_read_total_overrun_count += src->media_read_total_overrun_count;
+  dst->media_read_last_overrun_us = src->media_read_last_overrun_us;
   btif_a2dp_source_accumulate_scheduling_stats(&src->tx_queue_enqueue_stats,
                                                &dst->tx_queue_enqueue_stats);
   btif_a2dp_source_accumulate_scheduling_stats(&src->tx_queue_dequeue_stats,
@@ -257,6 +315,9 @@ bool btif_a2dp_source_startup(void) {
   }
 
   btif_a2dp_source_cb.tx_audio_queue = fixed_queue_new(SIZE_MAX);
+  btif_a2dp_source_memory = memory_governor_register(
+      "a2dp_source_tx", btif_a2dp_source_memory_pressure, NULL);
+  btif_a2dp_source_memory_pressure(memory_governor_pressure(), NULL);
 
   btif_a2dp_source_cb.cmd_msg_queue = fixed_queue_new(SIZE_MAX);
   fixed_queue_register_dequeue(
@@ -327,9 +388,12 @@ static void btif_a2dp_source_shutdown_delayed(UNUSED_ATTR void* context) {
   } else {
     btif_a2dp_control_cleanup();
   }
-  fixed_queue_free(btif_a2dp_source_cb.tx_audio_queue, NULL);
+  fixed_queue_free(btif_a2dp_source_cb.tx_audio_queue,
+                   btif_a2dp_source_free_tx_buf);
   btif_a2dp_source_cb.tx_audio_queue = NULL;
 
+  btif_a2dp_source_cb.encoder_codec_config = nullptr;
+
   btif_a2dp_source_state = BTIF_A2DP_SOURCE_STATE_OFF;
   APPL_TRACE_EVENT("%s: enc_update_in_progress = %d", __func__, enc_update_in_progress);
   enc_update_in_progress = FALSE;
@@ -500,6 +564,16 @@ static void btif_a2dp_source_command_ready(fixed_queue_t* queue,
   osi_free(p_msg);
 }
 
+void btif_a2dp_source_encoder_prepare(tBTA_AV_HNDL hndl) {
+  APPL_TRACE_EVENT("## A2DP SOURCE PREPARE ENCODER ##");
+
+  mutex_global_lock();
+  if (bta_av_set_a2dp_current_codec(hndl) == BT_STATUS_SUCCESS) {
+    btif_a2dp_source_encoder_init();
+  }
+  mutex_global_unlock();
+}
+
 bt_status_t btif_a2dp_source_setup_codec(tBTA_AV_HNDL hndl) {
   APPL_TRACE_EVENT("## A2DP SOURCE SETUP CODEC ##");
   bt_status_t status = BT_STATUS_FAIL;
@@ -688,9 +762,46 @@ static void btif_a2dp_source_encoder_init_event(BT_HDR* p_msg) {
     return;
   }
 
+  // The encoder is kept when it was already initialized for this codec
+  // configuration and peer, typically when prepared before a restart. This
+  // saves the encoder setup from the stream start and keeps its state warm.
+  btav_a2dp_codec_config_t codec_config = a2dp_codec_config->getCodecConfig();
+  uint8_t codec_info[AVDT_CODEC_SIZE];
+  memset(codec_info, 0, sizeof(codec_info));
+  a2dp_codec_config->copyOutOtaCodecConfig(codec_info);
+  const tA2DP_ENCODER_INIT_PEER_PARAMS& peer_params =
+      p_encoder_init->peer_params;
+  const tA2DP_ENCODER_INIT_PEER_PARAMS& last_peer_params =
+      btif_a2dp_source_cb.encoder_peer_params;
+  const btav_a2dp_codec_config_t& last_config =
+      btif_a2dp_source_cb.encoder_config;
+  if (btif_a2dp_source_cb.encoder_codec_config == a2dp_codec_config &&
+      memcmp(btif_a2dp_source_cb.encoder_codec_info, codec_info,
+             sizeof(codec_info)) == 0 &&
+      last_config.codec_type == codec_config.codec_type &&
+      last_config.sample_rate == codec_config.sample_rate &&
+      last_config.bits_per_sample == codec_config.bits_per_sample &&
+      last_config.channel_mode == codec_config.channel_mode &&
+      last_config.codec_specific_1 == codec_config.codec_specific_1 &&
+      last_config.codec_specific_2 == codec_config.codec_specific_2 &&
+      last_config.codec_specific_3 == codec_config.codec_specific_3 &&
+      last_config.codec_specific_4 == codec_config.codec_specific_4 &&
+      last_peer_params.is_peer_edr == peer_params.is_peer_edr &&
+      last_peer_params.peer_supports_3mbps == peer_params.peer_supports_3mbps &&
+      last_peer_params.peer_mtu == peer_params.peer_mtu) {
+    APPL_TRACE_DEBUG("%s: encoder already initialized for %s", __func__,
+                     a2dp_codec_config->name().c_str());
+    return;
+  }
+
   btif_a2dp_source_cb.encoder_interface->encoder_init(
       &p_encoder_init->peer_params, a2dp_codec_config,
       btif_a2dp_source_read_callback, btif_a2dp_source_enqueue_callback);
+  btif_a2dp_source_cb.encoder_codec_config = a2dp_codec_config;
+  btif_a2dp_source_cb.encoder_config = codec_config;
+  memcpy(btif_a2dp_source_cb.encoder_codec_info, codec_info,
+         sizeof(codec_info));
+  btif_a2dp_source_cb.encoder_peer_params = peer_params;
 
   // Save a local copy of the encoder_interval_ms
   btif_a2dp_source_cb.encoder_interval_ms =
@@ -904,6 +1015,30 @@ static void btif_a2dp_source_audio_tx_start_event(void) {
     return;
   }
 
+  btif_a2dp_source_cb.tick_pll_enabled =
+      stack_config_get_interface()->get_a2dp_source_tick_pll_enabled();
+
+  char value[PROPERTY_VALUE_MAX];
+  osi_property_get(A2DP_SOURCE_LINK_POLICY_PROPERTY, value, "true");
+  btif_a2dp_source_cb.link_policy_enabled = (strcmp(value, "true") == 0);
+  a2dp_link_policy_reset(&btif_a2dp_source_cb.link_policy);
+  btif_av_get_active_peer_addr(&btif_a2dp_source_cb.link_policy_peer);
+
+  int32_t latency_target_ms = osi_property_get_int32(
+      A2DP_SOURCE_TX_LATENCY_TARGET_PROPERTY, A2DP_SOURCE_TX_LATENCY_TARGET_MS);
+  btif_a2dp_source_tx_latency_target_us =
+      (latency_target_ms > 0) ? (uint64_t)latency_target_ms * 1000 : 0;
+
+  /* Follow the quality reports of the controller on the streaming link */
+  btif_a2dp_source_bqr_handle = BTM_GetHCIConnHandle(
+      btif_a2dp_source_cb.link_policy_peer, BT_TRANSPORT_BR_EDR);
+  bluetooth::bqr::RegisterLinkQualityCallback(
+      btif_a2dp_source_link_quality_cb, NULL);
+  btif_a2dp_source_cb.tick_clock_ns = 0;
+  btif_a2dp_source_cb.tick_period_ns =
+      btif_a2dp_source_cb.encoder_interface->get_encoder_interval_ms() *
+      1000000;
+
   alarm_set(btif_a2dp_source_cb.media_alarm,
             btif_a2dp_source_cb.encoder_interface->get_encoder_interval_ms(),
             btif_a2dp_source_alarm_cb, NULL);
@@ -933,6 +1068,18 @@ static void btif_a2dp_source_audio_tx_stop_event(void) {
   alarm_free(btif_a2dp_source_cb.media_alarm);
   btif_a2dp_source_cb.media_alarm = NULL;
 
+  bluetooth::bqr::UnregisterLinkQualityCallback(
+      btif_a2dp_source_link_quality_cb, NULL);
+  btif_a2dp_source_bqr_handle = HCI_INVALID_HANDLE;
+
+  /* Give the link its normal packet types back */
+  if (btif_a2dp_source_cb.link_policy.robust) {
+    do_in_bta_thread(FROM_HERE,
+                     base::Bind(&btif_a2dp_source_apply_link_policy,
+                                btif_a2dp_source_cb.link_policy_peer, false));
+  }
+  a2dp_link_policy_reset(&btif_a2dp_source_cb.link_policy);
+
   if (!btif_a2dp_source_is_hal_v2_supported()) {
     UIPC_Close(UIPC_CH_ID_AV_AUDIO);
   }
@@ -987,6 +1134,7 @@ static void btif_a2dp_source_alarm_cb(UNUSED_ATTR void* context) {
 }
 
 static void btif_a2dp_source_audio_handle_timer(UNUSED_ATTR void* context) {
+  BT_TRACE_SCOPE("a2dp encode");
   uint64_t timestamp_us = time_get_os_boottime_us();
   int curr_idx = btif_av_get_latest_device_idx_to_start();
   log_tstamps_us("A2DP Source tx timer", timestamp_us);
@@ -998,12 +1146,30 @@ static void btif_a2dp_source_audio_handle_timer(UNUSED_ATTR void* context) {
 #ifndef OS_GENERIC
     ATRACE_INT("btif TX queue", transmit_queue_length);
 #endif
+    bool read_link_quality = false;
     if (btif_a2dp_source_cb.encoder_interface->set_transmit_queue_length !=
         NULL) {
       btif_a2dp_source_cb.encoder_interface->set_transmit_queue_length(
           transmit_queue_length);
+      read_link_quality = true;
+    }
+    if (btif_a2dp_source_cb.link_policy_enabled) {
+      if (a2dp_link_policy_update(&btif_a2dp_source_cb.link_policy,
+                                  transmit_queue_length)) {
+        do_in_bta_thread(
+            FROM_HERE, base::Bind(&btif_a2dp_source_apply_link_policy,
+                                  btif_a2dp_source_cb.link_policy_peer,
+                                  btif_a2dp_source_cb.link_policy.robust));
+      }
+      read_link_quality = true;
+    }
+    if (read_link_quality) btif_a2dp_source_read_link_quality(timestamp_us);
+    if (btif_a2dp_source_cb.tick_pll_enabled) {
+      btif_a2dp_source_cb.encoder_interface->send_frames(
+          btif_a2dp_source_tick_pll_update(timestamp_us));
+    } else {
+      btif_a2dp_source_cb.encoder_interface->send_frames(timestamp_us);
     }
-    btif_a2dp_source_cb.encoder_interface->send_frames(timestamp_us);
     if (btif_av_check_flag_remote_suspend(curr_idx) || btif_a2dp_source_cb.tx_flush) {
       APPL_TRACE_ERROR("Don't signal data ready BTU task since remote suspended or tx_flush = %d", btif_a2dp_source_cb.tx_flush);
     } else {
@@ -1021,7 +1187,14 @@ static uint32_t btif_a2dp_source_read_callback(uint8_t* p_buf, uint32_t len) {
   uint16_t event;
   uint32_t bytes_read = 0;
   if (btif_a2dp_source_is_hal_v2_supported()) {
-    bytes_read = bluetooth::audio::a2dp::read(p_buf, len);
+    bool overrun = false;
+    bytes_read = bluetooth::audio::a2dp::read(p_buf, len, &overrun);
+    if (overrun) {
+      // The audio HAL found the FMQ full and waited for this read
+      btif_a2dp_source_cb.stats.media_read_total_overrun_count++;
+      btif_a2dp_source_cb.stats.media_read_last_overrun_us =
+          time_get_os_boottime_us();
+    }
   } else {
     bytes_read = UIPC_Read(UIPC_CH_ID_AV_AUDIO, &event, p_buf, len);
   }
@@ -1063,7 +1236,8 @@ static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
     btif_a2dp_source_cb.stats.tx_queue_total_flushed_messages +=
         fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue);
     btif_a2dp_source_cb.stats.tx_queue_last_flushed_us = now_us;
-    fixed_queue_flush(btif_a2dp_source_cb.tx_audio_queue, osi_free);
+    fixed_queue_flush(btif_a2dp_source_cb.tx_audio_queue,
+                      btif_a2dp_source_free_tx_buf);
 
     osi_free(p_buf);
     return false;
@@ -1071,12 +1245,13 @@ static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
 
   // Check for TX queue overflow
   // TODO: Using frames_n here is probably wrong: should be "+ 1" instead.
+  size_t tx_queue_limit = btif_a2dp_source_tx_queue_limit;
   if (fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue) + frames_n >
-      MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ) {
-    LOG_DEBUG(LOG_TAG, "%s: TX queue buffer size now=%u adding=%u max=%d",
+      tx_queue_limit) {
+    LOG_DEBUG(LOG_TAG, "%s: TX queue buffer size now=%u adding=%u max=%zu",
              __func__,
              (uint32_t)fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue),
-             (uint32_t)frames_n, MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ);
+             (uint32_t)frames_n, tx_queue_limit);
     // Keep track of drop-outs
     btif_a2dp_source_cb.stats.tx_queue_dropouts++;
     btif_a2dp_source_cb.stats.tx_queue_last_dropouts_us = now_us;
@@ -1087,7 +1262,8 @@ static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
         drop_n, btif_a2dp_source_cb.stats.tx_queue_max_dropped_messages);
     while (fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue)) {
       btif_a2dp_source_cb.stats.tx_queue_total_dropped_messages++;
-      osi_free(fixed_queue_try_dequeue(btif_a2dp_source_cb.tx_audio_queue));
+      btif_a2dp_source_free_tx_buf(
+          fixed_queue_try_dequeue(btif_a2dp_source_cb.tx_audio_queue));
     }
 
     // Request RSSI and Failed Contact Counter for log purposes if we had to
@@ -1125,11 +1301,62 @@ static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
       frames_n, btif_a2dp_source_cb.stats.tx_queue_max_frames_per_packet);
   CHECK(btif_a2dp_source_cb.encoder_interface != NULL);
 
+  BT_TRACE_PACKET_BEGIN("a2dp tx queue", p_buf);
+  btif_a2dp_source_stamp_tx_buf(p_buf, now_us);
+  memory_governor_charge(btif_a2dp_source_memory,
+                         btif_a2dp_source_tx_buf_size(p_buf));
   fixed_queue_enqueue(btif_a2dp_source_cb.tx_audio_queue, p_buf);
 
   return true;
 }
 
+// Frees a buffer of the TX queue that is not going to be sent
+static void btif_a2dp_source_free_tx_buf(void* p_buf) {
+  BT_TRACE_PACKET_END("a2dp tx queue", p_buf);
+  memory_governor_release(
+      btif_a2dp_source_memory,
+      btif_a2dp_source_tx_buf_size(static_cast<BT_HDR*>(p_buf)));
+  osi_free(p_buf);
+}
+
+// Bytes of a TX queue buffer for the memory governor
+static size_t btif_a2dp_source_tx_buf_size(const BT_HDR* p_buf) {
+  return sizeof(BT_HDR) + p_buf->offset + p_buf->len;
+}
+
+// The time a buffer entered the TX queue is kept in its headroom, right after
+// the RTP timestamp written by the encoder. The lower layers only write their
+// headers there once the buffer has left the queue.
+#define BTIF_A2DP_SOURCE_TX_STAMP_OFFSET sizeof(uint32_t)
+#define BTIF_A2DP_SOURCE_TX_STAMP_END \
+  (BTIF_A2DP_SOURCE_TX_STAMP_OFFSET + sizeof(uint64_t))
+
+static void btif_a2dp_source_stamp_tx_buf(BT_HDR* p_buf, uint64_t now_us) {
+  if (p_buf->offset < BTIF_A2DP_SOURCE_TX_STAMP_END) return;
+  memcpy((uint8_t*)(p_buf + 1) + BTIF_A2DP_SOURCE_TX_STAMP_OFFSET, &now_us,
+         sizeof(now_us));
+}
+
+// Sets |p_age_us| to the time |p_buf| spent in the TX queue until |now_us|.
+// Returns false if the buffer has no room for its enqueue time.
+static bool btif_a2dp_source_tx_buf_age_us(const BT_HDR* p_buf, uint64_t now_us,
+                                           uint64_t* p_age_us) {
+  if (p_buf->offset < BTIF_A2DP_SOURCE_TX_STAMP_END) return false;
+  uint64_t enqueue_us;
+  memcpy(&enqueue_us,
+         (const uint8_t*)(p_buf + 1) + BTIF_A2DP_SOURCE_TX_STAMP_OFFSET,
+         sizeof(enqueue_us));
+  *p_age_us = (now_us > enqueue_us) ? now_us - enqueue_us : 0;
+  return true;
+}
+
+// Shortens the TX queue under memory pressure, keeping room for a tick
+static void btif_a2dp_source_memory_pressure(memory_pressure_t pressure,
+                                             UNUSED_ATTR void* context) {
+  btif_a2dp_source_tx_queue_limit = memory_governor_scale(
+      MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ, MAX_PCM_FRAME_NUM_PER_TICK, pressure);
+}
+
 static void btif_a2dp_source_audio_tx_flush_event(UNUSED_ATTR BT_HDR* p_msg) {
   /* Flush all enqueued audio buffers (encoded) */
   APPL_TRACE_DEBUG("%s", __func__);
@@ -1141,7 +1368,8 @@ static void btif_a2dp_source_audio_tx_flush_event(UNUSED_ATTR BT_HDR* p_msg) {
       fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue);
   btif_a2dp_source_cb.stats.tx_queue_last_flushed_us =
       time_get_os_boottime_us();
-  fixed_queue_flush(btif_a2dp_source_cb.tx_audio_queue, osi_free);
+  fixed_queue_flush(btif_a2dp_source_cb.tx_audio_queue,
+                    btif_a2dp_source_free_tx_buf);
 
   if (!btif_a2dp_source_is_hal_v2_supported()) {
     UIPC_Ioctl(UIPC_CH_ID_AV_AUDIO, UIPC_REQ_RX_FLUSH, NULL);
@@ -1171,12 +1399,31 @@ static bool btif_a2dp_source_audio_tx_flush_req(void) {
 
 BT_HDR* btif_a2dp_source_audio_readbuf(void) {
   uint64_t now_us = time_get_os_boottime_us();
-  BT_HDR* p_buf =
-      (BT_HDR*)fixed_queue_try_dequeue(btif_a2dp_source_cb.tx_audio_queue);
+  uint64_t latency_target_us = btif_a2dp_source_tx_latency_target_us;
+  uint64_t age_us = 0;
+  bool age_known = false;
+  BT_HDR* p_buf;
   APPL_TRACE_DEBUG("%s:", __func__);
   btif_a2dp_source_cb.stats.tx_queue_total_readbuf_calls++;
   btif_a2dp_source_cb.stats.tx_queue_last_readbuf_us = now_us;
+
+  // Skip the packets that would reach the peer past the latency target: under
+  // congestion sending them only delays the fresh audio behind them.
+  while ((p_buf = (BT_HDR*)fixed_queue_try_dequeue(
+              btif_a2dp_source_cb.tx_audio_queue)) != NULL) {
+    age_known = btif_a2dp_source_tx_buf_age_us(p_buf, now_us, &age_us);
+    if (!age_known || latency_target_us == 0 || age_us <= latency_target_us)
+      break;
+    btif_a2dp_source_cb.stats.tx_queue_total_expired_messages++;
+    btif_a2dp_source_cb.stats.tx_queue_last_expired_us = now_us;
+    btif_a2dp_source_free_tx_buf(p_buf);
+  }
+
   if (p_buf != NULL) {
+    if (age_known) update_queue_age_stats(&btif_a2dp_source_cb.stats, age_us);
+    BT_TRACE_PACKET_END("a2dp tx queue", p_buf);
+    memory_governor_release(btif_a2dp_source_memory,
+                            btif_a2dp_source_tx_buf_size(p_buf));
     APPL_TRACE_DEBUG("%s: p_buf is not null, updating queue statistics.", __func__);
     // Update the statistics
     update_scheduling_stats(&btif_a2dp_source_cb.stats.tx_queue_dequeue_stats,
@@ -1195,6 +1442,101 @@ static void log_tstamps_us(const char* comment, uint64_t timestamp_us) {
   prev_us = timestamp_us;
 }
 
+// Advances the encoder tick clock to the media alarm wakeup at |now_us|.
+// The clock is a second order PLL locked on the alarm: the period estimate
+// follows the mean tick rate and the phase takes 1/8 of each tick error, so
+// a late wakeup spreads its catch-up frames over the next ticks instead of
+// producing a burst. Returns the tick clock in us.
+static uint64_t btif_a2dp_source_tick_pll_update(uint64_t now_us) {
+  int64_t period_ns = btif_a2dp_source_cb.encoder_interval_ms * 1000000;
+  uint64_t now_ns = now_us * 1000;
+
+  if (btif_a2dp_source_cb.tick_clock_ns == 0) {
+    btif_a2dp_source_cb.tick_clock_ns = now_ns;
+    return now_us;
+  }
+
+  uint64_t predicted_ns =
+      btif_a2dp_source_cb.tick_clock_ns + btif_a2dp_source_cb.tick_period_ns;
+  int64_t error_ns = (int64_t)(now_ns - predicted_ns);
+  if (error_ns > 4 * period_ns || error_ns < -4 * period_ns) {
+    // Stalled or reset timer, lock again on this wakeup
+    btif_a2dp_source_cb.tick_clock_ns = now_ns;
+    btif_a2dp_source_cb.tick_period_ns = period_ns;
+    return now_us;
+  }
+
+  btif_a2dp_source_cb.tick_clock_ns = predicted_ns + error_ns / 8;
+  int64_t tick_period_ns = btif_a2dp_source_cb.tick_period_ns + error_ns / 64;
+  tick_period_ns = std::max(tick_period_ns, period_ns / 2);
+  tick_period_ns = std::min(tick_period_ns, period_ns * 2);
+  btif_a2dp_source_cb.tick_period_ns = tick_period_ns;
+
+  return btif_a2dp_source_cb.tick_clock_ns / 1000;
+}
+
+static void update_jitter_histogram(scheduling_stats_t* stats,
+                                    uint64_t delta_us) {
+  int bucket = 0;
+  while (bucket < BTIF_A2DP_SOURCE_JITTER_BUCKETS - 1 &&
+         delta_us >= (100ull << bucket)) {
+    bucket++;
+  }
+  stats->jitter_histogram[bucket]++;
+}
+
+// Returns the upper bound in us of the jitter histogram bucket holding the
+// |percent| percentile, or 0 if there is no sample. The last bucket has no
+// upper bound and is reported as its lower bound.
+static uint64_t get_jitter_percentile_us(const scheduling_stats_t* stats,
+                                         size_t percent) {
+  size_t total = 0;
+  for (int i = 0; i < BTIF_A2DP_SOURCE_JITTER_BUCKETS; i++)
+    total += stats->jitter_histogram[i];
+  if (total == 0) return 0;
+
+  size_t rank = (total * percent + 99) / 100;
+  size_t count = 0;
+  for (int i = 0; i < BTIF_A2DP_SOURCE_JITTER_BUCKETS - 1; i++) {
+    count += stats->jitter_histogram[i];
+    if (count >= rank) return 100ull << i;
+  }
+  return 100ull << (BTIF_A2DP_SOURCE_JITTER_BUCKETS - 2);
+}
+
+static void update_queue_age_stats(btif_media_stats_t* stats,
+                                   uint64_t age_us) {
+  stats->tx_queue_total_queueing_time_us += age_us;
+  stats->tx_queue_max_queueing_time_us =
+      std::max(stats->tx_queue_max_queueing_time_us, age_us);
+
+  int bucket = 0;
+  while (bucket < BTIF_A2DP_SOURCE_QUEUE_AGE_BUCKETS - 1 &&
+         age_us >= (1000ull << bucket)) {
+    bucket++;
+  }
+  stats->tx_queue_age_histogram[bucket]++;
+}
+
+// Returns the upper bound in ms of the queue age histogram bucket holding the
+// |percent| percentile, or 0 if there is no sample. The last bucket has no
+// upper bound and is reported as its lower bound.
+static uint64_t get_queue_age_percentile_ms(const btif_media_stats_t* stats,
+                                            size_t percent) {
+  size_t total = 0;
+  for (int i = 0; i < BTIF_A2DP_SOURCE_QUEUE_AGE_BUCKETS; i++)
+    total += stats->tx_queue_age_histogram[i];
+  if (total == 0) return 0;
+
+  size_t rank = (total * percent + 99) / 100;
+  size_t count = 0;
+  for (int i = 0; i < BTIF_A2DP_SOURCE_QUEUE_AGE_BUCKETS - 1; i++) {
+    count += stats->tx_queue_age_histogram[i];
+    if (count >= rank) return 1ull << i;
+  }
+  return 1ull << (BTIF_A2DP_SOURCE_QUEUE_AGE_BUCKETS - 2);
+}
+
 static void update_scheduling_stats(scheduling_stats_t* stats, uint64_t now_us,
                                     uint64_t expected_delta) {
   uint64_t last_us = stats->last_update_us;
@@ -1215,6 +1557,7 @@ static void update_scheduling_stats(scheduling_stats_t* stats, uint64_t now_us,
       stats->total_overdue_scheduling_delta_us += delta_us;
       stats->overdue_scheduling_count++;
       stats->total_scheduling_time_us += now_us - last_us;
+      update_jitter_histogram(stats, delta_us);
     }
   } else if (deadline_us > now_us) {
     // Premature scheduling
@@ -1226,11 +1569,13 @@ static void update_scheduling_stats(scheduling_stats_t* stats, uint64_t now_us,
       stats->total_premature_scheduling_delta_us += delta_us;
       stats->premature_scheduling_count++;
       stats->total_scheduling_time_us += now_us - last_us;
+      update_jitter_histogram(stats, delta_us);
     }
   } else {
     // On-time scheduling
     stats->exact_scheduling_count++;
     stats->total_scheduling_time_us += now_us - last_us;
+    update_jitter_histogram(stats, 0);
   }
 }
 
@@ -1308,6 +1653,47 @@ void btif_a2dp_source_debug_dump(int fd) {
                 1000
           : 0);
 
+  dprintf(fd,
+          "  Counts (expired past the latency target)                : %zu "
+          "(target %llu ms)\n",
+          accumulated_stats->tx_queue_total_expired_messages,
+          (unsigned long long)btif_a2dp_source_tx_latency_target_us / 1000);
+
+  dprintf(fd,
+          "  Last update time ago in ms (expired)                    : %llu\n",
+          (accumulated_stats->tx_queue_last_expired_us > 0)
+              ? (unsigned long long)(now_us -
+                                     accumulated_stats
+                                         ->tx_queue_last_expired_us) /
+                    1000
+              : 0);
+
+  size_t age_count = 0;
+  for (int i = 0; i < BTIF_A2DP_SOURCE_QUEUE_AGE_BUCKETS; i++)
+    age_count += accumulated_stats->tx_queue_age_histogram[i];
+  ave_time_us = 0;
+  if (age_count != 0) {
+    ave_time_us =
+        accumulated_stats->tx_queue_total_queueing_time_us / age_count;
+  }
+  dprintf(
+      fd,
+      "  Queueing time in ms (total/max/ave)                     : %llu / %llu "
+      "/ %llu\n",
+      (unsigned long long)accumulated_stats->tx_queue_total_queueing_time_us /
+          1000,
+      (unsigned long long)accumulated_stats->tx_queue_max_queueing_time_us /
+          1000,
+      (unsigned long long)ave_time_us / 1000);
+
+  dprintf(
+      fd,
+      "  Queue age percentiles in ms (p50/p90/p99)               : %llu / %llu "
+      "/ %llu\n",
+      (unsigned long long)get_queue_age_percentile_ms(accumulated_stats, 50),
+      (unsigned long long)get_queue_age_percentile_ms(accumulated_stats, 90),
+      (unsigned long long)get_queue_age_percentile_ms(accumulated_stats, 99));
+
   dprintf(fd,
           "  Counts (underflow)                                      : %zu\n",
           accumulated_stats->media_read_total_underflow_count);
@@ -1325,6 +1711,37 @@ void btif_a2dp_source_debug_dump(int fd) {
                     1000
               : 0);
 
+  dprintf(fd,
+          "  Counts (overrun)                                        : %zu\n",
+          accumulated_stats->media_read_total_overrun_count);
+
+  dprintf(fd,
+          "  Last update time ago in ms (overrun)                    : %llu\n",
+          (accumulated_stats->media_read_last_overrun_us > 0)
+              ? (unsigned long long)(now_us -
+                                     accumulated_stats
+                                         ->media_read_last_overrun_us) /
+                    1000
+              : 0);
+
+  tBTA_AV_MEDIA_STATS media_stats;
+  size_t copies_per_100_packets = 0;
+  BTA_AvGetMediaStats(&media_stats);
+  if (media_stats.packets != 0)
+    copies_per_100_packets = media_stats.copies * 100 / media_stats.packets;
+  dprintf(fd,
+          "  Media packets (written/copies/copied bytes)             : %zu / "
+          "%zu / %zu\n",
+          media_stats.packets, media_stats.copies, media_stats.copied_bytes);
+  dprintf(fd,
+          "  Copies per packet                                       : "
+          "%zu.%02zu\n",
+          copies_per_100_packets / 100, copies_per_100_packets % 100);
+  dprintf(fd,
+          "  Multicast fan-out packets (shared encode/codec mismatch): %zu / "
+          "%zu\n",
+          media_stats.fanout_packets, media_stats.fanout_mismatches);
+
   //
   // TxQueue enqueue stats
   //
@@ -1363,6 +1780,19 @@ void btif_a2dp_source_debug_dump(int fd) {
           1000,
       (unsigned long long)ave_time_us / 1000);
 
+  dprintf(fd,
+          "  Enqueue jitter percentiles in us (p50/p90/p99)          : %llu / "
+          "%llu / %llu\n",
+          (unsigned long long)get_jitter_percentile_us(enqueue_stats, 50),
+          (unsigned long long)get_jitter_percentile_us(enqueue_stats, 90),
+          (unsigned long long)get_jitter_percentile_us(enqueue_stats, 99));
+
+  dprintf(fd,
+          "  Enqueue tick clock (enabled/period in us)               : %s / "
+          "%llu\n",
+          btif_a2dp_source_cb.tick_pll_enabled ? "true" : "false",
+          (unsigned long long)btif_a2dp_source_cb.tick_period_ns / 1000);
+
   //
   // TxQueue dequeue stats
   //
@@ -1401,6 +1831,21 @@ void btif_a2dp_source_debug_dump(int fd) {
           1000,
       (unsigned long long)ave_time_us / 1000);
 
+  dprintf(fd,
+          "  Dequeue jitter percentiles in us (p50/p90/p99)          : %llu / "
+          "%llu / %llu\n",
+          (unsigned long long)get_jitter_percentile_us(dequeue_stats, 50),
+          (unsigned long long)get_jitter_percentile_us(dequeue_stats, 90),
+          (unsigned long long)get_jitter_percentile_us(dequeue_stats, 99));
+
+  //
+  // Link policy
+  //
+  dprintf(fd,
+          "  Link policy (enabled)                                   : %s\n",
+          btif_a2dp_source_cb.link_policy_enabled ? "true" : "false");
+  a2dp_link_policy_debug_dump(&btif_a2dp_source_cb.link_policy, fd);
+
   //
   // Codec-specific stats
   //
@@ -1453,6 +1898,22 @@ void btif_a2dp_source_update_metrics(void) {
   BluetoothMetricsLogger::GetInstance()->LogA2dpSession(metrics);
 }
 
+// Samples the link quality of the active peer for the encoder adaptive bit
+// rate and the link policy, every A2DP_SOURCE_LINK_QUALITY_INTERVAL_MS while
+// streaming.
+static void btif_a2dp_source_read_link_quality(uint64_t timestamp_us) {
+  if (timestamp_us - btif_a2dp_source_cb.last_link_quality_read_us <
+      A2DP_SOURCE_LINK_QUALITY_INTERVAL_MS * 1000)
+    return;
+  btif_a2dp_source_cb.last_link_quality_read_us = timestamp_us;
+
+  RawAddress peer_bda;
+  btif_av_get_active_peer_addr(&peer_bda);
+  if (BTM_ReadRSSI(peer_bda, btm_read_rssi_cb) != BTM_CMD_STARTED)
+    return;
+  BTM_ReadFailedContactCounter(peer_bda, btm_read_failed_contact_counter_cb);
+}
+
 static void btm_read_rssi_cb(void* data) {
   if (data == nullptr) {
     LOG_ERROR(LOG_TAG, "%s Read RSSI request timed out", __func__);
@@ -1466,8 +1927,9 @@ static void btm_read_rssi_cb(void* data) {
     return;
   }
 
-  LOG_WARN(LOG_TAG, "%s device: %s, rssi: %d", __func__,
+  LOG_INFO(LOG_TAG, "%s device: %s, rssi: %d", __func__,
            result->rem_bda.ToString().c_str(), result->rssi);
+  a2dp_abr_report_rssi(result->rssi);
 }
 
 static void btm_read_failed_contact_counter_cb(void* data) {
@@ -1485,8 +1947,80 @@ static void btm_read_failed_contact_counter_cb(void* data) {
     return;
   }
 
-  LOG_WARN(LOG_TAG, "%s device: %s, Failed Contact Counter: %u", __func__,
+  LOG_INFO(LOG_TAG, "%s device: %s, Failed Contact Counter: %u", __func__,
            result->rem_bda.ToString().c_str(), result->failed_contact_counter);
+  a2dp_abr_report_failed_contact_counter(result->failed_contact_counter);
+  a2dp_link_policy_report_failed_contact_counter(
+      result->failed_contact_counter);
+}
+
+// Quality reports of the controller, received on the BTU thread. A report of
+// choppy audio or one meeting the BQR warning criteria on the streaming link
+// counts as a degraded link for the encoder ABR and the link policy.
+static void btif_a2dp_source_link_quality_cb(
+    const bluetooth::bqr::BqrLinkQuality& report,
+    UNUSED_ATTR const bluetooth::bqr::BqrLinkQualityAggregate& aggregate,
+    UNUSED_ATTR void* context) {
+  using bluetooth::bqr::QUALITY_REPORT_ID_A2DP_AUDIO_CHOPPY;
+
+  if (report.connection_handle != btif_a2dp_source_bqr_handle) return;
+  if (!report.warning &&
+      report.quality_report_id != QUALITY_REPORT_ID_A2DP_AUDIO_CHOPPY)
+    return;
+
+  a2dp_abr_report_link_degraded();
+  a2dp_link_policy_report_link_degraded();
+}
+
+// What the link policy changed on the link, only used on the BTA thread
+static struct {
+  RawAddress peer_bda;
+  bool robust;
+  uint16_t normal_pkt_types;
+  uint16_t normal_flush_tout;
+  uint16_t robust_pkt_types;
+  uint16_t robust_flush_tout;
+} btif_a2dp_source_robust_link;
+
+// Changes the link to |peer_bda| to the robust packet types and flush timeout
+// if |robust|, or back to what it used before. What others changed on the
+// link in the meantime, like the packet types limit of some codecs, is kept.
+static void btif_a2dp_source_apply_link_policy(const RawAddress& peer_bda,
+                                               bool robust) {
+  auto& link = btif_a2dp_source_robust_link;
+
+  if (link.robust && (!robust || link.peer_bda != peer_bda)) {
+    link.robust = false;
+    if (BTM_ReadPacketTypes(link.peer_bda) == link.robust_pkt_types)
+      BTM_SetPacketTypes(link.peer_bda, link.normal_pkt_types);
+    if (L2CA_GetFlushTimeout(link.peer_bda) == link.robust_flush_tout)
+      L2CA_SetFlushTimeout(link.peer_bda, link.normal_flush_tout);
+    btif_debug_conn_link_policy(link.peer_bda, "A2DP normal",
+                                BTM_ReadPacketTypes(link.peer_bda),
+                                L2CA_GetFlushTimeout(link.peer_bda));
+  }
+  if (!robust || link.robust) return;
+
+  link.normal_pkt_types = BTM_ReadPacketTypes(peer_bda);
+  if (link.normal_pkt_types == 0) {
+    LOG_WARN(LOG_TAG, "%s: no ACL link to %s", __func__,
+             peer_bda.ToString().c_str());
+    return;
+  }
+  link.peer_bda = peer_bda;
+  link.robust = true;
+  BTM_SetPacketTypes(peer_bda,
+                     a2dp_link_policy_robust_pkt_types(link.normal_pkt_types));
+  link.robust_pkt_types = BTM_ReadPacketTypes(peer_bda);
+
+  link.normal_flush_tout = L2CA_GetFlushTimeout(peer_bda);
+  if (A2DP_LINK_POLICY_ROBUST_FLUSH_TO_MS != 0 &&
+      link.normal_flush_tout > A2DP_LINK_POLICY_ROBUST_FLUSH_TO_MS)
+    L2CA_SetFlushTimeout(peer_bda, A2DP_LINK_POLICY_ROBUST_FLUSH_TO_MS);
+  link.robust_flush_tout = L2CA_GetFlushTimeout(peer_bda);
+
+  btif_debug_conn_link_policy(peer_bda, "A2DP robust", link.robust_pkt_types,
+                              link.robust_flush_tout);
 }
 
 static void btm_read_automatic_flush_timeout_cb(void* data) {
@@ -1544,6 +2078,10 @@ bool btif_a2dp_source_start_session(const RawAddress& peer_address) {
     return false;
   }
 
+  // A new session reads the cached properties again, such as the SBC
+  // middle quality of the encoder
+  osi_property_cache_refresh();
+
   if (btif_a2dp_source_is_hal_v2_supported()) {
     APPL_TRACE_EVENT("%s calling ## init ##", __func__);
     bluetooth::audio::a2dp::init(btif_a2dp_source_cb.worker_thread);
@@ -1556,7 +2094,8 @@ bool btif_a2dp_source_start_session(const RawAddress& peer_address) {
     if (bluetooth::audio::a2dp::get_session_type() ==
        SessionType::A2DP_SOFTWARE_ENCODING_DATAPATH) {
       APPL_TRACE_EVENT("%s Freeing queue from previous session", __func__);
-      fixed_queue_flush(btif_a2dp_source_cb.tx_audio_queue, osi_free);
+      fixed_queue_flush(btif_a2dp_source_cb.tx_audio_queue,
+                        btif_a2dp_source_free_tx_buf);
     }
   }
   btif_a2dp_update_sink_latency_change();
@@ -55,6 +55,8 @@
 #include <base/logging.h>
 #include <string.h>
 
+#include <atomic>
+
 #include <hardware/bluetooth.h>
 #include <hardware/bt_av.h>
 #include <hardware/bt_rc_ext.h>
@@ -69,6 +71,7 @@
 #include "btif_a2dp_control.h"
 #include "btif_a2dp_sink.h"
 #include "btif_av_co.h"
+#include "btif_debug_conn.h"
 #include "btif_profile_queue.h"
 #include "btif_util.h"
 #include "btu.h"
@@ -239,6 +242,16 @@ static btav_sink_callbacks_t* bt_av_sink_callbacks = NULL;
 static btif_av_cb_t btif_av_cb[BTIF_AV_NUM_CB];
 btif_av_collision_detect_t collision_detect[BTIF_AV_NUM_CB];
 
+/* Peers of btif_av_cb by state, one bit per index. They are updated on the
+ * state machine transitions, so that the lookups made on every media event
+ * avoid scanning btif_av_cb and are safe from the media threads. */
+static struct {
+  std::atomic<uint32_t> opened;   /* In BTIF_AV_STATE_OPENED */
+  std::atomic<uint32_t> started;  /* In BTIF_AV_STATE_STARTED */
+  std::atomic<uint32_t> playing;  /* current_playing set */
+  std::atomic<int> last_bda_idx;  /* Last btif_av_idx_by_bdaddr() hit */
+} btif_av_peers;
+
 static alarm_t* av_open_on_rc_timer = NULL;
 static btif_sm_event_t idle_rc_event;
 static tBTA_AV idle_rc_data;
@@ -522,6 +535,49 @@ static void btif_initiate_av_open_timer_timeout(void* data) {
  *  Static functions
  *****************************************************************************/
 
+/* Returns the lowest index in |mask| of btif_av_peers, btif_max_av_clients if
+ * there is none */
+static int btif_av_peers_first(uint32_t mask) {
+  mask &= (1u << btif_max_av_clients) - 1;
+  return (mask != 0) ? __builtin_ctz(mask) : btif_max_av_clients;
+}
+
+/* Returns |mask| of btif_av_peers without |index| */
+static uint32_t btif_av_peers_other(uint32_t mask, int index) {
+  mask &= (1u << btif_max_av_clients) - 1;
+  if (index >= 0 && index < BTIF_AV_NUM_CB) mask &= ~(1u << index);
+  return mask;
+}
+
+/* Records that the state machine of |index| entered |state| */
+static void btif_av_peers_set_state(int index, btif_sm_state_t state) {
+  uint32_t bit = 1u << index;
+  if (state == BTIF_AV_STATE_OPENED)
+    btif_av_peers.opened |= bit;
+  else
+    btif_av_peers.opened &= ~bit;
+  if (state == BTIF_AV_STATE_STARTED)
+    btif_av_peers.started |= bit;
+  else
+    btif_av_peers.started &= ~bit;
+}
+
+static void btif_av_set_current_playing(int index, bool current_playing) {
+  btif_av_cb[index].current_playing = current_playing;
+  if (current_playing)
+    btif_av_peers.playing |= 1u << index;
+  else
+    btif_av_peers.playing &= ~(1u << index);
+}
+
+/* Forgets |index| in btif_av_peers, for a state machine that is gone */
+static void btif_av_peers_clear(int index) {
+  btif_av_peers_set_state(index, BTIF_AV_STATE_IDLE);
+  btif_av_peers.playing &= ~(1u << index);
+  if (btif_av_peers.last_bda_idx == index)
+    btif_av_peers.last_bda_idx = BTIF_AV_NUM_CB;
+}
+
 static void btif_av_disconnect_queue_advance_by_uuid(const RawAddress* bd_addr) {
   if (bd_addr == NULL) {
     BTIF_TRACE_DEBUG("%s: bd_addr is null", __func__);
@@ -559,6 +615,8 @@ static void btif_av_disconnect_queue_advance_by_uuid(const RawAddress* bd_addr)
  ******************************************************************************/
 static void btif_report_connection_state(btav_connection_state_t state,
                                          RawAddress* bd_addr) {
+  if (state == BTAV_CONNECTION_STATE_CONNECTED)
+    btif_debug_conn_milestone(*bd_addr, BTIF_DEBUG_CONN_PROFILE_CONNECTED);
   if (bt_av_sink_callbacks != NULL) {
     HAL_CBACK(bt_av_sink_callbacks, connection_state_cb, *bd_addr, state);
   } else if (bt_av_src_callbacks != NULL) {
@@ -979,13 +1037,14 @@ static bool btif_av_state_idle_handler(btif_sm_event_t event, void* p_data, int
 
   switch (event) {
     case BTIF_SM_ENTER_EVT:
+      btif_av_peers_set_state(index, BTIF_AV_STATE_IDLE);
       /* clear the peer_bda */
       BTIF_TRACE_EVENT("%s: IDLE state for index: %d", __func__, index);
       memset(&btif_av_cb[index].peer_bda, 0, sizeof(RawAddress));
       btif_av_cb[index].flags = 0;
       btif_av_cb[index].edr_3mbps = false;
       btif_av_cb[index].edr = 0;
-      btif_av_cb[index].current_playing = false;
+      btif_av_set_current_playing(index, false);
       btif_av_cb[index].is_slave = false;
       btif_av_cb[index].is_device_playing = false;
       btif_av_cb[index].reconfig_pending = false;
@@ -1316,6 +1375,7 @@ static bool btif_av_state_opening_handler(btif_sm_event_t event, void* p_data,
 
   switch (event) {
     case BTIF_SM_ENTER_EVT:
+      btif_av_peers_set_state(index, BTIF_AV_STATE_OPENING);
       //When uncheck media audio from settings UI and try to connect from remote,
       //a2dp would fail. Then check the media audio from UI, then due to peer codec info
       //null, so it will not go for A2dp connection. So reinit peer codecs if null.
@@ -1606,7 +1666,10 @@ static bool btif_av_state_opening_handler(btif_sm_event_t event, void* p_data,
          BTA_AvCloseRc(peer_handle);
        }
        BTA_AvClose(btif_av_cb[index].bta_handle);
-       btif_queue_advance();
+       btif_queue_advance_by_uuid(bt_av_sink_callbacks != NULL
+                                      ? UUID_SERVCLASS_AUDIO_SINK
+                                      : UUID_SERVCLASS_AUDIO_SOURCE,
+                                  &(btif_av_cb[index].peer_bda));
        btif_sm_change_state(btif_av_cb[index].sm_handle, BTIF_AV_STATE_IDLE);
        btif_report_connection_state_to_ba(BTAV_CONNECTION_STATE_DISCONNECTED);
        } break;
@@ -1653,6 +1716,7 @@ static bool btif_av_state_closing_handler(btif_sm_event_t event, void* p_data, i
 
   switch (event) {
     case BTIF_SM_ENTER_EVT:
+      btif_av_peers_set_state(index, BTIF_AV_STATE_CLOSING);
       if (btif_av_cb[index].peer_sep == AVDT_TSEP_SNK) {
         /* Multicast/Soft Hand-off:
          * If MC/SHO is enabled we need to keep/start playing on
@@ -1835,6 +1899,7 @@ static bool btif_av_state_opened_handler(btif_sm_event_t event, void* p_data,
 
   switch (event) {
     case BTIF_SM_ENTER_EVT: {
+      btif_av_peers_set_state(index, BTIF_AV_STATE_OPENED);
       btif_av_cb[index].flags &= ~BTIF_AV_FLAG_PENDING_STOP;
       if (btif_av_cb[index].reconfig_pending &&
           (btif_av_cb[index].flags &= BTIF_AV_FLAG_PENDING_START) != 0 &&
@@ -2229,6 +2294,9 @@ static bool btif_av_state_opened_handler(btif_sm_event_t event, void* p_data,
         if (btif_a2dp_source_is_restart_session_needed()) {
           btif_report_source_codec_state(p_data, &btif_av_cb[index].peer_bda);
         } else {
+          /* Set up the new encoder while the peer answers the start */
+          if (!btif_a2dp_source_is_hal_v2_supported())
+            btif_a2dp_source_encoder_prepare(btif_av_cb[index].bta_handle);
           BTA_AvStart(btif_av_cb[index].bta_handle);
           ba_send_message(BTIF_BA_BT_A2DP_STARTING_EVT, 0, NULL, true);
         }
@@ -2378,6 +2446,7 @@ static bool btif_av_state_started_handler(btif_sm_event_t event, void* p_data,
 
   switch (event) {
     case BTIF_SM_ENTER_EVT:
+      btif_av_peers_set_state(index, BTIF_AV_STATE_STARTED);
       /* Ack from entry point of started handler instead of open state to avoid
        * race condition
        */
@@ -2468,7 +2537,7 @@ static bool btif_av_state_started_handler(btif_sm_event_t event, void* p_data,
 #if (TWS_ENABLED == TRUE)
      if (btif_av_current_device_is_tws() &&
        btif_av_cb[index].tws_device) {
-       btif_av_cb[index].current_playing = true;
+       btif_av_set_current_playing(index, true);
      }
 #endif
      if (!btif_av_is_split_a2dp_enabled() && btif_av_cb[index].reconfig_event) {
@@ -3134,7 +3203,7 @@ static void btif_av_handle_event(uint16_t event, char* p_param) {
         for(int i = 0; i < btif_max_av_clients; i++)
         {
           if (btif_av_cb[i].current_playing == TRUE)
-            btif_av_cb[i].current_playing = FALSE;
+            btif_av_set_current_playing(i, false);
         }
         BTIF_TRACE_IMP("Reset all Current Playing for Device -> Null");
         if (btif_a2dp_source_is_hal_v2_supported()) {
@@ -3186,7 +3255,7 @@ static void btif_av_handle_event(uint16_t event, char* p_param) {
       if (active_device_selected == false)
       {
         BTIF_TRACE_IMP("For Null -> Device set current playing and don't trigger handoff");
-        btif_av_cb[index].current_playing = TRUE;
+        btif_av_set_current_playing(index, true);
         btif_av_set_browse_active(*bt_addr, BTA_AV_BROWSE_ACTIVE);
         if (btif_a2dp_source_is_hal_v2_supported()) {
           //btif_av_set_offload_status();
@@ -3213,7 +3282,7 @@ static void btif_av_handle_event(uint16_t event, char* p_param) {
 #if (TWS_ENABLED == TRUE)
       if (btif_av_cb[index].tws_device &&
         btif_av_is_tws_device_playing(index)) {
-        btif_av_cb[index].current_playing = TRUE;
+        btif_av_set_current_playing(index, true);
         btif_av_signal_session_ready();
         BTIF_TRACE_DEBUG("TWSP device, do not trigger handoff");
         return;
@@ -3234,9 +3303,9 @@ static void btif_av_handle_event(uint16_t event, char* p_param) {
         for(int i = 0; i < btif_max_av_clients; i++)
         {
           if (i == index)
-            btif_av_cb[i].current_playing = TRUE;
+            btif_av_set_current_playing(i, true);
           else
-            btif_av_cb[i].current_playing = FALSE;
+            btif_av_set_current_playing(i, false);
 
           BTIF_TRACE_IMP("current_playing for index %d: %d", i,
                                btif_av_cb[i].current_playing);
@@ -3616,10 +3685,16 @@ static bool btif_av_get_valid_idx(int idx) {
  *
  ******************************************************************************/
 int btif_av_idx_by_bdaddr(const RawAddress *bd_addr) {
-  int i;
+  int i = btif_av_peers.last_bda_idx;
+  if (i < btif_max_av_clients && !bd_addr->IsEmpty() &&
+      *bd_addr == btif_av_cb[i].peer_bda)
+    return i;
+
   for (i = 0; i < btif_max_av_clients; i++)
-    if (*bd_addr == btif_av_cb[i].peer_bda)
+    if (*bd_addr == btif_av_cb[i].peer_bda) {
+      btif_av_peers.last_bda_idx = i;
       return i;
+    }
   return i;
 }
 
@@ -3643,10 +3718,7 @@ bool btif_av_is_current_device(RawAddress address) {
  *
  ******************************************************************************/
 int btif_av_get_latest_device_idx_to_start() {
-  int i;
-  for (i = 0; i < btif_max_av_clients; i++)
-    if (btif_av_cb[i].current_playing)
-      break;
+  int i = btif_av_peers_first(btif_av_peers.playing);
   if (i == btif_max_av_clients)
     BTIF_TRACE_ERROR("%s:No valid active device found",__func__);
   return i;
@@ -3662,15 +3734,9 @@ int btif_av_get_latest_device_idx_to_start() {
  *
  ******************************************************************************/
 int btif_av_get_latest_playing_device_idx() {
-  int i;
-  btif_sm_state_t state;
-  for (i = 0; i < btif_max_av_clients; i++) {
-    state = btif_sm_get_state(btif_av_cb[i].sm_handle);
-    if (state == BTIF_AV_STATE_STARTED) {
-      BTIF_TRACE_IMP("Latest playing device index %d", i);
-      break;
-    }
-  }
+  int i = btif_av_peers_first(btif_av_peers.started);
+  if (i < btif_max_av_clients)
+    BTIF_TRACE_IMP("Latest playing device index %d", i);
   return i;
 }
 
@@ -4371,6 +4437,7 @@ static bt_status_t init_src(
   }
   for (int i = 0; i < max_connected_audio_devices; i++) {
     memset(&btif_av_cb[i], 0, sizeof(btif_av_cb[i]));
+    btif_av_peers_clear(i);
     btif_av_cb[i].codec_priorities = codec_priorities;
     btif_av_cb[i].state = BTIF_AV_STATE_IDLE;
     btif_av_cb[i].service = BTA_A2DP_SOURCE_SERVICE_ID;
@@ -5304,6 +5371,7 @@ bt_status_t btif_av_execute_service(bool b_enable) {
         }
         btif_sm_shutdown(btif_av_cb[i].sm_handle);
         btif_av_cb[i].sm_handle = NULL;
+        btif_av_peers_clear(i);
       }
     }
     for (i = 0; i < btif_max_av_clients; i++)
@@ -5359,6 +5427,7 @@ bt_status_t btif_av_sink_execute_service(bool b_enable) {
         BTIF_TRACE_DEBUG("%s(): shutting down AV SM", __func__);
         btif_sm_shutdown(btif_av_cb[i].sm_handle);
         btif_av_cb[i].sm_handle = NULL;
+        btif_av_peers_clear(i);
       }
     }
     BTA_AvDeregister(btif_av_cb[0].bta_handle);
@@ -5513,18 +5582,10 @@ bool btif_av_is_connected_on_other_idx(int current_index) {
 *******************************************************************************/
 int btif_av_get_other_connected_idx(int current_index)
 {
-  btif_sm_state_t state = BTIF_AV_STATE_IDLE;
-  int i;
-  // return true if other IDx is connected
-  for (i = 0; i < btif_max_av_clients; i++) {
-    if (i != current_index) {
-      state = btif_sm_get_state(btif_av_cb[i].sm_handle);
-      if ((state == BTIF_AV_STATE_OPENED) ||
-          (state == BTIF_AV_STATE_STARTED))
-        return i;
-    }
-  }
-  return INVALID_INDEX;
+  int i = btif_av_peers_first(
+      btif_av_peers_other(btif_av_peers.opened | btif_av_peers.started,
+                          current_index));
+  return (i < btif_max_av_clients) ? i : INVALID_INDEX;
 }
 
 /*******************************************************************************
@@ -5538,17 +5599,7 @@ int btif_av_get_other_connected_idx(int current_index)
 *******************************************************************************/
 bool btif_av_is_playing_on_other_idx(int current_index)
 {
-  btif_sm_state_t state = BTIF_AV_STATE_IDLE;
-  int i;
-  // return true if other IDx is playing
-  for (i = 0; i < btif_max_av_clients; i++) {
-    if (i != current_index) {
-      state = btif_sm_get_state(btif_av_cb[i].sm_handle);
-      if (state == BTIF_AV_STATE_STARTED)
-        return true;
-    }
-  }
-  return false;
+  return btif_av_peers_other(btif_av_peers.started, current_index) != 0;
 }
 
 bool btif_av_is_peer_silenced(RawAddress *bd_addr)
@@ -5617,15 +5668,13 @@ bool btif_av_is_remote_started_set(int index)
  ******************************************************************************/
 int btif_av_get_current_playing_dev_idx(void)
 {
-  int i;
+  int i = btif_av_peers_first(btif_av_peers.playing);
 
-  for (i = 0; i < btif_max_av_clients; i++) {
-    if (btif_av_cb[i].current_playing == TRUE) {
-      BTIF_TRACE_DEBUG("current playing on index = %d", i);
-      return i;
-    }
+  if (i < btif_max_av_clients) {
+    BTIF_TRACE_DEBUG("current playing on index = %d", i);
+  } else {
+    BTIF_TRACE_DEBUG("current playing device not set on any idx");
   }
-  BTIF_TRACE_DEBUG("current playing device not set on any idx");
   return i;
 }
 
@@ -6704,10 +6753,11 @@ int64_t btif_get_average_delay() {
 **
 ** Returns          bool
 *******************************************************************************/
+OSI_CACHED_PROPERTY(a2dp_sink_property, "persist.vendor.service.bt.a2dp.sink",
+                    false);
+
 bool btif_device_in_sink_role() {
-    char a2dp_role[6] = "false";
-    osi_property_get("persist.vendor.service.bt.a2dp.sink", a2dp_role, "false");
-    if (strncmp("true", a2dp_role, 4) == 0){
+    if (osi_cached_property_get_bool(&a2dp_sink_property)) {
         BTIF_TRACE_EVENT("%s: SINK role true ",__func__);
         return true;
     }
@@ -6746,12 +6796,12 @@ void btif_initiate_sink_handoff(int idx, bool audio_state_changed) {
                        __func__, idx, cur_playing_idx);
 
   // Mark idx as current playing index
-  btif_av_cb[idx].current_playing = true;
+  btif_av_set_current_playing(idx, true);
   // Mark the other playing devices as not playing
   int i;
   for (i = 0; i < btif_max_av_clients; i++) {
     if (i != idx) {
-      btif_av_cb[i].current_playing = false;
+      btif_av_set_current_playing(i, false);
     }
   }
   other_device_media_packet_count = 0;
@@ -28,7 +28,10 @@
 
 using namespace android;
 
-typedef struct { android::sp<android::AudioTrack> track; } BtifAvrcpAudioTrack;
+typedef struct {
+  android::sp<android::AudioTrack> track;
+  uint32_t frames_written;  // Since the last flush, wraps with the position
+} BtifAvrcpAudioTrack;
 
 #if (DUMP_PCM_DATA == TRUE)
 FILE* outputPcmSampleFile;
@@ -48,6 +51,7 @@ void* BtifAvrcpAudioTrackCreate(int trackFreq, int channelType) {
   BtifAvrcpAudioTrack* trackHolder = new BtifAvrcpAudioTrack;
   CHECK(trackHolder != NULL);
   trackHolder->track = track;
+  trackHolder->frames_written = 0;
 
   if (trackHolder->track->initCheck() != 0) {
     return nullptr;
@@ -72,6 +76,29 @@ int BtifAvrcpAudioTrackLatency(void* handle) {
   return trackHolder->track->latency();
 }
 
+int BtifAvrcpAudioTrackGetBufferedFrames(void* handle) {
+  if (handle == NULL) {
+    LOG_ERROR(LOG_TAG, "%s: handle is null!", __func__);
+    return -1;
+  }
+  BtifAvrcpAudioTrack* trackHolder = static_cast<BtifAvrcpAudioTrack*>(handle);
+  CHECK(trackHolder != NULL);
+  CHECK(trackHolder->track != NULL);
+  uint32_t position;
+  if (trackHolder->track->getPosition(&position) != NO_ERROR ||
+      position == 0) {
+    return -1;
+  }
+  int32_t buffered = (int32_t)(trackHolder->frames_written - position);
+  if (buffered < 0) {
+    // The position was not reset with the written frames, resynchronize
+    trackHolder->frames_written = position;
+    return -1;
+  }
+  LOG_VERBOSE(LOG_TAG, "%s Track.cpp: buffered frames %d", __func__, buffered);
+  return buffered;
+}
+
 void BtifAvrcpAudioTrackStart(void* handle) {
   if (handle == NULL) {
     LOG_ERROR(LOG_TAG, "%s: handle is null!", __func__);
@@ -125,6 +152,7 @@ void BtifAvrcpAudioTrackPause(void* handle) {
     LOG_VERBOSE(LOG_TAG, "%s Track.cpp: btStartTrack", __func__);
     trackHolder->track->pause();
     trackHolder->track->flush();
+    trackHolder->frames_written = 0;
   }
 }
 
@@ -152,6 +180,9 @@ int BtifAvrcpAudioTrackWriteData(void* handle, void* audioBuffer,
   }
 #endif
   retval = trackHolder->track->write(audioBuffer, (size_t)bufferlen);
+  if (retval > 0) {
+    trackHolder->frames_written += retval / trackHolder->track->frameSize();
+  }
   LOG_VERBOSE(LOG_TAG, "%s Track.cpp: btWriteData len = %d ret = %d", __func__,
               bufferlen, retval);
   return retval;
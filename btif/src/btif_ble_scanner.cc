@@ -66,29 +66,102 @@ extern const btgatt_callbacks_t* bt_gatt_callbacks;
 
 namespace {
 
-// all access to this variable should be done on the jni thread
-std::set<RawAddress> remote_bdaddr_cache;
-std::queue<RawAddress> remote_bdaddr_cache_ordered;
-const size_t remote_bdaddr_cache_max_size = 1024;
-
-void btif_address_cache_add(const RawAddress& p_bda, uint8_t addr_type) {
-  // Remove the oldest entries
-  while (remote_bdaddr_cache.size() >= remote_bdaddr_cache_max_size) {
-    const RawAddress& raw_address = remote_bdaddr_cache_ordered.front();
-    remote_bdaddr_cache.erase(raw_address);
-    remote_bdaddr_cache_ordered.pop();
+// Recently scanned devices, in an open addressing table (linear probing) kept
+// at most half full. Once it holds BTIF_BLE_SCAN_ADDR_CACHE_SIZE devices, the
+// clock algorithm evicts one that was not seen since the hand last passed.
+struct AddressCacheEntry {
+  RawAddress address;
+  bool in_use;
+  bool referenced;          // Seen since the clock hand last passed
+  bool properties_updated;  // Remote name already given to btif_dm
+  uint8_t device_type;      // Device type and address written to the storage
+  uint8_t addr_type;
+};
+
+constexpr size_t address_cache_slot_count(size_t slots = 1) {
+  return slots >= 2 * BTIF_BLE_SCAN_ADDR_CACHE_SIZE
+             ? slots
+             : address_cache_slot_count(slots << 1);
+}
+constexpr size_t address_cache_slots = address_cache_slot_count();
+constexpr size_t address_cache_mask = address_cache_slots - 1;
+
+// all access to these variables should be done on the jni thread
+AddressCacheEntry address_cache[address_cache_slots];
+size_t address_cache_count = 0;
+size_t address_cache_hand = 0;
+
+size_t btif_address_cache_home(const RawAddress& p_bda) {
+  size_t hash = 0;
+  for (uint8_t byte : p_bda.address) hash = hash * 31 + byte;
+  return hash & address_cache_mask;
+}
+
+AddressCacheEntry* btif_address_cache_find(const RawAddress& p_bda) {
+  for (size_t i = btif_address_cache_home(p_bda);;
+       i = (i + 1) & address_cache_mask) {
+    AddressCacheEntry* p_entry = &address_cache[i];
+    if (!p_entry->in_use) return nullptr;
+    if (p_entry->address == p_bda) {
+      p_entry->referenced = true;
+      return p_entry;
+    }
+  }
+}
+
+// Empties |slot|, shifting back the entries probed past it
+void btif_address_cache_remove(size_t slot) {
+  size_t hole = slot;
+  address_cache[hole].in_use = false;
+  for (size_t i = (hole + 1) & address_cache_mask; address_cache[i].in_use;
+       i = (i + 1) & address_cache_mask) {
+    size_t home = btif_address_cache_home(address_cache[i].address);
+    size_t distance = (i - home) & address_cache_mask;
+    if (distance >= ((i - hole) & address_cache_mask)) {
+      address_cache[hole] = address_cache[i];
+      address_cache[i].in_use = false;
+      hole = i;
+    }
   }
-  remote_bdaddr_cache.insert(p_bda);
-  remote_bdaddr_cache_ordered.push(p_bda);
+  address_cache_count--;
 }
 
-bool btif_address_cache_find(const RawAddress& p_bda) {
-  return (remote_bdaddr_cache.find(p_bda) != remote_bdaddr_cache.end());
+void btif_address_cache_evict(void) {
+  for (;;) {
+    AddressCacheEntry* p_entry = &address_cache[address_cache_hand];
+    if (p_entry->in_use) {
+      if (!p_entry->referenced) {
+        btif_address_cache_remove(address_cache_hand);
+        return;
+      }
+      p_entry->referenced = false;
+    }
+    address_cache_hand = (address_cache_hand + 1) & address_cache_mask;
+  }
+}
+
+AddressCacheEntry* btif_address_cache_add(const RawAddress& p_bda) {
+  if (address_cache_count >= BTIF_BLE_SCAN_ADDR_CACHE_SIZE)
+    btif_address_cache_evict();
+
+  size_t i = btif_address_cache_home(p_bda);
+  while (address_cache[i].in_use) i = (i + 1) & address_cache_mask;
+
+  AddressCacheEntry* p_entry = &address_cache[i];
+  p_entry->address = p_bda;
+  p_entry->in_use = true;
+  p_entry->referenced = true;
+  p_entry->properties_updated = false;
+  p_entry->device_type = 0;
+  p_entry->addr_type = 0;
+  address_cache_count++;
+  return p_entry;
 }
 
 void btif_address_cache_init(void) {
-  remote_bdaddr_cache.clear();
-  remote_bdaddr_cache_ordered = {};
+  for (AddressCacheEntry& entry : address_cache) entry.in_use = false;
+  address_cache_count = 0;
+  address_cache_hand = 0;
 }
 
 void bta_batch_scan_threshold_cb(tBTM_BLE_REF_VALUE ref_value) {
@@ -99,7 +172,7 @@ void bta_batch_scan_reports_cb(int client_id, tBTA_STATUS status,
                                uint8_t report_format, uint8_t num_records,
                                std::vector<uint8_t> data) {
   SCAN_CBACK_IN_JNI(batchscan_reports_cb, client_id, status, report_format,
-                    num_records, std::move(data));
+                    num_records, base::Passed(&data));
 }
 
 void bta_scan_results_cb_impl(RawAddress bd_addr, tBT_DEVICE_TYPE device_type,
@@ -113,17 +186,22 @@ void bta_scan_results_cb_impl(RawAddress bd_addr, tBT_DEVICE_TYPE device_type,
   bt_device_type_t dev_type;
   bt_property_t properties;
 
-  const uint8_t* p_eir_remote_name = AdvertiseDataParser::GetFieldByType(
-      value, BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &remote_name_len);
+  AdvertiseDataParser::FieldIndex ad_fields(value);
+  const uint8_t* p_eir_remote_name = ad_fields.GetFieldByType(
+      BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &remote_name_len);
 
   if (p_eir_remote_name == NULL) {
-    p_eir_remote_name = AdvertiseDataParser::GetFieldByType(
-        value, BT_EIR_SHORTENED_LOCAL_NAME_TYPE, &remote_name_len);
+    p_eir_remote_name = ad_fields.GetFieldByType(
+        BT_EIR_SHORTENED_LOCAL_NAME_TYPE, &remote_name_len);
   }
 
+  AddressCacheEntry* p_entry = btif_address_cache_find(bd_addr);
+  bool new_device = (p_entry == nullptr);
+  if (new_device) p_entry = btif_address_cache_add(bd_addr);
+
   if ((addr_type != BLE_ADDR_RANDOM) || (p_eir_remote_name)) {
-    if (!btif_address_cache_find(bd_addr)) {
-      btif_address_cache_add(bd_addr, addr_type);
+    if (!p_entry->properties_updated) {
+      p_entry->properties_updated = true;
 
       if (p_eir_remote_name) {
         if (remote_name_len > BD_NAME_LEN + 1 ||
@@ -147,12 +225,19 @@ void bta_scan_results_cb_impl(RawAddress bd_addr, tBT_DEVICE_TYPE device_type,
     }
   }
 
-  dev_type = (bt_device_type_t)device_type;
-  BTIF_STORAGE_FILL_PROPERTY(&properties, BT_PROPERTY_TYPE_OF_DEVICE,
-                             sizeof(dev_type), &dev_type);
-  btif_storage_set_remote_device_property(&(bd_addr), &properties);
+  // Devices seen recently have their type in the storage already
+  if (new_device || p_entry->device_type != device_type ||
+      p_entry->addr_type != addr_type) {
+    p_entry->device_type = device_type;
+    p_entry->addr_type = addr_type;
 
-  btif_storage_set_remote_addr_type(&bd_addr, addr_type);
+    dev_type = (bt_device_type_t)device_type;
+    BTIF_STORAGE_FILL_PROPERTY(&properties, BT_PROPERTY_TYPE_OF_DEVICE,
+                               sizeof(dev_type), &dev_type);
+    btif_storage_set_remote_device_property(&(bd_addr), &properties);
+
+    btif_storage_set_remote_addr_type(&bd_addr, addr_type);
+  }
   HAL_CBACK(bt_gatt_callbacks, scanner->scan_result_cb, ble_evt_type, addr_type,
             &bd_addr, ble_primary_phy, ble_secondary_phy, ble_advertising_sid,
             ble_tx_power, rssi, ble_periodic_adv_int, std::move(value));
@@ -15,10 +15,15 @@
  */
 
 #include <stdio.h>
+
+#include <algorithm>
+#include <mutex>
+
 #include "btif_bqr.h"
 #include "btif_dm.h"
 #include "osi/include/leaky_bonded_queue.h"
 #include "osi/include/properties.h"
+#include "osi/include/time.h"
 #include "stack/btm/btm_int.h"
 #include "raw_address.h"
 
@@ -35,6 +40,18 @@ using std::chrono::system_clock;
 static std::unique_ptr<LeakyBondedQueue<BqrVseSubEvt>> kpBqrEventQueue(
     new LeakyBondedQueue<BqrVseSubEvt>(kBqrEventQueueSize));
 
+struct LinkQualitySubscriber {
+  BqrLinkQualityCallback callback;
+  void* context;
+};
+
+// The in-stack subscribers and the aggregates of the connections, guarded by
+// kLinkQualityMutex. An aggregate with no report is free.
+static std::mutex kLinkQualityMutex;
+static LinkQualitySubscriber kLinkQualitySubscribers[kMaxLinkQualityCallbacks];
+static BqrLinkQualityAggregate
+    kLinkQualityAggregates[kMaxLinkQualityAggregates];
+
 bool BqrVseSubEvt::IsEvtToBeParsed(uint8_t quality_report_id) {
   switch (quality_report_id) {
     case QUALITY_REPORT_ID_MONITOR_MODE:
@@ -198,9 +215,161 @@ std::string PacketTypeToString(uint8_t packet_type) {
   }
 }
 
+// Returns true for the reports about an existing connection.
+static bool IsConnectionReport(uint8_t quality_report_id) {
+  switch (quality_report_id) {
+    case QUALITY_REPORT_ID_MONITOR_MODE:
+    case QUALITY_REPORT_ID_APPROACH_LSTO:
+    case QUALITY_REPORT_ID_A2DP_AUDIO_CHOPPY:
+    case QUALITY_REPORT_ID_SCO_VOICE_CHOPPY:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static int64_t MoveAverage(int64_t average, int64_t sample) {
+  return average + (sample - average) / 8;
+}
+
+// Returns the aggregates of |connection_handle|, nullptr if it had no report
+// since |kLinkQualityAggregateExpiryMs|. With |create|, the aggregates are
+// started over, taking the least recently reported slot if needed.
+// kLinkQualityMutex must be held.
+static BqrLinkQualityAggregate* FindLinkQualityAggregate(
+    uint16_t connection_handle, uint64_t now_ms, bool create) {
+  BqrLinkQualityAggregate* p_oldest = &kLinkQualityAggregates[0];
+  for (auto& aggregate : kLinkQualityAggregates) {
+    if (aggregate.report_count != 0 &&
+        aggregate.connection_handle == connection_handle) {
+      if (now_ms - aggregate.last_report_ms <= kLinkQualityAggregateExpiryMs)
+        return &aggregate;
+      p_oldest = &aggregate;
+      break;
+    }
+    if (aggregate.last_report_ms < p_oldest->last_report_ms)
+      p_oldest = &aggregate;
+  }
+  if (!create) return nullptr;
+
+  *p_oldest = {};
+  p_oldest->connection_handle = connection_handle;
+  p_oldest->first_report_ms = now_ms;
+  return p_oldest;
+}
+
+static void UpdateLinkQualityAggregate(BqrLinkQualityAggregate* p_aggregate,
+                                       const BqrLinkQuality& report) {
+  if (p_aggregate->report_count == 0) {
+    p_aggregate->rssi_average = report.rssi;
+    p_aggregate->snr_average = report.snr;
+    p_aggregate->unused_afh_channel_average = report.unused_afh_channel_count;
+    p_aggregate->retransmission_average = report.retransmission_count;
+    p_aggregate->nak_average = report.nak_count;
+  } else {
+    p_aggregate->rssi_average =
+        MoveAverage(p_aggregate->rssi_average, report.rssi);
+    p_aggregate->snr_average =
+        MoveAverage(p_aggregate->snr_average, report.snr);
+    p_aggregate->unused_afh_channel_average =
+        MoveAverage(p_aggregate->unused_afh_channel_average,
+                    report.unused_afh_channel_count);
+    p_aggregate->retransmission_average = MoveAverage(
+        p_aggregate->retransmission_average, report.retransmission_count);
+    p_aggregate->nak_average =
+        MoveAverage(p_aggregate->nak_average, report.nak_count);
+  }
+  p_aggregate->report_count++;
+  if (report.warning) p_aggregate->warning_count++;
+  if (report.quality_report_id == QUALITY_REPORT_ID_A2DP_AUDIO_CHOPPY)
+    p_aggregate->a2dp_choppy_count++;
+  if (report.quality_report_id == QUALITY_REPORT_ID_SCO_VOICE_CHOPPY)
+    p_aggregate->sco_choppy_count++;
+  p_aggregate->last_report_ms = report.timestamp_ms;
+}
+
+// Delivers |bqr_event| to the in-stack subscribers, without formatting it.
+static void NotifyLinkQuality(const BqrVseSubEvt& bqr_event) {
+  BqrLinkQuality report;
+  report.quality_report_id = bqr_event.quality_report_id_;
+  report.packet_types = bqr_event.packet_types_;
+  report.connection_handle = bqr_event.connection_handle_;
+  report.rssi = bqr_event.rssi_;
+  report.snr = bqr_event.snr_;
+  report.unused_afh_channel_count = bqr_event.unused_afh_channel_count_;
+  report.afh_select_unideal_channel_count =
+      bqr_event.afh_select_unideal_channel_count_;
+  report.retransmission_count = bqr_event.retransmission_count_;
+  report.no_rx_count = bqr_event.no_rx_count_;
+  report.nak_count = bqr_event.nak_count_;
+  report.flow_off_count = bqr_event.flow_off_count_;
+  report.buffer_overflow_bytes = bqr_event.buffer_overflow_bytes_;
+  report.buffer_underflow_bytes = bqr_event.buffer_underflow_bytes_;
+  report.timestamp_ms = time_get_os_boottime_ms();
+  report.warning = (bqr_event.rssi_ < kCriWarnRssi ||
+                    bqr_event.unused_afh_channel_count_ > kCriWarnUnusedCh);
+
+  BqrLinkQualityAggregate aggregate = {};
+  LinkQualitySubscriber subscribers[kMaxLinkQualityCallbacks];
+  {
+    std::lock_guard<std::mutex> lock(kLinkQualityMutex);
+    if (IsConnectionReport(report.quality_report_id)) {
+      BqrLinkQualityAggregate* p_aggregate = FindLinkQualityAggregate(
+          report.connection_handle, report.timestamp_ms, true);
+      UpdateLinkQualityAggregate(p_aggregate, report);
+      aggregate = *p_aggregate;
+    }
+    std::copy(std::begin(kLinkQualitySubscribers),
+              std::end(kLinkQualitySubscribers), subscribers);
+  }
+
+  for (const auto& subscriber : subscribers) {
+    if (subscriber.callback != nullptr)
+      subscriber.callback(report, aggregate, subscriber.context);
+  }
+}
+
+bool RegisterLinkQualityCallback(BqrLinkQualityCallback callback,
+                                 void* context) {
+  std::lock_guard<std::mutex> lock(kLinkQualityMutex);
+  LinkQualitySubscriber* p_free = nullptr;
+  for (auto& subscriber : kLinkQualitySubscribers) {
+    if (subscriber.callback == callback && subscriber.context == context)
+      return true;
+    if (subscriber.callback == nullptr && p_free == nullptr)
+      p_free = &subscriber;
+  }
+  if (p_free == nullptr) {
+    LOG(ERROR) << __func__ << ": no room for another subscriber";
+    return false;
+  }
+  p_free->callback = callback;
+  p_free->context = context;
+  return true;
+}
+
+void UnregisterLinkQualityCallback(BqrLinkQualityCallback callback,
+                                   void* context) {
+  std::lock_guard<std::mutex> lock(kLinkQualityMutex);
+  for (auto& subscriber : kLinkQualitySubscribers) {
+    if (subscriber.callback == callback && subscriber.context == context)
+      subscriber = {};
+  }
+}
+
+bool GetLinkQualityAggregate(uint16_t connection_handle,
+                             BqrLinkQualityAggregate* p_aggregate) {
+  std::lock_guard<std::mutex> lock(kLinkQualityMutex);
+  const BqrLinkQualityAggregate* p_found = FindLinkQualityAggregate(
+      connection_handle, time_get_os_boottime_ms(), false);
+  if (p_found == nullptr) return false;
+  *p_aggregate = *p_found;
+  return true;
+}
+
 void AddBqrEventToQueue(uint8_t length, uint8_t* p_stream) {
-  std::unique_ptr<BqrVseSubEvt> p_bqr_event = std::make_unique<BqrVseSubEvt>();
-  if (!p_bqr_event->ParseBqrEvt(length, p_stream)) {
+  BqrVseSubEvt bqr_event;
+  if (!bqr_event.ParseBqrEvt(length, p_stream)) {
     LOG(WARNING) << __func__ << ": Fail to parse BQR sub event.";
     return;
   }
@@ -211,7 +380,7 @@ void AddBqrEventToQueue(uint8_t length, uint8_t* p_stream) {
     * parameters | 0x** for first parameter id | 0x** for length of first parameter |
     * 0x** for first parameter value | ..so on..]
     */
-  if (p_bqr_event->quality_report_id_ == QUALITY_REPORT_ID_ROOT_INFLAMMATION) {
+  if (bqr_event.quality_report_id_ == QUALITY_REPORT_ID_ROOT_INFLAMMATION) {
     uint8_t error_code, vendor_error_code;
     STREAM_SKIP_UINT8(p_stream);
     STREAM_TO_UINT8(error_code, p_stream);
@@ -236,7 +405,8 @@ void AddBqrEventToQueue(uint8_t length, uint8_t* p_stream) {
                << loghex(vendor_error_code) << vs_params;
     return;
   }
-  LOG(WARNING) << *p_bqr_event;
+  LOG(WARNING) << bqr_event;
+  NotifyLinkQuality(bqr_event);
 
   if (length >= kBqrParamTotalLen + BD_ADDR_LEN) {
     RawAddress bd_addr;
@@ -247,7 +417,7 @@ void AddBqrEventToQueue(uint8_t length, uint8_t* p_stream) {
     LOG(WARNING) << __func__ << ": BQR event doesn't contain remote address";
   }
 
-  kpBqrEventQueue->Enqueue(p_bqr_event.release());
+  kpBqrEventQueue->Enqueue(new BqrVseSubEvt(bqr_event));
 }
 
 void ConfigBqrA2dpScoThreshold() {
@@ -406,7 +576,31 @@ void ConfigureBqr(const BqrConfiguration& bqr_config) {
                             param, BqrVscCompleteCallback);
 }
 
+// Dumps the aggregates of the connections with a recent report.
+static void DebugDumpLinkQualityAggregates(int fd) {
+  std::lock_guard<std::mutex> lock(kLinkQualityMutex);
+  uint64_t now_ms = time_get_os_boottime_ms();
+
+  dprintf(fd, "\nBT Quality Report Link Aggregates: \n");
+  for (const auto& aggregate : kLinkQualityAggregates) {
+    if (aggregate.report_count == 0 ||
+        now_ms - aggregate.last_report_ms > kLinkQualityAggregateExpiryMs)
+      continue;
+    dprintf(fd,
+            "  Handle: 0x%04x, reports: %u (warnings %u, A2DP choppy %u, SCO "
+            "choppy %u), RSSI: %d, SNR: %u, UnusedCh: %u, ReTx: %u, NAK: %u, "
+            "last: %llu ms ago\n",
+            aggregate.connection_handle, aggregate.report_count,
+            aggregate.warning_count, aggregate.a2dp_choppy_count,
+            aggregate.sco_choppy_count, aggregate.rssi_average,
+            aggregate.snr_average, aggregate.unused_afh_channel_average,
+            aggregate.retransmission_average, aggregate.nak_average,
+            (unsigned long long)(now_ms - aggregate.last_report_ms));
+  }
+}
+
 void DebugDump(int fd) {
+  DebugDumpLinkQualityAggregates(fd);
   dprintf(fd, "\nBT Quality Report Events: \n");
 
   if (kpBqrEventQueue->Empty()) {
@@ -20,6 +20,7 @@
 
 #include "btif_config.h"
 
+#include <base/bind.h>
 #include <base/logging.h>
 #include <ctype.h>
 #include <openssl/rand.h>
@@ -27,11 +28,15 @@
 #include <private/android_filesystem_config.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <btif_keystore.h>
 #include "bt_types.h"
@@ -41,6 +46,7 @@
 #include "btif_config_transcode.h"
 #include "btif_util.h"
 #include "common/address_obfuscator.h"
+#include "common/thread_pool.h"
 #include "osi/include/alarm.h"
 #include "osi/include/allocator.h"
 #include "osi/include/compat.h"
@@ -81,6 +87,8 @@ static void timer_config_save_cb(void* data);
 static void btif_config_write(uint16_t event, char* p_param);
 static bool is_factory_reset(void);
 static void delete_config_files(void);
+static bool btif_config_is_paired_or_other(const config_t* config,
+                                           const char* section);
 static void btif_config_remove_unpaired(config_t* config);
 static void btif_config_remove_restricted(config_t* config);
 
@@ -189,8 +197,112 @@ static void read_or_set_metrics_salt() {
 }
 
 static std::recursive_mutex config_lock;  // protects operations on |config|.
+static std::mutex config_write_lock;  // orders the writes of the config file.
 static alarm_t* config_timer;
 
+// An immutable copy of |config| that readers use without taking
+// |config_lock|. It is valid as long as |config| is not modified after the
+// copy, that is while its |generation| matches |config_generation|; readers
+// fall back to |config| otherwise, so that they always see their own writes.
+struct btif_config_snapshot_t {
+  btif_config_snapshot_t(config_t* config, uint64_t generation)
+      : config(config), generation(generation) {}
+  ~btif_config_snapshot_t() { config_free(config); }
+
+  config_t* const config;
+  const uint64_t generation;
+};
+
+static std::shared_ptr<const btif_config_snapshot_t> config_snapshot;
+// Incremented under |config_lock| after every modification of |config|.
+static std::atomic<uint64_t> config_generation;
+
+// Must be called with |config_lock| held, after |config| was modified.
+static void btif_config_modified(void) { config_generation++; }
+
+// Must be called with |config_lock| held. Publishes a new snapshot of |config|
+// unless the current one is still valid.
+static void btif_config_publish_snapshot(void) {
+  uint64_t generation = config_generation;
+  std::shared_ptr<const btif_config_snapshot_t> snapshot =
+      std::atomic_load(&config_snapshot);
+  if (snapshot && snapshot->generation == generation) return;
+
+  config_t* copy = config_new_clone(config);
+  if (!copy) return;
+  std::atomic_store(&config_snapshot,
+                    std::shared_ptr<const btif_config_snapshot_t>(
+                        new btif_config_snapshot_t(copy, generation)));
+}
+
+// Returns the snapshot if it is still valid, NULL otherwise.
+static std::shared_ptr<const btif_config_snapshot_t> btif_config_get_snapshot(
+    void) {
+  std::shared_ptr<const btif_config_snapshot_t> snapshot =
+      std::atomic_load(&config_snapshot);
+  if (!snapshot || snapshot->generation != config_generation) return nullptr;
+  return snapshot;
+}
+
+// Runs |read| on the snapshot if it is valid, or on |config| under
+// |config_lock| otherwise.
+template <typename F>
+static auto btif_config_read(F read) -> decltype(read(config)) {
+  std::shared_ptr<const btif_config_snapshot_t> snapshot =
+      btif_config_get_snapshot();
+  if (snapshot) return read(snapshot->config);
+
+  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  return read(config);
+}
+
+// Warm restart: clean_up() keeps the parsed config for the next init() of the
+// process, which uses it again instead of parsing the file if the file was
+// not changed in between. Set the property to false to always parse it.
+#define WARM_RESTART_PROPERTY "persist.bluetooth.config_warm_restart"
+
+static config_t* warm_config;
+static struct stat warm_config_stat;
+
+static bool is_same_file(const struct stat& a, const struct stat& b) {
+  return a.st_dev == b.st_dev && a.st_ino == b.st_ino &&
+         a.st_size == b.st_size && a.st_mtim.tv_sec == b.st_mtim.tv_sec &&
+         a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+}
+
+// Must be called with |config_lock| held, once |config| was written. Keeps
+// |config| for the next init() if the file holds all of it, returns false if
+// it was not kept.
+static bool btif_config_keep_warm(config_t* config) {
+  char value[PROPERTY_VALUE_MAX];
+  osi_property_get(WARM_RESTART_PROPERTY, value, "true");
+  if (strcmp(value, "true") != 0) return false;
+  if (config_is_dirty(config)) return false;
+  if (stat(CONFIG_FILE_PATH, &warm_config_stat) != 0) return false;
+
+  config_free(warm_config);
+  warm_config = config;
+  return true;
+}
+
+// Must be called with |config_lock| held. Returns the config kept by
+// clean_up() if the file is still the one it was written to, NULL otherwise.
+static config_t* btif_config_take_warm(void) {
+  config_t* config = warm_config;
+  warm_config = NULL;
+  if (config == NULL) return NULL;
+
+  struct stat file_stat;
+  if (stat(CONFIG_FILE_PATH, &file_stat) != 0 ||
+      !is_same_file(file_stat, warm_config_stat)) {
+    LOG_INFO(LOG_TAG, "%s: %s changed, parsing it again", __func__,
+             CONFIG_FILE_PATH);
+    config_free(config);
+    return NULL;
+  }
+  return config;
+}
+
 // Module lifecycle functions
 
 static future_t* init(void) {
@@ -200,7 +312,12 @@ static future_t* init(void) {
 
   std::string file_source;
 
-  if (config_checksum_pass(CONFIG_FILE_COMPARE_PASS)) {
+  config = btif_config_take_warm();
+  if (config) {
+    LOG_INFO(LOG_TAG, "%s: reusing the config parsed before the restart",
+             __func__);
+    btif_config_source = ORIGINAL;
+  } else if (config_checksum_pass(CONFIG_FILE_COMPARE_PASS)) {
     config = btif_config_open(CONFIG_FILE_PATH);
     btif_config_source = ORIGINAL;
   }
@@ -274,6 +391,9 @@ static future_t* init(void) {
 
   LOG_EVENT_INT(BT_CONFIG_SOURCE_TAG_NUM, btif_config_source);
 
+  btif_config_modified();
+  btif_config_publish_snapshot();
+
   return future_new_immediate(FUTURE_SUCCESS);
 
 error:
@@ -311,7 +431,9 @@ static future_t* clean_up(void) {
   config_timer = NULL;
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
-  config_free(config);
+  std::atomic_store(&config_snapshot,
+                    std::shared_ptr<const btif_config_snapshot_t>());
+  if (!btif_config_keep_warm(config)) config_free(config);
   config = NULL;
   get_bluetooth_keystore_interface()->clear_map();
   return future_new_immediate(FUTURE_SUCCESS);
@@ -327,8 +449,8 @@ bool btif_config_has_section(const char* section) {
   CHECK(config != NULL);
   CHECK(section != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
-  return config_has_section(config, section);
+  return btif_config_read(
+      [&](const config_t* conf) { return config_has_section(conf, section); });
 }
 
 bool btif_config_exist(const char* section, const char* key) {
@@ -336,8 +458,9 @@ bool btif_config_exist(const char* section, const char* key) {
   CHECK(section != NULL);
   CHECK(key != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
-  return config_has_key(config, section, key);
+  return btif_config_read([&](const config_t* conf) {
+    return config_has_key(conf, section, key);
+  });
 }
 
 bool btif_config_get_int(const char* section, const char* key, int* value) {
@@ -346,11 +469,11 @@ bool btif_config_get_int(const char* section, const char* key, int* value) {
   CHECK(key != NULL);
   CHECK(value != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
-  bool ret = config_has_key(config, section, key);
-  if (ret) *value = config_get_int(config, section, key, *value);
-
-  return ret;
+  return btif_config_read([&](const config_t* conf) {
+    bool ret = config_has_key(conf, section, key);
+    if (ret) *value = config_get_int(conf, section, key, *value);
+    return ret;
+  });
 }
 
 bool btif_config_get_uint16(const char* section, const char* key, uint16_t* value) {
@@ -359,11 +482,11 @@ bool btif_config_get_uint16(const char* section, const char* key, uint16_t* valu
   CHECK(key != NULL);
   CHECK(value != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
-  bool ret = config_has_key(config, section, key);
-  if (ret) *value = config_get_uint16(config, section, key, *value);
-
-  return ret;
+  return btif_config_read([&](const config_t* conf) {
+    bool ret = config_has_key(conf, section, key);
+    if (ret) *value = config_get_uint16(conf, section, key, *value);
+    return ret;
+  });
 }
 
 bool btif_config_get_uint64(const char* section, const char* key,
@@ -373,11 +496,11 @@ bool btif_config_get_uint64(const char* section, const char* key,
   CHECK(section != NULL);
   CHECK(key != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
-  bool ret = config_has_key(config, section, key);
-  if (ret) *value = config_get_uint64(config, section, key, *value);
-
-  return ret;
+  return btif_config_read([&](const config_t* conf) {
+    bool ret = config_has_key(conf, section, key);
+    if (ret) *value = config_get_uint64(conf, section, key, *value);
+    return ret;
+  });
 }
 
 
@@ -388,6 +511,7 @@ bool btif_config_set_int(const char* section, const char* key, int value) {
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
   config_set_int(config, section, key, value);
+  btif_config_modified();
 
   return true;
 }
@@ -399,6 +523,7 @@ bool btif_config_set_uint16(const char* section, const char* key, uint16_t value
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
   config_set_uint16(config, section, key, value);
+  btif_config_modified();
 
   return true;
 }
@@ -411,6 +536,7 @@ bool btif_config_set_uint64(const char* section, const char* key,
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
   config_set_uint64(config, section, key, value);
+  btif_config_modified();
 
   return true;
 }
@@ -424,12 +550,13 @@ bool btif_config_get_str(const char* section, const char* key, char* value,
   CHECK(value != NULL);
   CHECK(size_bytes != NULL);
 
-  {
-    std::unique_lock<std::recursive_mutex> lock(config_lock);
-    const char* stored_value = config_get_string(config, section, key, NULL);
+  bool found = btif_config_read([&](const config_t* conf) {
+    const char* stored_value = config_get_string(conf, section, key, NULL);
     if (!stored_value) return false;
     strlcpy(value, stored_value, *size_bytes);
-  }
+    return true;
+  });
+  if (!found) return false;
 
   *size_bytes = strlen(value) + 1;
   return true;
@@ -444,6 +571,7 @@ bool btif_config_set_str(const char* section, const char* key,
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
   config_set_string(config, section, key, value);
+  btif_config_modified();
   return true;
 }
 
@@ -453,6 +581,60 @@ static bool btif_in_encrypt_key_name_list(std::string key) {
                    key) != (encrypt_key_name_list + ENCRYPT_KEY_NAME_LIST_SIZE);
 }
 
+// Returns the value of the hex digit |c|, or -1 if it is not one.
+static int btif_config_hex_digit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Decodes the hex string |value_str| into |value|, of |*length| bytes.
+static bool btif_config_decode_bin(const std::string* value_str, uint8_t* value,
+                                   size_t* length) {
+  const char* cvalue_str = value_str->c_str();
+  size_t value_len = strlen(cvalue_str);
+  if ((value_len % 2) != 0 || *length < (value_len / 2)) return false;
+
+  for (size_t i = 0; i < value_len; i += 2) {
+    int high = btif_config_hex_digit(cvalue_str[i]);
+    int low = btif_config_hex_digit(cvalue_str[i + 1]);
+    if (high < 0 || low < 0) return false;
+    value[i / 2] = (high << 4) | low;
+  }
+  *length = value_len / 2;
+
+  return true;
+}
+
+void btif_config_load_encrypted_keys(void) {
+  if (!btif_is_niap_mode()) return;
+
+  std::vector<std::string> prefixes =
+      btif_config_read([](const config_t* conf) {
+        std::vector<std::string> prefixes;
+        for (const config_section_node_t* node = config_section_begin(conf);
+             node != config_section_end(conf);
+             node = config_section_next(node)) {
+          const char* section = config_section_name(node);
+          for (const std::string& key : encrypt_key_name_list) {
+            const char* value =
+                config_get_string(conf, section, key.c_str(), NULL);
+            if (value && value == ENCRYPTED_STR)
+              prefixes.push_back(section + std::string("-") + key);
+          }
+        }
+        return prefixes;
+      });
+
+  // Fills the keystore cache, so that reading the keys later does not wait
+  // on the keystore.
+  for (const std::string& prefix : prefixes)
+    get_bluetooth_keystore_interface()->get_key(prefix);
+  LOG_INFO(LOG_TAG, "%s: loaded %zu encrypted keys", __func__,
+           prefixes.size());
+}
+
 bool btif_config_get_bin(const char* section, const char* key, uint8_t* value,
                          size_t* length) {
   CHECK(config != NULL);
@@ -461,6 +643,32 @@ bool btif_config_get_bin(const char* section, const char* key, uint8_t* value,
   CHECK(value != NULL);
   CHECK(length != NULL);
 
+  bool in_encrypt_key_name_list = btif_in_encrypt_key_name_list(key);
+
+  std::shared_ptr<const btif_config_snapshot_t> snapshot =
+      btif_config_get_snapshot();
+  if (snapshot) {
+    const char* stored_value =
+        config_get_string(snapshot->config, section, key, NULL);
+    if (!stored_value) {
+      VLOG(2) << __func__ << ": cannot find string for section " << section
+              << ", key " << key;
+      return false;
+    }
+
+    // Keys that have to be moved in or out of the keystore are rewritten in
+    // |config| below, under the lock.
+    bool is_key_encrypted = stored_value == ENCRYPTED_STR;
+    if (!in_encrypt_key_name_list || is_key_encrypted == btif_is_niap_mode()) {
+      std::string value_str =
+          (in_encrypt_key_name_list && is_key_encrypted)
+              ? get_bluetooth_keystore_interface()->get_key(
+                    section + std::string("-") + key)
+              : std::string(stored_value);
+      return btif_config_decode_bin(&value_str, value, length);
+    }
+  }
+
   std::unique_lock<std::recursive_mutex> lock(config_lock);
 
   const std::string* value_str;
@@ -472,7 +680,6 @@ bool btif_config_get_bin(const char* section, const char* key, uint8_t* value,
     return false;
   }
 
-  bool in_encrypt_key_name_list = btif_in_encrypt_key_name_list(key);
   bool is_key_encrypted = &value_str_from_config[0] == ENCRYPTED_STR;
   std::string string;
   std::string svalue_str_from_config1 = value_str_from_config;
@@ -487,26 +694,19 @@ bool btif_config_get_bin(const char* section, const char* key, uint8_t* value,
 
   if (!value_str) return false;
 
-  const char* cvalue_str = value_str->c_str();
-  size_t value_len = strlen(cvalue_str);
-  if ((value_len % 2) != 0 || *length < (value_len / 2)) return false;
-
-  for (size_t i = 0; i < value_len; ++i)
-    if (!isxdigit(value_str->c_str()[i])) return false;
-
-  for (*length = 0; *cvalue_str; cvalue_str += 2, *length += 1) {
-    sscanf(cvalue_str, "%02hhx", &value[*length]);
-  }
+  if (!btif_config_decode_bin(value_str, value, length)) return false;
 
   if (btif_is_niap_mode()) {
     if (in_encrypt_key_name_list && !is_key_encrypted) {
       get_bluetooth_keystore_interface()->set_encrypt_key_or_remove_key(
           section + std::string("-") + key, &value_str_from_config[0]);
       config_set_string(config, section, key, ENCRYPTED_STR.c_str());
+      btif_config_modified();
     }
   } else {
     if (in_encrypt_key_name_list && is_key_encrypted) {
       config_set_string(config, section, key, value_str->c_str());
+      btif_config_modified();
     }
   }
 
@@ -518,12 +718,13 @@ size_t btif_config_get_bin_length(const char* section, const char* key) {
   CHECK(section != NULL);
   CHECK(key != NULL);
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
-  const char* value_str = config_get_string(config, section, key, NULL);
-  if (!value_str) return 0;
+  return btif_config_read([&](const config_t* conf) -> size_t {
+    const char* value_str = config_get_string(conf, section, key, NULL);
+    if (!value_str) return 0;
 
-  size_t value_len = strlen(value_str);
-  return ((value_len % 2) != 0) ? 0 : (value_len / 2);
+    size_t value_len = strlen(value_str);
+    return ((value_len % 2) != 0) ? 0 : (value_len / 2);
+  });
 }
 
 bool btif_config_set_bin(const char* section, const char* key,
@@ -556,6 +757,7 @@ bool btif_config_set_bin(const char* section, const char* key,
   {
     std::unique_lock<std::recursive_mutex> lock(config_lock);
     config_set_string(config, section, key, value_str.c_str());
+    btif_config_modified();
   }
 
   osi_free(str);
@@ -597,7 +799,9 @@ bool btif_config_remove(const char* section, const char* key) {
         section + std::string("-") + key, "");
   }
   std::unique_lock<std::recursive_mutex> lock(config_lock);
-  return config_remove_key(config, section, key);
+  bool ret = config_remove_key(config, section, key);
+  if (ret) btif_config_modified();
+  return ret;
 }
 
 void btif_config_save(void) {
@@ -621,45 +825,86 @@ bool btif_config_clear(void) {
 
   alarm_cancel(config_timer);
 
+  std::unique_lock<std::mutex> write_lock(config_write_lock);
   std::unique_lock<std::recursive_mutex> lock(config_lock);
   config_free(config);
 
   config = config_new_empty();
+  btif_config_modified();
   if (config == NULL) return false;
 
   bool ret = config_save(config, CONFIG_FILE_PATH);
+  if (ret) config_clear_dirty(config);
   btif_config_source = RESET;
 
   return ret;
 }
 
 static void timer_config_save_cb(UNUSED_ATTR void* data) {
-  // Moving file I/O to btif context instead of timer callback because
-  // it usually takes a lot of time to be completed, introducing
-  // delays during A2DP playback causing blips or choppiness.
-  btif_transfer_context(btif_config_write, 0, NULL, 0, NULL);
+  // Moving the serialization and file I/O off the timer callback because
+  // they usually take a lot of time to be completed, introducing
+  // delays during A2DP playback causing blips or choppiness. They run in
+  // the thread pool, or in btif context if the pool is not running.
+  if (!bluetooth::common::PostToPool(
+          FROM_HERE, base::BindOnce(&btif_config_write, 0,
+                                    static_cast<char*>(nullptr))))
+    btif_transfer_context(btif_config_write, 0, NULL, 0, NULL);
 }
 
 static void btif_config_write(UNUSED_ATTR uint16_t event,
                               UNUSED_ATTR char* p_param) {
-  CHECK(config != NULL);
-  CHECK(config_timer != NULL);
+  // Holding |config_write_lock| across both steps keeps the writes in order.
+  std::unique_lock<std::mutex> write_lock(config_write_lock);
+  std::string contents;
+  uint64_t generation;
+  {
+    std::unique_lock<std::recursive_mutex> lock(config_lock);
+    // A write posted to the thread pool may run after clean_up()
+    if (config == NULL) return;
 
-  std::unique_lock<std::recursive_mutex> lock(config_lock);
-  rename(CONFIG_FILE_PATH, CONFIG_BACKUP_PATH);
-  config_t* config_paired = config_new_clone(config);
+    // Readers switch to the new snapshot while the file is being written.
+    btif_config_publish_snapshot();
+
+    // Nothing changed since the last write, the file and its hash are current.
+    if (!config_is_dirty(config)) return;
 
-  if (config_paired != NULL) {
-    btif_config_remove_unpaired(config_paired);
-    config_save(config_paired, CONFIG_FILE_PATH);
-    config_free(config_paired);
+    // Unpaired devices are left out, only the modified sections are
+    // serialized again.
+    contents = config_serialize(config, btif_config_is_paired_or_other);
+    generation = config_generation;
+  }
+
+  // The file is written without holding |config_lock|.
+  rename(CONFIG_FILE_PATH, CONFIG_BACKUP_PATH);
+  if (config_save_contents(contents, CONFIG_FILE_PATH)) {
+    std::unique_lock<std::recursive_mutex> lock(config_lock);
+    if (config_generation == generation) config_clear_dirty(config);
   }
+
   if (btif_is_niap_mode()) {
     get_bluetooth_keystore_interface()->set_encrypt_key_or_remove_key(
         CONFIG_FILE_PREFIX, CONFIG_FILE_HASH);
   }
 }
 
+// Returns false for the device sections that don't belong in the paired
+// config, true for paired devices and for any other section.
+static bool btif_config_is_paired_or_other(const config_t* conf,
+                                           const char* section) {
+  if (!RawAddress::IsValidAddress(section)) return true;
+
+  return config_has_key(conf, section, "LinkKey") ||
+         config_has_key(conf, section, "LE_KEY_PENC") ||
+         config_has_key(conf, section, "LE_KEY_PID") ||
+         config_has_key(conf, section, "LE_KEY_PCSRK") ||
+         config_has_key(conf, section, "LE_KEY_LENC") ||
+         config_has_key(conf, section, "LE_KEY_LCSRK") ||
+         config_has_key(conf, section, "AvrcpCtVersion") ||
+         config_has_key(conf, section, "AvrcpFeatures") ||
+         config_has_key(conf, section, "TwsPlusPeerAddr") ||
+         config_has_key(conf, section, "Codecs");
+}
+
 static void btif_config_remove_unpaired(config_t* conf) {
   CHECK(conf != NULL);
   int paired_devices = 0;
@@ -671,16 +916,7 @@ static void btif_config_remove_unpaired(config_t* conf) {
   while (snode != config_section_end(conf)) {
     const char* section = config_section_name(snode);
     if (RawAddress::IsValidAddress(section)) {
-      if (!config_has_key(conf, section, "LinkKey") &&
-          !config_has_key(conf, section, "LE_KEY_PENC") &&
-          !config_has_key(conf, section, "LE_KEY_PID") &&
-          !config_has_key(conf, section, "LE_KEY_PCSRK") &&
-          !config_has_key(conf, section, "LE_KEY_LENC") &&
-          !config_has_key(conf, section, "LE_KEY_LCSRK") &&
-          !config_has_key(conf, section, "AvrcpCtVersion") &&
-          !config_has_key(conf, section, "AvrcpFeatures") &&
-          !config_has_key(conf, section, "TwsPlusPeerAddr") &&
-          !config_has_key(conf, section, "Codecs")) {
+      if (!btif_config_is_paired_or_other(conf, section)) {
         snode = config_section_next(snode);
         config_remove_section(conf, section);
         continue;
@@ -63,6 +63,7 @@
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/properties.h"
+#include "osi/include/task_stats.h"
 #include "osi/include/thread.h"
 #include "stack_manager.h"
 #include "device/include/device_iot_config.h"
@@ -237,7 +238,8 @@ bt_status_t do_in_jni_thread(const base::Location& from_here,
     return BT_STATUS_FAIL;
   }
 
-  if (message_loop_->task_runner()->PostTask(from_here, task))
+  if (message_loop_->task_runner()->PostTask(
+          from_here, task_stats_wrap(BT_JNI_WORKQUEUE_NAME, from_here, task)))
     return BT_STATUS_SUCCESS;
 
   BTIF_TRACE_ERROR("%s: Post task to task runner failed!", __func__);
@@ -859,10 +861,7 @@ static void execute_storage_request(uint16_t event, char* p_param) {
         local_le_features.local_privacy_enabled = BTM_BleLocalPrivacyEnabled();
 
         prop.len = sizeof(bt_local_le_features_t);
-        if (cmn_vsc_cb.filter_support == 1)
-          local_le_features.max_adv_filter_supported = cmn_vsc_cb.max_filter;
-        else
-          local_le_features.max_adv_filter_supported = 0;
+        local_le_features.max_adv_filter_supported = BTM_BleMaxScanFilters();
         local_le_features.max_adv_instance = cmn_vsc_cb.adv_inst_max;
         local_le_features.max_irk_list_size = cmn_vsc_cb.max_irk_list_sz;
         local_le_features.rpa_offload_supported = cmn_vsc_cb.rpa_offloading;
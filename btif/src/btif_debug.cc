@@ -22,8 +22,20 @@
 #include "btif/include/btif_debug.h"
 #include "btif/include/btif_debug_btsnoop.h"
 #include "internal_include/bt_target.h"
+#include "osi/include/allocation_tracker.h"
+#include "osi/include/properties.h"
+#include "osi/include/task_stats.h"
+
+// Set to 1 to record the queueing delay and run time of the stack tasks
+#define TASK_STATS_PROPERTY "persist.bluetooth.taskstats"
+
+// Set to N to sample one in N osi allocations by size and call site
+#define ALLOC_SAMPLE_PROPERTY "persist.bluetooth.allocsample"
 
 void btif_debug_init(void) {
+  task_stats_set_enabled(osi_property_get_int32(TASK_STATS_PROPERTY, 0) != 0);
+  int32_t alloc_sample = osi_property_get_int32(ALLOC_SAMPLE_PROPERTY, 0);
+  if (alloc_sample > 0) allocation_tracker_init_sampling(alloc_sample);
 #if (BTSNOOP_MEM == TRUE)
   btif_debug_btsnoop_init();
 #endif
@@ -16,17 +16,23 @@
  *
  ******************************************************************************/
 
+#include <string.h>
+
+#include <algorithm>
+#include <deque>
 #include <mutex>
+#include <vector>
 
+#include <base/bind.h>
 #include <base/logging.h>
 #include <resolv.h>
 #include <zlib.h>
 
 #include "btif/include/btif_debug.h"
 #include "btif/include/btif_debug_btsnoop.h"
+#include "common/thread_pool.h"
 #include "hci/include/btsnoop_mem.h"
 #include "internal_include/bt_target.h"
-#include "osi/include/ringbuffer.h"
 #include "osi/include/time.h"
 
 #define REDUCE_HCI_TYPE_TO_SIGNIFICANT_BITS(type) ((type) >> 8)
@@ -39,16 +45,40 @@ static const size_t BTSNOOP_MEM_BUFFER_SIZE = (256 * 1024);
 // Block size for copying buffers (for compression/encoding etc.)
 static const size_t BLOCK_SIZE = 16384;
 
+// Records are grouped in blocks of up to this size, compressed once full
+#ifndef BTSNOOZ_RECORD_BLOCK_SIZE
+static const size_t BTSNOOZ_RECORD_BLOCK_SIZE = (16 * 1024);
+#endif
+
 // Maximum line length in bugreport (should be multiple of 4 for base64 output)
 static const uint8_t MAX_LINE_LENGTH = 128;
 
+// A full block of records, compressed on its own
+typedef struct {
+  std::vector<uint8_t> data;
+  size_t length;  // Uncompressed length
+} btsnooz_block_t;
+
+// The memory log holds, oldest first, the compressed blocks, the full blocks
+// the thread pool has yet to compress and the block being filled. Together
+// they stay within BTSNOOP_MEM_BUFFER_SIZE. The pool takes the oldest full
+// block out to |pending_block| while it compresses it.
 static std::mutex buffer_mutex;
-static ringbuffer_t* buffer = NULL;
+static std::deque<btsnooz_block_t> compressed_blocks;
+static size_t compressed_size = 0;
+static size_t compressed_records_length = 0;
+static std::vector<uint8_t> pending_block;
+static std::deque<std::vector<uint8_t>> full_blocks;
+static size_t full_blocks_size = 0;  // |pending_block| included
+static bool compressing = false;
+static std::vector<uint8_t> current_block;
 static uint64_t last_timestamp_ms = 0;
 
 static size_t btsnoop_calculate_packet_length(uint16_t type,
                                               const uint8_t* data,
                                               size_t length);
+static void btsnoop_close_block(void);
+static void btsnoop_compress_full_blocks(void);
 
 __attribute__((no_sanitize("integer")))
 static void btsnoop_cb(const uint16_t type, const uint8_t* data,
@@ -60,13 +90,9 @@ static void btsnoop_cb(const uint16_t type, const uint8_t* data,
 
   std::lock_guard<std::mutex> lock(buffer_mutex);
 
-  // Make room in the ring buffer
-
-  while (ringbuffer_available(buffer) <
-         (included_length + sizeof(btsnooz_header_t))) {
-    ringbuffer_pop(buffer, (uint8_t*)&header, sizeof(btsnooz_header_t));
-    ringbuffer_delete(buffer, header.length - 1);
-  }
+  if (current_block.size() + sizeof(btsnooz_header_t) + included_length >
+      BTSNOOZ_RECORD_BLOCK_SIZE)
+    btsnoop_close_block();
 
   // Insert data
   header.type = REDUCE_HCI_TYPE_TO_SIGNIFICANT_BITS(type);
@@ -76,8 +102,103 @@ static void btsnoop_cb(const uint16_t type, const uint8_t* data,
       last_timestamp_ms ? timestamp_us - last_timestamp_ms : 0;
   last_timestamp_ms = timestamp_us;
 
-  ringbuffer_insert(buffer, (uint8_t*)&header, sizeof(btsnooz_header_t));
-  ringbuffer_insert(buffer, data, included_length);
+  const uint8_t* p_header = (const uint8_t*)&header;
+  current_block.insert(current_block.end(), p_header,
+                       p_header + sizeof(btsnooz_header_t));
+  current_block.insert(current_block.end(), data, data + included_length);
+}
+
+// Compresses the records of |records| into |block|.
+static bool btsnoop_compress_block(const std::vector<uint8_t>& records,
+                                   btsnooz_block_t* block) {
+  uLongf compressed_length = compressBound(records.size());
+  block->data.resize(compressed_length);
+  block->length = records.size();
+  if (compress2(block->data.data(), &compressed_length, records.data(),
+                records.size(), Z_DEFAULT_COMPRESSION) != Z_OK) {
+    LOG(ERROR) << __func__ << ": unable to compress " << records.size()
+               << " bytes of records";
+    return false;
+  }
+  block->data.resize(compressed_length);
+  block->data.shrink_to_fit();
+  return true;
+}
+
+// Drops the oldest blocks to make room for the next one. Full blocks are only
+// dropped once no compressed block is left, if the pool falls that far behind.
+// Must be called with buffer_mutex held.
+static void btsnoop_trim(void) {
+  const size_t budget = BTSNOOP_MEM_BUFFER_SIZE - BTSNOOZ_RECORD_BLOCK_SIZE;
+  while (compressed_size + full_blocks_size > budget) {
+    if (!compressed_blocks.empty()) {
+      compressed_size -= compressed_blocks.front().data.size();
+      compressed_records_length -= compressed_blocks.front().length;
+      compressed_blocks.pop_front();
+    } else if (!full_blocks.empty()) {
+      full_blocks_size -= full_blocks.front().size();
+      full_blocks.pop_front();
+    } else {
+      break;
+    }
+  }
+}
+
+// Must be called with buffer_mutex held.
+static void btsnoop_add_compressed_block(btsnooz_block_t block) {
+  compressed_size += block.data.size();
+  compressed_records_length += block.length;
+  compressed_blocks.push_back(std::move(block));
+  btsnoop_trim();
+}
+
+// Hands the block being filled over to the thread pool to be compressed, or
+// compresses it in place if the pool is not running. Must be called with
+// buffer_mutex held.
+static void btsnoop_close_block(void) {
+  if (current_block.empty()) return;
+
+  full_blocks_size += current_block.size();
+  full_blocks.push_back(std::move(current_block));
+  current_block = std::vector<uint8_t>();
+  current_block.reserve(BTSNOOZ_RECORD_BLOCK_SIZE);
+  btsnoop_trim();
+
+  // The running task compresses every full block, in order
+  if (compressing) return;
+  compressing = true;
+  if (bluetooth::common::PostToPool(
+          FROM_HERE, base::BindOnce(&btsnoop_compress_full_blocks)))
+    return;
+  compressing = false;
+
+  while (!full_blocks.empty()) {
+    btsnooz_block_t block;
+    bool rc = btsnoop_compress_block(full_blocks.front(), &block);
+    full_blocks_size -= full_blocks.front().size();
+    full_blocks.pop_front();
+    if (rc) btsnoop_add_compressed_block(std::move(block));
+  }
+}
+
+// Runs in the thread pool until no full block is left to compress.
+static void btsnoop_compress_full_blocks(void) {
+  std::unique_lock<std::mutex> lock(buffer_mutex);
+  while (!full_blocks.empty()) {
+    pending_block = std::move(full_blocks.front());
+    full_blocks.pop_front();
+
+    // |pending_block| is only read while it is compressed, dumps included
+    lock.unlock();
+    btsnooz_block_t block;
+    bool rc = btsnoop_compress_block(pending_block, &block);
+    lock.lock();
+
+    full_blocks_size -= pending_block.size();
+    pending_block = std::vector<uint8_t>();
+    if (rc) btsnoop_add_compressed_block(std::move(block));
+  }
+  compressing = false;
 }
 
 static size_t btsnoop_calculate_packet_length(uint16_t type,
@@ -132,9 +253,27 @@ static size_t btsnoop_calculate_packet_length(uint16_t type,
   }
 }
 
-static bool btsnoop_compress(ringbuffer_t* rb_dst, ringbuffer_t* rb_src) {
-  CHECK(rb_dst != NULL);
-  CHECK(rb_src != NULL);
+// Appends the deflate output of |zs| to |dst| until |flush| is done.
+static bool btsnoop_deflate(z_stream* zs, int flush,
+                            std::vector<uint8_t>* dst) {
+  uint8_t block_dst[BLOCK_SIZE];
+
+  do {
+    zs->avail_out = BLOCK_SIZE;
+    zs->next_out = block_dst;
+
+    if (deflate(zs, flush) == Z_STREAM_ERROR) return false;
+
+    dst->insert(dst->end(), block_dst, block_dst + BLOCK_SIZE - zs->avail_out);
+  } while (zs->avail_out == 0);
+
+  return true;
+}
+
+// Appends every record to |dst| as a single compressed stream, whatever the
+// blocks they are held in. Must be called with buffer_mutex held.
+static bool btsnoop_compress(std::vector<uint8_t>* dst) {
+  CHECK(dst != NULL);
 
   z_stream zs;
   zs.zalloc = Z_NULL;
@@ -144,29 +283,37 @@ static bool btsnoop_compress(ringbuffer_t* rb_dst, ringbuffer_t* rb_src) {
   if (deflateInit(&zs, Z_DEFAULT_COMPRESSION) != Z_OK) return false;
 
   bool rc = true;
-  uint8_t block_src[BLOCK_SIZE];
-  uint8_t block_dst[BLOCK_SIZE];
+  std::vector<uint8_t> records(BTSNOOZ_RECORD_BLOCK_SIZE);
+  for (const btsnooz_block_t& block : compressed_blocks) {
+    if (!rc) break;
+    uLongf length = records.size();
+    if (uncompress(records.data(), &length, block.data.data(),
+                   block.data.size()) != Z_OK) {
+      rc = false;
+      break;
+    }
+    zs.avail_in = length;
+    zs.next_in = records.data();
+    rc = btsnoop_deflate(&zs, Z_NO_FLUSH, dst);
+  }
 
-  const size_t num_blocks =
-      (ringbuffer_size(rb_src) + BLOCK_SIZE - 1) / BLOCK_SIZE;
-  for (size_t i = 0; i < num_blocks; ++i) {
-    zs.avail_in =
-        ringbuffer_peek(rb_src, i * BLOCK_SIZE, block_src, BLOCK_SIZE);
-    zs.next_in = block_src;
-
-    do {
-      zs.avail_out = BLOCK_SIZE;
-      zs.next_out = block_dst;
-
-      int err = deflate(&zs, (i == num_blocks - 1) ? Z_FINISH : Z_NO_FLUSH);
-      if (err == Z_STREAM_ERROR) {
-        rc = false;
-        break;
-      }
+  if (rc && !pending_block.empty()) {
+    zs.avail_in = pending_block.size();
+    zs.next_in = pending_block.data();
+    rc = btsnoop_deflate(&zs, Z_NO_FLUSH, dst);
+  }
+
+  for (const std::vector<uint8_t>& records : full_blocks) {
+    if (!rc) break;
+    zs.avail_in = records.size();
+    zs.next_in = const_cast<uint8_t*>(records.data());
+    rc = btsnoop_deflate(&zs, Z_NO_FLUSH, dst);
+  }
 
-      const size_t length = BLOCK_SIZE - zs.avail_out;
-      ringbuffer_insert(rb_dst, block_dst, length);
-    } while (zs.avail_out == 0);
+  if (rc) {
+    zs.avail_in = current_block.size();
+    zs.next_in = current_block.data();
+    rc = btsnoop_deflate(&zs, Z_FINISH, dst);
   }
 
   deflateEnd(&zs);
@@ -174,24 +321,22 @@ static bool btsnoop_compress(ringbuffer_t* rb_dst, ringbuffer_t* rb_src) {
 }
 
 void btif_debug_btsnoop_init(void) {
-  if (buffer == NULL) buffer = ringbuffer_init(BTSNOOP_MEM_BUFFER_SIZE);
+  {
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    current_block.reserve(BTSNOOZ_RECORD_BLOCK_SIZE);
+  }
   btsnoop_mem_set_callback(btsnoop_cb);
 }
 
 void btif_debug_btsnoop_dump(int fd) {
-  ringbuffer_t* ringbuffer = ringbuffer_init(BTSNOOP_MEM_BUFFER_SIZE);
-  if (ringbuffer == NULL) {
-    dprintf(fd, "%s Unable to allocate memory for compression", __func__);
-    return;
-  }
+  std::vector<uint8_t> compressed;
+  compressed.reserve(BTSNOOP_MEM_BUFFER_SIZE);
 
   // Prepend preamble
 
   btsnooz_preamble_t preamble;
   preamble.version = BTSNOOZ_CURRENT_VERSION;
-  preamble.last_timestamp_ms = last_timestamp_ms;
-  ringbuffer_insert(ringbuffer, (uint8_t*)&preamble,
-                    sizeof(btsnooz_preamble_t));
+  compressed.resize(sizeof(btsnooz_preamble_t));
 
   // Compress data
 
@@ -203,20 +348,26 @@ void btif_debug_btsnoop_dump(int fd) {
   bool rc;
   {
     std::lock_guard<std::mutex> lock(buffer_mutex);
-    dprintf(fd, "--- BEGIN:BTSNOOP_LOG_SUMMARY (%zu bytes in) ---\n",
-            ringbuffer_size(buffer));
-    rc = btsnoop_compress(ringbuffer, buffer);
+    preamble.last_timestamp_ms = last_timestamp_ms;
+    memcpy(compressed.data(), &preamble, sizeof(btsnooz_preamble_t));
+    dprintf(fd,
+            "--- BEGIN:BTSNOOP_LOG_SUMMARY (%zu bytes in, %zu bytes held) "
+            "---\n",
+            compressed_records_length + full_blocks_size + current_block.size(),
+            compressed_size + full_blocks_size + current_block.size());
+    rc = btsnoop_compress(&compressed);
   }
 
   if (rc == false) {
     dprintf(fd, "%s Log compression failed", __func__);
-    goto error;
+    return;
   }
 
   // Base64 encode & output
 
-  while (ringbuffer_size(ringbuffer) > 0) {
-    size_t read = ringbuffer_pop(ringbuffer, b64_in, 3);
+  for (size_t offset = 0; offset < compressed.size(); offset += 3) {
+    size_t read = std::min<size_t>(3, compressed.size() - offset);
+    memcpy(b64_in, &compressed[offset], read);
     if (line_length >= MAX_LINE_LENGTH) {
       dprintf(fd, "\n");
       line_length = 0;
@@ -226,7 +377,4 @@ void btif_debug_btsnoop_dump(int fd) {
   }
 
   dprintf(fd, "\n--- END:BTSNOOP_LOG_SUMMARY ---\n");
-
-error:
-  ringbuffer_free(ringbuffer);
 }
@@ -20,10 +20,17 @@
 #include <string.h>
 #include <time.h>
 
+#include <algorithm>
+#include <mutex>
+
 #include "btif/include/btif_debug_conn.h"
+#include "l2cdefs.h"
 #include "osi/include/time.h"
 
 #define NUM_CONNECTION_EVENTS 16
+#define NUM_CONNECTION_TIMELINES 8
+#define NUM_MILESTONE_SAMPLES 64
+#define NUM_LINK_POLICY_EVENTS 16
 #define TEMP_BUFFER_SIZE 30
 
 typedef struct conn_event_t {
@@ -33,9 +40,40 @@ typedef struct conn_event_t {
   tGATT_DISCONN_REASON disconnect_reason;
 } conn_event_t;
 
+typedef struct conn_timeline_t {
+  uint64_t ts;  // Wall clock time of the first milestone
+  RawAddress bda;
+  // Boot time of each milestone, 0 if the milestone was not reached
+  uint64_t milestone_us[BTIF_DEBUG_CONN_MILESTONE_MAX];
+} conn_timeline_t;
+
+typedef struct link_policy_event_t {
+  uint64_t ts;
+  RawAddress bda;
+  const char* policy;
+  uint16_t pkt_types;
+  uint16_t flush_tout;
+} link_policy_event_t;
+
+// Delays of a milestone from the start of the timelines
+typedef struct milestone_stats_t {
+  size_t count;
+  uint64_t delay_us[NUM_MILESTONE_SAMPLES];  // The last samples
+} milestone_stats_t;
+
 static conn_event_t connection_events[NUM_CONNECTION_EVENTS];
 static uint8_t current_event = 0;
 
+// The milestones are reported from several threads
+static std::mutex timeline_mutex;
+static conn_timeline_t timelines[NUM_CONNECTION_TIMELINES];
+static uint8_t current_timeline = 0;
+static milestone_stats_t milestone_stats[BTIF_DEBUG_CONN_MILESTONE_MAX];
+
+static std::mutex link_policy_mutex;
+static link_policy_event_t link_policy_events[NUM_LINK_POLICY_EVENTS];
+static size_t link_policy_event_count = 0;
+
 static char* format_ts(const uint64_t ts, char* buffer, int len) {
   const uint64_t ms = ts / 1000;
   const time_t secs = ms / 1000;
@@ -61,6 +99,70 @@ static const char* format_state(const btif_debug_conn_state_t state) {
   return "UNKNOWN";
 }
 
+static const char* format_milestone(
+    const btif_debug_conn_milestone_t milestone) {
+  switch (milestone) {
+    case BTIF_DEBUG_CONN_ACL_CREATE:
+      return "ACL create       ";
+    case BTIF_DEBUG_CONN_ACL_CONNECTED:
+      return "ACL connected    ";
+    case BTIF_DEBUG_CONN_REMOTE_FEATURES:
+      return "Remote features  ";
+    case BTIF_DEBUG_CONN_ENCRYPTED:
+      return "Encrypted        ";
+    case BTIF_DEBUG_CONN_DISCOVERY_START:
+      return "Discovery start  ";
+    case BTIF_DEBUG_CONN_DISCOVERY_END:
+      return "Discovery end    ";
+    case BTIF_DEBUG_CONN_PROFILE_CONNECTED:
+      return "Profile connected";
+    case BTIF_DEBUG_CONN_MILESTONE_MAX:
+      break;
+  }
+  return "UNKNOWN          ";
+}
+
+// Returns the start of |timeline|, the boot time of its first milestone
+static uint64_t timeline_start_us(const conn_timeline_t* timeline) {
+  if (timeline->milestone_us[BTIF_DEBUG_CONN_ACL_CREATE] != 0)
+    return timeline->milestone_us[BTIF_DEBUG_CONN_ACL_CREATE];
+  return timeline->milestone_us[BTIF_DEBUG_CONN_ACL_CONNECTED];
+}
+
+// Returns the latest timeline of |bda|, or nullptr if there is none
+static conn_timeline_t* find_timeline(const RawAddress& bda) {
+  uint8_t index = current_timeline;
+  for (int i = 0; i < NUM_CONNECTION_TIMELINES; i++) {
+    conn_timeline_t* timeline = &timelines[index];
+    if (timeline->ts != 0 && timeline->bda == bda) return timeline;
+    index = (index > 0) ? index - 1 : NUM_CONNECTION_TIMELINES - 1;
+  }
+  return nullptr;
+}
+
+static conn_timeline_t* start_timeline(const RawAddress& bda) {
+  ++current_timeline;
+  if (current_timeline == NUM_CONNECTION_TIMELINES) current_timeline = 0;
+
+  conn_timeline_t* timeline = &timelines[current_timeline];
+  memset(timeline, 0, sizeof(*timeline));
+  timeline->ts = time_gettimeofday_us();
+  timeline->bda = bda;
+  return timeline;
+}
+
+// Returns the |percent| percentile of the samples of |stats|
+static uint64_t get_delay_percentile_us(const milestone_stats_t* stats,
+                                        int percent) {
+  size_t samples = std::min<size_t>(stats->count, NUM_MILESTONE_SAMPLES);
+  if (samples == 0) return 0;
+
+  uint64_t sorted[NUM_MILESTONE_SAMPLES];
+  std::copy(stats->delay_us, stats->delay_us + samples, sorted);
+  std::sort(sorted, sorted + samples);
+  return sorted[(samples - 1) * percent / 100];
+}
+
 static void next_event() {
   ++current_event;
   if (current_event == NUM_CONNECTION_EVENTS) current_event = 0;
@@ -78,6 +180,116 @@ void btif_debug_conn_state(const RawAddress& bda,
   evt->bda = bda;
 }
 
+void btif_debug_conn_milestone(const RawAddress& bda,
+                               const btif_debug_conn_milestone_t milestone) {
+  if (milestone >= BTIF_DEBUG_CONN_MILESTONE_MAX) return;
+  const uint64_t now_us = time_get_os_boottime_us();
+
+  std::lock_guard<std::mutex> lock(timeline_mutex);
+  conn_timeline_t* timeline = find_timeline(bda);
+  bool creating = timeline != nullptr &&
+                  timeline->milestone_us[BTIF_DEBUG_CONN_ACL_CREATE] != 0 &&
+                  timeline->milestone_us[BTIF_DEBUG_CONN_ACL_CONNECTED] == 0;
+
+  switch (milestone) {
+    case BTIF_DEBUG_CONN_ACL_CREATE:
+      // A new attempt of a pending creation keeps the first one
+      if (creating) return;
+      timeline = start_timeline(bda);
+      break;
+    case BTIF_DEBUG_CONN_ACL_CONNECTED:
+      if (!creating) timeline = start_timeline(bda);
+      break;
+    default:
+      if (timeline == nullptr || timeline->milestone_us[milestone] != 0)
+        return;
+      break;
+  }
+
+  timeline->milestone_us[milestone] = now_us;
+  const uint64_t start_us = timeline_start_us(timeline);
+  if (start_us == 0 || start_us == now_us) return;
+
+  milestone_stats_t* stats = &milestone_stats[milestone];
+  stats->delay_us[stats->count % NUM_MILESTONE_SAMPLES] = now_us - start_us;
+  stats->count++;
+}
+
+void btif_debug_conn_link_policy(const RawAddress& bda, const char* policy,
+                                 uint16_t pkt_types, uint16_t flush_tout) {
+  std::lock_guard<std::mutex> lock(link_policy_mutex);
+  link_policy_event_t* evt =
+      &link_policy_events[link_policy_event_count % NUM_LINK_POLICY_EVENTS];
+  evt->ts = time_gettimeofday_us();
+  evt->bda = bda;
+  evt->policy = policy;
+  evt->pkt_types = pkt_types;
+  evt->flush_tout = flush_tout;
+  link_policy_event_count++;
+}
+
+static void dump_link_policy_events(int fd) {
+  std::lock_guard<std::mutex> lock(link_policy_mutex);
+  char ts_buffer[TEMP_BUFFER_SIZE] = {0};
+
+  dprintf(fd, "\nLink Policy Changes (total %zu):\n", link_policy_event_count);
+  if (link_policy_event_count == 0) dprintf(fd, "  None\n");
+
+  size_t count =
+      std::min<size_t>(link_policy_event_count, NUM_LINK_POLICY_EVENTS);
+  for (size_t i = 1; i <= count; i++) {
+    const link_policy_event_t* evt =
+        &link_policy_events[(link_policy_event_count - i) %
+                            NUM_LINK_POLICY_EVENTS];
+    dprintf(fd, "  %s %s %s packet types: 0x%04x, flush timeout: ",
+            format_ts(evt->ts, ts_buffer, sizeof(ts_buffer)),
+            evt->bda.ToString().c_str(), evt->policy, evt->pkt_types);
+    if (evt->flush_tout == L2CAP_NO_AUTOMATIC_FLUSH)
+      dprintf(fd, "none\n");
+    else
+      dprintf(fd, "%u ms\n", evt->flush_tout);
+  }
+}
+
+static void dump_timelines(int fd) {
+  std::lock_guard<std::mutex> lock(timeline_mutex);
+  char ts_buffer[TEMP_BUFFER_SIZE] = {0};
+
+  dprintf(fd, "\nConnection Timelines (us from the first milestone):\n");
+  uint8_t index = current_timeline;
+  if (timelines[index].ts == 0) dprintf(fd, "  None\n");
+
+  for (int i = 0; i < NUM_CONNECTION_TIMELINES && timelines[index].ts != 0;
+       i++) {
+    const conn_timeline_t* timeline = &timelines[index];
+    const uint64_t start_us = timeline_start_us(timeline);
+    dprintf(fd, "  %s %s\n",
+            format_ts(timeline->ts, ts_buffer, sizeof(ts_buffer)),
+            timeline->bda.ToString().c_str());
+    for (int m = 0; m < BTIF_DEBUG_CONN_MILESTONE_MAX; m++) {
+      if (timeline->milestone_us[m] == 0) continue;
+      dprintf(fd, "    %s %llu\n",
+              format_milestone((btif_debug_conn_milestone_t)m),
+              (unsigned long long)(timeline->milestone_us[m] - start_us));
+    }
+    index = (index > 0) ? index - 1 : NUM_CONNECTION_TIMELINES - 1;
+  }
+
+  dprintf(fd,
+          "\nConnection Milestone Delays (us, last %d: p50 / p90 / p99):\n",
+          NUM_MILESTONE_SAMPLES);
+  for (int m = 0; m < BTIF_DEBUG_CONN_MILESTONE_MAX; m++) {
+    const milestone_stats_t* stats = &milestone_stats[m];
+    if (stats->count == 0) continue;
+    dprintf(fd, "  %s %llu / %llu / %llu (total %zu)\n",
+            format_milestone((btif_debug_conn_milestone_t)m),
+            (unsigned long long)get_delay_percentile_us(stats, 50),
+            (unsigned long long)get_delay_percentile_us(stats, 90),
+            (unsigned long long)get_delay_percentile_us(stats, 99),
+            stats->count);
+  }
+}
+
 void btif_debug_conn_dump(int fd) {
   const uint8_t current_event_local =
       current_event;  // Cache to avoid threading issues
@@ -104,4 +316,7 @@ void btif_debug_conn_dump(int fd) {
     // Check if we dumped all events
     if (dump_event == current_event_local) break;
   }
+
+  dump_timelines(fd);
+  dump_link_policy_events(fd);
 }
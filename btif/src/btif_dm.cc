@@ -65,6 +65,7 @@
 
 #include <base/bind.h>
 #include <base/logging.h>
+#include <inttypes.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -73,7 +74,10 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <map>
 #include <mutex>
+#include <string>
+#include <vector>
 
 #include <bluetooth/uuid.h>
 #include "hardware/vendor.h"
@@ -105,6 +109,7 @@
 #include "osi/include/metrics.h"
 #include "osi/include/osi.h"
 #include "osi/include/properties.h"
+#include "osi/include/time.h"
 #include "stack/btm/btm_int.h"
 #include "stack_config.h"
 #include "stack/sdp/sdpint.h"
@@ -140,6 +145,12 @@ const Uuid UUID_HEARING_AID = Uuid::FromString("FDF0");
 
 #define BTIF_DM_DEFAULT_INQ_MAX_RESULTS 0
 #define BTIF_DM_DEFAULT_INQ_MAX_DURATION 10
+
+/* Inquiry results of a device that repeat what it reported less than this
+ * long ago, apart from the RSSI, are neither stored nor sent up again */
+#ifndef BTIF_DM_INQ_RES_COALESCE_MS
+#define BTIF_DM_INQ_RES_COALESCE_MS 2000
+#endif
 #define BTIF_DM_MAX_SDP_ATTEMPTS_AFTER_PAIRING 2
 
 #define NUM_TIMEOUT_RETRIES 2
@@ -254,6 +265,29 @@ typedef struct {
 /* This flag will be true if HCI_Inquiry is in progress */
 static bool btif_dm_inquiry_in_progress = false;
 
+/* What each device reported last in the current discovery */
+typedef struct {
+  period_ms_t reported_ms;
+  std::string signature; /* reported properties but the RSSI, and the EIR */
+} btif_dm_inq_report_t;
+
+static std::map<RawAddress, btif_dm_inq_report_t> btif_dm_inq_reports;
+static uint32_t btif_dm_inq_res_coalesced;
+
+/* Device counts whose time to be found in a discovery is measured */
+static const size_t btif_dm_disc_milestones[] = {1, 5, 10};
+#define BTIF_DM_DISC_NUM_MILESTONES \
+  (sizeof(btif_dm_disc_milestones) / sizeof(btif_dm_disc_milestones[0]))
+
+typedef struct {
+  period_ms_t start_ms;
+  period_ms_t duration_ms; /* 0 while the discovery runs */
+  size_t num_devices;
+  period_ms_t milestone_ms[BTIF_DM_DISC_NUM_MILESTONES]; /* 0 if not reached */
+} btif_dm_disc_metrics_t;
+
+static btif_dm_disc_metrics_t btif_dm_disc_metrics;
+
 bool twsplus_enabled = false;
 
 /*******************************************************************************
@@ -744,10 +778,6 @@ static void btif_update_remote_properties(const RawAddress& bdaddr,
   if (strlen((const char*)bd_name)) {
     BTIF_STORAGE_FILL_PROPERTY(&properties[num_properties], BT_PROPERTY_BDNAME,
                                strlen((char*)bd_name), bd_name);
-    status = btif_storage_set_remote_device_property(
-        &bdaddr, &properties[num_properties]);
-    ASSERTC(status == BT_STATUS_SUCCESS, "failed to save remote device name",
-            status);
     num_properties++;
   }
 
@@ -770,10 +800,6 @@ static void btif_update_remote_properties(const RawAddress& bdaddr,
 
   BTIF_STORAGE_FILL_PROPERTY(&properties[num_properties],
                              BT_PROPERTY_CLASS_OF_DEVICE, sizeof(cod), &cod);
-  status = btif_storage_set_remote_device_property(&bdaddr,
-                                                   &properties[num_properties]);
-  ASSERTC(status == BT_STATUS_SUCCESS, "failed to save remote device class",
-          status);
   num_properties++;
 
   /* device type */
@@ -790,12 +816,14 @@ static void btif_update_remote_properties(const RawAddress& bdaddr,
   BTIF_STORAGE_FILL_PROPERTY(&properties[num_properties],
                              BT_PROPERTY_TYPE_OF_DEVICE, sizeof(dev_type),
                              &dev_type);
-  status = btif_storage_set_remote_device_property(&bdaddr,
-                                                   &properties[num_properties]);
-  ASSERTC(status == BT_STATUS_SUCCESS, "failed to save remote device type",
-          status);
   num_properties++;
 
+  /* Store all of them at once, so a bonded device is saved a single time */
+  status = btif_storage_set_remote_device_properties(&bdaddr, properties,
+                                                     num_properties);
+  ASSERTC(status == BT_STATUS_SUCCESS,
+          "failed to save remote device properties", status);
+
   auto tmp = bdaddr;
   HAL_CBACK(bt_hal_cbacks, remote_device_properties_cb, status, &tmp,
             num_properties, properties);
@@ -958,69 +986,30 @@ uint16_t btif_dm_get_connection_state(const RawAddress* bd_addr) {
   return rc;
 }
 
-/*******************************************************************************
- *
- * Function         search_devices_copy_cb
- *
- * Description      Deep copy callback for search devices event
- *
- * Returns          void
- *
- ******************************************************************************/
-static void search_devices_copy_cb(uint16_t event, char* p_dest, char* p_src) {
-  tBTA_DM_SEARCH* p_dest_data = (tBTA_DM_SEARCH*)p_dest;
-  tBTA_DM_SEARCH* p_src_data = (tBTA_DM_SEARCH*)p_src;
-
-  if (!p_src) return;
+/* A search event moved to the JNI thread. A successful discovery result owns
+ * the UUID list and raw data that BTA allocated for it, and an inquiry result
+ * keeps its EIR, as the HCI event holding the EIR is freed by then. */
+struct btif_dm_search_evt_t {
+  uint16_t event;
+  tBTA_DM_SEARCH data;
+  std::vector<uint8_t> eir;
 
-  BTIF_TRACE_DEBUG("%s: event=%s", __func__, dump_dm_search_event(event));
-  maybe_non_aligned_memcpy(p_dest_data, p_src_data, sizeof(*p_src_data));
-  switch (event) {
-    case BTA_DM_INQ_RES_EVT: {
-      if (p_src_data->inq_res.p_eir) {
-        p_dest_data->inq_res.p_eir =
-            (uint8_t*)(p_dest + sizeof(tBTA_DM_SEARCH));
-        memcpy(p_dest_data->inq_res.p_eir, p_src_data->inq_res.p_eir,
-               p_src_data->inq_res.eir_len);
-        p_dest_data->inq_res.eir_len = p_src_data->inq_res.eir_len;
-      }
-    } break;
-
-    case BTA_DM_DISC_RES_EVT: {
-      if (p_src_data->disc_res.raw_data_size &&
-          p_src_data->disc_res.p_raw_data) {
-        p_dest_data->disc_res.p_raw_data =
-            (uint8_t*)(p_dest + sizeof(tBTA_DM_SEARCH));
-        memcpy(p_dest_data->disc_res.p_raw_data,
-               p_src_data->disc_res.p_raw_data,
-               p_src_data->disc_res.raw_data_size);
-      }
-    } break;
+  btif_dm_search_evt_t(uint16_t event, const tBTA_DM_SEARCH* p_data)
+      : event(event) {
+    if (p_data)
+      maybe_non_aligned_memcpy(&data, p_data, sizeof(data));
+    else
+      memset(&data, 0, sizeof(data));
   }
-}
-
-static void search_services_copy_cb(uint16_t event, char* p_dest, char* p_src) {
-  tBTA_DM_SEARCH* p_dest_data = (tBTA_DM_SEARCH*)p_dest;
-  tBTA_DM_SEARCH* p_src_data = (tBTA_DM_SEARCH*)p_src;
 
-  if (!p_src) return;
-  maybe_non_aligned_memcpy(p_dest_data, p_src_data, sizeof(*p_src_data));
-  switch (event) {
-    case BTA_DM_DISC_RES_EVT: {
-      if (p_src_data->disc_res.result == BTA_SUCCESS) {
-        if (p_src_data->disc_res.num_uuids > 0) {
-          p_dest_data->disc_res.p_uuid_list =
-              (Uuid*)(p_dest + sizeof(tBTA_DM_SEARCH));
-          memcpy(p_dest_data->disc_res.p_uuid_list,
-                 p_src_data->disc_res.p_uuid_list,
-                 p_src_data->disc_res.num_uuids * sizeof(Uuid));
-          osi_free_and_reset((void**)&p_src_data->disc_res.p_uuid_list);
-        }
-        osi_free_and_reset((void**)&p_src_data->disc_res.p_raw_data);
-      }
-    } break;
+  ~btif_dm_search_evt_t() {
+    if (event == BTA_DM_DISC_RES_EVT && data.disc_res.result == BTA_SUCCESS) {
+      osi_free(data.disc_res.p_uuid_list);
+      osi_free(data.disc_res.p_raw_data);
+    }
   }
-}
+};
+
 /******************************************************************************
  *
  *  BTIF DM callback events
@@ -1451,6 +1440,54 @@ static void btif_dm_auth_cmpl_evt(tBTA_DM_AUTH_CMPL* p_auth_cmpl) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         btif_dm_inq_res_is_repeat
+ *
+ * Description      Checks if an inquiry result repeats, apart from the RSSI,
+ *                  the properties and EIR |bdaddr| reported less than
+ *                  BTIF_DM_INQ_RES_COALESCE_MS ago. Otherwise the result is
+ *                  remembered as the last one reported.
+ *
+ * Returns          true if the result can be dropped
+ *
+ ******************************************************************************/
+static bool btif_dm_inq_res_is_repeat(const RawAddress& bdaddr,
+                                      int addr_type, uint32_t num_properties,
+                                      const bt_property_t* properties,
+                                      const tBTA_DM_INQ_RES* p_inq_res) {
+  std::string signature((const char*)&addr_type, sizeof(addr_type));
+  for (uint32_t i = 0; i < num_properties; i++) {
+    if (properties[i].type == BT_PROPERTY_REMOTE_RSSI) continue;
+    signature.append((const char*)&properties[i].type,
+                     sizeof(properties[i].type));
+    signature.append((const char*)properties[i].val, properties[i].len);
+  }
+  if (p_inq_res->p_eir)
+    signature.append((const char*)p_inq_res->p_eir, p_inq_res->eir_len);
+
+  period_ms_t now_ms = time_get_os_boottime_ms();
+  btif_dm_inq_report_t& report = btif_dm_inq_reports[bdaddr];
+  if (report.reported_ms == 0) {
+    /* A device new to this discovery */
+    btif_dm_disc_metrics.num_devices = btif_dm_inq_reports.size();
+    for (size_t i = 0; i < BTIF_DM_DISC_NUM_MILESTONES; i++) {
+      if (btif_dm_disc_milestones[i] == btif_dm_disc_metrics.num_devices)
+        btif_dm_disc_metrics.milestone_ms[i] =
+            now_ms - btif_dm_disc_metrics.start_ms;
+    }
+  } else if (
+      now_ms - report.reported_ms < BTIF_DM_INQ_RES_COALESCE_MS &&
+      report.signature == signature) {
+    btif_dm_inq_res_coalesced++;
+    return true;
+  }
+
+  report.reported_ms = now_ms;
+  report.signature = std::move(signature);
+  return false;
+}
+
 /******************************************************************************
  *
  * Function         btif_dm_search_devices_evt
@@ -1460,13 +1497,15 @@ static void btif_dm_auth_cmpl_evt(tBTA_DM_AUTH_CMPL* p_auth_cmpl) {
  * Returns          void
  *
  *****************************************************************************/
-static void btif_dm_search_devices_evt(uint16_t event, char* p_param) {
+static void btif_dm_search_devices_evt(
+    std::unique_ptr<btif_dm_search_evt_t> p_evt) {
+  uint16_t event = p_evt->event;
   tBTA_DM_SEARCH* p_search_data;
   BTIF_TRACE_EVENT("%s event=%s", __func__, dump_dm_search_event(event));
 
   switch (event) {
     case BTA_DM_DISC_RES_EVT: {
-      p_search_data = (tBTA_DM_SEARCH*)p_param;
+      p_search_data = &p_evt->data;
       /* Remote name update */
       if (strlen((const char*)p_search_data->disc_res.bd_name)) {
         bt_property_t properties[1];
@@ -1493,7 +1532,7 @@ static void btif_dm_search_devices_evt(uint16_t event, char* p_param) {
       uint8_t remote_name_len;
       tBTA_SERVICE_MASK services = 0;
 
-      p_search_data = (tBTA_DM_SEARCH*)p_param;
+      p_search_data = &p_evt->data;
       RawAddress bdaddr = p_search_data->inq_res.bd_addr;
       RawAddress peer_eb_bdaddr = RawAddress::kEmpty;
       BTIF_TRACE_DEBUG("%s() %s device_type = 0x%x\n", __func__,
@@ -1587,6 +1626,10 @@ static void btif_dm_search_devices_evt(uint16_t event, char* p_param) {
                                    &(p_search_data->inq_res.rssi));
         num_properties++;
 
+        if (btif_dm_inq_res_is_repeat(bdaddr, addr_type, num_properties,
+                                      properties, &p_search_data->inq_res))
+          break;
+
         status =
             btif_storage_add_remote_device(&bdaddr, num_properties, properties);
         ASSERTC(status == BT_STATUS_SUCCESS,
@@ -1615,6 +1658,13 @@ static void btif_dm_search_devices_evt(uint16_t event, char* p_param) {
                      nullptr, base::Bind(&bte_scan_filt_param_cfg_evt, 0)));
     } break;
     case BTA_DM_DISC_CMPL_EVT: {
+      BTIF_TRACE_DEBUG("%s: %zu devices, %u repeated inquiry results dropped",
+                       __func__, btif_dm_inq_reports.size(),
+                       btif_dm_inq_res_coalesced);
+      btif_dm_disc_metrics.duration_ms =
+          time_get_os_boottime_ms() - btif_dm_disc_metrics.start_ms;
+      BTIF_TRACE_DEBUG("%s: first device after %" PRIu64 " ms", __func__,
+                       btif_dm_disc_metrics.milestone_ms[0]);
       HAL_CBACK(bt_hal_cbacks, discovery_state_changed_cb,
                 BT_DISCOVERY_STOPPED);
     } break;
@@ -1655,8 +1705,10 @@ static void btif_dm_search_devices_evt(uint16_t event, char* p_param) {
  * Returns          void
  *
  ******************************************************************************/
-static void btif_dm_search_services_evt(uint16_t event, char* p_param) {
-  tBTA_DM_SEARCH* p_data = (tBTA_DM_SEARCH*)p_param;
+static void btif_dm_search_services_evt(
+    std::unique_ptr<btif_dm_search_evt_t> p_evt) {
+  uint16_t event = p_evt->event;
+  tBTA_DM_SEARCH* p_data = &p_evt->data;
 
   BTIF_TRACE_EVENT("%s:  event = %d", __func__, event);
   switch (event) {
@@ -2294,10 +2346,7 @@ static void btif_dm_upstreams_evt(uint16_t event, char* p_param) {
       local_le_features.local_privacy_enabled = BTM_BleLocalPrivacyEnabled();
 
       prop.len = sizeof(bt_local_le_features_t);
-      if (cmn_vsc_cb.filter_support == 1)
-        local_le_features.max_adv_filter_supported = cmn_vsc_cb.max_filter;
-      else
-        local_le_features.max_adv_filter_supported = 0;
+      local_le_features.max_adv_filter_supported = BTM_BleMaxScanFilters();
       local_le_features.max_adv_instance = cmn_vsc_cb.adv_inst_max;
       local_le_features.max_irk_list_size = cmn_vsc_cb.max_irk_list_sz;
       local_le_features.rpa_offload_supported = cmn_vsc_cb.rpa_offloading;
@@ -2510,23 +2559,7 @@ void bte_dm_evt(tBTA_DM_SEC_EVT event, tBTA_DM_SEC* p_data) {
  ******************************************************************************/
 static void bte_search_devices_evt(tBTA_DM_SEARCH_EVT event,
                                    tBTA_DM_SEARCH* p_data) {
-  uint16_t param_len = 0;
-
-  if (p_data) param_len += sizeof(tBTA_DM_SEARCH);
-  /* Allocate buffer to hold the pointers (deep copy). The pointers will point
-   * to the end of the tBTA_DM_SEARCH */
-  switch (event) {
-    case BTA_DM_INQ_RES_EVT: {
-      if (p_data && p_data->inq_res.p_eir) param_len += p_data->inq_res.eir_len;
-    } break;
-
-    case BTA_DM_DISC_RES_EVT: {
-      if (p_data && p_data->disc_res.raw_data_size && p_data->disc_res.p_raw_data)
-        param_len += p_data->disc_res.raw_data_size;
-    } break;
-  }
-  BTIF_TRACE_DEBUG("%s event=%s param_len=%d", __func__,
-                   dump_dm_search_event(event), param_len);
+  BTIF_TRACE_DEBUG("%s event=%s", __func__, dump_dm_search_event(event));
 
   /* if remote name is available in EIR, set teh flag so that stack doesnt
    * trigger RNR */
@@ -2534,9 +2567,15 @@ static void bte_search_devices_evt(tBTA_DM_SEARCH_EVT event,
     p_data->inq_res.remt_name_not_required =
         check_eir_remote_name(p_data, NULL, NULL);
 
-  btif_transfer_context(
-      btif_dm_search_devices_evt, (uint16_t)event, (char*)p_data, param_len,
-      (param_len > sizeof(tBTA_DM_SEARCH)) ? search_devices_copy_cb : NULL);
+  std::unique_ptr<btif_dm_search_evt_t> p_evt(
+      new btif_dm_search_evt_t(event, p_data));
+  if (p_data && event == BTA_DM_INQ_RES_EVT && p_data->inq_res.p_eir) {
+    p_evt->eir.assign(p_data->inq_res.p_eir,
+                      p_data->inq_res.p_eir + p_data->inq_res.eir_len);
+    p_evt->data.inq_res.p_eir = p_evt->eir.data();
+  }
+
+  do_in_jni_thread(FROM_HERE, btif_dm_search_devices_evt, std::move(p_evt));
 }
 
 /*******************************************************************************
@@ -2551,22 +2590,12 @@ static void bte_search_devices_evt(tBTA_DM_SEARCH_EVT event,
  ******************************************************************************/
 static void bte_dm_search_services_evt(tBTA_DM_SEARCH_EVT event,
                                        tBTA_DM_SEARCH* p_data) {
-  uint16_t param_len = 0;
-  if (p_data) param_len += sizeof(tBTA_DM_SEARCH);
-  switch (event) {
-    case BTA_DM_DISC_RES_EVT: {
-      if ((p_data && p_data->disc_res.result == BTA_SUCCESS) &&
-          (p_data->disc_res.num_uuids > 0)) {
-        param_len += (p_data->disc_res.num_uuids * Uuid::kNumBytes128);
-      }
-    } break;
-  }
-  /* TODO: The only other member that needs a deep copy is the p_raw_data. But
-   * not sure
-   * if raw_data is needed. */
-  btif_transfer_context(
-      btif_dm_search_services_evt, event, (char*)p_data, param_len,
-      (param_len > sizeof(tBTA_DM_SEARCH)) ? search_services_copy_cb : NULL);
+  /* The UUID list and raw data of a discovery result are handed over with the
+   * event, so they are moved rather than copied */
+  do_in_jni_thread(
+      FROM_HERE, btif_dm_search_services_evt,
+      std::unique_ptr<btif_dm_search_evt_t>(
+          new btif_dm_search_evt_t(event, p_data)));
 }
 
 /*******************************************************************************
@@ -2700,6 +2729,10 @@ bt_status_t btif_dm_start_discovery(void) {
 
   /* Will be enabled to true once inquiry busy level has been received */
   btif_dm_inquiry_in_progress = false;
+  btif_dm_inq_reports.clear();
+  btif_dm_inq_res_coalesced = 0;
+  memset(&btif_dm_disc_metrics, 0, sizeof(btif_dm_disc_metrics));
+  btif_dm_disc_metrics.start_ms = time_get_os_boottime_ms();
   /* find nearby devices */
   BTA_DmSearch(&inq_params, services, bte_search_devices_evt);
 
@@ -3924,6 +3957,25 @@ void btif_debug_bond_event_dump(int fd) {
   }
 }
 
+void btif_debug_discovery_dump(int fd) {
+  const btif_dm_disc_metrics_t* p_metrics = &btif_dm_disc_metrics;
+
+  dprintf(fd, "\nLast Discovery: \n");
+  if (p_metrics->start_ms == 0) return;
+
+  if (p_metrics->duration_ms != 0)
+    dprintf(fd, "  Duration: %" PRIu64 " ms\n", p_metrics->duration_ms);
+  else
+    dprintf(fd, "  Running for: %" PRIu64 " ms\n",
+            time_get_os_boottime_ms() - p_metrics->start_ms);
+  dprintf(fd, "  Devices found: %zu\n", p_metrics->num_devices);
+  for (size_t i = 0; i < BTIF_DM_DISC_NUM_MILESTONES; i++) {
+    if (p_metrics->milestone_ms[i] == 0) continue;
+    dprintf(fd, "  Time to %zu device(s): %" PRIu64 " ms\n",
+            btif_dm_disc_milestones[i], p_metrics->milestone_ms[i]);
+  }
+}
+
 /*******************************************************************************
  *
  * Function        btif_dm_get_br_edr_links.
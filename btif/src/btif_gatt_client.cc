@@ -33,6 +33,7 @@
 #include <hardware/bluetooth.h>
 #include <stdlib.h>
 #include <string.h>
+#include <mutex>
 #include "device/include/controller.h"
 
 #include "btif_common.h"
@@ -96,6 +97,12 @@ extern const btgatt_callbacks_t* bt_gatt_callbacks;
 inline bool BTM_BLE_IS_RESOLVE_BDA(const RawAddress& x) {
   return ((x.address)[0] & BLE_RESOLVE_ADDR_MASK) == BLE_RESOLVE_ADDR_MSB;
 }
+
+/* Notifications waiting for delivery on the JNI thread */
+#ifndef BTIF_GATTC_NOTIFY_RING_SIZE
+#define BTIF_GATTC_NOTIFY_RING_SIZE 64
+#endif
+
 namespace {
 
 uint8_t rssi_request_client_if;
@@ -121,6 +128,7 @@ void btif_gattc_upstreams_evt(uint16_t event, char* p_param) {
     }
 
     case BTA_GATTC_NOTIF_EVT: {
+      /* indications, and notifications that could not be batched */
       btgatt_notify_params_t data;
 
       data.bda = p_data->notify.bda;
@@ -204,13 +212,101 @@ void btif_gattc_upstreams_evt(uint16_t event, char* p_param) {
                 p_data->conn_update.status);
       break;
 
+    case BTA_GATTC_SRVC_CHG_RANGE_EVT:
+      /* the HAL has no callback for a changed range */
+      break;
+
     default:
       LOG_ERROR(LOG_TAG, "%s: Unhandled event (%d)!", __func__, event);
       break;
   }
 }
 
+/* Notifications are copied into a ring on the stack thread, and each batch of
+ * them is delivered by a single task on the JNI thread. Any other event closes
+ * the current batch, so that the JNI thread sees events in arrival order. */
+struct notify_entry_t {
+  uint32_t batch;
+  uint16_t conn_id;
+  btgatt_notify_params_t params;
+};
+
+std::mutex notify_ring_mutex;
+notify_entry_t notify_ring[BTIF_GATTC_NOTIFY_RING_SIZE];
+size_t notify_ring_head;
+size_t notify_ring_count;
+uint32_t notify_batch;  /* batch new notifications are added to */
+bool notify_batch_open; /* a task is posted for notify_batch */
+
+void btif_gattc_deliver_notify_batch(uint32_t batch) {
+  notify_entry_t entry;
+
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(notify_ring_mutex);
+      const notify_entry_t& front = notify_ring[notify_ring_head];
+      if (notify_ring_count == 0 || front.batch != batch) {
+        if (notify_batch == batch) notify_batch_open = false;
+        return;
+      }
+
+      entry.conn_id = front.conn_id;
+      entry.params.bda = front.params.bda;
+      entry.params.handle = front.params.handle;
+      entry.params.len = front.params.len;
+      entry.params.is_notify = front.params.is_notify;
+      memcpy(entry.params.value, front.params.value, front.params.len);
+
+      notify_ring_head = (notify_ring_head + 1) % BTIF_GATTC_NOTIFY_RING_SIZE;
+      notify_ring_count--;
+    }
+
+    HAL_CBACK(bt_gatt_callbacks, client->notify_cb, entry.conn_id,
+              entry.params);
+  }
+}
+
+/* Returns true if |notify| was queued for batched delivery */
+bool btif_gattc_batch_notify(const tBTA_GATTC_NOTIFY& notify) {
+  std::lock_guard<std::mutex> lock(notify_ring_mutex);
+
+  if (notify_ring_count == BTIF_GATTC_NOTIFY_RING_SIZE ||
+      notify.len > BTGATT_MAX_ATTR_LEN) {
+    notify_batch_open = false;
+    return false;
+  }
+
+  if (!notify_batch_open) {
+    notify_batch++;
+    if (do_in_jni_thread(
+            Bind(&btif_gattc_deliver_notify_batch, notify_batch)) !=
+        BT_STATUS_SUCCESS)
+      return false;
+    notify_batch_open = true;
+  }
+
+  notify_entry_t& entry =
+      notify_ring[(notify_ring_head + notify_ring_count) %
+                  BTIF_GATTC_NOTIFY_RING_SIZE];
+  entry.batch = notify_batch;
+  entry.conn_id = notify.conn_id;
+  entry.params.bda = notify.bda;
+  entry.params.handle = notify.handle;
+  entry.params.len = notify.len;
+  entry.params.is_notify = notify.is_notify;
+  memcpy(entry.params.value, notify.value, notify.len);
+  notify_ring_count++;
+  return true;
+}
+
 void bta_gattc_cback(tBTA_GATTC_EVT event, tBTA_GATTC* p_data) {
+  if (event == BTA_GATTC_NOTIF_EVT && p_data->notify.is_notify) {
+    if (btif_gattc_batch_notify(p_data->notify)) return;
+  } else {
+    std::lock_guard<std::mutex> lock(notify_ring_mutex);
+    notify_batch_open = false;
+  }
+
   bt_status_t status =
       btif_transfer_context(btif_gattc_upstreams_evt, (uint16_t)event,
                             (char*)p_data, sizeof(tBTA_GATTC), NULL);
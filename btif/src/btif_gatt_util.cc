@@ -20,6 +20,7 @@
 
 #include "btif_gatt_util.h"
 
+#include <base/bind.h>
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -30,6 +31,7 @@
 
 #include "bt_common.h"
 #include "bta_api.h"
+#include "bta_closure_api.h"
 #include "bta_gatt_api.h"
 #include "bta_jv_api.h"
 #include "btif_common.h"
@@ -72,18 +74,25 @@ static void btif_gatt_set_encryption_cb(UNUSED_ATTR const RawAddress& bd_addr,
 #endif
 
 #if (BLE_DELAY_REQUEST_ENC == FALSE)
-void btif_gatt_check_encrypted_link(RawAddress bd_addr,
-                                    tGATT_TRANSPORT transport_link) {
-  tBTM_LE_PENC_KEYS key;
-  if ((btif_storage_get_ble_bonding_key(
-           &bd_addr, BTIF_DM_LE_KEY_PENC, (uint8_t*)&key,
-           sizeof(tBTM_LE_PENC_KEYS)) == BT_STATUS_SUCCESS) &&
+static void btif_gatt_check_encrypted_link_on_bta(
+    RawAddress bd_addr, tGATT_TRANSPORT transport_link) {
+  if (BTM_BleIsPeerEncKeyKnown(bd_addr) &&
       !btif_gatt_is_link_encrypted(bd_addr)) {
     BTIF_TRACE_DEBUG("%s: transport = %d", __func__, transport_link);
     BTA_DmSetEncryption(bd_addr, transport_link, &btif_gatt_set_encryption_cb,
                         BTM_BLE_SEC_ENCRYPT);
   }
 }
+
+void btif_gatt_check_encrypted_link(RawAddress bd_addr,
+                                    tGATT_TRANSPORT transport_link) {
+  // The keys of the bonded devices are loaded in the security records at
+  // startup, so check them on the stack thread instead of reading and
+  // decoding the config.
+  do_in_bta_thread(FROM_HERE,
+                   base::Bind(&btif_gatt_check_encrypted_link_on_bta, bd_addr,
+                              transport_link));
+}
 #else
 void btif_gatt_check_encrypted_link(UNUSED_ATTR RawAddress bd_addr,
                                     UNUSED_ATTR tGATT_TRANSPORT
@@ -557,13 +557,13 @@ static bt_status_t send_report(bthd_report_type_t type, uint8_t id,
   }
 
   if (type == BTHD_REPORT_TYPE_INTRDATA) {
-    report.type = BTHD_REPORT_TYPE_INPUT;
-    report.use_intr = TRUE;
-  } else {
-    report.type = (type & 0x03);
-    report.use_intr = FALSE;
+    BTA_HdSendInputReport(id, len, p_data);
+    return BT_STATUS_SUCCESS;
   }
 
+  report.type = (type & 0x03);
+  report.use_intr = FALSE;
+
   report.id = id;
   report.len = len;
   report.p_data = p_data;
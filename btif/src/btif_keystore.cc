@@ -26,6 +26,9 @@
 #include <base/callback.h>
 
 #include <map>
+#include <mutex>
+
+#include "btif_config.h"
 
 using base::Bind;
 using base::Unretained;
@@ -45,6 +48,10 @@ class BluetoothKeystoreInterfaceImpl
   void init(BluetoothKeystoreCallbacks* callbacks) override {
     VLOG(2) << __func__;
     this->callbacks = callbacks;
+
+    // The keys of the bonded devices are read in one go, off the paths that
+    // need them.
+    do_in_jni_thread(base::Bind(&btif_config_load_encrypted_keys));
   }
 
   void set_encrypt_key_or_remove_key(std::string prefix,
@@ -57,7 +64,10 @@ class BluetoothKeystoreInterfaceImpl
     }
 
     // Save the value into a map.
-    key_map[prefix] = decryptedString;
+    {
+      std::lock_guard<std::mutex> lock(key_map_lock);
+      key_map[prefix] = decryptedString;
+    }
 
     do_in_jni_thread(
         base::Bind(&bluetooth::bluetooth_keystore::BluetoothKeystoreCallbacks::
@@ -73,17 +83,20 @@ class BluetoothKeystoreInterfaceImpl
       return "";
     }
 
-    std::string decryptedString;
     // try to find the key.
-    std::map<std::string, std::string>::iterator iter = key_map.find(prefix);
-    if (iter == key_map.end()) {
-      decryptedString = callbacks->get_key(prefix);
-      // Save the value into a map.
-      key_map[prefix] = decryptedString;
-      VLOG(2) << __func__ << ": get key from bluetoothkeystore.";
-    } else {
-      decryptedString = iter->second;
+    {
+      std::lock_guard<std::mutex> lock(key_map_lock);
+      std::map<std::string, std::string>::iterator iter = key_map.find(prefix);
+      if (iter != key_map.end()) return iter->second;
     }
+
+    // The keystore is called without the lock, so that the cached keys can
+    // be read meanwhile.
+    std::string decryptedString = callbacks->get_key(prefix);
+    // Save the value into a map.
+    std::lock_guard<std::mutex> lock(key_map_lock);
+    key_map.emplace(prefix, decryptedString);
+    VLOG(2) << __func__ << ": get key from bluetoothkeystore.";
     return decryptedString;
   }
 
@@ -91,12 +104,15 @@ class BluetoothKeystoreInterfaceImpl
     VLOG(2) << __func__;
 
     std::map<std::string, std::string> empty_map;
+    std::lock_guard<std::mutex> lock(key_map_lock);
     key_map.swap(empty_map);
     key_map.clear();
   }
 
  private:
   BluetoothKeystoreCallbacks* callbacks = nullptr;
+  // Decrypted keys, read from any thread that reads the config
+  std::mutex key_map_lock;
   std::map<std::string, std::string> key_map;
 };
 
@@ -45,6 +45,7 @@
 #include <sys/prctl.h>
 #include <sys/select.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -86,8 +87,6 @@
                        __func__, #s, __LINE__)                           \
   } while (0)
 
-#define MIN(x, y) (((x) < (y)) ? (x) : (y))
-
 btpan_cb_t btpan_cb;
 
 static bool jni_initialized;
@@ -424,19 +423,29 @@ int btpan_tap_send(int tap_fd, const RawAddress& src, const RawAddress& dst,
     eth_hdr.h_dest = dst;
     eth_hdr.h_src = src;
     eth_hdr.h_proto = htons(proto);
-    char packet[TAP_MAX_PKT_WRITE_LEN + sizeof(tETH_HDR)];
-    memcpy(packet, &eth_hdr, sizeof(tETH_HDR));
     if (len > TAP_MAX_PKT_WRITE_LEN) {
       LOG_ERROR(LOG_TAG, "btpan_tap_send eth packet size:%d is exceeded limit!",
                 len);
+      btpan_cb.stats.tap_write_errors++;
       return -1;
     }
-    memcpy(packet + sizeof(tETH_HDR), buf, len);
 
-    /* Send data to network interface */
+    /* Send data to network interface, the driver takes one frame per write so
+     * the header and the payload are gathered rather than copied together */
+    struct iovec iov[2];
+    iov[0].iov_base = &eth_hdr;
+    iov[0].iov_len = sizeof(tETH_HDR);
+    iov[1].iov_base = (void*)buf;
+    iov[1].iov_len = len;
     ssize_t ret;
-    OSI_NO_INTR(ret = write(tap_fd, packet, len + sizeof(tETH_HDR)));
+    OSI_NO_INTR(ret = writev(tap_fd, iov, 2));
     BTIF_TRACE_DEBUG("ret:%d", ret);
+    if (ret < 0) {
+      btpan_cb.stats.tap_write_errors++;
+    } else {
+      btpan_cb.stats.tap_write_frames++;
+      btpan_cb.stats.tap_write_bytes += len;
+    }
     return (int)ret;
   }
   return -1;
@@ -676,9 +685,7 @@ static void bta_pan_callback(tBTA_PAN_EVT event, tBTA_PAN* p_data) {
                         sizeof(tBTA_PAN), NULL);
 }
 
-#define IS_EXCEPTION(e) ((e) & (POLLHUP | POLLRDHUP | POLLERR | POLLNVAL))
 static void btu_exec_tap_fd_read(void* p_param) {
-  struct pollfd ufd;
   int fd = PTR_TO_INT(p_param);
 
   if (fd == INVALID_FD || fd != btpan_cb.tap_fd) return;
@@ -686,74 +693,61 @@ static void btu_exec_tap_fd_read(void* p_param) {
   // Don't occupy BTU context too long, avoid buffer overruns and
   // give other profiles a chance to run by limiting the amount of memory
   // PAN can use.
+  size_t frames = 0;
   for (int i = 0; i < PAN_BUF_MAX && btif_is_enabled() && btpan_cb.flow; i++) {
+    // The Ethernet header is read apart so that the payload lands right after
+    // the headroom BNEP and L2CAP need for their own headers.
     BT_HDR* buffer = (BT_HDR*)osi_malloc(PAN_BUF_SIZE);
     buffer->offset = PAN_MINIMUM_OFFSET;
-    buffer->len = PAN_BUF_SIZE - sizeof(BT_HDR) - buffer->offset;
-
-    uint8_t* packet = (uint8_t*)buffer + sizeof(BT_HDR) + buffer->offset;
-
-    // If we don't have an undelivered packet left over, pull one from the TAP
-    // driver.
-    // We save it in the congest_packet right away in case we can't deliver it
-    // in this
-    // attempt.
-    if (!btpan_cb.congest_packet_size) {
-      ssize_t ret;
-      OSI_NO_INTR(ret = read(fd, btpan_cb.congest_packet,
-                             sizeof(btpan_cb.congest_packet)));
-      switch (ret) {
-        case -1:
-          BTIF_TRACE_ERROR("%s unable to read from driver: %s", __func__,
-                           strerror(errno));
-          osi_free(buffer);
-          // add fd back to monitor thread to try it again later
-          btsock_thread_add_fd(pan_pth, fd, 0, SOCK_THREAD_FD_RD, 0);
-          return;
-        case 0:
-          BTIF_TRACE_WARNING("%s end of file reached.", __func__);
-          osi_free(buffer);
-          // add fd back to monitor thread to process the exception
-          btsock_thread_add_fd(pan_pth, fd, 0, SOCK_THREAD_FD_RD, 0);
-          return;
-        default:
-          btpan_cb.congest_packet_size = ret;
-          break;
+    uint8_t* packet = (uint8_t*)(buffer + 1) + buffer->offset;
+
+    tETH_HDR hdr;
+    struct iovec iov[2];
+    iov[0].iov_base = &hdr;
+    iov[0].iov_len = sizeof(tETH_HDR);
+    iov[1].iov_base = packet;
+    iov[1].iov_len = PAN_BUF_SIZE - sizeof(BT_HDR) - buffer->offset;
+
+    ssize_t ret;
+    OSI_NO_INTR(ret = readv(fd, iov, 2));
+    if (ret <= 0) {
+      if (ret == 0) {
+        BTIF_TRACE_WARNING("%s end of file reached.", __func__);
+      } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        BTIF_TRACE_ERROR("%s unable to read from driver: %s", __func__,
+                         strerror(errno));
       }
+      // Nothing left to read, the monitor thread reports the next frame or
+      // the exception
+      osi_free(buffer);
+      break;
     }
-
-    memcpy(packet, btpan_cb.congest_packet,
-           MIN(btpan_cb.congest_packet_size, buffer->len));
-    buffer->len = MIN(btpan_cb.congest_packet_size, buffer->len);
-
-    if (buffer->len > sizeof(tETH_HDR) && should_forward((tETH_HDR*)packet)) {
-      // Extract the ethernet header from the buffer since the PAN_WriteBuf
-      // inside
-      // forward_bnep can't handle two pointers that point inside the same GKI
-      // buffer.
-      tETH_HDR hdr;
-      memcpy(&hdr, packet, sizeof(tETH_HDR));
-
-      // Skip the ethernet header.
-      buffer->len -= sizeof(tETH_HDR);
-      buffer->offset += sizeof(tETH_HDR);
-      if (forward_bnep(&hdr, buffer) != FORWARD_CONGEST)
-        btpan_cb.congest_packet_size = 0;
+    frames++;
+
+    if ((size_t)ret > sizeof(tETH_HDR) && should_forward(&hdr)) {
+      buffer->len = ret - sizeof(tETH_HDR);
+      btpan_cb.stats.tap_read_frames++;
+      btpan_cb.stats.tap_read_bytes += buffer->len;
+      int result = forward_bnep(&hdr, buffer);
+      if (result == FORWARD_CONGEST) {
+        // BNEP has released the frame, the flow control normally stops the
+        // reads before its queue is full
+        btpan_cb.stats.tap_read_congested++;
+      } else if (result == FORWARD_IGNORE) {
+        btpan_cb.stats.tap_read_dropped++;
+      }
     } else {
       BTIF_TRACE_WARNING("%s dropping packet of length %d", __func__,
-                         buffer->len);
-      btpan_cb.congest_packet_size = 0;
+                         (int)ret);
+      btpan_cb.stats.tap_read_dropped++;
       osi_free(buffer);
     }
+  }
 
-    // Bail out of the loop if reading from the TAP fd would block.
-    ufd.fd = fd;
-    ufd.events = POLLIN;
-    ufd.revents = 0;
-
-    int ret;
-    OSI_NO_INTR(ret = poll(&ufd, 1, 0));
-    if (ret <= 0 || IS_EXCEPTION(ufd.revents)) break;
+  if (frames > 0) {
+    btpan_cb.stats.tap_read_batches++;
+    if (frames > btpan_cb.stats.tap_read_max_batch)
+      btpan_cb.stats.tap_read_max_batch = frames;
   }
 
   if (btpan_cb.flow) {
@@ -762,6 +756,31 @@ static void btu_exec_tap_fd_read(void* p_param) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         btif_pan_debug_dump
+ *
+ * Description      Dumps the tethering throughput counters to |fd|
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btif_pan_debug_dump(int fd) {
+  const btpan_stats_t* stats = &btpan_cb.stats;
+
+  dprintf(fd, "\nPAN tethering:\n");
+  dprintf(fd, "  Open connections: %d\n", btpan_cb.open_count);
+  dprintf(fd, "  TAP reads (frames/bytes): %zu / %zu\n",
+          stats->tap_read_frames, stats->tap_read_bytes);
+  dprintf(fd, "  TAP read wakeups (count/max frames): %zu / %zu\n",
+          stats->tap_read_batches, stats->tap_read_max_batch);
+  dprintf(fd, "  TAP reads not forwarded (dropped/congested): %zu / %zu\n",
+          stats->tap_read_dropped, stats->tap_read_congested);
+  dprintf(fd, "  TAP writes (frames/bytes/errors): %zu / %zu / %zu\n",
+          stats->tap_write_frames, stats->tap_write_bytes,
+          stats->tap_write_errors);
+}
+
 static void btif_pan_close_all_conns() {
   if (!stack_initialized) return;
 
@@ -37,6 +37,8 @@
 
 #include "bt_common.h"
 #include "btif_common.h"
+#include "btm_api.h"
+#include "device/include/interop.h"
 #include "osi/include/allocator.h"
 #include "osi/include/list.h"
 #include "stack_manager.h"
@@ -51,6 +53,7 @@ typedef enum {
   BTIF_QUEUE_ADVANCE_EVT,
   BTIF_QUEUE_ADVANCE_BY_UUID_EVT,
   BTIF_QUEUE_CLEANUP_EVT,
+  BTIF_QUEUE_LINK_CHECK_EVT,
 
   BTIF_QUEUE_DISCONNECT_EVT,
 } btif_queue_event_t;
@@ -72,6 +75,15 @@ static list_t* connect_queue;
 
 static const size_t MAX_REASONABLE_REQUESTS = 20;
 
+// Requests of independent profiles wait behind a request in progress until
+// the ACL of their device is up and encrypted; it is checked again at this
+// interval meanwhile.
+#define PROFILE_CONNECT_LINK_CHECK_MS 200
+
+static alarm_t* connect_link_check_alarm;
+
+static void queue_int_handle_evt(uint16_t event, char* p_param);
+
 extern thread_t *bt_jni_workqueue_thread;
 /*******************************************************************************
  *  Queue helper functions
@@ -192,6 +204,82 @@ static void queue_int_cleanup(uint16_t* p_uuid) {
   }
 }
 
+// Returns true if the request |p_node| may be dispatched while others are in
+// progress. The profiles below keep their own state per device, so they only
+// need the link to be set up by whichever one comes first. The others, and
+// devices that misbehave when profiles connect at the same time, stay
+// serialized.
+static bool queue_int_is_independent(const connect_node_t* p_node) {
+  switch (p_node->uuid) {
+    case UUID_SERVCLASS_AUDIO_SOURCE:
+    case UUID_SERVCLASS_AUDIO_SINK:
+    case UUID_SERVCLASS_AG_HANDSFREE:
+      return !interop_match_addr_or_name(
+          INTEROP_SERIALIZE_PROFILE_CONNECTIONS, &p_node->bda);
+    default:
+      return false;
+  }
+}
+
+// Returns true if the ACL to |bda| is up and encrypted, so that a profile
+// connection does not start another page or authentication.
+static bool queue_int_link_ready(const RawAddress& bda) {
+  uint8_t sec_flags = 0;
+  return BTM_IsAclConnectionUp(bda, BT_TRANSPORT_BR_EDR) &&
+         BTM_GetSecurityFlagsByTransport(bda, &sec_flags,
+                                         BT_TRANSPORT_BR_EDR) &&
+         (sec_flags & BTM_SEC_FLAG_ENCRYPTED);
+}
+
+static void queue_int_link_check_cb(UNUSED_ATTR void* data) {
+  btif_transfer_context(queue_int_handle_evt, BTIF_QUEUE_LINK_CHECK_EVT, NULL,
+                        0, NULL);
+}
+
+static void queue_int_schedule_link_check() {
+  if (!connect_link_check_alarm)
+    connect_link_check_alarm = alarm_new("btif_queue.link_check");
+  if (!alarm_is_scheduled(connect_link_check_alarm))
+    alarm_set(connect_link_check_alarm, PROFILE_CONNECT_LINK_CHECK_MS,
+              queue_int_link_check_cb, NULL);
+}
+
+// Dispatches the requests queued behind a head request of an independent
+// profile, as long as they are independent too. The first serialized request
+// stops the walk so it still runs after everything queued before it.
+static void queue_int_connect_independent() {
+  connect_node_t* p_head = (connect_node_t*)list_front(connect_queue);
+  if (!queue_int_is_independent(p_head)) return;
+
+  for (const list_node_t* node = list_next(list_begin(connect_queue));
+       node != list_end(connect_queue); node = list_next(node)) {
+    connect_node_t* p_node = (connect_node_t*)list_node(node);
+    if (!queue_int_is_independent(p_node)) return;
+    if (p_node->busy) continue;
+
+    // One connection at a time per profile
+    bool profile_busy = false;
+    for (const list_node_t* prev = list_begin(connect_queue); prev != node;
+         prev = list_next(prev)) {
+      const connect_node_t* p_prev = (connect_node_t*)list_node(prev);
+      if (p_prev->busy && p_prev->uuid == p_node->uuid) profile_busy = true;
+    }
+    if (profile_busy) continue;
+
+    if (!queue_int_link_ready(p_node->bda)) {
+      queue_int_schedule_link_check();
+      continue;
+    }
+
+    LOG_INFO(LOG_TAG,
+             "%s: executing connection request UUID=%04X, bd_addr=%s "
+             "concurrently",
+             __func__, p_node->uuid, p_node->bda.ToString().c_str());
+    p_node->busy = true;
+    p_node->connect_cb(&p_node->bda, p_node->uuid);
+  }
+}
+
 static void queue_int_handle_evt(uint16_t event, char* p_param) {
   switch (event) {
     case BTIF_QUEUE_CONNECT_EVT:
@@ -209,6 +297,9 @@ static void queue_int_handle_evt(uint16_t event, char* p_param) {
     case BTIF_QUEUE_CLEANUP_EVT:
       queue_int_cleanup((uint16_t*)(p_param));
       return;
+
+    case BTIF_QUEUE_LINK_CHECK_EVT:
+      break;
   }
 
   if (stack_manager_get_interface()->get_stack_is_running())
@@ -311,10 +402,14 @@ bt_status_t btif_queue_connect_next(void) {
            p_head->busy);
   // If the queue is currently busy, we return success anyway,
   // since the connection has been queued...
-  if (p_head->busy) return BT_STATUS_SUCCESS;
+  bt_status_t status = BT_STATUS_SUCCESS;
+  if (!p_head->busy) {
+    p_head->busy = true;
+    status = p_head->connect_cb(&p_head->bda, p_head->uuid);
+  }
 
-  p_head->busy = true;
-  return p_head->connect_cb(&p_head->bda, p_head->uuid);
+  queue_int_connect_independent();
+  return status;
 }
 
 /*******************************************************************************
@@ -330,6 +425,8 @@ void btif_queue_release() {
   LOG_INFO(LOG_TAG, "%s", __func__);
   list_free(connect_queue);
   connect_queue = NULL;
+  alarm_free(connect_link_check_alarm);
+  connect_link_check_alarm = NULL;
 }
 
 
@@ -64,7 +64,12 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <deque>
+#include <map>
 #include <mutex>
+#include <string>
+#include <vector>
 
 #include <hardware/bluetooth.h>
 #include <hardware/bt_rc_ext.h>
@@ -85,6 +90,7 @@
 #include "osi/include/list.h"
 #include "osi/include/osi.h"
 #include "osi/include/properties.h"
+#include "osi/include/time.h"
 #include "stack/sdp/sdpint.h"
 #include "btif_bat.h"
 #include "btif_tws_plus.h"
@@ -209,6 +215,24 @@ typedef struct {
   bool is_rsp_pending;
 } btif_rc_cmd_ctxt_t;
 
+/* Element attributes the app sent are kept this long per device, to answer
+ * the GetElementAttributes repeated on a track without asking the app */
+#ifndef BTIF_RC_ELEM_ATTR_CACHE_MS
+#define BTIF_RC_ELEM_ATTR_CACHE_MS (5 * 1000)
+#endif
+
+/* The folder items the app sent beyond a browsing response are kept, up to
+ * this many per device, to answer the GetFolderItems asking for them next */
+#ifndef BTIF_RC_BROWSE_CURSOR_MAX_ITEMS
+#define BTIF_RC_BROWSE_CURSOR_MAX_ITEMS 256
+#endif
+
+/* Volumes set while a SetAbsoluteVolume is unanswered are folded into the
+ * last one, sent with the response. The peer is not waited for longer. */
+#ifndef BTIF_RC_ABS_VOL_RSP_TIMEOUT_MS
+#define BTIF_RC_ABS_VOL_RSP_TIMEOUT_MS 1000
+#endif
+
 /* 2 second timeout to get interim response */
 #define BTIF_TIMEOUT_RC_INTERIM_RSP_MS (2 * 1000)
 #define BTIF_TIMEOUT_RC_STATUS_CMD_MS (2 * 1000)
@@ -275,6 +299,11 @@ typedef struct {
   unsigned int rc_initial_volume;
 #endif
   uint8_t rc_vol_label;
+  bool rc_abs_vol_in_flight;      /* a SetAbsoluteVolume is unanswered */
+  uint8_t rc_abs_vol_label;       /* its label */
+  period_ms_t rc_abs_vol_sent_ms; /* and when it was sent */
+  bool rc_abs_vol_pending;        /* a volume waits for the response */
+  uint8_t rc_abs_vol_next;        /* the last volume set meanwhile */
   list_t* rc_supported_event_list;
   btif_rc_player_app_settings_t rc_app_settings;
   alarm_t* rc_play_status_timer;
@@ -316,12 +345,46 @@ typedef struct {
 
 typedef struct { uint8_t handle; } btif_rc_handle_t;
 
+/* The element attributes of the current track last sent to a device */
+typedef struct {
+  period_ms_t saved_ms;
+  std::map<uint32_t, std::string> attrs;
+} btif_rc_elem_attr_cache_t;
+
+/* A folder item, with the strings it points to */
+typedef struct {
+  tAVRC_ITEM item;
+  std::string name;
+  std::vector<tAVRC_ATTR_ENTRY> attrs;
+  std::vector<std::string> attr_values;
+} btif_rc_folder_item_t;
+
+/* The GetFolderItems last asked to the app for a device, and the items the
+ * app sent that did not fit the response, from |start_item| on */
+typedef struct {
+  uint8_t scope;
+  uint32_t start_item;
+  uint8_t num_attr;
+  std::vector<uint32_t> attr_ids;
+  uint16_t uid_counter;
+  std::deque<btif_rc_folder_item_t> items;
+} btif_rc_browse_cursor_t;
+
 typedef struct {
   std::recursive_mutex lbllock;
   rc_device_t *rc_index;
 } btif_rc_index_t;
 
 static bool isShoMcastEnabled = false;
+
+/* Cleared on track change, an entry is dropped when its device disconnects */
+static std::mutex elem_attr_cache_lock;
+static std::map<RawAddress, btif_rc_elem_attr_cache_t> elem_attr_cache;
+static btrc_uid_t elem_attr_cache_track;
+
+/* Dropped when the folder, the player or the UIDs change */
+static std::mutex browse_cursor_lock;
+static std::map<RawAddress, btif_rc_browse_cursor_t> browse_cursors;
 static void sleep_ms(period_ms_t timeout_ms);
 static bt_status_t set_addressed_player_rsp(RawAddress* bd_addr,
                                             btrc_status_t rsp_status);
@@ -435,6 +498,27 @@ void get_folder_item_type_player(const tAVRC_ITEM* avrc_item,
                                  btrc_folder_items_t* btrc_item);
 static bt_status_t get_folder_items_cmd(RawAddress* bd_addr, uint8_t scope,
                                         uint8_t start_item, uint8_t num_items);
+static bt_status_t get_element_attr_cached_rsp(btif_rc_device_cb_t* p_dev,
+                                               uint8_t num_attr,
+                                               btrc_media_attr_t* p_attr_ids);
+static tAVRC_STS fill_avrc_folder_item(btrc_folder_items_t* cur_item,
+                                       tAVRC_ITEM* p_item,
+                                       tAVRC_ATTR_ENTRY* attr_vals);
+static void send_folder_items_rsp(btif_rc_device_cb_t* p_dev,
+                                  tAVRC_RESPONSE* p_rsp, BT_HDR* p_msg);
+static void elem_attr_cache_save(const RawAddress& bd_addr, uint8_t num_attr,
+                                 btrc_element_attr_val_t* p_attrs);
+static void elem_attr_cache_track_changed(btrc_notification_type_t type,
+                                          const btrc_uid_t& track);
+static bt_status_t get_folder_items_cached_rsp(btif_rc_device_cb_t* p_dev,
+                                               tAVRC_GET_ITEMS_CMD* p_cmd,
+                                               uint8_t num_attr,
+                                               uint32_t* p_attr_ids);
+static void browse_cursor_save(btif_rc_device_cb_t* p_dev,
+                               uint16_t uid_counter, int sent_items,
+                               uint16_t num_items,
+                               btrc_folder_items_t* p_items);
+static void browse_cursor_drop(const RawAddress* bd_addr);
 
 static void btif_rc_upstreams_evt(uint16_t event, tAVRC_COMMAND* p_param,
                                   uint8_t ctype, uint8_t label,
@@ -449,6 +533,8 @@ static void rc_start_play_status_timer(btif_rc_device_cb_t* p_dev);
 static bool absolute_volume_disabled(void);
 static bool is_peer_avrcp_only_device(RawAddress bd_addr);
 static bt_status_t set_volume(uint8_t volume, RawAddress*bd_addr);
+static bt_status_t send_abs_volume_cmd(int idx, uint8_t volume);
+static void abs_volume_cmd_done(int idx, uint8_t label);
 /*****************************************************************************
  *  Static variables
  *****************************************************************************/
@@ -459,6 +545,11 @@ static btrc_ctrl_callbacks_t* bt_rc_ctrl_callbacks = NULL;
 static btrc_vendor_ctrl_callbacks_t* bt_rc_vendor_ctrl_callbacks = NULL;
 
 static int btif_max_rc_clients = 1;
+/* Index in btif_rc_cb.rc_multi_cb of the last device found by address and
+ * by handle. Most lookups are for the device of the last one, which is
+ * checked before scanning. */
+static std::atomic<int> btif_rc_last_bda_idx(0);
+static std::atomic<int> btif_rc_last_handle_idx(0);
 
 /*****************************************************************************
  *  Static functions
@@ -546,10 +637,18 @@ btif_rc_device_cb_t* btif_rc_get_device_by_bda(const RawAddress* bd_addr) {
     BTIF_TRACE_ERROR("%s: RC multicb is NULL", __func__);
     return NULL;
   }
+  int last_idx = btif_rc_last_bda_idx;
+  if (last_idx < btif_max_rc_clients &&
+      btif_rc_cb.rc_multi_cb[last_idx].rc_state !=
+          BTRC_CONNECTION_STATE_DISCONNECTED &&
+      btif_rc_cb.rc_multi_cb[last_idx].rc_addr == *bd_addr) {
+    return (&btif_rc_cb.rc_multi_cb[last_idx]);
+  }
   for (int idx = 0; idx < btif_max_rc_clients; idx++) {
     if ((btif_rc_cb.rc_multi_cb[idx].rc_state !=
          BTRC_CONNECTION_STATE_DISCONNECTED) &&
         btif_rc_cb.rc_multi_cb[idx].rc_addr == *bd_addr) {
+      btif_rc_last_bda_idx = idx;
       return (&btif_rc_cb.rc_multi_cb[idx]);
     }
   }
@@ -582,10 +681,18 @@ btif_rc_device_cb_t* btif_rc_get_device_by_handle(uint8_t handle) {
     BTIF_TRACE_ERROR("%s: RC multicb is NULL", __func__);
     return NULL;
   }
+  int last_idx = btif_rc_last_handle_idx;
+  if (last_idx < btif_max_rc_clients &&
+      btif_rc_cb.rc_multi_cb[last_idx].rc_state !=
+          BTRC_CONNECTION_STATE_DISCONNECTED &&
+      btif_rc_cb.rc_multi_cb[last_idx].rc_handle == handle) {
+    return (&btif_rc_cb.rc_multi_cb[last_idx]);
+  }
   for (int idx = 0; idx < btif_max_rc_clients; idx++) {
     if ((btif_rc_cb.rc_multi_cb[idx].rc_state !=
          BTRC_CONNECTION_STATE_DISCONNECTED) &&
         (btif_rc_cb.rc_multi_cb[idx].rc_handle == handle)) {
+      btif_rc_last_handle_idx = idx;
       BTIF_TRACE_DEBUG("%s: btif_rc_cb.rc_multi_cb[idx].rc_handle: 0x%x",
                        __func__, btif_rc_cb.rc_multi_cb[idx].rc_handle);
       return (&btif_rc_cb.rc_multi_cb[idx]);
@@ -911,6 +1018,8 @@ void handle_rc_connect(tBTA_AV_RC_OPEN* p_rc_open) {
 #if (TWS_ENABLED == TRUE)
   p_dev->rc_initial_volume = MAX_VOLUME;
 #endif
+  p_dev->rc_abs_vol_in_flight = false;
+  p_dev->rc_abs_vol_pending = false;
   p_dev->rc_only_peer_device = is_peer_avrcp_only_device(p_dev->rc_addr);
   p_dev->rc_connected = true;
   p_dev->rc_handle = p_rc_open->rc_handle;
@@ -964,6 +1073,12 @@ void handle_rc_disconnect(tBTA_AV_RC_CLOSE* p_rc_close) {
     BTIF_TRACE_ERROR("Got disconnect of unknown device");
     return;
   }
+
+  {
+    std::lock_guard<std::mutex> lock(elem_attr_cache_lock);
+    elem_attr_cache.erase(rc_addr);
+  }
+  browse_cursor_drop(&rc_addr);
  
   /* Clean up AVRCP procedure flags */
   memset(&p_dev->rc_app_settings, 0, sizeof(btif_rc_player_app_settings_t));
@@ -996,6 +1111,8 @@ void handle_rc_disconnect(tBTA_AV_RC_CLOSE* p_rc_close) {
 #if (TWS_ENABLED == TRUE)
     p_dev->rc_initial_volume = MAX_VOLUME;
 #endif
+    p_dev->rc_abs_vol_in_flight = false;
+    p_dev->rc_abs_vol_pending = false;
     p_dev->rc_pending_play = false;
     p_dev->rc_play_processed = false;
     p_dev->rc_ignore_play_released = false;
@@ -2178,6 +2295,9 @@ static void btif_rc_upstreams_evt(uint16_t event, tAVRC_COMMAND* pavrc_cmd,
         return;
       }
       fill_pdu_queue(IDX_GET_ELEMENT_ATTR_RSP, ctype, label, true, p_dev, pavrc_cmd->pdu);
+      if (get_element_attr_cached_rsp(p_dev, num_attr, element_attrs) ==
+          BT_STATUS_SUCCESS)
+        break;
       HAL_CBACK(bt_rc_callbacks, get_element_attr_cb, num_attr, element_attrs,
                 &rc_addr);
     } break;
@@ -2229,6 +2349,9 @@ static void btif_rc_upstreams_evt(uint16_t event, tAVRC_COMMAND* pavrc_cmd,
       }
 
       fill_pdu_queue(IDX_GET_FOLDER_ITEMS_RSP, ctype, label, true, p_dev, pavrc_cmd->pdu);
+      if (get_folder_items_cached_rsp(p_dev, &pavrc_cmd->get_items, num_attr,
+                                      attr_ids) == BT_STATUS_SUCCESS)
+        break;
       HAL_CBACK(bt_rc_callbacks, get_folder_items_cb,
                 pavrc_cmd->get_items.scope, pavrc_cmd->get_items.start_item,
                 pavrc_cmd->get_items.end_item, num_attr, attr_ids, &rc_addr);
@@ -2236,12 +2359,14 @@ static void btif_rc_upstreams_evt(uint16_t event, tAVRC_COMMAND* pavrc_cmd,
 
     case AVRC_PDU_SET_ADDRESSED_PLAYER: {
       fill_pdu_queue(IDX_SET_ADDR_PLAYER_RSP, ctype, label, true, p_dev, pavrc_cmd->pdu);
+      browse_cursor_drop(&rc_addr);
       HAL_CBACK(bt_rc_callbacks, set_addressed_player_cb,
                 pavrc_cmd->addr_player.player_id, &rc_addr);
     } break;
 
     case AVRC_PDU_SET_BROWSED_PLAYER: {
       fill_pdu_queue(IDX_SET_BROWSED_PLAYER_RSP, ctype, label, true, p_dev, pavrc_cmd->pdu);
+      browse_cursor_drop(&rc_addr);
       HAL_CBACK(bt_rc_callbacks, set_browsed_player_cb,
                 pavrc_cmd->br_player.player_id, &rc_addr);
     } break;
@@ -2278,12 +2403,14 @@ static void btif_rc_upstreams_evt(uint16_t event, tAVRC_COMMAND* pavrc_cmd,
 
     case AVRC_PDU_CHANGE_PATH: {
       fill_pdu_queue(IDX_CHG_PATH_RSP, ctype, label, true, p_dev, pavrc_cmd->pdu);
+      browse_cursor_drop(&rc_addr);
       HAL_CBACK(bt_rc_callbacks, change_path_cb, pavrc_cmd->chg_path.direction,
                 pavrc_cmd->chg_path.folder_uid, &rc_addr);
     } break;
 
     case AVRC_PDU_SEARCH: {
       fill_pdu_queue(IDX_SEARCH_RSP, ctype, label, true, p_dev, pavrc_cmd->pdu);
+      browse_cursor_drop(&rc_addr);
       HAL_CBACK(bt_rc_callbacks, search_cb, pavrc_cmd->search.string.charset_id,
                 pavrc_cmd->search.string.str_len,
                 pavrc_cmd->search.string.p_str, &rc_addr);
@@ -2956,6 +3083,113 @@ static bt_status_t get_element_attr_rsp(RawAddress* bd_addr, uint8_t num_attr,
   /* Send the response */
   SEND_METAMSG_RSP(p_dev, rsp_index, &avrc_rsp);
 
+  if (num_attr > 0) elem_attr_cache_save(*bd_addr, num_attr, p_attrs);
+
+  return BT_STATUS_SUCCESS;
+}
+
+/***************************************************************************
+ *
+ * Function         elem_attr_cache_save
+ *
+ * Description      Keeps the element attributes sent to |bd_addr|, but for
+ *                  the cover art handle that depends on the cover art
+ *                  connection.
+ *
+ * Returns          void
+ *
+ **************************************************************************/
+static void elem_attr_cache_save(const RawAddress& bd_addr, uint8_t num_attr,
+                                 btrc_element_attr_val_t* p_attrs) {
+  std::lock_guard<std::mutex> lock(elem_attr_cache_lock);
+  period_ms_t now_ms = time_get_os_boottime_ms();
+  btif_rc_elem_attr_cache_t& cache = elem_attr_cache[bd_addr];
+
+  if (cache.attrs.empty() ||
+      now_ms - cache.saved_ms > BTIF_RC_ELEM_ATTR_CACHE_MS) {
+    cache.attrs.clear();
+    cache.saved_ms = now_ms;
+  }
+
+  for (uint8_t i = 0; i < num_attr; i++) {
+    if (p_attrs[i].attr_id == AVRC_MEDIA_ATTR_ID_COVER_ART) continue;
+    cache.attrs[p_attrs[i].attr_id] =
+        std::string((char*)p_attrs[i].text,
+                    strnlen((char*)p_attrs[i].text, BTRC_MAX_ATTR_STR_LEN));
+  }
+}
+
+/***************************************************************************
+ *
+ * Function         elem_attr_cache_track_changed
+ *
+ * Description      Drops the element attributes of every device when the
+ *                  app reports another track.
+ *
+ * Returns          void
+ *
+ **************************************************************************/
+static void elem_attr_cache_track_changed(btrc_notification_type_t type,
+                                          const btrc_uid_t& track) {
+  std::lock_guard<std::mutex> lock(elem_attr_cache_lock);
+  /* Players that don't browse report the same UID for every track */
+  if (type == BTRC_NOTIFICATION_TYPE_CHANGED ||
+      memcmp(elem_attr_cache_track, track, sizeof(btrc_uid_t)) != 0) {
+    elem_attr_cache.clear();
+    memcpy(elem_attr_cache_track, track, sizeof(btrc_uid_t));
+  }
+}
+
+/***************************************************************************
+ *
+ * Function         get_element_attr_cached_rsp
+ *
+ * Description      Answers the pending GetElementAttributes of |p_dev| from
+ *                  the attributes kept for it, if all of |p_attr_ids| are
+ *                  kept and still fresh.
+ *
+ * Returns          BT_STATUS_SUCCESS if answered, the app is asked otherwise
+ *
+ **************************************************************************/
+static bt_status_t get_element_attr_cached_rsp(btif_rc_device_cb_t* p_dev,
+                                               uint8_t num_attr,
+                                               btrc_media_attr_t* p_attr_ids) {
+  tAVRC_RESPONSE avrc_rsp;
+  tAVRC_ATTR_ENTRY element_attrs[BTRC_MAX_ELEM_ATTR_SIZE];
+  int rsp_index = IDX_GET_ELEMENT_ATTR_RSP;
+
+  if (num_attr == 0 || num_attr > BTRC_MAX_ELEM_ATTR_SIZE)
+    return BT_STATUS_FAIL;
+
+  std::lock_guard<std::mutex> lock(elem_attr_cache_lock);
+  auto cache = elem_attr_cache.find(p_dev->rc_addr);
+  if (cache == elem_attr_cache.end() ||
+      time_get_os_boottime_ms() - cache->second.saved_ms >
+          BTIF_RC_ELEM_ATTR_CACHE_MS)
+    return BT_STATUS_FAIL;
+
+  memset(element_attrs, 0, sizeof(element_attrs));
+  for (uint8_t i = 0; i < num_attr; i++) {
+    auto attr = cache->second.attrs.find(p_attr_ids[i]);
+    if (attr == cache->second.attrs.end()) return BT_STATUS_FAIL;
+
+    element_attrs[i].attr_id = p_attr_ids[i];
+    element_attrs[i].name.charset_id = AVRC_CHARSET_ID_UTF8;
+    element_attrs[i].name.str_len = (uint16_t)attr->second.size();
+    element_attrs[i].name.p_str = (uint8_t*)attr->second.data();
+  }
+
+  BTIF_TRACE_DEBUG("%s: %d attribute(s) answered from the cache", __func__,
+                   num_attr);
+  avrc_rsp.get_attrs.status = AVRC_STS_NO_ERROR;
+  avrc_rsp.get_attrs.num_attrs = num_attr;
+  avrc_rsp.get_attrs.p_attrs = element_attrs;
+  avrc_rsp.get_attrs.pdu = AVRC_PDU_GET_ELEMENT_ATTR;
+  avrc_rsp.get_attrs.opcode = opcode_from_pdu(AVRC_PDU_GET_ELEMENT_ATTR);
+
+  /* Send the response */
+  SEND_METAMSG_RSP(p_dev, rsp_index, &avrc_rsp);
+
   return BT_STATUS_SUCCESS;
 }
 
@@ -3107,6 +3341,14 @@ static bt_status_t register_notification_rsp(
 
   BTIF_TRACE_IMP("%s: isShoMcastEnabled: %d", __func__, isShoMcastEnabled);
 
+  if (event_id == BTRC_EVT_TRACK_CHANGE && p_param != NULL)
+    elem_attr_cache_track_changed(type, p_param->track);
+  if (event_id == BTRC_EVT_NOW_PLAYING_CONTENT_CHANGED ||
+      event_id == BTRC_EVT_AVAL_PLAYER_CHANGE ||
+      event_id == BTRC_EVT_ADDR_PLAYER_CHANGE ||
+      event_id == BTRC_EVT_UIDS_CHANGED)
+    browse_cursor_drop(NULL);
+
   if (isShoMcastEnabled == true) {
     return(register_notification_rsp_sho_mcast(event_id,
                                                type,
@@ -3250,19 +3492,17 @@ static bt_status_t get_folder_items_list_rsp(RawAddress* bd_addr,
                                              btrc_folder_items_t* p_items) {
   tAVRC_RESPONSE avrc_rsp;
   tAVRC_ITEM item;
-  tBTA_AV_CODE code = 0, ctype = 0;
+  tAVRC_ATTR_ENTRY attr_vals[BTRC_MAX_ELEM_ATTR_SIZE];
   BT_HDR* p_msg = NULL;
-  int item_cnt;
+  int item_cnt = 0;
   tAVRC_STS status = AVRC_STS_NO_ERROR;
   btif_rc_device_cb_t* p_dev = btif_rc_get_device_by_bda(bd_addr);
   btrc_folder_items_t* cur_item = NULL;
-  int rsp_index = IDX_GET_FOLDER_ITEMS_RSP;
   if (p_dev == NULL) {
     BTIF_TRACE_ERROR("%s: p_dev is NULL", __func__);
     return BT_STATUS_FAIL;
   }
 
-  int front_index = p_dev->rc_pdu_info[rsp_index].front;
   BTIF_TRACE_DEBUG("%s: uid_counter %d num_items %d", __func__, uid_counter,
                    num_items);
   CHECK_RC_CONNECTED(p_dev);
@@ -3275,7 +3515,6 @@ static bt_status_t get_folder_items_list_rsp(RawAddress* bd_addr,
   }
 
   memset(&avrc_rsp, 0, sizeof(tAVRC_RESPONSE));
-  memset(&item, 0, sizeof(tAVRC_ITEM));
 
   avrc_rsp.get_items.pdu = AVRC_PDU_GET_FOLDER_ITEMS;
   avrc_rsp.get_items.opcode = opcode_from_pdu(AVRC_PDU_GET_FOLDER_ITEMS);
@@ -3293,62 +3532,11 @@ static bt_status_t get_folder_items_list_rsp(RawAddress* bd_addr,
     /* create single item and build response iteratively for all num_items */
     for (item_cnt = 0; item_cnt < num_items; item_cnt++) {
       cur_item = &p_items[item_cnt];
-      item.item_type = cur_item->item_type;
       /* build respective item based on item_type. All items should be of same
        * type within
        * a response */
       BTIF_TRACE_DEBUG("cur_item->item_type:%d,p_items->item_type:%d",cur_item->item_type,p_items->item_type);
-      switch (cur_item->item_type) {
-        case AVRC_ITEM_PLAYER: {
-          item.u.player.name.charset_id = cur_item->player.charset_id;
-          memcpy(&(item.u.player.features), &(cur_item->player.features),
-                 sizeof(cur_item->player.features));
-          item.u.player.major_type = cur_item->player.major_type;
-          item.u.player.sub_type = cur_item->player.sub_type;
-          item.u.player.play_status = cur_item->player.play_status;
-          item.u.player.player_id = cur_item->player.player_id;
-          item.u.player.name.p_str = cur_item->player.name;
-          item.u.player.name.str_len =
-              (uint16_t)strlen((char*)(cur_item->player.name));
-        } break;
-
-        case AVRC_ITEM_FOLDER: {
-          memcpy(item.u.folder.uid, cur_item->folder.uid, sizeof(tAVRC_UID));
-          item.u.folder.type = cur_item->folder.type;
-          item.u.folder.playable = cur_item->folder.playable;
-          item.u.folder.name.charset_id = AVRC_CHARSET_ID_UTF8;
-          item.u.folder.name.str_len = strlen((char*)cur_item->folder.name);
-          item.u.folder.name.p_str = cur_item->folder.name;
-        } break;
-
-        case AVRC_ITEM_MEDIA: {
-          tAVRC_ATTR_ENTRY attr_vals[BTRC_MAX_ELEM_ATTR_SIZE];
-
-          memcpy(item.u.media.uid, cur_item->media.uid, sizeof(tAVRC_UID));
-          item.u.media.type = cur_item->media.type;
-          item.u.media.name.charset_id = cur_item->media.charset_id;
-          item.u.media.name.str_len = strlen((char*)cur_item->media.name);
-          item.u.media.name.p_str = cur_item->media.name;
-          item.u.media.attr_count = cur_item->media.num_attrs;
-
-          /* Handle attributes of given item */
-          if (item.u.media.attr_count == 0) {
-            item.u.media.p_attr_list = NULL;
-          } else {
-            memset(&attr_vals, 0,
-                   sizeof(tAVRC_ATTR_ENTRY) * BTRC_MAX_ELEM_ATTR_SIZE);
-            fill_avrc_attr_entry(attr_vals, item.u.media.attr_count,
-                                 cur_item->media.p_attrs);
-            item.u.media.p_attr_list = attr_vals;
-          }
-        } break;
-
-        default: {
-          BTIF_TRACE_ERROR("%s: Unknown item_type: %d. Internal Error",
-                           __func__, p_items->item_type);
-          status = AVRC_STS_INTERNAL_ERR;
-        } break;
-      }
+      status = fill_avrc_folder_item(cur_item, &item, attr_vals);
 
       avrc_rsp.get_items.p_item_list = &item;
 
@@ -3378,18 +3566,113 @@ static bt_status_t get_folder_items_list_rsp(RawAddress* bd_addr,
     avrc_rsp.get_items.status = status;
   }
 
+  /* the items that did not fit are kept for the next request */
+  if (status == AVRC_STS_NO_ERROR && item_cnt < num_items)
+    browse_cursor_save(p_dev, uid_counter, item_cnt, num_items, p_items);
+
+  send_folder_items_rsp(p_dev, &avrc_rsp, p_msg);
+
+  return status == AVRC_STS_NO_ERROR ? BT_STATUS_SUCCESS : BT_STATUS_FAIL;
+}
+
+/***************************************************************************
+ *
+ * Function         fill_avrc_folder_item
+ *
+ * Description      Fills |p_item| with |cur_item| from the app. The strings
+ *                  and the attributes, kept in |attr_vals|, are not copied.
+ *
+ * Returns          AVRC_STS_NO_ERROR, AVRC_STS_INTERNAL_ERR if the item type
+ *                  is unknown
+ *
+ **************************************************************************/
+static tAVRC_STS fill_avrc_folder_item(btrc_folder_items_t* cur_item,
+                                       tAVRC_ITEM* p_item,
+                                       tAVRC_ATTR_ENTRY* attr_vals) {
+  memset(p_item, 0, sizeof(tAVRC_ITEM));
+  p_item->item_type = cur_item->item_type;
+  switch (cur_item->item_type) {
+    case AVRC_ITEM_PLAYER: {
+      p_item->u.player.name.charset_id = cur_item->player.charset_id;
+      memcpy(&(p_item->u.player.features), &(cur_item->player.features),
+             sizeof(cur_item->player.features));
+      p_item->u.player.major_type = cur_item->player.major_type;
+      p_item->u.player.sub_type = cur_item->player.sub_type;
+      p_item->u.player.play_status = cur_item->player.play_status;
+      p_item->u.player.player_id = cur_item->player.player_id;
+      p_item->u.player.name.p_str = cur_item->player.name;
+      p_item->u.player.name.str_len =
+          (uint16_t)strlen((char*)(cur_item->player.name));
+    } break;
+
+    case AVRC_ITEM_FOLDER: {
+      memcpy(p_item->u.folder.uid, cur_item->folder.uid, sizeof(tAVRC_UID));
+      p_item->u.folder.type = cur_item->folder.type;
+      p_item->u.folder.playable = cur_item->folder.playable;
+      p_item->u.folder.name.charset_id = AVRC_CHARSET_ID_UTF8;
+      p_item->u.folder.name.str_len = strlen((char*)cur_item->folder.name);
+      p_item->u.folder.name.p_str = cur_item->folder.name;
+    } break;
+
+    case AVRC_ITEM_MEDIA: {
+      memcpy(p_item->u.media.uid, cur_item->media.uid, sizeof(tAVRC_UID));
+      p_item->u.media.type = cur_item->media.type;
+      p_item->u.media.name.charset_id = cur_item->media.charset_id;
+      p_item->u.media.name.str_len = strlen((char*)cur_item->media.name);
+      p_item->u.media.name.p_str = cur_item->media.name;
+      p_item->u.media.attr_count = cur_item->media.num_attrs;
+
+      /* Handle attributes of given item */
+      if (p_item->u.media.attr_count == 0) {
+        p_item->u.media.p_attr_list = NULL;
+      } else {
+        memset(attr_vals, 0,
+               sizeof(tAVRC_ATTR_ENTRY) * BTRC_MAX_ELEM_ATTR_SIZE);
+        fill_avrc_attr_entry(attr_vals, p_item->u.media.attr_count,
+                             cur_item->media.p_attrs);
+        p_item->u.media.p_attr_list = attr_vals;
+      }
+    } break;
+
+    default: {
+      BTIF_TRACE_ERROR("%s: Unknown item_type: %d. Internal Error", __func__,
+                       cur_item->item_type);
+      return AVRC_STS_INTERNAL_ERR;
+    }
+  }
+  return AVRC_STS_NO_ERROR;
+}
+
+/***************************************************************************
+ *
+ * Function         send_folder_items_rsp
+ *
+ * Description      Sends the built GetFolderItems response |p_msg| for the
+ *                  pending request of |p_dev|, or rejects it if the status
+ *                  of |p_rsp| is an error.
+ *
+ * Returns          void
+ *
+ **************************************************************************/
+static void send_folder_items_rsp(btif_rc_device_cb_t* p_dev,
+                                  tAVRC_RESPONSE* p_rsp, BT_HDR* p_msg) {
+  tBTA_AV_CODE code = 0, ctype = 0;
+  int rsp_index = IDX_GET_FOLDER_ITEMS_RSP;
+  int front_index = p_dev->rc_pdu_info[rsp_index].front;
+
   /* if packet built successfully, send the built items to BTA layer */
-  if (status == AVRC_STS_NO_ERROR) {
+  if (p_rsp->get_items.status == AVRC_STS_NO_ERROR) {
     code = p_dev->rc_pdu_info[rsp_index].ctype[front_index];
-    ctype = get_rsp_type_code(avrc_rsp.get_items.status, code);
+    ctype = get_rsp_type_code(p_rsp->get_items.status, code);
     BTA_AvMetaRsp(p_dev->rc_handle, p_dev->rc_pdu_info[rsp_index].label[front_index],
                   ctype, p_msg);
   } else /* Error occured, send reject response */
   {
     BTIF_TRACE_ERROR("%s: Error status: 0x%02X. Sending reject rsp", __func__,
-                     avrc_rsp.rsp.status);
+                     p_rsp->rsp.status);
+    osi_free(p_msg);
     send_reject_response(p_dev->rc_handle, p_dev->rc_pdu_info[rsp_index].label[front_index],
-        avrc_rsp.pdu, avrc_rsp.get_items.status, avrc_rsp.get_items.opcode);
+        p_rsp->pdu, p_rsp->get_items.status, p_rsp->get_items.opcode);
   }
 
   TXN_LABEL_DEQUEUE(p_dev->rc_pdu_info[rsp_index].label, p_dev->rc_pdu_info[rsp_index].front,
@@ -3399,8 +3682,204 @@ static bt_status_t get_folder_items_list_rsp(RawAddress* bd_addr,
   p_dev->rc_pdu_info[rsp_index].label[front_index] = 0;
   if (p_dev->rc_pdu_info[rsp_index].size == 0)
     p_dev->rc_pdu_info[rsp_index].is_rsp_pending = false;
+}
 
-  return status == AVRC_STS_NO_ERROR ? BT_STATUS_SUCCESS : BT_STATUS_FAIL;
+/***************************************************************************
+ *
+ * Function         folder_item_keep
+ *
+ * Description      Copies |src| into |dst|, with the strings it points to.
+ *
+ * Returns          void
+ *
+ **************************************************************************/
+static void folder_item_keep(const tAVRC_ITEM& src,
+                             btif_rc_folder_item_t* dst) {
+  const tAVRC_FULL_NAME* name;
+
+  dst->item = src;
+  switch (src.item_type) {
+    case AVRC_ITEM_PLAYER:
+      name = &src.u.player.name;
+      break;
+    case AVRC_ITEM_FOLDER:
+      name = &src.u.folder.name;
+      break;
+    default:
+      name = &src.u.media.name;
+      for (uint8_t i = 0; i < src.u.media.attr_count; i++) {
+        const tAVRC_ATTR_ENTRY& attr = src.u.media.p_attr_list[i];
+        dst->attrs.push_back(attr);
+        dst->attr_values.emplace_back((char*)attr.name.p_str,
+                                      attr.name.str_len);
+      }
+      break;
+  }
+  dst->name.assign((char*)name->p_str, name->str_len);
+}
+
+/***************************************************************************
+ *
+ * Function         folder_item_get
+ *
+ * Description      Points the item kept in |kept| at its own strings.
+ *
+ * Returns          The item, valid as long as |kept| is not changed
+ *
+ **************************************************************************/
+static tAVRC_ITEM* folder_item_get(btif_rc_folder_item_t* kept) {
+  tAVRC_ITEM* p_item = &kept->item;
+  tAVRC_FULL_NAME* name;
+
+  switch (p_item->item_type) {
+    case AVRC_ITEM_PLAYER:
+      name = &p_item->u.player.name;
+      break;
+    case AVRC_ITEM_FOLDER:
+      name = &p_item->u.folder.name;
+      break;
+    default:
+      name = &p_item->u.media.name;
+      for (size_t i = 0; i < kept->attrs.size(); i++)
+        kept->attrs[i].name.p_str = (uint8_t*)kept->attr_values[i].data();
+      p_item->u.media.p_attr_list = kept->attrs.empty() ? NULL
+                                                        : kept->attrs.data();
+      break;
+  }
+  name->p_str = (uint8_t*)kept->name.data();
+  return p_item;
+}
+
+/***************************************************************************
+ *
+ * Function         browse_cursor_save
+ *
+ * Description      Keeps the items of |p_items| from |sent_items| on, that
+ *                  did not fit the response to the GetFolderItems of |p_dev|.
+ *                  Nothing is kept when more than one request is pending, as
+ *                  the items could not be told apart.
+ *
+ * Returns          void
+ *
+ **************************************************************************/
+static void browse_cursor_save(btif_rc_device_cb_t* p_dev,
+                               uint16_t uid_counter, int sent_items,
+                               uint16_t num_items,
+                               btrc_folder_items_t* p_items) {
+  tAVRC_ITEM item;
+  tAVRC_ATTR_ENTRY attr_vals[BTRC_MAX_ELEM_ATTR_SIZE];
+
+  std::lock_guard<std::mutex> lock(browse_cursor_lock);
+  auto cursor = browse_cursors.find(p_dev->rc_addr);
+  if (cursor == browse_cursors.end()) return;
+  if (p_dev->rc_pdu_info[IDX_GET_FOLDER_ITEMS_RSP].size != 1) {
+    browse_cursors.erase(cursor);
+    return;
+  }
+
+  btif_rc_browse_cursor_t& c = cursor->second;
+  c.start_item += sent_items;
+  c.uid_counter = uid_counter;
+  c.items.clear();
+  for (int i = sent_items;
+       i < num_items && c.items.size() < BTIF_RC_BROWSE_CURSOR_MAX_ITEMS; i++) {
+    if (fill_avrc_folder_item(&p_items[i], &item, attr_vals) !=
+        AVRC_STS_NO_ERROR)
+      break;
+    c.items.emplace_back();
+    folder_item_keep(item, &c.items.back());
+  }
+  BTIF_TRACE_DEBUG("%s: %zu item(s) kept from %u", __func__, c.items.size(),
+                   c.start_item);
+}
+
+/***************************************************************************
+ *
+ * Function         browse_cursor_drop
+ *
+ * Description      Drops the items kept for |bd_addr|, or for every device
+ *                  if |bd_addr| is NULL.
+ *
+ * Returns          void
+ *
+ **************************************************************************/
+static void browse_cursor_drop(const RawAddress* bd_addr) {
+  std::lock_guard<std::mutex> lock(browse_cursor_lock);
+  if (bd_addr == NULL)
+    browse_cursors.clear();
+  else
+    browse_cursors.erase(*bd_addr);
+}
+
+/***************************************************************************
+ *
+ * Function         get_folder_items_cached_rsp
+ *
+ * Description      Answers the pending GetFolderItems of |p_dev| from the
+ *                  items kept for it, if it asks for the same scope and
+ *                  attributes from the first item kept. Otherwise the
+ *                  request is remembered, for the app's response to be kept.
+ *
+ * Returns          BT_STATUS_SUCCESS if answered, the app is asked otherwise
+ *
+ **************************************************************************/
+static bt_status_t get_folder_items_cached_rsp(btif_rc_device_cb_t* p_dev,
+                                               tAVRC_GET_ITEMS_CMD* p_cmd,
+                                               uint8_t num_attr,
+                                               uint32_t* p_attr_ids) {
+  tAVRC_RESPONSE avrc_rsp;
+  BT_HDR* p_msg = NULL;
+  std::vector<uint32_t> attr_ids;
+  uint32_t sent = 0;
+
+  if (num_attr != 0xFF && num_attr != 0x00)
+    attr_ids.assign(p_attr_ids, p_attr_ids + num_attr);
+
+  std::lock_guard<std::mutex> lock(browse_cursor_lock);
+  btif_rc_browse_cursor_t& c = browse_cursors[p_dev->rc_addr];
+  if (c.items.empty() || c.scope != p_cmd->scope ||
+      c.start_item != p_cmd->start_item || c.num_attr != num_attr ||
+      c.attr_ids != attr_ids || p_cmd->end_item < p_cmd->start_item) {
+    c.scope = p_cmd->scope;
+    c.start_item = p_cmd->start_item;
+    c.num_attr = num_attr;
+    c.attr_ids = attr_ids;
+    c.items.clear();
+    return BT_STATUS_FAIL;
+  }
+
+  memset(&avrc_rsp, 0, sizeof(tAVRC_RESPONSE));
+  avrc_rsp.get_items.pdu = AVRC_PDU_GET_FOLDER_ITEMS;
+  avrc_rsp.get_items.opcode = opcode_from_pdu(AVRC_PDU_GET_FOLDER_ITEMS);
+  avrc_rsp.get_items.uid_counter = c.uid_counter;
+  avrc_rsp.get_items.item_count = 1;
+
+  /* as many items as asked for and fit the browsing MTU */
+  while (sent < c.items.size() && sent <= p_cmd->end_item - p_cmd->start_item) {
+    avrc_rsp.get_items.p_item_list = folder_item_get(&c.items[sent]);
+    int len_before = p_msg ? p_msg->len : 0;
+    avrc_rsp.get_items.status =
+        AVRC_BldResponse(p_dev->rc_handle, &avrc_rsp, &p_msg);
+    if (avrc_rsp.get_items.status != AVRC_STS_NO_ERROR ||
+        len_before == p_msg->len)
+      break;
+    sent++;
+  }
+
+  if (sent == 0) {
+    osi_free(p_msg);
+    c.items.clear();
+    return BT_STATUS_FAIL;
+  }
+
+  BTIF_TRACE_DEBUG("%s: %u item(s) from %u answered from the cursor", __func__,
+                   sent, c.start_item);
+  avrc_rsp.get_items.status = AVRC_STS_NO_ERROR;
+  c.items.erase(c.items.begin(), c.items.begin() + sent);
+  c.start_item += sent;
+  send_folder_items_rsp(p_dev, &avrc_rsp, p_msg);
+
+  return BT_STATUS_SUCCESS;
 }
 
 /***************************************************************************
@@ -3817,7 +4296,6 @@ static bt_status_t get_total_num_of_items_rsp(RawAddress* bd_addr,
 static bt_status_t set_volume_sho_mcast(uint8_t volume, RawAddress* bd_addr) {
   BTIF_TRACE_DEBUG("%s: volume: %d", __func__, volume);
   tAVRC_STS status = BT_STATUS_UNSUPPORTED;
-  rc_transaction_t* p_transaction = NULL;
 
   int idx = btif_rc_get_idx_by_bda(bd_addr);
   if (idx == -1) {
@@ -3825,7 +4303,8 @@ static bt_status_t set_volume_sho_mcast(uint8_t volume, RawAddress* bd_addr) {
     return (bt_status_t)BT_STATUS_FAIL;
   }
 
-  if (btif_rc_cb.rc_multi_cb[idx].rc_volume == volume) {
+  if (btif_rc_cb.rc_multi_cb[idx].rc_volume == volume &&
+      !btif_rc_cb.rc_multi_cb[idx].rc_abs_vol_in_flight) {
     status = BT_STATUS_DONE;
     BTIF_TRACE_ERROR("%s: volume value already set earlier: 0x%02x", __func__,
                      volume);
@@ -3848,38 +4327,7 @@ static bt_status_t set_volume_sho_mcast(uint8_t volume, RawAddress* bd_addr) {
   BTIF_TRACE_DEBUG("%s: Peer supports absolute volume. newVolume: %d",
           __func__, volume);
 
-  status = BT_STATUS_FAIL;
-  tAVRC_COMMAND avrc_cmd = {0};
-  BT_HDR* p_msg = NULL;
-  avrc_cmd.volume.opcode = AVRC_OP_VENDOR;
-  avrc_cmd.volume.pdu = AVRC_PDU_SET_ABSOLUTE_VOLUME;
-  avrc_cmd.volume.status = AVRC_STS_NO_ERROR;
-  avrc_cmd.volume.volume = volume;
-
-  if (AVRC_BldCommand(&avrc_cmd, &p_msg) == AVRC_STS_NO_ERROR) {
-    bt_status_t tran_status = get_transaction(&p_transaction, idx);
-
-    if (BT_STATUS_SUCCESS == tran_status && NULL != p_transaction) {
-      BTIF_TRACE_DEBUG("%s: msgreq being sent out with label: %d",
-                       __func__, p_transaction->lbl);
-      BTA_AvMetaCmd(btif_rc_cb.rc_multi_cb[idx].rc_handle,
-                    p_transaction->lbl, AVRC_CMD_CTRL, p_msg);
-      status = BT_STATUS_SUCCESS;
-    } else {
-      osi_free_and_reset((void**)&p_msg);
-      BTIF_TRACE_ERROR(
-          "%s: failed to obtain transaction details. status: 0x%02x",
-          __func__, tran_status);
-      status = BT_STATUS_FAIL;
-    }
-  } else {
-    BTIF_TRACE_ERROR(
-        "%s: failed to build absolute volume command. status: 0x%02x",
-        __func__, status);
-    status = BT_STATUS_FAIL;
-  }
-
-  return (bt_status_t)status;
+  return send_abs_volume_cmd(idx, volume);
 }
 
 /***************************************************************************
@@ -3904,7 +4352,6 @@ static bt_status_t set_volume(uint8_t volume, RawAddress*bd_addr) {
   }
 
   tAVRC_STS status = BT_STATUS_UNSUPPORTED;
-  rc_transaction_t* p_transaction = NULL;
 
   for (int idx = 0; idx < btif_max_rc_clients; idx++) {
     if (!btif_rc_cb.rc_multi_cb[idx].rc_connected) {
@@ -3914,53 +4361,24 @@ static bt_status_t set_volume(uint8_t volume, RawAddress*bd_addr) {
       continue;
     }
 
-    if (btif_rc_cb.rc_multi_cb[idx].rc_volume == volume) {
+    if (btif_rc_cb.rc_multi_cb[idx].rc_volume == volume &&
+        !btif_rc_cb.rc_multi_cb[idx].rc_abs_vol_in_flight) {
       status = BT_STATUS_DONE;
       BTIF_TRACE_ERROR("%s: volume value already set earlier: 0x%02x", __func__,
                        volume);
       continue;
     }
 
-    if ((btif_rc_cb.rc_multi_cb[idx].rc_volume != volume) &&
-        btif_rc_cb.rc_multi_cb[idx].rc_state ==
+    if (btif_rc_cb.rc_multi_cb[idx].rc_state ==
             BTRC_CONNECTION_STATE_CONNECTED) {
       if ((btif_rc_cb.rc_multi_cb[idx].rc_features & BTA_AV_FEAT_RCTG) == 0) {
         status = BT_STATUS_NOT_READY;
         continue;
       } else {
-        tAVRC_COMMAND avrc_cmd = {0};
-        BT_HDR* p_msg = NULL;
-
         if (btif_rc_cb.rc_multi_cb[idx].rc_features & BTA_AV_FEAT_ADV_CTRL) {
           BTIF_TRACE_DEBUG("%s: Peer supports absolute volume. newVolume: %d",
                            __func__, volume);
-          avrc_cmd.volume.opcode = AVRC_OP_VENDOR;
-          avrc_cmd.volume.pdu = AVRC_PDU_SET_ABSOLUTE_VOLUME;
-          avrc_cmd.volume.status = AVRC_STS_NO_ERROR;
-          avrc_cmd.volume.volume = volume;
-
-          if (AVRC_BldCommand(&avrc_cmd, &p_msg) == AVRC_STS_NO_ERROR) {
-            bt_status_t tran_status = get_transaction(&p_transaction, idx);
-
-            if (BT_STATUS_SUCCESS == tran_status && NULL != p_transaction) {
-              BTIF_TRACE_DEBUG("%s: msgreq being sent out with label: %d",
-                               __func__, p_transaction->lbl);
-              BTA_AvMetaCmd(btif_rc_cb.rc_multi_cb[idx].rc_handle,
-                            p_transaction->lbl, AVRC_CMD_CTRL, p_msg);
-              status = BT_STATUS_SUCCESS;
-            } else {
-              osi_free_and_reset((void**)&p_msg);
-              BTIF_TRACE_ERROR(
-                  "%s: failed to obtain transaction details. status: 0x%02x",
-                  __func__, tran_status);
-              status = BT_STATUS_FAIL;
-            }
-          } else {
-            BTIF_TRACE_ERROR(
-                "%s: failed to build absolute volume command. status: 0x%02x",
-                __func__, status);
-            status = BT_STATUS_FAIL;
-          }
+          status = send_abs_volume_cmd(idx, volume);
         }
       }
     }
@@ -3968,6 +4386,88 @@ static bt_status_t set_volume(uint8_t volume, RawAddress*bd_addr) {
   return (bt_status_t)status;
 }
 
+/***************************************************************************
+ *
+ * Function         send_abs_volume_cmd
+ *
+ * Description      Send SetAbsoluteVolume to the device at |idx|. While the
+ *                  previous one is unanswered, |volume| is only kept, to be
+ *                  sent with the response instead of the volumes set before.
+ *
+ * Returns          bt_status_t
+ *
+ **************************************************************************/
+static bt_status_t send_abs_volume_cmd(int idx, uint8_t volume) {
+  btif_rc_device_cb_t* p_dev = &btif_rc_cb.rc_multi_cb[idx];
+  rc_transaction_t* p_transaction = NULL;
+  tAVRC_COMMAND avrc_cmd = {0};
+  BT_HDR* p_msg = NULL;
+  tAVRC_STS status;
+
+  if (p_dev->rc_abs_vol_in_flight &&
+      time_get_os_boottime_ms() - p_dev->rc_abs_vol_sent_ms <
+          BTIF_RC_ABS_VOL_RSP_TIMEOUT_MS) {
+    BTIF_TRACE_DEBUG("%s: volume 0x%02x waits for label %d", __func__, volume,
+                     p_dev->rc_abs_vol_label);
+    p_dev->rc_abs_vol_pending = true;
+    p_dev->rc_abs_vol_next = volume;
+    return BT_STATUS_SUCCESS;
+  }
+
+  avrc_cmd.volume.opcode = AVRC_OP_VENDOR;
+  avrc_cmd.volume.pdu = AVRC_PDU_SET_ABSOLUTE_VOLUME;
+  avrc_cmd.volume.status = AVRC_STS_NO_ERROR;
+  avrc_cmd.volume.volume = volume;
+
+  status = AVRC_BldCommand(&avrc_cmd, &p_msg);
+  if (status != AVRC_STS_NO_ERROR) {
+    BTIF_TRACE_ERROR(
+        "%s: failed to build absolute volume command. status: 0x%02x",
+        __func__, status);
+    return BT_STATUS_FAIL;
+  }
+
+  bt_status_t tran_status = get_transaction(&p_transaction, idx);
+  if (BT_STATUS_SUCCESS != tran_status || NULL == p_transaction) {
+    osi_free_and_reset((void**)&p_msg);
+    BTIF_TRACE_ERROR("%s: failed to obtain transaction details. status: 0x%02x",
+                     __func__, tran_status);
+    return BT_STATUS_FAIL;
+  }
+
+  BTIF_TRACE_DEBUG("%s: msgreq being sent out with label: %d", __func__,
+                   p_transaction->lbl);
+  BTA_AvMetaCmd(p_dev->rc_handle, p_transaction->lbl, AVRC_CMD_CTRL, p_msg);
+  p_dev->rc_abs_vol_in_flight = true;
+  p_dev->rc_abs_vol_label = p_transaction->lbl;
+  p_dev->rc_abs_vol_sent_ms = time_get_os_boottime_ms();
+  p_dev->rc_abs_vol_pending = false;
+  return BT_STATUS_SUCCESS;
+}
+
+/***************************************************************************
+ *
+ * Function         abs_volume_cmd_done
+ *
+ * Description      The SetAbsoluteVolume with |label| was answered by the
+ *                  device at |idx|. Sends the volume kept meanwhile, if any.
+ *
+ * Returns          void
+ *
+ **************************************************************************/
+static void abs_volume_cmd_done(int idx, uint8_t label) {
+  btif_rc_device_cb_t* p_dev = &btif_rc_cb.rc_multi_cb[idx];
+
+  if (!p_dev->rc_abs_vol_in_flight || p_dev->rc_abs_vol_label != label)
+    return;
+
+  p_dev->rc_abs_vol_in_flight = false;
+  if (p_dev->rc_abs_vol_pending) {
+    p_dev->rc_abs_vol_pending = false;
+    send_abs_volume_cmd(idx, p_dev->rc_abs_vol_next);
+  }
+}
+
 /***************************************************************************
  *
  * Function         register_volumechange
@@ -4062,6 +4562,7 @@ static void handle_rc_metamsg_rsp(tBTA_AV_META_MSG* pmeta_msg,
         release_transaction(p_dev->rc_vol_label, idx);
       } else if (AVRC_PDU_SET_ABSOLUTE_VOLUME == avrc_response.rsp.pdu) {
         release_transaction(pmeta_msg->label, idx);
+        abs_volume_cmd_done(idx, pmeta_msg->label);
       }
       return;
     }
@@ -4092,6 +4593,7 @@ static void handle_rc_metamsg_rsp(tBTA_AV_META_MSG* pmeta_msg,
   } else if (AVRC_PDU_SET_ABSOLUTE_VOLUME == avrc_response.rsp.pdu) {
     /* free up the label here */
     release_transaction(pmeta_msg->label, idx);
+    abs_volume_cmd_done(idx, pmeta_msg->label);
   }
 
   BTIF_TRACE_EVENT("%s: Passing received metamsg response to app. pdu: %s",
@@ -7069,10 +7571,11 @@ static bool is_peer_avrcp_only_device(RawAddress bd_addr) {
   return (!a2dp_supported && avrcp_supported);
 }
 
+OSI_CACHED_PROPERTY(disable_abs_vol_property, "persist.bluetooth.disableabsvol",
+                    false);
+
 static bool absolute_volume_disabled() {
-  char volume_disabled[PROPERTY_VALUE_MAX] = {0};
-  osi_property_get("persist.bluetooth.disableabsvol", volume_disabled, "false");
-  if (strncmp(volume_disabled, "true", 4) == 0) {
+  if (osi_cached_property_get_bool(&disable_abs_vol_property)) {
     BTIF_TRACE_WARNING("%s: Absolute volume disabled by property", __func__);
     return true;
   }
@@ -31,6 +31,7 @@
 #include <hardware/bt_sock.h>
 
 #include "osi/include/allocator.h"
+#include "osi/include/list.h"
 #include "osi/include/log.h"
 
 #include "bt_common.h"
@@ -54,11 +55,8 @@
 #include "port_api.h"
 #include "sdp_api.h"
 
-struct packet {
-  struct packet *next, *prev;
-  uint32_t len;
-  uint8_t* data;
-};
+// Maximum number of incoming packets sent to the app with one sendmmsg.
+#define L2CAP_SEND_TO_APP_MAX_BUFS 16
 
 typedef struct l2cap_socket {
   struct l2cap_socket* prev;  // link to prev list item
@@ -67,6 +65,8 @@ typedef struct l2cap_socket {
   char name[256];             // user-friendly name of the service
   uint32_t id;                // just a tag to find this struct
   int app_uid;                // The UID of the app who requested this socket
+  // Traffic of app_uid, created on first use
+  uid_set_counter_t* traffic;
   int handle;                 // handle from lower layers
   unsigned security;          // security flags
   int channel;                // channel (fixed_chan) or PSM (!fixed_chan)
@@ -74,8 +74,7 @@ typedef struct l2cap_socket {
   int app_fd;                 // fd from app's side
 
   unsigned bytes_buffered;
-  struct packet* first_packet;  // fist packet to be delivered to app
-  struct packet* last_packet;   // last packet to be delivered to app
+  list_t* incoming_queue;  // BT_HDRs to be delivered to app, one per message
 
   unsigned fixed_chan : 1;        // fixed channel (or psm?)
   unsigned server : 1;            // is a server? (or connecting?)
@@ -87,6 +86,7 @@ typedef struct l2cap_socket {
 } l2cap_socket;
 
 static bt_status_t btSock_start_l2cap_server_l(l2cap_socket* sock);
+static uid_set_counter_t* btsock_l2cap_traffic_l(l2cap_socket* sock);
 
 static std::mutex state_lock;
 
@@ -112,89 +112,16 @@ static void btsock_l2cap_cbk(tBTA_JV_EVT event, tBTA_JV* p_data,
  * wait
  *       confirming the l2cap_ind until we have more space in the buffer. */
 
-/* returns false if none - caller must free "data" memory when done with it */
-static char packet_get_head_l(l2cap_socket* sock, uint8_t** data,
-                              uint32_t* len) {
-  struct packet* p = sock->first_packet;
-
-  if (!p) return false;
-
-  if (data) *data = sock->first_packet->data;
-  if (len) *len = sock->first_packet->len;
-  sock->first_packet = p->next;
-  if (sock->first_packet)
-    sock->first_packet->prev = NULL;
-  else
-    sock->last_packet = NULL;
-
-  if (len) sock->bytes_buffered -= *len;
-
-  osi_free(p);
-
-  return true;
-}
-
-static struct packet* packet_alloc(const uint8_t* data, uint32_t len) {
-  struct packet* p = (struct packet*)osi_calloc(sizeof(*p));
-  uint8_t* buf = (uint8_t*)osi_malloc(len);
-
-  p->data = buf;
-  p->len = len;
-  memcpy(p->data, data, len);
-  return p;
-}
-
-/* makes a copy of the data, returns true on success */
-static char packet_put_head_l(l2cap_socket* sock, const void* data,
-                              uint32_t len) {
-  struct packet* p = packet_alloc((const uint8_t*)data, len);
-
-  /*
-   * We do not check size limits here since this is used to undo "getting" a
-   * packet that the user read incompletely. That is to say the packet was
-   * already in the queue. We do check thos elimits in packet_put_tail_l() since
-   * that function is used to put new data into the queue.
-   */
-
-  if (!p) return false;
-
-  p->prev = NULL;
-  p->next = sock->first_packet;
-  sock->first_packet = p;
-  if (p->next)
-    p->next->prev = p;
-  else
-    sock->last_packet = p;
-
-  sock->bytes_buffered += len;
-
-  return true;
-}
-
-/* makes a copy of the data, returns true on success */
-static char packet_put_tail_l(l2cap_socket* sock, const void* data,
-                              uint32_t len) {
-  struct packet* p = packet_alloc((const uint8_t*)data, len);
-
+/* takes the ownership of p_buf, returns true on success */
+static bool packet_put_tail_l(l2cap_socket* sock, BT_HDR* p_buf) {
   if (sock->bytes_buffered >= L2CAP_MAX_RX_BUFFER) {
     LOG_ERROR(LOG_TAG, "packet_put_tail_l: buffer overflow");
+    osi_free(p_buf);
     return false;
   }
 
-  if (!p) {
-    LOG_ERROR(LOG_TAG, "packet_put_tail_l: unable to allocate packet...");
-    return false;
-  }
-
-  p->next = NULL;
-  p->prev = sock->last_packet;
-  sock->last_packet = p;
-  if (p->prev)
-    p->prev->next = p;
-  else
-    sock->first_packet = p;
-
-  sock->bytes_buffered += len;
+  list_append(sock->incoming_queue, p_buf);
+  sock->bytes_buffered += p_buf->len;
 
   return true;
 }
@@ -214,7 +141,6 @@ static l2cap_socket* btsock_l2cap_find_by_id_l(uint32_t id) {
 }
 
 static void btsock_l2cap_free_l(l2cap_socket* sock) {
-  uint8_t* buf;
   l2cap_socket* t = socks;
 
   while (t && t != sock) t = t->next;
@@ -237,7 +163,8 @@ static void btsock_l2cap_free_l(l2cap_socket* sock) {
     APPL_TRACE_ERROR("SOCK_LIST: free(id = %d) - NO app_fd!", sock->id);
   }
 
-  while (packet_get_head_l(sock, &buf, NULL)) osi_free(buf);
+  list_free(sock->incoming_queue);
+  uid_set_counter_release(sock->traffic);
 
   APPL_TRACE_DEBUG("%s: fixed_chan=%d, channel=%d is_le_soc=%d handle=%d sock_id:%d is_server=%d",
                      __func__, sock->fixed_chan, sock->channel, sock->is_le_coc, sock->handle,
@@ -282,6 +209,14 @@ static void btsock_l2cap_free_l(l2cap_socket* sock) {
   osi_free(sock);
 }
 
+// Returns the traffic counter of |sock|, created on its first traffic so that
+// the socket data path does not take the lock of the UID set.
+static uid_set_counter_t* btsock_l2cap_traffic_l(l2cap_socket* sock) {
+  if (sock->traffic == NULL)
+    sock->traffic = uid_set_counter_create(uid_set, sock->app_uid);
+  return sock->traffic;
+}
+
 static l2cap_socket* btsock_l2cap_alloc_l(const char* name,
                                           const RawAddress* addr,
                                           char is_server, int flags) {
@@ -315,8 +250,7 @@ static l2cap_socket* btsock_l2cap_alloc_l(const char* name,
   if (name) strncpy(sock->name, name, sizeof(sock->name) - 1);
   if (addr) sock->addr = *addr;
 
-  sock->first_packet = NULL;
-  sock->last_packet = NULL;
+  sock->incoming_queue = list_new(osi_free);
 
   sock->mps = L2CAP_LE_MIN_MPS;
 
@@ -648,13 +582,10 @@ static void on_l2cap_write_done(void* req_id, uint16_t len, uint32_t id) {
     osi_free(req_id);  // free the buffer
   }
 
-  int app_uid = -1;
-
   std::unique_lock<std::mutex> lock(state_lock);
   sock = btsock_l2cap_find_by_id_l(id);
   if (!sock) return;
 
-  app_uid = sock->app_uid;
   if (!sock->outgoing_congest) {
     // monitor the fd for any outgoing data
     APPL_TRACE_DEBUG("on_l2cap_write_done: adding fd to btsock_thread...");
@@ -662,7 +593,7 @@ static void on_l2cap_write_done(void* req_id, uint16_t len, uint32_t id) {
                          sock->id);
   }
 
-  uid_set_add_tx(uid_set, app_uid, len);
+  uid_set_counter_add_tx(btsock_l2cap_traffic_l(sock), len);
 }
 
 static void on_l2cap_write_fixed_done(void* req_id, uint16_t len, uint32_t id) {
@@ -672,18 +603,16 @@ static void on_l2cap_write_fixed_done(void* req_id, uint16_t len, uint32_t id) {
     osi_free(req_id);  // free the buffer
   }
 
-  int app_uid = -1;
   std::unique_lock<std::mutex> lock(state_lock);
   sock = btsock_l2cap_find_by_id_l(id);
   if (!sock) return;
 
-  app_uid = sock->app_uid;
   if (!sock->outgoing_congest) {
     // monitor the fd for any outgoing data
     btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP, SOCK_THREAD_FD_RD,
                          sock->id);
   }
-  uid_set_add_tx(uid_set, app_uid, len);
+  uid_set_counter_add_tx(btsock_l2cap_traffic_l(sock), len);
 }
 
 static void on_l2cap_write_fail(void* req_id, uint16_t len, uint32_t id) {
@@ -694,40 +623,35 @@ static void on_l2cap_write_fail(void* req_id, uint16_t len, uint32_t id) {
     osi_free(req_id);  // free the buffer
   }
 
-  int app_uid = -1;
   sock = btsock_l2cap_find_by_id_l(id);
   if (!sock) return;
 
-  app_uid = sock->app_uid;
   if (!sock->outgoing_congest) {
     // monitor the fd for any outgoing data
     APPL_TRACE_DEBUG("on_l2cap_write_fail: adding fd to btsock_thread...");
     btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP, SOCK_THREAD_FD_RD,
                          sock->id);
   }
-  uid_set_add_tx(uid_set, app_uid, len);
+  uid_set_counter_add_tx(btsock_l2cap_traffic_l(sock), len);
 }
 
 static void on_l2cap_data_ind(tBTA_JV* evt, uint32_t id) {
   l2cap_socket* sock;
 
-  int app_uid = -1;
   uint32_t bytes_read = 0;
 
   std::unique_lock<std::mutex> lock(state_lock);
   sock = btsock_l2cap_find_by_id_l(id);
   if (!sock) return;
 
-  app_uid = sock->app_uid;
-
   if (sock->fixed_chan) { /* we do these differently */
 
-    tBTA_JV_LE_DATA_IND* p_le_data_ind = &evt->le_data_ind;
-    BT_HDR* p_buf = p_le_data_ind->p_buf;
-    uint8_t* data = (uint8_t*)(p_buf + 1) + p_buf->offset;
+    /* The buffer is queued as is, the socket owns it from now on */
+    BT_HDR* p_buf = evt->le_data_ind.p_buf;
+    uint16_t len = p_buf->len;
 
-    if (packet_put_tail_l(sock, data, p_buf->len)) {
-      bytes_read = p_buf->len;
+    if (packet_put_tail_l(sock, p_buf)) {
+      bytes_read = len;
       btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP, SOCK_THREAD_FD_WR,
                            sock->id);
     } else {  // connection must be dropped
@@ -740,13 +664,18 @@ static void on_l2cap_data_ind(tBTA_JV* evt, uint32_t id) {
     }
 
   } else {
-    uint8_t buffer[L2CAP_MAX_SDU_LENGTH];
     uint32_t count;
 
     if (BTA_JvL2capReady(sock->handle, &count) == BTA_JV_SUCCESS) {
-      if (BTA_JvL2capRead(sock->handle, sock->id, buffer, count) ==
-          BTA_JV_SUCCESS) {
-        if (packet_put_tail_l(sock, buffer, count)) {
+      /* Read straight into the buffer queued for the app */
+      BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_HDR_SIZE + count);
+      p_buf->offset = 0;
+      p_buf->len = count;
+      if (BTA_JvL2capRead(sock->handle, sock->id, (uint8_t*)(p_buf + 1),
+                          count) != BTA_JV_SUCCESS) {
+        osi_free(p_buf);
+      } else {
+        if (packet_put_tail_l(sock, p_buf)) {
           bytes_read = count;
           btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP,
                                SOCK_THREAD_FD_WR, sock->id);
@@ -762,7 +691,7 @@ static void on_l2cap_data_ind(tBTA_JV* evt, uint32_t id) {
     }
   }
 
-  uid_set_add_rx(uid_set, app_uid, bytes_read);
+  uid_set_counter_add_rx(btsock_l2cap_traffic_l(sock), bytes_read);
 }
 
 static void btsock_l2cap_cbk(tBTA_JV_EVT event, tBTA_JV* p_data,
@@ -1018,26 +947,43 @@ bt_status_t btsock_l2cap_connect(const RawAddress* bd_addr, int channel,
  * (for example: unrecoverable error or no data)
  */
 static bool flush_incoming_que_on_wr_signal_l(l2cap_socket* sock) {
-  uint8_t* buf;
-  uint32_t len;
-
-  while (packet_get_head_l(sock, &buf, &len)) {
-    ssize_t sent;
-    OSI_NO_INTR(sent = send(sock->our_fd, buf, len, MSG_DONTWAIT));
-    int saved_errno = errno;
-
-    if (sent == (signed)len)
-      osi_free(buf);
-    else if (sent >= 0) {
-      packet_put_head_l(sock, buf + sent, len - sent);
-      osi_free(buf);
-      if (!sent) /* special case if other end not keeping up */
-        return true;
-    } else {
-      packet_put_head_l(sock, buf, len);
-      osi_free(buf);
-      return saved_errno == EWOULDBLOCK || saved_errno == EAGAIN;
+  while (!list_is_empty(sock->incoming_queue)) {
+    /* The socket is created with SOCK_SEQPACKET, every queued packet is sent
+     * as one message, a batch of them per system call. */
+    struct mmsghdr msgs[L2CAP_SEND_TO_APP_MAX_BUFS];
+    struct iovec iov[L2CAP_SEND_TO_APP_MAX_BUFS];
+    unsigned int count = 0;
+    for (const list_node_t* node = list_begin(sock->incoming_queue);
+         node != list_end(sock->incoming_queue) &&
+         count < L2CAP_SEND_TO_APP_MAX_BUFS;
+         node = list_next(node)) {
+      BT_HDR* p_buf = (BT_HDR*)list_node(node);
+      iov[count].iov_base = (uint8_t*)(p_buf + 1) + p_buf->offset;
+      iov[count].iov_len = p_buf->len;
+      memset(&msgs[count], 0, sizeof(msgs[count]));
+      msgs[count].msg_hdr.msg_iov = &iov[count];
+      msgs[count].msg_hdr.msg_iovlen = 1;
+      count++;
     }
+
+    int sent;
+    OSI_NO_INTR(sent = sendmmsg(sock->our_fd, msgs, count, MSG_DONTWAIT));
+    if (sent < 0) return errno == EWOULDBLOCK || errno == EAGAIN;
+
+    for (int i = 0; i < sent; i++) {
+      BT_HDR* p_buf = (BT_HDR*)list_front(sock->incoming_queue);
+      unsigned int len = msgs[i].msg_len;
+      sock->bytes_buffered -= len;
+      if (len < p_buf->len) {
+        p_buf->offset += len;
+        p_buf->len -= len;
+        return true; /* special case if other end not keeping up */
+      }
+      list_remove(sock->incoming_queue, p_buf);
+    }
+
+    /* the app socket is full */
+    if ((unsigned int)sent < count) return true;
   }
 
   return false;
@@ -26,6 +26,7 @@
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <mutex>
@@ -73,6 +74,9 @@ using bluetooth::Uuid;
 // Maximum number of devices we can have an RFCOMM connection with.
 #define MAX_RFC_SESSION 7
 
+// Maximum number of incoming buffers sent to the app with one sendmsg.
+#define RFC_SEND_TO_APP_MAX_BUFS 16
+
 typedef struct {
   int outgoing_congest : 1;
   int pending_sdp_request : 1;
@@ -96,6 +100,8 @@ typedef struct {
   int app_fd;   // Temporary storage for the half of the socketpair that's sent
                 // back to upper layers.
   int app_uid;  // UID of the app for which this socket was created.
+  // Traffic of app_uid, created on first use.
+  uid_set_counter_t* traffic;
   int mtu;
   uint8_t* packet;
   int sdp_handle;
@@ -113,6 +119,7 @@ static uid_set_t* uid_set = NULL;
 
 static rfc_slot_t* find_free_slot(void);
 static void cleanup_rfc_slot(rfc_slot_t* rs);
+static uid_set_counter_t* rfc_slot_traffic(rfc_slot_t* slot);
 static void jv_dm_cback(tBTA_JV_EVT event, tBTA_JV* p_data, uint32_t id);
 static uint32_t rfcomm_cback(tBTA_JV_EVT event, tBTA_JV* p_data,
                              uint32_t rfcomm_slot_id);
@@ -443,6 +450,8 @@ static void cleanup_rfc_slot(rfc_slot_t* slot) {
 
   free_rfc_slot_scn(slot);
   list_clear(slot->incoming_queue);
+  uid_set_counter_release(slot->traffic);
+  slot->traffic = NULL;
 
   slot->rfc_port_handle = 0;
   memset(&slot->f, 0, sizeof(slot->f));
@@ -450,6 +459,14 @@ static void cleanup_rfc_slot(rfc_slot_t* slot) {
   slot->scn_notified = false;
 }
 
+// Returns the traffic counter of |slot|, created on its first traffic so that
+// the socket data path does not take the lock of the UID set.
+static uid_set_counter_t* rfc_slot_traffic(rfc_slot_t* slot) {
+  if (slot->traffic == NULL)
+    slot->traffic = uid_set_counter_create(uid_set, slot->app_uid);
+  return slot->traffic;
+}
+
 static bool send_app_scn(rfc_slot_t* slot) {
   if (slot->scn_notified == true) {
     // already send, just return success.
@@ -562,19 +579,16 @@ static void on_rfc_write_done(tBTA_JV_RFCOMM_WRITE* p, uint32_t id) {
     return;
   }
 
-  int app_uid = -1;
   std::unique_lock<std::recursive_mutex> lock(slot_lock);
 
   rfc_slot_t* slot = find_rfc_slot_by_id(id);
   if (slot) {
-    app_uid = slot->app_uid;
     if (!slot->f.outgoing_congest) {
       btsock_thread_add_fd(pth, slot->fd, BTSOCK_RFCOMM, SOCK_THREAD_FD_RD,
                            slot->id);
     }
+    uid_set_counter_add_tx(rfc_slot_traffic(slot), p->len);
   }
-
-  uid_set_add_tx(uid_set, app_uid, p->len);
 }
 
 static void on_rfc_outgoing_congest(tBTA_JV_RFCOMM_CONG* p, uint32_t id) {
@@ -783,10 +797,58 @@ static sent_status_t send_data_to_app(int fd, BT_HDR* p_buf) {
   return SENT_PARTIAL;
 }
 
+// Sends the buffers at the front of the incoming queue with one sendmsg,
+// and frees the ones fully sent.
+// Returns SENT_ALL if all of the buffers tried were sent.
+static sent_status_t send_queue_to_app(rfc_slot_t* slot) {
+  struct iovec iov[RFC_SEND_TO_APP_MAX_BUFS];
+  int iovcnt = 0;
+  size_t size = 0;
+  for (const list_node_t* node = list_begin(slot->incoming_queue);
+       node != list_end(slot->incoming_queue) &&
+       iovcnt < RFC_SEND_TO_APP_MAX_BUFS;
+       node = list_next(node)) {
+    BT_HDR* p_buf = (BT_HDR*)list_node(node);
+    iov[iovcnt].iov_base = p_buf->data + p_buf->offset;
+    iov[iovcnt].iov_len = p_buf->len;
+    size += p_buf->len;
+    iovcnt++;
+  }
+
+  ssize_t sent = 0;
+  if (size > 0) {
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+    OSI_NO_INTR(sent = sendmsg(slot->fd, &msg, MSG_DONTWAIT));
+
+    if (sent == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return SENT_NONE;
+      LOG_ERROR(LOG_TAG, "%s error writing RFCOMM data back to app: %s",
+                __func__, strerror(errno));
+      return SENT_FAILED;
+    }
+
+    if (sent == 0) return SENT_FAILED;
+  }
+
+  // Free the buffers sent, and skip the part sent of the next one
+  for (int i = 0; i < iovcnt; i++) {
+    BT_HDR* p_buf = (BT_HDR*)list_front(slot->incoming_queue);
+    if ((size_t)sent < p_buf->len) {
+      p_buf->offset += sent;
+      p_buf->len -= sent;
+      return SENT_PARTIAL;
+    }
+    sent -= p_buf->len;
+    list_remove(slot->incoming_queue, p_buf);
+  }
+  return SENT_ALL;
+}
+
 static bool flush_incoming_que_on_wr_signal(rfc_slot_t* slot) {
   while (!list_is_empty(slot->incoming_queue)) {
-    BT_HDR* p_buf = (BT_HDR*)list_front(slot->incoming_queue);
-    switch (send_data_to_app(slot->fd, p_buf)) {
+    switch (send_queue_to_app(slot)) {
       case SENT_NONE:
       case SENT_PARTIAL:
         // monitor the fd to get callback when app is ready to receive data
@@ -795,11 +857,9 @@ static bool flush_incoming_que_on_wr_signal(rfc_slot_t* slot) {
         return true;
 
       case SENT_ALL:
-        list_remove(slot->incoming_queue, p_buf);
         break;
 
       case SENT_FAILED:
-        list_remove(slot->incoming_queue, p_buf);
         return false;
     }
   }
@@ -857,15 +917,13 @@ void btsock_rfc_signaled(UNUSED_ATTR int fd, int flags, uint32_t user_id) {
 }
 
 int bta_co_rfc_data_incoming(uint32_t id, BT_HDR* p_buf) {
-  int app_uid = -1;
-  uint64_t bytes_rx = 0;
   int ret = 0;
   std::unique_lock<std::recursive_mutex> lock(slot_lock);
   rfc_slot_t* slot = find_rfc_slot_by_id(id);
   if (!slot) return 0;
 
-  app_uid = slot->app_uid;
-  bytes_rx = p_buf->len;
+  // Counted before the slot may be cleaned up
+  uid_set_counter_add_rx(rfc_slot_traffic(slot), p_buf->len);
 
   if (list_is_empty(slot->incoming_queue)) {
     switch (send_data_to_app(slot->fd, p_buf)) {
@@ -890,8 +948,6 @@ int bta_co_rfc_data_incoming(uint32_t id, BT_HDR* p_buf) {
     list_append(slot->incoming_queue, p_buf);
   }
 
-  uid_set_add_rx(uid_set, app_uid, bytes_rx);
-
   return ret;  // Return 0 to disable data flow.
 }
 
@@ -930,6 +986,28 @@ int bta_co_rfc_data_outgoing(uint32_t id, uint8_t* buf, uint16_t size) {
   return true;
 }
 
+int bta_co_rfc_data_outgoing_vec(uint32_t id, const struct iovec* iov,
+                                 int iovcnt) {
+  std::unique_lock<std::recursive_mutex> lock(slot_lock);
+  rfc_slot_t* slot = find_rfc_slot_by_id(id);
+  if (!slot) return false;
+
+  size_t size = 0;
+  for (int i = 0; i < iovcnt; i++) size += iov[i].iov_len;
+
+  ssize_t received;
+  OSI_NO_INTR(received = readv(slot->fd, iov, iovcnt));
+
+  if (received < 0 || (size_t)received != size) {
+    LOG_ERROR(LOG_TAG, "%s error receiving RFCOMM data from app: %s", __func__,
+              strerror(errno));
+    cleanup_rfc_slot(slot);
+    return false;
+  }
+
+  return true;
+}
+
 static rfc_slot_t* find_rfc_slot_by_scn(int scn)
 {
     int i;
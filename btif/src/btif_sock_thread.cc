@@ -38,8 +38,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/poll.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/un.h>
@@ -66,10 +65,12 @@
 
 #define MAX_THREAD 8
 #define MAX_POLL 64
-#define POLL_EXCEPTION_EVENTS (POLLHUP | POLLRDHUP | POLLERR | POLLNVAL)
+#define POLL_EXCEPTION_EVENTS (EPOLLHUP | EPOLLRDHUP | EPOLLERR)
 #define IS_EXCEPTION(e) ((e)&POLL_EXCEPTION_EVENTS)
-#define IS_READ(e) ((e)&POLLIN)
-#define IS_WRITE(e) ((e)&POLLOUT)
+#define IS_READ(e) ((e)&EPOLLIN)
+#define IS_WRITE(e) ((e)&EPOLLOUT)
+// epoll data of the cmd fd, the data fds have their poll slot index
+#define CMD_FD_SLOT MAX_POLL
 /*cmd executes in socket poll thread */
 #define CMD_WAKEUP 1
 #define CMD_EXIT 2
@@ -78,16 +79,16 @@
 #define CMD_USER_PRIVATE 5
 
 typedef struct {
-  struct pollfd pfd;
+  int fd;
   uint32_t user_id;
   int type;
   int flags;
 } poll_slot_t;
 typedef struct {
   int cmd_fdr, cmd_fdw;
+  int epoll_fd;
   int poll_count;
   poll_slot_t ps[MAX_POLL];
-  int psi[MAX_POLL];  // index of poll slot
   pthread_t thread_id;
   btsock_signaled_cb callback;
   btsock_cmd_cb cmd_callback;
@@ -158,6 +159,7 @@ int btsock_thread_init() {
     int h;
     for (h = 0; h < MAX_THREAD; h++) {
       ts[h].cmd_fdr = ts[h].cmd_fdw = -1;
+      ts[h].epoll_fd = -1;
       ts[h].used = 0;
       ts[h].thread_id = -1;
       ts[h].poll_count = 0;
@@ -199,10 +201,26 @@ static inline void init_cmd_fd(int h) {
   }
   APPL_TRACE_DEBUG("h:%d, cmd_fdr:%d, cmd_fdw:%d", h, ts[h].cmd_fdr,
                    ts[h].cmd_fdw);
-  // add the cmd fd for read & write
-  add_poll(h, ts[h].cmd_fdr, 0, SOCK_THREAD_FD_RD, 0);
+  ts[h].epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (ts[h].epoll_fd == -1) {
+    APPL_TRACE_ERROR("epoll_create1 failed: %s", strerror(errno));
+    close_cmd_fd(h);
+    return;
+  }
+  // add the cmd fd for read
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u32 = CMD_FD_SLOT;
+  if (epoll_ctl(ts[h].epoll_fd, EPOLL_CTL_ADD, ts[h].cmd_fdr, &event) == -1) {
+    APPL_TRACE_ERROR("epoll_ctl cmd fd failed: %s", strerror(errno));
+    close_cmd_fd(h);
+  }
 }
 static inline void close_cmd_fd(int h) {
+  if (ts[h].epoll_fd != -1) {
+    close(ts[h].epoll_fd);
+    ts[h].epoll_fd = -1;
+  }
   if (ts[h].cmd_fdr != -1) {
     close(ts[h].cmd_fdr);
     ts[h].cmd_fdr = -1;
@@ -346,23 +364,33 @@ static void init_poll(int h) {
   ts[h].thread_id = -1;
   ts[h].callback = NULL;
   ts[h].cmd_callback = NULL;
-  for (i = 0; i < MAX_POLL; i++) {
-    ts[h].ps[i].pfd.fd = -1;
-    ts[h].psi[i] = -1;
-  }
+  memset(ts[h].ps, 0, sizeof(ts[h].ps));
+  for (i = 0; i < MAX_POLL; i++) ts[h].ps[i].fd = -1;
   init_cmd_fd(h);
 }
-static inline unsigned int flags2pevents(int flags) {
-  unsigned int pevents = 0;
-  if (flags & SOCK_THREAD_FD_WR) pevents |= POLLOUT;
-  if (flags & SOCK_THREAD_FD_RD) pevents |= POLLIN;
+static inline uint32_t flags2pevents(int flags) {
+  uint32_t pevents = 0;
+  if (flags & SOCK_THREAD_FD_WR) pevents |= EPOLLOUT;
+  if (flags & SOCK_THREAD_FD_RD) pevents |= EPOLLIN;
   pevents |= POLL_EXCEPTION_EVENTS;
   return pevents;
 }
 
+// Monitored events are one-shot: a signaled event is removed from the slot
+// until the fd is added again, so the registration stays level-triggered and
+// only changes when a slot does.
+static inline void update_epoll(int h, int op, int slot) {
+  struct epoll_event event = {};
+  event.events = flags2pevents(ts[h].ps[slot].flags);
+  event.data.u32 = slot;
+  if (epoll_ctl(ts[h].epoll_fd, op, ts[h].ps[slot].fd, &event) == -1)
+    APPL_TRACE_ERROR("epoll_ctl op:%d fd:%d failed: %s", op,
+                     ts[h].ps[slot].fd, strerror(errno));
+}
+
 static inline void set_poll(poll_slot_t* ps, int fd, int type, int flags,
                             uint32_t user_id) {
-  ps->pfd.fd = fd;
+  ps->fd = fd;
   ps->user_id = user_id;
   if (ps->type != 0 && ps->type != type)
     APPL_TRACE_ERROR(
@@ -370,8 +398,6 @@ static inline void set_poll(poll_slot_t* ps, int fd, int type, int flags,
         ps->type, type);
   ps->type = type;
   ps->flags = flags;
-  ps->pfd.events = flags2pevents(flags);
-  ps->pfd.revents = 0;
 }
 static inline void add_poll(int h, int fd, int type, int flags,
                             uint32_t user_id) {
@@ -381,33 +407,37 @@ static inline void add_poll(int h, int fd, int type, int flags,
   poll_slot_t* ps = ts[h].ps;
 
   for (i = 0; i < MAX_POLL; i++) {
-    if (ps[i].pfd.fd == fd) {
-      asrt(ts[h].poll_count < MAX_POLL);
-
+    if (ps[i].fd == fd) {
       set_poll(&ps[i], fd, type, flags | ps[i].flags, user_id);
+      update_epoll(h, EPOLL_CTL_MOD, i);
       return;
-    } else if (empty < 0 && ps[i].pfd.fd == -1)
+    } else if (empty < 0 && ps[i].fd == -1)
       empty = i;
   }
   if (empty >= 0) {
     asrt(ts[h].poll_count < MAX_POLL);
     set_poll(&ps[empty], fd, type, flags, user_id);
+    update_epoll(h, EPOLL_CTL_ADD, empty);
     ++ts[h].poll_count;
     return;
   }
   APPL_TRACE_ERROR("exceeded max poll slot:%d!", MAX_POLL);
 }
-static inline void remove_poll(int h, poll_slot_t* ps, int flags) {
+static inline void remove_poll(int h, int slot, int flags) {
+  poll_slot_t* ps = &ts[h].ps[slot];
   if (flags == ps->flags) {
     // all monitored events signaled. To remove it, just clear the slot
+    if (epoll_ctl(ts[h].epoll_fd, EPOLL_CTL_DEL, ps->fd, NULL) == -1)
+      APPL_TRACE_ERROR("epoll_ctl del fd:%d failed: %s", ps->fd,
+                       strerror(errno));
     --ts[h].poll_count;
     memset(ps, 0, sizeof(*ps));
-    ps->pfd.fd = -1;
+    ps->fd = -1;
   } else {
     // one read or one write monitor event signaled, removed the accordding bit
     ps->flags &= ~flags;
     // update the poll events mask
-    ps->pfd.events = flags2pevents(ps->flags);
+    update_epoll(h, EPOLL_CTL_MOD, slot);
   }
 }
 static int process_cmd_sock(int h) {
@@ -427,10 +457,10 @@ static int process_cmd_sock(int h) {
       add_poll(h, cmd.fd, cmd.type, cmd.flags, cmd.user_id);
       break;
     case CMD_REMOVE_FD:
-      for (int i = 1; i < MAX_POLL; ++i) {
+      for (int i = 0; i < MAX_POLL; ++i) {
         poll_slot_t* poll_slot = &ts[h].ps[i];
-        if (poll_slot->pfd.fd == cmd.fd) {
-          remove_poll(h, poll_slot, poll_slot->flags);
+        if (poll_slot->fd == cmd.fd) {
+          remove_poll(h, i, poll_slot->flags);
           break;
         }
       }
@@ -452,106 +482,80 @@ static int process_cmd_sock(int h) {
   return true;
 }
 
-static void print_events(short events) {
+static void print_events(uint32_t events) {
   std::string flags("");
-  if ((events)&POLLIN) flags += " POLLIN";
-  if ((events)&POLLPRI) flags += " POLLPRI";
-  if ((events)&POLLOUT) flags += " POLLOUT";
-  if ((events)&POLLERR) flags += " POLLERR";
-  if ((events)&POLLHUP) flags += " POLLHUP ";
-  if ((events)&POLLNVAL) flags += " POLLNVAL";
-  if ((events)&POLLRDHUP) flags += " POLLRDHUP";
+  if ((events)&EPOLLIN) flags += " EPOLLIN";
+  if ((events)&EPOLLPRI) flags += " EPOLLPRI";
+  if ((events)&EPOLLOUT) flags += " EPOLLOUT";
+  if ((events)&EPOLLERR) flags += " EPOLLERR";
+  if ((events)&EPOLLHUP) flags += " EPOLLHUP ";
+  if ((events)&EPOLLRDHUP) flags += " EPOLLRDHUP";
   APPL_TRACE_DEBUG("print poll event:%x = %s", (events), flags.c_str());
 }
 
-static void process_data_sock(int h, struct pollfd* pfds, int count) {
-  asrt(count <= ts[h].poll_count);
+static void process_data_sock(int h, struct epoll_event* events, int count) {
   int i;
-  for (i = 1; i < ts[h].poll_count; i++) {
-    if (pfds[i].revents) {
-      int ps_i = ts[h].psi[i];
-      if(ts[h].ps[ps_i].pfd.fd <= 0) {
-        APPL_TRACE_ERROR("%s: Socket fd is not open", __FUNCTION__);
-        return;
-      }
-      asrt(pfds[i].fd == ts[h].ps[ps_i].pfd.fd);
-      uint32_t user_id = ts[h].ps[ps_i].user_id;
-      int type = ts[h].ps[ps_i].type;
-      int flags = 0;
-      print_events(pfds[i].revents);
-      if (IS_READ(pfds[i].revents)) {
-        flags |= SOCK_THREAD_FD_RD;
-      }
-      if (IS_WRITE(pfds[i].revents)) {
-        flags |= SOCK_THREAD_FD_WR;
-      }
-      if (IS_EXCEPTION(pfds[i].revents)) {
-        flags |= SOCK_THREAD_FD_EXCEPTION;
-        // remove the whole slot not flags
-        remove_poll(h, &ts[h].ps[ps_i], ts[h].ps[ps_i].flags);
-      } else if (flags)
-        remove_poll(h, &ts[h].ps[ps_i],
-                    flags);  // remove the monitor flags that already processed
-      if (flags) ts[h].callback(pfds[i].fd, type, flags, user_id);
+  for (i = 0; i < count; i++) {
+    uint32_t slot = events[i].data.u32;
+    if (slot == CMD_FD_SLOT) continue;
+    poll_slot_t* ps = &ts[h].ps[slot];
+    // the slot may have been removed by the cmd or an earlier callback
+    if (ps->fd < 0) {
+      APPL_TRACE_DEBUG("%s: slot:%u removed, skip its events", __func__, slot);
+      continue;
     }
-  }
-}
-
-static void prepare_poll_fds(int h, struct pollfd* pfds) {
-  int count = 0;
-  int ps_i = 0;
-  int pfd_i = 0;
-  asrt(ts[h].poll_count <= MAX_POLL);
-  memset(pfds, 0, sizeof(pfds[0]) * ts[h].poll_count);
-  while (count < ts[h].poll_count) {
-    if (ps_i >= MAX_POLL) {
-      APPL_TRACE_ERROR(
-          "exceed max poll range, ps_i:%d, MAX_POLL:%d, count:%d, "
-          "ts[h].poll_count:%d",
-          ps_i, MAX_POLL, count, ts[h].poll_count);
-      return;
+    int fd = ps->fd;
+    uint32_t user_id = ps->user_id;
+    int type = ps->type;
+    int flags = 0;
+    print_events(events[i].events);
+    if (IS_READ(events[i].events)) {
+      flags |= SOCK_THREAD_FD_RD;
     }
-    if (ts[h].ps[ps_i].pfd.fd >= 0 && pfd_i < MAX_POLL) {
-      pfds[pfd_i] = ts[h].ps[ps_i].pfd;
-      ts[h].psi[pfd_i] = ps_i;
-      count++;
-      pfd_i++;
+    if (IS_WRITE(events[i].events)) {
+      flags |= SOCK_THREAD_FD_WR;
     }
-    ps_i++;
+    if (IS_EXCEPTION(events[i].events)) {
+      flags |= SOCK_THREAD_FD_EXCEPTION;
+      // remove the whole slot not flags
+      remove_poll(h, slot, ps->flags);
+    } else if (flags)
+      remove_poll(h, slot,
+                  flags);  // remove the monitor flags that already processed
+    if (flags) ts[h].callback(fd, type, flags, user_id);
   }
 }
+
 static void* sock_poll_thread(void* arg) {
-  struct pollfd pfds[MAX_POLL];
-  memset(pfds, 0, sizeof(pfds));
+  struct epoll_event events[MAX_POLL + 1];
   int h = (intptr_t)arg;
 
   prctl(PR_SET_NAME, (unsigned long)"btif_sock_poll", 0, 0, 0);
-  for (;;) {
-    prepare_poll_fds(h, pfds);
+  for (bool exiting = false; !exiting;) {
     int ret;
-    OSI_NO_INTR(ret = poll(pfds, ts[h].poll_count, -1));
+    OSI_NO_INTR(ret = epoll_wait(ts[h].epoll_fd, events, MAX_POLL + 1, -1));
     if (ret == -1) {
-      APPL_TRACE_ERROR("poll ret -1, exit the thread, errno:%d, err:%s", errno,
-                       strerror(errno));
+      APPL_TRACE_ERROR("epoll_wait ret -1, exit the thread, errno:%d, err:%s",
+                       errno, strerror(errno));
       break;
     }
     if (ret != 0) {
       int need_process_data_fd = true;
-      if (pfds[0].revents)  // cmd fd always is the first one
-      {
-        asrt(pfds[0].fd == ts[h].cmd_fdr);
+      // commands are processed before the data fds, as they may remove some
+      for (int i = 0; i < ret; i++) {
+        if (events[i].data.u32 != CMD_FD_SLOT) continue;
         if (!process_cmd_sock(h)) {
           APPL_TRACE_DEBUG("h:%d, process_cmd_sock return false, exit...", h);
-          break;
-        }
-        if (ret == 1)
+          exiting = true;
+          need_process_data_fd = false;
+        } else if (ret == 1) {
           need_process_data_fd = false;
-        else
-          ret--;  // exclude the cmd fd
+        }
+        break;
       }
-      if (need_process_data_fd) process_data_sock(h, pfds, ret);
+      if (need_process_data_fd) process_data_sock(h, events, ret);
     } else {
-      APPL_TRACE_DEBUG("no data, select ret: %d", ret)
+      APPL_TRACE_DEBUG("no data, epoll_wait ret: %d", ret)
     };
   }
   APPL_TRACE_DEBUG("socket poll thread exiting, h:%d", h);
@@ -40,6 +40,9 @@
 #include <string.h>
 #include <time.h>
 
+#include <mutex>
+#include <set>
+
 #include "bt_common.h"
 #include "bta_closure_api.h"
 #include "bta_hd_api.h"
@@ -68,6 +71,12 @@ using bluetooth::Uuid;
 // TODO(armansito): Find a better way than using a hardcoded path.
 #define BTIF_STORAGE_PATH_BLUEDROID "/data/misc/bluedroid"
 
+// Leaves the link key and the LE keys other than the IRK of the bonded
+// devices in the config at startup, until the device first connects
+#ifndef BTIF_STORAGE_DEFER_BOND_LOAD
+#define BTIF_STORAGE_DEFER_BOND_LOAD TRUE
+#endif
+
 //#define BTIF_STORAGE_PATH_ADAPTER_INFO "adapter_info"
 //#define BTIF_STORAGE_PATH_REMOTE_DEVICES "remote_devices"
 #define BTIF_STORAGE_PATH_REMOTE_DEVTIME "Timestamp"
@@ -175,9 +184,90 @@ static bt_status_t btif_in_fetch_bonded_device(const char* bdstr, int *dev_type)
 static bool btif_has_ble_keys(const char* bdstr);
 
 static bool prop_upd(const RawAddress* remote_bd_addr, bt_property_t *prop);
+
+/*******************************************************************************
+ *  Static variables
+ ******************************************************************************/
+
+// Bonded devices whose keys are not in the security database yet
+static std::set<RawAddress> deferred_devices;
+static std::mutex deferred_devices_lock;
+
 /*******************************************************************************
  *  Static functions
  ******************************************************************************/
+
+static void btif_storage_defer_device(const RawAddress& bd_addr) {
+  std::lock_guard<std::mutex> lock(deferred_devices_lock);
+  deferred_devices.insert(bd_addr);
+}
+
+static void btif_storage_forget_deferred_device(const RawAddress& bd_addr) {
+  std::lock_guard<std::mutex> lock(deferred_devices_lock);
+  deferred_devices.erase(bd_addr);
+}
+
+/*******************************************************************************
+ *
+ * Function         btif_storage_load_deferred_device
+ *
+ * Description      Adds the link key and the LE keys left in NVRAM at startup
+ *                  for |bd_addr| to the security database. Called by BTM on
+ *                  the first connection or link key request of the device.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btif_storage_load_deferred_device(const RawAddress& bd_addr) {
+  {
+    std::lock_guard<std::mutex> lock(deferred_devices_lock);
+    if (deferred_devices.erase(bd_addr) == 0) return;
+  }
+
+  std::string addrstr = bd_addr.ToString();
+  const char* name = addrstr.c_str();
+  BTIF_TRACE_DEBUG("%s: %s", __func__, name);
+
+  LinkKey link_key;
+  size_t size = link_key.size();
+  int linkkey_type;
+  if (btif_config_get_bin(name, "LinkKey", link_key.data(), &size) &&
+      btif_config_get_int(name, "LinkKeyType", &linkkey_type)) {
+    DEV_CLASS dev_class = {0, 0, 0};
+    uint32_t trusted_mask[BTM_SEC_SERVICE_ARRAY_SIZE] = {0};
+    int cod;
+    int pin_length = 0;
+    if (btif_config_get_int(name, "DevClass", &cod))
+      uint2devclass((uint32_t)cod, dev_class);
+    btif_config_get_int(name, "PinLength", &pin_length);
+    if (!BTM_SecAddDevice(bd_addr, dev_class, NULL, NULL, trusted_mask,
+                          &link_key, (uint8_t)linkkey_type, 0,
+                          (uint8_t)pin_length))
+      BTIF_TRACE_ERROR("%s: unable to add %s", __func__, name);
+  }
+
+  // The IRK was added at startup
+  static const struct {
+    uint8_t key_type;
+    size_t key_len;
+  } deferred_le_keys[] = {
+      {BTIF_DM_LE_KEY_PENC, sizeof(tBTM_LE_PENC_KEYS)},
+      {BTIF_DM_LE_KEY_LID, sizeof(tBTM_LE_PID_KEYS)},
+      {BTIF_DM_LE_KEY_PCSRK, sizeof(tBTM_LE_PCSRK_KEYS)},
+      {BTIF_DM_LE_KEY_LENC, sizeof(tBTM_LE_LENC_KEYS)},
+      {BTIF_DM_LE_KEY_LCSRK, sizeof(tBTM_LE_LCSRK_KEYS)},
+  };
+  for (const auto& le_key : deferred_le_keys) {
+    tBTM_LE_KEY_VALUE key;
+    memset(&key, 0, sizeof(key));
+    RawAddress addr = bd_addr;
+    if (btif_storage_get_ble_bonding_key(&addr, le_key.key_type,
+                                         (uint8_t*)&key,
+                                         le_key.key_len) == BT_STATUS_SUCCESS)
+      BTM_SecAddBleKey(bd_addr, &key, le_key.key_type);
+  }
+}
+
 static bool prop_upd(const RawAddress* remote_bd_addr, bt_property_t *prop)
 {
   std::string addrstr;
@@ -278,10 +368,24 @@ static bool prop_upd(const RawAddress* remote_bd_addr, bt_property_t *prop)
   return ret;
 }
 
+/* Saves the properties just updated for |bdstr| if the device was bonded */
+static void save_bonded_device_props(const char* bdstr) {
+  int dev_type = BT_DEVICE_TYPE_BREDR;
+
+  if (btif_in_fetch_bonded_device(bdstr, &dev_type) == BT_STATUS_SUCCESS) {
+    // flush is expensive, avoid for BLE devices during BLE Scanning
+    if(dev_type == BT_DEVICE_TYPE_BREDR) {
+      btif_config_flush();
+    } else {
+      btif_config_save();
+    }
+  }
+}
+
 static int prop2cfgs(const RawAddress* remote_bd_addr, bt_property_t* prop, int count) {
   std::string addrstr;
   const char* bdstr = addrstr.c_str();
-  int dev_type = BT_DEVICE_TYPE_BREDR, c;
+  int c;
   int ret = 0;
 
   if (remote_bd_addr) {
@@ -295,14 +399,7 @@ static int prop2cfgs(const RawAddress* remote_bd_addr, bt_property_t* prop, int
   }
 
   /* save changes if the device was bonded */
-  if (ret && btif_in_fetch_bonded_device(bdstr, &dev_type) == BT_STATUS_SUCCESS) {
-    // flush is expensive, avoid for BLE devices during BLE Scanning
-    if(dev_type == BT_DEVICE_TYPE_BREDR) {
-      btif_config_flush();
-    } else {
-      btif_config_save();
-    }
-  }
+  if (ret) save_bonded_device_props(bdstr);
 
   return ret;
 }
@@ -310,7 +407,6 @@ static int prop2cfgs(const RawAddress* remote_bd_addr, bt_property_t* prop, int
 static int prop2cfg(const RawAddress* remote_bd_addr, bt_property_t* prop) {
   std::string addrstr;
   const char* bdstr = addrstr.c_str();
-  int dev_type = BT_DEVICE_TYPE_BREDR;
   int ret;
 
   if(remote_bd_addr) {
@@ -323,14 +419,7 @@ static int prop2cfg(const RawAddress* remote_bd_addr, bt_property_t* prop) {
       BTIF_TRACE_ERROR("%s: prop_upd fail", __func__);
   }
   /* save changes if the device was bonded */
-  if (ret && btif_in_fetch_bonded_device(bdstr, &dev_type) == BT_STATUS_SUCCESS) {
-    // flush is expensive, avoid for BLE devices during BLE Scanning
-    if(dev_type == BT_DEVICE_TYPE_BREDR) {
-      btif_config_flush();
-    } else {
-      btif_config_save();
-    }
-  }
+  if (ret) save_bonded_device_props(bdstr);
 
   return ret;
 }
@@ -525,6 +614,9 @@ static bt_status_t btif_in_fetch_bonded_devices(
         RawAddress bd_addr;
         RawAddress::FromString(name, bd_addr);
         if (add) {
+#if (BTIF_STORAGE_DEFER_BOND_LOAD == TRUE)
+          btif_storage_defer_device(bd_addr);
+#else
           DEV_CLASS dev_class = {0, 0, 0};
           int cod;
           int pin_length = 0;
@@ -533,6 +625,7 @@ static bt_status_t btif_in_fetch_bonded_devices(
           btif_config_get_int(name, "PinLength", &pin_length);
           BTA_DmAddDevice(bd_addr, dev_class, link_key, 0, 0,
                           (uint8_t)linkkey_type, 0, pin_length);
+#endif
 
           if (btif_config_get_int(name, "DevType", &device_type) &&
               (device_type == BT_DEVICE_TYPE_DUMO)) {
@@ -871,6 +964,7 @@ bt_status_t btif_storage_add_remote_device(const RawAddress* remote_bd_addr,
                                            uint32_t num_properties,
                                            bt_property_t* properties) {
   uint32_t i = 0;
+  bool updated = false;
   /* TODO: If writing a property, fails do we go back undo the earlier
    * written properties? */
   for (i = 0; i < num_properties; i++) {
@@ -883,11 +977,14 @@ bt_status_t btif_storage_add_remote_device(const RawAddress* remote_bd_addr,
       bt_property_t addr_prop;
       memcpy(&addr_prop, &properties[i], sizeof(bt_property_t));
       addr_prop.type = (bt_property_type_t)BT_PROPERTY_REMOTE_DEVICE_TIMESTAMP;
-      btif_storage_set_remote_device_property(remote_bd_addr, &addr_prop);
+      updated |= prop_upd(remote_bd_addr, &addr_prop);
     } else {
-      btif_storage_set_remote_device_property(remote_bd_addr, &properties[i]);
+      updated |= prop_upd(remote_bd_addr, &properties[i]);
     }
   }
+
+  /* The device is saved once for all of its properties */
+  if (updated) save_bonded_device_props(remote_bd_addr->ToString().c_str());
   return BT_STATUS_SUCCESS;
 }
 
@@ -908,6 +1005,7 @@ bt_status_t btif_storage_add_bonded_device(RawAddress* remote_bd_addr,
                                            uint8_t pin_length) {
   std::string addrstr = remote_bd_addr->ToString();
   const char* bdstr = addrstr.c_str();
+  btif_storage_forget_deferred_device(*remote_bd_addr);
   int ret = btif_config_set_int(bdstr, "LinkKeyType", (int)key_type);
   ret &= btif_config_set_int(bdstr, "PinLength", (int)pin_length);
   ret &=
@@ -940,6 +1038,7 @@ bt_status_t btif_storage_remove_bonded_device(
   const char* bdstr = addrstr.c_str();
   BTIF_TRACE_DEBUG("in bd addr:%s", bdstr);
 
+  btif_storage_forget_deferred_device(*remote_bd_addr);
   btif_storage_remove_ble_bonding_keys(remote_bd_addr);
 
   int ret = 1;
@@ -1088,6 +1187,11 @@ bt_status_t btif_storage_load_bonded_devices(void) {
 
   remove_devices_with_sample_ltk();
 
+  {
+    std::lock_guard<std::mutex> lock(deferred_devices_lock);
+    deferred_devices.clear();
+  }
+  BTM_SecRegisterDevLoadCallback(btif_storage_load_deferred_device);
   btif_in_fetch_bonded_devices(&bonded_devices, 1);
 
   /* Now send the adapter_properties_cb with all adapter_properties */
@@ -1428,23 +1532,35 @@ static bt_status_t btif_in_fetch_bonded_ble_device(
       btif_storage_set_remote_addr_type(&bd_addr, BLE_ADDR_PUBLIC);
     }
 
+    // The IRK is always added, the resolving list needs it before the device
+    // connects. The other keys wait for the connection when deferred.
+    bool add_now = add && (BTIF_STORAGE_DEFER_BOND_LOAD != TRUE);
+
     btif_read_le_key(BTIF_DM_LE_KEY_PENC, sizeof(tBTM_LE_PENC_KEYS), bd_addr,
-                     addr_type, add, &device_added, &key_found);
+                     addr_type, add_now, &device_added, &key_found);
 
     btif_read_le_key(BTIF_DM_LE_KEY_PID, sizeof(tBTM_LE_PID_KEYS), bd_addr,
                      addr_type, add, &device_added, &key_found);
 
     btif_read_le_key(BTIF_DM_LE_KEY_LID, sizeof(tBTM_LE_PID_KEYS), bd_addr,
-                     addr_type, add, &device_added, &key_found);
+                     addr_type, add_now, &device_added, &key_found);
 
     btif_read_le_key(BTIF_DM_LE_KEY_PCSRK, sizeof(tBTM_LE_PCSRK_KEYS), bd_addr,
-                     addr_type, add, &device_added, &key_found);
+                     addr_type, add_now, &device_added, &key_found);
 
     btif_read_le_key(BTIF_DM_LE_KEY_LENC, sizeof(tBTM_LE_LENC_KEYS), bd_addr,
-                     addr_type, add, &device_added, &key_found);
+                     addr_type, add_now, &device_added, &key_found);
 
     btif_read_le_key(BTIF_DM_LE_KEY_LCSRK, sizeof(tBTM_LE_LCSRK_KEYS), bd_addr,
-                     addr_type, add, &device_added, &key_found);
+                     addr_type, add_now, &device_added, &key_found);
+
+    if (add && !add_now && key_found) {
+      if (!device_added) {
+        BTA_DmAddBleDevice(bd_addr, addr_type, BT_DEVICE_TYPE_BLE);
+        device_added = true;
+      }
+      btif_storage_defer_device(bd_addr);
+    }
 
     // Fill in the bonded devices
     if (device_added) {
@@ -1626,6 +1742,7 @@ bt_status_t btif_storage_remove_hid_info(RawAddress* remote_bd_addr) {
   btif_config_remove(bdstr, "HidSSRMaxLatency");
   btif_config_remove(bdstr, "HidSSRMinTimeout");
   btif_config_remove(bdstr, "HidDescriptor");
+  btif_config_remove(bdstr, "HidReportCache");
   btif_config_save();
   return BT_STATUS_SUCCESS;
 }
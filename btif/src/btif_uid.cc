@@ -22,8 +22,11 @@
  *                 socket usage per app UID.
  *
  ******************************************************************************/
+#include <atomic>
 #include <mutex>
 
+#include <base/logging.h>
+
 #include "bt_common.h"
 #include "btif_uid.h"
 
@@ -34,8 +37,17 @@ typedef struct uid_set_node_t {
   bt_uid_traffic_t data;
 } uid_set_node_t;
 
+struct uid_set_counter_t {
+  uid_set_counter_t* next;
+  uid_set_t* set;
+  int32_t app_uid;
+  std::atomic<uint64_t> tx_bytes;
+  std::atomic<uint64_t> rx_bytes;
+};
+
 typedef struct uid_set_t {
   uid_set_node_t* head;
+  uid_set_counter_t* counters;  // Counters of the open sockets
 } uid_set_t;
 
 uid_set_t* uid_set_create(void) {
@@ -52,6 +64,9 @@ void uid_set_destroy(uid_set_t* set) {
     osi_free(temp);
   }
   set->head = NULL;
+
+  // The sockets are closed by now, their counters are released
+  CHECK(set->counters == NULL);
   osi_free(set);
 }
 
@@ -88,9 +103,62 @@ void uid_set_add_rx(uid_set_t* set, int32_t app_uid, uint64_t bytes) {
   node->data.rx_bytes += bytes;
 }
 
+// Lock in uid_set_t must be held.
+static void uid_set_fold_counter(uid_set_t* set, uid_set_counter_t* counter) {
+  uint64_t tx_bytes = counter->tx_bytes.exchange(0, std::memory_order_relaxed);
+  uint64_t rx_bytes = counter->rx_bytes.exchange(0, std::memory_order_relaxed);
+  if (tx_bytes == 0 && rx_bytes == 0) return;
+
+  uid_set_node_t* node = uid_set_find_or_create_node(set, counter->app_uid);
+  node->data.tx_bytes += tx_bytes;
+  node->data.rx_bytes += rx_bytes;
+}
+
+uid_set_counter_t* uid_set_counter_create(uid_set_t* set, int32_t app_uid) {
+  if (app_uid == -1 || set == NULL) return NULL;
+
+  uid_set_counter_t* counter = new uid_set_counter_t();
+  counter->set = set;
+  counter->app_uid = app_uid;
+
+  std::unique_lock<std::mutex> guard(set_lock);
+  counter->next = set->counters;
+  set->counters = counter;
+  return counter;
+}
+
+void uid_set_counter_release(uid_set_counter_t* counter) {
+  if (counter == NULL) return;
+
+  std::unique_lock<std::mutex> guard(set_lock);
+  uid_set_t* set = counter->set;
+  uid_set_fold_counter(set, counter);
+
+  uid_set_counter_t** p_next = &set->counters;
+  while (*p_next != counter) p_next = &(*p_next)->next;
+  *p_next = counter->next;
+  guard.unlock();
+
+  delete counter;
+}
+
+void uid_set_counter_add_tx(uid_set_counter_t* counter, uint64_t bytes) {
+  if (counter == NULL || bytes == 0) return;
+  counter->tx_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void uid_set_counter_add_rx(uid_set_counter_t* counter, uint64_t bytes) {
+  if (counter == NULL || bytes == 0) return;
+  counter->rx_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
 bt_uid_traffic_t* uid_set_read_and_clear(uid_set_t* set) {
   std::unique_lock<std::mutex> guard(set_lock);
 
+  for (uid_set_counter_t* counter = set->counters; counter != NULL;
+       counter = counter->next)
+    uid_set_fold_counter(set, counter);
+
   // Find the length
   size_t len = 0;
   uid_set_node_t* node = set->head;
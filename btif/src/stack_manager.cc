@@ -22,10 +22,12 @@
 
 #include <hardware/bluetooth.h>
 
+#include "a2dp_vendor.h"
 #include "btcore/include/module.h"
 #include "btcore/include/osi_module.h"
 #include "btif_api.h"
 #include "btif_common.h"
+#include "common/thread_pool.h"
 #include "device/include/controller.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
@@ -114,10 +116,17 @@ static void event_init_stack(void* context) {
 
     module_init(get_module(OSI_MODULE));
     module_init(get_module(BT_UTILS_MODULE));
+    bluetooth::common::StartUpPool();
+    // Overlaps the vendor libraries' dlopen() with the rest of the init
+    A2DP_VendorPreloadEncoders();
+
+    // Both parse their config file, and neither one needs the other
+    const module_t* config_modules[] = {
 #if (BT_IOT_LOGGING_ENABLED == TRUE)
-    module_init(get_module(DEVICE_IOT_CONFIG_MODULE));
+        get_module(DEVICE_IOT_CONFIG_MODULE),
 #endif
-    module_init(get_module(BTIF_CONFIG_MODULE));
+        get_module(BTIF_CONFIG_MODULE)};
+    module_init_parallel(config_modules, ARRAY_SIZE(config_modules));
 
     future_t* local_hack_future = future_new();
     hack_future = local_hack_future;
@@ -228,6 +237,8 @@ static void event_clean_up_stack(void* context) {
 
   btif_vendor_cleanup_iot_broadcast_timer();
   btif_cleanup_bluetooth();
+  // Runs the offloaded work still queued while its modules are still there
+  bluetooth::common::ShutDownPool();
   module_clean_up(get_module(BTIF_CONFIG_MODULE));
 #if (BT_IOT_LOGGING_ENABLED == TRUE)
   module_clean_up(get_module(DEVICE_IOT_CONFIG_MODULE));
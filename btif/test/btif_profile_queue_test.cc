@@ -17,10 +17,32 @@
  ******************************************************************************/
 #include <gtest/gtest.h>
 
+#include "bt_types.h"
 #include "btif/include/btif_profile_queue.h"
+#include "btm_api.h"
+#include "device/include/interop.h"
 #include "stack_manager.h"
 
 static bool sStackRunning;
+static bool sLinkReady;
+static bool sInteropSerialize;
+
+bool BTM_IsAclConnectionUp(const RawAddress& remote_bda,
+                           tBT_TRANSPORT transport) {
+  return sLinkReady;
+}
+
+bool BTM_GetSecurityFlagsByTransport(const RawAddress& bd_addr,
+                                     uint8_t* p_sec_flags,
+                                     tBT_TRANSPORT transport) {
+  *p_sec_flags = sLinkReady ? BTM_SEC_FLAG_ENCRYPTED : 0;
+  return true;
+}
+
+bool interop_match_addr_or_name(const interop_feature_t feature,
+                                const RawAddress* addr) {
+  return sInteropSerialize;
+}
 
 bool get_stack_is_running(void) { return sStackRunning; }
 
@@ -64,6 +86,8 @@ class BtifProfileQueueTest : public ::testing::Test {
  protected:
   void SetUp() override {
     sStackRunning = true;
+    sLinkReady = true;
+    sInteropSerialize = false;
     sResult = NOT_SET;
   };
   void TearDown() override { btif_queue_release(); };
@@ -205,3 +229,38 @@ TEST_F(BtifProfileQueueTest, test_cleanup_both_reverse_order) {
   btif_queue_connect_next();
   EXPECT_EQ(sResult, NOT_SET);
 }
+
+static int sConnectCount;
+
+static bt_status_t count_connect_cb(RawAddress* bda, uint16_t uuid) {
+  sConnectCount++;
+  return BT_STATUS_SUCCESS;
+}
+
+TEST_F(BtifProfileQueueTest, test_independent_profiles_connect_concurrently) {
+  sConnectCount = 0;
+  btif_test_queue_connect(UUID_SERVCLASS_AG_HANDSFREE, &kTestAddr1,
+                          count_connect_cb);
+  btif_test_queue_connect(UUID_SERVCLASS_AUDIO_SOURCE, &kTestAddr1,
+                          count_connect_cb);
+  EXPECT_EQ(sConnectCount, 2);
+  // A serialized profile still waits for both
+  btif_test_queue_connect(kTestUuid1, &kTestAddr1, test_connect_cb);
+  EXPECT_EQ(sResult, NOT_SET);
+  btif_queue_advance_by_uuid(UUID_SERVCLASS_AUDIO_SOURCE, &kTestAddr1);
+  EXPECT_EQ(sResult, NOT_SET);
+  btif_queue_advance_by_uuid(UUID_SERVCLASS_AG_HANDSFREE, &kTestAddr1);
+  EXPECT_EQ(sResult, UUID1_ADDR1);
+}
+
+TEST_F(BtifProfileQueueTest, test_independent_profiles_serialized_by_interop) {
+  sInteropSerialize = true;
+  sConnectCount = 0;
+  btif_test_queue_connect(UUID_SERVCLASS_AG_HANDSFREE, &kTestAddr1,
+                          count_connect_cb);
+  btif_test_queue_connect(UUID_SERVCLASS_AUDIO_SOURCE, &kTestAddr1,
+                          count_connect_cb);
+  EXPECT_EQ(sConnectCount, 1);
+  btif_queue_advance_by_uuid(UUID_SERVCLASS_AG_HANDSFREE, &kTestAddr1);
+  EXPECT_EQ(sConnectCount, 2);
+}
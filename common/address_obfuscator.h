@@ -19,6 +19,7 @@
 #pragma once
 
 #include <array>
+#include <map>
 #include <mutex>
 #include <string>
 
@@ -30,6 +31,9 @@ namespace common {
 class AddressObfuscator {
  public:
   static constexpr unsigned int kOctet32Length = 32;
+  // Obfuscated addresses remembered until the salt changes. Metrics name the
+  // same few devices over and over, keeping their IDs saves an HMAC per event.
+  static constexpr size_t kMaxCachedAddresses = 64;
   using Octet32 = std::array<uint8_t, kOctet32Length>;
   static AddressObfuscator* GetInstance() {
     static auto instance = new AddressObfuscator();
@@ -66,9 +70,15 @@ class AddressObfuscator {
    */
   std::string Obfuscate(const RawAddress& address);
 
+  /**
+   * Return the number of obfuscated addresses remembered
+   */
+  size_t CachedAddressCount();
+
  private:
   AddressObfuscator() : salt_256bit_({0}) {}
   Octet32 salt_256bit_;
+  std::map<RawAddress, std::string> cache_;
   std::recursive_mutex instance_mutex_;
 };
 
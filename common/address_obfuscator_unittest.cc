@@ -117,4 +117,32 @@ TEST(AddressObfuscatorTest, test_obfuscate_address_key2_max_address) {
       AddressObfuscator::GetInstance()->Obfuscate(kTestData2_3);
   EXPECT_EQ(result.size(), AddressObfuscator::kOctet32Length);
   EXPECT_EQ(result, kTestResult2_3);
-}
\ No newline at end of file
+}
+
+TEST(AddressObfuscatorTest, test_obfuscate_address_cached_until_salt_changes) {
+  AddressObfuscator::GetInstance()->Initialize(kTestKey1);
+  EXPECT_EQ(AddressObfuscator::GetInstance()->Obfuscate(kTestData1),
+            kTestResult1);
+  EXPECT_EQ(AddressObfuscator::GetInstance()->Obfuscate(kTestData1),
+            kTestResult1);
+  EXPECT_GT(AddressObfuscator::GetInstance()->CachedAddressCount(), 0u);
+
+  // A new salt must not return the IDs obfuscated with the previous one
+  AddressObfuscator::GetInstance()->Initialize(kTestKey2);
+  EXPECT_EQ(AddressObfuscator::GetInstance()->CachedAddressCount(), 0u);
+  EXPECT_EQ(AddressObfuscator::GetInstance()->Obfuscate(kTestData2_3),
+            kTestResult2_3);
+}
+
+TEST(AddressObfuscatorTest, test_obfuscate_address_cache_bounded) {
+  AddressObfuscator::GetInstance()->Initialize(kTestKey1);
+  RawAddress address = kTestData1;
+  for (size_t i = 0; i < 2 * AddressObfuscator::kMaxCachedAddresses; i++) {
+    address.address[5] = i;
+    AddressObfuscator::GetInstance()->Obfuscate(address);
+    EXPECT_LE(AddressObfuscator::GetInstance()->CachedAddressCount(),
+              AddressObfuscator::kMaxCachedAddresses);
+  }
+  EXPECT_EQ(AddressObfuscator::GetInstance()->Obfuscate(kTestData1),
+            kTestResult1);
+}
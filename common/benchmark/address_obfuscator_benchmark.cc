@@ -0,0 +1,55 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "common/address_obfuscator.h"
+
+using ::benchmark::State;
+using bluetooth::common::AddressObfuscator;
+
+static const AddressObfuscator::Octet32 kSalt = {
+    0xfa, 0x5d, 0x53, 0x09, 0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde,
+    0xf0, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa,
+    0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x01, 0x02, 0x03, 0x04, 0x05};
+
+// The same device logged over and over, served from the cache
+static void BM_ObfuscateSameAddress(State& state) {
+  AddressObfuscator::GetInstance()->Initialize(kSalt);
+  RawAddress address = {{0x00, 0x11, 0x22, 0x33, 0x44, 0x55}};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        AddressObfuscator::GetInstance()->Obfuscate(address));
+  }
+}
+BENCHMARK(BM_ObfuscateSameAddress);
+
+// More devices than the cache holds, every address is hashed again
+static void BM_ObfuscateDistinctAddresses(State& state) {
+  AddressObfuscator::GetInstance()->Initialize(kSalt);
+  RawAddress address = {{0x00, 0x11, 0x22, 0x33, 0x44, 0x55}};
+  uint16_t i = 0;
+  for (auto _ : state) {
+    address.address[4] = i >> 8;
+    address.address[5] = i & 0xff;
+    i++;
+    benchmark::DoNotOptimize(
+        AddressObfuscator::GetInstance()->Obfuscate(address));
+  }
+}
+BENCHMARK(BM_ObfuscateDistinctAddresses);
+
+BENCHMARK_MAIN();
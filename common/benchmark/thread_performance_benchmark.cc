@@ -308,6 +308,44 @@ BENCHMARK_F(BM_OsiReactorThread, sequential_execution_using_reactor)
   }
 };
 
+#define SPSC_QUEUE_CAPACITY 1024
+
+class BM_OsiReactorThreadSpscQueue : public BM_OsiReactorThread {
+ protected:
+  void SetUp(State& st) override {
+    BM_OsiReactorThread::SetUp(st);
+    fixed_queue_free(bt_msg_queue_, nullptr);
+    bt_msg_queue_ = fixed_queue_new_spsc(SPSC_QUEUE_CAPACITY);
+  }
+};
+
+BENCHMARK_F(BM_OsiReactorThreadSpscQueue, batch_enque_dequeue_using_reactor)
+(State& state) {
+  fixed_queue_register_dequeue(bt_msg_queue_, thread_get_reactor(thread_),
+                               callback_batch, nullptr);
+  for (auto _ : state) {
+    g_counter = 0;
+    g_counter_barrier = std::make_unique<ExecutionBarrier>();
+    for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) {
+      fixed_queue_enqueue(bt_msg_queue_, (void*)&g_counter);
+    }
+    g_counter_barrier->WaitForExecution();
+  }
+};
+
+BENCHMARK_F(BM_OsiReactorThreadSpscQueue, sequential_execution_using_reactor)
+(State& state) {
+  fixed_queue_register_dequeue(bt_msg_queue_, thread_get_reactor(thread_),
+                               callback_sequential_queue, nullptr);
+  for (auto _ : state) {
+    for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) {
+      g_counter_barrier = std::make_unique<ExecutionBarrier>();
+      fixed_queue_enqueue(bt_msg_queue_, (void*)&g_counter);
+      g_counter_barrier->WaitForExecution();
+    }
+  }
+};
+
 class BM_MessageLooopThread : public BM_ThreadPerformance {
  protected:
   void SetUp(State& st) override {
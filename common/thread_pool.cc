@@ -0,0 +1,212 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include <base/bind.h>
+#include <base/logging.h>
+#include <base/threading/platform_thread.h>
+
+#include "thread_pool.h"
+
+namespace bluetooth {
+
+namespace common {
+
+// Upper bound of the workers of the pool shared by the stack
+static constexpr size_t kMaxPoolThreads = 4;
+
+// The pool and worker the current thread belongs to, if any
+static thread_local const ThreadPool* current_pool = nullptr;
+static thread_local size_t current_worker = 0;
+
+ThreadPool::ThreadPool(const std::string& name, size_t num_threads)
+    : name_(name), running_(false), pending_(0), next_worker_(0) {
+  CHECK_GT(num_threads, 0u);
+  for (size_t i = 0; i < num_threads; i++)
+    workers_.push_back(std::make_unique<Worker>());
+}
+
+ThreadPool::~ThreadPool() { ShutDown(); }
+
+void ThreadPool::StartUp() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_) {
+    LOG(WARNING) << __func__ << ": pool " << name_ << " is already started";
+    return;
+  }
+  running_ = true;
+  for (size_t i = 0; i < workers_.size(); i++)
+    workers_[i]->thread = new std::thread(&ThreadPool::Run, this, i);
+}
+
+void ThreadPool::ShutDown() {
+  CHECK(!RunsTasksInCurrentThread())
+      << __func__ << " should not be called from a task of the pool";
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) return;
+    running_ = false;
+  }
+  work_cv_.notify_all();
+
+  for (auto& worker : workers_) {
+    worker->thread->join();
+    delete worker->thread;
+    worker->thread = nullptr;
+  }
+}
+
+bool ThreadPool::PostTask(const base::Location& from_here,
+                          base::OnceClosure task) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!running_) {
+    LOG(ERROR) << __func__ << ": pool " << name_ << " is not running, from "
+               << from_here.ToString();
+    return false;
+  }
+
+  // A worker keeps its own tasks close, the others are spread over the pool
+  if (RunsTasksInCurrentThread()) {
+    Worker* worker = workers_[current_worker].get();
+    std::lock_guard<std::mutex> worker_lock(worker->mutex);
+    worker->tasks.push_front(std::move(task));
+  } else {
+    Worker* worker = workers_[next_worker_].get();
+    next_worker_ = (next_worker_ + 1) % workers_.size();
+    std::lock_guard<std::mutex> worker_lock(worker->mutex);
+    worker->tasks.push_back(std::move(task));
+  }
+  pending_++;
+  lock.unlock();
+  work_cv_.notify_one();
+  return true;
+}
+
+static void RunTaskAndReply(const base::Location& from_here,
+                            base::OnceClosure task,
+                            scoped_refptr<base::TaskRunner> reply_runner,
+                            base::OnceClosure reply) {
+  std::move(task).Run();
+  if (!reply_runner->PostTask(from_here, std::move(reply))) {
+    LOG(WARNING) << __func__ << ": unable to post the reply, from "
+                 << from_here.ToString();
+  }
+}
+
+bool ThreadPool::PostTaskAndReply(const base::Location& from_here,
+                                  base::OnceClosure task,
+                                  scoped_refptr<base::TaskRunner> reply_runner,
+                                  base::OnceClosure reply) {
+  CHECK(reply_runner != nullptr);
+  return PostTask(from_here,
+                  base::BindOnce(&RunTaskAndReply, from_here, std::move(task),
+                                 std::move(reply_runner), std::move(reply)));
+}
+
+bool ThreadPool::IsRunning() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return running_;
+}
+
+bool ThreadPool::RunsTasksInCurrentThread() const {
+  return current_pool == this;
+}
+
+void ThreadPool::Run(size_t index) {
+  base::PlatformThread::SetName(name_ + "_" + std::to_string(index));
+  current_pool = this;
+  current_worker = index;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_cv_.wait(lock, [this] { return pending_ > 0 || !running_; });
+      // The tasks posted before ShutDown() are all run
+      if (pending_ == 0) break;
+      pending_--;
+    }
+    base::OnceClosure task = TakeTask(index);
+    std::move(task).Run();
+  }
+
+  current_pool = nullptr;
+}
+
+base::OnceClosure ThreadPool::TakeTask(size_t index) {
+  // The reserved task is already queued, but another worker may be taking
+  // the one this worker sees, so look again until one is taken.
+  while (true) {
+    for (size_t i = 0; i < workers_.size(); i++) {
+      Worker* worker = workers_[(index + i) % workers_.size()].get();
+      std::lock_guard<std::mutex> worker_lock(worker->mutex);
+      if (worker->tasks.empty()) continue;
+
+      base::OnceClosure task;
+      if (i == 0) {
+        task = std::move(worker->tasks.front());
+        worker->tasks.pop_front();
+      } else {
+        task = std::move(worker->tasks.back());
+        worker->tasks.pop_back();
+      }
+      return task;
+    }
+  }
+}
+
+// The pool shared by the stack
+static std::mutex pool_mutex;
+static std::unique_ptr<ThreadPool> pool;
+
+void StartUpPool() {
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  if (pool != nullptr) return;
+
+  size_t num_threads = std::thread::hardware_concurrency() / 2;
+  num_threads = std::max<size_t>(1, std::min(num_threads, kMaxPoolThreads));
+  pool = std::make_unique<ThreadPool>("bt_pool", num_threads);
+  pool->StartUp();
+}
+
+void ShutDownPool() {
+  std::unique_ptr<ThreadPool> stopping;
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    stopping = std::move(pool);
+  }
+  // Tasks still running may post to the pool, and then do the work themselves
+  if (stopping != nullptr) stopping->ShutDown();
+}
+
+bool PostToPool(const base::Location& from_here, base::OnceClosure task) {
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  if (pool == nullptr) return false;
+  return pool->PostTask(from_here, std::move(task));
+}
+
+bool PostToPool(const base::Location& from_here, base::OnceClosure task,
+                scoped_refptr<base::TaskRunner> reply_on_thread,
+                base::OnceClosure reply) {
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  if (pool == nullptr) return false;
+  return pool->PostTaskAndReply(from_here, std::move(task),
+                                std::move(reply_on_thread), std::move(reply));
+}
+
+}  // namespace common
+
+}  // namespace bluetooth
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <base/callback.h>
+#include <base/location.h>
+#include <base/macros.h>
+#include <base/memory/ref_counted.h>
+#include <base/task_runner.h>
+
+namespace bluetooth {
+
+namespace common {
+
+/**
+ * A small pool of worker threads for CPU work that would otherwise hold up a
+ * protocol thread, such as key computation, compression or serialization.
+ *
+ * Each worker has its own queue. Tasks posted from outside the pool are spread
+ * over the queues, tasks posted from a worker go to the front of its own
+ * queue, and a worker whose queue is empty steals from the back of the
+ * others. Tasks therefore run in no particular order: a task that must follow
+ * another one has to be posted by it, or use a reply.
+ */
+class ThreadPool final {
+ public:
+  /**
+   * Create a pool of |num_threads| workers named |name|. The workers won't be
+   * running until StartUp is called.
+   *
+   * @param name name prefix of the worker threads
+   * @param num_threads number of worker threads, at least 1
+   */
+  ThreadPool(const std::string& name, size_t num_threads);
+
+  /**
+   * Shuts the pool down if it is still running
+   */
+  ~ThreadPool();
+
+  /**
+   * Start the worker threads. Repeated calls only start them once.
+   */
+  void StartUp();
+
+  /**
+   * Run every task already posted, then join the worker threads. PostTask()
+   * returns false from the start of this call.
+   *
+   * NOTE: Should never be called from a task of this pool
+   */
+  void ShutDown();
+
+  /**
+   * Post a task to run on one of the workers
+   *
+   * @param from_here location where this task is originated
+   * @param task task created through base::BindOnce()
+   * @return true if task is successfully scheduled, false if the pool is not
+   * running
+   */
+  bool PostTask(const base::Location& from_here, base::OnceClosure task);
+
+  /**
+   * Post a task to run on one of the workers, then |reply| to |reply_runner|
+   * once the task is done
+   *
+   * @return true if task is successfully scheduled, false if the pool is not
+   * running, in which case neither task nor reply is run
+   */
+  bool PostTaskAndReply(const base::Location& from_here,
+                        base::OnceClosure task,
+                        scoped_refptr<base::TaskRunner> reply_runner,
+                        base::OnceClosure reply);
+
+  /**
+   * Check if this pool is running
+   *
+   * @return true iff the workers are running and accept tasks
+   */
+  bool IsRunning() const;
+
+  /**
+   * @return true iff called from a worker of this pool
+   */
+  bool RunsTasksInCurrentThread() const;
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<base::OnceClosure> tasks;
+    std::thread* thread = nullptr;
+  };
+
+  /**
+   * Runs the tasks of worker |index| and those it steals, until ShutDown() is
+   * called and no task is left
+   */
+  void Run(size_t index);
+
+  /**
+   * Takes the next task for worker |index|. Must only be called once a task
+   * has been reserved in |pending_|.
+   */
+  base::OnceClosure TakeTask(size_t index);
+
+  std::string name_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  // Guards |running_| and |pending_|, the number of posted tasks that no
+  // worker has reserved yet. Workers wait on |work_cv_| for one.
+  mutable std::mutex mutex_;
+  std::condition_variable work_cv_;
+  bool running_;
+  size_t pending_;
+  size_t next_worker_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+/**
+ * Start and stop the pool shared by the stack. While it is not running,
+ * PostToPool() returns false and callers do the work themselves.
+ */
+void StartUpPool();
+void ShutDownPool();
+
+/**
+ * Post |task| to the pool shared by the stack
+ *
+ * @return true if task is successfully scheduled, false otherwise
+ */
+bool PostToPool(const base::Location& from_here, base::OnceClosure task);
+
+/**
+ * Post |task| to the pool shared by the stack, then |reply| to
+ * |reply_on_thread| once the task is done
+ *
+ * @return true if task is successfully scheduled, false otherwise
+ */
+bool PostToPool(const base::Location& from_here, base::OnceClosure task,
+                scoped_refptr<base::TaskRunner> reply_on_thread,
+                base::OnceClosure reply);
+
+}  // namespace common
+
+}  // namespace bluetooth
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <future>
+#include <thread>
+
+#include <base/bind.h>
+#include <base/message_loop/message_loop.h>
+#include <base/run_loop.h>
+#include <gtest/gtest.h>
+
+#include "thread_pool.h"
+
+using bluetooth::common::ThreadPool;
+
+static void Count(std::atomic<int>* counter) { (*counter)++; }
+
+static void Wait(std::shared_future<void> future) { future.wait(); }
+
+static void SaveThreadId(std::thread::id* id) {
+  *id = std::this_thread::get_id();
+}
+
+static void SaveThreadIdAndQuit(std::thread::id* id, base::OnceClosure quit) {
+  SaveThreadId(id);
+  std::move(quit).Run();
+}
+
+TEST(ThreadPoolTest, test_not_running) {
+  ThreadPool pool("test_pool", 2);
+  EXPECT_FALSE(pool.IsRunning());
+  std::atomic<int> counter(0);
+  EXPECT_FALSE(pool.PostTask(FROM_HERE, base::BindOnce(&Count, &counter)));
+  pool.StartUp();
+  EXPECT_TRUE(pool.IsRunning());
+  pool.ShutDown();
+  EXPECT_FALSE(pool.IsRunning());
+  EXPECT_FALSE(pool.PostTask(FROM_HERE, base::BindOnce(&Count, &counter)));
+  EXPECT_EQ(counter, 0);
+}
+
+TEST(ThreadPoolTest, test_shut_down_runs_posted_tasks) {
+  ThreadPool pool("test_pool", 3);
+  pool.StartUp();
+  std::atomic<int> counter(0);
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_TRUE(pool.PostTask(FROM_HERE, base::BindOnce(&Count, &counter)));
+  }
+  pool.ShutDown();
+  EXPECT_EQ(counter, 1000);
+}
+
+TEST(ThreadPoolTest, test_blocked_worker_is_stolen_from) {
+  ThreadPool pool("test_pool", 2);
+  pool.StartUp();
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  std::atomic<int> counter(0);
+
+  // Whichever worker is blocked, the other one runs every queued task
+  EXPECT_TRUE(pool.PostTask(FROM_HERE, base::BindOnce(&Wait, released)));
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(pool.PostTask(FROM_HERE, base::BindOnce(&Count, &counter)));
+  }
+  while (counter < 100) std::this_thread::yield();
+
+  release.set_value();
+  pool.ShutDown();
+  EXPECT_EQ(counter, 100);
+}
+
+TEST(ThreadPoolTest, test_reply_on_thread) {
+  base::MessageLoop message_loop;
+  base::RunLoop run_loop;
+  ThreadPool pool("test_pool", 2);
+  pool.StartUp();
+
+  std::thread::id task_thread;
+  std::thread::id reply_thread;
+  EXPECT_TRUE(pool.PostTaskAndReply(
+      FROM_HERE, base::BindOnce(&SaveThreadId, &task_thread),
+      message_loop.task_runner(),
+      base::BindOnce(&SaveThreadIdAndQuit, &reply_thread,
+                     run_loop.QuitClosure())));
+  run_loop.Run();
+
+  EXPECT_NE(task_thread, std::this_thread::get_id());
+  EXPECT_EQ(reply_thread, std::this_thread::get_id());
+  pool.ShutDown();
+}
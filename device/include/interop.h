@@ -279,6 +279,10 @@ typedef enum {
   //Some LE mouses want to use preferred connection parameters
   INTEROP_ENABLE_PREFERRED_CONN_PARAMETER,
 
+  // Some headsets fail to set up a profile while another one is connecting.
+  // Blacklist them to connect their profiles one after the other.
+  INTEROP_SERIALIZE_PROFILE_CONNECTIONS,
+
   END_OF_INTEROP_LIST
 } interop_feature_t;
 
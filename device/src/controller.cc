@@ -93,6 +93,44 @@ static uint8_t host_add_on_features_length = 0;
 static uint8_t simple_pairing_options = 0;
 static uint8_t maximum_encryption_key_size = 0;
 
+// Capabilities that only change with the controller firmware. They are kept
+// across BT off/on cycles and reused while the controller reports the same
+// address and version.
+typedef struct {
+  bool ble_valid;
+  bool codecs_valid;
+  bool pairing_options_valid;
+  bool add_on_features_valid;
+  bool scrambling_valid;
+  RawAddress address;
+  bt_version_t bt_version;
+
+  uint8_t ble_white_list_size;
+  uint16_t acl_data_size_ble;
+  uint8_t acl_buffer_count_ble;
+  uint8_t ble_supported_states[BLE_SUPPORTED_STATES_SIZE];
+  bt_device_features_t features_ble;
+  uint8_t ble_resolving_list_max_size;
+  uint16_t ble_maxium_advertising_data_length;
+  uint8_t ble_number_of_supported_advertising_sets;
+
+  uint8_t number_of_local_supported_codecs;
+  uint8_t local_supported_codecs[MAX_LOCAL_SUPPORTED_CODECS_SIZE];
+
+  uint8_t simple_pairing_options;
+  uint8_t maximum_encryption_key_size;
+
+  // From the vendor specific commands, when the configstore has none
+  bt_device_soc_add_on_features_t soc_add_on_features;
+  uint8_t soc_add_on_features_length;
+  uint16_t product_id;
+  uint16_t response_version;
+  uint8_t number_of_scrambling_supported_freqs;
+  uint8_t scrambling_supported_freqs[MAX_SUPPORTED_SCRAMBLING_FREQ_SIZE];
+} controller_capabilities_t;
+
+static controller_capabilities_t capabilities_cache;
+
 static bool readable;
 static bool ble_supported;
 static bool ble_offload_features_supported;
@@ -120,6 +158,29 @@ bool decode_max_power_values(char *);
 #define AWAIT_COMMAND(command) \
   static_cast<BT_HDR*>(future_await(hci->transmit_command_futured(command)))
 
+// Independent reads are sent together with SEND_COMMAND, so the HCI layer
+// keeps as many in flight as the controller has command credits, and their
+// responses are collected in order with AWAIT_RESPONSE
+#define SEND_COMMAND(command) hci->transmit_command_futured(command)
+#define AWAIT_RESPONSE(future) static_cast<BT_HDR*>(future_await(future))
+
+// Drops the cached capabilities unless they were read from the controller
+// that has just reported |address| and |bt_version|
+static void validate_capabilities_cache(void) {
+  const bt_version_t& cached = capabilities_cache.bt_version;
+  if (capabilities_cache.address == address &&
+      cached.hci_version == bt_version.hci_version &&
+      cached.hci_revision == bt_version.hci_revision &&
+      cached.lmp_version == bt_version.lmp_version &&
+      cached.manufacturer == bt_version.manufacturer &&
+      cached.lmp_subversion == bt_version.lmp_subversion)
+    return;
+
+  memset(&capabilities_cache, 0, sizeof(capabilities_cache));
+  capabilities_cache.address = address;
+  capabilities_cache.bt_version = bt_version;
+}
+
 // Module lifecycle functions
 
 void send_soc_log_command(bool value) {
@@ -328,25 +389,31 @@ static future_t* start_up(void) {
     btm_enable_link_lpa_enh_pwr_ctrl((uint16_t)HCI_INVALID_HANDLE, true);
   }
 
-  // Read the local version info off the controller next, including
-  // information such as manufacturer and supported HCI version
-  response = AWAIT_COMMAND(packet_factory->make_read_local_version_info());
+  // Read the local version info (manufacturer and supported HCI version), the
+  // bluetooth address, the supported commands and page 0 of the controller
+  // features next. None of them depends on another, so they are pipelined.
+  uint8_t page_number = 0;
+  future_t* version_future =
+      SEND_COMMAND(packet_factory->make_read_local_version_info());
+  future_t* bd_addr_future = SEND_COMMAND(packet_factory->make_read_bd_addr());
+  future_t* commands_future =
+      SEND_COMMAND(packet_factory->make_read_local_supported_commands());
+  future_t* features_future = SEND_COMMAND(
+      packet_factory->make_read_local_extended_features(page_number));
+
+  response = AWAIT_RESPONSE(version_future);
   packet_parser->parse_read_local_version_info_response(response, &bt_version);
 
-  // Read the bluetooth address off the controller next
-  response = AWAIT_COMMAND(packet_factory->make_read_bd_addr());
+  response = AWAIT_RESPONSE(bd_addr_future);
   packet_parser->parse_read_bd_addr_response(response, &address);
 
-  // Request the controller's supported commands next
-  response =
-      AWAIT_COMMAND(packet_factory->make_read_local_supported_commands());
+  validate_capabilities_cache();
+
+  response = AWAIT_RESPONSE(commands_future);
   packet_parser->parse_read_local_supported_commands_response(
       response, supported_commands, HCI_SUPPORTED_COMMANDS_ARRAY_SIZE);
 
-  // Read page 0 of the controller features next
-  uint8_t page_number = 0;
-  response = AWAIT_COMMAND(
-      packet_factory->make_read_local_extended_features(page_number));
+  response = AWAIT_RESPONSE(features_future);
   packet_parser->parse_read_local_extended_features_response(
       response, &page_number, &last_features_classic_page_index,
       features_classic, MAX_FEATURES_CLASSIC_PAGE_COUNT);
@@ -418,53 +485,98 @@ static future_t* start_up(void) {
 
   ble_supported = last_features_classic_page_index >= 1 &&
                   HCI_LE_HOST_SUPPORTED(features_classic[1].as_array);
-  if (ble_supported) {
-    // Request the ble white list size next
-    response = AWAIT_COMMAND(packet_factory->make_ble_read_white_list_size());
+  if (ble_supported && capabilities_cache.ble_valid) {
+    LOG_INFO(LOG_TAG, "%s: reusing the cached LE capabilities", __func__);
+    ble_white_list_size = capabilities_cache.ble_white_list_size;
+    acl_data_size_ble = capabilities_cache.acl_data_size_ble;
+    acl_buffer_count_ble = capabilities_cache.acl_buffer_count_ble;
+    memcpy(ble_supported_states, capabilities_cache.ble_supported_states,
+           sizeof(ble_supported_states));
+    features_ble = capabilities_cache.features_ble;
+    ble_resolving_list_max_size =
+        capabilities_cache.ble_resolving_list_max_size;
+    ble_maxium_advertising_data_length =
+        capabilities_cache.ble_maxium_advertising_data_length;
+    ble_number_of_supported_advertising_sets =
+        capabilities_cache.ble_number_of_supported_advertising_sets;
+
+    // The suggested default data length can be written by the host
+    if (HCI_LE_DATA_LEN_EXT_SUPPORTED(features_ble.as_array)) {
+      response = AWAIT_COMMAND(
+          packet_factory->make_ble_read_suggested_default_data_length());
+      packet_parser->parse_ble_read_suggested_default_data_length_response(
+          response, &ble_suggested_default_data_length);
+    }
+  } else if (ble_supported) {
+    // Request the ble white list size, buffer size, supported states and
+    // supported features next, all pipelined
+    future_t* white_list_future =
+        SEND_COMMAND(packet_factory->make_ble_read_white_list_size());
+    future_t* buffer_size_future =
+        SEND_COMMAND(packet_factory->make_ble_read_buffer_size());
+    future_t* states_future =
+        SEND_COMMAND(packet_factory->make_ble_read_supported_states());
+    future_t* features_ble_future =
+        SEND_COMMAND(packet_factory->make_ble_read_local_supported_features());
+
+    response = AWAIT_RESPONSE(white_list_future);
     packet_parser->parse_ble_read_white_list_size_response(
         response, &ble_white_list_size);
 
-    // Request the ble buffer size next
-    response = AWAIT_COMMAND(packet_factory->make_ble_read_buffer_size());
+    response = AWAIT_RESPONSE(buffer_size_future);
     packet_parser->parse_ble_read_buffer_size_response(
         response, &acl_data_size_ble, &acl_buffer_count_ble);
 
     // Response of 0 indicates ble has the same buffer size as classic
     if (acl_data_size_ble == 0) acl_data_size_ble = acl_data_size_classic;
 
-    // Request the ble supported states next
-    response = AWAIT_COMMAND(packet_factory->make_ble_read_supported_states());
+    response = AWAIT_RESPONSE(states_future);
     packet_parser->parse_ble_read_supported_states_response(
         response, ble_supported_states, sizeof(ble_supported_states));
 
-    // Request the ble supported features next
-    response =
-        AWAIT_COMMAND(packet_factory->make_ble_read_local_supported_features());
+    response = AWAIT_RESPONSE(features_ble_future);
     packet_parser->parse_ble_read_local_supported_features_response(
         response, &features_ble);
 
-    if (HCI_LE_ENHANCED_PRIVACY_SUPPORTED(features_ble.as_array)) {
-      response =
-          AWAIT_COMMAND(packet_factory->make_ble_read_resolving_list_size());
+    // The reads gated on the ble supported features are pipelined as well
+    future_t* resolving_list_future = NULL;
+    future_t* data_length_future = NULL;
+    future_t* adv_data_length_future = NULL;
+    future_t* adv_sets_future = NULL;
+
+    if (HCI_LE_ENHANCED_PRIVACY_SUPPORTED(features_ble.as_array))
+      resolving_list_future =
+          SEND_COMMAND(packet_factory->make_ble_read_resolving_list_size());
+
+    if (HCI_LE_DATA_LEN_EXT_SUPPORTED(features_ble.as_array))
+      data_length_future = SEND_COMMAND(
+          packet_factory->make_ble_read_suggested_default_data_length());
+
+    if (HCI_LE_EXTENDED_ADVERTISING_SUPPORTED(features_ble.as_array)) {
+      adv_data_length_future = SEND_COMMAND(
+          packet_factory->make_ble_read_maximum_advertising_data_length());
+      adv_sets_future = SEND_COMMAND(
+          packet_factory->make_ble_read_number_of_supported_advertising_sets());
+    }
+
+    if (resolving_list_future) {
+      response = AWAIT_RESPONSE(resolving_list_future);
       packet_parser->parse_ble_read_resolving_list_size_response(
           response, &ble_resolving_list_max_size);
     }
 
-    if (HCI_LE_DATA_LEN_EXT_SUPPORTED(features_ble.as_array)) {
-      response = AWAIT_COMMAND(
-          packet_factory->make_ble_read_suggested_default_data_length());
+    if (data_length_future) {
+      response = AWAIT_RESPONSE(data_length_future);
       packet_parser->parse_ble_read_suggested_default_data_length_response(
           response, &ble_suggested_default_data_length);
     }
 
-    if (HCI_LE_EXTENDED_ADVERTISING_SUPPORTED(features_ble.as_array)) {
-      response = AWAIT_COMMAND(
-          packet_factory->make_ble_read_maximum_advertising_data_length());
+    if (adv_data_length_future) {
+      response = AWAIT_RESPONSE(adv_data_length_future);
       packet_parser->parse_ble_read_maximum_advertising_data_length(
           response, &ble_maxium_advertising_data_length);
 
-      response = AWAIT_COMMAND(
-          packet_factory->make_ble_read_number_of_supported_advertising_sets());
+      response = AWAIT_RESPONSE(adv_sets_future);
       packet_parser->parse_ble_read_number_of_supported_advertising_sets(
           response, &ble_number_of_supported_advertising_sets);
     } else {
@@ -472,6 +584,22 @@ static future_t* start_up(void) {
       ble_maxium_advertising_data_length = 31;
     }
 
+    capabilities_cache.ble_white_list_size = ble_white_list_size;
+    capabilities_cache.acl_data_size_ble = acl_data_size_ble;
+    capabilities_cache.acl_buffer_count_ble = acl_buffer_count_ble;
+    memcpy(capabilities_cache.ble_supported_states, ble_supported_states,
+           sizeof(ble_supported_states));
+    capabilities_cache.features_ble = features_ble;
+    capabilities_cache.ble_resolving_list_max_size =
+        ble_resolving_list_max_size;
+    capabilities_cache.ble_maxium_advertising_data_length =
+        ble_maxium_advertising_data_length;
+    capabilities_cache.ble_number_of_supported_advertising_sets =
+        ble_number_of_supported_advertising_sets;
+    capabilities_cache.ble_valid = true;
+  }
+
+  if (ble_supported) {
     // Set the ble event mask next
     response =
         AWAIT_COMMAND(packet_factory->make_ble_set_event_mask(&BLE_EVENT_MASK));
@@ -486,22 +614,44 @@ static future_t* start_up(void) {
 
   // read local supported codecs
   if (HCI_READ_LOCAL_CODECS_SUPPORTED(supported_commands)) {
-    response =
-        AWAIT_COMMAND(packet_factory->make_read_local_supported_codecs());
-    packet_parser->parse_read_local_supported_codecs_response(
-        response, &number_of_local_supported_codecs, local_supported_codecs);
+    if (capabilities_cache.codecs_valid) {
+      number_of_local_supported_codecs =
+          capabilities_cache.number_of_local_supported_codecs;
+      memcpy(local_supported_codecs, capabilities_cache.local_supported_codecs,
+             sizeof(local_supported_codecs));
+    } else {
+      response =
+          AWAIT_COMMAND(packet_factory->make_read_local_supported_codecs());
+      packet_parser->parse_read_local_supported_codecs_response(
+          response, &number_of_local_supported_codecs, local_supported_codecs);
+
+      capabilities_cache.number_of_local_supported_codecs =
+          number_of_local_supported_codecs;
+      memcpy(capabilities_cache.local_supported_codecs, local_supported_codecs,
+             sizeof(local_supported_codecs));
+      capabilities_cache.codecs_valid = true;
+    }
   }
 
   read_simple_pairing_options_supported =
       HCI_READ_LOCAL_SIMPLE_PAIRING_OPTIONS_SUPPORTED(supported_commands);
 
   // read local simple pairing options
-  if (read_simple_pairing_options_supported) {
+  if (read_simple_pairing_options_supported &&
+      capabilities_cache.pairing_options_valid) {
+    simple_pairing_options = capabilities_cache.simple_pairing_options;
+    maximum_encryption_key_size =
+        capabilities_cache.maximum_encryption_key_size;
+  } else if (read_simple_pairing_options_supported) {
     LOG_DEBUG(LOG_TAG, "%s read local simple pairing options", __func__);
     response =
         AWAIT_COMMAND(packet_factory->make_read_local_simple_pairing_options());
     packet_parser->parse_read_local_simple_paring_options_response(
         response, &simple_pairing_options, &maximum_encryption_key_size);
+    capabilities_cache.simple_pairing_options = simple_pairing_options;
+    capabilities_cache.maximum_encryption_key_size =
+        maximum_encryption_key_size;
+    capabilities_cache.pairing_options_valid = true;
     LOG_DEBUG(LOG_TAG, "%s simple pairing options is 0x%x", __func__,
         simple_pairing_options);
   }
@@ -540,7 +690,14 @@ static future_t* start_up(void) {
       }
     }
 
-    if (!soc_add_on_features_length) {
+    if (!soc_add_on_features_length &&
+        capabilities_cache.add_on_features_valid) {
+      soc_add_on_features = capabilities_cache.soc_add_on_features;
+      soc_add_on_features_length =
+          capabilities_cache.soc_add_on_features_length;
+      product_id = capabilities_cache.product_id;
+      response_version = capabilities_cache.response_version;
+    } else if (!soc_add_on_features_length) {
       response =
             AWAIT_COMMAND(packet_factory->make_read_add_on_features_supported());
       if (response) {
@@ -549,9 +706,22 @@ static future_t* start_up(void) {
         packet_parser->parse_read_add_on_features_supported_response(
             response, &soc_add_on_features, &soc_add_on_features_length,
             &product_id, &response_version);
+
+        capabilities_cache.soc_add_on_features = soc_add_on_features;
+        capabilities_cache.soc_add_on_features_length =
+            soc_add_on_features_length;
+        capabilities_cache.product_id = product_id;
+        capabilities_cache.response_version = response_version;
+        capabilities_cache.add_on_features_valid = true;
       }
     }
-    if (!soc_add_on_features_length) {
+    if (!soc_add_on_features_length && capabilities_cache.scrambling_valid) {
+      number_of_scrambling_supported_freqs =
+          capabilities_cache.number_of_scrambling_supported_freqs;
+      memcpy(scrambling_supported_freqs,
+             capabilities_cache.scrambling_supported_freqs,
+             sizeof(scrambling_supported_freqs));
+    } else if (!soc_add_on_features_length) {
       // read scrambling support from controller incase of cherokee
       response =
             AWAIT_COMMAND(packet_factory->make_read_scrambling_supported_freqs());
@@ -564,6 +734,12 @@ static future_t* start_up(void) {
 
         LOG_DEBUG(LOG_TAG, "%s number_of_scrambling_supported_freqs %d", __func__,
                         number_of_scrambling_supported_freqs);
+
+        capabilities_cache.number_of_scrambling_supported_freqs =
+            number_of_scrambling_supported_freqs;
+        memcpy(capabilities_cache.scrambling_supported_freqs,
+               scrambling_supported_freqs, sizeof(scrambling_supported_freqs));
+        capabilities_cache.scrambling_valid = true;
       }
     } else {
         if (HCI_SPLIT_A2DP_SCRAMBLING_DATA_REQUIRED(soc_add_on_features.as_array))  {
@@ -31,6 +31,7 @@
 
 #include "g722_typedefs.h"
 #include "g722_enc_dec.h"
+#include "g722_qmf.h"
 
 #if !defined(FALSE)
 #define FALSE 0
@@ -263,6 +264,11 @@ static int16_t qmf_coeffs[12] =
 {
        3,  -11,   12,   32, -210,  951, 3876, -805,  362, -156,   53,  -11,
 };
+/* qmf_coeffs in reverse order, for the odd samples */
+static int16_t qmf_coeffs_reversed[12] =
+{
+     -11,   53, -156,  362, -805, 3876,  951, -210,   32,   12,  -11,    3,
+};
 static int16_t ihn[3] = {0, 1, 0};
 static int16_t ihp[3] = {0, 3, 2};
 static int16_t wh[3] = {0, -214, 798};
@@ -310,20 +316,13 @@ int g722_encode(g722_encode_state_t *s, uint8_t g722_data[],
             {
                 /* Apply the transmit QMF */
                 /* Shuffle the buffer down */
-                for (i = 0;  i < 22;  i++)
-                    s->x[i] = s->x[i + 2];
                 //TODO: if len is odd, then this can be a buffer overrun
-                s->x[22] = amp[j++];
-                s->x[23] = amp[j++];
+                g722_qmf_push(s->x, amp[j], amp[j + 1]);
+                j += 2;
 
                 /* Discard every other QMF output */
-                sumeven = 0;
-                sumodd = 0;
-                for (i = 0;  i < 12;  i++)
-                {
-                    sumodd += s->x[2*i]*qmf_coeffs[i];
-                    sumeven += s->x[2*i + 1]*qmf_coeffs[11 - i];
-                }
+                g722_qmf_apply(s->x, qmf_coeffs, qmf_coeffs_reversed,
+                               &sumodd, &sumeven);
                 /* We shift by 12 to allow for the QMF filters (DC gain = 4096), plus 1
                    to allow for us summing two filters, plus 1 to allow for the 15 bit
                    input to the G.722 algorithm. */
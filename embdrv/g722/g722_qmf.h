@@ -0,0 +1,102 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file */
+
+/* The 24 tap QMF shared by the G.722 encoder and decoder. The history holds
+   12 even and 12 odd samples, interleaved, each filtered by its own 12 taps.
+   All the products and sums fit in 32 bits, so the NEON filter gives the
+   same result as the C loop. */
+
+#if !defined(_G722_QMF_H_)
+#define _G722_QMF_H_
+
+#include <string.h>
+
+#include "g722_typedefs.h"
+
+/* Set G722_USE_NEON to 0 to always use the C filter */
+#if !defined(G722_USE_NEON)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define G722_USE_NEON 1
+#else
+#define G722_USE_NEON 0
+#endif
+#endif
+
+#if G722_USE_NEON
+#include <arm_neon.h>
+#endif
+
+#define G722_QMF_TAPS 12
+
+/* Shuffles the history down by a pair of samples and appends x0 and x1 */
+static __inline void g722_qmf_push(int x[2*G722_QMF_TAPS], int x0, int x1)
+{
+    memmove(x, x + 2, (2*G722_QMF_TAPS - 2)*sizeof(x[0]));
+    x[2*G722_QMF_TAPS - 2] = x0;
+    x[2*G722_QMF_TAPS - 1] = x1;
+}
+/*- End of function --------------------------------------------------------*/
+
+/* Filters the even samples of the history with ceven and the odd samples with
+   codd */
+static __inline void g722_qmf_apply(const int x[2*G722_QMF_TAPS],
+                                    const int16_t ceven[G722_QMF_TAPS],
+                                    const int16_t codd[G722_QMF_TAPS],
+                                    int *sum_even,
+                                    int *sum_odd)
+{
+#if G722_USE_NEON
+    int32x4_t acc_even = vdupq_n_s32(0);
+    int32x4_t acc_odd = vdupq_n_s32(0);
+    int i;
+
+    for (i = 0;  i < G722_QMF_TAPS;  i += 4)
+    {
+        int32x4x2_t v = vld2q_s32((const int32_t *) &x[2*i]);
+        acc_even = vmlaq_s32(acc_even, v.val[0], vmovl_s16(vld1_s16(&ceven[i])));
+        acc_odd = vmlaq_s32(acc_odd, v.val[1], vmovl_s16(vld1_s16(&codd[i])));
+    }
+#if defined(__aarch64__)
+    *sum_even = vaddvq_s32(acc_even);
+    *sum_odd = vaddvq_s32(acc_odd);
+#else
+    int32x2_t even = vadd_s32(vget_low_s32(acc_even), vget_high_s32(acc_even));
+    int32x2_t odd = vadd_s32(vget_low_s32(acc_odd), vget_high_s32(acc_odd));
+    *sum_even = vget_lane_s32(vpadd_s32(even, even), 0);
+    *sum_odd = vget_lane_s32(vpadd_s32(odd, odd), 0);
+#endif
+#else
+    int even;
+    int odd;
+    int i;
+
+    even = 0;
+    odd = 0;
+    for (i = 0;  i < G722_QMF_TAPS;  i++)
+    {
+        even += x[2*i]*ceven[i];
+        odd += x[2*i + 1]*codd[i];
+    }
+    *sum_even = even;
+    *sum_odd = odd;
+#endif
+}
+/*- End of function --------------------------------------------------------*/
+
+#endif
+/*- End of file ------------------------------------------------------------*/
@@ -238,6 +238,9 @@ typedef struct {
   uint8_t restrictSubbands;
   uint8_t enhancedEnabled;
   uint8_t bufferedBlocks;
+  /* Boolean, set by OI_CODEC_SBC_DecoderReset() and
+   * OI_CODEC_SBC_DecoderAllowSimd() */
+  uint8_t simdSynthesis;
 } OI_CODEC_SBC_DECODER_CONTEXT;
 
 typedef struct {
@@ -297,6 +300,24 @@ OI_STATUS OI_CODEC_SBC_DecoderReset(OI_CODEC_SBC_DECODER_CONTEXT* context,
 OI_STATUS OI_CODEC_SBC_DecoderLimit(OI_CODEC_SBC_DECODER_CONTEXT* context,
                                     OI_BOOL enhanced, uint8_t subbands);
 
+/**
+ * This function selects the synthesis filter implementation. Its use is
+ * optional. OI_CODEC_SBC_DecoderReset() selects the vectorized (NEON or AVX2)
+ * synthesis filter when the CPU supports it; both implementations produce the
+ * same output. If used, it must be called after calling
+ * OI_CODEC_SBC_DecoderReset().
+ *
+ * @param context   Pointer to the decoder context structure.
+ *
+ * @param allow     If true, the vectorized synthesis filter is used when the
+ *                  CPU supports it. If false, the C synthesis filter is used.
+ *
+ * @return          OI_OK, or OI_STATUS_NOT_IMPLEMENTED if allow is true and
+ *                  the CPU has no vectorized synthesis filter.
+ */
+OI_STATUS OI_CODEC_SBC_DecoderAllowSimd(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                                        OI_BOOL allow);
+
 /**
  * This function sets the decoder parameters for a raw decode where the decoder
  * parameters are not available in the sbc data stream.
@@ -114,6 +114,17 @@ OI_STATUS OI_CODEC_SBC_DecoderLimit(OI_CODEC_SBC_DECODER_CONTEXT* context,
   return OI_OK;
 }
 
+OI_STATUS OI_CODEC_SBC_DecoderAllowSimd(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                                        OI_BOOL allow) {
+  OI_BOOL available = OI_SBC_SynthSimdAvailable();
+
+  context->simdSynthesis = (allow && available) ? TRUE : FALSE;
+  if (allow && !available) {
+    return OI_STATUS_NOT_IMPLEMENTED;
+  }
+  return OI_OK;
+}
+
 /**
 @}
 */
@@ -73,6 +73,7 @@ INLINE OI_STATUS internal_DecoderReset(OI_CODEC_SBC_DECODER_CONTEXT* context,
   context->common.codecInfo = OI_Codec_Copyright;
   context->common.maxBitneed = 0;
   context->limitFrameFormat = FALSE;
+  context->simdSynthesis = OI_SBC_SynthSimdAvailable();
   OI_SBC_ExpandFrameFields(&context->common.frameInfo);
 
   /*PLATFORM_DECODER_RESET(context);*/
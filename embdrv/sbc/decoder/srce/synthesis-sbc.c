@@ -303,8 +303,13 @@ PRIVATE void OI_SBC_SynthFrame_80(OI_CODEC_SBC_DECODER_CONTEXT* context,
 
     for (ch = 0; ch < nrof_channels; ch++) {
       DCT2_8(context->common.filterBuffer[ch] + offset, s);
-      SYNTH80(pcm + ch, context->common.filterBuffer[ch] + offset,
-              pcmStrideShift);
+      if (context->simdSynthesis) {
+        SynthWindow80_simd(pcm + ch, context->common.filterBuffer[ch] + offset,
+                           pcmStrideShift);
+      } else {
+        SYNTH80(pcm + ch, context->common.filterBuffer[ch] + offset,
+                pcmStrideShift);
+      }
       s += 8;
     }
     pcm += (8 << pcmStrideShift);
@@ -341,8 +346,14 @@ PRIVATE void OI_SBC_SynthFrame_4SB(OI_CODEC_SBC_DECODER_CONTEXT* context,
     }
     for (ch = 0; ch < nrof_channels; ch++) {
       cosineModulateSynth4(context->common.filterBuffer[ch] + offset, s);
-      SynthWindow40_int32_int32_symmetry_with_sum(
-          pcm + ch, context->common.filterBuffer[ch] + offset, pcmStrideShift);
+      if (context->simdSynthesis) {
+        SynthWindow40_simd(pcm + ch, context->common.filterBuffer[ch] + offset,
+                           pcmStrideShift);
+      } else {
+        SynthWindow40_int32_int32_symmetry_with_sum(
+            pcm + ch, context->common.filterBuffer[ch] + offset,
+            pcmStrideShift);
+      }
       s += 4;
     }
     pcm += (4 << pcmStrideShift);
@@ -0,0 +1,270 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/** @file
+@ingroup codec_internal
+*/
+
+/**@addgroup codec_internal*/
+/**@{*/
+
+/*
+ * Vectorized versions of SynthWindow80_generated() and
+ * SynthWindow40_int32_int32_symmetry_with_sum(), computing all the output
+ * samples of a block at once. NEON is used on ARM, AVX2 on x86 when the CPU
+ * supports it.
+ *
+ * Each output sample is a sum of at most 10 products of a window coefficient
+ * and a buffer value. The tables below list, for each of the 10 taps, the
+ * coefficient used by every output sample, in pcm order, and where its buffer
+ * value is read. Unused taps have a zero coefficient. The products, shifts and
+ * wrap around are the same as in the C code, so the output is bit exact.
+ */
+
+#include "oi_codec_sbc_private.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SBC_SYNTH_NEON
+#define SBC_SYNTH_TARGET
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define SBC_SYNTH_AVX2
+#define SBC_SYNTH_TARGET __attribute__((target("avx2")))
+#endif
+
+#if defined(SBC_SYNTH_NEON) || defined(SBC_SYNTH_AVX2)
+
+/* SynthWindow80_generated(): taps of pcm[0..7], with the shift applied to each
+ * product before it is summed. Tap 2m reads buffer[16m + 5..12] in the order
+ * of synth80_even, tap 2m + 1 in the order of synth80_odd, with pcm[0] reading
+ * buffer[16m + 20] instead. */
+static const int16_t synth80_coef[10][8] = {
+    {8235, -3263, -10385, -16457, 10445, 16913, 11167, 9293},
+    {-23167, 29293, 24995, 19083, 0, -8443, -10337, -6087},
+    {26479, -5229, -309, -23641, -5297, 3687, 1917, 1247},
+    {-17397, 30835, 9161, -29015, 0, -301, -30605, -2893},
+    {9399, -27021, -23063, -12889, 22299, 15447, 8317, 23671},
+    {17397, 31633, 27561, 6145, 0, 10255, 9553, 18055},
+    {26479, 17319, 2309, 24211, 10603, -18233, 22117, 11537},
+    {23167, 26663, 12705, 23469, 0, 9405, 16383, 1747},
+    {8235, 4555, 6239, 21223, 9539, 1499, 7543, 685},
+    {0, 12419, 9251, 26913, 0, 26189, 8603, 8721},
+};
+static const int32_t synth80_lshift[10][8] = {
+    {0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 4, 0, 1, 1, 2, 3},
+    {1, 0, 0, 0, 0, 5, 0, 3},
+    {3, 1, 1, 2, 2, 2, 3, 2},
+    {1, 1, 1, 3, 0, 2, 2, 1},
+    {0, 1, 3, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 1},
+    {0, 0, 0, 0, 0, 0, 0, 1},
+    {0, 0, 0, 0, 0, 0, 0, 0},
+};
+static const int32_t synth80_rshift[10][8] = {
+    {3, 5, 6, 6, 4, 5, 4, 3},
+    {3, 5, 5, 5, 0, 7, 4, 2},
+    {2, 0, 0, 2, 0, 0, 0, 0},
+    {0, 3, 3, 4, 0, 0, 1, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0},
+    {2, 0, 0, 1, 0, 3, 4, 1},
+    {3, 2, 1, 2, 0, 1, 2, 0},
+    {3, 1, 3, 8, 4, 1, 3, 0},
+    {0, 4, 4, 6, 0, 7, 6, 7},
+};
+
+/* Byte shuffles of buffer[16m + 5..12] into the taps */
+static const uint8_t synth80_even[16] = {14, 15, 0, 1, 2, 3, 4, 5,
+                                         6,  7,  4, 5, 2, 3, 0, 1};
+static const uint8_t synth80_odd[16] = {12, 13, 12, 13, 10, 11, 8,  9,
+                                        8,  9,  8,  9,  10, 11, 12, 13};
+
+/* SynthWindow40_int32_int32_symmetry_with_sum(): taps of pcm[0..3], with the
+ * sums and differences of buffer values split into separate taps */
+static const uint8_t synth40_index[10][4] = {
+    {12, 1, 78, 79},
+    {76, 77, 14, 3},
+    {16, 13, 62, 67},
+    {64, 65, 30, 15},
+    {28, 17, 46, 63},
+    {60, 61, 0, 19},
+    {32, 29, 0, 51},
+    {48, 49, 0, 31},
+    {44, 33, 0, 47},
+    {0, 45, 0, 35},
+};
+static const int32_t synth40_coef[10][4] = {
+    {694, 97, 270, 97},
+    {694, 495, 338, 495},
+    {1974, 704, 5224, 704},
+    {-1974, -554, -5214, -554},
+    {4681, 3697, 44618, 3697},
+    {4681, 5824, 0, 5824},
+    {24529, 1109, 0, 1109},
+    {-24529, -14047, 0, -14047},
+    {53243, 35274, 0, 35274},
+    {0, 50984, 0, 50984},
+};
+
+SBC_SYNTH_TARGET PRIVATE void SynthWindow80_simd(
+    int16_t* pcm, SBC_BUFFER_T const* RESTRICT buffer, OI_UINT strideShift) {
+  SBC_BUFFER_T const* b;
+  int16_t out[8];
+  OI_UINT t, j;
+#ifdef SBC_SYNTH_NEON
+  int32x4_t lo = vdupq_n_s32(0);
+  int32x4_t hi = vdupq_n_s32(0);
+  uint8x8x2_t v;
+  uint8x16_t order;
+  int16x8_t x;
+
+  for (t = 0; t < 10; t++) {
+    b = buffer + 16 * (t >> 1);
+    v.val[0] = vreinterpret_u8_s16(vld1_s16(b + 5));
+    v.val[1] = vreinterpret_u8_s16(vld1_s16(b + 9));
+    order = vld1q_u8((t & 1) ? synth80_odd : synth80_even);
+    x = vreinterpretq_s16_u8(vcombine_u8(vtbl2_u8(v, vget_low_u8(order)),
+                                         vtbl2_u8(v, vget_high_u8(order))));
+    if ((t & 1) && t < 9) x = vsetq_lane_s16(b[20], x, 0);
+
+    lo = vaddq_s32(
+        lo, vshlq_s32(vmull_s16(vget_low_s16(x), vld1_s16(synth80_coef[t])),
+                      vsubq_s32(vld1q_s32(synth80_lshift[t]),
+                                vld1q_s32(synth80_rshift[t]))));
+    hi = vaddq_s32(
+        hi,
+        vshlq_s32(vmull_s16(vget_high_s16(x), vld1_s16(synth80_coef[t] + 4)),
+                  vsubq_s32(vld1q_s32(synth80_lshift[t] + 4),
+                            vld1q_s32(synth80_rshift[t] + 4))));
+  }
+
+  /* pcm /= 32768, rounding towards zero */
+  lo = vaddq_s32(lo, vandq_s32(vshrq_n_s32(lo, 31), vdupq_n_s32(32767)));
+  hi = vaddq_s32(hi, vandq_s32(vshrq_n_s32(hi, 31), vdupq_n_s32(32767)));
+  vst1q_s16(out, vcombine_s16(vqmovn_s32(vshrq_n_s32(lo, 15)),
+                              vqmovn_s32(vshrq_n_s32(hi, 15))));
+#else
+  __m256i acc = _mm256_setzero_si256();
+  __m256i p;
+  __m128i x;
+
+  for (t = 0; t < 10; t++) {
+    b = buffer + 16 * (t >> 1);
+    x = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i*)(b + 5)),
+        _mm_loadu_si128(
+            (const __m128i*)((t & 1) ? synth80_odd : synth80_even)));
+    if ((t & 1) && t < 9) x = _mm_insert_epi16(x, b[20], 0);
+
+    p = _mm256_mullo_epi32(_mm256_cvtepi16_epi32(x),
+                           _mm256_cvtepi16_epi32(_mm_loadu_si128(
+                               (const __m128i*)synth80_coef[t])));
+    p = _mm256_sllv_epi32(
+        p, _mm256_loadu_si256((const __m256i*)synth80_lshift[t]));
+    p = _mm256_srav_epi32(
+        p, _mm256_loadu_si256((const __m256i*)synth80_rshift[t]));
+    acc = _mm256_add_epi32(acc, p);
+  }
+
+  /* pcm /= 32768, rounding towards zero */
+  acc = _mm256_add_epi32(acc, _mm256_and_si256(_mm256_srai_epi32(acc, 31),
+                                               _mm256_set1_epi32(32767)));
+  acc = _mm256_srai_epi32(acc, 15);
+  _mm_storeu_si128((__m128i*)out,
+                   _mm_packs_epi32(_mm256_castsi256_si128(acc),
+                                   _mm256_extracti128_si256(acc, 1)));
+#endif
+
+  for (j = 0; j < 8; j++) pcm[j << strideShift] = out[j];
+}
+
+SBC_SYNTH_TARGET PRIVATE void SynthWindow40_simd(
+    int16_t* pcm, SBC_BUFFER_T const* RESTRICT buffer, OI_UINT strideShift) {
+  uint8_t const* index;
+  int16_t out[4];
+  OI_UINT t, j;
+#ifdef SBC_SYNTH_NEON
+  int32x4_t acc = vdupq_n_s32(0);
+  int32x4_t x;
+
+  for (t = 0; t < 10; t++) {
+    index = synth40_index[t];
+    x = vdupq_n_s32(buffer[index[0]]);
+    x = vsetq_lane_s32(buffer[index[1]], x, 1);
+    x = vsetq_lane_s32(buffer[index[2]], x, 2);
+    x = vsetq_lane_s32(buffer[index[3]], x, 3);
+    acc = vmlaq_s32(acc, x, vld1q_s32(synth40_coef[t]));
+  }
+
+  /* SCALE(-pa, 15) */
+  acc = vaddq_s32(vnegq_s32(acc), vdupq_n_s32(1 << 14));
+  vst1_s16(out, vqmovn_s32(vshrq_n_s32(acc, 15)));
+#else
+  __m128i acc = _mm_setzero_si128();
+
+  for (t = 0; t < 10; t++) {
+    index = synth40_index[t];
+    acc = _mm_add_epi32(
+        acc,
+        _mm_mullo_epi32(_mm_setr_epi32(buffer[index[0]], buffer[index[1]],
+                                       buffer[index[2]], buffer[index[3]]),
+                        _mm_loadu_si128((const __m128i*)synth40_coef[t])));
+  }
+
+  /* SCALE(-pa, 15) */
+  acc = _mm_add_epi32(_mm_sub_epi32(_mm_setzero_si128(), acc),
+                      _mm_set1_epi32(1 << 14));
+  acc = _mm_srai_epi32(acc, 15);
+  _mm_storel_epi64((__m128i*)out, _mm_packs_epi32(acc, acc));
+#endif
+
+  for (j = 0; j < 4; j++) pcm[j << strideShift] = out[j];
+}
+
+#else
+
+/* Never selected, as OI_SBC_SynthSimdAvailable() is false */
+PRIVATE void SynthWindow80_simd(int16_t* pcm,
+                                SBC_BUFFER_T const* RESTRICT buffer,
+                                OI_UINT strideShift) {
+  SynthWindow80_generated(pcm, buffer, strideShift);
+}
+
+PRIVATE void SynthWindow40_simd(int16_t* pcm,
+                                SBC_BUFFER_T const* RESTRICT buffer,
+                                OI_UINT strideShift) {
+  SynthWindow40_int32_int32_symmetry_with_sum(pcm, (SBC_BUFFER_T*)buffer,
+                                              strideShift);
+}
+
+#endif /* SBC_SYNTH_NEON || SBC_SYNTH_AVX2 */
+
+PRIVATE OI_BOOL OI_SBC_SynthSimdAvailable(void) {
+#if defined(SBC_SYNTH_NEON)
+  return TRUE;
+#elif defined(SBC_SYNTH_AVX2)
+  return __builtin_cpu_supports("avx2") ? TRUE : FALSE;
+#else
+  return FALSE;
+#endif
+}
+
+/**@}*/
@@ -26,6 +26,26 @@
 #define SBC_FUNCDECLARE_H
 
 #include "sbc_encoder.h"
+
+/* The bit allocation and the 64 bit quantizer have NEON/SSE2 versions */
+#if (SBC_USE_SIMD == TRUE) && (SBC_ARM_ASM_OPT == FALSE)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__SSE2__)
+#define SBC_SIMD_ENC TRUE
+#endif
+#endif
+
+#ifndef SBC_SIMD_ENC
+#define SBC_SIMD_ENC FALSE
+#endif
+
+/* The specialized kernels are generic ones inlined with a constant frame
+ * layout */
+#if defined(__GNUC__)
+#define SBC_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define SBC_ALWAYS_INLINE inline
+#endif
+
 /* Global data */
 #if (SBC_IS_64_MULT_IN_WINDOW_ACCU == FALSE)
 extern const int16_t gas32CoeffFor4SBs[];
@@ -39,8 +59,25 @@ extern const int32_t gas32CoeffFor8SBs[];
 
 extern void sbc_enc_bit_alloc_mono(SBC_ENC_PARAMS* CodecParams);
 extern void sbc_enc_bit_alloc_ste(SBC_ENC_PARAMS* CodecParams);
+/* sbc_enc_bit_alloc_ste for 8 subbands and the loudness allocation */
+extern void sbc_enc_bit_alloc_ste_8_loudness(SBC_ENC_PARAMS* CodecParams);
+
+/* Set by SBC_Encoder_Init when the vectorized code and the packing by words
+ * are allowed */
+extern bool EncUseSimd;
+
+/* The vectorized versions read and write 8 values at a time, so the scale
+ * factor and bitneed arrays must hold 8 values from the pointers passed, or
+ * 16 for s32Len 16. */
+extern void SbcLoudnessBitNeed(const int16_t* ps16ScaleFactor,
+                               const int16_t* ps16Offset,
+                               int32_t s32NumOfSubBands, int16_t* ps16BitNeed);
+extern int32_t SbcMaxBitNeed(const int16_t* ps16BitNeed, int32_t s32Len);
+extern int32_t SbcBitSliceCount(const int16_t* ps16BitNeed, int32_t s32Len,
+                                int32_t s32BitSlice);
 
 extern void SbcAnalysisInit(void);
+extern bool SbcAnalysisHasSimd(void);
 
 extern void SbcAnalysisFilter4(SBC_ENC_PARAMS* strEncParams, int16_t* input);
 extern void SbcAnalysisFilter8(SBC_ENC_PARAMS* strEncParams, int16_t* input);
@@ -49,6 +86,9 @@ extern void SBC_FastIDCT8(int32_t* pInVect, int32_t* pOutVect);
 extern void SBC_FastIDCT4(int32_t* x0, int32_t* pOutVect);
 
 extern uint32_t EncPacking(SBC_ENC_PARAMS* strEncParams, uint8_t* output);
+/* Selects the packing of samples specialized for 8 subbands, 16 blocks and
+ * two channels if bA2dpLayout, the generic one otherwise */
+extern void EncPackingInit(bool bA2dpLayout);
 extern void EncQuantizer(SBC_ENC_PARAMS*);
 #if (SBC_DSP_OPT == TRUE)
 int32_t SBC_Multiply_32_16_Simplified(int32_t s32In2Temp, int32_t s32In1Temp);
@@ -138,6 +138,15 @@
 #define SBC_FAST_DCT TRUE
 #endif /*SBC_FAST_DCT */
 
+/* Set SBC_USE_SIMD to FALSE to never use the NEON/SSE2 window accumulation,
+ * bit allocation and quantizer. The window accumulation is only vectorized
+ * with SBC_IPAQ_OPT and the 32 bit accumulation, the quantizer only with the
+ * 64 bit quantizer. They all give the same result as the C code.
+ */
+#ifndef SBC_USE_SIMD
+#define SBC_USE_SIMD TRUE
+#endif /*SBC_USE_SIMD */
+
 /* In case we do not use joint stereo mode the flag save some RAM and ROM in
  * case it is set to FALSE */
 #ifndef SBC_JOINT_STE_INCLUDED
@@ -201,6 +210,19 @@ extern uint32_t SBC_Encode(SBC_ENC_PARAMS* strEncParams, int16_t* input,
                            uint8_t* output);
 extern void SBC_Encoder_Init(SBC_ENC_PARAMS* strEncParams);
 
+/* Allows or forbids the NEON/SSE2 analysis filter, bit allocation and
+ * quantizer, and the packing of samples by words, which are allowed by
+ * default. Forbidding them selects the reference C code, which gives the same
+ * frames. The choice is applied by the next SBC_Encoder_Init. Returns true if
+ * vectorized code is available in this build. */
+extern bool SBC_Encoder_Allow_Simd(bool allow);
+
+/* Allows or forbids the kernels specialized for 8 subbands, 16 blocks and
+ * stereo or joint stereo, the usual A2DP configuration, which are allowed by
+ * default. Forbidding them selects the generic kernels, which give the same
+ * frames. The choice is applied by the next SBC_Encoder_Init. */
+extern void SBC_Encoder_Allow_Specialized(bool allow);
+
 #ifdef __cplusplus
 }
 #endif
@@ -27,6 +27,23 @@
 #include "sbc_encoder.h"
 /*#include <math.h>*/
 
+/* The 32 bit IPAQ window accumulation only sums 16 x 16 bit products, which
+ * NEON and SSE2 compute with the same wrap around as the C code */
+#if (SBC_USE_SIMD == TRUE) && (SBC_ARM_ASM_OPT == FALSE) && \
+    (SBC_IPAQ_OPT == TRUE) && (SBC_IS_64_MULT_IN_WINDOW_ACCU == FALSE)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SBC_SIMD_WINDOW_ACCU TRUE
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SBC_SIMD_WINDOW_ACCU TRUE
+#endif
+#endif
+
+#ifndef SBC_SIMD_WINDOW_ACCU
+#define SBC_SIMD_WINDOW_ACCU FALSE
+#endif
+
 #if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
 #define WIND_4_SUBBANDS_0_1                                              \
   (int32_t)0x01659F45 /* gas32CoeffFor4SBs[8] = -gas32CoeffFor4SBs[32] = \
@@ -1185,6 +1202,95 @@ static int16_t* s16X =
 #endif
 #endif
 
+#if (SBC_SIMD_WINDOW_ACCU == TRUE)
+/* The IPAQ window accumulations above, rearranged so that
+ * s32DCTY[k] = sum(as16WindowSimdN[j][k] * s16X[ChOffset + j * 2N + k]) over
+ * the five rows j. The differences of WINDOW_ACCU_x_0 become negated
+ * coefficients and the sums of WINDOW_ACCU_x_N become repeated ones, which is
+ * the same modulo 2^32. */
+#define WIND_SIMD_ROW_4(j, jr, c0, c4)                                   \
+  {                                                                      \
+    c0, WIND_4_SUBBANDS_1_##j, WIND_4_SUBBANDS_2_##j,                    \
+        WIND_4_SUBBANDS_3_##j, c4, WIND_4_SUBBANDS_3_##jr,               \
+        WIND_4_SUBBANDS_2_##jr, WIND_4_SUBBANDS_1_##jr                   \
+  }
+#define WIND_SIMD_ROW_8(j, jr, c0, c8)                                   \
+  {                                                                      \
+    c0, WIND_8_SUBBANDS_1_##j, WIND_8_SUBBANDS_2_##j,                    \
+        WIND_8_SUBBANDS_3_##j, WIND_8_SUBBANDS_4_##j,                    \
+        WIND_8_SUBBANDS_5_##j, WIND_8_SUBBANDS_6_##j,                    \
+        WIND_8_SUBBANDS_7_##j, c8, WIND_8_SUBBANDS_7_##jr,               \
+        WIND_8_SUBBANDS_6_##jr, WIND_8_SUBBANDS_5_##jr,                  \
+        WIND_8_SUBBANDS_4_##jr, WIND_8_SUBBANDS_3_##jr,                  \
+        WIND_8_SUBBANDS_2_##jr, WIND_8_SUBBANDS_1_##jr                   \
+  }
+
+static const int16_t as16WindowSimd4[5][2 * SUB_BANDS_4]
+    __attribute__((aligned(16))) = {
+        WIND_SIMD_ROW_4(0, 4, 0, WIND_4_SUBBANDS_4_0),
+        WIND_SIMD_ROW_4(1, 3, WIND_4_SUBBANDS_0_1, WIND_4_SUBBANDS_4_1),
+        WIND_SIMD_ROW_4(2, 2, WIND_4_SUBBANDS_0_2, WIND_4_SUBBANDS_4_2),
+        WIND_SIMD_ROW_4(3, 1, -WIND_4_SUBBANDS_0_2, WIND_4_SUBBANDS_4_1),
+        WIND_SIMD_ROW_4(4, 0, -WIND_4_SUBBANDS_0_1, WIND_4_SUBBANDS_4_0),
+};
+
+static const int16_t as16WindowSimd8[5][2 * SUB_BANDS_8]
+    __attribute__((aligned(16))) = {
+        WIND_SIMD_ROW_8(0, 4, 0, WIND_8_SUBBANDS_8_0),
+        WIND_SIMD_ROW_8(1, 3, WIND_8_SUBBANDS_0_1, WIND_8_SUBBANDS_8_1),
+        WIND_SIMD_ROW_8(2, 2, WIND_8_SUBBANDS_0_2, WIND_8_SUBBANDS_8_2),
+        WIND_SIMD_ROW_8(3, 1, -WIND_8_SUBBANDS_0_2, WIND_8_SUBBANDS_8_1),
+        WIND_SIMD_ROW_8(4, 0, -WIND_8_SUBBANDS_0_1, WIND_8_SUBBANDS_8_0),
+};
+
+/****************************************************************************
+* SbcWindowAccuSimd - window accumulation of s32Len outputs, 8 at a time
+*
+* RETURNS : N/A
+*/
+static void SbcWindowAccuSimd(const int16_t* ps16X, const int16_t* ps16Coeff,
+                              int32_t s32Len, int32_t* ps32DCTY) {
+  int32_t i, j;
+
+  for (i = 0; i < s32Len; i += 8) {
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    int16x8_t x = vld1q_s16(ps16X + i);
+    int16x8_t c = vld1q_s16(ps16Coeff + i);
+    int32x4_t lo = vmull_s16(vget_low_s16(x), vget_low_s16(c));
+    int32x4_t hi = vmull_s16(vget_high_s16(x), vget_high_s16(c));
+
+    for (j = 1; j < 5; j++) {
+      x = vld1q_s16(ps16X + j * s32Len + i);
+      c = vld1q_s16(ps16Coeff + j * s32Len + i);
+      lo = vmlal_s16(lo, vget_low_s16(x), vget_low_s16(c));
+      hi = vmlal_s16(hi, vget_high_s16(x), vget_high_s16(c));
+    }
+
+    vst1q_s32(ps32DCTY + i, lo);
+    vst1q_s32(ps32DCTY + i + 4, hi);
+#else
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+
+    for (j = 0; j < 5; j++) {
+      __m128i x = _mm_loadu_si128((const __m128i*)(ps16X + j * s32Len + i));
+      __m128i c = _mm_load_si128((const __m128i*)(ps16Coeff + j * s32Len + i));
+      __m128i prod_lo = _mm_mullo_epi16(x, c);
+      __m128i prod_hi = _mm_mulhi_epi16(x, c);
+      lo = _mm_add_epi32(lo, _mm_unpacklo_epi16(prod_lo, prod_hi));
+      hi = _mm_add_epi32(hi, _mm_unpackhi_epi16(prod_lo, prod_hi));
+    }
+
+    _mm_storeu_si128((__m128i*)(ps32DCTY + i), lo);
+    _mm_storeu_si128((__m128i*)(ps32DCTY + i + 4), hi);
+#endif
+  }
+}
+#endif
+
+static bool SbcUseSimd = false;
+extern bool EncAllowSimd;
+
 static int16_t ShiftCounter = 0;
 extern int16_t EncMaxShiftCounter;
 /****************************************************************************
@@ -1257,7 +1363,13 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
     for (s32Ch = 0; s32Ch < s32NumOfChannels; s32Ch++) {
       ChOffset = s32Ch * Offset2 + Offset;
 
-      WINDOW_PARTIAL_4
+#if (SBC_SIMD_WINDOW_ACCU == TRUE)
+      if (SbcUseSimd)
+        SbcWindowAccuSimd(&s16X[ChOffset], as16WindowSimd4[0],
+                          2 * SUB_BANDS_4, s32DCTY);
+      else
+#endif
+        WINDOW_PARTIAL_4
 
       SBC_FastIDCT4(s32DCTY, ps32SbBuf);
 
@@ -1370,7 +1482,13 @@ void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
     for (s32Ch = 0; s32Ch < s32NumOfChannels; s32Ch++) {
       ChOffset = s32Ch * Offset2 + Offset;
 
-      WINDOW_PARTIAL_8
+#if (SBC_SIMD_WINDOW_ACCU == TRUE)
+      if (SbcUseSimd)
+        SbcWindowAccuSimd(&s16X[ChOffset], as16WindowSimd8[0],
+                          2 * SUB_BANDS_8, s32DCTY);
+      else
+#endif
+        WINDOW_PARTIAL_8
 
       SBC_FastIDCT8(s32DCTY, ps32SbBuf);
 
@@ -1397,4 +1515,7 @@ void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
 void SbcAnalysisInit(void) {
   memset(s16X, 0, ENC_VX_BUFFER_SIZE * sizeof(int16_t));
   ShiftCounter = 0;
+  SbcUseSimd = EncAllowSimd && SbcAnalysisHasSimd();
 }
+
+bool SbcAnalysisHasSimd(void) { return SBC_SIMD_WINDOW_ACCU == TRUE; }
@@ -27,6 +27,14 @@
 #include "sbc_enc_func_declare.h"
 #include "sbc_encoder.h"
 
+#if (SBC_SIMD_ENC == TRUE)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#else
+#include <emmintrin.h>
+#endif
+#endif
+
 /*global arrays*/
 const int16_t sbc_enc_as16Offset4[4][4] = {
     {-1, 0, 0, 0}, {-2, 0, 0, 1}, {-2, 0, 0, 1}, {-2, 0, 0, 1}};
@@ -35,6 +43,198 @@ const int16_t sbc_enc_as16Offset8[4][8] = {{-2, 0, 0, 0, 0, 0, 0, 1},
                                            {-4, 0, 0, 0, 0, 0, 1, 2},
                                            {-4, 0, 0, 0, 0, 0, 1, 2}};
 
+#if (SBC_SIMD_ENC == TRUE)
+static const int16_t as16LaneIndex[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+/* Lanes of the 8 values from s32Offset that are below s32Len */
+static uint16x8_t SbcLanesBelow(int32_t s32Offset, int32_t s32Len) {
+  return vcltq_s16(vld1q_s16(as16LaneIndex),
+                   vdupq_n_s16((int16_t)(s32Len - s32Offset)));
+}
+#else
+static __m128i SbcLanesBelow(int32_t s32Offset, int32_t s32Len) {
+  return _mm_cmpgt_epi16(_mm_set1_epi16((int16_t)(s32Len - s32Offset)),
+                         _mm_loadu_si128((const __m128i*)as16LaneIndex));
+}
+#endif
+#endif
+
+/****************************************************************************
+* SbcLoudnessBitNeed - bitneed of the subbands of one channel with the
+* loudness allocation, from their scale factors and offsets
+*
+* RETURNS : N/A
+*/
+void SbcLoudnessBitNeed(const int16_t* ps16ScaleFactor,
+                        const int16_t* ps16Offset, int32_t s32NumOfSubBands,
+                        int16_t* ps16BitNeed) {
+  int32_t s32Sb;
+  int32_t s32Loudness;
+
+#if (SBC_SIMD_ENC == TRUE)
+  if (EncUseSimd) {
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    int16x8_t scf = vld1q_s16(ps16ScaleFactor);
+    int16x8_t offset = (s32NumOfSubBands == SUB_BANDS_8)
+                           ? vld1q_s16(ps16Offset)
+                           : vcombine_s16(vld1_s16(ps16Offset), vdup_n_s16(0));
+    int16x8_t loudness = vsubq_s16(scf, offset);
+    int16x8_t bitneed = vbslq_s16(vcgtq_s16(loudness, vdupq_n_s16(0)),
+                                  vshrq_n_s16(loudness, 1), loudness);
+    bitneed = vbslq_s16(vceqq_s16(scf, vdupq_n_s16(0)), vdupq_n_s16(-5),
+                        bitneed);
+    vst1q_s16(ps16BitNeed, bitneed);
+#else
+    __m128i scf = _mm_loadu_si128((const __m128i*)ps16ScaleFactor);
+    __m128i offset = (s32NumOfSubBands == SUB_BANDS_8)
+                         ? _mm_loadu_si128((const __m128i*)ps16Offset)
+                         : _mm_loadl_epi64((const __m128i*)ps16Offset);
+    __m128i loudness = _mm_sub_epi16(scf, offset);
+    __m128i positive = _mm_cmpgt_epi16(loudness, _mm_setzero_si128());
+    __m128i bitneed =
+        _mm_or_si128(_mm_and_si128(positive, _mm_srai_epi16(loudness, 1)),
+                     _mm_andnot_si128(positive, loudness));
+    __m128i zero = _mm_cmpeq_epi16(scf, _mm_setzero_si128());
+    bitneed = _mm_or_si128(_mm_and_si128(zero, _mm_set1_epi16(-5)),
+                           _mm_andnot_si128(zero, bitneed));
+    _mm_storeu_si128((__m128i*)ps16BitNeed, bitneed);
+#endif
+    return;
+  }
+#endif
+
+  for (s32Sb = 0; s32Sb < s32NumOfSubBands; s32Sb++) {
+    if (ps16ScaleFactor[s32Sb] == 0)
+      ps16BitNeed[s32Sb] = -5;
+    else {
+      s32Loudness = (int32_t)(ps16ScaleFactor[s32Sb] - ps16Offset[s32Sb]);
+      if (s32Loudness > 0)
+        ps16BitNeed[s32Sb] = (int16_t)(s32Loudness >> 1);
+      else
+        ps16BitNeed[s32Sb] = (int16_t)s32Loudness;
+    }
+  }
+}
+
+/****************************************************************************
+* SbcMaxBitNeed - largest of s32Len bitneeds
+*
+* RETURNS : the largest bitneed, or 0 if they are all negative
+*/
+int32_t SbcMaxBitNeed(const int16_t* ps16BitNeed, int32_t s32Len) {
+  int32_t s32Sb;
+  int32_t s32MaxBitNeed = 0;
+
+#if (SBC_SIMD_ENC == TRUE)
+  if (EncUseSimd) {
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    int16x8_t max = vdupq_n_s16(0);
+    int16x4_t max4;
+
+    for (s32Sb = 0; s32Sb < s32Len; s32Sb += 8) {
+      int16x8_t bitneed = vld1q_s16(ps16BitNeed + s32Sb);
+      bitneed = vbslq_s16(SbcLanesBelow(s32Sb, s32Len), bitneed,
+                          vdupq_n_s16(0));
+      max = vmaxq_s16(max, bitneed);
+    }
+    max4 = vmax_s16(vget_low_s16(max), vget_high_s16(max));
+    max4 = vpmax_s16(max4, max4);
+    max4 = vpmax_s16(max4, max4);
+    return vget_lane_s16(max4, 0);
+#else
+    __m128i max = _mm_setzero_si128();
+
+    for (s32Sb = 0; s32Sb < s32Len; s32Sb += 8) {
+      __m128i bitneed = _mm_loadu_si128((const __m128i*)(ps16BitNeed + s32Sb));
+      bitneed = _mm_and_si128(SbcLanesBelow(s32Sb, s32Len), bitneed);
+      max = _mm_max_epi16(max, bitneed);
+    }
+    max = _mm_max_epi16(max, _mm_shuffle_epi32(max, _MM_SHUFFLE(1, 0, 3, 2)));
+    max = _mm_max_epi16(max, _mm_shuffle_epi32(max, _MM_SHUFFLE(2, 3, 0, 1)));
+    max = _mm_max_epi16(max, _mm_srli_epi32(max, 16));
+    return (int16_t)_mm_cvtsi128_si32(max);
+#endif
+  }
+#endif
+
+  for (s32Sb = 0; s32Sb < s32Len; s32Sb++) {
+    if (ps16BitNeed[s32Sb] > s32MaxBitNeed) s32MaxBitNeed = ps16BitNeed[s32Sb];
+  }
+  return s32MaxBitNeed;
+}
+
+/****************************************************************************
+* SbcBitSliceCount - bits taken by the bitslice s32BitSlice of s32Len
+* subbands
+*
+* RETURNS : the number of bits
+*/
+int32_t SbcBitSliceCount(const int16_t* ps16BitNeed, int32_t s32Len,
+                         int32_t s32BitSlice) {
+  int32_t s32Sb;
+  int32_t s32SliceCount = 0;
+
+#if (SBC_SIMD_ENC == TRUE)
+  if (EncUseSimd) {
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    int16x8_t slice = vdupq_n_s16((int16_t)s32BitSlice);
+    int16x8_t first = vdupq_n_s16((int16_t)(s32BitSlice + 1));
+    int16x8_t end = vdupq_n_s16((int16_t)(s32BitSlice + 16));
+    int16x8_t count = vdupq_n_s16(0);
+    int64x2_t sum;
+
+    /* Lanes are -1 when true, the first bit of a subband counts twice */
+    for (s32Sb = 0; s32Sb < s32Len; s32Sb += 8) {
+      int16x8_t bitneed = vld1q_s16(ps16BitNeed + s32Sb);
+      uint16x8_t valid = SbcLanesBelow(s32Sb, s32Len);
+      uint16x8_t in = vandq_u16(vandq_u16(vcgtq_s16(bitneed, slice),
+                                          vcltq_s16(bitneed, end)),
+                                valid);
+      uint16x8_t one = vandq_u16(vceqq_s16(bitneed, first), valid);
+      count = vaddq_s16(count, vreinterpretq_s16_u16(in));
+      count = vaddq_s16(count, vreinterpretq_s16_u16(one));
+    }
+    sum = vpaddlq_s32(vpaddlq_s16(count));
+    return -(int32_t)(vgetq_lane_s64(sum, 0) + vgetq_lane_s64(sum, 1));
+#else
+    __m128i slice = _mm_set1_epi16((int16_t)s32BitSlice);
+    __m128i first = _mm_set1_epi16((int16_t)(s32BitSlice + 1));
+    __m128i end = _mm_set1_epi16((int16_t)(s32BitSlice + 16));
+    __m128i count = _mm_setzero_si128();
+
+    /* Lanes are -1 when true, the first bit of a subband counts twice */
+    for (s32Sb = 0; s32Sb < s32Len; s32Sb += 8) {
+      __m128i bitneed = _mm_loadu_si128((const __m128i*)(ps16BitNeed + s32Sb));
+      __m128i valid = SbcLanesBelow(s32Sb, s32Len);
+      __m128i in = _mm_and_si128(_mm_cmpgt_epi16(bitneed, slice),
+                                 _mm_cmplt_epi16(bitneed, end));
+      __m128i one = _mm_cmpeq_epi16(bitneed, first);
+      count = _mm_add_epi16(count, _mm_and_si128(in, valid));
+      count = _mm_add_epi16(count, _mm_and_si128(one, valid));
+    }
+    count = _mm_madd_epi16(count, _mm_set1_epi16(1));
+    count = _mm_add_epi32(count, _mm_shuffle_epi32(count,
+                                                   _MM_SHUFFLE(1, 0, 3, 2)));
+    count = _mm_add_epi32(count, _mm_shuffle_epi32(count,
+                                                   _MM_SHUFFLE(2, 3, 0, 1)));
+    return -_mm_cvtsi128_si32(count);
+#endif
+  }
+#endif
+
+  for (s32Sb = 0; s32Sb < s32Len; s32Sb++) {
+    if (((ps16BitNeed[s32Sb] - s32BitSlice) < 16) &&
+        (ps16BitNeed[s32Sb] - s32BitSlice) >= 1) {
+      if ((ps16BitNeed[s32Sb] - s32BitSlice) == 1)
+        s32SliceCount += 2;
+      else
+        s32SliceCount++;
+    }
+  }
+  return s32SliceCount;
+}
+
 /****************************************************************************
 * BitAlloc - Calculates the required number of bits for the given scale factor
 * and the number of subbands.
@@ -50,7 +250,6 @@ void sbc_enc_bit_alloc_mono(SBC_ENC_PARAMS* pstrCodecParams) {
   int32_t s32Sb;         /*counter for sub-band*/
   int32_t s32Ch;         /*counter for channel*/
   int16_t* ps16BitNeed;  /*temp memory to store required number of bits*/
-  int32_t s32Loudness;   /*used in Loudness calculation*/
   int16_t* ps16GenBufPtr;
   int16_t* ps16GenArrPtr;
   int16_t* ps16GenTabPtr;
@@ -75,34 +274,14 @@ void sbc_enc_bit_alloc_mono(SBC_ENC_PARAMS* pstrCodecParams) {
         ps16GenTabPtr =
             (int16_t*)sbc_enc_as16Offset8[pstrCodecParams->s16SamplingFreq];
       }
-      for (s32Sb = 0; s32Sb < s32NumOfSubBands; s32Sb++) {
-        if (pstrCodecParams
-                ->as16ScaleFactor[s32Ch * s32NumOfSubBands + s32Sb] == 0)
-          *(ps16GenBufPtr) = -5;
-        else {
-          s32Loudness = (int32_t)(
-              pstrCodecParams
-                  ->as16ScaleFactor[s32Ch * s32NumOfSubBands + s32Sb] -
-              *ps16GenTabPtr);
-          if (s32Loudness > 0)
-            *(ps16GenBufPtr) = (int16_t)(s32Loudness >> 1);
-          else
-            *(ps16GenBufPtr) = (int16_t)s32Loudness;
-        }
-        ps16GenBufPtr++;
-        ps16GenTabPtr++;
-      }
+      SbcLoudnessBitNeed(
+          pstrCodecParams->as16ScaleFactor + s32Ch * s32NumOfSubBands,
+          ps16GenTabPtr, s32NumOfSubBands, ps16GenBufPtr);
     }
 
     /* max bitneed index is searched*/
-    s32MaxBitNeed = 0;
-    ps16GenBufPtr = ps16BitNeed + s32Ch * s32NumOfSubBands;
-    for (s32Sb = 0; s32Sb < s32NumOfSubBands; s32Sb++) {
-      if (*(ps16GenBufPtr) > s32MaxBitNeed) s32MaxBitNeed = *(ps16GenBufPtr);
-
-      ps16GenBufPtr++;
-    }
     ps16GenBufPtr = ps16BitNeed + s32Ch * s32NumOfSubBands;
+    s32MaxBitNeed = SbcMaxBitNeed(ps16GenBufPtr, s32NumOfSubBands);
     /*iterative process to find hwo many bitslices fit into the bitpool*/
     s32BitSlice = s32MaxBitNeed + 1;
     s32BitCount = pstrCodecParams->s16BitPool;
@@ -110,20 +289,8 @@ void sbc_enc_bit_alloc_mono(SBC_ENC_PARAMS* pstrCodecParams) {
     do {
       s32BitSlice--;
       s32BitCount -= s32SliceCount;
-      s32SliceCount = 0;
-
-      for (s32Sb = 0; s32Sb < s32NumOfSubBands; s32Sb++) {
-        if ((((*ps16GenBufPtr - s32BitSlice) < 16) &&
-             (*ps16GenBufPtr - s32BitSlice) >= 1)) {
-          if ((*ps16GenBufPtr - s32BitSlice) == 1)
-            s32SliceCount += 2;
-          else
-            s32SliceCount++;
-        }
-        ps16GenBufPtr++;
-
-      } /*end of for*/
-      ps16GenBufPtr = ps16BitNeed + s32Ch * s32NumOfSubBands;
+      s32SliceCount =
+          SbcBitSliceCount(ps16GenBufPtr, s32NumOfSubBands, s32BitSlice);
     } while (s32BitCount - s32SliceCount > 0);
 
     if (s32BitCount == 0) {
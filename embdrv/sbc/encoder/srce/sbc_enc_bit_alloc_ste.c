@@ -35,10 +35,15 @@ extern const int16_t sbc_enc_as16Offset8[4][8];
 * BitAlloc - Calculates the required number of bits for the given scale factor
 * and the number of subbands.
 *
+* The number of subbands and the allocation method are passed as arguments so
+* that sbc_enc_bit_alloc_ste_8_loudness is specialized by the compiler.
+*
 * RETURNS : N/A
 */
 
-void sbc_enc_bit_alloc_ste(SBC_ENC_PARAMS* pstrCodecParams) {
+static SBC_ALWAYS_INLINE void SbcBitAllocSte(SBC_ENC_PARAMS* pstrCodecParams,
+                                             int32_t s32NumOfSubBands,
+                                             bool bLoudness) {
   /* CAUTIOM -> mips optim for arm 32 require to use int32_t instead of int16_t
    */
   /* Do not change variable type or name */
@@ -49,21 +54,18 @@ void sbc_enc_bit_alloc_ste(SBC_ENC_PARAMS* pstrCodecParams) {
   int32_t s32Sb;         /*counter for sub-band*/
   int32_t s32Ch;         /*counter for channel*/
   int16_t* ps16BitNeed;  /*temp memory to store required number of bits*/
-  int32_t s32Loudness;   /*used in Loudness calculation*/
   int16_t *ps16GenBufPtr, *pas16ScaleFactor;
   int16_t* ps16GenArrPtr;
   int16_t* ps16GenTabPtr;
-  int32_t s32NumOfSubBands = pstrCodecParams->s16NumOfSubBands;
   int32_t s32BitPool = pstrCodecParams->s16BitPool;
 
   /* bitneed values are derived from scale factor */
-  if (pstrCodecParams->s16AllocationMethod == SBC_SNR) {
+  if (!bLoudness) {
     ps16BitNeed = pstrCodecParams->as16ScaleFactor;
     s32MaxBitNeed = pstrCodecParams->s16MaxBitNeed;
   } else {
     ps16BitNeed = pstrCodecParams->s16ScartchMemForBitAlloc;
     pas16ScaleFactor = pstrCodecParams->as16ScaleFactor;
-    s32MaxBitNeed = 0;
     ps16GenBufPtr = ps16BitNeed;
     for (s32Ch = 0; s32Ch < 2; s32Ch++) {
       if (s32NumOfSubBands == 4) {
@@ -74,24 +76,12 @@ void sbc_enc_bit_alloc_ste(SBC_ENC_PARAMS* pstrCodecParams) {
             (int16_t*)sbc_enc_as16Offset8[pstrCodecParams->s16SamplingFreq];
       }
 
-      for (s32Sb = 0; s32Sb < s32NumOfSubBands; s32Sb++) {
-        if (*pas16ScaleFactor == 0)
-          *ps16GenBufPtr = -5;
-        else {
-          s32Loudness = (int32_t)(*pas16ScaleFactor - *ps16GenTabPtr);
-
-          if (s32Loudness > 0)
-            *ps16GenBufPtr = (int16_t)(s32Loudness >> 1);
-          else
-            *ps16GenBufPtr = (int16_t)s32Loudness;
-        }
-
-        if (*ps16GenBufPtr > s32MaxBitNeed) s32MaxBitNeed = *ps16GenBufPtr;
-        pas16ScaleFactor++;
-        ps16GenBufPtr++;
-        ps16GenTabPtr++;
-      }
+      SbcLoudnessBitNeed(pas16ScaleFactor, ps16GenTabPtr, s32NumOfSubBands,
+                         ps16GenBufPtr);
+      pas16ScaleFactor += s32NumOfSubBands;
+      ps16GenBufPtr += s32NumOfSubBands;
     }
+    s32MaxBitNeed = SbcMaxBitNeed(ps16BitNeed, 2 * s32NumOfSubBands);
   }
 
   /* iterative process to find out hwo many bitslices fit into the bitpool */
@@ -101,19 +91,8 @@ void sbc_enc_bit_alloc_ste(SBC_ENC_PARAMS* pstrCodecParams) {
   do {
     s32BitSlice--;
     s32BitCount -= s32SliceCount;
-    s32SliceCount = 0;
-    ps16GenBufPtr = ps16BitNeed;
-
-    for (s32Sb = 0; s32Sb < 2 * s32NumOfSubBands; s32Sb++) {
-      if ((*ps16GenBufPtr >= s32BitSlice + 1) &&
-          (*ps16GenBufPtr < s32BitSlice + 16)) {
-        if (*(ps16GenBufPtr) == s32BitSlice + 1)
-          s32SliceCount += 2;
-        else
-          s32SliceCount++;
-      }
-      ps16GenBufPtr++;
-    }
+    s32SliceCount =
+        SbcBitSliceCount(ps16BitNeed, 2 * s32NumOfSubBands, s32BitSlice);
   } while (s32BitCount - s32SliceCount > 0);
 
   if (s32BitCount - s32SliceCount == 0) {
@@ -184,4 +163,13 @@ void sbc_enc_bit_alloc_ste(SBC_ENC_PARAMS* pstrCodecParams) {
   }
 }
 
+void sbc_enc_bit_alloc_ste(SBC_ENC_PARAMS* pstrCodecParams) {
+  SbcBitAllocSte(pstrCodecParams, pstrCodecParams->s16NumOfSubBands,
+                 pstrCodecParams->s16AllocationMethod != SBC_SNR);
+}
+
+void sbc_enc_bit_alloc_ste_8_loudness(SBC_ENC_PARAMS* pstrCodecParams) {
+  SbcBitAllocSte(pstrCodecParams, SUB_BANDS_8, true);
+}
+
 /*End of BitAlloc() function*/
@@ -28,14 +28,42 @@
 #include "sbc_enc_func_declare.h"
 
 int16_t EncMaxShiftCounter;
+bool EncAllowSimd = true;
+bool EncUseSimd = false;
+static bool EncAllowSpecialized = true;
 
 #if (SBC_JOINT_STE_INCLUDED == TRUE)
 int32_t s32LRDiff[SBC_MAX_NUM_OF_BLOCKS] = {0};
 int32_t s32LRSum[SBC_MAX_NUM_OF_BLOCKS] = {0};
 #endif
 
-uint32_t SBC_Encode(SBC_ENC_PARAMS* pstrEncParams, int16_t* input,
-                    uint8_t* output) {
+/****************************************************************************
+* SbcScaleFactor - returns the scale factor of a subband whose largest sample
+* magnitude is s32MaxValue
+*
+* RETURNS : the scale factor, 0 to 15
+*/
+static SBC_ALWAYS_INLINE uint32_t SbcScaleFactor(int32_t s32MaxValue) {
+  uint32_t u32Count = (s32MaxValue > 0x800000) ? 9 : 0;
+
+  for (; u32Count < 15; u32Count++) {
+    if (s32MaxValue <= (int32_t)(0x8000 << u32Count)) break;
+  }
+  return u32Count;
+}
+
+/****************************************************************************
+* SbcEncScaleFactors - computes the scale factors and the joint stereo
+* decision of a frame, and the max bit need
+*
+* The frame layout is passed as arguments so that the kernels below are
+* specialized by the compiler for constant layouts.
+*
+* RETURNS : N/A
+*/
+static SBC_ALWAYS_INLINE void SbcEncScaleFactors(
+    SBC_ENC_PARAMS* pstrEncParams, int32_t s32NumOfSubBands,
+    int32_t s32NumOfChannels, int32_t s32NumOfBlocks, bool bJoint) {
   int32_t s32Ch;                 /* counter for ch*/
   int32_t s32Sb;                 /* counter for sub-band*/
   uint32_t u32Count, maxBit = 0; /* loop count*/
@@ -44,23 +72,15 @@ uint32_t SBC_Encode(SBC_ENC_PARAMS* pstrEncParams, int16_t* input,
   int16_t* ps16ScfL;
   int32_t* SbBuffer;
   int32_t s32Blk; /* counter for block*/
-  int32_t s32NumOfBlocks = pstrEncParams->s16NumOfBlocks;
 #if (SBC_JOINT_STE_INCLUDED == TRUE)
   int32_t s32MaxValue2;
   uint32_t u32CountSum, u32CountDiff;
   int32_t *pSum, *pDiff;
 #endif
-  register int32_t s32NumOfSubBands = pstrEncParams->s16NumOfSubBands;
-
-  /* SBC ananlysis filter*/
-  if (s32NumOfSubBands == 4)
-    SbcAnalysisFilter4(pstrEncParams, input);
-  else
-    SbcAnalysisFilter8(pstrEncParams, input);
 
   /* compute the scale factor, and save the max */
   ps16ScfL = pstrEncParams->as16ScaleFactor;
-  s32Ch = pstrEncParams->s16NumOfChannels * s32NumOfSubBands;
+  s32Ch = s32NumOfChannels * s32NumOfSubBands;
 
   for (s32Sb = 0; s32Sb < s32Ch; s32Sb++) {
     SbBuffer = pstrEncParams->s32SbBuffer + s32Sb;
@@ -70,18 +90,14 @@ uint32_t SBC_Encode(SBC_ENC_PARAMS* pstrEncParams, int16_t* input,
       SbBuffer += s32Ch;
     }
 
-    u32Count = (s32MaxValue > 0x800000) ? 9 : 0;
-
-    for (; u32Count < 15; u32Count++) {
-      if (s32MaxValue <= (int32_t)(0x8000 << u32Count)) break;
-    }
+    u32Count = SbcScaleFactor(s32MaxValue);
     *ps16ScfL++ = (int16_t)u32Count;
 
     if (u32Count > maxBit) maxBit = u32Count;
   }
 /* In case of JS processing,check whether to use JS */
 #if (SBC_JOINT_STE_INCLUDED == TRUE)
-  if (pstrEncParams->s16ChannelMode == SBC_JOINT_STEREO) {
+  if (bJoint) {
     /* Calculate sum and differance  scale factors for making JS decision   */
     ps16ScfL = pstrEncParams->as16ScaleFactor;
     /* calculate the scale factor of Joint stereo max sum and diff */
@@ -100,16 +116,8 @@ uint32_t SBC_Encode(SBC_ENC_PARAMS* pstrEncParams, int16_t* input,
         pDiff++;
         SbBuffer += s32Ch;
       }
-      u32Count = (s32MaxValue > 0x800000) ? 9 : 0;
-      for (; u32Count < 15; u32Count++) {
-        if (s32MaxValue <= (int32_t)(0x8000 << u32Count)) break;
-      }
-      u32CountSum = u32Count;
-      u32Count = (s32MaxValue2 > 0x800000) ? 9 : 0;
-      for (; u32Count < 15; u32Count++) {
-        if (s32MaxValue2 <= (int32_t)(0x8000 << u32Count)) break;
-      }
-      u32CountDiff = u32Count;
+      u32CountSum = SbcScaleFactor(s32MaxValue);
+      u32CountDiff = SbcScaleFactor(s32MaxValue2);
       if ((*ps16ScfL + *(ps16ScfL + s32NumOfSubBands)) >
           (int16_t)(u32CountSum + u32CountDiff)) {
         if (u32CountSum > maxBit) maxBit = u32CountSum;
@@ -143,13 +151,86 @@ uint32_t SBC_Encode(SBC_ENC_PARAMS* pstrEncParams, int16_t* input,
 #endif
 
   pstrEncParams->s16MaxBitNeed = (int16_t)maxBit;
+}
 
-  /* bit allocation */
+static void SbcEncScaleFactorsGeneric(SBC_ENC_PARAMS* pstrEncParams) {
+  SbcEncScaleFactors(pstrEncParams, pstrEncParams->s16NumOfSubBands,
+                     pstrEncParams->s16NumOfChannels,
+                     pstrEncParams->s16NumOfBlocks,
+                     pstrEncParams->s16ChannelMode == SBC_JOINT_STEREO);
+}
+
+/* 8 subbands, 16 blocks, joint stereo or stereo: the A2DP configurations */
+static void SbcEncScaleFactors8x16Joint(SBC_ENC_PARAMS* pstrEncParams) {
+  SbcEncScaleFactors(pstrEncParams, SUB_BANDS_8, 2, SBC_BLOCK_3, true);
+}
+
+static void SbcEncScaleFactors8x16Stereo(SBC_ENC_PARAMS* pstrEncParams) {
+  SbcEncScaleFactors(pstrEncParams, SUB_BANDS_8, 2, SBC_BLOCK_3, false);
+}
+
+static void SbcEncBitAllocGeneric(SBC_ENC_PARAMS* pstrEncParams) {
   if ((pstrEncParams->s16ChannelMode == SBC_STEREO) ||
       (pstrEncParams->s16ChannelMode == SBC_JOINT_STEREO))
     sbc_enc_bit_alloc_ste(pstrEncParams);
   else
     sbc_enc_bit_alloc_mono(pstrEncParams);
+}
+
+/* Kernels of the configuration given to SBC_Encoder_Init */
+static void (*EncAnalysisFilter)(SBC_ENC_PARAMS*, int16_t*) =
+    SbcAnalysisFilter8;
+static void (*EncScaleFactors)(SBC_ENC_PARAMS*) = SbcEncScaleFactorsGeneric;
+static void (*EncBitAlloc)(SBC_ENC_PARAMS*) = SbcEncBitAllocGeneric;
+
+/****************************************************************************
+* SbcEncSelectKernels - selects the kernels for the configuration of
+* pstrEncParams, the specialized ones for the frequent A2DP configuration
+* when allowed and the generic ones otherwise
+*
+* RETURNS : N/A
+*/
+static void SbcEncSelectKernels(const SBC_ENC_PARAMS* pstrEncParams) {
+  bool bA2dpLayout = EncAllowSpecialized &&
+                     pstrEncParams->s16NumOfSubBands == SUB_BANDS_8 &&
+                     pstrEncParams->s16NumOfBlocks == SBC_BLOCK_3 &&
+                     pstrEncParams->s16NumOfChannels == 2 &&
+                     pstrEncParams->s16ChannelMode != SBC_DUAL;
+
+  EncAnalysisFilter = (pstrEncParams->s16NumOfSubBands == 4)
+                          ? SbcAnalysisFilter4
+                          : SbcAnalysisFilter8;
+
+  EncScaleFactors = SbcEncScaleFactorsGeneric;
+  EncBitAlloc = SbcEncBitAllocGeneric;
+  if (bA2dpLayout) {
+#if (SBC_JOINT_STE_INCLUDED == TRUE)
+    if (pstrEncParams->s16ChannelMode == SBC_JOINT_STEREO)
+      EncScaleFactors = SbcEncScaleFactors8x16Joint;
+    else
+      EncScaleFactors = SbcEncScaleFactors8x16Stereo;
+#else
+    EncScaleFactors = SbcEncScaleFactors8x16Stereo;
+#endif
+    if (pstrEncParams->s16AllocationMethod == SBC_LOUDNESS)
+      EncBitAlloc = sbc_enc_bit_alloc_ste_8_loudness;
+    else
+      EncBitAlloc = sbc_enc_bit_alloc_ste;
+  }
+
+  EncPackingInit(bA2dpLayout);
+}
+
+uint32_t SBC_Encode(SBC_ENC_PARAMS* pstrEncParams, int16_t* input,
+                    uint8_t* output) {
+  /* SBC ananlysis filter*/
+  EncAnalysisFilter(pstrEncParams, input);
+
+  /* compute the scale factors and the joint stereo decision */
+  EncScaleFactors(pstrEncParams);
+
+  /* bit allocation */
+  EncBitAlloc(pstrEncParams);
 
   /* Quantize the encoded audio */
   return EncPacking(pstrEncParams, output);
@@ -254,5 +335,27 @@ void SBC_Encoder_Init(SBC_ENC_PARAMS* pstrEncParams) {
       EncMaxShiftCounter = ((ENC_VX_BUFFER_SIZE - 8 * 10 * 2) >> 4) << 3;
   }
 
+  EncUseSimd = EncAllowSimd;
   SbcAnalysisInit();
+  SbcEncSelectKernels(pstrEncParams);
 }
+
+/****************************************************************************
+* SBC_Encoder_Allow_Simd - Allows the vectorized code and the packing by words
+*                          from the next SBC_Encoder_Init on
+*
+* RETURNS : true if vectorized code is built in
+*/
+bool SBC_Encoder_Allow_Simd(bool allow) {
+  EncAllowSimd = allow;
+  return SbcAnalysisHasSimd() || (SBC_SIMD_ENC == TRUE);
+}
+
+/****************************************************************************
+* SBC_Encoder_Allow_Specialized - Allows the kernels specialized for 8
+*                                 subbands and 16 blocks from the next
+*                                 SBC_Encoder_Init on
+*
+* RETURNS : N/A
+*/
+void SBC_Encoder_Allow_Specialized(bool allow) { EncAllowSpecialized = allow; }
@@ -25,6 +25,18 @@
 #include "sbc_enc_func_declare.h"
 #include "sbc_encoder.h"
 
+/* Only the 64 bit quantizer is vectorized */
+#if (SBC_SIMD_ENC == TRUE) && (SBC_IS_64_MULT_IN_QUANTIZER == TRUE)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#else
+#include <emmintrin.h>
+#endif
+#define SBC_SIMD_QUANTIZER TRUE
+#else
+#define SBC_SIMD_QUANTIZER FALSE
+#endif
+
 #if (SBC_ARM_ASM_OPT == TRUE)
 #define Mult32(s32In1, s32In2, s32OutLow)    \
   {                                          \
@@ -51,6 +63,251 @@
   }
 #endif
 
+/* The quantizer tables repeat the values of each subband every s32Sb lanes,
+ * over 16 lanes so that a vector of 8 lanes always starts at the same
+ * subband for 4, 8 and 16 subbands per block. */
+#define SBC_QUANT_LANES 16
+
+#if (SBC_SIMD_QUANTIZER == TRUE) && \
+    (defined(__ARM_NEON) || defined(__ARM_NEON__))
+/****************************************************************************
+* EncQuantize4 - quantizes 4 subband samples with the 64 bit quantizer
+*
+* The 64 bit product a * levels of EncPacking is (a >> 16) * levels * 2^16 +
+* (a & 0xffff) * levels, and bits scf + 14 and up of the product are those of
+* scf and up of hi * 4 + (lo >> 14) modulo 2^32, since a quantized value has
+* 16 bits at most.
+*
+* RETURNS : N/A
+*/
+static void EncQuantize4(const int32_t* ps32Sb, const int32_t* ps32Offset,
+                         const int32_t* ps32Levels, const int32_t* ps32Shift,
+                         uint16_t* pu16Quant) {
+  int32x4_t a = vaddq_s32(vshrq_n_s32(vld1q_s32(ps32Sb), 2),
+                          vld1q_s32(ps32Offset));
+  int32x4_t levels = vld1q_s32(ps32Levels);
+  int32x4_t hi = vmulq_s32(vshrq_n_s32(a, 16), levels);
+  uint32x4_t lo =
+      vmulq_u32(vandq_u32(vreinterpretq_u32_s32(a), vdupq_n_u32(0xffff)),
+                vreinterpretq_u32_s32(levels));
+  uint32x4_t t =
+      vaddq_u32(vshlq_n_u32(vreinterpretq_u32_s32(hi), 2), vshrq_n_u32(lo, 14));
+
+  /* ps32Shift holds -scf, a negative shift is to the right */
+  vst1_u16(pu16Quant, vmovn_u32(vshlq_u32(t, vld1q_s32(ps32Shift))));
+}
+#endif
+
+/****************************************************************************
+* EncQuantizeSamples - quantizes the subband samples of a frame like the
+* reference packing loop of EncPacking, including the samples of the
+* subbands without bits, for s32Sb subbands of all channels per block
+*
+* RETURNS : N/A
+*/
+static SBC_ALWAYS_INLINE void EncQuantizeSamples(SBC_ENC_PARAMS* pstrEncParams,
+                                                 uint16_t* pu16Quant,
+                                                 int32_t s32Sb,
+                                                 int32_t s32NumOfBlocks) {
+  int32_t s32Len = s32NumOfBlocks * s32Sb;
+  const int32_t* ps32SbPtr = pstrEncParams->s32SbBuffer;
+  int32_t as32Offset[SBC_QUANT_LANES] __attribute__((aligned(16)));
+  int32_t as32Levels[SBC_QUANT_LANES] __attribute__((aligned(16)));
+  int32_t as32Scf[SBC_QUANT_LANES] __attribute__((aligned(16)));
+  int32_t s32Lane, i;
+
+  for (s32Lane = 0; s32Lane < SBC_QUANT_LANES; s32Lane++) {
+    int32_t s32Scf = pstrEncParams->as16ScaleFactor[s32Lane % s32Sb];
+    int32_t s32Bits = pstrEncParams->as16Bits[s32Lane % s32Sb];
+
+#if (SBC_IS_64_MULT_IN_QUANTIZER == TRUE)
+    as32Offset[s32Lane] = (int32_t)((uint32_t)1 << (s32Scf + 13));
+#else
+    as32Offset[s32Lane] = (int32_t)((uint32_t)1 << s32Scf);
+#endif
+    as32Levels[s32Lane] = (int32_t)(((uint32_t)1 << s32Bits) - 1);
+    as32Scf[s32Lane] = s32Scf;
+  }
+
+#if (SBC_SIMD_QUANTIZER == TRUE)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+  for (s32Lane = 0; s32Lane < SBC_QUANT_LANES; s32Lane++)
+    as32Scf[s32Lane] = -as32Scf[s32Lane];
+
+  for (i = 0; i < s32Len; i += 4) {
+    s32Lane = i % SBC_QUANT_LANES;
+    EncQuantize4(ps32SbPtr + i, as32Offset + s32Lane, as32Levels + s32Lane,
+                 as32Scf + s32Lane, pu16Quant + i);
+  }
+#else
+  /* SSE2 has no 32 bit multiply or per lane shift, so the products are made
+   * of 16 bit ones as in Mult64 of EncPacking. The shift right by scf of
+   * t = hi * 4 + (lo >> 14) is (t >> 16) * 2^(16 - scf) + (t & 0xffff) *
+   * 2^(16 - scf) / 2^16 on 16 bits, except for scf 0. */
+  int16_t as16Levels[SBC_QUANT_LANES] __attribute__((aligned(16)));
+  int16_t as16Mult[SBC_QUANT_LANES] __attribute__((aligned(16)));
+  int16_t as16ScfZero[SBC_QUANT_LANES] __attribute__((aligned(16)));
+
+  for (s32Lane = 0; s32Lane < SBC_QUANT_LANES; s32Lane++) {
+    as16Levels[s32Lane] = (int16_t)as32Levels[s32Lane];
+    as16Mult[s32Lane] = (int16_t)((uint32_t)1 << (16 - as32Scf[s32Lane]));
+    as16ScfZero[s32Lane] = (as32Scf[s32Lane] == 0) ? -1 : 0;
+  }
+
+  for (i = 0; i < s32Len; i += 8) {
+    s32Lane = i % SBC_QUANT_LANES;
+    __m128i a0 = _mm_add_epi32(
+        _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(ps32SbPtr + i)), 2),
+        _mm_load_si128((const __m128i*)(as32Offset + s32Lane)));
+    __m128i a1 = _mm_add_epi32(
+        _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(ps32SbPtr + i + 4)),
+                       2),
+        _mm_load_si128((const __m128i*)(as32Offset + s32Lane + 4)));
+    __m128i levels = _mm_load_si128((const __m128i*)(as16Levels + s32Lane));
+    __m128i mult = _mm_load_si128((const __m128i*)(as16Mult + s32Lane));
+    __m128i zero = _mm_load_si128((const __m128i*)(as16ScfZero + s32Lane));
+
+    /* a & 0xffff and a >> 16 on 16 bits */
+    __m128i a_lo = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a0, 16), 16),
+                                   _mm_srai_epi32(_mm_slli_epi32(a1, 16), 16));
+    __m128i a_hi = _mm_packs_epi32(_mm_srai_epi32(a0, 16),
+                                   _mm_srai_epi32(a1, 16));
+
+    /* Unsigned products of the low halves, signed ones of the high halves */
+    __m128i lo_lo = _mm_mullo_epi16(a_lo, levels);
+    __m128i lo_hi = _mm_mulhi_epu16(a_lo, levels);
+    __m128i hi_lo = _mm_mullo_epi16(a_hi, levels);
+    __m128i hi_hi =
+        _mm_sub_epi16(_mm_mulhi_epu16(a_hi, levels),
+                      _mm_and_si128(_mm_srai_epi16(a_hi, 15), levels));
+
+    __m128i t0 =
+        _mm_add_epi32(_mm_slli_epi32(_mm_unpacklo_epi16(hi_lo, hi_hi), 2),
+                      _mm_srli_epi32(_mm_unpacklo_epi16(lo_lo, lo_hi), 14));
+    __m128i t1 =
+        _mm_add_epi32(_mm_slli_epi32(_mm_unpackhi_epi16(hi_lo, hi_hi), 2),
+                      _mm_srli_epi32(_mm_unpackhi_epi16(lo_lo, lo_hi), 14));
+    __m128i t_lo = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(t0, 16), 16),
+                                   _mm_srai_epi32(_mm_slli_epi32(t1, 16), 16));
+    __m128i t_hi = _mm_packs_epi32(_mm_srai_epi32(t0, 16),
+                                   _mm_srai_epi32(t1, 16));
+
+    __m128i quant = _mm_or_si128(_mm_mullo_epi16(t_hi, mult),
+                                 _mm_mulhi_epu16(t_lo, mult));
+    quant = _mm_or_si128(_mm_andnot_si128(zero, quant),
+                         _mm_and_si128(zero, t_lo));
+    _mm_storeu_si128((__m128i*)(pu16Quant + i), quant);
+  }
+#endif
+#else
+  for (i = 0; i < s32Len; i++) {
+    s32Lane = i % SBC_QUANT_LANES;
+#if (SBC_IS_64_MULT_IN_QUANTIZER == TRUE)
+    int32_t s32Temp = (ps32SbPtr[i] >> 2) + as32Offset[s32Lane];
+    pu16Quant[i] = (uint16_t)(((int64_t)s32Temp * as32Levels[s32Lane]) >>
+                              (as32Scf[s32Lane] + 14));
+#else
+    uint32_t u32Temp = (uint32_t)((ps32SbPtr[i] >> 15) + as32Offset[s32Lane]);
+    pu16Quant[i] = (uint16_t)((int32_t)(u32Temp * as32Levels[s32Lane]) >>
+                              (as32Scf[s32Lane] + 1));
+#endif
+  }
+#endif
+}
+
+/****************************************************************************
+* EncPackSamples - packs the quantized samples of a frame after the bits in
+* *pu8Temp, 32 bits at a time
+*
+* Like the reference packing loop, the bits of a quantized value above its
+* bit count are or'ed into the byte being filled, which is only written when
+* the next value starts. It is the same as masking samples, which fit in
+* their bits unless the scale factor is saturated.
+*
+* RETURNS : the pointer to the last byte, partially filled as by the
+*           reference loop
+*/
+static SBC_ALWAYS_INLINE uint8_t* EncPackSamples(
+    SBC_ENC_PARAMS* pstrEncParams, const uint16_t* pu16Quant,
+    uint8_t* pu8PacketPtr, uint8_t* pu8Temp, int32_t* ps32PresentBit,
+    int32_t s32Sb, int32_t s32NumOfBlocks) {
+  int32_t s32Blk, s32Ch;
+  /* Bits to write, nbits of them, the last byte being filled has cur */
+  uint64_t u64Acc;
+  uint32_t u32Bits, u32Cur;
+
+  u32Cur = 8 - *ps32PresentBit;
+  u32Bits = u32Cur;
+  u64Acc = *pu8Temp & ((1u << u32Cur) - 1);
+
+  for (s32Blk = 0; s32Blk < s32NumOfBlocks; s32Blk++) {
+    for (s32Ch = 0; s32Ch < s32Sb; s32Ch++) {
+      uint32_t u32Count = pstrEncParams->as16Bits[s32Ch];
+      uint32_t u32Value = *pu16Quant++;
+      if (u32Count == 0) continue;
+
+      u64Acc = (u64Acc << u32Count) |
+               (u32Value & ((1u << (u32Count + u32Cur)) - 1));
+      u32Bits += u32Count;
+      u32Cur = ((u32Cur + u32Count - 1) & 7) + 1;
+
+      if (u32Bits - u32Cur >= 32) {
+        uint32_t u32Word = (uint32_t)(u64Acc >> (u32Bits - 32));
+        pu8PacketPtr[0] = (uint8_t)(u32Word >> 24);
+        pu8PacketPtr[1] = (uint8_t)(u32Word >> 16);
+        pu8PacketPtr[2] = (uint8_t)(u32Word >> 8);
+        pu8PacketPtr[3] = (uint8_t)u32Word;
+        pu8PacketPtr += 4;
+        u32Bits -= 32;
+      }
+    }
+  }
+
+  while (u32Bits > u32Cur) {
+    u32Bits -= 8;
+    *pu8PacketPtr++ = (uint8_t)(u64Acc >> u32Bits);
+  }
+  *pu8Temp = (uint8_t)(u64Acc & ((1u << u32Bits) - 1));
+  *ps32PresentBit = 8 - u32Bits;
+  return pu8PacketPtr;
+}
+
+typedef uint8_t* (*tENC_PACK_SAMPLES)(SBC_ENC_PARAMS* pstrEncParams,
+                                     uint8_t* pu8PacketPtr, uint8_t* pu8Temp,
+                                     int32_t* ps32PresentBit);
+
+static uint8_t* EncPackSamplesGeneric(SBC_ENC_PARAMS* pstrEncParams,
+                                      uint8_t* pu8PacketPtr, uint8_t* pu8Temp,
+                                      int32_t* ps32PresentBit) {
+  int32_t s32Sb =
+      pstrEncParams->s16NumOfChannels * pstrEncParams->s16NumOfSubBands;
+  uint16_t au16Quant[SBC_MAX_NUM_OF_CHANNELS * SBC_MAX_NUM_OF_SUBBANDS *
+                     SBC_MAX_NUM_OF_BLOCKS];
+
+  EncQuantizeSamples(pstrEncParams, au16Quant, s32Sb,
+                     pstrEncParams->s16NumOfBlocks);
+  return EncPackSamples(pstrEncParams, au16Quant, pu8PacketPtr, pu8Temp,
+                        ps32PresentBit, s32Sb, pstrEncParams->s16NumOfBlocks);
+}
+
+/* 8 subbands of two channels and 16 blocks */
+static uint8_t* EncPackSamples8x16(SBC_ENC_PARAMS* pstrEncParams,
+                                   uint8_t* pu8PacketPtr, uint8_t* pu8Temp,
+                                   int32_t* ps32PresentBit) {
+  uint16_t au16Quant[2 * SUB_BANDS_8 * SBC_BLOCK_3];
+
+  EncQuantizeSamples(pstrEncParams, au16Quant, 2 * SUB_BANDS_8, SBC_BLOCK_3);
+  return EncPackSamples(pstrEncParams, au16Quant, pu8PacketPtr, pu8Temp,
+                        ps32PresentBit, 2 * SUB_BANDS_8, SBC_BLOCK_3);
+}
+
+static tENC_PACK_SAMPLES EncPackSamplesKernel = EncPackSamplesGeneric;
+
+void EncPackingInit(bool bA2dpLayout) {
+  EncPackSamplesKernel =
+      bA2dpLayout ? EncPackSamples8x16 : EncPackSamplesGeneric;
+}
+
 /* return number of bytes written to output */
 uint32_t EncPacking(SBC_ENC_PARAMS* pstrEncParams, uint8_t* output) {
   uint8_t* pu8PacketPtr; /* packet ptr*/
@@ -126,82 +383,87 @@ uint32_t EncPacking(SBC_ENC_PARAMS* pstrEncParams, uint8_t* output) {
   }
 
   /* Pack samples */
-  ps32SbPtr = pstrEncParams->s32SbBuffer;
-  /*Temp=*pu8PacketPtr;*/
-  s32NumOfBlocks = pstrEncParams->s16NumOfBlocks;
-  for (s32Blk = s32NumOfBlocks - 1; s32Blk >= 0; s32Blk--) {
-    ps16GenPtr = pstrEncParams->as16Bits;
-    ps16ScfPtr = pstrEncParams->as16ScaleFactor;
-    for (s32Ch = s32Sb - 1; s32Ch >= 0; s32Ch--) {
-      s32LoopCount = *ps16GenPtr++;
-      if (s32LoopCount != 0) {
+  if (EncUseSimd) {
+    pu8PacketPtr = EncPackSamplesKernel(pstrEncParams, pu8PacketPtr, &Temp,
+                                        &s32PresentBit);
+  } else {
+    ps32SbPtr = pstrEncParams->s32SbBuffer;
+    /*Temp=*pu8PacketPtr;*/
+    s32NumOfBlocks = pstrEncParams->s16NumOfBlocks;
+    for (s32Blk = s32NumOfBlocks - 1; s32Blk >= 0; s32Blk--) {
+      ps16GenPtr = pstrEncParams->as16Bits;
+      ps16ScfPtr = pstrEncParams->as16ScaleFactor;
+      for (s32Ch = s32Sb - 1; s32Ch >= 0; s32Ch--) {
+        s32LoopCount = *ps16GenPtr++;
+        if (s32LoopCount != 0) {
 #if (SBC_IS_64_MULT_IN_QUANTIZER == TRUE)
-        /* finding level from reconstruction part of decoder */
-        u32SfRaisedToPow2 = ((uint32_t)1 << ((*ps16ScfPtr) + 1));
-        u16Levels = (uint16_t)(((uint32_t)1 << s32LoopCount) - 1);
+          /* finding level from reconstruction part of decoder */
+          u32SfRaisedToPow2 = ((uint32_t)1 << ((*ps16ScfPtr) + 1));
+          u16Levels = (uint16_t)(((uint32_t)1 << s32LoopCount) - 1);
 
-        /* quantizer */
-        s32Temp1 = (*ps32SbPtr >> 2) + (u32SfRaisedToPow2 << 12);
-        s32Temp2 = u16Levels;
+          /* quantizer */
+          s32Temp1 = (*ps32SbPtr >> 2) + (u32SfRaisedToPow2 << 12);
+          s32Temp2 = u16Levels;
 
-        Mult64(s32Temp1, s32Temp2, s32Low, s32Hi);
+          Mult64(s32Temp1, s32Temp2, s32Low, s32Hi);
 
-        s32Low1 = s32Low >> ((*ps16ScfPtr) + 2);
-        s32Low1 &= ((uint32_t)1 << (32 - ((*ps16ScfPtr) + 2))) - 1;
-        s32Hi1 = s32Hi << (32 - ((*ps16ScfPtr) + 2));
+          s32Low1 = s32Low >> ((*ps16ScfPtr) + 2);
+          s32Low1 &= ((uint32_t)1 << (32 - ((*ps16ScfPtr) + 2))) - 1;
+          s32Hi1 = s32Hi << (32 - ((*ps16ScfPtr) + 2));
 
-        u32QuantizedSbValue0 = (uint16_t)((s32Low1 | s32Hi1) >> 12);
+          u32QuantizedSbValue0 = (uint16_t)((s32Low1 | s32Hi1) >> 12);
 #else
-        /* finding level from reconstruction part of decoder */
-        u32SfRaisedToPow2 = ((uint32_t)1 << *ps16ScfPtr);
-        u16Levels = (uint16_t)(((uint32_t)1 << s32LoopCount) - 1);
-
-        /* quantizer */
-        s32Temp1 = (*ps32SbPtr >> 15) + u32SfRaisedToPow2;
-        Mult32(s32Temp1, u16Levels, s32Low);
-        s32Low >>= (*ps16ScfPtr + 1);
-        u32QuantizedSbValue0 = (uint16_t)s32Low;
+          /* finding level from reconstruction part of decoder */
+          u32SfRaisedToPow2 = ((uint32_t)1 << *ps16ScfPtr);
+          u16Levels = (uint16_t)(((uint32_t)1 << s32LoopCount) - 1);
+
+          /* quantizer */
+          s32Temp1 = (*ps32SbPtr >> 15) + u32SfRaisedToPow2;
+          Mult32(s32Temp1, u16Levels, s32Low);
+          s32Low >>= (*ps16ScfPtr + 1);
+          u32QuantizedSbValue0 = (uint16_t)s32Low;
 #endif
-        /*store the number of bits required and the quantized s32Sb
-        sample to ease the coding*/
-        u32QuantizedSbValue = u32QuantizedSbValue0;
+          /*store the number of bits required and the quantized s32Sb
+          sample to ease the coding*/
+          u32QuantizedSbValue = u32QuantizedSbValue0;
 
-        if (s32PresentBit >= s32LoopCount) {
-          Temp <<= s32LoopCount;
-          Temp |= u32QuantizedSbValue;
-          s32PresentBit -= s32LoopCount;
-        } else {
-          while (s32PresentBit < s32LoopCount) {
-            s32LoopCount -= s32PresentBit;
-            u32QuantizedSbValue >>= s32LoopCount;
+          if (s32PresentBit >= s32LoopCount) {
+            Temp <<= s32LoopCount;
+            Temp |= u32QuantizedSbValue;
+            s32PresentBit -= s32LoopCount;
+          } else {
+            while (s32PresentBit < s32LoopCount) {
+              s32LoopCount -= s32PresentBit;
+              u32QuantizedSbValue >>= s32LoopCount;
 
-            /*remove the unwanted msbs*/
-            /*u32QuantizedSbValue <<= 16 - s32PresentBit;
-            u32QuantizedSbValue >>= 16 - s32PresentBit;*/
+              /*remove the unwanted msbs*/
+              /*u32QuantizedSbValue <<= 16 - s32PresentBit;
+              u32QuantizedSbValue >>= 16 - s32PresentBit;*/
 
-            Temp <<= s32PresentBit;
+              Temp <<= s32PresentBit;
 
-            Temp |= u32QuantizedSbValue;
-            /*restore the original*/
-            u32QuantizedSbValue = u32QuantizedSbValue0;
+              Temp |= u32QuantizedSbValue;
+              /*restore the original*/
+              u32QuantizedSbValue = u32QuantizedSbValue0;
 
-            *(pu8PacketPtr++) = Temp;
-            Temp = 0;
-            s32PresentBit = 8;
-          }
-          Temp <<= s32LoopCount;
+              *(pu8PacketPtr++) = Temp;
+              Temp = 0;
+              s32PresentBit = 8;
+            }
+            Temp <<= s32LoopCount;
 
-          /* remove the unwanted msbs */
-          /*u32QuantizedSbValue <<= 16 - s32LoopCount;
-          u32QuantizedSbValue >>= 16 - s32LoopCount;*/
+            /* remove the unwanted msbs */
+            /*u32QuantizedSbValue <<= 16 - s32LoopCount;
+            u32QuantizedSbValue >>= 16 - s32LoopCount;*/
 
-          Temp |= u32QuantizedSbValue;
+            Temp |= u32QuantizedSbValue;
 
-          s32PresentBit -= s32LoopCount;
+            s32PresentBit -= s32LoopCount;
+          }
         }
+        ps16ScfPtr++;
+        ps32SbPtr++;
       }
-      ps16ScfPtr++;
-      ps32SbPtr++;
     }
   }
 
@@ -101,4 +101,8 @@ const hci_t* hci_layer_get_test_interface(
 void post_to_hci_message_loop(const base::Location& from_here,
                               BT_HDR* p_msg);
 
+// Dumps the command round trip times, the received event counts and the
+// transport read statistics to |fd|.
+void hci_layer_debug_dump(int fd);
+
 void hci_layer_cleanup_interface();
@@ -18,7 +18,13 @@
 
 #define LOG_TAG "bt_snoop"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 #include <arpa/inet.h>
 #include <base/logging.h>
@@ -31,6 +37,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/uio.h>
@@ -85,6 +92,9 @@
   #define DEFAULT_BTSNOOP_PATH "btsnoop_hci.log"
 #endif  //OFF_TARGET_TEST_ENABLED
 #define BTSNOOP_MAX_PACKETS_PROPERTY "persist.bluetooth.btsnoopsize"
+// Size (in KiB) of the circular capture file, 0 rotates regular log files
+#define BTSNOOP_CIRCULAR_SIZE_PROPERTY "persist.bluetooth.btsnoopcircularsize"
+#define BTSNOOP_CIRCULAR_MAX_SIZE_KB (64 * 1024)
 
 typedef enum {
   kCommandPacket = 1,
@@ -139,6 +149,61 @@ static const char *cpbr_pattern = "\x0d\x0a+CPBR:";
 
 static uint8_t packet[DEFAULT_PACKET_SIZE];
 
+typedef struct {
+  uint32_t length_original;
+  uint32_t length_captured;
+  uint32_t flags;
+  uint32_t dropped_packets;
+  uint64_t timestamp;
+  uint8_t type;
+} __attribute__((__packed__)) btsnoop_header_t;
+
+// Bytes of packet records waiting for the writer thread. A packet that does
+// not fit is dropped and counted in the header of the next records.
+#ifndef BTSNOOP_RING_SIZE
+#define BTSNOOP_RING_SIZE (512 * 1024)
+#endif
+
+// Longest the writer thread waits for the log fd to become writable
+#define BTSNOOP_WRITE_TIMEOUT_MS 100
+
+// Records are queued by the capturing thread (one at a time, under
+// btsnoop_mutex) and written by the writer thread, in the same format as the
+// log file. The positions only grow; the ring offset is the position modulo
+// the ring size.
+static std::unique_ptr<uint8_t[]> ring_buf;
+static std::atomic<uint64_t> ring_head;  // End of the queued records
+static std::atomic<uint64_t> ring_tail;  // End of the written records
+static std::atomic<uint32_t> dropped_packets;
+
+static std::thread writer_thread;
+static std::mutex writer_mutex;
+static std::condition_variable writer_cv;
+static std::atomic<bool> writer_idle;
+static bool writer_stop;  // Guarded by writer_mutex
+
+// A circular capture file is a header followed by a data area holding the
+// latest records, in the log file format. As with the ring above, positions
+// only grow and the data offset is the position modulo the data size. The
+// records from |first_record| to |end| are complete; tools/scripts/
+// btsnoop_circular.py turns them into a regular log file.
+#define BTSNOOP_CIRCULAR_MAGIC "btsnpcrc"
+#define BTSNOOP_CIRCULAR_VERSION 1
+#define BTSNOOP_CIRCULAR_HEADER_SIZE 64
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;  // Offset of the data area
+  uint64_t data_size;
+  uint64_t first_record;  // Position of the oldest record
+  uint64_t end;           // Position after the newest record
+} __attribute__((__packed__)) btsnoop_circular_header_t;
+
+static int circular_fd = INVALID_FD;
+static uint8_t* circular_map;  // Guarded by btsnoop_mutex
+static size_t circular_map_size;
+
 // Channel tracking variables for filtering.
 
 // Keeps track of L2CAP channels that need to be filtered out of the snoop
@@ -179,24 +244,53 @@ class FilterTracker {
 
   void addRfcDlci(uint8_t channel) { rfc_channels.insert(channel); }
 
-  bool isWhitelistedL2c(bool local, uint16_t cid) {
+  bool isWhitelistedL2c(bool local, uint16_t cid) const {
     const auto& set = local ? l2c_local_cid : l2c_remote_cid;
     return (set.find(cid) != set.end());
   }
 
-  bool isRfcChannel(bool local, uint16_t cid) {
+  bool isRfcChannel(bool local, uint16_t cid) const {
     const auto& channel = local ? rfc_local_cid : rfc_remote_cid;
     return cid == channel;
   }
 
-  bool isWhitelistedDlci(uint8_t dlci) {
+  bool isWhitelistedDlci(uint8_t dlci) const {
     return rfc_channels.find(dlci) != rfc_channels.end();
   }
 };
 
+// The filter tables read for every logged packet are published as immutable
+// snapshots. Writers change their table under its mutex and then swap in a
+// copy; the logging path reads the current copy without taking a lock. Since
+// packets are logged under btsnoop_mutex, no packet still reads the previous
+// copy once the writer has taken that mutex after the swap, and it is freed.
+template <typename Table>
+class TableSnapshot {
+ public:
+  TableSnapshot() : current_(new Table()) {}
+
+  // Only valid while btsnoop_mutex is held
+  const Table& get() const {
+    return *current_.load(std::memory_order_acquire);
+  }
+
+  // Must be called without btsnoop_mutex held
+  void publish(Table table) {
+    const Table* previous = current_.exchange(new Table(std::move(table)),
+                                              std::memory_order_acq_rel);
+    { std::lock_guard<std::mutex> lock(btsnoop_mutex); }
+    delete previous;
+  }
+
+ private:
+  std::atomic<const Table*> current_;
+};
+
 std::mutex filter_list_mutex;
 std::unordered_map<uint16_t, FilterTracker> filter_list;
 std::unordered_map<uint16_t, uint16_t> local_cid_to_acl;
+static TableSnapshot<std::unordered_map<uint16_t, FilterTracker>>
+    filter_list_snapshot;
 
 typedef enum {
   FILTER_PROFILE_NONE = -1,
@@ -219,6 +313,29 @@ typedef enum {
 #define PROFILE_UUID_HFP_HS 0x1112
 #define PROFILE_UUID_HFP_HF 0x111f
 
+// What the profiles filter does with the packets of an L2CAP channel or an
+// RFCOMM server channel, precomputed when channels open and close.
+struct ChannelDecision {
+  bool filtered = false;  // The payload is stripped
+  bool flow_ext = false;  // Frames carry a control field or a credit
+  bool hfp = false;       // Only phone book responses are stripped
+};
+
+// Decisions of the channels of one connection. The L2CAP channels are
+// indexed like the |local| argument of ProfilesFilter.
+struct ProfilesDecisions {
+  uint16_t rfc_cid[2] = {0, 0};
+  std::unordered_map<uint16_t, ChannelDecision> l2cap[2];
+  ChannelDecision rfcomm[32];  // By server channel number
+
+  const ChannelDecision& l2capChannel(bool local, uint16_t cid) const {
+    static const ChannelDecision kNotFiltered;
+    const auto& channels = l2cap[local];
+    auto it = channels.find(cid);
+    return it != channels.end() ? it->second : kNotFiltered;
+  }
+};
+
 class ProfilesFilter {
   public:
     ProfilesFilter() {
@@ -227,6 +344,8 @@ class ProfilesFilter {
         profiles[i].enabled = false;
         profiles[i].rfcomm_opened = false;
         profiles[i].l2cap_opened = false;
+        profiles[i].lcid = profiles[i].rcid = 0;
+        profiles[i].scn = 0;
       }
       if (pbap_filtered) {
         profiles[FILTER_PROFILE_PBAP].enabled =
@@ -236,36 +355,35 @@ class ProfilesFilter {
       if (map_filtered) {
         profiles[FILTER_PROFILE_MAP].enabled = true;
       }
-      ch_rfc_l = ch_rfc_r = ch_last = 0;
-    }
-
-    bool isHfpProfile(bool local, uint16_t cid, uint8_t dlci) {
-      profile_type_t profile = dlci2profile(local, cid, dlci);
-
-      return profile == FILTER_PROFILE_HFP_HS ||
-              profile == FILTER_PROFILE_HFP_HF;
-    }
-
-    bool isL2capMatch(bool local, uint16_t cid) {
-      return cid2profile(local, cid) != FILTER_PROFILE_NONE;
+      ch_rfc_l = ch_rfc_r = 0;
     }
 
-    bool isL2capFlowExt(bool local, uint16_t cid) {
-      profile_type_t profile = cid2profile(local, cid);
-      if (profile >= 0)
-        return profiles[profile].flow_ext_l2cap;
-      return false;
-    }
-
-    bool isRfcommMatch(bool local, uint16_t cid, uint8_t dlci) {
-      return dlci2profile(local, cid, dlci) != FILTER_PROFILE_NONE;
-    }
+    // Decisions of the logging path for the channels opened so far. The
+    // first matching profile wins, as in cid2profile() and dlci2profile().
+    ProfilesDecisions decisions() const {
+      ProfilesDecisions result;
 
-    bool isRfcommFlowExt(bool local, uint16_t cid, uint8_t dlci) {
-      profile_type_t profile = dlci2profile(local, cid, dlci);
-      if (profile >= 0)
-        return profiles[profile].flow_ext_rfcomm;
-      return false;
+      result.rfc_cid[false] = ch_rfc_r;
+      result.rfc_cid[true] = ch_rfc_l;
+      for (int i = 0; i < FILTER_PROFILE_MAX; i++) {
+        if (!profiles[i].enabled || !profiles[i].l2cap_opened) continue;
+
+        ChannelDecision l2cap;
+        l2cap.filtered = true;
+        l2cap.flow_ext = profiles[i].flow_ext_l2cap;
+        result.l2cap[false].emplace(profiles[i].rcid, l2cap);
+        result.l2cap[true].emplace(profiles[i].lcid, l2cap);
+
+        if (!profiles[i].rfcomm_opened || profiles[i].scn >= 32) continue;
+        ChannelDecision& rfcomm = result.rfcomm[profiles[i].scn];
+        if (!rfcomm.filtered) {
+          rfcomm.filtered = true;
+          rfcomm.flow_ext = profiles[i].flow_ext_rfcomm;
+          rfcomm.hfp = profiles[i].type == FILTER_PROFILE_HFP_HS ||
+                       profiles[i].type == FILTER_PROFILE_HFP_HF;
+        }
+      }
+      return result;
     }
 
     profile_type_t cid2profile(bool local, uint16_t cid) {
@@ -338,7 +456,6 @@ class ProfilesFilter {
     }
 
     uint16_t ch_rfc_l, ch_rfc_r;  // local & remote L2CAP channel for RFCOMM
-    uint16_t ch_last;             // last channel seen for fragment packet
 
 private:
     struct {
@@ -352,6 +469,12 @@ private:
 
 std::mutex profiles_filter_mutex;
 std::unordered_map<int16_t, ProfilesFilter> profiles_filter_table;
+static TableSnapshot<std::unordered_map<uint16_t, ProfilesDecisions>>
+    profiles_filter_snapshot;
+
+// Last channel seen on each connection, for continuation fragments. Guarded
+// by btsnoop_mutex.
+static uint16_t profiles_last_cid[HANDLE_MASK + 1];
 
 // Cached value for whether full snoop logs are enabled. So the property isn't
 // checked for every packet.
@@ -367,10 +490,21 @@ static bool is_avdt_media_packet(const uint8_t *p, bool is_local_cid);
 
 static void delete_btsnoop_files(bool filtered);
 static std::string get_btsnoop_log_path(bool filtered);
+static std::string get_btsnoop_circular_path(bool filtered);
 static std::string get_btsnoop_last_log_path(std::string log_path);
 static void open_next_snoop_file();
 static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
                                  bool is_received, uint64_t timestamp_us);
+static void ring_copy_in(uint8_t* ring, size_t ring_size, uint64_t position,
+                         const void* data, size_t length);
+static void ring_copy_out(const uint8_t* ring, size_t ring_size,
+                          uint64_t position, void* data, size_t length);
+static bool circular_open(size_t data_size);
+static void circular_close();
+static void circular_write(const btsnoop_header_t* header,
+                           const uint8_t* packet, size_t length);
+static void writer_start_up();
+static void writer_shut_down();
 
 // Module lifecycle functions
 
@@ -487,10 +621,15 @@ static future_t* start_up() {
   }
 
   if (is_btsnoop_enabled || is_vndbtsnoop_enabled) {
-    open_next_snoop_file();
+    int circular_kb = osi_property_get_int32(BTSNOOP_CIRCULAR_SIZE_PROPERTY, 0);
+    if (circular_kb > BTSNOOP_CIRCULAR_MAX_SIZE_KB)
+      circular_kb = BTSNOOP_CIRCULAR_MAX_SIZE_KB;
+    if (circular_kb <= 0 || !circular_open((size_t)circular_kb * 1024))
+      open_next_snoop_file();
     packets_per_file = (//osi_property_get_int32(BTSNOOP_MAX_PACKETS_PROPERTY,
                                               DEFAULT_BTSNOOP_SIZE);
     btsnoop_net_open();
+    writer_start_up();
     START_SNOOP_LOGGING();
   }
   LOG_DEBUG(LOG_TAG, "%s: vendor_logging_level values is %d ", __func__, vendor_logging_level);
@@ -513,6 +652,10 @@ static future_t* shut_down(void) {
   }
 #endif
 
+  // Write what is queued before the fd goes away
+  writer_shut_down();
+  circular_close();
+
   if (logfile_fd != INVALID_FD) close(logfile_fd);
   logfile_fd = INVALID_FD;
 
@@ -572,7 +715,7 @@ static void capture(const BT_HDR* buffer, bool is_received) {
 
   btsnoop_mem_capture(buffer, timestamp_us);
 
-  if (logfile_fd == INVALID_FD) return;
+  if (logfile_fd == INVALID_FD && circular_map == NULL) return;
 
   switch (buffer->event & MSG_EVT_MASK) {
     case MSG_HC_TO_STACK_HCI_EVT:
@@ -612,6 +755,7 @@ static void whitelist_l2c_channel(uint16_t conn_handle, uint16_t local_cid,
   // This will create the entry if there is no associated filter with the
   // connection.
   filter_list[conn_handle].addL2cCid(local_cid, remote_cid);
+  filter_list_snapshot.publish(filter_list);
 }
 
 static void whitelist_rfc_dlci(uint16_t local_cid, uint8_t dlci) {
@@ -627,6 +771,7 @@ static void whitelist_rfc_dlci(uint16_t local_cid, uint8_t dlci) {
   tL2C_CCB* p_ccb = l2cu_find_ccb_by_cid(nullptr, local_cid);
   if(p_ccb) {
     filter_list[p_ccb->p_lcb->handle].addRfcDlci(dlci);
+    filter_list_snapshot.publish(filter_list);
   }
 }
 
@@ -644,6 +789,7 @@ static void add_rfc_l2c_channel(uint16_t conn_handle, uint16_t local_cid,
 
   filter_list[conn_handle].setRfcCid(local_cid, remote_cid);
   local_cid_to_acl.insert({local_cid, conn_handle});
+  filter_list_snapshot.publish(filter_list);
 }
 
 static void clear_l2cap_whitelist(uint16_t conn_handle, uint16_t local_cid,
@@ -658,6 +804,7 @@ static void clear_l2cap_whitelist(uint16_t conn_handle, uint16_t local_cid,
   std::lock_guard<std::mutex> lock(filter_list_mutex);
 #endif
   filter_list[conn_handle].removeL2cCid(local_cid, remote_cid);
+  filter_list_snapshot.publish(filter_list);
 }
 
 static uint32_t payload_strip(uint8_t  *packet, uint32_t hdr_len, uint32_t pl_len) {
@@ -690,12 +837,6 @@ static uint32_t profiles_filter(bool is_received, uint8_t *packet) {
   uint16_t handle, l2c_chan, l2c_ctl;
   uint32_t length, totlen, offset;
 
-#if (OFF_TARGET_TEST_ENABLED == FALSE)
-  std::lock_guard lock(profiles_filter_mutex);
-#else
-  std::lock_guard<std::mutex> lock(profiles_filter_mutex);
-#endif
-
   STREAM_TO_UINT16(handle, stream);
   frag = (GET_BOUNDARY_FLAG(handle) == CONTINUATION_PACKET_BOUNDARY);
   handle = handle & HANDLE_MASK;
@@ -706,14 +847,19 @@ static uint32_t profiles_filter(bool is_received, uint8_t *packet) {
   STREAM_SKIP_UINT16(stream);
   STREAM_TO_UINT16(l2c_chan, stream);
 
-  auto &filters = profiles_filter_table[handle];
+  static const ProfilesDecisions kNoDecisions;
+  const auto& table = profiles_filter_snapshot.get();
+  auto it = table.find(handle);
+  const ProfilesDecisions& filters =
+      it != table.end() ? it->second : kNoDecisions;
   if (frag) {
-    l2c_chan = filters.ch_last;
+    l2c_chan = profiles_last_cid[handle];
   } else {
-    filters.ch_last = l2c_chan;
+    profiles_last_cid[handle] = l2c_chan;
   }
   if (l2c_chan != 0x1 && handle != 0x0edc) {
-    if (filters.isL2capFlowExt(is_received, l2c_chan)) {
+    const ChannelDecision& l2cap = filters.l2capChannel(is_received, l2c_chan);
+    if (l2cap.flow_ext) {
       STREAM_TO_UINT16(l2c_ctl, stream);
       if (!(l2c_ctl & 1)) { // I-Frame
         if (((l2c_ctl >> 14) & 0x3) == 0x01) { // Start of L2CAP SDU
@@ -722,13 +868,13 @@ static uint32_t profiles_filter(bool is_received, uint8_t *packet) {
       }
     }
     offset = stream - packet;
-    if (filters.isL2capMatch(is_received, l2c_chan)) {
+    if (l2cap.filtered) {
       if (frag) {
         return PACKET_TYPE_LENGTH + HCI_HEADER_LENGTH;
       }
       length = payload_strip(packet, offset, totlen - offset);
     } else {
-      if (filters.isRfcChannel(is_received, l2c_chan)) {
+      if (l2c_chan == filters.rfc_cid[is_received]) {
         uint8_t addr, ctrl, pf;
 
         STREAM_TO_UINT8(addr, stream);
@@ -739,7 +885,8 @@ static uint32_t profiles_filter(bool is_received, uint8_t *packet) {
         if(ctrl != RFCOMM_UIH) {
           return length;
         }
-        if(filters.isRfcommMatch(is_received, l2c_chan, addr)) {
+        const ChannelDecision& rfcomm = filters.rfcomm[addr >> 1];
+        if (rfcomm.filtered) {
           uint16_t len;
           uint8_t ea;
 
@@ -749,11 +896,11 @@ static uint32_t profiles_filter(bool is_received, uint8_t *packet) {
           if (!ea) {
             len += *stream++ << 7;
           }
-          if (filters.isRfcommFlowExt(is_received, l2c_chan, addr) && pf) {
+          if (rfcomm.flow_ext && pf) {
             stream ++; // credit byte
           }
           offset = stream - packet;
-          if (filters.isHfpProfile(is_received, l2c_chan, addr)) {
+          if (rfcomm.hfp) {
             uint32_t pat_len = strlen(cpbr_pattern);
 
             if ((totlen - offset) > pat_len) {
@@ -775,6 +922,15 @@ static uint32_t profiles_filter(bool is_received, uint8_t *packet) {
   return length;
 }
 
+// Publishes the decisions of profiles_filter_table for the logging path. Must
+// be called with profiles_filter_mutex held.
+static void publish_profiles_filter() {
+  std::unordered_map<uint16_t, ProfilesDecisions> table;
+  for (const auto& entry : profiles_filter_table)
+    table.emplace(entry.first, entry.second.decisions());
+  profiles_filter_snapshot.publish(std::move(table));
+}
+
 static void set_rfc_port_open(uint16_t handle, uint16_t local_cid,
                           uint8_t dlci, uint16_t uuid, bool flow) {
 
@@ -806,6 +962,7 @@ static void set_rfc_port_open(uint16_t handle, uint16_t local_cid,
 
   if (profile >= 0) {
     filters.profile_rfcomm_open(profile, local_cid, dlci, uuid, flow);
+    publish_profiles_filter();
   }
 }
 
@@ -826,6 +983,7 @@ static void set_rfc_port_close(uint16_t handle, uint16_t local_cid,
                     handle, local_cid, local_cid, dlci, dlci, uuid, uuid);
 
   filters.profile_rfcomm_close(filters.dlci2profile(true, local_cid, dlci));
+  publish_profiles_filter();
 }
 
 static void set_l2cap_channel_open(uint16_t handle, uint16_t local_cid,
@@ -859,6 +1017,7 @@ static void set_l2cap_channel_open(uint16_t handle, uint16_t local_cid,
   if (profile >= 0) {
     filters.profile_l2cap_open(profile, local_cid, remote_cid, psm, flow);
   }
+  publish_profiles_filter();
 }
 
 static void set_l2cap_channel_close(uint16_t handle, uint16_t local_cid, uint16_t remote_cid) {
@@ -878,6 +1037,7 @@ static void set_l2cap_channel_close(uint16_t handle, uint16_t local_cid, uint16_
                     remote_cid, remote_cid);
 
   filters.profile_l2cap_close(filters.cid2profile(true, local_cid));
+  publish_profiles_filter();
 }
 
 static const btsnoop_t interface = {capture, whitelist_l2c_channel,
@@ -897,6 +1057,10 @@ static void delete_btsnoop_files(bool filtered) {
   auto log_path = get_btsnoop_log_path(filtered);
   remove(log_path.c_str());
   remove(get_btsnoop_last_log_path(log_path).c_str());
+
+  auto circular_path = get_btsnoop_circular_path(filtered);
+  remove(circular_path.c_str());
+  remove(get_btsnoop_last_log_path(circular_path).c_str());
 }
 
 std::string get_btsnoop_log_path(bool filtered) {
@@ -912,6 +1076,10 @@ std::string get_btsnoop_last_log_path(std::string btsnoop_path) {
   return btsnoop_path.append(".last");
 }
 
+std::string get_btsnoop_circular_path(bool filtered) {
+  return get_btsnoop_log_path(filtered).append(".circular");
+}
+
 static void open_next_snoop_file() {
   packet_counter = 0;
 
@@ -944,15 +1112,6 @@ static void open_next_snoop_file() {
   write(logfile_fd, "btsnoop\0\0\0\0\1\0\0\x3\xea", 16);
 }
 
-typedef struct {
-  uint32_t length_original;
-  uint32_t length_captured;
-  uint32_t flags;
-  uint32_t dropped_packets;
-  uint64_t timestamp;
-  uint8_t type;
-} __attribute__((__packed__)) btsnoop_header_t;
-
 static uint64_t htonll(uint64_t ll) {
   const uint32_t l = 1;
   if (*(reinterpret_cast<const uint8_t*>(&l)) == 1)
@@ -1007,12 +1166,11 @@ static bool should_filter_log(bool is_received, uint8_t* packet) {
       HCID_GET_HANDLE((((uint16_t)packet[ACL_CHANNEL_OFFSET + 1]) << 8) +
                       packet[ACL_CHANNEL_OFFSET]);
 
-#if (OFF_TARGET_TEST_ENABLED == FALSE)
-  std::lock_guard lock(filter_list_mutex);
-#else
-  std::lock_guard<std::mutex> lock(filter_list_mutex);
-#endif
-  auto& filters = filter_list[acl_handle];
+  // A connection without filter entries only logs L2CAP signaling in full
+  static const FilterTracker kNoFilter;
+  const auto& table = filter_list_snapshot.get();
+  auto it = table.find(acl_handle);
+  const FilterTracker& filters = it != table.end() ? it->second : kNoFilter;
   uint16_t l2c_channel =
       (packet[L2C_CHANNEL_OFFSET + 1] << 8) + packet[L2C_CHANNEL_OFFSET];
   if (filters.isRfcChannel(is_received, l2c_channel)) {
@@ -1072,35 +1230,251 @@ static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
       blacklisted ? htonl(L2C_HEADER_SIZE) : header.length_original;
   if (blacklisted) length_he = L2C_HEADER_SIZE;
   header.flags = htonl(flags);
-  header.dropped_packets = 0;
+  header.dropped_packets = htonl(dropped_packets.load());
   header.timestamp = htonll(timestamp_us + BTSNOOP_EPOCH_DELTA);
   header.type = type;
 
-  btsnoop_net_write(&header, sizeof(btsnoop_header_t));
-  btsnoop_net_write(packet, length_he - 1);
+  if (circular_map != NULL && !sock_snoop_active) {
+    circular_write(&header, packet, length_he - 1);
+    return;
+  }
+
+  if (!ring_buf) return;
 
-  if (logfile_fd != INVALID_FD) {
-    packet_counter++;
-    if (!sock_snoop_active && packet_counter > packets_per_file) {
-      open_next_snoop_file();
+  // Queue the record for the writer thread, the capturing thread never waits
+  // for the log
+  size_t record_length = sizeof(btsnoop_header_t) + length_he - 1;
+  uint64_t head = ring_head.load(std::memory_order_relaxed);
+  if (record_length > BTSNOOP_RING_SIZE - (head - ring_tail.load())) {
+    dropped_packets++;
+    return;
+  }
+  ring_copy_in(ring_buf.get(), BTSNOOP_RING_SIZE, head, &header,
+               sizeof(btsnoop_header_t));
+  ring_copy_in(ring_buf.get(), BTSNOOP_RING_SIZE,
+               head + sizeof(btsnoop_header_t), packet, length_he - 1);
+  ring_head.store(head + record_length);
+
+  if (writer_idle.load()) {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    writer_cv.notify_one();
+  }
+}
+
+static void ring_copy_in(uint8_t* ring, size_t ring_size, uint64_t position,
+                         const void* data, size_t length) {
+  size_t offset = position % ring_size;
+  size_t first = std::min(length, ring_size - offset);
+
+  memcpy(&ring[offset], data, first);
+  memcpy(&ring[0], static_cast<const uint8_t*>(data) + first, length - first);
+}
+
+static void ring_copy_out(const uint8_t* ring, size_t ring_size,
+                          uint64_t position, void* data, size_t length) {
+  size_t offset = position % ring_size;
+  size_t first = std::min(length, ring_size - offset);
+
+  memcpy(data, &ring[offset], first);
+  memcpy(static_cast<uint8_t*>(data) + first, &ring[0], length - first);
+}
+
+// Writes the queued bytes from |from| to |to| with a single writev.
+static void writer_write(uint64_t from, uint64_t to) {
+  size_t offset = from % BTSNOOP_RING_SIZE;
+  size_t length = to - from;
+  size_t first = std::min(length, BTSNOOP_RING_SIZE - offset);
+  iovec iov[] = {{&ring_buf[offset], first}, {&ring_buf[0], length - first}};
+  int iovcnt = (first == length) ? 1 : 2;
+
+#if (BT_NET_DEBUG == TRUE)
+  std::vector<uint8_t> records(length);
+  ring_copy_out(ring_buf.get(), BTSNOOP_RING_SIZE, from, records.data(),
+                length);
+  btsnoop_net_write(records.data(), length);
+#endif
+
+  std::lock_guard<std::mutex> lock(btSnoopFd_mutex);
+  if (logfile_fd == INVALID_FD) return;
+
+  struct pollfd fds;
+  fds.fd = logfile_fd;
+  fds.events = POLLOUT;
+
+  int status = poll(&fds, 1, BTSNOOP_WRITE_TIMEOUT_MS);
+  if (status > 0 && fds.revents & POLLOUT) {
+    TEMP_FAILURE_RETRY(writev(logfile_fd, iov, iovcnt));
+  } else if (status == 0) {
+    LOG_WARN(LOG_TAG, "%s poll() timeout", __func__);
+  } else if (status == -1) {
+    LOG_ERROR(LOG_TAG, "%s poll failed errno %d (%s)", __func__, errno,
+              strerror(errno));
+  }
+}
+
+static void writer_run() {
+  uint64_t tail = ring_tail.load();
+
+  while (true) {
+    uint64_t head = ring_head.load();
+    if (head == tail) {
+      std::unique_lock<std::mutex> lock(writer_mutex);
+      if (writer_stop) break;
+      writer_idle = true;
+      writer_cv.wait_for(lock, std::chrono::seconds(1), [&tail] {
+        return writer_stop || ring_head.load() != tail;
+      });
+      writer_idle = false;
+      continue;
     }
 
-    struct pollfd fds;
-    fds.fd = logfile_fd;
-    fds.events = POLLOUT;
-    iovec iov[] = {{&header, sizeof(btsnoop_header_t)},
-                   {reinterpret_cast<void*>(packet), length_he - 1}};
-
-    status = poll(&fds, 1, 0);
-    if(status > 0 && fds.revents & POLLOUT) {
-      TEMP_FAILURE_RETRY(writev(logfile_fd, iov, 2));
-    } else if (status == 0) {
-      LOG_WARN(LOG_TAG, "%s poll() timeout", __func__);
-    } else if (status == -1) {
-      LOG_ERROR(LOG_TAG, "%s poll failed errno %d (%s)",
-                    __func__, errno, strerror(errno));
+    // Write all the queued records at once, unless the file is to be rotated
+    // before one of them
+    uint64_t end = tail;
+    bool rotate = false;
+    while (end != head) {
+      btsnoop_header_t header;
+      ring_copy_out(ring_buf.get(), BTSNOOP_RING_SIZE, end, &header,
+                    sizeof(btsnoop_header_t));
+      packet_counter++;
+      if (!sock_snoop_active && packet_counter > packets_per_file) {
+        rotate = true;
+        break;
+      }
+      end += sizeof(btsnoop_header_t) + ntohl(header.length_captured) - 1;
     }
+
+    if (end != tail) writer_write(tail, end);
+    tail = end;
+    ring_tail.store(tail);
+
+    if (rotate) open_next_snoop_file();
+  }
+}
+
+// Opens a new circular capture file with room for |data_size| bytes of
+// records. The previous one is kept as the last log.
+static bool circular_open(size_t data_size) {
+  auto circular_path = get_btsnoop_circular_path(is_btsnoop_filtered);
+  auto last_path = get_btsnoop_last_log_path(circular_path);
+
+  if (rename(circular_path.c_str(), last_path.c_str()) != 0 && errno != ENOENT)
+    LOG(ERROR) << __func__ << ": unable to rename '" << circular_path
+               << "' to '" << last_path << "' : " << strerror(errno);
+
+  mode_t prevmask = umask(0);
+  int fd = open(circular_path.c_str(), O_RDWR | O_CREAT | O_TRUNC,
+                S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH);
+  umask(prevmask);
+  if (fd == INVALID_FD) {
+    LOG(ERROR) << __func__ << ": unable to open '" << circular_path
+               << "' : " << strerror(errno);
+    return false;
+  }
+
+  // Allocate all the blocks now, capturing must not hit a full disk
+  size_t map_size = BTSNOOP_CIRCULAR_HEADER_SIZE + data_size;
+  if (posix_fallocate(fd, 0, map_size) != 0 && ftruncate(fd, map_size) != 0) {
+    LOG(ERROR) << __func__ << ": unable to size '" << circular_path
+               << "' : " << strerror(errno);
+    close(fd);
+    return false;
+  }
+
+  void* map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    LOG(ERROR) << __func__ << ": unable to map '" << circular_path
+               << "' : " << strerror(errno);
+    close(fd);
+    return false;
+  }
+
+  btsnoop_circular_header_t* p_header =
+      static_cast<btsnoop_circular_header_t*>(map);
+  memcpy(p_header->magic, BTSNOOP_CIRCULAR_MAGIC, sizeof(p_header->magic));
+  p_header->version = BTSNOOP_CIRCULAR_VERSION;
+  p_header->header_size = BTSNOOP_CIRCULAR_HEADER_SIZE;
+  p_header->data_size = data_size;
+  p_header->first_record = 0;
+  p_header->end = 0;
+
+  circular_fd = fd;
+  circular_map = static_cast<uint8_t*>(map);
+  circular_map_size = map_size;
+  LOG(INFO) << __func__ << ": capturing the latest " << data_size
+            << " bytes to '" << circular_path << "'";
+  return true;
+}
+
+static void circular_close() {
+  if (circular_map == NULL) return;
+
+  munmap(circular_map, circular_map_size);
+  circular_map = NULL;
+  close(circular_fd);
+  circular_fd = INVALID_FD;
+}
+
+// Copies a record to the circular capture file, over the oldest records. The
+// header is updated so that the file can be read at any time: the records
+// about to be overwritten are dropped from it first, the new one is added
+// once copied.
+static void circular_write(const btsnoop_header_t* header,
+                           const uint8_t* packet, size_t length) {
+  btsnoop_circular_header_t* p_header =
+      reinterpret_cast<btsnoop_circular_header_t*>(circular_map);
+  uint8_t* data = circular_map + BTSNOOP_CIRCULAR_HEADER_SIZE;
+  size_t data_size = p_header->data_size;
+  size_t record_length = sizeof(btsnoop_header_t) + length;
+
+  if (record_length > data_size) {
+    dropped_packets++;
+    return;
+  }
+
+  uint64_t end = p_header->end;
+  uint64_t first_record = p_header->first_record;
+  while (end + record_length - first_record > data_size) {
+    btsnoop_header_t oldest;
+    ring_copy_out(data, data_size, first_record, &oldest,
+                  sizeof(btsnoop_header_t));
+    first_record +=
+        sizeof(btsnoop_header_t) + ntohl(oldest.length_captured) - 1;
+  }
+  p_header->first_record = first_record;
+  std::atomic_thread_fence(std::memory_order_release);
+
+  ring_copy_in(data, data_size, end, header, sizeof(btsnoop_header_t));
+  ring_copy_in(data, data_size, end + sizeof(btsnoop_header_t), packet,
+               length);
+  std::atomic_thread_fence(std::memory_order_release);
+  p_header->end = end + record_length;
+}
+
+static void writer_start_up() {
+  ring_buf.reset(new uint8_t[BTSNOOP_RING_SIZE]);
+  ring_head = 0;
+  ring_tail = 0;
+  dropped_packets = 0;
+  writer_idle = false;
+  writer_stop = false;
+  writer_thread = std::thread(writer_run);
+}
+
+static void writer_shut_down() {
+  if (!writer_thread.joinable()) return;
+
+  {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    writer_stop = true;
+    writer_cv.notify_one();
   }
+  writer_thread.join();
+
+  if (dropped_packets > 0)
+    LOG_WARN(LOG_TAG, "%s: %u packets dropped from the log", __func__,
+             dropped_packets.load());
+  ring_buf.reset();
 }
 
 void update_snoop_fd(int snoop_fd) {
@@ -20,11 +20,16 @@
 
 #include "hci_inject.h"
 
+#include <base/bind.h>
 #include <base/logging.h>
 #include <errno.h>
 #include <string.h>
+#include <unistd.h>
+
+#include <mutex>
 
 #include "bt_types.h"
+#include "btu.h"
 #include "buffer_allocator.h"
 #include "hci_layer.h"
 #include "osi/include/allocator.h"
@@ -33,27 +38,77 @@
 #include "osi/include/osi.h"
 #include "osi/include/socket.h"
 #include "osi/include/thread.h"
-
+#include "osi/include/time.h"
+
+// Frames are a 1 byte type and a 2 bytes little endian length, followed by
+// the packet. Commands, ACL and SCO data go down to the controller. Events,
+// and ACL or SCO data with HCI_PACKET_UPWARD set in the type, go up to the
+// stack as if received from the controller.
+//
+// A HCI_PACKET_BATCH frame holds a batch id (4 bytes), a repeat count and a
+// repeat period in microseconds (2 and 4 bytes), then packets as a time
+// offset in microseconds from the start of the batch (4 bytes), a type and a
+// length (1 and 2 bytes) and the packet itself. The packets are injected at
+// their time offsets, the whole batch repeated every repeat period. Once the
+// stack has processed the upward packets of the batch, the client gets a
+// HCI_PACKET_BATCH_REPORT frame with:
+//   batch id (4 bytes)
+//   packets injected, packets dropped (2 bytes each)
+//   time taken to inject the packets (4 bytes, us)
+//   worst delay behind their time offset (4 bytes, us)
+//   time from the last packet injected to the stack done with it (4 bytes, us)
+// All the fields are little endian.
 typedef enum {
   HCI_PACKET_COMMAND = 1,
   HCI_PACKET_ACL_DATA = 2,
   HCI_PACKET_SCO_DATA = 3,
   HCI_PACKET_EVENT = 4,
+  HCI_PACKET_BATCH = 0x80,
+  HCI_PACKET_BATCH_REPORT = 0x81,
 } hci_packet_t;
 
+#define HCI_PACKET_UPWARD 0x10
+
+#define HCI_INJECT_BATCH_HEADER_SIZE 10
+#define HCI_INJECT_BATCH_PACKET_HEADER_SIZE 7
+#define HCI_INJECT_BATCH_REPORT_SIZE 20
+
 typedef struct {
+  int id;
   socket_t* socket;
   uint8_t buffer[65536 + 3];  // 2 bytes length prefix, 1 byte type prefix.
   size_t buffer_size;
 } client_t;
 
+// Marks the end of a batch on the stack message loop
+typedef struct {
+  int client_id;
+  uint32_t batch_id;
+  uint16_t injected;
+  uint16_t dropped;
+  uint32_t inject_us;
+  uint32_t max_late_us;
+  uint64_t last_injected_us;
+  uint64_t processed_us;
+} batch_marker_t;
+
 static bool hci_inject_open(const hci_t* hci_interface);
 static void hci_inject_close(void);
 static int hci_packet_to_event(hci_packet_t packet);
+static bool inject_packet(uint8_t type, const uint8_t* data, size_t len);
+static void inject_batch(client_t* client, const uint8_t* data, size_t len);
+static void batch_processed(batch_marker_t* marker);
+static void send_batch_report(void* context);
 static void accept_ready(socket_t* socket, void* context);
 static void read_ready(socket_t* socket, void* context);
 static void client_free(void* ptr);
 
+// Receive paths of the HCI layer
+extern void hci_event_received(const base::Location& from_here,
+                               BT_HDR* packet);
+extern void acl_event_received(BT_HDR* packet);
+extern void sco_data_received(BT_HDR* packet);
+
 static const port_t LISTEN_PORT = 8873;
 
 static const hci_inject_t interface = {hci_inject_open, hci_inject_close};
@@ -63,6 +118,10 @@ static const allocator_t* buffer_allocator;
 static socket_t* listen_socket;
 static thread_t* thread;
 static list_t* clients;
+static int next_client_id;
+
+// Guards |thread| for the batch markers run on the stack message loop
+static std::mutex thread_lock;
 
 static bool hci_inject_open(const hci_t* hci_interface) {
 #if (BT_NET_DEBUG != TRUE)
@@ -76,7 +135,10 @@ static bool hci_inject_open(const hci_t* hci_interface) {
 
   hci = hci_interface;
 
-  thread = thread_new("hci_inject");
+  {
+    std::lock_guard<std::mutex> lock(thread_lock);
+    thread = thread_new("hci_inject");
+  }
   if (!thread) goto error;
 
   clients = list_new(client_free);
@@ -103,10 +165,16 @@ static void hci_inject_close(void) {
 
   socket_free(listen_socket);
   list_free(clients);
-  thread_free(thread);
+
+  thread_t* old_thread;
+  {
+    std::lock_guard<std::mutex> lock(thread_lock);
+    old_thread = thread;
+    thread = NULL;
+  }
+  thread_free(old_thread);
 
   listen_socket = NULL;
-  thread = NULL;
   clients = NULL;
 }
 
@@ -118,12 +186,162 @@ static int hci_packet_to_event(hci_packet_t packet) {
       return MSG_STACK_TO_HC_HCI_ACL;
     case HCI_PACKET_SCO_DATA:
       return MSG_STACK_TO_HC_HCI_SCO;
+    case HCI_PACKET_EVENT:
+      return MSG_HC_TO_STACK_HCI_EVT;
+    case HCI_PACKET_UPWARD | HCI_PACKET_ACL_DATA:
+      return MSG_HC_TO_STACK_HCI_ACL;
+    case HCI_PACKET_UPWARD | HCI_PACKET_SCO_DATA:
+      return MSG_HC_TO_STACK_HCI_SCO;
     default:
       LOG_ERROR(LOG_TAG, "%s unsupported packet type: %d", __func__, packet);
       return -1;
   }
 }
 
+// Injects the packet |data| of |len| bytes and |type|, downward to the
+// controller or upward to the stack. Returns false if it was dropped.
+static bool inject_packet(uint8_t type, const uint8_t* data, size_t len) {
+  // TODO(sharvil): validate incoming HCI messages.
+  int event = hci_packet_to_event((hci_packet_t)type);
+  if (event < 0) return false;
+
+  BT_HDR* buf = (BT_HDR*)buffer_allocator->alloc(BT_HDR_SIZE + len);
+  if (!buf) {
+    LOG_ERROR(LOG_TAG, "%s dropping injected packet of length %zu", __func__,
+              len);
+    return false;
+  }
+  buf->event = event;
+  buf->offset = 0;
+  buf->layer_specific = 0;
+  buf->len = len;
+  memcpy(buf->data, data, len);
+
+  switch (event) {
+    case MSG_HC_TO_STACK_HCI_EVT:
+      hci_event_received(FROM_HERE, buf);
+      break;
+    case MSG_HC_TO_STACK_HCI_ACL:
+      acl_event_received(buf);
+      break;
+    case MSG_HC_TO_STACK_HCI_SCO:
+      sco_data_received(buf);
+      break;
+    default:
+      hci->transmit_downward(buf->event, buf);
+      break;
+  }
+  return true;
+}
+
+// Injects the packets of the batch frame |data| of |len| bytes at their time
+// offsets, then queues a marker behind them on the stack message loop for the
+// report to |client|.
+static void inject_batch(client_t* client, const uint8_t* data, size_t len) {
+  if (len < HCI_INJECT_BATCH_HEADER_SIZE) {
+    LOG_ERROR(LOG_TAG, "%s batch too short: %zu", __func__, len);
+    return;
+  }
+
+  batch_marker_t* marker =
+      (batch_marker_t*)osi_calloc(sizeof(batch_marker_t));
+  marker->client_id = client->id;
+  const uint8_t* p = data;
+  uint16_t repeat;
+  uint32_t period_us;
+  STREAM_TO_UINT32(marker->batch_id, p);
+  STREAM_TO_UINT16(repeat, p);
+  STREAM_TO_UINT32(period_us, p);
+  if (repeat == 0) repeat = 1;
+
+  const uint8_t* end = data + len;
+  uint64_t start_us = time_get_os_boottime_us();
+  for (uint16_t r = 0; r < repeat; r++) {
+    uint64_t repeat_start_us = start_us + (uint64_t)r * period_us;
+    for (const uint8_t* q = p; q < end;) {
+      if (end - q < HCI_INJECT_BATCH_PACKET_HEADER_SIZE) {
+        LOG_ERROR(LOG_TAG, "%s truncated packet header in batch %u", __func__,
+                  marker->batch_id);
+        break;
+      }
+      uint32_t offset_us;
+      uint8_t type;
+      uint16_t packet_len;
+      STREAM_TO_UINT32(offset_us, q);
+      STREAM_TO_UINT8(type, q);
+      STREAM_TO_UINT16(packet_len, q);
+      if (end - q < packet_len) {
+        LOG_ERROR(LOG_TAG, "%s truncated packet in batch %u", __func__,
+                  marker->batch_id);
+        break;
+      }
+
+      uint64_t due_us = repeat_start_us + offset_us;
+      uint64_t now_us = time_get_os_boottime_us();
+      if (now_us < due_us) {
+        usleep(due_us - now_us);
+      } else if (now_us - due_us > marker->max_late_us) {
+        marker->max_late_us = now_us - due_us;
+      }
+
+      if (inject_packet(type, q, packet_len)) {
+        marker->injected++;
+      } else {
+        marker->dropped++;
+      }
+      q += packet_len;
+    }
+  }
+
+  marker->last_injected_us = time_get_os_boottime_us();
+  marker->inject_us = marker->last_injected_us - start_us;
+
+  // The upward packets were posted to the stack message loop as they were
+  // injected, the marker runs once the stack is done with all of them.
+  base::MessageLoop* message_loop = get_message_loop();
+  if (!message_loop || !message_loop->task_runner().get() ||
+      !message_loop->task_runner()->PostTask(
+          FROM_HERE, base::Bind(&batch_processed, marker))) {
+    batch_processed(marker);
+  }
+}
+
+static void batch_processed(batch_marker_t* marker) {
+  marker->processed_us = time_get_os_boottime_us();
+
+  std::lock_guard<std::mutex> lock(thread_lock);
+  if (!thread || !thread_post(thread, send_batch_report, marker))
+    osi_free(marker);
+}
+
+static void send_batch_report(void* context) {
+  batch_marker_t* marker = (batch_marker_t*)context;
+
+  for (const list_node_t* node = list_begin(clients);
+       node != list_end(clients); node = list_next(node)) {
+    client_t* client = (client_t*)list_node(node);
+    if (client->id != marker->client_id) continue;
+
+    uint8_t report[3 + HCI_INJECT_BATCH_REPORT_SIZE];
+    uint8_t* p = report;
+    UINT8_TO_STREAM(p, HCI_PACKET_BATCH_REPORT);
+    UINT16_TO_STREAM(p, HCI_INJECT_BATCH_REPORT_SIZE);
+    UINT32_TO_STREAM(p, marker->batch_id);
+    UINT16_TO_STREAM(p, marker->injected);
+    UINT16_TO_STREAM(p, marker->dropped);
+    UINT32_TO_STREAM(p, marker->inject_us);
+    UINT32_TO_STREAM(p, marker->max_late_us);
+    UINT32_TO_STREAM(p, marker->processed_us - marker->last_injected_us);
+    if (socket_write(client->socket, report, sizeof(report)) !=
+        (ssize_t)sizeof(report)) {
+      LOG_ERROR(LOG_TAG, "%s unable to report batch %u", __func__,
+                marker->batch_id);
+    }
+    break;
+  }
+  osi_free(marker);
+}
+
 static void accept_ready(socket_t* socket, UNUSED_ATTR void* context) {
   CHECK(socket != NULL);
   CHECK(socket == listen_socket);
@@ -133,6 +351,7 @@ static void accept_ready(socket_t* socket, UNUSED_ATTR void* context) {
 
   client_t* client = (client_t*)osi_calloc(sizeof(client_t));
 
+  client->id = ++next_client_id;
   client->socket = socket;
 
   if (!list_append(clients, client)) {
@@ -167,21 +386,12 @@ static void read_ready(UNUSED_ATTR socket_t* socket, void* context) {
 
     if (client->buffer_size < frame_len) break;
 
-    // TODO(sharvil): validate incoming HCI messages.
     // TODO(sharvil): once we have an HCI parser, we can eliminate
     //   the 2-byte size field since it will be contained in the packet.
-
-    BT_HDR* buf = (BT_HDR*)buffer_allocator->alloc(BT_HDR_SIZE + packet_len);
-    if (buf) {
-      buf->event = hci_packet_to_event(packet_type);
-      buf->offset = 0;
-      buf->layer_specific = 0;
-      buf->len = packet_len;
-      memcpy(buf->data, buffer + 3, packet_len);
-      hci->transmit_downward(buf->event, buf);
+    if (packet_type == HCI_PACKET_BATCH) {
+      inject_batch(client, buffer + 3, packet_len);
     } else {
-      LOG_ERROR(LOG_TAG, "%s dropping injected packet of length %zu", __func__,
-                packet_len);
+      inject_packet(packet_type, buffer + 3, packet_len);
     }
 
     size_t remainder = client->buffer_size - frame_len;
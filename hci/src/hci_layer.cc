@@ -26,14 +26,18 @@
 #include <base/sequenced_task_runner.h>
 #include <base/threading/thread.h>
 
+#include <inttypes.h>
 #include <signal.h>
 #include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
+#include <map>
 #include <mutex>
 
+#include "bt_trace_span.h"
 #include "btcore/include/module.h"
 #include "btsnoop.h"
 #include "buffer_allocator.h"
@@ -47,6 +51,7 @@
 #include "osi/include/log.h"
 #include "osi/include/properties.h"
 #include "osi/include/reactor.h"
+#include "osi/include/task_stats.h"
 #include "packet_fragmenter.h"
 #include "controller.h"
 
@@ -58,6 +63,7 @@ extern void hci_close();
 extern int hci_open_firmware_log_file();
 extern void hci_close_firmware_log_file(int fd);
 extern void hci_log_firmware_debug_packet(int fd, BT_HDR* packet);
+extern void hci_transport_debug_dump(int fd);
 
 static int hci_firmware_log_fd = INVALID_FD;
 
@@ -124,8 +130,38 @@ static std::recursive_mutex commands_pending_response_mutex;
 static base::Callback<void(const base::Location&, BT_HDR*)>
     send_data_upwards;
 
+// Number of log2 buckets of the command latency histograms, the last one
+// holds everything from 2^(HCI_LATENCY_BUCKETS - 2) us (about 1 s)
+#define HCI_LATENCY_BUCKETS 22
+
+// Round trip times of the commands of one opcode, from sending them to their
+// Command Complete or Command Status event
+typedef struct {
+  size_t count;
+  size_t status_count;  // Answered by a Command Status event
+  uint64_t total_us;
+  uint64_t max_us;
+  size_t histogram[HCI_LATENCY_BUCKETS];
+} command_latency_t;
+
+typedef struct {
+  uint64_t count;
+  uint64_t count_at_last_dump;
+} event_counter_t;
+
+// Statistics, kept for the lifetime of the process
+static std::mutex hci_stats_mutex;
+static std::map<command_opcode_t, command_latency_t> command_latencies;
+static event_counter_t event_counters[256];
+static event_counter_t le_meta_event_counters[256];
+static std::chrono::time_point<std::chrono::steady_clock> last_stats_dump =
+    std::chrono::steady_clock::now();
+
 static bool filter_incoming_event(BT_HDR* packet);
 static waiting_command_t* get_waiting_command(command_opcode_t opcode);
+static void record_command_latency(const waiting_command_t* wait_entry,
+                                   bool status);
+static void count_incoming_event(const BT_HDR* packet);
 static int get_num_waiting_commands();
 
 static void event_finish_startup(void* context);
@@ -156,6 +192,7 @@ void initialization_complete() {
 void hci_event_received(const base::Location& from_here,
                         BT_HDR* packet) {
   btsnoop->capture(packet, true);
+  count_incoming_event(packet);
 
   if (!filter_incoming_event(packet)) {
     send_data_upwards.Run(from_here, packet);
@@ -163,6 +200,7 @@ void hci_event_received(const base::Location& from_here,
 }
 
 void acl_event_received(BT_HDR* packet) {
+  BT_TRACE_PACKET_SCOPE("hci rx", packet);
   btsnoop->capture(packet, true);
   packet_fragmenter->reassemble_and_dispatch(packet);
 }
@@ -386,6 +424,7 @@ static void transmit_downward(uint16_t type, void* data) {
              "%s legacy transmit of command. Use transmit_command instead.",
              __func__);
   } else {
+    BT_TRACE_PACKET_BEGIN("hci tx queue", data);
     enqueue_packet(data);
   }
 }
@@ -462,12 +501,15 @@ static void enqueue_packet(void* packet) {
     return;
   }
   message_loop_->task_runner()->PostTask(
-      FROM_HERE, base::Bind(&event_packet_ready, packet));
+      FROM_HERE, task_stats_wrap("hci_thread", FROM_HERE,
+                                 base::Bind(&event_packet_ready, packet)));
 }
 
 static void event_packet_ready(void* pkt) {
   // The queue may be the command queue or the packet queue, we don't care
   BT_HDR* packet = (BT_HDR*)pkt;
+  BT_TRACE_PACKET_END("hci tx queue", packet);
+  BT_TRACE_PACKET_SCOPE("hci tx", packet);
   packet_fragmenter->fragment_and_dispatch(packet);
 }
 
@@ -634,6 +676,7 @@ static bool filter_incoming_event(BT_HDR* packet) {
                  __func__, opcode);
       }
     } else {
+      record_command_latency(wait_entry, false);
       update_command_response_timer();
       if (wait_entry->complete_callback) {
         wait_entry->complete_callback(packet, wait_entry->context);
@@ -661,6 +704,7 @@ static bool filter_incoming_event(BT_HDR* packet) {
           "%s command status event with no matching command. opcode: 0x%04x",
           __func__, opcode);
     } else {
+      record_command_latency(wait_entry, true);
       update_command_response_timer();
       if (wait_entry->status_callback)
         wait_entry->status_callback(status, wait_entry->command,
@@ -702,6 +746,93 @@ intercepted:
   return true;
 }
 
+// Adds the round trip time of |wait_entry|, answered now by a Command
+// Complete event or by a Command Status event if |status|, to the latencies
+// of its opcode.
+static void record_command_latency(const waiting_command_t* wait_entry,
+                                   bool status) {
+  uint64_t latency_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - wait_entry->timestamp)
+          .count();
+  size_t bucket = 0;
+  for (uint64_t rest = latency_us;
+       rest > 0 && bucket < HCI_LATENCY_BUCKETS - 1; rest >>= 1)
+    bucket++;
+
+  std::lock_guard<std::mutex> lock(hci_stats_mutex);
+  command_latency_t& latency = command_latencies[wait_entry->opcode];
+  latency.count++;
+  if (status) latency.status_count++;
+  latency.total_us += latency_us;
+  latency.max_us = std::max(latency.max_us, latency_us);
+  latency.histogram[bucket]++;
+}
+
+static void count_incoming_event(const BT_HDR* packet) {
+  if (packet->len < 1) return;
+  uint8_t event_code = packet->data[0];
+
+  std::lock_guard<std::mutex> lock(hci_stats_mutex);
+  event_counters[event_code].count++;
+  if (event_code == HCI_BLE_EVENT && packet->len >= 3)
+    le_meta_event_counters[packet->data[2]].count++;
+}
+
+static void dump_event_counters(int fd, const char* prefix,
+                                event_counter_t* counters, double elapsed_s) {
+  for (size_t code = 0; code < 256; code++) {
+    event_counter_t& counter = counters[code];
+    if (counter.count == 0) continue;
+    dprintf(fd, "  %s0x%02zx  %-10" PRIu64 " %.1f\n", prefix, code,
+            counter.count,
+            elapsed_s > 0
+                ? (counter.count - counter.count_at_last_dump) / elapsed_s
+                : 0.0);
+    counter.count_at_last_dump = counter.count;
+  }
+}
+
+void hci_layer_debug_dump(int fd) {
+  std::lock_guard<std::mutex> lock(hci_stats_mutex);
+
+  dprintf(fd, "\nHCI command round trip times (us):\n");
+  dprintf(fd, "  Opcode  Count      Status     Average    Max\n");
+  for (const auto& entry : command_latencies) {
+    const command_latency_t& latency = entry.second;
+    dprintf(fd, "  0x%04x  %-10zu %-10zu %-10" PRIu64 " %-10" PRIu64 "\n",
+            entry.first, latency.count, latency.status_count,
+            latency.total_us / latency.count, latency.max_us);
+    dprintf(fd, "         ");
+    for (size_t i = 0; i < HCI_LATENCY_BUCKETS; i++) {
+      if (latency.histogram[i] == 0) continue;
+      // Bucket i holds the round trip times below 2^i us
+      if (i == HCI_LATENCY_BUCKETS - 1)
+        dprintf(fd, " >=%" PRIu64 ":%zu", (uint64_t)1 << (i - 1),
+                latency.histogram[i]);
+      else
+        dprintf(fd, " <%" PRIu64 ":%zu", (uint64_t)1 << i,
+                latency.histogram[i]);
+    }
+    dprintf(fd, "\n");
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  double elapsed_s =
+      std::chrono::duration_cast<std::chrono::milliseconds>(now -
+                                                            last_stats_dump)
+          .count() /
+      1000.0;
+  last_stats_dump = now;
+  dprintf(fd,
+          "\nHCI events received (event code, total, per second since the "
+          "last dump):\n");
+  dump_event_counters(fd, "", event_counters, elapsed_s);
+  dump_event_counters(fd, "LE ", le_meta_event_counters, elapsed_s);
+
+  hci_transport_debug_dump(fd);
+}
+
 // Callback for the fragmenter to dispatch up a completely reassembled packet
 static void dispatch_reassembled(BT_HDR* packet) {
   // Events should already have been dispatched before this point
@@ -226,3 +226,6 @@ void hci_close_firmware_log_file(int fd) {
 void hci_log_firmware_debug_packet(int fd, BT_HDR* packet) {
   TEMP_FAILURE_RETRY(write(fd, packet->data, packet->len));
 }
+
+// The HAL delivers one packet per callback, there are no reads to report
+void hci_transport_debug_dump(int fd) {}
@@ -23,15 +23,19 @@
 #include <base/threading/thread.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <poll.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <algorithm>
+#include <atomic>
 
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 
 #include "buffer_allocator.h"
@@ -65,6 +69,11 @@ using base::Thread;
 #define BT_EVT_HDR_SIZE 2
 #define BT_CMD_HDR_SIZE 3
 
+/* Largest frame read from the packet socket */
+#define HCI_PACKET_BUF_SIZE 2000
+/* Chunk read from the stream socket, holding several frames */
+#define HCI_STREAM_BUF_SIZE 16384
+
 struct sockaddr_hci {
   sa_family_t hci_family;
   unsigned short hci_dev;
@@ -114,167 +123,176 @@ static int rfkill_en;
 int reader_thread_ctrl_fd = -1;
 Thread* reader_thread = NULL;
 
-void monitor_socket_packet(int ctrl_fd, int fd) {
-  const allocator_t* buffer_allocator = buffer_allocator_get_interface();
-  const size_t buf_size = 2000;
-  uint8_t buf[buf_size];
-  ssize_t len = read(fd, buf, buf_size);
+// Reads of the transport, to see how many frames each read() returns
+static std::atomic<uint64_t> reader_reads;
+static std::atomic<uint64_t> reader_bytes;
+static std::atomic<uint64_t> reader_frames;
+static std::atomic<uint64_t> reader_max_frames;
+
+static void update_reader_stats(size_t bytes, size_t frames) {
+  reader_reads.fetch_add(1, std::memory_order_relaxed);
+  reader_bytes.fetch_add(bytes, std::memory_order_relaxed);
+  reader_frames.fetch_add(frames, std::memory_order_relaxed);
+  if (frames > reader_max_frames.load(std::memory_order_relaxed))
+    reader_max_frames.store(frames, std::memory_order_relaxed);
+}
 
-  while (len > 0) {
-    if (len == buf_size)
-      LOG(FATAL) << "This packet filled buffer, if it have continuation we "
-                    "don't know how to merge it, increase buffer size!";
+static void dispatch_packet(uint8_t type, BT_HDR* packet) {
+  packet->offset = 0;
+  packet->layer_specific = 0;
 
-    uint8_t type = buf[0];
+  switch (type) {
+    case HCI_PACKET_TYPE_COMMAND:
+      packet->event = MSG_HC_TO_STACK_HCI_EVT;
+      hci_event_received(FROM_HERE, packet);
+      break;
+    case HCI_PACKET_TYPE_ACL_DATA:
+      packet->event = MSG_HC_TO_STACK_HCI_ACL;
+      acl_event_received(packet);
+      break;
+    case HCI_PACKET_TYPE_SCO_DATA:
+      packet->event = MSG_HC_TO_STACK_HCI_SCO;
+      sco_data_received(packet);
+      break;
+    case HCI_PACKET_TYPE_EVENT:
+      packet->event = MSG_HC_TO_STACK_HCI_EVT;
+      hci_event_received(FROM_HERE, packet);
+      break;
+    default:
+      LOG(FATAL) << "Unexpected event type: " << +type;
+      break;
+  }
+}
 
-    size_t packet_size = buf_size + BT_HDR_SIZE;
-    BT_HDR* packet =
-        reinterpret_cast<BT_HDR*>(buffer_allocator->alloc(packet_size));
-    packet->offset = 0;
-    packet->layer_specific = 0;
-    packet->len = len - 1;
-    memcpy(packet->data, buf + 1, len - 1);
+// Waits for more data on |fd|, returns false when asked to exit on |ctrl_fd|
+static bool wait_for_data(int ctrl_fd, int fd) {
+  fd_set fds;
+  FD_ZERO(&fds);
+  FD_SET(ctrl_fd, &fds);
+  FD_SET(fd, &fds);
+  int res = select(std::max(fd, ctrl_fd) + 1, &fds, NULL, NULL, NULL);
+  if (res <= 0) LOG(INFO) << "Nothing more to read";
+
+  if (FD_ISSET(ctrl_fd, &fds)) {
+    LOG(INFO) << "exitting";
+    return false;
+  }
+  return true;
+}
 
-    switch (type) {
-      case HCI_PACKET_TYPE_COMMAND:
-        packet->event = MSG_HC_TO_STACK_HCI_EVT;
-        hci_event_received(FROM_HERE, packet);
-        break;
-      case HCI_PACKET_TYPE_ACL_DATA:
-        packet->event = MSG_HC_TO_STACK_HCI_ACL;
-        acl_event_received(packet);
-        break;
-      case HCI_PACKET_TYPE_SCO_DATA:
-        packet->event = MSG_HC_TO_STACK_HCI_SCO;
-        sco_data_received(packet);
-        break;
-      case HCI_PACKET_TYPE_EVENT:
-        packet->event = MSG_HC_TO_STACK_HCI_EVT;
-        hci_event_received(FROM_HERE, packet);
-        break;
-      default:
-        LOG(FATAL) << "Unexpected event type: " << +type;
-        break;
+// The socket returns one frame per read(), which is read straight into the
+// buffer given to the stack.
+void monitor_socket_packet(int ctrl_fd, int fd) {
+  const allocator_t* buffer_allocator = buffer_allocator_get_interface();
+  const size_t buf_size = HCI_PACKET_BUF_SIZE;
+
+  while (true) {
+    BT_HDR* packet = reinterpret_cast<BT_HDR*>(
+        buffer_allocator->alloc(BT_HDR_SIZE + buf_size));
+    uint8_t type;
+    struct iovec iov[2] = {{&type, 1}, {packet->data, buf_size}};
+    ssize_t len = readv(fd, iov, 2);
+    if (len <= 0) {
+      buffer_allocator->free(packet);
+      return;
     }
 
-    fd_set fds;
-    FD_ZERO(&fds);
-    FD_SET(ctrl_fd, &fds);
-    FD_SET(fd, &fds);
-    int res = select(std::max(fd, ctrl_fd) + 1, &fds, NULL, NULL, NULL);
-    if (res <= 0) LOG(INFO) << "Nothing more to read";
+    if ((size_t)len == buf_size + 1)
+      LOG(FATAL) << "This packet filled buffer, if it have continuation we "
+                    "don't know how to merge it, increase buffer size!";
 
-    if (FD_ISSET(ctrl_fd, &fds)) {
-      LOG(INFO) << "exitting";
-      return;
-    }
+    packet->len = len - 1;
+    update_reader_stats(len, 1);
+    dispatch_packet(type, packet);
 
-    len = read(fd, buf, buf_size);
+    if (!wait_for_data(ctrl_fd, fd)) return;
   }
 }
 
-static int do_read(int fd, unsigned char* buf, size_t len)
-{
-  int bytes_left = len, bytes_read = 0, read_offset = 0;
-  while(bytes_left > 0) {
-    bytes_read = read(fd, buf + read_offset, bytes_left);
-    if(bytes_read < 0) {
-       LOG(ERROR) << "read fail Error " << strerror(errno);
-      return -1;
-    } else if (bytes_read == 0) {
-      LOG(INFO) << " read returned 0, read bytes"  << (len-bytes_left) << " expected len" << len;
-      return (len - bytes_left);
-    } else {
-      if(bytes_read < bytes_left) {
-        bytes_left -= bytes_read;
-        read_offset += bytes_read;
-      } else {
-        break;
-      }
-    }
+// Returns the length of the H4 frame at |p|, type included, or 0 while the
+// |len| bytes read do not hold its header yet.
+static size_t h4_frame_length(const uint8_t* p, size_t len) {
+  if (len < 1) return 0;
+
+  switch (p[0]) {
+    case HCI_PACKET_TYPE_COMMAND:
+      if (len < 1 + BT_CMD_HDR_SIZE) return 0;
+      return 1 + BT_CMD_HDR_SIZE + p[3];
+    case HCI_PACKET_TYPE_ACL_DATA:
+      if (len < 1 + BT_ACL_HDR_SIZE) return 0;
+      return 1 + BT_ACL_HDR_SIZE + ((p[4] << 8) | p[3]);
+    case HCI_PACKET_TYPE_SCO_DATA:
+      if (len < 1 + BT_SCO_HDR_SIZE) return 0;
+      return 1 + BT_SCO_HDR_SIZE + p[3];
+    case HCI_PACKET_TYPE_EVENT:
+      if (len < 1 + BT_EVT_HDR_SIZE) return 0;
+      return 1 + BT_EVT_HDR_SIZE + p[2];
+    default:
+      LOG(FATAL) << "Unexpected event type: " << +p[0];
+      return 0;
   }
-
-  return len;
 }
 
+// The stream is read in chunks of up to HCI_STREAM_BUF_SIZE, and all the
+// frames completed by a read() are parsed in place. Each frame is copied once
+// into a buffer of its size, a partial frame waits for the next read().
 void monitor_socket_stream(int ctrl_fd, int fd) {
   const allocator_t* buffer_allocator = buffer_allocator_get_interface();
-  const size_t buf_size = 2000;
-  uint8_t buf[buf_size];
-  unsigned int packet_length;
-  ssize_t len = read(fd, buf, 1);
-
-  while (len > 0) {
-    if (len == buf_size)
-      LOG(FATAL) << "This packet filled buffer, if it have continuation we "
-                    "don't know how to merge it, increase buffer size!";
+  uint8_t* buf = static_cast<uint8_t*>(osi_malloc(HCI_STREAM_BUF_SIZE));
+  size_t filled = 0;
 
-    uint8_t type = buf[0];
-
-    size_t packet_size = buf_size + BT_HDR_SIZE;
-    BT_HDR* packet =
-        reinterpret_cast<BT_HDR*>(buffer_allocator->alloc(packet_size));
-    packet->offset = 0;
-    packet->layer_specific = 0;
-    LOG(INFO) << "packet type:" << +type;
-    switch (type) {
-      case HCI_PACKET_TYPE_COMMAND:
-        len = do_read(fd,buf+1,BT_CMD_HDR_SIZE);
-        packet->event = MSG_HC_TO_STACK_HCI_EVT;
-        packet_length = buf[3];
-        packet->len = packet_length + BT_CMD_HDR_SIZE;
-        len = do_read(fd,buf+1,packet->len);
-        memcpy(packet->data, buf+1, packet->len);
-        hci_event_received(FROM_HERE, packet);
-        break;
-      case HCI_PACKET_TYPE_ACL_DATA:
-        len = do_read(fd,buf+1,BT_ACL_HDR_SIZE);
-        packet->event = MSG_HC_TO_STACK_HCI_ACL;
-        packet_length = (buf[4] << 8) + buf[3];
-        packet->len = packet_length + BT_ACL_HDR_SIZE;
-        LOG(INFO) << "total packet length to be read:" << packet->len;
-        LOG(INFO) << "packet_length:" << packet_length;
-        len = do_read(fd, buf+BT_ACL_HDR_SIZE+1, packet_length);
-        LOG(INFO) << "length of bytes read:" << +len;
-        memcpy(packet->data, buf+1, packet->len);
-        acl_event_received(packet);
-        break;
-      case HCI_PACKET_TYPE_SCO_DATA:
-        len = do_read(fd,buf+1,BT_SCO_HDR_SIZE);
-        packet->event = MSG_HC_TO_STACK_HCI_SCO;
-        packet_length = buf[3];
-        packet->len = packet_length + BT_CMD_HDR_SIZE;
-        len = do_read(fd,buf+1,packet->len);
-        memcpy(packet->data, buf+1, packet->len);
-        sco_data_received(packet);
-        break;
-      case HCI_PACKET_TYPE_EVENT:
-        len = do_read(fd,buf+1,BT_EVT_HDR_SIZE);
-        packet->event = MSG_HC_TO_STACK_HCI_EVT;
-        packet_length = buf[2];
-        packet->len = packet_length + BT_EVT_HDR_SIZE;
-        len = do_read(fd, buf+BT_EVT_HDR_SIZE+1, packet_length);
-        memcpy(packet->data, buf+1, packet->len);
-        hci_event_received(FROM_HERE, packet);
-        break;
-      default:
-        LOG(FATAL) << "Unexpected event type: " << +type;
-        break;
+  while (true) {
+    ssize_t len = read(fd, buf + filled, HCI_STREAM_BUF_SIZE - filled);
+    if (len <= 0) {
+      if (len < 0) LOG(ERROR) << "read fail Error " << strerror(errno);
+      break;
+    }
+    filled += len;
+
+    size_t parsed = 0;
+    size_t frames = 0;
+    while (true) {
+      size_t frame_len = h4_frame_length(buf + parsed, filled - parsed);
+      if (frame_len > HCI_STREAM_BUF_SIZE)
+        LOG(FATAL) << "Frame of " << frame_len << " bytes does not fit the "
+                   << "buffer, increase HCI_STREAM_BUF_SIZE!";
+      if (frame_len == 0 || frame_len > filled - parsed) break;
+
+      BT_HDR* packet = reinterpret_cast<BT_HDR*>(
+          buffer_allocator->alloc(BT_HDR_SIZE + frame_len - 1));
+      packet->len = frame_len - 1;
+      memcpy(packet->data, buf + parsed + 1, frame_len - 1);
+      dispatch_packet(buf[parsed], packet);
+
+      parsed += frame_len;
+      frames++;
     }
 
-    fd_set fds;
-    FD_ZERO(&fds);
-    FD_SET(ctrl_fd, &fds);
-    FD_SET(fd, &fds);
-    int res = select(std::max(fd, ctrl_fd) + 1, &fds, NULL, NULL, NULL);
-    if (res <= 0) LOG(INFO) << "Nothing more to read";
+    filled -= parsed;
+    memmove(buf, buf + parsed, filled);
+    update_reader_stats(len, frames);
 
-    if (FD_ISSET(ctrl_fd, &fds)) {
-      LOG(INFO) << "exitting";
-      return;
-    }
-    len = read(fd, buf, 1);
+    if (!wait_for_data(ctrl_fd, fd)) break;
   }
+
+  osi_free(buf);
+}
+
+void hci_transport_debug_dump(int fd) {
+  uint64_t reads = reader_reads.load(std::memory_order_relaxed);
+  if (reads == 0) return;
+
+  uint64_t bytes = reader_bytes.load(std::memory_order_relaxed);
+  uint64_t frames = reader_frames.load(std::memory_order_relaxed);
+  dprintf(fd, "\nHCI transport reads (%s socket):\n",
+          use_stream_sock ? "stream" : "packet");
+  dprintf(fd, "  Reads: %" PRIu64 "  Bytes: %" PRIu64 "  Frames: %" PRIu64
+              "\n",
+          reads, bytes, frames);
+  dprintf(fd, "  Per read (avg bytes/avg frames/max frames): %" PRIu64
+              " / %.2f / %" PRIu64 "\n",
+          bytes / reads, (double)frames / reads,
+          reader_max_frames.load(std::memory_order_relaxed));
 }
 
 /* TODO: should thread the device waiting and return immedialty */
@@ -399,12 +417,12 @@ hci_transmit_status_t hci_transmit(BT_HDR* packet) {
       break;
   }
 
-  uint8_t* addr = packet->data + packet->offset - 1;
-  uint8_t store = *addr;
-  *addr = type;
-  size_t ret = write(bt_vendor_fd, addr, packet->len + 1);
-
-  *(addr) = store;
+  // Send the packet indicator from its own iovec, so that the packet is
+  // written as is, whatever headroom its buffer has
+  struct iovec iov[] = {{&type, 1},
+                        {packet->data + packet->offset, packet->len}};
+  ssize_t ret;
+  OSI_NO_INTR(ret = writev(bt_vendor_fd, iov, 2));
 
   if (ret != packet->len + 1) {
     status = HCI_TRANSMIT_DAEMON_DIED;
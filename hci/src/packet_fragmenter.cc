@@ -22,8 +22,8 @@
 
 #include <base/logging.h>
 #include <string.h>
-#include <unordered_map>
 
+#include "bt_packet.h"
 #include "bt_target.h"
 #include "buffer_allocator.h"
 #include "device/include/controller.h"
@@ -50,13 +50,41 @@ static const allocator_t* buffer_allocator;
 static const controller_t* controller;
 static const packet_fragmenter_callbacks_t* callbacks;
 
-static std::unordered_map<uint16_t /* handle */, BT_HDR*> partial_packets;
+// Packets being reassembled, at most one per ACL link
+typedef struct {
+  uint16_t handle;
+  BT_HDR* packet;
+} partial_packet_t;
+
+static partial_packet_t partial_packets[MAX_L2CAP_LINKS];
+
+static partial_packet_t* partial_packet_find(uint16_t handle) {
+  for (partial_packet_t& slot : partial_packets) {
+    if (slot.packet != NULL && slot.handle == handle) return &slot;
+  }
+  return NULL;
+}
+
+static partial_packet_t* partial_packet_new(uint16_t handle) {
+  for (partial_packet_t& slot : partial_packets) {
+    if (slot.packet == NULL) {
+      slot.handle = handle;
+      return &slot;
+    }
+  }
+  return NULL;
+}
 
 static void init(const packet_fragmenter_callbacks_t* result_callbacks) {
   callbacks = result_callbacks;
 }
 
-static void cleanup() { partial_packets.clear(); }
+static void cleanup() {
+  for (partial_packet_t& slot : partial_packets) {
+    if (slot.packet != NULL) buffer_allocator->free(slot.packet);
+    slot.packet = NULL;
+  }
+}
 
 static void fragment_and_dispatch(BT_HDR* packet) {
   CHECK(packet != NULL);
@@ -78,6 +106,13 @@ static void fragment_and_dispatch(BT_HDR* packet) {
   uint16_t max_packet_size = max_data_size + HCI_ACL_PREAMBLE_SIZE;
   uint16_t remaining_length = packet->len;
 
+  // The ACL headers of the continuation fragments are written over the
+  // payload, which other holders of a shared packet still read
+  if (remaining_length > max_packet_size) {
+    packet = bt_packet_unshare(packet);
+    stream = packet->data + packet->offset;
+  }
+
   uint16_t continuation_handle;
   STREAM_TO_UINT16(continuation_handle, stream);
   continuation_handle = APPLY_CONTINUATION_FLAG(continuation_handle);
@@ -143,16 +178,15 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
     }
 
     if (boundary_flag == START_PACKET_BOUNDARY) {
-      auto map_iter = partial_packets.find(handle);
-      if (map_iter != partial_packets.end()) {
+      partial_packet_t* slot = partial_packet_find(handle);
+      if (slot != NULL) {
         LOG_WARN(LOG_TAG,
                  "%s found unfinished packet for handle with start packet. "
                  "Dropping old.",
                  __func__);
 
-        BT_HDR* hdl = map_iter->second;
-        partial_packets.erase(map_iter);
-        buffer_allocator->free(hdl);
+        buffer_allocator->free(slot->packet);
+        slot->packet = NULL;
       }
 
       if (acl_length < L2CAP_HEADER_SIZE) {
@@ -189,6 +223,15 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
         return;
       }
 
+      slot = partial_packet_new(handle);
+      if (slot == NULL) {
+        LOG_ERROR(LOG_TAG,
+                  "%s no reassembly slot left for handle 0x%04x. Dropping it.",
+                  __func__, handle);
+        buffer_allocator->free(packet);
+        return;
+      }
+
       BT_HDR* partial_packet =
           (BT_HDR*)buffer_allocator->alloc(full_length + sizeof(BT_HDR));
       partial_packet->event = packet->event;
@@ -202,20 +245,20 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
       STREAM_SKIP_UINT16(stream);  // skip the handle
       UINT16_TO_STREAM(stream, full_length - HCI_ACL_PREAMBLE_SIZE);
 
-      partial_packets[handle] = partial_packet;
+      slot->packet = partial_packet;
 
       // Free the old packet buffer, since we don't need it anymore
       buffer_allocator->free(packet);
     } else {
-      auto map_iter = partial_packets.find(handle);
-      if (map_iter == partial_packets.end()) {
+      partial_packet_t* slot = partial_packet_find(handle);
+      if (slot == NULL) {
         LOG_WARN(LOG_TAG,
                  "%s got continuation for unknown packet. Dropping it.",
                  __func__);
         buffer_allocator->free(packet);
         return;
       }
-      BT_HDR* partial_packet = map_iter->second;
+      BT_HDR* partial_packet = slot->packet;
 
       packet->offset = HCI_ACL_PREAMBLE_SIZE;
       uint16_t projected_offset =
@@ -238,7 +281,7 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
       partial_packet->offset = projected_offset;
 
       if (partial_packet->offset == partial_packet->len) {
-        partial_packets.erase(handle);
+        slot->packet = NULL;
         partial_packet->offset = 0;
         callbacks->reassembled(partial_packet);
       }
@@ -0,0 +1,173 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Per packet cost of the snoop log filters. ACL packets are captured on a
+// channel logged in full and on a filtered one, with the whitelist filter and
+// with the profiles filter, to compare with unfiltered full logging. Run with
+// --benchmark_format=json to get results that can be compared between builds.
+//
+// The snoop log properties are changed while running and restored after;
+// the log goes to /data/local/tmp. The profiles filter only works on user
+// builds, its benchmarks are skipped on other builds.
+
+#include <benchmark/benchmark.h>
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "bt_types.h"
+#include "btcore/include/module.h"
+#include "hci/include/btsnoop.h"
+#include "hci_layer.h"
+#include "include/bt_logger_lib.h"
+#include "osi/include/properties.h"
+#include "stack/l2cap/l2c_int.h"
+
+using ::benchmark::State;
+
+extern const module_t btsnoop_module;
+
+// Normally provided by the vendor logger and the L2CAP layer
+uint16_t vendor_logging_level;
+bt_logger_interface_t* logger_interface;
+tL2C_CCB* l2cu_find_ccb_by_cid(tL2C_LCB* p_lcb, uint16_t local_cid) {
+  return nullptr;
+}
+
+namespace {
+
+constexpr uint16_t kHandle = 0x0042;
+constexpr uint16_t kLoggedCid = 0x0041;
+constexpr uint16_t kFilteredCid = 0x0040;
+constexpr uint16_t kPsmPbap = 0x1025;
+constexpr uint16_t kL2capHeaderSize = 4;
+constexpr uint16_t kAclHeaderSize = 4;
+
+constexpr char kLogPath[] = "/data/local/tmp/btsnoop_filter_benchmark.log";
+
+const char* const kProperties[] = {
+    "persist.bluetooth.btsnooplogmode", "persist.bluetooth.btsnooppath",
+    "persist.bluetooth.snoopfilter.profiles",
+    "persist.bluetooth.snoopfilter.mode"};
+
+// Starts the snoop log in |mode| after saving the properties it changes
+class SnoopLog {
+ public:
+  explicit SnoopLog(const char* mode) {
+    for (const char* key : kProperties) {
+      char value[PROPERTY_VALUE_MAX];
+      osi_property_get(key, value, "");
+      saved_.push_back(value);
+    }
+    osi_property_set("persist.bluetooth.btsnooplogmode", mode);
+    osi_property_set("persist.bluetooth.btsnooppath", kLogPath);
+    osi_property_set("persist.bluetooth.snoopfilter.profiles", "pbap");
+    osi_property_set("persist.bluetooth.snoopfilter.mode", "fullfilter");
+
+    // The filtered mode only logs ACL packets with one of the vendor modes
+    vendor_logging_level = HCI_SNOOP_LOG_FULL;
+    btsnoop_module.start_up();
+  }
+
+  ~SnoopLog() {
+    btsnoop_module.shut_down();
+    for (size_t i = 0; i < saved_.size(); i++)
+      osi_property_set(kProperties[i], saved_[i].c_str());
+    remove(kLogPath);
+    remove((std::string(kLogPath) + ".last").c_str());
+  }
+
+ private:
+  std::vector<std::string> saved_;
+};
+
+// Builds a received ACL packet of |data_size| bytes on |cid|
+std::vector<uint8_t> make_acl_packet(uint16_t cid, uint16_t data_size) {
+  std::vector<uint8_t> buffer(sizeof(BT_HDR) + kAclHeaderSize + data_size);
+  BT_HDR* packet = reinterpret_cast<BT_HDR*>(buffer.data());
+  packet->event = MSG_HC_TO_STACK_HCI_ACL;
+  packet->offset = 0;
+  packet->len = kAclHeaderSize + data_size;
+  packet->layer_specific = 0;
+
+  uint8_t* p = packet->data;
+  UINT16_TO_STREAM(p, kHandle | 0x2000);
+  UINT16_TO_STREAM(p, data_size);
+  UINT16_TO_STREAM(p, data_size - kL2capHeaderSize);
+  UINT16_TO_STREAM(p, cid);
+  for (uint16_t i = kL2capHeaderSize; i < data_size; i++) *p++ = i;
+  return buffer;
+}
+
+// Captures packets of |state.range(0)| bytes on |cid|
+void CapturePackets(State& state, const btsnoop_t* btsnoop, uint16_t cid) {
+  std::vector<uint8_t> buffer = make_acl_packet(cid, state.range(0));
+  const BT_HDR* packet = reinterpret_cast<const BT_HDR*>(buffer.data());
+
+  for (auto _ : state) {
+    btsnoop->capture(packet, true);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// ACL data sizes of LE without and with DLE and of BR/EDR 3-DH5
+void DataSizes(benchmark::internal::Benchmark* b) {
+  b->Arg(27)->Arg(251)->Arg(1021);
+}
+
+}  // namespace
+
+static void BM_CaptureUnfiltered(State& state) {
+  SnoopLog log("full");
+  CapturePackets(state, btsnoop_get_interface(), kFilteredCid);
+}
+BENCHMARK(BM_CaptureUnfiltered)->Apply(DataSizes);
+
+static void BM_CaptureWhitelist(State& state, uint16_t cid) {
+  SnoopLog log("filtered");
+  const btsnoop_t* btsnoop = btsnoop_get_interface();
+  btsnoop->whitelist_l2c_channel(kHandle, kLoggedCid, kLoggedCid);
+  CapturePackets(state, btsnoop, cid);
+  btsnoop->clear_l2cap_whitelist(kHandle, kLoggedCid, kLoggedCid);
+}
+BENCHMARK_CAPTURE(BM_CaptureWhitelist, logged, kLoggedCid)
+    ->Apply(DataSizes);
+BENCHMARK_CAPTURE(BM_CaptureWhitelist, filtered, kFilteredCid)
+    ->Apply(DataSizes);
+
+static void BM_CaptureProfiles(State& state, uint16_t cid) {
+  SnoopLog log("profilesfiltered");
+  if (!(vendor_logging_level & HCI_SNOOP_LOG_PROFILEFILTER)) {
+    state.SkipWithError("Profiles filter not available on this build");
+    return;
+  }
+
+  const btsnoop_t* btsnoop = btsnoop_get_interface();
+  btsnoop->set_l2cap_channel_open(kHandle, kFilteredCid, kFilteredCid,
+                                  kPsmPbap, false);
+  CapturePackets(state, btsnoop, cid);
+  btsnoop->set_l2cap_channel_close(kHandle, kFilteredCid, kFilteredCid);
+}
+BENCHMARK_CAPTURE(BM_CaptureProfiles, logged, kLoggedCid)->Apply(DataSizes);
+BENCHMARK_CAPTURE(BM_CaptureProfiles, filtered, kFilteredCid)
+    ->Apply(DataSizes);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,153 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// ACL throughput of the HCI layer. Run with --benchmark_format=json (or
+// --benchmark_out=<file> --benchmark_out_format=json) to get results that
+// can be compared between builds.
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "bt_types.h"
+#include "device/include/controller.h"
+#include "hci_internals.h"
+#include "osi/include/allocator.h"
+#include "osi/include/osi.h"
+#include "packet_fragmenter.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr uint16_t kHandle = 0x0042;
+constexpr uint16_t kL2capHeaderSize = 4;
+constexpr uint8_t kLocalBleControllerId = 1;
+
+uint16_t acl_data_size;
+uint64_t bytes_out;
+
+uint16_t get_acl_data_size() { return acl_data_size; }
+
+void fragmented(BT_HDR* packet, UNUSED_ATTR bool send_transmit_finished) {
+  bytes_out += packet->len - HCI_ACL_PREAMBLE_SIZE;
+}
+
+void reassembled(BT_HDR* packet) {
+  bytes_out += packet->len - HCI_ACL_PREAMBLE_SIZE;
+  allocator_malloc.free(packet);
+}
+
+void transmit_finished(UNUSED_ATTR BT_HDR* packet,
+                       UNUSED_ATTR bool all_fragments_sent) {}
+
+const packet_fragmenter_callbacks_t callbacks = {fragmented, reassembled,
+                                                 transmit_finished};
+
+const packet_fragmenter_t* fragmenter_init(uint16_t data_size) {
+  static controller_t controller;
+  controller.get_acl_data_size_classic = get_acl_data_size;
+  controller.get_acl_data_size_ble = get_acl_data_size;
+  acl_data_size = data_size;
+  bytes_out = 0;
+
+  const packet_fragmenter_t* fragmenter =
+      packet_fragmenter_get_test_interface(&controller, &allocator_malloc);
+  fragmenter->init(&callbacks);
+  return fragmenter;
+}
+
+// Writes an ACL header for |handle| and |data_length| bytes to |p|.
+void write_acl_header(uint8_t* p, uint16_t handle, uint16_t data_length) {
+  UINT16_TO_STREAM(p, handle);
+  UINT16_TO_STREAM(p, data_length);
+}
+
+// L2CAP PDU sizes (basic mode MTU of SDP, RFCOMM and AVDTP media, LE
+// credit based) and the ACL data sizes of BR/EDR 3-DH5, 2-DH5 and LE DLE
+void SizePairs(benchmark::internal::Benchmark* b) {
+  for (int pdu : {672, 1021, 2048, 4000}) {
+    for (int acl : {1021, 679, 251, 27}) b->Args({pdu, acl});
+  }
+}
+
+}  // namespace
+
+// Splits an L2CAP PDU of |state.range(0)| bytes into ACL packets of
+// |state.range(1)| bytes on its way to the controller.
+static void BM_AclFragment(State& state, uint8_t controller_id) {
+  uint16_t pdu_size = state.range(0);
+  const packet_fragmenter_t* fragmenter = fragmenter_init(state.range(1));
+  std::vector<uint8_t> buffer(sizeof(BT_HDR) + HCI_ACL_PREAMBLE_SIZE +
+                              pdu_size);
+  BT_HDR* packet = reinterpret_cast<BT_HDR*>(buffer.data());
+
+  for (auto _ : state) {
+    packet->event = MSG_STACK_TO_HC_HCI_ACL | controller_id;
+    packet->offset = 0;
+    packet->len = HCI_ACL_PREAMBLE_SIZE + pdu_size;
+    packet->layer_specific = 0;
+    write_acl_header(packet->data, kHandle | 0x2000, pdu_size);
+    fragmenter->fragment_and_dispatch(packet);
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(bytes_out);
+  fragmenter->cleanup();
+}
+BENCHMARK_CAPTURE(BM_AclFragment, classic, LOCAL_BR_EDR_CONTROLLER_ID)
+    ->Apply(SizePairs);
+BENCHMARK_CAPTURE(BM_AclFragment, ble, kLocalBleControllerId)
+    ->Apply(SizePairs);
+
+// Reassembles an L2CAP PDU of |state.range(0)| bytes received from the
+// controller in ACL packets of |state.range(1)| bytes, buffers included.
+static void BM_AclReassemble(State& state) {
+  uint16_t pdu_size = state.range(0);
+  uint16_t data_size = state.range(1);
+  const packet_fragmenter_t* fragmenter = fragmenter_init(data_size);
+  std::vector<uint8_t> pdu(pdu_size);
+  uint8_t* p = pdu.data();
+  UINT16_TO_STREAM(p, pdu_size - kL2capHeaderSize);
+  UINT16_TO_STREAM(p, 0x0040);
+  for (size_t i = kL2capHeaderSize; i < pdu.size(); i++) pdu[i] = i;
+
+  for (auto _ : state) {
+    for (uint16_t sent = 0; sent < pdu_size;) {
+      uint16_t length = std::min<uint16_t>(data_size, pdu_size - sent);
+      BT_HDR* packet = static_cast<BT_HDR*>(allocator_malloc.alloc(
+          sizeof(BT_HDR) + HCI_ACL_PREAMBLE_SIZE + length));
+      packet->event = MSG_HC_TO_STACK_HCI_ACL;
+      packet->offset = 0;
+      packet->len = HCI_ACL_PREAMBLE_SIZE + length;
+      packet->layer_specific = 0;
+      write_acl_header(packet->data, kHandle | (sent ? 0x1000 : 0x2000),
+                       length);
+      memcpy(packet->data + HCI_ACL_PREAMBLE_SIZE, pdu.data() + sent, length);
+      fragmenter->reassemble_and_dispatch(packet);
+      sent += length;
+    }
+  }
+  state.SetBytesProcessed(bytes_out);
+  fragmenter->cleanup();
+}
+BENCHMARK(BM_AclReassemble)->Apply(SizePairs);
+
+BENCHMARK_MAIN();
@@ -23,7 +23,8 @@
 #include "bt_gatt_client.h"
 #include "bt_gatt_types.h"
 
-/** Callback invoked when batchscan reports are obtained */
+/** Callback invoked when batchscan reports are obtained, possibly several
+ *  times per read when the reports are delivered in chunks */
 typedef void (*batchscan_reports_callback)(int client_if, int status,
                                            int report_format, int num_records,
                                            std::vector<uint8_t> data);
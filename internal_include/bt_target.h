@@ -188,6 +188,12 @@
 #define BTIF_DM_OOB_TEST TRUE
 #endif
 
+// Number of recently scanned LE devices whose properties are not written
+// again for every advertisement they send
+#ifndef BTIF_BLE_SCAN_ADDR_CACHE_SIZE
+#define BTIF_BLE_SCAN_ADDR_CACHE_SIZE 1024
+#endif
+
 // How long to wait before activating sniff mode after entering the
 // idle state for FTS, OPS connections
 #ifndef BTA_FTS_OPS_IDLE_TO_SNIFF_DELAY_MS
@@ -379,6 +385,20 @@
 #define BTM_INQ_DB_SIZE 40
 #endif
 
+/* Remote name requests held while another one is in progress. */
+#ifndef BTM_RMT_NAME_QUEUE_SIZE
+#define BTM_RMT_NAME_QUEUE_SIZE 8
+#endif
+
+/* Remote names remembered across inquiries, and for how long. */
+#ifndef BTM_RMT_NAME_CACHE_SIZE
+#define BTM_RMT_NAME_CACHE_SIZE BTM_INQ_DB_SIZE
+#endif
+
+#ifndef BTM_RMT_NAME_CACHE_TTL_MS
+#define BTM_RMT_NAME_CACHE_TTL_MS (30 * 60 * 1000)
+#endif
+
 /* The default scan mode */
 #ifndef BTM_DEFAULT_SCAN_TYPE
 #define BTM_DEFAULT_SCAN_TYPE BTM_SCAN_TYPE_INTERLACED
@@ -647,6 +667,18 @@
 #define L2CAP_HIGH_PRI_MIN_XMIT_QUOTA 5
 #endif
 
+/* ACL credits of a link that only its latency critical channels (A2DP media)
+ * may use, so the other channels of the link cannot fill the controller */
+#ifndef L2CAP_LATENCY_CRITICAL_RESERVE
+#define L2CAP_LATENCY_CRITICAL_RESERVE 2
+#endif
+
+/* Latency critical PDUs sent in a row, ahead of the other channels of the
+ * link, before one PDU of the other channels is let through */
+#ifndef L2CAP_LATENCY_CRITICAL_MAX_BURST
+#define L2CAP_LATENCY_CRITICAL_MAX_BURST 8
+#endif
+
 /* used for monitoring HCI ACL credit management */
 #ifndef L2CAP_HCI_FLOW_CONTROL_DEBUG
 #define L2CAP_HCI_FLOW_CONTROL_DEBUG TRUE
@@ -738,6 +770,22 @@
 #define BLE_PRIVACY_SPT TRUE
 #endif
 
+/*
+ * Time the resolving list changes are gathered before address resolution is
+ * turned back on, so that a burst of add/remove suspends the LE activity once.
+ */
+#ifndef BTM_BLE_RL_UPDATE_DELAY_MS
+#define BTM_BLE_RL_UPDATE_DELAY_MS 50
+#endif
+
+/*
+ * Largest chunk (in bytes) of batch scan records gathered before they are
+ * delivered, so that reading a full controller buffer does not hold it all.
+ */
+#ifndef BTM_BLE_BATCH_SCAN_REPORT_CHUNK_MAX
+#define BTM_BLE_BATCH_SCAN_REPORT_CHUNK_MAX 8192
+#endif
+
 /*
  * Enables or disables support for local privacy (ex. address rotation)
  */
@@ -813,8 +861,10 @@
  * create l2cap connection, it will use this fixed ID. */
 #define CONN_MGR_ID_L2CAP (GATT_MAX_APPS + 10)
 
+/* One GATT channel per link by default, so that raising MAX_ACL_CONNECTIONS
+ * raises both */
 #ifndef GATT_MAX_PHY_CHANNEL
-#define GATT_MAX_PHY_CHANNEL 7
+#define GATT_MAX_PHY_CHANNEL MAX_L2CAP_LINKS
 #endif
 
 /* Used for conformance testing ONLY */
@@ -875,6 +925,12 @@
 #define SDP_MAX_PAD_LEN 600
 #endif
 
+/* The maximum number of UUIDs indexed for each record. A record with more is
+ * searched by parsing its attributes. */
+#ifndef SDP_MAX_REC_UUIDS
+#define SDP_MAX_REC_UUIDS 16
+#endif
+
 /* The maximum length, in bytes, of an attribute. */
 #ifndef SDP_MAX_ATTR_LEN
 #define SDP_MAX_ATTR_LEN 400
@@ -979,6 +1035,24 @@
 #define PORT_RX_BUF_CRITICAL_WM 15
 #endif
 
+/* The largest credit window a port with a call out data path may grow to,
+ * in number of buffers. */
+#ifndef PORT_CREDIT_RX_MAX_WINDOW
+#define PORT_CREDIT_RX_MAX_WINDOW 40
+#endif
+
+/* The number of buffers a credit window grows by when the peer runs out of
+ * credits. */
+#ifndef PORT_CREDIT_RX_WINDOW_STEP
+#define PORT_CREDIT_RX_WINDOW_STEP 2
+#endif
+
+/* The receive memory, in bytes, all ports together may be granted above
+ * their initial credit window. */
+#ifndef PORT_CREDIT_RX_POOL_SIZE
+#define PORT_CREDIT_RX_POOL_SIZE (BTA_RFC_MTU_SIZE * 64)
+#endif
+
 /* The port transmit queue high watermark level, in bytes. */
 #ifndef PORT_TX_HIGH_WM
 #define PORT_TX_HIGH_WM (BTA_RFC_MTU_SIZE * PORT_TX_BUF_HIGH_WM)
@@ -1333,6 +1407,12 @@
 #define HID_DEV_FLUSH_TO 0xffff
 #endif
 
+/* Input reports held while the interrupt channel is congested. A report
+ * replaces the held report of the same ID. */
+#ifndef HID_DEV_MAX_HELD_REPORTS
+#define HID_DEV_MAX_HELD_REPORTS 8
+#endif
+
 /*************************************************************************
  * Definitions for Both HID-Host & Device
 */
@@ -1387,6 +1467,11 @@
 #define TWS_STATE_ENABLED TRUE
 #endif
 #endif
+
+/* Offer the audio HALs a shared memory ring for the UIPC audio channel */
+#ifndef UIPC_SHM_INCLUDED
+#define UIPC_SHM_INCLUDED TRUE
+#endif
 /******************************************************************************
  *
  * AVCTP
@@ -1480,6 +1565,11 @@ incoming connection
 #define BTSNOOP_MEM TRUE
 #endif
 
+/* Enable/disable the data path trace markers of bt_trace_span.h */
+#ifndef BT_TRACE_SPANS
+#define BT_TRACE_SPANS FALSE
+#endif
+
 /* Enable iot info logging */
 #ifndef BT_IOT_LOGGING_ENABLED
 #define BT_IOT_LOGGING_ENABLED TRUE
@@ -950,6 +950,9 @@ extern uint8_t appl_trace_level;
 void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...);
 void vnd_LogMsg (uint32_t trace_set_mask, const char *fmt_str, ...);
 
+/* Dumps the traces kept in memory by the binary trace log to |fd| */
+void bte_binary_log_dump(int fd);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,88 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include "bt_target.h"
+
+// Trace markers along the data path: the layers mark the span of time they
+// handle a packet, and the hops between threads are async spans. Packets are
+// identified by their buffer, which most of them keep from the encoder down
+// to HCI or from HCI up to GATT, so one trace shows where each packet spent
+// its time. The markers are compiled out unless BT_TRACE_SPANS is TRUE.
+//
+//   BT_TRACE_SCOPE(name)                 Marks the rest of the block
+//   BT_TRACE_PACKET_SCOPE(name, p_buf)   Same, for the packet in |p_buf|
+//   BT_TRACE_PACKET_BEGIN(name, p_buf)   Starts a span for |p_buf|, ended
+//   BT_TRACE_PACKET_END(name, p_buf)     with the same name on any thread
+//
+// A block holds at most one scope marker.
+
+#if (BT_TRACE_SPANS == TRUE)
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <cutils/trace.h>
+
+#ifndef BT_TRACE_TAG
+#define BT_TRACE_TAG ATRACE_TAG_ALWAYS
+#endif
+
+#define BT_TRACE_PACKET_ID(p_buf) ((int32_t)(uintptr_t)(p_buf))
+
+class BtTraceScope {
+ public:
+  explicit BtTraceScope(const char* name)
+      : begun_(atrace_is_tag_enabled(BT_TRACE_TAG)) {
+    if (begun_) atrace_begin(BT_TRACE_TAG, name);
+  }
+
+  BtTraceScope(const char* name, const void* p_buf)
+      : begun_(atrace_is_tag_enabled(BT_TRACE_TAG)) {
+    if (!begun_) return;
+    char span_name[64];
+    snprintf(span_name, sizeof(span_name), "%s #%08x", name,
+             BT_TRACE_PACKET_ID(p_buf));
+    atrace_begin(BT_TRACE_TAG, span_name);
+  }
+
+  ~BtTraceScope() {
+    if (begun_) atrace_end(BT_TRACE_TAG);
+  }
+
+ private:
+  bool begun_;
+};
+
+#define BT_TRACE_SCOPE(name) BtTraceScope bt_trace_scope_(name)
+#define BT_TRACE_PACKET_SCOPE(name, p_buf) \
+  BtTraceScope bt_trace_scope_(name, p_buf)
+#define BT_TRACE_PACKET_BEGIN(name, p_buf) \
+  atrace_async_begin(BT_TRACE_TAG, name, BT_TRACE_PACKET_ID(p_buf))
+#define BT_TRACE_PACKET_END(name, p_buf) \
+  atrace_async_end(BT_TRACE_TAG, name, BT_TRACE_PACKET_ID(p_buf))
+
+#else
+
+#define BT_TRACE_SCOPE(name)
+#define BT_TRACE_PACKET_SCOPE(name, p_buf)
+#define BT_TRACE_PACKET_BEGIN(name, p_buf)
+#define BT_TRACE_PACKET_END(name, p_buf)
+
+#endif
@@ -27,6 +27,7 @@ static const char STACK_CONFIG_MODULE[] = "stack_config_module";
 
 typedef struct {
   bool (*get_trace_config_enabled)(void);
+  bool (*get_trace_binary_enabled)(void);
   bool (*get_pts_secure_only_mode)(void);
   bool (*get_pts_conn_updates_disabled)(void);
   bool (*get_pts_crosskey_sdp_disable)(void);
@@ -43,6 +44,9 @@ typedef struct {
   int (*get_pts_bredr_invalid_encryption_keysize)(void);
   int (*get_pts_le_enc_disable)(void);
   int (*get_pts_smp_disable_h7_support)(void);
+  int (*get_inq_db_size)(void);
+  bool (*get_a2dp_source_tick_pll_enabled)(void);
+  int (*get_le_coc_credit_threshold)(void);
   config_t* (*get_all)(void);
 } stack_config_t;
 
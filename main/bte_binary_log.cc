@@ -0,0 +1,498 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Binary trace log. While enabled, the API, event and debug traces of LogMsg
+// are kept as their format string and raw arguments in a ring of the thread
+// tracing, and only formatted when dumped. A trace costs a scan of its
+// format string and a copy of its arguments, without locking, so verbose
+// levels can be turned on without changing the timing of the stack threads.
+//
+// The format strings of the trace macros are literals, so only their address
+// is kept. The %s arguments are copied, truncated if the strings of a trace
+// are longer than BTE_BINARY_LOG_STRING_SIZE. A trace whose format cannot be
+// deferred, such as one using %n or %m, is logged right away.
+
+#define LOG_TAG "bt_bte_binary_log"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/prctl.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "bt_target.h"
+#include "bt_types.h"
+#include "main_int.h"
+#include "osi/include/time.h"
+
+// Traces kept per thread
+#ifndef BTE_BINARY_LOG_RECORDS
+#define BTE_BINARY_LOG_RECORDS 512
+#endif
+
+// Arguments of a trace, including the '*' widths and precisions
+#ifndef BTE_BINARY_LOG_MAX_ARGS
+#define BTE_BINARY_LOG_MAX_ARGS 12
+#endif
+
+// Bytes kept of the %s arguments of a trace
+#ifndef BTE_BINARY_LOG_STRING_SIZE
+#define BTE_BINARY_LOG_STRING_SIZE 64
+#endif
+
+// Longest line of a formatted trace
+#define BTE_BINARY_LOG_LINE_SIZE 1024
+
+namespace {
+
+enum ArgClass {
+  kArgNone,  // %%
+  kArgInt,
+  kArgLong,
+  kArgLongLong,
+  kArgSize,
+  kArgIntMax,
+  kArgPtrdiff,
+  kArgDouble,
+  kArgPointer,
+  kArgString,
+  kArgInvalid,
+};
+
+struct Trace {
+  uint32_t trace_set_mask;
+  uint64_t timestamp_us;
+  const char* fmt_str;
+  union {
+    uint64_t i;
+    double d;
+    const void* p;
+    size_t s;  // Offset of a string in |strings|
+  } args[BTE_BINARY_LOG_MAX_ARGS];
+  char strings[BTE_BINARY_LOG_STRING_SIZE];
+};
+
+struct Record {
+  std::atomic<uint32_t> sequence;  // 0 if empty, odd while written
+  Trace trace;
+};
+
+struct Ring {
+  std::atomic<bool> in_use;
+  uint64_t next;  // Only used by the thread of the ring
+  char thread_name[16];
+  Record records[BTE_BINARY_LOG_RECORDS];
+};
+
+std::atomic<bool> enabled(false);
+
+// The rings are never freed, the ring of a thread that exited is given to the
+// next thread tracing. Guarded by |rings_lock|.
+std::mutex rings_lock;
+std::vector<Ring*> rings;
+
+struct RingOwner {
+  Ring* ring = nullptr;
+  ~RingOwner() {
+    if (ring != nullptr) ring->in_use.store(false);
+  }
+};
+thread_local RingOwner ring_owner;
+
+// Parses the conversion specification |spec|, following a '%'. Returns its
+// length, with the class of its argument in |arg_class| and the number of '*'
+// fields before the argument, each an int argument, in |stars|. Returns 0 if
+// the specification cannot be deferred.
+size_t ParseSpec(const char* spec, ArgClass* arg_class, int* stars) {
+  const char* p = spec;
+  *stars = 0;
+  if (*p == '%') {
+    *arg_class = kArgNone;
+    return 1;
+  }
+
+  while (*p != '\0' && strchr("-+ #0'", *p) != NULL) p++;
+  if (*p == '*') {
+    (*stars)++;
+    p++;
+  } else {
+    while (*p >= '0' && *p <= '9') p++;
+  }
+  if (*p == '.') {
+    p++;
+    if (*p == '*') {
+      (*stars)++;
+      p++;
+    } else {
+      while (*p >= '0' && *p <= '9') p++;
+    }
+  }
+
+  ArgClass length = kArgInt;
+  switch (*p) {
+    case 'h':
+      p++;
+      if (*p == 'h') p++;
+      break;
+    case 'l':
+      p++;
+      if (*p == 'l') {
+        p++;
+        length = kArgLongLong;
+      } else {
+        length = kArgLong;
+      }
+      break;
+    case 'q':
+      p++;
+      length = kArgLongLong;
+      break;
+    case 'z':
+      p++;
+      length = kArgSize;
+      break;
+    case 'j':
+      p++;
+      length = kArgIntMax;
+      break;
+    case 't':
+      p++;
+      length = kArgPtrdiff;
+      break;
+    case 'L':
+      p++;
+      length = kArgInvalid;
+      break;
+  }
+
+  switch (*p) {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+      *arg_class = length;
+      break;
+    case 'c':
+      *arg_class = (length == kArgInt) ? kArgInt : kArgInvalid;
+      break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      *arg_class =
+          (length == kArgInt || length == kArgLong) ? kArgDouble : kArgInvalid;
+      break;
+    case 'p':
+      *arg_class = kArgPointer;
+      break;
+    case 's':
+      *arg_class = (length == kArgInt) ? kArgString : kArgInvalid;
+      break;
+    default:
+      *arg_class = kArgInvalid;
+      break;
+  }
+  if (*arg_class == kArgInvalid) return 0;
+  return p - spec + 1;
+}
+
+// Copies the arguments |ap| of |fmt_str| to |trace|.
+// Returns false if the trace cannot be deferred.
+bool Capture(Trace* trace, const char* fmt_str, va_list ap) {
+  size_t nargs = 0;
+  size_t strings_len = 0;
+  trace->strings[BTE_BINARY_LOG_STRING_SIZE - 1] = '\0';
+
+  for (const char* p = fmt_str; *p != '\0'; p++) {
+    if (*p != '%') continue;
+
+    ArgClass arg_class;
+    int stars;
+    size_t len = ParseSpec(p + 1, &arg_class, &stars);
+    if (len == 0) return false;
+    p += len;
+    if (arg_class == kArgNone) continue;
+    if (nargs + stars + 1 > BTE_BINARY_LOG_MAX_ARGS) return false;
+
+    for (int i = 0; i < stars; i++) trace->args[nargs++].i = va_arg(ap, int);
+
+    auto& arg = trace->args[nargs++];
+    switch (arg_class) {
+      case kArgInt:
+        arg.i = va_arg(ap, unsigned int);
+        break;
+      case kArgLong:
+        arg.i = va_arg(ap, unsigned long);
+        break;
+      case kArgLongLong:
+        arg.i = va_arg(ap, unsigned long long);
+        break;
+      case kArgSize:
+        arg.i = va_arg(ap, size_t);
+        break;
+      case kArgIntMax:
+        arg.i = va_arg(ap, uintmax_t);
+        break;
+      case kArgPtrdiff:
+        arg.i = va_arg(ap, ptrdiff_t);
+        break;
+      case kArgDouble:
+        arg.d = va_arg(ap, double);
+        break;
+      case kArgPointer:
+        arg.p = va_arg(ap, void*);
+        break;
+      case kArgString: {
+        const char* str = va_arg(ap, const char*);
+        if (str == NULL) str = "(null)";
+        if (strings_len >= BTE_BINARY_LOG_STRING_SIZE - 1) {
+          arg.s = BTE_BINARY_LOG_STRING_SIZE - 1;
+          break;
+        }
+        size_t str_len =
+            strnlen(str, BTE_BINARY_LOG_STRING_SIZE - 1 - strings_len);
+        memcpy(&trace->strings[strings_len], str, str_len);
+        trace->strings[strings_len + str_len] = '\0';
+        arg.s = strings_len;
+        strings_len += str_len + 1;
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+template <typename T>
+int FormatArg(char* buf, size_t size, const char* spec, int stars,
+              const int* star_args, T value) {
+  switch (stars) {
+    case 0:
+      return snprintf(buf, size, spec, value);
+    case 1:
+      return snprintf(buf, size, spec, star_args[0], value);
+    default:
+      return snprintf(buf, size, spec, star_args[0], star_args[1], value);
+  }
+}
+
+// Formats |trace| to |buf| of |size| bytes, as LogMsg would have.
+void Format(const Trace& trace, char* buf, size_t size) {
+  size_t out = 0;
+  size_t nargs = 0;
+
+  const char* p = trace.fmt_str;
+  while (*p != '\0' && out < size - 1) {
+    if (*p != '%') {
+      buf[out++] = *p++;
+      continue;
+    }
+
+    ArgClass arg_class;
+    int stars;
+    size_t len = ParseSpec(p + 1, &arg_class, &stars);
+    char spec[32];
+    if (len + 2 > sizeof(spec)) break;
+    memcpy(spec, p, len + 1);
+    spec[len + 1] = '\0';
+    p += len + 1;
+    if (arg_class == kArgNone) {
+      buf[out++] = '%';
+      continue;
+    }
+
+    int star_args[2] = {0, 0};
+    for (int i = 0; i < stars; i++) star_args[i] = (int)trace.args[nargs++].i;
+
+    const auto& arg = trace.args[nargs++];
+    char* dst = &buf[out];
+    size_t room = size - out;
+    int written = 0;
+    switch (arg_class) {
+      case kArgInt:
+        written = FormatArg(dst, room, spec, stars, star_args, (int)arg.i);
+        break;
+      case kArgLong:
+        written = FormatArg(dst, room, spec, stars, star_args, (long)arg.i);
+        break;
+      case kArgLongLong:
+        written =
+            FormatArg(dst, room, spec, stars, star_args, (long long)arg.i);
+        break;
+      case kArgSize:
+        written = FormatArg(dst, room, spec, stars, star_args, (size_t)arg.i);
+        break;
+      case kArgIntMax:
+        written =
+            FormatArg(dst, room, spec, stars, star_args, (intmax_t)arg.i);
+        break;
+      case kArgPtrdiff:
+        written =
+            FormatArg(dst, room, spec, stars, star_args, (ptrdiff_t)arg.i);
+        break;
+      case kArgDouble:
+        written = FormatArg(dst, room, spec, stars, star_args, arg.d);
+        break;
+      case kArgPointer:
+        written = FormatArg(dst, room, spec, stars, star_args, arg.p);
+        break;
+      case kArgString:
+        written = FormatArg(dst, room, spec, stars, star_args,
+                            &trace.strings[arg.s]);
+        break;
+      default:
+        break;
+    }
+    if (written < 0) break;
+    out += std::min((size_t)written, room - 1);
+  }
+  buf[out] = '\0';
+}
+
+Ring* ThreadRing() {
+  if (ring_owner.ring != nullptr) return ring_owner.ring;
+
+  std::lock_guard<std::mutex> lock(rings_lock);
+  Ring* ring = nullptr;
+  for (Ring* candidate : rings) {
+    if (!candidate->in_use.load()) {
+      ring = candidate;
+      break;
+    }
+  }
+  if (ring == nullptr) {
+    ring = new Ring();
+    rings.push_back(ring);
+  } else {
+    // The traces of the previous thread would be dumped under this one
+    for (Record& record : ring->records) record.sequence.store(0);
+    ring->next = 0;
+  }
+  ring->in_use.store(true);
+  memset(ring->thread_name, 0, sizeof(ring->thread_name));
+  prctl(PR_GET_NAME, ring->thread_name);
+  ring_owner.ring = ring;
+  return ring;
+}
+
+char TraceTypeLetter(uint32_t trace_set_mask) {
+  switch (TRACE_GET_TYPE(trace_set_mask)) {
+    case TRACE_TYPE_API:
+    case TRACE_TYPE_EVENT:
+      return 'I';
+    case TRACE_TYPE_DEBUG:
+      return 'D';
+    default:
+      return '?';
+  }
+}
+
+}  // namespace
+
+void bte_binary_log_set_enabled(bool enable) { enabled.store(enable); }
+
+bool bte_binary_log_enabled(void) {
+  return enabled.load(std::memory_order_relaxed);
+}
+
+bool bte_binary_log_record(uint32_t trace_set_mask, const char* fmt_str,
+                           va_list ap) {
+  Trace trace;
+  va_list args;
+  va_copy(args, ap);
+  bool captured = Capture(&trace, fmt_str, args);
+  va_end(args);
+  if (!captured) return false;
+
+  trace.trace_set_mask = trace_set_mask;
+  trace.timestamp_us = time_get_os_boottime_us();
+  trace.fmt_str = fmt_str;
+
+  // A seqlock, the dump skips a record whose sequence changed while copied
+  Ring* ring = ThreadRing();
+  Record& record = ring->records[ring->next % BTE_BINARY_LOG_RECORDS];
+  uint32_t sequence = record.sequence.load(std::memory_order_relaxed);
+  record.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(&record.trace, &trace, sizeof(trace));
+  record.sequence.store(sequence + 2, std::memory_order_release);
+  ring->next++;
+  return true;
+}
+
+void bte_binary_log_dump(int fd) {
+  struct Entry {
+    Trace trace;
+    size_t thread;
+  };
+  std::vector<Entry> entries;
+  std::vector<std::string> thread_names;
+
+  {
+    std::lock_guard<std::mutex> lock(rings_lock);
+    if (rings.empty()) return;
+
+    for (Ring* ring : rings) {
+      thread_names.push_back(ring->thread_name);
+      for (Record& record : ring->records) {
+        uint32_t sequence = record.sequence.load(std::memory_order_acquire);
+        if (sequence == 0 || (sequence & 1)) continue;
+
+        Entry entry;
+        memcpy(&entry.trace, &record.trace, sizeof(entry.trace));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (record.sequence.load(std::memory_order_relaxed) != sequence)
+          continue;
+        entry.thread = thread_names.size() - 1;
+        entries.push_back(entry);
+      }
+    }
+  }
+
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry& a, const Entry& b) {
+              return a.trace.timestamp_us < b.trace.timestamp_us;
+            });
+
+  dprintf(fd, "\nBinary trace log (%s, %zu traces):\n",
+          bte_binary_log_enabled() ? "enabled" : "disabled", entries.size());
+  char line[BTE_BINARY_LOG_LINE_SIZE];
+  for (const Entry& entry : entries) {
+    Format(entry.trace, line, sizeof(line));
+    dprintf(fd, "  %" PRIu64 ".%06" PRIu64 " %-15s %c %s: %s\n",
+            entry.trace.timestamp_us / 1000000,
+            entry.trace.timestamp_us % 1000000,
+            thread_names[entry.thread].c_str(),
+            TraceTypeLetter(entry.trace.trace_set_mask),
+            bte_trace_layer_tag(entry.trace.trace_set_mask), line);
+  }
+}
@@ -189,12 +189,27 @@ static tBTTRC_FUNC_MAP bttrc_set_level_map[] = {
 
     {0, 0, NULL, NULL, DEFAULT_CONF_TRACE_LEVEL}};
 
+const char* bte_trace_layer_tag(uint32_t trace_set_mask) {
+  int trace_layer = TRACE_GET_LAYER(trace_set_mask);
+  if (trace_layer >= TRACE_LAYER_MAX_NUM) trace_layer = 0;
+  return bt_layer_tags[trace_layer];
+}
+
 void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {
   char buffer[BTE_LOG_BUF_SIZE];
   int trace_layer = TRACE_GET_LAYER(trace_set_mask);
   if (trace_layer >= TRACE_LAYER_MAX_NUM) trace_layer = 0;
 
   va_list ap;
+  uint32_t trace_type = TRACE_GET_TYPE(trace_set_mask);
+  if (bte_binary_log_enabled() && trace_type >= TRACE_TYPE_API &&
+      trace_type <= TRACE_TYPE_DEBUG) {
+    va_start(ap, fmt_str);
+    bool recorded = bte_binary_log_record(trace_set_mask, fmt_str, ap);
+    va_end(ap);
+    if (recorded) return;
+  }
+
   va_start(ap, fmt_str);
   vsnprintf(&buffer[MSG_BUFFER_OFFSET], BTE_LOG_MAX_SIZE, fmt_str, ap);
   va_end(ap);
@@ -278,6 +293,7 @@ static void load_levels_from_config(const config_t* config) {
 
 static future_t* init(void) {
   const stack_config_t* stack_config = stack_config_get_interface();
+  bte_binary_log_set_enabled(stack_config->get_trace_binary_enabled());
   if (!stack_config->get_trace_config_enabled()) {
     LOG_INFO(LOG_TAG, "using compile default trace settings");
     return NULL;
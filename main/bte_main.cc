@@ -38,6 +38,7 @@
 #include <hardware/vendor.h>
 
 #include "bt_common.h"
+#include "bt_trace_span.h"
 #include "bt_hci_bdroid.h"
 #include "bt_utils.h"
 #include "bta_api.h"
@@ -55,6 +56,7 @@
 #include "osi/include/future.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/task_stats.h"
 #include "osi/include/thread.h"
 #include "stack_config.h"
 
@@ -108,8 +110,12 @@ void post_to_hci_message_loop(const base::Location& from_here,
     return;
   }
 
+  BT_TRACE_PACKET_BEGIN("btu rx queue", p_msg);
+  if (btu_le_data_post(from_here, p_msg)) return;
+
   hci_message_loop->task_runner()->PostTask(
-      from_here, base::Bind(&btu_hci_msg_process, p_msg));
+      from_here, task_stats_wrap(BTU_MESSAGE_LOOP_NAME, from_here,
+                                 base::Bind(&btu_hci_msg_process, p_msg)));
 }
 
 /******************************************************************************
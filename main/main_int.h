@@ -19,9 +19,26 @@
 #ifndef MAIN_INT_H
 #define MAIN_INT_H
 
+#include <stdarg.h>
+#include <stdint.h>
+
 #include "osi/include/config.h"
 
 /* Initiates the logging for C++ */
 void init_cpp_logging(config_t* config);
 
+/* Returns the log tag of the layer of |trace_set_mask| */
+const char* bte_trace_layer_tag(uint32_t trace_set_mask);
+
+/* Keeps the API, event and debug traces of LogMsg in the binary trace log,
+ * formatted only when dumped, while enabled */
+void bte_binary_log_set_enabled(bool enable);
+bool bte_binary_log_enabled(void);
+
+/* Records the trace of |fmt_str| and its arguments |ap| in the binary trace
+ * log of the calling thread. Returns false if the format cannot be deferred,
+ * the trace is then to be logged right away. */
+bool bte_binary_log_record(uint32_t trace_set_mask, const char* fmt_str,
+                           va_list ap);
+
 #endif  // MAIN_INT_H
@@ -21,11 +21,15 @@
 #include "stack_config.h"
 
 #include <base/logging.h>
+#include <sched.h>
+#include <stdlib.h>
 
 #include "osi/include/future.h"
 #include "osi/include/log.h"
+#include "osi/include/thread.h"
 
 const char* TRACE_CONFIG_ENABLED_KEY = "TraceConf";
+const char* TRACE_BINARY_ENABLED_KEY = "TraceBinary";
 const char* PTS_SECURE_ONLY_MODE = "PTS_SecurePairOnly";
 const char* PTS_LE_CONN_UPDATED_DISABLED = "PTS_DisableConnUpdates";
 const char* PTS_DISABLE_SDP_LE_PAIR = "PTS_DisableSDPOnLEPair";
@@ -42,9 +46,20 @@ const char* PTS_BREDR_SECURECONNECTION_HOSTSUPPORT_DISABLE = "PTS_BredrSecConnHo
 const char* PTS_BREDR_INVALID_ENCRYPTION_KEYSIZE = "PTS_BredrInvalidEncryKeysize";
 const char* PTS_LE_DISABLE_ENCRYP = "PTS_LeDisableEncryp";
 const char* PTS_SMP_DISABLE_H7_SUPPORT = "PTS_DisableH7Support";
+const char* INQ_DB_SIZE_KEY = "InqDbSize";
+const char* A2DP_SOURCE_TICK_PLL_KEY = "A2dpSourceTickPll";
+const char* LE_COC_CREDIT_THRESHOLD_KEY = "LeCocCreditThreshold";
+
+// Sections named "Thread:<thread name>" set the scheduling policy of a thread
+const char* THREAD_POLICY_SECTION_PREFIX = "Thread:";
+const char* THREAD_SCHED_CLASS_KEY = "SchedClass";
+const char* THREAD_PRIORITY_KEY = "Priority";
+const char* THREAD_CPU_AFFINITY_KEY = "CpuAffinity";
 
 static config_t* config;
 
+static void set_thread_policies(void);
+
 // Module lifecycle functions
 
 static future_t* init() {
@@ -64,9 +79,48 @@ static future_t* init() {
     config = config_new_empty();
   }
 
+  set_thread_policies();
   return future_new_immediate(FUTURE_SUCCESS);
 }
 
+// Hands the thread policies of the config to the thread library, before the
+// stack threads are started.
+static void set_thread_policies(void) {
+  const size_t prefix_len = strlen(THREAD_POLICY_SECTION_PREFIX);
+
+  for (const config_section_node_t* node = config_section_begin(config);
+       node != config_section_end(config); node = config_section_next(node)) {
+    const char* section = config_section_name(node);
+    if (strncmp(section, THREAD_POLICY_SECTION_PREFIX, prefix_len) != 0)
+      continue;
+
+    thread_policy_t policy;
+    const char* sched_class =
+        config_get_string(config, section, THREAD_SCHED_CLASS_KEY, "");
+    if (strcmp(sched_class, "other") == 0) {
+      policy.sched_class = SCHED_OTHER;
+    } else if (strcmp(sched_class, "fifo") == 0) {
+      policy.sched_class = SCHED_FIFO;
+    } else if (strcmp(sched_class, "rr") == 0) {
+      policy.sched_class = SCHED_RR;
+    } else {
+      if (*sched_class != '\0')
+        LOG_ERROR(LOG_TAG, "%s unknown %s %s in %s", __func__,
+                  THREAD_SCHED_CLASS_KEY, sched_class, section);
+      policy.sched_class = -1;
+    }
+    policy.priority = config_get_int(config, section, THREAD_PRIORITY_KEY, 0);
+    policy.cpu_mask = strtoull(
+        config_get_string(config, section, THREAD_CPU_AFFINITY_KEY, "0"), NULL,
+        0);
+
+    LOG_INFO(LOG_TAG, "%s %s: class %d, priority %d, CPU mask 0x%llx",
+             __func__, section + prefix_len, policy.sched_class,
+             policy.priority, (unsigned long long)policy.cpu_mask);
+    thread_set_policy(section + prefix_len, &policy);
+  }
+}
+
 static future_t* clean_up() {
   config_free(config);
   config = NULL;
@@ -87,6 +141,11 @@ static bool get_trace_config_enabled(void) {
                          TRACE_CONFIG_ENABLED_KEY, false);
 }
 
+static bool get_trace_binary_enabled(void) {
+  return config_get_bool(config, CONFIG_DEFAULT_SECTION,
+                         TRACE_BINARY_ENABLED_KEY, false);
+}
+
 static bool get_pts_secure_only_mode(void) {
   return config_get_bool(config, CONFIG_DEFAULT_SECTION, PTS_SECURE_ONLY_MODE,
                          false);
@@ -165,9 +224,24 @@ static int get_pts_bredr_invalid_encryption_keysize(void) {
                         PTS_BREDR_INVALID_ENCRYPTION_KEYSIZE, 0);
 }
 
+static int get_inq_db_size(void) {
+  return config_get_int(config, CONFIG_DEFAULT_SECTION, INQ_DB_SIZE_KEY, 0);
+}
+
+static bool get_a2dp_source_tick_pll_enabled(void) {
+  return config_get_bool(config, CONFIG_DEFAULT_SECTION,
+                         A2DP_SOURCE_TICK_PLL_KEY, false);
+}
+
+static int get_le_coc_credit_threshold(void) {
+  return config_get_int(config, CONFIG_DEFAULT_SECTION,
+                        LE_COC_CREDIT_THRESHOLD_KEY, 0);
+}
+
 static config_t* get_all(void) { return config; }
 
 const stack_config_t interface = {get_trace_config_enabled,
+                                  get_trace_binary_enabled,
                                   get_pts_secure_only_mode,
                                   get_pts_conn_updates_disabled,
                                   get_pts_crosskey_sdp_disable,
@@ -184,6 +258,9 @@ const stack_config_t interface = {get_trace_config_enabled,
                                   get_pts_bredr_invalid_encryption_keysize,
                                   get_pts_le_enc_disable,
                                   get_pts_smp_disable_h7_support,
+                                  get_inq_db_size,
+                                  get_a2dp_source_tick_pll_enabled,
+                                  get_le_coc_credit_threshold,
                                   get_all};
 
 const stack_config_t* stack_config_get_interface(void) { return &interface; }
@@ -78,6 +78,14 @@ void* alarm_free(alarm_t* alarm);
 void alarm_set(alarm_t* alarm, period_ms_t interval_ms, alarm_callback_t cb,
                void* data);
 
+// Same as |alarm_set|, but the callback may be delayed by up to |slack_ms|
+// after |interval_ms|. Expirations of alarms whose windows overlap are
+// coalesced into a single timer expiration, so that the stack wakes up once
+// for all of them. Use this for timeouts that do not need to be precise.
+void alarm_set_with_slack(alarm_t* alarm, period_ms_t interval_ms,
+                          period_ms_t slack_ms, alarm_callback_t cb,
+                          void* data);
+
 // Sets an |alarm| to execute a callback in the main message loop. This function
 // is same as |alarm_set| except that the |cb| callback is scheduled for
 // execution in the context of the main message loop.
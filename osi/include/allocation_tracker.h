@@ -57,3 +57,15 @@ void* allocation_tracker_notify_free(allocator_id_t allocator_id, void* ptr);
 // Get the full size for an allocation, taking into account the size of
 // canaries.
 size_t allocation_tracker_resize_for_canary(size_t size);
+
+// Start sampling one in |interval| allocations: each sampled allocation is
+// counted by size class and by call site, for |osi_allocator_debug_dump|.
+// Sampling only takes a per-thread countdown on the allocations it skips and
+// a few atomic additions on those it samples, so, unlike the full tracking
+// started by |allocation_tracker_init|, it can stay on in production. An
+// |interval| of 0 stops sampling. The counts start over on each call.
+void allocation_tracker_init_sampling(size_t interval);
+
+// Notify the sampler of an allocation of |size| bytes made by the code at
+// |caller|. Does nothing unless sampling is on.
+void allocation_tracker_sample_alloc(size_t size, const void* caller);
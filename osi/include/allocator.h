@@ -34,6 +34,9 @@ typedef struct {
 extern const allocator_t allocator_malloc;
 extern const allocator_t allocator_calloc;
 
+// allocator_t abstraction for the osi_pool_malloc and osi_free functions
+extern const allocator_t allocator_pool;
+
 char* osi_strdup(const char* str);
 char* osi_strndup(const char* str, size_t len);
 
@@ -41,6 +44,30 @@ void* osi_malloc(size_t size);
 void* osi_calloc(size_t size);
 void osi_free(void* ptr);
 
+// Allocate |size| bytes from the size-class buffer pool. The pool is tuned
+// for BT_HDR packet buffers; requests that do not fit any size class, or that
+// arrive while the matching class is exhausted, are served from the heap.
+// Buffers must be released with |osi_free|.
+void* osi_pool_malloc(size_t size);
+
+// Same as |osi_pool_malloc| but the returned buffer is zero-filled.
+void* osi_pool_calloc(size_t size);
+
+// Add a reference to the pool buffer |ptr|. Each reference is released with
+// |osi_free| and the buffer goes back to the pool with the last one. Returns
+// |ptr|, or NULL if |ptr| was served from the heap and cannot be shared; the
+// caller must then copy it. |ptr| cannot be NULL.
+void* osi_ref(void* ptr);
+
+// Returns true if |ptr| is a pool buffer with more than one reference.
+bool osi_is_shared(const void* ptr);
+
+// Returns the number of bytes that may be used from |ptr|, which can be more
+// than were requested as the pool rounds up to its size classes. Returns 0 if
+// that is not known: for heap buffers and while the allocation tracker checks
+// the bytes following the requested size.
+size_t osi_pool_capacity(const void* ptr);
+
 // Free a buffer that was previously allocated with function |osi_malloc|
 // or |osi_calloc| and reset the pointer to that buffer to NULL.
 // |p_ptr| is a pointer to the buffer pointer to be reset.
@@ -51,3 +78,7 @@ void osi_free_and_reset(void** p_ptr);
 // descriptor.
 // The information is in user-readable text format. The |fd| must be valid.
 void osi_allocator_debug_dump(int fd);
+
+// Dump buffer pool statistics to the |fd| file descriptor.
+// The information is in user-readable text format. The |fd| must be valid.
+void osi_pool_debug_dump(int fd);
@@ -17,6 +17,7 @@
 // - All strings are case sensitive.
 
 #include <stdbool.h>
+#include <string>
 #include "stack/include/bt_types.h"
 #include "bt_target.h"
 
@@ -181,6 +182,35 @@ void config_sections_sort_by_entry_key(config_t* config, compare_func comp);
 // be lost. Neither |config| nor |filename| may be NULL.
 bool config_save(const config_t* config, const char* filename);
 
+// Returns true for each |section| of |config| that |config_save_filtered|
+// should write.
+typedef bool (*config_section_filter_t)(const config_t* config,
+                                        const char* section);
+
+// Same as |config_save|, but only writes the sections for which |filter|
+// returns true. |filter| may be NULL, in which case all sections are written.
+// Only the sections modified since they were last saved are serialized again.
+bool config_save_filtered(const config_t* config, const char* filename,
+                          config_section_filter_t filter);
+
+// Returns the contents |config_save_filtered| writes for |config| and
+// |filter|. |config| may not be NULL, |filter| may be NULL.
+std::string config_serialize(const config_t* config,
+                             config_section_filter_t filter);
+
+// Writes |contents|, as returned by |config_serialize|, to a file given by
+// |filename| with the same guarantees as |config_save|. It does not access any
+// config, so the caller does not need to hold the lock protecting it.
+bool config_save_contents(const std::string& contents, const char* filename);
+
+// Returns true if |config| was modified since it was created or since the
+// last call to |config_clear_dirty|. |config| may not be NULL.
+bool config_is_dirty(const config_t* config);
+
+// Marks |config| as unmodified, typically once it has been saved. |config| may
+// not be NULL.
+void config_clear_dirty(config_t* config);
+
 // Saves the encrypted |checksum| of config file to a given |filename| Note
 // that this could be a destructive operation: if |filename| already exists,
 // it will be overwritten.
@@ -29,6 +29,11 @@ typedef struct reactor_t reactor_t;
 
 typedef void (*fixed_queue_free_cb)(void* data);
 typedef void (*fixed_queue_cb)(fixed_queue_t* queue, void* context);
+// Maximum number of elements handed to a |fixed_queue_batch_cb| in one call.
+#define FIXED_QUEUE_MAX_BATCH 64
+
+typedef void (*fixed_queue_batch_cb)(fixed_queue_t* queue, void** elements,
+                                     size_t count, void* context);
 
 // Creates a new fixed queue with the given |capacity|. If more elements than
 // |capacity| are added to the queue, the caller is blocked until space is
@@ -36,6 +41,24 @@ typedef void (*fixed_queue_cb)(fixed_queue_t* queue, void* context);
 // the returned queue with |fixed_queue_free|.
 fixed_queue_t* fixed_queue_new(size_t capacity);
 
+// Creates a new lock-free fixed queue for a single producer thread and a
+// single consumer thread. |capacity| is rounded up to the next power of two
+// and must be greater than zero. Enqueue and dequeue never take a lock, and
+// the dequeue file descriptor is only signaled when an element is enqueued
+// into an empty queue; a callback registered with |fixed_queue_register_dequeue| is
+// therefore invoked repeatedly on each wakeup for as long as it keeps
+// dequeuing elements. Returns NULL on failure. The caller must free the
+// returned queue with |fixed_queue_free|.
+//
+// Lock-free queues do not support |fixed_queue_try_peek_last|,
+// |fixed_queue_try_remove_from_queue|, |fixed_queue_get_list| or
+// |fixed_queue_get_enqueue_fd|.
+fixed_queue_t* fixed_queue_new_spsc(size_t capacity);
+
+// Same as |fixed_queue_new_spsc| but the queue may be enqueued from any
+// number of producer threads. There must still be a single consumer.
+fixed_queue_t* fixed_queue_new_mpsc(size_t capacity);
+
 // Frees a queue and (optionally) the enqueued elements.
 // |queue| is the queue to free. If the |free_cb| callback is not null,
 // it is called on each queue element to free it.
@@ -128,6 +151,19 @@ int fixed_queue_get_dequeue_fd(const fixed_queue_t* queue);
 void fixed_queue_register_dequeue(fixed_queue_t* queue, reactor_t* reactor,
                                   fixed_queue_cb ready_cb, void* context);
 
+// Registers |queue| with |reactor| for batched dequeue operations. Each time
+// the reactor wakes up for |queue|, up to |max_batch| elements are dequeued
+// and passed to |ready_cb| in a single call, in queue order. Ownership of the
+// elements passes to the callback; the |elements| array itself is only valid
+// for the duration of the call. The |context| parameter is passed, untouched,
+// to the callback routine. Neither |queue|, nor |reactor|, nor |ready_cb| may
+// be NULL and |max_batch| must be between 1 and |FIXED_QUEUE_MAX_BATCH|.
+// |context| may be NULL.
+void fixed_queue_register_dequeue_batch(fixed_queue_t* queue,
+                                        reactor_t* reactor, size_t max_batch,
+                                        fixed_queue_batch_cb ready_cb,
+                                        void* context);
+
 // Unregisters the dequeue ready callback for |queue| from whichever reactor
 // it is registered with, if any. This function is idempotent.
 void fixed_queue_unregister_dequeue(fixed_queue_t* queue);
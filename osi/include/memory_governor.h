@@ -0,0 +1,80 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Memory governor: the bytes each subsystem holds in its queues, against a
+// global budget shared by all of them. When the total gets close to the
+// budget the subsystems are told to shrink their queue watermarks, so that
+// data is flow controlled or dropped before the process runs out of memory.
+// The governor never fails an allocation by itself.
+//
+// The budget is read from MEMORY_GOVERNOR_BUDGET_PROPERTY, in KiB, when the
+// first subsystem registers. A budget of 0, the default, means no budget and
+// no pressure.
+
+#define MEMORY_GOVERNOR_BUDGET_PROPERTY "persist.bluetooth.memory_budget_kb"
+
+typedef enum {
+  MEMORY_PRESSURE_NONE = 0,
+  MEMORY_PRESSURE_MODERATE,  // From 75% of the budget, back under 60%
+  MEMORY_PRESSURE_CRITICAL,  // From the budget, back under 90% of it
+} memory_pressure_t;
+
+typedef struct memory_client_t memory_client_t;
+
+// Called on each change of the global pressure, on the thread whose charge
+// or release changed it. It must be quick, typically only storing the
+// watermark to use, and may not call back into the governor.
+typedef void (*memory_pressure_cb)(memory_pressure_t pressure, void* context);
+
+// Registers the subsystem |name|, a string that must outlive the process,
+// with |callback| called with |context| on pressure changes. |callback| may be
+// NULL. Registering an existing name again replaces its callback and keeps
+// its counts. Returns NULL if there is no room for another subsystem; the
+// charge and release functions accept NULL and do nothing with it.
+memory_client_t* memory_governor_register(const char* name,
+                                          memory_pressure_cb callback,
+                                          void* context);
+
+// Counts |bytes| more held by |client|.
+void memory_governor_charge(memory_client_t* client, size_t bytes);
+
+// Counts |bytes| less held by |client|, which charged them before.
+void memory_governor_release(memory_client_t* client, size_t bytes);
+
+// Returns the bytes held by |client|, 0 for NULL.
+size_t memory_governor_held(const memory_client_t* client);
+
+// Returns the current global pressure.
+memory_pressure_t memory_governor_pressure(void);
+
+// Sets the global budget to |bytes|, 0 for none, instead of the property.
+// The pressure is updated right away.
+void memory_governor_set_budget(size_t bytes);
+
+// Returns |watermark| scaled for |pressure|: halved under moderate pressure
+// and quartered under critical pressure, but never under |minimum|.
+size_t memory_governor_scale(size_t watermark, size_t minimum,
+                             memory_pressure_t pressure);
+
+// Dumps the budget and the bytes held per subsystem to |fd|.
+void memory_governor_debug_dump(int fd);
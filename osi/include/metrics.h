@@ -198,6 +198,8 @@ class BluetoothMetricsLogger {
   /*
    * Log A2DP Audio Session Information
    *
+   * - The metrics are only accumulated here, the protobuf session is filled
+   *   when the Bluetooth session is queued or dumped
    * - Repeated calls to this method will override previous metrics if in the
    *   same Bluetooth connection
    * - If a Bluetooth session does not exist, create one with default parameter
@@ -247,6 +249,12 @@ class BluetoothMetricsLogger {
    */
   void Build();
 
+  /*
+   * Fill the A2DP session of the current Bluetooth session with the metrics
+   * accumulated by LogA2dpSession()
+   */
+  void FillA2dpSession();
+
   /*
    * Reset objects related to current Bluetooth session
    */
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #define UNUSED_ATTR __attribute__((unused))
@@ -61,6 +62,10 @@
 // Effort is made for this to come from a real random source.
 int osi_rand(void);
 
+// Fills |buf| with |len| bytes from the system random source, /dev/urandom,
+// which is suitable for keys and addresses. Returns false if it could not.
+bool osi_rand_bytes(void* buf, size_t len);
+
 // Re-run |fn| system call until the system call doesn't cause EINTR.
 #define OSI_NO_INTR(fn) \
   do {                  \
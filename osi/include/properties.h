@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #if defined(OS_GENERIC)
 #define PROPERTY_VALUE_MAX 92
@@ -43,3 +44,31 @@ int osi_property_set(const char* key, const char* value);
 // returns the value of |key| truncated and coerced into an
 // int32_t. If the property is not set, then the |default_value| is used.
 int32_t osi_property_get_int32(const char* key, int32_t default_value);
+
+// A property read once, then again only once the properties changed, for
+// paths too hot to ask the property service on every call. Define one per
+// key at file scope with OSI_CACHED_PROPERTY().
+typedef struct {
+  const char* key;
+  int32_t default_value;
+  std::atomic<bool> read;
+  std::atomic<uint32_t> serial;  // Properties serial when |value| was read
+  std::atomic<int32_t> value;
+} osi_cached_property_t;
+
+#define OSI_CACHED_PROPERTY(name, key, default_value) \
+  static osi_cached_property_t name = {                \
+      (key), (default_value), {false}, {0}, {0}}
+
+// Returns true if the cached |property| starts with "true". Its default value
+// is used as a bool if the property is not set.
+bool osi_cached_property_get_bool(osi_cached_property_t* property);
+
+// Returns the cached |property| coerced into an int32_t, like
+// osi_property_get_int32().
+int32_t osi_cached_property_get_int32(osi_cached_property_t* property);
+
+// Makes every cached property read again on its next use. The cached
+// properties follow the property service by themselves where it has a change
+// serial, this is for the properties set by other means elsewhere.
+void osi_property_cache_refresh(void);
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 
 struct semaphore_t;
 typedef struct semaphore_t semaphore_t;
@@ -41,9 +42,18 @@ void semaphore_wait(semaphore_t* semaphore);
 // |semaphore| may not be NULL.
 bool semaphore_try_wait(semaphore_t* semaphore);
 
+// Tries to decrement the value of |semaphore| up to |count| times. Returns the
+// number of times the value was decremented, which is less than |count| if the
+// value reached 0. This function never blocks. |semaphore| may not be NULL.
+size_t semaphore_try_wait_many(semaphore_t* semaphore, size_t count);
+
 // Increments the value of |semaphore|. |semaphore| may not be NULL.
 void semaphore_post(semaphore_t* semaphore);
 
+// Increments the value of |semaphore| by |count| in a single operation.
+// |semaphore| may not be NULL.
+void semaphore_post_many(semaphore_t* semaphore, size_t count);
+
 // Returns a file descriptor representing this semaphore. The caller may
 // only perform one operation on the file descriptor: select(2). If |select|
 // indicates the fd is readable, the caller may call |semaphore_wait|
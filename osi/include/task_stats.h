@@ -0,0 +1,57 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <base/callback.h>
+#include <base/location.h>
+
+// Task latency instrumentation: the time each task waits in the queue of its
+// thread and the time it runs, aggregated per thread and per posting site.
+// It is off by default and costs a flag check per task while off.
+
+// Name of the thread running the BTU (and BTA) message loop, outside of the
+// stack for the tasks posted by osi
+#define BTU_MESSAGE_LOOP_NAME "btu message loop"
+
+// Turns the instrumentation on or off. Tasks posted while it is off are not
+// recorded.
+void task_stats_set_enabled(bool enabled);
+
+// Returns true if the instrumentation is on.
+bool task_stats_enabled(void);
+
+// Returns |task| wrapped to record its queueing delay and run time on the
+// thread named |thread_name|, a string that must outlive the task. Returns
+// |task| itself when the instrumentation is off.
+base::Closure task_stats_wrap(const char* thread_name,
+                              const base::Location& from_here,
+                              const base::Closure& task);
+
+// Records a task of |thread_name| posted at |posted_us| and run from
+// |start_us| to |end_us|, all in OS boot time. The posting site is |site|,
+// described by |from_here| when known.
+void task_stats_record(const char* thread_name, const void* site,
+                       const base::Location* from_here, uint64_t posted_us,
+                       uint64_t start_us, uint64_t end_us);
+
+// Dumps the histograms and the slowest posting sites of each thread to |fd|.
+void task_stats_dump(int fd);
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #define THREAD_NAME_MAX 16
@@ -28,6 +29,21 @@ typedef struct thread_t thread_t;
 
 typedef void (*thread_fn)(void* context);
 
+// Scheduling policy of the threads of a given name.
+typedef struct {
+  int sched_class;    // SCHED_OTHER, SCHED_FIFO or SCHED_RR, -1 for the default
+  int priority;       // Nice value for SCHED_OTHER, else real-time priority
+  uint64_t cpu_mask;  // CPUs the thread may run on, 0 for all of them
+} thread_policy_t;
+
+// Sets the scheduling |policy| of the threads named |name|, matched on their
+// first THREAD_NAME_MAX bytes. A thread gets it when it is started by
+// |thread_new|, so it must be set before that. A thread with a policy
+// scheduling class ignores |thread_set_priority| and |thread_set_rt_priority|.
+// |policy| NULL removes the policy of |name|. |name| may not be NULL.
+// Returns false if there is no room left for another policy.
+bool thread_set_policy(const char* name, const thread_policy_t* policy);
+
 // Creates and starts a new thread with the given name. Only THREAD_NAME_MAX
 // bytes from |name| will be assigned to the newly-created thread. Returns a
 // thread object if the thread was successfully started, NULL otherwise. The
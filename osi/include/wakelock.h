@@ -21,6 +21,8 @@
 #include <hardware/bluetooth.h>
 #include <stdbool.h>
 
+#include "osi/include/time.h"
+
 // Set the Bluetooth OS callouts to |callouts|.
 // This function should be called when native kernel wakelocks are not used
 // directly. If this function is not called, or |callouts| is NULL, then native
@@ -37,6 +39,24 @@ bool wakelock_acquire(void);
 // Return true on success, otherwise false.
 bool wakelock_release(void);
 
+// Acquire the Bluetooth wakelock on behalf of |reason|, a string literal
+// naming the user in the debug dump. The wakelock is reference counted: it is
+// held until every acquisition has been released. If it is still held in its
+// release hold-off, no new lock is taken from the OS.
+// The function is thread safe.
+// Return true on success, otherwise false.
+bool wakelock_acquire_for(const char* reason);
+
+// Release an acquisition of the Bluetooth wakelock made for |reason|.
+// The function is thread safe.
+// Return true on success, otherwise false.
+bool wakelock_release_for(const char* reason);
+
+// Keep the wakelock held for |holdoff_ms| after its last acquisition is
+// released, so that users waking up again soon after do not cost a release
+// and an acquire of the OS lock each. 0, the default, releases it at once.
+void wakelock_set_release_holdoff(period_ms_t holdoff_ms);
+
 // Cleanup the wakelock internal state.
 // This function should be called by the OSI module cleanup during
 // graceful shutdown.
@@ -36,14 +36,16 @@
 
 #include <hardware/bluetooth.h>
 
+#include <algorithm>
 #include <mutex>
+#include <vector>
 
 #include "osi/include/allocator.h"
 #include "osi/include/fixed_queue.h"
-#include "osi/include/list.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/semaphore.h"
+#include "osi/include/task_stats.h"
 #include "osi/include/thread.h"
 #include "osi/include/wakelock.h"
 
@@ -69,6 +71,7 @@ typedef struct {
   size_t scheduled_count;
   size_t canceled_count;
   size_t rescheduled_count;
+  size_t coalesced_count;
   size_t total_updates;
   period_ms_t last_update_ms;
   stat_t callback_execution;
@@ -96,10 +99,14 @@ struct alarm_t {
   std::shared_ptr<std::recursive_mutex> callback_mutex;
   period_ms_t creation_time;
   period_ms_t period;
+  period_ms_t slack;  // How late the alarm may fire after its deadline
   period_ms_t deadline;
   period_ms_t prev_deadline;  // Previous deadline - used for accounting of
                               // periodic timers
   bool is_periodic;
+  uint64_t sequence;  // Orders alarms with the same deadline
+  size_t heap_index;    // Position in |alarms|, or ALARM_NOT_PENDING
+  size_t expiry_index;  // Position in |expiries|, or ALARM_NOT_PENDING
   fixed_queue_t* queue;  // The processing queue to add this alarm to
   alarm_callback_t callback;
   void* data;
@@ -122,14 +129,52 @@ static const clockid_t CLOCK_ID_ALARM = CLOCK_BOOTTIME;
 static const clockid_t CLOCK_ID_ALARM = CLOCK_BOOTTIME_ALARM;
 #endif
 
+static const size_t ALARM_NOT_PENDING = SIZE_MAX;
+
+// A binary min-heap of pending alarms. Each alarm keeps its position in the
+// heap in its |index| member.
+typedef struct {
+  std::vector<alarm_t*> items;
+  size_t alarm_t::*index;
+  bool (*is_before)(const alarm_t* a, const alarm_t* b);
+} alarm_heap_t;
+
 // This mutex ensures that the |alarm_set|, |alarm_cancel|, and alarm callback
 // functions execute serially and not concurrently. As a result, this mutex
-// also protects the |alarms| list.
+// also protects the |alarms| heap.
 static std::mutex alarms_mutex;
-static list_t* alarms;
+// Pending alarms, ordered by deadline
+static alarm_heap_t* alarms;
+// The same alarms, ordered by the latest time they may fire at
+static alarm_heap_t* expiries;
+static uint64_t alarm_sequence;
 static timer_t timer;
 static timer_t wakeup_timer;
 static bool timer_set;
+// Time the timers are armed for, 0 if they are not armed
+static period_ms_t armed_expiry;
+// Number of timer expirations that dispatched alarms, and of alarms
+// dispatched by them
+static size_t expiration_count;
+static size_t dispatched_count;
+
+// Returns true if |a| is due before |b|. Alarms with the same deadline are
+// due in the order they were scheduled.
+static bool alarm_is_before(const alarm_t* a, const alarm_t* b) {
+  if (a->deadline != b->deadline) return a->deadline < b->deadline;
+  return a->sequence < b->sequence;
+}
+
+// Latest time |alarm| may fire at
+static period_ms_t alarm_expiry(const alarm_t* alarm) {
+  return alarm->deadline + alarm->slack;
+}
+
+static bool alarm_expires_before(const alarm_t* a, const alarm_t* b) {
+  if (alarm_expiry(a) != alarm_expiry(b))
+    return alarm_expiry(a) < alarm_expiry(b);
+  return a->sequence < b->sequence;
+}
 
 // All alarm callbacks are dispatched from |dispatcher_thread|
 static thread_t* dispatcher_thread;
@@ -144,11 +189,13 @@ static alarm_t* alarm_new_internal(const char* name, bool is_periodic);
 static bool lazy_initialize(void);
 static period_ms_t now(void);
 static void alarm_set_internal(alarm_t* alarm, period_ms_t period,
-                               alarm_callback_t cb, void* data,
-                               fixed_queue_t* queue, bool for_msg_loop);
+                               period_ms_t slack, alarm_callback_t cb,
+                               void* data, fixed_queue_t* queue,
+                               bool for_msg_loop);
 static void* alarm_cancel_internal(alarm_t* alarm);
 static void remove_pending_alarm(alarm_t* alarm);
 static void schedule_next_instance(alarm_t* alarm);
+static void update_root_alarm(void);
 static void reschedule_root_alarm(void);
 static void alarm_queue_ready(fixed_queue_t* queue, void* context);
 static void timer_callback(void* data);
@@ -185,6 +232,8 @@ static alarm_t* alarm_new_internal(const char* name, bool is_periodic) {
   std::shared_ptr<std::recursive_mutex> ptr(new std::recursive_mutex());
   ret->callback_mutex = ptr;
   ret->is_periodic = is_periodic;
+  ret->heap_index = ALARM_NOT_PENDING;
+  ret->expiry_index = ALARM_NOT_PENDING;
   ret->stats.name = osi_strdup(name);
 
   ret->for_msg_loop = false;
@@ -223,19 +272,27 @@ period_ms_t alarm_get_remaining_ms(const alarm_t* alarm) {
 
 void alarm_set(alarm_t* alarm, period_ms_t interval_ms, alarm_callback_t cb,
                void* data) {
-  alarm_set_internal(alarm, interval_ms, cb, data, default_callback_queue,
+  alarm_set_internal(alarm, interval_ms, 0, cb, data, default_callback_queue,
                      false);
 }
 
+void alarm_set_with_slack(alarm_t* alarm, period_ms_t interval_ms,
+                          period_ms_t slack_ms, alarm_callback_t cb,
+                          void* data) {
+  alarm_set_internal(alarm, interval_ms, slack_ms, cb, data,
+                     default_callback_queue, false);
+}
+
 void alarm_set_on_mloop(alarm_t* alarm, period_ms_t interval_ms,
                         alarm_callback_t cb, void* data) {
-  alarm_set_internal(alarm, interval_ms, cb, data, NULL, true);
+  alarm_set_internal(alarm, interval_ms, 0, cb, data, NULL, true);
 }
 
 // Runs in exclusion with alarm_cancel and timer_callback.
 static void alarm_set_internal(alarm_t* alarm, period_ms_t period,
-                               alarm_callback_t cb, void* data,
-                               fixed_queue_t* queue, bool for_msg_loop) {
+                               period_ms_t slack, alarm_callback_t cb,
+                               void* data, fixed_queue_t* queue,
+                               bool for_msg_loop) {
   CHECK(alarms != NULL);
   CHECK(alarm != NULL);
   CHECK(cb != NULL);
@@ -244,6 +301,7 @@ static void alarm_set_internal(alarm_t* alarm, period_ms_t period,
 
   alarm->creation_time = now();
   alarm->period = period;
+  alarm->slack = slack;
   alarm->queue = queue;
   alarm->callback = cb;
   alarm->data = data;
@@ -274,8 +332,7 @@ void* alarm_cancel(alarm_t* alarm) {
 // Internal implementation of canceling an alarm.
 // The caller must hold the |alarms_mutex|
 static void* alarm_cancel_internal(alarm_t* alarm) {
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
+  bool was_pending = (alarm->heap_index != ALARM_NOT_PENDING);
 
   remove_pending_alarm(alarm);
 
@@ -288,7 +345,7 @@ static void* alarm_cancel_internal(alarm_t* alarm) {
   alarm->stats.canceled_count++;
   alarm->queue = NULL;
 
-  if (needs_reschedule) reschedule_root_alarm();
+  if (was_pending) update_root_alarm();
   return data;
 }
 
@@ -318,8 +375,11 @@ void alarm_cleanup(void) {
   semaphore_free(alarm_expired);
   alarm_expired = NULL;
 
-  list_free(alarms);
+  delete alarms;
   alarms = NULL;
+  delete expiries;
+  expiries = NULL;
+  armed_expiry = 0;
 }
 
 static bool lazy_initialize(void) {
@@ -332,11 +392,8 @@ static bool lazy_initialize(void) {
 
   std::lock_guard<std::mutex> lock(alarms_mutex);
 
-  alarms = list_new(NULL);
-  if (!alarms) {
-    LOG_ERROR(LOG_TAG, "%s unable to allocate alarm list.", __func__);
-    goto error;
-  }
+  alarms = new alarm_heap_t{{}, &alarm_t::heap_index, alarm_is_before};
+  expiries = new alarm_heap_t{{}, &alarm_t::expiry_index, alarm_expires_before};
 
   if (!timer_create_internal(CLOCK_ID, &timer)) goto error;
   timer_initialized = true;
@@ -395,8 +452,10 @@ error:
 
   if (timer_initialized) timer_delete(timer);
 
-  list_free(alarms);
+  delete alarms;
   alarms = NULL;
+  delete expiries;
+  expiries = NULL;
 
   return false;
 }
@@ -414,10 +473,61 @@ static period_ms_t now(void) {
   return (ts.tv_sec * 1000LL) + (ts.tv_nsec / 1000000LL);
 }
 
-// Remove alarm from internal alarm list and the processing queue
+static void heap_place(alarm_heap_t* heap, size_t index, alarm_t* alarm) {
+  heap->items[index] = alarm;
+  alarm->*(heap->index) = index;
+}
+
+// Moves the alarm at |index| up or down to its place in |heap|.
+static void heap_fix(alarm_heap_t* heap, size_t index) {
+  std::vector<alarm_t*>& items = heap->items;
+  alarm_t* alarm = items[index];
+
+  while (index > 0) {
+    size_t parent = (index - 1) / 2;
+    if (!heap->is_before(alarm, items[parent])) break;
+    heap_place(heap, index, items[parent]);
+    index = parent;
+  }
+
+  while (true) {
+    size_t child = 2 * index + 1;
+    if (child >= items.size()) break;
+    if (child + 1 < items.size() &&
+        heap->is_before(items[child + 1], items[child]))
+      child++;
+    if (!heap->is_before(items[child], alarm)) break;
+    heap_place(heap, index, items[child]);
+    index = child;
+  }
+
+  heap_place(heap, index, alarm);
+}
+
+static void heap_insert(alarm_heap_t* heap, alarm_t* alarm) {
+  heap->items.push_back(alarm);
+  heap_fix(heap, heap->items.size() - 1);
+}
+
+static void heap_remove(alarm_heap_t* heap, alarm_t* alarm) {
+  std::vector<alarm_t*>& items = heap->items;
+  size_t index = alarm->*(heap->index);
+  if (index >= items.size() || items[index] != alarm) return;
+
+  alarm->*(heap->index) = ALARM_NOT_PENDING;
+  alarm_t* last = items.back();
+  items.pop_back();
+  if (last == alarm) return;
+
+  items[index] = last;
+  heap_fix(heap, index);
+}
+
+// Remove alarm from internal alarm heap and the processing queue
 // The caller must hold the |alarms_mutex|
 static void remove_pending_alarm(alarm_t* alarm) {
-  list_remove(alarms, alarm);
+  heap_remove(alarms, alarm);
+  heap_remove(expiries, alarm);
 
   if (alarm->for_msg_loop) {
     alarm->closure.i.Cancel();
@@ -432,10 +542,6 @@ static void remove_pending_alarm(alarm_t* alarm) {
 
 // Must be called with |alarms_mutex| held
 static void schedule_next_instance(alarm_t* alarm) {
-  // If the alarm is currently set and it's at the start of the list,
-  // we'll need to re-schedule since we've adjusted the earliest deadline.
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
   if (alarm->callback) remove_pending_alarm(alarm);
 
   // Calculate the next deadline for this alarm
@@ -444,29 +550,32 @@ static void schedule_next_instance(alarm_t* alarm) {
   if ((alarm->is_periodic) && (alarm->period != 0))
     ms_into_period = ((just_now - alarm->creation_time) % alarm->period);
   alarm->deadline = just_now + (alarm->period - ms_into_period);
+  alarm->sequence = alarm_sequence++;
 
-  // Add it into the timer list sorted by deadline (earliest deadline first).
-  if (list_is_empty(alarms) ||
-      ((alarm_t*)list_front(alarms))->deadline > alarm->deadline) {
-    list_prepend(alarms, alarm);
-  } else {
-    for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-         node = list_next(node)) {
-      list_node_t* next = list_next(node);
-      if (next == list_end(alarms) ||
-          ((alarm_t*)list_node(next))->deadline > alarm->deadline) {
-        list_insert_after(alarms, node, alarm);
-        break;
-      }
-    }
-  }
+  heap_insert(alarms, alarm);
+  heap_insert(expiries, alarm);
 
-  // If the new alarm has the earliest deadline, we need to re-evaluate our
-  // schedule.
-  if (needs_reschedule ||
-      (!list_is_empty(alarms) && list_front(alarms) == alarm)) {
-    reschedule_root_alarm();
+  // The earliest expiration may have changed, re-evaluate our schedule.
+  update_root_alarm();
+}
+
+// Re-arms the timers after an alarm was set or cancelled, if the earliest
+// expiration has changed.
+// If the timers are armed too early while a wake lock is held, they are left
+// alone: |callback_dispatch| finds nothing due and re-arms them then. This
+// saves re-arming on every cancel or restart of the earliest alarm. A wakeup
+// timer is always re-armed, so that the device does not leave suspend early.
+// NOTE: must be called with |alarms_mutex| held
+static void update_root_alarm(void) {
+  if (expiries->items.empty()) {
+    if (armed_expiry == 0) return;
+  } else if (armed_expiry != 0) {
+    period_ms_t next_expiry = alarm_expiry(expiries->items.front());
+    if (next_expiry == armed_expiry) return;
+    if (next_expiry > armed_expiry && timer_set) return;
   }
+
+  reschedule_root_alarm();
 }
 
 // NOTE: must be called with |alarms_mutex| held
@@ -475,27 +584,31 @@ static void reschedule_root_alarm(void) {
   CHECK(alarms != NULL);
 
   const bool timer_was_set = timer_set;
-  alarm_t* next;
+  period_ms_t next_expiry;
   int64_t next_expiration;
 
   // If used in a zeroed state, disarms the timer.
   struct itimerspec timer_time;
   memset(&timer_time, 0, sizeof(timer_time));
 
-  if (list_is_empty(alarms)) goto done;
+  armed_expiry = 0;
+  if (expiries->items.empty()) goto done;
 
-  next = static_cast<alarm_t*>(list_front(alarms));
-  next_expiration = next->deadline - now();
+  // Alarms are dispatched at the latest time one of them may fire at, along
+  // with every other alarm that is due by then
+  next_expiry = alarm_expiry(expiries->items.front());
+  next_expiration = next_expiry - now();
   if (next_expiration < TIMER_INTERVAL_FOR_WAKELOCK_IN_MS) {
     if (!timer_set) {
-      if (!wakelock_acquire()) {
+      if (!wakelock_acquire_for("alarm")) {
         LOG_ERROR(LOG_TAG, "%s unable to acquire wake lock", __func__);
         goto done;
       }
     }
 
-    timer_time.it_value.tv_sec = (next->deadline / 1000);
-    timer_time.it_value.tv_nsec = (next->deadline % 1000) * 1000000LL;
+    timer_time.it_value.tv_sec = (next_expiry / 1000);
+    timer_time.it_value.tv_nsec = (next_expiry % 1000) * 1000000LL;
+    armed_expiry = next_expiry;
 
     // It is entirely unsafe to call timer_settime(2) with a zeroed timerspec
     // for timers with *_ALARM clock IDs. Although the man page states that the
@@ -520,18 +633,20 @@ static void reschedule_root_alarm(void) {
     struct itimerspec wakeup_time;
     memset(&wakeup_time, 0, sizeof(wakeup_time));
 
-    wakeup_time.it_value.tv_sec = (next->deadline / 1000);
-    wakeup_time.it_value.tv_nsec = (next->deadline % 1000) * 1000000LL;
+    wakeup_time.it_value.tv_sec = (next_expiry / 1000);
+    wakeup_time.it_value.tv_nsec = (next_expiry % 1000) * 1000000LL;
     if (timer_settime(wakeup_timer, TIMER_ABSTIME, &wakeup_time, NULL) == -1)
       LOG_ERROR(LOG_TAG, "%s unable to set wakeup timer: %s", __func__,
                 strerror(errno));
+    else
+      armed_expiry = next_expiry;
   }
 
 done:
   timer_set =
       timer_time.it_value.tv_sec != 0 || timer_time.it_value.tv_nsec != 0;
   if (timer_was_set && !timer_set) {
-    wakelock_release();
+    wakelock_release_for("alarm");
   }
 
   if (timer_settime(timer, TIMER_ABSTIME, &timer_time, NULL) == -1)
@@ -631,39 +746,62 @@ static void callback_dispatch(UNUSED_ATTR void* context) {
     if (!dispatcher_thread_active) break;
 
     std::lock_guard<std::mutex> lock(alarms_mutex);
-    alarm_t* alarm;
+    period_ms_t just_now = now();
 
     // Take into account that the alarm may get cancelled before we get to it.
     // We're done here if there are no alarms or the alarm at the front is in
     // the future. Exit right away since there's nothing left to do.
-    if (list_is_empty(alarms) ||
-        (alarm = static_cast<alarm_t*>(list_front(alarms)))->deadline > now()) {
+    if (alarms->items.empty() || alarms->items.front()->deadline > just_now) {
       reschedule_root_alarm();
       continue;
     }
 
-    list_remove(alarms, alarm);
-
-    if (alarm->is_periodic) {
-      alarm->prev_deadline = alarm->deadline;
-      schedule_next_instance(alarm);
-      alarm->stats.rescheduled_count++;
-    }
-    reschedule_root_alarm();
+    // Dispatch every alarm that is due, so that alarms whose slack overlaps
+    // share this expiration. Periodic alarms rescheduled here wait for the
+    // next one.
+    uint64_t last_sequence = alarm_sequence;
+    alarm_t* first = NULL;
+    size_t batch_size = 0;
+    while (!alarms->items.empty()) {
+      alarm_t* alarm = alarms->items.front();
+      if (alarm->deadline > just_now || alarm->sequence >= last_sequence) break;
+
+      heap_remove(alarms, alarm);
+      heap_remove(expiries, alarm);
+
+      if (++batch_size == 1) {
+        first = alarm;
+      } else {
+        if (batch_size == 2) first->stats.coalesced_count++;
+        alarm->stats.coalesced_count++;
+      }
 
-    // Enqueue the alarm for processing
-    if (alarm->for_msg_loop) {
-      if (!get_message_loop()) {
-        LOG_ERROR(LOG_TAG, "%s: message loop already NULL. Alarm: %s", __func__,
-                  alarm->stats.name);
-        continue;
+      if (alarm->is_periodic) {
+        alarm->prev_deadline = alarm->deadline;
+        schedule_next_instance(alarm);
+        alarm->stats.rescheduled_count++;
       }
 
-      alarm->closure.i.Reset(Bind(alarm_ready_mloop, alarm));
-      get_message_loop()->task_runner()->PostTask(FROM_HERE, alarm->closure.i.callback());
-    } else {
-      fixed_queue_enqueue(alarm->queue, alarm);
+      // Enqueue the alarm for processing
+      if (alarm->for_msg_loop) {
+        if (!get_message_loop()) {
+          LOG_ERROR(LOG_TAG, "%s: message loop already NULL. Alarm: %s",
+                    __func__, alarm->stats.name);
+          continue;
+        }
+
+        alarm->closure.i.Reset(Bind(alarm_ready_mloop, alarm));
+        get_message_loop()->task_runner()->PostTask(
+            FROM_HERE, task_stats_wrap(BTU_MESSAGE_LOOP_NAME, FROM_HERE,
+                                       alarm->closure.i.callback()));
+      } else {
+        fixed_queue_enqueue(alarm->queue, alarm);
+      }
     }
+
+    expiration_count++;
+    dispatched_count += batch_size;
+    reschedule_root_alarm();
   }
 
   LOG_DEBUG(LOG_TAG, "%s Callback thread exited", __func__);
@@ -746,12 +884,14 @@ void alarm_debug_dump(int fd) {
 
   period_ms_t just_now = now();
 
-  dprintf(fd, "  Total Alarms: %zu\n\n", list_length(alarms));
+  dprintf(fd, "  Total Alarms: %zu\n", alarms->items.size());
+  dprintf(fd, "  Timer expirations: %zu (alarms dispatched: %zu)\n\n",
+          expiration_count, dispatched_count);
 
-  // Dump info for each alarm
-  for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-       node = list_next(node)) {
-    alarm_t* alarm = (alarm_t*)list_node(node);
+  // Dump info for each alarm, earliest deadline first
+  std::vector<alarm_t*> sorted(alarms->items);
+  std::sort(sorted.begin(), sorted.end(), alarm_is_before);
+  for (alarm_t* alarm : sorted) {
     alarm_stats_t* stats = &alarm->stats;
 
     dprintf(fd, "  Alarm : %s (%s)\n", stats->name,
@@ -766,6 +906,9 @@ void alarm_debug_dump(int fd) {
             "    Deviation counts (overdue/premature)",
             stats->overdue_scheduling.count, stats->premature_scheduling.count);
 
+    dprintf(fd, "%-51s: %zu / %llu\n", "    Coalesced dispatches / slack in ms",
+            stats->coalesced_count, (unsigned long long)alarm->slack);
+
     dprintf(fd, "%-51s: %llu / %llu / %lld\n",
             "    Time in ms (since creation/interval/remaining)",
             (unsigned long long)(just_now - alarm->creation_time),
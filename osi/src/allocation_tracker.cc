@@ -21,11 +21,15 @@
 #include "osi/include/allocation_tracker.h"
 
 #include <base/logging.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <atomic>
 #include <mutex>
 #include <pthread.h>
 #include <unordered_map>
+#include <vector>
 #include <sys/time.h>
 #include <sys/types.h>
 
@@ -33,6 +37,7 @@
 #include "osi/include/compat.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 
 typedef struct {
   uint8_t allocator_id;
@@ -46,7 +51,7 @@ static char g_beginning_canary[canary_size];
 static char g_end_canary[canary_size];
 static std::unordered_map<void*, allocation_t*> allocations;
 static std::mutex tracker_lock;
-static bool enabled = false;
+static std::atomic<bool> enabled(false);
 
 // Memory allocation statistics
 static size_t alloc_counter = 0;
@@ -82,6 +87,169 @@ typedef struct {
 
 allocation_debug_t allocation_debug;
 
+// Sampling mode. Size class i holds the sizes from 2^i up to 2^(i+1), the
+// last one holds all the larger sizes. Call sites are hashed into a fixed
+// table whose slots are claimed once and never released until the counts
+// start over; the samples of sites that find no slot are counted together.
+#define ALLOCATION_SAMPLE_SIZE_CLASSES 16
+#define ALLOCATION_SAMPLE_SITES 512 /* Must be a power of 2 */
+#define ALLOCATION_SAMPLE_MAX_PROBES 16
+#define ALLOCATION_SAMPLE_DUMP_SITES 20
+
+typedef struct {
+  std::atomic<size_t> count;
+  std::atomic<size_t> bytes;
+} allocation_sample_stat_t;
+
+typedef struct {
+  std::atomic<uintptr_t> caller;  // 0 while the slot is free
+  allocation_sample_stat_t stat;
+} allocation_sample_site_t;
+
+static std::atomic<size_t> sample_interval(0);
+static std::atomic<uint64_t> sample_start_us(0);
+static allocation_sample_stat_t sample_size_classes
+    [ALLOCATION_SAMPLE_SIZE_CLASSES];
+static allocation_sample_site_t sample_sites[ALLOCATION_SAMPLE_SITES];
+static allocation_sample_stat_t sample_other_sites;
+
+// Allocations this thread still skips before its next sample
+static thread_local size_t sample_countdown = 0;
+
+static void sample_stat_reset(allocation_sample_stat_t* stat) {
+  stat->count.store(0, std::memory_order_relaxed);
+  stat->bytes.store(0, std::memory_order_relaxed);
+}
+
+static void sample_stat_add(allocation_sample_stat_t* stat, size_t size) {
+  stat->count.fetch_add(1, std::memory_order_relaxed);
+  stat->bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+static allocation_sample_stat_t* sample_site_stat(uintptr_t caller) {
+  size_t hash = (size_t)(((uint64_t)caller * 0x9E3779B97F4A7C15ULL) >> 32);
+
+  for (size_t probe = 0; probe < ALLOCATION_SAMPLE_MAX_PROBES; probe++) {
+    allocation_sample_site_t* site =
+        &sample_sites[(hash + probe) & (ALLOCATION_SAMPLE_SITES - 1)];
+    uintptr_t current = site->caller.load(std::memory_order_acquire);
+    if (current == 0 &&
+        site->caller.compare_exchange_strong(current, caller,
+                                             std::memory_order_acq_rel))
+      current = caller;
+    if (current == caller) return &site->stat;
+  }
+
+  return &sample_other_sites;
+}
+
+void allocation_tracker_init_sampling(size_t interval) {
+  // Nothing is sampled while the counts start over
+  sample_interval.store(0);
+
+  for (size_t i = 0; i < ALLOCATION_SAMPLE_SIZE_CLASSES; i++)
+    sample_stat_reset(&sample_size_classes[i]);
+  for (size_t i = 0; i < ALLOCATION_SAMPLE_SITES; i++) {
+    sample_sites[i].caller.store(0, std::memory_order_relaxed);
+    sample_stat_reset(&sample_sites[i].stat);
+  }
+  sample_stat_reset(&sample_other_sites);
+  sample_start_us.store(time_get_os_boottime_us());
+
+  if (interval != 0)
+    LOG_INFO(LOG_TAG, "%s sampling 1 in %zu allocations", __func__, interval);
+  sample_interval.store(interval);
+}
+
+void allocation_tracker_sample_alloc(size_t size, const void* caller) {
+  size_t interval = sample_interval.load(std::memory_order_relaxed);
+  if (interval == 0) return;
+
+  // A countdown left from a larger interval starts over
+  if (sample_countdown > 0 && sample_countdown <= interval) {
+    if (--sample_countdown > 0) return;
+  }
+  sample_countdown = interval;
+
+  size_t size_class = 0;
+  while (size_class < ALLOCATION_SAMPLE_SIZE_CLASSES - 1 &&
+         (size >> (size_class + 1)) != 0)
+    size_class++;
+
+  sample_stat_add(&sample_size_classes[size_class], size);
+  sample_stat_add(sample_site_stat((uintptr_t)caller), size);
+}
+
+// Prints the rates of |stat| over |seconds|, from one sample in |interval|
+static void sample_stat_dump(int fd, const allocation_sample_stat_t* stat,
+                             size_t interval, double seconds) {
+  double count = (double)stat->count.load(std::memory_order_relaxed);
+  double bytes = (double)stat->bytes.load(std::memory_order_relaxed);
+  dprintf(fd, "  %10.0f  %10.0f\n", count * interval / seconds,
+          bytes * interval / seconds);
+}
+
+static void sample_debug_dump(int fd) {
+  size_t interval = sample_interval.load();
+  if (interval == 0) return;
+
+  double seconds =
+      (time_get_os_boottime_us() - sample_start_us.load()) / 1000000.0;
+  if (seconds < 1.0) seconds = 1.0;
+
+  dprintf(fd, "\nBluetooth Sampled Allocations (1 in %zu, over %.0f s):\n",
+          interval, seconds);
+  dprintf(fd, "  %-22s  %10s  %10s\n", "Size (octets)", "Allocs/s",
+          "Octets/s");
+  for (size_t i = 0; i < ALLOCATION_SAMPLE_SIZE_CLASSES; i++) {
+    const allocation_sample_stat_t* stat = &sample_size_classes[i];
+    if (stat->count.load(std::memory_order_relaxed) == 0) continue;
+
+    char label[32];
+    if (i == ALLOCATION_SAMPLE_SIZE_CLASSES - 1)
+      snprintf(label, sizeof(label), "%zu+", (size_t)1 << i);
+    else
+      snprintf(label, sizeof(label), "%zu-%zu", i ? (size_t)1 << i : 0,
+               ((size_t)1 << (i + 1)) - 1);
+    dprintf(fd, "  %-22s", label);
+    sample_stat_dump(fd, stat, interval, seconds);
+  }
+
+  // Sites by octets. The offset from allocation_tracker_init locates a site
+  // in the unstripped library whatever its load address.
+  std::vector<const allocation_sample_site_t*> sites;
+  for (size_t i = 0; i < ALLOCATION_SAMPLE_SITES; i++) {
+    if (sample_sites[i].caller.load(std::memory_order_acquire) != 0)
+      sites.push_back(&sample_sites[i]);
+  }
+  std::sort(sites.begin(), sites.end(),
+            [](const allocation_sample_site_t* a,
+               const allocation_sample_site_t* b) {
+              return a->stat.bytes.load(std::memory_order_relaxed) >
+                     b->stat.bytes.load(std::memory_order_relaxed);
+            });
+  if (sites.size() > ALLOCATION_SAMPLE_DUMP_SITES)
+    sites.resize(ALLOCATION_SAMPLE_DUMP_SITES);
+
+  dprintf(fd, "  %-22s  %10s  %10s\n", "Call site (offset)", "Allocs/s",
+          "Octets/s");
+  uintptr_t anchor = (uintptr_t)&allocation_tracker_init;
+  for (const allocation_sample_site_t* site : sites) {
+    uintptr_t caller = site->caller.load(std::memory_order_relaxed);
+    char label[32];
+    if (caller >= anchor)
+      snprintf(label, sizeof(label), "+%#" PRIxPTR, caller - anchor);
+    else
+      snprintf(label, sizeof(label), "-%#" PRIxPTR, anchor - caller);
+    dprintf(fd, "  %-22s", label);
+    sample_stat_dump(fd, &site->stat, interval, seconds);
+  }
+  if (sample_other_sites.count.load(std::memory_order_relaxed) != 0) {
+    dprintf(fd, "  %-22s", "other sites");
+    sample_stat_dump(fd, &sample_other_sites, interval, seconds);
+  }
+}
+
 void allocation_tracker_init(void) {
   std::unique_lock<std::mutex> lock(tracker_lock);
   if (enabled) return;
@@ -140,6 +308,9 @@ void* allocation_tracker_notify_alloc(uint8_t allocator_id, void* ptr,
                                       size_t requested_size) {
   char* return_ptr;
   {
+    // The lock is only worth taking while the tracker is on
+    if (!enabled.load(std::memory_order_relaxed) || !ptr) return ptr;
+
     std::unique_lock<std::mutex> lock(tracker_lock);
     if (!enabled || !ptr) return ptr;
 
@@ -197,6 +368,8 @@ void* allocation_tracker_notify_alloc(uint8_t allocator_id, void* ptr,
 
 void* allocation_tracker_notify_free(UNUSED_ATTR uint8_t allocator_id,
                                      void* ptr) {
+  if (!enabled.load(std::memory_order_relaxed) || !ptr) return ptr;
+
   std::unique_lock<std::mutex> lock(tracker_lock);
 
   if (!enabled || !ptr) return ptr;
@@ -265,4 +438,8 @@ void osi_allocator_debug_dump(int fd) {
   dprintf(fd, "  Total allocated/free/used octets : %zu / %zu / %zu\n",
           alloc_total_size, free_total_size,
           alloc_total_size - free_total_size);
+  lock.unlock();
+
+  sample_debug_dump(fd);
+  osi_pool_debug_dump(fd);
 }
@@ -18,14 +18,227 @@
 #include <base/logging.h>
 #include <stdlib.h>
 #include <string.h>
+#include <atomic>
+#include <mutex>
 
 #include "osi/include/allocation_tracker.h"
 #include "osi/include/allocator.h"
 
 static const allocator_id_t alloc_allocator_id = 42;
 
+// Size-class pool backing |osi_pool_malloc| and |osi_pool_calloc|.
+//
+// All blocks of all classes are carved out of a single arena so that
+// |osi_free| can tell pool blocks from heap blocks with one range check.
+// Each class keeps a mutex-protected global free list; every thread also
+// keeps a small lock-free cache of recently freed blocks per class so the
+// common alloc/free pairs on the HCI, btu and A2DP threads never contend.
+// Requests that do not fit a class, or that arrive when a class is
+// exhausted, fall back to libc |malloc|.
+//
+// Pool blocks can be shared with |osi_ref|: each class keeps a count of the
+// extra references of its blocks, and |osi_free| only drops one of them while
+// any is left. Holders release a shared block like any other buffer.
+
+typedef struct pool_block_t {
+  struct pool_block_t* next;
+} pool_block_t;
+
+typedef struct {
+  size_t block_size;  // Must be a multiple of |pool_alignment|
+  size_t block_count;
+} pool_class_config_t;
+
+typedef struct {
+  uint8_t* base;
+  std::atomic<uint16_t>* refs;  // Extra references of each block
+  std::mutex lock;
+  pool_block_t* free_list;
+  size_t free_count;
+
+  // Statistics
+  std::atomic<size_t> alloc_count;
+  std::atomic<size_t> free_total;
+  std::atomic<size_t> fallback_count;
+  std::atomic<size_t> in_use;
+  std::atomic<size_t> in_use_max;
+} pool_class_t;
+
+static const size_t pool_alignment = 64;
+
+// The classes cover small HCI command/event buffers, LE ACL and control
+// packets, L2CAP MTU sized buffers and BT_DEFAULT_BUFFER_SIZE buffers
+// (4096 + 16 octets plus room for the allocation tracker canaries).
+static const pool_class_config_t pool_class_configs[] = {
+    {256, 64}, {1024, 32}, {2048, 32}, {4160, 32},
+};
+#define POOL_CLASS_COUNT \
+  (sizeof(pool_class_configs) / sizeof(pool_class_configs[0]))
+
+// Maximum number of free blocks cached per thread and per class.
+#define POOL_THREAD_CACHE_SIZE 8
+
+static pool_class_t pool_classes[POOL_CLASS_COUNT];
+static uint8_t* pool_arena_start;
+static uint8_t* pool_arena_end;
+static std::once_flag pool_init_flag;
+
+static void pool_init(void) {
+  size_t arena_size = 0;
+  for (size_t i = 0; i < POOL_CLASS_COUNT; i++)
+    arena_size +=
+        pool_class_configs[i].block_size * pool_class_configs[i].block_count;
+
+  void* arena = NULL;
+  CHECK(posix_memalign(&arena, pool_alignment, arena_size) == 0);
+  pool_arena_start = static_cast<uint8_t*>(arena);
+  pool_arena_end = pool_arena_start + arena_size;
+
+  uint8_t* base = pool_arena_start;
+  for (size_t i = 0; i < POOL_CLASS_COUNT; i++) {
+    const pool_class_config_t* config = &pool_class_configs[i];
+    pool_class_t* pool = &pool_classes[i];
+    pool->base = base;
+    pool->refs = new std::atomic<uint16_t>[config->block_count]();
+    pool->free_list = NULL;
+    for (size_t n = config->block_count; n > 0; n--) {
+      pool_block_t* block =
+          reinterpret_cast<pool_block_t*>(base + (n - 1) * config->block_size);
+      block->next = pool->free_list;
+      pool->free_list = block;
+    }
+    pool->free_count = config->block_count;
+    base += config->block_size * config->block_count;
+  }
+}
+
+static bool pool_owns(const void* ptr) {
+  const uint8_t* p = static_cast<const uint8_t*>(ptr);
+  return p >= pool_arena_start && p < pool_arena_end;
+}
+
+static size_t pool_class_for_block(const void* ptr) {
+  const uint8_t* p = static_cast<const uint8_t*>(ptr);
+  size_t i = POOL_CLASS_COUNT - 1;
+  while (i > 0 && p < pool_classes[i].base) i--;
+  return i;
+}
+
+static uint8_t* pool_block_start(const void* ptr, size_t cls) {
+  const uint8_t* p = static_cast<const uint8_t*>(ptr);
+  size_t block_size = pool_class_configs[cls].block_size;
+  return pool_classes[cls].base +
+         (p - pool_classes[cls].base) / block_size * block_size;
+}
+
+static std::atomic<uint16_t>* pool_block_refs(const void* ptr) {
+  size_t cls = pool_class_for_block(ptr);
+  size_t index = (pool_block_start(ptr, cls) - pool_classes[cls].base) /
+                 pool_class_configs[cls].block_size;
+  return &pool_classes[cls].refs[index];
+}
+
+// Drops an extra reference of the block holding |ptr|. Returns false if there
+// was none left, the block must then be freed.
+static bool pool_unref(const void* ptr) {
+  std::atomic<uint16_t>* refs = pool_block_refs(ptr);
+  uint16_t count = refs->load();
+  while (count > 0) {
+    if (refs->compare_exchange_weak(count, count - 1)) return true;
+  }
+  return false;
+}
+
+// Per-thread cache of free blocks. Any blocks still cached when the thread
+// exits are handed back to the global free lists.
+class PoolThreadCache {
+ public:
+  PoolThreadCache() { memset(counts_, 0, sizeof(counts_)); }
+
+  ~PoolThreadCache() {
+    for (size_t i = 0; i < POOL_CLASS_COUNT; i++) {
+      pool_class_t* pool = &pool_classes[i];
+      std::lock_guard<std::mutex> lock(pool->lock);
+      while (counts_[i] > 0) {
+        pool_block_t* block = blocks_[i][--counts_[i]];
+        block->next = pool->free_list;
+        pool->free_list = block;
+        pool->free_count++;
+      }
+    }
+  }
+
+  pool_block_t* Pop(size_t cls) {
+    if (counts_[cls] == 0) return NULL;
+    return blocks_[cls][--counts_[cls]];
+  }
+
+  bool Push(size_t cls, pool_block_t* block) {
+    if (counts_[cls] == POOL_THREAD_CACHE_SIZE) return false;
+    blocks_[cls][counts_[cls]++] = block;
+    return true;
+  }
+
+ private:
+  pool_block_t* blocks_[POOL_CLASS_COUNT][POOL_THREAD_CACHE_SIZE];
+  size_t counts_[POOL_CLASS_COUNT];
+};
+
+static thread_local PoolThreadCache pool_thread_cache;
+
+static void* pool_alloc(size_t real_size) {
+  std::call_once(pool_init_flag, pool_init);
+
+  size_t cls = 0;
+  while (cls < POOL_CLASS_COUNT &&
+         pool_class_configs[cls].block_size < real_size)
+    cls++;
+  if (cls == POOL_CLASS_COUNT) return NULL;
+
+  pool_class_t* pool = &pool_classes[cls];
+  pool_block_t* block = pool_thread_cache.Pop(cls);
+  if (block == NULL) {
+    std::lock_guard<std::mutex> lock(pool->lock);
+    block = pool->free_list;
+    if (block != NULL) {
+      pool->free_list = block->next;
+      pool->free_count--;
+    }
+  }
+
+  if (block == NULL) {
+    pool->fallback_count++;
+    return NULL;
+  }
+
+  pool->alloc_count++;
+  size_t in_use = ++pool->in_use;
+  size_t in_use_max = pool->in_use_max.load();
+  while (in_use > in_use_max &&
+         !pool->in_use_max.compare_exchange_weak(in_use_max, in_use)) {
+  }
+  return block;
+}
+
+static void pool_free(void* ptr) {
+  size_t cls = pool_class_for_block(ptr);
+  pool_class_t* pool = &pool_classes[cls];
+  pool_block_t* block = static_cast<pool_block_t*>(ptr);
+
+  pool->free_total++;
+  pool->in_use--;
+
+  if (pool_thread_cache.Push(cls, block)) return;
+
+  std::lock_guard<std::mutex> lock(pool->lock);
+  block->next = pool->free_list;
+  pool->free_list = block;
+  pool->free_count++;
+}
+
 char* osi_strdup(const char* str) {
   size_t size = strlen(str) + 1;  // + 1 for the null terminator
+  allocation_tracker_sample_alloc(size, __builtin_return_address(0));
   size_t real_size = allocation_tracker_resize_for_canary(size);
   void* ptr = malloc(real_size);
   CHECK(ptr);
@@ -42,6 +255,7 @@ char* osi_strndup(const char* str, size_t len) {
   size_t size = strlen(str);
   if (len < size) size = len;
 
+  allocation_tracker_sample_alloc(size + 1, __builtin_return_address(0));
   size_t real_size = allocation_tracker_resize_for_canary(size + 1);
   void* ptr = malloc(real_size);
   CHECK(ptr);
@@ -57,6 +271,7 @@ char* osi_strndup(const char* str, size_t len) {
 
 void* osi_malloc(size_t size) {
   CHECK(static_cast<ssize_t>(size) >= 0);
+  allocation_tracker_sample_alloc(size, __builtin_return_address(0));
   size_t real_size = allocation_tracker_resize_for_canary(size);
   void* ptr = malloc(real_size);
   CHECK(ptr);
@@ -65,14 +280,67 @@ void* osi_malloc(size_t size) {
 
 void* osi_calloc(size_t size) {
   CHECK(static_cast<ssize_t>(size) >= 0);
+  allocation_tracker_sample_alloc(size, __builtin_return_address(0));
   size_t real_size = allocation_tracker_resize_for_canary(size);
   void* ptr = calloc(1, real_size);
   CHECK(ptr);
   return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
 }
 
+void* osi_pool_malloc(size_t size) {
+  CHECK(static_cast<ssize_t>(size) >= 0);
+  allocation_tracker_sample_alloc(size, __builtin_return_address(0));
+  size_t real_size = allocation_tracker_resize_for_canary(size);
+  void* ptr = pool_alloc(real_size);
+  if (ptr == NULL) ptr = malloc(real_size);
+  CHECK(ptr);
+  return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
+}
+
+void* osi_pool_calloc(size_t size) {
+  CHECK(static_cast<ssize_t>(size) >= 0);
+  allocation_tracker_sample_alloc(size, __builtin_return_address(0));
+  size_t real_size = allocation_tracker_resize_for_canary(size);
+  void* ptr = pool_alloc(real_size);
+  if (ptr != NULL)
+    memset(ptr, 0, real_size);
+  else
+    ptr = calloc(1, real_size);
+  CHECK(ptr);
+  return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
+}
+
+void* osi_ref(void* ptr) {
+  CHECK(ptr != NULL);
+  if (!pool_owns(ptr)) return NULL;
+
+  std::atomic<uint16_t>* refs = pool_block_refs(ptr);
+  CHECK(refs->fetch_add(1) < UINT16_MAX);
+  return ptr;
+}
+
+bool osi_is_shared(const void* ptr) {
+  return ptr != NULL && pool_owns(ptr) && pool_block_refs(ptr)->load() > 0;
+}
+
+size_t osi_pool_capacity(const void* ptr) {
+  if (ptr == NULL || !pool_owns(ptr)) return 0;
+  if (allocation_tracker_resize_for_canary(0) != 0) return 0;
+
+  size_t cls = pool_class_for_block(ptr);
+  return pool_block_start(ptr, cls) + pool_class_configs[cls].block_size -
+         static_cast<const uint8_t*>(ptr);
+}
+
 void osi_free(void* ptr) {
-  free(allocation_tracker_notify_free(alloc_allocator_id, ptr));
+  if (ptr != NULL && pool_owns(ptr) && pool_unref(ptr)) return;
+
+  void* real_ptr = allocation_tracker_notify_free(alloc_allocator_id, ptr);
+  if (real_ptr != NULL && pool_owns(real_ptr)) {
+    pool_free(real_ptr);
+    return;
+  }
+  free(real_ptr);
 }
 
 void osi_free_and_reset(void** p_ptr) {
@@ -84,3 +352,26 @@ void osi_free_and_reset(void** p_ptr) {
 const allocator_t allocator_calloc = {osi_calloc, osi_free};
 
 const allocator_t allocator_malloc = {osi_malloc, osi_free};
+
+const allocator_t allocator_pool = {osi_pool_malloc, osi_free};
+
+void osi_pool_debug_dump(int fd) {
+  dprintf(fd, "\nBluetooth Buffer Pool Statistics:\n");
+  dprintf(fd,
+          "  Block size  Blocks  Free  In use (max)  Allocs  Frees  "
+          "Fallbacks\n");
+
+  for (size_t i = 0; i < POOL_CLASS_COUNT; i++) {
+    pool_class_t* pool = &pool_classes[i];
+    size_t free_count;
+    {
+      std::lock_guard<std::mutex> lock(pool->lock);
+      free_count = pool->free_count;
+    }
+    dprintf(fd, "  %10zu  %6zu  %4zu  %6zu (%zu)  %6zu  %5zu  %9zu\n",
+            pool_class_configs[i].block_size, pool_class_configs[i].block_count,
+            free_count, pool->in_use.load(), pool->in_use_max.load(),
+            pool->alloc_count.load(), pool->free_total.load(),
+            pool->fallback_count.load());
+  }
+}
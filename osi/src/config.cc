@@ -36,46 +36,97 @@
 #include "osi/include/list.h"
 #include "osi/include/log.h"
 #include "osi/include/compat.h"
+#include "osi/include/osi.h"
 #include "log/log.h"
 #include "bt_target.h"
 #include <inttypes.h>
 
+#include <memory>
+#include <unordered_map>
+
+// The contents of the file a config was parsed from, shared with its clones.
+// Parsed strings are terminated in place and never modified afterwards; a
+// string that is changed is replaced with a copy owned by its entry.
+typedef std::shared_ptr<char> config_arena_t;
+
+// |borrowed_key| and |borrowed_value| are set when the string points into the
+// arena of the config rather than being owned by the entry.
 typedef struct {
   char* key;
   char* value;
+  bool borrowed_key;
+  bool borrowed_value;
 } entry_t;
 
+// Hashes and compares the C strings owned by sections and entries, so that a
+// lookup does not have to copy its argument into a std::string.
+struct cstr_hash {
+  size_t operator()(const char* str) const {
+    // FNV-1a
+    size_t hash = 2166136261u;
+    for (; *str; ++str) hash = (hash ^ (unsigned char)*str) * 16777619u;
+    return hash;
+  }
+};
+
+struct cstr_equal {
+  bool operator()(const char* a, const char* b) const { return !strcmp(a, b); }
+};
+
+template <typename T>
+using cstr_index_t = std::unordered_map<const char*, T*, cstr_hash, cstr_equal>;
+
+// |entries| keeps the insertion order for config_save, |index| maps each key
+// to its entry. |serialized| caches the section as written by config_save and
+// is only rebuilt when |dirty| is set.
 typedef struct {
   char* name;
+  bool borrowed_name;
   list_t* entries;
+  cstr_index_t<entry_t> index;
+  mutable bool dirty;
+  mutable std::string serialized;
 } section_t;
 
+// |sections| keeps the insertion order for config_save, |index| maps each
+// section name to its section. |dirty| is set by any modification.
 struct config_t {
   list_t* sections;
+  cstr_index_t<section_t> index;
+  bool dirty;
+  config_arena_t arena;
 };
 
 // Empty definition; this type is aliased to list_node_t.
 struct config_section_iter_t {};
 
-static bool config_parse(FILE* fp, config_t* config);
+static bool config_parse(char* data, size_t size, config_t* config);
 
-static section_t* section_new(const char* name);
+static section_t* section_new(const char* name, bool borrow);
 static void section_free(void* ptr);
 static section_t* section_find(const config_t* config, const char* section);
-
-static entry_t* entry_new(const char* key, const char* value);
+static section_t* section_find_or_add(config_t* config, const char* section,
+                                      bool borrow);
+static void section_set(config_t* config, section_t* sec, const char* key,
+                        bool borrow_key, const char* value, bool borrow_value);
+static const std::string& section_serialize(const section_t* section);
+
+static entry_t* entry_new(const char* key, bool borrow_key, const char* value,
+                          bool borrow_value);
 static void entry_free(void* ptr);
 static entry_t* entry_find(const config_t* config, const char* section,
                            const char* key);
+static entry_t* section_entry_find(const section_t* sec, const char* key);
 
 config_t* config_new_empty(void) {
-  config_t* config = static_cast<config_t*>(osi_calloc(sizeof(config_t)));
+  config_t* config = new config_t();
 
   config->sections = list_new(section_free);
   if (!config->sections) {
     LOG_ERROR(LOG_TAG, "%s unable to allocate list for sections.", __func__);
     goto error;
   }
+  config->dirty = true;
 
   return config;
 
@@ -90,20 +141,50 @@ config_t* config_new(const char* filename) {
   config_t* config = config_new_empty();
   if (!config) return NULL;
 
-  FILE* fp = fopen(filename, "rt");
-  if (!fp) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
     LOG_ERROR(LOG_TAG, "%s unable to open file '%s': %s", __func__, filename,
               strerror(errno));
     config_free(config);
     return NULL;
   }
 
-  if (!config_parse(fp, config)) {
+  // The whole file is read in one go into the arena, and parsed in place.
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    LOG_ERROR(LOG_TAG, "%s unable to stat file '%s': %s", __func__, filename,
+              strerror(errno));
+    close(fd);
+    config_free(config);
+    return NULL;
+  }
+
+  size_t size = 0;
+  char* data = static_cast<char*>(osi_malloc(st.st_size + 1));
+  while (size < (size_t)st.st_size) {
+    ssize_t ret;
+    OSI_NO_INTR(ret = read(fd, data + size, st.st_size - size));
+    if (ret < 0) {
+      LOG_ERROR(LOG_TAG, "%s unable to read file '%s': %s", __func__, filename,
+                strerror(errno));
+      osi_free(data);
+      close(fd);
+      config_free(config);
+      return NULL;
+    }
+    if (ret == 0) break;
+    size += ret;
+  }
+  close(fd);
+
+  data[size] = '\0';
+  config->arena = config_arena_t(data, osi_free);
+
+  if (!config_parse(data, size, config)) {
     config_free(config);
     config = NULL;
   }
 
-  fclose(fp);
   return config;
 }
 
@@ -127,17 +208,25 @@ config_t* config_new_clone(const config_t* src) {
 
   CHECK(ret != NULL);
 
+  // Strings parsed from the file are shared with |src| rather than copied.
+  ret->arena = src->arena;
+
   for (const list_node_t* node = list_begin(src->sections);
        node != list_end(src->sections); node = list_next(node)) {
     section_t* sec = static_cast<section_t*>(list_node(node));
 
     if (sec) {
+      section_t* ret_sec = NULL;
       for (const list_node_t* node_entry = list_begin(sec->entries);
            node_entry != list_end(sec->entries);
            node_entry = list_next(node_entry)) {
         entry_t* entry = static_cast<entry_t*>(list_node(node_entry));
 
-        config_set_string(ret, sec->name, entry->key, entry->value);
+        if (!ret_sec)
+          ret_sec = section_find_or_add(ret, sec->name, sec->borrowed_name);
+        if (ret_sec)
+          section_set(ret, ret_sec, entry->key, entry->borrowed_key,
+                      entry->value, entry->borrowed_value);
       }
     }
   }
@@ -148,8 +237,9 @@ config_t* config_new_clone(const config_t* src) {
 void config_free(config_t* config) {
   if (!config) return;
 
+  config->index.clear();
   list_free(config->sections);
-  osi_free(config);
+  delete config;
 }
 
 bool config_has_section(const config_t* config, const char* section) {
@@ -281,15 +371,7 @@ void config_set_bool(config_t* config, const char* section, const char* key,
 
 void config_set_string(config_t* config, const char* section, const char* key,
                        const char* value) {
-  section_t* sec = section_find(config, section);
-  if (!sec) {
-    sec = section_new(section);
-    if (sec)
-      list_append(config->sections, sec);
-    else {
-      LOG_ERROR(LOG_TAG,"%s: Unable to allocate memory for section", __func__);
-    }
-  }
+  section_t* sec = section_find_or_add(config, section, false);
 
   std::string value_string = value;
   std::string value_no_newline;
@@ -301,20 +383,7 @@ void config_set_string(config_t* config, const char* section, const char* key,
     value_no_newline = value_string;
   }
 
-  if (sec) {
-    for (const list_node_t* node = list_begin(sec->entries);
-         node != list_end(sec->entries); node = list_next(node)) {
-      entry_t* entry = static_cast<entry_t*>(list_node(node));
-      if (!strcmp(entry->key, key)) {
-        osi_free(entry->value);
-        entry->value = osi_strdup(value_no_newline.c_str());
-        return;
-      }
-    }
-
-    entry_t* entry = entry_new(key, value_no_newline.c_str());
-    list_append(sec->entries, entry);
-  }
+  if (sec) section_set(config, sec, key, false, value_no_newline.c_str(), false);
 }
 
 bool config_remove_section(config_t* config, const char* section) {
@@ -324,6 +393,8 @@ bool config_remove_section(config_t* config, const char* section) {
   section_t* sec = section_find(config, section);
   if (!sec) return false;
 
+  config->index.erase(sec->name);
+  config->dirty = true;
   return list_remove(config->sections, sec);
 }
 
@@ -333,9 +404,14 @@ bool config_remove_key(config_t* config, const char* section, const char* key) {
   CHECK(key != NULL);
 
   section_t* sec = section_find(config, section);
-  entry_t* entry = entry_find(config, section, key);
-  if (!sec || !entry) return false;
+  if (!sec) return false;
 
+  entry_t* entry = section_entry_find(sec, key);
+  if (!entry) return false;
+
+  sec->index.erase(entry->key);
+  sec->dirty = true;
+  config->dirty = true;
   return list_remove(sec->entries, entry);
 }
 
@@ -362,6 +438,16 @@ const char* config_section_name(const config_section_node_t* node) {
   return section->name;
 }
 
+bool config_is_dirty(const config_t* config) {
+  CHECK(config != NULL);
+  return config->dirty;
+}
+
+void config_clear_dirty(config_t* config) {
+  CHECK(config != NULL);
+  config->dirty = false;
+}
+
 #if (BT_IOT_LOGGING_ENABLED == TRUE)
 void config_sections_sort_by_entry_key(config_t* config, compare_func comp) {
   CHECK(config != NULL);
@@ -382,27 +468,61 @@ void config_sections_sort_by_entry_key(config_t* config, compare_func comp) {
       for (;list_next(q) && list_next(q) != p; q = list_next(q)) {
         entry_t* first = (entry_t*)list_node(q);
         entry_t* second = (entry_t*)list_node(list_next(q));
-        char* tmp_key;
-        char* tmp_value;
         if (comp(first->key, second->key) > 0) {
-          tmp_key = first->key;
-          tmp_value = first->value;
-          first->key = second->key;
-          first->value = second->value;
-          second->key = tmp_key;
-          second->value = tmp_value;
+          entry_t tmp = *first;
+          *first = *second;
+          *second = tmp;
           changed = true;
         }
       }
       p = q;
     }
 
+    // Keys were swapped between entries, point the index at their new owners.
+    sec->dirty = true;
+    config->dirty = true;
+    sec->index.clear();
+    for (list_node_t* enode = list_begin(sec->entries);
+         enode != list_end(sec->entries); enode = list_next(enode)) {
+      entry_t* entry = (entry_t*)list_node(enode);
+      sec->index.emplace(entry->key, entry);
+    }
   }
 }
 #endif
 
 bool config_save(const config_t* config, const char* filename) {
+  return config_save_filtered(config, filename, NULL);
+}
+
+bool config_save_filtered(const config_t* config, const char* filename,
+                          config_section_filter_t filter) {
+  CHECK(config != NULL);
+
+  return config_save_contents(config_serialize(config, filter), filename);
+}
+
+std::string config_serialize(const config_t* config,
+                             config_section_filter_t filter) {
   CHECK(config != NULL);
+
+  std::string contents;
+
+  // Only sections modified since the last save are serialized again.
+  for (const list_node_t* node = list_begin(config->sections);
+       node != list_end(config->sections); node = list_next(node)) {
+    const section_t* section = (const section_t*)list_node(node);
+    if (filter && !filter(config, section->name)) continue;
+
+    // Separate sections with a newline.
+    if (!contents.empty()) contents.push_back('\n');
+    contents.append(section_serialize(section));
+  }
+
+  return contents;
+}
+
+bool config_save_contents(const std::string& contents, const char* filename) {
   CHECK(filename != NULL);
   CHECK(*filename != '\0');
 
@@ -447,37 +567,10 @@ bool config_save(const config_t* config, const char* filename) {
     goto error;
   }
 
-  for (const list_node_t* node = list_begin(config->sections);
-       node != list_end(config->sections); node = list_next(node)) {
-    const section_t* section = (const section_t*)list_node(node);
-    if (section->name[0] == '#') {
-        if (fprintf(fp, "%s", section->name) < 0) {
-            LOG_ERROR(LOG_TAG, "%s unable to write to file '%s': %s", __func__, temp_filename, strerror(errno));
-            goto error;
-        }
-    } else if (fprintf(fp, "[%s]\n", section->name) < 0) {
-      LOG_ERROR(LOG_TAG, "%s unable to write to file '%s': %s", __func__, temp_filename, strerror(errno));
-      goto error;
-    }
-
-    for (const list_node_t* enode = list_begin(section->entries);
-         enode != list_end(section->entries); enode = list_next(enode)) {
-      const entry_t* entry = (const entry_t*)list_node(enode);
-      if (fprintf(fp, "%s = %s\n", entry->key, entry->value) < 0) {
-        LOG_ERROR(LOG_TAG, "%s unable to write to file '%s': %s", __func__,
-                  temp_filename, strerror(errno));
-        goto error;
-      }
-    }
-
-    // Only add a separating newline if there are more sections.
-    if (list_next(node) != list_end(config->sections)) {
-      if (fputc('\n', fp) == EOF) {
-        LOG_ERROR(LOG_TAG, "%s unable to write to file '%s': %s", __func__,
-                  temp_filename, strerror(errno));
-        goto error;
-      }
-    }
+  if (fwrite(contents.data(), 1, contents.size(), fp) != contents.size()) {
+    LOG_ERROR(LOG_TAG, "%s unable to write to file '%s': %s", __func__,
+              temp_filename, strerror(errno));
+    goto error;
   }
 
   // Sync written temp file out to disk. fsync() is blocking until data makes it
@@ -652,43 +745,25 @@ static char* trim(char* str) {
   return str;
 }
 
-static bool config_parse(FILE* fp, config_t* config) {
-  CHECK(fp != NULL);
+static bool config_parse(char* data, size_t size, config_t* config) {
+  CHECK(data != NULL);
   CHECK(config != NULL);
 
   int line_num = 0;
-  char line[1024] = { '\0' };
-  std::string line_new;
-  uint16_t MAX_BUF = 1023;
-  char section[1024] = { '\0' };
-  char comment[1024] = { '\0' };
+  const char* section = CONFIG_DEFAULT_SECTION;
+  bool borrow_section = false;
   bool skip_entries = false;
-  strcpy(section, CONFIG_DEFAULT_SECTION);
+  char* data_end = data + size;
 
-  while (fgets(line, sizeof(line), fp)) {
-    char* line_ptr = trim(line);
+  // Lines are terminated in place, every section name, key and value parsed
+  // points into |data|.
+  for (char* line = data; line < data_end;) {
+    char* line_end = static_cast<char*>(memchr(line, '\n', data_end - line));
+    if (!line_end) line_end = data_end;
+    *line_end = '\0';
 
-    /* fgets stops when either sizeof(line) = MAX_BUF (buffer_length - 1)character
-     * are read, the newline character is read, or the end-of-file is reached,
-     * whichever comes first.
-     * Hence check if sizeof(line) = MAX_BUF and the last character read is not an
-     * EOF and/or not '\n' then  Read remaining characters of a line.
-     */
-
-    if ((strlen(line) == MAX_BUF) && (line[MAX_BUF - 1] != EOF) &&
-        (line[MAX_BUF - 1] != '\n')) {
-      line_new = line_ptr;
-      while (fgets(line, sizeof(line), fp)) {
-        line_ptr = trim(line);
-        line_new.append(line_ptr);
-
-        //stop reading if '\n' or EOF is reached
-        if (strlen(line) == 0 || line[strlen(line) - 1] == '\n' ||
-            line[strlen(line) - 1] == EOF)
-          break;
-      }
-      line_ptr = &line_new[0];
-    }
+    char* line_ptr = trim(line);
+    line = line_end + 1;
     ++line_num;
 
     // Skip blanks.
@@ -696,13 +771,7 @@ static bool config_parse(FILE* fp, config_t* config) {
       continue;
 
     if (*line_ptr == '#') {
-        strlcpy(comment, line_ptr, 1024);
-
-        if(!section_find(config, comment)) {
-            section_t *sec = section_new(comment);
-            if (sec)
-                list_append(config->sections, sec);
-        }
+        section_find_or_add(config, line_ptr, true);
     } else if (*line_ptr == '[') {
       size_t len = strlen(line_ptr);
       if (line_ptr[len - 1] != ']') {
@@ -710,8 +779,9 @@ static bool config_parse(FILE* fp, config_t* config) {
         skip_entries = true;
         continue;
       }
-      strncpy(section, line_ptr + 1, len - 2);
-      section[len - 2] = '\0';
+      line_ptr[len - 1] = '\0';
+      section = line_ptr + 1;
+      borrow_section = true;
       skip_entries = false;
     } else {
       char *split = strchr(line_ptr, '=');
@@ -725,17 +795,21 @@ static bool config_parse(FILE* fp, config_t* config) {
       }
 
       *split = '\0';
-      config_set_string(config, section, trim(line_ptr), trim(split + 1));
+      section_t* sec = section_find_or_add(config, section, borrow_section);
+      if (sec)
+        section_set(config, sec, trim(line_ptr), true, trim(split + 1), true);
     }
   }
   return true;
 }
 
-static section_t* section_new(const char* name) {
-  section_t* section = static_cast<section_t*>(osi_calloc(sizeof(section_t)));
+static section_t* section_new(const char* name, bool borrow) {
+  section_t* section = new section_t();
 
-  section->name = osi_strdup(name);
+  section->name = borrow ? const_cast<char*>(name) : osi_strdup(name);
+  section->borrowed_name = borrow;
   section->entries = list_new(entry_free);
+  section->dirty = true;
   return section;
 }
 
@@ -743,26 +817,84 @@ static void section_free(void* ptr) {
   if (!ptr) return;
 
   section_t* section = static_cast<section_t*>(ptr);
-  osi_free(section->name);
+  section->index.clear();
+  if (!section->borrowed_name) osi_free(section->name);
   list_free(section->entries);
-  osi_free(section);
+  delete section;
 }
 
 static section_t* section_find(const config_t* config, const char* section) {
-  for (const list_node_t* node = list_begin(config->sections);
-       node != list_end(config->sections); node = list_next(node)) {
-    section_t* sec = static_cast<section_t*>(list_node(node));
-    if (sec && !strcmp(sec->name, section)) return sec;
+  auto it = config->index.find(section);
+  return (it != config->index.end()) ? it->second : NULL;
 }
 
-  return NULL;
+static section_t* section_find_or_add(config_t* config, const char* section,
+                                      bool borrow) {
+  section_t* sec = section_find(config, section);
+  if (sec) return sec;
+
+  sec = section_new(section, borrow);
+  if (!sec) {
+    LOG_ERROR(LOG_TAG, "%s: Unable to allocate memory for section", __func__);
+    return NULL;
+  }
+
+  list_append(config->sections, sec);
+  config->index.emplace(sec->name, sec);
+  config->dirty = true;
+  return sec;
+}
+
+// Sets |key| in |sec| to |value|. Borrowed strings point into the arena of
+// |config| and are not copied.
+static void section_set(config_t* config, section_t* sec, const char* key,
+                        bool borrow_key, const char* value, bool borrow_value) {
+  entry_t* entry = section_entry_find(sec, key);
+  if (entry) {
+    // Rewriting the same value is common, don't make the section dirty.
+    if (!strcmp(entry->value, value)) return;
+    if (!entry->borrowed_value) osi_free(entry->value);
+    entry->value =
+        borrow_value ? const_cast<char*>(value) : osi_strdup(value);
+    entry->borrowed_value = borrow_value;
+  } else {
+    entry = entry_new(key, borrow_key, value, borrow_value);
+    list_append(sec->entries, entry);
+    sec->index.emplace(entry->key, entry);
+  }
+  sec->dirty = true;
+  config->dirty = true;
+}
+
+static const std::string& section_serialize(const section_t* section) {
+  if (!section->dirty) return section->serialized;
+
+  std::string& out = section->serialized;
+  out.clear();
+  if (section->name[0] == '#') {
+    out.append(section->name);
+  } else {
+    out.append("[").append(section->name).append("]\n");
+  }
+
+  for (const list_node_t* node = list_begin(section->entries);
+       node != list_end(section->entries); node = list_next(node)) {
+    const entry_t* entry = (const entry_t*)list_node(node);
+    out.append(entry->key).append(" = ").append(entry->value).append("\n");
+  }
+
+  section->dirty = false;
+  return out;
 }
 
-static entry_t* entry_new(const char* key, const char* value) {
+static entry_t* entry_new(const char* key, bool borrow_key, const char* value,
+                          bool borrow_value) {
   entry_t* entry = static_cast<entry_t*>(osi_calloc(sizeof(entry_t)));
 
-  entry->key = osi_strdup(key);
-  entry->value = osi_strdup(value);
+  entry->key = borrow_key ? const_cast<char*>(key) : osi_strdup(key);
+  entry->value = borrow_value ? const_cast<char*>(value) : osi_strdup(value);
+  entry->borrowed_key = borrow_key;
+  entry->borrowed_value = borrow_value;
   return entry;
 }
 
@@ -770,8 +902,8 @@ static void entry_free(void* ptr) {
   if (!ptr) return;
 
   entry_t* entry = static_cast<entry_t*>(ptr);
-  osi_free(entry->key);
-  osi_free(entry->value);
+  if (!entry->borrowed_key) osi_free(entry->key);
+  if (!entry->borrowed_value) osi_free(entry->value);
   osi_free(entry);
 }
 
@@ -780,11 +912,10 @@ static entry_t* entry_find(const config_t* config, const char* section,
   section_t* sec = section_find(config, section);
   if (!sec) return NULL;
 
-  for (const list_node_t* node = list_begin(sec->entries);
-       node != list_end(sec->entries); node = list_next(node)) {
-    entry_t* entry = static_cast<entry_t*>(list_node(node));
-    if (!strcmp(entry->key, key)) return entry;
-  }
+  return section_entry_find(sec, key);
+}
 
-  return NULL;
+static entry_t* section_entry_find(const section_t* sec, const char* key) {
+  auto it = sec->index.find(key);
+  return (it != sec->index.end()) ? it->second : NULL;
 }
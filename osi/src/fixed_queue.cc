@@ -19,6 +19,7 @@
 #include <base/logging.h>
 #include <string.h>
 
+#include <atomic>
 #include <mutex>
 
 #include "osi/include/allocator.h"
@@ -28,7 +29,33 @@
 #include "osi/include/reactor.h"
 #include "osi/include/semaphore.h"
 
+// Bounded lock-free ring used by queues created with |fixed_queue_new_spsc|
+// or |fixed_queue_new_mpsc|. Each cell carries a sequence number that tells
+// producers and the consumer whether the cell is free or holds data for the
+// current lap, so no lock is needed on either side.
+typedef struct {
+  std::atomic<size_t> sequence;
+  void* data;
+} ring_cell_t;
+
+typedef struct {
+  ring_cell_t* cells;
+  size_t mask;
+  bool multi_producer;
+
+  alignas(64) std::atomic<size_t> enqueue_pos;
+  alignas(64) std::atomic<size_t> dequeue_pos;
+
+  // Number of published elements. Producers increment it after publishing;
+  // it can briefly lag behind the consumer and is only used for reporting.
+  alignas(64) std::atomic<size_t> count;
+
+  // Number of producers blocked in |fixed_queue_enqueue| on a full ring.
+  std::atomic<int> waiting_producers;
+} fixed_queue_ring_t;
+
 typedef struct fixed_queue_t {
+  fixed_queue_ring_t* ring;
   list_t* list;
   semaphore_t* enqueue_sem;
   semaphore_t* dequeue_sem;
@@ -37,10 +64,18 @@ typedef struct fixed_queue_t {
 
   reactor_object_t* dequeue_object;
   fixed_queue_cb dequeue_ready;
+  fixed_queue_batch_cb dequeue_batch_ready;
+  size_t dequeue_batch_size;
   void* dequeue_context;
 } fixed_queue_t;
 
 static void internal_dequeue_ready(void* context);
+static void internal_dequeue_batch_ready(void* context);
+static fixed_queue_t* ring_queue_new(size_t capacity, bool multi_producer);
+static bool ring_try_enqueue(fixed_queue_t* queue, void* data);
+static void* ring_try_dequeue(fixed_queue_t* queue);
+static void* ring_try_dequeue_before_wait(fixed_queue_t* queue);
+static void* ring_peek(const fixed_queue_t* queue);
 
 fixed_queue_t* fixed_queue_new(size_t capacity) {
   fixed_queue_t* ret =
@@ -65,11 +100,32 @@ error:
   return NULL;
 }
 
+fixed_queue_t* fixed_queue_new_spsc(size_t capacity) {
+  return ring_queue_new(capacity, false);
+}
+
+fixed_queue_t* fixed_queue_new_mpsc(size_t capacity) {
+  return ring_queue_new(capacity, true);
+}
+
 void fixed_queue_free(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
   if (!queue) return;
 
   fixed_queue_unregister_dequeue(queue);
 
+  if (queue->ring) {
+    void* data;
+    while ((data = ring_try_dequeue(queue)) != NULL)
+      if (free_cb) free_cb(data);
+
+    semaphore_free(queue->enqueue_sem);
+    semaphore_free(queue->dequeue_sem);
+    delete[] queue->ring->cells;
+    delete queue->ring;
+    osi_free(queue);
+    return;
+  }
+
   if (free_cb)
     for (const list_node_t* node = list_begin(queue->list);
          node != list_end(queue->list); node = list_next(node))
@@ -96,6 +152,8 @@ void fixed_queue_flush(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
 bool fixed_queue_is_empty(fixed_queue_t* queue) {
   if (queue == NULL) return true;
 
+  if (queue->ring) return ring_peek(queue) == NULL;
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_is_empty(queue->list);
 }
@@ -103,6 +161,12 @@ bool fixed_queue_is_empty(fixed_queue_t* queue) {
 size_t fixed_queue_length(fixed_queue_t* queue) {
   if (queue == NULL) return 0;
 
+  if (queue->ring) {
+    // The consumer may briefly run ahead of a producer's increment.
+    ssize_t count = static_cast<ssize_t>(queue->ring->count.load());
+    return count > 0 ? static_cast<size_t>(count) : 0;
+  }
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_length(queue->list);
 }
@@ -117,6 +181,20 @@ void fixed_queue_enqueue(fixed_queue_t* queue, void* data) {
   CHECK(queue != NULL);
   CHECK(data != NULL);
 
+  if (queue->ring) {
+    while (!ring_try_enqueue(queue, data)) {
+      queue->ring->waiting_producers++;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (ring_try_enqueue(queue, data)) {
+        queue->ring->waiting_producers--;
+        return;
+      }
+      semaphore_wait(queue->enqueue_sem);
+      queue->ring->waiting_producers--;
+    }
+    return;
+  }
+
   semaphore_wait(queue->enqueue_sem);
 
   {
@@ -130,6 +208,15 @@ void fixed_queue_enqueue(fixed_queue_t* queue, void* data) {
 void* fixed_queue_dequeue(fixed_queue_t* queue) {
   CHECK(queue != NULL);
 
+  if (queue->ring) {
+    void* ret;
+    while ((ret = ring_try_dequeue(queue)) == NULL) {
+      if ((ret = ring_try_dequeue_before_wait(queue)) != NULL) break;
+      semaphore_wait(queue->dequeue_sem);
+    }
+    return ret;
+  }
+
   semaphore_wait(queue->dequeue_sem);
 
   void* ret = NULL;
@@ -148,6 +235,8 @@ bool fixed_queue_try_enqueue(fixed_queue_t* queue, void* data) {
   CHECK(queue != NULL);
   CHECK(data != NULL);
 
+  if (queue->ring) return ring_try_enqueue(queue, data);
+
   if (!semaphore_try_wait(queue->enqueue_sem)) return false;
 
   {
@@ -162,6 +251,8 @@ bool fixed_queue_try_enqueue(fixed_queue_t* queue, void* data) {
 void* fixed_queue_try_dequeue(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
+  if (queue->ring) return ring_try_dequeue(queue);
+
   if (!semaphore_try_wait(queue->dequeue_sem)) return NULL;
 
   void* ret = NULL;
@@ -179,6 +270,8 @@ void* fixed_queue_try_dequeue(fixed_queue_t* queue) {
 void* fixed_queue_try_peek_first(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
+  if (queue->ring) return ring_peek(queue);
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_is_empty(queue->list) ? NULL : list_front(queue->list);
 }
@@ -186,6 +279,8 @@ void* fixed_queue_try_peek_first(fixed_queue_t* queue) {
 void* fixed_queue_try_peek_last(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
+  CHECK(queue->ring == NULL) << "not supported on lock-free queues";
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_is_empty(queue->list) ? NULL : list_back(queue->list);
 }
@@ -193,6 +288,8 @@ void* fixed_queue_try_peek_last(fixed_queue_t* queue) {
 void* fixed_queue_try_remove_from_queue(fixed_queue_t* queue, void* data) {
   if (queue == NULL) return NULL;
 
+  CHECK(queue->ring == NULL) << "not supported on lock-free queues";
+
   bool removed = false;
   {
     std::lock_guard<std::mutex> lock(*queue->mutex);
@@ -212,6 +309,7 @@ void* fixed_queue_try_remove_from_queue(fixed_queue_t* queue, void* data) {
 
 list_t* fixed_queue_get_list(fixed_queue_t* queue) {
   CHECK(queue != NULL);
+  CHECK(queue->ring == NULL) << "not supported on lock-free queues";
 
   // NOTE: Using the list in this way is not thread-safe.
   // Using this list in any context where threads can call other functions
@@ -226,6 +324,7 @@ int fixed_queue_get_dequeue_fd(const fixed_queue_t* queue) {
 
 int fixed_queue_get_enqueue_fd(const fixed_queue_t* queue) {
   CHECK(queue != NULL);
+  CHECK(queue->ring == NULL) << "not supported on lock-free queues";
   return semaphore_get_fd(queue->enqueue_sem);
 }
 
@@ -245,6 +344,26 @@ void fixed_queue_register_dequeue(fixed_queue_t* queue, reactor_t* reactor,
                        internal_dequeue_ready, NULL);
 }
 
+void fixed_queue_register_dequeue_batch(fixed_queue_t* queue,
+                                        reactor_t* reactor, size_t max_batch,
+                                        fixed_queue_batch_cb ready_cb,
+                                        void* context) {
+  CHECK(queue != NULL);
+  CHECK(reactor != NULL);
+  CHECK(ready_cb != NULL);
+  CHECK(max_batch > 0 && max_batch <= FIXED_QUEUE_MAX_BATCH);
+
+  // Make sure we're not already registered
+  fixed_queue_unregister_dequeue(queue);
+
+  queue->dequeue_batch_ready = ready_cb;
+  queue->dequeue_batch_size = max_batch;
+  queue->dequeue_context = context;
+  queue->dequeue_object =
+      reactor_register(reactor, fixed_queue_get_dequeue_fd(queue), queue,
+                       internal_dequeue_batch_ready, NULL);
+}
+
 void fixed_queue_unregister_dequeue(fixed_queue_t* queue) {
   CHECK(queue != NULL);
 
@@ -258,5 +377,173 @@ static void internal_dequeue_ready(void* context) {
   CHECK(context != NULL);
 
   fixed_queue_t* queue = static_cast<fixed_queue_t*>(context);
+
+  if (queue->ring) {
+    // Producers only signal on the empty->non-empty transition, so consume
+    // that signal and keep calling back for as long as the callback makes
+    // progress draining the ring.
+    semaphore_try_wait(queue->dequeue_sem);
+    fixed_queue_ring_t* ring = queue->ring;
+    for (;;) {
+      if (ring_peek(queue) == NULL) {
+        // Pairs with the fence in |ring_try_enqueue| so that either we see
+        // the new head or its producer sees our position and signals us.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ring_peek(queue) == NULL) break;
+      }
+      size_t pos = ring->dequeue_pos.load(std::memory_order_relaxed);
+      queue->dequeue_ready(queue, queue->dequeue_context);
+      if (ring->dequeue_pos.load(std::memory_order_relaxed) == pos) break;
+    }
+    return;
+  }
+
   queue->dequeue_ready(queue, queue->dequeue_context);
 }
+
+static void internal_dequeue_batch_ready(void* context) {
+  CHECK(context != NULL);
+
+  fixed_queue_t* queue = static_cast<fixed_queue_t*>(context);
+  void* batch[FIXED_QUEUE_MAX_BATCH];
+  size_t count = 0;
+
+  if (queue->ring) {
+    semaphore_try_wait(queue->dequeue_sem);
+    while (count < queue->dequeue_batch_size) {
+      void* data = ring_try_dequeue(queue);
+      if (data == NULL) data = ring_try_dequeue_before_wait(queue);
+      if (data == NULL) break;
+      batch[count++] = data;
+    }
+
+    // Hand the rest of a long burst to the next reactor iteration so other
+    // objects on the same reactor get a turn.
+    if (count == queue->dequeue_batch_size && ring_peek(queue) != NULL)
+      semaphore_post(queue->dequeue_sem);
+  } else {
+    // One semaphore token per element; grab the whole batch worth at once.
+    count = semaphore_try_wait_many(queue->dequeue_sem,
+                                    queue->dequeue_batch_size);
+    {
+      std::lock_guard<std::mutex> lock(*queue->mutex);
+      for (size_t i = 0; i < count; i++) {
+        batch[i] = list_front(queue->list);
+        list_remove(queue->list, batch[i]);
+      }
+    }
+    semaphore_post_many(queue->enqueue_sem, count);
+  }
+
+  if (count > 0)
+    queue->dequeue_batch_ready(queue, batch, count, queue->dequeue_context);
+}
+
+static fixed_queue_t* ring_queue_new(size_t capacity, bool multi_producer) {
+  CHECK(capacity > 0);
+  CHECK(capacity <= (SIZE_MAX >> 2));
+
+  size_t size = 1;
+  while (size < capacity) size <<= 1;
+
+  fixed_queue_t* ret =
+      static_cast<fixed_queue_t*>(osi_calloc(sizeof(fixed_queue_t)));
+  ret->capacity = size;
+
+  ret->enqueue_sem = semaphore_new(0);
+  ret->dequeue_sem = semaphore_new(0);
+  if (!ret->enqueue_sem || !ret->dequeue_sem) {
+    semaphore_free(ret->enqueue_sem);
+    semaphore_free(ret->dequeue_sem);
+    osi_free(ret);
+    return NULL;
+  }
+
+  fixed_queue_ring_t* ring = new fixed_queue_ring_t;
+  ring->cells = new ring_cell_t[size];
+  for (size_t i = 0; i < size; i++) {
+    ring->cells[i].sequence.store(i, std::memory_order_relaxed);
+    ring->cells[i].data = NULL;
+  }
+  ring->mask = size - 1;
+  ring->multi_producer = multi_producer;
+  ring->enqueue_pos.store(0, std::memory_order_relaxed);
+  ring->dequeue_pos.store(0, std::memory_order_relaxed);
+  ring->count.store(0, std::memory_order_relaxed);
+  ring->waiting_producers.store(0, std::memory_order_relaxed);
+  ret->ring = ring;
+
+  return ret;
+}
+
+static bool ring_try_enqueue(fixed_queue_t* queue, void* data) {
+  fixed_queue_ring_t* ring = queue->ring;
+  size_t pos = ring->enqueue_pos.load(std::memory_order_relaxed);
+  ring_cell_t* cell;
+
+  for (;;) {
+    cell = &ring->cells[pos & ring->mask];
+    size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+    if (diff == 0) {
+      if (!ring->multi_producer) {
+        ring->enqueue_pos.store(pos + 1, std::memory_order_relaxed);
+        break;
+      }
+      if (ring->enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                                  std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return false;  // Full
+    } else {
+      pos = ring->enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->data = data;
+  cell->sequence.store(pos + 1, std::memory_order_release);
+  ring->count.fetch_add(1);
+
+  // Only the element at the head of the ring can be the one the consumer is
+  // waiting for; anything behind it is picked up while draining.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (ring->dequeue_pos.load(std::memory_order_relaxed) == pos)
+    semaphore_post(queue->dequeue_sem);
+  return true;
+}
+
+static void* ring_try_dequeue(fixed_queue_t* queue) {
+  fixed_queue_ring_t* ring = queue->ring;
+  size_t pos = ring->dequeue_pos.load(std::memory_order_relaxed);
+  ring_cell_t* cell = &ring->cells[pos & ring->mask];
+  size_t sequence = cell->sequence.load(std::memory_order_acquire);
+  if ((intptr_t)sequence - (intptr_t)(pos + 1) < 0) return NULL;  // Empty
+
+  void* data = cell->data;
+  ring->dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+  cell->sequence.store(pos + ring->mask + 1, std::memory_order_release);
+  ring->count.fetch_sub(1);
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (ring->waiting_producers.load() > 0) semaphore_post(queue->enqueue_sem);
+
+  return data;
+}
+
+// Retries a failed dequeue right before the consumer blocks. The fence pairs
+// with the one in |ring_try_enqueue|: either the retry sees the element being
+// published at the head, or its producer sees the consumer parked on it and
+// signals the dequeue semaphore.
+static void* ring_try_dequeue_before_wait(fixed_queue_t* queue) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  return ring_try_dequeue(queue);
+}
+
+static void* ring_peek(const fixed_queue_t* queue) {
+  const fixed_queue_ring_t* ring = queue->ring;
+  size_t pos = ring->dequeue_pos.load(std::memory_order_relaxed);
+  const ring_cell_t* cell = &ring->cells[pos & ring->mask];
+  size_t sequence = cell->sequence.load(std::memory_order_acquire);
+  if ((intptr_t)sequence - (intptr_t)(pos + 1) < 0) return NULL;
+  return cell->data;
+}
@@ -4,6 +4,12 @@
 #include "osi/include/list.h"
 #include "osi/include/osi.h"
 
+// Nodes stored in the list itself, most lists never need more
+#define LIST_INLINE_NODES 4
+
+// Removed heap nodes kept for reuse by each list
+#define LIST_SPARE_NODES_MAX 8
+
 struct list_node_t {
   struct list_node_t* next;
   void* data;
@@ -15,8 +21,15 @@ typedef struct list_t {
   size_t length;
   list_free_cb free_cb;
   const allocator_t* allocator;
+  // Unused nodes, the free inline nodes and up to |LIST_SPARE_NODES_MAX|
+  // heap nodes
+  list_node_t* spare;
+  size_t spare_heap_nodes;
+  list_node_t inline_nodes[LIST_INLINE_NODES];
 } list_t;
 
+static bool list_is_inline_node_(const list_t* list, const list_node_t* node);
+static list_node_t* list_new_node_(list_t* list);
 static list_node_t* list_free_node_(list_t* list, list_node_t* node);
 
 // Hidden constructor, only to be used by the hash map for the allocation
@@ -29,6 +42,10 @@ list_t* list_new_internal(list_free_cb callback,
 
   list->free_cb = callback;
   list->allocator = zeroed_allocator;
+  for (list_node_t& node : list->inline_nodes) {
+    node.next = list->spare;
+    list->spare = &node;
+  }
   return list;
 }
 
@@ -40,6 +57,11 @@ void list_free(list_t* list) {
   if (!list) return;
 
   list_clear(list);
+  while (list->spare) {
+    list_node_t* node = list->spare;
+    list->spare = node->next;
+    if (!list_is_inline_node_(list, node)) list->allocator->free(node);
+  }
   list->allocator->free(list);
 }
 
@@ -91,7 +113,7 @@ bool list_insert_after(list_t* list, list_node_t* prev_node, void* data) {
   CHECK(prev_node != NULL);
   CHECK(data != NULL);
 
-  list_node_t* node = (list_node_t*)list->allocator->alloc(sizeof(list_node_t));
+  list_node_t* node = list_new_node_(list);
   if (!node) return false;
 
   node->next = prev_node->next;
@@ -106,7 +128,7 @@ bool list_prepend(list_t* list, void* data) {
   CHECK(list != NULL);
   CHECK(data != NULL);
 
-  list_node_t* node = (list_node_t*)list->allocator->alloc(sizeof(list_node_t));
+  list_node_t* node = list_new_node_(list);
   if (!node) return false;
   node->next = list->head;
   node->data = data;
@@ -120,7 +142,7 @@ bool list_append(list_t* list, void* data) {
   CHECK(list != NULL);
   CHECK(data != NULL);
 
-  list_node_t* node = (list_node_t*)list->allocator->alloc(sizeof(list_node_t));
+  list_node_t* node = list_new_node_(list);
   if (!node) return false;
   node->next = NULL;
   node->data = data;
@@ -201,6 +223,20 @@ void* list_node(const list_node_t* node) {
   return node->data;
 }
 
+static bool list_is_inline_node_(const list_t* list, const list_node_t* node) {
+  return node >= list->inline_nodes &&
+         node < list->inline_nodes + LIST_INLINE_NODES;
+}
+
+static list_node_t* list_new_node_(list_t* list) {
+  list_node_t* node = list->spare;
+  if (!node) return (list_node_t*)list->allocator->alloc(sizeof(list_node_t));
+
+  list->spare = node->next;
+  if (!list_is_inline_node_(list, node)) --list->spare_heap_nodes;
+  return node;
+}
+
 static list_node_t* list_free_node_(list_t* list, list_node_t* node) {
   CHECK(list != NULL);
   CHECK(node != NULL);
@@ -208,8 +244,16 @@ static list_node_t* list_free_node_(list_t* list, list_node_t* node) {
   list_node_t* next = node->next;
 
   if (list->free_cb) list->free_cb(node->data);
-  list->allocator->free(node);
   --list->length;
 
+  bool is_inline = list_is_inline_node_(list, node);
+  if (is_inline || list->spare_heap_nodes < LIST_SPARE_NODES_MAX) {
+    if (!is_inline) ++list->spare_heap_nodes;
+    node->next = list->spare;
+    list->spare = node;
+  } else {
+    list->allocator->free(node);
+  }
+
   return next;
 }
@@ -0,0 +1,182 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_memory_governor"
+
+#include "osi/include/memory_governor.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <mutex>
+
+#include "osi/include/log.h"
+#include "osi/include/properties.h"
+
+// Number of subsystems that may register
+#define MEMORY_GOVERNOR_MAX_CLIENTS 16
+
+struct memory_client_t {
+  const char* name;
+  memory_pressure_cb callback;
+  void* context;
+  std::atomic<size_t> held;
+  std::atomic<size_t> held_max;
+};
+
+static memory_client_t clients[MEMORY_GOVERNOR_MAX_CLIENTS];
+static size_t client_count;
+
+// Serializes the registrations and the pressure changes, so that the
+// callbacks see the changes in order
+static std::mutex governor_lock;
+static std::once_flag budget_flag;
+
+static std::atomic<size_t> budget;
+static std::atomic<size_t> total_held;
+static std::atomic<size_t> total_held_max;
+static std::atomic<int> current_pressure{MEMORY_PRESSURE_NONE};
+static std::atomic<size_t> pressure_changes;
+
+static void read_budget(void) {
+  int32_t budget_kb =
+      osi_property_get_int32(MEMORY_GOVERNOR_BUDGET_PROPERTY, 0);
+  if (budget_kb > 0) budget = static_cast<size_t>(budget_kb) * 1024;
+}
+
+static void update_max(std::atomic<size_t>* max, size_t value) {
+  size_t current = max->load();
+  while (value > current && !max->compare_exchange_weak(current, value)) {
+  }
+}
+
+// Returns the pressure for |held| bytes coming from |current|. The pressure
+// goes down at lower levels than it goes up so that it does not flap.
+static memory_pressure_t pressure_for(size_t held, size_t limit,
+                                      memory_pressure_t current) {
+  if (limit == 0) return MEMORY_PRESSURE_NONE;
+  if (held >= limit ||
+      (current == MEMORY_PRESSURE_CRITICAL && held >= limit / 10 * 9))
+    return MEMORY_PRESSURE_CRITICAL;
+  if (held >= limit / 4 * 3 ||
+      (current != MEMORY_PRESSURE_NONE && held >= limit / 10 * 6))
+    return MEMORY_PRESSURE_MODERATE;
+  return MEMORY_PRESSURE_NONE;
+}
+
+static void update_pressure(void) {
+  memory_pressure_t current =
+      static_cast<memory_pressure_t>(current_pressure.load());
+  if (pressure_for(total_held, budget, current) == current) return;
+
+  std::lock_guard<std::mutex> lock(governor_lock);
+  current = static_cast<memory_pressure_t>(current_pressure.load());
+  memory_pressure_t next = pressure_for(total_held, budget, current);
+  if (next == current) return;
+
+  current_pressure = next;
+  pressure_changes++;
+  LOG_INFO(LOG_TAG, "%s: pressure %d, %zu bytes held of %zu", __func__, next,
+           total_held.load(), budget.load());
+  for (size_t i = 0; i < client_count; i++) {
+    if (clients[i].callback != NULL)
+      clients[i].callback(next, clients[i].context);
+  }
+}
+
+memory_client_t* memory_governor_register(const char* name,
+                                          memory_pressure_cb callback,
+                                          void* context) {
+  std::call_once(budget_flag, read_budget);
+
+  std::lock_guard<std::mutex> lock(governor_lock);
+  memory_client_t* client = NULL;
+  for (size_t i = 0; i < client_count; i++) {
+    if (strcmp(clients[i].name, name) == 0) client = &clients[i];
+  }
+  if (client == NULL) {
+    if (client_count == MEMORY_GOVERNOR_MAX_CLIENTS) {
+      LOG_ERROR(LOG_TAG, "%s: no room for %s", __func__, name);
+      return NULL;
+    }
+    client = &clients[client_count++];
+    client->name = name;
+  }
+  client->callback = callback;
+  client->context = context;
+  return client;
+}
+
+void memory_governor_charge(memory_client_t* client, size_t bytes) {
+  if (client == NULL || bytes == 0) return;
+
+  update_max(&client->held_max, client->held += bytes);
+  update_max(&total_held_max, total_held += bytes);
+  update_pressure();
+}
+
+void memory_governor_release(memory_client_t* client, size_t bytes) {
+  if (client == NULL || bytes == 0) return;
+
+  client->held -= bytes;
+  total_held -= bytes;
+  update_pressure();
+}
+
+size_t memory_governor_held(const memory_client_t* client) {
+  return client != NULL ? client->held.load() : 0;
+}
+
+memory_pressure_t memory_governor_pressure(void) {
+  return static_cast<memory_pressure_t>(current_pressure.load());
+}
+
+void memory_governor_set_budget(size_t bytes) {
+  // The property must not override the budget later on
+  std::call_once(budget_flag, [] {});
+  budget = bytes;
+  update_pressure();
+}
+
+size_t memory_governor_scale(size_t watermark, size_t minimum,
+                             memory_pressure_t pressure) {
+  size_t scaled = watermark;
+  if (pressure == MEMORY_PRESSURE_MODERATE)
+    scaled = watermark / 2;
+  else if (pressure == MEMORY_PRESSURE_CRITICAL)
+    scaled = watermark / 4;
+  return (scaled < minimum) ? minimum : scaled;
+}
+
+void memory_governor_debug_dump(int fd) {
+  std::call_once(budget_flag, read_budget);
+
+  dprintf(fd, "\nBluetooth Memory Governor:\n");
+  dprintf(fd, "  Budget: %zu bytes (0 for none)\n", budget.load());
+  dprintf(fd, "  Held: %zu bytes (max %zu)\n", total_held.load(),
+          total_held_max.load());
+  dprintf(fd, "  Pressure: %d (%zu changes)\n", current_pressure.load(),
+          pressure_changes.load());
+
+  std::lock_guard<std::mutex> lock(governor_lock);
+  for (size_t i = 0; i < client_count; i++) {
+    dprintf(fd, "  %-24s %10zu bytes (max %zu)\n", clients[i].name,
+            clients[i].held.load(), clients[i].held_max.load());
+  }
+}
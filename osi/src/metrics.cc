@@ -19,6 +19,7 @@
 
 #include <unistd.h>
 #include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <chrono>
 #include <cstdint>
@@ -29,6 +30,7 @@
 #include <base/base64.h>
 #include <base/logging.h>
 
+#include "osi/include/compat.h"
 #include "osi/include/leaky_bonded_queue.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
@@ -223,6 +225,94 @@ static BluetoothSession_DisconnectReasonType get_disconnect_reason_type(
   }
 }
 
+/*
+ * Bounded queue of plain records, filled by any number of threads without
+ * lock or allocation and emptied by a single consumer. Each slot carries a
+ * sequence number telling whether it is free for the producer of a given
+ * position or filled for the consumer.
+ */
+template <typename T, size_t N>
+class RecordBuffer {
+ public:
+  RecordBuffer() : head_(0), tail_(0) {
+    for (size_t i = 0; i < N; i++) slots_[i].sequence = i;
+  }
+
+  /*
+   * Copy |record| into the buffer, returns false if it is full
+   */
+  bool Push(const T& record) {
+    size_t position = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      Slot& slot = slots_[position % N];
+      size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      if (sequence == position) {
+        if (tail_.compare_exchange_weak(position, position + 1,
+                                        std::memory_order_relaxed)) {
+          slot.record = record;
+          slot.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (sequence < position) {
+        return false;
+      } else {
+        position = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /*
+   * Move the oldest record into |record|, returns false if there is none.
+   * Only one thread at a time may call it.
+   */
+  bool Pop(T* record) {
+    size_t position = head_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[position % N];
+    if (slot.sequence.load(std::memory_order_acquire) != position + 1)
+      return false;
+    *record = slot.record;
+    head_.store(position + 1, std::memory_order_relaxed);
+    slot.sequence.store(position + N, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T record;
+  };
+  Slot slots_[N];
+  std::atomic<size_t> head_;
+  std::atomic<size_t> tail_;
+};
+
+/*
+ * Events as logged, turned into protobuf objects by Build()
+ */
+static const size_t kMaxRecordStringLength = 64;
+
+struct PairRecord {
+  uint32_t disconnect_reason;
+  uint64_t timestamp_ms;
+  uint32_t device_class;
+  device_type_t device_type;
+};
+
+struct WakeRecord {
+  wake_event_type_t type;
+  char requestor[kMaxRecordStringLength];
+  char name[kMaxRecordStringLength];
+  uint64_t timestamp_ms;
+};
+
+struct ScanRecord {
+  bool start;
+  char initiator[kMaxRecordStringLength];
+  scan_tech_t type;
+  uint32_t results;
+  uint64_t timestamp_ms;
+};
+
 struct BluetoothMetricsLogger::impl {
   impl(size_t max_bluetooth_session, size_t max_pair_event,
        size_t max_wake_event, size_t max_scan_event)
@@ -235,6 +325,61 @@ struct BluetoothMetricsLogger::impl {
     bluetooth_session_ = nullptr;
     bluetooth_session_start_time_ms_ = 0;
     a2dp_session_metrics_ = A2dpSessionMetrics();
+    a2dp_session_logged_ = false;
+  }
+
+  /*
+   * Turn the logged events into protobuf objects in the event queues. Must be
+   * called with bluetooth_log_lock_ held.
+   */
+  void DrainRecords() {
+    PairRecord pair;
+    while (pair_records_.Pop(&pair)) {
+      PairEvent* event = new PairEvent();
+      DeviceInfo* info = event->mutable_device_paired_with();
+      info->set_device_class(pair.device_class);
+      info->set_device_type(get_device_type(pair.device_type));
+      event->set_disconnect_reason(pair.disconnect_reason);
+      event->set_event_time_millis(pair.timestamp_ms);
+      pair_event_queue_->Enqueue(event);
+      bluetooth_log_->set_num_pair_event(bluetooth_log_->num_pair_event() + 1);
+    }
+    WakeRecord wake;
+    while (wake_records_.Pop(&wake)) {
+      WakeEvent* event = new WakeEvent();
+      event->set_wake_event_type(get_wake_event_type(wake.type));
+      event->set_requestor(wake.requestor);
+      event->set_name(wake.name);
+      event->set_event_time_millis(wake.timestamp_ms);
+      wake_event_queue_->Enqueue(event);
+      bluetooth_log_->set_num_wake_event(bluetooth_log_->num_wake_event() + 1);
+    }
+    ScanRecord scan;
+    while (scan_records_.Pop(&scan)) {
+      ScanEvent* event = new ScanEvent();
+      if (scan.start) {
+        event->set_scan_event_type(ScanEvent::SCAN_EVENT_START);
+      } else {
+        event->set_scan_event_type(ScanEvent::SCAN_EVENT_STOP);
+      }
+      event->set_initiator(scan.initiator);
+      event->set_scan_technology_type(get_scan_tech_type(scan.type));
+      event->set_number_results(scan.results);
+      event->set_event_time_millis(scan.timestamp_ms);
+      scan_event_queue_->Enqueue(event);
+      bluetooth_log_->set_num_scan_event(bluetooth_log_->num_scan_event() + 1);
+    }
+  }
+
+  /*
+   * Add |record| to |records|, draining them first if they are full
+   */
+  template <typename T, size_t N>
+  void PushRecord(RecordBuffer<T, N>* records, const T& record) {
+    while (!records->Push(record)) {
+      std::lock_guard<std::recursive_mutex> lock(bluetooth_log_lock_);
+      DrainRecords();
+    }
   }
 
   /* Bluetooth log lock protected */
@@ -245,12 +390,17 @@ struct BluetoothMetricsLogger::impl {
   BluetoothSession* bluetooth_session_;
   uint64_t bluetooth_session_start_time_ms_;
   A2dpSessionMetrics a2dp_session_metrics_;
+  bool a2dp_session_logged_;
   std::recursive_mutex bluetooth_session_lock_;
   /* End bluetooth session lock protected */
   std::unique_ptr<LeakyBondedQueue<BluetoothSession>> bt_session_queue_;
   std::unique_ptr<LeakyBondedQueue<PairEvent>> pair_event_queue_;
   std::unique_ptr<LeakyBondedQueue<WakeEvent>> wake_event_queue_;
   std::unique_ptr<LeakyBondedQueue<ScanEvent>> scan_event_queue_;
+  /* Events logged since the last Build() */
+  RecordBuffer<PairRecord, 16> pair_records_;
+  RecordBuffer<WakeRecord, 256> wake_records_;
+  RecordBuffer<ScanRecord, 16> scan_records_;
 };
 
 BluetoothMetricsLogger::BluetoothMetricsLogger()
@@ -261,57 +411,37 @@ void BluetoothMetricsLogger::LogPairEvent(uint32_t disconnect_reason,
                                           uint64_t timestamp_ms,
                                           uint32_t device_class,
                                           device_type_t device_type) {
-  PairEvent* event = new PairEvent();
-  DeviceInfo* info = event->mutable_device_paired_with();
-  info->set_device_class(device_class);
-  info->set_device_type(get_device_type(device_type));
-  event->set_disconnect_reason(disconnect_reason);
-  event->set_event_time_millis(timestamp_ms);
-  pimpl_->pair_event_queue_->Enqueue(event);
-  {
-    std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_log_lock_);
-    pimpl_->bluetooth_log_->set_num_pair_event(
-        pimpl_->bluetooth_log_->num_pair_event() + 1);
-  }
+  PairRecord record;
+  record.disconnect_reason = disconnect_reason;
+  record.timestamp_ms = timestamp_ms;
+  record.device_class = device_class;
+  record.device_type = device_type;
+  pimpl_->PushRecord(&pimpl_->pair_records_, record);
 }
 
 void BluetoothMetricsLogger::LogWakeEvent(wake_event_type_t type,
                                           const std::string& requestor,
                                           const std::string& name,
                                           uint64_t timestamp_ms) {
-  WakeEvent* event = new WakeEvent();
-  event->set_wake_event_type(get_wake_event_type(type));
-  event->set_requestor(requestor);
-  event->set_name(name);
-  event->set_event_time_millis(timestamp_ms);
-  pimpl_->wake_event_queue_->Enqueue(event);
-  {
-    std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_log_lock_);
-    pimpl_->bluetooth_log_->set_num_wake_event(
-        pimpl_->bluetooth_log_->num_wake_event() + 1);
-  }
+  WakeRecord record;
+  record.type = type;
+  strlcpy(record.requestor, requestor.c_str(), sizeof(record.requestor));
+  strlcpy(record.name, name.c_str(), sizeof(record.name));
+  record.timestamp_ms = timestamp_ms;
+  pimpl_->PushRecord(&pimpl_->wake_records_, record);
 }
 
 void BluetoothMetricsLogger::LogScanEvent(bool start,
                                           const std::string& initator,
                                           scan_tech_t type, uint32_t results,
                                           uint64_t timestamp_ms) {
-  ScanEvent* event = new ScanEvent();
-  if (start) {
-    event->set_scan_event_type(ScanEvent::SCAN_EVENT_START);
-  } else {
-    event->set_scan_event_type(ScanEvent::SCAN_EVENT_STOP);
-  }
-  event->set_initiator(initator);
-  event->set_scan_technology_type(get_scan_tech_type(type));
-  event->set_number_results(results);
-  event->set_event_time_millis(timestamp_ms);
-  pimpl_->scan_event_queue_->Enqueue(event);
-  {
-    std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_log_lock_);
-    pimpl_->bluetooth_log_->set_num_scan_event(
-        pimpl_->bluetooth_log_->num_scan_event() + 1);
-  }
+  ScanRecord record;
+  record.start = start;
+  strlcpy(record.initiator, initator.c_str(), sizeof(record.initiator));
+  record.type = type;
+  record.results = results;
+  record.timestamp_ms = timestamp_ms;
+  pimpl_->PushRecord(&pimpl_->scan_records_, record);
 }
 
 void BluetoothMetricsLogger::LogBluetoothSessionStart(
@@ -339,6 +469,7 @@ void BluetoothMetricsLogger::LogBluetoothSessionEnd(
   if (timestamp_ms == 0) {
     timestamp_ms = time_get_os_boottime_ms();
   }
+  FillA2dpSession();
   int64_t session_duration_sec =
       (timestamp_ms - pimpl_->bluetooth_session_start_time_ms_) / 1000;
   pimpl_->bluetooth_session_->set_session_duration_sec(session_duration_sec);
@@ -346,6 +477,7 @@ void BluetoothMetricsLogger::LogBluetoothSessionEnd(
       get_disconnect_reason_type(disconnect_reason));
   pimpl_->bt_session_queue_->Enqueue(pimpl_->bluetooth_session_);
   pimpl_->bluetooth_session_ = nullptr;
+  pimpl_->a2dp_session_logged_ = false;
   {
     std::lock_guard<std::recursive_mutex> log_lock(pimpl_->bluetooth_log_lock_);
     pimpl_->bluetooth_log_->set_num_bluetooth_session(
@@ -373,8 +505,17 @@ void BluetoothMetricsLogger::LogA2dpSession(
     LogBluetoothSessionStart(CONNECTION_TECHNOLOGY_TYPE_BREDR, 0);
     LogBluetoothSessionDeviceInfo(BTM_COD_MAJOR_AUDIO, DEVICE_TYPE_BREDR);
   }
-  // Accumulate metrics
+  // Accumulate metrics, the protobuf object is only filled when the session
+  // is queued
   pimpl_->a2dp_session_metrics_.Update(a2dp_session_metrics);
+  pimpl_->a2dp_session_logged_ = true;
+}
+
+void BluetoothMetricsLogger::FillA2dpSession() {
+  std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_session_lock_);
+  if (pimpl_->bluetooth_session_ == nullptr || !pimpl_->a2dp_session_logged_) {
+    return;
+  }
   // Get or allocate new A2DP session object
   A2DPSession* a2dp_session =
       pimpl_->bluetooth_session_->mutable_a2dp_session();
@@ -438,12 +579,14 @@ void BluetoothMetricsLogger::CutoffSession() {
     pimpl_->bluetooth_session_ = new_bt_session;
     pimpl_->bluetooth_session_start_time_ms_ = time_get_os_boottime_ms();
     pimpl_->a2dp_session_metrics_ = A2dpSessionMetrics();
+    pimpl_->a2dp_session_logged_ = false;
   }
 }
 
 void BluetoothMetricsLogger::Build() {
   std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_log_lock_);
   CutoffSession();
+  pimpl_->DrainRecords();
   BluetoothLog* bluetooth_log = pimpl_->bluetooth_log_;
   while (!pimpl_->bt_session_queue_->Empty() &&
          static_cast<size_t>(bluetooth_log->session_size()) <=
@@ -485,6 +628,7 @@ void BluetoothMetricsLogger::ResetSession() {
   }
   pimpl_->bluetooth_session_start_time_ms_ = 0;
   pimpl_->a2dp_session_metrics_ = A2dpSessionMetrics();
+  pimpl_->a2dp_session_logged_ = false;
 }
 
 void BluetoothMetricsLogger::ResetLog() {
@@ -494,6 +638,11 @@ void BluetoothMetricsLogger::ResetLog() {
 
 void BluetoothMetricsLogger::Reset() {
   ResetSession();
+  {
+    // Drop the events not built yet
+    std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_log_lock_);
+    pimpl_->DrainRecords();
+  }
   ResetLog();
   pimpl_->bt_session_queue_->Clear();
   pimpl_->pair_event_queue_->Clear();
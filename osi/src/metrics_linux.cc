@@ -197,6 +197,10 @@ void BluetoothMetricsLogger::Build() {
   // TODO(siyuanh): Implement for linux
 }
 
+void BluetoothMetricsLogger::FillA2dpSession() {
+  // TODO(siyuanh): Implement for linux
+}
+
 void BluetoothMetricsLogger::Reset() {
   // TODO(siyuanh): Implement for linux
 }
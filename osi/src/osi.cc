@@ -51,3 +51,25 @@ int osi_rand(void) {
 
   return rand;
 }
+
+bool osi_rand_bytes(void* buf, size_t len) {
+  int rand_fd = open(RANDOM_PATH, O_RDONLY);
+  if (rand_fd == INVALID_FD) {
+    LOG_ERROR(LOG_TAG, "%s can't open rand fd %s: %s ", __func__, RANDOM_PATH,
+              strerror(errno));
+    return false;
+  }
+
+  size_t total = 0;
+  while (total < len) {
+    ssize_t read_bytes;
+    OSI_NO_INTR(read_bytes =
+                    read(rand_fd, static_cast<uint8_t*>(buf) + total,
+                         len - total));
+    if (read_bytes <= 0) break;
+    total += read_bytes;
+  }
+  close(rand_fd);
+
+  return total == len;
+}
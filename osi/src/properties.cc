@@ -17,6 +17,9 @@
  ******************************************************************************/
 
 #include <string.h>
+#if !defined(OS_GENERIC)
+#include <sys/system_properties.h>
+#endif
 
 #include "osi/include/properties.h"
 #include "hardware/vendor.h"
@@ -28,6 +31,18 @@
 
 bt_property_callout_t* property_callouts = NULL;
 
+// Bumped by every change this process makes, and by a refresh
+static std::atomic<uint32_t> property_generation(0);
+
+// Changes whenever a property may have changed
+static uint32_t osi_property_serial(void) {
+  uint32_t serial = property_generation.load(std::memory_order_relaxed);
+#if !defined(OS_GENERIC)
+  serial += __system_property_area_serial();
+#endif
+  return serial;
+}
+
 int osi_property_get(const char* key, char* value, const char* default_value) {
 #if defined(OS_GENERIC)
   #if (OFF_TARGET_TEST_ENABLED == TRUE)
@@ -53,6 +68,7 @@ int osi_property_get(const char* key, char* value, const char* default_value) {
 }
 
 int osi_property_set(const char* key, const char* value) {
+  property_generation.fetch_add(1, std::memory_order_relaxed);
 #if defined(OS_GENERIC)
   #if (OFF_TARGET_TEST_ENABLED == TRUE)
     return property_set(key, value);
@@ -80,4 +96,42 @@ if(property_callouts)
 
 void set_prop_callouts(bt_property_callout_t* callouts) {
   property_callouts = callouts;
+  osi_property_cache_refresh();
+}
+
+// Returns the value of |property|, read again if the properties changed.
+// Racing readers may both read the property, to the same result.
+static int32_t osi_cached_property_get(osi_cached_property_t* property,
+                                       bool is_bool) {
+  uint32_t serial = osi_property_serial();
+  if (property->read.load(std::memory_order_acquire) &&
+      property->serial.load(std::memory_order_relaxed) == serial)
+    return property->value.load(std::memory_order_relaxed);
+
+  int32_t value;
+  if (is_bool) {
+    char buf[PROPERTY_VALUE_MAX] = {0};
+    value = property->default_value ? 1 : 0;
+    if (osi_property_get(property->key, buf, NULL) > 0)
+      value = (strncmp(buf, "true", 4) == 0) ? 1 : 0;
+  } else {
+    value = osi_property_get_int32(property->key, property->default_value);
+  }
+
+  property->value.store(value, std::memory_order_relaxed);
+  property->serial.store(serial, std::memory_order_relaxed);
+  property->read.store(true, std::memory_order_release);
+  return value;
+}
+
+bool osi_cached_property_get_bool(osi_cached_property_t* property) {
+  return osi_cached_property_get(property, true) != 0;
+}
+
+int32_t osi_cached_property_get_int32(osi_cached_property_t* property) {
+  return osi_cached_property_get(property, false);
+}
+
+void osi_property_cache_refresh(void) {
+  property_generation.fetch_add(1, std::memory_order_relaxed);
 }
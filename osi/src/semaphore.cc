@@ -95,6 +95,37 @@ bool semaphore_try_wait(semaphore_t* semaphore) {
   return rc;
 }
 
+size_t semaphore_try_wait_many(semaphore_t* semaphore, size_t count) {
+  CHECK(semaphore != NULL);
+  CHECK(semaphore->fd != INVALID_FD);
+
+  if (count == 0) return 0;
+
+  int flags = fcntl(semaphore->fd, F_GETFL);
+  if (flags == -1) {
+    LOG_ERROR(LOG_TAG, "%s unable to get flags for semaphore fd: %s", __func__,
+              strerror(errno));
+    return 0;
+  }
+  if (fcntl(semaphore->fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+    LOG_ERROR(LOG_TAG, "%s unable to set O_NONBLOCK for semaphore fd: %s",
+              __func__, strerror(errno));
+    return 0;
+  }
+
+  // Each read of an EFD_SEMAPHORE eventfd decrements the value by one, but
+  // the descriptor flags only need to be toggled once for the whole batch.
+  size_t acquired = 0;
+  eventfd_t value;
+  while (acquired < count && eventfd_read(semaphore->fd, &value) == 0)
+    acquired++;
+
+  if (fcntl(semaphore->fd, F_SETFL, flags) == -1)
+    LOG_ERROR(LOG_TAG, "%s unable to restore flags for semaphore fd: %s",
+              __func__, strerror(errno));
+  return acquired;
+}
+
 void semaphore_post(semaphore_t* semaphore) {
   CHECK(semaphore != NULL);
   CHECK(semaphore->fd != INVALID_FD);
@@ -104,6 +135,17 @@ void semaphore_post(semaphore_t* semaphore) {
               strerror(errno));
 }
 
+void semaphore_post_many(semaphore_t* semaphore, size_t count) {
+  CHECK(semaphore != NULL);
+  CHECK(semaphore->fd != INVALID_FD);
+
+  if (count == 0) return;
+
+  if (eventfd_write(semaphore->fd, (eventfd_t)count) == -1)
+    LOG_ERROR(LOG_TAG, "%s unable to post to semaphore: %s", __func__,
+              strerror(errno));
+}
+
 int semaphore_get_fd(const semaphore_t* semaphore) {
   CHECK(semaphore != NULL);
   CHECK(semaphore->fd != INVALID_FD);
@@ -0,0 +1,185 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_task_stats"
+
+#include "osi/include/task_stats.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <base/bind.h>
+
+#include "osi/include/time.h"
+
+// Number of log2 buckets of the histograms, the last one holds everything
+// from 2^(TASK_STATS_BUCKETS - 2) us (about 0.5 s)
+#define TASK_STATS_BUCKETS 21
+
+// Number of posting sites dumped per thread
+#define TASK_STATS_TOP_SITES 10
+
+typedef struct {
+  const void* site;
+  const char* function_name;  // NULL when the site is only a function pointer
+  const char* file_name;
+  int line_number;
+  size_t count;
+  uint64_t total_run_us;
+  uint64_t max_run_us;
+  uint64_t max_delay_us;
+} task_site_stats_t;
+
+typedef struct {
+  size_t count;
+  uint64_t max_delay_us;
+  uint64_t max_run_us;
+  size_t delay_histogram[TASK_STATS_BUCKETS];
+  size_t run_histogram[TASK_STATS_BUCKETS];
+  std::map<const void*, task_site_stats_t> sites;
+} task_thread_stats_t;
+
+static std::atomic<bool> enabled(false);
+static std::mutex stats_mutex;
+static std::map<std::string, task_thread_stats_t, std::less<>> thread_stats;
+
+static size_t bucket_of(uint64_t duration_us) {
+  size_t bucket = 0;
+  while (duration_us > 0 && bucket < TASK_STATS_BUCKETS - 1) {
+    duration_us >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+static void run_task(const char* thread_name, const base::Location& from_here,
+                     uint64_t posted_us, const base::Closure& task) {
+  uint64_t start_us = time_get_os_boottime_us();
+  task.Run();
+  task_stats_record(thread_name, from_here.program_counter(), &from_here,
+                    posted_us, start_us, time_get_os_boottime_us());
+}
+
+void task_stats_set_enabled(bool enable) { enabled = enable; }
+
+bool task_stats_enabled(void) {
+  return enabled.load(std::memory_order_relaxed);
+}
+
+base::Closure task_stats_wrap(const char* thread_name,
+                              const base::Location& from_here,
+                              const base::Closure& task) {
+  if (!task_stats_enabled()) return task;
+
+  return base::Bind(&run_task, thread_name, from_here,
+                    time_get_os_boottime_us(), task);
+}
+
+void task_stats_record(const char* thread_name, const void* site,
+                       const base::Location* from_here, uint64_t posted_us,
+                       uint64_t start_us, uint64_t end_us) {
+  uint64_t delay_us = start_us - posted_us;
+  uint64_t run_us = end_us - start_us;
+
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  auto it = thread_stats.find(thread_name);
+  if (it == thread_stats.end())
+    it = thread_stats.emplace(thread_name, task_thread_stats_t()).first;
+  task_thread_stats_t& stats = it->second;
+
+  stats.count++;
+  stats.max_delay_us = std::max(stats.max_delay_us, delay_us);
+  stats.max_run_us = std::max(stats.max_run_us, run_us);
+  stats.delay_histogram[bucket_of(delay_us)]++;
+  stats.run_histogram[bucket_of(run_us)]++;
+
+  task_site_stats_t& site_stats = stats.sites[site];
+  if (site_stats.count == 0) {
+    site_stats.site = site;
+    if (from_here != NULL) {
+      site_stats.function_name = from_here->function_name();
+      site_stats.file_name = from_here->file_name();
+      site_stats.line_number = from_here->line_number();
+    }
+  }
+  site_stats.count++;
+  site_stats.total_run_us += run_us;
+  site_stats.max_run_us = std::max(site_stats.max_run_us, run_us);
+  site_stats.max_delay_us = std::max(site_stats.max_delay_us, delay_us);
+}
+
+static void dump_histogram(int fd, const char* title,
+                           const size_t* histogram) {
+  dprintf(fd, "    %s:", title);
+  for (size_t i = 0; i < TASK_STATS_BUCKETS; i++) {
+    if (histogram[i] == 0) continue;
+    // Bucket i holds the durations below 2^i us
+    if (i == TASK_STATS_BUCKETS - 1)
+      dprintf(fd, " >=%" PRIu64 "us:%zu", (uint64_t)1 << (i - 1),
+              histogram[i]);
+    else
+      dprintf(fd, " <%" PRIu64 "us:%zu", (uint64_t)1 << i, histogram[i]);
+  }
+  dprintf(fd, "\n");
+}
+
+void task_stats_dump(int fd) {
+  dprintf(fd, "\nTask latency (%s):\n",
+          task_stats_enabled() ? "enabled" : "disabled");
+
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  for (const auto& entry : thread_stats) {
+    const task_thread_stats_t& stats = entry.second;
+    dprintf(fd,
+            "  Thread %s: %zu tasks, max queueing delay %" PRIu64
+            " us, max run time %" PRIu64 " us\n",
+            entry.first.c_str(), stats.count, stats.max_delay_us,
+            stats.max_run_us);
+    dump_histogram(fd, "Queueing delay", stats.delay_histogram);
+    dump_histogram(fd, "Run time      ", stats.run_histogram);
+
+    std::vector<const task_site_stats_t*> sites;
+    for (const auto& site : stats.sites) sites.push_back(&site.second);
+    size_t top = std::min<size_t>(TASK_STATS_TOP_SITES, sites.size());
+    std::partial_sort(
+        sites.begin(), sites.begin() + top, sites.end(),
+        [](const task_site_stats_t* a, const task_site_stats_t* b) {
+          return a->total_run_us > b->total_run_us;
+        });
+
+    dprintf(fd, "    Count    Total us   Max run us Max delay us  Site\n");
+    for (size_t i = 0; i < top; i++) {
+      const task_site_stats_t* site = sites[i];
+      dprintf(fd, "    %-8zu %-10" PRIu64 " %-12" PRIu64 " %-12" PRIu64 "  ",
+              site->count, site->total_run_us, site->max_run_us,
+              site->max_delay_us);
+      if (site->function_name != NULL)
+        dprintf(fd, "%s@%s:%d\n", site->function_name, site->file_name,
+                site->line_number);
+      else
+        dprintf(fd, "%p\n", site->site);
+    }
+  }
+}
@@ -21,11 +21,13 @@
 #include "osi/include/thread.h"
 
 #include <atomic>
+#include <mutex>
 
 #include <base/logging.h>
 #include <errno.h>
 #include <malloc.h>
 #include <pthread.h>
+#include <sched.h>
 #include <string.h>
 #include <sys/prctl.h>
 #include <sys/resource.h>
@@ -38,6 +40,8 @@
 #include "osi/include/log.h"
 #include "osi/include/reactor.h"
 #include "osi/include/semaphore.h"
+#include "osi/include/task_stats.h"
+#include "osi/include/time.h"
 
 struct thread_t {
   std::atomic_bool is_joined{false};
@@ -57,13 +61,33 @@ struct start_arg {
 typedef struct {
   thread_fn func;
   void* context;
+  uint64_t posted_us;  // 0 unless the task latency instrumentation is on
 } work_item_t;
 
+// Scheduling policy set for the threads of a name
+typedef struct {
+  char name[THREAD_NAME_MAX + 1];
+  thread_policy_t policy;
+} named_policy_t;
+
+#define MAX_THREAD_POLICIES 16
+
+static named_policy_t thread_policies[MAX_THREAD_POLICIES];
+static size_t thread_policy_count;
+static std::mutex thread_policy_mutex;
+
+static bool get_thread_policy(const char* name, thread_policy_t* policy);
+static void apply_thread_policy(const thread_t* thread);
 static void* run_thread(void* start_arg);
-static void work_queue_read_cb(void* context);
+static void work_queue_read_cb(fixed_queue_t* queue, void** items,
+                               size_t count, void* context);
+static void run_work_item(thread_t* thread, work_item_t* item);
 
 static const size_t DEFAULT_WORK_QUEUE_CAPACITY = 128;
 
+// Maximum number of work items dispatched per reactor wakeup.
+static const size_t WORK_QUEUE_BATCH_SIZE = 16;
+
 thread_t* thread_new_sized(const char* name, size_t work_queue_capacity) {
   CHECK(name != NULL);
   CHECK(work_queue_capacity != 0);
@@ -139,6 +163,7 @@ bool thread_post(thread_t* thread, thread_fn func, void* context) {
   work_item_t* item = (work_item_t*)osi_malloc(sizeof(work_item_t));
   item->func = func;
   item->context = context;
+  item->posted_us = task_stats_enabled() ? time_get_os_boottime_us() : 0;
   fixed_queue_enqueue(thread->work_queue, item);
   return true;
 }
@@ -151,6 +176,13 @@ void thread_stop(thread_t* thread) {
 bool thread_set_priority(thread_t* thread, int priority) {
   if (!thread) return false;
 
+  thread_policy_t policy;
+  if (get_thread_policy(thread->name, &policy) && policy.sched_class >= 0) {
+    LOG_INFO(LOG_TAG, "%s keeping the configured policy of %s", __func__,
+             thread->name);
+    return true;
+  }
+
   const int rc = setpriority(PRIO_PROCESS, thread->tid, priority);
   if (rc < 0) {
     LOG_ERROR(LOG_TAG,
@@ -165,6 +197,13 @@ bool thread_set_priority(thread_t* thread, int priority) {
 bool thread_set_rt_priority(thread_t* thread, int priority) {
   if (!thread) return false;
 
+  thread_policy_t policy;
+  if (get_thread_policy(thread->name, &policy) && policy.sched_class >= 0) {
+    LOG_INFO(LOG_TAG, "%s keeping the configured policy of %s", __func__,
+             thread->name);
+    return true;
+  }
+
   struct sched_param rt_params;
   rt_params.sched_priority = priority;
 
@@ -179,6 +218,83 @@ bool thread_set_rt_priority(thread_t* thread, int priority) {
   return true;
 }
 
+bool thread_set_policy(const char* name, const thread_policy_t* policy) {
+  CHECK(name != NULL);
+
+  std::lock_guard<std::mutex> lock(thread_policy_mutex);
+  size_t i = 0;
+  while (i < thread_policy_count &&
+         strncmp(thread_policies[i].name, name, THREAD_NAME_MAX) != 0)
+    i++;
+
+  if (policy == NULL) {
+    if (i < thread_policy_count)
+      thread_policies[i] = thread_policies[--thread_policy_count];
+    return true;
+  }
+
+  if (i == thread_policy_count) {
+    if (thread_policy_count == MAX_THREAD_POLICIES) {
+      LOG_ERROR(LOG_TAG, "%s no room for the policy of %s", __func__, name);
+      return false;
+    }
+    strncpy(thread_policies[i].name, name, THREAD_NAME_MAX);
+    thread_policies[i].name[THREAD_NAME_MAX] = '\0';
+    thread_policy_count++;
+  }
+  thread_policies[i].policy = *policy;
+  return true;
+}
+
+static bool get_thread_policy(const char* name, thread_policy_t* policy) {
+  std::lock_guard<std::mutex> lock(thread_policy_mutex);
+  for (size_t i = 0; i < thread_policy_count; i++) {
+    if (strncmp(thread_policies[i].name, name, THREAD_NAME_MAX) == 0) {
+      *policy = thread_policies[i].policy;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Applies the policy set for the name of |thread|, if any, to |thread|.
+static void apply_thread_policy(const thread_t* thread) {
+  thread_policy_t policy;
+  if (!get_thread_policy(thread->name, &policy)) return;
+
+  if (policy.sched_class >= 0) {
+    struct sched_param params;
+    params.sched_priority =
+        (policy.sched_class == SCHED_OTHER) ? 0 : policy.priority;
+    if (sched_setscheduler(thread->tid, policy.sched_class, &params) != 0) {
+      LOG_ERROR(LOG_TAG, "%s unable to set scheduler %d priority %d for %s: %s",
+                __func__, policy.sched_class, policy.priority, thread->name,
+                strerror(errno));
+    } else if (policy.sched_class == SCHED_OTHER &&
+               setpriority(PRIO_PROCESS, thread->tid, policy.priority) != 0) {
+      LOG_ERROR(LOG_TAG, "%s unable to set priority %d for %s: %s", __func__,
+                policy.priority, thread->name, strerror(errno));
+    }
+  }
+
+  if (policy.cpu_mask != 0) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; cpu++) {
+      if (policy.cpu_mask & (1ULL << cpu)) CPU_SET(cpu, &cpus);
+    }
+    if (sched_setaffinity(thread->tid, sizeof(cpus), &cpus) != 0) {
+      LOG_ERROR(LOG_TAG, "%s unable to set CPU mask 0x%llx for %s: %s",
+                __func__, (unsigned long long)policy.cpu_mask, thread->name,
+                strerror(errno));
+    }
+  }
+
+  LOG_INFO(LOG_TAG, "%s %s: scheduler %d, priority %d, CPU mask 0x%llx",
+           __func__, thread->name, policy.sched_class, policy.priority,
+           (unsigned long long)policy.cpu_mask);
+}
+
 bool thread_is_self(const thread_t* thread) {
   CHECK(thread != NULL);
   return !!pthread_equal(pthread_self(), thread->pthread);
@@ -210,19 +326,18 @@ static void* run_thread(void* start_arg) {
     return NULL;
   }
   thread->tid = gettid();
+  apply_thread_policy(thread);
 
   LOG_INFO(LOG_TAG, "%s: thread id %d, thread name %s started", __func__,
            thread->tid, thread->name);
 
   semaphore_post(start->start_sem);
 
-  int fd = fixed_queue_get_dequeue_fd(thread->work_queue);
-  void* context = thread->work_queue;
-
-  reactor_object_t* work_queue_object =
-      reactor_register(thread->reactor, fd, context, work_queue_read_cb, NULL);
+  fixed_queue_register_dequeue_batch(thread->work_queue, thread->reactor,
+                                     WORK_QUEUE_BATCH_SIZE, work_queue_read_cb,
+                                     thread);
   reactor_start(thread->reactor);
-  reactor_unregister(work_queue_object);
+  fixed_queue_unregister_dequeue(thread->work_queue);
 
   // Make sure we dispatch all queued work items before exiting the thread.
   // This allows a caller to safely tear down by enqueuing a teardown
@@ -231,8 +346,7 @@ static void* run_thread(void* start_arg) {
   work_item_t* item =
       static_cast<work_item_t*>(fixed_queue_try_dequeue(thread->work_queue));
   while (item && count <= fixed_queue_capacity(thread->work_queue)) {
-    item->func(item->context);
-    osi_free(item);
+    run_work_item(thread, item);
     item =
         static_cast<work_item_t*>(fixed_queue_try_dequeue(thread->work_queue));
     ++count;
@@ -246,11 +360,24 @@ static void* run_thread(void* start_arg) {
   return NULL;
 }
 
-static void work_queue_read_cb(void* context) {
-  CHECK(context != NULL);
+static void work_queue_read_cb(UNUSED_ATTR fixed_queue_t* queue, void** items,
+                               size_t count, void* context) {
+  thread_t* thread = static_cast<thread_t*>(context);
+  for (size_t i = 0; i < count; i++) {
+    run_work_item(thread, static_cast<work_item_t*>(items[i]));
+  }
+}
 
-  fixed_queue_t* queue = (fixed_queue_t*)context;
-  work_item_t* item = static_cast<work_item_t*>(fixed_queue_dequeue(queue));
-  item->func(item->context);
+// Runs and frees |item|, recording its latency if it was posted with the
+// task latency instrumentation on.
+static void run_work_item(thread_t* thread, work_item_t* item) {
+  if (item->posted_us == 0) {
+    item->func(item->context);
+  } else {
+    uint64_t start_us = time_get_os_boottime_us();
+    item->func(item->context);
+    task_stats_record(thread->name, (const void*)item->func, NULL,
+                      item->posted_us, start_us, time_get_os_boottime_us());
+  }
   osi_free(item);
 }
@@ -30,8 +30,11 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
 #include <string>
+#include <thread>
 
 #include "base/logging.h"
 #include "osi/include/alarm.h"
@@ -82,12 +85,41 @@ static wakelock_stats_t wakelock_stats;
 // are executed serially.
 static std::mutex stats_mutex;
 
+// Acquisitions of the wakelock made for one reason
+typedef struct {
+  const char* reason;
+  size_t acquired_count;  // Acquisitions made for the reason
+  size_t reused_count;    // Acquisitions served by the lock in its hold-off
+  size_t held_count;      // Acquisitions not released yet
+} wakelock_reason_stats_t;
+
+#define WAKELOCK_MAX_REASONS 8
+
+// This mutex serializes the reference count and the OS lock state. It is
+// taken before |stats_mutex| when both are needed.
+static std::mutex lock_mutex;
+static size_t lock_ref_count;
+static bool os_lock_held;
+static period_ms_t release_holdoff_ms;
+static period_ms_t release_deadline_ms;  // 0 when no release is pending
+static std::condition_variable release_cv;
+static std::thread* release_thread;  // Never destroyed while running
+static bool release_thread_running;
+static size_t os_lock_reuses;
+static wakelock_reason_stats_t reason_stats[WAKELOCK_MAX_REASONS];
+
 static bt_status_t wakelock_acquire_callout(void);
 static bt_status_t wakelock_acquire_native(void);
 static bt_status_t wakelock_release_callout(void);
 static bt_status_t wakelock_release_native(void);
 static void wakelock_initialize(void);
 static void wakelock_initialize_native(void);
+static bool wakelock_acquire_os(void);
+static bool wakelock_release_os(void);
+static void wakelock_release_thread(void);
+static wakelock_reason_stats_t* get_reason_stats(const char* reason);
+static period_ms_t now(void);
+static void dump_wakelock_stats(int fd);
 static void reset_wakelock_stats(void);
 static void update_wakelock_acquired_stats(bt_status_t acquired_status);
 static void update_wakelock_released_stats(bt_status_t released_status);
@@ -99,9 +131,105 @@ void wakelock_set_os_callouts(bt_os_callouts_t* callouts) {
            (is_native) ? "native" : "non-native");
 }
 
-bool wakelock_acquire(void) {
+bool wakelock_acquire(void) { return wakelock_acquire_for("unspecified"); }
+
+bool wakelock_release(void) { return wakelock_release_for("unspecified"); }
+
+bool wakelock_acquire_for(const char* reason) {
+  pthread_once(&initialized, wakelock_initialize);
+
+  std::lock_guard<std::mutex> lock(lock_mutex);
+  wakelock_reason_stats_t* stats = get_reason_stats(reason);
+
+  if (!os_lock_held) {
+    if (!wakelock_acquire_os()) return false;
+    os_lock_held = true;
+  } else if (lock_ref_count == 0) {
+    // Still held in its release hold-off
+    release_deadline_ms = 0;
+    os_lock_reuses++;
+    stats->reused_count++;
+  }
+
+  lock_ref_count++;
+  stats->acquired_count++;
+  stats->held_count++;
+  return true;
+}
+
+bool wakelock_release_for(const char* reason) {
   pthread_once(&initialized, wakelock_initialize);
 
+  std::lock_guard<std::mutex> lock(lock_mutex);
+  if (lock_ref_count == 0) {
+    LOG_WARN(LOG_TAG, "%s %s released a wake lock it did not hold", __func__,
+             reason);
+    return false;
+  }
+
+  wakelock_reason_stats_t* stats = get_reason_stats(reason);
+  if (stats->held_count > 0) stats->held_count--;
+  if (--lock_ref_count > 0) return true;
+
+  if (release_holdoff_ms == 0) {
+    os_lock_held = false;
+    return wakelock_release_os();
+  }
+
+  release_deadline_ms = now() + release_holdoff_ms;
+  if (!release_thread_running) {
+    release_thread_running = true;
+    release_thread = new std::thread(wakelock_release_thread);
+  }
+  release_cv.notify_one();
+  return true;
+}
+
+void wakelock_set_release_holdoff(period_ms_t holdoff_ms) {
+  std::lock_guard<std::mutex> lock(lock_mutex);
+  release_holdoff_ms = holdoff_ms;
+}
+
+// Releases the OS lock once its hold-off passed without a new acquisition
+static void wakelock_release_thread(void) {
+  std::unique_lock<std::mutex> lock(lock_mutex);
+
+  while (release_thread_running) {
+    if (release_deadline_ms == 0) {
+      release_cv.wait(lock);
+      continue;
+    }
+
+    const period_ms_t now_ms = now();
+    if (now_ms < release_deadline_ms) {
+      release_cv.wait_for(
+          lock, std::chrono::milliseconds(release_deadline_ms - now_ms));
+      continue;
+    }
+
+    release_deadline_ms = 0;
+    os_lock_held = false;
+    wakelock_release_os();
+  }
+}
+
+// Returns the statistics of |reason|; reasons past the table size share its
+// last entry.
+// NOTE: must be called with |lock_mutex| held
+static wakelock_reason_stats_t* get_reason_stats(const char* reason) {
+  for (size_t i = 0; i < WAKELOCK_MAX_REASONS - 1; i++) {
+    wakelock_reason_stats_t* stats = &reason_stats[i];
+    if (stats->reason == NULL) stats->reason = reason;
+    if (stats->reason == reason || strcmp(stats->reason, reason) == 0)
+      return stats;
+  }
+
+  wakelock_reason_stats_t* stats = &reason_stats[WAKELOCK_MAX_REASONS - 1];
+  stats->reason = "other";
+  return stats;
+}
+
+static bool wakelock_acquire_os(void) {
   bt_status_t status = BT_STATUS_FAIL;
 
   if (is_native)
@@ -147,9 +275,7 @@ static bt_status_t wakelock_acquire_native(void) {
   return BT_STATUS_SUCCESS;
 }
 
-bool wakelock_release(void) {
-  pthread_once(&initialized, wakelock_initialize);
-
+static bool wakelock_release_os(void) {
   bt_status_t status = BT_STATUS_FAIL;
 
   if (is_native)
@@ -215,10 +341,30 @@ static void wakelock_initialize_native(void) {
 }
 
 void wakelock_cleanup(void) {
-  if(wakelock_stats.is_acquired) {
-    LOG_ERROR(LOG_TAG, "%s releasing wake lock as part of cleanup", __func__);
-    wakelock_release();
+  std::thread* thread = NULL;
+  {
+    std::lock_guard<std::mutex> lock(lock_mutex);
+    if (os_lock_held) {
+      LOG_ERROR(LOG_TAG, "%s releasing wake lock as part of cleanup",
+                __func__);
+      wakelock_release_os();
+      os_lock_held = false;
+    }
+    lock_ref_count = 0;
+    release_holdoff_ms = 0;
+    release_deadline_ms = 0;
+    release_thread_running = false;
+    thread = release_thread;
+    release_thread = NULL;
+    os_lock_reuses = 0;
+    memset(reason_stats, 0, sizeof(reason_stats));
+  }
+  release_cv.notify_one();
+  if (thread != NULL) {
+    thread->join();
+    delete thread;
   }
+
   wake_lock_path.clear();
   wake_unlock_path.clear();
   initialized = PTHREAD_ONCE_INIT;
@@ -332,7 +478,7 @@ static void update_wakelock_released_stats(bt_status_t released_status) {
       system_bt_osi::WAKE_EVENT_RELEASED, "", "", now_ms);
 }
 
-void wakelock_debug_dump(int fd) {
+static void dump_wakelock_stats(int fd) {
   const period_ms_t now_ms = now();
 
   std::lock_guard<std::mutex> lock(stats_mutex);
@@ -377,3 +523,20 @@ void wakelock_debug_dump(int fd) {
       fd, "  Total run time (ms)            : %llu\n",
       (unsigned long long)(now_ms - wakelock_stats.last_reset_timestamp_ms));
 }
+
+void wakelock_debug_dump(int fd) {
+  dump_wakelock_stats(fd);
+
+  std::lock_guard<std::mutex> lock(lock_mutex);
+  dprintf(fd, "  Held acquisitions              : %zu\n", lock_ref_count);
+  dprintf(fd, "  Release hold-off (ms)          : %llu\n",
+          (unsigned long long)release_holdoff_ms);
+  dprintf(fd, "  Acquisitions in hold-off       : %zu\n", os_lock_reuses);
+  for (size_t i = 0; i < WAKELOCK_MAX_REASONS; i++) {
+    const wakelock_reason_stats_t* stats = &reason_stats[i];
+    if (stats->reason == NULL) continue;
+    dprintf(fd, "  %-30s : %zu acquired, %zu in hold-off, %zu held\n",
+            stats->reason, stats->acquired_count, stats->reused_count,
+            stats->held_count);
+  }
+}
@@ -216,6 +216,28 @@ TEST_F(AlarmTest, test_set_short_short) {
   alarm_free(alarm[1]);
 }
 
+TEST_F(AlarmTest, test_set_with_slack_coalesces) {
+  alarm_t* alarm[2] = {alarm_new("alarm_test.test_set_with_slack_coalesces_0"),
+                       alarm_new("alarm_test.test_set_with_slack_coalesces_1")};
+
+  // The first alarm may wait for the second one, so both fire together
+  alarm_set_with_slack(alarm[0], 10, 200, cb, NULL);
+  alarm_set(alarm[1], 100, cb, NULL);
+
+  msleep(10 + EPSILON_MS);
+  EXPECT_EQ(cb_counter, 0);
+  EXPECT_TRUE(alarm_is_scheduled(alarm[0]));
+
+  semaphore_wait(semaphore);
+  semaphore_wait(semaphore);
+
+  EXPECT_EQ(cb_counter, 2);
+  EXPECT_FALSE(WakeLockHeld());
+
+  alarm_free(alarm[0]);
+  alarm_free(alarm[1]);
+}
+
 TEST_F(AlarmTest, test_set_short_long) {
   alarm_t* alarm[2] = {alarm_new("alarm_test.test_set_short_long_0"),
                        alarm_new("alarm_test.test_set_short_long_1")};
@@ -312,6 +334,40 @@ TEST_F(AlarmTest, test_callback_ordering) {
   EXPECT_FALSE(WakeLockHeld());
 }
 
+// Set, restart and cancel many alarms, then let them all expire.
+TEST_F(AlarmTest, test_set_cancel_many_alarms) {
+  const int num_alarms = 1000;
+  alarm_t* alarms[num_alarms];
+
+  for (int i = 0; i < num_alarms; i++) {
+    const std::string alarm_name =
+        "alarm_test.test_set_cancel_many_alarms[" + std::to_string(i) + "]";
+    alarms[i] = alarm_new(alarm_name.c_str());
+  }
+
+  for (int round = 0; round < 10; round++) {
+    for (int i = 0; i < num_alarms; i++)
+      alarm_set(alarms[(i * 373) % num_alarms], 10000 + i, cb, NULL);
+    for (int i = 0; i < num_alarms; i += 2)
+      alarm_set(alarms[(i * 373) % num_alarms], 20000 - i, cb, NULL);
+    for (int i = 0; i < num_alarms; i++)
+      alarm_cancel(alarms[(i * 631) % num_alarms]);
+  }
+
+  for (int i = 0; i < num_alarms; i++)
+    EXPECT_FALSE(alarm_is_scheduled(alarms[i]));
+
+  for (int i = 0; i < num_alarms; i++)
+    alarm_set(alarms[(i * 373) % num_alarms], 100 + i % 10, cb, NULL);
+
+  for (int i = 0; i < num_alarms; i++) semaphore_wait(semaphore);
+  EXPECT_EQ(cb_counter, num_alarms);
+
+  for (int i = 0; i < num_alarms; i++) alarm_free(alarms[i]);
+
+  EXPECT_FALSE(WakeLockHeld());
+}
+
 // Test whether the callbacks are involed in the expected order on a
 // message loop.
 TEST_F(AlarmTest, test_callback_ordering_on_mloop) {
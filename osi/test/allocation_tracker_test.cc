@@ -17,8 +17,12 @@
  ******************************************************************************/
 
 #include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <string>
 
 #include "osi/include/allocation_tracker.h"
+#include "osi/include/allocator.h"
 
 void allocation_tracker_uninit(void);
 
@@ -62,3 +66,33 @@ TEST(AllocationTrackerTest, test_canaries_on) {
 
   free(dummy_allocation);
 }
+
+TEST(AllocationTrackerTest, test_sampling_dump) {
+  static const int site = 0;
+  allocation_tracker_init_sampling(4);
+
+  for (int i = 0; i < 64; i++) allocation_tracker_sample_alloc(40, &site);
+
+  FILE* file = tmpfile();
+  ASSERT_TRUE(file != NULL);
+  osi_allocator_debug_dump(fileno(file));
+  rewind(file);
+  std::string dump;
+  char buffer[256];
+  while (fgets(buffer, sizeof(buffer), file) != NULL) dump += buffer;
+  fclose(file);
+
+  EXPECT_NE(std::string::npos, dump.find("Sampled Allocations (1 in 4"));
+  EXPECT_NE(std::string::npos, dump.find("32-63"));
+
+  // Nothing is reported once sampling stops
+  allocation_tracker_init_sampling(0);
+  file = tmpfile();
+  ASSERT_TRUE(file != NULL);
+  osi_allocator_debug_dump(fileno(file));
+  rewind(file);
+  dump.clear();
+  while (fgets(buffer, sizeof(buffer), file) != NULL) dump += buffer;
+  fclose(file);
+  EXPECT_EQ(std::string::npos, dump.find("Sampled Allocations"));
+}
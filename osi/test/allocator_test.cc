@@ -50,3 +50,57 @@ TEST_F(AllocatorTest, test_osi_strndup) {
   EXPECT_EQ(0, strcmp(str, copy_str));
   osi_free(copy_str);
 }
+
+TEST_F(AllocatorTest, test_osi_pool_malloc_free) {
+  static const size_t sizes[] = {1, 200, 1000, 1700, 4112, 8192};
+  for (size_t size : sizes) {
+    uint8_t* ptr = static_cast<uint8_t*>(osi_pool_malloc(size));
+    ASSERT_TRUE(ptr != NULL);
+    memset(ptr, 0xAB, size);
+    osi_free(ptr);
+  }
+}
+
+TEST_F(AllocatorTest, test_osi_pool_calloc_zeroes) {
+  // Dirty a block first so that the recycled block must be cleared.
+  uint8_t* ptr = static_cast<uint8_t*>(osi_pool_malloc(512));
+  memset(ptr, 0xFF, 512);
+  osi_free(ptr);
+
+  ptr = static_cast<uint8_t*>(osi_pool_calloc(512));
+  for (size_t i = 0; i < 512; i++) EXPECT_EQ(0, ptr[i]);
+  osi_free(ptr);
+}
+
+TEST_F(AllocatorTest, test_osi_pool_exhaustion_falls_back) {
+  static const size_t count = 256;
+  void* ptrs[count];
+  for (size_t i = 0; i < count; i++) {
+    ptrs[i] = osi_pool_malloc(2000);
+    ASSERT_TRUE(ptrs[i] != NULL);
+  }
+  for (size_t i = 0; i < count; i++) osi_free(ptrs[i]);
+}
+
+TEST_F(AllocatorTest, test_osi_ref_shares_pool_buffer) {
+  uint8_t* ptr = static_cast<uint8_t*>(osi_pool_malloc(512));
+  ASSERT_TRUE(ptr != NULL);
+  EXPECT_FALSE(osi_is_shared(ptr));
+
+  EXPECT_EQ(ptr, osi_ref(ptr));
+  EXPECT_TRUE(osi_is_shared(ptr));
+
+  // The first release leaves the buffer to the other holder
+  osi_free(ptr);
+  EXPECT_FALSE(osi_is_shared(ptr));
+  memset(ptr, 0xAB, 512);
+  osi_free(ptr);
+}
+
+TEST_F(AllocatorTest, test_osi_ref_heap_buffer) {
+  void* ptr = osi_malloc(512);
+  EXPECT_EQ(NULL, osi_ref(ptr));
+  EXPECT_FALSE(osi_is_shared(ptr));
+  EXPECT_EQ(0u, osi_pool_capacity(ptr));
+  osi_free(ptr);
+}
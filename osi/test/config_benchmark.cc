@@ -0,0 +1,129 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "osi/include/config.h"
+
+using ::benchmark::State;
+
+static const char CONFIG_FILE[] = "/data/local/tmp/config_benchmark.conf";
+static const char SAVE_FILE[] = "/data/local/tmp/config_benchmark_save.conf";
+
+static constexpr int kNumDevices = 200;
+
+// Keys a bonded device typically has in bt_config.conf
+static const char* const kDeviceKeys[] = {
+    "Timestamp",      "Name",         "DevClass",   "DevType",
+    "AddrType",       "Manufacturer", "LmpVer",     "LmpSubVer",
+    "Service",        "LinkKeyType",  "PinLength",  "LinkKey",
+    "LE_KEY_PENC",    "LE_KEY_PID",   "LE_KEY_PCSRK", "LE_KEY_LENC",
+    "LE_KEY_LCSRK",   "LE_KEY_LID",   "SdpDiVendorId", "SdpDiProductId",
+};
+
+static std::string device_address(int i) {
+  char address[18];
+  snprintf(address, sizeof(address), "00:1a:7d:da:%02x:%02x", i >> 8,
+           i & 0xff);
+  return address;
+}
+
+class BM_Config : public ::benchmark::Fixture {
+ public:
+  void SetUp(State& st) override {
+    FILE* fp = fopen(CONFIG_FILE, "wt");
+    fprintf(fp, "[Info]\nFileSource = Empty\nTimeCreated = 2018-01-01\n\n");
+    fprintf(fp, "[Adapter]\nAddress = 22:22:22:22:22:22\nName = bench\n");
+    for (int i = 0; i < kNumDevices; i++) {
+      std::string address = device_address(i);
+      addresses_.push_back(address);
+      fprintf(fp, "\n[%s]\n", address.c_str());
+      for (const char* key : kDeviceKeys)
+        fprintf(fp, "%s = %08x%08x\n", key, i, (unsigned)strlen(key));
+    }
+    fclose(fp);
+  }
+
+  void TearDown(State& st) override {
+    unlink(CONFIG_FILE);
+    unlink(SAVE_FILE);
+  }
+
+ protected:
+  std::vector<std::string> addresses_;
+};
+
+BENCHMARK_F(BM_Config, load)(State& state) {
+  for (auto _ : state) {
+    config_t* config = config_new(CONFIG_FILE);
+    benchmark::DoNotOptimize(config);
+    config_free(config);
+  }
+}
+
+// Every key of every device, as fetched when restoring the bonded devices
+BENCHMARK_F(BM_Config, get_all_keys)(State& state) {
+  config_t* config = config_new(CONFIG_FILE);
+  for (auto _ : state) {
+    for (const std::string& address : addresses_) {
+      for (const char* key : kDeviceKeys) {
+        benchmark::DoNotOptimize(
+            config_get_string(config, address.c_str(), key, NULL));
+      }
+    }
+  }
+  config_free(config);
+}
+
+// Updating one key of the last device, as done on every property change
+BENCHMARK_F(BM_Config, set_string)(State& state) {
+  config_t* config = config_new(CONFIG_FILE);
+  const char* address = addresses_.back().c_str();
+  for (auto _ : state) {
+    config_set_string(config, address, "Timestamp", "1514764800");
+  }
+  config_free(config);
+}
+
+BENCHMARK_F(BM_Config, save)(State& state) {
+  config_t* config = config_new(CONFIG_FILE);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(config_save(config, SAVE_FILE));
+  }
+  config_free(config);
+}
+
+// Saving after one device was updated, only its section is serialized again
+BENCHMARK_F(BM_Config, save_one_changed)(State& state) {
+  config_t* config = config_new(CONFIG_FILE);
+  const char* address = addresses_.back().c_str();
+  int timestamp = 0;
+  for (auto _ : state) {
+    config_set_int(config, address, "Timestamp", timestamp++);
+    benchmark::DoNotOptimize(config_save(config, SAVE_FILE));
+  }
+  config_free(config);
+}
+
+BENCHMARK_MAIN();
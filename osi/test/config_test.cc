@@ -91,6 +91,29 @@ TEST_F(ConfigTest, config_new_clone) {
   config_free(clone);
 }
 
+TEST_F(ConfigTest, config_new_clone_outlives_source) {
+  config_t* config = config_new(CONFIG_FILE);
+  config_t* clone = config_new_clone(config);
+  config_free(config);
+
+  EXPECT_STREQ("value", config_get_string(clone, CONFIG_DEFAULT_SECTION,
+                                          "first_key", NULL));
+  EXPECT_EQ(0x1436, config_get_int(clone, "DID", "version", 0));
+  EXPECT_TRUE(config_remove_key(clone, "DID", "version"));
+  config_free(clone);
+}
+
+TEST_F(ConfigTest, config_new_long_line) {
+  std::string value(3000, 'x');
+  std::string content = "[Long]\nkey = " + value + "\nother = 1";
+  base::WriteFile(base::FilePath(CONFIG_FILE), content.data(), content.size());
+
+  config_t* config = config_new(CONFIG_FILE);
+  EXPECT_EQ(value, config_get_string(config, "Long", "key", ""));
+  EXPECT_EQ(1, config_get_int(config, "Long", "other", 0));
+  config_free(config);
+}
+
 TEST_F(ConfigTest, config_has_section) {
   config_t* config = config_new(CONFIG_FILE);
   EXPECT_TRUE(config_has_section(config, "DID"));
@@ -165,6 +188,43 @@ TEST_F(ConfigTest, config_remove_key_missing) {
   config_free(config);
 }
 
+TEST_F(ConfigTest, config_remove_and_readd) {
+  config_t* config = config_new(CONFIG_FILE);
+  EXPECT_TRUE(config_remove_key(config, "DID", "productId"));
+  config_set_int(config, "DID", "productId", 0x1300);
+  EXPECT_EQ(config_get_int(config, "DID", "productId", 999), 0x1300);
+  EXPECT_TRUE(config_remove_section(config, "DID"));
+  EXPECT_FALSE(config_remove_key(config, "DID", "version"));
+  config_set_int(config, "DID", "version", 0x1437);
+  EXPECT_EQ(config_get_int(config, "DID", "version", 999), 0x1437);
+  EXPECT_FALSE(config_has_key(config, "DID", "productId"));
+  config_free(config);
+}
+
+TEST_F(ConfigTest, config_many_sections_keep_order) {
+  config_t* config = config_new_empty();
+  char section[32];
+  for (int i = 0; i < 300; i++) {
+    snprintf(section, sizeof(section), "00:11:22:33:%02x:%02x", i >> 8,
+             i & 0xff);
+    config_set_int(config, section, "DevClass", i);
+    config_set_int(config, section, "DevType", i + 1);
+  }
+
+  int i = 0;
+  for (const config_section_node_t* node = config_section_begin(config);
+       node != config_section_end(config); node = config_section_next(node)) {
+    snprintf(section, sizeof(section), "00:11:22:33:%02x:%02x", i >> 8,
+             i & 0xff);
+    EXPECT_STREQ(section, config_section_name(node));
+    EXPECT_EQ(i, config_get_int(config, section, "DevClass", -1));
+    EXPECT_EQ(i + 1, config_get_int(config, section, "DevType", -1));
+    i++;
+  }
+  EXPECT_EQ(300, i);
+  config_free(config);
+}
+
 TEST_F(ConfigTest, config_section_begin) {
   config_t* config = config_new(CONFIG_FILE);
   const config_section_node_t* section = config_section_begin(config);
@@ -202,6 +262,80 @@ TEST_F(ConfigTest, config_save_basic) {
   config_free(config);
 }
 
+static std::string read_file(const char* filename) {
+  std::string contents;
+  EXPECT_TRUE(base::ReadFileToString(base::FilePath(filename), &contents));
+  return contents;
+}
+
+TEST_F(ConfigTest, config_dirty) {
+  config_t* config = config_new(CONFIG_FILE);
+  EXPECT_TRUE(config_is_dirty(config));
+  config_clear_dirty(config);
+
+  config_set_string(config, "DID", "version", "0x1436");
+  EXPECT_FALSE(config_is_dirty(config));
+  EXPECT_FALSE(config_remove_key(config, "DID", "not a key"));
+  EXPECT_FALSE(config_is_dirty(config));
+
+  config_set_string(config, "DID", "version", "0x1437");
+  EXPECT_TRUE(config_is_dirty(config));
+  config_clear_dirty(config);
+
+  EXPECT_TRUE(config_remove_section(config, "DID"));
+  EXPECT_TRUE(config_is_dirty(config));
+  config_free(config);
+}
+
+TEST_F(ConfigTest, config_save_after_modification) {
+  config_t* config = config_new_empty();
+  config_set_string(config, "DID", "recordNumber", "1");
+  config_set_string(config, "DID", "version", "0x1436");
+  config_set_string(config, "Other", "key", "value");
+  EXPECT_TRUE(config_save(config, CONFIG_FILE));
+
+  config_set_string(config, "DID", "version", "0x1437");
+  config_set_string(config, "New", "key", "value");
+  EXPECT_TRUE(config_remove_key(config, "DID", "recordNumber"));
+  EXPECT_TRUE(config_save(config, CONFIG_FILE));
+  std::string saved = read_file(CONFIG_FILE);
+
+  // A clone serializes every section from scratch
+  config_t* clone = config_new_clone(config);
+  EXPECT_TRUE(config_save(clone, CONFIG_FILE));
+  EXPECT_EQ(saved, read_file(CONFIG_FILE));
+
+  config_free(clone);
+  config_free(config);
+}
+
+static bool skip_did(const config_t* config, const char* section) {
+  return strcmp(section, "DID") != 0;
+}
+
+TEST_F(ConfigTest, config_save_filtered) {
+  config_t* config = config_new(CONFIG_FILE);
+  EXPECT_TRUE(config_save_filtered(config, CONFIG_FILE, skip_did));
+  config_free(config);
+
+  config = config_new(CONFIG_FILE);
+  EXPECT_FALSE(config_has_section(config, "DID"));
+  EXPECT_TRUE(config_has_key(config, CONFIG_DEFAULT_SECTION, "first_key"));
+  config_free(config);
+}
+
+TEST_F(ConfigTest, config_save_contents) {
+  config_t* config = config_new(CONFIG_FILE);
+  EXPECT_TRUE(config_save(config, CONFIG_FILE));
+  std::string saved = read_file(CONFIG_FILE);
+
+  std::string contents = config_serialize(config, NULL);
+  EXPECT_EQ(saved, contents);
+  EXPECT_TRUE(config_save_contents(contents, CONFIG_FILE));
+  EXPECT_EQ(saved, read_file(CONFIG_FILE));
+  config_free(config);
+}
+
 TEST_F(ConfigTest, checksum_read) {
   std::string filename = "/data/misc/bluedroid/test.checksum";
   std::string checksum = "0x1234";
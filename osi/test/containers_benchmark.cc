@@ -0,0 +1,144 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "osi/include/array.h"
+#include "osi/include/hash_map_utils.h"
+#include "osi/include/list.h"
+#include "osi/include/ringbuffer.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Items handed to the lists, the lists only store the pointers
+std::vector<uint32_t> items(1024);
+
+bool count_item(void* data, void* context) {
+  (*static_cast<size_t*>(context)) += *static_cast<uint32_t*>(data) & 1;
+  return true;
+}
+
+}  // namespace
+
+// Queue use of a list of |state.range(0)| items, as by the fixed queues:
+// append at the back and remove from the front.
+static void BM_ListAppendRemoveFront(State& state) {
+  size_t length = state.range(0);
+  list_t* list = list_new(NULL);
+  for (size_t i = 0; i < length; i++) list_append(list, &items[i]);
+
+  size_t i = 0;
+  for (auto _ : state) {
+    list_remove(list, list_front(list));
+    list_append(list, &items[i]);
+    i = (i + 1) % length;
+  }
+  state.SetItemsProcessed(state.iterations());
+  list_free(list);
+}
+BENCHMARK(BM_ListAppendRemoveFront)->RangeMultiplier(4)->Range(1, 1024);
+
+// Builds a new list of |state.range(0)| items and frees it
+static void BM_ListNewAppendFree(State& state) {
+  size_t length = state.range(0);
+  for (auto _ : state) {
+    list_t* list = list_new(NULL);
+    for (size_t i = 0; i < length; i++) list_append(list, &items[i]);
+    list_free(list);
+  }
+  state.SetItemsProcessed(state.iterations() * length);
+}
+BENCHMARK(BM_ListNewAppendFree)->RangeMultiplier(4)->Range(1, 1024);
+
+static void BM_ListForeach(State& state) {
+  size_t length = state.range(0);
+  list_t* list = list_new(NULL);
+  for (size_t i = 0; i < length; i++) list_append(list, &items[i]);
+
+  size_t count = 0;
+  for (auto _ : state) {
+    list_foreach(list, count_item, &count);
+    benchmark::DoNotOptimize(count);
+  }
+  state.SetItemsProcessed(state.iterations() * length);
+  list_free(list);
+}
+BENCHMARK(BM_ListForeach)->RangeMultiplier(4)->Range(1, 1024);
+
+// Builds an array of |state.range(0)| values and frees it
+static void BM_ArrayAppendValue(State& state) {
+  size_t length = state.range(0);
+  for (auto _ : state) {
+    array_t* array = array_new(sizeof(uint32_t));
+    for (size_t i = 0; i < length; i++) array_append_value(array, i);
+    benchmark::DoNotOptimize(array_ptr(array));
+    array_free(array);
+  }
+  state.SetItemsProcessed(state.iterations() * length);
+}
+BENCHMARK(BM_ArrayAppendValue)->RangeMultiplier(4)->Range(1, 1024);
+
+// Streams chunks of |state.range(0)| bytes through a ring buffer of
+// |state.range(1)| bytes that is kept half full, as the A2DP sink and the
+// HID report queues do.
+static void BM_RingbufferInsertPop(State& state) {
+  size_t chunk = state.range(0);
+  size_t size = state.range(1);
+  std::vector<uint8_t> in(chunk, 0xA5);
+  std::vector<uint8_t> out(chunk);
+  ringbuffer_t* rb = ringbuffer_init(size);
+  while (ringbuffer_size(rb) + chunk <= size / 2)
+    ringbuffer_insert(rb, in.data(), chunk);
+
+  for (auto _ : state) {
+    ringbuffer_insert(rb, in.data(), chunk);
+    ringbuffer_pop(rb, out.data(), chunk);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * chunk);
+  ringbuffer_free(rb);
+}
+BENCHMARK(BM_RingbufferInsertPop)
+    ->Args({16, 1024})
+    ->Args({128, 4096})
+    ->Args({512, 4096})
+    ->Args({1024, 16384})
+    ->Args({4096, 65536});
+
+// Parses audio HAL parameters as set on every A2DP stream state change
+static void BM_HashMapFromStringParams(State& state) {
+  const char params[] =
+      "A2dpSuspended=false;closing=false;exiting=0;routing=128;"
+      "bt_headset_name=Headset;bt_headset_nrec=on;bt_wbs=on;"
+      "reconfigA2dp=true;TwsChannelConfig=mono;";
+  for (auto _ : state) {
+    std::unordered_map<std::string, std::string> map =
+        hash_map_utils_new_from_string_params(params);
+    benchmark::DoNotOptimize(map.size());
+  }
+}
+BENCHMARK(BM_HashMapFromStringParams);
+
+BENCHMARK_MAIN();
@@ -348,3 +348,144 @@ TEST_F(FixedQueueTest, test_fixed_queue_register_dequeue) {
   thread_free(worker_thread);
   fixed_queue_free(queue, NULL);
 }
+
+TEST_F(FixedQueueTest, test_fixed_queue_spsc_enqueue_dequeue) {
+  fixed_queue_t* queue = fixed_queue_new_spsc(TEST_QUEUE_SIZE);
+  ASSERT_TRUE(queue != NULL);
+
+  // The capacity is rounded up to a power of two
+  EXPECT_EQ(16u, fixed_queue_capacity(queue));
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+
+  // Fill the queue until it refuses more elements
+  size_t enqueued = 0;
+  while (fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING)) enqueued++;
+  EXPECT_EQ(fixed_queue_capacity(queue), enqueued);
+  EXPECT_EQ(enqueued, fixed_queue_length(queue));
+  EXPECT_EQ(DUMMY_DATA_STRING, fixed_queue_try_peek_first(queue));
+
+  // Elements come out in FIFO order, including across ring wrap-around
+  fixed_queue_flush(queue, NULL);
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING3);
+  EXPECT_EQ(DUMMY_DATA_STRING1, fixed_queue_dequeue(queue));
+  EXPECT_EQ(DUMMY_DATA_STRING2, fixed_queue_try_dequeue(queue));
+  EXPECT_EQ(DUMMY_DATA_STRING3, fixed_queue_dequeue(queue));
+  EXPECT_EQ(NULL, fixed_queue_try_dequeue(queue));
+
+  // Remaining elements are passed to the free callback
+  test_queue_entry_free_counter = 0;
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+  fixed_queue_free(queue, test_queue_entry_free_cb);
+  EXPECT_EQ(2, test_queue_entry_free_counter);
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_spsc_dequeue_fd) {
+  fixed_queue_t* queue = fixed_queue_new_spsc(TEST_QUEUE_SIZE);
+  int dequeue_fd = fixed_queue_get_dequeue_fd(queue);
+  EXPECT_FALSE(is_fd_readable(dequeue_fd));
+
+  // Only the empty->non-empty transition signals the fd
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+  EXPECT_TRUE(is_fd_readable(dequeue_fd));
+  EXPECT_EQ(DUMMY_DATA_STRING1, fixed_queue_dequeue(queue));
+  EXPECT_EQ(DUMMY_DATA_STRING2, fixed_queue_dequeue(queue));
+
+  fixed_queue_free(queue, NULL);
+}
+
+static const size_t MPSC_MESSAGES_PER_PRODUCER = 1000;
+
+static void mpsc_producer(void* context) {
+  fixed_queue_t* queue = static_cast<fixed_queue_t*>(context);
+  for (size_t i = 0; i < MPSC_MESSAGES_PER_PRODUCER; i++)
+    fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING);
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_mpsc_register_dequeue) {
+  static const size_t producer_count = 4;
+  fixed_queue_t* queue = fixed_queue_new_mpsc(TEST_QUEUE_SIZE);
+  ASSERT_TRUE(queue != NULL);
+
+  thread_t* producers[producer_count];
+  for (size_t i = 0; i < producer_count; i++) {
+    producers[i] = thread_new("test_mpsc_producer");
+    thread_post(producers[i], mpsc_producer, queue);
+  }
+
+  size_t received = 0;
+  while (received < producer_count * MPSC_MESSAGES_PER_PRODUCER) {
+    EXPECT_EQ(DUMMY_DATA_STRING, fixed_queue_dequeue(queue));
+    received++;
+  }
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+
+  for (size_t i = 0; i < producer_count; i++) thread_free(producers[i]);
+
+  // The reactor path keeps draining while the callback makes progress
+  thread_t* worker_thread = thread_new("test_fixed_queue_worker_thread");
+  received_message_future = future_new();
+  fixed_queue_register_dequeue(queue, thread_get_reactor(worker_thread),
+                               fixed_queue_ready, NULL);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  EXPECT_EQ(DUMMY_DATA_STRING1, future_await(received_message_future));
+  fixed_queue_unregister_dequeue(queue);
+  thread_free(worker_thread);
+
+  fixed_queue_free(queue, NULL);
+}
+
+static size_t batch_received_count = 0;
+static size_t batch_max_seen = 0;
+
+// Batch callback counting the elements it has been handed
+static void fixed_queue_batch_ready(UNUSED_ATTR fixed_queue_t* queue,
+                                    void** elements, size_t count,
+                                    UNUSED_ATTR void* context) {
+  for (size_t i = 0; i < count; i++)
+    EXPECT_EQ(DUMMY_DATA_STRING, elements[i]);
+  if (count > batch_max_seen) batch_max_seen = count;
+  batch_received_count += count;
+  if (batch_received_count == TEST_QUEUE_SIZE)
+    future_ready(received_message_future, NULL);
+}
+
+static void test_fixed_queue_batch(fixed_queue_t* queue) {
+  // Fill the queue before the consumer is registered so that the first
+  // wakeup sees the whole burst.
+  for (size_t i = 0; i < TEST_QUEUE_SIZE; i++)
+    fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING);
+
+  batch_received_count = 0;
+  batch_max_seen = 0;
+  received_message_future = future_new();
+  thread_t* worker_thread = thread_new("test_fixed_queue_worker_thread");
+  fixed_queue_register_dequeue_batch(queue, thread_get_reactor(worker_thread),
+                                     4, fixed_queue_batch_ready, NULL);
+  future_await(received_message_future);
+  fixed_queue_unregister_dequeue(queue);
+  thread_free(worker_thread);
+
+  EXPECT_EQ(TEST_QUEUE_SIZE, batch_received_count);
+  EXPECT_EQ(4u, batch_max_seen);
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_register_dequeue_batch) {
+  fixed_queue_t* queue = fixed_queue_new(TEST_QUEUE_SIZE);
+  test_fixed_queue_batch(queue);
+
+  // All enqueue slots are available again
+  EXPECT_TRUE(is_fd_readable(fixed_queue_get_enqueue_fd(queue)));
+  fixed_queue_free(queue, NULL);
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_spsc_register_dequeue_batch) {
+  fixed_queue_t* queue = fixed_queue_new_spsc(TEST_QUEUE_SIZE);
+  test_fixed_queue_batch(queue);
+  fixed_queue_free(queue, NULL);
+}
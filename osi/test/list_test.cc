@@ -209,3 +209,31 @@ TEST_F(ListTest, test_list_foreach_partial) {
 
   list_free(list);
 }
+
+TEST_F(ListTest, test_list_reuses_removed_nodes) {
+  int x[32];
+  list_t* list = list_new(NULL);
+
+  // Enough items for the inline nodes, the spare nodes and fresh heap nodes
+  for (int round = 0; round < 3; ++round) {
+    for (size_t i = 0; i < ARRAY_SIZE(x); ++i) {
+      x[i] = i;
+      list_append(list, &x[i]);
+    }
+    EXPECT_EQ(list_length(list), ARRAY_SIZE(x));
+
+    int i = 0;
+    for (const list_node_t *node = list_begin(list); node != list_end(list);
+         node = list_next(node), ++i)
+      EXPECT_EQ(list_node(node), &x[i]);
+
+    for (size_t j = 0; j < ARRAY_SIZE(x); j += 2)
+      EXPECT_TRUE(list_remove(list, &x[j]));
+    EXPECT_EQ(list_length(list), ARRAY_SIZE(x) / 2);
+    EXPECT_EQ(list_front(list), &x[1]);
+    EXPECT_EQ(list_back(list), &x[ARRAY_SIZE(x) - 1]);
+    list_clear(list);
+  }
+
+  list_free(list);
+}
@@ -0,0 +1,108 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "AllocationTestHarness.h"
+
+#include "osi/include/memory_governor.h"
+
+static std::vector<memory_pressure_t> pressures;
+
+static void record_pressure(memory_pressure_t pressure, void* context) {
+  pressures.push_back(pressure);
+}
+
+class MemoryGovernorTest : public AllocationTestHarness {
+ protected:
+  void SetUp() override {
+    AllocationTestHarness::SetUp();
+    pressures.clear();
+    client_ = memory_governor_register("test", record_pressure, NULL);
+    memory_governor_set_budget(1000);
+  }
+
+  void TearDown() override {
+    memory_governor_release(client_, memory_governor_held(client_));
+    memory_governor_set_budget(0);
+    AllocationTestHarness::TearDown();
+  }
+
+  memory_client_t* client_;
+};
+
+TEST_F(MemoryGovernorTest, test_counts_bytes_held) {
+  ASSERT_TRUE(client_ != NULL);
+  memory_client_t* other = memory_governor_register("test_other", NULL, NULL);
+
+  memory_governor_charge(client_, 100);
+  memory_governor_charge(other, 50);
+  memory_governor_release(client_, 30);
+  EXPECT_EQ(70u, memory_governor_held(client_));
+  EXPECT_EQ(50u, memory_governor_held(other));
+
+  // Registering again keeps the counts
+  EXPECT_EQ(client_, memory_governor_register("test", record_pressure, NULL));
+  EXPECT_EQ(70u, memory_governor_held(client_));
+  memory_governor_release(other, 50);
+}
+
+TEST_F(MemoryGovernorTest, test_pressure_callbacks) {
+  memory_governor_charge(client_, 700);
+  EXPECT_TRUE(pressures.empty());
+  memory_governor_charge(client_, 100);
+  memory_governor_charge(client_, 200);
+
+  ASSERT_EQ(2u, pressures.size());
+  EXPECT_EQ(MEMORY_PRESSURE_MODERATE, pressures[0]);
+  EXPECT_EQ(MEMORY_PRESSURE_CRITICAL, pressures[1]);
+  EXPECT_EQ(MEMORY_PRESSURE_CRITICAL, memory_governor_pressure());
+
+  // The pressure goes down at lower levels than it goes up
+  memory_governor_release(client_, 50);
+  EXPECT_EQ(2u, pressures.size());
+  memory_governor_release(client_, 100);
+  memory_governor_release(client_, 200);
+  EXPECT_EQ(3u, pressures.size());
+  memory_governor_release(client_, 100);
+
+  ASSERT_EQ(4u, pressures.size());
+  EXPECT_EQ(MEMORY_PRESSURE_MODERATE, pressures[2]);
+  EXPECT_EQ(MEMORY_PRESSURE_NONE, pressures[3]);
+}
+
+TEST_F(MemoryGovernorTest, test_no_budget_no_pressure) {
+  memory_governor_set_budget(0);
+  memory_governor_charge(client_, 1000000);
+  EXPECT_EQ(MEMORY_PRESSURE_NONE, memory_governor_pressure());
+  EXPECT_TRUE(pressures.empty());
+
+  // Setting a budget applies to what is already held
+  memory_governor_set_budget(1000);
+  ASSERT_EQ(1u, pressures.size());
+  EXPECT_EQ(MEMORY_PRESSURE_CRITICAL, pressures[0]);
+}
+
+TEST_F(MemoryGovernorTest, test_scale) {
+  EXPECT_EQ(64u, memory_governor_scale(64, 4, MEMORY_PRESSURE_NONE));
+  EXPECT_EQ(32u, memory_governor_scale(64, 4, MEMORY_PRESSURE_MODERATE));
+  EXPECT_EQ(16u, memory_governor_scale(64, 4, MEMORY_PRESSURE_CRITICAL));
+  EXPECT_EQ(20u, memory_governor_scale(64, 20, MEMORY_PRESSURE_CRITICAL));
+}
@@ -54,3 +54,20 @@ TEST_F(PropertiesTest, test_successfull_set_and_get_value_int32) {
   int32_t received = osi_property_get_int32("very.useful.set.test", 84);
   ASSERT_EQ(received, 42);
 }
+
+OSI_CACHED_PROPERTY(cached_bool_property, "very.useful.cached.test", true);
+OSI_CACHED_PROPERTY(cached_int32_property, "very.useful.cached.int32.test",
+                    42);
+
+TEST_F(PropertiesTest, test_cached_default_value) {
+  ASSERT_TRUE(osi_cached_property_get_bool(&cached_bool_property));
+  ASSERT_EQ(42, osi_cached_property_get_int32(&cached_int32_property));
+}
+
+TEST_F(PropertiesTest, test_cached_value_follows_set) {
+  ASSERT_EQ(0, osi_property_set("very.useful.cached.test", "false"));
+  ASSERT_FALSE(osi_cached_property_get_bool(&cached_bool_property));
+
+  ASSERT_EQ(0, osi_property_set("very.useful.cached.test", "true"));
+  ASSERT_TRUE(osi_cached_property_get_bool(&cached_bool_property));
+}
@@ -15,3 +15,12 @@ TEST_F(RandTest, test_rand) {
     EXPECT_TRUE(x >= 0);
   }
 }
+
+TEST_F(RandTest, test_rand_bytes) {
+  uint8_t zero[64] = {0};
+  uint8_t buf[64] = {0};
+  EXPECT_TRUE(osi_rand_bytes(buf, sizeof(buf)));
+  // 64 zero bytes from the random source would be a broken source
+  EXPECT_NE(0, memcmp(zero, buf, sizeof(buf)));
+  EXPECT_TRUE(osi_rand_bytes(buf, 0));
+}
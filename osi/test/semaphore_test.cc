@@ -60,6 +60,19 @@ TEST_F(SemaphoreTest, test_try_wait) {
   semaphore_free(semaphore);
 }
 
+TEST_F(SemaphoreTest, test_try_wait_many_post_many) {
+  semaphore_t* semaphore = semaphore_new(0);
+  ASSERT_TRUE(semaphore != NULL);
+
+  EXPECT_EQ(0u, semaphore_try_wait_many(semaphore, 4));
+  semaphore_post_many(semaphore, 5);
+  EXPECT_EQ(4u, semaphore_try_wait_many(semaphore, 4));
+  EXPECT_EQ(1u, semaphore_try_wait_many(semaphore, 4));
+  EXPECT_FALSE(semaphore_try_wait(semaphore));
+
+  semaphore_free(semaphore);
+}
+
 TEST_F(SemaphoreTest, test_wait_after_post) {
   semaphore_t* semaphore = semaphore_new(0);
   ASSERT_TRUE(semaphore != NULL);
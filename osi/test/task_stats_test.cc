@@ -0,0 +1,87 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <base/bind.h>
+
+#include "osi/include/task_stats.h"
+
+namespace {
+
+int task_runs;
+
+void count_task() { task_runs++; }
+
+std::string dump() {
+  FILE* file = tmpfile();
+  task_stats_dump(fileno(file));
+  std::string contents;
+  char buffer[256];
+  rewind(file);
+  while (fgets(buffer, sizeof(buffer), file) != NULL) contents += buffer;
+  fclose(file);
+  return contents;
+}
+
+}  // namespace
+
+class TaskStatsTest : public ::testing::Test {
+ protected:
+  void SetUp() override { task_runs = 0; }
+
+  void TearDown() override { task_stats_set_enabled(false); }
+};
+
+TEST_F(TaskStatsTest, disabled_does_not_record) {
+  task_stats_set_enabled(false);
+  base::Closure task =
+      task_stats_wrap("disabled_thread", FROM_HERE, base::Bind(&count_task));
+  task.Run();
+
+  EXPECT_EQ(1, task_runs);
+  EXPECT_EQ(std::string::npos, dump().find("disabled_thread"));
+}
+
+TEST_F(TaskStatsTest, wrapped_task_is_recorded_per_thread) {
+  task_stats_set_enabled(true);
+  base::Closure task =
+      task_stats_wrap("wrapped_thread", FROM_HERE, base::Bind(&count_task));
+  task.Run();
+  task.Run();
+
+  EXPECT_EQ(2, task_runs);
+  std::string contents = dump();
+  EXPECT_NE(std::string::npos, contents.find("Thread wrapped_thread: 2 tasks"));
+  EXPECT_NE(std::string::npos, contents.find("task_stats_test.cc"));
+}
+
+TEST_F(TaskStatsTest, record_sorts_delays_into_buckets) {
+  task_stats_record("record_thread", (const void*)&count_task, NULL, 0, 100,
+                    100);
+
+  std::string contents = dump();
+  EXPECT_NE(std::string::npos, contents.find("Thread record_thread: 1 tasks"));
+  EXPECT_NE(std::string::npos, contents.find("max queueing delay 100 us"));
+  EXPECT_NE(std::string::npos, contents.find("<128us:1"));
+}
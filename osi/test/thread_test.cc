@@ -2,6 +2,7 @@
 
 #include "AllocationTestHarness.h"
 
+#include <sched.h>
 #include <sys/select.h>
 
 #include "osi/include/osi.h"
@@ -55,3 +56,30 @@ TEST_F(ThreadTest, test_thread_is_not_self) {
   EXPECT_FALSE(thread_is_self(thread));
   thread_free(thread);
 }
+
+static void thread_affinity_fn(void* context) {
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(cpus), &cpus));
+  *static_cast<int*>(context) = CPU_COUNT(&cpus);
+  EXPECT_TRUE(CPU_ISSET(0, &cpus));
+}
+
+TEST_F(ThreadTest, test_policy_sets_affinity) {
+  thread_policy_t policy = {-1, 0, 0x1};
+  ASSERT_TRUE(thread_set_policy("test_policy", &policy));
+
+  int cpu_count = 0;
+  thread_t* thread = thread_new("test_policy");
+  thread_post(thread, thread_affinity_fn, &cpu_count);
+  thread_free(thread);
+  EXPECT_EQ(1, cpu_count);
+
+  // Once removed, the policy is not applied any more
+  ASSERT_TRUE(thread_set_policy("test_policy", NULL));
+  cpu_count = 0;
+  thread = thread_new("test_policy");
+  thread_post(thread, thread_affinity_fn, &cpu_count);
+  thread_free(thread);
+  EXPECT_LE(1, cpu_count);
+}
@@ -23,15 +23,18 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include "osi/include/wakelock.h"
 
 #include "AllocationTestHarness.h"
 
 static bool is_wake_lock_acquired = false;
+static size_t acquire_wake_lock_count = 0;
 
 static int acquire_wake_lock_cb(const char* lock_name) {
   is_wake_lock_acquired = true;
+  acquire_wake_lock_count++;
   return BT_STATUS_SUCCESS;
 }
 
@@ -71,6 +74,7 @@ class WakelockTest : public AllocationTestHarness {
 
   virtual void TearDown() {
     is_wake_lock_acquired = false;
+    acquire_wake_lock_count = 0;
     wakelock_cleanup();
     wakelock_set_os_callouts(NULL);
 
@@ -155,3 +159,36 @@ TEST_F(WakelockTest, test_set_paths) {
     ASSERT_FALSE(IsFileWakeLockAcquired());
   }
 }
+
+TEST_F(WakelockTest, test_reference_count) {
+  wakelock_set_os_callouts(&bt_wakelock_callouts);
+
+  ASSERT_TRUE(wakelock_acquire_for("first"));
+  ASSERT_TRUE(wakelock_acquire_for("second"));
+  ASSERT_EQ(1U, acquire_wake_lock_count);
+
+  ASSERT_TRUE(wakelock_release_for("first"));
+  ASSERT_TRUE(is_wake_lock_acquired);
+  ASSERT_TRUE(wakelock_release_for("second"));
+  ASSERT_FALSE(is_wake_lock_acquired);
+
+  // Nothing is left to release
+  ASSERT_FALSE(wakelock_release_for("second"));
+}
+
+TEST_F(WakelockTest, test_release_holdoff) {
+  wakelock_set_os_callouts(&bt_wakelock_callouts);
+  wakelock_set_release_holdoff(100);
+
+  // Acquisitions within the hold-off reuse the lock
+  for (size_t i = 0; i < 1000; i++) {
+    ASSERT_TRUE(wakelock_acquire_for("test"));
+    ASSERT_TRUE(wakelock_release_for("test"));
+    ASSERT_TRUE(is_wake_lock_acquired);
+  }
+  ASSERT_EQ(1U, acquire_wake_lock_count);
+
+  // The lock goes once the hold-off passed
+  for (size_t i = 0; i < 100 && is_wake_lock_acquired; i++) usleep(10000);
+  ASSERT_FALSE(is_wake_lock_acquired);
+}
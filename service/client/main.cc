@@ -41,6 +41,7 @@
 #include <bluetooth/adapter_state.h>
 #include <bluetooth/low_energy_constants.h>
 #include <bluetooth/scan_filter.h>
+#include <bluetooth/scan_result.h>
 #include <bluetooth/scan_settings.h>
 #include <bluetooth/uuid.h>
 
@@ -286,6 +287,31 @@ class CLIBluetoothLeScannerCallback
     return Status::ok();
   }
 
+  Status OnBatchScanResults(const std::vector<uint8_t>& batch,
+                            int count) override {
+    std::vector<bluetooth::ScanResult> results;
+    if (!bluetooth::DecodeScanResults(batch, &results))
+      PrintError("Malformed scan result batch");
+
+    BeginAsyncOut();
+    cout << COLOR_BOLDWHITE "Batch of " << count << " scan results" COLOR_OFF;
+    EndAsyncOut();
+
+    for (const auto& result : results) {
+      BeginAsyncOut();
+      cout << COLOR_BOLDWHITE "Scan result: " << COLOR_BOLDYELLOW "["
+           << result.device_address() << "] "
+           << COLOR_BOLDWHITE "- RSSI: " << result.rssi() << COLOR_OFF;
+      if (dump_scan_record) {
+        cout << " - Record: "
+             << base::HexEncode(result.scan_record().data(),
+                                result.scan_record().size());
+      }
+      EndAsyncOut();
+    }
+    return Status::ok();
+  }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(CLIBluetoothLeScannerCallback);
 };
@@ -18,6 +18,7 @@
 #include "raw_address.h"
 
 #include <base/logging.h>
+#include <base/strings/stringprintf.h>
 
 namespace bluetooth {
 
@@ -38,4 +39,42 @@ bool ScanResult::operator==(const ScanResult& rhs) const {
   return true;
 }
 
+void AppendEncodedScanResult(const uint8_t address[6], int rssi,
+                             const uint8_t* scan_record,
+                             size_t scan_record_len,
+                             std::vector<uint8_t>* batch) {
+  CHECK(scan_record_len <= UINT8_MAX);
+
+  batch->insert(batch->end(), address, address + RawAddress::kLength);
+  batch->push_back(static_cast<uint8_t>(static_cast<int8_t>(rssi)));
+  batch->push_back(static_cast<uint8_t>(scan_record_len));
+  batch->insert(batch->end(), scan_record, scan_record + scan_record_len);
+}
+
+bool DecodeScanResults(const std::vector<uint8_t>& batch,
+                       std::vector<ScanResult>* results) {
+  size_t offset = 0;
+  while (offset < batch.size()) {
+    if (batch.size() - offset < kEncodedScanResultHeaderSize) return false;
+
+    const uint8_t* p = batch.data() + offset;
+    size_t record_len = p[RawAddress::kLength + 1];
+    if (batch.size() - offset - kEncodedScanResultHeaderSize < record_len)
+      return false;
+
+    // Same format as the addresses of the results reported one at a time.
+    std::string address = base::StringPrintf(
+        "%02X:%02X:%02X:%02X:%02X:%02X", p[0], p[1], p[2], p[3], p[4], p[5]);
+    int rssi = static_cast<int8_t>(p[RawAddress::kLength]);
+    const uint8_t* record = p + kEncodedScanResultHeaderSize;
+    results->emplace_back(address,
+                          std::vector<uint8_t>(record, record + record_len),
+                          rssi);
+
+    offset += kEncodedScanResultHeaderSize + record_len;
+  }
+
+  return true;
+}
+
 }  // namespace bluetooth
@@ -51,4 +51,23 @@ class ScanResult {
   int rssi_;
 };
 
+// Compact binary encoding of a batch of scan results, for IPC clients that
+// take them by the thousand. Each result is encoded as:
+//   6 bytes: BD_ADDR, most significant byte first
+//   1 byte:  RSSI, signed
+//   1 byte:  length of the scan record
+//   N bytes: scan record
+constexpr size_t kEncodedScanResultHeaderSize = 8;
+
+// Appends one result to |batch|. |scan_record_len| must not exceed 255.
+void AppendEncodedScanResult(const uint8_t address[6], int rssi,
+                             const uint8_t* scan_record,
+                             size_t scan_record_len,
+                             std::vector<uint8_t>* batch);
+
+// Decodes |batch| into |results|. Returns false if |batch| is malformed, in
+// which case |results| holds the results before the malformed one.
+bool DecodeScanResults(const std::vector<uint8_t>& batch,
+                       std::vector<ScanResult>* results);
+
 }  // namespace bluetooth
@@ -196,45 +196,151 @@ bool GattServer::SendNotification(const std::string& device_address,
   std::shared_ptr<PendingIndication> pending_ind(
       new PendingIndication(callback));
 
-  // Send the notification/indication on all matching connections.
+  // Send the notification/indication on all matching connections. We don't
+  // immediately fail if one of them fails. It's better to report success as
+  // long as we sent out at least one notification to this device as
+  // multi-transport GATT connections from the same BD_ADDR will be rare enough
+  // already.
   int send_count = 0;
   for (const auto& conn : conn_iter->second) {
-    // Make sure that one isn't already pending for this connection.
-    if (pending_indications_.find(conn->conn_id) !=
-        pending_indications_.end()) {
-      VLOG(1) << "A" << (confirm ? "n indication" : " notification")
-              << " is already pending for connection: " << conn->conn_id;
-      continue;
-    }
+    if (SendOrQueueNotification(conn, handle, confirm, value, pending_ind))
+      send_count++;
+  }
 
-    // The HAL API takes char* rather const char* for |value|, so we have to
-    // cast away the const.
-    // TODO(armansito): Make HAL accept const char*.
-    bt_status_t status = hal::BluetoothGattInterface::Get()
-                             ->GetServerHALInterface()
-                             ->send_indication(server_id_, handle,
-                                               conn->conn_id, confirm, value);
+  if (send_count == 0) {
+    LOG(ERROR) << "Failed to send notifications/indications to device: "
+               << device_address;
+    return false;
+  }
 
-    // Increment the send count if this was successful. We don't immediately
-    // fail if the HAL returned an error. It's better to report success as long
-    // as we sent out at least one notification to this device as
-    // multi-transport GATT connections from the same BD_ADDR will be rare
-    // enough already.
-    if (status != BT_STATUS_SUCCESS) continue;
+  return true;
+}
 
-    send_count++;
-    pending_indications_[conn->conn_id] = pending_ind;
+bool GattServer::SendNotifications(
+    const std::string& device_address,
+    const std::vector<std::pair<uint16_t, std::vector<uint8_t>>>&
+        notifications,
+    const GattCallback& callback) {
+  VLOG(1) << " - server_id: " << server_id_
+          << " device_address: " << device_address
+          << " count: " << notifications.size();
+  lock_guard<mutex> lock(mutex_);
+
+  if (notifications.empty()) {
+    LOG(ERROR) << "No notifications given";
+    return false;
   }
 
-  if (send_count == 0) {
-    LOG(ERROR) << "Failed to send notifications/indications to device: "
+  auto conn_iter = conn_addr_map_.find(device_address);
+  if (conn_iter == conn_addr_map_.end()) {
+    LOG(ERROR) << "No known connections for device with address: "
                << device_address;
     return false;
   }
 
+  // The callback runs once the last of them is sent on every connection.
+  std::shared_ptr<PendingIndication> pending_ind(
+      new PendingIndication(callback));
+
+  int send_count = 0;
+  for (const auto& conn : conn_iter->second) {
+    bool sent = false;
+    for (const auto& notification : notifications) {
+      if (SendOrQueueNotification(conn, notification.first, false,
+                                  notification.second, pending_ind))
+        sent = true;
+    }
+    if (sent) send_count++;
+  }
+
+  if (send_count == 0) {
+    LOG(ERROR) << "Failed to send notifications to device: " << device_address;
+    return false;
+  }
+
+  return true;
+}
+
+bool GattServer::SendOrQueueNotification(
+    const std::shared_ptr<Connection>& conn, uint16_t handle, bool confirm,
+    const std::vector<uint8_t>& value,
+    const std::shared_ptr<PendingIndication>& ind) {
+  bool in_flight =
+      pending_indications_.find(conn->conn_id) != pending_indications_.end();
+
+  // Indications wait for a confirmation, so they are not queued.
+  if (confirm) {
+    if (in_flight) {
+      VLOG(1) << "A notification is already pending for connection: "
+              << conn->conn_id;
+      return false;
+    }
+    return SendToStack(conn->conn_id, handle, true, value, {ind});
+  }
+
+  if (!in_flight && !conn->congested && conn->notification_queue.empty())
+    return SendToStack(conn->conn_id, handle, false, value, {ind});
+
+  // Only the latest value of a handle is worth sending.
+  for (auto& queued : conn->notification_queue) {
+    if (queued.handle != handle) continue;
+
+    VLOG(1) << "Replacing the queued notification of handle: " << handle
+            << " for connection: " << conn->conn_id;
+    queued.value = value;
+    queued.pending_inds.push_back(ind);
+    return true;
+  }
+
+  conn->notification_queue.push_back({handle, value, {ind}});
+  return true;
+}
+
+bool GattServer::SendToStack(int conn_id, uint16_t handle, bool confirm,
+                             const std::vector<uint8_t>& value,
+                             PendingIndications pending_inds) {
+  bt_status_t status = hal::BluetoothGattInterface::Get()
+                           ->GetServerHALInterface()
+                           ->send_indication(server_id_, handle, conn_id,
+                                             confirm, value);
+  if (status != BT_STATUS_SUCCESS) return false;
+
+  pending_indications_[conn_id] = std::move(pending_inds);
   return true;
 }
 
+void GattServer::SendQueuedNotifications(
+    const std::shared_ptr<Connection>& conn) {
+  while (!conn->congested && !conn->notification_queue.empty() &&
+         pending_indications_.find(conn->conn_id) ==
+             pending_indications_.end()) {
+    QueuedNotification queued = std::move(conn->notification_queue.front());
+    conn->notification_queue.pop_front();
+
+    if (SendToStack(conn->conn_id, queued.handle, false, queued.value,
+                    queued.pending_inds))
+      return;
+
+    LOG(ERROR) << "Failed to send queued notification of handle: "
+               << queued.handle << " for connection: " << conn->conn_id;
+    CompletePendingIndications(std::move(queued.pending_inds), BT_STATUS_FAIL);
+  }
+}
+
+void GattServer::CompletePendingIndications(PendingIndications pending_inds,
+                                            int status) {
+  for (auto& pending_ind : pending_inds) {
+    if (status == BT_STATUS_SUCCESS) pending_ind->has_success = true;
+
+    // Invoke it if this was the last reference to the confirmation callback.
+    if (pending_ind.unique() && pending_ind->callback) {
+      pending_ind->callback(pending_ind->has_success
+                                ? GATT_ERROR_NONE
+                                : static_cast<GATTError>(status));
+    }
+  }
+}
+
 void GattServer::ConnectionCallback(
     hal::BluetoothGattInterface* /* gatt_iface */, int conn_id, int server_id,
     int connected, const RawAddress& bda) {
@@ -259,7 +365,13 @@ void GattServer::ConnectionCallback(
          ++conn_iter) {
       if ((*conn_iter)->conn_id != conn_id) continue;
 
+      // The queued notifications will never go out.
+      std::shared_ptr<Connection> conn = *conn_iter;
       iter->second.erase(conn_iter);
+      for (auto& queued : conn->notification_queue)
+        CompletePendingIndications(std::move(queued.pending_inds),
+                                   BT_STATUS_FAIL);
+      conn->notification_queue.clear();
       break;
     }
 
@@ -516,17 +628,29 @@ void GattServer::IndicationSentCallback(
     return;
   }
 
-  std::shared_ptr<PendingIndication> pending_ind = pending_ind_iter->second;
+  PendingIndications pending_inds = std::move(pending_ind_iter->second);
   pending_indications_.erase(pending_ind_iter);
 
-  if (status == BT_STATUS_SUCCESS) pending_ind->has_success = true;
+  CompletePendingIndications(std::move(pending_inds), status);
 
-  // Invoke it if this was the last reference to the confirmation callback.
-  if (pending_ind.unique() && pending_ind->callback) {
-    pending_ind->callback(pending_ind->has_success
-                              ? GATT_ERROR_NONE
-                              : static_cast<GATTError>(status));
-  }
+  // The connection is ready for the next notification.
+  auto conn_iter = conn_id_map_.find(conn_id);
+  if (conn_iter != conn_id_map_.end())
+    SendQueuedNotifications(conn_iter->second);
+}
+
+void GattServer::CongestionCallback(
+    hal::BluetoothGattInterface* /* gatt_iface */, int conn_id,
+    bool congested) {
+  VLOG(1) << __func__ << " conn_id: " << conn_id
+          << " congested: " << congested;
+  lock_guard<mutex> lock(mutex_);
+
+  auto conn_iter = conn_id_map_.find(conn_id);
+  if (conn_iter == conn_id_map_.end()) return;
+
+  conn_iter->second->congested = congested;
+  if (!congested) SendQueuedNotifications(conn_iter->second);
 }
 
 void GattServer::CleanUpPendingData() {
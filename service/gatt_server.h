@@ -22,6 +22,7 @@
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <base/macros.h>
@@ -162,31 +163,63 @@ class GattServer : public BluetoothInstance,
                         const std::vector<uint8_t>& value,
                         const GattCallback& callback);
 
+  // Sends an ATT Handle-Value Notification for each (handle, value) pair of
+  // |notifications| to the device with BD_ADDR |device_address|, in order.
+  // |callback| is run once, when all of them have been sent out. Returns false
+  // if none of them could be sent or queued.
+  //
+  // Notifications sent while the previous one to the device is still going
+  // out, or while the link is congested, are queued per connection. A queued
+  // notification is replaced by a later one for the same handle, in which case
+  // only the latest value is sent and the callbacks of both run once it is.
+  bool SendNotifications(
+      const std::string& device_address,
+      const std::vector<std::pair<uint16_t, std::vector<uint8_t>>>&
+          notifications,
+      const GattCallback& callback);
+
  private:
   friend class GattServerFactory;
 
   // Used for the internal remote connection tracking. Keeps track of the
   // request ID and the device address for the connection. If |request_id| is -1
   // then no ATT read/write request is currently pending.
+    // Used to keep track of a pending Handle-Value indication.
+  struct PendingIndication {
+    explicit PendingIndication(const GattCallback& callback)
+        : has_success(false), callback(callback) {}
+
+    bool has_success;
+    GattCallback callback;
+  };
+  using PendingIndications = std::vector<std::shared_ptr<PendingIndication>>;
+
+  // A notification waiting for the connection to be ready for it, with the
+  // pending callbacks of every notification it replaced.
+  struct QueuedNotification {
+    uint16_t handle;
+    std::vector<uint8_t> value;
+    PendingIndications pending_inds;
+  };
+
   struct Connection {
     Connection(int conn_id, const RawAddress& bdaddr)
-        : conn_id(conn_id), bdaddr(bdaddr) {}
-    Connection() : conn_id(-1) { memset(&bdaddr, 0, sizeof(bdaddr)); }
+        : conn_id(conn_id), bdaddr(bdaddr), congested(false) {}
+    Connection() : conn_id(-1), congested(false) {
+      memset(&bdaddr, 0, sizeof(bdaddr));
+    }
 
     int conn_id;
     std::unordered_map<int, int> request_id_to_handle;
     RawAddress bdaddr;
-  };
 
-  // Used to keep track of a pending Handle-Value indication.
-  struct PendingIndication {
-    explicit PendingIndication(const GattCallback& callback)
-        : has_success(false), callback(callback) {}
-
-    bool has_success;
-    GattCallback callback;
+    // Notifications not sent yet, at most one per handle, and whether the
+    // stack reported the link as congested.
+    std::deque<QueuedNotification> notification_queue;
+    bool congested;
   };
 
+
   // Constructor shouldn't be called directly as instances are meant to be
   // obtained from the factory.
   GattServer(const Uuid& uuid, int server_id);
@@ -224,6 +257,28 @@ class GattServer : public BluetoothInstance,
                                 const RawAddress& bda, int exec_write) override;
   void IndicationSentCallback(hal::BluetoothGattInterface* gatt_iface,
                               int conn_id, int status) override;
+  void CongestionCallback(hal::BluetoothGattInterface* gatt_iface,
+                          int conn_id, bool congested) override;
+
+  // Sends a notification or indication on |conn|, or queues a notification if
+  // the connection is busy. Returns false if it was neither sent nor queued.
+  bool SendOrQueueNotification(const std::shared_ptr<Connection>& conn,
+                               uint16_t handle, bool confirm,
+                               const std::vector<uint8_t>& value,
+                               const std::shared_ptr<PendingIndication>& ind);
+
+  // Hands a notification or indication to the stack and records its pending
+  // callbacks for the connection.
+  bool SendToStack(int conn_id, uint16_t handle, bool confirm,
+                   const std::vector<uint8_t>& value,
+                   PendingIndications pending_inds);
+
+  // Sends the next queued notifications of |conn|, if it is ready for them.
+  void SendQueuedNotifications(const std::shared_ptr<Connection>& conn);
+
+  // Reports |status| to each of |pending_inds|, running the callbacks that no
+  // other connection still waits on.
+  void CompletePendingIndications(PendingIndications pending_inds, int status);
 
   // Helper function that notifies and clears the pending callback.
   void CleanUpPendingData();
@@ -256,8 +311,7 @@ class GattServer : public BluetoothInstance,
   // be multiple indications to the same device (in the case of a dual-mode
   // device with simulatenous BR/EDR & LE GATT connections), we also keep track
   // of whether there has been at least one successful confirmation.
-  std::unordered_map<int, std::shared_ptr<PendingIndication>>
-      pending_indications_;
+  std::unordered_map<int, PendingIndications> pending_indications_;
 
   // Raw handle to the Delegate, which must outlive this GattServer instance.
   Delegate* delegate_;
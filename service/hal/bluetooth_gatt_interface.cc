@@ -362,6 +362,15 @@ void IndicationSentCallback(int conn_id, int status) {
       IndicationSentCallback(g_interface, conn_id, status));
 }
 
+void ServerCongestionCallback(int conn_id, bool congested) {
+  shared_lock<shared_mutex_impl> lock(g_instance_lock);
+  VLOG(2) << __func__ << " - conn_id: " << conn_id
+          << " congested: " << congested;
+  VERIFY_INTERFACE_OR_RETURN();
+
+  FOR_EACH_SERVER_OBSERVER(CongestionCallback(g_interface, conn_id, congested));
+}
+
 void MtuChangedCallback(int conn_id, int mtu) {
   shared_lock<shared_mutex_impl> lock(g_instance_lock);
   VLOG(2) << __func__ << " - conn_id: " << conn_id << " mtu: " << mtu;
@@ -415,7 +424,7 @@ const btgatt_server_callbacks_t gatt_server_callbacks = {
     RequestExecWriteCallback,
     ResponseConfirmationCallback,
     IndicationSentCallback,
-    nullptr,  // congestion_cb
+    ServerCongestionCallback,
     MtuChangedCallback,
     nullptr,
     nullptr,
@@ -716,6 +725,12 @@ void BluetoothGattInterface::ServerObserver::IndicationSentCallback(
   // Do nothing.
 }
 
+void BluetoothGattInterface::ServerObserver::CongestionCallback(
+    BluetoothGattInterface* /* gatt_iface */, int /* conn_id */,
+    bool /* congested */) {
+  // Do nothing.
+}
+
 void BluetoothGattInterface::ServerObserver::MtuChangedCallback(
     BluetoothGattInterface* /* gatt_iface */, int /* conn_id */,
     int /* mtu */) {
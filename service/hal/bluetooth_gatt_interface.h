@@ -169,6 +169,9 @@ class BluetoothGattInterface {
     virtual void IndicationSentCallback(BluetoothGattInterface* gatt_iface,
                                         int conn_id, int status);
 
+    virtual void CongestionCallback(BluetoothGattInterface* gatt_iface,
+                                    int conn_id, bool congested);
+
     virtual void MtuChangedCallback(BluetoothGattInterface* gatt_iface,
                                     int conn_id, int mtu);
   };
@@ -269,6 +269,12 @@ void FakeBluetoothGattInterface::NotifyIndicationSentCallback(int conn_id,
                     IndicationSentCallback(this, conn_id, status));
 }
 
+void FakeBluetoothGattInterface::NotifyServerCongestionCallback(
+    int conn_id, bool congested) {
+  FOR_EACH_OBSERVER(ServerObserver, server_observers_,
+                    CongestionCallback(this, conn_id, congested));
+}
+
 void FakeBluetoothGattInterface::AddScannerObserver(ScannerObserver* observer) {
   CHECK(observer);
   scanner_observers_.AddObserver(observer);
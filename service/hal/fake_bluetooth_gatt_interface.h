@@ -124,6 +124,7 @@ class FakeBluetoothGattInterface : public BluetoothGattInterface {
   void NotifyRequestExecWriteCallback(int conn_id, int trans_id,
                                       const RawAddress& bda, int exec_write);
   void NotifyIndicationSentCallback(int conn_id, int status);
+  void NotifyServerCongestionCallback(int conn_id, bool congested);
 
   // BluetoothGattInterface overrides:
   void AddScannerObserver(ScannerObserver* observer) override;
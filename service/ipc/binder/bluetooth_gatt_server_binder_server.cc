@@ -173,6 +173,77 @@ Status BluetoothGattServerBinderServer::SendNotification(
   return Status::ok();
 }
 
+Status BluetoothGattServerBinderServer::SendNotifications(
+    int server_id, const String16& device_address,
+    const std::vector<int32_t>& handles,
+    const std::vector<int32_t>& value_lengths,
+    const std::vector<uint8_t>& values, bool* _aidl_return) {
+  VLOG(2) << __func__;
+  std::lock_guard<std::mutex> lock(*maps_lock());
+
+  *_aidl_return = false;
+
+  auto gatt_server = GetGattServer(server_id);
+  if (!gatt_server) {
+    LOG(ERROR) << "Unknown server_id: " << server_id;
+    return Status::ok();
+  }
+
+  if (handles.size() != value_lengths.size()) {
+    LOG(ERROR) << "Got " << handles.size() << " handles for "
+               << value_lengths.size() << " values";
+    return Status::ok();
+  }
+
+  // Split |values| up front, so that the batch is queued as a whole.
+  std::vector<std::pair<uint16_t, std::vector<uint8_t>>> notifications;
+  notifications.reserve(handles.size());
+  size_t offset = 0;
+  for (size_t i = 0; i < handles.size(); i++) {
+    if (value_lengths[i] < 0 ||
+        static_cast<size_t>(value_lengths[i]) > values.size() - offset) {
+      LOG(ERROR) << "Bad length for value " << i << ": " << value_lengths[i];
+      return Status::ok();
+    }
+    auto begin = values.begin() + offset;
+    notifications.emplace_back(
+        static_cast<uint16_t>(handles[i]),
+        std::vector<uint8_t>(begin, begin + value_lengths[i]));
+    offset += value_lengths[i];
+  }
+
+  // Create a weak pointer and pass that to the callback to prevent a potential
+  // use after free.
+  android::wp<BluetoothGattServerBinderServer> weak_ptr_to_this(this);
+  auto callback = [=](bluetooth::GATTError error) {
+    auto sp_to_this = weak_ptr_to_this.promote();
+    if (!sp_to_this.get()) {
+      VLOG(2) << "BluetoothLowEnergyBinderServer was deleted";
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(*maps_lock());
+
+    auto gatt_cb = GetGattServerCallback(server_id);
+    if (!gatt_cb.get()) {
+      VLOG(2) << "The callback was deleted";
+      return;
+    }
+
+    gatt_cb->OnNotificationSent(device_address, error);
+  };
+
+  if (!gatt_server->SendNotifications(
+          std::string(String8(device_address).string()), notifications,
+          callback)) {
+    LOG(ERROR) << "Failed to send notifications";
+    return Status::ok();
+  }
+
+  *_aidl_return = true;
+  return Status::ok();
+}
+
 void BluetoothGattServerBinderServer::OnCharacteristicReadRequest(
     bluetooth::GattServer* gatt_server, const std::string& device_address,
     int request_id, int offset, bool is_long, uint16_t handle) {
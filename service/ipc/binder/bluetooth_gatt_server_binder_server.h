@@ -63,6 +63,12 @@ class BluetoothGattServerBinderServer : public BnBluetoothGattServer,
                           const ::android::String16& device_address, int handle,
                           bool confirm, const ::std::vector<uint8_t>& value,
                           bool* _aidl_return) override;
+  Status SendNotifications(int32_t server_id,
+                           const ::android::String16& device_address,
+                           const ::std::vector<int32_t>& handles,
+                           const ::std::vector<int32_t>& value_lengths,
+                           const ::std::vector<uint8_t>& values,
+                           bool* _aidl_return) override;
 
   // bluetooth::GattServer::Delegate overrides:
   void OnCharacteristicReadRequest(bluetooth::GattServer* gatt_server,
@@ -116,6 +116,23 @@ void BluetoothLeScannerBinderServer::OnScanResult(
   cb->OnScanResult(result);
 }
 
+void BluetoothLeScannerBinderServer::OnBatchScanResults(
+    bluetooth::LowEnergyScanner* scanner, const std::vector<uint8_t>& batch,
+    size_t count) {
+  VLOG(2) << __func__ << " count: " << count;
+  std::lock_guard<std::mutex> lock(*maps_lock());
+
+  int scanner_id = scanner->GetInstanceId();
+  auto cb = GetLECallback(scanner->GetInstanceId());
+  if (!cb.get()) {
+    VLOG(2) << "Scanner was unregistered - scanner_id: " << scanner_id;
+    return;
+  }
+
+  // The batch goes out as it is, in a single transaction.
+  cb->OnBatchScanResults(batch, count);
+}
+
 android::sp<IBluetoothLeScannerCallback>
 BluetoothLeScannerBinderServer::GetLECallback(int scanner_id) {
   auto cb = GetCallback(scanner_id);
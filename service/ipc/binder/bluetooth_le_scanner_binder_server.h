@@ -63,6 +63,9 @@ class BluetoothLeScannerBinderServer
 
   void OnScanResult(bluetooth::LowEnergyScanner* scanner,
                     const bluetooth::ScanResult& result) override;
+  void OnBatchScanResults(bluetooth::LowEnergyScanner* scanner,
+                          const std::vector<uint8_t>& batch,
+                          size_t count) override;
 
  private:
   // Returns a pointer to the IBluetoothLowEnergyCallback instance associated
@@ -37,10 +37,13 @@ namespace {
 // can support advertising length extensions in the future.
 const size_t kScanRecordLength = 62;
 
+// Upper bound of the scan results delivered in one batch.
+const size_t kMaxBatchedScanResults = 256;
+
 // Returns the length of the given scan record array. We have to calculate this
 // based on the maximum possible data length and the TLV data. See TODO above
 // |kScanRecordLength|.
-size_t GetScanRecordLength(std::vector<uint8_t> bytes) {
+size_t GetScanRecordLength(const std::vector<uint8_t>& bytes) {
   for (size_t i = 0, field_len = 0; i < kScanRecordLength;
        i += (field_len + 1)) {
     field_len = bytes[i];
@@ -71,7 +74,8 @@ LowEnergyScanner::LowEnergyScanner(Adapter& adapter, const Uuid& uuid,
       app_identifier_(uuid),
       scanner_id_(scanner_id),
       scan_started_(false),
-      delegate_(nullptr) {}
+      delegate_(nullptr),
+      batch_count_(0) {}
 
 LowEnergyScanner::~LowEnergyScanner() {
   // Automatically unregister the scanner.
@@ -110,6 +114,21 @@ bool LowEnergyScanner::StartScan(const ScanSettings& settings,
     return false;
   }
 
+  {
+    lock_guard<mutex> lock(scan_fields_lock_);
+    scan_settings_ = settings;
+  }
+
+  {
+    lock_guard<mutex> lock(delegate_mutex_);
+    report_delay_ = settings.report_delay();
+    batch_.clear();
+    batch_count_ = 0;
+    if (report_delay_ > base::TimeDelta())
+      batch_.reserve(kMaxBatchedScanResults *
+                     (kEncodedScanResultHeaderSize + kScanRecordLength));
+  }
+
   scan_started_ = true;
   return true;
 }
@@ -128,6 +147,10 @@ bool LowEnergyScanner::StopScan() {
   }
 
   scan_started_ = false;
+
+  // The results batched so far are the last ones of the scan.
+  lock_guard<mutex> lock(delegate_mutex_);
+  DeliverBatchLocked();
   return true;
 }
 
@@ -149,6 +172,21 @@ void LowEnergyScanner::ScanResultCallback(
   // TODO(armansito): Apply software filters here.
 
   size_t record_len = GetScanRecordLength(adv_data);
+
+  if (report_delay_ > base::TimeDelta()) {
+    base::TimeTicks now = base::TimeTicks::Now();
+    if (batch_count_ == 0) batch_start_ = now;
+
+    AppendEncodedScanResult(bda.address, rssi, adv_data.data(), record_len,
+                            &batch_);
+    batch_count_++;
+
+    if (batch_count_ >= kMaxBatchedScanResults ||
+        now - batch_start_ >= report_delay_)
+      DeliverBatchLocked();
+    return;
+  }
+
   std::vector<uint8_t> scan_record(adv_data.begin(),
                                    adv_data.begin() + record_len);
 
@@ -157,6 +195,25 @@ void LowEnergyScanner::ScanResultCallback(
   delegate_->OnScanResult(this, result);
 }
 
+void LowEnergyScanner::DeliverBatchLocked() {
+  if (batch_count_ == 0) return;
+
+  if (delegate_) delegate_->OnBatchScanResults(this, batch_, batch_count_);
+
+  batch_.clear();
+  batch_count_ = 0;
+}
+
+void LowEnergyScanner::Delegate::OnBatchScanResults(
+    LowEnergyScanner* client, const std::vector<uint8_t>& batch,
+    size_t /* count */) {
+  std::vector<ScanResult> results;
+  if (!DecodeScanResults(batch, &results))
+    LOG(ERROR) << "Malformed scan result batch";
+
+  for (const auto& result : results) OnScanResult(client, result);
+}
+
 // LowEnergyScannerFactory implementation
 // ========================================================
 
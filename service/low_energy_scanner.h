@@ -55,6 +55,14 @@ class LowEnergyScanner : private hal::BluetoothGattInterface::ScannerObserver,
     virtual void OnScanResult(LowEnergyScanner* client,
                               const ScanResult& scan_result) = 0;
 
+    // Called with the scan results batched up when the scan settings have a
+    // report delay. |batch| holds |count| results, encoded as described for
+    // AppendEncodedScanResult(). By default each of them is decoded and passed
+    // to OnScanResult().
+    virtual void OnBatchScanResults(LowEnergyScanner* client,
+                                    const std::vector<uint8_t>& batch,
+                                    size_t count);
+
    private:
     DISALLOW_COPY_AND_ASSIGN(Delegate);
   };
@@ -99,6 +107,10 @@ class LowEnergyScanner : private hal::BluetoothGattInterface::ScannerObserver,
   void InvokeAndClearStartCallback(BLEStatus status);
   void InvokeAndClearStopCallback(BLEStatus status);
 
+  // Passes the batched scan results to the delegate. |delegate_mutex_| must be
+  // held.
+  void DeliverBatchLocked();
+
   // Raw pointer to the Bluetooth Adapter.
   Adapter& adapter_;
 
@@ -120,6 +132,15 @@ class LowEnergyScanner : private hal::BluetoothGattInterface::ScannerObserver,
   std::mutex delegate_mutex_;
   Delegate* delegate_;
 
+  // Scan results batched while the scan settings have a report delay, guarded
+  // by |delegate_mutex_|. A batch is delivered once it is full, with the first
+  // result that arrives after the report delay has passed since the batch
+  // began, and when the scan stops.
+  base::TimeDelta report_delay_;
+  std::vector<uint8_t> batch_;
+  size_t batch_count_;
+  base::TimeTicks batch_start_;
+
   DISALLOW_COPY_AND_ASSIGN(LowEnergyScanner);
 };
 
@@ -723,5 +723,70 @@ TEST_F(GattServerPostRegisterTest, SendNotification) {
   EXPECT_EQ(GATT_ERROR_NONE, gatt_error);
 }
 
+TEST_F(GattServerPostRegisterTest, SendNotificationQueued) {
+  SetUpTestService();
+
+  const std::string kTestAddress0 = "01:23:45:67:89:AB";
+  const int kConnId0 = 0;
+  const std::vector<uint8_t> kValue0 = {0x01};
+  const std::vector<uint8_t> kValue1 = {0x02};
+  const std::vector<uint8_t> kValue2 = {0x03};
+  RawAddress hal_addr0;
+  ASSERT_TRUE(RawAddress::FromString(kTestAddress0, hal_addr0));
+
+  fake_hal_gatt_iface_->NotifyServerConnectionCallback(
+      kConnId0, kDefaultServerId, true, hal_addr0);
+
+  int callback_count = 0;
+  auto callback = [&](GATTError in_error) {
+    EXPECT_EQ(GATT_ERROR_NONE, in_error);
+    callback_count++;
+  };
+
+  EXPECT_CALL(*mock_handler_, SendIndication(kDefaultServerId, char_handle_,
+                                             kConnId0, 0, kValue0))
+      .Times(1)
+      .WillOnce(Return(BT_STATUS_SUCCESS));
+  EXPECT_TRUE(gatt_server_->SendNotification(kTestAddress0, char_handle_,
+                                             false, kValue0, callback));
+
+  // The next two are queued behind the first one, and only the latest value
+  // is sent.
+  EXPECT_CALL(*mock_handler_, SendIndication(kDefaultServerId, char_handle_,
+                                             kConnId0, 0, kValue1))
+      .Times(0);
+  EXPECT_TRUE(gatt_server_->SendNotification(kTestAddress0, char_handle_,
+                                             false, kValue1, callback));
+  EXPECT_TRUE(gatt_server_->SendNotification(kTestAddress0, char_handle_,
+                                             false, kValue2, callback));
+
+  EXPECT_CALL(*mock_handler_, SendIndication(kDefaultServerId, char_handle_,
+                                             kConnId0, 0, kValue2))
+      .Times(1)
+      .WillOnce(Return(BT_STATUS_SUCCESS));
+  fake_hal_gatt_iface_->NotifyIndicationSentCallback(kConnId0,
+                                                     BT_STATUS_SUCCESS);
+  EXPECT_EQ(1, callback_count);
+
+  // Both callbacks of the replaced value run.
+  fake_hal_gatt_iface_->NotifyIndicationSentCallback(kConnId0,
+                                                     BT_STATUS_SUCCESS);
+  EXPECT_EQ(3, callback_count);
+
+  // Nothing goes out while the link is congested.
+  fake_hal_gatt_iface_->NotifyServerCongestionCallback(kConnId0, true);
+  EXPECT_TRUE(gatt_server_->SendNotification(kTestAddress0, char_handle_,
+                                             false, kValue1, callback));
+
+  EXPECT_CALL(*mock_handler_, SendIndication(kDefaultServerId, char_handle_,
+                                             kConnId0, 0, kValue1))
+      .Times(1)
+      .WillOnce(Return(BT_STATUS_SUCCESS));
+  fake_hal_gatt_iface_->NotifyServerCongestionCallback(kConnId0, false);
+  fake_hal_gatt_iface_->NotifyIndicationSentCallback(kConnId0,
+                                                     BT_STATUS_SUCCESS);
+  EXPECT_EQ(4, callback_count);
+}
+
 }  // namespace
 }  // namespace bluetooth
@@ -86,11 +86,12 @@ class MockScannerHandler : public BleScannerInterface {
 
 class TestDelegate : public LowEnergyScanner::Delegate {
  public:
-  TestDelegate() : scan_result_count_(0) {}
+  TestDelegate() : scan_result_count_(0), batch_count_(0) {}
 
   ~TestDelegate() override = default;
 
   int scan_result_count() const { return scan_result_count_; }
+  int batch_count() const { return batch_count_; }
   const ScanResult& last_scan_result() const { return last_scan_result_; }
 
   void OnScanResult(LowEnergyScanner* scanner, const ScanResult& scan_result) {
@@ -99,8 +100,16 @@ class TestDelegate : public LowEnergyScanner::Delegate {
     last_scan_result_ = scan_result;
   }
 
+  void OnBatchScanResults(LowEnergyScanner* scanner,
+                          const std::vector<uint8_t>& batch,
+                          size_t count) override {
+    batch_count_++;
+    LowEnergyScanner::Delegate::OnBatchScanResults(scanner, batch, count);
+  }
+
  private:
   int scan_result_count_;
+  int batch_count_;
   ScanResult last_scan_result_;
 
   DISALLOW_COPY_AND_ASSIGN(TestDelegate);
@@ -345,5 +354,44 @@ TEST_F(LowEnergyScannerPostRegisterTest, ScanRecord) {
   le_scanner_->SetDelegate(nullptr);
 }
 
+TEST_F(LowEnergyScannerPostRegisterTest, ScanRecordBatched) {
+  TestDelegate delegate;
+  le_scanner_->SetDelegate(&delegate);
+
+  std::vector<uint8_t> kTestRecord0({0x02, 0x01, 0x00, 0x00});
+  std::vector<uint8_t> kTestRecord1({0x00});
+  const RawAddress kTestAddress0 = {{0x01, 0x02, 0x03, 0x0A, 0x0B, 0x0C}};
+  const RawAddress kTestAddress1 = {{0x0D, 0x0E, 0x0F, 0x04, 0x05, 0x06}};
+  const char kTestAddressStr1[] = "0D:0E:0F:04:05:06";
+  const int kTestRssi = -70;
+
+  EXPECT_CALL(mock_adapter_, IsEnabled()).Times(1).WillOnce(Return(true));
+  EXPECT_CALL(*mock_handler_, Scan(_))
+      .Times(2)
+      .WillOnce(Return())
+      .WillOnce(Return());
+  ScanSettings settings;
+  settings.set_report_delay(base::TimeDelta::FromSeconds(60));
+  std::vector<ScanFilter> filters;
+  ASSERT_TRUE(le_scanner_->StartScan(settings, filters));
+
+  // Nothing is delivered before the report delay.
+  fake_hal_gatt_iface_->NotifyScanResultCallback(kTestAddress0, kTestRssi,
+                                                 kTestRecord0);
+  fake_hal_gatt_iface_->NotifyScanResultCallback(kTestAddress1, kTestRssi,
+                                                 kTestRecord1);
+  EXPECT_EQ(0, delegate.scan_result_count());
+
+  // Stopping the scan delivers the batch.
+  ASSERT_TRUE(le_scanner_->StopScan());
+  EXPECT_EQ(1, delegate.batch_count());
+  EXPECT_EQ(2, delegate.scan_result_count());
+  EXPECT_EQ(kTestAddressStr1, delegate.last_scan_result().device_address());
+  EXPECT_EQ(kTestRssi, delegate.last_scan_result().rssi());
+  EXPECT_TRUE(delegate.last_scan_result().scan_record().empty());
+
+  le_scanner_->SetDelegate(nullptr);
+}
+
 }  // namespace
 }  // namespace bluetooth
@@ -26,10 +26,18 @@
 #include <aacenc_lib.h>
 #include <base/logging.h>
 
+#include <atomic>
+
 #include "a2dp_aac.h"
+#include "a2dp_abr.h"
+#include "a2dp_encoder_pipeline.h"
 #include "bt_common.h"
+#include "osi/include/fixed_queue.h"
+#include "osi/include/future.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
+#include "osi/include/thread.h"
 
 //
 // Encoder for AAC Source Codec
@@ -44,6 +52,9 @@
  */
 #define MAX_2MBPS_AVDTP_MTU 663
 
+// Encodes on a thread of its own instead of the media task when "true"
+#define A2DP_AAC_ENCODE_THREAD_PROPERTY "persist.bluetooth.a2dp_aac_thread"
+
 // offset
 #if (BTA_AV_CO_CP_SCMS_T == TRUE)
 #define A2DP_AAC_OFFSET (AVDT_MEDIA_OFFSET + 1)
@@ -60,45 +71,55 @@ typedef struct {
   int max_encoded_buffer_bytes;  // Max encoded bytes per frame
 } tA2DP_AAC_ENCODER_PARAMS;
 
+// The PCM frames read at a media task tick, for the encode thread
 typedef struct {
-  uint32_t counter;
-  uint32_t bytes_per_tick;              // pcm bytes read each media task tick
-  uint64_t last_frame_timestamp_100ns;  // values in 1/10 microseconds
-} tA2DP_AAC_FEEDING_STATE;
+  uint32_t frames;      // PCM frames in |pcm|
+  uint32_t next_frame;  // Next frame to encode
+  uint32_t bytes_read;  // Feeding bytes read for all the frames
+  uint8_t pcm[];
+} tA2DP_AAC_ENCODE_JOB;
 
+// A packet of the encode thread, enqueued at the next media task tick
 typedef struct {
-  uint64_t session_start_us;
+  BT_HDR* p_buf;
+  size_t frames_n;
+  uint32_t bytes_read;
+} tA2DP_AAC_ENCODED_PACKET;
 
-  size_t media_read_total_expected_packets;
-  size_t media_read_total_expected_reads_count;
-  size_t media_read_total_expected_read_bytes;
+typedef struct {
+  thread_t* thread;              // NULL when encoding on the media task
+  fixed_queue_t* encoded_queue;  // tA2DP_AAC_ENCODED_PACKET
+  tA2DP_AAC_ENCODE_JOB* p_job;   // Job being encoded, on the thread only
+  a2dp_source_enqueue_callback_t enqueue_callback;
+  std::atomic<uint32_t> pending_jobs;
 
-  size_t media_read_total_dropped_packets;
-  size_t media_read_total_actual_reads_count;
-  size_t media_read_total_actual_read_bytes;
-} a2dp_aac_encoder_stats_t;
+  // Counters
+  size_t jobs;          // Ticks handed to the thread
+  size_t missed_ticks;  // Ticks at which the previous one was not encoded
+} tA2DP_AAC_ENCODE_THREAD;
 
 typedef struct {
-  a2dp_source_read_callback_t read_callback;
-  a2dp_source_enqueue_callback_t enqueue_callback;
   uint16_t TxAaMtuSize;
 
   bool use_SCMS_T;
   bool is_peer_edr;          // True if the peer device supports EDR
   bool peer_supports_3mbps;  // True if the peer device supports 3Mbps EDR
   uint16_t peer_mtu;         // MTU of the A2DP peer
-  uint32_t timestamp;        // Timestamp for the A2DP frames
 
   HANDLE_AACENCODER aac_handle;
   bool has_aac_handle;  // True if aac_handle is valid
 
   tA2DP_FEEDING_PARAMS feeding_params;
   tA2DP_AAC_ENCODER_PARAMS aac_encoder_params;
-  tA2DP_AAC_FEEDING_STATE aac_feeding_state;
 
-  a2dp_aac_encoder_stats_t stats;
+  tA2DP_ABR abr;             // Adaptive bit rate control
+  uint32_t abr_base_bitrate; // Configured constant bit rate, 0 if VBR
+
+  tA2DP_ENCODER_PIPELINE pipeline;
 } tA2DP_AAC_ENCODER_CB;
 
+static tA2DP_AAC_ENCODE_THREAD a2dp_aac_encode_thread;
+
 static uint32_t a2dp_aac_encoder_interval_ms = A2DP_AAC_ENCODER_INTERVAL_MS;
 
 static tA2DP_AAC_ENCODER_CB a2dp_aac_encoder_cb;
@@ -108,11 +129,15 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
                                     bool* p_restart_input,
                                     bool* p_restart_output,
                                     bool* p_config_updated);
-static void a2dp_aac_get_num_frame_iteration(uint8_t* num_of_iterations,
-                                             uint8_t* num_of_frames,
-                                             uint64_t timestamp_us);
-static void a2dp_aac_encode_frames(uint8_t nb_frame);
-static bool a2dp_aac_read_feeding(uint8_t* read_buffer ,uint32_t* bytes_read);
+static bool a2dp_aac_encode_frame(const uint8_t* p_pcm, uint8_t* p_out,
+                                  uint32_t out_size,
+                                  tA2DP_ENCODED_FRAME* p_encoded);
+static void a2dp_aac_encode_thread_start(
+    a2dp_source_enqueue_callback_t enqueue_callback);
+static void a2dp_aac_encode_thread_stop(void);
+static void a2dp_aac_encode_thread_sync(void);
+static void a2dp_aac_encode_thread_tick(uint32_t nb_frame);
+static void a2dp_aac_set_bitrate(void* context);
 
 bool A2DP_LoadEncoderAac(void) {
   // Nothing to do - the library is statically linked
@@ -121,6 +146,7 @@ bool A2DP_LoadEncoderAac(void) {
 
 void A2DP_UnloadEncoderAac(void) {
   // Nothing to do - the library is statically linked
+  a2dp_aac_encode_thread_stop();
   if (a2dp_aac_encoder_cb.has_aac_handle)
     aacEncClose(&a2dp_aac_encoder_cb.aac_handle);
   memset(&a2dp_aac_encoder_cb, 0, sizeof(a2dp_aac_encoder_cb));
@@ -134,18 +160,29 @@ void a2dp_aac_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
     LOG_INFO(LOG_TAG,"aac is running offload mode");
     return;
   }
+  a2dp_aac_encode_thread_stop();
   if (a2dp_aac_encoder_cb.has_aac_handle)
     aacEncClose(&a2dp_aac_encoder_cb.aac_handle);
   memset(&a2dp_aac_encoder_cb, 0, sizeof(a2dp_aac_encoder_cb));
 
-  a2dp_aac_encoder_cb.stats.session_start_us = time_get_os_boottime_us();
+  a2dp_encoder_pipeline_init(&a2dp_aac_encoder_cb.pipeline, read_callback,
+                             enqueue_callback);
+  a2dp_aac_encoder_cb.pipeline.encode_frame = a2dp_aac_encode_frame;
+  a2dp_aac_encoder_cb.pipeline.offset = A2DP_AAC_OFFSET;
+  // NOTE: We don't check whether the packet will fit in the MTU,
+  // because AAC doesn't give us control over the encoded frame size.
+  // If the packet is larger than the MTU, it will be fragmented before
+  // transmission.
+  a2dp_aac_encoder_cb.pipeline.close_on_output = true;
+
+  char value[PROPERTY_VALUE_MAX];
+  osi_property_get(A2DP_AAC_ENCODE_THREAD_PROPERTY, value, "false");
+  if (strcmp(value, "true") == 0)
+    a2dp_aac_encode_thread_start(enqueue_callback);
 
-  a2dp_aac_encoder_cb.read_callback = read_callback;
-  a2dp_aac_encoder_cb.enqueue_callback = enqueue_callback;
   a2dp_aac_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
   a2dp_aac_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
   a2dp_aac_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_aac_encoder_cb.timestamp = 0;
 
   a2dp_aac_encoder_cb.use_SCMS_T = false;  // TODO: should be a parameter
 #if (BTA_AV_CO_CP_SCMS_T == TRUE)
@@ -164,10 +201,11 @@ void a2dp_aac_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
 bool A2dpCodecConfigAac::updateEncoderUserConfig(
     const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params, bool* p_restart_input,
     bool* p_restart_output, bool* p_config_updated) {
+  a2dp_aac_encode_thread_sync();
   a2dp_aac_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
   a2dp_aac_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
   a2dp_aac_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_aac_encoder_cb.timestamp = 0;
+  a2dp_aac_encoder_cb.pipeline.timestamp = 0;
 
   if (a2dp_aac_encoder_cb.peer_mtu == 0) {
     LOG_ERROR(LOG_TAG,
@@ -200,6 +238,9 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
   *p_restart_output = false;
   *p_config_updated = false;
 
+  // The encoder handle may not change while the thread encodes
+  a2dp_aac_encode_thread_sync();
+
   if (!a2dp_aac_encoder_cb.has_aac_handle) {
     AACENC_ERROR aac_error = aacEncOpen(&a2dp_aac_encoder_cb.aac_handle, 0,
                                         2 /* max 2 channels: stereo */);
@@ -366,6 +407,9 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
               __func__, aac_param_value, aac_error);
     return;  // TODO: Return an error?
   }
+  // The adaptive bit rate steps down from the configured bit rate
+  a2dp_abr_reset(&a2dp_aac_encoder_cb.abr);
+  a2dp_aac_encoder_cb.abr_base_bitrate = aac_param_value;
 
   // Set the encoder's parameters: PEAK Bit Rate
   aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
@@ -429,6 +473,8 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
   } else if (aac_param_value == A2DP_AAC_VARIABLE_BIT_RATE_ENABLED) {
     //TODO: Other modes need to add
     aac_param_value = 0x05; // This is High Bitrate mode value
+    // The encoder ignores AACENC_BITRATE in VBR mode
+    a2dp_aac_encoder_cb.abr_base_bitrate = 0;
   }
   aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
                                   AACENC_BITRATEMODE, aac_param_value);
@@ -474,6 +520,7 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
 }
 
 void a2dp_aac_encoder_cleanup(void) {
+  a2dp_aac_encode_thread_stop();
   if (a2dp_aac_encoder_cb.has_aac_handle)
     aacEncClose(&a2dp_aac_encoder_cb.aac_handle);
   memset(&a2dp_aac_encoder_cb, 0, sizeof(a2dp_aac_encoder_cb));
@@ -503,18 +550,16 @@ void a2dp_aac_feeding_reset(void) {
                      "aac is running offload mode");
     return;
   }
-  memset(&a2dp_aac_encoder_cb.aac_feeding_state, 0,
-         sizeof(a2dp_aac_encoder_cb.aac_feeding_state));
-
-  a2dp_aac_encoder_cb.aac_feeding_state.bytes_per_tick =
-      (a2dp_aac_encoder_cb.feeding_params.sample_rate *
-       a2dp_aac_encoder_cb.feeding_params.bits_per_sample / 8 *
-       a2dp_aac_encoder_cb.feeding_params.channel_count *
-       a2dp_aac_encoder_interval_ms) /
-      1000;
+  a2dp_aac_encode_thread_sync();
+  a2dp_aac_encoder_cb.pipeline.pcm_bytes_per_frame =
+      frame_length * a2dp_aac_encoder_cb.feeding_params.channel_count *
+      a2dp_aac_encoder_cb.feeding_params.bits_per_sample / 8;
+  a2dp_encoder_pipeline_reset(&a2dp_aac_encoder_cb.pipeline,
+                              &a2dp_aac_encoder_cb.feeding_params,
+                              a2dp_aac_encoder_interval_ms);
 
   LOG_INFO(LOG_TAG, "%s: PCM bytes %u per tick %u ms", __func__,
-           a2dp_aac_encoder_cb.aac_feeding_state.bytes_per_tick,
+           a2dp_aac_encoder_cb.pipeline.bytes_per_tick,
            a2dp_aac_encoder_interval_ms);
 }
 
@@ -524,7 +569,44 @@ void a2dp_aac_feeding_flush(void) {
                      "aac is running offload mode");
     return;
   }
-  a2dp_aac_encoder_cb.aac_feeding_state.counter = 0;
+  a2dp_aac_encode_thread_sync();
+  a2dp_aac_encoder_cb.pipeline.counter = 0;
+}
+
+void a2dp_aac_set_transmit_queue_length(size_t transmit_queue_length) {
+  if (A2DP_IsCodecEnabledInOffload(BTAV_A2DP_CODEC_INDEX_SOURCE_AAC)) return;
+  if (!a2dp_aac_encoder_cb.has_aac_handle ||
+      a2dp_aac_encoder_cb.abr_base_bitrate == 0)
+    return;
+  if (!a2dp_abr_update(&a2dp_aac_encoder_cb.abr, transmit_queue_length))
+    return;
+
+  // The new bit rate applies from the next aacEncEncode() call on
+  uint32_t bitrate = a2dp_abr_scale(&a2dp_aac_encoder_cb.abr,
+                                    a2dp_aac_encoder_cb.abr_base_bitrate);
+  if (a2dp_aac_encode_thread.thread != NULL) {
+    thread_post(a2dp_aac_encode_thread.thread, a2dp_aac_set_bitrate,
+                reinterpret_cast<void*>(static_cast<uintptr_t>(bitrate)));
+    return;
+  }
+  a2dp_aac_set_bitrate(
+      reinterpret_cast<void*>(static_cast<uintptr_t>(bitrate)));
+}
+
+// Sets the AAC bit rate to |context|, on the thread encoding
+static void a2dp_aac_set_bitrate(void* context) {
+  uint32_t bitrate =
+      static_cast<uint32_t>(reinterpret_cast<uintptr_t>(context));
+  AACENC_ERROR aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
+                                               AACENC_BITRATE, bitrate);
+  if (aac_error != AACENC_OK) {
+    LOG_ERROR(LOG_TAG,
+              "%s: Cannot set AAC parameter AACENC_BITRATE to %u: "
+              "AAC error 0x%x",
+              __func__, bitrate, aac_error);
+    return;
+  }
+  LOG_INFO(LOG_TAG, "%s: bit rate %u", __func__, bitrate);
 }
 
 period_ms_t a2dp_aac_get_encoder_interval_ms(void) {
@@ -537,93 +619,42 @@ period_ms_t a2dp_aac_get_encoder_interval_ms(void) {
 }
 
 void a2dp_aac_send_frames(uint64_t timestamp_us) {
-  uint8_t nb_frame = 0;
-  uint8_t nb_iterations = 0;
-
   if (A2DP_IsCodecEnabledInOffload(BTAV_A2DP_CODEC_INDEX_SOURCE_AAC)) {
     LOG_INFO(LOG_TAG,"a2dp_aac_send_frames:"
                      "aac is running offload mode");
     return;
   }
-  a2dp_aac_get_num_frame_iteration(&nb_iterations, &nb_frame, timestamp_us);
-  LOG_VERBOSE(LOG_TAG, "%s: Sending %d frames per iteration, %d iterations",
-              __func__, nb_frame, nb_iterations);
+  uint32_t nb_frame = a2dp_encoder_pipeline_schedule(
+      &a2dp_aac_encoder_cb.pipeline, timestamp_us);
+  LOG_VERBOSE(LOG_TAG, "%s: Sending %u frames", __func__, nb_frame);
+  if (a2dp_aac_encode_thread.thread != NULL) {
+    a2dp_aac_encode_thread_tick(nb_frame);
+    return;
+  }
   if (nb_frame == 0) return;
 
-  for (uint8_t counter = 0; counter < nb_iterations; counter++) {
-    // Transcode frame and enqueue
-    a2dp_aac_encode_frames(nb_frame);
-  }
+  // Transcode frame and enqueue
+  a2dp_encoder_pipeline_encode(&a2dp_aac_encoder_cb.pipeline, nb_frame);
 }
 
-// Obtains the number of frames to send and number of iterations
-// to be used. |num_of_iterations| and |num_of_frames| parameters
-// are used as output param for returning the respective values.
-static void a2dp_aac_get_num_frame_iteration(uint8_t* num_of_iterations,
-                                             uint8_t* num_of_frames,
-                                             uint64_t timestamp_us) {
-  uint32_t result = 0;
-  uint8_t nof = 0;
-  uint8_t noi = 1;
-
-  uint32_t pcm_bytes_per_frame =
-      a2dp_aac_encoder_cb.aac_encoder_params.frame_length *
-      a2dp_aac_encoder_cb.feeding_params.channel_count *
-      a2dp_aac_encoder_cb.feeding_params.bits_per_sample / 8;
-  LOG_VERBOSE(LOG_TAG, "%s: pcm_bytes_per_frame %u", __func__,
-              pcm_bytes_per_frame);
-
-  uint32_t hecto_ns_this_tick = a2dp_aac_encoder_interval_ms * 10000;
-  uint64_t* last_100ns =
-      &a2dp_aac_encoder_cb.aac_feeding_state.last_frame_timestamp_100ns;
-  uint64_t now_100ns = timestamp_us * 10;
-  if (*last_100ns != 0) {
-    hecto_ns_this_tick = (now_100ns - *last_100ns);
-  }
-  *last_100ns = now_100ns;
-
-  uint32_t bytes_this_tick =
-      a2dp_aac_encoder_cb.aac_feeding_state.bytes_per_tick *
-      hecto_ns_this_tick / (a2dp_aac_encoder_interval_ms * 10000);
-  a2dp_aac_encoder_cb.aac_feeding_state.counter += bytes_this_tick;
-  // Without this erratum, there was a three microseocnd shift per tick which
-  // would cause one frame mismatched after every 180 seconds
-  uint32_t erratum_100ns =
-      ceil(1.0f * bytes_this_tick * a2dp_aac_encoder_interval_ms * 10000 /
-           a2dp_aac_encoder_cb.aac_feeding_state.bytes_per_tick);
-  if (erratum_100ns < hecto_ns_this_tick) {
-    LOG_VERBOSE(LOG_TAG, "%s: hecto_ns_this_tick=%d, bytes=%d, erratum_100ns=%d",
-                __func__, hecto_ns_this_tick, bytes_this_tick, erratum_100ns);
-    *last_100ns -= hecto_ns_this_tick - erratum_100ns;
-  }
-
-  result = a2dp_aac_encoder_cb.aac_feeding_state.counter / pcm_bytes_per_frame;
-  a2dp_aac_encoder_cb.aac_feeding_state.counter -= result * pcm_bytes_per_frame;
-  nof = result;
-
-  LOG_VERBOSE(LOG_TAG, "%s: effective num of frames %u, iterations %u",
-              __func__, nof, noi);
-
-  *num_of_frames = nof;
-  *num_of_iterations = noi;
-}
-
-static void a2dp_aac_encode_frames(uint8_t nb_frame) {
+static bool a2dp_aac_encode_frame(const uint8_t* p_pcm, uint8_t* p_out,
+                                  uint32_t out_size,
+                                  tA2DP_ENCODED_FRAME* p_encoded) {
   tA2DP_AAC_ENCODER_PARAMS* p_encoder_params =
       &a2dp_aac_encoder_cb.aac_encoder_params;
   tA2DP_FEEDING_PARAMS* p_feeding_params = &a2dp_aac_encoder_cb.feeding_params;
-  uint8_t remain_nb_frame = nb_frame;
-  uint8_t read_buffer[BT_DEFAULT_BUFFER_SIZE];
-  int pcm_bytes_per_frame = p_encoder_params->frame_length *
-                            p_feeding_params->channel_count *
-                            p_feeding_params->bits_per_sample / 8;
-  CHECK(pcm_bytes_per_frame <= static_cast<int>(sizeof(read_buffer)));
+
+  if (!a2dp_aac_encoder_cb.has_aac_handle) {
+    LOG_ERROR(LOG_TAG, "%s: invalid AAC handle", __func__);
+    return false;
+  }
 
   // Setup the input buffer
   AACENC_BufDesc in_buf_desc;
-  void* in_buf_vector[1] = {nullptr};
+  void* in_buf_vector[1] = {const_cast<uint8_t*>(p_pcm)};
   int in_buf_identifiers[1] = {IN_AUDIO_DATA};
-  int in_buf_sizes[1] = {pcm_bytes_per_frame};
+  int in_buf_sizes[1] = {
+      static_cast<int>(a2dp_aac_encoder_cb.pipeline.pcm_bytes_per_frame)};
   int in_buf_element_sizes[1] = {p_feeding_params->bits_per_sample / 8};
   in_buf_desc.numBufs = 1;
   in_buf_desc.bufs = in_buf_vector;
@@ -631,11 +662,13 @@ static void a2dp_aac_encode_frames(uint8_t nb_frame) {
   in_buf_desc.bufSizes = in_buf_sizes;
   in_buf_desc.bufElSizes = in_buf_element_sizes;
 
-  // Setup the output buffer (partially)
+  // Setup the output buffer
   AACENC_BufDesc out_buf_desc;
-  void* out_buf_vector[1] = {nullptr};
+  void* out_buf_vector[1] = {p_out};
   int out_buf_identifiers[1] = {OUT_BITSTREAM_DATA};
-  int out_buf_sizes[1] = {p_encoder_params->max_encoded_buffer_bytes};
+  int out_buf_sizes[1] = {
+      std::min(p_encoder_params->max_encoded_buffer_bytes,
+               static_cast<int>(out_size))};
   // NOTE: out_buf_element_sizes below is probably unused by the encoder
   int out_buf_element_sizes[1] = {p_feeding_params->bits_per_sample / 8};
   out_buf_desc.numBufs = 1;
@@ -643,8 +676,6 @@ static void a2dp_aac_encode_frames(uint8_t nb_frame) {
   out_buf_desc.bufferIdentifiers = out_buf_identifiers;
   out_buf_desc.bufSizes = out_buf_sizes;
   out_buf_desc.bufElSizes = out_buf_element_sizes;
-  CHECK(p_encoder_params->max_encoded_buffer_bytes <=
-        static_cast<int>(BT_DEFAULT_BUFFER_SIZE - sizeof(BT_HDR)));
 
   AACENC_InArgs aac_in_args;
   aac_in_args.numInSamples =
@@ -654,117 +685,170 @@ static void a2dp_aac_encode_frames(uint8_t nb_frame) {
   AACENC_OutArgs aac_out_args = {
       .numOutBytes = 0, .numInSamples = 0, .numAncBytes = 0};
 
-  uint32_t count;
-  uint32_t total_bytes_read = 0;
-  int written = 0;
-
-  while (nb_frame) {
-    BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
-    p_buf->offset = A2DP_AAC_OFFSET;
-    p_buf->len = 0;
-    p_buf->layer_specific = 0;
-    a2dp_aac_encoder_cb.stats.media_read_total_expected_packets++;
-
-    count = 0;
-    do {
-      // Read the PCM data and encode it
-      uint32_t bytes_read = 0;
-      if (a2dp_aac_read_feeding(read_buffer, &bytes_read)) {
-        uint8_t* packet = (uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len;
-        if (!a2dp_aac_encoder_cb.has_aac_handle) {
-          LOG_ERROR(LOG_TAG, "%s: invalid AAC handle", __func__);
-          LOG_WARN(LOG_TAG, "%s: nb_frame:%d, bytes_read:%d, len:%d, count:%d, total_bytes_read:%d",
-                   __func__, nb_frame, bytes_read, p_buf->len, count, total_bytes_read);
-          a2dp_aac_encoder_cb.stats.media_read_total_dropped_packets++;
-          osi_free(p_buf);
-          return;
-        }
-        in_buf_vector[0] = read_buffer;
-        out_buf_vector[0] = packet + count;
-        AACENC_ERROR aac_error =
-            aacEncEncode(a2dp_aac_encoder_cb.aac_handle, &in_buf_desc,
-                         &out_buf_desc, &aac_in_args, &aac_out_args);
-        if (aac_error != AACENC_OK) {
-          LOG_ERROR(LOG_TAG, "%s: AAC encoding error: 0x%x", __func__,
-                    aac_error);
-          LOG_WARN(LOG_TAG, "%s: nb_frame:%d, bytes_read:%d, len:%d, count:%d, total_bytes_read:%d",
-                   __func__, nb_frame, bytes_read, p_buf->len, count, total_bytes_read);
-          a2dp_aac_encoder_cb.stats.media_read_total_dropped_packets++;
-          osi_free(p_buf);
-          return;
-        }
-        written = aac_out_args.numOutBytes;
-        count += written;
-        p_buf->len += written;
-        nb_frame--;
-        p_buf->layer_specific++;  // added a frame to the buffer
-      } else {
-        LOG_WARN(LOG_TAG, "%s: underflow %d", __func__, nb_frame);
-        a2dp_aac_encoder_cb.aac_feeding_state.counter +=
-            nb_frame * p_encoder_params->frame_length *
-            p_feeding_params->channel_count *
-            p_feeding_params->bits_per_sample / 8;
-
-        // no more pcm to read
-        nb_frame = 0;
-      }
-      total_bytes_read += bytes_read;
-    } while ((written == 0) && nb_frame);
-
-    // NOTE: We don't check whether the packet will fit in the MTU,
-    // because AAC doesn't give us control over the encoded frame size.
-    // If the packet is larger than the MTU, it will be fragmented before
-    // transmission.
-    if (p_buf->len) {
-      /*
-       * Timestamp of the media packet header represent the TS of the
-       * first frame, i.e the timestamp before including this frame.
-       */
-      *((uint32_t*)(p_buf + 1)) = a2dp_aac_encoder_cb.timestamp;
-
-      a2dp_aac_encoder_cb.timestamp +=
-          p_buf->layer_specific * p_encoder_params->frame_length;
-
-      uint8_t done_nb_frame = remain_nb_frame - nb_frame;
-      remain_nb_frame = nb_frame;
-      if (!a2dp_aac_encoder_cb.enqueue_callback(p_buf, done_nb_frame,
-                                                total_bytes_read)) {
-        LOG_WARN(LOG_TAG, "%s: enqueue discarded done_nb_frame: %d,"
-                 "total bytes_read: %d, len: %d, count: %d, written: %d",
-                 __func__, done_nb_frame, total_bytes_read, p_buf->len, count, written);
-        return;
-      }
-    } else {
-      a2dp_aac_encoder_cb.stats.media_read_total_dropped_packets++;
-      osi_free(p_buf);
-    }
+  AACENC_ERROR aac_error =
+      aacEncEncode(a2dp_aac_encoder_cb.aac_handle, &in_buf_desc, &out_buf_desc,
+                   &aac_in_args, &aac_out_args);
+  if (aac_error != AACENC_OK) {
+    LOG_ERROR(LOG_TAG, "%s: AAC encoding error: 0x%x", __func__, aac_error);
+    return false;
   }
+
+  p_encoded->bytes = aac_out_args.numOutBytes;
+  p_encoded->frames = 1;  // added a frame to the buffer
+  p_encoded->samples = p_encoder_params->frame_length;
+  return true;
 }
 
-static bool a2dp_aac_read_feeding(uint8_t* read_buffer, uint32_t* bytes_read) {
-  uint32_t read_size = a2dp_aac_encoder_cb.aac_encoder_params.frame_length *
-                       a2dp_aac_encoder_cb.feeding_params.channel_count *
-                       a2dp_aac_encoder_cb.feeding_params.bits_per_sample / 8;
+//
+// Encode thread. The media task reads the PCM frames due at a tick and hands
+// them to the thread, which encodes and packetizes them through the pipeline.
+// The packets are enqueued at the next tick, so the thread has a whole tick to
+// encode and a slow frame no longer delays the tick.
+//
 
-  a2dp_aac_encoder_cb.stats.media_read_total_expected_reads_count++;
-  a2dp_aac_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
+// Encodes the frames of the job |context|, on the encode thread
+static void a2dp_aac_encode_job(void* context) {
+  tA2DP_AAC_ENCODE_JOB* p_job = static_cast<tA2DP_AAC_ENCODE_JOB*>(context);
+
+  a2dp_aac_encode_thread.p_job = p_job;
+  a2dp_encoder_pipeline_encode(&a2dp_aac_encoder_cb.pipeline, p_job->frames);
+  a2dp_aac_encode_thread.p_job = NULL;
+  osi_free(p_job);
+  a2dp_aac_encode_thread.pending_jobs--;
+}
 
-  /* Read Data from UIPC channel */
-  uint32_t nb_byte_read =
-      a2dp_aac_encoder_cb.read_callback(read_buffer, read_size);
-  a2dp_aac_encoder_cb.stats.media_read_total_actual_read_bytes += nb_byte_read;
-  *bytes_read = nb_byte_read;
+// Read callback of the pipeline on the encode thread, takes the next frame of
+// the job being encoded
+static bool a2dp_aac_read_job_frame(uint8_t* p_pcm, uint32_t* p_bytes_read) {
+  tA2DP_AAC_ENCODE_JOB* p_job = a2dp_aac_encode_thread.p_job;
+  uint32_t frame_size = a2dp_aac_encoder_cb.pipeline.pcm_bytes_per_frame;
+  if (p_job == NULL || p_job->next_frame >= p_job->frames) return false;
+
+  memcpy(p_pcm, p_job->pcm + p_job->next_frame * frame_size, frame_size);
+  // The feeding bytes of the job are counted with its first packet
+  *p_bytes_read = (p_job->next_frame == 0) ? p_job->bytes_read : 0;
+  p_job->next_frame++;
+  return true;
+}
 
-  if (nb_byte_read < read_size) {
-    if (nb_byte_read == 0) return false;
+// Enqueue callback of the pipeline on the encode thread
+static bool a2dp_aac_enqueue_encoded(BT_HDR* p_buf, size_t frames_n,
+                                     uint32_t bytes_read) {
+  tA2DP_AAC_ENCODED_PACKET* p_packet =
+      (tA2DP_AAC_ENCODED_PACKET*)osi_malloc(sizeof(*p_packet));
+  p_packet->p_buf = p_buf;
+  p_packet->frames_n = frames_n;
+  p_packet->bytes_read = bytes_read;
+  fixed_queue_enqueue(a2dp_aac_encode_thread.encoded_queue, p_packet);
+  return true;
+}
 
-    /* Fill the unfilled part of the read buffer with silence (0) */
-    memset(((uint8_t*)read_buffer) + nb_byte_read, 0, read_size - nb_byte_read);
-    nb_byte_read = read_size;
+static void a2dp_aac_free_encoded(void* data) {
+  tA2DP_AAC_ENCODED_PACKET* p_packet =
+      static_cast<tA2DP_AAC_ENCODED_PACKET*>(data);
+  osi_free(p_packet->p_buf);
+  osi_free(p_packet);
+}
+
+static void a2dp_aac_encode_thread_start(
+    a2dp_source_enqueue_callback_t enqueue_callback) {
+  a2dp_aac_encode_thread.thread = thread_new("a2dp_aac_encode");
+  if (a2dp_aac_encode_thread.thread == NULL) {
+    LOG_ERROR(LOG_TAG, "%s: unable to start the encode thread", __func__);
+    return;
   }
-  a2dp_aac_encoder_cb.stats.media_read_total_actual_reads_count++;
+  a2dp_aac_encode_thread.encoded_queue = fixed_queue_new(SIZE_MAX);
+  a2dp_aac_encode_thread.enqueue_callback = enqueue_callback;
+  a2dp_aac_encode_thread.pending_jobs = 0;
+  a2dp_aac_encode_thread.jobs = 0;
+  a2dp_aac_encode_thread.missed_ticks = 0;
 
-  return true;
+  a2dp_aac_encoder_cb.pipeline.read_frame = a2dp_aac_read_job_frame;
+  a2dp_aac_encoder_cb.pipeline.enqueue_callback = a2dp_aac_enqueue_encoded;
+  LOG_INFO(LOG_TAG, "%s: encoding on a thread of its own", __func__);
+}
+
+static void a2dp_aac_encode_thread_stop(void) {
+  if (a2dp_aac_encode_thread.thread == NULL) return;
+
+  // The jobs posted are encoded before the thread exits
+  thread_free(a2dp_aac_encode_thread.thread);
+  a2dp_aac_encode_thread.thread = NULL;
+  fixed_queue_free(a2dp_aac_encode_thread.encoded_queue,
+                   a2dp_aac_free_encoded);
+  a2dp_aac_encode_thread.encoded_queue = NULL;
+}
+
+static void a2dp_aac_encode_thread_synced(void* context) {
+  future_ready(static_cast<future_t*>(context), FUTURE_SUCCESS);
+}
+
+// Waits for the jobs posted to be encoded and drops their packets, before the
+// encoder or its feeding are changed
+static void a2dp_aac_encode_thread_sync(void) {
+  if (a2dp_aac_encode_thread.thread == NULL) return;
+
+  future_t* future = future_new();
+  thread_post(a2dp_aac_encode_thread.thread, a2dp_aac_encode_thread_synced,
+              future);
+  future_await(future);
+  fixed_queue_flush(a2dp_aac_encode_thread.encoded_queue,
+                    a2dp_aac_free_encoded);
+}
+
+// Enqueues the packets encoded since the previous tick and hands the
+// |nb_frame| PCM frames due to the encode thread
+static void a2dp_aac_encode_thread_tick(uint32_t nb_frame) {
+  tA2DP_ENCODER_PIPELINE* p_pipeline = &a2dp_aac_encoder_cb.pipeline;
+
+  if (a2dp_aac_encode_thread.pending_jobs != 0)
+    a2dp_aac_encode_thread.missed_ticks++;
+
+  tA2DP_AAC_ENCODED_PACKET* p_packet;
+  while ((p_packet = (tA2DP_AAC_ENCODED_PACKET*)fixed_queue_try_dequeue(
+              a2dp_aac_encode_thread.encoded_queue)) != NULL) {
+    BT_HDR* p_buf = p_packet->p_buf;
+    size_t frames_n = p_packet->frames_n;
+    uint32_t bytes_read = p_packet->bytes_read;
+    osi_free(p_packet);
+    if (!a2dp_aac_encode_thread.enqueue_callback(p_buf, frames_n,
+                                                 bytes_read)) {
+      LOG_WARN(LOG_TAG, "%s: enqueue discarded frames_n: %zu", __func__,
+               frames_n);
+    }
+  }
+
+  if (nb_frame == 0) return;
+
+  uint32_t frame_size = p_pipeline->pcm_bytes_per_frame;
+  tA2DP_AAC_ENCODE_JOB* p_job = (tA2DP_AAC_ENCODE_JOB*)osi_malloc(
+      sizeof(tA2DP_AAC_ENCODE_JOB) + nb_frame * frame_size);
+  p_job->frames = 0;
+  p_job->next_frame = 0;
+  p_job->bytes_read = 0;
+  while (p_job->frames < nb_frame) {
+    uint32_t bytes_read = 0;
+    bool have_frame = a2dp_encoder_pipeline_read_pcm(
+        p_pipeline, p_job->pcm + p_job->frames * frame_size, &bytes_read);
+    p_job->bytes_read += bytes_read;
+    if (!have_frame) {
+      // Give the frames not read back to the scheduler
+      uint32_t missing = nb_frame - p_job->frames;
+      LOG_WARN(LOG_TAG, "%s: underflow %u", __func__, missing);
+      if (p_pipeline->bytes_per_tick != 0)
+        p_pipeline->counter += missing * frame_size;
+      break;
+    }
+    p_job->frames++;
+  }
+
+  if (p_job->frames == 0) {
+    osi_free(p_job);
+    return;
+  }
+  a2dp_aac_encode_thread.pending_jobs++;
+  a2dp_aac_encode_thread.jobs++;
+  thread_post(a2dp_aac_encode_thread.thread, a2dp_aac_encode_job, p_job);
 }
 
 period_ms_t A2dpCodecConfigAac::encoderIntervalMs() const {
@@ -772,25 +856,22 @@ period_ms_t A2dpCodecConfigAac::encoderIntervalMs() const {
 }
 
 void A2dpCodecConfigAac::debug_codec_dump(int fd) {
-  a2dp_aac_encoder_stats_t* stats = &a2dp_aac_encoder_cb.stats;
-
   A2dpCodecConfig::debug_codec_dump(fd);
 
-  dprintf(fd,
-          "  Packet counts (expected/dropped)                        : %zu / "
-          "%zu\n",
-          stats->media_read_total_expected_packets,
-          stats->media_read_total_dropped_packets);
-
-  dprintf(fd,
-          "  PCM read counts (expected/actual)                       : %zu / "
-          "%zu\n",
-          stats->media_read_total_expected_reads_count,
-          stats->media_read_total_actual_reads_count);
+  a2dp_encoder_pipeline_debug_dump(&a2dp_aac_encoder_cb.pipeline, fd);
 
   dprintf(fd,
-          "  PCM read bytes (expected/actual)                        : %zu / "
-          "%zu\n",
-          stats->media_read_total_expected_read_bytes,
-          stats->media_read_total_actual_read_bytes);
+          "  Bit rate (current/configured, 0 for VBR)                : %u / "
+          "%u\n",
+          a2dp_abr_scale(&a2dp_aac_encoder_cb.abr,
+                         a2dp_aac_encoder_cb.abr_base_bitrate),
+          a2dp_aac_encoder_cb.abr_base_bitrate);
+  a2dp_abr_debug_dump(&a2dp_aac_encoder_cb.abr, fd);
+
+  if (a2dp_aac_encode_thread.thread != NULL) {
+    dprintf(fd,
+            "  Encode thread ticks (encoded/missed)                    : %zu / "
+            "%zu\n",
+            a2dp_aac_encode_thread.jobs, a2dp_aac_encode_thread.missed_ticks);
+  }
 }
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "a2dp_abr"
+
+#include "a2dp_abr.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+
+#include "osi/include/log.h"
+
+// TX queue length (in packets) that makes the bit rate step down
+#ifndef A2DP_ABR_QUEUE_HIGH
+#define A2DP_ABR_QUEUE_HIGH 5
+#endif
+
+// TX queue length (in packets) that counts as a good tick
+#ifndef A2DP_ABR_QUEUE_LOW
+#define A2DP_ABR_QUEUE_LOW 1
+#endif
+
+// Good ticks in a row before the bit rate steps up (about 5 s at 20 ms)
+#ifndef A2DP_ABR_STEP_UP_TICKS
+#define A2DP_ABR_STEP_UP_TICKS 250
+#endif
+
+// Ticks given to the TX queue to drain after a step down
+#ifndef A2DP_ABR_HOLD_TICKS
+#define A2DP_ABR_HOLD_TICKS 10
+#endif
+
+// RSSI (in dB below the golden receive power range) of a weak link
+#ifndef A2DP_ABR_WEAK_RSSI
+#define A2DP_ABR_WEAK_RSSI (-20)
+#endif
+
+// Percentage of the configured bit rate used at each quality step
+static const uint8_t a2dp_abr_level_percent[A2DP_ABR_MAX_LEVEL + 1] = {
+    100, 85, 70, 55, 40};
+
+// Link quality events reported on the BTU thread, counted by every
+// controller on the encoder thread
+static std::atomic<uint32_t> a2dp_abr_link_events(0);
+static std::atomic<int> a2dp_abr_last_rssi(0);
+static std::atomic<int> a2dp_abr_last_failed_contact_counter(0);
+
+void a2dp_abr_reset(tA2DP_ABR* p_abr) {
+  memset(p_abr, 0, sizeof(*p_abr));
+  p_abr->link_events = a2dp_abr_link_events;
+}
+
+bool a2dp_abr_update(tA2DP_ABR* p_abr, size_t transmit_queue_length) {
+  uint32_t link_events = a2dp_abr_link_events;
+  bool link_degraded = (link_events != p_abr->link_events);
+  uint8_t level = p_abr->level;
+
+  p_abr->link_events = link_events;
+  if (transmit_queue_length > p_abr->max_queue_length)
+    p_abr->max_queue_length = transmit_queue_length;
+  if (p_abr->hold_ticks > 0) p_abr->hold_ticks--;
+
+  if (transmit_queue_length >= A2DP_ABR_QUEUE_HIGH || link_degraded) {
+    p_abr->good_ticks = 0;
+    if (p_abr->level < A2DP_ABR_MAX_LEVEL &&
+        (p_abr->hold_ticks == 0 || link_degraded)) {
+      p_abr->level++;
+      p_abr->step_downs++;
+      if (link_degraded) p_abr->link_step_downs++;
+      p_abr->hold_ticks = A2DP_ABR_HOLD_TICKS;
+    }
+  } else if (transmit_queue_length <= A2DP_ABR_QUEUE_LOW) {
+    if (p_abr->level > 0 && ++p_abr->good_ticks >= A2DP_ABR_STEP_UP_TICKS) {
+      p_abr->level--;
+      p_abr->step_ups++;
+      p_abr->good_ticks = 0;
+    }
+  } else {
+    p_abr->good_ticks = 0;
+  }
+
+  if (level == p_abr->level) return false;
+  LOG_INFO(LOG_TAG, "%s: queue %zu%s: quality step %u -> %u", __func__,
+           transmit_queue_length, link_degraded ? " weak link" : "", level,
+           p_abr->level);
+  return true;
+}
+
+uint32_t a2dp_abr_scale(const tA2DP_ABR* p_abr, uint32_t value) {
+  return value * a2dp_abr_level_percent[p_abr->level] / 100;
+}
+
+void a2dp_abr_report_rssi(int8_t rssi) {
+  a2dp_abr_last_rssi = rssi;
+  if (rssi < A2DP_ABR_WEAK_RSSI) a2dp_abr_link_events++;
+}
+
+void a2dp_abr_report_failed_contact_counter(uint16_t failed_contact_counter) {
+  a2dp_abr_last_failed_contact_counter = failed_contact_counter;
+  // The counter only counts the flushes in a row, any is a struggling link
+  if (failed_contact_counter > 0) a2dp_abr_link_events++;
+}
+
+void a2dp_abr_report_link_degraded(void) { a2dp_abr_link_events++; }
+
+void a2dp_abr_debug_dump(const tA2DP_ABR* p_abr, int fd) {
+  dprintf(fd,
+          "  ABR quality step (current/max) bit rate                 : %u / "
+          "%u (%u%%)\n",
+          p_abr->level, A2DP_ABR_MAX_LEVEL,
+          a2dp_abr_level_percent[p_abr->level]);
+  dprintf(fd,
+          "  ABR decisions (step down/step up/weak link)             : %zu / "
+          "%zu / %zu\n",
+          p_abr->step_downs, p_abr->step_ups, p_abr->link_step_downs);
+  dprintf(fd,
+          "  ABR link (max TX queue/RSSI/failed contacts)            : %zu / "
+          "%d / %d\n",
+          p_abr->max_queue_length, a2dp_abr_last_rssi.load(),
+          a2dp_abr_last_failed_contact_counter.load());
+}
@@ -0,0 +1,286 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "a2dp_encoder_pipeline"
+
+#include "a2dp_encoder_pipeline.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bt_common.h"
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+#include "osi/include/time.h"
+
+void a2dp_encoder_pipeline_init(
+    tA2DP_ENCODER_PIPELINE* p_pipeline,
+    a2dp_source_read_callback_t read_callback,
+    a2dp_source_enqueue_callback_t enqueue_callback) {
+  memset(p_pipeline, 0, sizeof(*p_pipeline));
+  p_pipeline->read_callback = read_callback;
+  p_pipeline->enqueue_callback = enqueue_callback;
+  p_pipeline->buffer_size = BT_DEFAULT_BUFFER_SIZE;
+  p_pipeline->stats.session_start_us = time_get_os_boottime_us();
+}
+
+void a2dp_encoder_pipeline_reset(tA2DP_ENCODER_PIPELINE* p_pipeline,
+                                 const tA2DP_FEEDING_PARAMS* p_feeding_params,
+                                 uint32_t interval_ms) {
+  p_pipeline->counter = 0;
+  p_pipeline->last_frame_timestamp_100ns = 0;
+  p_pipeline->interval_ms = interval_ms;
+  p_pipeline->bytes_per_tick =
+      (p_feeding_params->sample_rate * p_feeding_params->bits_per_sample / 8 *
+       p_feeding_params->channel_count * interval_ms) /
+      1000;
+
+  LOG_DEBUG(LOG_TAG, "%s: PCM bytes per tick %u", __func__,
+            p_pipeline->bytes_per_tick);
+}
+
+uint32_t a2dp_encoder_pipeline_tick(tA2DP_ENCODER_PIPELINE* p_pipeline,
+                                    uint64_t timestamp_us) {
+  if (p_pipeline->bytes_per_tick == 0 || p_pipeline->pcm_bytes_per_frame == 0)
+    return 0;
+
+  uint32_t hecto_ns_per_tick = p_pipeline->interval_ms * 10000;
+  uint32_t hecto_ns_this_tick = hecto_ns_per_tick;
+  uint64_t* last_100ns = &p_pipeline->last_frame_timestamp_100ns;
+  uint64_t now_100ns = timestamp_us * 10;
+  if (*last_100ns != 0) {
+    hecto_ns_this_tick = (now_100ns - *last_100ns);
+  }
+  *last_100ns = now_100ns;
+
+  uint32_t bytes_this_tick = (uint64_t)p_pipeline->bytes_per_tick *
+                             hecto_ns_this_tick / hecto_ns_per_tick;
+  p_pipeline->counter += bytes_this_tick;
+  // Without this erratum, there was a three microsecond shift per tick which
+  // would cause one frame mismatched every few tens of seconds
+  uint32_t erratum_100ns = ceil(1.0f * hecto_ns_per_tick * bytes_this_tick /
+                                p_pipeline->bytes_per_tick);
+  if (erratum_100ns < hecto_ns_this_tick) {
+    LOG_VERBOSE(LOG_TAG, "%s: hecto_ns_this_tick=%d, bytes=%d, erratum_100ns=%d",
+                __func__, hecto_ns_this_tick, bytes_this_tick, erratum_100ns);
+    *last_100ns -= hecto_ns_this_tick - erratum_100ns;
+  }
+
+  return p_pipeline->counter / p_pipeline->pcm_bytes_per_frame;
+}
+
+uint32_t a2dp_encoder_pipeline_schedule(tA2DP_ENCODER_PIPELINE* p_pipeline,
+                                        uint64_t timestamp_us) {
+  uint32_t nb_frame = a2dp_encoder_pipeline_tick(p_pipeline, timestamp_us);
+  p_pipeline->counter -= nb_frame * p_pipeline->pcm_bytes_per_frame;
+  p_pipeline->stats.media_read_total_expected_frames += nb_frame;
+
+  LOG_VERBOSE(LOG_TAG, "%s: effective num of frames %u", __func__, nb_frame);
+  return nb_frame;
+}
+
+bool a2dp_encoder_pipeline_read_pcm(tA2DP_ENCODER_PIPELINE* p_pipeline,
+                                    uint8_t* p_pcm, uint32_t* p_bytes_read) {
+  tA2DP_ENCODER_STATS* p_stats = &p_pipeline->stats;
+  uint32_t read_size = p_pipeline->pcm_bytes_per_frame;
+
+  p_stats->media_read_total_expected_reads_count++;
+  p_stats->media_read_total_expected_read_bytes += read_size;
+
+  /* Read Data from UIPC channel */
+  uint32_t nb_byte_read = p_pipeline->read_callback(p_pcm, read_size);
+  p_stats->media_read_total_actual_read_bytes += nb_byte_read;
+  *p_bytes_read = nb_byte_read;
+
+  if (nb_byte_read < read_size) {
+    if (nb_byte_read == 0) return false;
+
+    /* Fill the unfilled part of the read buffer with silence (0) */
+    memset(p_pcm + nb_byte_read, 0, read_size - nb_byte_read);
+  }
+  p_stats->media_read_total_actual_reads_count++;
+  return true;
+}
+
+// Encodes the PCM frame in the staging buffer to |p_out|.
+static bool a2dp_encoder_pipeline_encode_frame(
+    tA2DP_ENCODER_PIPELINE* p_pipeline, uint8_t* p_out, uint32_t out_size,
+    tA2DP_ENCODED_FRAME* p_encoded) {
+  tA2DP_ENCODER_STATS* p_stats = &p_pipeline->stats;
+
+  memset(p_encoded, 0, sizeof(*p_encoded));
+  uint64_t start_us = time_get_os_boottime_us();
+  bool ok =
+      p_pipeline->encode_frame(p_pipeline->pcm, p_out, out_size, p_encoded);
+  uint64_t encode_us = time_get_os_boottime_us() - start_us;
+
+  p_stats->encode_total_frames++;
+  p_stats->encode_total_us += encode_us;
+  if (encode_us > p_stats->encode_max_us) p_stats->encode_max_us = encode_us;
+  if (!ok) return false;
+
+  if (p_encoded->bytes > out_size) {
+    LOG_ERROR(LOG_TAG, "%s: %u encoded bytes do not fit in %u", __func__,
+              p_encoded->bytes, out_size);
+    return false;
+  }
+  p_stats->encode_total_bytes += p_encoded->bytes;
+  return true;
+}
+
+void a2dp_encoder_pipeline_encode(tA2DP_ENCODER_PIPELINE* p_pipeline,
+                                  uint32_t nb_frame) {
+  tA2DP_ENCODER_STATS* p_stats = &p_pipeline->stats;
+  uint16_t max_len = p_pipeline->buffer_size - sizeof(BT_HDR);
+
+  if (p_pipeline->offset >= max_len) {
+    LOG_ERROR(LOG_TAG, "%s: invalid offset %u", __func__, p_pipeline->offset);
+    return;
+  }
+  max_len -= p_pipeline->offset;
+  if (p_pipeline->read_frame == NULL &&
+      p_pipeline->pcm_bytes_per_frame > sizeof(p_pipeline->pcm)) {
+    LOG_ERROR(LOG_TAG, "%s: %u PCM bytes per frame do not fit", __func__,
+              p_pipeline->pcm_bytes_per_frame);
+    return;
+  }
+
+  while (nb_frame) {
+    BT_HDR* p_buf = (BT_HDR*)osi_malloc(p_pipeline->buffer_size);
+    p_buf->offset = p_pipeline->offset;
+    p_buf->len = 0;
+    p_buf->layer_specific = 0;
+    p_stats->media_read_total_expected_packets++;
+
+    uint8_t* packet = (uint8_t*)(p_buf + 1) + p_buf->offset;
+    uint32_t bytes_read = 0;
+    uint32_t packet_frames = 0;
+    uint32_t packet_samples = 0;
+    uint32_t last_frame_len = 0;
+    bool packet_full = false;
+    do {
+      // Read the PCM data and encode it
+      uint32_t frame_bytes_read = 0;
+      bool have_frame =
+          (p_pipeline->read_frame != NULL)
+              ? p_pipeline->read_frame(p_pipeline->pcm, &frame_bytes_read)
+              : a2dp_encoder_pipeline_read_pcm(p_pipeline, p_pipeline->pcm,
+                                               &frame_bytes_read);
+      bytes_read += frame_bytes_read;
+      if (!have_frame) {
+        LOG_WARN(LOG_TAG, "%s: underflow %u", __func__, nb_frame);
+        if (p_pipeline->bytes_per_tick != 0)
+          p_pipeline->counter += nb_frame * p_pipeline->pcm_bytes_per_frame;
+
+        // no more pcm to read
+        nb_frame = 0;
+        break;
+      }
+
+      tA2DP_ENCODED_FRAME encoded;
+      if (!a2dp_encoder_pipeline_encode_frame(p_pipeline, packet + p_buf->len,
+                                              max_len - p_buf->len,
+                                              &encoded)) {
+        LOG_WARN(LOG_TAG, "%s: nb_frame: %u, bytes_read: %u, len: %u",
+                 __func__, nb_frame, bytes_read, p_buf->len);
+        p_stats->media_read_total_dropped_packets++;
+        osi_free(p_buf);
+        return;
+      }
+      p_buf->len += encoded.bytes;
+      p_buf->layer_specific += encoded.frames;
+      packet_samples += encoded.samples;
+      packet_frames++;
+      nb_frame--;
+      if (encoded.bytes != 0) last_frame_len = encoded.bytes;
+
+      if (p_pipeline->close_on_output && encoded.bytes != 0) packet_full = true;
+      if (p_pipeline->max_frames != 0 &&
+          packet_frames >= p_pipeline->max_frames)
+        packet_full = true;
+      if (p_pipeline->mtu != 0 &&
+          p_buf->len + last_frame_len >= p_pipeline->mtu)
+        packet_full = true;
+      if (p_buf->len + last_frame_len > max_len) packet_full = true;
+    } while (!packet_full && nb_frame);
+
+    if (p_buf->len == 0) {
+      // A codec buffering frames normally leaves the last packet empty when
+      // there wasn't enough PCM to complete a frame
+      if (!p_pipeline->codec_buffers)
+        p_stats->media_read_total_dropped_packets++;
+      osi_free(p_buf);
+      continue;
+    }
+
+    /*
+     * Timestamp of the media packet header represent the TS of the
+     * first frame, i.e the timestamp before including this frame.
+     */
+    *((uint32_t*)(p_buf + 1)) = p_pipeline->timestamp;
+    p_pipeline->timestamp += packet_samples;
+
+    size_t enqueue_frames = p_pipeline->enqueue_frames != 0
+                                ? p_pipeline->enqueue_frames
+                                : packet_frames;
+    uint16_t len = p_buf->len;
+    if (!p_pipeline->enqueue_callback(p_buf, enqueue_frames, bytes_read)) {
+      LOG_WARN(LOG_TAG,
+               "%s: enqueue discarded done_nb_frame: %zu, bytes_read: %u, "
+               "len: %u",
+               __func__, enqueue_frames, bytes_read, len);
+      return;
+    }
+  }
+}
+
+void a2dp_encoder_pipeline_debug_dump(const tA2DP_ENCODER_PIPELINE* p_pipeline,
+                                      int fd) {
+  const tA2DP_ENCODER_STATS* stats = &p_pipeline->stats;
+
+  dprintf(fd,
+          "  Packet counts (expected/dropped)                        : %zu / "
+          "%zu\n",
+          stats->media_read_total_expected_packets,
+          stats->media_read_total_dropped_packets);
+
+  dprintf(fd,
+          "  PCM read counts (expected/actual)                       : %zu / "
+          "%zu\n",
+          stats->media_read_total_expected_reads_count,
+          stats->media_read_total_actual_reads_count);
+
+  dprintf(fd,
+          "  PCM read bytes (expected/actual)                        : %zu / "
+          "%zu\n",
+          stats->media_read_total_expected_read_bytes,
+          stats->media_read_total_actual_read_bytes);
+
+  dprintf(fd,
+          "  Encoded frames (count/bytes)                            : %zu / "
+          "%zu\n",
+          stats->encode_total_frames, stats->encode_total_bytes);
+
+  dprintf(fd,
+          "  Encoding time per frame (average/max us)                : "
+          "%" PRIu64 " / %" PRIu64 "\n",
+          stats->encode_total_frames != 0
+              ? stats->encode_total_us / stats->encode_total_frames
+              : 0,
+          stats->encode_max_us);
+}
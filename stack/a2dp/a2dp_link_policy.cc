@@ -0,0 +1,136 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "a2dp_link_policy"
+
+#include "a2dp_link_policy.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+
+#include "osi/include/log.h"
+
+// TX queue length (in packets) of a busy tick
+#ifndef A2DP_LINK_POLICY_QUEUE_HIGH
+#define A2DP_LINK_POLICY_QUEUE_HIGH 8
+#endif
+
+// TX queue length (in packets) that counts as a good tick
+#ifndef A2DP_LINK_POLICY_QUEUE_LOW
+#define A2DP_LINK_POLICY_QUEUE_LOW 1
+#endif
+
+// Busy ticks in a row before the link goes robust (about 400 ms at 20 ms)
+#ifndef A2DP_LINK_POLICY_BUSY_TICKS
+#define A2DP_LINK_POLICY_BUSY_TICKS 20
+#endif
+
+// Good ticks before a robust link goes back to normal (about 10 s at 20 ms)
+#ifndef A2DP_LINK_POLICY_GOOD_TICKS
+#define A2DP_LINK_POLICY_GOOD_TICKS 500
+#endif
+
+// Ticks a robust link stays robust whatever the queue (about 5 s at 20 ms)
+#ifndef A2DP_LINK_POLICY_HOLD_TICKS
+#define A2DP_LINK_POLICY_HOLD_TICKS 250
+#endif
+
+// Failed contact reports made on the BTU thread, counted by the policy on
+// the encoder thread
+static std::atomic<uint32_t> a2dp_link_policy_link_events(0);
+static std::atomic<int> a2dp_link_policy_last_failed_contact_counter(0);
+
+void a2dp_link_policy_reset(tA2DP_LINK_POLICY* p_policy) {
+  memset(p_policy, 0, sizeof(*p_policy));
+  p_policy->link_events = a2dp_link_policy_link_events;
+}
+
+bool a2dp_link_policy_update(tA2DP_LINK_POLICY* p_policy,
+                             size_t transmit_queue_length) {
+  uint32_t link_events = a2dp_link_policy_link_events;
+  bool link_degraded = (link_events != p_policy->link_events);
+
+  p_policy->link_events = link_events;
+  if (p_policy->hold_ticks > 0) p_policy->hold_ticks--;
+
+  if (transmit_queue_length >= A2DP_LINK_POLICY_QUEUE_HIGH) {
+    if (p_policy->busy_ticks < A2DP_LINK_POLICY_BUSY_TICKS)
+      p_policy->busy_ticks++;
+  } else {
+    p_policy->busy_ticks = 0;
+  }
+
+  if (link_degraded || transmit_queue_length > A2DP_LINK_POLICY_QUEUE_LOW)
+    p_policy->good_ticks = 0;
+  else if (p_policy->good_ticks < A2DP_LINK_POLICY_GOOD_TICKS)
+    p_policy->good_ticks++;
+
+  if (!p_policy->robust) {
+    if (!link_degraded && p_policy->busy_ticks < A2DP_LINK_POLICY_BUSY_TICKS)
+      return false;
+    p_policy->robust = true;
+    p_policy->to_robust++;
+    if (link_degraded) p_policy->link_to_robust++;
+  } else {
+    // Failed contacts keep the link robust for another hold period
+    if (link_degraded) p_policy->hold_ticks = A2DP_LINK_POLICY_HOLD_TICKS;
+    if (p_policy->hold_ticks > 0 ||
+        p_policy->good_ticks < A2DP_LINK_POLICY_GOOD_TICKS)
+      return false;
+    p_policy->robust = false;
+    p_policy->to_normal++;
+  }
+
+  p_policy->busy_ticks = 0;
+  p_policy->good_ticks = 0;
+  p_policy->hold_ticks = p_policy->robust ? A2DP_LINK_POLICY_HOLD_TICKS : 0;
+  LOG_INFO(LOG_TAG, "%s: queue %zu%s: %s packet types", __func__,
+           transmit_queue_length, link_degraded ? " failed contacts" : "",
+           p_policy->robust ? "robust" : "normal");
+  return true;
+}
+
+void a2dp_link_policy_report_failed_contact_counter(
+    uint16_t failed_contact_counter) {
+  a2dp_link_policy_last_failed_contact_counter = failed_contact_counter;
+  // The counter only counts the flushes in a row, any means retransmissions
+  // ran out
+  if (failed_contact_counter > 0) a2dp_link_policy_link_events++;
+}
+
+void a2dp_link_policy_report_link_degraded(void) {
+  a2dp_link_policy_link_events++;
+}
+
+uint16_t a2dp_link_policy_robust_pkt_types(uint16_t pkt_types) {
+  return (pkt_types & ~A2DP_LINK_POLICY_ROBUST_PKT_TYPES_CLEARED) |
+         A2DP_LINK_POLICY_ROBUST_NO_PKT_TYPES;
+}
+
+void a2dp_link_policy_debug_dump(const tA2DP_LINK_POLICY* p_policy, int fd) {
+  dprintf(fd,
+          "  Link policy packet types (current)                      : %s\n",
+          p_policy->robust ? "robust" : "normal");
+  dprintf(fd,
+          "  Link policy changes (to robust/to normal/failed contact): %zu / "
+          "%zu / %zu\n",
+          p_policy->to_robust, p_policy->to_normal, p_policy->link_to_robust);
+  dprintf(fd,
+          "  Link policy last failed contacts                        : %d\n",
+          a2dp_link_policy_last_failed_contact_counter.load());
+}
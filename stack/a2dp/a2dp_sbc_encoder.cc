@@ -26,7 +26,10 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "a2dp_abr.h"
+#include "a2dp_encoder_pipeline.h"
 #include "a2dp_sbc.h"
+#include "a2dp_sbc_resampler.h"
 #include "a2dp_sbc_up_sample.h"
 #include "bt_common.h"
 #include <sbc_encoder.h>
@@ -79,43 +82,31 @@ typedef struct {
   uint32_t aa_frame_counter;
   int32_t aa_feed_counter;
   int32_t aa_feed_residue;
-  uint32_t counter;
-  uint32_t bytes_per_tick;              // pcm bytes read each media task tick
-  uint64_t last_frame_timestamp_100ns;  // values in 1/10 microseconds
+  bool resampler_checked;               // resampler initialized for feeding
+  bool use_resampler;                   // polyphase resampler in use
 } tA2DP_SBC_FEEDING_STATE;
 
 typedef struct {
-  uint64_t session_start_us;
-
-  size_t media_read_total_expected_packets;
-  size_t media_read_total_expected_reads_count;
-  size_t media_read_total_expected_read_bytes;
-
-  size_t media_read_total_dropped_packets;
-  size_t media_read_total_actual_reads_count;
-  size_t media_read_total_actual_read_bytes;
-
-  size_t media_read_total_expected_frames;
-  size_t media_read_total_dropped_frames;
-} a2dp_sbc_encoder_stats_t;
-
-typedef struct {
-  a2dp_source_read_callback_t read_callback;
-  a2dp_source_enqueue_callback_t enqueue_callback;
   uint16_t TxAaMtuSize;
   uint8_t tx_sbc_frames;
   bool is_peer_edr;         /* True if the peer device supports EDR */
   bool peer_supports_3mbps; /* True if the peer device supports 3Mbps EDR */
   uint16_t peer_mtu;        /* MTU of the A2DP peer */
-  uint32_t timestamp;       /* Timestamp for the A2DP frames */
   SBC_ENC_PARAMS sbc_encoder_params;
   tA2DP_FEEDING_PARAMS feeding_params;
   tA2DP_SBC_FEEDING_STATE feeding_state;
-  int16_t pcmBuffer[SBC_MAX_PCM_BUFFER_SIZE];
 
-  a2dp_sbc_encoder_stats_t stats;
+  tA2DP_ABR abr;            /* adaptive bit rate control */
+  int16_t abr_base_bitpool; /* bitpool of the configured bit rate */
+  int16_t abr_min_bitpool;  /* lowest bitpool accepted by the peer */
+
+  tA2DP_ENCODER_PIPELINE pipeline;
 } tA2DP_SBC_ENCODER_CB;
 
+static_assert(SBC_MAX_PCM_BUFFER_SIZE * sizeof(int16_t) <=
+                  A2DP_ENCODER_PCM_STAGING_SIZE,
+              "SBC frames do not fit in the staging buffer");
+
 bool enc_update_in_progress = FALSE;
 bool tx_enc_update_initiated = FALSE;
 static tA2DP_SBC_ENCODER_CB a2dp_sbc_encoder_cb;
@@ -125,8 +116,11 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
                                     bool* p_restart_input,
                                     bool* p_restart_output,
                                     bool* p_config_updated);
-static bool a2dp_sbc_read_feeding(uint32_t* bytes);
-static void a2dp_sbc_encode_frames(uint8_t nb_frame);
+static bool a2dp_sbc_read_feeding(uint8_t* p_pcm, uint32_t* bytes);
+static bool a2dp_sbc_read_resampled_feeding(uint8_t* p_pcm, uint32_t* bytes);
+static bool a2dp_sbc_encode_frame(const uint8_t* p_pcm, uint8_t* p_out,
+                                  uint32_t out_size,
+                                  tA2DP_ENCODED_FRAME* p_encoded);
 static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
                                              uint8_t* num_of_frames,
                                              uint64_t timestamp_us);
@@ -153,14 +147,17 @@ void a2dp_sbc_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
   }
   memset(&a2dp_sbc_encoder_cb, 0, sizeof(a2dp_sbc_encoder_cb));
 
-  a2dp_sbc_encoder_cb.stats.session_start_us = time_get_os_boottime_us();
+  a2dp_encoder_pipeline_init(&a2dp_sbc_encoder_cb.pipeline, read_callback,
+                             enqueue_callback);
+  a2dp_sbc_encoder_cb.pipeline.encode_frame = a2dp_sbc_encode_frame;
+  a2dp_sbc_encoder_cb.pipeline.read_frame = a2dp_sbc_read_feeding;
+  a2dp_sbc_encoder_cb.pipeline.buffer_size = A2DP_SBC_BUFFER_SIZE;
+  a2dp_sbc_encoder_cb.pipeline.offset = A2DP_SBC_OFFSET;
+  a2dp_sbc_encoder_cb.pipeline.max_frames = 0x0F;  // media payload header
 
-  a2dp_sbc_encoder_cb.read_callback = read_callback;
-  a2dp_sbc_encoder_cb.enqueue_callback = enqueue_callback;
   a2dp_sbc_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
   a2dp_sbc_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
   a2dp_sbc_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_sbc_encoder_cb.timestamp = 0;
 
   // NOTE: Ignore the restart_input / restart_output flags - this initization
   // happens when the connection is (re)started.
@@ -177,7 +174,7 @@ bool A2dpCodecConfigSbc::updateEncoderUserConfig(
   a2dp_sbc_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
   a2dp_sbc_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
   a2dp_sbc_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_sbc_encoder_cb.timestamp = 0;
+  a2dp_sbc_encoder_cb.pipeline.timestamp = 0;
 
   if (a2dp_sbc_encoder_cb.peer_mtu == 0) {
     LOG_ERROR(LOG_TAG,
@@ -385,6 +382,13 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
   /* Finally update the bitpool in the encoder structure */
   p_encoder_params->s16BitPool = s16BitPool;
 
+  /* The adaptive bit rate steps down from the configured bitpool */
+  a2dp_abr_reset(&a2dp_sbc_encoder_cb.abr);
+  a2dp_sbc_encoder_cb.abr_base_bitpool = s16BitPool;
+  a2dp_sbc_encoder_cb.abr_min_bitpool =
+      (min_bitpool > A2DP_SBC_IE_MIN_BITPOOL) ? min_bitpool
+                                              : A2DP_SBC_IE_MIN_BITPOOL;
+
   LOG_DEBUG(LOG_TAG, "%s: final bit rate %d, final bit pool %d", __func__,
             p_encoder_params->u16BitRate, p_encoder_params->s16BitPool);
 
@@ -410,15 +414,9 @@ void a2dp_sbc_feeding_reset(void) {
   memset(&a2dp_sbc_encoder_cb.feeding_state, 0,
          sizeof(a2dp_sbc_encoder_cb.feeding_state));
 
-  a2dp_sbc_encoder_cb.feeding_state.bytes_per_tick =
-      (a2dp_sbc_encoder_cb.feeding_params.sample_rate *
-       a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8 *
-       a2dp_sbc_encoder_cb.feeding_params.channel_count *
-       A2DP_SBC_ENCODER_INTERVAL_MS) /
-      1000;
-
-  LOG_DEBUG(LOG_TAG, "%s: PCM bytes per tick %u", __func__,
-            a2dp_sbc_encoder_cb.feeding_state.bytes_per_tick);
+  a2dp_encoder_pipeline_reset(&a2dp_sbc_encoder_cb.pipeline,
+                              &a2dp_sbc_encoder_cb.feeding_params,
+                              A2DP_SBC_ENCODER_INTERVAL_MS);
 }
 
 void a2dp_sbc_feeding_flush(void) {
@@ -427,8 +425,30 @@ void a2dp_sbc_feeding_flush(void) {
                      "sbc is running in offload mode");
     return;
   }
-  a2dp_sbc_encoder_cb.feeding_state.counter = 0;
+  a2dp_sbc_encoder_cb.pipeline.counter = 0;
   a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue = 0;
+  /* drop the resampler history along with the residue */
+  a2dp_sbc_encoder_cb.feeding_state.resampler_checked = false;
+}
+
+void a2dp_sbc_set_transmit_queue_length(size_t transmit_queue_length) {
+  if (A2DP_IsCodecEnabledInOffload(BTAV_A2DP_CODEC_INDEX_SOURCE_SBC)) return;
+  if (a2dp_sbc_encoder_cb.abr_base_bitpool == 0) return;
+  if (!a2dp_abr_update(&a2dp_sbc_encoder_cb.abr, transmit_queue_length))
+    return;
+
+  int16_t bitpool = (int16_t)a2dp_abr_scale(
+      &a2dp_sbc_encoder_cb.abr, a2dp_sbc_encoder_cb.abr_base_bitpool);
+  if (bitpool < a2dp_sbc_encoder_cb.abr_min_bitpool)
+    bitpool = a2dp_sbc_encoder_cb.abr_min_bitpool;
+  if (bitpool > a2dp_sbc_encoder_cb.abr_base_bitpool)
+    bitpool = a2dp_sbc_encoder_cb.abr_base_bitpool;
+
+  /* Each frame carries its bitpool, the peer follows without reconfiguring */
+  LOG_INFO(LOG_TAG, "%s: bitpool %d -> %d", __func__,
+           a2dp_sbc_encoder_cb.sbc_encoder_params.s16BitPool, bitpool);
+  a2dp_sbc_encoder_cb.sbc_encoder_params.s16BitPool = bitpool;
+  a2dp_sbc_encoder_cb.tx_sbc_frames = calculate_max_frames_per_packet();
 }
 
 period_ms_t a2dp_sbc_get_encoder_interval_ms(void) {
@@ -454,9 +474,10 @@ void a2dp_sbc_send_frames(uint64_t timestamp_us) {
               __func__, nb_frame, nb_iterations);
   if (nb_frame == 0) return;
 
+  a2dp_sbc_encoder_cb.pipeline.mtu = a2dp_sbc_encoder_cb.TxAaMtuSize;
   for (uint8_t counter = 0; counter < nb_iterations; counter++) {
     // Transcode frame and enqueue
-    a2dp_sbc_encode_frames(nb_frame);
+    a2dp_encoder_pipeline_encode(&a2dp_sbc_encoder_cb.pipeline, nb_frame);
   }
 }
 
@@ -478,35 +499,13 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
   LOG_VERBOSE(LOG_TAG, "%s: pcm_bytes_per_frame %u", __func__,
               pcm_bytes_per_frame);
 
-  uint32_t hecto_ns_this_tick = A2DP_SBC_ENCODER_INTERVAL_MS * 10000;
-  uint64_t* last_100ns =
-      &a2dp_sbc_encoder_cb.feeding_state.last_frame_timestamp_100ns;
-  uint64_t now_100ns = timestamp_us * 10;
-  if (*last_100ns != 0) {
-    hecto_ns_this_tick = (now_100ns - *last_100ns);
-  }
-  *last_100ns = now_100ns;
-
-  uint32_t bytes_this_tick = a2dp_sbc_encoder_cb.feeding_state.bytes_per_tick *
-                             hecto_ns_this_tick /
-                             (A2DP_SBC_ENCODER_INTERVAL_MS * 10000);
-  a2dp_sbc_encoder_cb.feeding_state.counter += bytes_this_tick;
-  // Without this erratum, there was a three microseocnd shift per tick which
-  // would cause one SBC frame mismatched after every 20 seconds
-  uint32_t erratum_100ns =
-      ceil(1.0f * A2DP_SBC_ENCODER_INTERVAL_MS * 10000 * bytes_this_tick /
-           a2dp_sbc_encoder_cb.feeding_state.bytes_per_tick);
-  if (erratum_100ns < hecto_ns_this_tick) {
-    LOG_VERBOSE(LOG_TAG, "%s: hecto_ns_this_tick=%d, bytes=%d, erratum_100ns=%d",
-                __func__, hecto_ns_this_tick, bytes_this_tick, erratum_100ns);
-    *last_100ns -= hecto_ns_this_tick - erratum_100ns;
-  }
+  tA2DP_ENCODER_PIPELINE* p_pipeline = &a2dp_sbc_encoder_cb.pipeline;
+  p_pipeline->pcm_bytes_per_frame = pcm_bytes_per_frame;
 
   /* Calculate the number of frames pending for this media tick */
-  projected_nof =
-      a2dp_sbc_encoder_cb.feeding_state.counter / pcm_bytes_per_frame;
+  projected_nof = a2dp_encoder_pipeline_tick(p_pipeline, timestamp_us);
   // Update the stats
-  a2dp_sbc_encoder_cb.stats.media_read_total_expected_frames += projected_nof;
+  p_pipeline->stats.media_read_total_expected_frames += projected_nof;
 
   if (projected_nof > MAX_PCM_FRAME_NUM_PER_TICK) {
     LOG_WARN(LOG_TAG, "%s: limiting frames to be sent from %d to %d", __func__,
@@ -514,7 +513,7 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
 
     // Update the stats
     size_t delta = projected_nof - MAX_PCM_FRAME_NUM_PER_TICK;
-    a2dp_sbc_encoder_cb.stats.media_read_total_dropped_frames += delta;
+    p_pipeline->stats.media_read_total_dropped_frames += delta;
 
     projected_nof = MAX_PCM_FRAME_NUM_PER_TICK;
   }
@@ -543,8 +542,7 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
           LOG_ERROR(LOG_TAG, "%s: Audio Congestion (iterations:%d > max (%d))",
                     __func__, noi, A2DP_SBC_MAX_PCM_ITER_NUM_PER_TICK);
           noi = A2DP_SBC_MAX_PCM_ITER_NUM_PER_TICK;
-          a2dp_sbc_encoder_cb.feeding_state.counter =
-              noi * nof * pcm_bytes_per_frame;
+          p_pipeline->counter = noi * nof * pcm_bytes_per_frame;
         }
         projected_nof = nof;
       } else {
@@ -563,15 +561,14 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
 
       // Update the stats
       size_t delta = projected_nof - MAX_PCM_FRAME_NUM_PER_TICK;
-      a2dp_sbc_encoder_cb.stats.media_read_total_dropped_frames += delta;
+      p_pipeline->stats.media_read_total_dropped_frames += delta;
 
       projected_nof = MAX_PCM_FRAME_NUM_PER_TICK;
-      a2dp_sbc_encoder_cb.feeding_state.counter =
-          noi * projected_nof * pcm_bytes_per_frame;
+      p_pipeline->counter = noi * projected_nof * pcm_bytes_per_frame;
     }
     nof = projected_nof;
   }
-  a2dp_sbc_encoder_cb.feeding_state.counter -= noi * nof * pcm_bytes_per_frame;
+  p_pipeline->counter -= noi * nof * pcm_bytes_per_frame;
   LOG_VERBOSE(LOG_TAG, "%s: effective num of frames %u, iterations %u",
               __func__, nof, noi);
 
@@ -579,81 +576,26 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
   *num_of_iterations = noi;
 }
 
-static void a2dp_sbc_encode_frames(uint8_t nb_frame) {
+static bool a2dp_sbc_encode_frame(const uint8_t* p_pcm, uint8_t* p_out,
+                                  uint32_t out_size,
+                                  tA2DP_ENCODED_FRAME* p_encoded) {
   SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
-  uint8_t remain_nb_frame = nb_frame;
   uint16_t blocm_x_subband =
       p_encoder_params->s16NumOfSubBands * p_encoder_params->s16NumOfBlocks;
 
-  uint8_t last_frame_len = 0;
-  while (nb_frame) {
-    BT_HDR* p_buf = (BT_HDR*)osi_malloc(A2DP_SBC_BUFFER_SIZE);
-    uint32_t bytes_read = 0;
-    p_buf->offset = A2DP_SBC_OFFSET;
-    p_buf->len = 0;
-    p_buf->layer_specific = 0;
-    a2dp_sbc_encoder_cb.stats.media_read_total_expected_packets++;
-
-    do {
-      /* Fill allocated buffer with 0 */
-      memset(a2dp_sbc_encoder_cb.pcmBuffer, 0,
-             blocm_x_subband * p_encoder_params->s16NumOfChannels);
-
-      // Read the PCM data and encode it. If necessary, upsample the data.
-      uint32_t num_bytes = 0;
-      if (a2dp_sbc_read_feeding(&num_bytes)) {
-        uint8_t* output = (uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len;
-        int16_t* input = a2dp_sbc_encoder_cb.pcmBuffer;
-        uint16_t output_len = SBC_Encode(p_encoder_params, input, output);
-        last_frame_len = output_len;
-
-        /* Update SBC frame length */
-        p_buf->len += output_len;
-        nb_frame--;
-        p_buf->layer_specific++;
-        bytes_read += num_bytes;
-      } else {
-        LOG_WARN(LOG_TAG, "%s: underflow %d, %d", __func__, nb_frame,
-                 a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue);
-        a2dp_sbc_encoder_cb.feeding_state.counter +=
-            nb_frame * p_encoder_params->s16NumOfSubBands *
-            p_encoder_params->s16NumOfBlocks *
-            a2dp_sbc_encoder_cb.feeding_params.channel_count *
-            a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8;
-        /* no more pcm to read */
-        nb_frame = 0;
-      }
-    } while (
-        ((p_buf->len + last_frame_len) < a2dp_sbc_encoder_cb.TxAaMtuSize) &&
-        (p_buf->layer_specific < 0x0F) && nb_frame);
-
-    if (p_buf->len) {
-      /*
-       * Timestamp of the media packet header represent the TS of the
-       * first SBC frame, i.e the timestamp before including this frame.
-       */
-      *((uint32_t*)(p_buf + 1)) = a2dp_sbc_encoder_cb.timestamp;
-
-      a2dp_sbc_encoder_cb.timestamp += p_buf->layer_specific * blocm_x_subband;
-
-      uint8_t done_nb_frame = remain_nb_frame - nb_frame;
-      remain_nb_frame = nb_frame;
-      if (!a2dp_sbc_encoder_cb.enqueue_callback(p_buf, done_nb_frame,
-                                                bytes_read)) {
-        LOG_WARN(LOG_TAG, "%s: enqueue discarded done_nb_frame: %d,"
-                 "bytes_read: %d, len: %d, last_frame_len: %d",
-                 __func__, done_nb_frame, bytes_read, p_buf->len, last_frame_len);
-        return;
-      }
-    } else {
-      a2dp_sbc_encoder_cb.stats.media_read_total_dropped_packets++;
-      osi_free(p_buf);
-    }
-  }
+  if (out_size < a2dp_sbc_frame_length()) return false;
+
+  int16_t* input = (int16_t*)const_cast<uint8_t*>(p_pcm);
+  /* Update SBC frame length */
+  p_encoded->bytes = SBC_Encode(p_encoder_params, input, p_out);
+  p_encoded->frames = 1;
+  p_encoded->samples = blocm_x_subband;
+  return true;
 }
 
-static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
+static bool a2dp_sbc_read_feeding(uint8_t* p_pcm, uint32_t* bytes_read) {
   SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
+  tA2DP_ENCODER_PIPELINE* p_pipeline = &a2dp_sbc_encoder_cb.pipeline;
   uint16_t blocm_x_subband =
       p_encoder_params->s16NumOfSubBands * p_encoder_params->s16NumOfBlocks;
   uint32_t read_size;
@@ -675,6 +617,10 @@ static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
   int32_t fract_threshold;
   uint32_t nb_byte_read;
 
+  /* Fill the PCM staging buffer with 0 */
+  memset(p_pcm, 0, blocm_x_subband * p_encoder_params->s16NumOfChannels *
+                      sizeof(int16_t));
+
   /* Get the SBC sampling rate */
   switch (p_encoder_params->s16SamplingFreq) {
     case SBC_sf48000:
@@ -691,16 +637,15 @@ static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
       break;
   }
 
-  a2dp_sbc_encoder_cb.stats.media_read_total_expected_reads_count++;
+  p_pipeline->stats.media_read_total_expected_reads_count++;
   if (sbc_sampling == a2dp_sbc_encoder_cb.feeding_params.sample_rate) {
     read_size =
         bytes_needed - a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue;
-    a2dp_sbc_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
-    nb_byte_read = a2dp_sbc_encoder_cb.read_callback(
-        ((uint8_t*)a2dp_sbc_encoder_cb.pcmBuffer) +
-            a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
+    p_pipeline->stats.media_read_total_expected_read_bytes += read_size;
+    nb_byte_read = p_pipeline->read_callback(
+        p_pcm + a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
         read_size);
-    a2dp_sbc_encoder_cb.stats.media_read_total_actual_read_bytes +=
+    p_pipeline->stats.media_read_total_actual_read_bytes +=
         nb_byte_read;
 
     *bytes_read = nb_byte_read;
@@ -708,11 +653,27 @@ static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
       a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue += nb_byte_read;
       return false;
     }
-    a2dp_sbc_encoder_cb.stats.media_read_total_actual_reads_count++;
+    p_pipeline->stats.media_read_total_actual_reads_count++;
     a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue = 0;
     return true;
   }
 
+  if (!a2dp_sbc_encoder_cb.feeding_state.resampler_checked) {
+    a2dp_sbc_encoder_cb.feeding_state.use_resampler = a2dp_sbc_resampler_init(
+        a2dp_sbc_encoder_cb.feeding_params.sample_rate, sbc_sampling,
+        a2dp_sbc_encoder_cb.feeding_params.bits_per_sample,
+        a2dp_sbc_encoder_cb.feeding_params.channel_count,
+        p_encoder_params->s16NumOfChannels);
+    a2dp_sbc_encoder_cb.feeding_state.resampler_checked = true;
+    LOG_INFO(LOG_TAG, "%s: %u Hz feeding to %u Hz SBC, %s", __func__,
+             a2dp_sbc_encoder_cb.feeding_params.sample_rate, sbc_sampling,
+             a2dp_sbc_encoder_cb.feeding_state.use_resampler
+                 ? "polyphase resampler"
+                 : "up-sampler");
+  }
+  if (a2dp_sbc_encoder_cb.feeding_state.use_resampler)
+    return a2dp_sbc_read_resampled_feeding(p_pcm, bytes_read);
+
   /*
    * Some Feeding PCM frequencies require to split the number of sample
    * to read.
@@ -755,12 +716,12 @@ static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
   read_size = src_samples;
   read_size *= a2dp_sbc_encoder_cb.feeding_params.channel_count;
   read_size *= (a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8);
-  a2dp_sbc_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
+  p_pipeline->stats.media_read_total_expected_read_bytes += read_size;
 
   /* Read Data from UIPC channel */
   nb_byte_read =
-      a2dp_sbc_encoder_cb.read_callback((uint8_t*)read_buffer, read_size);
-  a2dp_sbc_encoder_cb.stats.media_read_total_actual_read_bytes += nb_byte_read;
+      p_pipeline->read_callback((uint8_t*)read_buffer, read_size);
+  p_pipeline->stats.media_read_total_actual_read_bytes += nb_byte_read;
 
   if (nb_byte_read < read_size) {
     if (nb_byte_read == 0) return false;
@@ -769,7 +730,7 @@ static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
     memset(((uint8_t*)read_buffer) + nb_byte_read, 0, read_size - nb_byte_read);
     nb_byte_read = read_size;
   }
-  a2dp_sbc_encoder_cb.stats.media_read_total_actual_reads_count++;
+  p_pipeline->stats.media_read_total_actual_reads_count++;
 
   /* Initialize PCM up-sampling engine */
   a2dp_sbc_init_up_sample(a2dp_sbc_encoder_cb.feeding_params.sample_rate,
@@ -797,8 +758,7 @@ static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
     return false;
 
   /* Copy the output pcm samples in SBC encoding buffer */
-  memcpy((uint8_t*)a2dp_sbc_encoder_cb.pcmBuffer, (uint8_t*)up_sampled_buffer,
-         bytes_needed);
+  memcpy(p_pcm, (uint8_t*)up_sampled_buffer, bytes_needed);
   /* update the residue */
   a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue -= bytes_needed;
 
@@ -810,6 +770,77 @@ static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
   return true;
 }
 
+/* Reads the feeding through the polyphase resampler. The residue is the
+ * converted pcm kept for the next SBC frame. */
+static bool a2dp_sbc_read_resampled_feeding(uint8_t* p_pcm,
+                                            uint32_t* bytes_read) {
+  SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
+  tA2DP_ENCODER_PIPELINE* p_pipeline = &a2dp_sbc_encoder_cb.pipeline;
+  tA2DP_SBC_FEEDING_STATE* p_state = &a2dp_sbc_encoder_cb.feeding_state;
+  uint32_t frames_needed =
+      p_encoder_params->s16NumOfSubBands * p_encoder_params->s16NumOfBlocks;
+  uint32_t frame_bytes = p_encoder_params->s16NumOfChannels * sizeof(int16_t);
+  uint32_t bytes_needed = frames_needed * frame_bytes;
+  uint32_t src_frame_bytes =
+      a2dp_sbc_encoder_cb.feeding_params.channel_count *
+      a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8;
+  /* one SBC frame, and what the resampler may produce past it */
+  static int16_t resampled_buffer[SBC_MAX_NUM_OF_BLOCKS *
+                                  SBC_MAX_NUM_OF_SUBBANDS *
+                                  SBC_MAX_NUM_OF_CHANNELS * 2];
+  /* 32 bit stereo source of an SBC frame, up to 48 kHz feeding at 16 kHz */
+  static int32_t read_buffer[SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_SUBBANDS *
+                             SBC_MAX_NUM_OF_CHANNELS * 4 * 2];
+  uint32_t dst_frames_max = sizeof(resampled_buffer) / frame_bytes;
+  uint32_t dst_frames = p_state->aa_feed_residue / frame_bytes;
+
+  *bytes_read = 0;
+  if (dst_frames < frames_needed) {
+    uint32_t src_frames =
+        a2dp_sbc_resampler_input_frames(frames_needed - dst_frames);
+    uint32_t read_size = src_frames * src_frame_bytes;
+
+    if (read_size > sizeof(read_buffer)) {
+      LOG_ERROR(LOG_TAG, "%s: %u bytes do not fit the read buffer", __func__,
+                read_size);
+      return false;
+    }
+
+    p_pipeline->stats.media_read_total_expected_read_bytes +=
+        read_size;
+    uint32_t nb_byte_read =
+        p_pipeline->read_callback((uint8_t*)read_buffer, read_size);
+    p_pipeline->stats.media_read_total_actual_read_bytes +=
+        nb_byte_read;
+    if (nb_byte_read == 0) return false;
+
+    /* Fill the unfilled part of the read buffer with silence (0) */
+    if (nb_byte_read < read_size)
+      memset((uint8_t*)read_buffer + nb_byte_read, 0, read_size - nb_byte_read);
+    p_pipeline->stats.media_read_total_actual_reads_count++;
+    *bytes_read = nb_byte_read;
+
+    dst_frames += a2dp_sbc_resampler_process(
+        read_buffer, src_frames,
+        resampled_buffer + dst_frames * p_encoder_params->s16NumOfChannels,
+        dst_frames_max - dst_frames);
+  }
+
+  if (dst_frames < frames_needed) {
+    p_state->aa_feed_residue = dst_frames * frame_bytes;
+    return false;
+  }
+
+  /* Copy the output pcm samples in SBC encoding buffer */
+  memcpy(p_pcm, resampled_buffer, bytes_needed);
+  p_state->aa_feed_residue = (dst_frames - frames_needed) * frame_bytes;
+  if (p_state->aa_feed_residue != 0) {
+    memmove(resampled_buffer, (uint8_t*)resampled_buffer + bytes_needed,
+            p_state->aa_feed_residue);
+  }
+  return true;
+}
+
 static uint8_t calculate_max_frames_per_packet(void) {
   uint16_t effective_mtu_size = a2dp_sbc_encoder_cb.TxAaMtuSize;
   SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
@@ -901,11 +932,11 @@ static uint16_t a2dp_sbc_offload_source_rate(bool is_peer_edr) {
   LOG_DEBUG(LOG_TAG,"%s rate = %d",__func__,rate);
   return rate;
 }
+OSI_CACHED_PROPERTY(sbc_mq_property, "persist.vendor.btstack.sbcmq", false);
+
 static uint16_t a2dp_sbc_source_rate(void) {
   uint16_t rate = A2DP_SBC_DEFAULT_BITRATE;
-  char value[PROPERTY_VALUE_MAX] = {'\0'};
-  osi_property_get("persist.vendor.btstack.sbcmq", value, "false");
-  if (!(strcmp(value,"true"))) {
+  if (osi_cached_property_get_bool(&sbc_mq_property)) {
      LOG_ERROR(LOG_TAG,"%s:MQ enabled",__func__);
      return A2DP_SBC_NON_EDR_MAX_RATE;
   }
@@ -1135,31 +1166,22 @@ period_ms_t A2dpCodecConfigSbc::encoderIntervalMs() const {
 }
 
 void A2dpCodecConfigSbc::debug_codec_dump(int fd) {
-  a2dp_sbc_encoder_stats_t* stats = &a2dp_sbc_encoder_cb.stats;
+  const tA2DP_ENCODER_STATS* stats = &a2dp_sbc_encoder_cb.pipeline.stats;
 
   A2dpCodecConfig::debug_codec_dump(fd);
 
-  dprintf(fd,
-          "  Packet counts (expected/dropped)                        : %zu / "
-          "%zu\n",
-          stats->media_read_total_expected_packets,
-          stats->media_read_total_dropped_packets);
-
-  dprintf(fd,
-          "  PCM read counts (expected/actual)                       : %zu / "
-          "%zu\n",
-          stats->media_read_total_expected_reads_count,
-          stats->media_read_total_actual_reads_count);
-
-  dprintf(fd,
-          "  PCM read bytes (expected/actual)                        : %zu / "
-          "%zu\n",
-          stats->media_read_total_expected_read_bytes,
-          stats->media_read_total_actual_read_bytes);
+  a2dp_encoder_pipeline_debug_dump(&a2dp_sbc_encoder_cb.pipeline, fd);
 
   dprintf(fd,
           "  Frames counts (expected/dropped)                        : %zu / "
           "%zu\n",
           stats->media_read_total_expected_frames,
           stats->media_read_total_dropped_frames);
+
+  dprintf(fd,
+          "  Bitpool (current/configured)                            : %d / "
+          "%d\n",
+          a2dp_sbc_encoder_cb.sbc_encoder_params.s16BitPool,
+          a2dp_sbc_encoder_cb.abr_base_bitpool);
+  a2dp_abr_debug_dump(&a2dp_sbc_encoder_cb.abr, fd);
 }
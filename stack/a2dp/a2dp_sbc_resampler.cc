@@ -0,0 +1,338 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains a polyphase FIR resampler for the SBC audio feeding.
+ *
+ *  The conversion ratio is reduced to dst_sps / src_sps = L / M. The
+ *  prototype low pass filter is a Kaiser windowed sinc running at L times the
+ *  source rate, cut at the Nyquist frequency of the slower rate, and split
+ *  in L phases of A2DP_SBC_RESAMPLER_TAPS taps. Each converted sample is the
+ *  dot product of one phase with the last source samples.
+ *
+ ******************************************************************************/
+
+#include "a2dp_sbc_resampler.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define A2DP_SBC_RESAMPLER_SIMD 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define A2DP_SBC_RESAMPLER_SIMD 1
+#else
+#define A2DP_SBC_RESAMPLER_SIMD 0
+#endif
+
+/* Taps per phase, a multiple of 4 */
+#ifndef A2DP_SBC_RESAMPLER_TAPS
+#define A2DP_SBC_RESAMPLER_TAPS 32
+#endif
+
+/* Largest L, 441 is needed for 32 kHz to 44.1 kHz */
+#define A2DP_SBC_RESAMPLER_MAX_PHASES 441
+
+/* Kaiser window beta, about 60 dB of stop band attenuation */
+#define A2DP_SBC_RESAMPLER_KAISER_BETA 6.0
+
+/* Source frames converted to float at a time */
+#define A2DP_SBC_RESAMPLER_BLOCK 256
+
+#define A2DP_SBC_RESAMPLER_HIST (A2DP_SBC_RESAMPLER_TAPS - 1)
+
+typedef struct {
+  uint32_t up;   /* L */
+  uint32_t down; /* M */
+  uint32_t pos;  /* next converted sample, in 1/L source samples */
+  uint8_t bits;
+  uint8_t src_channels;
+  uint8_t dst_channels;
+  uint8_t filt_channels; /* channels going through the filter */
+  bool use_simd;
+  /* last source samples of each channel, oldest first */
+  float hist[2][A2DP_SBC_RESAMPLER_HIST + A2DP_SBC_RESAMPLER_BLOCK];
+  /* phases, with the taps reversed to line up with the history */
+  float coeff[A2DP_SBC_RESAMPLER_MAX_PHASES][A2DP_SBC_RESAMPLER_TAPS]
+      __attribute__((aligned(16)));
+} tA2DP_SBC_RESAMPLER_CB;
+
+static tA2DP_SBC_RESAMPLER_CB a2dp_sbc_rs_cb;
+static bool a2dp_sbc_rs_allow_simd = true;
+
+static uint32_t gcd(uint32_t a, uint32_t b) {
+  while (b != 0) {
+    uint32_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+/* Modified Bessel function of the first kind of order 0 */
+static double bessel_i0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+
+  for (int k = 1; k < 32; k++) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+    if (term < sum * 1e-12) break;
+  }
+  return sum;
+}
+
+static void a2dp_sbc_resampler_make_filter(void) {
+  uint32_t up = a2dp_sbc_rs_cb.up;
+  uint32_t len = up * A2DP_SBC_RESAMPLER_TAPS;
+  double center = (len - 1) / 2.0;
+  /* cutoff in cycles per sample at L times the source rate */
+  double cutoff =
+      0.5 / (a2dp_sbc_rs_cb.up > a2dp_sbc_rs_cb.down ? a2dp_sbc_rs_cb.up
+                                                     : a2dp_sbc_rs_cb.down);
+  double i0_beta = bessel_i0(A2DP_SBC_RESAMPLER_KAISER_BETA);
+
+  for (uint32_t phase = 0; phase < up; phase++) {
+    double taps[A2DP_SBC_RESAMPLER_TAPS];
+    double sum = 0;
+
+    for (uint32_t k = 0; k < A2DP_SBC_RESAMPLER_TAPS; k++) {
+      double n = k * up + phase;
+      double x = n - center;
+      double sinc = (x == 0) ? 1.0 : sin(2.0 * M_PI * cutoff * x) /
+                                         (2.0 * M_PI * cutoff * x);
+      double r = x / center;
+      double window =
+          bessel_i0(A2DP_SBC_RESAMPLER_KAISER_BETA * sqrt(1.0 - r * r)) /
+          i0_beta;
+      taps[k] = sinc * window;
+      sum += taps[k];
+    }
+
+    /* unity gain at DC on every phase */
+    for (uint32_t k = 0; k < A2DP_SBC_RESAMPLER_TAPS; k++) {
+      a2dp_sbc_rs_cb.coeff[phase][A2DP_SBC_RESAMPLER_TAPS - 1 - k] =
+          (float)(taps[k] / sum);
+    }
+  }
+}
+
+static inline float a2dp_sbc_resampler_dot(const float* p_x,
+                                           const float* p_c) {
+  float acc = 0;
+  for (int k = 0; k < A2DP_SBC_RESAMPLER_TAPS; k++) acc += p_x[k] * p_c[k];
+  return acc;
+}
+
+#if (A2DP_SBC_RESAMPLER_SIMD == 1)
+static inline float a2dp_sbc_resampler_dot_simd(const float* p_x,
+                                                const float* p_c) {
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+  float32x4_t acc0 = vdupq_n_f32(0);
+  float32x4_t acc1 = vdupq_n_f32(0);
+  int k = 0;
+
+  for (; k + 8 <= A2DP_SBC_RESAMPLER_TAPS; k += 8) {
+    acc0 = vmlaq_f32(acc0, vld1q_f32(p_x + k), vld1q_f32(p_c + k));
+    acc1 = vmlaq_f32(acc1, vld1q_f32(p_x + k + 4), vld1q_f32(p_c + k + 4));
+  }
+  for (; k < A2DP_SBC_RESAMPLER_TAPS; k += 4)
+    acc0 = vmlaq_f32(acc0, vld1q_f32(p_x + k), vld1q_f32(p_c + k));
+
+  acc0 = vaddq_f32(acc0, acc1);
+  float32x2_t sum = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+  return vget_lane_f32(vpadd_f32(sum, sum), 0);
+#else
+  __m128 acc0 = _mm_setzero_ps();
+  __m128 acc1 = _mm_setzero_ps();
+  int k = 0;
+
+  for (; k + 8 <= A2DP_SBC_RESAMPLER_TAPS; k += 8) {
+    acc0 = _mm_add_ps(acc0,
+                      _mm_mul_ps(_mm_loadu_ps(p_x + k), _mm_load_ps(p_c + k)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(p_x + k + 4),
+                                       _mm_load_ps(p_c + k + 4)));
+  }
+  for (; k < A2DP_SBC_RESAMPLER_TAPS; k += 4)
+    acc0 = _mm_add_ps(acc0,
+                      _mm_mul_ps(_mm_loadu_ps(p_x + k), _mm_load_ps(p_c + k)));
+
+  acc0 = _mm_add_ps(acc0, acc1);
+  acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+  acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+  return _mm_cvtss_f32(acc0);
+#endif
+}
+#endif
+
+static inline int16_t a2dp_sbc_resampler_to_pcm16(float y) {
+  int32_t v = (int32_t)(y >= 0 ? y + 0.5f : y - 0.5f);
+  if (v > INT16_MAX) return INT16_MAX;
+  if (v < INT16_MIN) return INT16_MIN;
+  return (int16_t)v;
+}
+
+/* Source sample |i| of |p_src|, scaled to the 16 bit range */
+static inline float a2dp_sbc_resampler_sample(const uint8_t* p_src,
+                                              uint32_t i) {
+  switch (a2dp_sbc_rs_cb.bits) {
+    case 8:
+      return (float)((int32_t)p_src[i] - 128) * 256.0f;
+    case 24: {
+      const uint8_t* p = p_src + 3 * i;
+      int32_t v = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 |
+                            (uint32_t)p[2] << 24);
+      return (float)v * (1.0f / 65536.0f);
+    }
+    case 32:
+      return (float)((const int32_t*)p_src)[i] * (1.0f / 65536.0f);
+    default:
+      return (float)((const int16_t*)p_src)[i];
+  }
+}
+
+/* Appends |frames| source frames after the history */
+static void a2dp_sbc_resampler_load(const uint8_t* p_src, uint32_t frames) {
+  float* p_left = a2dp_sbc_rs_cb.hist[0] + A2DP_SBC_RESAMPLER_HIST;
+  float* p_right = a2dp_sbc_rs_cb.hist[1] + A2DP_SBC_RESAMPLER_HIST;
+
+  if (a2dp_sbc_rs_cb.src_channels == 1) {
+    for (uint32_t i = 0; i < frames; i++)
+      p_left[i] = a2dp_sbc_resampler_sample(p_src, i);
+  } else if (a2dp_sbc_rs_cb.filt_channels == 1) {
+    for (uint32_t i = 0; i < frames; i++)
+      p_left[i] = (a2dp_sbc_resampler_sample(p_src, 2 * i) +
+                   a2dp_sbc_resampler_sample(p_src, 2 * i + 1)) *
+                  0.5f;
+  } else {
+    for (uint32_t i = 0; i < frames; i++) {
+      p_left[i] = a2dp_sbc_resampler_sample(p_src, 2 * i);
+      p_right[i] = a2dp_sbc_resampler_sample(p_src, 2 * i + 1);
+    }
+  }
+}
+
+bool a2dp_sbc_resampler_init(uint32_t src_sps, uint32_t dst_sps, uint8_t bits,
+                             uint8_t src_channels, uint8_t dst_channels) {
+  if (src_sps == 0 || dst_sps == 0) return false;
+  if (bits != 8 && bits != 16 && bits != 24 && bits != 32) return false;
+  if (src_channels < 1 || src_channels > 2) return false;
+  if (dst_channels < 1 || dst_channels > 2) return false;
+
+  uint32_t div = gcd(src_sps, dst_sps);
+  if (dst_sps / div > A2DP_SBC_RESAMPLER_MAX_PHASES) return false;
+
+  memset(a2dp_sbc_rs_cb.hist, 0, sizeof(a2dp_sbc_rs_cb.hist));
+  a2dp_sbc_rs_cb.pos = 0;
+  a2dp_sbc_rs_cb.bits = bits;
+  a2dp_sbc_rs_cb.src_channels = src_channels;
+  a2dp_sbc_rs_cb.dst_channels = dst_channels;
+  a2dp_sbc_rs_cb.filt_channels =
+      (src_channels < dst_channels) ? src_channels : dst_channels;
+  a2dp_sbc_rs_cb.use_simd = A2DP_SBC_RESAMPLER_SIMD && a2dp_sbc_rs_allow_simd;
+
+  /* keep the filter when only the format changes */
+  if (a2dp_sbc_rs_cb.up != dst_sps / div ||
+      a2dp_sbc_rs_cb.down != src_sps / div) {
+    a2dp_sbc_rs_cb.up = dst_sps / div;
+    a2dp_sbc_rs_cb.down = src_sps / div;
+    a2dp_sbc_resampler_make_filter();
+  }
+  return true;
+}
+
+uint32_t a2dp_sbc_resampler_input_frames(uint32_t dst_frames) {
+  if (dst_frames == 0 || a2dp_sbc_rs_cb.up == 0) return 0;
+
+  uint64_t last = a2dp_sbc_rs_cb.pos +
+                  (uint64_t)(dst_frames - 1) * a2dp_sbc_rs_cb.down;
+  return (uint32_t)(last / a2dp_sbc_rs_cb.up) + 1;
+}
+
+uint32_t a2dp_sbc_resampler_process(const void* p_src, uint32_t src_frames,
+                                    int16_t* p_dst, uint32_t dst_frames_max) {
+  const uint8_t* p_in = (const uint8_t*)p_src;
+  uint32_t in_frame_bytes =
+      a2dp_sbc_rs_cb.src_channels * (a2dp_sbc_rs_cb.bits / 8);
+  uint32_t up = a2dp_sbc_rs_cb.up;
+  uint32_t down = a2dp_sbc_rs_cb.down;
+  bool stereo = (a2dp_sbc_rs_cb.filt_channels == 2);
+  bool duplicate = (a2dp_sbc_rs_cb.dst_channels > a2dp_sbc_rs_cb.filt_channels);
+  uint32_t dst_frames = 0;
+
+  if (up == 0) return 0;
+
+  while (src_frames > 0) {
+    uint32_t frames = (src_frames < A2DP_SBC_RESAMPLER_BLOCK)
+                          ? src_frames
+                          : A2DP_SBC_RESAMPLER_BLOCK;
+    uint32_t end = frames * up;
+
+    a2dp_sbc_resampler_load(p_in, frames);
+
+    for (; a2dp_sbc_rs_cb.pos < end; a2dp_sbc_rs_cb.pos += down) {
+      if (dst_frames >= dst_frames_max) continue;
+
+      uint32_t i = a2dp_sbc_rs_cb.pos / up;
+      const float* p_c = a2dp_sbc_rs_cb.coeff[a2dp_sbc_rs_cb.pos % up];
+      float left, right = 0;
+
+#if (A2DP_SBC_RESAMPLER_SIMD == 1)
+      if (a2dp_sbc_rs_cb.use_simd) {
+        left = a2dp_sbc_resampler_dot_simd(a2dp_sbc_rs_cb.hist[0] + i, p_c);
+        if (stereo)
+          right =
+              a2dp_sbc_resampler_dot_simd(a2dp_sbc_rs_cb.hist[1] + i, p_c);
+      } else
+#endif
+      {
+        left = a2dp_sbc_resampler_dot(a2dp_sbc_rs_cb.hist[0] + i, p_c);
+        if (stereo)
+          right = a2dp_sbc_resampler_dot(a2dp_sbc_rs_cb.hist[1] + i, p_c);
+      }
+
+      *p_dst++ = a2dp_sbc_resampler_to_pcm16(left);
+      if (stereo) {
+        *p_dst++ = a2dp_sbc_resampler_to_pcm16(right);
+      } else if (duplicate) {
+        *p_dst = p_dst[-1];
+        p_dst++;
+      }
+      dst_frames++;
+    }
+    a2dp_sbc_rs_cb.pos -= end;
+
+    /* keep the last source samples for the next block */
+    for (int ch = 0; ch < a2dp_sbc_rs_cb.filt_channels; ch++) {
+      memmove(a2dp_sbc_rs_cb.hist[ch], a2dp_sbc_rs_cb.hist[ch] + frames,
+              A2DP_SBC_RESAMPLER_HIST * sizeof(float));
+    }
+
+    p_in += frames * in_frame_bytes;
+    src_frames -= frames;
+  }
+  return dst_frames;
+}
+
+bool a2dp_sbc_resampler_allow_simd(bool allow) {
+  a2dp_sbc_rs_allow_simd = allow;
+  return A2DP_SBC_RESAMPLER_SIMD == 1;
+}
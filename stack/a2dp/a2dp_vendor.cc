@@ -53,11 +53,18 @@
 
 #define LOG_TAG "a2dp_vendor"
 
+#include <base/bind.h>
+#include <base/location.h>
+
 #include "a2dp_vendor.h"
 #include "a2dp_vendor_aptx.h"
+#include "a2dp_vendor_aptx_encoder.h"
 #include "a2dp_vendor_aptx_hd.h"
+#include "a2dp_vendor_aptx_hd_encoder.h"
 #include "a2dp_vendor_ldac.h"
+#include "a2dp_vendor_ldac_encoder.h"
 #include "bt_target.h"
+#include "common/thread_pool.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "a2dp_vendor_aptx_tws.h"
@@ -790,3 +797,21 @@ bool A2DP_VendorDumpCodecInfo(const uint8_t* p_codec_info) {
 
   return false;
 }
+
+static void a2dp_vendor_load_encoders(void) {
+  // A missing library only means the codec is not offered, as when the codecs
+  // are enumerated
+  if (!A2DP_VendorLoadEncoderAptx())
+    LOG_INFO(LOG_TAG, "%s: aptX encoder not available", __func__);
+  if (!A2DP_VendorLoadEncoderAptxHd())
+    LOG_INFO(LOG_TAG, "%s: aptX-HD encoder not available", __func__);
+  if (!A2DP_VendorLoadEncoderLdac())
+    LOG_INFO(LOG_TAG, "%s: LDAC encoder not available", __func__);
+}
+
+void A2DP_VendorPreloadEncoders(void) {
+  // Without the pool, the libraries are loaded when the codecs are enumerated
+  if (!bluetooth::common::PostToPool(
+          FROM_HERE, base::BindOnce(&a2dp_vendor_load_encoders)))
+    LOG_WARN(LOG_TAG, "%s: thread pool not running", __func__);
+}
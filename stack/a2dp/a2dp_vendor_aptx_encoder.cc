@@ -23,6 +23,9 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <mutex>
+
+#include "a2dp_encoder_pipeline.h"
 #include "a2dp_vendor.h"
 #include "a2dp_vendor_aptx.h"
 #include "bt_common.h"
@@ -38,6 +41,9 @@
 //
 static const char* APTX_ENCODER_LIB_NAME = "libaptX_encoder.so";
 static void* aptx_encoder_lib_handle = NULL;
+// The library may be preloaded off the stack threads, see
+// A2DP_VendorPreloadEncoders()
+static std::recursive_mutex aptx_encoder_lib_mutex;
 
 static const char* APTX_ENCODER_INIT_NAME = "aptxbtenc_init";
 typedef int (*tAPTX_ENCODER_INIT)(void* state, short endian);
@@ -61,6 +67,8 @@ static tAPTX_ENCODER_SIZEOF_PARAMS aptx_encoder_sizeof_params_func;
 #endif
 
 #define A2DP_APTX_MAX_PCM_BYTES_PER_READ 1024
+static_assert(A2DP_APTX_MAX_PCM_BYTES_PER_READ <= A2DP_ENCODER_PCM_STAGING_SIZE,
+              "PCM reads do not fit in the staging buffer");
 
 typedef struct {
   uint64_t sleep_time_ns;
@@ -71,31 +79,15 @@ typedef struct {
 } tAPTX_FRAMING_PARAMS;
 
 typedef struct {
-  uint64_t session_start_us;
-
-  size_t media_read_total_expected_packets;
-  size_t media_read_total_expected_reads_count;
-  size_t media_read_total_expected_read_bytes;
-
-  size_t media_read_total_dropped_packets;
-  size_t media_read_total_actual_reads_count;
-  size_t media_read_total_actual_read_bytes;
-} a2dp_aptx_encoder_stats_t;
-
-typedef struct {
-  a2dp_source_read_callback_t read_callback;
-  a2dp_source_enqueue_callback_t enqueue_callback;
-
   bool use_SCMS_T;
   bool is_peer_edr;          // True if the peer device supports EDR
   bool peer_supports_3mbps;  // True if the peer device supports 3Mbps EDR
   uint16_t peer_mtu;         // MTU of the A2DP peer
-  uint32_t timestamp;        // Timestamp for the A2DP frames
 
   tA2DP_FEEDING_PARAMS feeding_params;
   tAPTX_FRAMING_PARAMS framing_params;
   void* aptx_encoder_state;
-  a2dp_aptx_encoder_stats_t stats;
+  tA2DP_ENCODER_PIPELINE pipeline;
 } tA2DP_APTX_ENCODER_CB;
 
 static tA2DP_APTX_ENCODER_CB a2dp_aptx_encoder_cb;
@@ -111,7 +103,12 @@ static size_t aptx_encode_16bit(tAPTX_FRAMING_PARAMS* framing_params,
                                 size_t* data_out_index, uint16_t* data16_in,
                                 uint8_t* data_out);
 
+static bool a2dp_aptx_encode_frame(const uint8_t* p_pcm, uint8_t* p_out,
+                                   uint32_t out_size,
+                                   tA2DP_ENCODED_FRAME* p_encoded);
+
 bool A2DP_VendorLoadEncoderAptx(void) {
+  std::lock_guard<std::recursive_mutex> lock(aptx_encoder_lib_mutex);
   if (aptx_encoder_lib_handle != NULL) return true;  // Already loaded
 
   // Open the encoder library
@@ -156,6 +153,7 @@ bool A2DP_VendorLoadEncoderAptx(void) {
 }
 
 void A2DP_VendorUnloadEncoderAptx(void) {
+  std::lock_guard<std::recursive_mutex> lock(aptx_encoder_lib_mutex);
   aptx_encoder_init_func = NULL;
   aptx_encoder_encode_stereo_func = NULL;
   aptx_encoder_sizeof_params_func = NULL;
@@ -177,14 +175,16 @@ void a2dp_vendor_aptx_encoder_init(
   }
   memset(&a2dp_aptx_encoder_cb, 0, sizeof(a2dp_aptx_encoder_cb));
 
-  a2dp_aptx_encoder_cb.stats.session_start_us = time_get_os_boottime_us();
-
-  a2dp_aptx_encoder_cb.read_callback = read_callback;
-  a2dp_aptx_encoder_cb.enqueue_callback = enqueue_callback;
+  a2dp_encoder_pipeline_init(&a2dp_aptx_encoder_cb.pipeline, read_callback,
+                             enqueue_callback);
+  a2dp_aptx_encoder_cb.pipeline.encode_frame = a2dp_aptx_encode_frame;
+  a2dp_aptx_encoder_cb.pipeline.offset = A2DP_APTX_OFFSET;
+  // Each tick sends one packet of all the PCM reads of the framing
+  a2dp_aptx_encoder_cb.pipeline.enqueue_frames = 1;
   a2dp_aptx_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
   a2dp_aptx_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
   a2dp_aptx_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_aptx_encoder_cb.timestamp = 0;
+  a2dp_aptx_encoder_cb.pipeline.timestamp = 0;
 
   /* aptX encoder config */
   a2dp_aptx_encoder_cb.use_SCMS_T = false;  // TODO: should be a parameter
@@ -217,7 +217,7 @@ bool A2dpCodecConfigAptx::updateEncoderUserConfig(
   a2dp_aptx_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
   a2dp_aptx_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
   a2dp_aptx_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_aptx_encoder_cb.timestamp = 0;
+  a2dp_aptx_encoder_cb.pipeline.timestamp = 0;
 
   if (a2dp_aptx_encoder_cb.peer_mtu == 0) {
     LOG_ERROR(LOG_TAG,
@@ -400,15 +400,6 @@ void a2dp_vendor_aptx_send_frames(uint64_t timestamp_us) {
   }
   tAPTX_FRAMING_PARAMS* framing_params = &a2dp_aptx_encoder_cb.framing_params;
 
-  // Prepare the packet to send
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
-  p_buf->offset = A2DP_APTX_OFFSET;
-  p_buf->len = 0;
-  p_buf->layer_specific = 0;
-
-  uint8_t* encoded_ptr = (uint8_t*)(p_buf + 1);
-  encoded_ptr += p_buf->offset;
-
   aptx_update_framing_params(framing_params);
 
   //
@@ -416,55 +407,33 @@ void a2dp_vendor_aptx_send_frames(uint64_t timestamp_us) {
   //
   LOG_VERBOSE(LOG_TAG, "%s: %u PCM reads of size %u", __func__,
               framing_params->pcm_reads, framing_params->pcm_bytes_per_read);
-  size_t encoded_ptr_index = 0;
-  size_t pcm_bytes_encoded = 0;
-  uint32_t bytes_read = 0;
-  a2dp_aptx_encoder_cb.stats.media_read_total_expected_packets++;
-  a2dp_aptx_encoder_cb.stats.media_read_total_expected_reads_count +=
-      framing_params->pcm_reads;
-  a2dp_aptx_encoder_cb.stats.media_read_total_expected_read_bytes +=
-      framing_params->pcm_reads * framing_params->pcm_bytes_per_read;
-  for (size_t reads = 0; reads < framing_params->pcm_reads; reads++) {
-    uint16_t read_buffer16[A2DP_APTX_MAX_PCM_BYTES_PER_READ / sizeof(uint16_t)];
-    size_t pcm_bytes_read = a2dp_aptx_encoder_cb.read_callback(
-        (uint8_t*)read_buffer16, framing_params->pcm_bytes_per_read);
-    bytes_read += pcm_bytes_read;
-    a2dp_aptx_encoder_cb.stats.media_read_total_actual_read_bytes +=
-        pcm_bytes_read;
-    if (pcm_bytes_read < framing_params->pcm_bytes_per_read) {
-      LOG_WARN(LOG_TAG,
-               "%s: underflow at PCM reading iteration %zu: read %zu "
-               "instead of %d",
-               __func__, reads, pcm_bytes_read,
-               framing_params->pcm_bytes_per_read);
-      break;
-    }
-    a2dp_aptx_encoder_cb.stats.media_read_total_actual_reads_count++;
-    pcm_bytes_encoded += aptx_encode_16bit(framing_params, &encoded_ptr_index,
-                                           read_buffer16, encoded_ptr);
-  }
+  a2dp_aptx_encoder_cb.pipeline.pcm_bytes_per_frame =
+      framing_params->pcm_bytes_per_read;
+  a2dp_encoder_pipeline_encode(&a2dp_aptx_encoder_cb.pipeline,
+                               framing_params->pcm_reads);
+}
+
+static bool a2dp_aptx_encode_frame(const uint8_t* p_pcm, uint8_t* p_out,
+                                   uint32_t out_size,
+                                   tA2DP_ENCODED_FRAME* p_encoded) {
+  tAPTX_FRAMING_PARAMS* framing_params = &a2dp_aptx_encoder_cb.framing_params;
 
   // Compute the number of encoded bytes
   const int COMPRESSION_RATIO = 4;
-  size_t encoded_bytes = pcm_bytes_encoded / COMPRESSION_RATIO;
-  p_buf->len += encoded_bytes;
-  LOG_VERBOSE(LOG_TAG, "%s: encoded %zu PCM bytes to %zu", __func__,
-              pcm_bytes_encoded, encoded_bytes);
+  if (framing_params->pcm_bytes_per_read / COMPRESSION_RATIO > out_size)
+    return false;
+
+  size_t encoded_ptr_index = 0;
+  size_t pcm_bytes_encoded = aptx_encode_16bit(
+      framing_params, &encoded_ptr_index, (uint16_t*)p_pcm, p_out);
 
   // Update the RTP timestamp
-  *((uint32_t*)(p_buf + 1)) = a2dp_aptx_encoder_cb.timestamp;
   const uint8_t BYTES_PER_FRAME = 2;
-  uint32_t rtp_timestamp =
+  p_encoded->bytes = pcm_bytes_encoded / COMPRESSION_RATIO;
+  p_encoded->samples =
       (pcm_bytes_encoded / a2dp_aptx_encoder_cb.feeding_params.channel_count) /
       BYTES_PER_FRAME;
-  a2dp_aptx_encoder_cb.timestamp += rtp_timestamp;
-
-  if (p_buf->len > 0) {
-    a2dp_aptx_encoder_cb.enqueue_callback(p_buf, 1, bytes_read);
-  } else {
-    a2dp_aptx_encoder_cb.stats.media_read_total_dropped_packets++;
-    osi_free(p_buf);
-  }
+  return true;
 }
 
 static size_t aptx_encode_16bit(tAPTX_FRAMING_PARAMS* framing_params,
@@ -505,25 +474,7 @@ period_ms_t A2dpCodecConfigAptx::encoderIntervalMs() const {
 }
 
 void A2dpCodecConfigAptx::debug_codec_dump(int fd) {
-  a2dp_aptx_encoder_stats_t* stats = &a2dp_aptx_encoder_cb.stats;
-
   A2dpCodecConfig::debug_codec_dump(fd);
 
-  dprintf(fd,
-          "  Packet counts (expected/dropped)                        : %zu / "
-          "%zu\n",
-          stats->media_read_total_expected_packets,
-          stats->media_read_total_dropped_packets);
-
-  dprintf(fd,
-          "  PCM read counts (expected/actual)                       : %zu / "
-          "%zu\n",
-          stats->media_read_total_expected_reads_count,
-          stats->media_read_total_actual_reads_count);
-
-  dprintf(fd,
-          "  PCM read bytes (expected/actual)                        : %zu / "
-          "%zu\n",
-          stats->media_read_total_expected_read_bytes,
-          stats->media_read_total_actual_read_bytes);
+  a2dp_encoder_pipeline_debug_dump(&a2dp_aptx_encoder_cb.pipeline, fd);
 }
@@ -27,8 +27,11 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <mutex>
+
 #include <ldacBT.h>
 
+#include "a2dp_encoder_pipeline.h"
 #include "a2dp_vendor.h"
 #include "a2dp_vendor_ldac.h"
 #include "a2dp_vendor_ldac_abr.h"
@@ -45,6 +48,9 @@
 //
 static const char* LDAC_ENCODER_LIB_NAME = "libldacBT_enc.so";
 static void* ldac_encoder_lib_handle = NULL;
+// The library may be preloaded off the stack threads, see
+// A2DP_VendorPreloadEncoders()
+static std::recursive_mutex ldac_encoder_lib_mutex;
 
 static const char* LDAC_GET_HANDLE_NAME = "ldacBT_get_handle";
 typedef HANDLE_LDAC_BT (*tLDAC_GET_HANDLE)(void);
@@ -102,9 +108,12 @@ static tLDAC_ALTER_EQMID_PRIORITY ldac_alter_eqmid_priority_func;
 static tLDAC_GET_EQMID ldac_get_eqmid_func;
 static tLDAC_GET_ERROR_CODE ldac_get_error_code_func;
 
+// An encoder handle allocated with the library and kept between streams, so
+// starting a stream doesn't allocate one
+static HANDLE_LDAC_BT ldac_spare_handle = NULL;
+
 // A2DP LDAC encoder interval in milliseconds
 #define A2DP_LDAC_ENCODER_INTERVAL_MS 20
-#define A2DP_LDAC_MEDIA_BYTES_PER_FRAME 128
 
 // offset
 #if (BTA_AV_CO_CP_SCMS_T == TRUE)
@@ -115,6 +124,10 @@ static tLDAC_GET_ERROR_CODE ldac_get_error_code_func;
 
 #define L2CA_BASIC_MODE_HDR_SIZE 4
 
+static_assert(LDACBT_MAX_LSU * 4 /* byte/sample */ * 2 /* ch */ <=
+                  A2DP_ENCODER_PCM_STAGING_SIZE,
+              "LDAC frames do not fit in the staging buffer");
+
 typedef struct {
   uint32_t sample_rate;
   uint8_t channel_mode;
@@ -125,26 +138,6 @@ typedef struct {
 } tA2DP_LDAC_ENCODER_PARAMS;
 
 typedef struct {
-  uint32_t counter;
-  uint32_t bytes_per_tick; /* pcm bytes read each media task tick */
-  uint64_t last_frame_us;
-} tA2DP_LDAC_FEEDING_STATE;
-
-typedef struct {
-  uint64_t session_start_us;
-
-  size_t media_read_total_expected_packets;
-  size_t media_read_total_expected_reads_count;
-  size_t media_read_total_expected_read_bytes;
-
-  size_t media_read_total_dropped_packets;
-  size_t media_read_total_actual_reads_count;
-  size_t media_read_total_actual_read_bytes;
-} a2dp_ldac_encoder_stats_t;
-
-typedef struct {
-  a2dp_source_read_callback_t read_callback;
-  a2dp_source_enqueue_callback_t enqueue_callback;
   uint16_t TxAaMtuSize;
   size_t TxQueueLength;
 
@@ -152,7 +145,6 @@ typedef struct {
   bool is_peer_edr;          // True if the peer device supports EDR
   bool peer_supports_3mbps;  // True if the peer device supports 3Mbps EDR
   uint16_t peer_mtu;         // MTU of the A2DP peer
-  uint32_t timestamp;        // Timestamp for the A2DP frames
 
   HANDLE_LDAC_BT ldac_handle;
   bool has_ldac_handle;  // True if ldac_handle is valid
@@ -164,9 +156,8 @@ typedef struct {
 
   tA2DP_FEEDING_PARAMS feeding_params;
   tA2DP_LDAC_ENCODER_PARAMS ldac_encoder_params;
-  tA2DP_LDAC_FEEDING_STATE ldac_feeding_state;
 
-  a2dp_ldac_encoder_stats_t stats;
+  tA2DP_ENCODER_PIPELINE pipeline;
 } tA2DP_LDAC_ENCODER_CB;
 
 static bool ldac_abr_loaded = false;
@@ -178,12 +169,12 @@ static void a2dp_vendor_ldac_encoder_update(uint16_t peer_mtu,
                                             bool* p_restart_input,
                                             bool* p_restart_output,
                                             bool* p_config_updated);
-static void a2dp_ldac_get_num_frame_iteration(uint8_t* num_of_iterations,
-                                              uint8_t* num_of_frames,
-                                              uint64_t timestamp_us);
-static void a2dp_ldac_encode_frames(uint8_t nb_frame);
-static bool a2dp_ldac_read_feeding(uint8_t* read_buffer, uint32_t* bytes_read);
+static bool a2dp_ldac_encode_frame(const uint8_t* p_pcm, uint8_t* p_out,
+                                   uint32_t out_size,
+                                   tA2DP_ENCODED_FRAME* p_encoded);
 static std::string quality_mode_index_to_name(int quality_mode_index);
+static HANDLE_LDAC_BT a2dp_ldac_take_handle(void);
+static void a2dp_ldac_release_handle(HANDLE_LDAC_BT ldac_handle);
 
 static void* load_func(const char* func_name) {
   void* func_ptr = dlsym(ldac_encoder_lib_handle, func_name);
@@ -198,6 +189,7 @@ static void* load_func(const char* func_name) {
 }
 
 bool A2DP_VendorLoadEncoderLdac(void) {
+  std::lock_guard<std::recursive_mutex> lock(ldac_encoder_lib_mutex);
   if (ldac_encoder_lib_handle != NULL) return true;  // Already loaded
 
   // Initialize the control block
@@ -242,6 +234,8 @@ bool A2DP_VendorLoadEncoderLdac(void) {
       (tLDAC_GET_ERROR_CODE)load_func(LDAC_GET_ERROR_CODE_NAME);
   if (ldac_get_error_code_func == NULL) return false;
 
+  ldac_spare_handle = ldac_get_handle_func();
+
   if (!A2DP_VendorLoadLdacAbr()) {
     LOG_WARN(LOG_TAG, "%s: cannot load the LDAC ABR library", __func__);
     ldac_abr_loaded = false;
@@ -252,9 +246,14 @@ bool A2DP_VendorLoadEncoderLdac(void) {
 }
 
 void A2DP_VendorUnloadEncoderLdac(void) {
+  std::lock_guard<std::recursive_mutex> lock(ldac_encoder_lib_mutex);
   // Cleanup any LDAC-related state
-  if (a2dp_ldac_encoder_cb.has_ldac_handle && ldac_free_handle_func != NULL)
-    ldac_free_handle_func(a2dp_ldac_encoder_cb.ldac_handle);
+  if (ldac_free_handle_func != NULL) {
+    if (a2dp_ldac_encoder_cb.has_ldac_handle)
+      ldac_free_handle_func(a2dp_ldac_encoder_cb.ldac_handle);
+    if (ldac_spare_handle != NULL) ldac_free_handle_func(ldac_spare_handle);
+  }
+  ldac_spare_handle = NULL;
   memset(&a2dp_ldac_encoder_cb, 0, sizeof(a2dp_ldac_encoder_cb));
 
   ldac_get_handle_func = NULL;
@@ -282,19 +281,25 @@ void a2dp_vendor_ldac_encoder_init(
     a2dp_source_read_callback_t read_callback,
     a2dp_source_enqueue_callback_t enqueue_callback) {
   if (a2dp_ldac_encoder_cb.has_ldac_handle)
-    ldac_free_handle_func(a2dp_ldac_encoder_cb.ldac_handle);
+    a2dp_ldac_release_handle(a2dp_ldac_encoder_cb.ldac_handle);
   if (a2dp_ldac_encoder_cb.has_ldac_abr_handle)
     a2dp_ldac_abr_free_handle(a2dp_ldac_encoder_cb.ldac_abr_handle);
   memset(&a2dp_ldac_encoder_cb, 0, sizeof(a2dp_ldac_encoder_cb));
 
-  a2dp_ldac_encoder_cb.stats.session_start_us = time_get_os_boottime_us();
+  a2dp_encoder_pipeline_init(&a2dp_ldac_encoder_cb.pipeline, read_callback,
+                             enqueue_callback);
+  a2dp_ldac_encoder_cb.pipeline.encode_frame = a2dp_ldac_encode_frame;
+  a2dp_ldac_encoder_cb.pipeline.offset = A2DP_LDAC_OFFSET;
+  a2dp_ldac_encoder_cb.pipeline.close_on_output = true;
+  // NOTE: Unlike the execution path for other codecs, it is normal for
+  // LDAC to NOT write encoded data to the last buffer if there wasn't
+  // enough data to write to. That data is accumulated internally by
+  // the codec and included in the next iteration.
+  a2dp_ldac_encoder_cb.pipeline.codec_buffers = true;
 
-  a2dp_ldac_encoder_cb.read_callback = read_callback;
-  a2dp_ldac_encoder_cb.enqueue_callback = enqueue_callback;
   a2dp_ldac_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
   a2dp_ldac_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
   a2dp_ldac_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_ldac_encoder_cb.timestamp = 0;
   a2dp_ldac_encoder_cb.ldac_abr_handle = NULL;
   a2dp_ldac_encoder_cb.has_ldac_abr_handle = false;
   a2dp_ldac_encoder_cb.last_ldac_abr_eqmid = -1;
@@ -321,7 +326,7 @@ bool A2dpCodecConfigLdac::updateEncoderUserConfig(
   a2dp_ldac_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
   a2dp_ldac_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
   a2dp_ldac_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_ldac_encoder_cb.timestamp = 0;
+  a2dp_ldac_encoder_cb.pipeline.timestamp = 0;
 
   if (a2dp_ldac_encoder_cb.peer_mtu == 0) {
     LOG_ERROR(LOG_TAG,
@@ -359,7 +364,7 @@ static void a2dp_vendor_ldac_encoder_update(uint16_t peer_mtu,
   *p_config_updated = false;
 
   if (!a2dp_ldac_encoder_cb.has_ldac_handle) {
-    a2dp_ldac_encoder_cb.ldac_handle = ldac_get_handle_func();
+    a2dp_ldac_encoder_cb.ldac_handle = a2dp_ldac_take_handle();
     if (a2dp_ldac_encoder_cb.ldac_handle == NULL) {
       LOG_ERROR(LOG_TAG, "%s: Cannot get LDAC encoder handle", __func__);
       return;  // TODO: Return an error?
@@ -513,7 +518,7 @@ void a2dp_vendor_ldac_encoder_cleanup(void) {
   if (a2dp_ldac_encoder_cb.has_ldac_abr_handle)
     a2dp_ldac_abr_free_handle(a2dp_ldac_encoder_cb.ldac_abr_handle);
   if (a2dp_ldac_encoder_cb.has_ldac_handle)
-    ldac_free_handle_func(a2dp_ldac_encoder_cb.ldac_handle);
+    a2dp_ldac_release_handle(a2dp_ldac_encoder_cb.ldac_handle);
   memset(&a2dp_ldac_encoder_cb, 0, sizeof(a2dp_ldac_encoder_cb));
 }
 
@@ -522,23 +527,16 @@ void a2dp_vendor_ldac_feeding_reset(void) {
     LOG_INFO(LOG_TAG,"LDAC is running in offload mode");
     return;
   }
-  /* By default, just clear the entire state */
-  memset(&a2dp_ldac_encoder_cb.ldac_feeding_state, 0,
-         sizeof(a2dp_ldac_encoder_cb.ldac_feeding_state));
-
-  a2dp_ldac_encoder_cb.ldac_feeding_state.bytes_per_tick =
-      (a2dp_ldac_encoder_cb.feeding_params.sample_rate *
-       a2dp_ldac_encoder_cb.feeding_params.bits_per_sample / 8 *
-       a2dp_ldac_encoder_cb.feeding_params.channel_count *
-       A2DP_LDAC_ENCODER_INTERVAL_MS) /
-      1000;
-
-  LOG_DEBUG(LOG_TAG, "%s: PCM bytes per tick %u", __func__,
-            a2dp_ldac_encoder_cb.ldac_feeding_state.bytes_per_tick);
+  a2dp_ldac_encoder_cb.pipeline.pcm_bytes_per_frame =
+      LDACBT_ENC_LSU * a2dp_ldac_encoder_cb.feeding_params.channel_count *
+      a2dp_ldac_encoder_cb.feeding_params.bits_per_sample / 8;
+  a2dp_encoder_pipeline_reset(&a2dp_ldac_encoder_cb.pipeline,
+                              &a2dp_ldac_encoder_cb.feeding_params,
+                              A2DP_LDAC_ENCODER_INTERVAL_MS);
 }
 
 void a2dp_vendor_ldac_feeding_flush(void) {
-  a2dp_ldac_encoder_cb.ldac_feeding_state.counter = 0;
+  a2dp_ldac_encoder_cb.pipeline.counter = 0;
 }
 
 period_ms_t a2dp_vendor_ldac_get_encoder_interval_ms(void) {
@@ -546,87 +544,38 @@ period_ms_t a2dp_vendor_ldac_get_encoder_interval_ms(void) {
 }
 
 void a2dp_vendor_ldac_send_frames(uint64_t timestamp_us) {
-  uint8_t nb_frame = 0;
-  uint8_t nb_iterations = 0;
-
   if (A2DP_IsCodecEnabledInOffload(BTAV_A2DP_CODEC_INDEX_SOURCE_LDAC)) {
     LOG_INFO(LOG_TAG,"LDAC is running in offload mode");
     return;
   }
 
-  a2dp_ldac_get_num_frame_iteration(&nb_iterations, &nb_frame, timestamp_us);
-  LOG_VERBOSE(LOG_TAG, "%s: Sending %d frames per iteration, %d iterations",
-              __func__, nb_frame, nb_iterations);
+  uint32_t nb_frame = a2dp_encoder_pipeline_schedule(
+      &a2dp_ldac_encoder_cb.pipeline, timestamp_us);
+  LOG_VERBOSE(LOG_TAG, "%s: Sending %u frames", __func__, nb_frame);
   if (nb_frame == 0) return;
 
-  for (uint8_t counter = 0; counter < nb_iterations; counter++) {
-    if (a2dp_ldac_encoder_cb.has_ldac_abr_handle) {
-      int flag_enable = 1;
-      int prev_eqmid = a2dp_ldac_encoder_cb.last_ldac_abr_eqmid;
-      a2dp_ldac_encoder_cb.last_ldac_abr_eqmid =
-          a2dp_ldac_abr_proc(a2dp_ldac_encoder_cb.ldac_handle,
-                             a2dp_ldac_encoder_cb.ldac_abr_handle,
-                             a2dp_ldac_encoder_cb.TxQueueLength, flag_enable);
-      if (prev_eqmid != a2dp_ldac_encoder_cb.last_ldac_abr_eqmid)
-        a2dp_ldac_encoder_cb.ldac_abr_adjustments++;
+  if (a2dp_ldac_encoder_cb.has_ldac_abr_handle) {
+    int flag_enable = 1;
+    int prev_eqmid = a2dp_ldac_encoder_cb.last_ldac_abr_eqmid;
+    a2dp_ldac_encoder_cb.last_ldac_abr_eqmid =
+        a2dp_ldac_abr_proc(a2dp_ldac_encoder_cb.ldac_handle,
+                           a2dp_ldac_encoder_cb.ldac_abr_handle,
+                           a2dp_ldac_encoder_cb.TxQueueLength, flag_enable);
+    if (prev_eqmid != a2dp_ldac_encoder_cb.last_ldac_abr_eqmid)
+      a2dp_ldac_encoder_cb.ldac_abr_adjustments++;
 #ifndef OS_GENERIC
-      ATRACE_INT("LDAC ABR level", a2dp_ldac_encoder_cb.last_ldac_abr_eqmid);
+    ATRACE_INT("LDAC ABR level", a2dp_ldac_encoder_cb.last_ldac_abr_eqmid);
 #endif
-    }
-    // Transcode frame and enqueue
-    a2dp_ldac_encode_frames(nb_frame);
   }
+  // Transcode frame and enqueue
+  a2dp_encoder_pipeline_encode(&a2dp_ldac_encoder_cb.pipeline, nb_frame);
 }
 
-// Obtains the number of frames to send and number of iterations
-// to be used. |num_of_iterations| and |num_of_frames| parameters
-// are used as output param for returning the respective values.
-static void a2dp_ldac_get_num_frame_iteration(uint8_t* num_of_iterations,
-                                              uint8_t* num_of_frames,
-                                              uint64_t timestamp_us) {
-  uint32_t result = 0;
-  uint8_t nof = 0;
-  uint8_t noi = 1;
-
-  uint32_t pcm_bytes_per_frame =
-      A2DP_LDAC_MEDIA_BYTES_PER_FRAME *
-      a2dp_ldac_encoder_cb.feeding_params.channel_count *
-      a2dp_ldac_encoder_cb.feeding_params.bits_per_sample / 8;
-  LOG_VERBOSE(LOG_TAG, "%s: pcm_bytes_per_frame %u", __func__,
-              pcm_bytes_per_frame);
-
-  uint32_t us_this_tick = A2DP_LDAC_ENCODER_INTERVAL_MS * 1000;
-  uint64_t now_us = timestamp_us;
-  if (a2dp_ldac_encoder_cb.ldac_feeding_state.last_frame_us != 0)
-    us_this_tick =
-        (now_us - a2dp_ldac_encoder_cb.ldac_feeding_state.last_frame_us);
-  a2dp_ldac_encoder_cb.ldac_feeding_state.last_frame_us = now_us;
-
-  a2dp_ldac_encoder_cb.ldac_feeding_state.counter +=
-      a2dp_ldac_encoder_cb.ldac_feeding_state.bytes_per_tick * us_this_tick /
-      (A2DP_LDAC_ENCODER_INTERVAL_MS * 1000);
-
-  result =
-      a2dp_ldac_encoder_cb.ldac_feeding_state.counter / pcm_bytes_per_frame;
-  a2dp_ldac_encoder_cb.ldac_feeding_state.counter -=
-      result * pcm_bytes_per_frame;
-  nof = result;
-
-  LOG_VERBOSE(LOG_TAG, "%s: effective num of frames %u, iterations %u",
-              __func__, nof, noi);
-
-  *num_of_frames = nof;
-  *num_of_iterations = noi;
-}
-
-static void a2dp_ldac_encode_frames(uint8_t nb_frame) {
-  tA2DP_LDAC_ENCODER_PARAMS* p_encoder_params =
-      &a2dp_ldac_encoder_cb.ldac_encoder_params;
-  uint8_t remain_nb_frame = nb_frame;
+static bool a2dp_ldac_encode_frame(const uint8_t* p_pcm, uint8_t* p_out,
+                                   uint32_t out_size,
+                                   tA2DP_ENCODED_FRAME* p_encoded) {
   uint16_t ldac_frame_size;
-  uint8_t read_buffer[LDACBT_MAX_LSU * 4 /* byte/sample */ * 2 /* ch */];
-
-  switch (p_encoder_params->sample_rate) {
+  switch (a2dp_ldac_encoder_cb.ldac_encoder_params.sample_rate) {
     case 176400:
     case 192000:
       ldac_frame_size = 512;  // sample/ch
@@ -642,119 +591,54 @@ static void a2dp_ldac_encode_frames(uint8_t nb_frame) {
       break;
   }
 
-  uint32_t count;
+  if (a2dp_ldac_encoder_cb.ldac_handle == NULL) {
+    LOG_ERROR(LOG_TAG, "%s: invalid LDAC handle", __func__);
+    return false;
+  }
+
+  // The packet buffer always has room for the largest LDAC frame
+  (void)out_size;
   int32_t encode_count = 0;
   int32_t out_frames = 0;
   int written = 0;
-
-  uint32_t bytes_read = 0;
-  while (nb_frame) {
-    BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
-    p_buf->offset = A2DP_LDAC_OFFSET;
-    p_buf->len = 0;
-    p_buf->layer_specific = 0;
-    a2dp_ldac_encoder_cb.stats.media_read_total_expected_packets++;
-
-    count = 0;
-    do {
-      // Read the PCM data and encode it
-      uint32_t temp_bytes_read = 0;
-      if (a2dp_ldac_read_feeding(read_buffer, &temp_bytes_read)) {
-        bytes_read += temp_bytes_read;
-        uint8_t* packet = (uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len;
-        if (a2dp_ldac_encoder_cb.ldac_handle == NULL) {
-          LOG_ERROR(LOG_TAG, "%s: invalid LDAC handle", __func__);
-          LOG_WARN(LOG_TAG, "%s: nb_frame: %d, bytes_read: %d, count: %d, len: %d",
-                   __func__, nb_frame, bytes_read, count, p_buf->len);
-          a2dp_ldac_encoder_cb.stats.media_read_total_dropped_packets++;
-          osi_free(p_buf);
-          return;
-        }
-        int result = ldac_encode_func(
-            a2dp_ldac_encoder_cb.ldac_handle, read_buffer, (int*)&encode_count,
-            packet + count, (int*)&written, (int*)&out_frames);
-        if (result != 0) {
-          int err_code =
-              ldac_get_error_code_func(a2dp_ldac_encoder_cb.ldac_handle);
-          LOG_ERROR(LOG_TAG,
-                    "%s: LDAC encoding error: %d api_error = %d "
-                    "handle_error = %d block_error = %d",
-                    __func__, result, LDACBT_API_ERR(err_code),
-                    LDACBT_HANDLE_ERR(err_code), LDACBT_BLOCK_ERR(err_code));
-          LOG_WARN(LOG_TAG, "%s: nb_frame: %d, bytes_read: %d count: %d, len: %d",
-                   __func__, nb_frame, bytes_read, count, p_buf->len);
-          a2dp_ldac_encoder_cb.stats.media_read_total_dropped_packets++;
-          osi_free(p_buf);
-          return;
-        }
-        count += written;
-        p_buf->len += written;
-        nb_frame--;
-        p_buf->layer_specific += out_frames;  // added a frame to the buffer
-      } else {
-        LOG_WARN(LOG_TAG, "%s: underflow %d", __func__, nb_frame);
-        a2dp_ldac_encoder_cb.ldac_feeding_state.counter +=
-            nb_frame * LDACBT_ENC_LSU *
-            a2dp_ldac_encoder_cb.feeding_params.channel_count *
-            a2dp_ldac_encoder_cb.feeding_params.bits_per_sample / 8;
-
-        // no more pcm to read
-        nb_frame = 0;
-      }
-    } while ((written == 0) && nb_frame);
-
-    if (p_buf->len) {
-      /*
-       * Timestamp of the media packet header represent the TS of the
-       * first frame, i.e the timestamp before including this frame.
-       */
-      *((uint32_t*)(p_buf + 1)) = a2dp_ldac_encoder_cb.timestamp;
-
-      a2dp_ldac_encoder_cb.timestamp += p_buf->layer_specific * ldac_frame_size;
-
-      uint8_t done_nb_frame = remain_nb_frame - nb_frame;
-      remain_nb_frame = nb_frame;
-      if (!a2dp_ldac_encoder_cb.enqueue_callback(p_buf, done_nb_frame,
-                                                 bytes_read)) {
-        LOG_WARN(LOG_TAG, "%s: enqueue discarded done_nb_frame: %d"
-                 " bytes_read: %d, len: %d, count: %d",
-                 __func__, done_nb_frame, bytes_read, p_buf->len, count);
-        return;
-      }
-    } else {
-      // NOTE: Unlike the execution path for other codecs, it is normal for
-      // LDAC to NOT write encoded data to the last buffer if there wasn't
-      // enough data to write to. That data is accumulated internally by
-      // the codec and included in the next iteration. Therefore, here we
-      // don't increment the "media_read_total_dropped_packets" counter.
-      osi_free(p_buf);
-    }
+  int result = ldac_encode_func(
+      a2dp_ldac_encoder_cb.ldac_handle, const_cast<uint8_t*>(p_pcm),
+      (int*)&encode_count, p_out, (int*)&written, (int*)&out_frames);
+  if (result != 0) {
+    int err_code = ldac_get_error_code_func(a2dp_ldac_encoder_cb.ldac_handle);
+    LOG_ERROR(LOG_TAG,
+              "%s: LDAC encoding error: %d api_error = %d "
+              "handle_error = %d block_error = %d",
+              __func__, result, LDACBT_API_ERR(err_code),
+              LDACBT_HANDLE_ERR(err_code), LDACBT_BLOCK_ERR(err_code));
+    return false;
   }
-}
 
-static bool a2dp_ldac_read_feeding(uint8_t* read_buffer, uint32_t* bytes_read) {
-  uint32_t read_size = LDACBT_ENC_LSU *
-                       a2dp_ldac_encoder_cb.feeding_params.channel_count *
-                       a2dp_ldac_encoder_cb.feeding_params.bits_per_sample / 8;
-
-  a2dp_ldac_encoder_cb.stats.media_read_total_expected_reads_count++;
-  a2dp_ldac_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
-
-  /* Read Data from UIPC channel */
-  uint32_t nb_byte_read =
-      a2dp_ldac_encoder_cb.read_callback(read_buffer, read_size);
-  a2dp_ldac_encoder_cb.stats.media_read_total_actual_read_bytes += nb_byte_read;
+  p_encoded->bytes = written;
+  p_encoded->frames = out_frames;  // added frames to the buffer
+  p_encoded->samples = out_frames * ldac_frame_size;
+  return true;
+}
 
-  if (nb_byte_read < read_size) {
-    if (nb_byte_read == 0) return false;
+// Gets an encoder handle, the spare one if it is there
+static HANDLE_LDAC_BT a2dp_ldac_take_handle(void) {
+  std::lock_guard<std::recursive_mutex> lock(ldac_encoder_lib_mutex);
+  HANDLE_LDAC_BT ldac_handle = ldac_spare_handle;
+  ldac_spare_handle = NULL;
+  if (ldac_handle == NULL) ldac_handle = ldac_get_handle_func();
+  return ldac_handle;
+}
 
-    /* Fill the unfilled part of the read buffer with silence (0) */
-    memset(((uint8_t*)read_buffer) + nb_byte_read, 0, read_size - nb_byte_read);
-    nb_byte_read = read_size;
+// Gives back an encoder handle. It is closed, ready for the next stream, and
+// kept as the spare one unless there is already one.
+static void a2dp_ldac_release_handle(HANDLE_LDAC_BT ldac_handle) {
+  std::lock_guard<std::recursive_mutex> lock(ldac_encoder_lib_mutex);
+  if (ldac_spare_handle != NULL) {
+    ldac_free_handle_func(ldac_handle);
+    return;
   }
-  a2dp_ldac_encoder_cb.stats.media_read_total_actual_reads_count++;
-  *bytes_read = nb_byte_read;
-  return true;
+  ldac_close_handle_func(ldac_handle);
+  ldac_spare_handle = ldac_handle;
 }
 
 static std::string quality_mode_index_to_name(int quality_mode_index) {
@@ -781,7 +665,6 @@ period_ms_t A2dpCodecConfigLdac::encoderIntervalMs() const {
 }
 
 void A2dpCodecConfigLdac::debug_codec_dump(int fd) {
-  a2dp_ldac_encoder_stats_t* stats = &a2dp_ldac_encoder_cb.stats;
   tA2DP_LDAC_ENCODER_PARAMS* p_encoder_params =
       &a2dp_ldac_encoder_cb.ldac_encoder_params;
 
@@ -792,23 +675,7 @@ void A2dpCodecConfigLdac::debug_codec_dump(int fd) {
 
   A2dpCodecConfig::debug_codec_dump(fd);
 
-  dprintf(fd,
-          "  Packet counts (expected/dropped)                        : %zu / "
-          "%zu\n",
-          stats->media_read_total_expected_packets,
-          stats->media_read_total_dropped_packets);
-
-  dprintf(fd,
-          "  PCM read counts (expected/actual)                       : %zu / "
-          "%zu\n",
-          stats->media_read_total_expected_reads_count,
-          stats->media_read_total_actual_reads_count);
-
-  dprintf(fd,
-          "  PCM read bytes (expected/actual)                        : %zu / "
-          "%zu\n",
-          stats->media_read_total_expected_read_bytes,
-          stats->media_read_total_actual_read_bytes);
+  a2dp_encoder_pipeline_debug_dump(&a2dp_ldac_encoder_cb.pipeline, fd);
 
   dprintf(
       fd, "  LDAC quality mode                                       : %s\n",
@@ -83,6 +83,7 @@ typedef struct {
   uint8_t ch_state;       /* L2CAP channel state */
   uint8_t ch_flags;       /* L2CAP configuration flags */
   BT_HDR* p_rx_msg;       /* Message being reassembled */
+  uint16_t rx_msg_size;   /* Size of the buffer of p_rx_msg */
   uint16_t conflict_lcid; /* L2CAP channel LCID */
   RawAddress peer_addr;   /* BD address of peer */
   fixed_queue_t* tx_q;    /* Transmit data buffer queue       */
@@ -39,6 +39,27 @@ const uint8_t avct_lcb_pkt_type_len[] = {AVCT_HDR_LEN_SINGLE,
                                          AVCT_HDR_LEN_START, AVCT_HDR_LEN_CONT,
                                          AVCT_HDR_LEN_END};
 
+/*******************************************************************************
+ *
+ * Function         avct_lcb_rx_buf
+ *
+ * Description      Get a reassembly buffer of at least |size| bytes for the
+ *                  LCB. The buffer of a reassembly that was dropped is used
+ *                  again if it is big enough.
+ *
+ *
+ * Returns          Pointer to the buffer, also set in p_rx_msg.
+ *
+ ******************************************************************************/
+static BT_HDR* avct_lcb_rx_buf(tAVCT_LCB* p_lcb, uint16_t size) {
+  if (p_lcb->p_rx_msg == NULL || p_lcb->rx_msg_size < size) {
+    osi_free(p_lcb->p_rx_msg);
+    p_lcb->p_rx_msg = (BT_HDR*)osi_malloc(size);
+    p_lcb->rx_msg_size = size;
+  }
+  return p_lcb->p_rx_msg;
+}
+
 /*******************************************************************************
  *
  * Function         avct_lcb_msg_asmbl
@@ -82,12 +103,11 @@ static BT_HDR* avct_lcb_msg_asmbl(tAVCT_LCB* p_lcb, BT_HDR* p_buf) {
   }
   /* start packet */
   else if (pkt_type == AVCT_PKT_TYPE_START) {
-    /* if reassembly in progress drop message and process new start */
+    /* if reassembly in progress drop message and process new start, the
+     * buffer of the dropped message is kept for the new one */
     if (p_lcb->p_rx_msg != NULL)
       AVCT_TRACE_WARNING("Got start during reassembly");
 
-    osi_free_and_reset((void**)&p_lcb->p_rx_msg);
-
     /*
      * Allocate bigger buffer for reassembly. As lower layers are
      * not aware of possible packet size after reassembly, they
@@ -95,11 +115,22 @@ static BT_HDR* avct_lcb_msg_asmbl(tAVCT_LCB* p_lcb, BT_HDR* p_buf) {
      */
     if (sizeof(BT_HDR) + p_buf->offset + p_buf->len > BT_DEFAULT_BUFFER_SIZE) {
       android_errorWriteLog(0x534e4554, "232023771");
+      osi_free_and_reset((void**)&p_lcb->p_rx_msg);
       osi_free(p_buf);
       p_ret = NULL;
       return p_ret;
     }
-    p_lcb->p_rx_msg = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+
+    /*
+     * Size the buffer for the number of packets the start packet announces,
+     * none of which is bigger than our mtu. The buffer grows to the default
+     * size if the peer sends more.
+     */
+    uint8_t nosp = *(p + 1);
+    uint32_t size = sizeof(BT_HDR) + p_buf->offset + p_buf->len;
+    if (nosp > 1) size += (nosp - 1) * (avct_cb.mtu - AVCT_HDR_LEN_CONT);
+    if (size > BT_DEFAULT_BUFFER_SIZE) size = BT_DEFAULT_BUFFER_SIZE;
+    avct_lcb_rx_buf(p_lcb, (uint16_t)size);
     memcpy(p_lcb->p_rx_msg, p_buf, sizeof(BT_HDR) + p_buf->offset + p_buf->len);
 
     /* Free original buffer */
@@ -127,19 +158,26 @@ static BT_HDR* avct_lcb_msg_asmbl(tAVCT_LCB* p_lcb, BT_HDR* p_buf) {
       AVCT_TRACE_WARNING("Pkt type=%d out of order", pkt_type);
       p_ret = NULL;
     } else {
-      /* get size of buffer holding assembled message */
-      /*
-       * NOTE: The buffer is allocated above at the beginning of the
-       * reassembly, and is always of size BT_DEFAULT_BUFFER_SIZE.
-       */
-      uint16_t buf_len = BT_DEFAULT_BUFFER_SIZE - sizeof(BT_HDR);
-
       /* adjust offset and len of fragment for header byte */
       p_buf->offset += AVCT_HDR_LEN_CONT;
       p_buf->len -= AVCT_HDR_LEN_CONT;
 
+      /* more than announced in the start packet, grow to the default size */
+      uint32_t needed =
+          sizeof(BT_HDR) + p_lcb->p_rx_msg->offset + p_buf->len;
+      if (needed > p_lcb->rx_msg_size && needed <= BT_DEFAULT_BUFFER_SIZE) {
+        AVCT_TRACE_WARNING("%s: Fragmented message bigger than announced",
+                           __func__);
+        BT_HDR* p_msg = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+        memcpy(p_msg, p_lcb->p_rx_msg,
+               sizeof(BT_HDR) + p_lcb->p_rx_msg->offset);
+        osi_free(p_lcb->p_rx_msg);
+        p_lcb->p_rx_msg = p_msg;
+        p_lcb->rx_msg_size = BT_DEFAULT_BUFFER_SIZE;
+      }
+
       /* verify length */
-      if ((p_lcb->p_rx_msg->offset + p_buf->len) > buf_len) {
+      if (needed > p_lcb->rx_msg_size) {
         /* won't fit; free everything */
         AVCT_TRACE_WARNING("%s: Fragmented message too big!", __func__);
         osi_free_and_reset((void**)&p_lcb->p_rx_msg);
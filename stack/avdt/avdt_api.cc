@@ -32,6 +32,7 @@
 #include "avdt_int.h"
 #include "avdtc_api.h"
 #include "bt_target.h"
+#include "bt_trace_span.h"
 #include "bt_types.h"
 #include "btm_api.h"
 #include "btm_int.h"
@@ -966,6 +967,7 @@ uint16_t AVDT_SecurityRsp(uint8_t handle, uint8_t label, uint8_t error_code,
  ******************************************************************************/
 uint16_t AVDT_WriteReqOpt(uint8_t handle, BT_HDR* p_pkt, uint32_t time_stamp,
                           uint8_t m_pt, tAVDT_DATA_OPT_MASK opt) {
+  BT_TRACE_PACKET_SCOPE("avdt write", p_pkt);
   tAVDT_SCB* p_scb;
   tAVDT_SCB_EVT evt;
   uint16_t result = AVDT_SUCCESS;
@@ -480,6 +480,8 @@ typedef struct {
   BT_HDR* p_pkt;                    /* packet waiting to be sent */
   tAVDT_CCB* p_ccb;                 /* ccb associated with this scb */
   uint16_t media_seq;               /* media packet sequence number */
+  uint8_t media_hdr[AVDT_MEDIA_HDR_SIZE]; /* media packet header template */
+  bool media_hdr_valid;             /* whether media_hdr is built */
   bool allocated;                   /* whether scb is allocated or unused */
   bool in_use;                      /* whether stream being used by peer */
   uint8_t role;       /* initiator/acceptor role in current procedure */
@@ -0,0 +1,78 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the fast path of the AVDTP media packet header: the
+ *  header of a stream only changes in its sequence number and time stamp, so
+ *  it is copied from a template built once, and received headers without
+ *  padding, extension or CSRC are parsed at fixed offsets.
+ *
+ ******************************************************************************/
+
+#include "avdt_media.h"
+
+#include <string.h>
+
+#include "avdt_api.h"
+#include "avdt_defs.h"
+
+/* Offsets in the media packet header */
+#define AVDT_MEDIA_M_PT_OFFSET 1
+#define AVDT_MEDIA_SEQ_OFFSET 2
+#define AVDT_MEDIA_TIME_STAMP_OFFSET 4
+#define AVDT_MEDIA_SSRC_OFFSET 8
+
+void avdt_media_init_hdr(uint8_t* p_hdr, uint8_t m_pt, uint32_t ssrc) {
+  p_hdr[0] = AVDT_MEDIA_OCTET1;
+  p_hdr[AVDT_MEDIA_M_PT_OFFSET] = m_pt;
+  memset(p_hdr + AVDT_MEDIA_SEQ_OFFSET, 0,
+         AVDT_MEDIA_SSRC_OFFSET - AVDT_MEDIA_SEQ_OFFSET);
+  p_hdr[AVDT_MEDIA_SSRC_OFFSET] = (uint8_t)(ssrc >> 24);
+  p_hdr[AVDT_MEDIA_SSRC_OFFSET + 1] = (uint8_t)(ssrc >> 16);
+  p_hdr[AVDT_MEDIA_SSRC_OFFSET + 2] = (uint8_t)(ssrc >> 8);
+  p_hdr[AVDT_MEDIA_SSRC_OFFSET + 3] = (uint8_t)ssrc;
+}
+
+void avdt_media_write_hdr(uint8_t* p, const uint8_t* p_hdr, uint16_t seq,
+                          uint32_t time_stamp) {
+  memcpy(p, p_hdr, AVDT_MEDIA_HDR_SIZE);
+  p[AVDT_MEDIA_SEQ_OFFSET] = (uint8_t)(seq >> 8);
+  p[AVDT_MEDIA_SEQ_OFFSET + 1] = (uint8_t)seq;
+  p[AVDT_MEDIA_TIME_STAMP_OFFSET] = (uint8_t)(time_stamp >> 24);
+  p[AVDT_MEDIA_TIME_STAMP_OFFSET + 1] = (uint8_t)(time_stamp >> 16);
+  p[AVDT_MEDIA_TIME_STAMP_OFFSET + 2] = (uint8_t)(time_stamp >> 8);
+  p[AVDT_MEDIA_TIME_STAMP_OFFSET + 3] = (uint8_t)time_stamp;
+}
+
+bool avdt_media_parse_hdr(const uint8_t* p, uint16_t len, uint8_t* p_m_pt,
+                          uint8_t* p_marker, uint16_t* p_seq,
+                          uint32_t* p_time_stamp) {
+  /* version 2, no padding, no extension, no CSRC */
+  if (len < AVDT_MEDIA_HDR_SIZE || p[0] != AVDT_MEDIA_OCTET1) return false;
+
+  *p_marker = (p[AVDT_MEDIA_M_PT_OFFSET] >> 7) & 0x01;
+  *p_m_pt = p[AVDT_MEDIA_M_PT_OFFSET] & 0x7F;
+  *p_seq = ((uint16_t)p[AVDT_MEDIA_SEQ_OFFSET] << 8) |
+           p[AVDT_MEDIA_SEQ_OFFSET + 1];
+  *p_time_stamp = ((uint32_t)p[AVDT_MEDIA_TIME_STAMP_OFFSET] << 24) |
+                  ((uint32_t)p[AVDT_MEDIA_TIME_STAMP_OFFSET + 1] << 16) |
+                  ((uint32_t)p[AVDT_MEDIA_TIME_STAMP_OFFSET + 2] << 8) |
+                  p[AVDT_MEDIA_TIME_STAMP_OFFSET + 3];
+  return true;
+}
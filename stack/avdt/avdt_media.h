@@ -0,0 +1,38 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+/* Builds at |p_hdr| the AVDT_MEDIA_HDR_SIZE bytes RTP media header template
+ * of a stream: no padding, extension or CSRC, payload type |m_pt| and |ssrc|.
+ */
+void avdt_media_init_hdr(uint8_t* p_hdr, uint8_t m_pt, uint32_t ssrc);
+
+/* Writes at |p| the media header template |p_hdr| with the sequence number
+ * |seq| and the time stamp |time_stamp|. */
+void avdt_media_write_hdr(uint8_t* p, const uint8_t* p_hdr, uint16_t seq,
+                          uint32_t time_stamp);
+
+/* Parses the media header at |p| of a |len| bytes media packet without
+ * padding, extension or CSRC, the common case. Returns false for any other
+ * packet, to be parsed in full. */
+bool avdt_media_parse_hdr(const uint8_t* p, uint16_t len, uint8_t* p_m_pt,
+                          uint8_t* p_marker, uint16_t* p_seq,
+                          uint32_t* p_time_stamp);
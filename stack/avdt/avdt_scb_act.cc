@@ -32,6 +32,7 @@
 #include "a2dp_codec_api.h"
 #include "avdt_api.h"
 #include "avdt_int.h"
+#include "avdt_media.h"
 #include "avdtc_api.h"
 #include "bt_common.h"
 #include "bt_target.h"
@@ -259,6 +260,12 @@ void avdt_scb_hdl_pkt_no_frag(tAVDT_SCB* p_scb, tAVDT_SCB_EVT* p_data) {
 
   p = p_start = (uint8_t*)(p_data->p_pkt + 1) + p_data->p_pkt->offset;
 
+  /* common case: no padding, extension or csrc */
+  if (avdt_media_parse_hdr(p_start, len, &m_pt, &marker, &seq, &time_stamp)) {
+    offset = AVDT_MEDIA_HDR_SIZE;
+    goto send_up;
+  }
+
   /* parse media packet header */
   offset = 12;
   // AVDT_MSG_PRS_OCTET1(1) + AVDT_MSG_PRS_M_PT(1) + UINT16(2) + UINT32(4) + 4
@@ -299,22 +306,23 @@ void avdt_scb_hdl_pkt_no_frag(tAVDT_SCB* p_scb, tAVDT_SCB_EVT* p_data) {
   if (pad_len > (len - offset)) {
     AVDT_TRACE_WARNING("Got bad media packet");
     osi_free_and_reset((void**)&p_data->p_pkt);
+    return;
   }
+
+send_up:
   /* adjust offset and length and send it up */
-  else {
-    p_data->p_pkt->len -= (offset + pad_len);
-    p_data->p_pkt->offset += offset;
-
-    if (p_scb->cs.p_sink_data_cback != NULL) {
-      /* report sequence number */
-      p_data->p_pkt->layer_specific = seq;
-      APPL_TRACE_LATENCY_AUDIO("AVDTP Recv Packet, seq number %d", seq);
-      (*p_scb->cs.p_sink_data_cback)(avdt_scb_to_hdl(p_scb), p_data->p_pkt,
-                                     time_stamp,
-                                     (uint8_t)(m_pt | (marker << 7)));
-    } else {
-      osi_free_and_reset((void**)&p_data->p_pkt);
-    }
+  p_data->p_pkt->len -= (offset + pad_len);
+  p_data->p_pkt->offset += offset;
+
+  if (p_scb->cs.p_sink_data_cback != NULL) {
+    /* report sequence number */
+    p_data->p_pkt->layer_specific = seq;
+    APPL_TRACE_LATENCY_AUDIO("AVDTP Recv Packet, seq number %d", seq);
+    (*p_scb->cs.p_sink_data_cback)(avdt_scb_to_hdl(p_scb), p_data->p_pkt,
+                                   time_stamp,
+                                   (uint8_t)(m_pt | (marker << 7)));
+  } else {
+    osi_free_and_reset((void**)&p_data->p_pkt);
   }
   return;
 length_error:
@@ -923,6 +931,7 @@ void avdt_scb_hdl_tc_close(tAVDT_SCB* p_scb, tAVDT_SCB_EVT* p_data) {
   /* clear sep variables */
   avdt_scb_clr_vars(p_scb, p_data);
   p_scb->media_seq = 0;
+  p_scb->media_hdr_valid = false;
   p_scb->cong = false;
 
   /* free pkt we're holding, if any */
@@ -1183,7 +1192,6 @@ void avdt_scb_hdl_tc_open_sto(tAVDT_SCB* p_scb, tAVDT_SCB_EVT* p_data) {
  ******************************************************************************/
 void avdt_scb_hdl_write_req(tAVDT_SCB* p_scb, tAVDT_SCB_EVT* p_data) {
   uint8_t* p;
-  uint32_t ssrc;
   bool add_rtp_header = !(p_data->apiwrite.opt & AVDT_DATA_OPT_NO_RTP);
   AVDT_TRACE_DEBUG("%s: add_rtp_header: %d, num_protect: %d",
                         __func__, add_rtp_header, p_scb->curr_cfg.num_protect);
@@ -1194,7 +1202,6 @@ void avdt_scb_hdl_write_req(tAVDT_SCB* p_scb, tAVDT_SCB_EVT* p_data) {
     AVDT_TRACE_WARNING("Dropped media packet; congested");
   }
   osi_free_and_reset((void**)&p_scb->p_pkt);
-  AVDT_TRACE_DEBUG("%s:pkt freed and reset",__func__);
   /* Recompute only if the RTP header wasn't disabled by the API */
   if (add_rtp_header) {
     bool is_content_protection = (p_scb->curr_cfg.num_protect > 0);
@@ -1204,30 +1211,30 @@ void avdt_scb_hdl_write_req(tAVDT_SCB* p_scb, tAVDT_SCB_EVT* p_data) {
 
   /* Build a media packet, and add an RTP header if required. */
   if (add_rtp_header) {
-    AVDT_TRACE_DEBUG("%s:add rtp header",__func__);
     if (p_data->apiwrite.p_buf->offset < AVDT_MEDIA_HDR_SIZE) {
       android_errorWriteWithInfoLog(0x534e4554, "242535997", -1, NULL, 0);
       return;
     }
 
-    ssrc = avdt_scb_gen_ssrc(p_scb);
+    /* only the sequence number and time stamp change from packet to packet */
+    if (!p_scb->media_hdr_valid ||
+        p_scb->media_hdr[1] != p_data->apiwrite.m_pt) {
+      avdt_media_init_hdr(p_scb->media_hdr, p_data->apiwrite.m_pt,
+                          avdt_scb_gen_ssrc(p_scb));
+      p_scb->media_hdr_valid = true;
+    }
 
     p_data->apiwrite.p_buf->len += AVDT_MEDIA_HDR_SIZE;
     p_data->apiwrite.p_buf->offset -= AVDT_MEDIA_HDR_SIZE;
     p_scb->media_seq++;
     p = (uint8_t*)(p_data->apiwrite.p_buf + 1) + p_data->apiwrite.p_buf->offset;
 
-    UINT8_TO_BE_STREAM(p, AVDT_MEDIA_OCTET1);
-    UINT8_TO_BE_STREAM(p, p_data->apiwrite.m_pt);
-    UINT16_TO_BE_STREAM(p, p_scb->media_seq);
-    UINT32_TO_BE_STREAM(p, p_data->apiwrite.time_stamp);
-    UINT32_TO_BE_STREAM(p, ssrc);
-    AVDT_TRACE_DEBUG("%s:rtp header added",__func__);
+    avdt_media_write_hdr(p, p_scb->media_hdr, p_scb->media_seq,
+                         p_data->apiwrite.time_stamp);
   }
 
   /* store it */
   p_scb->p_pkt = p_data->apiwrite.p_buf;
-  AVDT_TRACE_DEBUG("%s:Exit",__func__);
 }
 
 /*******************************************************************************
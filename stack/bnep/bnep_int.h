@@ -139,6 +139,9 @@ typedef struct {
   RawAddress sent_mcast_filter_end[BNEP_MAX_MULTI_FILTERS];
 
   uint16_t rcvd_num_filters;
+  /* The received ranges, sorted and merged into rcvd_prot_ranges disjoint
+   * ranges */
+  uint16_t rcvd_prot_ranges;
   uint16_t rcvd_prot_filter_start[BNEP_MAX_PROT_FILTERS];
   uint16_t rcvd_prot_filter_end[BNEP_MAX_PROT_FILTERS];
 
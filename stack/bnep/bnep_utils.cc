@@ -937,14 +937,36 @@ void bnepu_process_peer_filter_set(tBNEP_CONN* p_bcb, uint8_t* p_filters,
   if (bnep_cb.p_filter_ind_cb)
     (*bnep_cb.p_filter_ind_cb)(p_bcb->handle, true, 0, len, p_filters);
 
+  /* Keep the ranges sorted by start and merged, so that a packet is checked
+   * with a binary search */
   p_bcb->rcvd_num_filters = num_filters;
+  p_bcb->rcvd_prot_ranges = 0;
   for (xx = 0; xx < num_filters; xx++) {
     BE_STREAM_TO_UINT16(start, p_filters);
     BE_STREAM_TO_UINT16(end, p_filters);
 
-    p_bcb->rcvd_prot_filter_start[xx] = start;
-    p_bcb->rcvd_prot_filter_end[xx] = end;
+    uint16_t yy = p_bcb->rcvd_prot_ranges++;
+    for (; yy > 0 && p_bcb->rcvd_prot_filter_start[yy - 1] > start; yy--) {
+      p_bcb->rcvd_prot_filter_start[yy] = p_bcb->rcvd_prot_filter_start[yy - 1];
+      p_bcb->rcvd_prot_filter_end[yy] = p_bcb->rcvd_prot_filter_end[yy - 1];
+    }
+    p_bcb->rcvd_prot_filter_start[yy] = start;
+    p_bcb->rcvd_prot_filter_end[yy] = end;
   }
+  uint16_t ranges = 0;
+  for (xx = 0; xx < p_bcb->rcvd_prot_ranges; xx++) {
+    start = p_bcb->rcvd_prot_filter_start[xx];
+    end = p_bcb->rcvd_prot_filter_end[xx];
+    if (ranges > 0 && start <= p_bcb->rcvd_prot_filter_end[ranges - 1] + 1) {
+      if (end > p_bcb->rcvd_prot_filter_end[ranges - 1])
+        p_bcb->rcvd_prot_filter_end[ranges - 1] = end;
+    } else {
+      p_bcb->rcvd_prot_filter_start[ranges] = start;
+      p_bcb->rcvd_prot_filter_end[ranges] = end;
+      ranges++;
+    }
+  }
+  p_bcb->rcvd_prot_ranges = ranges;
 
   bnepu_send_peer_filter_rsp(p_bcb, resp_code);
 }
@@ -1261,7 +1283,7 @@ tBNEP_RESULT bnep_is_packet_allowed(tBNEP_CONN* p_bcb,
                                     uint16_t protocol, bool fw_ext_present,
                                     uint8_t* p_data, uint16_t org_len) {
   if (p_bcb->rcvd_num_filters) {
-    uint16_t i, proto;
+    uint16_t low, high, proto;
 
     /* Findout the actual protocol to check for the filtering */
     proto = protocol;
@@ -1290,13 +1312,18 @@ tBNEP_RESULT bnep_is_packet_allowed(tBNEP_CONN* p_bcb,
       BE_STREAM_TO_UINT16(proto, p_data);
     }
 
-    for (i = 0; i < p_bcb->rcvd_num_filters; i++) {
-      if ((p_bcb->rcvd_prot_filter_start[i] <= proto) &&
-          (proto <= p_bcb->rcvd_prot_filter_end[i]))
-        break;
+    /* Find the last range starting at or before the protocol */
+    low = 0;
+    high = p_bcb->rcvd_prot_ranges;
+    while (low < high) {
+      uint16_t mid = (low + high) / 2;
+      if (p_bcb->rcvd_prot_filter_start[mid] <= proto)
+        low = mid + 1;
+      else
+        high = mid;
     }
 
-    if (i == p_bcb->rcvd_num_filters) {
+    if (low == 0 || proto > p_bcb->rcvd_prot_filter_end[low - 1]) {
       BNEP_TRACE_DEBUG("Ignoring protocol 0x%x in BNEP data write", proto);
       return BNEP_IGNORE_CMD;
     }
@@ -658,6 +658,8 @@ class BleAdvertiserHciExtendedImpl : public BleAdvertiserHciInterface {
                command_complete);
   }
 
+  bool CanEnableMultipleSets() override { return true; }
+
   void SetPeriodicAdvertisingParameters(uint8_t handle,
                                         uint16_t periodic_adv_int_min,
                                         uint16_t periodic_adv_int_max,
@@ -109,6 +109,9 @@ class BleAdvertiserHciInterface {
 
   // Some implementation don't behave well when handle value 0 is used.
   virtual bool QuirkAdvertiserZeroHandle() { return 0; }
+
+  // True if one Enable call can carry several advertising sets.
+  virtual bool CanEnableMultipleSets() { return false; }
 };
 
 #endif  // BLE_ADVERTISER_HCI_INTERFACE_H
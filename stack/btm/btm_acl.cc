@@ -37,10 +37,14 @@
 #include <string.h>
 #include <log/log.h>
 
+#include <algorithm>
+
 #include "bt_common.h"
 #include "bt_target.h"
 #include "bt_types.h"
 #include "bt_utils.h"
+#include "btif/include/btif_config.h"
+#include "btif/include/btif_debug_conn.h"
 #include "btm_api.h"
 #include "btm_int.h"
 #include "btu.h"
@@ -60,9 +64,24 @@
 
 static void btm_read_remote_features(uint16_t handle);
 static void btm_read_remote_ext_features(uint16_t handle, uint8_t page_number);
+static void btm_request_feature_page(tACL_CONN* p_acl_cb, uint8_t page);
+static void btm_feature_page_read(tACL_CONN* p_acl_cb, uint8_t page);
 static void btm_process_remote_ext_features(tACL_CONN* p_acl_cb,
                                             uint8_t num_read_pages);
 static void btm_enable_link_PL10_adaptive_ctrl(uint16_t handle, bool enable);
+static void btm_acl_start_peer_outcome(tBTM_SEC_DEV_REC* p_dev_rec);
+static void btm_acl_store_peer_outcome(const RawAddress& bd_addr,
+                                       const char* key, int value);
+
+/* Config keys of the link policy outcomes of a peer */
+#define BTM_PEER_RS_REFUSED_KEY "RoleSwitchRefusedConns"
+#define BTM_PEER_SNIFF_REFUSED_KEY "SniffRefusedConns"
+#define BTM_PEER_PREF_ROLE_KEY "PeerPreferredRole"
+
+/* Connections on which a request the peer refused is not attempted again */
+#ifndef BTM_PEER_REFUSED_CONNS
+#define BTM_PEER_REFUSED_CONNS 8
+#endif
 #if (BT_IOT_LOGGING_ENABLED == TRUE)
 extern void btm_iot_save_remote_properties(tACL_CONN *p_acl_cb);
 extern void btm_iot_save_remote_versions(tACL_CONN *p_acl_cb);
@@ -250,6 +269,8 @@ void btm_acl_created(const RawAddress& bda, DEV_CLASS dc, BD_NAME bdn,
     return;
   }
 
+  btif_debug_conn_milestone(bda, BTIF_DEBUG_CONN_ACL_CONNECTED);
+
   /* Allocate acl_db entry */
   for (xx = 0, p = &btm_cb.acl_db[0]; xx < MAX_L2CAP_LINKS; xx++, p++) {
     if (!p->in_use) {
@@ -291,7 +312,10 @@ void btm_acl_created(const RawAddress& bda, DEV_CLASS dc, BD_NAME bdn,
         bt_soc_type_t soc_type = controller_get_interface()->get_soc_type();
         BTM_TRACE_DEBUG("%s: soc_type: %d", __func__, soc_type);
 
+        /* The clock offset, the version and the features are read all at
+         * once, the HCI layer sends them as command credits allow */
         btsnd_hcic_read_rmt_clk_offset(p->hci_handle);
+        btsnd_hcic_rmt_ver_req(p->hci_handle);
 
         if ((soc_type == BT_SOC_TYPE_CHEROKEE || soc_type == BT_SOC_TYPE_HASTINGS ||
              BT_SOC_TYPE_MOSELLE) && interop_match_addr_or_name(
@@ -310,6 +334,26 @@ void btm_acl_created(const RawAddress& bda, DEV_CLASS dc, BD_NAME bdn,
         BTM_TRACE_DEBUG("device_type=0x%x", p_dev_rec->device_type);
       }
 
+      if (p_dev_rec && transport == BT_TRANSPORT_BR_EDR)
+        btm_acl_start_peer_outcome(p_dev_rec);
+
+      /* The version of the last connection is used until it is read again */
+      if (p_dev_rec && p_dev_rec->remote_version_known) {
+        p->lmp_version = p_dev_rec->lmp_version;
+        p->manufacturer = p_dev_rec->manufacturer;
+        p->lmp_subversion = p_dev_rec->lmp_subversion;
+      } else {
+        p->lmp_version = 0;
+        p->manufacturer = 0;
+        p->lmp_subversion = 0;
+      }
+
+      if (transport == BT_TRANSPORT_BR_EDR) {
+        p->num_read_pages = 0;
+        memset(p->peer_lmp_feature_pages, 0,
+               sizeof(p->peer_lmp_feature_pages));
+      }
+
       if (p_dev_rec && !(transport == BT_TRANSPORT_LE)) {
         /* If remote features already known, copy them and continue connection
          * setup */
@@ -330,10 +374,16 @@ void btm_acl_created(const RawAddress& bda, DEV_CLASS dc, BD_NAME bdn,
             l2cu_resubmit_pending_sec_req(&p_dev_rec->bd_addr);
           }
           btm_establish_continue(p);
+
+          /* Read them again in case they changed */
+          btm_read_remote_features(p->hci_handle);
           return;
         }
       }
 
+      if (transport == BT_TRANSPORT_BR_EDR)
+        btm_read_remote_features(p->hci_handle);
+
       /* If here, features are not known yet */
       if (p_dev_rec && transport == BT_TRANSPORT_LE) {
 #if (BLE_PRIVACY_SPT == TRUE)
@@ -677,6 +727,12 @@ tBTM_STATUS BTM_SwitchRole(const RawAddress& remote_bd_addr, uint8_t new_role,
                 (!IsHighQualityCodecSelected(remote_bd_addr))))
       return(BTM_SUCCESS);
 
+  /* Do not retry a role switch the peer refused on an earlier connection */
+  if (BTM_IsPeerRoleSwitchRefused(remote_bd_addr)) {
+    VLOG(1) << __func__ << " peer refused role switch: " << remote_bd_addr;
+    return BTM_MODE_UNSUPPORTED;
+  }
+
   /* Ignore role switch request if the previous request was not completed */
   if (p->switch_role_state != BTM_ACL_SWKEY_STATE_IDLE) {
     BTM_TRACE_DEBUG("BTM_SwitchRole busy: %d", p->switch_role_state);
@@ -1008,6 +1064,37 @@ void btm_use_preferred_conn_params(const RawAddress& bda) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_cache_remote_version
+ *
+ * Description      Keeps the remote version read on a link in the device
+ *                  record for the next connections. A new version drops the
+ *                  features kept in the record, the ones being read on the
+ *                  link replace them.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_cache_remote_version(tACL_CONN* p_acl_cb) {
+  tBTM_SEC_DEV_REC* p_dev_rec = btm_find_dev(p_acl_cb->remote_addr);
+  if (p_dev_rec == NULL) return;
+
+  if (p_dev_rec->remote_version_known &&
+      (p_dev_rec->lmp_version != p_acl_cb->lmp_version ||
+       p_dev_rec->manufacturer != p_acl_cb->manufacturer ||
+       p_dev_rec->lmp_subversion != p_acl_cb->lmp_subversion)) {
+    BTM_TRACE_WARNING("%s: remote version changed, features dropped",
+                      __func__);
+    p_dev_rec->num_read_pages = 0;
+  }
+
+  p_dev_rec->remote_version_known = true;
+  p_dev_rec->lmp_version = p_acl_cb->lmp_version;
+  p_dev_rec->manufacturer = p_acl_cb->manufacturer;
+  p_dev_rec->lmp_subversion = p_acl_cb->lmp_subversion;
+}
+
 /*******************************************************************************
  *
  * Function         btm_read_remote_version_complete
@@ -1035,10 +1122,7 @@ void btm_read_remote_version_complete(uint8_t* p) {
         STREAM_TO_UINT8(p_acl_cb->lmp_version, p);
         STREAM_TO_UINT16(p_acl_cb->manufacturer, p);
         STREAM_TO_UINT16(p_acl_cb->lmp_subversion, p);
-        if (p_acl_cb->transport == BT_TRANSPORT_BR_EDR) {
-          BTM_TRACE_DEBUG("Calling btm_read_remote_features");
-          btm_read_remote_features (p_acl_cb->hci_handle);
-        }
+        btm_cache_remote_version(p_acl_cb);
     }
 
       if (p_acl_cb->transport == BT_TRANSPORT_LE) {
@@ -1084,6 +1168,8 @@ void btm_process_remote_ext_features(tACL_CONN* p_acl_cb,
 
   p_acl_cb->num_read_pages = num_read_pages;
   p_dev_rec->num_read_pages = num_read_pages;
+  btif_debug_conn_milestone(p_acl_cb->remote_addr,
+                            BTIF_DEBUG_CONN_REMOTE_FEATURES);
 
   /* Move the pages to placeholder */
   for (page_idx = 0; page_idx < num_read_pages; page_idx++) {
@@ -1127,7 +1213,9 @@ void btm_process_remote_ext_features(tACL_CONN* p_acl_cb,
  * Function         btm_read_remote_features
  *
  * Description      Local function called to send a read remote supported
- *                  features/remote extended features page[0].
+ *                  features/remote extended features page[0]. When the
+ *                  features of the last connection are known, the extended
+ *                  pages they had are read at the same time.
  *
  * Returns          void
  *
@@ -1135,6 +1223,7 @@ void btm_process_remote_ext_features(tACL_CONN* p_acl_cb,
 void btm_read_remote_features(uint16_t handle) {
   uint8_t acl_idx;
   tACL_CONN* p_acl_cb;
+  uint8_t num_pages = 1;
 
   BTM_TRACE_DEBUG("btm_read_remote_features() handle: %d", handle);
 
@@ -1145,14 +1234,67 @@ void btm_read_remote_features(uint16_t handle) {
   }
 
   p_acl_cb = &btm_cb.acl_db[acl_idx];
-  p_acl_cb->num_read_pages = 0;
-  memset(p_acl_cb->peer_lmp_feature_pages, 0,
-         sizeof(p_acl_cb->peer_lmp_feature_pages));
+  p_acl_cb->feature_pages_pending = 0;
+  p_acl_cb->feature_pages_done = 0;
+  p_acl_cb->feature_read_failed = false;
+
+  if (p_acl_cb->num_read_pages > 1 &&
+      HCI_LMP_EXTENDED_SUPPORTED(p_acl_cb->peer_lmp_feature_pages[0]) &&
+      controller_get_interface()->supports_reading_remote_extended_features())
+    num_pages = p_acl_cb->num_read_pages;
 
   /* first send read remote supported features HCI command */
   /* because we don't know whether the remote support extended feature command
    */
-  btsnd_hcic_rmt_features_req(handle);
+  for (uint8_t page = 0; page < num_pages; page++)
+    btm_request_feature_page(p_acl_cb, page);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_request_feature_page
+ *
+ * Description      Local function called to read one remote features page,
+ *                  the supported features for page 0.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_request_feature_page(tACL_CONN* p_acl_cb, uint8_t page) {
+  p_acl_cb->feature_pages_pending |= (1 << page);
+  if (page == 0)
+    btsnd_hcic_rmt_features_req(p_acl_cb->hci_handle);
+  else
+    btm_read_remote_ext_features(p_acl_cb->hci_handle, page);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_feature_page_read
+ *
+ * Description      Local function called when one remote features page was
+ *                  read, or could not be read. Once no page is left the pages
+ *                  read from page 0 on are processed and the connection
+ *                  establishment continues.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_feature_page_read(tACL_CONN* p_acl_cb, uint8_t page) {
+  uint8_t num_pages = 0;
+
+  p_acl_cb->feature_pages_pending &= ~(1 << page);
+  if (p_acl_cb->feature_pages_pending != 0) return;
+
+  while (num_pages <= HCI_EXT_FEATURES_PAGE_MAX &&
+         (p_acl_cb->feature_pages_done & (1 << num_pages)))
+    num_pages++;
+
+  /* Process the pages */
+  btm_process_remote_ext_features(p_acl_cb, num_pages ? num_pages : 1);
+
+  /* Continue with HCI connection establishment */
+  btm_establish_continue(p_acl_cb);
 }
 
 /*******************************************************************************
@@ -1211,6 +1353,7 @@ void btm_read_remote_features_complete(uint8_t* p) {
   /* Copy the received features page */
   STREAM_TO_ARRAY(p_acl_cb->peer_lmp_feature_pages[0], p,
                   HCI_FEATURE_BYTES_PER_PAGE);
+  p_acl_cb->feature_pages_done |= 1;
 
 #if (BT_IOT_LOGGING_ENABLED == TRUE)
   /* save remote supported features to iot conf file */
@@ -1227,18 +1370,23 @@ void btm_read_remote_features_complete(uint8_t* p) {
            ->supports_reading_remote_extended_features())) {
     /* if the remote controller has extended features and local controller
        supports HCI_Read_Remote_Extended_Features command then start reading
-       these feature starting with extended features page 1 */
-    BTM_TRACE_DEBUG("Start reading remote extended features");
-    btm_read_remote_ext_features(handle, 1);
-    return;
+       these feature starting with extended features page 1, unless it is
+       being read already */
+    if (!p_acl_cb->feature_read_failed &&
+        !((p_acl_cb->feature_pages_pending | p_acl_cb->feature_pages_done) &
+          (1 << 1))) {
+      BTM_TRACE_DEBUG("Start reading remote extended features");
+      btm_request_feature_page(p_acl_cb, 1);
+    }
+  } else {
+    /* Remote controller has no extended features. Process remote controller
+       supported features (features page 0), the pages read on the features
+       of the last connection are not waited for. */
+    p_acl_cb->feature_pages_pending = 1;
+    p_acl_cb->feature_pages_done = 1;
   }
 
-  /* Remote controller has no extended features. Process remote controller
-     supported features (features page 0). */
-  btm_process_remote_ext_features(p_acl_cb, 1);
-
-  /* Continue with HCI connection establishment */
-  btm_establish_continue(p_acl_cb);
+  btm_feature_page_read(p_acl_cb, 0);
 }
 
 /*******************************************************************************
@@ -1301,9 +1449,16 @@ void btm_read_remote_ext_features_complete(uint8_t* p, uint8_t evt_len) {
 
   p_acl_cb = &btm_cb.acl_db[acl_idx];
 
+  /* Not waited for any longer */
+  if (!(p_acl_cb->feature_pages_pending & (1 << page_num))) {
+    BTM_TRACE_DEBUG("%s: page=%d dropped", __func__, page_num);
+    return;
+  }
+
   /* Copy the received features page */
   STREAM_TO_ARRAY(p_acl_cb->peer_lmp_feature_pages[page_num], p,
                   HCI_FEATURE_BYTES_PER_PAGE);
+  p_acl_cb->feature_pages_done |= (1 << page_num);
 
 #if (BT_IOT_LOGGING_ENABLED == TRUE)
   /* save remote extended features to iot conf file */
@@ -1315,25 +1470,20 @@ void btm_read_remote_ext_features_complete(uint8_t* p, uint8_t evt_len) {
           p_acl_cb->peer_lmp_feature_pages[page_num], BD_FEATURES_LEN);
 #endif
 
-  /* If there is the next remote features page and
-   * we have space to keep this page data - read this page */
-  if ((page_num < max_page) && (page_num < HCI_EXT_FEATURES_PAGE_MAX)) {
-    page_num++;
+  /* Read all the remaining pages we have space for at once, and stop waiting
+   * for the pages past the last one */
+  for (uint8_t next = page_num + 1; next <= max_page; next++) {
+    if ((p_acl_cb->feature_pages_pending | p_acl_cb->feature_pages_done) &
+        (1 << next))
+      continue;
     BTM_TRACE_DEBUG("BTM reads next remote extended features page (%d)",
-                    page_num);
-    btm_read_remote_ext_features(handle, page_num);
-    return;
+                    next);
+    btm_request_feature_page(p_acl_cb, next);
   }
+  p_acl_cb->feature_pages_pending &= (1 << (max_page + 1)) - 1;
+  p_acl_cb->feature_pages_done &= (1 << (max_page + 1)) - 1;
 
-  /* Reading of remote feature pages is complete */
-  BTM_TRACE_DEBUG("BTM reached last remote extended features page (%d)",
-                  page_num);
-
-  /* Process the pages */
-  btm_process_remote_ext_features(p_acl_cb, (uint8_t)(page_num + 1));
-
-  /* Continue with HCI connection establishment */
-  btm_establish_continue(p_acl_cb);
+  btm_feature_page_read(p_acl_cb, page_num);
 }
 
 /*******************************************************************************
@@ -1363,11 +1513,21 @@ void btm_read_remote_ext_features_failed(uint8_t status, uint16_t handle) {
 
   p_acl_cb = &btm_cb.acl_db[acl_idx];
 
-  /* Process supported features only */
-  btm_process_remote_ext_features(p_acl_cb, 1);
+  /* A page no longer waited for */
+  if (p_acl_cb->feature_pages_pending == 0) return;
 
-  /* Continue HCI connection establishment */
-  btm_establish_continue(p_acl_cb);
+  /* Stop reading extended pages, keep the pages read so far. The connection
+   * establishment continues once page 0 is in. */
+  p_acl_cb->feature_read_failed = true;
+  p_acl_cb->feature_pages_pending &= 1;
+  p_acl_cb->feature_pages_done &= 1;
+  if (p_acl_cb->feature_pages_pending == 0) {
+    /* Process supported features only */
+    btm_process_remote_ext_features(p_acl_cb, 1);
+
+    /* Continue HCI connection establishment */
+    btm_establish_continue(p_acl_cb);
+  }
 }
 
 /*******************************************************************************
@@ -1581,9 +1741,8 @@ uint16_t BTM_GetHCIConnHandle(const RawAddress& remote_bda,
  ******************************************************************************/
 void btm_process_clk_off_comp_evt(uint16_t hci_handle, uint16_t clock_offset) {
   uint8_t xx;
-  BTM_TRACE_DEBUG("btm_process_clk_off_comp_evt ,req remote version");
+  BTM_TRACE_DEBUG("btm_process_clk_off_comp_evt");
 
-  btsnd_hcic_rmt_ver_req(hci_handle);
   /* Look up the connection by handle and set the current mode */
   xx = btm_handle_to_acl_index(hci_handle);
   if (xx < MAX_L2CAP_LINKS) btm_cb.acl_db[xx].clock_offset = clock_offset;
@@ -1698,6 +1857,124 @@ void btm_blacklist_role_change_device(const RawAddress& bd_addr,
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_acl_store_peer_outcome
+ *
+ * Description      Saves a link policy outcome in the config section of a peer
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_acl_store_peer_outcome(const RawAddress& bd_addr,
+                                       const char* key, int value) {
+  const std::string name = bd_addr.ToString();
+  if (value == 0 && !btif_config_exist(name.c_str(), key)) return;
+  if (btif_config_set_int(name.c_str(), key, value)) btif_config_save();
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_acl_start_peer_outcome
+ *
+ * Description      Loads the link policy outcomes of a peer from its config
+ *                  section the first time it connects, and uses up one of
+ *                  the connections on which refused requests are skipped.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_acl_start_peer_outcome(tBTM_SEC_DEV_REC* p_dev_rec) {
+  const std::string name = p_dev_rec->bd_addr.ToString();
+  int value;
+
+  if (!p_dev_rec->link_outcome_loaded) {
+    p_dev_rec->link_outcome_loaded = true;
+    p_dev_rec->rs_refused_conns =
+        btif_config_get_int(name.c_str(), BTM_PEER_RS_REFUSED_KEY, &value)
+            ? std::min(value, BTM_PEER_REFUSED_CONNS)
+            : 0;
+    p_dev_rec->sniff_refused_conns =
+        btif_config_get_int(name.c_str(), BTM_PEER_SNIFF_REFUSED_KEY, &value)
+            ? std::min(value, BTM_PEER_REFUSED_CONNS)
+            : 0;
+    p_dev_rec->peer_pref_role =
+        btif_config_get_int(name.c_str(), BTM_PEER_PREF_ROLE_KEY, &value)
+            ? value
+            : BTM_ROLE_UNDEFINED;
+  }
+
+  /* a refused request is tried again once its connections are used up */
+  if (p_dev_rec->rs_refused_conns) {
+    p_dev_rec->rs_refused_conns--;
+    btm_acl_store_peer_outcome(p_dev_rec->bd_addr, BTM_PEER_RS_REFUSED_KEY,
+                               p_dev_rec->rs_refused_conns);
+  }
+  if (p_dev_rec->sniff_refused_conns) {
+    p_dev_rec->sniff_refused_conns--;
+    btm_acl_store_peer_outcome(p_dev_rec->bd_addr, BTM_PEER_SNIFF_REFUSED_KEY,
+                               p_dev_rec->sniff_refused_conns);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsPeerRoleSwitchRefused
+ *
+ * Description      Returns true if the peer refused a role switch on a recent
+ *                  connection, and role switches are not attempted with it.
+ *
+ ******************************************************************************/
+bool BTM_IsPeerRoleSwitchRefused(const RawAddress& bd_addr) {
+  tBTM_SEC_DEV_REC* p_dev_rec = btm_find_dev(bd_addr);
+  return p_dev_rec != NULL && p_dev_rec->rs_refused_conns;
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_GetPeerPreferredRole
+ *
+ * Description      Returns the local role the peer last switched the link to
+ *                  by itself, or BTM_ROLE_UNDEFINED if it never did.
+ *
+ ******************************************************************************/
+uint8_t BTM_GetPeerPreferredRole(const RawAddress& bd_addr) {
+  tBTM_SEC_DEV_REC* p_dev_rec = btm_find_dev(bd_addr);
+  if (p_dev_rec == NULL || !p_dev_rec->link_outcome_loaded)
+    return BTM_ROLE_UNDEFINED;
+  return p_dev_rec->peer_pref_role;
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsPeerSniffRefused
+ *
+ * Description      Returns true if the peer refused sniff mode on a recent
+ *                  connection.
+ *
+ ******************************************************************************/
+bool BTM_IsPeerSniffRefused(const RawAddress& bd_addr) {
+  tBTM_SEC_DEV_REC* p_dev_rec = btm_find_dev(bd_addr);
+  return p_dev_rec != NULL && p_dev_rec->sniff_refused_conns;
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_SetPeerSniffRefused
+ *
+ * Description      Records that the peer refused sniff mode, so that it is
+ *                  not requested on its next connections.
+ *
+ ******************************************************************************/
+void BTM_SetPeerSniffRefused(const RawAddress& bd_addr) {
+  tBTM_SEC_DEV_REC* p_dev_rec = btm_find_dev(bd_addr);
+  if (p_dev_rec == NULL || !p_dev_rec->link_outcome_loaded) return;
+
+  p_dev_rec->sniff_refused_conns = BTM_PEER_REFUSED_CONNS;
+  btm_acl_store_peer_outcome(bd_addr, BTM_PEER_SNIFF_REFUSED_KEY,
+                             BTM_PEER_REFUSED_CONNS);
+}
+
 /*******************************************************************************
  *
  * Function         btm_acl_role_changed
@@ -1731,6 +2008,29 @@ void btm_acl_role_changed(uint8_t hci_status, const RawAddress* bd_addr,
 
   p_data->hci_status = hci_status;
 
+  p_dev_rec = btm_find_dev(*p_bda);
+  if (p_dev_rec != NULL && p_dev_rec->link_outcome_loaded) {
+    if (hci_status == HCI_SUCCESS &&
+        p->switch_role_state == BTM_ACL_SWKEY_STATE_IDLE) {
+      /* the peer switched the link itself, remember the role it wanted */
+      if (p_dev_rec->peer_pref_role != new_role) {
+        p_dev_rec->peer_pref_role = new_role;
+        btm_acl_store_peer_outcome(*p_bda, BTM_PEER_PREF_ROLE_KEY, new_role);
+      }
+    } else if (hci_status == HCI_SUCCESS) {
+      if (p_dev_rec->rs_refused_conns) {
+        p_dev_rec->rs_refused_conns = 0;
+        btm_acl_store_peer_outcome(*p_bda, BTM_PEER_RS_REFUSED_KEY, 0);
+      }
+    } else if (hci_status == HCI_ERR_ROLE_CHANGE_NOT_ALLOWED ||
+               hci_status == HCI_ERR_UNSUPPORTED_REM_FEATURE ||
+               hci_status == HCI_ERR_UNSUPPORTED_LMP_FEATURE) {
+      p_dev_rec->rs_refused_conns = BTM_PEER_REFUSED_CONNS;
+      btm_acl_store_peer_outcome(*p_bda, BTM_PEER_RS_REFUSED_KEY,
+                                 BTM_PEER_REFUSED_CONNS);
+    }
+  }
+
   if (hci_status == HCI_SUCCESS) {
     p_data->role = new_role;
     p_data->remote_bd_addr = *p_bda;
@@ -1906,6 +2206,39 @@ tBTM_STATUS btm_set_packet_types(tACL_CONN* p, uint16_t pkt_types) {
   return (BTM_CMD_STARTED);
 }
 
+/*******************************************************************************
+ *
+ * Function         BTM_SetPacketTypes
+ *
+ * Description      This function sets the packet types used on the BR/EDR
+ *                  ACL connection to remote_bda.
+ *
+ * Returns          BTM_CMD_STARTED if successfully initiated, otherwise error
+ *
+ ******************************************************************************/
+tBTM_STATUS BTM_SetPacketTypes(const RawAddress& remote_bda,
+                               uint16_t pkt_types) {
+  tACL_CONN* p = btm_bda_to_acl(remote_bda, BT_TRANSPORT_BR_EDR);
+  if (p == NULL) return (BTM_UNKNOWN_ADDR);
+
+  return btm_set_packet_types(p, pkt_types);
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_ReadPacketTypes
+ *
+ * Description      This function returns the packet types used on the BR/EDR
+ *                  ACL connection to remote_bda.
+ *
+ * Returns          The packet types mask, 0 if there is no such connection
+ *
+ ******************************************************************************/
+uint16_t BTM_ReadPacketTypes(const RawAddress& remote_bda) {
+  tACL_CONN* p = btm_bda_to_acl(remote_bda, BT_TRANSPORT_BR_EDR);
+  return (p != NULL) ? p->pkt_types_mask : 0;
+}
+
 /*******************************************************************************
  *
  * Function         btm_get_max_packet_size
@@ -1324,6 +1324,22 @@ bool btm_ble_get_enc_key_type(const RawAddress& bd_addr, uint8_t* p_key_types) {
   return false;
 }
 
+/*******************************************************************************
+ *
+ * Function         BTM_BleIsPeerEncKeyKnown
+ *
+ * Description      Check if the LE encryption key of a peer is known, from
+ *                  the bonded device records kept in memory.
+ *
+ * Returns          true if the key is known, false otherwise.
+ *
+ ******************************************************************************/
+bool BTM_BleIsPeerEncKeyKnown(const RawAddress& bd_addr) {
+  tBTM_SEC_DEV_REC* p_dev_rec = btm_find_dev(bd_addr);
+
+  return p_dev_rec != NULL && (p_dev_rec->ble.key_type & BTM_LE_KEY_PENC);
+}
+
 /*******************************************************************************
  *
  * Function         btm_get_local_div
@@ -1401,6 +1417,7 @@ void btm_sec_save_le_key(const RawAddress& bd_addr, tBTM_LE_KEY_TYPE key_type,
         p_rec->ble.identity_addr = p_keys->pid_key.identity_addr;
         p_rec->ble.identity_addr_type = p_keys->pid_key.identity_addr_type;
         p_rec->ble.key_type |= BTM_LE_KEY_PID;
+        btm_ble_rpa_cache_invalidate();
         BTM_TRACE_DEBUG(
             "%s: BTM_LE_KEY_PID key_type=0x%x save peer IRK, change bd_addr=%s "
             "to id_addr=%s id_addr_type=0x%x",
@@ -1955,6 +1972,9 @@ void btm_ble_connected(const RawAddress& bda, uint16_t handle, uint8_t enc_mode,
 
   BTM_TRACE_EVENT("btm_ble_connected");
 
+  /* The keys are stored under the identity address of a resolved device */
+  btm_sec_load_deferred_dev(p_dev_rec ? p_dev_rec->bd_addr : bda);
+
   /* Commenting out trace due to obf/compilation problems.
   */
   if (p_dev_rec) {
@@ -1976,7 +1996,7 @@ void btm_ble_connected(const RawAddress& bda, uint16_t handle, uint8_t enc_mode,
     if (p_dev_rec == NULL) return;
   } else /* Update the timestamp for this device */
   {
-    p_dev_rec->timestamp = btm_cb.dev_rec_count++;
+    btm_sec_dev_rec_touch(p_dev_rec);
   }
 
   /* update device information */
@@ -1994,6 +2014,9 @@ void btm_ble_connected(const RawAddress& bda, uint16_t handle, uint8_t enc_mode,
 
   if (p_dev_rec->ble.ble_addr_type == BLE_ADDR_RANDOM && !addr_matched)
     p_dev_rec->ble.cur_rand_addr = bda;
+
+  p_dev_rec->ble.rl_timestamp = p_dev_rec->timestamp;
+  btm_ble_resolving_list_promote_dev(p_dev_rec);
 #endif
 
   p_cb->inq_var.directed_conn = BTM_BLE_CONNECT_EVT;
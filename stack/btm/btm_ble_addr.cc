@@ -23,7 +23,11 @@
  ******************************************************************************/
 
 #include <base/bind.h>
+#include <inttypes.h>
+#include <stdio.h>
 #include <string.h>
+#include <list>
+#include <unordered_map>
 
 #include "bt_types.h"
 #include "btm_int.h"
@@ -31,6 +35,8 @@
 #include "device/include/controller.h"
 #include "gap_api.h"
 #include "hcimsgs.h"
+#include "osi/include/osi.h"
+#include "osi/include/time.h"
 
 #include "btm_ble_int.h"
 #include "stack/crypto_toolbox/crypto_toolbox.h"
@@ -85,10 +91,82 @@ void btm_gen_resolve_paddr_low(const RawAddress& address) {
   }
 }
 
-/** This function generate a resolvable private address using local IRK */
+/* Local RPAs made ahead of time from the host random source and the local
+ * IRK, so that an address rotation, for the local privacy address or for an
+ * advertising set, is a swap instead of an HCI LE Rand round trip. The pool
+ * is owned by the btu thread and refilled there after each use. It is
+ * dropped when the local IRK changes. */
+#define BTM_BLE_RPA_POOL_SIZE 8
+
+static RawAddress rpa_pool[BTM_BLE_RPA_POOL_SIZE];
+static uint8_t rpa_pool_count;
+static Octet16 rpa_pool_irk; /* IRK the pooled RPAs were made with */
+static bool rpa_pool_refill_scheduled;
+static uint64_t rpa_pool_hits;
+static uint64_t rpa_pool_misses;
+
+static void btm_ble_rpa_pool_refill(void) {
+  const Octet16& irk = BTM_GetDeviceIDRoot();
+  uint8_t bytes[BTM_BLE_RPA_POOL_SIZE * 3];
+
+  rpa_pool_refill_scheduled = false;
+  if (rpa_pool_irk != irk) {
+    rpa_pool_count = 0;
+    rpa_pool_irk = irk;
+  }
+
+  uint8_t needed = BTM_BLE_RPA_POOL_SIZE - rpa_pool_count;
+  if (needed == 0 || !osi_rand_bytes(bytes, needed * 3)) return;
+
+  for (uint8_t i = 0; i < needed; i++) {
+    BT_OCTET8 random = {bytes[i * 3], bytes[i * 3 + 1], bytes[i * 3 + 2]};
+
+    /* The random part of prand may not be all 0s or all 1s */
+    uint8_t msb = random[2] & ~BLE_RESOLVE_ADDR_MASK;
+    if ((random[0] == 0 && random[1] == 0 && msb == 0) ||
+        (random[0] == 0xff && random[1] == 0xff &&
+         msb == (uint8_t)~BLE_RESOLVE_ADDR_MASK))
+      continue;
+
+    rpa_pool[rpa_pool_count++] = generate_rpa_from_irk_and_rand(irk, random);
+  }
+  memset(bytes, 0, sizeof(bytes));
+}
+
+static void btm_ble_rpa_pool_schedule_refill(void) {
+  if (rpa_pool_refill_scheduled) return;
+
+  base::MessageLoop* message_loop = get_message_loop();
+  if (!message_loop || !message_loop->task_runner().get()) {
+    btm_ble_rpa_pool_refill();
+    return;
+  }
+
+  rpa_pool_refill_scheduled = true;
+  message_loop->task_runner()->PostTask(FROM_HERE,
+                                        base::Bind(&btm_ble_rpa_pool_refill));
+}
+
+/** This function generate a resolvable private address using local IRK. The
+ * address comes from the RPA pool when it can, the callback then runs before
+ * this function returns. */
 void btm_gen_resolvable_private_addr(
     base::Callback<void(const RawAddress&)> cb) {
   BTM_TRACE_EVENT("%s", __func__);
+
+  if (rpa_pool_count == 0 || rpa_pool_irk != BTM_GetDeviceIDRoot())
+    btm_ble_rpa_pool_refill();
+
+  if (rpa_pool_count > 0) {
+    RawAddress rpa = rpa_pool[--rpa_pool_count];
+    rpa_pool[rpa_pool_count] = RawAddress::kEmpty;
+    rpa_pool_hits++;
+    btm_ble_rpa_pool_schedule_refill();
+    cb.Run(rpa);
+    return;
+  }
+
+  rpa_pool_misses++;
   /* generate 3B rand as BD LSB, SRK with it, get BD MSB */
   btsnd_hcic_ble_rand(base::Bind(
       [](base::Callback<void(const RawAddress&)> cb, BT_OCTET8 random) {
@@ -205,6 +283,103 @@ static bool rpa_matches_irk(const RawAddress& rpa, const Octet16& irk) {
   return false;
 }
 
+/* Cache of RPA resolution results. Resolving an RPA means running AES-128
+ * against the IRK of every bonded LE device, and the same peer RPA is seen on
+ * every advertising report until it rotates. A positive entry maps the RPA to
+ * the record whose IRK resolved it; a negative entry remembers that no IRK
+ * matched. Entries age out after the RPA rotation interval, and the whole
+ * cache is flushed whenever the set of known IRKs changes. */
+#define BTM_BLE_RPA_CACHE_MAX_ENTRIES 256
+#define BTM_BLE_RPA_CACHE_TTL_MS (15 * 60 * 1000)
+
+namespace {
+
+struct RpaAddrHash {
+  std::size_t operator()(const RawAddress& x) const {
+    const uint8_t* a = x.address;
+    return a[0] ^ (a[1] << 8) ^ (a[2] << 16) ^ (a[3] << 24) ^ a[4] ^
+           (a[5] << 8);
+  }
+};
+
+struct RpaCacheEntry {
+  tBTM_SEC_DEV_REC* p_dev_rec; /* nullptr for a negative entry */
+  period_ms_t timestamp;
+  std::list<RawAddress>::iterator lru_pos;
+};
+
+std::unordered_map<RawAddress, RpaCacheEntry, RpaAddrHash> rpa_cache;
+std::list<RawAddress> rpa_cache_lru; /* front is the least recently used */
+
+uint64_t rpa_cache_positive_hits;
+uint64_t rpa_cache_negative_hits;
+uint64_t rpa_cache_misses;
+uint64_t rpa_cache_flushes;
+
+void rpa_cache_erase(
+    std::unordered_map<RawAddress, RpaCacheEntry, RpaAddrHash>::iterator it) {
+  rpa_cache_lru.erase(it->second.lru_pos);
+  rpa_cache.erase(it);
+}
+
+/* Returns true and fills |p_dev_rec| if |rpa| has a live cache entry. */
+bool rpa_cache_lookup(const RawAddress& rpa, tBTM_SEC_DEV_REC** p_dev_rec) {
+  auto it = rpa_cache.find(rpa);
+  if (it == rpa_cache.end()) return false;
+
+  if (time_get_os_boottime_ms() - it->second.timestamp >
+      BTM_BLE_RPA_CACHE_TTL_MS) {
+    rpa_cache_erase(it);
+    return false;
+  }
+
+  rpa_cache_lru.splice(rpa_cache_lru.end(), rpa_cache_lru,
+                       it->second.lru_pos);
+  *p_dev_rec = it->second.p_dev_rec;
+  return true;
+}
+
+void rpa_cache_insert(const RawAddress& rpa, tBTM_SEC_DEV_REC* p_dev_rec) {
+  auto it = rpa_cache.find(rpa);
+  if (it != rpa_cache.end()) rpa_cache_erase(it);
+
+  if (rpa_cache.size() >= BTM_BLE_RPA_CACHE_MAX_ENTRIES)
+    rpa_cache_erase(rpa_cache.find(rpa_cache_lru.front()));
+
+  rpa_cache_lru.push_back(rpa);
+  rpa_cache[rpa] = {p_dev_rec, time_get_os_boottime_ms(),
+                    std::prev(rpa_cache_lru.end())};
+}
+
+}  // namespace
+
+/** Drop every cached RPA resolution. Must be called whenever an IRK is added,
+ * changed or removed, or a security record is freed.
+ */
+void btm_ble_rpa_cache_invalidate(void) {
+  if (rpa_cache.empty()) return;
+  rpa_cache.clear();
+  rpa_cache_lru.clear();
+  rpa_cache_flushes++;
+}
+
+/** Dump RPA resolution cache statistics to |fd|. */
+void BTM_BleRpaCacheDump(int fd) {
+  dprintf(fd, "\nRPA resolution cache:\n");
+  dprintf(fd, "  entries: %zu (max %d)\n", rpa_cache.size(),
+          BTM_BLE_RPA_CACHE_MAX_ENTRIES);
+  dprintf(fd, "  positive hits: %" PRIu64 "\n", rpa_cache_positive_hits);
+  dprintf(fd, "  negative hits: %" PRIu64 "\n", rpa_cache_negative_hits);
+  dprintf(fd, "  misses: %" PRIu64 "\n", rpa_cache_misses);
+  dprintf(fd, "  flushes: %" PRIu64 "\n", rpa_cache_flushes);
+
+  dprintf(fd, "\nLocal RPA pool:\n");
+  dprintf(fd, "  ready: %d (max %d)\n", rpa_pool_count,
+          BTM_BLE_RPA_POOL_SIZE);
+  dprintf(fd, "  taken: %" PRIu64 ", HCI LE Rand fallbacks: %" PRIu64 "\n",
+          rpa_pool_hits, rpa_pool_misses);
+}
+
 /** This function checks if a RPA is resolvable by the device key.
  *  Returns true is resolvable; false otherwise.
  */
@@ -214,9 +389,26 @@ bool btm_ble_addr_resolvable(const RawAddress& rpa,
 
   if ((p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) &&
       (p_dev_rec->ble.key_type & BTM_LE_KEY_PID)) {
+    /* A negative entry means no known IRK resolves |rpa|. A positive entry
+     * for another record is not conclusive, as two records may share an IRK
+     * until they are consolidated. */
+    tBTM_SEC_DEV_REC* p_cached = nullptr;
+    if (rpa_cache_lookup(rpa, &p_cached)) {
+      if (p_cached == nullptr) {
+        rpa_cache_negative_hits++;
+        return false;
+      }
+      if (p_cached == p_dev_rec) {
+        rpa_cache_positive_hits++;
+        btm_ble_init_pseudo_addr(p_dev_rec, rpa);
+        return true;
+      }
+    }
+
     BTM_TRACE_DEBUG("%s try to resolve", __func__);
 
     if (rpa_matches_irk(rpa, p_dev_rec->ble.keys.irk)) {
+      rpa_cache_insert(rpa, p_dev_rec);
       btm_ble_init_pseudo_addr(p_dev_rec, rpa);
       return true;
     }
@@ -257,6 +449,18 @@ static bool btm_ble_match_random_bda(void* data, void* context) {
 tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(const RawAddress& random_bda) {
   BTM_TRACE_EVENT("%s", __func__);
 
+  tBTM_SEC_DEV_REC* p_cached = nullptr;
+  if (rpa_cache_lookup(random_bda, &p_cached)) {
+    if (p_cached != nullptr)
+      rpa_cache_positive_hits++;
+    else
+      rpa_cache_negative_hits++;
+    BTM_TRACE_EVENT("%s:  %sresolved (cached)", __func__,
+                    (p_cached == nullptr ? "not " : ""));
+    return p_cached;
+  }
+  rpa_cache_misses++;
+
   /* start to resolve random address */
   /* check for next security record */
 
@@ -264,6 +468,7 @@ tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(const RawAddress& random_bda) {
                                 (void*)&random_bda);
   tBTM_SEC_DEV_REC* p_dev_rec = nullptr;
   if (n != nullptr) p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  rpa_cache_insert(random_bda, p_dev_rec);
 
   BTM_TRACE_EVENT("%s:  %sresolved", __func__,
                   (p_dev_rec == nullptr ? "not " : ""));
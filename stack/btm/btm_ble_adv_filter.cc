@@ -82,6 +82,31 @@ bool is_filtering_supported() {
   return cmn_ble_vsc_cb.filter_support != 0 && cmn_ble_vsc_cb.max_filter != 0;
 }
 
+/* Filters are evaluated by the host when the controller has none */
+static bool is_host_filtering() {
+  return !is_filtering_supported() && btm_ble_host_filter_max() > 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_BleMaxScanFilters
+ *
+ * Description      This function returns the number of scan filter indexes,
+ *                  either of the controller or of the host filters.
+ *
+ * Returns          number of filter indexes, 0 if filtering is unavailable
+ *
+ ******************************************************************************/
+uint8_t BTM_BleMaxScanFilters(void) {
+  tBTM_BLE_VSC_CB vsc_cb;
+
+  BTM_BleGetVendorCapabilities(&vsc_cb);
+  if (vsc_cb.filter_support == 1 && vsc_cb.max_filter != 0)
+    return vsc_cb.max_filter;
+
+  return btm_ble_host_filter_max();
+}
+
 /*******************************************************************************
  *
  * Function         btm_ble_condtype_to_ocf
@@ -648,6 +673,12 @@ void BTM_LE_PF_tds_data(tBTM_BLE_SCAN_COND_OP action,
 void BTM_LE_PF_set(tBTM_BLE_PF_FILT_INDEX filt_index,
                    std::vector<ApcfCommand> commands,
                    tBTM_BLE_PF_CFG_CBACK cb) {
+  if (is_host_filtering()) {
+    bool ok = btm_ble_host_filter_set(filt_index, commands);
+    cb.Run(0, 0, ok ? 0 : 1 /* BTA_FAILURE */);
+    return;
+  }
+
   if (!is_filtering_supported()) {
     cb.Run(0, BTM_BLE_PF_ENABLE, 1 /* BTA_FAILURE */);
     return;
@@ -739,6 +770,12 @@ void BTM_LE_PF_set(tBTM_BLE_PF_FILT_INDEX filt_index,
  */
 void BTM_LE_PF_clear(tBTM_BLE_PF_FILT_INDEX filt_index,
                      tBTM_BLE_PF_CFG_CBACK cb) {
+  if (is_host_filtering()) {
+    bool ok = btm_ble_host_filter_clear(filt_index);
+    cb.Run(0, BTM_BLE_SCAN_COND_CLEAR, ok ? 0 : 1 /* BTA_FAILURE */);
+    return;
+  }
+
   if (!is_filtering_supported()) {
     cb.Run(0, BTM_BLE_PF_ENABLE, 1 /* BTA_FAILURE */);
     return;
@@ -820,6 +857,13 @@ void BTM_BleAdvFilterParamSetup(
                 BTM_BLE_ADV_FILT_FEAT_SELN_LEN + BTM_BLE_ADV_FILT_TRACK_NUM;
   uint8_t param[len], *p;
 
+  if (is_host_filtering()) {
+    bool ok = btm_ble_host_filter_param_setup(action, filt_index,
+                                              p_filt_params.get());
+    cb.Run(btm_ble_host_filter_max(), action, ok ? 0 : 1 /* BTA_FAILURE */);
+    return;
+  }
+
   if (!is_filtering_supported()) {
     cb.Run(0, BTM_BLE_PF_ENABLE, 1 /* BTA_FAILURE */);
     return;
@@ -938,6 +982,12 @@ void enable_cmpl_cback(tBTM_BLE_PF_STATUS_CBACK p_stat_cback, uint8_t* p,
  ******************************************************************************/
 void BTM_BleEnableDisableFilterFeature(uint8_t enable,
                                        tBTM_BLE_PF_STATUS_CBACK p_stat_cback) {
+  if (is_host_filtering()) {
+    btm_ble_host_filter_enable(enable != 0);
+    if (p_stat_cback) p_stat_cback.Run(enable, BTM_SUCCESS);
+    return;
+  }
+
   if (!is_filtering_supported()) {
     if (p_stat_cback) p_stat_cback.Run(BTM_BLE_PF_ENABLE, 1 /* BTA_FAILURE */);
     return;
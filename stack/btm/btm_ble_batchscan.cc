@@ -244,7 +244,10 @@ void btm_ble_read_batchscan_reports(tBTM_BLE_BATCH_SCAN_MODE scan_mode,
 }
 
 /* read reports. data is accumulated in |data_all|, number of records is
- * accumulated in |num_records_all| */
+ * accumulated in |num_records_all|. The records gathered so far are delivered
+ * whenever the next fragment would take them over
+ * BTM_BLE_BATCH_SCAN_REPORT_CHUNK_MAX bytes or 255 records, the last chunk is
+ * delivered when the controller has no more records. */
 void read_reports_cb(std::vector<uint8_t> data_all, uint8_t num_records_all,
                      tBTM_BLE_SCAN_REP_CBACK cb, uint8_t* p, uint16_t len) {
   if (len < 2) {
@@ -276,12 +279,23 @@ void read_reports_cb(std::vector<uint8_t> data_all, uint8_t num_records_all,
   }
 
   if (len > 4) {
-    data_all.insert(data_all.end(), p, p + len - 4);
+    size_t fragment_len = len - 4;
+    if (!data_all.empty() &&
+        (data_all.size() + fragment_len > BTM_BLE_BATCH_SCAN_REPORT_CHUNK_MAX ||
+         num_records_all + num_records > UINT8_MAX)) {
+      BTM_TRACE_DEBUG("%s: delivering %d records, %zu bytes", __func__,
+                      num_records_all, data_all.size());
+      cb.Run(status, report_format, num_records_all, std::move(data_all));
+      data_all = std::vector<uint8_t>();
+      num_records_all = 0;
+    }
+
+    data_all.insert(data_all.end(), p, p + fragment_len);
     num_records_all += num_records;
 
     /* More records could be in the buffer and needs to be pulled out */
     btm_ble_read_batchscan_reports(
-        report_format, base::Bind(&read_reports_cb, std::move(data_all),
+        report_format, base::Bind(&read_reports_cb, base::Passed(&data_all),
                                   num_records_all, std::move(cb)));
   }
 }
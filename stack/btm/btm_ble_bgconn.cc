@@ -22,7 +22,11 @@
  *
  ******************************************************************************/
 
+#include <base/bind.h>
+#include <base/location.h>
 #include <base/logging.h>
+#include <inttypes.h>
+#include <stdio.h>
 #include <unordered_map>
 
 #include "bt_types.h"
@@ -31,6 +35,7 @@
 #include "device/include/controller.h"
 #include "hcimsgs.h"
 #include "l2c_int.h"
+#include "osi/include/time.h"
 
 extern void btm_send_hci_create_connection(
     uint16_t scan_int, uint16_t scan_win, uint8_t init_filter_policy,
@@ -126,6 +131,19 @@ static bool background_connections_pending() {
   return false;
 }
 
+/* true if the white list programmed in the controller is not the one the
+ * background connection needs */
+static bool background_connections_need_sync() {
+  for (auto& map_el : background_connections) {
+    BackgroundConnection* connection = &map_el.second;
+    if (connection->pending_removal) return true;
+    const bool connected =
+        BTM_IsAclConnectionUp(connection->address, BT_TRANSPORT_LE);
+    if (connection->in_controller_wl == connected) return true;
+  }
+  return false;
+}
+
 static int background_connections_count() {
   int count = 0;
   for (auto& map_el : background_connections) {
@@ -257,6 +275,9 @@ bool btm_add_dev_to_controller(bool to_add, const RawAddress& bd_addr) {
       }
 
       p_dev_rec->ble.in_controller_list |= BTM_WHITE_LIST_BIT;
+#if (BLE_PRIVACY_SPT == TRUE)
+      btm_ble_resolving_list_promote_dev(p_dev_rec);
+#endif
     } else {
       if (!p_dev_rec->ble.identity_addr.IsEmpty()) {
         if (p_dev_rec->ble.ble_addr_type == BLE_ADDR_RANDOM &&
@@ -387,6 +408,61 @@ void BTM_SetLeConnectionModeToSlow() {
   }
 }
 
+// White list changes requested while handling one message are applied
+// together, once the message loop gets to the scheduled sync.
+static bool bg_conn_sync_scheduled = false;
+static uint64_t bg_conn_syncs = 0;
+static uint64_t bg_conn_syncs_unchanged = 0;
+
+// Time the background connection spent stopped for a white list or resolving
+// list update, from the cancel to the next create connection.
+static uint32_t bg_conn_suspended_since_ms = 0;
+static uint64_t bg_conn_suspensions = 0;
+static uint64_t bg_conn_suspended_total_ms = 0;
+static uint64_t bg_conn_suspended_max_ms = 0;
+
+static void btm_ble_bgconn_sync() {
+  bg_conn_sync_scheduled = false;
+  bg_conn_syncs++;
+
+  if (btm_cb.ble_ctr_cb.wl_state & BTM_BLE_WL_INIT) {
+    if (!background_connections_need_sync()) {
+      bg_conn_syncs_unchanged++;
+      return;
+    }
+    // the connection is started again when the cancel completes
+    btm_ble_stop_auto_conn();
+    return;
+  }
+  btm_ble_resume_bg_conn();
+}
+
+static void btm_ble_bgconn_schedule_sync() {
+  if (bg_conn_sync_scheduled) return;
+
+  base::MessageLoop* message_loop = get_message_loop();
+  if (!message_loop || !message_loop->task_runner().get()) {
+    btm_ble_bgconn_sync();
+    return;
+  }
+
+  bg_conn_sync_scheduled = true;
+  message_loop->task_runner()->PostTask(FROM_HERE,
+                                        base::Bind(&btm_ble_bgconn_sync));
+}
+
+void BTM_BleBgConnDump(int fd) {
+  dprintf(fd, "\nLE background connection:\n");
+  dprintf(fd, "  devices: %d\n", background_connections_count());
+  dprintf(fd, "  white list syncs: %" PRIu64 " (%" PRIu64 " unchanged)\n",
+          bg_conn_syncs, bg_conn_syncs_unchanged);
+  dprintf(fd,
+          "  suspensions: %" PRIu64 ", total %" PRIu64 " ms, max %" PRIu64
+          " ms\n",
+          bg_conn_suspensions, bg_conn_suspended_total_ms,
+          bg_conn_suspended_max_ms);
+}
+
 /** This function is to start auto connection procedure */
 bool btm_ble_start_auto_conn() {
   tBTM_BLE_CB* p_cb = &btm_cb.ble_ctr_cb;
@@ -414,6 +490,9 @@ bool btm_ble_start_auto_conn() {
   RawAddress rem_bd_addr = get_bg_conn_pending_bdaddr();
   tL2C_LCB* p_lcb = l2cu_find_lcb_by_bd_addr(rem_bd_addr, BT_TRANSPORT_LE);
 
+  // nothing waits for the background connection any more
+  if (!background_connections_pending()) bg_conn_suspended_since_ms = 0;
+
   if (btm_ble_get_conn_st() != BLE_CONN_IDLE ||
       !background_connections_pending() ||
       (!p_lcb && !l2cu_can_allocate_lcb())) {
@@ -449,6 +528,16 @@ bool btm_ble_start_auto_conn() {
       0,                              /* uint16_t min_len       */
       0,                              /* uint16_t max_len       */
       phy);
+
+  if (bg_conn_suspended_since_ms != 0) {
+    uint32_t suspended_ms =
+        time_get_os_boottime_ms() - bg_conn_suspended_since_ms;
+    bg_conn_suspended_since_ms = 0;
+    bg_conn_suspensions++;
+    bg_conn_suspended_total_ms += suspended_ms;
+    if (suspended_ms > bg_conn_suspended_max_ms)
+      bg_conn_suspended_max_ms = suspended_ms;
+  }
   return true;
 }
 
@@ -464,6 +553,9 @@ bool btm_ble_stop_auto_conn() {
 
   btm_ble_create_conn_cancel();
 
+  if ((btm_cb.ble_ctr_cb.wl_state & BTM_BLE_WL_INIT) &&
+      bg_conn_suspended_since_ms == 0)
+    bg_conn_suspended_since_ms = time_get_os_boottime_ms();
   btm_cb.ble_ctr_cb.wl_state &= ~BTM_BLE_WL_INIT;
   return true;
 }
@@ -510,22 +602,16 @@ bool BTM_WhiteListAdd(const RawAddress& address) {
     return false;
   }
 
-  if (btm_cb.ble_ctr_cb.wl_state & BTM_BLE_WL_INIT) {
-    btm_ble_stop_auto_conn();
-  }
   btm_add_dev_to_controller(true, address);
-  btm_ble_resume_bg_conn();
+  btm_ble_bgconn_schedule_sync();
   return true;
 }
 
 /** Removes the device from white list */
 void BTM_WhiteListRemove(const RawAddress& address) {
   VLOG(1) << __func__ << ": " << address;
-  if (btm_cb.ble_ctr_cb.wl_state & BTM_BLE_WL_INIT) {
-    btm_ble_stop_auto_conn();
-  }
   btm_add_dev_to_controller(false, address);
-  btm_ble_resume_bg_conn();
+  btm_ble_bgconn_schedule_sync();
 }
 
 /** clear white list complete */
@@ -63,6 +63,18 @@
 #define MIN_ADV_LENGTH 2
 #define BTM_VSC_CHIP_CAPABILITY_RSP_LEN_L_RELEASE 9
 
+/* An advertising report that repeats the last one forwarded for the same
+ * advertiser is dropped, unless it is older than this many milliseconds or its
+ * RSSI moved by at least BTM_BLE_ADV_DEDUP_RSSI_DELTA dBm. 0 disables the
+ * filtering. */
+#ifndef BTM_BLE_ADV_DEDUP_TIMEOUT_MS
+#define BTM_BLE_ADV_DEDUP_TIMEOUT_MS 500
+#endif
+
+#ifndef BTM_BLE_ADV_DEDUP_RSSI_DELTA
+#define BTM_BLE_ADV_DEDUP_RSSI_DELTA 5
+#endif
+
 namespace {
 
 class AdvertisingCache {
@@ -137,6 +149,96 @@ class AdvertisingCache {
  * on secondary channel */
 AdvertisingCache cache;
 
+class AdvertisingReportDedupCache {
+ public:
+  /* Check the report from advertising set |sid| of |addr_type, addr| against
+   * the last one forwarded. |standalone| is false for a report that is only
+   * part of the advertising data, the report after it is then never a
+   * duplicate. Returns true if the report should be dropped. */
+  bool IsDuplicate(uint8_t addr_type, const RawAddress& addr, uint8_t sid,
+                   uint16_t evt_type, bool standalone, int8_t rssi,
+                   const uint8_t* data, uint8_t data_len) {
+    auto it = Find(addr_type, addr, sid);
+    if (it == items.end()) {
+      if (items.size() >= cache_max) items.pop_back();
+      items.emplace_front(addr_type, addr, sid);
+    } else if (it != items.begin()) {
+      items.splice(items.begin(), items, it);
+    }
+
+    Item& item = items.front();
+    if (!standalone || item.pending) {
+      item.pending = !standalone;
+      item.valid = false;
+      return false;
+    }
+
+    uint64_t now = time_get_os_boottime_ms();
+    uint32_t hash = Hash(data, data_len);
+    if (item.valid && item.evt_type == evt_type && item.data_len == data_len &&
+        item.hash == hash && now - item.time_ms < BTM_BLE_ADV_DEDUP_TIMEOUT_MS &&
+        abs(rssi - item.rssi) < BTM_BLE_ADV_DEDUP_RSSI_DELTA) {
+      return true;
+    }
+
+    item.valid = true;
+    item.evt_type = evt_type;
+    item.data_len = data_len;
+    item.hash = hash;
+    item.rssi = rssi;
+    item.time_ms = now;
+    return false;
+  }
+
+  /* Forget every advertiser, so that the next report of each is forwarded */
+  void Clear() { items.clear(); }
+
+ private:
+  struct Item {
+    uint8_t addr_type;
+    RawAddress addr;
+    uint8_t sid;
+    bool pending = false; /* last report was not the whole data */
+    bool valid = false;   /* the fields below describe the last report */
+    uint16_t evt_type = 0;
+    uint8_t data_len = 0;
+    uint32_t hash = 0;
+    int8_t rssi = 0;
+    uint64_t time_ms = 0;
+
+    Item(uint8_t addr_type, const RawAddress& addr, uint8_t sid)
+        : addr_type(addr_type), addr(addr), sid(sid) {}
+  };
+
+  /* FNV-1a */
+  static uint32_t Hash(const uint8_t* data, uint8_t data_len) {
+    uint32_t hash = 2166136261u;
+    for (uint8_t i = 0; i < data_len; i++) {
+      hash ^= data[i];
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+
+  std::list<Item>::iterator Find(uint8_t addr_type, const RawAddress& addr,
+                                 uint8_t sid) {
+    for (auto it = items.begin(); it != items.end(); it++) {
+      if (it->addr_type == addr_type && it->addr == addr && it->sid == sid) {
+        return it;
+      }
+    }
+    return items.end();
+  }
+
+  /* we keep the most recently heard 32 advertisers */
+  const size_t cache_max = 32;
+  std::list<Item> items;
+};
+
+/* Last report forwarded for each advertiser, keyed by the over the air address
+ * so that repeated reports are dropped before address resolution */
+AdvertisingReportDedupCache dedup_cache;
+
 }  // namespace
 
 #if (BLE_VND_INCLUDED == TRUE)
@@ -1315,7 +1417,7 @@ void btm_send_hci_set_scan_params(uint8_t scan_phy, uint8_t scan_type,
   }
 }
 
-bool btm_ble_is_scan_params_low_latency() {
+static bool btm_ble_is_scan_params(uint16_t interval, uint16_t window) {
     bool result = true;
     tBTM_BLE_CB* p_ble_cb = &btm_cb.ble_ctr_cb;
     uint8_t i=0, cnt=0;
@@ -1325,8 +1427,8 @@ bool btm_ble_is_scan_params_low_latency() {
     }
     int phy_cnt = std::bitset<std::numeric_limits<uint8_t>::digits>(p_ble_cb->inq_var.scan_phy).count();
     for(i=0; i< phy_cnt; i++) {
-        if ((p_ble_cb->inq_var.scan_interval[i] != BTM_BLE_LOW_LATENCY_SCAN_INT) ||
-           (p_ble_cb->inq_var.scan_window[i] != BTM_BLE_LOW_LATENCY_SCAN_WIN)) {
+        if ((p_ble_cb->inq_var.scan_interval[i] != interval) ||
+           (p_ble_cb->inq_var.scan_window[i] != window)) {
             cnt++;
         }
     }
@@ -1337,6 +1439,11 @@ bool btm_ble_is_scan_params_low_latency() {
     return result;
 }
 
+bool btm_ble_is_scan_params_low_latency() {
+  return btm_ble_is_scan_params(BTM_BLE_LOW_LATENCY_SCAN_INT,
+                                BTM_BLE_LOW_LATENCY_SCAN_WIN);
+}
+
 /*******************************************************************************
  *
  * Function         btm_ble_start_inquiry
@@ -1364,6 +1471,8 @@ tBTM_STATUS btm_ble_start_inquiry(uint8_t mode, uint8_t duration) {
   tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
   std::vector<uint16_t> scan_interval = {0, 0};
   std::vector<uint16_t> scan_window = {0, 0};
+  uint16_t interval = BTM_BLE_LOW_LATENCY_SCAN_INT;
+  uint16_t window = BTM_BLE_LOW_LATENCY_SCAN_WIN;
   int phy_cnt =0, i=0;
 
   uint8_t scan_phy = SCAN_PHY_LE_1M;
@@ -1379,10 +1488,18 @@ tBTM_STATUS btm_ble_start_inquiry(uint8_t mode, uint8_t duration) {
     return (BTM_BUSY);
   }
 
+#if (BTA_HOST_INTERLEAVE_SEARCH == FALSE)
+  /* A BR/EDR inquiry runs at the same time, leave it some air time */
+  if (p_inq->inqparms.mode & BTM_BR_INQUIRY_MASK) {
+    interval = BTM_BLE_DUAL_MODE_SCAN_INT;
+    window = BTM_BLE_DUAL_MODE_SCAN_WIN;
+  }
+#endif
+
   phy_cnt = std::bitset<std::numeric_limits<uint8_t>::digits>(scan_phy).count();
   for(i=0; i< phy_cnt; i++) {
-    scan_interval[i] = BTM_BLE_LOW_LATENCY_SCAN_INT;
-    scan_window[i] = BTM_BLE_LOW_LATENCY_SCAN_WIN;
+    scan_interval[i] = interval;
+    scan_window[i] = window;
   }
 
   if (!BTM_BLE_IS_SCAN_ACTIVE(p_ble_cb->scan_activity)) {
@@ -1395,9 +1512,8 @@ tBTM_STATUS btm_ble_start_inquiry(uint8_t mode, uint8_t duration) {
 #endif
     p_ble_cb->inq_var.scan_duplicate_filter = BTM_BLE_DUPLICATE_DISABLE;
     status = btm_ble_start_scan();
-  } else if (!btm_ble_is_scan_params_low_latency()) {
-    BTM_TRACE_DEBUG("%s, restart LE scan with low latency scan params",
-                    __func__);
+  } else if (!btm_ble_is_scan_params(interval, window)) {
+    BTM_TRACE_DEBUG("%s, restart LE scan with inquiry scan params", __func__);
     btm_send_hci_scan_enable(BTM_BLE_SCAN_DISABLE, BTM_BLE_DUPLICATE_ENABLE);
     btm_send_hci_set_scan_params(
         scan_phy, BTM_BLE_SCAN_MODE_ACTI, scan_interval,
@@ -1562,8 +1678,8 @@ static void btm_ble_update_adv_flag(uint8_t flag) {
  * Check ADV flag to make sure device is discoverable and match the search
  * condition
  */
-uint8_t btm_ble_is_discoverable(const RawAddress& bda,
-                                std::vector<uint8_t> const& adv_data) {
+uint8_t btm_ble_is_discoverable(
+    const RawAddress& bda, AdvertiseDataParser::FieldIndex const& ad_fields) {
   uint8_t flag = 0, rt = 0;
   uint8_t data_len;
   tBTM_INQ_PARMS* p_cond = &btm_cb.btm_inq_vars.inqparms;
@@ -1579,23 +1695,21 @@ uint8_t btm_ble_is_discoverable(const RawAddress& bda,
     return rt;
   }
 
-  if (!adv_data.empty()) {
-    const uint8_t* p_flag = AdvertiseDataParser::GetFieldByType(
-        adv_data, BTM_BLE_AD_TYPE_FLAG, &data_len);
-    if (p_flag != NULL) {
-      flag = *p_flag;
+  const uint8_t* p_flag =
+      ad_fields.GetFieldByType(BTM_BLE_AD_TYPE_FLAG, &data_len);
+  if (p_flag != NULL) {
+    flag = *p_flag;
 
-      if ((btm_cb.btm_inq_vars.inq_active & BTM_BLE_GENERAL_INQUIRY) &&
-          (flag & (BTM_BLE_LIMIT_DISC_FLAG | BTM_BLE_GEN_DISC_FLAG)) != 0) {
-        BTM_TRACE_DEBUG("Find Generable Discoverable device");
-        rt |= BTM_BLE_INQ_RESULT;
-      }
+    if ((btm_cb.btm_inq_vars.inq_active & BTM_BLE_GENERAL_INQUIRY) &&
+        (flag & (BTM_BLE_LIMIT_DISC_FLAG | BTM_BLE_GEN_DISC_FLAG)) != 0) {
+      BTM_TRACE_DEBUG("Find Generable Discoverable device");
+      rt |= BTM_BLE_INQ_RESULT;
+    }
 
-      else if (btm_cb.btm_inq_vars.inq_active & BTM_BLE_LIMITED_INQUIRY &&
-               (flag & BTM_BLE_LIMIT_DISC_FLAG) != 0) {
-        BTM_TRACE_DEBUG("Find limited discoverable device");
-        rt |= BTM_BLE_INQ_RESULT;
-      }
+    else if (btm_cb.btm_inq_vars.inq_active & BTM_BLE_LIMITED_INQUIRY &&
+             (flag & BTM_BLE_LIMIT_DISC_FLAG) != 0) {
+      BTM_TRACE_DEBUG("Find limited discoverable device");
+      rt |= BTM_BLE_INQ_RESULT;
     }
   }
   return rt;
@@ -1729,12 +1843,12 @@ static void btm_ble_appearance_to_cod(uint16_t appearance, uint8_t* dev_class) {
 /**
  * Update adv packet information into inquiry result.
  */
-void btm_ble_update_inq_result(tINQ_DB_ENT* p_i, uint8_t addr_type,
-                               const RawAddress& bda, uint16_t evt_type,
-                               uint8_t primary_phy, uint8_t secondary_phy,
-                               uint8_t advertising_sid, int8_t tx_power,
-                               int8_t rssi, uint16_t periodic_adv_int,
-                               std::vector<uint8_t> const& data) {
+void btm_ble_update_inq_result(
+    tINQ_DB_ENT* p_i, uint8_t addr_type, const RawAddress& bda,
+    uint16_t evt_type, uint8_t primary_phy, uint8_t secondary_phy,
+    uint8_t advertising_sid, int8_t tx_power, int8_t rssi,
+    uint16_t periodic_adv_int,
+    AdvertiseDataParser::FieldIndex const& ad_fields) {
   tBTM_INQ_RESULTS* p_cur = &p_i->inq_info.results;
   uint8_t len;
   tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
@@ -1765,39 +1879,33 @@ void btm_ble_update_inq_result(tINQ_DB_ENT* p_i, uint8_t addr_type,
 
   p_i->inq_count = p_inq->inq_counter; /* Mark entry for current inquiry */
 
-  if (!data.empty()) {
-    const uint8_t* p_flag =
-        AdvertiseDataParser::GetFieldByType(data, BTM_BLE_AD_TYPE_FLAG, &len);
-    if (p_flag != NULL) p_cur->flag = *p_flag;
-  }
-
-  if (!data.empty()) {
-    /* Check to see the BLE device has the Appearance UUID in the advertising
-     * data.  If it does
-     * then try to convert the appearance value to a class of device value
-     * Bluedroid can use.
-     * Otherwise fall back to trying to infer if it is a HID device based on the
-     * service class.
-     */
-    const uint8_t* p_uuid16 = AdvertiseDataParser::GetFieldByType(
-        data, BTM_BLE_AD_TYPE_APPEARANCE, &len);
-    if (p_uuid16 && len == 2) {
-      btm_ble_appearance_to_cod((uint16_t)p_uuid16[0] | (p_uuid16[1] << 8),
-                                p_cur->dev_class);
-    } else {
-      p_uuid16 = AdvertiseDataParser::GetFieldByType(
-          data, BTM_BLE_AD_TYPE_16SRV_CMPL, &len);
-      if (p_uuid16 != NULL) {
-        uint8_t i;
-        for (i = 0; i + 2 <= len; i = i + 2) {
-          /* if this BLE device support HID over LE, set HID Major in class of
-           * device */
-          if ((p_uuid16[i] | (p_uuid16[i + 1] << 8)) == UUID_SERVCLASS_LE_HID) {
-            p_cur->dev_class[0] = 0;
-            p_cur->dev_class[1] = BTM_COD_MAJOR_PERIPHERAL;
-            p_cur->dev_class[2] = 0;
-            break;
-          }
+  const uint8_t* p_flag = ad_fields.GetFieldByType(BTM_BLE_AD_TYPE_FLAG, &len);
+  if (p_flag != NULL) p_cur->flag = *p_flag;
+
+  /* Check to see the BLE device has the Appearance UUID in the advertising
+   * data.  If it does
+   * then try to convert the appearance value to a class of device value
+   * Bluedroid can use.
+   * Otherwise fall back to trying to infer if it is a HID device based on the
+   * service class.
+   */
+  const uint8_t* p_uuid16 =
+      ad_fields.GetFieldByType(BTM_BLE_AD_TYPE_APPEARANCE, &len);
+  if (p_uuid16 && len == 2) {
+    btm_ble_appearance_to_cod((uint16_t)p_uuid16[0] | (p_uuid16[1] << 8),
+                              p_cur->dev_class);
+  } else {
+    p_uuid16 = ad_fields.GetFieldByType(BTM_BLE_AD_TYPE_16SRV_CMPL, &len);
+    if (p_uuid16 != NULL) {
+      uint8_t i;
+      for (i = 0; i + 2 <= len; i = i + 2) {
+        /* if this BLE device support HID over LE, set HID Major in class of
+         * device */
+        if ((p_uuid16[i] | (p_uuid16[i + 1] << 8)) == UUID_SERVCLASS_LE_HID) {
+          p_cur->dev_class[0] = 0;
+          p_cur->dev_class[1] = BTM_COD_MAJOR_PERIPHERAL;
+          p_cur->dev_class[2] = 0;
+          break;
         }
       }
     }
@@ -1831,13 +1939,13 @@ void btm_clear_all_pending_le_entry(void) {
   uint16_t xx;
   tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
 
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
+  for (xx = 0; xx < btm_cb.btm_inq_vars.inq_db_size; xx++, p_ent++) {
     /* mark all pending LE entry as unused if an LE only device has scan
      * response outstanding */
     if ((p_ent->in_use) &&
         (p_ent->inq_info.results.device_type == BT_DEVICE_TYPE_BLE) &&
         !p_ent->scan_rsp)
-      p_ent->in_use = false;
+      btm_inq_db_delete(p_ent);
   }
 }
 
@@ -1867,6 +1975,29 @@ void btm_ble_process_adv_addr(RawAddress& bda, uint8_t* addr_type) {
 #endif
 }
 
+/**
+ * Check if an advertising report repeats the previous one from the same
+ * advertiser, and can be dropped before address resolution.
+ */
+static bool btm_ble_adv_report_is_duplicate(uint16_t evt_type,
+                                            uint8_t addr_type,
+                                            const RawAddress& bda, uint8_t sid,
+                                            int8_t rssi, uint8_t data_len,
+                                            uint8_t* data) {
+  if (BTM_BLE_ADV_DEDUP_TIMEOUT_MS == 0) return false;
+
+  /* a report that is waiting for a scan response or chained data is not
+   * complete on its own */
+  bool is_active_scan =
+      btm_cb.ble_ctr_cb.inq_var.scan_type == BTM_BLE_SCAN_MODE_ACTI;
+  bool standalone = ble_evt_type_data_status(evt_type) != 0x01 &&
+                    !ble_evt_type_is_scan_resp(evt_type) &&
+                    !(is_active_scan && ble_evt_type_is_scannable(evt_type));
+
+  return dedup_cache.IsDuplicate(addr_type, bda, sid, evt_type, standalone,
+                                 rssi, data, data_len);
+}
+
 /**
  * This function is called when extended advertising report event is received .
  * It updates the inquiry database. If the inquiry database is full, the oldest
@@ -1887,7 +2018,8 @@ void btm_ble_process_ext_adv_pkt(uint8_t data_len, uint8_t* data) {
   STREAM_TO_UINT8(num_reports, p);
 
   while (num_reports--) {
-    if (p > data + data_len) {
+    /* The fixed part of a report, up to the data length, must be there */
+    if (p + 24 > data + data_len) {
       // TODO(jpawlowski): we should crash the stack here
       BTM_TRACE_ERROR(
           "Malformed LE Extended Advertising Report Event from controller - "
@@ -1924,6 +2056,12 @@ void btm_ble_process_ext_adv_pkt(uint8_t data_len, uint8_t* data) {
     BTM_TRACE_EVENT("%s Address type %d", __func__, addr_type);
     VLOG(1) << __func__ << ": bda=" << bda;
 
+    if (btm_ble_adv_report_is_duplicate(event_type, addr_type, bda,
+                                        advertising_sid, rssi, pkt_data_len,
+                                        pkt_data)) {
+      continue;
+    }
+
     if (addr_type != BLE_ADDR_ANONYMOUS) {
       btm_ble_process_adv_addr(bda, &addr_type);
     }
@@ -1952,7 +2090,8 @@ void btm_ble_process_adv_pkt(uint8_t data_len, uint8_t* data) {
   STREAM_TO_UINT8(num_reports, p);
 
   while (num_reports--) {
-    if (p > data + data_len) {
+    /* The fixed part of a report, up to the data length, must be there */
+    if (p + 9 > data + data_len) {
       // TODO(jpawlowski): we should crash the stack here
       BTM_TRACE_ERROR("Malformed LE Advertising Report Event from controller");
       return;
@@ -1978,8 +2117,6 @@ void btm_ble_process_adv_pkt(uint8_t data_len, uint8_t* data) {
                       pkt_data_len, rssi);
     }
 
-    btm_ble_process_adv_addr(bda, &addr_type);
-
     uint16_t event_type;
     if (legacy_evt_type == 0x00) {  // ADV_IND;
       event_type = 0x0013;
@@ -2001,6 +2138,14 @@ void btm_ble_process_adv_pkt(uint8_t data_len, uint8_t* data) {
       return;
     }
 
+    if (btm_ble_adv_report_is_duplicate(event_type, addr_type, bda,
+                                        NO_ADI_PRESENT, rssi, pkt_data_len,
+                                        pkt_data)) {
+      continue;
+    }
+
+    btm_ble_process_adv_addr(bda, &addr_type);
+
     btm_ble_process_adv_pkt_cont(
         event_type, addr_type, bda, PHY_LE_1M, PHY_LE_NO_PACKET, NO_ADI_PRESENT,
         TX_POWER_NOT_PRESENT, rssi, 0x00 /* no periodic adv */, pkt_data_len,
@@ -2091,14 +2236,17 @@ static void btm_ble_process_adv_pkt_cont(
     p_inq->inq_cmpl_info.num_resp++;
   }
 
-  p_i->time_of_resp = time_get_os_boottime_ms();
+  btm_inq_db_update_time(p_i);
+
+  /* parse the advertising data once for all the lookups below */
+  AdvertiseDataParser::FieldIndex ad_fields(adv_data);
 
   /* update the LE device information in inquiry database */
   btm_ble_update_inq_result(p_i, addr_type, bda, evt_type, primary_phy,
                             secondary_phy, advertising_sid, tx_power, rssi,
-                            periodic_adv_int, adv_data);
+                            periodic_adv_int, ad_fields);
 
-  uint8_t result = btm_ble_is_discoverable(bda, adv_data);
+  uint8_t result = btm_ble_is_discoverable(bda, ad_fields);
   if (result == 0) {
     cache.Clear(addr_type, bda);
     LOG_WARN(LOG_TAG,
@@ -2107,6 +2255,11 @@ static void btm_ble_process_adv_pkt_cont(
     return;
   }
 
+  /* the controller would have filtered the report out before the scanners */
+  if ((result & BTM_BLE_OBS_RESULT) &&
+      !btm_ble_host_filter_match(bda, rssi, adv_data))
+    result &= ~BTM_BLE_OBS_RESULT;
+
   if (!update) result &= ~BTM_BLE_INQ_RESULT;
   /* If the number of responses found and limited, issue a cancel inquiry */
   if (p_inq->inqparms.max_resps &&
@@ -2159,6 +2312,7 @@ void btm_ble_process_phy_update_pkt(uint8_t len, uint8_t* data) {
   STREAM_TO_UINT8(tx_phy, p);
   STREAM_TO_UINT8(rx_phy, p);
 
+  l2cble_process_phy_update(handle, status, tx_phy);
   gatt_notify_phy_updated(status, handle, tx_phy, rx_phy);
 }
 
@@ -2173,6 +2327,10 @@ void btm_ble_process_phy_update_pkt(uint8_t len, uint8_t* data) {
  ******************************************************************************/
 tBTM_STATUS btm_ble_start_scan(void) {
   tBTM_BLE_INQ_CB* p_inq = &btm_cb.ble_ctr_cb.inq_var;
+
+  /* report every advertiser seen by this scan at least once */
+  dedup_cache.Clear();
+
   /* start scan, disable duplicate filtering */
   btm_send_hci_scan_enable(BTM_BLE_SCAN_ENABLE, p_inq->scan_duplicate_filter);
 
@@ -0,0 +1,407 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains a host implementation of the advertising packet content
+ *  filters (APCF), used when the controller does not support them. The filter
+ *  conditions are the ones the vendor commands would program, and are
+ *  evaluated on the btu thread once the advertising data is complete, so that
+ *  the reports nobody is interested in are not sent up to the scanners.
+ *
+ *  A report is only ever dropped when it certainly does not match. Conditions
+ *  that cannot be evaluated on the host (service data change, transport
+ *  discovery data) always match; the scanners still check every result
+ *  against their own filters.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "bt_types.h"
+#include "btm_ble_api.h"
+#include "btm_ble_int.h"
+#include "btm_int.h"
+#include "hcidefs.h"
+
+using bluetooth::Uuid;
+
+/* TRUE to offer host filters when the controller has no APCF support */
+#ifndef BTM_BLE_HOST_FILTER_SUPPORTED
+#define BTM_BLE_HOST_FILTER_SUPPORTED TRUE
+#endif
+
+/* Number of filter indexes offered */
+#ifndef BTM_BLE_HOST_FILTER_MAX
+#define BTM_BLE_HOST_FILTER_MAX 16
+#endif
+
+/* Service solicitation AD types, not used outside of the filters */
+#define BTM_BLE_AD_TYPE_SOL_SRV_UUID_16 0x14
+#define BTM_BLE_AD_TYPE_SOL_SRV_UUID_32 0x1F
+#define BTM_BLE_AD_TYPE_SOL_SRV_UUID_128 0x15
+
+#define BTM_BLE_HOST_FILTER_BIT(x) (uint16_t)(1 << (x))
+
+typedef struct {
+  bool in_use;
+  uint16_t feat_seln;       /* BTM_BLE_PF_* conditions to check */
+  uint16_t list_logic_type; /* per condition type, AND between entries */
+  uint8_t filt_logic_type;  /* AND between condition types */
+  int8_t rssi_high_thres;
+  std::vector<ApcfCommand> conds[BTM_BLE_PF_TYPE_ALL];
+} tBTM_BLE_HOST_FILTER;
+
+static tBTM_BLE_HOST_FILTER host_filters[BTM_BLE_HOST_FILTER_MAX];
+static bool host_filter_enabled;
+
+/* Calls |fn| with the payload of every AD structure of |type| */
+template <typename F>
+static void for_each_field(const std::vector<uint8_t>& ad, uint8_t type,
+                           F fn) {
+  size_t position = 0;
+
+  while (position < ad.size()) {
+    uint8_t len = ad[position];
+    if (len == 0 || position + 1 + len > ad.size()) break;
+
+    if (ad[position + 1] == type)
+      fn(ad.data() + position + 2, (uint8_t)(len - 1));
+    position += len + 1;
+  }
+}
+
+/* |data| starts with |pattern| once both are masked */
+static bool match_masked(const uint8_t* data, size_t data_len,
+                         const std::vector<uint8_t>& pattern,
+                         const std::vector<uint8_t>& mask) {
+  if (data_len < pattern.size()) return false;
+
+  for (size_t i = 0; i < pattern.size(); i++) {
+    uint8_t m = (i < mask.size()) ? mask[i] : 0xFF;
+    if ((data[i] & m) != (pattern[i] & m)) return false;
+  }
+  return true;
+}
+
+static bool match_uuid(const Uuid& uuid, const ApcfCommand& cond) {
+  if (cond.uuid_mask.IsEmpty()) return uuid == cond.uuid;
+
+  const Uuid::UUID128Bit& a = uuid.To128BitBE();
+  const Uuid::UUID128Bit& b = cond.uuid.To128BitBE();
+  const Uuid::UUID128Bit& m = cond.uuid_mask.To128BitBE();
+  for (size_t i = 0; i < Uuid::kNumBytes128; i++) {
+    if ((a[i] & m[i]) != (b[i] & m[i])) return false;
+  }
+  return true;
+}
+
+static bool match_uuid_list(const std::vector<uint8_t>& ad, uint8_t type,
+                            size_t uuid_len, const ApcfCommand& cond) {
+  bool found = false;
+
+  for_each_field(ad, type, [&](const uint8_t* p, uint8_t len) {
+    for (; !found && len >= uuid_len; len -= uuid_len, p += uuid_len) {
+      Uuid uuid;
+      if (uuid_len == Uuid::kNumBytes16)
+        uuid = Uuid::From16Bit(p[0] | (p[1] << 8));
+      else if (uuid_len == Uuid::kNumBytes32)
+        uuid = Uuid::From32Bit(p[0] | (p[1] << 8) | (p[2] << 16) |
+                               ((uint32_t)p[3] << 24));
+      else
+        uuid = Uuid::From128BitLE(p);
+      found = match_uuid(uuid, cond);
+    }
+  });
+  return found;
+}
+
+static bool match_name(const std::vector<uint8_t>& ad,
+                       const std::vector<uint8_t>& name) {
+  bool found = false;
+  auto match = [&](const uint8_t* p, uint8_t len) {
+    /* a shortened name only needs to be a prefix of the filter */
+    size_t n = std::min((size_t)len, name.size());
+    if (n > 0 && memcmp(p, name.data(), n) == 0) found = true;
+  };
+
+  for_each_field(ad, HCI_EIR_COMPLETE_LOCAL_NAME_TYPE, match);
+  for_each_field(ad, HCI_EIR_SHORTENED_LOCAL_NAME_TYPE, match);
+  return found;
+}
+
+static bool match_manu_data(const std::vector<uint8_t>& ad,
+                            const ApcfCommand& cond) {
+  uint16_t company_mask = cond.company_mask ? cond.company_mask : 0xFFFF;
+  bool found = false;
+
+  for_each_field(
+      ad, HCI_EIR_MANUFACTURER_SPECIFIC_TYPE,
+      [&](const uint8_t* p, uint8_t len) {
+        if (found || len < 2) return;
+
+        uint16_t company = p[0] | (p[1] << 8);
+        if ((company & company_mask) != (cond.company & company_mask)) return;
+
+        /* the data is only programmed along with its mask */
+        found = cond.data_mask.empty() ||
+                match_masked(p + 2, len - 2, cond.data, cond.data_mask);
+      });
+  return found;
+}
+
+static bool match_srvc_data(const std::vector<uint8_t>& ad,
+                            const ApcfCommand& cond) {
+  bool found = false;
+  auto match = [&](const uint8_t* p, uint8_t len) {
+    if (!found) found = match_masked(p, len, cond.data, cond.data_mask);
+  };
+
+  for_each_field(ad, HCI_EIR_SERVICE_DATA_16BITS_UUID_TYPE, match);
+  for_each_field(ad, HCI_EIR_SERVICE_DATA_32BITS_UUID_TYPE, match);
+  for_each_field(ad, HCI_EIR_SERVICE_DATA_128BITS_UUID_TYPE, match);
+  return found;
+}
+
+static bool match_cond(const RawAddress& bda, const std::vector<uint8_t>& ad,
+                       const ApcfCommand& cond) {
+  switch (cond.type) {
+    case BTM_BLE_PF_ADDR_FILTER:
+      return cond.address == bda;
+
+    case BTM_BLE_PF_SRVC_UUID:
+      return match_uuid_list(ad, HCI_EIR_COMPLETE_16BITS_UUID_TYPE,
+                             Uuid::kNumBytes16, cond) ||
+             match_uuid_list(ad, HCI_EIR_MORE_16BITS_UUID_TYPE,
+                             Uuid::kNumBytes16, cond) ||
+             match_uuid_list(ad, HCI_EIR_COMPLETE_32BITS_UUID_TYPE,
+                             Uuid::kNumBytes32, cond) ||
+             match_uuid_list(ad, HCI_EIR_MORE_32BITS_UUID_TYPE,
+                             Uuid::kNumBytes32, cond) ||
+             match_uuid_list(ad, HCI_EIR_COMPLETE_128BITS_UUID_TYPE,
+                             Uuid::kNumBytes128, cond) ||
+             match_uuid_list(ad, HCI_EIR_MORE_128BITS_UUID_TYPE,
+                             Uuid::kNumBytes128, cond);
+
+    case BTM_BLE_PF_SRVC_SOL_UUID:
+      return match_uuid_list(ad, BTM_BLE_AD_TYPE_SOL_SRV_UUID_16,
+                             Uuid::kNumBytes16, cond) ||
+             match_uuid_list(ad, BTM_BLE_AD_TYPE_SOL_SRV_UUID_32,
+                             Uuid::kNumBytes32, cond) ||
+             match_uuid_list(ad, BTM_BLE_AD_TYPE_SOL_SRV_UUID_128,
+                             Uuid::kNumBytes128, cond);
+
+    case BTM_BLE_PF_LOCAL_NAME:
+      return match_name(ad, cond.name);
+
+    case BTM_BLE_PF_MANU_DATA:
+      return match_manu_data(ad, cond);
+
+    case BTM_BLE_PF_SRVC_DATA_PATTERN:
+      return match_srvc_data(ad, cond);
+
+    default:
+      /* service data change and transport discovery data */
+      return true;
+  }
+}
+
+static bool match_filter(const tBTM_BLE_HOST_FILTER& filter,
+                         const RawAddress& bda, int8_t rssi,
+                         const std::vector<uint8_t>& ad) {
+  bool and_logic = (filter.filt_logic_type == BTM_BLE_PF_LOGIC_AND);
+  bool selected = false;
+
+  if (rssi < filter.rssi_high_thres) return false;
+
+  for (uint8_t type = 0; type < BTM_BLE_PF_TYPE_ALL; type++) {
+    const std::vector<ApcfCommand>& conds = filter.conds[type];
+    if (!(filter.feat_seln & BTM_BLE_HOST_FILTER_BIT(type)) || conds.empty())
+      continue;
+
+    bool list_and = filter.list_logic_type & BTM_BLE_HOST_FILTER_BIT(type);
+    bool matched = list_and;
+    for (const ApcfCommand& cond : conds) {
+      if (match_cond(bda, ad, cond) != list_and) {
+        matched = !list_and;
+        break;
+      }
+    }
+
+    if (and_logic && !matched) return false;
+    if (!and_logic && matched) return true;
+    selected = true;
+  }
+
+  /* no condition selected lets everything through */
+  return and_logic || !selected;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_host_filter_max
+ *
+ * Description      Returns the number of filter indexes the host filters
+ *                  offer, 0 if they are disabled.
+ *
+ ******************************************************************************/
+uint8_t btm_ble_host_filter_max(void) {
+#if (BTM_BLE_HOST_FILTER_SUPPORTED == TRUE)
+  return BTM_BLE_HOST_FILTER_MAX;
+#else
+  return 0;
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_host_filter_param_setup
+ *
+ * Description      Adds, deletes or clears the feature selection of a filter
+ *                  index, like HCI_BLE_ADV_FILTER_OCF BTM_BLE_META_PF_FEAT_SEL.
+ *
+ * Returns          true on success
+ *
+ ******************************************************************************/
+bool btm_ble_host_filter_param_setup(
+    int action, tBTM_BLE_PF_FILT_INDEX filt_index,
+    const btgatt_filt_param_setup_t* p_filt_params) {
+  if (action == BTM_BLE_SCAN_COND_CLEAR) {
+    for (tBTM_BLE_HOST_FILTER& filter : host_filters) filter.in_use = false;
+    return true;
+  }
+
+  if (filt_index >= BTM_BLE_HOST_FILTER_MAX) return false;
+
+  tBTM_BLE_HOST_FILTER& filter = host_filters[filt_index];
+  if (action == BTM_BLE_SCAN_COND_DELETE) {
+    filter.in_use = false;
+    return true;
+  }
+
+  if (p_filt_params == NULL) return false;
+
+  filter.in_use = true;
+  filter.feat_seln = p_filt_params->feat_seln;
+  filter.list_logic_type = p_filt_params->list_logic_type;
+  filter.filt_logic_type = p_filt_params->filt_logic_type;
+  filter.rssi_high_thres = (int8_t)p_filt_params->rssi_high_thres;
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_host_filter_set
+ *
+ * Description      Adds the conditions |commands| to a filter index.
+ *
+ * Returns          true on success
+ *
+ ******************************************************************************/
+bool btm_ble_host_filter_set(tBTM_BLE_PF_FILT_INDEX filt_index,
+                             const std::vector<ApcfCommand>& commands) {
+  if (filt_index >= BTM_BLE_HOST_FILTER_MAX) return false;
+
+  tBTM_BLE_HOST_FILTER& filter = host_filters[filt_index];
+  for (const ApcfCommand& cmd : commands) {
+    if (cmd.type >= BTM_BLE_PF_TYPE_ALL) {
+      BTM_TRACE_ERROR("%s: unknown filter type %d", __func__, cmd.type);
+      continue;
+    }
+    filter.conds[cmd.type].push_back(cmd);
+  }
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_host_filter_clear
+ *
+ * Description      Clears the conditions and the feature selection of a
+ *                  filter index.
+ *
+ * Returns          true on success
+ *
+ ******************************************************************************/
+bool btm_ble_host_filter_clear(tBTM_BLE_PF_FILT_INDEX filt_index) {
+  if (filt_index >= BTM_BLE_HOST_FILTER_MAX) return false;
+
+  tBTM_BLE_HOST_FILTER& filter = host_filters[filt_index];
+  for (std::vector<ApcfCommand>& conds : filter.conds) conds.clear();
+  filter.feat_seln = 0;
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_host_filter_enable
+ *
+ * Description      Enables or disables the host filters.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_ble_host_filter_enable(bool enable) {
+  host_filter_enabled = enable && btm_ble_host_filter_max() > 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_host_filter_match
+ *
+ * Description      Checks a complete advertising report against the host
+ *                  filters.
+ *
+ * Returns          false if the report matches no filter, true otherwise
+ *
+ ******************************************************************************/
+bool btm_ble_host_filter_match(const RawAddress& bda, int8_t rssi,
+                               const std::vector<uint8_t>& adv_data) {
+  bool any_in_use = false;
+
+  if (!host_filter_enabled) return true;
+
+  for (const tBTM_BLE_HOST_FILTER& filter : host_filters) {
+    if (!filter.in_use) continue;
+    if (match_filter(filter, bda, rssi, adv_data)) return true;
+    any_in_use = true;
+  }
+
+  /* the controller would drop everything, but nobody asked for that */
+  return !any_in_use;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_host_filter_cleanup
+ *
+ * Description      Disables the host filters and clears every filter index.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_ble_host_filter_cleanup(void) {
+  host_filter_enabled = false;
+  for (tBTM_BLE_HOST_FILTER& filter : host_filters) {
+    for (std::vector<ApcfCommand>& conds : filter.conds) conds.clear();
+    filter.in_use = false;
+    filter.feat_seln = 0;
+  }
+}
@@ -139,6 +139,7 @@ extern void btm_gen_non_resolvable_private_addr(tBTM_BLE_ADDR_CBACK* p_cback,
                                                 void* p);
 extern tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(
     const RawAddress& random_bda);
+extern void btm_ble_rpa_cache_invalidate(void);
 extern void btm_gen_resolve_paddr_low(const RawAddress& address);
 extern uint64_t btm_get_next_private_addrress_interval_ms();
 
@@ -178,6 +179,17 @@ extern void btm_ble_batchscan_init(void);
 extern void btm_ble_batchscan_cleanup(void);
 extern void btm_ble_adv_filter_init(void);
 extern void btm_ble_adv_filter_cleanup(void);
+extern uint8_t btm_ble_host_filter_max(void);
+extern bool btm_ble_host_filter_param_setup(
+    int action, tBTM_BLE_PF_FILT_INDEX filt_index,
+    const btgatt_filt_param_setup_t* p_filt_params);
+extern bool btm_ble_host_filter_set(tBTM_BLE_PF_FILT_INDEX filt_index,
+                                    const std::vector<ApcfCommand>& commands);
+extern bool btm_ble_host_filter_clear(tBTM_BLE_PF_FILT_INDEX filt_index);
+extern void btm_ble_host_filter_enable(bool enable);
+extern bool btm_ble_host_filter_match(const RawAddress& bda, int8_t rssi,
+                                      const std::vector<uint8_t>& adv_data);
+extern void btm_ble_host_filter_cleanup(void);
 extern bool btm_ble_topology_check(tBTM_BLE_STATE_MASK request);
 extern bool btm_ble_clear_topology_mask(tBTM_BLE_STATE_MASK request_state);
 extern bool btm_ble_set_topology_mask(tBTM_BLE_STATE_MASK request_state);
@@ -54,6 +54,15 @@
 #define BTM_BLE_LOW_LATENCY_SCAN_INT 8000
 /* scan_window = 5s= 8000 * 0.625 ms */
 #define BTM_BLE_LOW_LATENCY_SCAN_WIN 8000
+/* Discovery scan sharing the radio with a BR/EDR inquiry */
+/* Interval(scan_int) = 100 ms = 160 * 0.625 ms */
+#ifndef BTM_BLE_DUAL_MODE_SCAN_INT
+#define BTM_BLE_DUAL_MODE_SCAN_INT 160
+#endif
+/* scan_window = 60 ms = 96 * 0.625 ms */
+#ifndef BTM_BLE_DUAL_MODE_SCAN_WIN
+#define BTM_BLE_DUAL_MODE_SCAN_WIN 96
+#endif
 
 /* TGAP(adv_fast_interval1) = 30(used) ~ 60 ms  = 48 *0.625 */
 #define BTM_BLE_GAP_ADV_FAST_INT_1 48
@@ -310,6 +319,8 @@ typedef struct {
   tBTM_BLE_RL_STATE suspended_rl_state;     /* Suspended resolving list state */
   uint8_t* irk_list_mask; /* IRK list availability mask, up to max entry bits */
   tBTM_BLE_RL_STATE rl_state; /* Resolving list state */
+  alarm_t* rl_update_timer;   /* ends a batch of resolving list changes */
+  tBTM_BLE_RL_STATE rl_resume_state; /* state restored after the batch */
 #endif
 
   /* current BLE link state */
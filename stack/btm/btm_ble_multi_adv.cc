@@ -29,6 +29,7 @@
 #include "stack/btm/btm_ble_int.h"
 
 #include <string.h>
+#include <deque>
 #include <queue>
 #include <vector>
 
@@ -61,6 +62,18 @@ bool is_connectable(uint16_t advertising_event_properties) {
   return advertising_event_properties & 0x01;
 }
 
+/* Advertising or scan response data of a set, as last written to the
+ * controller. Updates arriving while a write is in flight are merged, and only
+ * the latest one is written once the controller is done with the previous. */
+struct AdvertisingDataCache {
+  bool valid = false;  // |data| is what the controller holds
+  std::vector<uint8_t> data;
+  bool in_flight = false;
+  bool pending = false;
+  std::vector<uint8_t> pending_data;
+  std::vector<MultiAdvCb> pending_cbs;
+};
+
 struct AdvertisingInstance {
   uint8_t inst_id;
   bool in_use;
@@ -89,6 +102,11 @@ struct AdvertisingInstance {
   bool enable_status;
   TimeTicks enable_time;
 
+  AdvertisingDataCache adv_data;
+  AdvertisingDataCache scan_rsp_data;
+  // Bumped on unregistration, so writes still in flight are not cached
+  uint8_t data_generation;
+
   bool IsEnabled() { return enable_status; }
 
   bool IsConnectable() { return is_connectable(advertising_event_properties); }
@@ -104,7 +122,8 @@ struct AdvertisingInstance {
         own_address(RawAddress::kEmpty),
         address_update_required(false),
         periodic_enabled(false),
-        enable_status(false) {
+        enable_status(false),
+        data_generation(0) {
     adv_raddr_timer = alarm_new_periodic("btm_ble.adv_raddr_timer");
   }
 
@@ -119,6 +138,18 @@ struct AdvertisingInstance {
   }
 };
 
+/* Sets waiting for the "LE Set Extended Advertising Set Enable" command in
+ * flight to complete, sent together in one command once it does. */
+struct PendingEnable {
+  SetEnableData set;
+  MultiAdvCb cb;
+};
+
+struct EnableBatch {
+  bool enable;
+  std::vector<PendingEnable> sets;
+};
+
 void btm_ble_adv_raddr_timer_timeout(void* data);
 
 struct closure_data {
@@ -692,8 +723,72 @@ class BleAdvertisingManagerImpl
 
     if (enable) p_inst->enable_time = TimeTicks::Now();
     p_inst->enable_status = enable;
-    GetHciInterface()->Enable(enable, p_inst->inst_id, p_inst->duration,
-                              p_inst->maxExtAdvEvents, std::move(myCb));
+    SendEnable(enable,
+               SetEnableData{
+                   .handle = p_inst->inst_id,
+                   .duration = p_inst->duration,
+                   .max_extended_advertising_events = p_inst->maxExtAdvEvents},
+               std::move(myCb));
+  }
+
+  /* Enables or disables one set. While an enable command is in flight, sets
+   * are queued and sent together in one command once it completes. */
+  void SendEnable(bool enable, SetEnableData set, MultiAdvCb cb) {
+    if (!GetHciInterface()->CanEnableMultipleSets()) {
+      GetHciInterface()->Enable(enable, set.handle, set.duration,
+                                set.max_extended_advertising_events,
+                                std::move(cb));
+      return;
+    }
+
+    if (enable_in_flight) {
+      bool new_batch =
+          pending_enables.empty() || pending_enables.back().enable != enable;
+      if (!new_batch) {
+        // A set can be in one command only once
+        for (const PendingEnable& pending : pending_enables.back().sets) {
+          if (pending.set.handle == set.handle) new_batch = true;
+        }
+      }
+      if (new_batch) pending_enables.emplace_back(EnableBatch{enable, {}});
+      pending_enables.back().sets.emplace_back(
+          PendingEnable{set, std::move(cb)});
+      return;
+    }
+
+    EnableBatch batch{enable, {}};
+    batch.sets.emplace_back(PendingEnable{set, std::move(cb)});
+    SendEnableBatch(std::move(batch));
+  }
+
+  void SendEnableBatch(EnableBatch batch) {
+    std::vector<SetEnableData> sets;
+    std::vector<MultiAdvCb> cbs;
+    for (PendingEnable& pending : batch.sets) {
+      sets.push_back(pending.set);
+      cbs.push_back(std::move(pending.cb));
+    }
+
+    VLOG(1) << __func__ << " enable: " << batch.enable
+            << ", sets: " << sets.size();
+    enable_in_flight = true;
+    GetHciInterface()->Enable(
+        batch.enable, sets,
+        Bind(&BleAdvertisingManagerImpl::EnableBatchCb,
+             weak_factory_.GetWeakPtr(), std::move(cbs)));
+  }
+
+  void EnableBatchCb(std::vector<MultiAdvCb> cbs, uint8_t status) {
+    enable_in_flight = false;
+
+    // Send the next batch first, the callbacks might enable more sets
+    if (!pending_enables.empty()) {
+      EnableBatch batch = std::move(pending_enables.front());
+      pending_enables.pop_front();
+      SendEnableBatch(std::move(batch));
+    }
+
+    for (MultiAdvCb& cb : cbs) cb.Run(status);
   }
 
   void SetParameters(uint8_t inst_id, tBTM_BLE_ADV_PARAMS* p_params,
@@ -795,12 +890,70 @@ class BleAdvertisingManagerImpl
     }
 
     VLOG(1) << "data is: " << base::HexEncode(data.data(), data.size());
+
+    AdvertisingDataCache* p_cache =
+        is_scan_rsp ? &p_inst->scan_rsp_data : &p_inst->adv_data;
+    if (p_cache->in_flight) {
+      // Written once the controller is done with the previous update
+      p_cache->pending = true;
+      p_cache->pending_data = std::move(data);
+      p_cache->pending_cbs.push_back(std::move(cb));
+      return;
+    }
+
+    WriteData(p_inst, is_scan_rsp, std::move(data), std::move(cb));
+  }
+
+  void WriteData(AdvertisingInstance* p_inst, bool is_scan_rsp,
+                 std::vector<uint8_t> data, MultiAdvCb cb) {
+    AdvertisingDataCache* p_cache =
+        is_scan_rsp ? &p_inst->scan_rsp_data : &p_inst->adv_data;
+    if (p_cache->valid && p_cache->data == data) {
+      VLOG(1) << __func__ << " data unchanged, skipping the write";
+      cb.Run(BTM_BLE_MULTI_ADV_SUCCESS);
+      return;
+    }
+
+    p_cache->valid = false;
+    p_cache->in_flight = true;
+    p_cache->data = data;
     DivideAndSendData(
-        inst_id, data, false, cb,
+        p_inst->inst_id, std::move(data), false,
+        base::Bind(&BleAdvertisingManagerImpl::WriteDataCb,
+                   weak_factory_.GetWeakPtr(), p_inst->inst_id, is_scan_rsp,
+                   p_inst->data_generation, std::move(cb)),
         base::Bind(&BleAdvertisingManagerImpl::SetDataAdvDataSender,
                    weak_factory_.GetWeakPtr(), is_scan_rsp));
   }
 
+  void WriteDataCb(uint8_t inst_id, bool is_scan_rsp, uint8_t generation,
+                   MultiAdvCb cb, uint8_t status) {
+    AdvertisingInstance* p_inst = &adv_inst[inst_id];
+    AdvertisingDataCache* p_cache =
+        is_scan_rsp ? &p_inst->scan_rsp_data : &p_inst->adv_data;
+
+    p_cache->in_flight = false;
+    if (generation == p_inst->data_generation)
+      p_cache->valid = (status == BTM_BLE_MULTI_ADV_SUCCESS);
+
+    // Write the merged updates first, the callback might update the data again
+    if (p_cache->pending) {
+      std::vector<uint8_t> data = std::move(p_cache->pending_data);
+      std::vector<MultiAdvCb> cbs = std::move(p_cache->pending_cbs);
+      p_cache->pending = false;
+      p_cache->pending_data.clear();
+      p_cache->pending_cbs.clear();
+      WriteData(p_inst, is_scan_rsp, std::move(data),
+                Bind(&BleAdvertisingManagerImpl::RunDataCbs, std::move(cbs)));
+    }
+
+    cb.Run(status);
+  }
+
+  static void RunDataCbs(std::vector<MultiAdvCb> cbs, uint8_t status) {
+    for (MultiAdvCb& cb : cbs) cb.Run(status);
+  }
+
   void SetDataAdvDataSender(uint8_t is_scan_rsp, uint8_t inst_id,
                             uint8_t operation, uint8_t length, uint8_t* data,
                             MultiAdvCb cb) {
@@ -920,11 +1073,37 @@ class BleAdvertisingManagerImpl
       return;
     }
 
+    // Queued enables of this set would follow the removal
+    for (EnableBatch& batch : pending_enables) {
+      for (auto it = batch.sets.begin(); it != batch.sets.end();) {
+        if (it->set.handle == inst_id)
+          it = batch.sets.erase(it);
+        else
+          it++;
+      }
+    }
+    for (auto it = pending_enables.begin(); it != pending_enables.end();) {
+      if (it->sets.empty())
+        it = pending_enables.erase(it);
+      else
+        it++;
+    }
+
     if (adv_inst[inst_id].IsEnabled()) {
       p_inst->enable_status = false;
       GetHciInterface()->Enable(false, inst_id, 0x00, 0x00, base::DoNothing());
     }
 
+    // The set starts over with no data, drop the updates not written yet
+    for (AdvertisingDataCache* p_cache :
+         {&p_inst->adv_data, &p_inst->scan_rsp_data}) {
+      p_cache->valid = false;
+      p_cache->pending = false;
+      p_cache->pending_data.clear();
+      p_cache->pending_cbs.clear();
+    }
+    p_inst->data_generation++;
+
     if (p_inst->periodic_enabled) {
       p_inst->periodic_enabled = false;
       GetHciInterface()->SetPeriodicAdvertisingEnable(false, inst_id,
@@ -1034,8 +1213,12 @@ class BleAdvertisingManagerImpl
 
         RecomputeTimeout(p_inst, TimeTicks::Now());
         if (p_inst->enable_status) {
-          GetHciInterface()->Enable(true, advertising_handle, p_inst->duration,
-                                    p_inst->maxExtAdvEvents, base::DoNothing());
+          SendEnable(true,
+                     SetEnableData{.handle = advertising_handle,
+                                   .duration = p_inst->duration,
+                                   .max_extended_advertising_events =
+                                       p_inst->maxExtAdvEvents},
+                     base::DoNothing());
         }
       } else {
         /* mark directed adv as disabled if adv has been stopped */
@@ -1067,6 +1250,8 @@ class BleAdvertisingManagerImpl
   std::vector<AdvertisingInstance> adv_inst;
   uint8_t inst_count;
   bool rpa_gen_offload_enabled;
+  bool enable_in_flight = false;
+  std::deque<EnableBatch> pending_enables;
 
   // Member variables should appear before the WeakPtrFactory, to ensure
   // that any WeakPtrs are invalidated before its members
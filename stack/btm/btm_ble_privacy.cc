@@ -288,6 +288,8 @@ void btm_ble_add_resolving_list_entry_complete(uint8_t* p, uint16_t evt_len) {
   {
     btm_cb.ble_ctr_cb.resolving_list_avail_size = 0;
     BTM_TRACE_DEBUG("%s Resolving list Full ", __func__);
+    /* the host keeps resolving the addresses of the device */
+    btm_ble_update_resolving_list(pseudo_bda, false);
   }
 }
 
@@ -662,6 +664,178 @@ bool btm_ble_disable_resolving_list(uint8_t rl_mask, bool to_resume) {
   return true;
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_ble_resolving_list_has_room
+ *
+ * Description      check whether one more device fits in the resolving list
+ *                  once the pending operations have completed
+ *
+ * Returns          true if there is room for a device
+ *
+ ******************************************************************************/
+static bool btm_ble_resolving_list_has_room(void) {
+  tBTM_BLE_RESOLVE_Q* p_q = &btm_cb.ble_ctr_cb.resolving_list_pend_q;
+  int avail_size = btm_cb.ble_ctr_cb.resolving_list_avail_size;
+
+  for (uint8_t i = p_q->q_pending; i != p_q->q_next;) {
+    if (p_q->resolve_q_action[i] == BTM_BLE_META_ADD_IRK_ENTRY)
+      avail_size--;
+    else if (p_q->resolve_q_action[i] == BTM_BLE_META_REMOVE_IRK_ENTRY)
+      avail_size++;
+
+    i++;
+    i %= controller_get_interface()->get_ble_resolving_list_max_size();
+  }
+  return avail_size > 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_resolving_list_lower_priority
+ *
+ * Description      compare the claim of two devices on a resolving list
+ *                  entry: a device the host connects to in the background
+ *                  comes first, then the most recently connected one.
+ *
+ * Returns          true if |p_a| has a lower priority than |p_b|
+ *
+ ******************************************************************************/
+static bool btm_ble_resolving_list_lower_priority(const tBTM_SEC_DEV_REC* p_a,
+                                                  const tBTM_SEC_DEV_REC* p_b) {
+  bool a_bg_conn = p_a->ble.in_controller_list & BTM_WHITE_LIST_BIT;
+  bool b_bg_conn = p_b->ble.in_controller_list & BTM_WHITE_LIST_BIT;
+
+  if (a_bg_conn != b_bg_conn) return b_bg_conn;
+  return p_a->ble.rl_timestamp < p_b->ble.rl_timestamp;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_resolving_list_find_victim
+ *
+ * Description      find the device of the resolving list to evict for
+ *                  |p_dev_rec|
+ *
+ * Returns          the lowest priority device of the list if it has a lower
+ *                  priority than |p_dev_rec|, NULL otherwise
+ *
+ ******************************************************************************/
+static tBTM_SEC_DEV_REC* btm_ble_resolving_list_find_victim(
+    const tBTM_SEC_DEV_REC* p_dev_rec) {
+  tBTM_SEC_DEV_REC* p_victim = NULL;
+
+  list_node_t* end = list_end(btm_cb.sec_dev_rec);
+  for (list_node_t* node = list_begin(btm_cb.sec_dev_rec); node != end;
+       node = list_next(node)) {
+    tBTM_SEC_DEV_REC* p_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
+    if (!(p_rec->ble.in_controller_list & BTM_RESOLVING_LIST_BIT) ||
+        btm_ble_brcm_find_resolving_pending_entry(
+            p_rec->bd_addr, BTM_BLE_META_ADD_IRK_ENTRY))
+      continue;
+
+    if (p_victim == NULL ||
+        btm_ble_resolving_list_lower_priority(p_rec, p_victim))
+      p_victim = p_rec;
+  }
+
+  if (p_victim != NULL &&
+      btm_ble_resolving_list_lower_priority(p_victim, p_dev_rec))
+    return p_victim;
+  return NULL;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_resolving_list_update_timeout
+ *
+ * Description      end of a batch of resolving list changes: swap in the
+ *                  devices which gained priority, then turn the address
+ *                  resolution back on and resume the suspended activity.
+ *
+ ******************************************************************************/
+static void btm_ble_resolving_list_update_timeout(UNUSED_ATTR void* data) {
+  tBTM_BLE_CB* p_ble_cb = &btm_cb.ble_ctr_cb;
+
+  /* load the remaining devices by priority until one does not fit */
+  for (;;) {
+    tBTM_SEC_DEV_REC* p_best = NULL;
+
+    list_node_t* end = list_end(btm_cb.sec_dev_rec);
+    for (list_node_t* node = list_begin(btm_cb.sec_dev_rec); node != end;
+         node = list_next(node)) {
+      tBTM_SEC_DEV_REC* p_rec =
+          static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
+      if ((p_rec->ble.in_controller_list & BTM_RESOLVING_LIST_BIT) ||
+          (p_rec->ble.key_type & (BTM_LE_KEY_PID | BTM_LE_KEY_LID)) == 0)
+        continue;
+
+      if (p_best == NULL ||
+          btm_ble_resolving_list_lower_priority(p_best, p_rec))
+        p_best = p_rec;
+    }
+
+    if (p_best == NULL || !btm_ble_resolving_list_load_dev(p_best)) break;
+  }
+
+  /* the swaps are gathered in another batch */
+  if (alarm_is_scheduled(p_ble_cb->rl_update_timer)) return;
+
+  const tBTM_BLE_RL_STATE rl_state = p_ble_cb->rl_resume_state;
+  p_ble_cb->rl_resume_state = BTM_BLE_RL_IDLE;
+  if (rl_state) btm_ble_enable_resolving_list(rl_state);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_resolving_list_begin_update
+ *
+ * Description      make the resolving list ready for a change. The address
+ *                  resolution stays disabled, and the LE activity suspended,
+ *                  until the changes of the whole batch have been sent.
+ *
+ * Returns          true if the resolving list can be changed
+ *
+ ******************************************************************************/
+static bool btm_ble_resolving_list_begin_update(void) {
+  tBTM_BLE_CB* p_ble_cb = &btm_cb.ble_ctr_cb;
+  const uint8_t rl_state = p_ble_cb->rl_state;
+
+  if (rl_state && !btm_ble_disable_resolving_list(rl_state, false))
+    return false;
+
+  p_ble_cb->rl_resume_state |= rl_state;
+  if (!alarm_is_scheduled(p_ble_cb->rl_update_timer))
+    alarm_set_on_mloop(p_ble_cb->rl_update_timer, BTM_BLE_RL_UPDATE_DELAY_MS,
+                       btm_ble_resolving_list_update_timeout, NULL);
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_resolving_list_promote_dev
+ *
+ * Description      This function is called when a device gains priority on
+ *                  a resolving list entry, by connecting or by being added to
+ *                  the background connection. The device is swapped in at the
+ *                  end of the current batch of resolving list changes.
+ *
+ * Parameters       pointer to device security record
+ *
+ ******************************************************************************/
+void btm_ble_resolving_list_promote_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
+  tBTM_BLE_CB* p_ble_cb = &btm_cb.ble_ctr_cb;
+
+  if (controller_get_interface()->get_ble_resolving_list_max_size() == 0 ||
+      (p_dev_rec->ble.in_controller_list & BTM_RESOLVING_LIST_BIT) ||
+      (p_dev_rec->ble.key_type & (BTM_LE_KEY_PID | BTM_LE_KEY_LID)) == 0)
+    return;
+
+  if (!alarm_is_scheduled(p_ble_cb->rl_update_timer))
+    alarm_set_on_mloop(p_ble_cb->rl_update_timer, BTM_BLE_RL_UPDATE_DELAY_MS,
+                       btm_ble_resolving_list_update_timeout, NULL);
+}
+
 /*******************************************************************************
  *
  * Function         btm_ble_resolving_list_load_dev
@@ -675,7 +849,7 @@ bool btm_ble_disable_resolving_list(uint8_t rl_mask, bool to_resume) {
  *
  ******************************************************************************/
 bool btm_ble_resolving_list_load_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
-  const uint8_t rl_state = btm_cb.ble_ctr_cb.rl_state;
+  tBTM_SEC_DEV_REC* p_victim = NULL;
 
   if (controller_get_interface()->get_ble_resolving_list_max_size() == 0) {
     BTM_TRACE_DEBUG(
@@ -705,12 +879,21 @@ bool btm_ble_resolving_list_load_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
     return true;
   }
 
-  if (btm_cb.ble_ctr_cb.resolving_list_avail_size == 0) {
-    return false;
+  if (!btm_ble_resolving_list_has_room()) {
+    p_victim = btm_ble_resolving_list_find_victim(p_dev_rec);
+    if (p_victim == NULL) {
+      BTM_TRACE_DEBUG("%s: Resolving list full", __func__);
+      return false;
+    }
   }
 
-  if (rl_state && !btm_ble_disable_resolving_list(rl_state, false)) {
-    return false;
+  if (!btm_ble_resolving_list_begin_update()) return false;
+
+  if (p_victim != NULL) {
+    BTM_TRACE_DEBUG("%s: evicting %s from resolving list", __func__,
+                    p_victim->bd_addr.ToString().c_str());
+    btm_ble_update_resolving_list(p_victim->bd_addr, false);
+    btm_ble_remove_resolving_list_entry(p_victim);
   }
 
   btm_ble_update_resolving_list(p_dev_rec->bd_addr, true);
@@ -752,11 +935,9 @@ bool btm_ble_resolving_list_load_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
   btm_ble_enq_resolving_list_pending(p_dev_rec->bd_addr,
                                      BTM_BLE_META_ADD_IRK_ENTRY);
 
-  /* if resolving list has been turned on, re-enable it */
-  if (rl_state)
-    btm_ble_enable_resolving_list(rl_state);
-  else
-    btm_ble_enable_resolving_list(BTM_BLE_RL_INIT);
+  /* turn the resolving list on at the end of the batch */
+  if (btm_cb.ble_ctr_cb.rl_resume_state == BTM_BLE_RL_IDLE)
+    btm_cb.ble_ctr_cb.rl_resume_state = BTM_BLE_RL_INIT;
 
   return true;
 }
@@ -773,24 +954,20 @@ bool btm_ble_resolving_list_load_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
  *
  ******************************************************************************/
 void btm_ble_resolving_list_remove_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
-  uint8_t rl_mask = btm_cb.ble_ctr_cb.rl_state;
-
   BTM_TRACE_EVENT("%s", __func__);
-  if (rl_mask) {
-    if (!btm_ble_disable_resolving_list(rl_mask, false)) return;
-  }
 
-  if ((p_dev_rec->ble.in_controller_list & BTM_RESOLVING_LIST_BIT) &&
-      !btm_ble_brcm_find_resolving_pending_entry(
+  if (!(p_dev_rec->ble.in_controller_list & BTM_RESOLVING_LIST_BIT) ||
+      btm_ble_brcm_find_resolving_pending_entry(
           p_dev_rec->bd_addr, BTM_BLE_META_REMOVE_IRK_ENTRY)) {
-    btm_ble_update_resolving_list(p_dev_rec->bd_addr, false);
-    btm_ble_remove_resolving_list_entry(p_dev_rec);
-  } else {
     BTM_TRACE_DEBUG("Device not in resolving list");
+    return;
   }
 
-  /* if resolving list has been turned on, re-enable it */
-  if (rl_mask) btm_ble_enable_resolving_list(rl_mask);
+  /* the freed entry goes to the next device by priority */
+  if (!btm_ble_resolving_list_begin_update()) return;
+
+  btm_ble_update_resolving_list(p_dev_rec->bd_addr, false);
+  btm_ble_remove_resolving_list_entry(p_dev_rec);
 }
 
 /*******************************************************************************
@@ -894,6 +1071,9 @@ void btm_ble_resolving_list_init(uint8_t max_irk_list_sz) {
     if (btm_cb.ble_ctr_cb.irk_list_mask == NULL)
       btm_cb.ble_ctr_cb.irk_list_mask = (uint8_t*)osi_malloc(irk_mask_size);
 
+    if (btm_cb.ble_ctr_cb.rl_update_timer == NULL)
+      btm_cb.ble_ctr_cb.rl_update_timer = alarm_new("btm_ble.rl_update_timer");
+
     BTM_TRACE_DEBUG("%s max_irk_list_sz = %d", __func__, max_irk_list_sz);
   }
 
@@ -922,6 +1102,10 @@ void btm_ble_resolving_list_cleanup(void) {
   controller_get_interface()->set_ble_resolving_list_max_size(0);
 
   osi_free_and_reset((void**)&btm_cb.ble_ctr_cb.irk_list_mask);
+
+  alarm_free(btm_cb.ble_ctr_cb.rl_update_timer);
+  btm_cb.ble_ctr_cb.rl_update_timer = NULL;
+  btm_cb.ble_ctr_cb.rl_resume_state = BTM_BLE_RL_IDLE;
 }
 
 /*******************************************************************************
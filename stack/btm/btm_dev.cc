@@ -61,6 +61,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <list>
+#include <unordered_map>
 
 #include "bt_common.h"
 #include "bt_types.h"
@@ -72,6 +74,122 @@
 #include "hcimsgs.h"
 #include "l2c_api.h"
 
+/* Lookup index kept alongside btm_cb.sec_dev_rec.
+ *
+ * The address and handle maps are filled lazily from the results of the
+ * linear search and every hit is validated against the current contents of
+ * the record, so fields being updated elsewhere in the stack can only cause a
+ * miss (and a fallback to the search), never a wrong answer. The LRU list
+ * holds every live record ordered by |timestamp|, oldest first, and doubles as
+ * the set of live records used to validate map entries.
+ */
+struct DevRecAddrHash {
+  std::size_t operator()(const RawAddress& x) const {
+    const uint8_t* a = x.address;
+    return a[0] ^ (a[1] << 8) ^ (a[2] << 16) ^ (a[3] << 24) ^ a[4] ^
+           (a[5] << 8);
+  }
+};
+
+typedef std::list<tBTM_SEC_DEV_REC*> DevRecLru;
+
+static std::unordered_map<RawAddress, tBTM_SEC_DEV_REC*, DevRecAddrHash>
+    dev_rec_by_addr;
+static std::unordered_map<uint16_t, tBTM_SEC_DEV_REC*> dev_rec_by_handle;
+static DevRecLru dev_rec_lru;
+static std::unordered_map<tBTM_SEC_DEV_REC*, DevRecLru::iterator>
+    dev_rec_lru_pos;
+
+/* Stale map entries are harmless but are dropped wholesale past this size */
+#define BTM_DEV_REC_INDEX_MAX_ENTRIES (4 * BTM_SEC_MAX_DEVICE_RECORDS)
+
+static bool btm_dev_rec_is_live(tBTM_SEC_DEV_REC* p_dev_rec) {
+  return dev_rec_lru_pos.find(p_dev_rec) != dev_rec_lru_pos.end();
+}
+
+static void btm_dev_rec_index_addr(const RawAddress& bd_addr,
+                                   tBTM_SEC_DEV_REC* p_dev_rec) {
+  if (dev_rec_by_addr.size() >= BTM_DEV_REC_INDEX_MAX_ENTRIES)
+    dev_rec_by_addr.clear();
+  dev_rec_by_addr[bd_addr] = p_dev_rec;
+}
+
+static void btm_dev_rec_index_handle(uint16_t handle,
+                                     tBTM_SEC_DEV_REC* p_dev_rec) {
+  if (dev_rec_by_handle.size() >= BTM_DEV_REC_INDEX_MAX_ENTRIES)
+    dev_rec_by_handle.clear();
+  dev_rec_by_handle[handle] = p_dev_rec;
+}
+
+/* Moves |p_dev_rec| to its place in the LRU according to its timestamp */
+static void btm_dev_rec_lru_reposition(tBTM_SEC_DEV_REC* p_dev_rec) {
+  auto pos = dev_rec_lru_pos.find(p_dev_rec);
+  if (pos == dev_rec_lru_pos.end()) return;
+  dev_rec_lru.erase(pos->second);
+
+  auto it = dev_rec_lru.end();
+  while (it != dev_rec_lru.begin()) {
+    auto prev = std::prev(it);
+    if ((*prev)->timestamp <= p_dev_rec->timestamp) break;
+    it = prev;
+  }
+  pos->second = dev_rec_lru.insert(it, p_dev_rec);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sec_dev_rec_touch
+ *
+ * Description      "Bump" the timestamp of a device record, marking it as the
+ *                  most recently used one.
+ *
+ ******************************************************************************/
+void btm_sec_dev_rec_touch(tBTM_SEC_DEV_REC* p_dev_rec) {
+  p_dev_rec->timestamp = btm_cb.dev_rec_count++;
+
+  auto pos = dev_rec_lru_pos.find(p_dev_rec);
+  if (pos == dev_rec_lru_pos.end()) return;
+  dev_rec_lru.splice(dev_rec_lru.end(), dev_rec_lru, pos->second);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sec_dev_rec_free
+ *
+ * Description      Free callback of btm_cb.sec_dev_rec. Drops the record from
+ *                  the lookup index before releasing it.
+ *
+ ******************************************************************************/
+void btm_sec_dev_rec_free(void* data) {
+  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
+
+  btm_ble_rpa_cache_invalidate();
+
+  auto pos = dev_rec_lru_pos.find(p_dev_rec);
+  if (pos != dev_rec_lru_pos.end()) {
+    dev_rec_lru.erase(pos->second);
+    dev_rec_lru_pos.erase(pos);
+  }
+
+  const RawAddress* addrs[] = {&p_dev_rec->bd_addr,
+                               &p_dev_rec->ble.pseudo_addr};
+  for (const RawAddress* addr : addrs) {
+    auto it = dev_rec_by_addr.find(*addr);
+    if (it != dev_rec_by_addr.end() && it->second == p_dev_rec)
+      dev_rec_by_addr.erase(it);
+  }
+
+  const uint16_t handles[] = {p_dev_rec->hci_handle,
+                              p_dev_rec->ble_hci_handle};
+  for (uint16_t handle : handles) {
+    auto it = dev_rec_by_handle.find(handle);
+    if (it != dev_rec_by_handle.end() && it->second == p_dev_rec)
+      dev_rec_by_handle.erase(it);
+  }
+
+  osi_free(p_dev_rec);
+}
+
 /*******************************************************************************
  *
  * Function         BTM_SecAddDevice
@@ -116,7 +234,7 @@ bool BTM_SecAddDevice(const RawAddress& bd_addr, DEV_CLASS dev_class,
   } else {
 
     /* "Bump" timestamp for existing record */
-    p_dev_rec->timestamp = btm_cb.dev_rec_count++;
+    btm_sec_dev_rec_touch(p_dev_rec);
 
     /* TODO(eisenbach):
      * Small refactor, but leaving original logic for now.
@@ -415,8 +533,21 @@ bool is_handle_equal(void* data, void* context) {
  *
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle) {
+  auto it = dev_rec_by_handle.find(handle);
+  if (it != dev_rec_by_handle.end()) {
+    tBTM_SEC_DEV_REC* p_dev_rec = it->second;
+    if (btm_dev_rec_is_live(p_dev_rec) &&
+        (p_dev_rec->hci_handle == handle ||
+         p_dev_rec->ble_hci_handle == handle))
+      return p_dev_rec;
+  }
+
   list_node_t* n = list_foreach(btm_cb.sec_dev_rec, is_handle_equal, &handle);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  if (n) {
+    tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+    btm_dev_rec_index_handle(handle, p_dev_rec);
+    return p_dev_rec;
+  }
 
   return NULL;
 }
@@ -445,9 +576,27 @@ bool is_address_equal(void* data, void* context) {
  *
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr) {
+  if (bd_addr == RawAddress::kEmpty) return NULL;
+
+  auto it = dev_rec_by_addr.find(bd_addr);
+  if (it != dev_rec_by_addr.end()) {
+    tBTM_SEC_DEV_REC* p_dev_rec = it->second;
+    if (btm_dev_rec_is_live(p_dev_rec) &&
+        (p_dev_rec->bd_addr == bd_addr ||
+         p_dev_rec->ble.pseudo_addr == bd_addr))
+      return p_dev_rec;
+  }
+
   list_node_t* n =
       list_foreach(btm_cb.sec_dev_rec, is_address_equal, (void*)&bd_addr);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  if (n) {
+    tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+    /* Matches through RPA resolution are not indexed since they can only be
+     * validated by resolving the address again */
+    if (p_dev_rec->bd_addr == bd_addr || p_dev_rec->ble.pseudo_addr == bd_addr)
+      btm_dev_rec_index_addr(bd_addr, p_dev_rec);
+    return p_dev_rec;
+  }
 
   return NULL;
 }
@@ -491,6 +640,9 @@ void btm_consolidate_dev(tBTM_SEC_DEV_REC* p_target_rec) {
       p_target_rec->no_smp_on_br = temp_rec.no_smp_on_br;
       p_target_rec->bond_type = temp_rec.bond_type;
 
+      /* the target record inherited the timestamp of the combined one */
+      btm_dev_rec_lru_reposition(p_target_rec);
+
       /* remove the combined record */
       list_remove(btm_cb.sec_dev_rec, p_dev_rec);
       //p_dev_rec gets freed in list_remove, we should not  access it further
@@ -543,37 +695,18 @@ tBTM_SEC_DEV_REC* btm_find_or_alloc_dev(const RawAddress& bd_addr) {
  *
  ******************************************************************************/
 static tBTM_SEC_DEV_REC* btm_find_oldest_dev_rec(void) {
-  tBTM_SEC_DEV_REC* p_oldest = NULL;
-  uint32_t ts_oldest = 0xFFFFFFFF;
-  tBTM_SEC_DEV_REC* p_oldest_paired = NULL;
-  uint32_t ts_oldest_paired = 0xFFFFFFFF;
-
-  list_node_t* end = list_end(btm_cb.sec_dev_rec);
-  for (list_node_t* node = list_begin(btm_cb.sec_dev_rec); node != end;
-       node = list_next(node)) {
-    tBTM_SEC_DEV_REC* p_dev_rec =
-        static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
+  if (dev_rec_lru.empty()) return NULL;
 
+  // The LRU is ordered oldest first, so the first non-paired device found is
+  // the oldest one. Paired devices are usually a small minority at the front.
+  for (tBTM_SEC_DEV_REC* p_dev_rec : dev_rec_lru) {
     if ((p_dev_rec->sec_flags &
-         (BTM_SEC_LINK_KEY_KNOWN | BTM_SEC_LE_LINK_KEY_KNOWN)) == 0) {
-      // Device is not paired
-      if (p_dev_rec->timestamp < ts_oldest) {
-        p_oldest = p_dev_rec;
-        ts_oldest = p_dev_rec->timestamp;
-      }
-    } else {
-      // Paired device
-      if (p_dev_rec->timestamp < ts_oldest_paired) {
-        p_oldest_paired = p_dev_rec;
-        ts_oldest_paired = p_dev_rec->timestamp;
-      }
-    }
+         (BTM_SEC_LINK_KEY_KNOWN | BTM_SEC_LE_LINK_KEY_KNOWN)) == 0)
+      return p_dev_rec;
   }
 
   // If we did not find any non-paired devices, use the oldest paired one...
-  if (ts_oldest == 0xFFFFFFFF) p_oldest = p_oldest_paired;
-
-  return p_oldest;
+  return dev_rec_lru.front();
 }
 
 /*******************************************************************************
@@ -599,6 +732,7 @@ tBTM_SEC_DEV_REC* btm_sec_allocate_dev_rec(void) {
   p_dev_rec =
       static_cast<tBTM_SEC_DEV_REC*>(osi_calloc(sizeof(tBTM_SEC_DEV_REC)));
   list_append(btm_cb.sec_dev_rec, p_dev_rec);
+  dev_rec_lru_pos[p_dev_rec] = dev_rec_lru.insert(dev_rec_lru.end(), p_dev_rec);
 
   // Initialize defaults
   p_dev_rec->sec_flags = BTM_SEC_IN_USE;
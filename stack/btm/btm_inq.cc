@@ -29,6 +29,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <vector>
 
 #include "device/include/controller.h"
 #include "osi/include/osi.h"
@@ -42,6 +46,7 @@
 #include "btu.h"
 #include "hcidefs.h"
 #include "hcimsgs.h"
+#include "stack_config.h"
 
 using bluetooth::Uuid;
 
@@ -59,6 +64,47 @@ using bluetooth::Uuid;
 static const LAP general_inq_lap = {0x9e, 0x8b, 0x33};
 static const LAP limited_inq_lap = {0x9e, 0x8b, 0x00};
 
+/* Largest inquiry database accepted from stack_config. Inquiry response
+ * counts are kept in 8 bits. */
+#define BTM_INQ_DB_MAX_SIZE 255
+
+struct InqDbAddrHash {
+  std::size_t operator()(const RawAddress& x) const {
+    const uint8_t* a = x.address;
+    return a[0] ^ (a[1] << 8) ^ (a[2] << 16) ^ (a[3] << 24) ^ a[4] ^
+           (a[5] << 8);
+  }
+};
+
+/* In use entries, least recently heard first */
+typedef std::list<tINQ_DB_ENT*> InqDbLru;
+
+static InqDbLru inq_db_lru;
+static std::unordered_map<RawAddress, InqDbLru::iterator, InqDbAddrHash>
+    inq_db_index;
+static std::vector<tINQ_DB_ENT*> inq_db_free_list;
+
+/* Remote name requests waiting for the active one, bonded devices first */
+typedef struct {
+  RawAddress bd_addr;
+  tBTM_CMPL_CB* p_cb;
+  period_ms_t timeout_ms;
+  bool bonded;
+} tBTM_RMT_NAME_REQ;
+
+static std::deque<tBTM_RMT_NAME_REQ> rmt_name_queue;
+
+/* Names read from remote devices. Kept apart from the inquiry database, which
+ * is cleared at the start of every discovery. */
+typedef struct {
+  BD_NAME name;
+  uint16_t length;
+  uint32_t time_ms;
+} tBTM_RMT_NAME_CACHE_ENT;
+
+static std::unordered_map<RawAddress, tBTM_RMT_NAME_CACHE_ENT, InqDbAddrHash>
+    rmt_name_cache;
+
 const uint16_t BTM_EIR_UUID_LKUP_TBL[BTM_EIR_MAX_SERVICES] = {
     UUID_SERVCLASS_SERVICE_DISCOVERY_SERVER,
     /*    UUID_SERVCLASS_BROWSE_GROUP_DESCRIPTOR,   */
@@ -116,6 +162,18 @@ static void btm_initiate_inquiry(tBTM_INQUIRY_VAR_ST* p_inq);
 static tBTM_STATUS btm_set_inq_event_filter(uint8_t filter_cond_type,
                                             tBTM_INQ_FILT_COND* p_filt_cond);
 static void btm_clr_inq_result_flt(void);
+static void btm_inq_db_reindex(void);
+static tBTM_STATUS btm_inq_start_rem_name(const RawAddress& remote_bda,
+                                          period_ms_t timeout_ms,
+                                          tBTM_CMPL_CB* p_cb);
+static void btm_inq_rmt_name_next(void);
+static void btm_inq_remote_name_cached(void* data);
+static const tBTM_RMT_NAME_CACHE_ENT* btm_rmt_name_cache_find(
+    const RawAddress& bd_addr);
+static void btm_rmt_name_cache_store(const RawAddress& bd_addr,
+                                     const uint8_t* p_name, uint16_t length);
+static void btm_inq_db_set_name(tINQ_DB_ENT* p_ent,
+                                const tBTM_RMT_NAME_CACHE_ENT* p_name);
 
 static uint8_t btm_convert_uuid_to_eir_service(uint16_t uuid16);
 static void btm_set_eir_uuid(uint8_t* p_eir, tBTM_INQ_RESULTS* p_results);
@@ -945,8 +1003,9 @@ tBTM_STATUS BTM_StartInquiry(tBTM_INQ_PARMS* p_inqparms,
  *
  * Returns
  *                  BTM_CMD_STARTED is returned if the request was successfully
- *                                  sent to HCI.
- *                  BTM_BUSY if already in progress
+ *                                  sent to HCI, queued behind the one in
+ *                                  progress or answered from the name cache.
+ *                  BTM_BUSY if too many requests are already queued
  *                  BTM_UNKNOWN_ADDR if device address is bad
  *                  BTM_NO_RESOURCES if could not allocate resources to start
  *                                   the command
@@ -991,6 +1050,8 @@ tBTM_STATUS BTM_CancelRemoteDeviceName(void) {
 
   /* Make sure there is not already one in progress */
   if (p_inq->remname_active) {
+    /* A cached name is answered without going to the controller */
+    if (p_inq->remname_from_cache) return (BTM_CMD_STARTED);
     if (BTM_UseLeLink(p_inq->remname_bda)) {
       if (btm_ble_cancel_remote_name(p_inq->remname_bda))
         return (BTM_CMD_STARTED);
@@ -1041,7 +1102,7 @@ tBTM_INQ_INFO* BTM_InqDbFirst(void) {
   uint16_t xx;
   tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
 
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
+  for (xx = 0; xx < btm_cb.btm_inq_vars.inq_db_size; xx++, p_ent++) {
     if (p_ent->in_use) return (&p_ent->inq_info);
   }
 
@@ -1068,8 +1129,8 @@ tBTM_INQ_INFO* BTM_InqDbNext(tBTM_INQ_INFO* p_cur) {
     p_ent = (tINQ_DB_ENT*)((uint8_t*)p_cur - offsetof(tINQ_DB_ENT, inq_info));
     inx = (uint16_t)((p_ent - btm_cb.btm_inq_vars.inq_db) + 1);
 
-    for (p_ent = &btm_cb.btm_inq_vars.inq_db[inx]; inx < BTM_INQ_DB_SIZE;
-         inx++, p_ent++) {
+    for (p_ent = &btm_cb.btm_inq_vars.inq_db[inx];
+         inx < btm_cb.btm_inq_vars.inq_db_size; inx++, p_ent++) {
       if (p_ent->in_use) return (&p_ent->inq_info);
     }
 
@@ -1174,6 +1235,7 @@ void btm_inq_db_reset(void) {
   if (p_inq->remname_active) {
     alarm_cancel(p_inq->remote_name_timer);
     p_inq->remname_active = false;
+    p_inq->remname_from_cache = false;
     p_inq->remname_bda = RawAddress::kEmpty;
 
     if (p_inq->p_remname_cmpl_cb) {
@@ -1184,6 +1246,18 @@ void btm_inq_db_reset(void) {
     }
   }
 
+  /* The queued requests are notified the same way */
+  std::deque<tBTM_RMT_NAME_REQ> queue;
+  queue.swap(rmt_name_queue);
+  for (const tBTM_RMT_NAME_REQ& req : queue) {
+    if (req.p_cb == NULL) continue;
+    rem_name.status = BTM_DEV_RESET;
+    rem_name.bd_addr = req.bd_addr;
+    rem_name.length = 0;
+    rem_name.remote_bd_name[0] = 0;
+    (*req.p_cb)(&rem_name);
+  }
+
   /* Cancel an inquiry filter request if active, and notify the caller (if
    * waiting) */
   if (p_inq->inqfilt_active) {
@@ -1222,14 +1296,107 @@ void btm_inq_db_reset(void) {
  *
  ******************************************************************************/
 void btm_inq_db_init(void) {
-  alarm_free(btm_cb.btm_inq_vars.remote_name_timer);
-  btm_cb.btm_inq_vars.remote_name_timer =
-      alarm_new("btm_inq.remote_name_timer");
-  btm_cb.btm_inq_vars.no_inc_ssp = BTM_NO_SSP_ON_INQUIRY;
+  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
+  int size = stack_config_get_interface()->get_inq_db_size();
+
+  if (size <= 0) size = BTM_INQ_DB_SIZE;
+  if (size > BTM_INQ_DB_MAX_SIZE) size = BTM_INQ_DB_MAX_SIZE;
+
+  alarm_free(p_inq->remote_name_timer);
+  p_inq->remote_name_timer = alarm_new("btm_inq.remote_name_timer");
+  p_inq->no_inc_ssp = BTM_NO_SSP_ON_INQUIRY;
+
+  osi_free(p_inq->inq_db);
+  p_inq->inq_db_size = (uint16_t)size;
+  p_inq->inq_db =
+      (tINQ_DB_ENT*)osi_calloc(p_inq->inq_db_size * sizeof(tINQ_DB_ENT));
+  btm_inq_db_reindex();
 }
 
 void btm_inq_db_free(void) {
   alarm_free(btm_cb.btm_inq_vars.remote_name_timer);
+
+  rmt_name_queue.clear();
+  rmt_name_cache.clear();
+
+  inq_db_index.clear();
+  inq_db_lru.clear();
+  inq_db_free_list.clear();
+  osi_free_and_reset((void**)&btm_cb.btm_inq_vars.inq_db);
+  btm_cb.btm_inq_vars.inq_db_size = 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_inq_db_reindex
+ *
+ * Description      Rebuilds the address index, the LRU order and the free list
+ *                  from the inquiry database, after the entries were moved.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_inq_db_reindex(void) {
+  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
+  uint16_t xx;
+
+  inq_db_index.clear();
+  inq_db_lru.clear();
+  inq_db_free_list.clear();
+
+  for (xx = 0; xx < btm_cb.btm_inq_vars.inq_db_size; xx++, p_ent++) {
+    if (p_ent->in_use)
+      inq_db_lru.push_back(p_ent);
+    else
+      inq_db_free_list.push_back(p_ent);
+  }
+
+  inq_db_lru.sort([](const tINQ_DB_ENT* a, const tINQ_DB_ENT* b) {
+    return a->time_of_resp < b->time_of_resp;
+  });
+
+  for (auto it = inq_db_lru.begin(); it != inq_db_lru.end(); ++it)
+    inq_db_index[(*it)->inq_info.results.remote_bd_addr] = it;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_inq_db_delete
+ *
+ * Description      This function removes an entry from the inquiry database.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_inq_db_delete(tINQ_DB_ENT* p_ent) {
+  if (!p_ent->in_use) return;
+
+  auto map_it = inq_db_index.find(p_ent->inq_info.results.remote_bd_addr);
+  if (map_it != inq_db_index.end() && *map_it->second == p_ent) {
+    inq_db_lru.erase(map_it->second);
+    inq_db_index.erase(map_it);
+  }
+
+  p_ent->in_use = false;
+  inq_db_free_list.push_back(p_ent);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_inq_db_update_time
+ *
+ * Description      This function records that a response was just received
+ *                  for an entry, making it the last one to be evicted.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_inq_db_update_time(tINQ_DB_ENT* p_ent) {
+  p_ent->time_of_resp = time_get_os_boottime_ms();
+
+  auto map_it = inq_db_index.find(p_ent->inq_info.results.remote_bd_addr);
+  if (map_it != inq_db_index.end())
+    inq_db_lru.splice(inq_db_lru.end(), inq_db_lru, map_it->second);
 }
 
 /*******************************************************************************
@@ -1302,13 +1469,14 @@ void btm_clr_inq_db(const RawAddress* p_bda) {
   BTM_TRACE_DEBUG("btm_clr_inq_db: inq_active:0x%x state:%d",
                   btm_cb.btm_inq_vars.inq_active, btm_cb.btm_inq_vars.state);
 #endif
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (p_ent->in_use) {
-      /* If this is the specified BD_ADDR or clearing all devices */
-      if (p_bda == NULL || (p_ent->inq_info.results.remote_bd_addr == *p_bda)) {
-        p_ent->in_use = false;
-      }
-    }
+  if (p_bda != NULL) {
+    /* Clear the specified BD_ADDR */
+    p_ent = btm_inq_db_find(*p_bda);
+    if (p_ent != NULL) btm_inq_db_delete(p_ent);
+  } else {
+    /* Clear all devices */
+    for (xx = 0; xx < p_inq->inq_db_size; xx++, p_ent++) p_ent->in_use = false;
+    btm_inq_db_reindex();
   }
 #if (BTM_INQ_DEBUG == TRUE)
   BTM_TRACE_DEBUG("inq_active:0x%x state:%d", btm_cb.btm_inq_vars.inq_active,
@@ -1381,13 +1549,8 @@ bool btm_inq_find_bdaddr(const RawAddress& p_bda, tBT_DEVICE_TYPE p_dev_type) {
  *
  ******************************************************************************/
 tINQ_DB_ENT* btm_inq_db_find(const RawAddress& p_bda) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
-
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (p_ent->in_use && p_ent->inq_info.results.remote_bd_addr == p_bda)
-      return (p_ent);
-  }
+  auto map_it = inq_db_index.find(p_bda);
+  if (map_it != inq_db_index.end()) return (*map_it->second);
 
   /* If here, not found */
   return (NULL);
@@ -1397,41 +1560,34 @@ tINQ_DB_ENT* btm_inq_db_find(const RawAddress& p_bda) {
  *
  * Function         btm_inq_db_new
  *
- * Description      This function looks through the inquiry database for an
- *                  unused entry. If no entry is free, it allocates the oldest
- *                  entry.
+ * Description      This function takes an unused entry from the inquiry
+ *                  database. If no entry is free, it reuses the entry that was
+ *                  heard from least recently.
  *
  * Returns          pointer to entry
  *
  ******************************************************************************/
 tINQ_DB_ENT* btm_inq_db_new(const RawAddress& p_bda) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
-  tINQ_DB_ENT* p_old = btm_cb.btm_inq_vars.inq_db;
-  uint32_t ot = 0xFFFFFFFF;
-
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (!p_ent->in_use) {
-      memset(p_ent, 0, sizeof(tINQ_DB_ENT));
-      p_ent->inq_info.results.remote_bd_addr = p_bda;
-      p_ent->in_use = true;
+  tINQ_DB_ENT* p_ent = btm_inq_db_find(p_bda);
 
-      return (p_ent);
-    }
+  if (p_ent != NULL) btm_inq_db_delete(p_ent);
 
-    if (p_ent->time_of_resp < ot) {
-      p_old = p_ent;
-      ot = p_ent->time_of_resp;
-    }
+  if (!inq_db_free_list.empty()) {
+    p_ent = inq_db_free_list.back();
+    inq_db_free_list.pop_back();
+  } else {
+    /* If here, no free entry found. Reuse the oldest. */
+    p_ent = inq_db_lru.front();
+    inq_db_index.erase(p_ent->inq_info.results.remote_bd_addr);
+    inq_db_lru.pop_front();
   }
 
-  /* If here, no free entry found. Return the oldest. */
-
-  memset(p_old, 0, sizeof(tINQ_DB_ENT));
-  p_old->inq_info.results.remote_bd_addr = p_bda;
-  p_old->in_use = true;
+  memset(p_ent, 0, sizeof(tINQ_DB_ENT));
+  p_ent->inq_info.results.remote_bd_addr = p_bda;
+  p_ent->in_use = true;
 
-  return (p_old);
+  inq_db_index[p_bda] = inq_db_lru.insert(inq_db_lru.end(), p_ent);
+  return (p_ent);
 }
 
 /*******************************************************************************
@@ -1649,9 +1805,10 @@ static void btm_initiate_inquiry(tBTM_INQUIRY_VAR_ST* p_inq) {
 
   /* Make sure the number of responses doesn't overflow the database
    * configuration */
-  p_inqparms->max_resps = (uint8_t)((p_inqparms->max_resps <= BTM_INQ_DB_SIZE)
-                                        ? p_inqparms->max_resps
-                                        : BTM_INQ_DB_SIZE);
+  p_inqparms->max_resps =
+      (uint8_t)((p_inqparms->max_resps <= p_inq->inq_db_size)
+                    ? p_inqparms->max_resps
+                    : p_inq->inq_db_size);
 
   lap = (p_inq->inq_active & BTM_LIMITED_INQUIRY_ACTIVE) ? &limited_inq_lap
                                                          : &general_inq_lap;
@@ -1793,6 +1950,9 @@ void btm_process_inq_results(uint8_t* p, uint8_t inq_res_mode) {
     if (p_i == NULL) {
       p_i = btm_inq_db_new(bda);
       is_new = true;
+
+      const tBTM_RMT_NAME_CACHE_ENT* p_name = btm_rmt_name_cache_find(bda);
+      if (p_name != NULL) btm_inq_db_set_name(p_i, p_name);
     }
 
     /* If an entry for the device already exists, overwrite it ONLY if it is
@@ -1826,7 +1986,7 @@ void btm_process_inq_results(uint8_t* p, uint8_t inq_res_mode) {
       BTM_TRACE_WARNING ("btm_process_inq_results: Dev class: %02x-%02x-%02x",
                   p_cur->dev_class[0], p_cur->dev_class[1], p_cur->dev_class[2]);
 
-      p_i->time_of_resp = time_get_os_boottime_ms();
+      btm_inq_db_update_time(p_i);
 
       if (p_i->inq_count != p_inq->inq_counter)
         p_inq->inq_cmpl_info.num_resp++; /* A new response was found */
@@ -1895,9 +2055,10 @@ void btm_sort_inq_result(void) {
   int size;
   tINQ_DB_ENT* p_tmp = (tINQ_DB_ENT*)osi_malloc(sizeof(tINQ_DB_ENT));
 
-  num_resp = (btm_cb.btm_inq_vars.inq_cmpl_info.num_resp < BTM_INQ_DB_SIZE)
+  num_resp = (btm_cb.btm_inq_vars.inq_cmpl_info.num_resp <
+              btm_cb.btm_inq_vars.inq_db_size)
                  ? btm_cb.btm_inq_vars.inq_cmpl_info.num_resp
-                 : BTM_INQ_DB_SIZE;
+                 : btm_cb.btm_inq_vars.inq_db_size;
 
   size = sizeof(tINQ_DB_ENT);
   for (xx = 0; xx < num_resp - 1; xx++, p_ent++) {
@@ -1911,6 +2072,9 @@ void btm_sort_inq_result(void) {
   }
 
   osi_free(p_tmp);
+
+  /* The entries moved, the index refers to their old slots */
+  btm_inq_db_reindex();
 }
 
 /*******************************************************************************
@@ -2055,9 +2219,14 @@ void btm_process_cancel_complete(uint8_t status, uint8_t mode) {
  *                                    A pointer to tBTM_REMOTE_DEV_NAME is
  *                                    passed to the callback.
  *
+ *                  A request made while another one is in progress is queued
+ *                  (once per address and callback) and started when the
+ *                  active one completes.
+ *
  * Returns
- *                  BTM_CMD_STARTED is returned if the request was sent to HCI.
- *                  BTM_BUSY if already in progress
+ *                  BTM_CMD_STARTED is returned if the request was sent to HCI
+ *                                  or queued.
+ *                  BTM_BUSY if the request queue is full
  *                  BTM_NO_RESOURCES if could not allocate resources to start
  *                                   the command
  *                  BTM_WRONG_MODE if the device is not up.
@@ -2075,42 +2244,210 @@ tBTM_STATUS btm_initiate_rem_name(const RawAddress& remote_bda, uint8_t origin,
                             HCI_MANDATARY_PAGE_SCAN_MODE, 0);
     return BTM_CMD_STARTED;
   }
-  /* Make sure there are no two remote name requests from external API in
-     progress */
+  /* Requests from the external API are run one at a time */
   else if (origin == BTM_RMT_NAME_EXT) {
-    if (p_inq->remname_active) {
-      return (BTM_BUSY);
-    } else {
-      /* If there is no remote name request running,call the callback function
-       * and start timer */
-      p_inq->p_remname_cmpl_cb = p_cb;
-      p_inq->remname_bda = remote_bda;
-
-      alarm_set_on_mloop(p_inq->remote_name_timer, timeout_ms,
-                         btm_inq_remote_name_timer_timeout, NULL);
-
-      /* If the database entry exists for the device, use its clock offset */
-      tINQ_DB_ENT* p_i = btm_inq_db_find(remote_bda);
-      if (p_i && (p_i->inq_info.results.inq_result_type & BTM_INQ_RESULT_BR)) {
-        tBTM_INQ_INFO* p_cur = &p_i->inq_info;
-        btsnd_hcic_rmt_name_req(
-            remote_bda, p_cur->results.page_scan_rep_mode,
-            p_cur->results.page_scan_mode,
-            (uint16_t)(p_cur->results.clock_offset | BTM_CLOCK_OFFSET_VALID));
-      } else {
-        /* Otherwise use defaults and mark the clock offset as invalid */
-        btsnd_hcic_rmt_name_req(remote_bda, HCI_PAGE_SCAN_REP_MODE_R1,
-                                HCI_MANDATARY_PAGE_SCAN_MODE, 0);
-      }
+    if (!p_inq->remname_active)
+      return btm_inq_start_rem_name(remote_bda, timeout_ms, p_cb);
 
-      p_inq->remname_active = true;
+    /* The same request is answered once */
+    if (p_inq->remname_bda == remote_bda && p_inq->p_remname_cmpl_cb == p_cb)
       return BTM_CMD_STARTED;
+    for (const tBTM_RMT_NAME_REQ& req : rmt_name_queue) {
+      if (req.bd_addr == remote_bda && req.p_cb == p_cb) return BTM_CMD_STARTED;
     }
+    if (rmt_name_queue.size() >= BTM_RMT_NAME_QUEUE_SIZE) return (BTM_BUSY);
+
+    /* Names of bonded devices are read before the others */
+    tBTM_RMT_NAME_REQ req = {remote_bda, p_cb, timeout_ms,
+                             btm_sec_is_a_bonded_dev(remote_bda)};
+    auto it = rmt_name_queue.end();
+    if (req.bonded) {
+      it = rmt_name_queue.begin();
+      while (it != rmt_name_queue.end() && it->bonded) it++;
+    }
+    rmt_name_queue.insert(it, req);
+    VLOG(1) << __func__ << ": queued " << remote_bda << ", "
+            << rmt_name_queue.size() << " waiting";
+    return BTM_CMD_STARTED;
   } else {
     return BTM_ILLEGAL_VALUE;
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_inq_start_rem_name
+ *
+ * Description      This function starts an external remote name request. A
+ *                  request with a callback for a device whose name is in the
+ *                  cache is answered from it. Requests without a callback come
+ *                  from security, which needs the request to go to the peer to
+ *                  learn its host features.
+ *
+ * Returns          BTM_CMD_STARTED
+ *
+ ******************************************************************************/
+static tBTM_STATUS btm_inq_start_rem_name(const RawAddress& remote_bda,
+                                          period_ms_t timeout_ms,
+                                          tBTM_CMPL_CB* p_cb) {
+  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
+
+  p_inq->p_remname_cmpl_cb = p_cb;
+  p_inq->remname_bda = remote_bda;
+  p_inq->remname_active = true;
+  p_inq->remname_from_cache =
+      (p_cb != NULL && btm_rmt_name_cache_find(remote_bda) != NULL);
+
+  if (p_inq->remname_from_cache) {
+    /* Answer from the message loop, as the controller would */
+    alarm_set_on_mloop(p_inq->remote_name_timer, 0, btm_inq_remote_name_cached,
+                       NULL);
+    return BTM_CMD_STARTED;
+  }
+
+  alarm_set_on_mloop(p_inq->remote_name_timer, timeout_ms,
+                     btm_inq_remote_name_timer_timeout, NULL);
+
+  /* If the database entry exists for the device, use its clock offset */
+  tINQ_DB_ENT* p_i = btm_inq_db_find(remote_bda);
+  if (p_i && (p_i->inq_info.results.inq_result_type & BTM_INQ_RESULT_BR)) {
+    tBTM_INQ_INFO* p_cur = &p_i->inq_info;
+    btsnd_hcic_rmt_name_req(
+        remote_bda, p_cur->results.page_scan_rep_mode,
+        p_cur->results.page_scan_mode,
+        (uint16_t)(p_cur->results.clock_offset | BTM_CLOCK_OFFSET_VALID));
+  } else {
+    /* Otherwise use defaults and mark the clock offset as invalid */
+    btsnd_hcic_rmt_name_req(remote_bda, HCI_PAGE_SCAN_REP_MODE_R1,
+                            HCI_MANDATARY_PAGE_SCAN_MODE, 0);
+  }
+  return BTM_CMD_STARTED;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_inq_rmt_name_next
+ *
+ * Description      This function starts the first queued remote name request
+ *                  if none is in progress.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_inq_rmt_name_next(void) {
+  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
+
+  if (p_inq->remname_active || rmt_name_queue.empty()) return;
+
+  tBTM_RMT_NAME_REQ req = rmt_name_queue.front();
+  rmt_name_queue.pop_front();
+  btm_inq_start_rem_name(req.bd_addr, req.timeout_ms, req.p_cb);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_inq_remote_name_cached
+ *
+ * Description      This function completes the active remote name request with
+ *                  the cached name of the device.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_inq_remote_name_cached(UNUSED_ATTR void* data) {
+  const RawAddress bd_addr = btm_cb.btm_inq_vars.remname_bda;
+  const tBTM_RMT_NAME_CACHE_ENT* p_ent = btm_rmt_name_cache_find(bd_addr);
+  BD_NAME bd_name;
+
+  if (p_ent == NULL) {
+    btm_process_remote_name(&bd_addr, NULL, 0, HCI_ERR_UNSPECIFIED);
+    return;
+  }
+
+  VLOG(1) << __func__ << ": " << bd_addr;
+  memcpy(bd_name, p_ent->name, sizeof(bd_name));
+  btm_process_remote_name(&bd_addr, bd_name, p_ent->length, HCI_SUCCESS);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_rmt_name_cache_find
+ *
+ * Description      This function looks up the name read from a device, if it
+ *                  is recent enough.
+ *
+ * Returns          pointer to the cached name, or NULL if not found
+ *
+ ******************************************************************************/
+static const tBTM_RMT_NAME_CACHE_ENT* btm_rmt_name_cache_find(
+    const RawAddress& bd_addr) {
+  auto it = rmt_name_cache.find(bd_addr);
+  if (it == rmt_name_cache.end()) return NULL;
+
+  if (time_get_os_boottime_ms() - it->second.time_ms >
+      BTM_RMT_NAME_CACHE_TTL_MS) {
+    rmt_name_cache.erase(it);
+    return NULL;
+  }
+  return &it->second;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_rmt_name_cache_store
+ *
+ * Description      This function remembers the name read from a device, and
+ *                  gives it to its inquiry database entry. The oldest name is
+ *                  forgotten when the cache is full.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_rmt_name_cache_store(const RawAddress& bd_addr,
+                                     const uint8_t* p_name, uint16_t length) {
+  length = strnlen((const char*)p_name, (length < BD_NAME_LEN) ? length
+                                                               : BD_NAME_LEN);
+  if (length == 0) return;
+
+  if (rmt_name_cache.find(bd_addr) == rmt_name_cache.end() &&
+      rmt_name_cache.size() >= BTM_RMT_NAME_CACHE_SIZE) {
+    auto oldest = rmt_name_cache.begin();
+    for (auto it = rmt_name_cache.begin(); it != rmt_name_cache.end(); it++) {
+      if ((int32_t)(it->second.time_ms - oldest->second.time_ms) < 0)
+        oldest = it;
+    }
+    rmt_name_cache.erase(oldest);
+  }
+
+  tBTM_RMT_NAME_CACHE_ENT* p_ent = &rmt_name_cache[bd_addr];
+  memcpy(p_ent->name, p_name, length);
+  p_ent->name[length] = 0;
+  p_ent->length = length;
+  p_ent->time_ms = time_get_os_boottime_ms();
+
+  tINQ_DB_ENT* p_i = btm_inq_db_find(bd_addr);
+  if (p_i != NULL) btm_inq_db_set_name(p_i, p_ent);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_inq_db_set_name
+ *
+ * Description      This function fills the remote name of an inquiry database
+ *                  entry.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_inq_db_set_name(tINQ_DB_ENT* p_ent,
+                                const tBTM_RMT_NAME_CACHE_ENT* p_name) {
+  tBTM_INQ_INFO* p_info = &p_ent->inq_info;
+
+  memcpy(p_info->remote_name, p_name->name, p_name->length + 1);
+  p_info->remote_name_len = p_name->length;
+  p_info->remote_name_state = BTM_INQ_RMT_NAME_DONE;
+}
+
 /*******************************************************************************
  *
  * Function         btm_process_remote_name
@@ -2140,15 +2477,24 @@ void btm_process_remote_name(const RawAddress* bda, BD_NAME bdn,
 
   VLOG(2) << "Inquire BDA " << p_inq->remname_bda;
 
+  bool is_active =
+      (p_inq->remname_active) && (!bda || (*bda == p_inq->remname_bda));
+
+  /* Remember every name read from a device, whoever asked for it */
+  if (bda && bdn && hci_status == HCI_SUCCESS &&
+      !(is_active && p_inq->remname_from_cache))
+    btm_rmt_name_cache_store(*bda, bdn, evt_len);
+
   /* If the inquire BDA and remote DBA are the same, then stop the timer and set
    * the active to false */
-  if ((p_inq->remname_active) && (!bda || (*bda == p_inq->remname_bda))) {
+  if (is_active) {
     if (BTM_UseLeLink(p_inq->remname_bda)) {
       if (hci_status == HCI_ERR_UNSPECIFIED)
         btm_ble_cancel_remote_name(p_inq->remname_bda);
     }
     alarm_cancel(p_inq->remote_name_timer);
     p_inq->remname_active = false;
+    p_inq->remname_from_cache = false;
     /* Clean up and return the status if the command was not successful */
     /* Note: If part of the inquiry, the name is not stored, and the    */
     /*       inquiry complete callback is called.                       */
@@ -2182,6 +2528,8 @@ void btm_process_remote_name(const RawAddress* bda, BD_NAME bdn,
 
     p_inq->p_remname_cmpl_cb = NULL;
     if (p_cb) (p_cb)((tBTM_REMOTE_DEV_NAME*)&rem_name);
+
+    btm_inq_rmt_name_next();
   }
 }
 
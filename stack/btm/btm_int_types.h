@@ -79,6 +79,9 @@ typedef struct {
                                                             features mask table
                                                             for the device */
   uint8_t num_read_pages;
+  uint8_t feature_pages_pending; /* Bit mask of the pages being read */
+  uint8_t feature_pages_done;    /* Bit mask of the pages read */
+  bool feature_read_failed;      /* No more extended pages are read */
   uint8_t lmp_version;
 
   bool in_use;
@@ -261,6 +264,7 @@ typedef struct {
 #define BTM_RMT_NAME_SEC 0x2 /* Initiated internally by security manager */
 #define BTM_RMT_NAME_INQ 0x4 /* Remote name initiated internally by inquiry */
   bool remname_active; /* State of a remote name request by external API */
+  bool remname_from_cache; /* Active request answered from the name cache */
 
   tBTM_CMPL_CB* p_inq_cmpl_cb;
   tBTM_INQ_RESULTS_CB* p_inq_results_cb;
@@ -276,7 +280,8 @@ typedef struct {
   tINQ_BDADDR* p_bd_db;    /* Pointer to memory that holds bdaddrs */
   uint16_t num_bd_entries; /* Number of entries in database */
   uint16_t max_bd_entries; /* Maximum number of entries that can be stored */
-  tINQ_DB_ENT inq_db[BTM_INQ_DB_SIZE];
+  tINQ_DB_ENT* inq_db;  /* inquiry database, inq_db_size entries */
+  uint16_t inq_db_size; /* from stack_config, defaults to BTM_INQ_DB_SIZE */
   tBTM_INQ_PARMS inqparms; /* Contains the parameters for the current inquiry */
   tBTM_INQUIRY_CMPL
       inq_cmpl_info; /* Status and number of responses from the last inquiry */
@@ -363,12 +368,25 @@ typedef struct {
   uint8_t hci_status;
 } tBTM_ESCO_INFO;
 
+#if (BTM_SCO_HCI_INCLUDED == TRUE)
+/* SCO data over HCI of one connection, by Packet_Status_Flag when received */
+typedef struct {
+  uint32_t rx_pkts;           /* received correctly */
+  uint32_t rx_err_pkts;       /* possibly invalid data */
+  uint32_t rx_lost_pkts;      /* no data received */
+  uint32_t rx_part_lost_pkts; /* partially lost data */
+  uint32_t tx_pkts;           /* sent to the controller */
+  uint32_t tx_dropped_pkts;   /* not sent, bad offset */
+} tBTM_SCO_DATA_STATS;
+#endif
+
 /* Define the structure used for SCO Management
 */
 typedef struct {
   tBTM_ESCO_INFO esco; /* Current settings             */
 #if (BTM_SCO_HCI_INCLUDED == TRUE)
-  fixed_queue_t* xmit_data_q; /* SCO data transmitting queue  */
+  fixed_queue_t* xmit_data_q;     /* SCO data transmitting queue  */
+  tBTM_SCO_DATA_STATS data_stats; /* SCO data of this connection  */
 #endif
   tBTM_SCO_CB* p_conn_cb; /* Callback for when connected  */
   tBTM_SCO_CB* p_disc_cb; /* Callback for when disconnect */
@@ -440,6 +458,21 @@ typedef struct {
 #endif
 } tBTM_SEC_SERV_REC;
 
+/* Index of the security service records in use, for the lookups on the
+ * connection path. Each chain holds the records of a hash of the PSM, or of
+ * the PSM and the originator or acceptor multiplexer channel, in record order.
+ * Entries are a record index plus one, zero ends a chain. */
+#define BTM_SEC_SERV_HASH_SIZE 32
+
+typedef struct {
+  uint8_t psm_first[BTM_SEC_SERV_HASH_SIZE];
+  uint8_t orig_first[BTM_SEC_SERV_HASH_SIZE];
+  uint8_t term_first[BTM_SEC_SERV_HASH_SIZE];
+  uint8_t psm_next[BTM_SEC_MAX_SERVICE_RECORDS];
+  uint8_t orig_next[BTM_SEC_MAX_SERVICE_RECORDS];
+  uint8_t term_next[BTM_SEC_MAX_SERVICE_RECORDS];
+} tBTM_SEC_SERV_INDEX;
+
 /* LE Security information of device in Slave Role */
 typedef struct {
   Octet16 irk;   /* peer diverified identity root */
@@ -476,6 +509,7 @@ typedef struct {
   uint8_t resolving_list_index;
 #if (BLE_PRIVACY_SPT == TRUE)
   RawAddress cur_rand_addr; /* current random address */
+  uint32_t rl_timestamp; /* last connection, orders the resolving list */
 
 #define BTM_BLE_ADDR_PSEUDO 0 /* address index device record */
 #define BTM_BLE_ADDR_RRA 1    /* cur_rand_addr */
@@ -539,6 +573,13 @@ typedef struct {
                             1]; /* Features supported by the device */
   uint8_t num_read_pages;
 
+  /* Remote version read on the last connection. The features above are
+   * dropped when it changes, the peer got a new controller or firmware. */
+  bool remote_version_known;
+  uint8_t lmp_version;
+  uint16_t manufacturer;
+  uint16_t lmp_subversion;
+
 #define BTM_SEC_STATE_IDLE 0
 #define BTM_SEC_STATE_AUTHENTICATING 1
 #define BTM_SEC_STATE_ENCRYPTING 2
@@ -626,6 +667,12 @@ typedef struct {
 #define BTM_MAX_BL_SW_ROLE_ATTEMPTS 1
   uint8_t switch_role_attempts;
 #endif
+  /* Link policy outcomes of the peer, kept in its config section. The refused
+   * counts are the connections left on which the request is not attempted. */
+  bool link_outcome_loaded;
+  uint8_t rs_refused_conns;
+  uint8_t sniff_refused_conns;
+  uint8_t peer_pref_role; /* Local role the peer switched the link to */
 } tBTM_SEC_DEV_REC;
 
 #define BTM_SEC_IS_SM4(sm) ((bool)(BTM_SM4_TRUE == ((sm)&BTM_SM4_TRUE)))
@@ -858,6 +905,7 @@ typedef struct {
   **      Security Management
   *****************************************************/
   tBTM_APPL_INFO api;
+  tBTM_SEC_DEV_LOAD_CALLBACK* p_dev_load_callback;
 
 #define BTM_SEC_MAX_RMT_NAME_CALLBACKS 2
   tBTM_RMT_NAME_CALLBACK* p_rmt_name_callback[BTM_SEC_MAX_RMT_NAME_CALLBACKS];
@@ -883,6 +931,7 @@ typedef struct {
   uint16_t disc_handle;             /* for legacy devices */
   uint8_t disc_reason;              /* for legacy devices */
   tBTM_SEC_SERV_REC sec_serv_rec[BTM_SEC_MAX_SERVICE_RECORDS];
+  tBTM_SEC_SERV_INDEX sec_serv_index; /* rebuilt when the records change */
   list_t* sec_dev_rec; /* list of tBTM_SEC_DEV_REC */
   tBTM_SEC_SERV_REC* p_out_serv;
   tBTM_MKEY_CALLBACK* mkey_cback;
@@ -65,17 +65,43 @@
 
 static uint16_t btm_sco_voice_settings_to_legacy(enh_esco_params_t* p_parms);
 
+#if (BTM_SCO_HCI_INCLUDED == TRUE && BTM_MAX_SCO_LINKS > 0)
+/*******************************************************************************
+ *
+ * Function         btm_sco_report_data_stats
+ *
+ * Description      This function logs the statistics of the SCO data over HCI
+ *                  of a connection that went down, and clears them.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_sco_report_data_stats(tSCO_CONN* p) {
+  tBTM_SCO_DATA_STATS* p_stats = &p->data_stats;
+  uint32_t rx_total = p_stats->rx_pkts + p_stats->rx_err_pkts +
+                      p_stats->rx_lost_pkts + p_stats->rx_part_lost_pkts;
+
+  if (rx_total != 0 || p_stats->tx_pkts != 0 || p_stats->tx_dropped_pkts != 0) {
+    BTM_TRACE_EVENT(
+        "%s: handle 0x%04x rx %u (erroneous %u, lost %u, partially lost %u), "
+        "tx %u (dropped %u)",
+        __func__, p->hci_handle, rx_total, p_stats->rx_err_pkts,
+        p_stats->rx_lost_pkts, p_stats->rx_part_lost_pkts, p_stats->tx_pkts,
+        p_stats->tx_dropped_pkts);
+  }
+  memset(p_stats, 0, sizeof(*p_stats));
+}
+
 /*******************************************************************************
  *
  * Function         btm_sco_flush_sco_data
  *
  * Description      This function is called to flush the SCO data for this
- *                  channel.
+ *                  channel when it goes down.
  *
  * Returns          void
  *
  ******************************************************************************/
-#if (BTM_SCO_HCI_INCLUDED == TRUE && BTM_MAX_SCO_LINKS > 0)
 void btm_sco_flush_sco_data(uint16_t sco_inx) {
   tSCO_CONN* p;
   BT_HDR* p_buf;
@@ -84,10 +110,20 @@ void btm_sco_flush_sco_data(uint16_t sco_inx) {
     p = &btm_cb.sco_cb.sco_db[sco_inx];
     while ((p_buf = (BT_HDR*)fixed_queue_try_dequeue(p->xmit_data_q)) != NULL)
       osi_free(p_buf);
+    btm_sco_report_data_stats(p);
   }
 }
-}
 #else
+/*******************************************************************************
+ *
+ * Function         btm_sco_flush_sco_data
+ *
+ * Description      This function is called to flush the SCO data for this
+ *                  channel when it goes down.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
 void btm_sco_flush_sco_data(UNUSED_ATTR uint16_t sco_inx) {}
 #endif
 /*******************************************************************************
@@ -269,6 +305,22 @@ void btm_route_sco_data(BT_HDR* p_msg) {
 
   sco_inx = btm_find_scb_by_handle(handle);
   if (sco_inx != BTM_MAX_SCO_LINKS) {
+    tBTM_SCO_DATA_STATS* p_stats = &btm_cb.sco_cb.sco_db[sco_inx].data_stats;
+    switch (pkt_status) {
+      case BTM_SCO_DATA_CORRECT:
+        p_stats->rx_pkts++;
+        break;
+      case BTM_SCO_DATA_PAR_ERR:
+        p_stats->rx_err_pkts++;
+        break;
+      case BTM_SCO_DATA_NONE:
+        p_stats->rx_lost_pkts++;
+        break;
+      default:
+        p_stats->rx_part_lost_pkts++;
+        break;
+    }
+
     /* send data callback */
     if (!btm_cb.sco_cb.p_data_cb)
       /* if no data callback registered,  just free the buffer  */
@@ -320,6 +372,7 @@ tBTM_STATUS BTM_WriteScoData(uint16_t sco_inx, BT_HDR* p_buf) {
       BTM_TRACE_ERROR("BTM SCO - cannot send buffer, offset: %d",
                       p_buf->offset);
       osi_free(p_buf);
+      p_ccb->data_stats.tx_dropped_pkts++;
       status = BTM_ILLEGAL_VALUE;
     } else /* write HCI header */
     {
@@ -340,6 +393,7 @@ tBTM_STATUS BTM_WriteScoData(uint16_t sco_inx, BT_HDR* p_buf) {
       p_buf->len += HCI_SCO_PREAMBLE_SIZE;
 
       fixed_queue_enqueue(p_ccb->xmit_data_q, p_buf);
+      p_ccb->data_stats.tx_pkts++;
 
       btm_sco_check_send_pkts(sco_inx);
     }
@@ -36,6 +36,7 @@
 
 #include "bt_types.h"
 #include "bt_utils.h"
+#include "btif/include/btif_debug_conn.h"
 #include "btif_storage.h"
 #include "btm_int.h"
 #include "btu.h"
@@ -59,6 +60,15 @@ bool(APPL_AUTH_WRITE_EXCEPTION)(const RawAddress& bd_addr);
  ******************************************************************************/
 tBTM_SEC_SERV_REC* btm_sec_find_first_serv(bool is_originator, uint16_t psm);
 static tBTM_SEC_SERV_REC* btm_sec_find_next_serv(tBTM_SEC_SERV_REC* p_cur);
+static void btm_sec_serv_index_rebuild(void);
+
+static_assert(BTM_SEC_MAX_SERVICE_RECORDS < 256,
+              "service record index entries are 8 bit");
+
+/* Hash of a PSM and multiplexer channel in the service record index */
+static inline uint8_t btm_sec_serv_hash(uint16_t psm, uint32_t mx_chan_id) {
+  return (psm ^ (psm >> 8) ^ (mx_chan_id * 7)) & (BTM_SEC_SERV_HASH_SIZE - 1);
+}
 static tBTM_SEC_SERV_REC* btm_sec_find_mx_serv(uint8_t is_originator,
                                                uint16_t psm,
                                                uint32_t mx_proto_id,
@@ -273,6 +283,34 @@ bool BTM_SecRegisterLinkKeyNotificationCallback(
   return true;
 }
 
+/*******************************************************************************
+ *
+ * Function         BTM_SecRegisterDevLoadCallback
+ *
+ * Description      Registers the callback asked to add a bonded device whose
+ *                  keys were not loaded at startup.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTM_SecRegisterDevLoadCallback(tBTM_SEC_DEV_LOAD_CALLBACK* p_callback) {
+  btm_cb.p_dev_load_callback = p_callback;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sec_load_deferred_dev
+ *
+ * Description      Lets the application add the keys of |bda| if it deferred
+ *                  them, before the device record is used.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_sec_load_deferred_dev(const RawAddress& bda) {
+  if (btm_cb.p_dev_load_callback) (*btm_cb.p_dev_load_callback)(bda);
+}
+
 /*******************************************************************************
  *
  * Function         BTM_SecAddRmtNameNotifyCallback
@@ -698,6 +736,7 @@ static bool btm_sec_set_security_level(CONNECTION_TYPE conn_type,
 #endif
 #endif
 
+  btm_sec_serv_index_rebuild();
   return (record_allocated);
 }
 
@@ -738,6 +777,7 @@ uint8_t BTM_SecClrService(uint8_t service_id) {
     }
   }
 
+  if (num_freed) btm_sec_serv_index_rebuild();
   return (num_freed);
 }
 
@@ -772,6 +812,7 @@ uint8_t btm_sec_clr_service_by_psm(uint16_t psm) {
   }
   BTM_TRACE_API("btm_sec_clr_service_by_psm psm:0x%x num_freed:%d", psm,
                 num_freed);
+  if (num_freed) btm_sec_serv_index_rebuild();
 
   return (num_freed);
 }
@@ -2707,6 +2748,7 @@ tBTM_STATUS btm_sec_mx_access_request(const RawAddress& bd_addr, uint16_t psm,
  *
  ******************************************************************************/
 void btm_sec_conn_req(const RawAddress& bda, uint8_t* dc) {
+  btm_sec_load_deferred_dev(bda);
   tBTM_SEC_DEV_REC* p_dev_rec = btm_find_dev(bda);
 
   /* Some device may request a connection before we are done with the HCI_Reset
@@ -4226,6 +4268,7 @@ void btm_sec_encrypt_change(uint16_t handle, uint8_t status,
   if (!p_dev_rec) return;
 
   if ((status == HCI_SUCCESS) && encr_enable) {
+    btif_debug_conn_milestone(p_dev_rec->bd_addr, BTIF_DEBUG_CONN_ENCRYPTED);
     if (p_dev_rec->hci_handle == handle) {
       p_dev_rec->sec_flags |= (BTM_SEC_AUTHENTICATED | BTM_SEC_ENCRYPTED);
       if (p_dev_rec->pin_code_length >= 16 ||
@@ -4391,6 +4434,7 @@ void btm_sec_connected(const RawAddress& bda, uint16_t handle, uint8_t status,
 
   btm_acl_resubmit_page(bda, status == HCI_SUCCESS);
 
+  btm_sec_load_deferred_dev(bda);
   tBTM_SEC_DEV_REC* p_dev_rec = btm_find_dev(bda);
   if (p_dev_rec) {
     VLOG(2) << __func__ << ": Security Manager: in state: "
@@ -4424,7 +4468,7 @@ void btm_sec_connected(const RawAddress& bda, uint16_t handle, uint8_t status,
   } else /* Update the timestamp for this device */
   {
     bit_shift = (handle == p_dev_rec->ble_hci_handle) ? 8 : 0;
-    p_dev_rec->timestamp = btm_cb.dev_rec_count++;
+    btm_sec_dev_rec_touch(p_dev_rec);
     if (p_dev_rec->sm4 & BTM_SM4_CONN_PEND) {
       /* tell L2CAP it's a bonding connection. */
       if ((btm_cb.pairing_state != BTM_PAIR_STATE_IDLE) &&
@@ -4995,6 +5039,7 @@ void btm_sec_link_key_notification(const RawAddress& p_bda,
  *
  ******************************************************************************/
 void btm_sec_link_key_request(const RawAddress& bda) {
+  btm_sec_load_deferred_dev(bda);
   tBTM_SEC_DEV_REC* p_dev_rec = btm_find_or_alloc_dev(bda);
 
   VLOG(2) << __func__ << " bda: " << bda;
@@ -5648,7 +5693,7 @@ bool btm_sec_are_all_trusted(uint32_t p_mask[]) {
  ******************************************************************************/
 tBTM_SEC_SERV_REC* btm_sec_find_first_serv(CONNECTION_TYPE conn_type,
                                            uint16_t psm) {
-  tBTM_SEC_SERV_REC* p_serv_rec = &btm_cb.sec_serv_rec[0];
+  tBTM_SEC_SERV_REC* p_serv_rec;
   int i;
   bool is_originator;
 
@@ -5669,7 +5714,10 @@ tBTM_SEC_SERV_REC* btm_sec_find_first_serv(CONNECTION_TYPE conn_type,
   }
 
   /* otherwise, just find the first record with the specified PSM */
-  for (i = 0; i < BTM_SEC_MAX_SERVICE_RECORDS; i++, p_serv_rec++) {
+  const tBTM_SEC_SERV_INDEX* p_index = &btm_cb.sec_serv_index;
+  for (i = p_index->psm_first[btm_sec_serv_hash(psm, 0)]; i != 0;
+       i = p_index->psm_next[i - 1]) {
+    p_serv_rec = &btm_cb.sec_serv_rec[i - 1];
     if ((p_serv_rec->security_flags & BTM_SEC_IN_USE) &&
         (p_serv_rec->psm == psm))
       return (p_serv_rec);
@@ -5688,10 +5736,13 @@ tBTM_SEC_SERV_REC* btm_sec_find_first_serv(CONNECTION_TYPE conn_type,
  *
  ******************************************************************************/
 static tBTM_SEC_SERV_REC* btm_sec_find_next_serv(tBTM_SEC_SERV_REC* p_cur) {
-  tBTM_SEC_SERV_REC* p_serv_rec = &btm_cb.sec_serv_rec[0];
+  const tBTM_SEC_SERV_INDEX* p_index = &btm_cb.sec_serv_index;
+  tBTM_SEC_SERV_REC* p_serv_rec;
   int i;
 
-  for (i = 0; i < BTM_SEC_MAX_SERVICE_RECORDS; i++, p_serv_rec++) {
+  for (i = p_index->psm_first[btm_sec_serv_hash(p_cur->psm, 0)]; i != 0;
+       i = p_index->psm_next[i - 1]) {
+    p_serv_rec = &btm_cb.sec_serv_rec[i - 1];
     if ((p_serv_rec->security_flags & BTM_SEC_IN_USE) &&
         (p_serv_rec->psm == p_cur->psm)) {
       if (p_cur != p_serv_rec) {
@@ -5717,7 +5768,7 @@ static tBTM_SEC_SERV_REC* btm_sec_find_mx_serv(uint8_t is_originator,
                                                uint32_t mx_proto_id,
                                                uint32_t mx_chan_id) {
   tBTM_SEC_SERV_REC* p_out_serv = btm_cb.p_out_serv;
-  tBTM_SEC_SERV_REC* p_serv_rec = &btm_cb.sec_serv_rec[0];
+  tBTM_SEC_SERV_REC* p_serv_rec;
   int i;
 
   BTM_TRACE_DEBUG("%s()", __func__);
@@ -5729,8 +5780,15 @@ static tBTM_SEC_SERV_REC* btm_sec_find_mx_serv(uint8_t is_originator,
     return btm_cb.p_out_serv;
   }
 
-  /* otherwise, the old way */
-  for (i = 0; i < BTM_SEC_MAX_SERVICE_RECORDS; i++, p_serv_rec++) {
+  /* otherwise, from the chain of the PSM and channel of this direction */
+  const tBTM_SEC_SERV_INDEX* p_index = &btm_cb.sec_serv_index;
+  const uint8_t* p_next =
+      is_originator ? p_index->orig_next : p_index->term_next;
+  uint8_t hash = btm_sec_serv_hash(psm, mx_chan_id);
+  for (i = is_originator ? p_index->orig_first[hash]
+                         : p_index->term_first[hash];
+       i != 0; i = p_next[i - 1]) {
+    p_serv_rec = &btm_cb.sec_serv_rec[i - 1];
     if ((p_serv_rec->security_flags & BTM_SEC_IN_USE) &&
         (p_serv_rec->psm == psm) && (p_serv_rec->mx_proto_id == mx_proto_id) &&
         ((is_originator && (p_serv_rec->orig_mx_chan_id == mx_chan_id)) ||
@@ -5741,6 +5799,40 @@ static tBTM_SEC_SERV_REC* btm_sec_find_mx_serv(uint8_t is_originator,
   return (NULL);
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_sec_serv_index_rebuild
+ *
+ * Description      Rebuild the index of the service records in use, after
+ *                  records were added, changed or removed
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_sec_serv_index_rebuild(void) {
+  tBTM_SEC_SERV_INDEX* p_index = &btm_cb.sec_serv_index;
+
+  memset(p_index, 0, sizeof(tBTM_SEC_SERV_INDEX));
+
+  /* Push the records from the last one, so that chains are in record order */
+  for (int i = BTM_SEC_MAX_SERVICE_RECORDS - 1; i >= 0; i--) {
+    const tBTM_SEC_SERV_REC* p_srec = &btm_cb.sec_serv_rec[i];
+    if (!(p_srec->security_flags & BTM_SEC_IN_USE)) continue;
+
+    uint8_t hash = btm_sec_serv_hash(p_srec->psm, 0);
+    p_index->psm_next[i] = p_index->psm_first[hash];
+    p_index->psm_first[hash] = i + 1;
+
+    hash = btm_sec_serv_hash(p_srec->psm, p_srec->orig_mx_chan_id);
+    p_index->orig_next[i] = p_index->orig_first[hash];
+    p_index->orig_first[hash] = i + 1;
+
+    hash = btm_sec_serv_hash(p_srec->psm, p_srec->term_mx_chan_id);
+    p_index->term_next[i] = p_index->term_first[hash];
+    p_index->term_first[hash] = i + 1;
+  }
+}
+
 /*******************************************************************************
  *
  * Function         btm_sec_collision_timeout
@@ -6226,6 +6318,7 @@ void btm_sec_clear_ble_keys(tBTM_SEC_DEV_REC* p_dev_rec) {
   BTM_TRACE_DEBUG("%s() Clearing BLE Keys", __func__);
   p_dev_rec->ble.key_type = BTM_LE_KEY_NONE;
   memset(&p_dev_rec->ble.keys, 0, sizeof(tBTM_SEC_BLE_KEYS));
+  btm_ble_rpa_cache_invalidate();
 
 #if (BLE_PRIVACY_SPT == TRUE)
   btm_ble_resolving_list_remove_dev(p_dev_rec);
@@ -51,6 +51,7 @@
 #include "l2c_int.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/task_stats.h"
 #include "device/include/device_iot_config.h"
 #include "stack_config.h"
 
@@ -91,7 +92,7 @@ static void btu_hcif_command_status_evt(uint8_t status, BT_HDR* command,
 static void btu_hcif_hardware_error_evt(uint8_t* p);
 static void btu_hcif_flush_occured_evt(void);
 static void btu_hcif_role_change_evt(uint8_t* p);
-static void btu_hcif_num_compl_data_pkts_evt(uint8_t* p);
+static void btu_hcif_num_compl_data_pkts_evt(uint8_t* p, uint8_t evt_len);
 static void btu_hcif_mode_change_evt(uint8_t* p);
 static void btu_hcif_pin_code_request_evt(uint8_t* p);
 static void btu_hcif_link_key_request_evt(uint8_t* p);
@@ -148,7 +149,8 @@ static void do_in_hci_thread(const base::Location& from_here,
     return;
   }
 
-  hci_message_loop->task_runner()->PostTask(from_here, task);
+  hci_message_loop->task_runner()->PostTask(
+      from_here, task_stats_wrap(BTU_MESSAGE_LOOP_NAME, from_here, task));
 }
 
 /*******************************************************************************
@@ -246,7 +248,7 @@ void btu_hcif_process_event(UNUSED_ATTR uint8_t controller_id, BT_HDR* p_msg) {
       btu_hcif_role_change_evt(p);
       break;
     case HCI_NUM_COMPL_DATA_PKTS_EVT:
-      btu_hcif_num_compl_data_pkts_evt(p);
+      btu_hcif_num_compl_data_pkts_evt(p, hci_evt_len);
       break;
     case HCI_MODE_CHANGE_EVT:
       btu_hcif_mode_change_evt(p);
@@ -334,6 +336,15 @@ void btu_hcif_process_event(UNUSED_ATTR uint8_t controller_id, BT_HDR* p_msg) {
       HCI_TRACE_EVENT("BLE HCI(id=%d) event = 0x%02x)", hci_evt_code,
                       ble_sub_code);
 
+      // validate subevent size, as for the events
+      if (ble_sub_code < sizeof(hci_ble_event_parameters_minimum_length) &&
+          hci_evt_len <
+              hci_ble_event_parameters_minimum_length[ble_sub_code]) {
+        HCI_TRACE_WARNING("%s: subevt:0x%2X, malformed event of size %hhd",
+                          __func__, ble_sub_code, hci_evt_len);
+        break;
+      }
+
       uint8_t ble_evt_len = hci_evt_len - 1;
       switch (ble_sub_code) {
         case HCI_BLE_ADV_PKT_RPT_EVT: /* result of inquiry */
@@ -371,7 +382,7 @@ void btu_hcif_process_event(UNUSED_ATTR uint8_t controller_id, BT_HDR* p_msg) {
           break;
 
         case HCI_LE_EXTENDED_ADVERTISING_REPORT_EVT:
-          btm_ble_process_ext_adv_pkt(hci_evt_len, p);
+          btm_ble_process_ext_adv_pkt(ble_evt_len, p);
           break;
 
         case HCI_LE_ADVERTISING_SET_TERMINATED_EVT:
@@ -1443,9 +1454,9 @@ static void btu_hcif_role_change_evt(uint8_t* p) {
  * Returns          void
  *
  ******************************************************************************/
-static void btu_hcif_num_compl_data_pkts_evt(uint8_t* p) {
+static void btu_hcif_num_compl_data_pkts_evt(uint8_t* p, uint8_t evt_len) {
   /* Process for L2CAP and SCO */
-  l2c_link_process_num_completed_pkts(p);
+  l2c_link_process_num_completed_pkts(p, evt_len);
 
   /* Send on to SCO */
   /*?? No SCO for now */
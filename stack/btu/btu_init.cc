@@ -93,6 +93,8 @@ void btu_free_core(void) {
 
   sdp_free();
 
+  smp_key_pool_free();
+
   btm_free();
 }
 
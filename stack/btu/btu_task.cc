@@ -28,14 +28,23 @@
 #include <base/run_loop.h>
 #include <base/threading/thread.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "bt_trace_span.h"
 #include "bta/sys/bta_sys.h"
 #include "btcore/include/module.h"
 #include "bte.h"
 #include "btif/include/btif_common.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
+#include "osi/include/task_stats.h"
 #include "osi/include/thread.h"
+#include "osi/include/time.h"
 #include "stack/btm/btm_int.h"
 #include "stack/include/btu.h"
+#include "stack/include/hcimsgs.h"
 #include "stack/l2cap/l2c_int.h"
 
 static const int THREAD_RT_PRIORITY = 1;
@@ -49,7 +58,105 @@ static base::MessageLoop* message_loop_ = NULL;
 static base::RunLoop* run_loop_ = NULL;
 static thread_t* message_loop_thread_;
 
+/* LE data plane: the ACL data and the link events of the LE links are
+ * processed on a loop of their own, so that a burst of notifications does not
+ * queue up in front of the BR/EDR control traffic. The two loops never run
+ * stack code at the same time: they take turns around each task, in the
+ * order they asked for one. Whatever the LE path hands to BTA is posted to
+ * the main loop by BTA itself. */
+static std::atomic<bool> le_data_enabled;
+static std::atomic<base::MessageLoop*> le_data_loop_;
+static base::RunLoop* le_data_run_loop_ = NULL;
+static thread_t* le_data_thread_;
+
+/* Number of buckets of the items queued on the LE data loop, by handle */
+#define BTU_LE_DATA_BUCKETS 64
+
+/* Handles of the LE links, set and cleared on the HCI thread */
+static std::atomic<uint32_t> le_data_links[(HCI_DATA_HANDLE_MASK + 1) / 32];
+
+/* Items still queued on the LE data loop, by handle bucket. A handle keeps
+ * going to the LE data loop while its bucket is not empty, even once its
+ * link is gone, so that its traffic is never processed out of order. */
+static std::atomic<uint32_t> le_data_queued[BTU_LE_DATA_BUCKETS];
+
+static std::atomic<uint64_t> le_data_acl_count;
+static std::atomic<uint64_t> le_data_evt_count;
+
+typedef struct {
+  const char* name;
+  std::atomic<uint64_t> turns;
+  std::atomic<uint64_t> waits; /* Turns the loop had to wait for */
+  std::atomic<uint64_t> wait_us_total;
+  std::atomic<uint64_t> wait_us_max;
+} tBTU_LOOP_STATS;
+
+static tBTU_LOOP_STATS main_loop_stats = {BTU_MESSAGE_LOOP_NAME, {0}, {0},
+                                          {0}, {0}};
+static tBTU_LOOP_STATS le_data_loop_stats = {BTU_LE_DATA_LOOP_NAME, {0}, {0},
+                                             {0}, {0}};
+
+static std::mutex stack_turn_lock;
+static std::condition_variable stack_turn_cv;
+static uint64_t stack_turn_next;    /* Ticket of the next turn asked for */
+static uint64_t stack_turn_serving; /* Ticket of the turn running */
+static thread_local bool stack_turn_held;
+
+static void btu_take_stack_turn(tBTU_LOOP_STATS* p_stats) {
+  uint64_t start_us = time_get_os_boottime_us();
+  std::unique_lock<std::mutex> lock(stack_turn_lock);
+  uint64_t ticket = stack_turn_next++;
+  bool waited = (ticket != stack_turn_serving);
+  stack_turn_cv.wait(lock, [ticket] { return ticket == stack_turn_serving; });
+  lock.unlock();
+
+  stack_turn_held = true;
+  p_stats->turns++;
+  if (!waited) return;
+
+  uint64_t wait_us = time_get_os_boottime_us() - start_us;
+  p_stats->waits++;
+  p_stats->wait_us_total += wait_us;
+  uint64_t max_us = p_stats->wait_us_max.load();
+  while (wait_us > max_us &&
+         !p_stats->wait_us_max.compare_exchange_weak(max_us, wait_us)) {
+  }
+}
+
+static void btu_give_stack_turn(void) {
+  stack_turn_held = false;
+  {
+    std::lock_guard<std::mutex> lock(stack_turn_lock);
+    stack_turn_serving++;
+  }
+  stack_turn_cv.notify_all();
+}
+
+/* Takes the stack turn around each task of the loop it observes */
+class StackTurnObserver : public base::MessageLoop::TaskObserver {
+ public:
+  explicit StackTurnObserver(tBTU_LOOP_STATS* p_stats) : p_stats_(p_stats) {}
+
+  void WillProcessTask(const base::PendingTask& pending_task) override {
+    btu_take_stack_turn(p_stats_);
+  }
+
+  void DidProcessTask(const base::PendingTask& pending_task) override {
+    btu_give_stack_turn();
+  }
+
+ private:
+  tBTU_LOOP_STATS* p_stats_;
+};
+
 void btu_hci_msg_process(BT_HDR* p_msg) {
+  BT_TRACE_PACKET_END("btu rx queue", p_msg);
+  BT_TRACE_PACKET_SCOPE("btu rx", p_msg);
+  BTU_DCHECK_STACK_TURN();
+  /* Only the LE link traffic is handed to the LE data loop */
+  DCHECK(btu_is_main_thread() ||
+         (p_msg->event & BT_EVT_MASK) == BT_EVT_TO_BTU_HCI_ACL ||
+         (p_msg->event & BT_EVT_MASK) == BT_EVT_TO_BTU_HCI_EVT);
   /* Determine the input message type. */
   switch (p_msg->event & BT_EVT_MASK) {
     case BT_EVT_TO_BTU_HCI_ACL:
@@ -85,10 +192,264 @@ void btu_hci_msg_process(BT_HDR* p_msg) {
 
 base::MessageLoop* get_message_loop() { return message_loop_; }
 
+/*******************************************************************************
+ *
+ * Function         btu_is_main_thread
+ *
+ * Description      Checks if the caller runs on the main BTU loop. Always
+ *                  true while the LE data loop is off.
+ *
+ * Returns          true on the main loop
+ *
+ ******************************************************************************/
+bool btu_is_main_thread(void) {
+  if (!le_data_enabled) return true;
+  return message_loop_ != NULL && base::MessageLoop::current() == message_loop_;
+}
+
+/*******************************************************************************
+ *
+ * Function         btu_is_le_data_thread
+ *
+ * Description      Checks if the caller runs on the LE data loop.
+ *
+ * Returns          true on the LE data loop
+ *
+ ******************************************************************************/
+bool btu_is_le_data_thread(void) {
+  base::MessageLoop* loop = le_data_loop_;
+  return loop != NULL && base::MessageLoop::current() == loop;
+}
+
+/*******************************************************************************
+ *
+ * Function         btu_holds_stack_turn
+ *
+ * Description      Checks if the caller may run stack code: it runs a task of
+ *                  the main loop or of the LE data loop. Always true while
+ *                  the LE data loop is off.
+ *
+ * Returns          true if the caller has the stack turn
+ *
+ ******************************************************************************/
+bool btu_holds_stack_turn(void) { return !le_data_enabled || stack_turn_held; }
+
+static bool btu_le_data_is_link(uint16_t handle) {
+  return (le_data_links[handle / 32].load(std::memory_order_relaxed) >>
+          (handle % 32)) & 1;
+}
+
+static std::atomic<uint32_t>* btu_le_data_bucket(uint16_t handle) {
+  return &le_data_queued[handle % BTU_LE_DATA_BUCKETS];
+}
+
+/* Returns the connection handle an event is about, or HCI_INVALID_HANDLE
+ * for the events not tied to a link. Sets |p_le_link| for a successful LE
+ * connection complete event. */
+static uint16_t btu_le_data_evt_handle(BT_HDR* p_msg, bool* p_le_link) {
+  uint8_t* p = (uint8_t*)(p_msg + 1) + p_msg->offset;
+  uint8_t evt_code, evt_len, sub_code, status;
+  uint16_t handle = HCI_INVALID_HANDLE;
+
+  *p_le_link = false;
+  if (p_msg->len < 5) return HCI_INVALID_HANDLE;
+  STREAM_TO_UINT8(evt_code, p);
+  STREAM_TO_UINT8(evt_len, p);
+  if (evt_len + 2 > p_msg->len || evt_len < 3) return HCI_INVALID_HANDLE;
+
+  switch (evt_code) {
+    case HCI_CONNECTION_COMP_EVT:
+    case HCI_DISCONNECTION_COMP_EVT:
+    case HCI_ENCRYPTION_CHANGE_EVT:
+    case HCI_ENCRYPTION_KEY_REFRESH_COMP_EVT:
+      p++; /* status */
+      STREAM_TO_UINT16(handle, p);
+      break;
+
+    case HCI_BLE_EVENT:
+      STREAM_TO_UINT8(sub_code, p);
+      switch (sub_code) {
+        case HCI_BLE_CONN_COMPLETE_EVT:
+        case HCI_BLE_ENHANCED_CONN_COMPLETE_EVT:
+          if (evt_len < 4) break;
+          STREAM_TO_UINT8(status, p);
+          STREAM_TO_UINT16(handle, p);
+          *p_le_link = (status == HCI_SUCCESS);
+          break;
+
+        case HCI_BLE_LL_CONN_PARAM_UPD_EVT:
+        case HCI_BLE_READ_REMOTE_FEAT_CMPL_EVT:
+        case HCI_BLE_PHY_UPDATE_COMPLETE_EVT:
+          if (evt_len < 4) break;
+          p++; /* status */
+          STREAM_TO_UINT16(handle, p);
+          break;
+
+        case HCI_BLE_LTK_REQ_EVT:
+        case HCI_BLE_RC_PARAM_REQ_EVT:
+        case HCI_BLE_DATA_LENGTH_CHANGE_EVT:
+          STREAM_TO_UINT16(handle, p);
+          break;
+      }
+      break;
+  }
+
+  return (handle == HCI_INVALID_HANDLE) ? handle : HCID_GET_HANDLE(handle);
+}
+
+static void btu_le_data_process(uint16_t handle, BT_HDR* p_msg) {
+  CHECK(btu_is_le_data_thread());
+  btu_hci_msg_process(p_msg);
+  (*btu_le_data_bucket(handle))--;
+}
+
+/*******************************************************************************
+ *
+ * Function         btu_le_data_post
+ *
+ * Description      Posts the ACL data and the link events of an LE link to
+ *                  the LE data loop. The LE links are tracked from the
+ *                  connection and disconnection events seen here, on the HCI
+ *                  thread, so the events of a link stay in order with its
+ *                  data.
+ *
+ * Returns          true if |p_msg| was posted, false if it is for the main
+ *                  loop
+ *
+ ******************************************************************************/
+bool btu_le_data_post(const base::Location& from_here, BT_HDR* p_msg) {
+  base::MessageLoop* loop = le_data_loop_;
+  if (loop == NULL) return false;
+
+  uint16_t handle = HCI_INVALID_HANDLE;
+  bool le_link = false;
+  bool disconnected = false;
+  if ((p_msg->event & BT_EVT_MASK) == BT_EVT_TO_BTU_HCI_ACL) {
+    uint8_t* p = (uint8_t*)(p_msg + 1) + p_msg->offset;
+    if (p_msg->len < HCI_DATA_PREAMBLE_SIZE) return false;
+    STREAM_TO_UINT16(handle, p);
+    handle = HCID_GET_HANDLE(handle);
+  } else if ((p_msg->event & BT_EVT_MASK) == BT_EVT_TO_BTU_HCI_EVT) {
+    handle = btu_le_data_evt_handle(p_msg, &le_link);
+    if (handle == HCI_INVALID_HANDLE) return false;
+    uint8_t* p = (uint8_t*)(p_msg + 1) + p_msg->offset;
+    disconnected = (p[0] == HCI_DISCONNECTION_COMP_EVT && p[2] == HCI_SUCCESS);
+  } else {
+    return false;
+  }
+
+  std::atomic<uint32_t>* p_bucket = btu_le_data_bucket(handle);
+  if (le_link)
+    le_data_links[handle / 32] |= (1u << (handle % 32));
+  else if (!btu_le_data_is_link(handle) && *p_bucket == 0)
+    return false;
+
+  if (disconnected) le_data_links[handle / 32] &= ~(1u << (handle % 32));
+
+  if ((p_msg->event & BT_EVT_MASK) == BT_EVT_TO_BTU_HCI_ACL)
+    le_data_acl_count++;
+  else
+    le_data_evt_count++;
+  (*p_bucket)++;
+  loop->task_runner()->PostTask(
+      from_here, task_stats_wrap(BTU_LE_DATA_LOOP_NAME, from_here,
+                                 base::Bind(&btu_le_data_process, handle,
+                                            p_msg)));
+  return true;
+}
+
+static void btu_le_data_loop_run(UNUSED_ATTR void* context) {
+  base::MessageLoop* loop = new base::MessageLoop();
+  le_data_run_loop_ = new base::RunLoop();
+  StackTurnObserver observer(&le_data_loop_stats);
+  loop->AddTaskObserver(&observer);
+  le_data_loop_ = loop;
+
+  le_data_run_loop_->Run();
+
+  le_data_loop_ = NULL;
+  loop->RemoveTaskObserver(&observer);
+  delete loop;
+
+  delete le_data_run_loop_;
+  le_data_run_loop_ = NULL;
+}
+
+static void btu_le_data_start_up(void) {
+  char value[PROPERTY_VALUE_MAX];
+  osi_property_get(BTU_LE_DATA_THREAD_PROPERTY, value, "false");
+  if (strcmp(value, "true") != 0) return;
+
+  for (auto& links : le_data_links) links = 0;
+  for (auto& queued : le_data_queued) queued = 0;
+
+  le_data_thread_ = thread_new(BTU_LE_DATA_LOOP_NAME);
+  if (!le_data_thread_) {
+    LOG(ERROR) << __func__ << " unable to create the LE data loop thread";
+    return;
+  }
+
+  le_data_enabled = true;
+  thread_set_rt_priority(le_data_thread_, THREAD_RT_PRIORITY);
+  thread_post(le_data_thread_, btu_le_data_loop_run, nullptr);
+}
+
+static void btu_le_data_shut_down(void) {
+  if (le_data_thread_ == NULL) return;
+
+  base::MessageLoop* loop = le_data_loop_;
+  if (loop != NULL && le_data_run_loop_ != NULL)
+    loop->task_runner()->PostTask(FROM_HERE, le_data_run_loop_->QuitClosure());
+
+  /* The packets still queued on the LE data loop are dropped with it */
+  thread_free(le_data_thread_);
+  le_data_thread_ = NULL;
+  le_data_enabled = false;
+}
+
+/*******************************************************************************
+ *
+ * Function         btu_le_data_debug_dump
+ *
+ * Description      Dumps the traffic of the LE data loop and the time each
+ *                  loop waited for its stack turns. The queueing and run
+ *                  times of the two loops are in the task stats.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btu_le_data_debug_dump(int fd) {
+  dprintf(fd, "\nBTU LE Data Loop:\n");
+  dprintf(fd, "  Enabled: %s\n", le_data_enabled ? "true" : "false");
+  if (!le_data_enabled) return;
+
+  int links = 0;
+  for (auto& bits : le_data_links) links += __builtin_popcount(bits.load());
+  dprintf(fd, "  LE links: %d\n", links);
+  dprintf(fd, "  ACL packets: %llu, link events: %llu\n",
+          (unsigned long long)le_data_acl_count.load(),
+          (unsigned long long)le_data_evt_count.load());
+
+  for (tBTU_LOOP_STATS* p_stats : {&main_loop_stats, &le_data_loop_stats}) {
+    uint64_t waits = p_stats->waits;
+    dprintf(fd,
+            "  %s: %llu tasks, %llu waited for their turn (avg %llu us, "
+            "max %llu us)\n",
+            p_stats->name, (unsigned long long)p_stats->turns.load(),
+            (unsigned long long)waits,
+            (unsigned long long)(waits ? p_stats->wait_us_total / waits : 0),
+            (unsigned long long)p_stats->wait_us_max.load());
+  }
+}
+
 void btu_message_loop_run(UNUSED_ATTR void* context) {
   message_loop_ = new base::MessageLoop();
   run_loop_ = new base::RunLoop();
 
+  StackTurnObserver observer(&main_loop_stats);
+  bool take_turns = le_data_enabled;
+  if (take_turns) message_loop_->AddTaskObserver(&observer);
+
   // Inform the bt jni thread initialization is ok.
   message_loop_->task_runner()->PostTask(
       FROM_HERE, base::Bind(base::IgnoreResult(&btif_transfer_context),
@@ -96,6 +457,7 @@ void btu_message_loop_run(UNUSED_ATTR void* context) {
 
   run_loop_->Run();
 
+  if (take_turns) message_loop_->RemoveTaskObserver(&observer);
   delete message_loop_;
   message_loop_ = NULL;
 
@@ -123,7 +485,10 @@ void btu_task_start_up(UNUSED_ATTR void* context) {
    */
   module_init(get_module(BTE_LOGMSG_MODULE));
 
-  message_loop_thread_ = thread_new("btu message loop");
+  /* Before the main loop, which only takes stack turns when it is on */
+  btu_le_data_start_up();
+
+  message_loop_thread_ = thread_new(BTU_MESSAGE_LOOP_NAME);
   if (!message_loop_thread_) {
     LOG(FATAL) << __func__ << " unable to create btu message loop thread.";
   }
@@ -134,6 +499,8 @@ void btu_task_start_up(UNUSED_ATTR void* context) {
 }
 
 void btu_task_shut_down(UNUSED_ATTR void* context) {
+  btu_le_data_shut_down();
+
   // Shutdown message loop on task completed
   if (run_loop_ && message_loop_) {
     message_loop_->task_runner()->PostTask(FROM_HERE, run_loop_->QuitClosure());
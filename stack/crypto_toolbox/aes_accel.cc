@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* AES-128 block encryption using the CPU AES instructions. Key expansion is
+ * left to the portable implementation in aes.cc; only the rounds run here. */
+
+#include "stack/crypto_toolbox/aes_accel.h"
+
+#include <base/logging.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AES_ACCEL_X86
+#include <wmmintrin.h>
+#elif defined(__aarch64__)
+#define AES_ACCEL_ARM64
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_AES
+#define HWCAP_AES (1 << 3)
+#endif
+#endif
+
+namespace crypto_toolbox {
+
+#if defined(AES_ACCEL_X86)
+
+bool aes_128_hw_available() { return __builtin_cpu_supports("aes"); }
+
+__attribute__((target("aes,sse2"))) void aes_128_hw_encrypt(
+    const uint8_t round_keys[AES_128_SCHEDULE_LEN], const uint8_t in[16],
+    uint8_t out[16]) {
+  const __m128i* rk = reinterpret_cast<const __m128i*>(round_keys);
+  __m128i state = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+
+  state = _mm_xor_si128(state, _mm_loadu_si128(&rk[0]));
+  for (int i = 1; i < 10; i++)
+    state = _mm_aesenc_si128(state, _mm_loadu_si128(&rk[i]));
+  state = _mm_aesenclast_si128(state, _mm_loadu_si128(&rk[10]));
+
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), state);
+}
+
+#elif defined(AES_ACCEL_ARM64)
+
+bool aes_128_hw_available() { return getauxval(AT_HWCAP) & HWCAP_AES; }
+
+#if defined(__clang__)
+__attribute__((target("crypto")))
+#else
+__attribute__((target("+crypto")))
+#endif
+void aes_128_hw_encrypt(const uint8_t round_keys[AES_128_SCHEDULE_LEN],
+                        const uint8_t in[16], uint8_t out[16]) {
+  uint8x16_t state = vld1q_u8(in);
+
+  /* AESE does AddRoundKey before SubBytes/ShiftRows, so the first nine rounds
+   * pair AESE with AESMC and the final round key is a plain XOR. */
+  for (int i = 0; i < 9; i++)
+    state = vaesmcq_u8(vaeseq_u8(state, vld1q_u8(round_keys + i * 16)));
+  state = vaeseq_u8(state, vld1q_u8(round_keys + 9 * 16));
+  state = veorq_u8(state, vld1q_u8(round_keys + 10 * 16));
+
+  vst1q_u8(out, state);
+}
+
+#else
+
+bool aes_128_hw_available() { return false; }
+
+void aes_128_hw_encrypt(const uint8_t round_keys[AES_128_SCHEDULE_LEN],
+                        const uint8_t in[16], uint8_t out[16]) {
+  LOG(FATAL) << __func__ << ": no AES instructions on this platform";
+}
+
+#endif
+
+}  // namespace crypto_toolbox
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace crypto_toolbox {
+
+/* Number of bytes in an expanded AES-128 key schedule (11 round keys). */
+#define AES_128_SCHEDULE_LEN 176
+
+/* Returns true if the CPU provides AES instructions (AES-NI on x86, the
+ * ARMv8 Crypto Extensions on arm64) and aes_128_hw_encrypt() may be used. */
+bool aes_128_hw_available();
+
+/* Encrypts the 16 byte block |in| into |out| using the FIPS-197 ordered
+ * expanded key |round_keys|. Both blocks are in FIPS-197 byte order. Must
+ * only be called when aes_128_hw_available() returned true. */
+void aes_128_hw_encrypt(const uint8_t round_keys[AES_128_SCHEDULE_LEN],
+                        const uint8_t in[16], uint8_t out[16]);
+
+}  // namespace crypto_toolbox
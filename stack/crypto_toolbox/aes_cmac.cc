@@ -23,6 +23,7 @@
  ******************************************************************************/
 
 #include "stack/crypto_toolbox/aes.h"
+#include "stack/crypto_toolbox/aes_accel.h"
 #include "stack/crypto_toolbox/crypto_toolbox.h"
 
 #include <base/logging.h>
@@ -56,25 +57,56 @@ static void xor_128(Octet16* a, const Octet16& b) {
     aa[i] = aa[i] ^ bb[i];
   }
 }
+
+/** Returns true if the AES instructions of the CPU are used for the rounds.
+ * Probed once, the answer can't change while we run. */
+bool use_hw_aes() {
+  static const bool available = aes_128_hw_available();
+  return available;
+}
 }  // namespace
 
-/* This function computes AES_128(key, message) */
-Octet16 aes_128(const Octet16& key, const Octet16& message) {
+static_assert(sizeof(Aes128Key::round_keys) == AES_128_SCHEDULE_LEN,
+              "Aes128Key must hold 11 round keys");
+
+/* This function expands |key| into the AES-128 round keys */
+void aes_128_set_key(const Octet16& key, Aes128Key* schedule) {
   Octet16 key_reversed;
+  std::reverse_copy(key.begin(), key.end(), key_reversed.begin());
+
+  aes_context ctx;
+  aes_set_key(key_reversed.data(), key_reversed.size(), &ctx);
+  memcpy(schedule->round_keys, ctx.ksch, AES_128_SCHEDULE_LEN);
+}
+
+/* This function computes AES_128(schedule, message) */
+Octet16 aes_128(const Aes128Key& schedule, const Octet16& message) {
   Octet16 message_reversed;
   Octet16 output;
 
-  std::reverse_copy(key.begin(), key.end(), key_reversed.begin());
   std::reverse_copy(message.begin(), message.end(), message_reversed.begin());
 
-  aes_context ctx;
-  aes_set_key(key_reversed.data(), key_reversed.size(), &ctx);
-  aes_encrypt(message_reversed.data(), output.data(), &ctx);
+  if (use_hw_aes()) {
+    aes_128_hw_encrypt(schedule.round_keys, message_reversed.data(),
+                       output.data());
+  } else {
+    aes_context ctx;
+    memcpy(ctx.ksch, schedule.round_keys, AES_128_SCHEDULE_LEN);
+    ctx.rnd = 10;
+    aes_encrypt(message_reversed.data(), output.data(), &ctx);
+  }
 
   std::reverse(output.begin(), output.end());
   return output;
 }
 
+/* This function computes AES_128(key, message) */
+Octet16 aes_128(const Octet16& key, const Octet16& message) {
+  Aes128Key schedule;
+  aes_128_set_key(key, &schedule);
+  return aes_128(schedule, message);
+}
+
 /** utility function to padding the given text to be a 128 bits data. The
  * parameter dest is input and output parameter, it must point to a
  * OCTET16_LEN memory space; where include length bytes valid data. */
@@ -99,7 +131,7 @@ static void leftshift_onebit(uint8_t* input, uint8_t* output) {
 }
 
 /** This function is the calculation of block cipher using AES-128. */
-static Octet16 cmac_aes_k_calculate(const Octet16& key) {
+static Octet16 cmac_aes_k_calculate(const Aes128Key& key) {
   Octet16 output;
   Octet16 x{0};  // zero initialized
 
@@ -143,9 +175,9 @@ static void cmac_prepare_last_block(const Octet16& k1, const Octet16& k2) {
 }
 
 /** This is the function to generate the two subkeys.
- * |key| is CMAC key, expect SRK when used by SMP.
+ * |key| is the expanded CMAC key, expect SRK when used by SMP.
  */
-static void cmac_generate_subkey(const Octet16& key) {
+static void cmac_generate_subkey(const Aes128Key& key) {
   DVLOG(2) << __func__;
 
   Octet16 zero{};
@@ -203,10 +235,14 @@ Octet16 aes_cmac(const Octet16& key, const uint8_t* input, uint16_t length) {
     cmac_cb.len = 0;
   }
 
+  /* the subkey and every block are encrypted under the same key */
+  Aes128Key schedule;
+  aes_128_set_key(key, &schedule);
+
   /* prepare calculation for subkey s and last block of data */
-  cmac_generate_subkey(key);
+  cmac_generate_subkey(schedule);
   /* start calculation */
-  Octet16 signature = cmac_aes_k_calculate(key);
+  Octet16 signature = cmac_aes_k_calculate(schedule);
 
   /* clean up */
   memset(&cmac_cb, 0, sizeof(tCMAC_CB));
@@ -20,6 +20,15 @@
 
 namespace crypto_toolbox {
 
+/* Expanded AES-128 key schedule. Callers that encrypt several blocks under
+ * the same key (CMAC, IRK resolution) expand it once with aes_128_set_key()
+ * and pass it to aes_128() instead of the raw key. */
+struct Aes128Key {
+  uint8_t round_keys[176];
+};
+
+extern void aes_128_set_key(const Octet16& key, Aes128Key* schedule);
+extern Octet16 aes_128(const Aes128Key& schedule, const Octet16& message);
 extern Octet16 aes_128(const Octet16& key, const Octet16& message);
 extern Octet16 aes_cmac(const Octet16& key, const uint8_t* message,
                         uint16_t length);
@@ -45,6 +54,15 @@ inline Octet16 aes_128(const Octet16& key, const uint8_t* message,
   return aes_128(key, msg);
 }
 
+/* Same as above, with a key schedule from aes_128_set_key(). */
+inline Octet16 aes_128(const Aes128Key& schedule, const uint8_t* message,
+                       const uint8_t length) {
+  CHECK(length <= OCTET16_LEN) << "you tried aes_128 more than 16 bytes!";
+  Octet16 msg{0};
+  std::copy(message, message + length, msg.begin());
+  return aes_128(schedule, msg);
+}
+
 // |tlen| - lenth of mac desired
 // |p_signature| - data pointer to where signed data to be stored, tlen long.
 inline void aes_cmac(const Octet16& key, const uint8_t* message,
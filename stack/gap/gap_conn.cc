@@ -18,6 +18,7 @@
 
 #include <base/strings/stringprintf.h>
 #include <string.h>
+#include "bt_packet.h"
 #include "bt_target.h"
 #include "bt_utils.h"
 #include "btm_int.h"
@@ -576,14 +577,18 @@ uint16_t GAP_ConnWriteData(uint16_t gap_handle, uint8_t* p_data,
   if (p_ccb->con_state != GAP_CCB_STATE_CONNECTED) return (GAP_ERR_BAD_STATE);
 
   while (max_len) {
-    if (p_ccb->cfg.fcr.mode == L2CAP_FCR_ERTM_MODE)
-      p_buf = (BT_HDR*)osi_malloc(L2CAP_FCR_ERTM_BUF_SIZE);
-    else
-      p_buf = (BT_HDR*)osi_malloc(GAP_DATA_BUF_SIZE);
-
-    p_buf->offset = L2CAP_MIN_OFFSET;
-    p_buf->len =
+    uint16_t len =
         (p_ccb->rem_mtu_size < max_len) ? p_ccb->rem_mtu_size : max_len;
+
+    if (p_ccb->transport == BT_TRANSPORT_LE) {
+      /* Leave room for the SDU length, L2CAP sends single PDU SDUs without
+       * a copy then */
+      p_buf = bt_packet_new(L2CAP_LCC_OFFSET, len, 0);
+    } else {
+      /* Leave room for the FCS, L2CAP keeps unsegmented ERTM SDUs for
+       * retransmission without a copy then */
+      p_buf = bt_packet_new(L2CAP_MIN_OFFSET, len, L2CAP_FCS_LEN);
+    }
     p_buf->event = BT_EVT_TO_BTU_SP_DATA;
 
     memcpy((uint8_t*)(p_buf + 1) + p_buf->offset, p_data, p_buf->len);
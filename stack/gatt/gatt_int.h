@@ -29,6 +29,7 @@
 #include <base/strings/stringprintf.h>
 #include <string.h>
 #include <list>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -66,6 +67,22 @@ typedef uint8_t tGATT_SEC_ACTION;
 
 #define GATT_INDEX_INVALID 0xff
 
+/* TCB indexes are one byte in the connection IDs */
+static_assert(GATT_MAX_PHY_CHANNEL < GATT_INDEX_INVALID,
+              "GATT_MAX_PHY_CHANNEL does not fit the connection IDs");
+static_assert(GATT_CL_MAX_LCB < GATT_INDEX_INVALID,
+              "GATT_CL_MAX_LCB does not fit the CLCB indexes");
+
+/* Number of entries in the address-indexed TCB table, a power of two with
+ * room for all the channels */
+#if (GATT_MAX_PHY_CHANNEL <= 8)
+#define GATT_TCB_ADDR_TABLE_SIZE 16
+#elif (GATT_MAX_PHY_CHANNEL <= 32)
+#define GATT_TCB_ADDR_TABLE_SIZE 64
+#else
+#define GATT_TCB_ADDR_TABLE_SIZE 256
+#endif
+
 #define GATT_PENDING_REQ_NONE 0
 
 #define GATT_WRITE_CMD_MASK 0xc0 /*0x1100-0000*/
@@ -79,6 +96,13 @@ typedef uint8_t tGATT_SEC_ACTION;
 #define GATT_WAIT_FOR_DISC_RSP_TIMEOUT_MS (5 * 1000)
 #define GATT_REQ_RETRY_LIMIT 2
 
+/* Answer the prepare writes of the clients in the stack, and pass each run of
+ * contiguous prepared data for one attribute to the application as a single
+ * prepare write, ahead of the execute write request. */
+#ifndef GATT_SR_COALESCE_PREP_WRITE
+#define GATT_SR_COALESCE_PREP_WRITE TRUE
+#endif
+
 /* characteristic descriptor type */
 #define GATT_DESCR_EXT_DSCPTOR 1  /* Characteristic Extended Properties */
 #define GATT_DESCR_USER_DSCPTOR 2 /* Characteristic User Description    */
@@ -218,7 +242,10 @@ typedef struct {
   BT_HDR* p_rsp_msg;
   uint32_t trans_id;
   tGATT_READ_MULTI multi_req;
-  fixed_queue_t* multi_rsp_q;
+  BT_HDR* p_multi_rsp; /* read multiple response being assembled */
+  /* values received ahead of the ones before them */
+  BT_HDR* multi_rsp_early[GATT_MAX_READ_MULTI_HANDLES];
+  uint8_t multi_rsp_next; /* next value to go into p_multi_rsp */
   uint16_t handle;
   uint8_t op_code;
   uint8_t status;
@@ -263,6 +290,24 @@ typedef struct {
   bool is_primary;
 } tGATT_SRV_LIST_ELEM;
 
+/* Entry of the server handle index, one per handle of the started services */
+typedef struct {
+  std::list<tGATT_SRV_LIST_ELEM>::iterator srv; /* owning service, or end() */
+  tGATT_ATTR* p_attr; /* attribute at this handle, NULL if none */
+} tGATT_SR_HDL_INDEX_ELEM;
+
+/* Prepared data of a client for one attribute, not yet passed to the
+ * application. The buffer of a link is allocated on its first prepare write
+ * and reused until the link goes down. */
+typedef struct {
+  tGATT_IF gatt_if; /* application of the attribute, 0 if nothing is held */
+  uint16_t handle;
+  uint16_t offset; /* offset of the first byte held */
+  uint16_t len;
+  bt_gatt_db_attribute_type_t gatt_type;
+  uint8_t value[GATT_MAX_ATTR_LEN];
+} tGATT_SR_PREP_RUN;
+
 typedef struct {
   std::queue<tGATT_CLCB*> pending_enc_clcb; /* pending encryption channel q */
   tGATT_SEC_ACTION sec_act;
@@ -287,6 +332,7 @@ typedef struct {
   alarm_t* conf_timer; /* peer confirm to indication timer */
 
   uint8_t prep_cnt[GATT_MAX_APPS];
+  tGATT_SR_PREP_RUN* p_prep_run; /* prepared data held by the stack */
   uint8_t ind_count;
 
   std::queue<tGATT_CMD_Q> cl_cmd_q;
@@ -355,6 +401,8 @@ typedef struct {
 
 typedef struct {
   tGATT_TCB tcb[GATT_MAX_PHY_CHANNEL];
+  /* TCB index last found for each address and transport, by their hash */
+  uint8_t tcb_by_addr[GATT_TCB_ADDR_TABLE_SIZE];
   fixed_queue_t* sign_op_queue;
 
   uint16_t next_handle;     /* next available handle */
@@ -364,9 +412,19 @@ typedef struct {
   std::list<tGATT_HDL_LIST_ELEM>* hdl_list_info;
   std::list<tGATT_SRV_LIST_ELEM>* srv_list_info;
 
+  /* indexes of the started services' attributes, rebuilt when a service is
+   * started or stopped */
+  std::vector<tGATT_SR_HDL_INDEX_ELEM>* sr_hdl_index; /* by handle */
+  std::unordered_map<bluetooth::Uuid, std::vector<uint16_t>>*
+      sr_type_index; /* sorted handles, by attribute type */
+
   fixed_queue_t* srv_chg_clt_q; /* service change clients queue */
   tGATT_REG cl_rcb[GATT_MAX_APPS];
   tGATT_CLCB clcb[GATT_CL_MAX_LCB]; /* connection link control block*/
+  uint8_t clcb_free[GATT_CL_MAX_LCB]; /* indexes of the free CLCBs */
+  uint8_t clcb_free_count;
+  /* CLCBs in use for each connection ID, by TCB index and gatt_if */
+  uint8_t clcb_count[GATT_MAX_PHY_CHANNEL][GATT_MAX_APPS + 1];
   uint16_t def_mtu_size;
 
 #if (GATT_CONFORMANCE_TESTING == TRUE)
@@ -476,6 +534,8 @@ extern bool gatt_auto_connect_dev_remove(tGATT_IF gatt_if,
 /* server function */
 extern std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle);
+extern tGATT_ATTR* gatt_sr_find_attr_by_handle(uint16_t handle);
+extern void gatt_sr_update_attr_index(void);
 extern tGATT_STATUS gatt_sr_process_app_rsp(tGATT_TCB& tcb, tGATT_IF gatt_if,
                                             uint32_t trans_id, uint8_t op_code,
                                             tGATT_STATUS status,
@@ -505,6 +565,8 @@ extern void gatt_sr_update_cback_cnt(tGATT_TCB& p_tcb, tGATT_IF gatt_if,
                                      bool is_inc, bool is_reset_first);
 extern void gatt_sr_update_prep_cnt(tGATT_TCB& tcb, tGATT_IF gatt_if,
                                     bool is_inc, bool is_reset_first);
+extern void gatt_sr_free_prep_run(tGATT_TCB& tcb);
+extern void gatt_sr_free_multi_rsp(tGATT_TCB& tcb);
 
 extern uint8_t gatt_num_clcb_by_bd_addr(const RawAddress& bda);
 extern tGATT_TCB* gatt_find_tcb_by_cid(uint16_t lcid);
@@ -558,7 +620,7 @@ extern uint16_t gatts_add_characteristic(tGATT_SVC_DB& db, tGATT_PERM perm,
 extern uint16_t gatts_add_char_descr(tGATT_SVC_DB& db, tGATT_PERM perm,
                                      const bluetooth::Uuid& dscp_uuid);
 extern tGATT_STATUS gatts_db_read_attr_value_by_type(
-    tGATT_TCB& tcb, tGATT_SVC_DB* p_db, uint8_t op_code, BT_HDR* p_rsp,
+    tGATT_TCB& tcb, uint8_t op_code, BT_HDR* p_rsp,
     uint16_t s_handle, uint16_t e_handle, const bluetooth::Uuid& type,
     uint16_t* p_len, tGATT_SEC_FLAG sec_flag, uint8_t key_size,
     uint32_t trans_id, uint16_t* p_cur_handle);
@@ -25,6 +25,7 @@
 #include "bt_target.h"
 
 #include "bt_common.h"
+#include "bt_trace_span.h"
 #include "bt_utils.h"
 #include "btif_storage.h"
 #include "btm_ble_int.h"
@@ -103,6 +104,9 @@ void gatt_init(void) {
   VLOG(1) << __func__;
 
   gatt_cb = tGATT_CB();
+  for (int i = 0; i < GATT_CL_MAX_LCB; i++) {
+    gatt_cb.clcb_free[gatt_cb.clcb_free_count++] = GATT_CL_MAX_LCB - 1 - i;
+  }
   connection_manager::reset(true);
   memset(&fixed_reg, 0, sizeof(tL2CAP_FIXED_CHNL_REG));
 
@@ -141,6 +145,9 @@ void gatt_init(void) {
 
   gatt_cb.hdl_list_info = new std::list<tGATT_HDL_LIST_ELEM>();
   gatt_cb.srv_list_info = new std::list<tGATT_SRV_LIST_ELEM>();
+  gatt_cb.sr_hdl_index = new std::vector<tGATT_SR_HDL_INDEX_ELEM>();
+  gatt_cb.sr_type_index =
+      new std::unordered_map<bluetooth::Uuid, std::vector<uint16_t>>();
   gatt_profile_db_init();
 }
 
@@ -173,8 +180,9 @@ void gatt_free(void) {
     alarm_free(gatt_cb.tcb[i].ind_ack_timer);
     gatt_cb.tcb[i].ind_ack_timer = NULL;
 
-    fixed_queue_free(gatt_cb.tcb[i].sr_cmd.multi_rsp_q, NULL);
-    gatt_cb.tcb[i].sr_cmd.multi_rsp_q = NULL;
+    gatt_sr_free_multi_rsp(gatt_cb.tcb[i]);
+
+    gatt_sr_free_prep_run(gatt_cb.tcb[i]);
   }
 
   if (gatt_cb.hdl_list_info != nullptr) {
@@ -188,6 +196,11 @@ void gatt_free(void) {
     delete(gatt_cb.srv_list_info);
     gatt_cb.srv_list_info = nullptr;
   }
+
+  delete gatt_cb.sr_hdl_index;
+  gatt_cb.sr_hdl_index = nullptr;
+  delete gatt_cb.sr_type_index;
+  gatt_cb.sr_type_index = nullptr;
 }
 
 /*******************************************************************************
@@ -910,6 +923,7 @@ static void gatt_send_conn_cback(tGATT_TCB* p_tcb) {
  *
  ******************************************************************************/
 void gatt_data_process(tGATT_TCB& tcb, BT_HDR* p_buf) {
+  BT_TRACE_PACKET_SCOPE("gatt rx", p_buf);
   uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
   uint8_t op_code, pseudo_op_code;
 
@@ -37,6 +37,22 @@
 using base::StringPrintf;
 using bluetooth::Uuid;
 
+/*******************************************************************************
+ *
+ * Function         gatt_sr_is_no_rsp_op
+ *
+ * Description      Checks if the client PDU needs no response from the server:
+ *                  ATT commands and the handle value confirmation. A client
+ *                  may send these while a request is outstanding.
+ *
+ * Returns          true if no response is expected, false otherwise.
+ *
+ ******************************************************************************/
+static bool gatt_sr_is_no_rsp_op(uint8_t op_code) {
+  return (op_code == GATT_CMD_WRITE || op_code == GATT_SIGN_CMD_WRITE ||
+          op_code == GATT_HANDLE_VALUE_CONF);
+}
+
 /*******************************************************************************
  *
  * Function         gatt_sr_enqueue_cmd
@@ -51,11 +67,12 @@ uint32_t gatt_sr_enqueue_cmd(tGATT_TCB& tcb, uint8_t op_code, uint16_t handle) {
   tGATT_SR_CMD* p_cmd = &tcb.sr_cmd;
   uint32_t trans_id = 0;
 
-  if ((p_cmd->op_code == 0) ||
-      (op_code == GATT_HANDLE_VALUE_CONF)) /* no pending request */
+  if (gatt_sr_is_no_rsp_op(op_code)) {
+    /* never waits for a response, so does not take the request slot */
+    trans_id = ++tcb.trans_id;
+  } else if (p_cmd->op_code == 0) /* no pending request */
   {
-    if (op_code == GATT_CMD_WRITE || op_code == GATT_SIGN_CMD_WRITE ||
-        op_code == GATT_REQ_MTU || op_code == GATT_HANDLE_VALUE_CONF) {
+    if (op_code == GATT_REQ_MTU) {
       trans_id = ++tcb.trans_id;
     } else {
       p_cmd->trans_id = ++tcb.trans_id;
@@ -97,123 +114,127 @@ void gatt_dequeue_sr_cmd(tGATT_TCB& tcb) {
     LOG(ERROR) << "free tcb.sr_cmd.p_rsp_msg = " << tcb.sr_cmd.p_rsp_msg;
   osi_free_and_reset((void**)&tcb.sr_cmd.p_rsp_msg);
 
-  while (!fixed_queue_is_empty(tcb.sr_cmd.multi_rsp_q))
-    osi_free(fixed_queue_try_dequeue(tcb.sr_cmd.multi_rsp_q));
-  fixed_queue_free(tcb.sr_cmd.multi_rsp_q, NULL);
+  gatt_sr_free_multi_rsp(tcb);
   memset(&tcb.sr_cmd, 0, sizeof(tGATT_SR_CMD));
 }
 
+/*******************************************************************************
+ *
+ * Function         gatt_sr_free_multi_rsp
+ *
+ * Description      Drops the read multiple response being assembled, and the
+ *                  values held for it.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void gatt_sr_free_multi_rsp(tGATT_TCB& tcb) {
+  tGATT_SR_CMD* p_cmd = &tcb.sr_cmd;
+
+  osi_free_and_reset((void**)&p_cmd->p_multi_rsp);
+  for (uint8_t ii = 0; ii < GATT_MAX_READ_MULTI_HANDLES; ii++)
+    osi_free_and_reset((void**)&p_cmd->multi_rsp_early[ii]);
+  p_cmd->multi_rsp_next = 0;
+}
+
+/* Appends a value to the read multiple response, cut to what the MTU leaves */
+static void multi_rsp_append(BT_HDR* p_buf, const uint8_t* p_value,
+                             uint16_t len, uint16_t mtu) {
+  uint16_t room = (p_buf->len < mtu) ? (mtu - p_buf->len) : 0;
+
+  if (len > room) {
+    /* just send the partial response for the overflow case */
+    VLOG(1) << StringPrintf("multi read overflow available len=%d val_len=%d",
+                            room, len);
+    len = room;
+  }
+  memcpy((uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len, p_value, len);
+  p_buf->len += len;
+}
+
 /*******************************************************************************
  *
  * Function         process_read_multi_rsp
  *
- * Description      This function check the read multiple response.
+ * Description      This function check the read multiple response. Each value
+ *                  is copied to the response as it arrives, in the order of
+ *                  the handles read; only a value that arrives ahead of the
+ *                  ones before it is held until they are in.
  *
  * Returns          bool    if all replies have been received
  *
  ******************************************************************************/
 static bool process_read_multi_rsp(tGATT_SR_CMD* p_cmd, tGATT_STATUS status,
                                    tGATTS_RSP* p_msg, uint16_t mtu) {
-  uint16_t ii, total_len, len;
-  uint8_t* p;
-  bool is_overflow = false;
+  uint16_t num_handles = p_cmd->multi_req.num_handles;
+  uint16_t ii;
 
   VLOG(1) << StringPrintf("%s status=%d mtu=%d", __func__, status, mtu);
 
-  if (p_cmd->multi_rsp_q == NULL)
-    p_cmd->multi_rsp_q = fixed_queue_new(SIZE_MAX);
+  p_cmd->status = status;
+  /* any handle read exception occurs, return error */
+  if (status != GATT_SUCCESS) return (true);
+
+  if (p_cmd->p_multi_rsp == NULL) {
+    BT_HDR* p_buf =
+        (BT_HDR*)osi_malloc(sizeof(BT_HDR) + L2CAP_MIN_OFFSET + mtu);
+    p_buf->offset = L2CAP_MIN_OFFSET;
+    /* First byte in the response is the opcode */
+    *((uint8_t*)(p_buf + 1) + p_buf->offset) = GATT_RSP_READ_MULTI;
+    p_buf->len = 1;
+    p_cmd->p_multi_rsp = p_buf;
+    p_cmd->multi_rsp_next = 0;
+  }
 
-  /* Enqueue the response */
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(sizeof(tGATTS_RSP));
-  memcpy((void*)p_buf, (const void*)p_msg, sizeof(tGATTS_RSP));
-  fixed_queue_enqueue(p_cmd->multi_rsp_q, p_buf);
+  /* The value answers the first handle read with no value yet */
+  for (ii = p_cmd->multi_rsp_next; ii < num_handles; ii++) {
+    if (p_cmd->multi_req.handles[ii] == p_msg->attr_value.handle &&
+        (ii == p_cmd->multi_rsp_next || p_cmd->multi_rsp_early[ii] == NULL))
+      break;
+  }
+  if (ii == num_handles) {
+    p_cmd->status = GATT_NOT_FOUND;
+    return (true);
+  }
 
-  p_cmd->status = status;
-  if (status == GATT_SUCCESS) {
-    VLOG(1) << "Multi read count=" << fixed_queue_length(p_cmd->multi_rsp_q)
-            << " num_hdls=" << p_cmd->multi_req.num_handles;
-    /* Wait till we get all the responses */
-    if (fixed_queue_length(p_cmd->multi_rsp_q) ==
-        p_cmd->multi_req.num_handles) {
-      len = sizeof(BT_HDR) + L2CAP_MIN_OFFSET + mtu;
-      p_buf = (BT_HDR*)osi_calloc(len);
-      p_buf->offset = L2CAP_MIN_OFFSET;
-      p = (uint8_t*)(p_buf + 1) + p_buf->offset;
-
-      /* First byte in the response is the opcode */
-      *p++ = GATT_RSP_READ_MULTI;
-      p_buf->len = 1;
-
-      /* Now walk through the buffers puting the data into the response in order
-       */
-      list_t* list = NULL;
-      const list_node_t* node = NULL;
-      if (!fixed_queue_is_empty(p_cmd->multi_rsp_q))
-        list = fixed_queue_get_list(p_cmd->multi_rsp_q);
-      for (ii = 0; ii < p_cmd->multi_req.num_handles; ii++) {
-        tGATTS_RSP* p_rsp = NULL;
-
-        if (list != NULL) {
-          if (ii == 0)
-            node = list_begin(list);
-          else
-            node = list_next(node);
-          if (node != list_end(list)) p_rsp = (tGATTS_RSP*)list_node(node);
-        }
+  if (ii != p_cmd->multi_rsp_next) {
+    BT_HDR* p_early =
+        (BT_HDR*)osi_malloc(sizeof(BT_HDR) + p_msg->attr_value.len);
+    p_early->offset = 0;
+    p_early->len = p_msg->attr_value.len;
+    memcpy(p_early + 1, p_msg->attr_value.value, p_early->len);
+    p_cmd->multi_rsp_early[ii] = p_early;
+    return (false);
+  }
 
-        if (p_rsp != NULL) {
-          total_len = (p_buf->len + p_rsp->attr_value.len);
-
-          if (total_len > mtu) {
-            /* just send the partial response for the overflow case */
-            len = p_rsp->attr_value.len - (total_len - mtu);
-            is_overflow = true;
-            VLOG(1) << StringPrintf(
-                "multi read overflow available len=%d val_len=%d", len,
-                p_rsp->attr_value.len);
-          } else {
-            len = p_rsp->attr_value.len;
-          }
-
-          if (p_rsp->attr_value.handle == p_cmd->multi_req.handles[ii]) {
-            memcpy(p, p_rsp->attr_value.value, len);
-            if (!is_overflow) p += len;
-            p_buf->len += len;
-          } else {
-            p_cmd->status = GATT_NOT_FOUND;
-            break;
-          }
-
-          if (is_overflow) break;
-
-        } else {
-          p_cmd->status = GATT_NOT_FOUND;
-          break;
-        }
+  multi_rsp_append(p_cmd->p_multi_rsp, p_msg->attr_value.value,
+                   p_msg->attr_value.len, mtu);
+  p_cmd->multi_rsp_next++;
+
+  /* then the values that were waiting for this one */
+  while (p_cmd->multi_rsp_next < num_handles &&
+         p_cmd->multi_rsp_early[p_cmd->multi_rsp_next] != NULL) {
+    BT_HDR* p_early = p_cmd->multi_rsp_early[p_cmd->multi_rsp_next];
+    multi_rsp_append(p_cmd->p_multi_rsp, (uint8_t*)(p_early + 1),
+                     p_early->len, mtu);
+    osi_free_and_reset((void**)&p_cmd->multi_rsp_early[p_cmd->multi_rsp_next]);
+    p_cmd->multi_rsp_next++;
+  }
 
-      } /* loop through all handles*/
+  VLOG(1) << "Multi read count=" << +p_cmd->multi_rsp_next
+          << " num_hdls=" << num_handles;
 
-      /* Sanity check on the buffer length */
-      if (p_buf->len == 0) {
-        LOG(ERROR) << __func__ << " nothing found!!";
-        p_cmd->status = GATT_NOT_FOUND;
-        osi_free(p_buf);
-        VLOG(1) << __func__ << "osi_free(p_buf)";
-      } else if (p_cmd->p_rsp_msg != NULL) {
-        osi_free(p_buf);
-      } else {
-        p_cmd->p_rsp_msg = p_buf;
-      }
+  /* If here, still waiting */
+  if (p_cmd->multi_rsp_next < num_handles) return (false);
 
-      return (true);
-    }
-  } else /* any handle read exception occurs, return error */
-  {
-    return (true);
+  if (p_cmd->p_rsp_msg != NULL) {
+    osi_free_and_reset((void**)&p_cmd->p_multi_rsp);
+  } else {
+    p_cmd->p_rsp_msg = p_cmd->p_multi_rsp;
+    p_cmd->p_multi_rsp = NULL;
   }
 
-  /* If here, still waiting */
-  return (false);
+  return (true);
 }
 
 /*******************************************************************************
@@ -275,6 +296,123 @@ tGATT_STATUS gatt_sr_process_app_rsp(tGATT_TCB& tcb, tGATT_IF gatt_if,
   return ret_code;
 }
 
+#if (GATT_SR_COALESCE_PREP_WRITE == TRUE)
+/*******************************************************************************
+ *
+ * Function         gatt_sr_flush_prep_run
+ *
+ * Description      Passes the prepared data held for the link to its
+ *                  application as one prepare write. No response is expected:
+ *                  the client already has its prepare write responses.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void gatt_sr_flush_prep_run(tGATT_TCB& tcb) {
+  tGATT_SR_PREP_RUN* p_run = tcb.p_prep_run;
+  if (p_run == NULL || p_run->gatt_if == 0) return;
+
+  tGATTS_DATA sr_data;
+  memset(&sr_data, 0, sizeof(tGATTS_DATA));
+  sr_data.write_req.handle = p_run->handle;
+  sr_data.write_req.offset = p_run->offset;
+  sr_data.write_req.len = p_run->len;
+  memcpy(sr_data.write_req.value, p_run->value, p_run->len);
+  sr_data.write_req.is_prep = true;
+  sr_data.write_req.need_rsp = false;
+
+  uint8_t opcode = (p_run->gatt_type == BTGATT_DB_DESCRIPTOR)
+                       ? GATTS_REQ_TYPE_WRITE_DESCRIPTOR
+                       : GATTS_REQ_TYPE_WRITE_CHARACTERISTIC;
+  uint32_t trans_id = gatt_sr_enqueue_cmd(tcb, GATT_CMD_WRITE, p_run->handle);
+  uint16_t conn_id = GATT_CREATE_CONN_ID(tcb.tcb_idx, p_run->gatt_if);
+
+  VLOG(1) << __func__ << " handle: " << +p_run->handle
+          << ", offset: " << +p_run->offset << ", len: " << +p_run->len;
+
+  gatt_sr_send_req_callback(conn_id, trans_id, opcode, &sr_data);
+
+  /* only tells the execute write which applications to call */
+  if (tcb.prep_cnt[p_run->gatt_if - 1] == 0)
+    gatt_sr_update_prep_cnt(tcb, p_run->gatt_if, true, false);
+
+  p_run->gatt_if = 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         gatt_sr_queue_prep_write
+ *
+ * Description      Answers a prepare write request of the client, and holds
+ *                  its data with the data prepared just before it when it
+ *                  continues it: same application, same attribute and the
+ *                  next offset. Otherwise the data held so far is passed to
+ *                  the application first.
+ *
+ * Returns          true if the request is answered, false if it is left to
+ *                  the application.
+ *
+ ******************************************************************************/
+static bool gatt_sr_queue_prep_write(tGATT_TCB& tcb, tGATT_IF gatt_if,
+                                     uint16_t handle, uint16_t offset,
+                                     uint8_t* p_data, uint16_t len,
+                                     bt_gatt_db_attribute_type_t gatt_type) {
+  if (gatt_type != BTGATT_DB_CHARACTERISTIC &&
+      gatt_type != BTGATT_DB_DESCRIPTOR)
+    return false;
+  if (len > GATT_MAX_ATTR_LEN) return false;
+
+  if (tcb.p_prep_run == NULL)
+    tcb.p_prep_run = (tGATT_SR_PREP_RUN*)osi_calloc(sizeof(tGATT_SR_PREP_RUN));
+  tGATT_SR_PREP_RUN* p_run = tcb.p_prep_run;
+
+  if (p_run->gatt_if != 0 &&
+      (p_run->gatt_if != gatt_if || p_run->handle != handle ||
+       p_run->offset + p_run->len != offset ||
+       p_run->len + len > GATT_MAX_ATTR_LEN))
+    gatt_sr_flush_prep_run(tcb);
+
+  if (p_run->gatt_if == 0) {
+    p_run->gatt_if = gatt_if;
+    p_run->handle = handle;
+    p_run->offset = offset;
+    p_run->len = 0;
+    p_run->gatt_type = gatt_type;
+  }
+  if (len != 0) memcpy(p_run->value + p_run->len, p_data, len);
+  p_run->len += len;
+
+  /* the response echoes the request */
+  tGATT_SR_MSG msg;
+  msg.attr_value.handle = handle;
+  msg.attr_value.offset = offset;
+  msg.attr_value.len = len;
+  if (len != 0) memcpy(msg.attr_value.value, p_data, len);
+
+  BT_HDR* p_rsp = attp_build_sr_msg(tcb, GATT_RSP_PREPARE_WRITE, &msg);
+  if (p_rsp == NULL) {
+    gatt_send_error_rsp(tcb, GATT_NO_RESOURCES, GATT_REQ_PREPARE_WRITE, handle,
+                        false);
+    return true;
+  }
+  attp_send_sr_msg(tcb, p_rsp);
+  return true;
+}
+#endif
+
+/*******************************************************************************
+ *
+ * Function         gatt_sr_free_prep_run
+ *
+ * Description      Drops the prepared data held for the link and its buffer.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void gatt_sr_free_prep_run(tGATT_TCB& tcb) {
+  osi_free_and_reset((void**)&tcb.p_prep_run);
+}
+
 /*******************************************************************************
  *
  * Function         gatt_process_exec_write_req
@@ -317,6 +455,12 @@ void gatt_process_exec_write_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
   /* mask the flag */
   flag &= GATT_PREP_WRITE_EXEC;
 
+#if (GATT_SR_COALESCE_PREP_WRITE == TRUE)
+  /* the application gets the last prepared data before the execute or the
+   * cancel, as it would have without the stack holding it */
+  gatt_sr_flush_prep_run(tcb);
+#endif
+
   /* no prep write is queued */
   if (!gatt_sr_is_prep_cnt_zero(tcb)) {
     trans_id = gatt_sr_enqueue_cmd(tcb, op_code, 0);
@@ -410,7 +554,7 @@ void gatt_process_read_multi_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
     trans_id =
         gatt_sr_enqueue_cmd(tcb, op_code, tcb.sr_cmd.multi_req.handles[0]);
     if (trans_id != 0) {
-      gatt_sr_reset_cback_cnt(tcb); /* read multiple use multi_rsp_q's count*/
+      gatt_sr_reset_cback_cnt(tcb); /* read multiple counts its values */
 
       for (ll = 0; ll < tcb.sr_cmd.multi_req.num_handles; ll++) {
         tGATTS_RSP* p_msg = (tGATTS_RSP*)osi_calloc(sizeof(tGATTS_RSP));
@@ -822,25 +966,16 @@ void gatts_process_read_by_type_req(tGATT_TCB& tcb, uint8_t op_code,
   p_msg->len = 2;
   uint16_t buf_len = tcb.payload_size - 2;
 
-  reason = GATT_NOT_FOUND;
-  for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
-    if (el.s_hdl <= e_hdl && el.e_hdl >= s_hdl) {
-      uint8_t sec_flag, key_size;
-      gatt_sr_get_sec_info(tcb.peer_bda, tcb.transport, &sec_flag, &key_size);
-
-      tGATT_STATUS ret = gatts_db_read_attr_value_by_type(
-          tcb, el.p_db, op_code, p_msg, s_hdl, e_hdl, uuid, &buf_len, sec_flag,
-          key_size, 0, &err_hdl);
-      if (ret != GATT_NOT_FOUND) {
-        reason = ret;
-        if (ret == GATT_NO_RESOURCES) reason = GATT_SUCCESS;
-      }
+  uint8_t sec_flag, key_size;
+  gatt_sr_get_sec_info(tcb.peer_bda, tcb.transport, &sec_flag, &key_size);
 
-      if (ret != GATT_SUCCESS && ret != GATT_NOT_FOUND) {
-        s_hdl = err_hdl;
-        break;
-      }
-    }
+  reason = gatts_db_read_attr_value_by_type(tcb, op_code, p_msg, s_hdl, e_hdl,
+                                            uuid, &buf_len, sec_flag, key_size,
+                                            0, &err_hdl);
+  if (reason == GATT_NO_RESOURCES) {
+    reason = GATT_SUCCESS;
+  } else if (reason != GATT_SUCCESS && reason != GATT_NOT_FOUND) {
+    s_hdl = err_hdl;
   }
   *p = (uint8_t)p_msg->offset;
   p_msg->offset = L2CAP_MIN_OFFSET;
@@ -913,6 +1048,13 @@ void gatts_process_write_req(tGATT_TCB& tcb, tGATT_SRV_LIST_ELEM& el,
                                        sr_data.write_req.offset, p, len,
                                        sec_flag, key_size);
 
+#if (GATT_SR_COALESCE_PREP_WRITE == TRUE)
+  if (status == GATT_SUCCESS && op_code == GATT_REQ_PREPARE_WRITE &&
+      gatt_sr_queue_prep_write(tcb, el.gatt_if, handle,
+                               sr_data.write_req.offset, p, len, gatt_type))
+    return;
+#endif
+
   if (status == GATT_SUCCESS) {
     trans_id = gatt_sr_enqueue_cmd(tcb, op_code, handle);
     if (trans_id != 0) {
@@ -1039,32 +1181,26 @@ void gatts_process_attribute_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
 #endif
 
   if (GATT_HANDLE_IS_VALID(handle)) {
-    for (auto& el : *gatt_cb.srv_list_info) {
-      if (el.s_hdl <= handle && el.e_hdl >= handle) {
-        for (const auto& attr : el.p_db->attr_list) {
-          if (attr.handle == handle) {
-            switch (op_code) {
-              case GATT_REQ_READ: /* read char/char descriptor value */
-              case GATT_REQ_READ_BLOB:
-                gatts_process_read_req(tcb, el, op_code, handle, len, p);
-                break;
-
-              case GATT_REQ_WRITE: /* write char/char descriptor value */
-              case GATT_CMD_WRITE:
-              case GATT_SIGN_CMD_WRITE:
-              case GATT_REQ_PREPARE_WRITE:
-                gatts_process_write_req(tcb, el, handle, op_code, len, p,
-                                        attr.gatt_type);
-                break;
-              default:
-                break;
-            }
-            status = GATT_SUCCESS;
-            break;
-          }
-        }
-        break;
+    auto it = gatt_sr_find_i_rcb_by_handle(handle);
+    tGATT_ATTR* p_attr = gatt_sr_find_attr_by_handle(handle);
+    if (it != gatt_cb.srv_list_info->end() && p_attr) {
+      switch (op_code) {
+        case GATT_REQ_READ: /* read char/char descriptor value */
+        case GATT_REQ_READ_BLOB:
+          gatts_process_read_req(tcb, *it, op_code, handle, len, p);
+          break;
+
+        case GATT_REQ_WRITE: /* write char/char descriptor value */
+        case GATT_CMD_WRITE:
+        case GATT_SIGN_CMD_WRITE:
+        case GATT_REQ_PREPARE_WRITE:
+          gatts_process_write_req(tcb, *it, handle, op_code, len, p,
+                                  p_attr->gatt_type);
+          break;
+        default:
+          break;
       }
+      status = GATT_SUCCESS;
     }
   }
 
@@ -1172,13 +1308,12 @@ void gatts_process_value_conf(tGATT_TCB& tcb, uint8_t op_code) {
   if (continue_processing) {
     tGATTS_DATA gatts_data;
     gatts_data.handle = handle;
-    for (auto& el : *gatt_cb.srv_list_info) {
-      if (el.s_hdl <= handle && el.e_hdl >= handle) {
-        uint32_t trans_id = gatt_sr_enqueue_cmd(tcb, op_code, handle);
-        uint16_t conn_id = GATT_CREATE_CONN_ID(tcb.tcb_idx, el.gatt_if);
-        gatt_sr_send_req_callback(conn_id, trans_id, GATTS_REQ_TYPE_CONF,
-                                  &gatts_data);
-      }
+    auto it = gatt_sr_find_i_rcb_by_handle(handle);
+    if (it != gatt_cb.srv_list_info->end()) {
+      uint32_t trans_id = gatt_sr_enqueue_cmd(tcb, op_code, handle);
+      uint16_t conn_id = GATT_CREATE_CONN_ID(tcb.tcb_idx, it->gatt_if);
+      gatt_sr_send_req_callback(conn_id, trans_id, GATTS_REQ_TYPE_CONF,
+                                &gatts_data);
     }
   }
 }
@@ -1186,8 +1321,10 @@ void gatts_process_value_conf(tGATT_TCB& tcb, uint8_t op_code) {
 /** This function is called to handle the client requests to server */
 void gatt_server_handle_client_req(tGATT_TCB& tcb, uint8_t op_code,
                                    uint16_t len, uint8_t* p_data) {
-  /* there is pending command, discard this one */
-  if (!gatt_sr_cmd_empty(tcb) && op_code != GATT_HANDLE_VALUE_CONF) {
+  /* there is pending request, discard this one. Commands and confirmations
+   * need no response, so they are not held behind the application's answer
+   * to the pending request */
+  if (!gatt_sr_cmd_empty(tcb) && !gatt_sr_is_no_rsp_op(op_code)) {
     LOG(ERROR) << __func__ << "Server Command Queue is not empty. Discard this cmd.";
     return;
   }
@@ -26,6 +26,7 @@
 #include "osi/include/osi.h"
 
 #include <string.h>
+#include <algorithm>
 #include "bt_common.h"
 #include "stdio.h"
 
@@ -336,34 +337,45 @@ tGATTS_SRV_CHG* gatt_is_bda_in_the_srv_chg_clt_list(const RawAddress& bda) {
  *
  ******************************************************************************/
 bool gatt_is_bda_connected(const RawAddress& bda) {
-  uint8_t i = 0;
-  bool connected = false;
+  tGATT_TCB* p_le_tcb = gatt_find_tcb_by_addr(bda, BT_TRANSPORT_LE);
+  tGATT_TCB* p_br_tcb = gatt_find_tcb_by_addr(bda, BT_TRANSPORT_BR_EDR);
 
-  for (i = 0; i < GATT_MAX_PHY_CHANNEL; i++) {
-    if (gatt_cb.tcb[i].in_use && gatt_cb.tcb[i].peer_bda == bda) {
-      connected = true;
-      break;
-    }
-  }
-  return connected;
+  return (p_le_tcb && p_le_tcb->in_use) || (p_br_tcb && p_br_tcb->in_use);
+}
+
+/* Returns the entry of the address-indexed TCB table for |bda| */
+static uint8_t* gatt_tcb_addr_entry(const RawAddress& bda,
+                                    tBT_TRANSPORT transport) {
+  uint8_t hash = transport;
+  for (int i = 0; i < BD_ADDR_LEN; i++) hash = hash * 31 + bda.address[i];
+  return &gatt_cb.tcb_by_addr[hash & (GATT_TCB_ADDR_TABLE_SIZE - 1)];
 }
 
 /*******************************************************************************
  *
  * Function         gatt_find_i_tcb_by_addr
  *
- * Description      Search for an empty tcb entry, and return the index.
+ * Description      Search for an empty tcb entry, and return the index. The
+ *                  address-indexed table holds the index found last for the
+ *                  address, it is checked before the tcbs are searched.
  *
  * Returns          GATT_INDEX_INVALID if not found. Otherwise index to the tcb.
  *
  ******************************************************************************/
 uint8_t gatt_find_i_tcb_by_addr(const RawAddress& bda,
                                 tBT_TRANSPORT transport) {
-  uint8_t i = 0;
+  uint8_t* p_entry = gatt_tcb_addr_entry(bda, transport);
+  uint8_t i = *p_entry;
+
+  /* The entry may be stale, it is used only if it still matches */
+  if (i < GATT_MAX_PHY_CHANNEL && gatt_cb.tcb[i].in_use &&
+      gatt_cb.tcb[i].peer_bda == bda && gatt_cb.tcb[i].transport == transport)
+    return i;
 
-  for (; i < GATT_MAX_PHY_CHANNEL; i++) {
+  for (i = 0; i < GATT_MAX_PHY_CHANNEL; i++) {
     if (gatt_cb.tcb[i].peer_bda == bda &&
         gatt_cb.tcb[i].transport == transport) {
+      *p_entry = i;
       return i;
     }
   }
@@ -437,6 +449,7 @@ tGATT_TCB* gatt_allocate_tcb_by_bdaddr(const RawAddress& bda,
     p_tcb->tcb_idx = i;
     p_tcb->transport = transport;
     p_tcb->peer_bda = bda;
+    *gatt_tcb_addr_entry(bda, transport) = i;
     return p_tcb;
   }
 
@@ -652,25 +665,73 @@ void gatt_ind_ack_timeout(void* data) {
   p_tcb->ind_count = 0;
   attp_send_cl_msg(*p_tcb, nullptr, GATT_HANDLE_VALUE_CONF, NULL);
 }
+/*******************************************************************************
+ *
+ * Function         gatt_sr_update_attr_index
+ *
+ * Description      Rebuild the handle and attribute type indexes of the
+ *                  started services. Must be called whenever a service is
+ *                  added to or removed from the service list.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void gatt_sr_update_attr_index(void) {
+  std::vector<tGATT_SR_HDL_INDEX_ELEM>& hdl_index = *gatt_cb.sr_hdl_index;
+  auto end = gatt_cb.srv_list_info->end();
+
+  uint16_t max_hdl = 0;
+  for (const tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info)
+    max_hdl = std::max(max_hdl, el.e_hdl);
+
+  hdl_index.assign(gatt_cb.srv_list_info->empty() ? 0 : max_hdl + 1,
+                   tGATT_SR_HDL_INDEX_ELEM{end, nullptr});
+  gatt_cb.sr_type_index->clear();
+
+  /* the service list is sorted by handle, so is every type bucket */
+  for (auto it = gatt_cb.srv_list_info->begin(); it != end; it++) {
+    for (uint32_t hdl = it->s_hdl; hdl <= it->e_hdl; hdl++)
+      hdl_index[hdl].srv = it;
+
+    if (!it->p_db) continue;
+
+    for (tGATT_ATTR& attr : it->p_db->attr_list) {
+      if (attr.handle < it->s_hdl || attr.handle > it->e_hdl) continue;
+
+      hdl_index[attr.handle].p_attr = &attr;
+      (*gatt_cb.sr_type_index)[attr.uuid].push_back(attr.handle);
+    }
+  }
+}
+
 /*******************************************************************************
  *
  * Description      Search for a service that owns a specific handle.
  *
- * Returns          GATT_MAX_SR_PROFILES if not found. Otherwise the index of
- *                  the service.
+ * Returns          gatt_cb.srv_list_info->end() if not found. Otherwise the
+ *                  service.
  *
  ******************************************************************************/
 std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle) {
-  auto it = gatt_cb.srv_list_info->begin();
+  if (handle >= gatt_cb.sr_hdl_index->size())
+    return gatt_cb.srv_list_info->end();
 
-  for (; it != gatt_cb.srv_list_info->end(); it++) {
-    if (it->s_hdl <= handle && it->e_hdl >= handle) {
-      return it;
-    }
-  }
+  return (*gatt_cb.sr_hdl_index)[handle].srv;
+}
 
-  return it;
+/*******************************************************************************
+ *
+ * Description      Search the started services for the attribute at a
+ *                  specific handle.
+ *
+ * Returns          NULL if not found. Otherwise the attribute.
+ *
+ ******************************************************************************/
+tGATT_ATTR* gatt_sr_find_attr_by_handle(uint16_t handle) {
+  if (handle >= gatt_cb.sr_hdl_index->size()) return nullptr;
+
+  return (*gatt_cb.sr_hdl_index)[handle].p_attr;
 }
 
 /*******************************************************************************
@@ -877,6 +938,11 @@ tGATT_REG* gatt_get_regcb(tGATT_IF gatt_if) {
 bool gatt_is_clcb_allocated(uint16_t conn_id) {
   uint8_t i = 0;
   bool is_allocated = false;
+  uint8_t tcb_idx = GATT_GET_TCB_IDX(conn_id);
+  tGATT_IF gatt_if = GATT_GET_GATT_IF(conn_id);
+
+  if (tcb_idx < GATT_MAX_PHY_CHANNEL && gatt_if <= GATT_MAX_APPS)
+    return gatt_cb.clcb_count[tcb_idx][gatt_if] != 0;
 
   for (i = 0; i < GATT_CL_MAX_LCB; i++) {
     if (gatt_cb.clcb[i].in_use && (gatt_cb.clcb[i].conn_id == conn_id)) {
@@ -899,24 +965,21 @@ bool gatt_is_clcb_allocated(uint16_t conn_id) {
  *
  ******************************************************************************/
 tGATT_CLCB* gatt_clcb_alloc(uint16_t conn_id) {
-  uint8_t i = 0;
   tGATT_CLCB* p_clcb = NULL;
   tGATT_IF gatt_if = GATT_GET_GATT_IF(conn_id);
   uint8_t tcb_idx = GATT_GET_TCB_IDX(conn_id);
   tGATT_TCB* p_tcb = gatt_get_tcb_by_idx(tcb_idx);
   tGATT_REG* p_reg = gatt_get_regcb(gatt_if);
 
-  for (i = 0; i < GATT_CL_MAX_LCB; i++) {
-    if (!gatt_cb.clcb[i].in_use) {
-      p_clcb = &gatt_cb.clcb[i];
+  if (gatt_cb.clcb_free_count == 0) return NULL;
+  p_clcb = &gatt_cb.clcb[gatt_cb.clcb_free[--gatt_cb.clcb_free_count]];
 
-      p_clcb->in_use = true;
-      p_clcb->conn_id = conn_id;
-      p_clcb->p_reg = p_reg;
-      p_clcb->p_tcb = p_tcb;
-      break;
-    }
-  }
+  p_clcb->in_use = true;
+  p_clcb->conn_id = conn_id;
+  p_clcb->p_reg = p_reg;
+  p_clcb->p_tcb = p_tcb;
+  if (tcb_idx < GATT_MAX_PHY_CHANNEL && gatt_if <= GATT_MAX_APPS)
+    gatt_cb.clcb_count[tcb_idx][gatt_if]++;
 
   return p_clcb;
 }
@@ -933,8 +996,14 @@ tGATT_CLCB* gatt_clcb_alloc(uint16_t conn_id) {
  ******************************************************************************/
 void gatt_clcb_dealloc(tGATT_CLCB* p_clcb) {
   if (p_clcb && p_clcb->in_use) {
+    uint8_t tcb_idx = GATT_GET_TCB_IDX(p_clcb->conn_id);
+    tGATT_IF gatt_if = GATT_GET_GATT_IF(p_clcb->conn_id);
+    if (tcb_idx < GATT_MAX_PHY_CHANNEL && gatt_if <= GATT_MAX_APPS)
+      gatt_cb.clcb_count[tcb_idx][gatt_if]--;
+
     alarm_free(p_clcb->gatt_rsp_timer_ent);
     memset(p_clcb, 0, sizeof(tGATT_CLCB));
+    gatt_cb.clcb_free[gatt_cb.clcb_free_count++] = p_clcb - gatt_cb.clcb;
   }
 }
 
@@ -1276,8 +1345,8 @@ void gatt_cleanup_upon_disc(const RawAddress& bda, uint16_t reason,
   alarm_free(p_tcb->conf_timer);
   p_tcb->conf_timer = NULL;
   gatt_free_pending_ind(p_tcb);
-  fixed_queue_free(p_tcb->sr_cmd.multi_rsp_q, NULL);
-  p_tcb->sr_cmd.multi_rsp_q = NULL;
+  gatt_sr_free_multi_rsp(*p_tcb);
+  gatt_sr_free_prep_run(*p_tcb);
 
   for (uint8_t i = 0; i < GATT_MAX_APPS; i++) {
     tGATT_REG* p_reg = &gatt_cb.cl_rcb[i];
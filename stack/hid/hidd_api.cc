@@ -100,6 +100,8 @@ tHID_STATUS HID_DevRegister(tHID_DEV_HOST_CALLBACK* host_cback) {
     osi_free(hd_cb.pending_data);
     hd_cb.pending_data = NULL;
   }
+  hidd_conn_free_held_reports();
+  memset(&hd_cb.rpt_stats, 0, sizeof(hd_cb.rpt_stats));
 
   return (HID_SUCCESS);
 }
@@ -403,6 +405,40 @@ tHID_STATUS HID_DevSendReport(uint8_t channel, uint8_t type, uint8_t id,
   return HID_ERR_INVALID_PARAM;
 }
 
+/*******************************************************************************
+ *
+ * Function         HID_DevSendInputReport
+ *
+ * Description      Sends input report without copying it
+ *
+ * Returns          tHID_STATUS
+ *
+ ******************************************************************************/
+tHID_STATUS HID_DevSendInputReport(uint8_t id, BT_HDR* p_buf,
+                                   uint64_t timestamp_us) {
+  HIDD_TRACE_VERBOSE("%s: id=%d len=%d", __func__, id, p_buf->len);
+
+  if (p_buf->offset < HID_DEV_INPUT_REPORT_OFFSET) {
+    osi_free(p_buf);
+    return HID_ERR_INVALID_PARAM;
+  }
+
+  return hidd_conn_send_input_report(id, p_buf, timestamp_us);
+}
+
+/*******************************************************************************
+ *
+ * Function         HID_DevGetReportStats
+ *
+ * Description      Gets the statistics of the input reports
+ *
+ * Returns          const tHID_DEV_RPT_STATS*
+ *
+ ******************************************************************************/
+const tHID_DEV_RPT_STATS* HID_DevGetReportStats(void) {
+  return &hd_cb.rpt_stats;
+}
+
 /*******************************************************************************
  *
  * Function         HID_DevVirtualCableUnplug
@@ -43,6 +43,7 @@
 #include "hidd_int.h"
 
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 
 static void hidd_l2cif_connect_ind(const RawAddress& bd_addr, uint16_t cid,
                                    uint16_t psm, uint8_t id);
@@ -53,6 +54,8 @@ static void hidd_l2cif_disconnect_ind(uint16_t cid, bool ack_needed);
 static void hidd_l2cif_disconnect_cfm(uint16_t cid, uint16_t result);
 static void hidd_l2cif_data_ind(uint16_t cid, BT_HDR* p_msg);
 static void hidd_l2cif_cong_ind(uint16_t cid, bool congested);
+static void hidd_conn_hold_pending_data(BT_HDR* p_buf);
+static void hidd_conn_send_held_reports(tHID_CONN* p_hcon);
 
 static const tL2CAP_APPL_INFO dev_reg_info = {
     hidd_l2cif_connect_ind,
@@ -516,6 +519,7 @@ static void hidd_l2cif_disconnect_ind(uint16_t cid, bool ack_needed) {
       osi_free(hd_cb.pending_data);
       hd_cb.pending_data = NULL;
     }
+    hidd_conn_free_held_reports();
 
     hd_cb.device.state = HIDD_DEV_NO_CONN;
     p_hcon->conn_state = HID_CONN_STATE_UNUSED;
@@ -599,6 +603,7 @@ static void hidd_l2cif_cong_ind(uint16_t cid, bool congested) {
     p_hcon->conn_flags |= HID_CONN_FLAGS_CONGESTED;
   } else {
     p_hcon->conn_flags &= ~HID_CONN_FLAGS_CONGESTED;
+    hidd_conn_send_held_reports(p_hcon);
   }
 }
 
@@ -863,6 +868,7 @@ tHID_STATUS hidd_conn_disconnect(void) {
     osi_free(hd_cb.pending_data);
     hd_cb.pending_data = NULL;
   }
+  hidd_conn_free_held_reports();
 
   p_hcon = &hd_cb.device.conn;
 
@@ -960,17 +966,7 @@ tHID_STATUS hidd_conn_send_data(uint8_t channel, uint8_t msg_type,
   if (hd_cb.device.state != HIDD_DEV_CONNECTED) {
     // for DATA on intr we hold transfer and try to reconnect
     if (msg_type == HID_TRANS_DATA && cid == p_hcon->intr_cid) {
-      // drop previous data, we do not queue it for now
-      if (hd_cb.pending_data) {
-        osi_free(hd_cb.pending_data);
-      }
-
-      hd_cb.pending_data = p_buf;
-
-      if (hd_cb.device.conn.conn_state == HID_CONN_STATE_UNUSED) {
-        hidd_conn_initiate();
-      }
-
+      hidd_conn_hold_pending_data(p_buf);
       return HID_SUCCESS;
     }
 
@@ -988,3 +984,184 @@ tHID_STATUS hidd_conn_send_data(uint8_t channel, uint8_t msg_type,
 
   return (HID_SUCCESS);
 }
+
+/*******************************************************************************
+ *
+ * Function         hidd_conn_hold_pending_data
+ *
+ * Description      Holds data for the interrupt channel until the host is
+ *                  connected, connecting to it if needed
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void hidd_conn_hold_pending_data(BT_HDR* p_buf) {
+  // drop previous data, we do not queue it for now
+  if (hd_cb.pending_data) {
+    osi_free(hd_cb.pending_data);
+  }
+
+  hd_cb.pending_data = p_buf;
+
+  if (hd_cb.device.conn.conn_state == HID_CONN_STATE_UNUSED) {
+    hidd_conn_initiate();
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         hidd_conn_write_input_report
+ *
+ * Description      Writes input report to the interrupt channel
+ *
+ * Returns          tHID_STATUS
+ *
+ ******************************************************************************/
+static tHID_STATUS hidd_conn_write_input_report(tHID_CONN* p_hcon,
+                                                BT_HDR* p_buf,
+                                                uint64_t timestamp_us) {
+  tHID_DEV_RPT_STATS* p_stats = &hd_cb.rpt_stats;
+  uint64_t latency_us;
+  uint8_t status;
+
+  status = L2CA_DataWrite(p_hcon->intr_cid, p_buf);
+  if (status == L2CAP_DW_FAILED) return (HID_ERR_CONGESTED);
+
+  // hold the following reports until L2CAP reports the channel uncongested
+  if (status == L2CAP_DW_CONGESTED)
+    p_hcon->conn_flags |= HID_CONN_FLAGS_CONGESTED;
+
+  latency_us = time_get_os_boottime_us() - timestamp_us;
+  p_stats->count++;
+  p_stats->total_latency_us += latency_us;
+  if (latency_us > p_stats->max_latency_us)
+    p_stats->max_latency_us = latency_us;
+
+  return (HID_SUCCESS);
+}
+
+/*******************************************************************************
+ *
+ * Function         hidd_conn_hold_input_report
+ *
+ * Description      Holds input report while the interrupt channel is
+ *                  congested. The report replaces the held report of the same
+ *                  ID, the oldest report is dropped when all are in use.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void hidd_conn_hold_input_report(uint8_t id, BT_HDR* p_buf,
+                                        uint64_t timestamp_us) {
+  tHID_DEV_HELD_RPT* p_held = hd_cb.held_rpts;
+  uint8_t xx;
+
+  for (xx = 0; xx < hd_cb.held_rpt_count; xx++) {
+    if (p_held[xx].id == id) break;
+  }
+
+  if (xx < hd_cb.held_rpt_count) {
+    // superseded, the new report is sent in the order of the latest one
+    osi_free(p_held[xx].p_buf);
+    hd_cb.rpt_stats.coalesced_count++;
+  } else if (hd_cb.held_rpt_count == HID_DEV_MAX_HELD_REPORTS) {
+    HIDD_TRACE_WARNING("%s: dropping report id=%d", __func__, p_held[0].id);
+    xx = 0;
+    osi_free(p_held[0].p_buf);
+    hd_cb.rpt_stats.dropped_count++;
+  } else {
+    hd_cb.held_rpt_count++;
+  }
+
+  memmove(&p_held[xx], &p_held[xx + 1],
+          (hd_cb.held_rpt_count - xx - 1) * sizeof(tHID_DEV_HELD_RPT));
+  p_held[hd_cb.held_rpt_count - 1].id = id;
+  p_held[hd_cb.held_rpt_count - 1].p_buf = p_buf;
+  p_held[hd_cb.held_rpt_count - 1].timestamp_us = timestamp_us;
+}
+
+/*******************************************************************************
+ *
+ * Function         hidd_conn_send_held_reports
+ *
+ * Description      Sends the held input reports, oldest first, until the
+ *                  interrupt channel is congested again
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void hidd_conn_send_held_reports(tHID_CONN* p_hcon) {
+  tHID_DEV_HELD_RPT* p_held = hd_cb.held_rpts;
+  uint8_t sent = 0;
+
+  while (sent < hd_cb.held_rpt_count &&
+         !(p_hcon->conn_flags & HID_CONN_FLAGS_CONGESTED)) {
+    hidd_conn_write_input_report(p_hcon, p_held[sent].p_buf,
+                                 p_held[sent].timestamp_us);
+    sent++;
+  }
+
+  hd_cb.held_rpt_count -= sent;
+  memmove(&p_held[0], &p_held[sent],
+          hd_cb.held_rpt_count * sizeof(tHID_DEV_HELD_RPT));
+}
+
+/*******************************************************************************
+ *
+ * Function         hidd_conn_free_held_reports
+ *
+ * Description      Frees the held input reports
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void hidd_conn_free_held_reports(void) {
+  for (uint8_t xx = 0; xx < hd_cb.held_rpt_count; xx++) {
+    osi_free(hd_cb.held_rpts[xx].p_buf);
+  }
+  hd_cb.held_rpt_count = 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         hidd_conn_send_input_report
+ *
+ * Description      Sends input report to host without copying it, holding it
+ *                  while the interrupt channel is congested
+ *
+ * Returns          tHID_STATUS
+ *
+ ******************************************************************************/
+tHID_STATUS hidd_conn_send_input_report(uint8_t id, BT_HDR* p_buf,
+                                        uint64_t timestamp_us) {
+  tHID_CONN* p_hcon = &hd_cb.device.conn;
+  uint8_t* p_out;
+
+  HIDD_TRACE_VERBOSE("%s: id=%d len=%d", __func__, id, p_buf->len);
+
+  // add report id prefix only if non-zero (which is reserved)
+  if (id) {
+    p_buf->offset--;
+    p_buf->len++;
+    p_out = (uint8_t*)(p_buf + 1) + p_buf->offset;
+    *p_out = id;
+  }
+
+  p_buf->offset--;
+  p_buf->len++;
+  p_out = (uint8_t*)(p_buf + 1) + p_buf->offset;
+  *p_out = HID_BUILD_HDR(HID_TRANS_DATA, HID_PAR_REP_TYPE_INPUT);
+
+  // for DATA on intr we hold transfer and try to reconnect
+  if (hd_cb.device.state != HIDD_DEV_CONNECTED) {
+    hidd_conn_hold_pending_data(p_buf);
+    return HID_SUCCESS;
+  }
+
+  if (p_hcon->conn_flags & HID_CONN_FLAGS_CONGESTED) {
+    hidd_conn_hold_input_report(id, p_buf, timestamp_us);
+    return HID_SUCCESS;
+  }
+
+  return hidd_conn_write_input_report(p_hcon, p_buf, timestamp_us);
+}
@@ -45,6 +45,13 @@ typedef struct device_ctb {
   uint8_t idle_time;
 } tHID_DEV_DEV_CTB;
 
+/* input report held while the interrupt channel is congested */
+typedef struct {
+  uint8_t id;
+  BT_HDR* p_buf;
+  uint64_t timestamp_us;
+} tHID_DEV_HELD_RPT;
+
 typedef struct dev_ctb {
   tHID_DEV_DEV_CTB device;
 
@@ -63,6 +70,11 @@ typedef struct dev_ctb {
   BT_HDR* pending_data;
 
   bool pending_vc_unplug;
+
+  tHID_DEV_HELD_RPT held_rpts[HID_DEV_MAX_HELD_REPORTS]; /* oldest first */
+  uint8_t held_rpt_count;
+
+  tHID_DEV_RPT_STATS rpt_stats;
 } tHID_DEV_CTB;
 
 extern tHID_STATUS hidd_conn_reg(void);
@@ -72,6 +84,9 @@ extern tHID_STATUS hidd_conn_disconnect(void);
 extern tHID_STATUS hidd_conn_send_data(uint8_t channel, uint8_t msg_type,
                                        uint8_t param, uint8_t data,
                                        uint16_t len, uint8_t* p_data);
+extern tHID_STATUS hidd_conn_send_input_report(uint8_t id, BT_HDR* p_buf,
+                                               uint64_t timestamp_us);
+extern void hidd_conn_free_held_reports(void);
 
 #ifdef __cplusplus
 extern "C" {
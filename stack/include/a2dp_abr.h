@@ -0,0 +1,66 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Adaptive bit rate control for the A2DP source encoders without a vendor
+// ABR library (SBC and AAC).
+//
+
+#ifndef A2DP_ABR_H
+#define A2DP_ABR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of quality steps below the configured bit rate
+#define A2DP_ABR_MAX_LEVEL 4
+
+typedef struct {
+  uint8_t level;          // Current quality step, 0 is the configured rate
+  uint16_t good_ticks;    // Ticks with a short TX queue since the last step
+  uint16_t hold_ticks;    // Ticks left before the next step down
+  uint32_t link_events;   // Link quality events already acted on
+  size_t step_downs;      // Decisions lowering the bit rate
+  size_t step_ups;        // Decisions raising the bit rate
+  size_t link_step_downs; // Step downs caused by the link quality
+  size_t max_queue_length;
+} tA2DP_ABR;
+
+// Resets |p_abr| to the configured bit rate.
+void a2dp_abr_reset(tA2DP_ABR* p_abr);
+
+// Runs one encoder tick of |p_abr| with the TX queue holding
+// |transmit_queue_length| packets.
+// Returns true if the quality step has changed.
+bool a2dp_abr_update(tA2DP_ABR* p_abr, size_t transmit_queue_length);
+
+// Scales the configured |value| (bitpool or bit rate) to the current quality
+// step of |p_abr|.
+uint32_t a2dp_abr_scale(const tA2DP_ABR* p_abr, uint32_t value);
+
+// Reports the RSSI of the streaming link, as read by HCI_Read_RSSI.
+void a2dp_abr_report_rssi(int8_t rssi);
+
+// Reports the Failed Contact Counter of the streaming link.
+void a2dp_abr_report_failed_contact_counter(uint16_t failed_contact_counter);
+
+// Reports that the controller found the streaming link degraded.
+void a2dp_abr_report_link_degraded(void);
+
+// Dumps the decisions of |p_abr| to |fd|.
+void a2dp_abr_debug_dump(const tA2DP_ABR* p_abr, int fd);
+
+#endif  // A2DP_ABR_H
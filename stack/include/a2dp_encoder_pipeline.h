@@ -0,0 +1,144 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Encoder pipeline shared by the A2DP source encoders: PCM staging, the
+// frame scheduler, the packetizer and the statistics. A codec plugs in with
+// a callback encoding one PCM frame.
+//
+
+#ifndef A2DP_ENCODER_PIPELINE_H
+#define A2DP_ENCODER_PIPELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "a2dp_codec_api.h"
+#include "bt_target.h"
+
+// Size of the PCM staging buffer, the largest PCM frame of a codec
+#ifndef A2DP_ENCODER_PCM_STAGING_SIZE
+#define A2DP_ENCODER_PCM_STAGING_SIZE BT_DEFAULT_BUFFER_SIZE
+#endif
+
+// What a codec produced from one PCM frame
+typedef struct {
+  uint32_t bytes;    // Encoded bytes, 0 if the codec kept the frame for later
+  uint16_t frames;   // Media frames completed, counted in layer_specific
+  uint32_t samples;  // RTP timestamp units the encoded bytes stand for
+} tA2DP_ENCODED_FRAME;
+
+// Encodes the PCM frame |p_pcm| to |p_out|, of |out_size| bytes at most.
+// Returns false on an encoding error, the packet is then dropped.
+typedef bool (*tA2DP_ENCODE_FRAME_CBACK)(const uint8_t* p_pcm, uint8_t* p_out,
+                                         uint32_t out_size,
+                                         tA2DP_ENCODED_FRAME* p_encoded);
+
+// Fills |p_pcm| with the next PCM frame of a codec converting its feeding.
+// |p_bytes_read| is the number of feeding bytes read.
+// Returns false if there is not enough PCM for a frame.
+typedef bool (*tA2DP_READ_FRAME_CBACK)(uint8_t* p_pcm, uint32_t* p_bytes_read);
+
+typedef struct {
+  uint64_t session_start_us;
+
+  size_t media_read_total_expected_packets;
+  size_t media_read_total_expected_reads_count;
+  size_t media_read_total_expected_read_bytes;
+
+  size_t media_read_total_dropped_packets;
+  size_t media_read_total_actual_reads_count;
+  size_t media_read_total_actual_read_bytes;
+
+  size_t media_read_total_expected_frames;
+  size_t media_read_total_dropped_frames;
+
+  size_t encode_total_frames;  // PCM frames given to the codec
+  size_t encode_total_bytes;   // Encoded bytes the codec produced
+  uint64_t encode_total_us;    // Time spent in the codec
+  uint64_t encode_max_us;      // Longest encoding of a frame
+} tA2DP_ENCODER_STATS;
+
+typedef struct {
+  // Set by the codec
+  a2dp_source_read_callback_t read_callback;
+  a2dp_source_enqueue_callback_t enqueue_callback;
+  tA2DP_ENCODE_FRAME_CBACK encode_frame;
+  tA2DP_READ_FRAME_CBACK read_frame;  // NULL to read the feeding as it is
+  uint32_t pcm_bytes_per_frame;       // Feeding bytes of a PCM frame
+  uint16_t buffer_size;               // Size of a packet buffer
+  uint16_t offset;                    // Offset of the media payload
+  uint16_t mtu;                       // 0 if the packets are not limited
+  uint8_t max_frames;                 // PCM frames of a packet, 0 if any
+  bool close_on_output;  // A packet ends with the first encoded bytes
+  bool codec_buffers;    // An empty packet is not a drop, the codec buffers
+  uint8_t enqueue_frames;  // Frames reported per packet, 0 for its PCM frames
+
+  // Frame scheduler
+  uint32_t counter;         // PCM bytes due and not encoded yet
+  uint32_t bytes_per_tick;  // PCM bytes read each media task tick
+  uint32_t interval_ms;     // Media task tick
+  uint64_t last_frame_timestamp_100ns;  // values in 1/10 microseconds
+
+  uint32_t timestamp;  // RTP timestamp of the next packet
+  tA2DP_ENCODER_STATS stats;
+
+  // One PCM frame, as the codec reads it
+  alignas(uint32_t) uint8_t pcm[A2DP_ENCODER_PCM_STAGING_SIZE];
+} tA2DP_ENCODER_PIPELINE;
+
+// Clears |p_pipeline| and starts a new session reading with |read_callback|
+// and enqueueing with |enqueue_callback|. The codec then sets the other
+// parameters.
+void a2dp_encoder_pipeline_init(
+    tA2DP_ENCODER_PIPELINE* p_pipeline,
+    a2dp_source_read_callback_t read_callback,
+    a2dp_source_enqueue_callback_t enqueue_callback);
+
+// Restarts the scheduler of |p_pipeline| for a feeding of |p_feeding_params|
+// read every |interval_ms|.
+void a2dp_encoder_pipeline_reset(tA2DP_ENCODER_PIPELINE* p_pipeline,
+                                 const tA2DP_FEEDING_PARAMS* p_feeding_params,
+                                 uint32_t interval_ms);
+
+// Adds the PCM bytes due since the previous tick to the scheduler of
+// |p_pipeline|, for the tick at |timestamp_us|.
+// Returns the number of PCM frames due, still counted in the scheduler.
+uint32_t a2dp_encoder_pipeline_tick(tA2DP_ENCODER_PIPELINE* p_pipeline,
+                                    uint64_t timestamp_us);
+
+// Runs the tick at |timestamp_us| and takes every PCM frame due.
+// Returns the number of PCM frames to encode.
+uint32_t a2dp_encoder_pipeline_schedule(tA2DP_ENCODER_PIPELINE* p_pipeline,
+                                        uint64_t timestamp_us);
+
+// Reads the next PCM frame of the feeding of |p_pipeline| to |p_pcm|, of
+// |pcm_bytes_per_frame| bytes, padded with silence. |p_bytes_read| is the
+// number of feeding bytes read.
+// Returns false if there is no PCM left.
+bool a2dp_encoder_pipeline_read_pcm(tA2DP_ENCODER_PIPELINE* p_pipeline,
+                                    uint8_t* p_pcm, uint32_t* p_bytes_read);
+
+// Reads, encodes and enqueues |nb_frame| PCM frames through |p_pipeline|.
+// The frames not read for lack of PCM are given back to the scheduler.
+void a2dp_encoder_pipeline_encode(tA2DP_ENCODER_PIPELINE* p_pipeline,
+                                  uint32_t nb_frame);
+
+// Dumps the statistics of |p_pipeline| to |fd|.
+void a2dp_encoder_pipeline_debug_dump(const tA2DP_ENCODER_PIPELINE* p_pipeline,
+                                      int fd);
+
+#endif  // A2DP_ENCODER_PIPELINE_H
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// ACL packet type and automatic flush timeout policy of the A2DP source link.
+// A link that keeps retransmitting goes robust: no 5 slot and no 3 Mbps
+// packets, which are the first to fail on a noisy channel, and a finite flush
+// timeout so that stale media is dropped instead of stalling the queue. The
+// link goes back to what it used after a long good period.
+//
+
+#ifndef A2DP_LINK_POLICY_H
+#define A2DP_LINK_POLICY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hcidefs.h"
+
+// Packet types excluded from a robust link, on top of what it already uses
+#define A2DP_LINK_POLICY_ROBUST_NO_PKT_TYPES                   \
+  (HCI_PKT_TYPES_MASK_NO_3_DH1 | HCI_PKT_TYPES_MASK_NO_3_DH3 | \
+   HCI_PKT_TYPES_MASK_NO_3_DH5 | HCI_PKT_TYPES_MASK_NO_2_DH5)
+#define A2DP_LINK_POLICY_ROBUST_PKT_TYPES_CLEARED \
+  (HCI_PKT_TYPES_MASK_DM5 | HCI_PKT_TYPES_MASK_DH5)
+
+// Automatic flush timeout (in ms) of a robust link, 0 to leave it alone
+#ifndef A2DP_LINK_POLICY_ROBUST_FLUSH_TO_MS
+#define A2DP_LINK_POLICY_ROBUST_FLUSH_TO_MS 100
+#endif
+
+typedef struct {
+  bool robust;            // The link uses the robust packet types
+  uint16_t busy_ticks;    // Ticks in a row with a long TX queue
+  uint16_t good_ticks;    // Ticks with a short TX queue since the last change
+  uint16_t hold_ticks;    // Ticks left before going back to normal
+  uint32_t link_events;   // Failed contact reports already acted on
+  size_t to_robust;       // Changes to the robust packet types
+  size_t to_normal;       // Changes back to the normal packet types
+  size_t link_to_robust;  // Changes to robust caused by failed contacts
+} tA2DP_LINK_POLICY;
+
+// Resets |p_policy| to the normal packet types.
+void a2dp_link_policy_reset(tA2DP_LINK_POLICY* p_policy);
+
+// Runs one encoder tick of |p_policy| with the TX queue holding
+// |transmit_queue_length| packets.
+// Returns true if the link must change to or from the robust packet types.
+bool a2dp_link_policy_update(tA2DP_LINK_POLICY* p_policy,
+                             size_t transmit_queue_length);
+
+// Reports the Failed Contact Counter of the streaming link.
+void a2dp_link_policy_report_failed_contact_counter(
+    uint16_t failed_contact_counter);
+
+// Reports that the controller found the streaming link degraded.
+void a2dp_link_policy_report_link_degraded(void);
+
+// Returns the packet types of a robust link using |pkt_types| when normal.
+uint16_t a2dp_link_policy_robust_pkt_types(uint16_t pkt_types);
+
+// Dumps the decisions of |p_policy| to |fd|.
+void a2dp_link_policy_debug_dump(const tA2DP_LINK_POLICY* p_policy, int fd);
+
+#endif  // A2DP_LINK_POLICY_H
@@ -0,0 +1,90 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This is the interface to the polyphase FIR resampler that converts the
+ *  audio feeding to the SBC sampling frequency.
+ *
+ ******************************************************************************/
+#ifndef A2DP_SBC_RESAMPLER_H
+#define A2DP_SBC_RESAMPLER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*******************************************************************************
+ *
+ * Function         a2dp_sbc_resampler_init
+ *
+ * Description      Initializes the resampler and clears its history.
+ *
+ *                  src_sps: samples per second (source audio data)
+ *                  dst_sps: samples per second (converted audio data)
+ *                  bits: number of bits per source pcm sample (8, 16, 24 or
+ *                        32, 24 bit samples are packed in 3 bytes)
+ *                  src_channels: number of source channels (1 or 2)
+ *                  dst_channels: number of converted channels (1 or 2)
+ *
+ * Returns          true if the conversion is supported, false otherwise
+ *
+ ******************************************************************************/
+bool a2dp_sbc_resampler_init(uint32_t src_sps, uint32_t dst_sps, uint8_t bits,
+                             uint8_t src_channels, uint8_t dst_channels);
+
+/*******************************************************************************
+ *
+ * Function         a2dp_sbc_resampler_input_frames
+ *
+ * Description      Computes the number of source frames that make the next
+ *                  a2dp_sbc_resampler_process call produce at least
+ *                  dst_frames frames. It produces fewer than dst_frames +
+ *                  src_sps / dst_sps + 1 frames.
+ *
+ * Returns          number of source frames
+ *
+ ******************************************************************************/
+uint32_t a2dp_sbc_resampler_input_frames(uint32_t dst_frames);
+
+/*******************************************************************************
+ *
+ * Function         a2dp_sbc_resampler_process
+ *
+ * Description      Converts src_frames frames of source audio data to 16 bit
+ *                  pcm samples. All of the source frames are consumed, the
+ *                  converted frames after dst_frames_max are dropped.
+ *
+ * Returns          number of frames written to p_dst
+ *
+ ******************************************************************************/
+uint32_t a2dp_sbc_resampler_process(const void* p_src, uint32_t src_frames,
+                                    int16_t* p_dst, uint32_t dst_frames_max);
+
+/*******************************************************************************
+ *
+ * Function         a2dp_sbc_resampler_allow_simd
+ *
+ * Description      Allows the vectorized filter from the next
+ *                  a2dp_sbc_resampler_init on.
+ *
+ * Returns          true if the vectorized filter is built in
+ *
+ ******************************************************************************/
+bool a2dp_sbc_resampler_allow_simd(bool allow);
+
+#endif /* A2DP_SBC_RESAMPLER_H */
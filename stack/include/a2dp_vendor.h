@@ -201,6 +201,11 @@ const char* A2DP_VendorCodecIndexStr(btav_a2dp_codec_index_t codec_index);
 bool A2DP_VendorInitCodecConfig(btav_a2dp_codec_index_t codec_index,
                                 tAVDT_CFG* p_cfg);
 
+// Loads the A2DP vendor encoder libraries on the stack's thread pool, ahead of
+// the codecs being enumerated, so enabling A2DP and starting the first stream
+// don't wait on dlopen(). Loading again later is then immediate.
+void A2DP_VendorPreloadEncoders(void);
+
 // Decodes and displays A2DP vendor codec info when using |LOG_DEBUG|.
 // |p_codec_info| is a pointer to the codec_info to decode and display.
 // Returns true if the codec information is valid, otherwise false.
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <stdint.h>
+
 #include <array>
 #include <vector>
 
@@ -140,4 +142,65 @@ class AdvertiseDataParser {
                                        uint8_t type, uint8_t* p_length) {
     return GetFieldByType(ad.data(), ad.size(), type, p_length);
   }
+
+  /**
+   * Index of the fields of an advertising data, built in a single pass. Use it
+   * instead of GetFieldByType when looking up several field types in the same
+   * data. The indexed data must outlive the index.
+   */
+  class FieldIndex {
+   public:
+    FieldIndex(const uint8_t* ad, size_t ad_len) : ad_(ad) {
+      present_.fill(0);
+
+      size_t position = 0;
+      while (position < ad_len) {
+        uint8_t len = ad[position];
+
+        if (len == 0) break;
+        if (position + len >= ad_len) break;
+        if (position + 2 > UINT16_MAX) break;
+
+        uint8_t adv_type = ad[position + 1];
+
+        /* keep the first field of each type, like GetFieldByType */
+        if (!IsPresent(adv_type)) {
+          present_[adv_type / 64] |= 1ULL << (adv_type % 64);
+          offset_[adv_type] = position + 2;
+          length_[adv_type] = len - 1; /* minus the length of type */
+        }
+
+        position += len + 1; /* skip the length of data */
+      }
+    }
+
+    explicit FieldIndex(std::vector<uint8_t> const& ad)
+        : FieldIndex(ad.data(), ad.size()) {}
+
+    /**
+     * Returns a pointer inside the indexed data where a field of |type| is
+     * located, together with its length in |p_length|
+     */
+    const uint8_t* GetFieldByType(uint8_t type, uint8_t* p_length) const {
+      if (!IsPresent(type)) {
+        *p_length = 0;
+        return NULL;
+      }
+
+      *p_length = length_[type];
+      return ad_ + offset_[type];
+    }
+
+   private:
+    bool IsPresent(uint8_t type) const {
+      return present_[type / 64] & (1ULL << (type % 64));
+    }
+
+    const uint8_t* ad_;
+    /* bit per field type, offset_ and length_ are only set for present types
+     * so that indexing a short advertisement stays cheap */
+    std::array<uint64_t, 4> present_;
+    std::array<uint16_t, 256> offset_;
+    std::array<uint8_t, 256> length_;
+  };
 };
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Reference counted BT_HDR packets.
+//
+// A packet from |bt_packet_new| is a BT_HDR served from the buffer pool, so
+// it can be shared instead of copied: |bt_packet_ref| adds a holder, and every
+// holder releases the packet with osi_free() like any other BT_HDR. The
+// layers below do not need to know a packet is shared.
+//
+// The BT_HDR fields are shared with the payload, so only the holder sending
+// the packet may change them; the other holders keep their own offset and
+// length of the payload aside. The sender may write its headers in the
+// headroom before the payload and its trailer in the tailroom after it, but
+// must call |bt_packet_unshare| before writing over the payload.
+//
+
+#pragma once
+
+#include <string.h>
+
+#include "bt_types.h"
+#include "osi/include/allocator.h"
+
+// Returns a new packet of |len| payload bytes at |headroom|, with room for
+// |tailroom| bytes after the payload.
+inline BT_HDR* bt_packet_new(uint16_t headroom, uint16_t len,
+                             uint16_t tailroom) {
+  BT_HDR* p_pkt =
+      (BT_HDR*)osi_pool_malloc(BT_HDR_SIZE + headroom + len + tailroom);
+  p_pkt->event = 0;
+  p_pkt->len = len;
+  p_pkt->offset = headroom;
+  p_pkt->layer_specific = 0;
+  return p_pkt;
+}
+
+// Adds a holder to |p_pkt|. Returns |p_pkt|, or NULL if it was not allocated
+// from the pool and must be copied instead.
+inline BT_HDR* bt_packet_ref(BT_HDR* p_pkt) {
+  return (BT_HDR*)osi_ref(p_pkt);
+}
+
+// Returns true if |p_pkt| has more than one holder.
+inline bool bt_packet_is_shared(const BT_HDR* p_pkt) {
+  return osi_is_shared(p_pkt);
+}
+
+// Returns the number of bytes that may be written after the payload of
+// |p_pkt|, 0 if that is not known.
+inline uint16_t bt_packet_tailroom(const BT_HDR* p_pkt) {
+  size_t capacity = osi_pool_capacity(p_pkt);
+  size_t used = BT_HDR_SIZE + p_pkt->offset + p_pkt->len;
+  if (capacity <= used) return 0;
+  return (capacity - used > UINT16_MAX) ? UINT16_MAX : capacity - used;
+}
+
+// Returns a copy of the payload of |p_pkt| at |headroom|, with room for
+// |tailroom| bytes after it. The other BT_HDR fields are copied as well.
+inline BT_HDR* bt_packet_copy(const BT_HDR* p_pkt, uint16_t headroom,
+                              uint16_t tailroom) {
+  BT_HDR* p_copy = bt_packet_new(headroom, p_pkt->len, tailroom);
+  p_copy->event = p_pkt->event;
+  p_copy->layer_specific = p_pkt->layer_specific;
+  memcpy(p_copy->data + headroom, p_pkt->data + p_pkt->offset, p_pkt->len);
+  return p_copy;
+}
+
+// Returns |p_pkt| if it has no other holder. Otherwise releases it and returns
+// a copy with the same headroom and tailroom that can be written freely.
+inline BT_HDR* bt_packet_unshare(BT_HDR* p_pkt) {
+  if (!bt_packet_is_shared(p_pkt)) return p_pkt;
+
+  BT_HDR* p_copy =
+      bt_packet_copy(p_pkt, p_pkt->offset, bt_packet_tailroom(p_pkt));
+  osi_free(p_pkt);
+  return p_copy;
+}
@@ -580,8 +580,9 @@ extern tBTM_STATUS BTM_SetPageScanType(uint16_t scan_type);
  *
  * Returns
  *                  BTM_CMD_STARTED is returned if the request was successfully
- *                                  sent to HCI.
- *                  BTM_BUSY if already in progress
+ *                                  sent to HCI, queued behind the one in
+ *                                  progress or answered from the name cache.
+ *                  BTM_BUSY if too many requests are already queued
  *                  BTM_UNKNOWN_ADDR if device address is bad
  *                  BTM_NO_RESOURCES if resources could not be allocated to
  *                                   start the command
@@ -785,6 +786,32 @@ extern tBTM_STATUS BTM_SetLinkPolicy(const RawAddress& remote_bda,
  ******************************************************************************/
 extern void BTM_SetDefaultLinkPolicy(uint16_t settings);
 
+/*******************************************************************************
+ *
+ * Function         BTM_SetPacketTypes
+ *
+ * Description      Set the ACL packet types used on the BR/EDR link to
+ *                  remote_bda. The types not supported by both sides are
+ *                  left out.
+ *
+ * Returns          BTM_CMD_STARTED if successfully initiated, otherwise error
+ *
+ ******************************************************************************/
+extern tBTM_STATUS BTM_SetPacketTypes(const RawAddress& remote_bda,
+                                      uint16_t pkt_types);
+
+/*******************************************************************************
+ *
+ * Function         BTM_ReadPacketTypes
+ *
+ * Description      Read the ACL packet types used on the BR/EDR link to
+ *                  remote_bda.
+ *
+ * Returns          The packet types mask, 0 if there is no such link
+ *
+ ******************************************************************************/
+extern uint16_t BTM_ReadPacketTypes(const RawAddress& remote_bda);
+
 /*******************************************************************************
  *
  * Function         BTM_SetDefaultLinkSuperTout
@@ -868,6 +895,55 @@ extern tBTM_STATUS BTM_GetRole(const RawAddress& remote_bd_addr,
 extern tBTM_STATUS BTM_SwitchRole(const RawAddress& remote_bd_addr,
                                   uint8_t new_role, tBTM_CMPL_CB* p_cb);
 
+/*******************************************************************************
+ *
+ * Function         BTM_IsPeerRoleSwitchRefused
+ *
+ * Description      This function is called to check if the peer refused a role
+ *                  switch on a recent connection. BTM_SwitchRole returns
+ *                  BTM_MODE_UNSUPPORTED for such a peer.
+ *
+ * Returns          true if role switches are not attempted with the peer
+ *
+ ******************************************************************************/
+extern bool BTM_IsPeerRoleSwitchRefused(const RawAddress& bd_addr);
+
+/*******************************************************************************
+ *
+ * Function         BTM_GetPeerPreferredRole
+ *
+ * Description      This function is called to get the local role that the
+ *                  peer last switched the link to by itself.
+ *
+ * Returns          HCI_ROLE_MASTER, HCI_ROLE_SLAVE or BTM_ROLE_UNDEFINED
+ *
+ ******************************************************************************/
+extern uint8_t BTM_GetPeerPreferredRole(const RawAddress& bd_addr);
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsPeerSniffRefused
+ *
+ * Description      This function is called to check if the peer refused sniff
+ *                  mode on a recent connection.
+ *
+ * Returns          true if sniff mode should not be requested
+ *
+ ******************************************************************************/
+extern bool BTM_IsPeerSniffRefused(const RawAddress& bd_addr);
+
+/*******************************************************************************
+ *
+ * Function         BTM_SetPeerSniffRefused
+ *
+ * Description      This function is called when the peer refused sniff mode,
+ *                  so that it is not requested on the next connections.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTM_SetPeerSniffRefused(const RawAddress& bd_addr);
+
 /*******************************************************************************
  *
  * Function         BTM_ReadRSSI
@@ -1303,6 +1379,20 @@ extern bool BTM_SecRegister(const tBTM_APPL_INFO* p_cb_info);
 extern bool BTM_SecRegisterLinkKeyNotificationCallback(
     tBTM_LINK_KEY_CALLBACK* p_callback);
 
+/*******************************************************************************
+ *
+ * Function         BTM_SecRegisterDevLoadCallback
+ *
+ * Description      Registers the callback asked to add a bonded device whose
+ *                  keys were not loaded at startup, on the first connection
+ *                  or link key request of the device.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTM_SecRegisterDevLoadCallback(
+    tBTM_SEC_DEV_LOAD_CALLBACK* p_callback);
+
 /*******************************************************************************
  *
  * Function         BTM_SecAddRmtNameNotifyCallback
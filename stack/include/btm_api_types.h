@@ -1603,6 +1603,11 @@ typedef void(tBTM_SEC_CBACK)(const RawAddress* bd_addr, tBT_TRANSPORT trasnport,
 */
 typedef void(tBTM_BOND_CANCEL_CMPL_CALLBACK)(tBTM_STATUS result);
 
+/* Asks the application to add the keys of a bonded device it did not load at
+ * startup, before the security manager looks the device up.
+*/
+typedef void(tBTM_SEC_DEV_LOAD_CALLBACK)(const RawAddress& bd_addr);
+
 /* LE related event and data structure */
 /* received IO_CAPABILITY_REQUEST event */
 #define BTM_LE_IO_REQ_EVT SMP_IO_CAP_REQ_EVT
@@ -110,6 +110,18 @@ extern void BTM_BleSetScanParams(uint8_t scan_phy, std::vector<uint32_t> scan_in
  *
  ******************************************************************************/
 extern void BTM_BleGetVendorCapabilities(tBTM_BLE_VSC_CB* p_cmn_vsc_cb);
+
+/*******************************************************************************
+ *
+ * Function         BTM_BleMaxScanFilters
+ *
+ * Description      This function returns the number of scan filter indexes,
+ *                  either of the controller or of the host filters.
+ *
+ * Returns          number of filter indexes, 0 if filtering is unavailable
+ *
+ ******************************************************************************/
+extern uint8_t BTM_BleMaxScanFilters(void);
 /*******************************************************************************
  *
  * Function         BTM_BleSetStorageConfig
@@ -144,7 +156,8 @@ extern void BTM_BleEnableBatchScan(
 extern void BTM_BleDisableBatchScan(
     base::Callback<void(uint8_t /* status */)> cb);
 
-/* This function is called to read batch scan reports */
+/* This function is called to read batch scan reports. |cb| runs once per
+ * chunk of records, the last chunk once the controller buffer is empty. */
 extern void BTM_BleReadScanReports(tBLE_SCAN_MODE scan_mode,
                                    tBTM_BLE_SCAN_REP_CBACK cb);
 
@@ -591,6 +604,32 @@ extern void BTM_BleTurnOnPrivacyOnRemote(const RawAddress& bd_addr,
  ******************************************************************************/
 extern void BTM_BleUpdateAdvFilterPolicy(tBTM_BLE_AFP adv_policy);
 
+/*******************************************************************************
+ *
+ * Function         BTM_BleRpaCacheDump
+ *
+ * Description      Dump the hit/miss statistics of the resolvable private
+ *                  address resolution cache.
+ *
+ * Parameter        fd: file descriptor to write to
+ *
+ * Return           void
+ ******************************************************************************/
+extern void BTM_BleRpaCacheDump(int fd);
+
+/*******************************************************************************
+ *
+ * Function         BTM_BleBgConnDump
+ *
+ * Description      Dump the white list updates of the LE background
+ *                  connection and the time it spent suspended for them.
+ *
+ * Parameter        fd: file descriptor to write to
+ *
+ * Return           void
+ ******************************************************************************/
+extern void BTM_BleBgConnDump(int fd);
+
 /*******************************************************************************
  *
  * Function         BTM_BleReceiverTest
@@ -642,6 +681,18 @@ void BTM_BleTestEnd(tBTM_CMPL_CB* p_cmd_cmpl_cback);
  ******************************************************************************/
 extern bool BTM_UseLeLink(const RawAddress& bd_addr);
 
+/*******************************************************************************
+ *
+ * Function         BTM_BleIsPeerEncKeyKnown
+ *
+ * Description      Check if the LE encryption key of a peer is known, from
+ *                  the bonded device records kept in memory.
+ *
+ * Returns          true if the key is known, false otherwise.
+ *
+ ******************************************************************************/
+extern bool BTM_BleIsPeerEncKeyKnown(const RawAddress& bd_addr);
+
 /*******************************************************************************
  *
  * Function         BTM_BleStackEnable
@@ -29,6 +29,7 @@
 
 #include <base/callback.h>
 #include <base/location.h>
+#include <base/logging.h>
 #include <base/threading/thread.h>
 #include "bt_common.h"
 #include "bt_target.h"
@@ -58,6 +59,21 @@ void btu_free_core(void);
 */
 base::MessageLoop* get_message_loop();
 
+/* The LE data loop, off unless BTU_LE_DATA_THREAD_PROPERTY is "true", runs
+ * the ACL data and the link events of the LE links. It takes turns with the
+ * main loop, so stack code still never runs on both at once. */
+#define BTU_LE_DATA_LOOP_NAME "btu le data loop"
+#define BTU_LE_DATA_THREAD_PROPERTY "persist.bluetooth.le_data_thread"
+
+bool btu_le_data_post(const base::Location& from_here, BT_HDR* p_msg);
+bool btu_is_main_thread(void);
+bool btu_is_le_data_thread(void);
+bool btu_holds_stack_turn(void);
+void btu_le_data_debug_dump(int fd);
+
+/* Stack code must run on one of the two loops, while it has the turn */
+#define BTU_DCHECK_STACK_TURN() DCHECK(btu_holds_stack_turn())
+
 void BTU_StartUp(void);
 void BTU_ShutDown(void);
 
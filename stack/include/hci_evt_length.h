@@ -276,3 +276,33 @@ static const uint8_t hci_event_parameters_minimum_length[] = {
     0,    //  0xFE - N/A
     0,    //  0xFF - HCI_Vendor_Specific Event
 };
+
+/*
+ *  Definitions for LE Meta Event Parameter Minimum Length, indexed by the
+ *  subevent code. As for the events, the length includes the subevent code.
+ */
+static const uint8_t hci_ble_event_parameters_minimum_length[] = {
+    0,   //  0x00 - N/A
+    19,  //  0x01 - HCI_LE_Connection_Complete Event
+    12,  //  0x02 - HCI_LE_Advertising_Report Event
+         //  (Num_Reports = 1, Data_Length = 0)
+    10,  //  0x03 - HCI_LE_Connection_Update_Complete Event
+    12,  //  0x04 - HCI_LE_Read_Remote_Features_Complete Event
+    13,  //  0x05 - HCI_LE_Long_Term_Key_Request Event
+    11,  //  0x06 - HCI_LE_Remote_Connection_Parameter_Request Event
+    11,  //  0x07 - HCI_LE_Data_Length_Change Event
+    66,  //  0x08 - HCI_LE_Read_Local_P-256_Public_Key_Complete Event
+    34,  //  0x09 - HCI_LE_Generate_DHKey_Complete Event
+    31,  //  0x0A - HCI_LE_Enhanced_Connection_Complete Event
+    18,  //  0x0B - HCI_LE_Directed_Advertising_Report Event (Num_Reports = 1)
+    6,   //  0x0C - HCI_LE_PHY_Update_Complete Event
+    26,  //  0x0D - HCI_LE_Extended_Advertising_Report Event
+         //  (Num_Reports = 1, Data_Length = 0)
+    16,  //  0x0E - HCI_LE_Periodic_Advertising_Sync_Established Event
+    8,   //  0x0F - HCI_LE_Periodic_Advertising_Report Event (Data_Length = 0)
+    3,   //  0x10 - HCI_LE_Periodic_Advertising_Sync_Lost Event
+    1,   //  0x11 - HCI_LE_Scan_Timeout Event
+    6,   //  0x12 - HCI_LE_Advertising_Set_Terminated Event
+    9,   //  0x13 - HCI_LE_Scan_Request_Received Event
+    4,   //  0x14 - HCI_LE_Channel_Selection_Algorithm Event
+};
@@ -20,6 +20,7 @@
 #define HIDD_API_H
 
 #include "hiddefs.h"
+#include "l2c_api.h"
 #include "sdp_api.h"
 
 /*****************************************************************************
@@ -50,6 +51,19 @@ enum {
 typedef void(tHID_DEV_HOST_CALLBACK)(const RawAddress& bd_addr, uint8_t event,
                                      uint32_t data, BT_HDR* p_buf);
 
+/* Offset of the reports given to HID_DevSendInputReport, leaving room for the
+ * HID header and the report ID */
+#define HID_DEV_INPUT_REPORT_OFFSET (L2CAP_MIN_OFFSET + 2)
+
+/* input reports sent with HID_DevSendInputReport */
+typedef struct {
+  size_t count;              /* reports written to L2CAP */
+  size_t coalesced_count;    /* reports replaced by a later one of their ID */
+  size_t dropped_count;      /* reports dropped with all held reports in use */
+  uint64_t total_latency_us; /* total time from the BTA API to L2CAP */
+  uint64_t max_latency_us;
+} tHID_DEV_RPT_STATS;
+
 /*****************************************************************************
  *  External Function Declarations
  ****************************************************************************/
@@ -127,6 +141,34 @@ extern tHID_STATUS HID_DevAddRecord(uint32_t handle, char* p_name,
 extern tHID_STATUS HID_DevSendReport(uint8_t channel, uint8_t type, uint8_t id,
                                      uint16_t len, uint8_t* p_data);
 
+/*******************************************************************************
+ *
+ * Function         HID_DevSendInputReport
+ *
+ * Description      Sends the input report in |p_buf| on the interrupt channel
+ *                  without copying it. The report starts at
+ *                  HID_DEV_INPUT_REPORT_OFFSET, |timestamp_us| is the time it
+ *                  was given to BTA. While the channel is congested the report
+ *                  is held, replacing a held report of the same ID.
+ *
+ * Returns          tHID_STATUS
+ *
+ ******************************************************************************/
+extern tHID_STATUS HID_DevSendInputReport(uint8_t id, BT_HDR* p_buf,
+                                          uint64_t timestamp_us);
+
+/*******************************************************************************
+ *
+ * Function         HID_DevGetReportStats
+ *
+ * Description      Gets the statistics of the reports sent with
+ *                  HID_DevSendInputReport
+ *
+ * Returns          const tHID_DEV_RPT_STATS*
+ *
+ ******************************************************************************/
+extern const tHID_DEV_RPT_STATS* HID_DevGetReportStats(void);
+
 /*******************************************************************************
  *
  * Function         HID_DevVirtualCableUnplug
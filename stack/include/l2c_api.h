@@ -788,6 +788,19 @@ extern bool L2CA_SendTestSFrame(uint16_t cid, uint8_t sup_type,
  ******************************************************************************/
 extern bool L2CA_SetTxPriority(uint16_t cid, tL2CAP_CHNL_PRIORITY priority);
 
+/*******************************************************************************
+ *
+ * Function         L2CA_SetChnlLatencyCritical
+ *
+ * Description      Marks a channel as latency critical. Its data is sent ahead
+ *                  of the other channels of the link, and the link keeps
+ *                  L2CAP_LATENCY_CRITICAL_RESERVE ACL credits for it.
+ *
+ * Returns          true if a valid channel, else false
+ *
+ ******************************************************************************/
+extern bool L2CA_SetChnlLatencyCritical(uint16_t cid, bool latency_critical);
+
 /*******************************************************************************
  *
  * Function         L2CA_RegForNoCPEvt
@@ -843,6 +856,19 @@ typedef void(tL2CA_RESERVE_CMPL_CBACK)(void);
 extern bool L2CA_SetFlushTimeout(const RawAddress& bd_addr,
                                  uint16_t flush_tout);
 
+/*******************************************************************************
+ *
+ * Function         L2CA_GetFlushTimeout
+ *
+ * Description      This function returns the automatic flush time out (in ms)
+ *                  of the BR/EDR link to bd_addr.
+ *
+ * Returns          The flush time out, L2CAP_NO_AUTOMATIC_FLUSH if there is
+ *                  none or no such link
+ *
+ ******************************************************************************/
+extern uint16_t L2CA_GetFlushTimeout(const RawAddress& bd_addr);
+
 /*******************************************************************************
  *
  * Function         L2CA_DataWriteEx
@@ -929,6 +955,53 @@ extern uint8_t L2CA_GetChnlFcrMode(uint16_t lcid);
 
 extern bool L2CA_LE_SetFlowControlCredits (uint16_t cid, uint16_t credits);
 
+/*******************************************************************************
+ *
+ *  Function         L2CA_GetPeerLECocCredit
+ *
+ *  Description      Get the number of PDUs the peer of an LE connection
+ *                   oriented channel can currently receive
+ *
+ *  Parameters:      Local CID
+ *
+ *  Return value:    Peer credits, 0 if the channel is not found
+ *
+ ******************************************************************************/
+extern uint16_t L2CA_GetPeerLECocCredit(uint16_t lcid);
+
+/*******************************************************************************
+ *
+ *  Function         L2CA_GetLinkPacketCounts
+ *
+ *  Description      Get the number of ACL packets sent and received on the
+ *                   BR/EDR link to a peer since the link came up.
+ *
+ *  Returns          true if the link is found, false otherwise.
+ *
+ ******************************************************************************/
+extern bool L2CA_GetLinkPacketCounts(const RawAddress& bd_addr,
+                                     uint32_t* p_tx_pkts, uint32_t* p_rx_pkts);
+
+/*******************************************************************************
+ *
+ *  Function         L2CA_LeCocDebugDump
+ *
+ *  Description      Dumps the throughput and credit statistics of the open LE
+ *                   connection oriented channels to fd.
+ *
+ ******************************************************************************/
+extern void L2CA_LeCocDebugDump(int fd);
+
+/*******************************************************************************
+ *
+ *  Function         L2CA_LinkDebugDump
+ *
+ *  Description      Dumps the ACL credit usage of the links, and the LE
+ *                   connection parameters requested and applied, to fd.
+ *
+ ******************************************************************************/
+extern void L2CA_LinkDebugDump(int fd);
+
 /*******************************************************************************
  *
  *                      UCD callback prototypes
@@ -1233,11 +1306,42 @@ extern bool L2CA_GetConnectionConfig(uint16_t lcid, uint16_t* mtu,
  ******************************************************************************/
 extern bool L2CA_CancelBleConnectReq(const RawAddress& rem_bda);
 
+/* Users of the LE connection parameters, each has its own request on a link.
+ * On equally demanding requests, the later users win. */
+typedef enum {
+  L2CA_BLE_CONN_USER_APP = 0, /* GATT applications, connection priority */
+  L2CA_BLE_CONN_USER_HID,
+  L2CA_BLE_CONN_USER_HEARING_AID,
+  L2CA_BLE_CONN_NUM_USERS
+} tL2CA_BLE_CONN_USER;
+
+/*******************************************************************************
+ *
+ *  Function        L2CA_RequestBleConnParams
+ *
+ *  Description     Request BLE connection parameters for a user of the link.
+ *                  The request replaces the previous one of the user. The
+ *                  link uses the most demanding request of its users, the
+ *                  one with the shortest maximum interval, then the lowest
+ *                  latency.
+ *
+ *  Parameters:     BD Address of remote
+ *
+ *  Return value:   true if the request was recorded
+ *
+ ******************************************************************************/
+extern bool L2CA_RequestBleConnParams(const RawAddress& rem_bda,
+                                      tL2CA_BLE_CONN_USER user,
+                                      uint16_t min_int, uint16_t max_int,
+                                      uint16_t latency, uint16_t timeout,
+                                      uint16_t min_ce_len, uint16_t max_ce_len);
+
 /*******************************************************************************
  *
  *  Function        L2CA_UpdateBleConnParams
  *
- *  Description     Update BLE connection parameters.
+ *  Description     Update BLE connection parameters, as requested by the GATT
+ *                  applications. See L2CA_RequestBleConnParams.
  *
  *  Parameters:     BD Address of remote
  *
@@ -104,6 +104,8 @@ typedef int(tPORT_DATA_CALLBACK)(uint16_t port_handle, void* p_data,
 #define DATA_CO_CALLBACK_TYPE_INCOMING 1
 #define DATA_CO_CALLBACK_TYPE_OUTGOING_SIZE 2
 #define DATA_CO_CALLBACK_TYPE_OUTGOING 3
+/* p_buf is an array of len struct iovec, to be filled in full */
+#define DATA_CO_CALLBACK_TYPE_OUTGOING_VEC 4
 typedef int(tPORT_DATA_CO_CALLBACK)(uint16_t port_handle, uint8_t* p_buf,
                                     uint16_t len, int type);
 
@@ -682,4 +684,16 @@ extern const char* PORT_GetResultString(const uint8_t result_code);
  ******************************************************************************/
 extern int PORT_GetStateBySCN(const RawAddress& bd_addr, uint32_t scn_id, bool is_server);
 
+/*******************************************************************************
+ *
+ * Function         PORT_DebugDump
+ *
+ * Description      This function dumps the credit flow control state of the
+ *                  open ports.
+ *
+ * Parameters:      fd         - file descriptor to write to
+ *
+ ******************************************************************************/
+extern void PORT_DebugDump(int fd);
+
 #endif /* PORT_API_H */
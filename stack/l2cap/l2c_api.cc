@@ -1417,6 +1417,35 @@ bool L2CA_SetTxPriority(uint16_t cid, tL2CAP_CHNL_PRIORITY priority) {
   return (true);
 }
 
+/*******************************************************************************
+ *
+ * Function         L2CA_SetChnlLatencyCritical
+ *
+ * Description      Marks a channel as latency critical, its data is sent ahead
+ *                  of the other channels of the link.
+ *
+ * Returns          true if a valid channel, else false
+ *
+ ******************************************************************************/
+bool L2CA_SetChnlLatencyCritical(uint16_t cid, bool latency_critical) {
+  tL2C_CCB* p_ccb;
+
+  L2CAP_TRACE_API("L2CA_SetChnlLatencyCritical()  CID: 0x%04x, critical:%d",
+                  cid, latency_critical);
+
+  /* Find the channel control block. We don't know the link it is on. */
+  p_ccb = l2cu_find_ccb_by_cid(NULL, cid);
+  if (p_ccb == NULL) {
+    L2CAP_TRACE_WARNING(
+        "L2CAP - no CCB for L2CA_SetChnlLatencyCritical, CID: %d", cid);
+    return (false);
+  }
+
+  p_ccb->latency_critical = latency_critical;
+
+  return (true);
+}
+
 /*******************************************************************************
  *
  * Function         L2CA_SetChnlDataRate
@@ -1545,6 +1574,25 @@ bool L2CA_SetFlushTimeout(const RawAddress& bd_addr, uint16_t flush_tout) {
   return (true);
 }
 
+/*******************************************************************************
+ *
+ * Function         L2CA_GetFlushTimeout
+ *
+ * Description      This function returns the automatic flush time out (in ms)
+ *                  of the BR/EDR link to bd_addr.
+ *
+ * Returns          The flush time out, L2CAP_NO_AUTOMATIC_FLUSH if there is
+ *                  none or no such link
+ *
+ ******************************************************************************/
+uint16_t L2CA_GetFlushTimeout(const RawAddress& bd_addr) {
+  tL2C_LCB* p_lcb = l2cu_find_lcb_by_bd_addr(bd_addr, BT_TRANSPORT_BR_EDR);
+  if (p_lcb == NULL || !p_lcb->in_use || p_lcb->link_state != LST_CONNECTED)
+    return L2CAP_NO_AUTOMATIC_FLUSH;
+
+  return p_lcb->link_flush_tout;
+}
+
 /*******************************************************************************
  *
  *  Function         L2CA_GetPeerFeatures
@@ -1628,6 +1676,53 @@ uint8_t L2CA_GetChnlFcrMode(uint16_t lcid) {
   return (L2CAP_FCR_BASIC_MODE);
 }
 
+/*******************************************************************************
+ *
+ *  Function         L2CA_GetPeerLECocCredit
+ *
+ *  Description      Get the number of PDUs the peer of an LE connection
+ *                   oriented channel can currently receive
+ *
+ *  Parameters:      Local CID
+ *
+ *  Return value:    Peer credits, 0 if the channel is not found
+ *
+ ******************************************************************************/
+uint16_t L2CA_GetPeerLECocCredit(uint16_t lcid) {
+  tL2C_CCB* p_ccb = l2cu_find_ccb_by_cid(NULL, lcid);
+
+  if (p_ccb == NULL) {
+    L2CAP_TRACE_ERROR("%s: no CCB for CID: 0x%04x", __func__, lcid);
+    return 0;
+  }
+
+  return p_ccb->peer_conn_cfg.credits;
+}
+
+/*******************************************************************************
+ *
+ *  Function         L2CA_GetLinkPacketCounts
+ *
+ *  Description      Get the number of ACL packets sent and received on the
+ *                   BR/EDR link to a peer since the link came up
+ *
+ *  Parameters:      BD address of the peer
+ *                   Pointers to the sent and received counts
+ *
+ *  Return value:    true if the link is found, false otherwise
+ *
+ ******************************************************************************/
+bool L2CA_GetLinkPacketCounts(const RawAddress& bd_addr, uint32_t* p_tx_pkts,
+                              uint32_t* p_rx_pkts) {
+  tL2C_LCB* p_lcb = l2cu_find_lcb_by_bd_addr(bd_addr, BT_TRANSPORT_BR_EDR);
+
+  if (p_lcb == NULL) return false;
+
+  *p_tx_pkts = p_lcb->link_stats.tx_acl_pkts;
+  *p_rx_pkts = p_lcb->link_stats.rx_acl_pkts;
+  return true;
+}
+
 #if (L2CAP_NUM_FIXED_CHNLS > 0)
 /*******************************************************************************
  *
@@ -2242,7 +2337,7 @@ uint16_t L2CA_FlushChannel(uint16_t lcid, uint16_t num_to_flush) {
   /* If needed, flush buffers in the CCB xmit hold queue */
   while ((num_to_flush != 0) && (!fixed_queue_is_empty(p_ccb->xmit_hold_q))) {
     BT_HDR* p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->xmit_hold_q);
-    osi_free(p_buf);
+    l2c_fcr_free_xmit_sdu(p_ccb, p_buf);
     num_to_flush--;
     num_flushed2++;
   }
@@ -24,7 +24,10 @@
 
 #include <base/logging.h>
 #include <base/strings/stringprintf.h>
+#include <inttypes.h>
+#include <stdio.h>
 #include <string.h>
+#include <algorithm>
 #include "bt_target.h"
 #include "bt_utils.h"
 #include "bta_hearing_aid_api.h"
@@ -37,6 +40,7 @@
 #include "l2cdefs.h"
 #include "log/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 #include "stack/gatt/connection_manager.h"
 #include "stack_config.h"
 
@@ -44,6 +48,27 @@ using base::StringPrintf;
 
 static void l2cble_start_conn_update(tL2C_LCB* p_lcb);
 
+/* An LE connection parameter update completed by the controller */
+typedef struct {
+  uint64_t timestamp_ms;
+  RawAddress bda;
+  uint8_t user; /* whose request was applied, see conn_req_user */
+  uint8_t status;
+  uint16_t interval;
+  uint16_t latency;
+  uint16_t timeout;
+  uint8_t tx_phy;
+  uint16_t tx_data_len;
+} tL2C_BLE_CONN_UPDATE;
+
+static tL2C_BLE_CONN_UPDATE
+    conn_update_history[L2C_BLE_CONN_UPDATE_HISTORY_SIZE];
+static size_t conn_update_count;
+
+/* Peers whose link failed on the 2M PHY, kept on the 1M PHY */
+static RawAddress phy_fallback[L2C_BLE_PHY_FALLBACK_SIZE];
+static size_t phy_fallback_count;
+
 /*******************************************************************************
  *
  *  Function        L2CA_CancelBleConnectReq
@@ -95,10 +120,30 @@ bool L2CA_CancelBleConnectReq(const RawAddress& rem_bda) {
  *  Return value:   true if update started
  *
  ******************************************************************************/
-bool L2CA_UpdateBleConnParams(const RawAddress& rem_bda, uint16_t min_int,
-                              uint16_t max_int, uint16_t latency,
-                              uint16_t timeout, uint16_t min_ce_len,
-                              uint16_t max_ce_len) {
+/* Returns the local user whose request is the most demanding on |p_lcb|, or
+ * L2CA_BLE_CONN_NUM_USERS if there is no request */
+static uint8_t l2cble_select_conn_req(const tL2C_LCB* p_lcb) {
+  uint8_t selected = L2CA_BLE_CONN_NUM_USERS;
+  for (uint8_t user = 0; user < L2CA_BLE_CONN_NUM_USERS; user++) {
+    const tL2C_BLE_CONN_REQ* p_req = &p_lcb->conn_req[user];
+    if (!p_req->in_use) continue;
+    if (selected != L2CA_BLE_CONN_NUM_USERS) {
+      const tL2C_BLE_CONN_REQ* p_sel = &p_lcb->conn_req[selected];
+      if (p_req->max_interval > p_sel->max_interval) continue;
+      if (p_req->max_interval == p_sel->max_interval &&
+          p_req->latency > p_sel->latency)
+        continue;
+    }
+    selected = user;
+  }
+  return selected;
+}
+
+bool L2CA_RequestBleConnParams(const RawAddress& rem_bda,
+                               tL2CA_BLE_CONN_USER user, uint16_t min_int,
+                               uint16_t max_int, uint16_t latency,
+                               uint16_t timeout, uint16_t min_ce_len,
+                               uint16_t max_ce_len) {
   tL2C_LCB* p_lcb;
   tACL_CONN* p_acl_cb = btm_bda_to_acl(rem_bda, BT_TRANSPORT_LE);
 
@@ -116,23 +161,53 @@ bool L2CA_UpdateBleConnParams(const RawAddress& rem_bda, uint16_t min_int,
     return (false);
   }
 
-  VLOG(2) << __func__ << ": BD_ADDR=" << rem_bda << ", min_int=" << min_int
-          << ", max_int=" << max_int << ", min_ce_len=" << min_ce_len
-          << ", max_ce_len=" << max_ce_len;
+  if (user >= L2CA_BLE_CONN_NUM_USERS) return (false);
+
+  VLOG(2) << __func__ << ": BD_ADDR=" << rem_bda << ", user=" << +user
+          << ", min_int=" << min_int << ", max_int=" << max_int
+          << ", min_ce_len=" << min_ce_len << ", max_ce_len=" << max_ce_len;
+
+  tL2C_BLE_CONN_REQ* p_req = &p_lcb->conn_req[user];
+  p_req->in_use = true;
+  p_req->min_interval = min_int;
+  p_req->max_interval = max_int;
+  p_req->latency = latency;
+  p_req->timeout = timeout;
+  p_req->min_ce_len = min_ce_len;
+  p_req->max_ce_len = max_ce_len;
+
+  /* A less demanding request than the one in use is only recorded, it is used
+   * once the more demanding one is relaxed */
+  uint8_t selected = l2cble_select_conn_req(p_lcb);
+  if (selected != user && selected == p_lcb->conn_req_user) {
+    VLOG(1) << __func__ << ": keeping the parameters of user " << +selected;
+    return (true);
+  }
 
-  p_lcb->min_interval = min_int;
-  p_lcb->max_interval = max_int;
-  p_lcb->latency = latency;
-  p_lcb->timeout = timeout;
+  p_req = &p_lcb->conn_req[selected];
+  p_lcb->conn_req_user = selected;
+  p_lcb->min_interval = p_req->min_interval;
+  p_lcb->max_interval = p_req->max_interval;
+  p_lcb->latency = p_req->latency;
+  p_lcb->timeout = p_req->timeout;
   p_lcb->conn_update_mask |= L2C_BLE_NEW_CONN_PARAM;
-  p_lcb->min_ce_len = min_ce_len;
-  p_lcb->max_ce_len = max_ce_len;
+  p_lcb->min_ce_len = p_req->min_ce_len;
+  p_lcb->max_ce_len = p_req->max_ce_len;
 
   l2cble_start_conn_update(p_lcb);
 
   return (true);
 }
 
+bool L2CA_UpdateBleConnParams(const RawAddress& rem_bda, uint16_t min_int,
+                              uint16_t max_int, uint16_t latency,
+                              uint16_t timeout, uint16_t min_ce_len,
+                              uint16_t max_ce_len) {
+  return L2CA_RequestBleConnParams(rem_bda, L2CA_BLE_CONN_USER_APP, min_int,
+                                   max_int, latency, timeout, min_ce_len,
+                                   max_ce_len);
+}
+
 bool L2CA_UpdateBleConnParams(const RawAddress& rem_bda, uint16_t min_int,
                               uint16_t max_int, uint16_t latency,
                               uint16_t timeout) {
@@ -258,6 +333,31 @@ void l2cble_notify_le_connection(const RawAddress& bda) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function l2cble_notify_le_data
+ *
+ * Description This function is called for each ACL packet received on an LE
+ *             link. Once the link is connected, only the channels still
+ *             waiting for it need the connection notification, so the address
+ *             lookups of l2cble_notify_le_connection are skipped.
+ *
+ * Returns none
+ *
+ ******************************************************************************/
+void l2cble_notify_le_data(tL2C_LCB* p_lcb) {
+  if (p_lcb->link_state != LST_CONNECTED) {
+    l2cble_notify_le_connection(p_lcb->remote_bd_addr);
+    return;
+  }
+
+  for (tL2C_CCB* p_ccb = p_lcb->ccb_queue.p_first_ccb; p_ccb;
+       p_ccb = p_ccb->p_next_ccb) {
+    if (p_ccb->chnl_state == CST_CLOSED)
+      l2c_csm_execute(p_ccb, L2CEVT_LP_CONNECT_CFM, NULL);
+  }
+}
+
 /** This function is called when an HCI Connection Complete event is received.
  */
 void l2cble_conn_comp(uint16_t handle, uint8_t role, const RawAddress& bda,
@@ -457,6 +557,20 @@ void l2cble_process_conn_update_evt(uint16_t handle, uint8_t status,
     L2CAP_TRACE_WARNING("%s: Error status: %d", __func__, status);
   }
 
+  tL2C_BLE_CONN_UPDATE* p_update =
+      &conn_update_history[conn_update_count %
+                           L2C_BLE_CONN_UPDATE_HISTORY_SIZE];
+  conn_update_count++;
+  p_update->timestamp_ms = time_get_os_boottime_ms();
+  p_update->bda = p_lcb->remote_bd_addr;
+  p_update->user = p_lcb->conn_req_user;
+  p_update->status = status;
+  p_update->interval = interval;
+  p_update->latency = latency;
+  p_update->timeout = timeout;
+  p_update->tx_phy = p_lcb->tx_phy;
+  p_update->tx_data_len = p_lcb->tx_data_len;
+
   l2cble_start_conn_update(p_lcb);
 
   L2CAP_TRACE_DEBUG("%s: conn_update_mask=%d", __func__,
@@ -545,6 +659,7 @@ void l2cble_process_sig_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
         } else {
           l2cu_send_peer_ble_par_rsp(p_lcb, L2CAP_CFG_OK, id);
 
+          p_lcb->conn_req_user = L2C_BLE_CONN_USER_PEER;
           p_lcb->min_interval = min_interval;
           p_lcb->max_interval = max_interval;
           p_lcb->latency = latency;
@@ -984,7 +1099,8 @@ void l2cble_update_data_length(tL2C_LCB* p_lcb) {
     }
   }
 
-  if (tx_mtu > BTM_BLE_DATA_SIZE_MAX) tx_mtu = BTM_BLE_DATA_SIZE_MAX;
+  if (tx_mtu > BTM_BLE_DATA_SIZE_MAX || p_lcb->bulk_link)
+    tx_mtu = BTM_BLE_DATA_SIZE_MAX;
 
   /* update TX data length if changed */
   if (p_lcb->tx_data_len != tx_mtu)
@@ -1013,6 +1129,188 @@ void l2cble_process_data_length_change_event(uint16_t handle,
   /* ignore rx_data len for now */
 }
 
+/*******************************************************************************
+ *
+ * Function         l2cble_process_phy_update
+ *
+ * Description      This function records the TX PHY of a link after a PHY
+ *                  update, to be reported with the connection updates.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cble_process_phy_update(uint16_t handle, uint8_t status,
+                               uint8_t tx_phy) {
+  tL2C_LCB* p_lcb = l2cu_find_lcb_by_handle(handle);
+  if (p_lcb == NULL || status != HCI_SUCCESS) return;
+
+  p_lcb->tx_phy = tx_phy;
+}
+
+static bool l2cble_is_phy_fallback(const RawAddress& bda) {
+  size_t count = std::min<size_t>(phy_fallback_count,
+                                  L2C_BLE_PHY_FALLBACK_SIZE);
+  for (size_t i = 0; i < count; i++) {
+    if (phy_fallback[i] == bda) return true;
+  }
+  return false;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cble_track_throughput
+ *
+ * Description      This function is called as ACL packets of an LE link are
+ *                  sent or received. Once the link carries sustained traffic
+ *                  it requests the largest data length and the 2M PHY, if
+ *                  both sides support them.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cble_track_throughput(tL2C_LCB* p_lcb) {
+#if (L2C_BLE_BULK_LINK_POLICY == TRUE)
+  if (p_lcb->bulk_link) return;
+
+  period_ms_t now_ms = time_get_os_boottime_ms();
+  period_ms_t elapsed_ms = now_ms - p_lcb->bulk_window_ms;
+  if (elapsed_ms < L2C_BLE_BULK_WINDOW_MS) return;
+
+  /* A window stretched by an idle link is held to the same rate */
+  uint32_t pkts = p_lcb->link_stats.tx_acl_pkts + p_lcb->link_stats.rx_acl_pkts;
+  uint64_t window_pkts = pkts - p_lcb->bulk_window_pkts;
+  if (window_pkts * L2C_BLE_BULK_WINDOW_MS >=
+      (uint64_t)L2C_BLE_BULK_MIN_PKTS * elapsed_ms)
+    p_lcb->bulk_windows++;
+  else
+    p_lcb->bulk_windows = 0;
+  p_lcb->bulk_window_ms = now_ms;
+  p_lcb->bulk_window_pkts = pkts;
+  if (p_lcb->bulk_windows < L2C_BLE_BULK_WINDOWS) return;
+
+  tACL_CONN* p_acl = btm_bda_to_acl(p_lcb->remote_bd_addr, BT_TRANSPORT_LE);
+  if (p_acl == NULL) return;
+
+  p_lcb->bulk_link = true;
+  const controller_t* controller = controller_get_interface();
+  L2CAP_TRACE_DEBUG("%s: sustained traffic on handle 0x%04x", __func__,
+                    p_lcb->handle);
+
+  if (controller->supports_ble_packet_extension() &&
+      HCI_LE_DATA_LEN_EXT_SUPPORTED(p_acl->peer_le_features))
+    l2cble_update_data_length(p_lcb);
+
+  if (p_lcb->tx_phy != PHY_LE_2M && controller->supports_ble_2m_phy() &&
+      HCI_LE_2M_PHY_SUPPORTED(p_acl->peer_le_features) &&
+      !l2cble_is_phy_fallback(p_lcb->remote_bd_addr))
+    BTM_BleSetPhy(p_lcb->remote_bd_addr, PHY_LE_2M_MASK, PHY_LE_2M_MASK, 0);
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cble_process_link_loss
+ *
+ * Description      This function is called when an LE link disconnects. A
+ *                  peer lost on the 2M PHY is kept on the 1M PHY by the
+ *                  sustained traffic policy.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cble_process_link_loss(tL2C_LCB* p_lcb, uint8_t reason) {
+  if (p_lcb->tx_phy != PHY_LE_2M) return;
+  if (reason != HCI_ERR_CONNECTION_TOUT &&
+      reason != HCI_ERR_LMP_RESPONSE_TIMEOUT &&
+      reason != HCI_ERR_CONN_TOUT_DUE_TO_MIC_FAILURE)
+    return;
+  if (l2cble_is_phy_fallback(p_lcb->remote_bd_addr)) return;
+
+  LOG(WARNING) << __func__ << ": " << p_lcb->remote_bd_addr
+               << " lost on the 2M PHY, reason: " << loghex(reason);
+  phy_fallback[phy_fallback_count % L2C_BLE_PHY_FALLBACK_SIZE] =
+      p_lcb->remote_bd_addr;
+  phy_fallback_count++;
+}
+
+static const char* l2cble_conn_user_text(uint8_t user) {
+  switch (user) {
+    case L2CA_BLE_CONN_USER_APP:
+      return "app";
+    case L2CA_BLE_CONN_USER_HID:
+      return "HID";
+    case L2CA_BLE_CONN_USER_HEARING_AID:
+      return "hearing aid";
+    case L2C_BLE_CONN_USER_PEER:
+      return "peer";
+    default:
+      return "none";
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cble_conn_params_debug_dump
+ *
+ * Description      This function dumps the connection parameters requested
+ *                  on an LE link and which request is in use.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cble_conn_params_debug_dump(const tL2C_LCB* p_lcb, int fd) {
+  dprintf(fd,
+          "    conn params: interval %d-%d, latency: %d, timeout: %d, "
+          "from: %s, tx PHY: %d, tx data len: %d%s\n",
+          p_lcb->min_interval, p_lcb->max_interval, p_lcb->latency,
+          p_lcb->timeout,
+          l2cble_conn_user_text(p_lcb->conn_req_user), p_lcb->tx_phy,
+          p_lcb->tx_data_len, p_lcb->bulk_link ? ", sustained traffic" : "");
+  for (uint8_t user = 0; user < L2CA_BLE_CONN_NUM_USERS; user++) {
+    const tL2C_BLE_CONN_REQ* p_req = &p_lcb->conn_req[user];
+    if (!p_req->in_use) continue;
+    dprintf(fd,
+            "      %s request: interval %d-%d, latency: %d, timeout: %d, "
+            "CE len %d-%d\n",
+            l2cble_conn_user_text(user), p_req->min_interval,
+            p_req->max_interval, p_req->latency, p_req->timeout,
+            p_req->min_ce_len, p_req->max_ce_len);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cble_conn_update_history_dump
+ *
+ * Description      This function dumps the last LE connection parameter
+ *                  updates, oldest first.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cble_conn_update_history_dump(int fd) {
+  size_t fallbacks = std::min<size_t>(phy_fallback_count,
+                                      L2C_BLE_PHY_FALLBACK_SIZE);
+  for (size_t i = 0; i < fallbacks; i++)
+    dprintf(fd, "\n%s kept on the 1M PHY", phy_fallback[i].ToString().c_str());
+  if (fallbacks > 0) dprintf(fd, "\n");
+
+  dprintf(fd, "\nLE connection updates (%zu total):\n", conn_update_count);
+  size_t count = std::min<size_t>(conn_update_count,
+                                  L2C_BLE_CONN_UPDATE_HISTORY_SIZE);
+  for (size_t i = conn_update_count - count; i < conn_update_count; i++) {
+    const tL2C_BLE_CONN_UPDATE* p_update =
+        &conn_update_history[i % L2C_BLE_CONN_UPDATE_HISTORY_SIZE];
+    dprintf(fd,
+            "  %" PRIu64 " ms %s from %s, status: %d, interval: %d, "
+            "latency: %d, timeout: %d, tx PHY: %d, tx data len: %d\n",
+            p_update->timestamp_ms, p_update->bda.ToString().c_str(),
+            l2cble_conn_user_text(p_update->user), p_update->status,
+            p_update->interval, p_update->latency, p_update->timeout,
+            p_update->tx_phy, p_update->tx_data_len);
+  }
+}
+
 /*******************************************************************************
  *
  * Function         l2cble_set_fixed_channel_tx_data_length
@@ -1239,6 +1537,43 @@ bool L2CA_LE_SetFlowControlCredits (uint16_t cid, uint16_t credits)
         return (TRUE);
 }
 
+/*******************************************************************************
+ *
+ * Function         L2CA_LeCocDebugDump
+ *
+ * Description      This function dumps the throughput and credit statistics
+ *                  of the open LE connection oriented channels.
+ *
+ * Parameters:      fd         - file descriptor to write to
+ *
+ ******************************************************************************/
+void L2CA_LeCocDebugDump(int fd) {
+  dprintf(fd, "\nLE CoC channels (credit threshold: %d):\n",
+          l2cb.le_credit_threshold);
+  for (int xx = 0; xx < MAX_L2CAP_CHANNELS; xx++) {
+    tL2C_CCB* p_ccb = &l2cb.ccb_pool[xx];
+    if (!p_ccb->in_use || !p_ccb->p_lcb ||
+        p_ccb->p_lcb->transport != BT_TRANSPORT_LE)
+      continue;
+
+    const tL2C_LCC_STATS* p_stats = &p_ccb->lcc_stats;
+    dprintf(fd, "  CID: 0x%04x, psm: 0x%04x, mtu: %d/%d, mps: %d/%d\n",
+            p_ccb->local_cid, p_ccb->p_rcb ? p_ccb->p_rcb->psm : 0,
+            p_ccb->local_conn_cfg.mtu, p_ccb->peer_conn_cfg.mtu,
+            p_ccb->local_conn_cfg.mps, p_ccb->peer_conn_cfg.mps);
+    dprintf(fd,
+            "    tx SDUs: %u (%" PRIu64 " bytes), zero copy PDUs: %u, credits: "
+            "%d, out of credits: %u\n",
+            p_stats->tx_sdus, p_stats->tx_bytes, p_stats->tx_zero_copy,
+            p_ccb->peer_conn_cfg.credits, p_stats->tx_credit_stalls);
+    dprintf(fd,
+            "    rx SDUs: %u (%" PRIu64 " bytes), zero copy SDUs: %u, remote "
+            "credits: %d, credit packets sent: %u\n",
+            p_stats->rx_sdus, p_stats->rx_bytes, p_stats->rx_zero_copy,
+            p_ccb->remote_credit_count, p_stats->credit_returns);
+  }
+}
+
 /*******************************************************************************
  *
  * Function         l2ble_sec_access_req
@@ -30,12 +30,14 @@
 #include <string.h>
 
 #include "bt_common.h"
+#include "bt_packet.h"
 #include "bt_types.h"
 #include "btm_api.h"
 #include "btm_int.h"
 #include "btu.h"
 #include "hcimsgs.h"
 #include "l2c_api.h"
+#include "l2c_fcs.h"
 #include "l2c_int.h"
 #include "l2cdefs.h"
 
@@ -43,6 +45,14 @@
  */
 #define L2C_FCR_RETX_ALL_PKTS 0xFF
 
+/* Room needed after an I-frame for the FCS (Frame Check Sequence), and for
+ * the timestamp put at its end when L2CAP_ERTM_STATS is enabled */
+#if (L2CAP_ERTM_STATS == TRUE)
+#define L2C_FCR_TAILROOM (L2CAP_FCS_LEN + sizeof(uint32_t))
+#else
+#define L2C_FCR_TAILROOM L2CAP_FCS_LEN
+#endif
+
 /* this is the minimal offset required by OBX to process incoming packets */
 static const uint16_t OBX_BUF_MIN_OFFSET = 4;
 
@@ -50,39 +60,6 @@ static const char* SAR_types[] = {"Unsegmented", "Start", "End",
                                   "Continuation"};
 static const char* SUP_types[] = {"RR", "REJ", "RNR", "SREJ"};
 
-/* Look-up table for the CRC calculation */
-static const unsigned short crctab[256] = {
-    0x0000, 0xc0c1, 0xc181, 0x0140, 0xc301, 0x03c0, 0x0280, 0xc241, 0xc601,
-    0x06c0, 0x0780, 0xc741, 0x0500, 0xc5c1, 0xc481, 0x0440, 0xcc01, 0x0cc0,
-    0x0d80, 0xcd41, 0x0f00, 0xcfc1, 0xce81, 0x0e40, 0x0a00, 0xcac1, 0xcb81,
-    0x0b40, 0xc901, 0x09c0, 0x0880, 0xc841, 0xd801, 0x18c0, 0x1980, 0xd941,
-    0x1b00, 0xdbc1, 0xda81, 0x1a40, 0x1e00, 0xdec1, 0xdf81, 0x1f40, 0xdd01,
-    0x1dc0, 0x1c80, 0xdc41, 0x1400, 0xd4c1, 0xd581, 0x1540, 0xd701, 0x17c0,
-    0x1680, 0xd641, 0xd201, 0x12c0, 0x1380, 0xd341, 0x1100, 0xd1c1, 0xd081,
-    0x1040, 0xf001, 0x30c0, 0x3180, 0xf141, 0x3300, 0xf3c1, 0xf281, 0x3240,
-    0x3600, 0xf6c1, 0xf781, 0x3740, 0xf501, 0x35c0, 0x3480, 0xf441, 0x3c00,
-    0xfcc1, 0xfd81, 0x3d40, 0xff01, 0x3fc0, 0x3e80, 0xfe41, 0xfa01, 0x3ac0,
-    0x3b80, 0xfb41, 0x3900, 0xf9c1, 0xf881, 0x3840, 0x2800, 0xe8c1, 0xe981,
-    0x2940, 0xeb01, 0x2bc0, 0x2a80, 0xea41, 0xee01, 0x2ec0, 0x2f80, 0xef41,
-    0x2d00, 0xedc1, 0xec81, 0x2c40, 0xe401, 0x24c0, 0x2580, 0xe541, 0x2700,
-    0xe7c1, 0xe681, 0x2640, 0x2200, 0xe2c1, 0xe381, 0x2340, 0xe101, 0x21c0,
-    0x2080, 0xe041, 0xa001, 0x60c0, 0x6180, 0xa141, 0x6300, 0xa3c1, 0xa281,
-    0x6240, 0x6600, 0xa6c1, 0xa781, 0x6740, 0xa501, 0x65c0, 0x6480, 0xa441,
-    0x6c00, 0xacc1, 0xad81, 0x6d40, 0xaf01, 0x6fc0, 0x6e80, 0xae41, 0xaa01,
-    0x6ac0, 0x6b80, 0xab41, 0x6900, 0xa9c1, 0xa881, 0x6840, 0x7800, 0xb8c1,
-    0xb981, 0x7940, 0xbb01, 0x7bc0, 0x7a80, 0xba41, 0xbe01, 0x7ec0, 0x7f80,
-    0xbf41, 0x7d00, 0xbdc1, 0xbc81, 0x7c40, 0xb401, 0x74c0, 0x7580, 0xb541,
-    0x7700, 0xb7c1, 0xb681, 0x7640, 0x7200, 0xb2c1, 0xb381, 0x7340, 0xb101,
-    0x71c0, 0x7080, 0xb041, 0x5000, 0x90c1, 0x9181, 0x5140, 0x9301, 0x53c0,
-    0x5280, 0x9241, 0x9601, 0x56c0, 0x5780, 0x9741, 0x5500, 0x95c1, 0x9481,
-    0x5440, 0x9c01, 0x5cc0, 0x5d80, 0x9d41, 0x5f00, 0x9fc1, 0x9e81, 0x5e40,
-    0x5a00, 0x9ac1, 0x9b81, 0x5b40, 0x9901, 0x59c0, 0x5880, 0x9841, 0x8801,
-    0x48c0, 0x4980, 0x8941, 0x4b00, 0x8bc1, 0x8a81, 0x4a40, 0x4e00, 0x8ec1,
-    0x8f81, 0x4f40, 0x8d01, 0x4dc0, 0x4c80, 0x8c41, 0x4400, 0x84c1, 0x8581,
-    0x4540, 0x8701, 0x47c0, 0x4680, 0x8641, 0x8201, 0x42c0, 0x4380, 0x8341,
-    0x4100, 0x81c1, 0x8081, 0x4040,
-};
-
 /*******************************************************************************
  *  Static local functions
 */
@@ -103,24 +80,96 @@ static void l2c_fcr_collect_ack_delay(tL2C_CCB* p_ccb, uint8_t num_bufs_acked);
 
 /*******************************************************************************
  *
- * Function         l2c_fcr_updcrc
+ * Function         l2c_fcr_sdu_unref
  *
- * Description      This function computes the CRC using the look-up table.
+ * Description      This function drops a reference to an SDU that has
+ *                  segments waiting for ack, and frees it with the last one.
  *
- * Returns          CRC
+ * Returns          -
  *
  ******************************************************************************/
-static unsigned short l2c_fcr_updcrc(unsigned short icrc, unsigned char* icp,
-                                     int icnt) {
-  unsigned short crc = icrc;
-  unsigned char* cp = icp;
-  int cnt = icnt;
+static void l2c_fcr_sdu_unref(tL2C_FCR_SDU* p_sdu) {
+  CHECK(p_sdu->ref_count > 0);
 
-  while (cnt--) {
-    crc = ((crc >> 8) & 0xff) ^ crctab[(crc & 0xff) ^ *cp++];
+  if (--p_sdu->ref_count == 0) {
+    osi_free(p_sdu->p_buf);
+    osi_free(p_sdu);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_free_wack
+ *
+ * Description      This function frees an I-frame of the waiting_for_ack_q.
+ *
+ * Returns          -
+ *
+ ******************************************************************************/
+static void l2c_fcr_free_wack(void* data) {
+  tL2C_FCR_WACK* p_wack = (tL2C_FCR_WACK*)data;
+
+  l2c_fcr_sdu_unref(p_wack->p_sdu);
+  osi_free(p_wack);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_free_xmit_sdu
+ *
+ * Description      This function frees an SDU removed from the xmit_hold_q.
+ *                  If some segments of the SDU are still waiting for ack, the
+ *                  buffer is only freed once they are acked.
+ *
+ * Returns          -
+ *
+ ******************************************************************************/
+void l2c_fcr_free_xmit_sdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
+  CHECK(p_ccb != NULL);
+  tL2C_FCR_SDU* p_sdu = p_ccb->fcrb.p_tx_sdu;
+
+  if ((p_sdu != NULL) && (p_sdu->p_buf == p_buf)) {
+    p_ccb->fcrb.p_tx_sdu = NULL;
+    l2c_fcr_sdu_unref(p_sdu);
+  } else {
+    osi_free(p_buf);
   }
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_build_wack_frame
+ *
+ * Description      This function rebuilds an I-frame waiting for ack for
+ *                  retransmission, with the control word of its last
+ *                  transmission. prepare_I_frame() refreshes the control word
+ *                  and adds the FCS.
+ *
+ * Returns          pointer to the new buffer
+ *
+ ******************************************************************************/
+static BT_HDR* l2c_fcr_build_wack_frame(tL2C_CCB* p_ccb,
+                                        const tL2C_FCR_WACK* p_wack) {
+  uint16_t hdr_len = L2CAP_PKT_OVERHEAD + L2CAP_FCR_OVERHEAD;
+  uint16_t sar = p_wack->layer_specific & L2CAP_FCR_SAR_BITS;
+
+  if (sar == L2CAP_FCR_START_SDU) hdr_len += L2CAP_SDU_LEN_OVERHEAD;
+
+  BT_HDR* p_buf =
+      bt_packet_new(HCI_DATA_PREAMBLE_SIZE, p_wack->len, L2CAP_FCS_LEN);
+  p_buf->layer_specific = p_wack->layer_specific;
+
+  uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
+
+  UINT16_TO_STREAM(p, p_wack->len - L2CAP_PKT_OVERHEAD);
+  UINT16_TO_STREAM(p, p_ccb->remote_cid);
+  UINT16_TO_STREAM(p, p_wack->ctrl_word);
+  if (sar == L2CAP_FCR_START_SDU) UINT16_TO_STREAM(p, p_wack->sdu_len);
 
-  return (crc);
+  memcpy(p, (uint8_t*)(p_wack->p_sdu->p_buf + 1) + p_wack->offset,
+         p_wack->len - hdr_len);
+
+  return (p_buf);
 }
 
 /*******************************************************************************
@@ -219,7 +268,14 @@ void l2c_fcr_cleanup(tL2C_CCB* p_ccb) {
 
   osi_free_and_reset((void**)&p_fcrb->p_rx_sdu);
 
-  fixed_queue_free(p_fcrb->waiting_for_ack_q, osi_free);
+  /* The SDU being segmented was freed along with the xmit_hold_q */
+  if (p_fcrb->p_tx_sdu != NULL) {
+    p_fcrb->p_tx_sdu->p_buf = NULL;
+    l2c_fcr_sdu_unref(p_fcrb->p_tx_sdu);
+    p_fcrb->p_tx_sdu = NULL;
+  }
+
+  fixed_queue_free(p_fcrb->waiting_for_ack_q, l2c_fcr_free_wack);
   p_fcrb->waiting_for_ack_q = NULL;
 
   fixed_queue_free(p_fcrb->srej_rcv_hold_q, osi_free);
@@ -341,28 +397,38 @@ void l2c_fcr_cleanup(tL2C_CCB* p_ccb) {
 BT_HDR* l2c_fcr_clone_buf(BT_HDR* p_buf, uint16_t new_offset,
                           uint16_t no_of_bytes) {
   CHECK(p_buf != NULL);
-  /*
-   * NOTE: We allocate extra L2CAP_FCS_LEN octets, in case we need to put
-   * the FCS (Frame Check Sequence) at the end of the buffer.
-   */
-  uint16_t buf_size = no_of_bytes + sizeof(BT_HDR) + new_offset + L2CAP_FCS_LEN;
-#if (L2CAP_ERTM_STATS == TRUE)
-  /*
-   * NOTE: If L2CAP_ERTM_STATS is enabled, we need 4 extra octets at the
-   * end for a timestamp at the end of an I-frame.
-   */
-  buf_size += sizeof(uint32_t);
-#endif
-  BT_HDR* p_buf2 = (BT_HDR*)osi_malloc(buf_size);
+  BT_HDR* p_buf2 = bt_packet_new(new_offset, no_of_bytes, L2C_FCR_TAILROOM);
 
-  p_buf2->offset = new_offset;
-  p_buf2->len = no_of_bytes;
   memcpy(((uint8_t*)(p_buf2 + 1)) + p_buf2->offset,
          ((uint8_t*)(p_buf + 1)) + p_buf->offset, no_of_bytes);
 
   return (p_buf2);
 }
 
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_share_buf
+ *
+ * Description      This function shares an unsegmented SDU with the lower
+ *                  layers instead of copying it. The L2CAP and HCI headers
+ *                  go in its headroom and the FCS in its tailroom, so the
+ *                  payload kept for retransmission is not written over.
+ *
+ * Returns          the SDU with a new reference, or NULL if it must be
+ *                  copied
+ *
+ ******************************************************************************/
+static BT_HDR* l2c_fcr_share_buf(BT_HDR* p_buf) {
+  /* The headers of the last segment would go over the previous segment */
+  if (p_buf->event != 0) return NULL;
+
+  if ((p_buf->offset < L2CAP_MIN_OFFSET) ||
+      (bt_packet_tailroom(p_buf) < L2C_FCR_TAILROOM))
+    return NULL;
+
+  return bt_packet_ref(p_buf);
+}
+
 /*******************************************************************************
  *
  * Function         l2c_fcr_is_flow_controlled
@@ -862,12 +928,17 @@ void l2c_lcc_proc_pdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
       return;
     }
 
-    p_data = (BT_HDR*)osi_malloc(L2CAP_MAX_BUF_SIZE);
-    if (p_data == NULL) {
-      osi_free(p_buf);
+    if (sdu_length == p_buf->len) {
+      /* The whole SDU is in this PDU, pass its buffer up as is */
+      p_ccb->lcc_stats.rx_sdus++;
+      p_ccb->lcc_stats.rx_bytes += sdu_length;
+      p_ccb->lcc_stats.rx_zero_copy++;
+      l2c_csm_execute(p_ccb, L2CEVT_L2CAP_DATA, p_buf);
       return;
     }
 
+    p_data = (BT_HDR*)osi_malloc(BT_HDR_SIZE + sdu_length);
+
     p_ccb->ble_sdu = p_data;
     p_data->len = 0;
     p_ccb->ble_sdu_length = sdu_length;
@@ -898,6 +969,8 @@ void l2c_lcc_proc_pdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
   p_data->len += p_buf->len;
   p = (uint8_t*)(p_data + 1) + p_data->offset;
   if (p_data->len == p_ccb->ble_sdu_length) {
+    p_ccb->lcc_stats.rx_sdus++;
+    p_ccb->lcc_stats.rx_bytes += p_data->len;
     l2c_csm_execute(p_ccb, L2CEVT_L2CAP_DATA, p_data);
     p_ccb->is_first_seg = true;
     p_ccb->ble_sdu = NULL;
@@ -1033,8 +1106,8 @@ static bool process_reqseq(tL2C_CCB* p_ccb, uint16_t ctrl_word) {
 #endif
 
     for (xx = 0; xx < num_bufs_acked; xx++) {
-      BT_HDR* p_tmp =
-          (BT_HDR*)fixed_queue_try_dequeue(p_fcrb->waiting_for_ack_q);
+      tL2C_FCR_WACK* p_tmp =
+          (tL2C_FCR_WACK*)fixed_queue_try_dequeue(p_fcrb->waiting_for_ack_q);
       if (p_tmp == NULL) {
         L2CAP_TRACE_WARNING ("%s: Unable to dequeue", __func__);
         return (FALSE);
@@ -1044,7 +1117,7 @@ static bool process_reqseq(tL2C_CCB* p_ccb, uint16_t ctrl_word) {
       if ((ls == L2CAP_FCR_UNSEG_SDU) || (ls == L2CAP_FCR_END_SDU))
         full_sdus_xmitted++;
 
-      osi_free(p_tmp);
+      l2c_fcr_free_wack(p_tmp);
     }
 
     /* If we are still in a wait_ack state, do not mess with the timer */
@@ -1561,10 +1634,8 @@ static bool do_sar_reassembly(tL2C_CCB* p_ccb, BT_HDR* p_buf,
 static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq) {
   CHECK(p_ccb != NULL);
 
-  BT_HDR* p_buf = NULL;
-  uint8_t* p;
+  tL2C_FCR_WACK* p_wack = NULL;
   uint8_t buf_seq;
-  uint16_t ctrl_word;
 
   if ((!fixed_queue_is_empty(p_ccb->fcrb.waiting_for_ack_q)) &&
       (p_ccb->peer_cfg.fcr.max_transmit != 0) &&
@@ -1593,14 +1664,10 @@ static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq) {
     */
     if (list_ack != NULL) {
       for (; node_ack != list_end(list_ack); node_ack = list_next(node_ack)) {
-        p_buf = (BT_HDR*)list_node(node_ack);
-        /* Get the old control word */
-        p = ((uint8_t*)(p_buf + 1)) + p_buf->offset + L2CAP_PKT_OVERHEAD;
-
-        STREAM_TO_UINT16(ctrl_word, p);
+        p_wack = (tL2C_FCR_WACK*)list_node(node_ack);
 
-        buf_seq =
-            (ctrl_word & L2CAP_FCR_TX_SEQ_BITS) >> L2CAP_FCR_TX_SEQ_BITS_SHIFT;
+        buf_seq = (p_wack->ctrl_word & L2CAP_FCR_TX_SEQ_BITS) >>
+                  L2CAP_FCR_TX_SEQ_BITS_SHIFT;
 
         L2CAP_TRACE_DEBUG(
             "retransmit_i_frames()   cur seq: %u  looking for: %u", buf_seq,
@@ -1610,7 +1677,7 @@ static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq) {
       }
     }
 
-    if (!p_buf) {
+    if (!p_wack) {
       L2CAP_TRACE_ERROR("retransmit_i_frames() UNKNOWN seq: %u  q_count: %u",
                         tx_seq,
                         fixed_queue_length(p_ccb->fcrb.waiting_for_ack_q));
@@ -1640,15 +1707,11 @@ static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq) {
 
   if (list_ack != NULL) {
     while (node_ack != list_end(list_ack)) {
-      p_buf = (BT_HDR*)list_node(node_ack);
+      p_wack = (tL2C_FCR_WACK*)list_node(node_ack);
       node_ack = list_next(node_ack);
 
-      BT_HDR* p_buf2 = l2c_fcr_clone_buf(p_buf, p_buf->offset, p_buf->len);
-      if (p_buf2) {
-        p_buf2->layer_specific = p_buf->layer_specific;
-
-        fixed_queue_enqueue(p_ccb->fcrb.retrans_q, p_buf2);
-      }
+      BT_HDR* p_buf2 = l2c_fcr_build_wack_frame(p_ccb, p_wack);
+      if (p_buf2) fixed_queue_enqueue(p_ccb->fcrb.retrans_q, p_buf2);
 
       if ((tx_seq != L2C_FCR_RETX_ALL_PKTS) || (p_buf2 == NULL)) break;
     }
@@ -1684,6 +1747,9 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
   BT_HDR *p_buf, *p_xmit;
   uint8_t* p;
   uint16_t max_pdu = p_ccb->tx_mps /* Needed? - L2CAP_MAX_HEADER_FCS*/;
+  bool ertm = (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE);
+  bool sdu_done = false; /* The SDU was removed from the xmit_hold_q */
+  uint16_t seg_offset;   /* Offset of the segment in the SDU buffer */
 
   /* If there is anything in the retransmit queue, that goes first
   */
@@ -1716,6 +1782,8 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
     return NULL;
   }
 
+  seg_offset = p_buf->offset;
+
   /* If there is more data than the MPS, it requires segmentation */
   if (p_buf->len > max_pdu) {
     /* We are using the "event" field to tell is if we already started
@@ -1747,6 +1815,22 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
           "L2CAP - cannot get buffer for segmentation, max_pdu: %u", max_pdu);
       return (NULL);
     }
+  } else if (ertm) {
+    /* The SDU is kept until all its segments are acked. Unless it can be
+     * shared with HCI, which writes its headers into the buffer it sends and
+     * frees it, the last segment is copied as well */
+    p_xmit = l2c_fcr_share_buf(p_buf);
+    if (p_xmit == NULL)
+      p_xmit = l2c_fcr_clone_buf(
+          p_buf, L2CAP_MIN_OFFSET + L2CAP_SDU_LEN_OFFSET, p_buf->len);
+
+    if (p_buf->event != 0) last_seg = true;
+
+    fixed_queue_try_dequeue(p_ccb->xmit_hold_q);
+    sdu_done = true;
+
+    p_xmit->event = p_ccb->local_cid;
+    p_xmit->layer_specific = p_buf->layer_specific;
   } else /* Use the original buffer if no segmentation, or the last segment */
   {
     void *seg_msg = fixed_queue_try_dequeue(p_ccb->xmit_hold_q);
@@ -1799,36 +1883,39 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
 
   prepare_I_frame(p_ccb, p_xmit, false);
 
-  if (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE) {
-    BT_HDR* p_wack =
-        l2c_fcr_clone_buf(p_xmit, HCI_DATA_PREAMBLE_SIZE, p_xmit->len);
+  if (ertm) {
+    /* Keep a reference to the payload in the SDU for retransmission */
+    tL2C_FCR_SDU* p_sdu = p_ccb->fcrb.p_tx_sdu;
+    if (p_sdu == NULL) {
+      p_sdu = (tL2C_FCR_SDU*)osi_malloc(sizeof(tL2C_FCR_SDU));
+      p_sdu->p_buf = p_buf;
+      p_sdu->ref_count = 1; /* The xmit_hold_q reference */
+      p_ccb->fcrb.p_tx_sdu = p_sdu;
+    }
 
-    if (!p_wack) {
-      L2CAP_TRACE_ERROR(
-          "L2CAP - no buffer for xmit cloning, CID: 0x%04x  Length: %u",
-          p_ccb->local_cid, p_xmit->len);
+    tL2C_FCR_WACK* p_wack = (tL2C_FCR_WACK*)osi_malloc(sizeof(tL2C_FCR_WACK));
+    p_wack->p_sdu = p_sdu;
+    p_sdu->ref_count++;
 
-      /* We will not save the FCS in case we reconfigure and change options */
-      if (p_ccb->bypass_fcs != L2CAP_BYPASS_FCS) p_xmit->len -= L2CAP_FCS_LEN;
+    p_wack->offset = seg_offset;
+    /* We will not save the FCS in case we reconfigure and change options */
+    p_wack->len = p_xmit->len;
+    if (p_ccb->bypass_fcs != L2CAP_BYPASS_FCS) p_wack->len -= L2CAP_FCS_LEN;
+    p_wack->layer_specific = p_xmit->layer_specific;
+    p_wack->sdu_len = sdu_len;
+
+    p = (uint8_t*)(p_xmit + 1) + p_xmit->offset + L2CAP_PKT_OVERHEAD;
+    STREAM_TO_UINT16(p_wack->ctrl_word, p);
 
-      /* Pretend we sent it and it got lost */
-      fixed_queue_enqueue(p_ccb->fcrb.waiting_for_ack_q, p_xmit);
-      return (NULL);
-    } else {
 #if (L2CAP_ERTM_STATS == TRUE)
-      /* set timestamp at the end of tx I-frame to get acking delay */
-      /*
-       * NOTE: Here we assume the allocate buffer is large enough
-       * to include extra 4 octets at the end.
-       */
-      p = ((uint8_t*)(p_wack + 1)) + p_wack->offset + p_wack->len;
-      UINT32_TO_STREAM(p, time_get_os_boottime_ms());
+    /* set timestamp of tx I-frame to get acking delay */
+    p_wack->timestamp = time_get_os_boottime_ms();
 #endif
-      /* We will not save the FCS in case we reconfigure and change options */
-      if (p_ccb->bypass_fcs != L2CAP_BYPASS_FCS) p_wack->len -= L2CAP_FCS_LEN;
+    fixed_queue_enqueue(p_ccb->fcrb.waiting_for_ack_q, p_wack);
 
-      p_wack->layer_specific = p_xmit->layer_specific;
-      fixed_queue_enqueue(p_ccb->fcrb.waiting_for_ack_q, p_wack);
+    if (sdu_done) {
+      p_ccb->fcrb.p_tx_sdu = NULL;
+      l2c_fcr_sdu_unref(p_sdu);
     }
 
 #if (L2CAP_ERTM_STATS == TRUE)
@@ -1884,15 +1971,18 @@ BT_HDR* l2c_lcc_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
     no_of_bytes_to_send = max_pdu;
   }
 
-  /* Get a new buffer and copy the data that can be sent in a PDU */
-  if (first_seg == true)
-    p_xmit = l2c_fcr_clone_buf(p_buf, L2CAP_LCC_OFFSET, no_of_bytes_to_send);
-  else
-    p_xmit = l2c_fcr_clone_buf(p_buf, L2CAP_MIN_OFFSET, no_of_bytes_to_send);
+  if (first_seg == true) {
+    p_ccb->lcc_stats.tx_sdus++;
+    p_ccb->lcc_stats.tx_bytes += sdu_len;
+  }
 
-  if (p_xmit != NULL) {
-    p_buf->event = p_ccb->local_cid;
+  if (last_seg == true &&
+      p_buf->offset >= (first_seg ? L2CAP_LCC_OFFSET : L2CAP_MIN_OFFSET)) {
+    /* The rest of the SDU fits in the PDU and its buffer has room for the
+     * headers, send it as is */
+    p_xmit = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->xmit_hold_q);
     p_xmit->event = p_ccb->local_cid;
+    p_ccb->lcc_stats.tx_zero_copy++;
 
     if (first_seg == true) {
       p_xmit->offset -= L2CAP_LCC_SDU_LENGTH; /* for writing the SDU length. */
@@ -1900,23 +1990,42 @@ BT_HDR* l2c_lcc_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
       UINT16_TO_STREAM(p, sdu_len);
       p_xmit->len += L2CAP_LCC_SDU_LENGTH;
     }
+  } else {
+    /* Get a new buffer and copy the data that can be sent in a PDU */
+    if (first_seg == true)
+      p_xmit = l2c_fcr_clone_buf(p_buf, L2CAP_LCC_OFFSET, no_of_bytes_to_send);
+    else
+      p_xmit = l2c_fcr_clone_buf(p_buf, L2CAP_MIN_OFFSET, no_of_bytes_to_send);
 
-    p_buf->len -= no_of_bytes_to_send;
-    p_buf->offset += no_of_bytes_to_send;
+    if (p_xmit != NULL) {
+      p_buf->event = p_ccb->local_cid;
+      p_xmit->event = p_ccb->local_cid;
 
-    /* copy PBF setting */
-    p_xmit->layer_specific = p_buf->layer_specific;
+      if (first_seg == true) {
+        /* for writing the SDU length. */
+        p_xmit->offset -= L2CAP_LCC_SDU_LENGTH;
+        p = (uint8_t*)(p_xmit + 1) + p_xmit->offset;
+        UINT16_TO_STREAM(p, sdu_len);
+        p_xmit->len += L2CAP_LCC_SDU_LENGTH;
+      }
 
-  } else /* Should never happen if the application has configured buffers
-            correctly */
-  {
-    L2CAP_TRACE_ERROR("L2CAP - cannot get buffer, for segmentation");
-    return (NULL);
-  }
+      p_buf->len -= no_of_bytes_to_send;
+      p_buf->offset += no_of_bytes_to_send;
 
-  if (last_seg == true) {
-    p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->xmit_hold_q);
-    osi_free(p_buf);
+      /* copy PBF setting */
+      p_xmit->layer_specific = p_buf->layer_specific;
+
+    } else /* Should never happen if the application has configured buffers
+              correctly */
+    {
+      L2CAP_TRACE_ERROR("L2CAP - cannot get buffer, for segmentation");
+      return (NULL);
+    }
+
+    if (last_seg == true) {
+      p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->xmit_hold_q);
+      osi_free(p_buf);
+    }
   }
 
   /* Step back to add the L2CAP headers */
@@ -2408,8 +2517,7 @@ uint8_t l2c_fcr_process_peer_cfg_req(tL2C_CCB* p_ccb, tL2CAP_CFG_INFO* p_cfg) {
  ******************************************************************************/
 static void l2c_fcr_collect_ack_delay(tL2C_CCB* p_ccb, uint8_t num_bufs_acked) {
   uint32_t index;
-  BT_HDR* p_buf;
-  uint8_t* p;
+  tL2C_FCR_WACK* p_wack;
   uint32_t timestamp, delay;
   uint8_t xx;
   uint8_t str[120];
@@ -2438,19 +2546,13 @@ static void l2c_fcr_collect_ack_delay(tL2C_CCB* p_ccb, uint8_t num_bufs_acked) {
     for (const list_node_t *node = list_begin(list), xx = 0;
          (node != list_end(list)) && (xx < num_bufs_acked);
          node = list_next(node), xx++) {
-      p_buf = list_node(node);
+      p_wack = (tL2C_FCR_WACK*)list_node(node);
       /* adding up length of acked I-frames to get throughput */
-      p_ccb->fcrb.throughput[index] += p_buf->len - 8;
+      p_ccb->fcrb.throughput[index] += p_wack->len - 8;
 
       if (xx == num_bufs_acked - 1) {
         /* get timestamp from tx I-frame that receiver is acking */
-        p = ((uint8_t*)(p_buf + 1)) + p_buf->offset + p_buf->len;
-        if (p_ccb->bypass_fcs != L2CAP_BYPASS_FCS) {
-          p += L2CAP_FCS_LEN;
-        }
-
-        STREAM_TO_UINT32(timestamp, p);
-        delay = time_get_os_boottime_ms() - timestamp;
+        delay = time_get_os_boottime_ms() - p_wack->timestamp;
 
         p_ccb->fcrb.ack_delay_avg[index] += delay;
         if (delay > p_ccb->fcrb.ack_delay_max[index])
@@ -0,0 +1,81 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the L2CAP Frame Check Sequence computation, the CRC-16
+ *  with generator polynomial x^16 + x^15 + x^2 + 1 used in Enhanced
+ *  Retransmission and Streaming modes.
+ *
+ *  The CRC is computed 8 bytes at a time with the slice-by-8 method: table k
+ *  gives the CRC of a byte followed by k zero bytes, so that the 8 bytes of a
+ *  block are looked up independently of each other.
+ *
+ ******************************************************************************/
+
+#include "l2c_fcs.h"
+
+/* Reflected generator polynomial */
+#define L2C_FCS_POLYNOMIAL 0xA001
+
+typedef struct { uint16_t table[8][256]; } tL2C_FCS_TABLES;
+
+static constexpr tL2C_FCS_TABLES l2c_fcs_make_tables() {
+  tL2C_FCS_TABLES t = {};
+
+  for (int i = 0; i < 256; i++) {
+    uint16_t crc = i;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc & 1) ? (crc >> 1) ^ L2C_FCS_POLYNOMIAL : (crc >> 1);
+    t.table[0][i] = crc;
+  }
+
+  for (int k = 1; k < 8; k++) {
+    for (int i = 0; i < 256; i++) {
+      uint16_t crc = t.table[k - 1][i];
+      t.table[k][i] = (crc >> 8) ^ t.table[0][crc & 0xff];
+    }
+  }
+
+  return t;
+}
+
+static constexpr tL2C_FCS_TABLES l2c_fcs_tables = l2c_fcs_make_tables();
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_updcrc
+ *
+ * Description      This function computes the CRC using the look-up tables.
+ *
+ * Returns          CRC
+ *
+ ******************************************************************************/
+uint16_t l2c_fcr_updcrc(uint16_t crc, const uint8_t* p, uint32_t len) {
+  const uint16_t(*t)[256] = l2c_fcs_tables.table;
+
+  for (; len >= 8; len -= 8, p += 8) {
+    uint32_t lo = (p[0] | (p[1] << 8)) ^ crc;
+    crc = t[7][lo & 0xff] ^ t[6][lo >> 8] ^ t[5][p[2]] ^ t[4][p[3]] ^
+          t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+  }
+
+  while (len--) crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+
+  return crc;
+}
@@ -56,6 +56,18 @@ constexpr uint16_t L2CAP_LE_CREDIT_THRESHOLD = 0x0040;
 static_assert(L2CAP_LE_CREDIT_THRESHOLD < L2CAP_LE_CREDIT_DEFAULT,
               "Threshold must be smaller then default credits");
 
+/* LE CoC throughput and credit statistics of a channel */
+typedef struct {
+  uint32_t tx_sdus;          /* SDUs sent */
+  uint64_t tx_bytes;         /* SDU bytes sent */
+  uint32_t tx_zero_copy;     /* PDUs sent in the SDU buffer itself */
+  uint32_t tx_credit_stalls; /* Times the peer credits ran out with data left */
+  uint32_t rx_sdus;          /* SDUs received */
+  uint64_t rx_bytes;         /* SDU bytes received */
+  uint32_t rx_zero_copy;     /* SDUs received in a single PDU, not copied */
+  uint32_t credit_returns;   /* Flow Control Credit packets sent */
+} tL2C_LCC_STATS;
+
 /*
  * Timeout values (in milliseconds).
  */
@@ -183,6 +195,29 @@ typedef enum {
 
 typedef uint8_t tL2C_BLE_FIXED_CHNLS_MASK;
 
+/* An SDU whose segments are waiting for ack. The segments refer to the SDU
+ * payload instead of holding a copy of it, and the buffer is freed when the
+ * last reference is dropped. While the SDU is still in the xmit_hold_q, that
+ * queue holds a reference too. */
+typedef struct {
+  BT_HDR* p_buf;      /* The SDU, NULL once freed through the xmit_hold_q */
+  uint16_t ref_count; /* Segments in waiting_for_ack_q, plus the hold queue */
+} tL2C_FCR_SDU;
+
+/* An I-frame waiting for ack. Only the fields needed to rebuild the frame for
+ * retransmission are kept; the payload stays in the SDU. */
+typedef struct {
+  tL2C_FCR_SDU* p_sdu;     /* SDU holding the payload */
+  uint16_t offset;         /* Offset of the payload in the SDU buffer */
+  uint16_t len;            /* Length of the I-frame, without FCS */
+  uint16_t layer_specific; /* SAR type and flushable flag */
+  uint16_t ctrl_word;      /* Control word of the last transmission */
+  uint16_t sdu_len;        /* SDU length field of a start segment */
+#if (L2CAP_ERTM_STATS == TRUE)
+  uint32_t timestamp; /* Time of the first transmission */
+#endif
+} tL2C_FCR_WACK;
+
 typedef struct {
   uint8_t next_tx_seq;       /* Next sequence number to be Tx'ed */
   uint8_t last_rx_ack;       /* Last sequence number ack'ed by the peer */
@@ -203,8 +238,9 @@ typedef struct {
 
   uint16_t rx_sdu_len; /* Length of the SDU being received */
   BT_HDR* p_rx_sdu;    /* Buffer holding the SDU being received */
+  tL2C_FCR_SDU* p_tx_sdu; /* SDU being segmented, still in the xmit_hold_q */
   fixed_queue_t*
-      waiting_for_ack_q;          /* Buffers sent and waiting for peer to ack */
+      waiting_for_ack_q;          /* I-frames sent and waiting for peer to ack */
   fixed_queue_t* srej_rcv_hold_q; /* Buffers rcvd but held pending SREJ rsp */
   fixed_queue_t* retrans_q;       /* Buffers being retransmitted */
 
@@ -334,6 +370,7 @@ typedef struct t_l2c_ccb {
   uint16_t buff_quota;        /* Buffer quota before sending congestion */
 
   tL2CAP_CHNL_PRIORITY ccb_priority;  /* Channel priority */
+  bool latency_critical; /* Served ahead of the other channels of the link */
   tL2CAP_CHNL_DATA_RATE tx_data_rate; /* Channel Tx data rate */
   tL2CAP_CHNL_DATA_RATE rx_data_rate; /* Channel Rx data rate */
 
@@ -364,6 +401,8 @@ typedef struct t_l2c_ccb {
   /* Number of LE frames that the remote can send to us (credit count in
    * remote). Valid only for LE CoC */
   uint16_t remote_credit_count;
+
+  tL2C_LCC_STATS lcc_stats; /* Valid only for LE CoC */
 } tL2C_CCB;
 
 /***********************************************************************
@@ -379,8 +418,10 @@ typedef struct {
 /* Round-Robin service for the same priority channels */
 #define L2CAP_NUM_CHNL_PRIORITY \
   3 /* Total number of priority group (high, medium, low)*/
+#ifndef L2CAP_CHNL_PRIORITY_WEIGHT
 #define L2CAP_CHNL_PRIORITY_WEIGHT \
   5 /* weight per priority for burst transmission quota */
+#endif
 #define L2CAP_GET_PRIORITY_QUOTA(pri) \
   ((L2CAP_NUM_CHNL_PRIORITY - (pri)) * L2CAP_CHNL_PRIORITY_WEIGHT)
 
@@ -399,6 +440,69 @@ typedef struct {
 
 #endif /* (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE) */
 
+/* ACL credit usage statistics of a link */
+typedef struct {
+  uint32_t tx_acl_pkts;         /* ACL packets sent to the controller */
+  uint32_t rx_acl_pkts;         /* ACL packets received from the controller */
+  uint32_t tx_latency_critical; /* PDUs of latency critical channels */
+  uint32_t quota_full;          /* Times the link used all of its quota */
+  uint32_t reserve_holds; /* Times data waited on the latency critical reserve */
+  uint16_t max_sent_not_acked;  /* Most packets in the controller at once */
+  period_ms_t quota_full_ms;  /* When the link used all of its quota, or 0 */
+  period_ms_t starved_ms;     /* Time spent with all of the quota used */
+  period_ms_t max_starved_ms; /* Longest time with all of the quota used */
+  period_ms_t start_ms;         /* When the link control block was allocated */
+#if (L2CAP_NUM_FIXED_CHNLS > 0)
+  uint32_t rx_fixed_pkts[L2CAP_NUM_FIXED_CHNLS];  /* PDUs per fixed channel */
+  uint32_t rx_fixed_bytes[L2CAP_NUM_FIXED_CHNLS]; /* Bytes per fixed channel */
+#endif
+} tL2C_LINK_STATS;
+
+/* LE connection parameters requested by a local user of a link */
+typedef struct {
+  bool in_use;
+  uint16_t min_interval;
+  uint16_t max_interval;
+  uint16_t latency;
+  uint16_t timeout;
+  uint16_t min_ce_len;
+  uint16_t max_ce_len;
+} tL2C_BLE_CONN_REQ;
+
+/* The connection parameters were requested by the peer */
+#define L2C_BLE_CONN_USER_PEER L2CA_BLE_CONN_NUM_USERS
+/* The link still uses the parameters it was created with */
+#define L2C_BLE_CONN_USER_NONE (L2CA_BLE_CONN_NUM_USERS + 1)
+
+/* Number of LE connection parameter updates kept for the debug dump */
+#ifndef L2C_BLE_CONN_UPDATE_HISTORY_SIZE
+#define L2C_BLE_CONN_UPDATE_HISTORY_SIZE 16
+#endif
+
+/* An LE link moves to the largest data length and the 2M PHY once it carries
+ * L2C_BLE_BULK_MIN_PKTS ACL packets per window of L2C_BLE_BULK_WINDOW_MS for
+ * L2C_BLE_BULK_WINDOWS windows in a row */
+#ifndef L2C_BLE_BULK_LINK_POLICY
+#define L2C_BLE_BULK_LINK_POLICY TRUE
+#endif
+
+#ifndef L2C_BLE_BULK_WINDOW_MS
+#define L2C_BLE_BULK_WINDOW_MS 1000
+#endif
+
+#ifndef L2C_BLE_BULK_MIN_PKTS
+#define L2C_BLE_BULK_MIN_PKTS 50
+#endif
+
+#ifndef L2C_BLE_BULK_WINDOWS
+#define L2C_BLE_BULK_WINDOWS 3
+#endif
+
+/* Number of peers kept on the 1M PHY after their link failed on the 2M PHY */
+#ifndef L2C_BLE_PHY_FALLBACK_SIZE
+#define L2C_BLE_PHY_FALLBACK_SIZE 8
+#endif
+
 /* Define a link control block. There is one link control block between
  * this device and any other device (i.e. BD ADDR).
 */
@@ -477,6 +581,18 @@ typedef struct t_l2c_linkcb {
   uint16_t min_ce_len;
   uint16_t max_ce_len;
 
+  /* Connection parameters requested by each local user, see
+   * L2CA_RequestBleConnParams */
+  tL2C_BLE_CONN_REQ conn_req[L2CA_BLE_CONN_NUM_USERS];
+  uint8_t conn_req_user; /* a local user, L2C_BLE_CONN_USER_PEER or _NONE */
+  uint8_t tx_phy;        /* LE PHY used to transmit, 0 if not updated */
+
+  /* Sustained traffic detection, see l2cble_track_throughput */
+  bool bulk_link;            /* the largest data length and 2M were requested */
+  uint8_t bulk_windows;      /* windows in a row with sustained traffic */
+  uint32_t bulk_window_pkts; /* ACL packets when the window started */
+  period_ms_t bulk_window_ms; /* when the window started */
+
 #if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
   /* each priority group is limited burst transmission */
   /* round robin service for the same priority channels */
@@ -484,6 +600,8 @@ typedef struct t_l2c_linkcb {
   uint8_t rr_pri; /* current serving priority group */
 #endif
 
+  uint8_t latency_critical_burst; /* Latency critical PDUs sent in a row */
+  tL2C_LINK_STATS link_stats;
 } tL2C_LCB;
 
 /* Define the L2CAP control structure
@@ -500,6 +618,21 @@ typedef struct {
 
   tL2C_LCB lcb_pool[MAX_L2CAP_LINKS];    /* Link Control Block pool */
   tL2C_CCB ccb_pool[MAX_L2CAP_CHANNELS]; /* Channel Control Block pool */
+
+/* Number of entries in the handle-indexed and the address-indexed LCB
+ * tables, powers of two with room for all the links */
+#if (MAX_L2CAP_LINKS <= 8)
+#define L2CAP_LCB_HANDLE_TABLE_SIZE 16
+#elif (MAX_L2CAP_LINKS <= 32)
+#define L2CAP_LCB_HANDLE_TABLE_SIZE 64
+#else
+#define L2CAP_LCB_HANDLE_TABLE_SIZE 256
+#endif
+#define L2CAP_LCB_ADDR_TABLE_SIZE L2CAP_LCB_HANDLE_TABLE_SIZE
+  /* LCB last found for each handle, indexed by the low bits of the handle */
+  tL2C_LCB* p_lcb_by_handle[L2CAP_LCB_HANDLE_TABLE_SIZE];
+  /* LCB last found for each address and transport, indexed by their hash */
+  tL2C_LCB* p_lcb_by_addr[L2CAP_LCB_ADDR_TABLE_SIZE];
   tL2C_RCB rcb_pool[MAX_L2CAP_CLIENTS];  /* Registration info pool */
 
   tL2C_CCB* p_free_ccb_first; /* Pointer to first free CCB */
@@ -555,6 +688,7 @@ typedef struct {
   bool le_dyn_psm_assigned[LE_DYNAMIC_PSM_RANGE]; /* Table of assigned LE PSM */
   uint8_t cert_failure; /*Insufficient Enc case for certification */
 
+  uint16_t le_credit_threshold; /* Credits left in remote when we send more */
 } tL2C_CB;
 
 /* Define a structure that contains the information about a connection.
@@ -765,7 +899,8 @@ extern void l2c_info_resp_timer_timeout(void* data);
 extern void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb,
                                      BT_HDR* p_buf);
 extern void l2c_link_adjust_allocation(void);
-extern void l2c_link_process_num_completed_pkts(uint8_t* p);
+extern void l2c_link_process_num_completed_pkts(uint8_t* p,
+                                                uint8_t evt_len);
 extern void l2c_link_process_num_completed_blocks(uint8_t controller_id,
                                                   uint8_t* p, uint16_t evt_len);
 extern void l2c_link_processs_num_bufs(uint16_t num_lm_acl_bufs);
@@ -812,6 +947,7 @@ extern void l2c_fcr_send_S_frame(tL2C_CCB* p_ccb, uint16_t function_code,
                                  uint16_t pf_bit);
 extern BT_HDR* l2c_fcr_clone_buf(BT_HDR* p_buf, uint16_t new_offset,
                                  uint16_t no_of_bytes);
+extern void l2c_fcr_free_xmit_sdu(tL2C_CCB* p_ccb, BT_HDR* p_buf);
 extern bool l2c_fcr_is_flow_controlled(tL2C_CCB* p_ccb);
 extern BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
                                              uint16_t max_packet_length);
@@ -843,6 +979,7 @@ extern void l2cble_conn_comp(uint16_t handle, uint8_t role,
                              uint16_t conn_interval, uint16_t conn_latency,
                              uint16_t conn_timeout);
 extern void l2cble_notify_le_connection(const RawAddress& bda);
+extern void l2cble_notify_le_data(tL2C_LCB* p_lcb);
 extern void l2c_ble_link_adjust_allocation(void);
 extern void l2cble_process_conn_update_evt(uint16_t handle, uint8_t status,
                                            uint16_t interval, uint16_t latency,
@@ -873,6 +1010,12 @@ extern void l2cble_set_fixed_channel_tx_data_length(
 extern void l2cble_process_data_length_change_event(uint16_t handle,
                                                     uint16_t tx_data_len,
                                                     uint16_t rx_data_len);
+extern void l2cble_process_phy_update(uint16_t handle, uint8_t status,
+                                      uint8_t tx_phy);
+extern void l2cble_track_throughput(tL2C_LCB* p_lcb);
+extern void l2cble_process_link_loss(tL2C_LCB* p_lcb, uint8_t reason);
+extern void l2cble_conn_params_debug_dump(const tL2C_LCB* p_lcb, int fd);
+extern void l2cble_conn_update_history_dump(int fd);
 
 extern void l2cu_process_fixed_disc_cback(tL2C_LCB* p_lcb);
 
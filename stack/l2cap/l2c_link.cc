@@ -25,11 +25,13 @@
  ******************************************************************************/
 
 #include <base/logging.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "bt_common.h"
+#include "bt_trace_span.h"
 #include "bt_types.h"
 #include "bt_utils.h"
 #include "btm_api.h"
@@ -42,6 +44,7 @@
 #include "l2c_int.h"
 #include "l2cdefs.h"
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 #include "device/include/device_iot_config.h"
 #include "btif/include/btif_av.h"
 
@@ -426,8 +429,10 @@ bool l2c_link_hci_disc_comp(uint16_t handle, uint8_t reason) {
     p_lcb->link_state = LST_DISCONNECTING;
 
     /* Check for BLE and handle that differently */
-    if (p_lcb->transport == BT_TRANSPORT_LE)
+    if (p_lcb->transport == BT_TRANSPORT_LE) {
       btm_ble_update_link_topology_mask(p_lcb->link_role, false);
+      l2cble_process_link_loss(p_lcb, reason);
+    }
     /* Link is disconnected. For all channels, send the event through */
     /* their FSMs. The CCBs should remove themselves from the LCB     */
     for (p_ccb = p_lcb->ccb_queue.p_first_ccb; p_ccb;) {
@@ -1171,6 +1176,12 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
       }
     }
 
+    if (p_lcb->sent_not_acked >= p_lcb->link_xmit_quota) {
+      p_lcb->link_stats.quota_full++;
+      if (p_lcb->link_stats.quota_full_ms == 0)
+        p_lcb->link_stats.quota_full_ms = time_get_os_boottime_ms();
+    }
+
     /* There is a special case where we have readjusted the link quotas and  */
     /* this link may have sent anything but some other link sent packets so  */
     /* so we may need a timer to kick off this link's transmissions.         */
@@ -1194,8 +1205,10 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
  ******************************************************************************/
 static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf,
                                    tL2C_TX_COMPLETE_CB_INFO* p_cbi) {
+  BT_TRACE_PACKET_SCOPE("l2c send", p_buf);
   uint16_t num_segs;
   uint16_t xmit_window, acl_data_size;
+  uint16_t sent_not_acked = p_lcb->sent_not_acked;
   const controller_t* controller = controller_get_interface();
 
   if ((p_buf->len <= controller->get_acl_packet_size_classic() &&
@@ -1267,6 +1280,11 @@ static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf,
     }
   }
 
+  p_lcb->link_stats.tx_acl_pkts += p_lcb->sent_not_acked - sent_not_acked;
+  if (p_lcb->sent_not_acked > p_lcb->link_stats.max_sent_not_acked)
+    p_lcb->link_stats.max_sent_not_acked = p_lcb->sent_not_acked;
+  if (p_lcb->transport == BT_TRANSPORT_LE) l2cble_track_throughput(p_lcb);
+
 #if (L2CAP_HCI_FLOW_CONTROL_DEBUG == TRUE)
   if (p_lcb->transport == BT_TRANSPORT_LE) {
     L2CAP_TRACE_DEBUG(
@@ -1299,7 +1317,7 @@ static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf,
  * Returns          void
  *
  ******************************************************************************/
-void l2c_link_process_num_completed_pkts(uint8_t* p) {
+void l2c_link_process_num_completed_pkts(uint8_t* p, uint8_t evt_len) {
   uint8_t num_handles, xx;
   uint16_t handle;
   uint16_t num_sent;
@@ -1307,6 +1325,20 @@ void l2c_link_process_num_completed_pkts(uint8_t* p) {
 
   STREAM_TO_UINT8(num_handles, p);
 
+  /* Each handle takes 4 octets, only use the ones that are all there */
+  if (num_handles > (evt_len - 1) / 4) {
+    L2CAP_TRACE_ERROR("%s: %d handles do not fit in an event of size %d",
+                      __func__, num_handles, evt_len);
+    num_handles = (evt_len - 1) / 4;
+  }
+
+  /* The credits of all the handles are returned first, then only the links
+   * that got credits back are served, and the round-robin links once. */
+  tL2C_LCB* served[MAX_L2CAP_LINKS];
+  int num_served = 0;
+  tL2C_LCB* p_rr_lcb = NULL;
+  bool check_round_robin = false;
+
   for (xx = 0; xx < num_handles; xx++) {
     STREAM_TO_UINT16(handle, p);
     /* Extract the handle */
@@ -1352,19 +1384,37 @@ void l2c_link_process_num_completed_pkts(uint8_t* p) {
       else
         p_lcb->sent_not_acked = 0;
 
-      l2c_link_check_send_pkts(p_lcb, NULL, NULL);
+      tL2C_LINK_STATS* p_stats = &p_lcb->link_stats;
+      if (num_sent != 0 && p_stats->quota_full_ms != 0) {
+        period_ms_t starved_ms =
+            time_get_os_boottime_ms() - p_stats->quota_full_ms;
+        p_stats->starved_ms += starved_ms;
+        if (starved_ms > p_stats->max_starved_ms)
+          p_stats->max_starved_ms = starved_ms;
+        p_stats->quota_full_ms = 0;
+      }
+
+      if (p_lcb->link_xmit_quota == 0) {
+        p_rr_lcb = p_lcb;
+      } else if (num_sent != 0) {
+        int yy;
+        for (yy = 0; yy < num_served && served[yy] != p_lcb; yy++)
+          ;
+        if (yy == num_served && num_served < MAX_L2CAP_LINKS)
+          served[num_served++] = p_lcb;
+      }
 
       /* If we were doing round-robin for low priority links, check 'em */
       if ((p_lcb->acl_priority == L2CAP_PRIORITY_HIGH) &&
           (l2cb.check_round_robin) &&
           (l2cb.round_robin_unacked < l2cb.round_robin_quota)) {
-        l2c_link_check_send_pkts(NULL, NULL, NULL);
+        check_round_robin = true;
       }
       if ((p_lcb->transport == BT_TRANSPORT_LE) &&
           (p_lcb->acl_priority == L2CAP_PRIORITY_HIGH) &&
           ((l2cb.ble_check_round_robin) &&
            (l2cb.ble_round_robin_unacked < l2cb.ble_round_robin_quota))) {
-        l2c_link_check_send_pkts(NULL, NULL, NULL);
+        check_round_robin = true;
       }
     }
 
@@ -1390,6 +1440,14 @@ void l2c_link_process_num_completed_pkts(uint8_t* p) {
     }
 #endif
   }
+
+  for (xx = 0; xx < num_served; xx++)
+    l2c_link_check_send_pkts(served[xx], NULL, NULL);
+  /* Round-robin starts after the last round-robin link that got credits */
+  if (p_rr_lcb != NULL)
+    l2c_link_check_send_pkts(p_rr_lcb, NULL, NULL);
+  else if (check_round_robin)
+    l2c_link_check_send_pkts(NULL, NULL, NULL);
 }
 
 /*******************************************************************************
@@ -1431,3 +1489,61 @@ void l2c_link_segments_xmitted(BT_HDR* p_msg) {
   } else
     osi_free(p_msg);
 }
+
+/*******************************************************************************
+ *
+ * Function         L2CA_LinkDebugDump
+ *
+ * Description      This function dumps the ACL credit usage of the links.
+ *
+ * Parameters:      fd         - file descriptor to write to
+ *
+ ******************************************************************************/
+void L2CA_LinkDebugDump(int fd) {
+  dprintf(fd, "\nL2CAP links:\n");
+  dprintf(fd,
+          "  BR/EDR window: %d, round-robin (quota/unacked): %d / %d\n"
+          "  LE window: %d, round-robin (quota/unacked): %d / %d\n",
+          l2cb.controller_xmit_window, l2cb.round_robin_quota,
+          l2cb.round_robin_unacked, l2cb.controller_le_xmit_window,
+          l2cb.ble_round_robin_quota, l2cb.ble_round_robin_unacked);
+  for (int xx = 0; xx < MAX_L2CAP_LINKS; xx++) {
+    tL2C_LCB* p_lcb = &l2cb.lcb_pool[xx];
+    if (!p_lcb->in_use) continue;
+
+    const tL2C_LINK_STATS* p_stats = &p_lcb->link_stats;
+    dprintf(fd, "  handle: 0x%04x, %s, priority: %s\n", p_lcb->handle,
+            (p_lcb->transport == BT_TRANSPORT_LE) ? "LE" : "BR/EDR",
+            (p_lcb->acl_priority == L2CAP_PRIORITY_HIGH) ? "high" : "normal");
+    dprintf(fd,
+            "    quota: %d, in controller (current/max): %d / %d, ACL packets "
+            "(tx/rx): %u / %u, quota full: %u\n",
+            p_lcb->link_xmit_quota, p_lcb->sent_not_acked,
+            p_stats->max_sent_not_acked, p_stats->tx_acl_pkts,
+            p_stats->rx_acl_pkts, p_stats->quota_full);
+    dprintf(fd, "    latency critical PDUs: %u, reserve holds: %u\n",
+            p_stats->tx_latency_critical, p_stats->reserve_holds);
+    dprintf(fd,
+            "    quota full time (total/max): %" PRIu64 " / %" PRIu64 " ms\n",
+            p_stats->starved_ms, p_stats->max_starved_ms);
+
+#if (L2CAP_NUM_FIXED_CHNLS > 0)
+    period_ms_t up_ms = time_get_os_boottime_ms() - p_stats->start_ms;
+    for (int yy = 0; yy < L2CAP_NUM_FIXED_CHNLS; yy++) {
+      if (p_stats->rx_fixed_pkts[yy] == 0) continue;
+      dprintf(fd,
+              "    fixed CID 0x%04x RX PDUs: %u (%u bytes), rate: %" PRIu64
+              " PDUs/min\n",
+              yy + L2CAP_FIRST_FIXED_CHNL, p_stats->rx_fixed_pkts[yy],
+              p_stats->rx_fixed_bytes[yy],
+              (up_ms > 0) ? (uint64_t)p_stats->rx_fixed_pkts[yy] * 60000 / up_ms
+                          : 0);
+    }
+#endif
+
+    if (p_lcb->transport == BT_TRANSPORT_LE)
+      l2cble_conn_params_debug_dump(p_lcb, fd);
+  }
+
+  l2cble_conn_update_history_dump(fd);
+}
@@ -30,6 +30,7 @@
 
 #include "bt_common.h"
 #include "bt_target.h"
+#include "bt_trace_span.h"
 #include "btm_int.h"
 #include "btu.h"
 #include "device/include/controller.h"
@@ -66,6 +67,7 @@ tL2C_CB l2cb;
  *
  ******************************************************************************/
 void l2c_rcv_acl_data(BT_HDR* p_msg) {
+  BT_TRACE_PACKET_SCOPE("l2c rx", p_msg);
   uint8_t* p = (uint8_t*)(p_msg + 1) + p_msg->offset;
   uint16_t handle, hci_len;
   uint8_t pkt_type;
@@ -127,6 +129,8 @@ void l2c_rcv_acl_data(BT_HDR* p_msg) {
       osi_free(p_msg);
       return;
     }
+    p_lcb->link_stats.rx_acl_pkts++;
+    if (p_lcb->transport == BT_TRANSPORT_LE) l2cble_track_throughput(p_lcb);
   } else {
     L2CAP_TRACE_WARNING("L2CAP - expected pkt start or complete, got: %d",
                         pkt_type);
@@ -155,7 +159,7 @@ void l2c_rcv_acl_data(BT_HDR* p_msg) {
       p_lcb->link_state != LST_DISCONNECTING)
     /* only process fixed channel data as channel open indication when link is
      * not in disconnecting mode */
-    l2cble_notify_le_connection(p_lcb->remote_bd_addr);
+    l2cble_notify_le_data(p_lcb);
 
   /* Find the CCB for this CID */
   if (rcv_cid >= L2CAP_BASE_APPL_CID) {
@@ -201,21 +205,24 @@ void l2c_rcv_acl_data(BT_HDR* p_msg) {
            (rcv_cid <= L2CAP_LAST_FIXED_CHNL) &&
            (l2cb.fixed_reg[rcv_cid - L2CAP_FIRST_FIXED_CHNL]
                 .pL2CA_FixedData_Cb != NULL)) {
+    uint16_t fixed_idx = rcv_cid - L2CAP_FIRST_FIXED_CHNL;
+    tL2CAP_FIXED_CHNL_REG* p_reg = &l2cb.fixed_reg[fixed_idx];
+
     /* If no CCB for this channel, allocate one */
     if (p_lcb &&
         /* only process fixed channel data when link is open or wait for data
            indication */
         (p_lcb->link_state != LST_DISCONNECTING) &&
-        l2cu_initialize_fixed_ccb(
-            p_lcb, rcv_cid, &l2cb.fixed_reg[rcv_cid - L2CAP_FIRST_FIXED_CHNL]
-                                 .fixed_chnl_opts)) {
-      p_ccb = p_lcb->p_fixed_ccbs[rcv_cid - L2CAP_FIRST_FIXED_CHNL];
+        l2cu_initialize_fixed_ccb(p_lcb, rcv_cid, &p_reg->fixed_chnl_opts)) {
+      p_ccb = p_lcb->p_fixed_ccbs[fixed_idx];
+
+      p_lcb->link_stats.rx_fixed_pkts[fixed_idx]++;
+      p_lcb->link_stats.rx_fixed_bytes[fixed_idx] += p_msg->len;
 
       if (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_BASIC_MODE)
         l2c_fcr_proc_pdu(p_ccb, p_msg);
       else
-        (*l2cb.fixed_reg[rcv_cid - L2CAP_FIRST_FIXED_CHNL].pL2CA_FixedData_Cb)(
-            rcv_cid, p_lcb->remote_bd_addr, p_msg);
+        (*p_reg->pL2CA_FixedData_Cb)(rcv_cid, p_lcb->remote_bd_addr, p_msg);
     } else
       osi_free(p_msg);
   }
@@ -233,9 +240,10 @@ void l2c_rcv_acl_data(BT_HDR* p_msg) {
         // Got a pkt, valid send out credits to the peer device
 
         /* If the credits left on the remote device are getting low, send some */
-        if (p_ccb->remote_credit_count <= L2CAP_LE_CREDIT_THRESHOLD) {
+        if (p_ccb->remote_credit_count <= l2cb.le_credit_threshold) {
           uint16_t credits = L2CAP_LE_CREDIT_DEFAULT - p_ccb->remote_credit_count;
           p_ccb->remote_credit_count = L2CAP_LE_CREDIT_DEFAULT;
+          p_ccb->lcc_stats.credit_returns++;
 
           /* Return back credits */
           l2c_csm_execute(p_ccb, L2CEVT_L2CA_SEND_FLOW_CONTROL_CREDIT, &credits);
@@ -1004,6 +1012,14 @@ void l2c_init(void) {
   l2cb.high_pri_min_xmit_quota = L2CAP_HIGH_PRI_MIN_XMIT_QUOTA;
 #endif
 
+  /* Credits are returned to the peer in batches, once it is this low */
+  int credit_threshold =
+      stack_config_get_interface()->get_le_coc_credit_threshold();
+  if (credit_threshold > 0 && credit_threshold < L2CAP_LE_CREDIT_DEFAULT)
+    l2cb.le_credit_threshold = credit_threshold;
+  else
+    l2cb.le_credit_threshold = L2CAP_LE_CREDIT_THRESHOLD;
+
   l2cb.l2c_ble_fixed_chnls_mask = L2CAP_FIXED_CHNL_ATT_BIT |
                                   L2CAP_FIXED_CHNL_BLE_SIG_BIT |
                                   L2CAP_FIXED_CHNL_SMP_BIT;
@@ -1077,6 +1093,7 @@ void l2c_lcb_timer_timeout(void* data) {
  *
  ******************************************************************************/
 uint8_t l2c_data_write(uint16_t cid, BT_HDR* p_data, uint16_t flags) {
+  BT_TRACE_PACKET_SCOPE("l2c write", p_data);
   tL2C_CCB* p_ccb;
 
   /* Find the channel control block. We don't know the link it is on. */
@@ -31,6 +31,7 @@
 #include "bt_utils.h"
 #include "btm_api.h"
 #include "btm_int.h"
+#include "btif/include/btif_debug_conn.h"
 #include "btu.h"
 #include "device/include/controller.h"
 #include "hci/include/btsnoop.h"
@@ -94,6 +95,8 @@ tL2C_LCB* l2cu_allocate_lcb(const RawAddress& p_bd_addr, bool is_bonding,
       p_lcb->tx_data_len =
           controller_get_interface()->get_ble_default_data_packet_length();
       p_lcb->le_sec_pending_q = fixed_queue_new(SIZE_MAX);
+      p_lcb->link_stats.start_ms = time_get_os_boottime_ms();
+      p_lcb->conn_req_user = L2C_BLE_CONN_USER_NONE;
 
       if (transport == BT_TRANSPORT_LE) {
         l2cb.num_ble_links_active++;
@@ -249,7 +252,9 @@ void l2cu_release_lcb(tL2C_LCB* p_lcb) {
  * Function         l2cu_find_lcb_by_bd_addr
  *
  * Description      Look through all active LCBs for a match based on the
- *                  remote BD address.
+ *                  remote BD address. The address-indexed table holds the
+ *                  LCB found last for the address, it is checked before the
+ *                  pool is searched.
  *
  * Returns          pointer to matched LCB, or NULL if no match
  *
@@ -257,11 +262,22 @@ void l2cu_release_lcb(tL2C_LCB* p_lcb) {
 tL2C_LCB* l2cu_find_lcb_by_bd_addr(const RawAddress& p_bd_addr,
                                    tBT_TRANSPORT transport) {
   int xx;
-  tL2C_LCB* p_lcb = &l2cb.lcb_pool[0];
+  uint8_t hash = transport;
+  for (xx = 0; xx < BD_ADDR_LEN; xx++) hash = hash * 31 + p_bd_addr.address[xx];
+  tL2C_LCB** pp_entry =
+      &l2cb.p_lcb_by_addr[hash & (L2CAP_LCB_ADDR_TABLE_SIZE - 1)];
+  tL2C_LCB* p_lcb = *pp_entry;
+
+  /* The entry may be stale, it is used only if it still matches */
+  if (p_lcb && p_lcb->in_use && p_lcb->transport == transport &&
+      p_lcb->remote_bd_addr == p_bd_addr)
+    return (p_lcb);
 
+  p_lcb = &l2cb.lcb_pool[0];
   for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p_lcb++) {
     if ((p_lcb->in_use) && p_lcb->transport == transport &&
         (p_lcb->remote_bd_addr == p_bd_addr)) {
+      *pp_entry = p_lcb;
       return (p_lcb);
     }
   }
@@ -1424,6 +1440,8 @@ tL2C_CCB* l2cu_allocate_ccb(tL2C_LCB* p_lcb, uint16_t cid) {
   p_ccb->p_next_ccb = p_ccb->p_prev_ccb = NULL;
 
   p_ccb->in_use = true;
+  p_ccb->latency_critical = false;
+  memset(&p_ccb->lcc_stats, 0, sizeof(p_ccb->lcc_stats));
 
   /* Get a CID for the connection */
   p_ccb->local_cid = L2CAP_BASE_APPL_CID + (uint16_t)(p_ccb - l2cb.ccb_pool);
@@ -2311,6 +2329,7 @@ bool l2cu_create_conn_after_switch(tL2C_LCB* p_lcb) {
                               HCI_PKT_TYPES_MASK_DM3 | HCI_PKT_TYPES_MASK_DH3 |
                               HCI_PKT_TYPES_MASK_DM5 | HCI_PKT_TYPES_MASK_DH5),
       page_scan_rep_mode, page_scan_mode, clock_offset, allow_switch);
+  btif_debug_conn_milestone(p_lcb->remote_bd_addr, BTIF_DEBUG_CONN_ACL_CREATE);
 
   btm_acl_update_busy_level(BTM_BLI_PAGE_EVT);
 
@@ -3090,17 +3109,28 @@ void l2cu_send_peer_ble_credit_based_disconn_req(tL2C_CCB* p_ccb) {
  * Function         l2cu_find_lcb_by_handle
  *
  * Description      Look through all active LCBs for a match based on the
- *                  HCI handle.
+ *                  HCI handle. The handle-indexed table holds the LCB found
+ *                  last for the handle, it is checked before the pool is
+ *                  searched.
  *
  * Returns          pointer to matched LCB, or NULL if no match
  *
  ******************************************************************************/
 tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle) {
   int xx;
-  tL2C_LCB* p_lcb = &l2cb.lcb_pool[0];
+  tL2C_LCB** pp_entry =
+      &l2cb.p_lcb_by_handle[handle & (L2CAP_LCB_HANDLE_TABLE_SIZE - 1)];
+  tL2C_LCB* p_lcb = *pp_entry;
 
+  /* The entry may be stale, it is used only if it still matches */
+  if (p_lcb && p_lcb->in_use && p_lcb->handle == handle &&
+      handle != HCI_INVALID_HANDLE)
+    return (p_lcb);
+
+  p_lcb = &l2cb.lcb_pool[0];
   for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p_lcb++) {
     if ((p_lcb->in_use) && (p_lcb->handle == handle)) {
+      *pp_entry = p_lcb;
       return (p_lcb);
     }
   }
@@ -3161,6 +3191,63 @@ tL2C_CCB* l2cu_find_ccb_by_cid(tL2C_LCB* p_lcb, uint16_t local_cid) {
   return (p_ccb);
 }
 
+/******************************************************************************
+ *
+ * Function         l2cu_is_ccb_ready_to_send
+ *
+ * Description      checks if a channel has data that it can send now.
+ *
+ * Returns          true if the channel can send
+ *
+ ******************************************************************************/
+static bool l2cu_is_ccb_ready_to_send(tL2C_CCB* p_ccb) {
+  if (p_ccb->chnl_state != CST_OPEN) return false;
+
+  if (p_ccb->p_lcb->transport == BT_TRANSPORT_LE)
+    return !fixed_queue_is_empty(p_ccb->xmit_hold_q);
+
+  /* eL2CAP option in use */
+  if (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_BASIC_MODE) {
+    if (p_ccb->fcrb.wait_ack || p_ccb->fcrb.remote_busy) return false;
+
+    if (fixed_queue_is_empty(p_ccb->fcrb.retrans_q)) {
+      if (fixed_queue_is_empty(p_ccb->xmit_hold_q)) return false;
+
+      /* If in eRTM mode, check for window closure */
+      if ((p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE) &&
+          (l2c_fcr_is_flow_controlled(p_ccb)))
+        return false;
+    }
+    return true;
+  }
+
+  return !fixed_queue_is_empty(p_ccb->xmit_hold_q);
+}
+
+/******************************************************************************
+ *
+ * Function         l2cu_get_next_latency_critical_channel
+ *
+ * Description      get the next latency critical channel with data to send on
+ *                  a link. p_found is set if the link has any latency critical
+ *                  channel.
+ *
+ * Returns          pointer to CCB or NULL
+ *
+ ******************************************************************************/
+static tL2C_CCB* l2cu_get_next_latency_critical_channel(tL2C_LCB* p_lcb,
+                                                        bool* p_found) {
+  for (tL2C_CCB* p_ccb = p_lcb->ccb_queue.p_first_ccb; p_ccb;
+       p_ccb = p_ccb->p_next_ccb) {
+    if (!p_ccb->latency_critical) continue;
+
+    *p_found = true;
+    if (l2cu_is_ccb_ready_to_send(p_ccb)) return p_ccb;
+  }
+
+  return NULL;
+}
+
 #if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
 
 /******************************************************************************
@@ -3209,29 +3296,7 @@ static tL2C_CCB* l2cu_get_next_channel_in_rr(tL2C_LCB* p_lcb) {
         p_lcb->rr_serv[p_lcb->rr_pri].p_serve_ccb = p_ccb->p_next_ccb;
       }
 
-      if (p_ccb->chnl_state != CST_OPEN) continue;
-
-      if (p_ccb->p_lcb->transport == BT_TRANSPORT_LE) {
-        L2CAP_TRACE_DEBUG("%s : Connection oriented channel", __func__);
-        if (fixed_queue_is_empty(p_ccb->xmit_hold_q)) continue;
-
-      } else {
-        /* eL2CAP option in use */
-        if (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_BASIC_MODE) {
-          if (p_ccb->fcrb.wait_ack || p_ccb->fcrb.remote_busy) continue;
-
-          if (fixed_queue_is_empty(p_ccb->fcrb.retrans_q)) {
-            if (fixed_queue_is_empty(p_ccb->xmit_hold_q)) continue;
-
-            /* If in eRTM mode, check for window closure */
-            if ((p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE) &&
-                (l2c_fcr_is_flow_controlled(p_ccb)))
-              continue;
-          }
-        } else {
-          if (fixed_queue_is_empty(p_ccb->xmit_hold_q)) continue;
-        }
-      }
+      if (!l2cu_is_ccb_ready_to_send(p_ccb)) continue;
 
       /* found a channel to serve */
       p_serve_ccb = p_ccb;
@@ -3369,16 +3434,44 @@ BT_HDR* l2cu_get_next_buffer_to_send(tL2C_LCB* p_lcb,
   }
 #endif
 
+  /* Latency critical channels go first. Unless the link is round-robin
+   * served, the other channels cannot use the last ACL credits of the link
+   * when it has a latency critical channel. */
+  bool has_latency_critical = false;
+  p_ccb = l2cu_get_next_latency_critical_channel(p_lcb, &has_latency_critical);
+  bool in_reserve =
+      has_latency_critical &&
+      (p_lcb->link_xmit_quota > L2CAP_LATENCY_CRITICAL_RESERVE) &&
+      (p_lcb->sent_not_acked >=
+       p_lcb->link_xmit_quota - L2CAP_LATENCY_CRITICAL_RESERVE);
+
+  if (p_ccb == NULL || (!in_reserve && p_lcb->latency_critical_burst >=
+                                           L2CAP_LATENCY_CRITICAL_MAX_BURST)) {
+    if (p_ccb == NULL && in_reserve) {
+      p_lcb->link_stats.reserve_holds++;
+      return (NULL);
+    }
+
+    tL2C_CCB* p_latency_critical_ccb = p_ccb;
 #if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
-  /* get next serving channel in round-robin */
-  p_ccb = l2cu_get_next_channel_in_rr(p_lcb);
+    /* get next serving channel in round-robin */
+    p_ccb = l2cu_get_next_channel_in_rr(p_lcb);
 #else
-  p_ccb = l2cu_get_next_channel(p_lcb);
+    p_ccb = l2cu_get_next_channel(p_lcb);
 #endif
+    if (p_ccb == NULL) p_ccb = p_latency_critical_ccb;
+  }
 
   /* Return if no buffer */
   if (p_ccb == NULL) return (NULL);
 
+  if (p_ccb->latency_critical) {
+    p_lcb->latency_critical_burst++;
+    p_lcb->link_stats.tx_latency_critical++;
+  } else {
+    p_lcb->latency_critical_burst = 0;
+  }
+
   if (p_ccb->p_lcb->transport == BT_TRANSPORT_LE) {
     /* Check credits */
     if (p_ccb->peer_conn_cfg.credits == 0) {
@@ -3389,6 +3482,9 @@ BT_HDR* l2cu_get_next_buffer_to_send(tL2C_LCB* p_lcb,
     if (p_buf == NULL) return (NULL);
 
     p_ccb->peer_conn_cfg.credits--;
+    if (p_ccb->peer_conn_cfg.credits == 0 &&
+        !fixed_queue_is_empty(p_ccb->xmit_hold_q))
+      p_ccb->lcc_stats.tx_credit_stalls++;
   } else {
     if (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_BASIC_MODE) {
       p_buf = l2c_fcr_get_next_xmit_sdu_seg(p_ccb, 0);
@@ -25,7 +25,9 @@
 #define LOG_TAG "bt_port_api"
 
 #include <base/logging.h>
+#include <stdio.h>
 #include <string.h>
+#include <sys/uio.h>
 
 #include "osi/include/log.h"
 #include "osi/include/mutex.h"
@@ -43,6 +45,11 @@
 /* duration of break in 200ms units */
 #define PORT_BREAK_DURATION 1
 
+/* Maximum number of buffers PORT_WriteDataCO reads with one call out */
+#ifndef PORT_WRITE_CO_MAX_BUFS
+#define PORT_WRITE_CO_MAX_BUFS 8
+#endif
+
 #define info(fmt, ...) LOG_INFO(LOG_TAG, "%s: " fmt, __func__, ##__VA_ARGS__)
 #define debug(fmt, ...) LOG_DEBUG(LOG_TAG, "%s: " fmt, __func__, ##__VA_ARGS__)
 #define error(fmt, ...) \
@@ -252,7 +259,8 @@ int RFCOMM_RemoveConnection(uint16_t handle) {
     RFCOMM_TRACE_ERROR("RFCOMM_RemoveConnection() BAD handle:%d", handle);
     return (PORT_BAD_HANDLE);
   }
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_SUCCESS);
 
   if (!p_port->in_use ||
       (p_port->state == PORT_STATE_CLOSED) ||
@@ -287,7 +295,8 @@ int RFCOMM_RemoveServer(uint16_t handle) {
     RFCOMM_TRACE_ERROR("RFCOMM_RemoveServer() BAD handle:%d", handle);
     return (PORT_BAD_HANDLE);
   }
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_SUCCESS);
 
   /* Do not report any events to the client any more. */
   p_port->p_mgmt_callback = NULL;
@@ -331,7 +340,8 @@ int PORT_SetEventCallback(uint16_t port_handle, tPORT_CALLBACK* p_port_cb) {
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[port_handle - 1];
+  p_port = rfc_cb.port.port[port_handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -361,7 +371,8 @@ int PORT_ClearKeepHandleFlag(uint16_t port_handle) {
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[port_handle - 1];
+  p_port = rfc_cb.port.port[port_handle - 1];
+  if (p_port == NULL) return (PORT_SUCCESS);
   p_port->keep_port_handle = 0;
   return (PORT_SUCCESS);
 }
@@ -390,7 +401,8 @@ int PORT_SetDataCallback(uint16_t port_handle, tPORT_DATA_CALLBACK* p_port_cb) {
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[port_handle - 1];
+  p_port = rfc_cb.port.port[port_handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -425,7 +437,8 @@ int PORT_SetDataCOCallback(uint16_t port_handle,
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[port_handle - 1];
+  p_port = rfc_cb.port.port[port_handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -457,7 +470,8 @@ int PORT_SetEventMask(uint16_t port_handle, uint32_t mask) {
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[port_handle - 1];
+  p_port = rfc_cb.port.port[port_handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -491,7 +505,8 @@ int PORT_CheckConnection(uint16_t handle, RawAddress& bd_addr,
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -532,7 +547,8 @@ uint16_t PORT_GetRemoteMtu (uint16_t handle)
         return (0);
     }
 
-    p_port = &rfc_cb.port.port[handle - 1];
+    p_port = rfc_cb.port.port[handle - 1];
+    if (p_port == NULL) return (0);
 
     if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED))
     {
@@ -582,10 +598,9 @@ bool PORT_IsOpening(RawAddress& bd_addr) {
     if (rfc_cb.port.rfc_mcb[xx].state == RFC_MX_STATE_CONNECTED) {
       found_port = false;
       p_mcb = &rfc_cb.port.rfc_mcb[xx];
-      p_port = &rfc_cb.port.port[0];
-
-      for (yy = 0; yy < MAX_RFC_PORTS; yy++, p_port++) {
-        if (p_port->rfc.p_mcb == p_mcb) {
+      for (yy = 0; yy < MAX_RFC_PORTS; yy++) {
+        p_port = rfc_cb.port.port[yy];
+        if (p_port != NULL && p_port->rfc.p_mcb == p_mcb) {
           found_port = true;
           break;
         }
@@ -627,7 +642,8 @@ int PORT_SetState(uint16_t handle, tPORT_STATE* p_settings) {
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -670,7 +686,8 @@ int PORT_GetRxQueueCnt(uint16_t handle, uint16_t* p_rx_queue_count) {
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -711,7 +728,8 @@ int PORT_GetState(uint16_t handle, tPORT_STATE* p_settings) {
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -747,7 +765,8 @@ int PORT_Control(uint16_t handle, uint8_t signal) {
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -831,7 +850,8 @@ int PORT_FlowControl(uint16_t handle, bool enable) {
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -898,7 +918,8 @@ int PORT_FlowControl_MaxCredit(uint16_t handle, bool enable) {
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -960,7 +981,8 @@ int PORT_GetModemStatus(uint16_t handle, uint8_t* p_signal) {
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -1000,7 +1022,8 @@ int PORT_ClearError(uint16_t handle, uint16_t* p_errors,
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -1036,7 +1059,8 @@ int PORT_SendError(uint16_t handle, uint8_t errors) {
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -1070,7 +1094,8 @@ int PORT_GetQueueStatus(uint16_t handle, tPORT_STATUS* p_status) {
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -1119,7 +1144,8 @@ int PORT_Purge(uint16_t handle, uint8_t purge_flags) {
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -1133,6 +1159,7 @@ int PORT_Purge(uint16_t handle, uint8_t purge_flags) {
     while ((p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_port->rx.queue)) != NULL)
       osi_free(p_buf);
 
+    memory_governor_release(port_rx_memory, p_port->rx.queue_size);
     p_port->rx.queue_size = 0;
 
     mutex_global_unlock();
@@ -1193,7 +1220,8 @@ int PORT_ReadData(uint16_t handle, char* p_data, uint16_t max_len,
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -1221,6 +1249,7 @@ int PORT_ReadData(uint16_t handle, char* p_data, uint16_t max_len,
       mutex_global_lock();
 
       p_port->rx.queue_size -= max_len;
+      memory_governor_release(port_rx_memory, max_len);
 
       mutex_global_unlock();
 
@@ -1234,6 +1263,7 @@ int PORT_ReadData(uint16_t handle, char* p_data, uint16_t max_len,
       mutex_global_lock();
 
       p_port->rx.queue_size -= p_buf->len;
+      memory_governor_release(port_rx_memory, p_buf->len);
 
       if (max_len) {
         p_data += p_buf->len;
@@ -1283,7 +1313,8 @@ int PORT_Read(uint16_t handle, BT_HDR** pp_buf) {
   if ((handle == 0) || (handle > MAX_RFC_PORTS)) {
     return (PORT_BAD_HANDLE);
   }
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -1298,6 +1329,7 @@ int PORT_Read(uint16_t handle, BT_HDR** pp_buf) {
   p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_port->rx.queue);
   if (p_buf) {
     p_port->rx.queue_size -= p_buf->len;
+    memory_governor_release(port_rx_memory, p_buf->len);
 
     mutex_global_unlock();
 
@@ -1394,7 +1426,11 @@ int PORT_Write(uint16_t handle, BT_HDR* p_buf) {
     return (PORT_BAD_HANDLE);
   }
 
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) {
+    osi_free(p_buf);
+    return (PORT_NOT_OPENED);
+  }
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     osi_free(p_buf);
@@ -1454,7 +1490,8 @@ int PORT_WriteDataCO(uint16_t handle, int* p_len) {
   if ((handle == 0) || (handle > MAX_RFC_PORTS)) {
     return (PORT_BAD_HANDLE);
   }
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     RFCOMM_TRACE_WARNING("PORT_WriteDataByFd() no port state:%d",
@@ -1537,40 +1574,79 @@ int PORT_WriteDataCO(uint16_t handle, int* p_len) {
     }
 
     /* continue with rfcomm data write */
-    p_buf = (BT_HDR*)osi_malloc(RFCOMM_DATA_BUF_SIZE);
-    p_buf->offset = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
-    p_buf->layer_specific = handle;
-
     if (p_port->peer_mtu < length) length = p_port->peer_mtu;
-    if (available < (int)length) length = (uint16_t)available;
-    p_buf->len = length;
-    p_buf->event = BT_EVT_TO_BTU_SP_DATA;
 
-    // memcpy ((uint8_t *)(p_buf + 1) + p_buf->offset, p_data, length);
-    // if(recv(fd, (uint8_t *)(p_buf + 1) + p_buf->offset, (int)length, 0) !=
-    // (int)length)
-    if (p_port->p_data_co_callback(
-            handle, (uint8_t*)(p_buf + 1) + p_buf->offset, length,
-            DATA_CO_CALLBACK_TYPE_OUTGOING) == false) {
+    /* Read the data of as many buffers as the high water marks let in the
+     * queue with one call out */
+    BT_HDR* p_bufs[PORT_WRITE_CO_MAX_BUFS];
+    struct iovec iov[PORT_WRITE_CO_MAX_BUFS];
+    int num_bufs = 0;
+    int batch_len = 0;
+    uint32_t queue_size = p_port->tx.queue_size;
+    size_t queue_length = fixed_queue_length(p_port->tx.queue);
+    do {
+      uint16_t buf_len = length;
+      if (available - batch_len < (int)buf_len)
+        buf_len = (uint16_t)(available - batch_len);
+
+      p_buf = (BT_HDR*)osi_malloc(RFCOMM_DATA_BUF_SIZE);
+      p_buf->offset = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
+      p_buf->layer_specific = handle;
+      p_buf->len = buf_len;
+      p_buf->event = BT_EVT_TO_BTU_SP_DATA;
+
+      iov[num_bufs].iov_base = (uint8_t*)(p_buf + 1) + p_buf->offset;
+      iov[num_bufs].iov_len = buf_len;
+      p_bufs[num_bufs++] = p_buf;
+      batch_len += buf_len;
+      queue_size += buf_len;
+      queue_length++;
+    } while (num_bufs < PORT_WRITE_CO_MAX_BUFS && batch_len < available &&
+             queue_size <= PORT_TX_HIGH_WM &&
+             queue_length <= PORT_TX_BUF_HIGH_WM);
+
+    bool read_ok;
+    if (num_bufs == 1) {
+      read_ok = p_port->p_data_co_callback(handle, (uint8_t*)iov[0].iov_base,
+                                           p_bufs[0]->len,
+                                           DATA_CO_CALLBACK_TYPE_OUTGOING);
+    } else {
+      read_ok = p_port->p_data_co_callback(handle, (uint8_t*)iov, num_bufs,
+                                           DATA_CO_CALLBACK_TYPE_OUTGOING_VEC);
+    }
+    if (!read_ok) {
       error(
-          "p_data_co_callback DATA_CO_CALLBACK_TYPE_OUTGOING failed, length:%d",
-          length);
+          "p_data_co_callback DATA_CO_CALLBACK_TYPE_OUTGOING failed, "
+          "length:%d, buffers:%d",
+          batch_len, num_bufs);
+      for (int i = 0; i < num_bufs; i++) osi_free(p_bufs[i]);
       return (PORT_UNKNOWN_ERROR);
     }
 
-    RFCOMM_TRACE_EVENT("PORT_WriteData %d bytes", length);
+    RFCOMM_TRACE_EVENT("PORT_WriteData %d bytes in %d buffers", batch_len,
+                       num_bufs);
 
-    rc = port_write(p_port, p_buf);
+    int i;
+    for (i = 0; i < num_bufs; i++) {
+      uint16_t buf_len = p_bufs[i]->len;
 
-    /* If queue went below the threashold need to send flow control */
-    event |= port_flow_control_user(p_port);
+      rc = port_write(p_port, p_bufs[i]);
 
-    if (rc == PORT_SUCCESS) event |= PORT_EV_TXCHAR;
+      /* If queue went below the threashold need to send flow control */
+      event |= port_flow_control_user(p_port);
 
-    if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING)) break;
+      if (rc == PORT_SUCCESS) event |= PORT_EV_TXCHAR;
 
-    *p_len += length;
-    available -= (int)length;
+      if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING)) break;
+
+      *p_len += buf_len;
+      available -= (int)buf_len;
+    }
+    if (i < num_bufs) {
+      /* the port can't take the data already read for the next buffers */
+      while (++i < num_bufs) osi_free(p_bufs[i]);
+      break;
+    }
   }
   if (!available && (rc != PORT_CMD_PENDING) && (rc != PORT_TX_QUEUE_DISABLED))
     event |= PORT_EV_TXEMPTY;
@@ -1613,7 +1689,8 @@ int PORT_WriteData(uint16_t handle, const char* p_data, uint16_t max_len,
   if ((handle == 0) || (handle > MAX_RFC_PORTS)) {
     return (PORT_BAD_HANDLE);
   }
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     RFCOMM_TRACE_WARNING("PORT_WriteData() no port state:%d", p_port->state);
@@ -1714,7 +1791,8 @@ int PORT_Test(uint16_t handle, uint8_t* p_data, uint16_t len) {
   if ((handle == 0) || (handle > MAX_RFC_PORTS)) {
     return (PORT_BAD_HANDLE);
   }
-  p_port = &rfc_cb.port.port[handle - 1];
+  p_port = rfc_cb.port.port[handle - 1];
+  if (p_port == NULL) return (PORT_NOT_OPENED);
 
   if (!p_port->in_use || (p_port->state == PORT_STATE_CLOSED)) {
     return (PORT_NOT_OPENED);
@@ -1743,6 +1821,7 @@ int PORT_Test(uint16_t handle, uint8_t* p_data, uint16_t len) {
  *
  ******************************************************************************/
 void RFCOMM_Init(void) {
+  port_free_ports();
   memset(&rfc_cb, 0, sizeof(tRFC_CB)); /* Init RFCOMM control block */
 
   rfc_cb.rfc.last_mux = MAX_BD_CONNECTIONS;
@@ -1754,6 +1833,7 @@ void RFCOMM_Init(void) {
 #endif
 
   rfcomm_l2cap_if_init();
+  port_memory_init();
 }
 
 /*******************************************************************************
@@ -1821,9 +1901,9 @@ int PORT_GetStateBySCN(const RawAddress& bd_addr, uint32_t scn_id, bool is_serve
     return PORT_STATE_OPENING;
   } else if (rfc_cb.port.rfc_mcb[xx].state == RFC_MX_STATE_CONNECTED) {
 
-    p_port = &rfc_cb.port.port[0];
-
-    for (yy = 0; yy < MAX_RFC_PORTS; yy++, p_port++) {
+    for (yy = 0; yy < MAX_RFC_PORTS; yy++) {
+      p_port = rfc_cb.port.port[yy];
+      if (p_port == NULL) continue;
       if ((p_port->rfc.p_mcb == p_mcb) && (p_port->scn == scn_id) &&
           (p_port->is_server == is_server)) {
         found_port = true;
@@ -1844,3 +1924,40 @@ int PORT_GetStateBySCN(const RawAddress& bd_addr, uint32_t scn_id, bool is_serve
   return PORT_STATE_CLOSED;
 }
 
+/*******************************************************************************
+ *
+ * Function         PORT_DebugDump
+ *
+ * Description      This function dumps the credit flow control state of the
+ *                  open ports.
+ *
+ * Parameters:      fd         - file descriptor to write to
+ *
+ ******************************************************************************/
+void PORT_DebugDump(int fd) {
+  dprintf(fd, "\nRFCOMM ports:\n");
+  for (int xx = 0; xx < MAX_RFC_PORTS; xx++) {
+    tPORT* p_port = rfc_cb.port.port[xx];
+    if (p_port == NULL || !p_port->in_use || !p_port->rfc.p_mcb) continue;
+
+    dprintf(fd, "  handle: %d, dlci: %d, mtu: %d, flow: %s%s\n", p_port->inx,
+            p_port->dlci, p_port->mtu,
+            (p_port->rfc.p_mcb->flow == PORT_FC_CREDIT) ? "credit" : "TS 07.10",
+            p_port->rx.user_fc ? ", user flow controlled" : "");
+    if (p_port->rfc.p_mcb->flow != PORT_FC_CREDIT) continue;
+    dprintf(fd,
+            "    rx credit window (current/initial/peak): %d / %d / %d, "
+            "credits: %d, update at: %d\n",
+            p_port->credit_rx_max, p_port->credit_rx_base,
+            p_port->credit_rx_peak, p_port->credit_rx, p_port->credit_rx_low);
+    dprintf(fd,
+            "    rx peer out of credits: %u, app stalls: %u, window grows: "
+            "%u, shrinks: %u\n",
+            p_port->credit_rx_exhausted, p_port->credit_rx_app_stalls,
+            p_port->credit_rx_grows, p_port->credit_rx_shrinks);
+    dprintf(fd, "    tx credits: %d, out of credits: %u, queued: %u bytes\n",
+            p_port->credit_tx, p_port->credit_tx_stalls,
+            p_port->tx.queue_size);
+  }
+}
+
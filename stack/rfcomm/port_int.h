@@ -29,6 +29,7 @@
 #include "bt_target.h"
 #include "osi/include/alarm.h"
 #include "osi/include/fixed_queue.h"
+#include "osi/include/memory_governor.h"
 #include "port_api.h"
 #include "rfcdefs.h"
 
@@ -201,6 +202,14 @@ typedef struct {
   uint16_t
       credit_rx_max; /* Max number of credits we will allow this guy to sent */
   uint16_t credit_rx_low;   /* Number of credits when we send credit update */
+  uint16_t credit_rx_base;  /* Initial credit_rx_max, the smallest window */
+  uint16_t credit_rx_low_base; /* Initial credit_rx_low */
+  uint16_t credit_rx_peak;     /* Largest credit_rx_max reached */
+  uint32_t credit_rx_exhausted; /* Frames that used the last peer credit */
+  uint32_t credit_rx_app_stalls; /* Frames the app could not take at once */
+  uint32_t credit_rx_grows;      /* Credit window increases */
+  uint32_t credit_rx_shrinks;    /* Credit window decreases */
+  uint32_t credit_tx_stalls;     /* Times we ran out of peer credits */
   uint16_t rx_buf_critical; /* port receive queue critical watermark level */
   bool keep_port_handle;    /* true if port is not deallocated when closing */
   /* it is set to true for server when allocating port */
@@ -209,9 +218,19 @@ typedef struct {
 
 /* Define the PORT/RFCOMM control structure
 */
+/* Port handles are one byte in the multiplexer DLCI table */
+static_assert(MAX_RFC_PORTS < 256, "MAX_RFC_PORTS does not fit port_inx");
+
+/* Number of entries in the address-indexed MCB table, a power of two */
+#define PORT_MCB_ADDR_TABLE_SIZE 16
+
 typedef struct {
-  tPORT port[MAX_RFC_PORTS];            /* Port info pool */
+  /* Port info pool, by handle - 1. A port is allocated the first time its
+   * handle is used and kept for the handle until RFCOMM_Init. */
+  tPORT* port[MAX_RFC_PORTS];
   tRFC_MCB rfc_mcb[MAX_BD_CONNECTIONS]; /* RFCOMM bd_connections pool */
+  /* MCB index + 1 last found for each address, indexed by its hash */
+  uint8_t mcb_by_addr[PORT_MCB_ADDR_TABLE_SIZE];
 } tPORT_CB;
 
 /*
@@ -221,6 +240,7 @@ extern tPORT* port_allocate_port(uint8_t dlci, const RawAddress& bd_addr);
 extern void port_set_defaults(tPORT* p_port);
 extern void port_select_mtu(tPORT* p_port);
 extern void port_release_port(tPORT* p_port);
+extern void port_free_ports(void);
 extern tPORT* port_find_mcb_dlci_port(tRFC_MCB* p_mcb, uint8_t dlci);
 extern tRFC_MCB* port_find_mcb(const RawAddress& bd_addr);
 extern tPORT* port_find_dlci_port(uint8_t dlci);
@@ -229,6 +249,12 @@ extern uint32_t port_get_signal_changes(tPORT* p_port, uint8_t old_signals,
                                         uint8_t signal);
 extern uint32_t port_flow_control_user(tPORT* p_port);
 extern void port_flow_control_peer(tPORT* p_port, bool enable, uint16_t count);
+extern void port_credit_window_grow(tPORT* p_port);
+extern void port_credit_window_shrink(tPORT* p_port);
+extern void port_memory_init(void);
+
+/* Bytes of the receive queues of all the ports, for the memory governor */
+extern memory_client_t* port_rx_memory;
 
 /*
  * Functions provided by the port_rfc.cc
@@ -197,8 +197,9 @@ void PORT_StartCnf(tRFC_MCB* p_mcb, uint16_t result) {
 
   RFCOMM_TRACE_EVENT("PORT_StartCnf result:%d", result);
 
-  p_port = &rfc_cb.port.port[0];
-  for (i = 0; i < MAX_RFC_PORTS; i++, p_port++) {
+  for (i = 0; i < MAX_RFC_PORTS; i++) {
+    p_port = rfc_cb.port.port[i];
+    if (p_port == NULL) continue;
     if (p_port->rfc.p_mcb == p_mcb) {
       no_ports_up = false;
 
@@ -251,9 +252,11 @@ void PORT_StartInd(tRFC_MCB* p_mcb) {
 
   RFCOMM_TRACE_EVENT("PORT_StartInd");
 
-  p_port = &rfc_cb.port.port[0];
-  for (i = 0; i < MAX_RFC_PORTS; i++, p_port++) {
-    if ((p_port->rfc.p_mcb == NULL) || (p_port->rfc.p_mcb == p_mcb)) {
+  /* A port never allocated has no multiplexer either */
+  for (i = 0; i < MAX_RFC_PORTS; i++) {
+    p_port = rfc_cb.port.port[i];
+    if ((p_port == NULL) || (p_port->rfc.p_mcb == NULL) ||
+        (p_port->rfc.p_mcb == p_mcb)) {
       RFCOMM_TRACE_DEBUG(
           "PORT_StartInd, RFCOMM_StartRsp RFCOMM_SUCCESS: p_mcb:%p", p_mcb);
       RFCOMM_StartRsp(p_mcb, RFCOMM_SUCCESS);
@@ -720,8 +723,9 @@ void PORT_CloseInd(tRFC_MCB* p_mcb) {
 
   RFCOMM_TRACE_EVENT("PORT_CloseInd");
 
-  p_port = &rfc_cb.port.port[0];
-  for (i = 0; i < MAX_RFC_PORTS; i++, p_port++) {
+  for (i = 0; i < MAX_RFC_PORTS; i++) {
+    p_port = rfc_cb.port.port[i];
+    if (p_port == NULL) continue;
     if (p_port->rfc.p_mcb == p_mcb) {
       port_rfc_closed(p_port, PORT_PEER_CONNECTION_FAILED);
     }
@@ -743,8 +747,9 @@ void Port_TimeOutCloseMux(tRFC_MCB* p_mcb) {
 
   RFCOMM_TRACE_EVENT("Port_TimeOutCloseMux");
 
-  p_port = &rfc_cb.port.port[0];
-  for (i = 0; i < MAX_RFC_PORTS; i++, p_port++) {
+  for (i = 0; i < MAX_RFC_PORTS; i++) {
+    p_port = rfc_cb.port.port[i];
+    if (p_port == NULL) continue;
     if (p_port->rfc.p_mcb == p_mcb) {
       port_rfc_closed(p_port, PORT_PEER_TIMEOUT);
     }
@@ -776,11 +781,21 @@ void PORT_DataInd(tRFC_MCB* p_mcb, uint8_t dlci, BT_HDR* p_buf) {
   /* If client registered callout callback with flow control we can just deliver
    * receive data */
   if (p_port->p_data_co_callback) {
+    bool credit_flow = (p_mcb->flow == PORT_FC_CREDIT);
     /* Another packet is delivered to user.  Send credits to peer if required */
     if (p_port->p_data_co_callback(p_port->inx, (uint8_t*)p_buf, -1,
                                    DATA_CO_CALLBACK_TYPE_INCOMING)) {
+      /* The peer waits for credits while the user keeps up */
+      if (credit_flow && p_port->credit_rx <= 1 && !p_port->rx.user_fc) {
+        p_port->credit_rx_exhausted++;
+        port_credit_window_grow(p_port);
+      }
       port_flow_control_peer(p_port, true, 1);
     } else {
+      if (credit_flow) {
+        p_port->credit_rx_app_stalls++;
+        port_credit_window_shrink(p_port);
+      }
       port_flow_control_peer(p_port, false, 0);
     }
     // osi_free(p_buf);
@@ -820,6 +835,7 @@ void PORT_DataInd(tRFC_MCB* p_mcb, uint8_t dlci, BT_HDR* p_buf) {
 
   fixed_queue_enqueue(p_port->rx.queue, p_buf);
   p_port->rx.queue_size += p_buf->len;
+  memory_governor_charge(port_rx_memory, p_buf->len);
 
   mutex_global_unlock();
 
@@ -869,8 +885,8 @@ void PORT_FlowInd(tRFC_MCB* p_mcb, uint8_t dlci, bool enable_data) {
   for (i = 0; i < MAX_RFC_PORTS; i++) {
     /* If DLCI is 0 event applies to all ports */
     if (dlci == 0) {
-      p_port = &rfc_cb.port.port[i];
-      if (!p_port->in_use || (p_port->rfc.p_mcb != p_mcb) ||
+      p_port = rfc_cb.port.port[i];
+      if (p_port == NULL || !p_port->in_use || (p_port->rfc.p_mcb != p_mcb) ||
           (p_port->rfc.state != RFC_STATE_OPENED))
         continue;
     }
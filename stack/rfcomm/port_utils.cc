@@ -24,6 +24,8 @@
 #include <base/logging.h>
 #include <string.h>
 
+#include <atomic>
+
 #include "osi/include/mutex.h"
 
 #include "bt_common.h"
@@ -48,6 +50,36 @@ static const tPORT_STATE default_port_pars = {
     PORT_XOFF_DC3,
 };
 
+memory_client_t* port_rx_memory;
+
+/* Memory pressure of the governor, the receive watermarks follow it */
+static std::atomic<int> port_rx_pressure_level{MEMORY_PRESSURE_NONE};
+
+static memory_pressure_t port_rx_pressure(void) {
+  return static_cast<memory_pressure_t>(port_rx_pressure_level.load());
+}
+
+static void port_memory_pressure(memory_pressure_t pressure, void* context) {
+  port_rx_pressure_level = pressure;
+}
+
+/*******************************************************************************
+ *
+ * Function         port_memory_init
+ *
+ * Description      Registers the receive queues of the ports with the memory
+ *                  governor. Under memory pressure the ports flow control
+ *                  the peer sooner and grow their credit windows less.
+ *
+ * Returns          nothing
+ *
+ ******************************************************************************/
+void port_memory_init(void) {
+  port_rx_memory =
+      memory_governor_register("rfcomm_port_rx", port_memory_pressure, NULL);
+  port_rx_pressure_level = memory_governor_pressure();
+}
+
 /*******************************************************************************
  *
  * Function         port_allocate_port
@@ -61,13 +93,17 @@ static const tPORT_STATE default_port_pars = {
  *
  ******************************************************************************/
 tPORT* port_allocate_port(uint8_t dlci, const RawAddress& bd_addr) {
-  tPORT* p_port = &rfc_cb.port.port[0];
+  tPORT* p_port;
   uint8_t xx, yy;
 
   for (xx = 0, yy = rfc_cb.rfc.last_port + 1; xx < MAX_RFC_PORTS; xx++, yy++) {
     if (yy >= MAX_RFC_PORTS) yy = 0;
 
-    p_port = &rfc_cb.port.port[yy];
+    p_port = rfc_cb.port.port[yy];
+    if (p_port == NULL) {
+      p_port = (tPORT*)osi_calloc(sizeof(tPORT));
+      rfc_cb.port.port[yy] = p_port;
+    }
     if (!p_port->in_use) {
       memset(p_port, 0, sizeof(tPORT));
 
@@ -187,6 +223,9 @@ void port_select_mtu(tPORT* p_port) {
   p_port->rx_buf_critical = (PORT_RX_CRITICAL_WM / p_port->mtu);
   if (p_port->rx_buf_critical > PORT_RX_BUF_CRITICAL_WM)
     p_port->rx_buf_critical = PORT_RX_BUF_CRITICAL_WM;
+  p_port->credit_rx_base = p_port->credit_rx_max;
+  p_port->credit_rx_low_base = p_port->credit_rx_low;
+  p_port->credit_rx_peak = p_port->credit_rx_max;
   RFCOMM_TRACE_DEBUG(
       "port_select_mtu credit_rx_max %d, credit_rx_low %d, rx_buf_critical %d",
       p_port->credit_rx_max, p_port->credit_rx_low, p_port->rx_buf_critical);
@@ -209,6 +248,7 @@ void port_release_port(tPORT* p_port) {
   BT_HDR* p_buf;
   while ((p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_port->rx.queue)) != NULL)
     osi_free(p_buf);
+  memory_governor_release(port_rx_memory, p_port->rx.queue_size);
   p_port->rx.queue_size = 0;
 
   while ((p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_port->tx.queue)) != NULL)
@@ -267,20 +307,54 @@ void port_release_port(tPORT* p_port) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         port_free_ports
+ *
+ * Description      Frees the ports allocated so far, when RFCOMM is
+ *                  initialized again.
+ *
+ * Returns          nothing
+ *
+ ******************************************************************************/
+void port_free_ports(void) {
+  for (int i = 0; i < MAX_RFC_PORTS; i++) {
+    osi_free(rfc_cb.port.port[i]);
+    rfc_cb.port.port[i] = NULL;
+  }
+}
+
+static uint8_t* port_mcb_addr_entry(const RawAddress& bd_addr) {
+  uint8_t hash = 0;
+  for (int i = 0; i < BD_ADDR_LEN; i++) hash = hash * 31 + bd_addr.address[i];
+  return &rfc_cb.port.mcb_by_addr[hash & (PORT_MCB_ADDR_TABLE_SIZE - 1)];
+}
+
 /*******************************************************************************
  *
  * Function         port_find_mcb
  *
  * Description      This function checks if connection exists to device with
- *                  the address.
+ *                  the address. The address-indexed table holds the MCB
+ *                  found last for the address, it is checked before the
+ *                  pool is searched.
  *
  ******************************************************************************/
 tRFC_MCB* port_find_mcb(const RawAddress& bd_addr) {
   int i;
+  uint8_t* p_entry = port_mcb_addr_entry(bd_addr);
+
+  /* The entry may be stale, it is used only if it still matches */
+  i = *p_entry - 1;
+  if (i >= 0 && i < MAX_BD_CONNECTIONS &&
+      rfc_cb.port.rfc_mcb[i].state != RFC_MX_STATE_IDLE &&
+      rfc_cb.port.rfc_mcb[i].bd_addr == bd_addr)
+    return (&rfc_cb.port.rfc_mcb[i]);
 
   for (i = 0; i < MAX_BD_CONNECTIONS; i++) {
     if ((rfc_cb.port.rfc_mcb[i].state != RFC_MX_STATE_IDLE) &&
         rfc_cb.port.rfc_mcb[i].bd_addr == bd_addr) {
+      *p_entry = i + 1;
       /* Multiplexer channel found do not change anything */
       VLOG(1) << __func__ << ": found bd_addr:" << bd_addr;
       RFCOMM_TRACE_DEBUG(
@@ -319,7 +393,7 @@ tPORT* port_find_mcb_dlci_port(tRFC_MCB* p_mcb, uint8_t dlci) {
         dlci);
     return (NULL);
   } else
-    return (&rfc_cb.port.port[inx - 1]);
+    return (rfc_cb.port.port[inx - 1]);
 }
 
 /*******************************************************************************
@@ -336,9 +410,9 @@ tPORT* port_find_dlci_port(uint8_t dlci) {
   tPORT* p_port;
 
   for (i = 0; i < MAX_RFC_PORTS; i++) {
-    p_port = &rfc_cb.port.port[i];
+    p_port = rfc_cb.port.port[i];
 
-    if (p_port->in_use && (p_port->rfc.p_mcb == NULL)) {
+    if (p_port && p_port->in_use && (p_port->rfc.p_mcb == NULL)) {
       if (p_port->dlci == dlci) {
         return (p_port);
       } else if ((dlci & 0x01) && (p_port->dlci == (dlci - 1))) {
@@ -363,9 +437,16 @@ tPORT* port_find_port(uint8_t dlci, const RawAddress& bd_addr) {
   uint16_t i;
   tPORT* p_port;
 
+  /* The ports on a multiplexer are indexed by DLCI, the ports not bound to
+   * one yet are searched */
+  p_port = port_find_mcb_dlci_port(port_find_mcb(bd_addr), dlci);
+  if (p_port && p_port->in_use && (p_port->dlci == dlci) &&
+      p_port->bd_addr == bd_addr)
+    return (p_port);
+
   for (i = 0; i < MAX_RFC_PORTS; i++) {
-    p_port = &rfc_cb.port.port[i];
-    if (p_port->in_use && (p_port->dlci == dlci) &&
+    p_port = rfc_cb.port.port[i];
+    if (p_port && p_port->in_use && (p_port->dlci == dlci) &&
         p_port->bd_addr == bd_addr) {
       return (p_port);
     }
@@ -444,6 +525,93 @@ uint32_t port_get_signal_changes(tPORT* p_port, uint8_t old_signals,
   return (p_port->ev_mask & events);
 }
 
+/*******************************************************************************
+ *
+ * Function         port_credit_window_set
+ *
+ * Description      Set the credit window of the port, and scale the credit
+ *                  update watermark with it.
+ *
+ * Returns          nothing
+ *
+ ******************************************************************************/
+static void port_credit_window_set(tPORT* p_port, uint16_t window) {
+  p_port->credit_rx_max = window;
+  p_port->credit_rx_low = (uint16_t)((uint32_t)window *
+                                     p_port->credit_rx_low_base /
+                                     p_port->credit_rx_base);
+  if (p_port->credit_rx_low < p_port->credit_rx_low_base)
+    p_port->credit_rx_low = p_port->credit_rx_low_base;
+  if (window > p_port->credit_rx_peak) p_port->credit_rx_peak = window;
+}
+
+/*******************************************************************************
+ *
+ * Function         port_credit_window_grow
+ *
+ * Description      Called when the peer used its last credit while the user
+ *                  takes the data as fast as it comes: credit updates do not
+ *                  reach the peer in time, so the credit window grows, up to
+ *                  PORT_CREDIT_RX_MAX_WINDOW and as long as the receive
+ *                  memory granted to all ports stays in
+ *                  PORT_CREDIT_RX_POOL_SIZE, scaled down under memory
+ *                  pressure.
+ *
+ * Returns          nothing
+ *
+ ******************************************************************************/
+void port_credit_window_grow(tPORT* p_port) {
+  uint32_t pool = 0;
+  uint16_t window;
+  int xx;
+
+  if (p_port->credit_rx_base == 0 ||
+      p_port->credit_rx_max >= PORT_CREDIT_RX_MAX_WINDOW)
+    return;
+
+  window = p_port->credit_rx_max + PORT_CREDIT_RX_WINDOW_STEP;
+  if (window > PORT_CREDIT_RX_MAX_WINDOW) window = PORT_CREDIT_RX_MAX_WINDOW;
+
+  for (xx = 0; xx < MAX_RFC_PORTS; xx++) {
+    tPORT* p = rfc_cb.port.port[xx];
+    if (p && p->in_use && p->credit_rx_max > p->credit_rx_base)
+      pool += (uint32_t)(p->credit_rx_max - p->credit_rx_base) * p->mtu;
+  }
+  pool += (uint32_t)(window - p_port->credit_rx_max) * p_port->mtu;
+  if (pool > memory_governor_scale(PORT_CREDIT_RX_POOL_SIZE, 0,
+                                   port_rx_pressure()))
+    return;
+
+  port_credit_window_set(p_port, window);
+  p_port->credit_rx_grows++;
+  RFCOMM_TRACE_DEBUG("%s: handle:%d credit window %d", __func__, p_port->inx,
+                     p_port->credit_rx_max);
+}
+
+/*******************************************************************************
+ *
+ * Function         port_credit_window_shrink
+ *
+ * Description      Called when the user could not take a frame at once: the
+ *                  data waits in memory, so the credit window is halved, down
+ *                  to the initial one.
+ *
+ * Returns          nothing
+ *
+ ******************************************************************************/
+void port_credit_window_shrink(tPORT* p_port) {
+  uint16_t window = p_port->credit_rx_max / 2;
+
+  if (p_port->credit_rx_base == 0) return;
+  if (window < p_port->credit_rx_base) window = p_port->credit_rx_base;
+  if (window == p_port->credit_rx_max) return;
+
+  port_credit_window_set(p_port, window);
+  p_port->credit_rx_shrinks++;
+  RFCOMM_TRACE_DEBUG("%s: handle:%d credit window %d", __func__, p_port->inx,
+                     p_port->credit_rx_max);
+}
+
 /*******************************************************************************
  *
  * Function         port_flow_control_peer
@@ -518,8 +686,12 @@ void port_flow_control_peer(tPORT* p_port, bool enable, uint16_t count) {
       }
       /* Check the size of the rx queue.  If it exceeds certain */
       /* level and flow control has not been sent to the peer do it now */
-      else if (((p_port->rx.queue_size > PORT_RX_HIGH_WM) ||
-                (fixed_queue_length(p_port->rx.queue) > PORT_RX_BUF_HIGH_WM)) &&
+      else if (((p_port->rx.queue_size >
+                 memory_governor_scale(PORT_RX_HIGH_WM, PORT_RX_LOW_WM,
+                                       port_rx_pressure())) ||
+                (fixed_queue_length(p_port->rx.queue) >
+                 memory_governor_scale(PORT_RX_BUF_HIGH_WM, PORT_RX_BUF_LOW_WM,
+                                       port_rx_pressure()))) &&
                !p_port->rx.peer_fc) {
         RFCOMM_TRACE_EVENT("PORT_DataInd Data reached HW. Sending FC set.");
 
@@ -171,9 +171,9 @@ void RFCOMM_ConnectCnf(uint16_t lcid, uint16_t result) {
         if (idx != 0) {
           p_mcb->port_inx[i] = 0;
           p_mcb->port_inx[i + 1] = idx;
-          rfc_cb.port.port[idx - 1].dlci += 1;
+          rfc_cb.port.port[idx - 1]->dlci += 1;
           RFCOMM_TRACE_DEBUG("RFCOMM MX - DLCI:%d -> %d", i,
-                             rfc_cb.port.port[idx - 1].dlci);
+                             rfc_cb.port.port[idx - 1]->dlci);
         }
       }
 
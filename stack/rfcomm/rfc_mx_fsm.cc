@@ -237,9 +237,9 @@ void rfc_mx_sm_state_wait_conn_cnf(tRFC_MCB* p_mcb, uint16_t event,
           if (idx != 0) {
             p_mcb->port_inx[i] = 0;
             p_mcb->port_inx[i + 1] = idx;
-            rfc_cb.port.port[idx - 1].dlci += 1;
+            rfc_cb.port.port[idx - 1]->dlci += 1;
             RFCOMM_TRACE_DEBUG("RFCOMM MX - DLCI:%d -> %d", i,
-                               rfc_cb.port.port[idx - 1].dlci);
+                               rfc_cb.port.port[idx - 1]->dlci);
           }
         }
 
@@ -405,9 +405,9 @@ void rfc_mx_sm_state_wait_sabme(tRFC_MCB* p_mcb, uint16_t event, void* p_data) {
         p_mcb->state = RFC_MX_STATE_CONNECTED;
         p_mcb->peer_ready = true;
         bool no_outgoing_ports_up = true;
-        p_port = &rfc_cb.port.port[0];
-        for (i = 0; i < MAX_RFC_PORTS; i++, p_port++) {
-          if (p_port->rfc.p_mcb == p_mcb) {
+        for (i = 0; i < MAX_RFC_PORTS; i++) {
+          p_port = rfc_cb.port.port[i];
+          if (p_port != NULL && p_port->rfc.p_mcb == p_mcb) {
              no_outgoing_ports_up = false;
              PORT_StartCnf (p_mcb, RFCOMM_SUCCESS);
              break;
@@ -209,8 +209,8 @@ void rfc_release_multiplexer_channel(tRFC_MCB* p_mcb) {
 
   /* Remove the MCB from the ports */
   for (int i = 0; i < MAX_RFC_PORTS; i++) {
-    if (rfc_cb.port.port[i].rfc.p_mcb == p_mcb)
-      rfc_cb.port.port[i].rfc.p_mcb = NULL;
+    tPORT* p_port = rfc_cb.port.port[i];
+    if (p_port != NULL && p_port->rfc.p_mcb == p_mcb) p_port->rfc.p_mcb = NULL;
   }
 
   rfc_timer_stop(p_mcb);
@@ -412,7 +412,10 @@ void rfc_dec_credit(tPORT* p_port) {
 
         RFCOMM_TRACE_EVENT ("rfc_dec_credit:%d", p_port->credit_tx);
 
-    if (p_port->credit_tx == 0) p_port->tx.peer_fc = true;
+    if (p_port->credit_tx == 0) {
+      if (!p_port->tx.peer_fc) p_port->credit_tx_stalls++;
+      p_port->tx.peer_fc = true;
+    }
   }
 }
 
@@ -72,12 +72,17 @@
 #include "sdp_api.h"
 #include "sdpint.h"
 
+using bluetooth::Uuid;
+
 #if (SDP_SERVER_ENABLED == TRUE)
 /******************************************************************************/
 /*            L O C A L    F U N C T I O N     P R O T O T Y P E S            */
 /******************************************************************************/
 static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_his_uuid,
                              uint16_t his_len, int nest_level);
+static void sdp_db_build_uuid_cache(tSDP_RECORD* p_rec);
+static bool sdp_db_rec_has_uuid(const tSDP_RECORD* p_rec,
+                                const uint8_t* p_uuid128);
 
 /*******************************************************************************
  *
@@ -102,9 +107,30 @@ tSDP_RECORD* sdp_db_service_search(tSDP_RECORD* p_rec, tSDP_UUID_SEQ* p_seq) {
   else
     p_rec++;
 
+  /* Expand the searched UUIDs once, the records are then matched against */
+  /* the UUIDs cached for them instead of parsing their attributes.        */
+  uint8_t uuids[MAX_UUIDS_PER_SEQ][Uuid::kNumBytes128];
+  bool use_cache = (p_seq->num_uids <= MAX_UUIDS_PER_SEQ);
+  for (yy = 0; use_cache && yy < p_seq->num_uids; yy++) {
+    use_cache = sdpu_normalize_uuid(p_seq->uuid_entry[yy].value,
+                                    p_seq->uuid_entry[yy].len, uuids[yy]);
+  }
+
   /* Look through the records. The spec says that a match occurs if */
   /* the record contains all the passed UUIDs in it.                */
   for (; p_rec < p_end; p_rec++) {
+    if (use_cache) {
+      if (!p_rec->uuids_valid) sdp_db_build_uuid_cache(p_rec);
+
+      if (!p_rec->uuids_overflow) {
+        for (yy = 0; yy < p_seq->num_uids; yy++) {
+          if (!sdp_db_rec_has_uuid(p_rec, uuids[yy])) break;
+        }
+        if (yy == p_seq->num_uids) return (p_rec);
+        continue;
+      }
+    }
+
     for (yy = 0; yy < p_seq->num_uids; yy++) {
       p_attr = &p_rec->attribute[0];
       for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++) {
@@ -171,6 +197,115 @@ static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_uuid,
   return (false);
 }
 
+/*******************************************************************************
+ *
+ * Function         sdp_db_add_uuid_to_cache
+ *
+ * Description      This function adds a UUID found in the attributes of a
+ *                  record to the UUIDs cached for the record.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_db_add_uuid_to_cache(tSDP_RECORD* p_rec, uint8_t* p_uuid,
+                                     uint32_t len) {
+  uint8_t uuid[Uuid::kNumBytes128];
+
+  /* An invalid UUID does not match anything */
+  if (!sdpu_normalize_uuid(p_uuid, len, uuid)) return;
+
+  if (sdp_db_rec_has_uuid(p_rec, uuid)) return;
+
+  if (p_rec->num_uuids == SDP_MAX_REC_UUIDS) {
+    p_rec->uuids_overflow = true;
+    return;
+  }
+
+  memcpy(p_rec->uuids[p_rec->num_uuids++], uuid, Uuid::kNumBytes128);
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_add_seq_to_uuid_cache
+ *
+ * Description      This function adds the UUIDs of a data element sequence to
+ *                  the UUIDs cached for a record. It parses the sequence the
+ *                  same way as find_uuid_in_seq.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_db_add_seq_to_uuid_cache(tSDP_RECORD* p_rec, uint8_t* p,
+                                         uint32_t seq_len, int nest_level) {
+  uint8_t* p_end = p + seq_len;
+  uint8_t type;
+  uint32_t len;
+
+  /* find_uuid_in_seq does not look any deeper */
+  if (nest_level > 3) return;
+
+  while (p < p_end) {
+    type = *p++;
+    p = sdpu_get_len_from_type(p, p_end, type, &len);
+    if (p == NULL || (p + len) > p_end) break;
+
+    type = type >> 3;
+    if (type == UUID_DESC_TYPE)
+      sdp_db_add_uuid_to_cache(p_rec, p, len);
+    else if (type == DATA_ELE_SEQ_DESC_TYPE)
+      sdp_db_add_seq_to_uuid_cache(p_rec, p, len, nest_level + 1);
+    p = p + len;
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_build_uuid_cache
+ *
+ * Description      This function collects the UUIDs found in the attributes of
+ *                  a record, in their 16 byte form. If there are more than
+ *                  SDP_MAX_REC_UUIDS, the record is searched by parsing its
+ *                  attributes.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_db_build_uuid_cache(tSDP_RECORD* p_rec) {
+  tSDP_ATTRIBUTE* p_attr = &p_rec->attribute[0];
+  uint16_t xx;
+
+  p_rec->num_uuids = 0;
+  p_rec->uuids_overflow = false;
+
+  for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++) {
+    if (p_attr->type == UUID_DESC_TYPE)
+      sdp_db_add_uuid_to_cache(p_rec, p_attr->value_ptr, p_attr->len);
+    else if (p_attr->type == DATA_ELE_SEQ_DESC_TYPE)
+      sdp_db_add_seq_to_uuid_cache(p_rec, p_attr->value_ptr, p_attr->len, 0);
+  }
+
+  p_rec->uuids_valid = true;
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_rec_has_uuid
+ *
+ * Description      This function checks the UUIDs cached for a record for a
+ *                  16 byte UUID.
+ *
+ * Returns          true if found, else false
+ *
+ ******************************************************************************/
+static bool sdp_db_rec_has_uuid(const tSDP_RECORD* p_rec,
+                                const uint8_t* p_uuid128) {
+  for (uint8_t xx = 0; xx < p_rec->num_uuids; xx++) {
+    if (memcmp(p_rec->uuids[xx], p_uuid128, Uuid::kNumBytes128) == 0)
+      return (true);
+  }
+  return (false);
+}
+
 /*******************************************************************************
  *
  * Function         sdp_db_find_record
@@ -208,15 +343,22 @@ tSDP_RECORD* sdp_db_find_record(uint32_t handle) {
  ******************************************************************************/
 tSDP_ATTRIBUTE* sdp_db_find_attr_in_rec(tSDP_RECORD* p_rec, uint16_t start_attr,
                                         uint16_t end_attr) {
-  tSDP_ATTRIBUTE* p_at;
-  uint16_t xx;
-
-  /* Note that the attributes in a record are assumed to be in sorted order */
-  for (xx = 0, p_at = &p_rec->attribute[0]; xx < p_rec->num_attributes;
-       xx++, p_at++) {
-    if ((p_at->id >= start_attr) && (p_at->id <= end_attr)) return (p_at);
+  uint16_t lo = 0;
+  uint16_t hi = p_rec->num_attributes;
+
+  /* The attributes in a record are kept in sorted order, find the first one */
+  /* at or past the start of the range                                       */
+  while (lo < hi) {
+    uint16_t mid = lo + (hi - lo) / 2;
+    if (p_rec->attribute[mid].id < start_attr)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
 
+  if (lo < p_rec->num_attributes && p_rec->attribute[lo].id <= end_attr)
+    return (&p_rec->attribute[lo]);
+
   /* No matching attribute found */
   return (NULL);
 }
@@ -474,6 +616,8 @@ bool SDP_AddAttributeToRecord (tSDP_RECORD *p_rec, uint16_t attr_id,
     uint16_t xx, yy;
     tSDP_ATTRIBUTE* p_attr = &p_rec->attribute[0];
 
+    p_rec->uuids_valid = false;
+
     /* Found the record. Now, see if the attribute already exists */
     for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++) {
       /* The attribute exists. replace it */
@@ -1000,6 +1144,8 @@ bool SDP_DeleteAttributeFromRecord (tSDP_RECORD* p_rec, uint16_t attr_id)
   uint8_t *pad_ptr;
   uint32_t len;                        /* Number of bytes in the entry */
 
+  p_rec->uuids_valid = false;
+
   /* Found it. Now, find the attribute */
   for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++) {
     if (p_attr->id == attr_id) {
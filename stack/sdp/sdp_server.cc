@@ -159,6 +159,9 @@ static bool check_remote_map_version_104(RawAddress remote_addr);
 #define SDP_ENABLE_PTS_MAP  "vendor.bt.pts.map"
 #endif
 
+OSI_CACHED_PROPERTY(pts_pbap_property, SDP_ENABLE_PTS_PBAP, false);
+OSI_CACHED_PROPERTY(pts_map_property, SDP_ENABLE_PTS_MAP, false);
+
 #define MAP_1_4 0x0104
 
 struct blacklist_entry
@@ -1450,13 +1453,8 @@ static uint16_t sdp_update_pbap_blacklist_len(tCONN_CB* p_ccb, tSDP_ATTR_SEQ* at
   bool is_pbap_102_supported = check_remote_pbap_version_102(p_ccb->device_address);
   bool is_pbap_101_blacklisted = is_device_blacklisted_for_pbap(p_ccb->device_address, false);
   bool is_pbap_102_blacklisted = is_device_blacklisted_for_pbap(p_ccb->device_address, true);
-  bool running_pts = false;
-  char pts_property[6];
-  osi_property_get(SDP_ENABLE_PTS_PBAP, pts_property, "false");
-  if (!strncmp("true", pts_property, 4)) {
-    SDP_TRACE_DEBUG("%s pts running= %d", __func__, pts_property);
-    running_pts = true;
-  }
+  bool running_pts = osi_cached_property_get_bool(&pts_pbap_property);
+  SDP_TRACE_DEBUG("%s pts running= %d", __func__, running_pts);
   SDP_TRACE_DEBUG("%s remote BD Addr : %s is_pbap_102_supported = %d "
       "is_pbap_1_1__blacklisted = %d is_pbap_1_2__blacklisted = %d "
       "running_pts = %d", __func__,
@@ -1545,13 +1543,8 @@ static tSDP_RECORD *sdp_upgrade_pse_record(tSDP_RECORD * p_rec,
   is_pbap_102_supported = check_remote_pbap_version_102(remote_address);
   bool is_pbap_101_blacklisted = is_device_blacklisted_for_pbap(remote_address, false);
   bool is_pbap_102_blacklisted = is_device_blacklisted_for_pbap(remote_address, true);
-  bool running_pts = false;
-  char pts_property[6];
-  osi_property_get(SDP_ENABLE_PTS_PBAP, pts_property, "false");
-  if (!strncmp("true", pts_property, 4)) {
-    SDP_TRACE_DEBUG("%s pts running= %d", __func__, pts_property);
-    running_pts = true;
-  }
+  bool running_pts = osi_cached_property_get_bool(&pts_pbap_property);
+  SDP_TRACE_DEBUG("%s pts running= %d", __func__, running_pts);
   SDP_TRACE_DEBUG("%s remote BD Addr : %s is_pbap_102_supported : %d "
       "is_pbap_1_1__blacklisted = %d is_pbap_1_2__blacklisted = %d "
       "running_pts = %d", __func__,
@@ -1928,13 +1921,8 @@ static tSDP_RECORD *sdp_upgrade_mse_record(tSDP_RECORD * p_rec,
   }
   /* Check if remote supports MAP 1.4 */
   is_map_104_supported = check_remote_map_version_104(remote_address);
-  bool running_pts = false;
-  char pts_property[6];
-  osi_property_get(SDP_ENABLE_PTS_MAP, pts_property, "false");
-  if (!strncmp("true", pts_property, 4)) {
-    SDP_TRACE_DEBUG("%s pts running= %s", __func__, pts_property);
-    running_pts = true;
-  }
+  bool running_pts = osi_cached_property_get_bool(&pts_map_property);
+  SDP_TRACE_DEBUG("%s pts running= %d", __func__, running_pts);
   APPL_TRACE_ERROR("%s remote BD Addr : %s is_map_104_supported : %d running_pts = %d",
       __func__,remote_address.ToString().c_str(),is_map_104_supported,running_pts);
 
@@ -721,6 +721,31 @@ bool sdpu_compare_uuid_arrays(uint8_t* p_uuid1, uint32_t len1, uint8_t* p_uuid2,
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         sdpu_normalize_uuid
+ *
+ * Description      This function expands a 2, 4 or 16 byte UUID to its 16 byte
+ *                  form. Two UUIDs match in sdpu_compare_uuid_arrays if and
+ *                  only if their 16 byte forms are equal.
+ *
+ * Returns          true if the length is valid, else false
+ *
+ ******************************************************************************/
+bool sdpu_normalize_uuid(const uint8_t* p_uuid, uint32_t len,
+                         uint8_t* p_uuid128) {
+  memcpy(p_uuid128, sdp_base_uuid, Uuid::kNumBytes128);
+
+  if (len == 2)
+    memcpy(p_uuid128 + 2, p_uuid, len);
+  else if (len == 4 || len == Uuid::kNumBytes128)
+    memcpy(p_uuid128, p_uuid, len);
+  else
+    return false;
+
+  return true;
+}
+
 /*******************************************************************************
  *
  * Function         sdpu_compare_uuid_with_attr
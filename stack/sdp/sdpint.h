@@ -123,6 +123,13 @@ typedef struct {
   uint16_t num_attributes;
   tSDP_ATTRIBUTE attribute[SDP_MAX_REC_ATTR];
   uint8_t attr_pad[SDP_MAX_PAD_LEN];
+
+  /* UUIDs found in the attributes, in 128-bit form. Collected by the first
+   * service search after the attributes change. */
+  bool uuids_valid;
+  bool uuids_overflow; /* More than SDP_MAX_REC_UUIDS UUIDs */
+  uint8_t num_uuids;
+  uint8_t uuids[SDP_MAX_REC_UUIDS][bluetooth::Uuid::kNumBytes128];
 } tSDP_RECORD;
 
 /* Define the SDP database */
@@ -273,6 +280,8 @@ extern uint8_t* sdpu_get_len_from_type(uint8_t* p, uint8_t* p_end, uint8_t type,
 extern bool sdpu_is_base_uuid(uint8_t* p_uuid);
 extern bool sdpu_compare_uuid_arrays(uint8_t* p_uuid1, uint32_t len1,
                                      uint8_t* p_uuid2, uint16_t len2);
+extern bool sdpu_normalize_uuid(const uint8_t* p_uuid, uint32_t len,
+                                uint8_t* p_uuid128);
 extern bool sdpu_compare_uuid_with_attr(const bluetooth::Uuid& uuid,
                                         tSDP_DISC_ATTR* p_attr);
 
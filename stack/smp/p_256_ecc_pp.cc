@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <mutex>
 #include "p_256_multprecision.h"
 
 elliptic_curve_t curve;
@@ -246,6 +247,224 @@ void ECC_PointMult_Bin_NAF(Point* q, Point* p, uint32_t* n,
   multiprecision_mersenns_mult_mod(q->y, q->y, q->z, keyLength);
 }
 
+// Constant time helpers used by the fixed-base and windowed multiplications
+// below, so that the sequence of point operations and table accesses does not
+// depend on the private scalar.
+
+// r = mask ? a : r, mask is all ones or zero
+static void p_256_cond_copy_point(Point* r, const Point* a, uint32_t mask) {
+  for (uint32_t i = 0; i < KEY_LENGTH_DWORDS_P256; i++) {
+    r->x[i] = (r->x[i] & ~mask) | (a->x[i] & mask);
+    r->y[i] = (r->y[i] & ~mask) | (a->y[i] & mask);
+    r->z[i] = (r->z[i] & ~mask) | (a->z[i] & mask);
+  }
+}
+
+// r = table[idx], reading every entry of the table
+static void p_256_select_point(Point* r, const Point* table, uint32_t len,
+                               uint32_t idx) {
+  p_256_init_point(r);
+  for (uint32_t i = 0; i < len; i++) {
+    uint32_t mask = 0 - (uint32_t)(i == idx);
+    p_256_cond_copy_point(r, &table[i], mask);
+  }
+}
+
+// p = -p if mask is all ones
+static void p_256_cond_negate_point(Point* p, uint32_t mask) {
+  uint32_t minus_y[KEY_LENGTH_DWORDS_P256];
+  multiprecision_sub(minus_y, curve_p256.p, p->y, KEY_LENGTH_DWORDS_P256);
+  for (uint32_t i = 0; i < KEY_LENGTH_DWORDS_P256; i++)
+    p->y[i] = (p->y[i] & ~mask) | (minus_y[i] & mask);
+}
+
+// Converts q from jacobian to affine coordinates, q->z must not be zero
+static void p_256_to_affine(Point* q) {
+  const uint32_t kl = KEY_LENGTH_DWORDS_P256;
+  uint32_t z_inv[KEY_LENGTH_DWORDS_P256];
+  uint32_t t[KEY_LENGTH_DWORDS_P256];
+
+  multiprecision_inv_mod(z_inv, q->z, kl);
+  multiprecision_mersenns_squa_mod(t, z_inv, kl);
+  multiprecision_mersenns_mult_mod(q->x, q->x, t, kl);
+  multiprecision_mersenns_mult_mod(t, t, z_inv, kl);
+  multiprecision_mersenns_mult_mod(q->y, q->y, t, kl);
+  multiprecision_init(q->z, kl);
+  q->z[0] = 1;
+}
+
+// Converts |len| points to affine coordinates with a single inversion
+// (Montgomery's trick). None of the points may be the point at infinity.
+static void p_256_batch_to_affine(Point* points, uint32_t len) {
+  const uint32_t kl = KEY_LENGTH_DWORDS_P256;
+  uint32_t prod[8][KEY_LENGTH_DWORDS_P256];
+  uint32_t inv[KEY_LENGTH_DWORDS_P256];
+  uint32_t z_inv[KEY_LENGTH_DWORDS_P256];
+  uint32_t t[KEY_LENGTH_DWORDS_P256];
+
+  // prod[i] = z0 * z1 * ... * zi
+  multiprecision_copy(prod[0], points[0].z, kl);
+  for (uint32_t i = 1; i < len; i++)
+    multiprecision_mersenns_mult_mod(prod[i], prod[i - 1], points[i].z, kl);
+
+  multiprecision_copy(t, prod[len - 1], kl);
+  multiprecision_inv_mod(inv, t, kl);
+
+  for (int i = len - 1; i >= 0; i--) {
+    // z_inv = (z0 * ... * zi)^-1 * (z0 * ... * zi-1)
+    if (i > 0) {
+      multiprecision_mersenns_mult_mod(z_inv, inv, prod[i - 1], kl);
+      multiprecision_mersenns_mult_mod(inv, inv, points[i].z, kl);
+    } else {
+      multiprecision_copy(z_inv, inv, kl);
+    }
+
+    multiprecision_mersenns_squa_mod(t, z_inv, kl);
+    multiprecision_mersenns_mult_mod(points[i].x, points[i].x, t, kl);
+    multiprecision_mersenns_mult_mod(t, t, z_inv, kl);
+    multiprecision_mersenns_mult_mod(points[i].y, points[i].y, t, kl);
+    multiprecision_init(points[i].z, kl);
+    points[i].z[0] = 1;
+  }
+}
+
+// Comb table for the base point: comb_table[i] = sum of 2^(64 * t) * G over
+// the bits t set in i, in affine coordinates. Entry 0 is unused. Built once,
+// public keys may be computed off the btu thread by the SMP key pool.
+#define P256_COMB_TEETH 4
+#define P256_COMB_SPACING 64
+static Point comb_table[1 << P256_COMB_TEETH];
+static std::once_flag comb_table_once;
+
+static void p_256_init_comb_table() {
+  const uint32_t kl = KEY_LENGTH_DWORDS_P256;
+  Point r;
+
+  p_256_copy_point(&comb_table[1], &curve_p256.G);
+  multiprecision_init(comb_table[1].z, kl);
+  comb_table[1].z[0] = 1;
+
+  // comb_table[2^t] = 2^64 * comb_table[2^(t-1)]
+  for (int t = 1; t < P256_COMB_TEETH; t++) {
+    Point* q = &comb_table[1 << t];
+    p_256_copy_point(q, &comb_table[1 << (t - 1)]);
+    for (int i = 0; i < P256_COMB_SPACING; i++) {
+      p_256_copy_point(&r, q);
+      ECC_Double(q, &r, kl);
+    }
+    p_256_to_affine(q);
+  }
+
+  // comb_table[i] = comb_table[i - top] + comb_table[top]
+  for (int i = 3; i < (1 << P256_COMB_TEETH); i++) {
+    int top = 1 << (31 - __builtin_clz(i));
+    if (i == top) continue;
+    p_256_copy_point(&r, &comb_table[i - top]);
+    ECC_Add(&comb_table[i], &r, &comb_table[top], kl);
+    p_256_to_affine(&comb_table[i]);
+  }
+}
+
+// Fixed-base comb multiplication q = n * G on P-256. Uses 64 doublings and 64
+// additions against a precomputed table instead of the ~256 doublings of the
+// binary NAF method.
+void ECC_PointMult_Base(Point* q, uint32_t* n) {
+  const uint32_t kl = KEY_LENGTH_DWORDS_P256;
+  Point r;
+  Point sum;
+  Point entry;
+
+  std::call_once(comb_table_once, p_256_init_comb_table);
+
+  p_256_init_point(q);
+
+  for (int col = P256_COMB_SPACING - 1; col >= 0; col--) {
+    p_256_copy_point(&r, q);
+    ECC_Double(q, &r, kl);
+
+    uint32_t idx = 0;
+    for (int t = 0; t < P256_COMB_TEETH; t++) {
+      int bit = col + t * P256_COMB_SPACING;
+      idx |= ((n[bit / DWORD_BITS] >> (bit % DWORD_BITS)) & 0x01) << t;
+    }
+
+    // Always add, and discard the sum when the column is empty
+    uint32_t nonzero = 0 - (uint32_t)(idx != 0);
+    p_256_select_point(&entry, comb_table, 1 << P256_COMB_TEETH,
+                       idx | (~nonzero & 0x01));
+    p_256_copy_point(&r, q);
+    ECC_Add(&sum, &r, &entry, kl);
+    p_256_cond_copy_point(q, &sum, nonzero);
+  }
+
+  p_256_to_affine(q);
+}
+
+// Fixed-window multiplication q = n * p on P-256 with a regular signed digit
+// recoding: every 4 bit window is an odd digit in [-15, 15], so each window
+// costs four doublings and exactly one addition from a table of odd multiples.
+void ECC_PointMult_Window(Point* q, Point* p, uint32_t* n) {
+  const uint32_t kl = KEY_LENGTH_DWORDS_P256;
+  Point table[8];  // p, 3p, 5p, ..., 15p
+  Point two_p;
+  Point r;
+  Point entry;
+  int8_t digits[64];
+  uint32_t k[KEY_LENGTH_DWORDS_P256];
+
+  multiprecision_init(p->z, kl);
+  p->z[0] = 1;
+
+  // odd multiples of p
+  ECC_Double(&two_p, p, kl);
+  p_256_to_affine(&two_p);
+  p_256_copy_point(&table[0], p);
+  for (int i = 1; i < 8; i++) {
+    p_256_copy_point(&r, &table[i - 1]);
+    ECC_Add(&table[i], &r, &two_p, kl);
+  }
+  p_256_batch_to_affine(&table[1], 7);
+
+  // Recode the odd scalar k = n | 1 into digits d_i = (k mod 32) - 16,
+  // k = (k - d_i) / 16 = (k >> 4) | 1, which ends with k == 1.
+  multiprecision_copy(k, n, kl);
+  uint32_t even = 0 - (uint32_t)(~n[0] & 0x01);
+  k[0] |= 1;
+  for (int i = 0; i < 64; i++) {
+    digits[i] = (int8_t)(k[0] & 0x1F) - 16;
+    for (uint32_t j = 0; j < kl - 1; j++) k[j] = (k[j] >> 4) | (k[j + 1] << 28);
+    k[kl - 1] >>= 4;
+    k[0] |= 1;
+  }
+
+  p_256_copy_point(q, p);
+  for (int i = 63; i >= 0; i--) {
+    for (int j = 0; j < 4; j++) {
+      p_256_copy_point(&r, q);
+      ECC_Double(q, &r, kl);
+    }
+
+    int8_t d = digits[i];
+    uint32_t negative = 0 - (uint32_t)(d < 0);
+    uint32_t abs_d = (uint32_t)((d ^ (int8_t)negative) - (int8_t)negative);
+    p_256_select_point(&entry, table, 8, abs_d >> 1);
+    p_256_cond_negate_point(&entry, negative);
+
+    p_256_copy_point(&r, q);
+    ECC_Add(q, &r, &entry, kl);
+  }
+
+  // n was even, so (n + 1) * p was computed: subtract p
+  p_256_copy_point(&entry, p);
+  p_256_cond_negate_point(&entry, 0xFFFFFFFF);
+  p_256_copy_point(&r, q);
+  Point corrected;
+  ECC_Add(&corrected, &r, &entry, kl);
+  p_256_cond_copy_point(q, &corrected, even);
+
+  p_256_to_affine(q);
+}
+
 bool ECC_ValidatePoint(const Point& pt) {
   const size_t kl = KEY_LENGTH_DWORDS_P256;
   p_256_init_curve(kl);
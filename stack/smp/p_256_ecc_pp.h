@@ -60,6 +60,12 @@ bool ECC_ValidatePoint(const Point& p);
 
 void ECC_PointMult_Bin_NAF(Point* q, Point* p, uint32_t* n, uint32_t keyLength);
 
+// q = n * G on P-256
+void ECC_PointMult_Base(Point* q, uint32_t* n);
+
+// q = n * p on P-256
+void ECC_PointMult_Window(Point* q, Point* p, uint32_t* n);
+
 #define ECC_PointMult(q, p, n, keyLength) \
   ECC_PointMult_Bin_NAF(q, p, n, keyLength)
 
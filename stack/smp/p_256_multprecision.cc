@@ -223,6 +223,35 @@ uint32_t multiprecision_lshift(uint32_t* c, uint32_t* a, uint32_t keyLength) {
   return carrier;
 }
 
+#if defined(__SIZEOF_INT128__) && \
+    (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+// c=a*b for P-256 operands using 64 bit limbs, 16 partial products instead
+// of 64. Relies on two little endian uint32_t limbs forming one uint64_t.
+__attribute__((no_sanitize("integer")))
+static void multiprecision_mult_p256_64(uint32_t* c, uint32_t* a,
+                                        uint32_t* b) {
+  uint64_t a64[KEY_LENGTH_DWORDS_P256 / 2];
+  uint64_t b64[KEY_LENGTH_DWORDS_P256 / 2];
+  uint64_t c64[KEY_LENGTH_DWORDS_P256] = {0};
+
+  memcpy(a64, a, sizeof(a64));
+  memcpy(b64, b, sizeof(b64));
+
+  for (int i = 0; i < KEY_LENGTH_DWORDS_P256 / 2; i++) {
+    uint64_t carry = 0;
+    for (int j = 0; j < KEY_LENGTH_DWORDS_P256 / 2; j++) {
+      unsigned __int128 t =
+          (unsigned __int128)a64[i] * b64[j] + c64[i + j] + carry;
+      c64[i + j] = (uint64_t)t;
+      carry = (uint64_t)(t >> 64);
+    }
+    c64[i + KEY_LENGTH_DWORDS_P256 / 2] = carry;
+  }
+
+  memcpy(c, c64, sizeof(c64));
+}
+#endif
+
 // c=a*b; c must have a buffer of 2*Key_LENGTH_uint32_tS, c != a != b
 __attribute__((no_sanitize("integer")))
 void multiprecision_mult(uint32_t* c, uint32_t* a, uint32_t* b,
@@ -231,6 +260,14 @@ void multiprecision_mult(uint32_t* c, uint32_t* a, uint32_t* b,
   uint32_t U;
   uint32_t V;
 
+#if defined(__SIZEOF_INT128__) && \
+    (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  if (keyLength == KEY_LENGTH_DWORDS_P256) {
+    multiprecision_mult_p256_64(c, a, b);
+    return;
+  }
+#endif
+
   U = V = W = 0;
   multiprecision_init(c, keyLength);
 
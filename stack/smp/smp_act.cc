@@ -1537,8 +1537,19 @@ void smp_idle_terminate(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
 void smp_both_have_public_keys(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
   SMP_TRACE_DEBUG("%s", __func__);
 
-  /* invokes DHKey computation */
+  /* invokes DHKey computation, smp_dhkey_computed() follows */
   smp_compute_dhkey(p_cb);
+}
+
+/*******************************************************************************
+ * Function     smp_dhkey_computed
+ * Description  The function is called once the DHKey is saved.
+ *              Actions:
+ *              - on slave side invokes sending local public key to the peer.
+ *              - invokes SC phase 1 process.
+ ******************************************************************************/
+void smp_dhkey_computed(tSMP_CB* p_cb) {
+  SMP_TRACE_DEBUG("%s", __func__);
 
   /* on slave side invokes sending local public key to the peer */
   if (p_cb->role == HCI_ROLE_SLAVE) smp_send_pair_public_key(p_cb, NULL);
@@ -403,6 +403,7 @@ extern void smp_proc_srk_info(tSMP_CB* p_cb, tSMP_INT_DATA* p_data);
 extern void smp_generate_csrk(tSMP_CB* p_cb, tSMP_INT_DATA* p_data);
 extern void smp_key_pick_key(tSMP_CB* p_cb, tSMP_INT_DATA* p_data);
 extern void smp_both_have_public_keys(tSMP_CB* p_cb, tSMP_INT_DATA* p_data);
+extern void smp_dhkey_computed(tSMP_CB* p_cb);
 extern void smp_start_secure_connection_phase1(tSMP_CB* p_cb,
                                                tSMP_INT_DATA* p_data);
 extern void smp_process_local_nonce(tSMP_CB* p_cb, tSMP_INT_DATA* p_data);
@@ -495,6 +496,13 @@ extern void smp_start_nonce_generation(tSMP_CB* p_cb);
 extern bool smp_calculate_link_key_from_long_term_key(tSMP_CB* p_cb);
 extern bool smp_calculate_long_term_key_from_link_key(tSMP_CB* p_cb);
 
+/* smp_key_pool.cc */
+extern void smp_key_pool_refill(void);
+extern bool smp_key_pool_take(BT_OCTET32 private_key,
+                              tSMP_PUBLIC_KEY* p_public_key);
+extern void smp_key_pool_discard(const BT_OCTET32 private_key);
+extern void smp_key_pool_free(void);
+
 #if (SMP_DEBUG == TRUE)
 extern void smp_debug_print_nbyte_little_endian(uint8_t* p,
                                                 const char* key_name,
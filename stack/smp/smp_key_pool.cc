@@ -0,0 +1,223 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains a pool of precomputed local P-256 key pairs for LE
+ *  Secure Connections, so that pairing does not wait for the controller
+ *  random numbers and the public key computation.
+ *
+ *  The pool is owned by the btu thread. Only the point multiplication runs in
+ *  the thread pool, on an entry that is handed over and handed back.
+ *
+ ******************************************************************************/
+
+#include <base/bind.h>
+#include <base/location.h>
+#include <base/logging.h>
+#include <base/threading/thread.h>
+#include <string.h>
+
+#include "btu.h"
+#include "common/thread_pool.h"
+#include "hcimsgs.h"
+#include "osi/include/allocator.h"
+#include "p_256_ecc_pp.h"
+#include "smp_int.h"
+
+/* Number of key pairs kept ready */
+#ifndef SMP_KEY_POOL_SIZE
+#define SMP_KEY_POOL_SIZE 2
+#endif
+
+/* Number of pairings a key pair may be used for before it is discarded. The
+ * spec allows a device to keep its key pair across pairings; 1 generates a
+ * fresh key pair for every pairing. A key pair is always discarded after a
+ * failed pairing. */
+#ifndef SMP_KEY_POOL_MAX_REUSE
+#define SMP_KEY_POOL_MAX_REUSE 1
+#endif
+
+typedef struct {
+  BT_OCTET32 private_key;
+  tSMP_PUBLIC_KEY public_key;
+  uint8_t uses;
+} tSMP_KEY_POOL_ENTRY;
+
+static tSMP_KEY_POOL_ENTRY smp_key_pool[SMP_KEY_POOL_SIZE];
+static uint8_t smp_key_pool_count;
+static uint8_t smp_key_pool_pending;
+static bool smp_key_pool_running;
+
+static void smp_key_pool_rand_cb(tSMP_KEY_POOL_ENTRY* p_entry, uint8_t offset,
+                                 BT_OCTET8 rand);
+
+static void smp_key_pool_free_entry(tSMP_KEY_POOL_ENTRY* p_entry) {
+  memset(p_entry, 0, sizeof(tSMP_KEY_POOL_ENTRY));
+  osi_free(p_entry);
+}
+
+static void smp_key_pool_remove(uint8_t index) {
+  for (uint8_t i = index; i + 1 < smp_key_pool_count; i++)
+    smp_key_pool[i] = smp_key_pool[i + 1];
+  smp_key_pool_count--;
+  memset(&smp_key_pool[smp_key_pool_count], 0, sizeof(tSMP_KEY_POOL_ENTRY));
+}
+
+/* btu thread: the public key of |p_entry| is ready */
+static void smp_key_pool_add(tSMP_KEY_POOL_ENTRY* p_entry) {
+  if (smp_key_pool_pending > 0) smp_key_pool_pending--;
+
+  if (smp_key_pool_running && smp_key_pool_count < SMP_KEY_POOL_SIZE) {
+    smp_key_pool[smp_key_pool_count++] = *p_entry;
+    SMP_TRACE_DEBUG("%s: %d key pair(s) ready", __func__, smp_key_pool_count);
+  }
+
+  smp_key_pool_free_entry(p_entry);
+}
+
+/* thread pool: compute the public key of |p_entry| */
+static void smp_key_pool_compute(tSMP_KEY_POOL_ENTRY* p_entry) {
+  BT_OCTET32 private_key;
+  Point public_key;
+
+  memcpy(private_key, p_entry->private_key, BT_OCTET32_LEN);
+  ECC_PointMult_Base(&public_key, (uint32_t*)private_key);
+  memset(private_key, 0, BT_OCTET32_LEN);
+
+  memcpy(p_entry->public_key.x, public_key.x, BT_OCTET32_LEN);
+  memcpy(p_entry->public_key.y, public_key.y, BT_OCTET32_LEN);
+
+  base::MessageLoop* message_loop = get_message_loop();
+  if (!message_loop || !message_loop->task_runner().get()) {
+    SMP_TRACE_WARNING("%s: btu message loop not running", __func__);
+    smp_key_pool_free_entry(p_entry);
+    return;
+  }
+
+  message_loop->task_runner()->PostTask(
+      FROM_HERE, base::Bind(&smp_key_pool_add, p_entry));
+}
+
+/* btu thread: collect the private key 8 octets at a time from the controller,
+ * then hand the entry over to the thread pool */
+static void smp_key_pool_rand_cb(tSMP_KEY_POOL_ENTRY* p_entry, uint8_t offset,
+                                 BT_OCTET8 rand) {
+  if (!smp_key_pool_running) {
+    smp_key_pool_free_entry(p_entry);
+    return;
+  }
+
+  memcpy(&p_entry->private_key[offset], rand, BT_OCTET8_LEN);
+  offset += BT_OCTET8_LEN;
+
+  if (offset < BT_OCTET32_LEN) {
+    btsnd_hcic_ble_rand(base::Bind(&smp_key_pool_rand_cb, p_entry, offset));
+    return;
+  }
+
+  if (!bluetooth::common::PostToPool(
+          FROM_HERE, base::BindOnce(&smp_key_pool_compute, p_entry)))
+    smp_key_pool_compute(p_entry);
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pool_refill
+ *
+ * Description      Starts generating key pairs until the pool is full.
+ *                  Must be called on the btu thread once the controller is
+ *                  up, as the private keys come from HCI LE Rand.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void smp_key_pool_refill(void) {
+  smp_key_pool_running = true;
+
+  while (smp_key_pool_count + smp_key_pool_pending < SMP_KEY_POOL_SIZE) {
+    tSMP_KEY_POOL_ENTRY* p_entry =
+        (tSMP_KEY_POOL_ENTRY*)osi_calloc(sizeof(tSMP_KEY_POOL_ENTRY));
+    smp_key_pool_pending++;
+    btsnd_hcic_ble_rand(base::Bind(&smp_key_pool_rand_cb, p_entry, 0));
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pool_take
+ *
+ * Description      Copies a precomputed key pair out of the pool and starts
+ *                  replacing it.
+ *
+ * Returns          true if a key pair was available, false otherwise.
+ *
+ ******************************************************************************/
+bool smp_key_pool_take(BT_OCTET32 private_key, tSMP_PUBLIC_KEY* p_public_key) {
+  bool found = false;
+
+  if (smp_key_pool_count > 0) {
+    tSMP_KEY_POOL_ENTRY* p_entry = &smp_key_pool[0];
+    memcpy(private_key, p_entry->private_key, BT_OCTET32_LEN);
+    *p_public_key = p_entry->public_key;
+    if (++p_entry->uses >= SMP_KEY_POOL_MAX_REUSE) smp_key_pool_remove(0);
+    found = true;
+  }
+
+  smp_key_pool_refill();
+  return found;
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pool_discard
+ *
+ * Description      Drops the key pair with |private_key| from the pool, if it
+ *                  is still there, so that it is not reused after a failed
+ *                  pairing.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void smp_key_pool_discard(const BT_OCTET32 private_key) {
+  for (uint8_t i = 0; i < smp_key_pool_count; i++) {
+    if (memcmp(smp_key_pool[i].private_key, private_key, BT_OCTET32_LEN) == 0) {
+      smp_key_pool_remove(i);
+      smp_key_pool_refill();
+      return;
+    }
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pool_free
+ *
+ * Description      Clears every key pair. The key pairs still being computed
+ *                  are dropped when they are done.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void smp_key_pool_free(void) {
+  smp_key_pool_running = false;
+
+  memset(smp_key_pool, 0, sizeof(smp_key_pool));
+  smp_key_pool_count = 0;
+  smp_key_pool_pending = 0;
+}
@@ -32,6 +32,8 @@
 #include "btm_ble_api.h"
 #include "btm_ble_int.h"
 #include "btm_int.h"
+#include "btu.h"
+#include "common/thread_pool.h"
 #include "device/include/controller.h"
 #include "hcimsgs.h"
 #include "osi/include/osi.h"
@@ -52,6 +54,7 @@ using crypto_toolbox::aes_128;
 static void smp_process_stk(tSMP_CB* p_cb, Octet16* p);
 static Octet16 smp_calculate_legacy_short_term_key(tSMP_CB* p_cb);
 static void smp_process_private_key(tSMP_CB* p_cb);
+static void smp_process_public_key(tSMP_CB* p_cb);
 
 #define SMP_PASSKEY_MASK 0xfff00000
 
@@ -622,6 +625,12 @@ Octet16 smp_calculate_legacy_short_term_key(tSMP_CB* p_cb) {
 void smp_create_private_key(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
   SMP_TRACE_DEBUG("%s", __func__);
 
+  if (smp_key_pool_take(p_cb->private_key, &p_cb->loc_publ_key)) {
+    SMP_TRACE_DEBUG("%s: using a precomputed key pair", __func__);
+    smp_process_public_key(p_cb);
+    return;
+  }
+
   btsnd_hcic_ble_rand(Bind(
       [](tSMP_CB* p_cb, BT_OCTET8 rand) {
         memcpy((void*)p_cb->private_key, rand, BT_OCTET8_LEN);
@@ -696,16 +705,32 @@ void smp_use_oob_private_key(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
 void smp_process_private_key(tSMP_CB* p_cb) {
   Point public_key;
   BT_OCTET32 private_key;
-  int generate_invalid_public_key;
 
   SMP_TRACE_DEBUG("%s", __func__);
 
   memcpy(private_key, p_cb->private_key, BT_OCTET32_LEN);
-  ECC_PointMult(&public_key, &(curve_p256.G), (uint32_t*)private_key,
-                KEY_LENGTH_DWORDS_P256);
+  ECC_PointMult_Base(&public_key, (uint32_t*)private_key);
   memcpy(p_cb->loc_publ_key.x, public_key.x, BT_OCTET32_LEN);
   memcpy(p_cb->loc_publ_key.y, public_key.y, BT_OCTET32_LEN);
 
+  smp_process_public_key(p_cb);
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_process_public_key
+ *
+ * Description      This function is called once the local public key is
+ *                  known, either computed from the private key or taken from
+ *                  the key pool. It notifies SM that private key / public key
+ *                  pair is created.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void smp_process_public_key(tSMP_CB* p_cb) {
+  int generate_invalid_public_key;
+
   generate_invalid_public_key =
       stack_config_get_interface()->get_pts_smp_generate_invalid_public_key();
 
@@ -741,33 +766,48 @@ void smp_process_private_key(tSMP_CB* p_cb) {
   smp_sm_event(p_cb, SMP_LOC_PUBL_KEY_CRTD_EVT, NULL);
 }
 
-/*******************************************************************************
- *
- * Function         smp_compute_dhkey
- *
- * Description      The function:
- *                  - calculates a new public key using as input local private
- *                    key and peer public key;
- *                  - saves the new public key x-coordinate as DHKey.
- *
- * Returns          void
- *
- ******************************************************************************/
-void smp_compute_dhkey(tSMP_CB* p_cb) {
-  Point peer_publ_key, new_publ_key;
+/* The inputs and the result of a DHKey computation in the thread pool */
+typedef struct {
+  RawAddress pairing_bda;
   BT_OCTET32 private_key;
-  int generate_invalid_public_key;
+  tSMP_PUBLIC_KEY peer_publ_key;
+  BT_OCTET32 dhkey;
+} tSMP_DHKEY_JOB;
 
-  SMP_TRACE_DEBUG("%s", __func__);
+/* thread pool: the DHKey is the x-coordinate of the peer public key
+ * multiplied by the local private key */
+static void smp_dhkey_job_compute(tSMP_DHKEY_JOB* p_job) {
+  Point peer_publ_key, new_publ_key;
 
-  memcpy(private_key, p_cb->private_key, BT_OCTET32_LEN);
-  memcpy(peer_publ_key.x, p_cb->peer_publ_key.x, BT_OCTET32_LEN);
-  memcpy(peer_publ_key.y, p_cb->peer_publ_key.y, BT_OCTET32_LEN);
+  memcpy(peer_publ_key.x, p_job->peer_publ_key.x, BT_OCTET32_LEN);
+  memcpy(peer_publ_key.y, p_job->peer_publ_key.y, BT_OCTET32_LEN);
+
+  ECC_PointMult_Window(&new_publ_key, &peer_publ_key,
+                       (uint32_t*)p_job->private_key);
+
+  memcpy(p_job->dhkey, new_publ_key.x, BT_OCTET32_LEN);
+}
 
-  ECC_PointMult(&new_publ_key, &peer_publ_key, (uint32_t*)private_key,
-                KEY_LENGTH_DWORDS_P256);
+/* btu thread: save the DHKey of |p_job| if it was computed for the pairing
+ * still in progress, and go on with it */
+static void smp_dhkey_job_done(tSMP_DHKEY_JOB* p_job) {
+  tSMP_CB* p_cb = &smp_cb;
+  int generate_invalid_public_key;
 
-  memcpy(p_cb->dhkey, new_publ_key.x, BT_OCTET32_LEN);
+  if (p_cb->state != SMP_STATE_SEC_CONN_PHS1_START ||
+      p_cb->pairing_bda != p_job->pairing_bda ||
+      memcmp(p_cb->private_key, p_job->private_key, BT_OCTET32_LEN) != 0 ||
+      memcmp(&p_cb->peer_publ_key, &p_job->peer_publ_key,
+             sizeof(tSMP_PUBLIC_KEY)) != 0) {
+    SMP_TRACE_WARNING("%s: pairing ended meanwhile, DHKey dropped", __func__);
+    memset(p_job, 0, sizeof(tSMP_DHKEY_JOB));
+    osi_free(p_job);
+    return;
+  }
+
+  memcpy(p_cb->dhkey, p_job->dhkey, BT_OCTET32_LEN);
+  memset(p_job, 0, sizeof(tSMP_DHKEY_JOB));
+  osi_free(p_job);
 
   generate_invalid_public_key =
       stack_config_get_interface()->get_pts_smp_generate_invalid_public_key();
@@ -787,6 +827,44 @@ void smp_compute_dhkey(tSMP_CB* p_cb) {
                                       BT_OCTET32_LEN);
   smp_debug_print_nbyte_little_endian(p_cb->dhkey, "Reverted DHKey",
                                       BT_OCTET32_LEN);
+
+  smp_dhkey_computed(p_cb);
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_compute_dhkey
+ *
+ * Description      The function:
+ *                  - calculates a new public key using as input local private
+ *                    key and peer public key;
+ *                  - saves the new public key x-coordinate as DHKey;
+ *                  - calls smp_dhkey_computed().
+ *
+ *                  The point multiplication runs in the thread pool when it
+ *                  is running, the DHKey is then saved on the btu thread.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void smp_compute_dhkey(tSMP_CB* p_cb) {
+  SMP_TRACE_DEBUG("%s", __func__);
+
+  tSMP_DHKEY_JOB* p_job = (tSMP_DHKEY_JOB*)osi_calloc(sizeof(tSMP_DHKEY_JOB));
+  p_job->pairing_bda = p_cb->pairing_bda;
+  memcpy(p_job->private_key, p_cb->private_key, BT_OCTET32_LEN);
+  p_job->peer_publ_key = p_cb->peer_publ_key;
+
+  base::MessageLoop* message_loop = get_message_loop();
+  if (message_loop && message_loop->task_runner().get() &&
+      bluetooth::common::PostToPool(
+          FROM_HERE, base::BindOnce(&smp_dhkey_job_compute, p_job),
+          message_loop->task_runner(),
+          base::BindOnce(&smp_dhkey_job_done, p_job)))
+    return;
+
+  smp_dhkey_job_compute(p_job);
+  smp_dhkey_job_done(p_job);
 }
 
 /** The function calculates and saves local commmitment in CB. */
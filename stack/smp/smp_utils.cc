@@ -916,6 +916,9 @@ void smp_proc_pairing_cmpl(tSMP_CB* p_cb) {
 
   RawAddress pairing_bda = p_cb->pairing_bda;
 
+  /* never reuse a key pair after a failed pairing */
+  if (p_cb->status != SMP_SUCCESS) smp_key_pool_discard(p_cb->private_key);
+
   smp_reset_control_value(p_cb);
 
   if (p_callback) (*p_callback)(SMP_COMPLT_EVT, pairing_bda, &evt_data);
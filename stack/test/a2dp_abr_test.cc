@@ -0,0 +1,101 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "a2dp_abr.h"
+
+class A2dpAbrTest : public ::testing::Test {
+ protected:
+  void SetUp() override { a2dp_abr_reset(&abr_); }
+
+  // Runs |ticks| encoder ticks with a TX queue of |queue_length| packets
+  void run(size_t ticks, size_t queue_length) {
+    for (size_t i = 0; i < ticks; i++) a2dp_abr_update(&abr_, queue_length);
+  }
+
+  tA2DP_ABR abr_;
+};
+
+TEST_F(A2dpAbrTest, keeps_configured_rate_on_short_queue) {
+  run(1000, 0);
+  EXPECT_EQ(0, abr_.level);
+  EXPECT_EQ(53u, a2dp_abr_scale(&abr_, 53));
+  EXPECT_EQ(0u, abr_.step_downs);
+}
+
+TEST_F(A2dpAbrTest, steps_down_once_per_hold_period) {
+  EXPECT_TRUE(a2dp_abr_update(&abr_, 8));
+  EXPECT_EQ(1, abr_.level);
+
+  // The queue needs time to drain before the next step
+  run(5, 8);
+  EXPECT_EQ(1, abr_.level);
+
+  run(100, 8);
+  EXPECT_EQ(A2DP_ABR_MAX_LEVEL, abr_.level);
+  EXPECT_EQ((size_t)A2DP_ABR_MAX_LEVEL, abr_.step_downs);
+  EXPECT_LT(a2dp_abr_scale(&abr_, 328), 328u);
+  EXPECT_EQ(8u, abr_.max_queue_length);
+}
+
+TEST_F(A2dpAbrTest, steps_up_after_a_long_good_period) {
+  run(100, 8);
+  ASSERT_EQ(A2DP_ABR_MAX_LEVEL, abr_.level);
+
+  // A medium queue is neither good nor bad
+  run(1000, 3);
+  EXPECT_EQ(A2DP_ABR_MAX_LEVEL, abr_.level);
+
+  run(249, 0);
+  EXPECT_EQ(A2DP_ABR_MAX_LEVEL, abr_.level);
+  EXPECT_TRUE(a2dp_abr_update(&abr_, 0));
+  EXPECT_EQ(A2DP_ABR_MAX_LEVEL - 1, abr_.level);
+
+  run(250 * A2DP_ABR_MAX_LEVEL, 1);
+  EXPECT_EQ(0, abr_.level);
+  EXPECT_EQ((size_t)A2DP_ABR_MAX_LEVEL, abr_.step_ups);
+}
+
+TEST_F(A2dpAbrTest, steps_down_on_failed_contacts) {
+  a2dp_abr_report_failed_contact_counter(0);
+  EXPECT_FALSE(a2dp_abr_update(&abr_, 0));
+
+  a2dp_abr_report_failed_contact_counter(3);
+  EXPECT_TRUE(a2dp_abr_update(&abr_, 0));
+  EXPECT_EQ(1, abr_.level);
+  EXPECT_EQ(1u, abr_.link_step_downs);
+
+  // A single report is acted on once
+  EXPECT_FALSE(a2dp_abr_update(&abr_, 0));
+}
+
+TEST_F(A2dpAbrTest, steps_down_on_weak_rssi) {
+  a2dp_abr_report_rssi(0);
+  EXPECT_FALSE(a2dp_abr_update(&abr_, 0));
+
+  a2dp_abr_report_rssi(-30);
+  EXPECT_TRUE(a2dp_abr_update(&abr_, 0));
+  EXPECT_EQ(1u, abr_.link_step_downs);
+}
+
+TEST_F(A2dpAbrTest, steps_down_on_degraded_link) {
+  a2dp_abr_report_link_degraded();
+  EXPECT_TRUE(a2dp_abr_update(&abr_, 0));
+  EXPECT_EQ(1u, abr_.link_step_downs);
+}
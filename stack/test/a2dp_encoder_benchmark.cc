@@ -0,0 +1,246 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// CPU cost of the A2DP source encoders, driven through their
+// tA2DP_ENCODER_INTERFACE like the media task does. The time per iteration is
+// the CPU time used per second of streaming, so codecs can be compared to each
+// other on the same device. Run with --benchmark_format=json to get results
+// that can be compared between builds.
+//
+// The PCM fed to the encoders is synthetic unless A2DP_BENCHMARK_PCM names a
+// file of raw PCM, which is then looped. The file must match the feeding of
+// the codec measured, usually 16 bit stereo at 44.1kHz.
+
+#include <benchmark/benchmark.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "a2dp_codec_api.h"
+#include "a2dp_sbc_constants.h"
+#include "a2dp_vendor_ldac_constants.h"
+#include "bt_common.h"
+#include "osi/include/allocator.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// An EDR 3 Mbps peer with the MTU of most headsets
+constexpr tA2DP_ENCODER_INIT_PEER_PARAMS kPeerParams = {true, true, 1005};
+
+// Codec specific value selecting an LDAC quality, see a2dp_vendor_ldac.cc
+constexpr int64_t kLdacQualityBase = 1000;
+
+// No SBC bitpool limit or LDAC quality selected
+constexpr int kDefault = -1;
+
+// PCM looped by the read callback
+std::vector<uint8_t> pcm;
+size_t pcm_offset;
+
+// What the encoders enqueued
+size_t packets;
+uint64_t packet_bytes;
+
+void LoadPcm() {
+  if (!pcm.empty()) return;
+
+  const char* path = getenv("A2DP_BENCHMARK_PCM");
+  if (path != nullptr) {
+    FILE* file = fopen(path, "rb");
+    if (file != nullptr) {
+      uint8_t buf[4096];
+      size_t len;
+      while ((len = fread(buf, 1, sizeof(buf), file)) > 0)
+        pcm.insert(pcm.end(), buf, buf + len);
+      fclose(file);
+    }
+    if (!pcm.empty()) return;
+    fprintf(stderr, "Unable to read %s, using synthetic PCM\n", path);
+  }
+
+  // Two seconds of a 1kHz tone over noise, 16 bit stereo at 48kHz. A pure
+  // tone would be cheaper to encode than music.
+  uint32_t seed = 0x12345678;
+  for (size_t i = 0; i < 2 * 48000; i++) {
+    double tone = 8000.0 * sin(2.0 * M_PI * 1000.0 * i / 48000.0);
+    for (int channel = 0; channel < 2; channel++) {
+      seed = seed * 1103515245 + 12345;
+      int16_t sample = (int16_t)(tone + (int16_t)(seed >> 16) / 8);
+      pcm.push_back(sample & 0xff);
+      pcm.push_back((sample >> 8) & 0xff);
+    }
+  }
+}
+
+uint32_t ReadPcm(uint8_t* p_buf, uint32_t len) {
+  for (uint32_t copied = 0; copied < len;) {
+    size_t chunk = std::min<size_t>(len - copied, pcm.size() - pcm_offset);
+    memcpy(p_buf + copied, pcm.data() + pcm_offset, chunk);
+    copied += chunk;
+    pcm_offset = (pcm_offset + chunk) % pcm.size();
+  }
+  return len;
+}
+
+bool EnqueuePacket(BT_HDR* p_buf, size_t frames_n, uint32_t num_bytes) {
+  packets++;
+  packet_bytes += p_buf->len;
+  osi_free(p_buf);
+  return true;
+}
+
+// Selects the codec of |codec_index| with its own capability as the peer's,
+// limited to |sbc_max_bitpool| for SBC. Returns the codec, or nullptr if it is
+// not available, such as when its vendor library is missing.
+A2dpCodecConfig* SelectCodec(A2dpCodecs* codecs,
+                             btav_a2dp_codec_index_t codec_index,
+                             int sbc_max_bitpool) {
+  tAVDT_CFG avdt_cfg;
+  memset(&avdt_cfg, 0, sizeof(avdt_cfg));
+  if (!A2DP_InitCodecConfig(codec_index, &avdt_cfg)) return nullptr;
+  if (codecs->findSourceCodecConfig(avdt_cfg.codec_info) == nullptr)
+    return nullptr;
+  if (sbc_max_bitpool != kDefault)
+    avdt_cfg.codec_info[A2DP_SBC_IE_MAX_BITPOOL_OFFSET] = sbc_max_bitpool;
+
+  uint8_t result_codec_config[AVDT_CODEC_SIZE];
+  if (!codecs->setCodecConfig(avdt_cfg.codec_info, true /* is_capability */,
+                              result_codec_config,
+                              true /* select_current_codec */))
+    return nullptr;
+  return codecs->getCurrentCodecConfig();
+}
+
+// Encodes one second of audio with the codec of |codec_index|, limited to
+// |sbc_max_bitpool| for SBC or at |ldac_quality| for LDAC.
+void EncodeOneSecond(State& state, btav_a2dp_codec_index_t codec_index,
+                     int sbc_max_bitpool, int ldac_quality) {
+  LoadPcm();
+  A2dpCodecs codecs(std::vector<btav_a2dp_codec_config_t>{});
+  if (!codecs.init()) {
+    state.SkipWithError("Unable to initialize the codecs");
+    return;
+  }
+
+  A2dpCodecConfig* codec_config =
+      SelectCodec(&codecs, codec_index, sbc_max_bitpool);
+  if (codec_config == nullptr) {
+    state.SkipWithError("Codec not available");
+    return;
+  }
+
+  if (ldac_quality != kDefault) {
+    btav_a2dp_codec_config_t user_config = {};
+    user_config.codec_type = codec_index;
+    user_config.codec_priority = BTAV_A2DP_CODEC_PRIORITY_HIGHEST;
+    user_config.codec_specific_1 = kLdacQualityBase + ldac_quality;
+    uint8_t peer_sink_capabilities[AVDT_CODEC_SIZE];
+    uint8_t result_codec_config[AVDT_CODEC_SIZE];
+    bool restart_input, restart_output, config_updated;
+    codec_config->copyOutOtaCodecConfig(peer_sink_capabilities);
+    if (!codecs.setCodecUserConfig(user_config, &kPeerParams,
+                                   peer_sink_capabilities, result_codec_config,
+                                   &restart_input, &restart_output,
+                                   &config_updated)) {
+      state.SkipWithError("Unable to select the quality");
+      return;
+    }
+  }
+
+  uint8_t codec_info[AVDT_CODEC_SIZE];
+  codec_config->copyOutOtaCodecConfig(codec_info);
+  const tA2DP_ENCODER_INTERFACE* encoder = A2DP_GetEncoderInterface(codec_info);
+  if (encoder == nullptr) {
+    state.SkipWithError("No encoder interface");
+    return;
+  }
+
+  encoder->encoder_init(&kPeerParams, codec_config, ReadPcm, EnqueuePacket);
+  encoder->feeding_reset();
+  uint64_t interval_us = encoder->get_encoder_interval_ms() * 1000;
+  uint64_t timestamp_us = interval_us;
+  pcm_offset = 0;
+  packets = 0;
+  packet_bytes = 0;
+
+  size_t ticks_per_second = 1000000 / interval_us;
+  for (auto _ : state) {
+    for (size_t i = 0; i < ticks_per_second; i++) {
+      encoder->send_frames(timestamp_us);
+      timestamp_us += interval_us;
+    }
+  }
+  encoder->encoder_cleanup();
+
+  state.SetBytesProcessed(packet_bytes);
+  state.counters["packets_per_second"] =
+      benchmark::Counter(packets / state.iterations());
+  state.counters["bytes_per_packet"] =
+      benchmark::Counter(packets != 0 ? packet_bytes / packets : 0);
+}
+
+}  // namespace
+
+static void BM_SbcEncoder(State& state) {
+  EncodeOneSecond(state, BTAV_A2DP_CODEC_INDEX_SOURCE_SBC, state.range(0),
+                  kDefault);
+}
+// Maximum bitpools of the low, middle and high quality joint stereo
+// configurations recommended by the A2DP specification
+BENCHMARK(BM_SbcEncoder)
+    ->Arg(19)
+    ->Arg(35)
+    ->Arg(53)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_AacEncoder(State& state) {
+  EncodeOneSecond(state, BTAV_A2DP_CODEC_INDEX_SOURCE_AAC, kDefault, kDefault);
+}
+BENCHMARK(BM_AacEncoder)->Unit(benchmark::kMillisecond);
+
+static void BM_AptxEncoder(State& state) {
+  EncodeOneSecond(state, BTAV_A2DP_CODEC_INDEX_SOURCE_APTX, kDefault,
+                  kDefault);
+}
+BENCHMARK(BM_AptxEncoder)->Unit(benchmark::kMillisecond);
+
+static void BM_AptxHdEncoder(State& state) {
+  EncodeOneSecond(state, BTAV_A2DP_CODEC_INDEX_SOURCE_APTX_HD, kDefault,
+                  kDefault);
+}
+BENCHMARK(BM_AptxHdEncoder)->Unit(benchmark::kMillisecond);
+
+static void BM_LdacEncoder(State& state) {
+  EncodeOneSecond(state, BTAV_A2DP_CODEC_INDEX_SOURCE_LDAC, kDefault,
+                  state.range(0));
+}
+// The high, mid and low quality EQMIDs
+BENCHMARK(BM_LdacEncoder)
+    ->Arg(A2DP_LDAC_QUALITY_HIGH)
+    ->Arg(A2DP_LDAC_QUALITY_MID)
+    ->Arg(A2DP_LDAC_QUALITY_LOW)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,133 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "a2dp_encoder_pipeline.h"
+#include "bt_common.h"
+#include "osi/include/allocator.h"
+
+namespace {
+
+constexpr uint32_t kPcmBytesPerFrame = 512;
+constexpr uint32_t kEncodedBytesPerFrame = 100;
+
+uint32_t pcm_available;
+std::vector<uint16_t> packet_lengths;
+std::vector<uint32_t> packet_timestamps;
+std::vector<size_t> packet_frames;
+
+uint32_t read_pcm(uint8_t* p_buf, uint32_t len) {
+  uint32_t read = (len < pcm_available) ? len : pcm_available;
+  memset(p_buf, 0x55, read);
+  pcm_available -= read;
+  return read;
+}
+
+bool enqueue_packet(BT_HDR* p_buf, size_t frames_n, uint32_t bytes_read) {
+  packet_lengths.push_back(p_buf->len);
+  packet_timestamps.push_back(*(uint32_t*)(p_buf + 1));
+  packet_frames.push_back(frames_n);
+  osi_free(p_buf);
+  return true;
+}
+
+bool encode_frame(const uint8_t* p_pcm, uint8_t* p_out, uint32_t out_size,
+                  tA2DP_ENCODED_FRAME* p_encoded) {
+  if (out_size < kEncodedBytesPerFrame) return false;
+  memset(p_out, p_pcm[0], kEncodedBytesPerFrame);
+  p_encoded->bytes = kEncodedBytesPerFrame;
+  p_encoded->frames = 1;
+  p_encoded->samples = 128;
+  return true;
+}
+
+}  // namespace
+
+class A2dpEncoderPipelineTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    pcm_available = 0;
+    packet_lengths.clear();
+    packet_timestamps.clear();
+    packet_frames.clear();
+
+    a2dp_encoder_pipeline_init(&pipeline_, read_pcm, enqueue_packet);
+    pipeline_.encode_frame = encode_frame;
+    pipeline_.pcm_bytes_per_frame = kPcmBytesPerFrame;
+
+    // 44.1kHz stereo 16 bits, 176.4 bytes per ms
+    tA2DP_FEEDING_PARAMS feeding_params = {44100, 16, 2};
+    a2dp_encoder_pipeline_reset(&pipeline_, &feeding_params, 20);
+  }
+
+  tA2DP_ENCODER_PIPELINE pipeline_;
+};
+
+TEST_F(A2dpEncoderPipelineTest, schedules_the_frames_of_each_tick) {
+  // 3528 bytes per 20ms tick, 6 frames, 456 bytes left for the next tick
+  EXPECT_EQ(6u, a2dp_encoder_pipeline_schedule(&pipeline_, 1000000));
+  EXPECT_EQ(456u, pipeline_.counter);
+
+  // The remainder completes a 7th frame after the next tick
+  EXPECT_EQ(7u, a2dp_encoder_pipeline_schedule(&pipeline_, 1020000));
+  EXPECT_EQ(13u, pipeline_.stats.media_read_total_expected_frames);
+}
+
+TEST_F(A2dpEncoderPipelineTest, splits_packets_on_mtu) {
+  pipeline_.mtu = 350;
+  pcm_available = 6 * kPcmBytesPerFrame;
+
+  a2dp_encoder_pipeline_encode(&pipeline_, 6);
+
+  // A packet holds frames while another one still fits in the MTU
+  ASSERT_EQ(2u, packet_lengths.size());
+  EXPECT_EQ(300u, packet_lengths[0]);
+  EXPECT_EQ(300u, packet_lengths[1]);
+  EXPECT_EQ(3u, packet_frames[0]);
+  EXPECT_EQ(0u, packet_timestamps[0]);
+  EXPECT_EQ(384u, packet_timestamps[1]);
+  EXPECT_EQ(6u, pipeline_.stats.encode_total_frames);
+  EXPECT_EQ(600u, pipeline_.stats.encode_total_bytes);
+}
+
+TEST_F(A2dpEncoderPipelineTest, gives_back_frames_on_underflow) {
+  pipeline_.max_frames = 2;
+  pcm_available = 2 * kPcmBytesPerFrame + 10;
+
+  a2dp_encoder_pipeline_encode(&pipeline_, 5);
+
+  // The partial frame is padded with silence, the last two are given back
+  ASSERT_EQ(2u, packet_lengths.size());
+  EXPECT_EQ(2u, packet_frames[0]);
+  EXPECT_EQ(1u, packet_frames[1]);
+  EXPECT_EQ(2 * kPcmBytesPerFrame, pipeline_.counter);
+  EXPECT_EQ(0u, pipeline_.stats.media_read_total_dropped_packets);
+}
+
+TEST_F(A2dpEncoderPipelineTest, drops_packet_on_encoding_error) {
+  pipeline_.buffer_size = sizeof(BT_HDR) + 50;
+  pcm_available = kPcmBytesPerFrame;
+
+  a2dp_encoder_pipeline_encode(&pipeline_, 1);
+
+  EXPECT_TRUE(packet_lengths.empty());
+  EXPECT_EQ(1u, pipeline_.stats.media_read_total_dropped_packets);
+}
@@ -0,0 +1,115 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "a2dp_link_policy.h"
+
+class A2dpLinkPolicyTest : public ::testing::Test {
+ protected:
+  void SetUp() override { a2dp_link_policy_reset(&policy_); }
+
+  // Runs |ticks| encoder ticks with a TX queue of |queue_length| packets.
+  // Returns the number of changes.
+  size_t run(size_t ticks, size_t queue_length) {
+    size_t changes = 0;
+    for (size_t i = 0; i < ticks; i++)
+      if (a2dp_link_policy_update(&policy_, queue_length)) changes++;
+    return changes;
+  }
+
+  tA2DP_LINK_POLICY policy_;
+};
+
+TEST_F(A2dpLinkPolicyTest, stays_normal_on_short_queue) {
+  EXPECT_EQ(0u, run(1000, 2));
+  EXPECT_FALSE(policy_.robust);
+
+  // A queue spike is not enough
+  EXPECT_EQ(0u, run(5, 20));
+  EXPECT_EQ(0u, run(100, 0));
+  EXPECT_FALSE(policy_.robust);
+}
+
+TEST_F(A2dpLinkPolicyTest, goes_robust_on_long_queue) {
+  EXPECT_EQ(1u, run(100, 20));
+  EXPECT_TRUE(policy_.robust);
+  EXPECT_EQ(1u, policy_.to_robust);
+  EXPECT_EQ(0u, policy_.link_to_robust);
+}
+
+TEST_F(A2dpLinkPolicyTest, goes_robust_on_failed_contacts) {
+  a2dp_link_policy_report_failed_contact_counter(0);
+  EXPECT_EQ(0u, run(1, 0));
+
+  a2dp_link_policy_report_failed_contact_counter(3);
+  EXPECT_TRUE(a2dp_link_policy_update(&policy_, 0));
+  EXPECT_TRUE(policy_.robust);
+  EXPECT_EQ(1u, policy_.link_to_robust);
+}
+
+TEST_F(A2dpLinkPolicyTest, goes_robust_on_degraded_link) {
+  a2dp_link_policy_report_link_degraded();
+  EXPECT_TRUE(a2dp_link_policy_update(&policy_, 0));
+  EXPECT_TRUE(policy_.robust);
+  EXPECT_EQ(1u, policy_.link_to_robust);
+}
+
+TEST_F(A2dpLinkPolicyTest, goes_back_after_a_long_good_period) {
+  run(100, 20);
+  ASSERT_TRUE(policy_.robust);
+
+  // A medium queue is not a good tick
+  EXPECT_EQ(0u, run(1000, 4));
+  EXPECT_TRUE(policy_.robust);
+
+  EXPECT_EQ(1u, run(1000, 0));
+  EXPECT_FALSE(policy_.robust);
+  EXPECT_EQ(1u, policy_.to_normal);
+}
+
+TEST_F(A2dpLinkPolicyTest, failed_contacts_hold_robust) {
+  run(100, 20);
+  ASSERT_TRUE(policy_.robust);
+
+  for (int i = 0; i < 10; i++) {
+    a2dp_link_policy_report_failed_contact_counter(1);
+    EXPECT_EQ(0u, run(100, 0));
+  }
+  EXPECT_TRUE(policy_.robust);
+
+  EXPECT_EQ(1u, run(1000, 0));
+  EXPECT_FALSE(policy_.robust);
+}
+
+TEST_F(A2dpLinkPolicyTest, robust_pkt_types) {
+  uint16_t pkt_types = HCI_PKT_TYPES_MASK_DM1 | HCI_PKT_TYPES_MASK_DH1 |
+                       HCI_PKT_TYPES_MASK_DM3 | HCI_PKT_TYPES_MASK_DH3 |
+                       HCI_PKT_TYPES_MASK_DM5 | HCI_PKT_TYPES_MASK_DH5;
+  uint16_t robust = a2dp_link_policy_robust_pkt_types(pkt_types);
+
+  EXPECT_EQ(0, robust & (HCI_PKT_TYPES_MASK_DM5 | HCI_PKT_TYPES_MASK_DH5));
+  EXPECT_EQ(HCI_PKT_TYPES_MASK_DH3, robust & HCI_PKT_TYPES_MASK_DH3);
+  EXPECT_EQ(0, robust & HCI_PKT_TYPES_MASK_NO_2_DH3);
+  EXPECT_NE(0, robust & HCI_PKT_TYPES_MASK_NO_2_DH5);
+  EXPECT_NE(0, robust & HCI_PKT_TYPES_MASK_NO_3_DH3);
+
+  // What the link already excludes stays excluded
+  robust = a2dp_link_policy_robust_pkt_types(HCI_PKT_TYPES_MASK_NO_2_DH3);
+  EXPECT_NE(0, robust & HCI_PKT_TYPES_MASK_NO_2_DH3);
+}
@@ -0,0 +1,87 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "a2dp_sbc_resampler.h"
+#include "a2dp_sbc_up_sample.h"
+
+using ::benchmark::State;
+
+// Frames of one 16 block, 8 subband SBC frame
+static constexpr uint32_t kFramesPerRead = 128;
+
+static void RatePairs(benchmark::internal::Benchmark* b) {
+  for (int src : {8000, 16000, 32000, 44100, 48000}) {
+    for (int dst : {16000, 32000, 44100, 48000}) {
+      if (src != dst) b->Args({src, dst});
+    }
+  }
+}
+
+// Converts one SBC frame of 16 bit stereo audio from |state.range(0)| Hz to
+// |state.range(1)| Hz. Items are converted frames, 48000 items are 1 s of
+// audio at 48 kHz.
+static void BM_PolyphaseResampler(State& state, bool simd) {
+  uint32_t src_sps = state.range(0);
+  uint32_t dst_sps = state.range(1);
+  std::vector<int16_t> in(kFramesPerRead * 8 * 2);
+  std::vector<int16_t> out((kFramesPerRead + 8) * 2);
+  for (size_t i = 0; i < in.size(); i++) in[i] = i * 977;
+
+  a2dp_sbc_resampler_allow_simd(simd);
+  a2dp_sbc_resampler_init(src_sps, dst_sps, 16, 2, 2);
+
+  uint64_t frames = 0;
+  for (auto _ : state) {
+    uint32_t n = a2dp_sbc_resampler_input_frames(kFramesPerRead);
+    frames += a2dp_sbc_resampler_process(in.data(), n, out.data(),
+                                         kFramesPerRead + 8);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(frames);
+  a2dp_sbc_resampler_allow_simd(true);
+}
+BENCHMARK_CAPTURE(BM_PolyphaseResampler, scalar, false)->Apply(RatePairs);
+BENCHMARK_CAPTURE(BM_PolyphaseResampler, simd, true)->Apply(RatePairs);
+
+// The same conversion with the sample and hold up-sampler
+static void BM_LegacyUpSample(State& state) {
+  uint32_t src_sps = state.range(0);
+  uint32_t dst_sps = state.range(1);
+  uint32_t src_frames = kFramesPerRead * src_sps / dst_sps + 1;
+  std::vector<int16_t> in(src_frames * 2);
+  std::vector<int16_t> out((kFramesPerRead + 8) * 2);
+  for (size_t i = 0; i < in.size(); i++) in[i] = i * 977;
+
+  uint64_t frames = 0;
+  for (auto _ : state) {
+    uint32_t src_used;
+    a2dp_sbc_init_up_sample(src_sps, dst_sps, 16, 2);
+    frames += a2dp_sbc_up_sample(in.data(), out.data(), in.size() * 2,
+                                 out.size() * 2, &src_used) /
+              4;
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(frames);
+}
+BENCHMARK(BM_LegacyUpSample)->Apply(RatePairs);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,190 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "a2dp_sbc_resampler.h"
+
+namespace {
+
+constexpr uint32_t kFeedingRates[] = {8000, 16000, 32000, 44100, 48000};
+constexpr uint32_t kSbcRates[] = {16000, 32000, 44100, 48000};
+constexpr uint32_t kFramesPerRead = 128;
+constexpr int kReads = 64;
+
+std::vector<int16_t> make_sine(uint32_t rate, uint32_t frames,
+                               uint8_t channels, double freq, double level) {
+  std::vector<int16_t> pcm(frames * channels);
+  for (uint32_t i = 0; i < frames; i++) {
+    for (uint8_t ch = 0; ch < channels; ch++)
+      pcm[i * channels + ch] =
+          (int16_t)lrint(level * sin(2 * M_PI * freq * i / rate + ch));
+  }
+  return pcm;
+}
+
+// Feeds |src| the way a2dp_sbc_read_feeding does, one SBC frame at a time
+std::vector<int16_t> resample(const std::vector<int16_t>& src,
+                              uint8_t channels) {
+  std::vector<int16_t> dst;
+  size_t offset = 0;
+
+  for (int i = 0; i < kReads; i++) {
+    uint32_t frames = a2dp_sbc_resampler_input_frames(kFramesPerRead);
+    if ((offset + frames) * channels > src.size()) break;
+
+    std::vector<int16_t> out((kFramesPerRead + 8) * channels);
+    uint32_t n = a2dp_sbc_resampler_process(src.data() + offset * channels,
+                                            frames, out.data(),
+                                            kFramesPerRead + 8);
+    dst.insert(dst.end(), out.begin(), out.begin() + n * channels);
+    offset += frames;
+  }
+  return dst;
+}
+
+double rms(const int16_t* p, size_t n) {
+  double sum = 0;
+  for (size_t i = 0; i < n; i++) sum += (double)p[i] * p[i];
+  return sqrt(sum / n);
+}
+
+}  // namespace
+
+TEST(A2dpSbcResamplerTest, input_frames_produce_the_frames_needed) {
+  for (uint32_t src_sps : kFeedingRates) {
+    for (uint32_t dst_sps : kSbcRates) {
+      if (src_sps == dst_sps) continue;
+      SCOPED_TRACE(testing::Message() << src_sps << " -> " << dst_sps);
+      ASSERT_TRUE(a2dp_sbc_resampler_init(src_sps, dst_sps, 16, 2, 2));
+
+      uint32_t extra = dst_sps / src_sps + 1;
+      uint64_t src_total = 0, dst_total = 0;
+      for (int i = 0; i < kReads; i++) {
+        uint32_t frames = a2dp_sbc_resampler_input_frames(kFramesPerRead);
+        std::vector<int16_t> in(frames * 2);
+        std::vector<int16_t> out((kFramesPerRead + extra) * 2);
+        uint32_t n = a2dp_sbc_resampler_process(in.data(), frames, out.data(),
+                                                kFramesPerRead + extra);
+        EXPECT_GE(n, kFramesPerRead);
+        EXPECT_LT(n, kFramesPerRead + extra);
+        src_total += frames;
+        dst_total += n;
+      }
+
+      // The converted stream runs at the destination rate
+      EXPECT_LE(llabs((int64_t)(src_total * dst_sps / src_sps) -
+                      (int64_t)dst_total),
+                1);
+    }
+  }
+}
+
+TEST(A2dpSbcResamplerTest, keeps_dc_and_tone_level) {
+  for (uint32_t src_sps : kFeedingRates) {
+    for (uint32_t dst_sps : kSbcRates) {
+      if (src_sps == dst_sps) continue;
+      SCOPED_TRACE(testing::Message() << src_sps << " -> " << dst_sps);
+      ASSERT_TRUE(a2dp_sbc_resampler_init(src_sps, dst_sps, 16, 1, 1));
+
+      // Skip the converted samples that depend on the initial silence
+      size_t settled = 32 * dst_sps / src_sps + 1;
+
+      std::vector<int16_t> dc(src_sps, 1000);
+      std::vector<int16_t> out = resample(dc, 1);
+      ASSERT_GT(out.size(), settled + 256);
+      for (size_t i = settled; i < out.size(); i++)
+        ASSERT_NEAR(1000, out[i], 1) << "sample " << i;
+
+      // A tone well inside both pass bands
+      double freq = std::min(src_sps, dst_sps) / 8.0;
+      ASSERT_TRUE(a2dp_sbc_resampler_init(src_sps, dst_sps, 16, 1, 1));
+      std::vector<int16_t> tone = make_sine(src_sps, src_sps, 1, freq, 16000);
+      out = resample(tone, 1);
+      EXPECT_NEAR(16000 / sqrt(2),
+                  rms(out.data() + settled, out.size() - settled),
+                  16000 / sqrt(2) * 0.02);
+    }
+  }
+}
+
+TEST(A2dpSbcResamplerTest, sample_formats_match) {
+  std::vector<int16_t> tone = make_sine(44100, 44100, 2, 1000, 20000);
+  std::vector<uint8_t> pcm24(tone.size() * 3);
+  std::vector<int32_t> pcm32(tone.size());
+  for (size_t i = 0; i < tone.size(); i++) {
+    int32_t v = tone[i] * 256;
+    pcm24[3 * i] = v & 0xff;
+    pcm24[3 * i + 1] = (v >> 8) & 0xff;
+    pcm24[3 * i + 2] = (v >> 16) & 0xff;
+    pcm32[i] = tone[i] * 65536;
+  }
+
+  ASSERT_TRUE(a2dp_sbc_resampler_init(44100, 48000, 16, 2, 2));
+  std::vector<int16_t> out16(4096 * 2);
+  uint32_t n16 =
+      a2dp_sbc_resampler_process(tone.data(), 3000, out16.data(), 4096);
+
+  ASSERT_TRUE(a2dp_sbc_resampler_init(44100, 48000, 24, 2, 2));
+  std::vector<int16_t> out24(4096 * 2);
+  uint32_t n24 =
+      a2dp_sbc_resampler_process(pcm24.data(), 3000, out24.data(), 4096);
+
+  ASSERT_TRUE(a2dp_sbc_resampler_init(44100, 48000, 32, 2, 2));
+  std::vector<int16_t> out32(4096 * 2);
+  uint32_t n32 =
+      a2dp_sbc_resampler_process(pcm32.data(), 3000, out32.data(), 4096);
+
+  EXPECT_EQ(n16, n24);
+  EXPECT_EQ(n16, n32);
+  EXPECT_EQ(out16, out24);
+  EXPECT_EQ(out16, out32);
+}
+
+TEST(A2dpSbcResamplerTest, simd_matches_scalar) {
+  if (!a2dp_sbc_resampler_allow_simd(true)) {
+    printf("No vectorized filter in this build\n");
+    return;
+  }
+
+  for (uint32_t src_sps : kFeedingRates) {
+    for (uint32_t dst_sps : kSbcRates) {
+      if (src_sps == dst_sps) continue;
+      SCOPED_TRACE(testing::Message() << src_sps << " -> " << dst_sps);
+      std::vector<int16_t> tone =
+          make_sine(src_sps, src_sps, 2, src_sps / 5.0, 30000);
+
+      a2dp_sbc_resampler_allow_simd(false);
+      ASSERT_TRUE(a2dp_sbc_resampler_init(src_sps, dst_sps, 16, 2, 2));
+      std::vector<int16_t> scalar = resample(tone, 2);
+
+      a2dp_sbc_resampler_allow_simd(true);
+      ASSERT_TRUE(a2dp_sbc_resampler_init(src_sps, dst_sps, 16, 2, 2));
+      std::vector<int16_t> simd = resample(tone, 2);
+
+      ASSERT_EQ(scalar.size(), simd.size());
+      for (size_t i = 0; i < scalar.size(); i++)
+        ASSERT_NEAR(scalar[i], simd[i], 1) << "sample " << i;
+    }
+  }
+}
@@ -0,0 +1,84 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "advertise_data_parser.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Advertisements as received from typical devices around a scanner
+const std::vector<std::vector<uint8_t>> corpus{
+    // iBeacon
+    {0x02, 0x01, 0x06, 0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15, 0xE2, 0xC5,
+     0x6D, 0xB5, 0xDF, 0xFB, 0x48, 0xD2, 0xB0, 0x60, 0xD0, 0xF5, 0xA7,
+     0x10, 0x96, 0xE0, 0x00, 0x01, 0x00, 0x02, 0xC5},
+    // Eddystone URL
+    {0x02, 0x01, 0x06, 0x03, 0x03, 0xAA, 0xFE, 0x11, 0x16, 0xAA, 0xFE,
+     0x10, 0xEB, 0x03, 0x61, 0x6E, 0x64, 0x72, 0x6F, 0x69, 0x64, 0x07},
+    // Heart rate sensor, advertising data and scan response
+    {0x02, 0x01, 0x06, 0x05, 0x03, 0x0D, 0x18, 0x0F, 0x18, 0x03, 0x19,
+     0x41, 0x03, 0x02, 0x0A, 0x00, 0x09, 0x09, 0x48, 0x52, 0x4D, 0x20,
+     0x31, 0x32, 0x33, 0x34, 0x07, 0xFF, 0x59, 0x00, 0x01, 0x02, 0x03,
+     0x04},
+    // Headset, 128 bit service UUID and shortened name, zero padded
+    {0x02, 0x01, 0x1A, 0x11, 0x07, 0xFB, 0x34, 0x9B, 0x5F, 0x80, 0x00,
+     0x00, 0x80, 0x00, 0x10, 0x00, 0x00, 0x0B, 0x11, 0x00, 0x00, 0x08,
+     0x08, 0x48, 0x65, 0x61, 0x64, 0x73, 0x65, 0x74, 0x00, 0x00}};
+
+// Field types looked up for each advertisement on its way to the scanner
+// clients
+const uint8_t lookups[] = {0x01 /* flags */, 0x19 /* appearance */,
+                           0x03 /* 16 bit UUIDs */, 0x09 /* complete name */,
+                           0x08 /* shortened name */};
+
+}  // namespace
+
+static void BM_AdParserGetFieldByType(State& state) {
+  for (auto _ : state) {
+    for (const std::vector<uint8_t>& ad : corpus) {
+      for (uint8_t type : lookups) {
+        uint8_t len;
+        benchmark::DoNotOptimize(
+            AdvertiseDataParser::GetFieldByType(ad, type, &len));
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(BM_AdParserGetFieldByType);
+
+static void BM_AdParserFieldIndex(State& state) {
+  for (auto _ : state) {
+    for (const std::vector<uint8_t>& ad : corpus) {
+      AdvertiseDataParser::FieldIndex ad_fields(ad);
+      for (uint8_t type : lookups) {
+        uint8_t len;
+        benchmark::DoNotOptimize(ad_fields.GetFieldByType(type, &len));
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(BM_AdParserFieldIndex);
+
+BENCHMARK_MAIN();
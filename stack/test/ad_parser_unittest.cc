@@ -130,6 +130,31 @@ TEST(AdvertiseDataParserTest, GetFieldByType) {
   EXPECT_EQ(0, p_length);
 }
 
+TEST(AdvertiseDataParserTest, FieldIndexMatchesGetFieldByType) {
+  const std::vector<std::vector<uint8_t>> ads{
+      // Flags, complete 16 bit UUIDs, name, second flags field.
+      {0x02, 0x01, 0x06, 0x03, 0x03, 0x0F, 0x18, 0x04, 0x09, 0x61, 0x62, 0x63,
+       0x02, 0x01, 0x02},
+      // Zero padding at end of packet.
+      {0x03, 0x02, 0x01, 0x02, 0x02, 0x03, 0x01, 0x00, 0x00},
+      // Two fields, second field length too long.
+      {0x02, 0x02, 0x00, 0x03, 0x00},
+      // Empty field, and manufacturer data.
+      {0x01, 0x08, 0x05, 0xFF, 0x4C, 0x00, 0x02, 0x15},
+      {}};
+
+  for (const std::vector<uint8_t>& ad : ads) {
+    AdvertiseDataParser::FieldIndex index(ad);
+    for (int type = 0; type <= 0xFF; type++) {
+      uint8_t expected_length = 0xAA, length = 0x55;
+      const uint8_t* expected =
+          AdvertiseDataParser::GetFieldByType(ad, type, &expected_length);
+      EXPECT_EQ(expected, index.GetFieldByType(type, &length));
+      EXPECT_EQ(expected_length, length);
+    }
+  }
+}
+
 // This test makes sure that RemoveTrailingZeros is working correctly. It does
 // run the RemoveTrailingZeros for ad data, then glue scan response at end of
 // it, and checks that the resulting data is good.
@@ -0,0 +1,75 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include "stack/avdt/avdt_media.h"
+#include "stack/include/avdt_api.h"
+#include "stack/include/bt_types.h"
+
+using ::benchmark::State;
+
+// Media header written field by field, as before the template
+static void BM_AvdtMediaWriteFields(State& state) {
+  uint8_t pkt[AVDT_MEDIA_HDR_SIZE];
+  uint16_t seq = 0;
+  uint32_t time_stamp = 0;
+
+  for (auto _ : state) {
+    uint8_t* p = pkt;
+    UINT8_TO_BE_STREAM(p, 0x80);
+    UINT8_TO_BE_STREAM(p, 0x60);
+    UINT16_TO_BE_STREAM(p, ++seq);
+    UINT32_TO_BE_STREAM(p, time_stamp += 128);
+    UINT32_TO_BE_STREAM(p, 1);
+    benchmark::DoNotOptimize(pkt);
+  }
+}
+BENCHMARK(BM_AvdtMediaWriteFields);
+
+static void BM_AvdtMediaWriteHdr(State& state) {
+  uint8_t hdr[AVDT_MEDIA_HDR_SIZE];
+  uint8_t pkt[AVDT_MEDIA_HDR_SIZE];
+  uint16_t seq = 0;
+  uint32_t time_stamp = 0;
+
+  avdt_media_init_hdr(hdr, 0x60, 1);
+  for (auto _ : state) {
+    avdt_media_write_hdr(pkt, hdr, ++seq, time_stamp += 128);
+    benchmark::DoNotOptimize(pkt);
+  }
+}
+BENCHMARK(BM_AvdtMediaWriteHdr);
+
+static void BM_AvdtMediaParseHdr(State& state) {
+  uint8_t hdr[AVDT_MEDIA_HDR_SIZE];
+  uint8_t pkt[AVDT_MEDIA_HDR_SIZE];
+  uint8_t m_pt, marker;
+  uint16_t seq;
+  uint32_t time_stamp;
+
+  avdt_media_init_hdr(hdr, 0x60, 1);
+  avdt_media_write_hdr(pkt, hdr, 1, 128);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(avdt_media_parse_hdr(pkt, sizeof(pkt), &m_pt,
+                                                  &marker, &seq, &time_stamp));
+  }
+}
+BENCHMARK(BM_AvdtMediaParseHdr);
+
+BENCHMARK_MAIN();
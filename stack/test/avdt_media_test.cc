@@ -0,0 +1,66 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "stack/avdt/avdt_media.h"
+#include "stack/include/avdt_api.h"
+
+TEST(AvdtMediaTest, writes_header_from_template) {
+  uint8_t hdr[AVDT_MEDIA_HDR_SIZE];
+  uint8_t pkt[AVDT_MEDIA_HDR_SIZE];
+  const uint8_t expected[AVDT_MEDIA_HDR_SIZE] = {
+      0x80, 0x60, 0x12, 0x34, 0xDE, 0xAD, 0xBE, 0xEF, 0x00, 0x00, 0x00, 0x01};
+
+  avdt_media_init_hdr(hdr, 0x60, 1);
+  avdt_media_write_hdr(pkt, hdr, 0x1234, 0xDEADBEEF);
+  EXPECT_EQ(0, memcmp(expected, pkt, sizeof(pkt)));
+}
+
+TEST(AvdtMediaTest, parses_written_header) {
+  uint8_t hdr[AVDT_MEDIA_HDR_SIZE];
+  uint8_t pkt[AVDT_MEDIA_HDR_SIZE + 2] = {};
+  uint8_t m_pt, marker;
+  uint16_t seq;
+  uint32_t time_stamp;
+
+  avdt_media_init_hdr(hdr, 0x80 | 0x60, 1);
+  avdt_media_write_hdr(pkt, hdr, 7, 1024);
+  ASSERT_TRUE(avdt_media_parse_hdr(pkt, sizeof(pkt), &m_pt, &marker, &seq,
+                                   &time_stamp));
+  EXPECT_EQ(0x60, m_pt);
+  EXPECT_EQ(1, marker);
+  EXPECT_EQ(7, seq);
+  EXPECT_EQ(1024u, time_stamp);
+}
+
+TEST(AvdtMediaTest, leaves_other_headers_to_the_full_parse) {
+  uint8_t pkt[AVDT_MEDIA_HDR_SIZE + 4] = {0x80};
+  uint8_t m_pt, marker;
+  uint16_t seq;
+  uint32_t time_stamp;
+
+  EXPECT_FALSE(avdt_media_parse_hdr(pkt, AVDT_MEDIA_HDR_SIZE - 1, &m_pt,
+                                    &marker, &seq, &time_stamp));
+  // Padding, extension and CSRC
+  for (uint8_t octet1 : {0xA0, 0x90, 0x81}) {
+    pkt[0] = octet1;
+    EXPECT_FALSE(avdt_media_parse_hdr(pkt, sizeof(pkt), &m_pt, &marker, &seq,
+                                      &time_stamp));
+  }
+}
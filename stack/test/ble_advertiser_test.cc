@@ -679,6 +679,82 @@ TEST_F(BleAdvertisingManagerTest, test_data_sender) {
   EXPECT_EQ(BTM_BLE_MULTI_ADV_SUCCESS, set_data_status);
 }
 
+/* This test verifies that writing the data the controller already holds is
+ * skipped. */
+TEST_F(BleAdvertisingManagerTest, test_unchanged_data_not_written) {
+  BleAdvertisingManager::Get()->RegisterAdvertiser(
+      Bind(&BleAdvertisingManagerTest::RegistrationCb, base::Unretained(this)));
+  EXPECT_EQ(BTM_BLE_MULTI_ADV_SUCCESS, reg_status);
+  int advertiser_id = reg_inst_id;
+  std::vector<uint8_t> data({0x02 /* len */, 0xFF, 0x01});
+
+  status_cb set_data_cb;
+  EXPECT_CALL(*hci_mock, SetAdvertisingData(advertiser_id, _, _, _, _, _))
+      .Times(1)
+      .WillOnce(SaveArg<5>(&set_data_cb));
+  BleAdvertisingManager::Get()->SetData(
+      advertiser_id, false, data,
+      Bind(&BleAdvertisingManagerTest::SetDataCb, base::Unretained(this)));
+  set_data_cb.Run(0x00);
+  ::testing::Mock::VerifyAndClearExpectations(hci_mock.get());
+  EXPECT_EQ(BTM_BLE_MULTI_ADV_SUCCESS, set_data_status);
+
+  set_data_status = -1;
+  EXPECT_CALL(*hci_mock, SetAdvertisingData(_, _, _, _, _, _))
+      .Times(Exactly(0));
+  BleAdvertisingManager::Get()->SetData(
+      advertiser_id, false, data,
+      Bind(&BleAdvertisingManagerTest::SetDataCb, base::Unretained(this)));
+  ::testing::Mock::VerifyAndClearExpectations(hci_mock.get());
+  EXPECT_EQ(BTM_BLE_MULTI_ADV_SUCCESS, set_data_status);
+
+  // The scan response is a different payload
+  EXPECT_CALL(*hci_mock, SetScanResponseData(advertiser_id, _, _, _, _, _))
+      .Times(1)
+      .WillOnce(SaveArg<5>(&set_data_cb));
+  BleAdvertisingManager::Get()->SetData(
+      advertiser_id, true, data,
+      Bind(&BleAdvertisingManagerTest::SetDataCb, base::Unretained(this)));
+  set_data_cb.Run(0x00);
+  ::testing::Mock::VerifyAndClearExpectations(hci_mock.get());
+}
+
+/* This test verifies that the data updates issued while a write is in flight
+ * are merged into a single write of the latest data. */
+TEST_F(BleAdvertisingManagerTest, test_data_updates_merged) {
+  BleAdvertisingManager::Get()->RegisterAdvertiser(
+      Bind(&BleAdvertisingManagerTest::RegistrationCb, base::Unretained(this)));
+  EXPECT_EQ(BTM_BLE_MULTI_ADV_SUCCESS, reg_status);
+  int advertiser_id = reg_inst_id;
+
+  status_cb set_data_cb;
+  EXPECT_CALL(*hci_mock, SetAdvertisingData(advertiser_id, _, _, _, _, _))
+      .Times(1)
+      .WillOnce(SaveArg<5>(&set_data_cb));
+  BleAdvertisingManager::Get()->SetData(
+      advertiser_id, false, std::vector<uint8_t>({0x02 /* len */, 0xFF, 0x01}),
+      Bind(DoNothing));
+  BleAdvertisingManager::Get()->SetData(
+      advertiser_id, false, std::vector<uint8_t>({0x02 /* len */, 0xFF, 0x02}),
+      Bind(DoNothing));
+  BleAdvertisingManager::Get()->SetData(
+      advertiser_id, false, std::vector<uint8_t>({0x02 /* len */, 0xFF, 0x03}),
+      Bind(&BleAdvertisingManagerTest::SetDataCb, base::Unretained(this)));
+  ::testing::Mock::VerifyAndClearExpectations(hci_mock.get());
+
+  uint8_t expected_adv_data[] = {0x02 /* len */, 0xFF, 0x03};
+  EXPECT_CALL(*hci_mock, SetAdvertisingData(advertiser_id, _, _, _, _, _))
+      .With(Args<4, 3>(ElementsAreArray(expected_adv_data)))
+      .Times(1)
+      .WillOnce(SaveArg<5>(&set_data_cb));
+  set_data_cb.Run(0x00);
+  ::testing::Mock::VerifyAndClearExpectations(hci_mock.get());
+  EXPECT_EQ(-1, set_data_status);
+
+  set_data_cb.Run(0x00);
+  EXPECT_EQ(BTM_BLE_MULTI_ADV_SUCCESS, set_data_status);
+}
+
 /* This test makes sure that conectable advertisment with timeout will get it's
  * address updated once the timeout passes and one tries to enable it again.*/
 TEST_F(BleAdvertisingManagerTest,
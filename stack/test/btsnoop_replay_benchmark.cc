@@ -0,0 +1,379 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Replays the controller to host packets of a btsnoop log into the stack, to
+// profile its receive paths on real traffic: advertising reports, ACL
+// reassembly, L2CAP and GATT notifications. BTSNOOP_REPLAY_LOG names the log,
+// which must be captured in full (not filtered) from the stack enable, so that
+// the controller module can start from the responses it holds.
+//
+// The events go to btu_hci_msg_process() on the BTU thread, like hci_layer
+// sends them, and the ACL packets go through the packet fragmenter first. The
+// HCI layer is a stub answering each command of the stack with the first
+// Command Complete or Command Status of the log for its opcode, or with a
+// successful Command Complete if there is none; the Command Complete and
+// Command Status events of the log are not replayed. Nothing is sent to the
+// controller.
+//
+// Each iteration replays the whole log, as fast as possible or at the pace it
+// was captured. The items per second are packets per second, and the counters
+// are the packets and the CPU time per packet of each layer. The work that
+// the stack posts to its own thread is not counted per layer, but is in the
+// real time. The stack keeps its state between iterations. Run with
+// --benchmark_format=json to get results that can be compared between builds.
+
+#include <benchmark/benchmark.h>
+
+#include <base/bind.h>
+#include <base/message_loop/message_loop.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bt_types.h"
+#include "btcore/include/module.h"
+#include "hci/include/packet_fragmenter.h"
+#include "hci_layer.h"
+#include "hcidefs.h"
+#include "osi/include/allocator.h"
+#include "osi/include/future.h"
+#include "osi/include/thread.h"
+#include "stack/include/btu.h"
+
+using ::benchmark::State;
+
+extern const module_t controller_module;
+
+void btu_hci_msg_process(BT_HDR* p_msg);
+void btu_message_loop_run(void* context);
+
+namespace {
+
+constexpr char kLogVariable[] = "BTSNOOP_REPLAY_LOG";
+
+constexpr uint8_t kBtsnoopHeader[] = {'b', 't', 's', 'n', 'o', 'o', 'p', 0,
+                                      0,   0,   0,   1,   0,   0,   0x03, 0xea};
+constexpr uint64_t kBtsnoopEpochDelta = 0x00dcddb30f2f8000ULL;
+constexpr size_t kRecordHeaderSize = 24;
+
+// Record flags
+constexpr uint32_t kReceived = 0x01;
+
+// H4 packet types
+constexpr uint8_t kAclPacket = 2;
+constexpr uint8_t kEventPacket = 4;
+
+// Zero return parameters of the made up Command Complete events, so that
+// their parsers do not read past them
+constexpr uint8_t kMadeUpParameters = 64;
+
+// A controller to host packet of the log, without its H4 type
+struct Record {
+  uint64_t timestamp_us;
+  uint8_t type;
+  std::vector<uint8_t> data;
+};
+
+std::vector<Record> records;
+std::map<uint16_t, std::vector<uint8_t>> command_completes;
+std::map<uint16_t, std::vector<uint8_t>> command_statuses;
+
+uint32_t ReadBigEndian32(const uint8_t* p) {
+  return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 |
+         p[3];
+}
+
+uint64_t ReadBigEndian64(const uint8_t* p) {
+  return (uint64_t)ReadBigEndian32(p) << 32 | ReadBigEndian32(p + 4);
+}
+
+void AddRecord(uint64_t timestamp_us, std::vector<uint8_t> packet) {
+  uint8_t type = packet[0];
+  packet.erase(packet.begin());
+
+  if (type == kEventPacket && packet.size() >= 6) {
+    // Keep the first answer to each opcode for the stub HCI layer
+    if (packet[0] == HCI_COMMAND_COMPLETE_EVT) {
+      command_completes.emplace(packet[3] | packet[4] << 8, packet);
+      return;
+    }
+    if (packet[0] == HCI_COMMAND_STATUS_EVT) {
+      command_statuses.emplace(packet[4] | packet[5] << 8, packet);
+      return;
+    }
+  }
+  if (type == kEventPacket || type == kAclPacket)
+    records.push_back({timestamp_us, type, std::move(packet)});
+}
+
+bool LoadLog() {
+  if (!records.empty()) return true;
+
+  const char* path = getenv(kLogVariable);
+  if (path == nullptr) return false;
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) return false;
+
+  uint8_t header[kRecordHeaderSize];
+  if (fread(header, 1, sizeof(kBtsnoopHeader), file) !=
+          sizeof(kBtsnoopHeader) ||
+      memcmp(header, kBtsnoopHeader, sizeof(kBtsnoopHeader)) != 0) {
+    fprintf(stderr, "%s is not an H4 btsnoop log\n", path);
+    fclose(file);
+    return false;
+  }
+
+  while (fread(header, 1, sizeof(header), file) == sizeof(header)) {
+    uint32_t length = ReadBigEndian32(header);
+    uint32_t captured = ReadBigEndian32(header + 4);
+    uint32_t flags = ReadBigEndian32(header + 8);
+    uint64_t timestamp_us = ReadBigEndian64(header + 16) - kBtsnoopEpochDelta;
+
+    std::vector<uint8_t> packet(captured);
+    if (captured == 0 || fread(packet.data(), 1, captured, file) != captured)
+      break;
+
+    // Filtered packets only have their headers in the log
+    if ((flags & kReceived) && captured == length)
+      AddRecord(timestamp_us, std::move(packet));
+  }
+  fclose(file);
+  return !records.empty();
+}
+
+BT_HDR* MakePacket(const std::vector<uint8_t>& data, uint16_t event) {
+  BT_HDR* packet = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + data.size());
+  packet->event = event;
+  packet->len = data.size();
+  packet->offset = 0;
+  packet->layer_specific = 0;
+  memcpy(packet->data, data.data(), data.size());
+  return packet;
+}
+
+BT_HDR* MakeCommandComplete(uint16_t opcode) {
+  auto it = command_completes.find(opcode);
+  if (it != command_completes.end())
+    return MakePacket(it->second, MSG_HC_TO_STACK_HCI_EVT);
+
+  std::vector<uint8_t> data(6 + kMadeUpParameters);
+  data[0] = HCI_COMMAND_COMPLETE_EVT;
+  data[1] = data.size() - 2;
+  data[2] = 1;  // Number of HCI command packets
+  data[3] = opcode & 0xff;
+  data[4] = opcode >> 8;
+  data[5] = HCI_SUCCESS;
+  return MakePacket(data, MSG_HC_TO_STACK_HCI_EVT);
+}
+
+uint16_t CommandOpcode(const BT_HDR* command) {
+  const uint8_t* p = command->data + command->offset;
+  return p[0] | p[1] << 8;
+}
+
+void StubSetDataCb(
+    base::Callback<void(const base::Location&, BT_HDR*)> send_data_cb) {}
+
+void StubTransmitCommand(BT_HDR* command, command_complete_cb complete_cb,
+                         command_status_cb status_cb, void* context) {
+  uint16_t opcode = CommandOpcode(command);
+
+  // The callbacks own the event, and the command if it gets a status
+  auto it = command_statuses.find(opcode);
+  if (it != command_statuses.end() && status_cb != nullptr) {
+    status_cb(it->second[2], command, context);
+    return;
+  }
+  if (complete_cb != nullptr)
+    complete_cb(MakeCommandComplete(opcode), context);
+  osi_free(command);
+}
+
+future_t* StubTransmitCommandFutured(BT_HDR* command) {
+  BT_HDR* response = MakeCommandComplete(CommandOpcode(command));
+  osi_free(command);
+  return future_new_immediate(response);
+}
+
+void StubTransmitDownward(uint16_t type, void* data) { osi_free(data); }
+
+const hci_t stub_hci = {StubSetDataCb, StubTransmitCommand,
+                        StubTransmitCommandFutured, StubTransmitDownward};
+
+// Where the CPU time goes, reassembly on the replaying thread and the rest
+// on the BTU thread
+enum Layer {
+  kReassembly,
+  kHciEvents,
+  kLeAdvertisingReports,
+  kAclData,
+  kNumLayers,
+};
+
+const char* const kLayerNames[kNumLayers] = {"reassembly", "hci_events",
+                                             "le_adv_reports", "acl_data"};
+
+struct LayerStats {
+  uint64_t packets;
+  uint64_t cpu_ns;
+};
+LayerStats layer_stats[kNumLayers];
+
+uint64_t ThreadCpuNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void ProcessOnBtu(Layer layer, BT_HDR* packet) {
+  uint64_t start_ns = ThreadCpuNs();
+  btu_hci_msg_process(packet);
+  layer_stats[layer].packets++;
+  layer_stats[layer].cpu_ns += ThreadCpuNs() - start_ns;
+}
+
+void PostToBtu(Layer layer, BT_HDR* packet) {
+  get_message_loop()->task_runner()->PostTask(
+      FROM_HERE, base::Bind(&ProcessOnBtu, layer, packet));
+}
+
+// Waits for the BTU thread to be done with what was posted to it
+void WaitForBtu() {
+  future_t* future = future_new();
+  get_message_loop()->task_runner()->PostTask(
+      FROM_HERE,
+      base::Bind([](future_t* future) { future_ready(future, FUTURE_SUCCESS); },
+                 future));
+  future_await(future);
+}
+
+void Reassembled(BT_HDR* packet) { PostToBtu(kAclData, packet); }
+
+void Fragmented(BT_HDR* packet, bool send_transmit_finished) {
+  osi_free(packet);
+}
+
+void TransmitFinished(BT_HDR* packet, bool all_fragments_sent) {}
+
+const packet_fragmenter_callbacks_t fragmenter_callbacks = {
+    Fragmented, Reassembled, TransmitFinished};
+
+const packet_fragmenter_t* fragmenter;
+thread_t* btu_thread;
+
+// Starts the controller module from the log, then the stack core and its
+// thread. Returns false and sets an error on |state| if that is not possible.
+bool StartStack(State& state) {
+  if (btu_thread != nullptr) return true;
+
+  if (!LoadLog()) {
+    state.SkipWithError("BTSNOOP_REPLAY_LOG does not name a btsnoop log");
+    return false;
+  }
+  // The controller module does not start without these
+  for (uint16_t opcode :
+       {HCI_RESET, HCI_READ_BUFFER_SIZE, HCI_READ_LOCAL_VERSION_INFO}) {
+    if (command_completes.count(opcode) == 0) {
+      state.SkipWithError("The log does not start at the stack enable");
+      return false;
+    }
+  }
+  if (future_await(controller_module.start_up()) != FUTURE_SUCCESS) {
+    state.SkipWithError("The controller module did not start from the log");
+    return false;
+  }
+
+  btu_init_core();
+  btu_thread = thread_new("btsnoop_replay_btu");
+  thread_post(btu_thread, btu_message_loop_run, nullptr);
+  while (get_message_loop() == nullptr)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  fragmenter = packet_fragmenter_get_interface();
+  fragmenter->init(&fragmenter_callbacks);
+  return true;
+}
+
+Layer EventLayer(const std::vector<uint8_t>& event) {
+  if (event[0] == HCI_BLE_EVENT && event.size() > 2 &&
+      (event[2] == HCI_BLE_ADV_PKT_RPT_EVT ||
+       event[2] == HCI_BLE_DIRECT_ADV_EVT ||
+       event[2] == HCI_LE_EXTENDED_ADVERTISING_REPORT_EVT))
+    return kLeAdvertisingReports;
+  return kHciEvents;
+}
+
+void Replay(State& state, bool paced) {
+  if (!StartStack(state)) return;
+  memset(layer_stats, 0, sizeof(layer_stats));
+
+  for (auto _ : state) {
+    auto start = std::chrono::steady_clock::now();
+    for (const Record& record : records) {
+      if (paced) {
+        std::this_thread::sleep_until(
+            start + std::chrono::microseconds(record.timestamp_us -
+                                              records[0].timestamp_us));
+      }
+      if (record.type == kAclPacket) {
+        uint64_t start_ns = ThreadCpuNs();
+        fragmenter->reassemble_and_dispatch(
+            MakePacket(record.data, MSG_HC_TO_STACK_HCI_ACL));
+        layer_stats[kReassembly].packets++;
+        layer_stats[kReassembly].cpu_ns += ThreadCpuNs() - start_ns;
+      } else {
+        PostToBtu(EventLayer(record.data),
+                  MakePacket(record.data, BT_EVT_TO_BTU_HCI_EVT));
+      }
+    }
+    WaitForBtu();
+  }
+
+  state.SetItemsProcessed(state.iterations() * records.size());
+  for (int i = 0; i < kNumLayers; i++) {
+    const LayerStats& stats = layer_stats[i];
+    state.counters[std::string(kLayerNames[i]) + "_packets"] = stats.packets;
+    state.counters[std::string(kLayerNames[i]) + "_cpu_ns"] =
+        stats.packets ? stats.cpu_ns / stats.packets : 0;
+  }
+}
+
+}  // namespace
+
+// Stands in for the HCI layer in the stack and in the controller module
+const hci_t* hci_layer_get_interface() { return &stub_hci; }
+
+static void BM_ReplayAsFastAsPossible(State& state) { Replay(state, false); }
+BENCHMARK(BM_ReplayAsFastAsPossible)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_ReplayAtLogPace(State& state) { Replay(state, true); }
+BENCHMARK(BM_ReplayAtLogPace)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(1);
+
+BENCHMARK_MAIN();
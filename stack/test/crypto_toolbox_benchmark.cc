@@ -0,0 +1,81 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+#include <vector>
+
+#include "stack/crypto_toolbox/aes.h"
+#include "stack/crypto_toolbox/crypto_toolbox.h"
+
+using ::benchmark::State;
+
+namespace crypto_toolbox {
+
+static const Octet16 kKey{0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                          0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+
+// Byte oriented implementation, key expanded on every block
+static void BM_AesSoftwareOneShot(State& state) {
+  uint8_t key[OCTET16_LEN];
+  std::copy(kKey.begin(), kKey.end(), key);
+  uint8_t block[OCTET16_LEN] = {0};
+  for (auto _ : state) {
+    aes_context ctx;
+    aes_set_key(key, sizeof(key), &ctx);
+    aes_encrypt(block, block, &ctx);
+    benchmark::DoNotOptimize(block);
+  }
+}
+BENCHMARK(BM_AesSoftwareOneShot);
+
+// aes_128() with the raw key, as used by RPA resolution
+static void BM_Aes128OneShot(State& state) {
+  Octet16 block{0};
+  for (auto _ : state) {
+    block = aes_128(kKey, block);
+    benchmark::DoNotOptimize(block);
+  }
+}
+BENCHMARK(BM_Aes128OneShot);
+
+// aes_128() with a key schedule expanded once up front
+static void BM_Aes128Prekeyed(State& state) {
+  Aes128Key schedule;
+  aes_128_set_key(kKey, &schedule);
+  Octet16 block{0};
+  for (auto _ : state) {
+    block = aes_128(schedule, block);
+    benchmark::DoNotOptimize(block);
+  }
+}
+BENCHMARK(BM_Aes128Prekeyed);
+
+// CMAC over a GATT signed write sized message
+static void BM_AesCmac(State& state) {
+  std::vector<uint8_t> message(state.range(0), 0x5a);
+  for (auto _ : state) {
+    Octet16 mac = aes_cmac(kKey, message.data(), message.size());
+    benchmark::DoNotOptimize(mac);
+  }
+  state.SetBytesProcessed(state.iterations() * message.size());
+}
+BENCHMARK(BM_AesCmac)->Arg(16)->Arg(64)->Arg(512);
+
+}  // namespace crypto_toolbox
+
+BENCHMARK_MAIN();
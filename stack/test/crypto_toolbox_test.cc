@@ -20,6 +20,7 @@
 #include <gtest/gtest.h>
 
 #include "stack/crypto_toolbox/aes.h"
+#include "stack/crypto_toolbox/aes_accel.h"
 #include "stack/crypto_toolbox/crypto_toolbox.h"
 
 #include <base/logging.h>
@@ -397,4 +398,38 @@ TEST(CryptoToolboxTest, bt_spec_example_d_12_test) {
   EXPECT_EQ(expected_ltk, ltk);
 }
 
+// The expanded key path must match the one shot path
+TEST(CryptoToolboxTest, aes_128_key_schedule_test) {
+  Octet16 k{0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+            0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+  Aes128Key schedule;
+  aes_128_set_key(k, &schedule);
+
+  Octet16 m{0};
+  for (int i = 0; i < 64; i++) {
+    m[i % OCTET16_LEN] ^= (uint8_t)(i * 37 + 11);
+    EXPECT_EQ(aes_128(k, m), aes_128(schedule, m));
+  }
+}
+
+// The AES instructions must agree with the portable implementation
+TEST(CryptoToolboxTest, aes_128_hw_matches_sw_test) {
+  if (!aes_128_hw_available()) return;
+
+  uint8_t k[] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+  aes_context ctx;
+  aes_set_key(k, sizeof(k), &ctx);
+
+  uint8_t m[OCTET16_LEN] = {0};
+  for (int i = 0; i < 64; i++) {
+    m[i % OCTET16_LEN] ^= (uint8_t)(i * 37 + 11);
+
+    uint8_t sw[OCTET16_LEN], hw[OCTET16_LEN];
+    aes_encrypt(m, sw, &ctx);
+    aes_128_hw_encrypt(ctx.ksch, m, hw);
+    EXPECT_THAT(hw, ElementsAreArray(sw, OCTET16_LEN));
+  }
+}
+
 }  // namespace crypto_toolbox
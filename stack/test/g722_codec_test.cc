@@ -0,0 +1,96 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <math.h>
+
+#include "embdrv/g722/g722_enc_dec.h"
+#include "embdrv/g722/g722_qmf.h"
+
+namespace {
+
+uint32_t fnv1a(uint32_t hash, const void* p, size_t len) {
+  const uint8_t* p_byte = static_cast<const uint8_t*>(p);
+  while (len--) {
+    hash ^= *p_byte++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+}  // namespace
+
+// The filter, vectorized or not, gives the result of the reference loop
+TEST(G722CodecTest, qmf_matches_reference_loop) {
+  const int16_t ceven[G722_QMF_TAPS] = {3,    -11, 12,   32,  -210, 951,
+                                        3876, -805, 362, -156, 53,   -11};
+  const int16_t codd[G722_QMF_TAPS] = {-11, 53, -156, 362, -805, 3876,
+                                       951, -210, 32,  12,  -11,  3};
+  int x[2 * G722_QMF_TAPS] = {};
+  uint32_t seed = 1;
+
+  for (int n = 0; n < 1000; n++) {
+    seed = seed * 1103515245u + 12345u;
+    // The decoder history reaches -32768..32767 on both sides
+    g722_qmf_push(x, (int)((seed >> 16) & 0xFFFF) - 32768, -32768 + n % 2);
+
+    int even = 0, odd = 0;
+    for (int i = 0; i < G722_QMF_TAPS; i++) {
+      even += x[2 * i] * ceven[i];
+      odd += x[2 * i + 1] * codd[i];
+    }
+    int sum_even, sum_odd;
+    g722_qmf_apply(x, ceven, codd, &sum_even, &sum_odd);
+    ASSERT_EQ(even, sum_even);
+    ASSERT_EQ(odd, sum_odd);
+  }
+}
+
+// Checksums of the codec output before the QMF was vectorized
+TEST(G722CodecTest, encode_decode_bit_exact) {
+  g722_encode_state_t encoder;
+  g722_decode_state_t decoder;
+  uint32_t seed = 1;
+  uint32_t encoded_hash = 2166136261u;
+  uint32_t decoded_hash = 2166136261u;
+
+  g722_encode_init(&encoder, 64000, 0);
+  g722_decode_init(&decoder, 64000, 0);
+  for (int frame = 0; frame < 200; frame++) {
+    int16_t pcm[320];
+    uint8_t code[160];
+    int16_t out[320];
+
+    // A tone with some noise, and every fourth frame full scale noise
+    for (int i = 0; i < 320; i++) {
+      seed = seed * 1103515245u + 12345u;
+      int noise = (int)((seed >> 16) & 0xFFFF) - 32768;
+      int tone = (int)(12000.0 * sin((frame * 320 + i) * 0.05));
+      pcm[i] = (int16_t)((frame % 4 == 3) ? noise : tone + (noise >> 3));
+    }
+    int encoded = g722_encode(&encoder, code, pcm, 320);
+    ASSERT_EQ(160, encoded);
+    encoded_hash = fnv1a(encoded_hash, code, encoded);
+    int decoded = g722_decode(&decoder, out, code, encoded, 0xFFFF);
+    ASSERT_EQ(320, decoded);
+    decoded_hash = fnv1a(decoded_hash, out, decoded * sizeof(out[0]));
+  }
+  EXPECT_EQ(0xe7ad2b63u, encoded_hash);
+  EXPECT_EQ(0xc1d7f86au, decoded_hash);
+}
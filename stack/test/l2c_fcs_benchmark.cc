@@ -0,0 +1,41 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "stack/include/l2cdefs.h"
+#include "stack/l2cap/l2c_fcs.h"
+
+using ::benchmark::State;
+
+// FCS over one I-frame of |state.range(0)| bytes
+static void BM_L2capFcs(State& state) {
+  std::vector<uint8_t> frame(state.range(0));
+  for (size_t i = 0; i < frame.size(); i++) frame[i] = i * 7;
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        l2c_fcr_updcrc(L2CAP_FCR_INIT_CRC, frame.data(), frame.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * frame.size());
+}
+BENCHMARK(BM_L2capFcs)->Arg(10)->Arg(64)->Arg(672)->Arg(1021);
+
+BENCHMARK_MAIN();
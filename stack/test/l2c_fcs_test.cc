@@ -0,0 +1,80 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "stack/include/l2cdefs.h"
+#include "stack/l2cap/l2c_fcs.h"
+
+namespace {
+
+// Bit at a time reference
+uint16_t reference_crc(uint16_t crc, const uint8_t* p, size_t len) {
+  while (len--) {
+    crc ^= *p++;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+  }
+  return crc;
+}
+
+}  // namespace
+
+// BT Spec 5.0 | Vol 3, Part A 3.3.5, I-frame example
+TEST(L2capFcsTest, spec_i_frame) {
+  const uint8_t frame[] = {0x0E, 0x00, 0x40, 0x00, 0x02, 0x00, 0x00, 0x01,
+                           0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09};
+  EXPECT_EQ(0x6138,
+            l2c_fcr_updcrc(L2CAP_FCR_INIT_CRC, frame, sizeof(frame)));
+}
+
+// BT Spec 5.0 | Vol 3, Part A 3.3.5, RR frame example
+TEST(L2capFcsTest, spec_rr_frame) {
+  const uint8_t frame[] = {0x04, 0x00, 0x40, 0x00, 0x01, 0x01};
+  EXPECT_EQ(0x14D4,
+            l2c_fcr_updcrc(L2CAP_FCR_INIT_CRC, frame, sizeof(frame)));
+}
+
+TEST(L2capFcsTest, matches_reference) {
+  std::vector<uint8_t> data(1031);
+  uint32_t seed = 0x2b7e1516;
+  for (uint8_t& byte : data) {
+    seed = seed * 1103515245 + 12345;
+    byte = seed >> 24;
+  }
+
+  // Every length and alignment around the 8 byte blocks
+  for (size_t offset = 0; offset < 8; offset++) {
+    for (size_t len = 0; len + offset <= data.size(); len++) {
+      ASSERT_EQ(reference_crc(L2CAP_FCR_INIT_CRC, &data[offset], len),
+                l2c_fcr_updcrc(L2CAP_FCR_INIT_CRC, &data[offset], len))
+          << "offset=" << offset << " len=" << len;
+    }
+  }
+}
+
+TEST(L2capFcsTest, incremental) {
+  const uint8_t data[] = "123456789abcdefghijklmnopqrstuvwxyz";
+  for (size_t split = 0; split < sizeof(data); split++) {
+    uint16_t crc = l2c_fcr_updcrc(L2CAP_FCR_INIT_CRC, data, split);
+    crc = l2c_fcr_updcrc(crc, data + split, sizeof(data) - split);
+    EXPECT_EQ(reference_crc(L2CAP_FCR_INIT_CRC, data, sizeof(data)), crc);
+  }
+}
@@ -0,0 +1,95 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+
+#include "stack/include/l2cdefs.h"
+#include "stack/l2cap/l2c_int.h"
+
+using ::benchmark::State;
+
+// 7 links, with the channels of the pool spread over them (up to 20 each)
+static constexpr int kNumLinks = 7;
+static constexpr int kNumChannels =
+    (MAX_L2CAP_CHANNELS < kNumLinks * 20) ? MAX_L2CAP_CHANNELS : kNumLinks * 20;
+
+static RawAddress link_address(int i) {
+  RawAddress address = {{0x00, 0x1b, 0xdc, 0x0f, 0x00, 0x00}};
+  address.address[5] = 0x10 + i;
+  return address;
+}
+
+static void setup_links() {
+  memset(&l2cb, 0, sizeof(l2cb));
+  for (int i = 0; i < kNumLinks; i++) {
+    // Controllers hand out handles that do not start at the pool order
+    l2cb.lcb_pool[MAX_L2CAP_LINKS - 1 - i].in_use = true;
+    l2cb.lcb_pool[MAX_L2CAP_LINKS - 1 - i].handle = 0x0002 + i * 3;
+    l2cb.lcb_pool[MAX_L2CAP_LINKS - 1 - i].transport = BT_TRANSPORT_LE;
+    l2cb.lcb_pool[MAX_L2CAP_LINKS - 1 - i].remote_bd_addr = link_address(i);
+  }
+  for (int i = 0; i < kNumChannels; i++) {
+    tL2C_CCB* p_ccb = &l2cb.ccb_pool[i];
+    p_ccb->in_use = true;
+    p_ccb->local_cid = L2CAP_BASE_APPL_CID + i;
+    p_ccb->p_lcb = &l2cb.lcb_pool[MAX_L2CAP_LINKS - 1 - i % kNumLinks];
+  }
+}
+
+// Link lookup of each inbound ACL packet, over all of the links
+static void BM_L2capFindLcbByHandle(State& state) {
+  setup_links();
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(l2cu_find_lcb_by_handle(0x0002 + i * 3));
+    if (++i == kNumLinks) i = 0;
+  }
+}
+BENCHMARK(BM_L2capFindLcbByHandle);
+
+// Link lookup by address of the GATT and security paths, over all of the
+// links
+static void BM_L2capFindLcbByBdAddr(State& state) {
+  setup_links();
+  RawAddress addresses[kNumLinks];
+  for (int i = 0; i < kNumLinks; i++) addresses[i] = link_address(i);
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        l2cu_find_lcb_by_bd_addr(addresses[i], BT_TRANSPORT_LE));
+    if (++i == kNumLinks) i = 0;
+  }
+}
+BENCHMARK(BM_L2capFindLcbByBdAddr);
+
+// Link then channel lookup of each inbound packet, over all of the channels
+static void BM_L2capFindLcbAndCcb(State& state) {
+  setup_links();
+  int i = 0;
+  for (auto _ : state) {
+    tL2C_LCB* p_lcb = l2cu_find_lcb_by_handle(0x0002 + (i % kNumLinks) * 3);
+    benchmark::DoNotOptimize(
+        l2cu_find_ccb_by_cid(p_lcb, L2CAP_BASE_APPL_CID + i));
+    if (++i == kNumChannels) i = 0;
+  }
+}
+BENCHMARK(BM_L2capFindLcbAndCcb);
+
+BENCHMARK_MAIN();
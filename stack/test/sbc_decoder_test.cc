@@ -0,0 +1,137 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "oi_codec_sbc.h"
+#include "sbc_encoder.h"
+
+namespace {
+
+constexpr int kNumFrames = 64;
+constexpr size_t kMaxFrameSize = 512;
+
+// Loud deterministic noise, so that the synthesis output also clips.
+std::vector<int16_t> make_pcm(size_t samples) {
+  std::vector<int16_t> pcm(samples);
+  uint32_t seed = 0x2468ace0;
+  for (size_t i = 0; i < samples; i++) {
+    seed = seed * 1103515245 + 12345;
+    pcm[i] = (int16_t)(seed >> 16);
+  }
+  return pcm;
+}
+
+std::vector<uint8_t> encode(SBC_ENC_PARAMS params) {
+  std::vector<uint8_t> stream;
+
+  SBC_Encoder_Init(&params);
+
+  size_t samples_per_frame = params.s16NumOfBlocks * params.s16NumOfSubBands *
+                             params.s16NumOfChannels;
+  std::vector<int16_t> pcm = make_pcm(samples_per_frame * kNumFrames);
+
+  for (int i = 0; i < kNumFrames; i++) {
+    uint8_t output[kMaxFrameSize];
+    uint32_t len =
+        SBC_Encode(&params, pcm.data() + i * samples_per_frame, output);
+    stream.insert(stream.end(), output, output + len);
+  }
+  return stream;
+}
+
+std::vector<int16_t> decode(const std::vector<uint8_t>& stream,
+                            uint8_t pcm_stride, bool allow_simd) {
+  OI_CODEC_SBC_DECODER_CONTEXT context;
+  uint32_t context_data[CODEC_DATA_WORDS(2, SBC_CODEC_FAST_FILTER_BUFFERS)];
+  std::vector<int16_t> pcm;
+
+  // The decoder does not clear the filter history
+  memset(context_data, 0, sizeof(context_data));
+  EXPECT_EQ(OI_OK, OI_CODEC_SBC_DecoderReset(&context, context_data,
+                                             sizeof(context_data), 2,
+                                             pcm_stride, false));
+  OI_CODEC_SBC_DecoderAllowSimd(&context, allow_simd);
+
+  const OI_BYTE* data = stream.data();
+  uint32_t bytes = stream.size();
+  while (bytes > 0) {
+    int16_t frame[SBC_MAX_SAMPLES_PER_FRAME * SBC_MAX_CHANNELS];
+    uint32_t pcm_bytes = sizeof(frame);
+    OI_STATUS status =
+        OI_CODEC_SBC_DecodeFrame(&context, &data, &bytes, frame, &pcm_bytes);
+    EXPECT_EQ(OI_OK, status);
+    if (!OI_SUCCESS(status)) break;
+    pcm.insert(pcm.end(), frame, frame + pcm_bytes / sizeof(int16_t));
+  }
+  return pcm;
+}
+
+class SbcDecoderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memset(&params_, 0, sizeof(params_));
+    params_.s16SamplingFreq = SBC_sf44100;
+    params_.s16AllocationMethod = SBC_LOUDNESS;
+    params_.u16BitRate = 328;
+  }
+
+  SBC_ENC_PARAMS params_;
+};
+
+}  // namespace
+
+TEST_F(SbcDecoderTest, simd_synthesis_matches_scalar) {
+  OI_CODEC_SBC_DECODER_CONTEXT context;
+  uint32_t context_data[CODEC_DATA_WORDS(2, SBC_CODEC_FAST_FILTER_BUFFERS)];
+  ASSERT_EQ(OI_OK,
+            OI_CODEC_SBC_DecoderReset(&context, context_data,
+                                      sizeof(context_data), 2, 2, false));
+  if (OI_CODEC_SBC_DecoderAllowSimd(&context, true) != OI_OK) {
+    printf("No vectorized synthesis filter on this CPU\n");
+    return;
+  }
+
+  for (int16_t subbands : {SUB_BANDS_4, SUB_BANDS_8}) {
+    for (int16_t mode : {SBC_MONO, SBC_DUAL, SBC_STEREO, SBC_JOINT_STEREO}) {
+      for (int16_t blocks : {4, 8, 12, 16}) {
+        for (uint8_t pcm_stride : {1, 2}) {
+          if (mode != SBC_MONO && pcm_stride == 1) continue;
+          SCOPED_TRACE(testing::Message()
+                       << "subbands=" << subbands << " mode=" << mode
+                       << " blocks=" << blocks
+                       << " stride=" << (int)pcm_stride);
+          params_.s16NumOfSubBands = subbands;
+          params_.s16ChannelMode = mode;
+          params_.s16NumOfBlocks = blocks;
+
+          std::vector<uint8_t> stream = encode(params_);
+          std::vector<int16_t> scalar = decode(stream, pcm_stride, false);
+          std::vector<int16_t> simd = decode(stream, pcm_stride, true);
+
+          ASSERT_FALSE(scalar.empty());
+          EXPECT_EQ(scalar, simd);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,128 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// CPU cost of the A2DP SBC encoder. Run with --benchmark_format=json to get
+// results that can be compared between builds.
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+
+#include <vector>
+
+#include "sbc_encoder.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr size_t kMaxFrameSize = 512;
+
+void Configurations(benchmark::internal::Benchmark* b) {
+  // The high quality configurations of the A2DP specification
+  b->Args({SBC_sf44100, 44100, 328});
+  b->Args({SBC_sf48000, 48000, 345});
+}
+
+}  // namespace
+
+// Encodes one second of 16 bit joint stereo audio at |state.range(1)| Hz, so
+// the time per iteration is the CPU time used per second of streaming.
+static void BM_SbcEncodeOneSecond(State& state, bool simd) {
+  SBC_ENC_PARAMS params;
+  memset(&params, 0, sizeof(params));
+  params.s16SamplingFreq = state.range(0);
+  params.s16ChannelMode = SBC_JOINT_STEREO;
+  params.s16NumOfSubBands = SUB_BANDS_8;
+  params.s16NumOfBlocks = 16;
+  params.s16AllocationMethod = SBC_LOUDNESS;
+  params.u16BitRate = state.range(2);
+
+  SBC_Encoder_Allow_Simd(simd);
+  SBC_Encoder_Init(&params);
+
+  size_t frames_per_sbc_frame = params.s16NumOfBlocks * params.s16NumOfSubBands;
+  size_t sbc_frames = (state.range(1) + frames_per_sbc_frame - 1) /
+                      frames_per_sbc_frame;
+  std::vector<int16_t> pcm(sbc_frames * frames_per_sbc_frame * 2);
+  uint32_t seed = 0x12345678;
+  for (int16_t& sample : pcm) {
+    seed = seed * 1103515245 + 12345;
+    sample = seed >> 16;
+  }
+
+  uint64_t bytes = 0;
+  for (auto _ : state) {
+    uint8_t output[kMaxFrameSize];
+    for (size_t i = 0; i < sbc_frames; i++) {
+      bytes += SBC_Encode(&params, pcm.data() + i * frames_per_sbc_frame * 2,
+                          output);
+      benchmark::DoNotOptimize(output);
+    }
+  }
+  state.SetBytesProcessed(bytes);
+  SBC_Encoder_Allow_Simd(true);
+}
+BENCHMARK_CAPTURE(BM_SbcEncodeOneSecond, scalar, false)
+    ->Apply(Configurations)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_SbcEncodeOneSecond, simd, true)
+    ->Apply(Configurations)
+    ->Unit(benchmark::kMillisecond);
+
+// Encodes one 8 subband, 16 block joint stereo frame of |state.range(2)| kbps
+// per iteration, with the kernels specialized for this configuration or the
+// generic ones, so the time per iteration is the cost of a frame. Multiply it
+// by the clock rate of the CPU for the cycles per frame.
+static void BM_SbcEncodeFrame(State& state, bool specialized) {
+  SBC_ENC_PARAMS params;
+  memset(&params, 0, sizeof(params));
+  params.s16SamplingFreq = state.range(0);
+  params.s16ChannelMode = SBC_JOINT_STEREO;
+  params.s16NumOfSubBands = SUB_BANDS_8;
+  params.s16NumOfBlocks = 16;
+  params.s16AllocationMethod = SBC_LOUDNESS;
+  params.u16BitRate = state.range(2);
+
+  SBC_Encoder_Allow_Specialized(specialized);
+  SBC_Encoder_Init(&params);
+
+  // A short loop of frames so that the filter history is not always silence
+  constexpr size_t kFrames = 64;
+  size_t frame_samples = params.s16NumOfBlocks * params.s16NumOfSubBands * 2;
+  std::vector<int16_t> pcm(kFrames * frame_samples);
+  uint32_t seed = 0x12345678;
+  for (int16_t& sample : pcm) {
+    seed = seed * 1103515245 + 12345;
+    sample = seed >> 16;
+  }
+
+  size_t frame = 0;
+  for (auto _ : state) {
+    uint8_t output[kMaxFrameSize];
+    SBC_Encode(&params, pcm.data() + frame * frame_samples, output);
+    benchmark::DoNotOptimize(output);
+    frame = (frame + 1) % kFrames;
+  }
+  state.SetItemsProcessed(state.iterations());
+  SBC_Encoder_Allow_Specialized(true);
+}
+BENCHMARK_CAPTURE(BM_SbcEncodeFrame, generic, false)->Apply(Configurations);
+BENCHMARK_CAPTURE(BM_SbcEncodeFrame, specialized, true)->Apply(Configurations);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,182 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "sbc_encoder.h"
+
+namespace {
+
+constexpr int kNumFrames = 64;
+constexpr size_t kMaxFrameSize = 512;
+
+struct EncodedStream {
+  std::vector<uint8_t> frames;
+  std::vector<int32_t> subbands;
+};
+
+// Deterministic noise with full scale square bursts.
+std::vector<int16_t> make_pcm(size_t samples) {
+  std::vector<int16_t> pcm(samples);
+  uint32_t seed = 0x12345678;
+  for (size_t i = 0; i < samples; i++) {
+    seed = seed * 1103515245 + 12345;
+    if ((i / 256) % 4 == 3)
+      pcm[i] = (seed & 0x10000) ? INT16_MAX : INT16_MIN;
+    else
+      pcm[i] = (int16_t)(seed >> 16);
+  }
+  return pcm;
+}
+
+EncodedStream encode(SBC_ENC_PARAMS params, bool allow_simd,
+                     bool allow_specialized = true) {
+  EncodedStream stream;
+
+  SBC_Encoder_Allow_Simd(allow_simd);
+  SBC_Encoder_Allow_Specialized(allow_specialized);
+  SBC_Encoder_Init(&params);
+
+  size_t samples_per_frame = params.s16NumOfBlocks * params.s16NumOfSubBands *
+                             params.s16NumOfChannels;
+  std::vector<int16_t> pcm = make_pcm(samples_per_frame * kNumFrames);
+
+  for (int i = 0; i < kNumFrames; i++) {
+    uint8_t output[kMaxFrameSize];
+    uint32_t len =
+        SBC_Encode(&params, pcm.data() + i * samples_per_frame, output);
+    EXPECT_LE(len, kMaxFrameSize);
+    stream.frames.insert(stream.frames.end(), output, output + len);
+    stream.subbands.insert(stream.subbands.end(), params.s32SbBuffer,
+                           params.s32SbBuffer + samples_per_frame);
+  }
+
+  SBC_Encoder_Allow_Simd(true);
+  SBC_Encoder_Allow_Specialized(true);
+  return stream;
+}
+
+class SbcEncoderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memset(&params_, 0, sizeof(params_));
+    params_.s16SamplingFreq = SBC_sf44100;
+    params_.u16BitRate = 328;
+  }
+
+  SBC_ENC_PARAMS params_;
+};
+
+}  // namespace
+
+TEST_F(SbcEncoderTest, simd_analysis_matches_scalar) {
+  if (!SBC_Encoder_Allow_Simd(true)) {
+    printf("No vectorized analysis filter in this build\n");
+    return;
+  }
+
+  for (int16_t subbands : {SUB_BANDS_4, SUB_BANDS_8}) {
+    for (int16_t mode : {SBC_MONO, SBC_DUAL, SBC_STEREO, SBC_JOINT_STEREO}) {
+      for (int16_t blocks : {4, 8, 12, 16}) {
+        for (int16_t alloc : {SBC_LOUDNESS, SBC_SNR}) {
+          SCOPED_TRACE(testing::Message()
+                       << "subbands=" << subbands << " mode=" << mode
+                       << " blocks=" << blocks << " alloc=" << alloc);
+          params_.s16NumOfSubBands = subbands;
+          params_.s16ChannelMode = mode;
+          params_.s16NumOfBlocks = blocks;
+          params_.s16AllocationMethod = alloc;
+
+          EncodedStream scalar = encode(params_, false);
+          EncodedStream simd = encode(params_, true);
+
+          ASSERT_FALSE(scalar.frames.empty());
+          EXPECT_EQ(scalar.subbands, simd.subbands);
+          EXPECT_EQ(scalar.frames, simd.frames);
+        }
+      }
+    }
+  }
+}
+
+TEST_F(SbcEncoderTest, fast_packing_matches_reference) {
+  // The bit allocation, quantizer and packing by words are used on every
+  // build, with or without a vectorized analysis filter
+  for (int16_t subbands : {SUB_BANDS_4, SUB_BANDS_8}) {
+    for (int16_t mode : {SBC_MONO, SBC_DUAL, SBC_STEREO, SBC_JOINT_STEREO}) {
+      for (int16_t blocks : {4, 8, 12, 16}) {
+        for (int16_t alloc : {SBC_LOUDNESS, SBC_SNR}) {
+          for (uint16_t bitrate : {128, 328, 512}) {
+            SCOPED_TRACE(testing::Message()
+                         << "subbands=" << subbands << " mode=" << mode
+                         << " blocks=" << blocks << " alloc=" << alloc
+                         << " bitrate=" << bitrate);
+            params_.s16NumOfSubBands = subbands;
+            params_.s16ChannelMode = mode;
+            params_.s16NumOfBlocks = blocks;
+            params_.s16AllocationMethod = alloc;
+            params_.u16BitRate = bitrate;
+
+            EncodedStream reference = encode(params_, false);
+            EncodedStream fast = encode(params_, true);
+
+            ASSERT_FALSE(reference.frames.empty());
+            EXPECT_EQ(reference.frames, fast.frames);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST_F(SbcEncoderTest, specialized_kernels_match_generic) {
+  // Only 8 subbands and 16 blocks in stereo or joint stereo are specialized,
+  // the other configurations check that the generic kernels are selected
+  for (int16_t subbands : {SUB_BANDS_4, SUB_BANDS_8}) {
+    for (int16_t mode : {SBC_MONO, SBC_DUAL, SBC_STEREO, SBC_JOINT_STEREO}) {
+      for (int16_t blocks : {8, 16}) {
+        for (int16_t alloc : {SBC_LOUDNESS, SBC_SNR}) {
+          for (int16_t freq : {SBC_sf16000, SBC_sf44100, SBC_sf48000}) {
+            SCOPED_TRACE(testing::Message()
+                         << "subbands=" << subbands << " mode=" << mode
+                         << " blocks=" << blocks << " alloc=" << alloc
+                         << " freq=" << freq);
+            params_.s16NumOfSubBands = subbands;
+            params_.s16ChannelMode = mode;
+            params_.s16NumOfBlocks = blocks;
+            params_.s16AllocationMethod = alloc;
+            params_.s16SamplingFreq = freq;
+
+            for (bool allow_simd : {false, true}) {
+              EncodedStream generic = encode(params_, allow_simd, false);
+              EncodedStream specialized = encode(params_, allow_simd, true);
+
+              ASSERT_FALSE(generic.frames.empty());
+              EXPECT_EQ(generic.subbands, specialized.subbands);
+              EXPECT_EQ(generic.frames, specialized.frames);
+            }
+          }
+        }
+      }
+    }
+  }
+}
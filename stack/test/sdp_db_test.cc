@@ -0,0 +1,127 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "sdp_api.h"
+#include "stack/sdp/sdpint.h"
+
+namespace {
+
+// The 16 byte form of the Serial Port service class UUID (0x1101)
+const uint8_t kSerialPortUuid128[] = {0x00, 0x00, 0x11, 0x01, 0x00, 0x00,
+                                      0x10, 0x00, 0x80, 0x00, 0x00, 0x80,
+                                      0x5F, 0x9B, 0x34, 0xFB};
+
+void add_uuid16(tSDP_UUID_SEQ* p_seq, uint16_t uuid) {
+  tUID_ENT* p_ent = &p_seq->uuid_entry[p_seq->num_uids++];
+  p_ent->len = 2;
+  p_ent->value[0] = uuid >> 8;
+  p_ent->value[1] = uuid & 0xFF;
+}
+
+}  // namespace
+
+class SdpDbTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SDP_DeleteRecord(0);
+    memset(&seq_, 0, sizeof(seq_));
+  }
+
+  void TearDown() override { SDP_DeleteRecord(0); }
+
+  tSDP_UUID_SEQ seq_;
+};
+
+TEST_F(SdpDbTest, service_search_matches_all_uuid_forms) {
+  uint16_t service = UUID_SERVCLASS_SERIAL_PORT;
+  uint32_t handle = SDP_CreateRecord();
+  ASSERT_NE(0u, handle);
+  ASSERT_TRUE(SDP_AddServiceClassIdList(handle, 1, &service));
+  tSDP_RECORD* p_rec = sdp_db_find_record(handle);
+
+  add_uuid16(&seq_, UUID_SERVCLASS_SERIAL_PORT);
+  EXPECT_EQ(p_rec, sdp_db_service_search(NULL, &seq_));
+  EXPECT_EQ(NULL, sdp_db_service_search(p_rec, &seq_));
+
+  seq_.uuid_entry[0].len = 4;
+  memcpy(seq_.uuid_entry[0].value, kSerialPortUuid128, 4);
+  EXPECT_EQ(p_rec, sdp_db_service_search(NULL, &seq_));
+
+  seq_.uuid_entry[0].len = sizeof(kSerialPortUuid128);
+  memcpy(seq_.uuid_entry[0].value, kSerialPortUuid128,
+         sizeof(kSerialPortUuid128));
+  EXPECT_EQ(p_rec, sdp_db_service_search(NULL, &seq_));
+
+  // Every UUID of the request has to be in the record
+  add_uuid16(&seq_, UUID_PROTOCOL_L2CAP);
+  EXPECT_EQ(NULL, sdp_db_service_search(NULL, &seq_));
+}
+
+TEST_F(SdpDbTest, service_search_follows_attribute_changes) {
+  uint16_t service = UUID_SERVCLASS_SERIAL_PORT;
+  uint32_t handle = SDP_CreateRecord();
+  ASSERT_TRUE(SDP_AddServiceClassIdList(handle, 1, &service));
+
+  add_uuid16(&seq_, UUID_SERVCLASS_HEADSET);
+  EXPECT_EQ(NULL, sdp_db_service_search(NULL, &seq_));
+
+  // Replacing the attribute drops the UUIDs cached for the record
+  service = UUID_SERVCLASS_HEADSET;
+  ASSERT_TRUE(SDP_AddServiceClassIdList(handle, 1, &service));
+  EXPECT_EQ(sdp_db_find_record(handle), sdp_db_service_search(NULL, &seq_));
+
+  ASSERT_TRUE(SDP_DeleteAttribute(handle, ATTR_ID_SERVICE_CLASS_ID_LIST));
+  EXPECT_EQ(NULL, sdp_db_service_search(NULL, &seq_));
+}
+
+TEST_F(SdpDbTest, service_search_skips_non_matching_records) {
+  uint16_t first = UUID_SERVCLASS_HEADSET;
+  uint16_t second = UUID_SERVCLASS_SERIAL_PORT;
+  uint32_t first_handle = SDP_CreateRecord();
+  uint32_t second_handle = SDP_CreateRecord();
+  ASSERT_TRUE(SDP_AddServiceClassIdList(first_handle, 1, &first));
+  ASSERT_TRUE(SDP_AddServiceClassIdList(second_handle, 1, &second));
+
+  add_uuid16(&seq_, UUID_SERVCLASS_SERIAL_PORT);
+  EXPECT_EQ(sdp_db_find_record(second_handle),
+            sdp_db_service_search(NULL, &seq_));
+
+  // The records moved by a delete keep matching
+  ASSERT_TRUE(SDP_DeleteRecord(first_handle));
+  EXPECT_EQ(sdp_db_find_record(second_handle),
+            sdp_db_service_search(NULL, &seq_));
+}
+
+TEST_F(SdpDbTest, find_attr_in_rec_returns_first_in_range) {
+  uint8_t value[2] = {0x01, 0x02};
+  uint32_t handle = SDP_CreateRecord();
+  ASSERT_TRUE(SDP_AddAttribute(handle, 0x0300, UINT_DESC_TYPE, 2, value));
+  ASSERT_TRUE(SDP_AddAttribute(handle, 0x0100, UINT_DESC_TYPE, 2, value));
+  ASSERT_TRUE(SDP_AddAttribute(handle, 0x0200, UINT_DESC_TYPE, 2, value));
+  tSDP_RECORD* p_rec = sdp_db_find_record(handle);
+
+  EXPECT_EQ(ATTR_ID_SERVICE_RECORD_HDL,
+            sdp_db_find_attr_in_rec(p_rec, 0, 0xFFFF)->id);
+  EXPECT_EQ(0x0100, sdp_db_find_attr_in_rec(p_rec, 0x0001, 0xFFFF)->id);
+  EXPECT_EQ(0x0200, sdp_db_find_attr_in_rec(p_rec, 0x0101, 0x0200)->id);
+  EXPECT_EQ(0x0300, sdp_db_find_attr_in_rec(p_rec, 0x0300, 0x0300)->id);
+  EXPECT_EQ(NULL, sdp_db_find_attr_in_rec(p_rec, 0x0101, 0x01FF));
+  EXPECT_EQ(NULL, sdp_db_find_attr_in_rec(p_rec, 0x0301, 0xFFFF));
+}
@@ -0,0 +1,85 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+#include <string.h>
+
+#include "stack/smp/p_256_ecc_pp.h"
+
+using ::benchmark::State;
+
+// Debug private key from BT Spec 5.0 | Vol 3, Part H 2.3.5.6.1
+static const uint32_t kPrivateKey[KEY_LENGTH_DWORDS_P256] = {
+    0xcd3c1abd, 0x5899b8a6, 0xeb40b799, 0x4aff607b,
+    0xd2103f50, 0x74c9b3e3, 0xa3c55f38, 0x3f49f6d4};
+
+class BM_P256 : public ::benchmark::Fixture {
+ public:
+  void SetUp(State& st) override {
+    p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+    memcpy(private_key_, kPrivateKey, sizeof(private_key_));
+    // Any point other than G stands in for the peer public key
+    ECC_PointMult_Base(&peer_key_, private_key_);
+  }
+
+ protected:
+  uint32_t private_key_[KEY_LENGTH_DWORDS_P256];
+  Point peer_key_;
+};
+
+// Public key generation, as done before: binary NAF on G
+BENCHMARK_F(BM_P256, public_key_naf)(State& state) {
+  for (auto _ : state) {
+    uint32_t k[KEY_LENGTH_DWORDS_P256];
+    memcpy(k, private_key_, sizeof(k));
+    Point base = curve_p256.G, q;
+    ECC_PointMult_Bin_NAF(&q, &base, k, KEY_LENGTH_DWORDS_P256);
+    benchmark::DoNotOptimize(q);
+  }
+}
+
+// Public key generation with the fixed-base comb
+BENCHMARK_F(BM_P256, public_key_comb)(State& state) {
+  for (auto _ : state) {
+    Point q;
+    ECC_PointMult_Base(&q, private_key_);
+    benchmark::DoNotOptimize(q);
+  }
+}
+
+// DHKey computation, as done before: binary NAF on the peer key
+BENCHMARK_F(BM_P256, dhkey_naf)(State& state) {
+  for (auto _ : state) {
+    uint32_t k[KEY_LENGTH_DWORDS_P256];
+    memcpy(k, private_key_, sizeof(k));
+    Point base = peer_key_, q;
+    ECC_PointMult_Bin_NAF(&q, &base, k, KEY_LENGTH_DWORDS_P256);
+    benchmark::DoNotOptimize(q);
+  }
+}
+
+// DHKey computation with the regular fixed window
+BENCHMARK_F(BM_P256, dhkey_window)(State& state) {
+  for (auto _ : state) {
+    Point base = peer_key_, q;
+    ECC_PointMult_Window(&q, &base, private_key_);
+    benchmark::DoNotOptimize(q);
+  }
+}
+
+BENCHMARK_MAIN();
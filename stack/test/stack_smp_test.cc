@@ -23,6 +23,7 @@
 #include "bt_trace.h"
 #include "hcidefs.h"
 #include "stack/include/smp_api.h"
+#include "stack/smp/p_256_ecc_pp.h"
 #include "stack/smp/smp_int.h"
 
 /*
@@ -207,4 +208,79 @@ TEST_F(SmpCalculateConfirmTest, test_smp_calculate_comfirm_as_master) {
   dump_uint128_reverse(output, confirm_str);
   ASSERT_THAT(confirm_str, StrEq(expected_confirm_str));
 }
+
+class SmpP256Test : public Test {
+ protected:
+  void SetUp() { p_256_init_curve(KEY_LENGTH_DWORDS_P256); }
+
+  // Reference result from the binary NAF implementation
+  Point naf_mult(const Point& p, const uint32_t* n) {
+    Point base = p, q;
+    uint32_t k[KEY_LENGTH_DWORDS_P256];
+    memcpy(k, n, sizeof(k));
+    ECC_PointMult_Bin_NAF(&q, &base, k, KEY_LENGTH_DWORDS_P256);
+    return q;
+  }
+
+  void set_scalar(uint32_t* n, uint32_t seed) {
+    for (int i = 0; i < KEY_LENGTH_DWORDS_P256; i++) {
+      seed = seed * 1103515245 + 12345;
+      n[i] = seed;
+    }
+  }
+};
+
+// Debug public key from BT Spec 5.0 | Vol 3, Part H 2.3.5.6.1
+TEST_F(SmpP256Test, test_base_mult_debug_key) {
+  uint32_t private_key[KEY_LENGTH_DWORDS_P256] = {
+      0xcd3c1abd, 0x5899b8a6, 0xeb40b799, 0x4aff607b,
+      0xd2103f50, 0x74c9b3e3, 0xa3c55f38, 0x3f49f6d4};
+  uint32_t public_x[KEY_LENGTH_DWORDS_P256] = {
+      0x0e359de6, 0xcc030148, 0xacf4fddb, 0xeff49111,
+      0xe9f9a5b9, 0x5e2c83a7, 0xf297be2c, 0x20b003d2};
+  uint32_t public_y[KEY_LENGTH_DWORDS_P256] = {
+      0x1589d28b, 0x741c8ed0, 0x8fed3024, 0x766345c2,
+      0x5a52155c, 0x63329abf, 0x652aeb6d, 0xdc809c49};
+
+  Point q;
+  ECC_PointMult_Base(&q, private_key);
+  EXPECT_EQ(0, memcmp(q.x, public_x, sizeof(public_x)));
+  EXPECT_EQ(0, memcmp(q.y, public_y, sizeof(public_y)));
+}
+
+// Fixed-base comb must agree with the binary NAF method
+TEST_F(SmpP256Test, test_base_mult_matches_naf) {
+  for (uint32_t seed = 1; seed <= 16; seed++) {
+    uint32_t n[KEY_LENGTH_DWORDS_P256];
+    set_scalar(n, seed);
+
+    Point expected = naf_mult(curve_p256.G, n);
+    Point q;
+    ECC_PointMult_Base(&q, n);
+    EXPECT_EQ(0, memcmp(q.x, expected.x, sizeof(q.x))) << "seed " << seed;
+    EXPECT_EQ(0, memcmp(q.y, expected.y, sizeof(q.y))) << "seed " << seed;
+  }
+}
+
+// Windowed multiplication must agree with the binary NAF method, for odd and
+// even scalars and a point other than the generator
+TEST_F(SmpP256Test, test_window_mult_matches_naf) {
+  uint32_t m[KEY_LENGTH_DWORDS_P256];
+  set_scalar(m, 0xabcdef);
+  Point p;
+  ECC_PointMult_Base(&p, m);
+  ASSERT_TRUE(ECC_ValidatePoint(p));
+
+  for (uint32_t seed = 1; seed <= 16; seed++) {
+    uint32_t n[KEY_LENGTH_DWORDS_P256];
+    set_scalar(n, seed);
+    if (seed & 0x01) n[0] &= ~0x01;
+
+    Point expected = naf_mult(p, n);
+    Point base = p, q;
+    ECC_PointMult_Window(&q, &base, n);
+    EXPECT_EQ(0, memcmp(q.x, expected.x, sizeof(q.x))) << "seed " << seed;
+    EXPECT_EQ(0, memcmp(q.y, expected.y, sizeof(q.y))) << "seed " << seed;
+  }
+}
 }  // namespace testing
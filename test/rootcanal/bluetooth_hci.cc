@@ -130,6 +130,12 @@ Return<void> BluetoothHci::initialize(const sp<IBluetoothHciCallbacks>& cb) {
   controller_.RegisterTaskCancel(
       [this](AsyncTaskId task) { async_manager_.CancelAsyncTask(task); });
 
+  controller_.RegisterClock([this]() { return async_manager_.Now(); });
+
+  controller_.RegisterVirtualTimeControl([this](bool virtual_time) {
+    async_manager_.SetVirtualTime(virtual_time);
+  });
+
   SetUpTestChannel(6111);
 
   unlink_cb_ = [cb](sp<BluetoothDeathRecipient>& death_recipient) {
@@ -0,0 +1,69 @@
+#!/usr/bin/env python
+"""
+This script turns a circular btsnoop capture file (written when
+persist.bluetooth.btsnoopcircularsize is set) into a regular btsnoop
+log file which can be viewed using standard tools like Wireshark.
+
+A circular capture file can be described as:
+
+circular_header
+data {
+  repeated {
+    record_header
+    record_data
+  }
+}
+
+where the data area wraps around, the header holds the positions of
+the oldest record and of the end of the newest one, and the records
+are btsnoop records.
+"""
+
+
+import struct
+import sys
+
+
+CIRCULAR_MAGIC = 'btsnpcrc'
+CIRCULAR_VERSION = 1
+CIRCULAR_HEADER_FORMAT = '<8sIIQQQ'
+
+BTSNOOP_FILE_HEADER = 'btsnoop\x00\x00\x00\x00\x01\x00\x00\x03\xea'
+
+
+def linearize(capture):
+  """
+  Returns the records of a circular capture file, oldest first.
+  """
+  magic, version, header_size, data_size, first_record, end = \
+      struct.unpack_from(CIRCULAR_HEADER_FORMAT, capture)
+  if magic != CIRCULAR_MAGIC or version != CIRCULAR_VERSION:
+    sys.stderr.write('Not a circular btsnoop capture file.\n')
+    sys.exit(1)
+
+  data = capture[header_size : header_size + data_size]
+  if len(data) != data_size or end - first_record > data_size:
+    sys.stderr.write('Truncated circular btsnoop capture file.\n')
+    sys.exit(1)
+
+  start = first_record % data_size
+  length = end - first_record
+  if start + length <= data_size:
+    return data[start : start + length]
+  return data[start:] + data[: start + length - data_size]
+
+
+def main():
+  if len(sys.argv) != 2:
+    sys.stderr.write('Usage: %s <circular capture file>\n' % sys.argv[0])
+    exit(1)
+
+  with open(sys.argv[1], 'rb') as f:
+    capture = f.read()
+
+  sys.stdout.write(BTSNOOP_FILE_HEADER)
+  sys.stdout.write(linearize(capture))
+
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,361 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Shared memory transport of the UIPC audio channel.
+ *
+ *  When the audio HAL connects the audio socket, the stack sends it a
+ *  tUIPC_SHM_SETUP message carrying a memory fd and two eventfds. The HAL
+ *  then writes the PCM data to a ring buffer in that memory instead of the
+ *  socket, which is only kept open to detect when either side goes away.
+ *
+ *  Each side only makes a syscall to wake the other side up when that side
+ *  is waiting: for data (the stack) or for room (the HAL). A HAL that does
+ *  not receive the setup message keeps writing to the socket, and the stack
+ *  goes back to reading the socket when data shows up on it.
+ *
+ *  This header is shared by the stack and the audio HALs.
+ *
+ ******************************************************************************/
+#ifndef UIPC_SHM_H
+#define UIPC_SHM_H
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <new>
+
+#define UIPC_SHM_MAGIC 0x55534D31 /* "USM1" */
+
+/* Size of the ring, a power of two no smaller than the socket buffers */
+#define UIPC_SHM_RING_SIZE (32 * 1024)
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2,
+              "the ring positions are shared between processes");
+
+/* Start of the shared memory, followed by the ring data */
+typedef struct {
+  uint32_t magic;
+  uint32_t size;
+  std::atomic<uint32_t> write_pos; /* free running, moved by the writer */
+  std::atomic<uint32_t> read_pos;  /* free running, moved by the reader */
+  std::atomic<uint32_t> reader_waiting; /* bytes the reader waits for */
+  std::atomic<uint32_t> writer_waiting; /* room the writer waits for */
+} tUIPC_SHM_HDR;
+
+/* Message sent by the stack with the memory fd, data fd and room fd */
+typedef struct {
+  uint32_t magic;
+  uint32_t size;
+} tUIPC_SHM_SETUP;
+
+#define UIPC_SHM_NUM_FDS 3
+
+typedef struct {
+  tUIPC_SHM_HDR* hdr; /* NULL when the channel does not use shared memory */
+  uint8_t* data;
+  uint32_t size;
+  int mem_fd;
+  int data_fd; /* signaled by the writer when data was added */
+  int room_fd; /* signaled by the reader when data was removed */
+} tUIPC_SHM;
+
+static inline void uipc_shm_init(tUIPC_SHM* p_shm) {
+  p_shm->hdr = NULL;
+  p_shm->data = NULL;
+  p_shm->size = 0;
+  p_shm->mem_fd = -1;
+  p_shm->data_fd = -1;
+  p_shm->room_fd = -1;
+}
+
+static inline void uipc_shm_close(tUIPC_SHM* p_shm) {
+  if (p_shm->hdr != NULL)
+    munmap(p_shm->hdr, sizeof(tUIPC_SHM_HDR) + p_shm->size);
+  if (p_shm->mem_fd != -1) close(p_shm->mem_fd);
+  if (p_shm->data_fd != -1) close(p_shm->data_fd);
+  if (p_shm->room_fd != -1) close(p_shm->room_fd);
+  uipc_shm_init(p_shm);
+}
+
+static inline bool uipc_shm_map(tUIPC_SHM* p_shm, uint32_t size) {
+  void* p = mmap(NULL, sizeof(tUIPC_SHM_HDR) + size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED, p_shm->mem_fd, 0);
+  if (p == MAP_FAILED) return false;
+
+  p_shm->hdr = static_cast<tUIPC_SHM_HDR*>(p);
+  p_shm->data = static_cast<uint8_t*>(p) + sizeof(tUIPC_SHM_HDR);
+  p_shm->size = size;
+  return true;
+}
+
+/* Creates the memory and the eventfds of a new ring, on the stack side */
+static inline bool uipc_shm_create(tUIPC_SHM* p_shm) {
+  uipc_shm_init(p_shm);
+
+  p_shm->mem_fd = syscall(__NR_memfd_create, "uipc_audio", MFD_CLOEXEC);
+  p_shm->data_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  p_shm->room_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (p_shm->mem_fd == -1 || p_shm->data_fd == -1 || p_shm->room_fd == -1 ||
+      ftruncate(p_shm->mem_fd, sizeof(tUIPC_SHM_HDR) + UIPC_SHM_RING_SIZE) ||
+      !uipc_shm_map(p_shm, UIPC_SHM_RING_SIZE)) {
+    uipc_shm_close(p_shm);
+    return false;
+  }
+
+  tUIPC_SHM_HDR* hdr = new (p_shm->hdr) tUIPC_SHM_HDR;
+  hdr->magic = UIPC_SHM_MAGIC;
+  hdr->size = UIPC_SHM_RING_SIZE;
+  hdr->write_pos = 0;
+  hdr->read_pos = 0;
+  hdr->reader_waiting = 0;
+  hdr->writer_waiting = 0;
+  return true;
+}
+
+/* Sends the setup message of |p_shm| to the HAL connected on |fd| */
+static inline bool uipc_shm_send_setup(const tUIPC_SHM* p_shm, int fd) {
+  tUIPC_SHM_SETUP setup = {UIPC_SHM_MAGIC, p_shm->size};
+  int fds[UIPC_SHM_NUM_FDS] = {p_shm->mem_fd, p_shm->data_fd, p_shm->room_fd};
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(sizeof(fds))];
+  } control;
+  struct iovec iov = {&setup, sizeof(setup)};
+  struct msghdr msg;
+
+  memset(&msg, 0, sizeof(msg));
+  memset(&control, 0, sizeof(control));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+  ssize_t ret;
+  do {
+    ret = sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+  } while (ret == -1 && errno == EINTR);
+  return ret == (ssize_t)sizeof(setup);
+}
+
+/* Waits up to |timeout_ms| for the setup message on the audio socket |fd|
+ * and maps the ring it describes, on the HAL side */
+static inline bool uipc_shm_receive_setup(tUIPC_SHM* p_shm, int fd,
+                                          int timeout_ms) {
+  struct pollfd pfd = {fd, POLLIN, 0};
+  tUIPC_SHM_SETUP setup;
+  int fds[UIPC_SHM_NUM_FDS];
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(sizeof(fds))];
+  } control;
+  struct iovec iov = {&setup, sizeof(setup)};
+  struct msghdr msg;
+  int ret;
+
+  uipc_shm_init(p_shm);
+
+  do {
+    ret = poll(&pfd, 1, timeout_ms);
+  } while (ret == -1 && errno == EINTR);
+  if (ret != 1 || !(pfd.revents & POLLIN)) return false;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  ssize_t n;
+  do {
+    n = recvmsg(fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+  } while (n == -1 && errno == EINTR);
+
+  struct cmsghdr* cmsg = (n > 0) ? CMSG_FIRSTHDR(&msg) : NULL;
+  if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET ||
+      cmsg->cmsg_type != SCM_RIGHTS) {
+    return false;
+  }
+  size_t num_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+  memcpy(fds, CMSG_DATA(cmsg),
+         (num_fds < UIPC_SHM_NUM_FDS ? num_fds : UIPC_SHM_NUM_FDS) *
+             sizeof(int));
+  if (num_fds != UIPC_SHM_NUM_FDS) {
+    for (size_t i = 0; i < num_fds && i < UIPC_SHM_NUM_FDS; i++)
+      close(fds[i]);
+    return false;
+  }
+  p_shm->mem_fd = fds[0];
+  p_shm->data_fd = fds[1];
+  p_shm->room_fd = fds[2];
+
+  struct stat st;
+  if (n != (ssize_t)sizeof(setup) || setup.magic != UIPC_SHM_MAGIC ||
+      setup.size == 0 || (setup.size & (setup.size - 1)) ||
+      fstat(p_shm->mem_fd, &st) ||
+      st.st_size < (off_t)(sizeof(tUIPC_SHM_HDR) + setup.size) ||
+      !uipc_shm_map(p_shm, setup.size) ||
+      p_shm->hdr->magic != UIPC_SHM_MAGIC || p_shm->hdr->size != setup.size) {
+    uipc_shm_close(p_shm);
+    return false;
+  }
+  return true;
+}
+
+static inline void uipc_shm_signal(int fd) {
+  uint64_t count = 1;
+  ssize_t ret;
+  do {
+    ret = write(fd, &count, sizeof(count));
+  } while (ret == -1 && errno == EINTR);
+}
+
+/* Number of bytes in the ring */
+static inline uint32_t uipc_shm_used(const tUIPC_SHM* p_shm) {
+  uint32_t used = p_shm->hdr->write_pos - p_shm->hdr->read_pos;
+  return used > p_shm->size ? 0 : used;
+}
+
+/* Copies up to |len| bytes out of the ring, returns the number copied */
+static inline uint32_t uipc_shm_read(tUIPC_SHM* p_shm, uint8_t* p_buf,
+                                     uint32_t len) {
+  tUIPC_SHM_HDR* hdr = p_shm->hdr;
+  uint32_t r = hdr->read_pos.load(std::memory_order_relaxed);
+  uint32_t used = hdr->write_pos.load(std::memory_order_acquire) - r;
+
+  if (used > p_shm->size) {
+    /* the writer broke the ring, drop what is in it */
+    hdr->read_pos = r + used;
+    return 0;
+  }
+  if (len > used) len = used;
+  if (len == 0) return 0;
+
+  uint32_t offset = r & (p_shm->size - 1);
+  uint32_t first = p_shm->size - offset;
+  if (first > len) first = len;
+  memcpy(p_buf, p_shm->data + offset, first);
+  memcpy(p_buf + first, p_shm->data, len - first);
+
+  hdr->read_pos = r + len;
+  uint32_t want = hdr->writer_waiting;
+  if (want && p_shm->size - (hdr->write_pos - (r + len)) >= want)
+    uipc_shm_signal(p_shm->room_fd);
+  return len;
+}
+
+/* Copies up to |len| bytes into the ring, returns the number copied */
+static inline uint32_t uipc_shm_write(tUIPC_SHM* p_shm, const uint8_t* p_buf,
+                                      uint32_t len) {
+  tUIPC_SHM_HDR* hdr = p_shm->hdr;
+  uint32_t w = hdr->write_pos.load(std::memory_order_relaxed);
+  uint32_t used = w - hdr->read_pos.load(std::memory_order_acquire);
+
+  if (used > p_shm->size) return 0;
+  if (len > p_shm->size - used) len = p_shm->size - used;
+  if (len == 0) return 0;
+
+  uint32_t offset = w & (p_shm->size - 1);
+  uint32_t first = p_shm->size - offset;
+  if (first > len) first = len;
+  memcpy(p_shm->data + offset, p_buf, first);
+  memcpy(p_shm->data, p_buf + first, len - first);
+
+  hdr->write_pos = w + len;
+  uint32_t want = hdr->reader_waiting;
+  if (want && w + len - hdr->read_pos >= want) uipc_shm_signal(p_shm->data_fd);
+  return len;
+}
+
+/* Discards the data in the ring, on the reader side */
+static inline void uipc_shm_flush(tUIPC_SHM* p_shm) {
+  p_shm->hdr->read_pos = p_shm->hdr->write_pos.load();
+  if (p_shm->hdr->writer_waiting) uipc_shm_signal(p_shm->room_fd);
+}
+
+/* Marks the reader (or the writer) as waiting for |want| bytes of data (or
+ * room). The other side only wakes it up once that much is there, so that a
+ * writer ahead of the reader wakes up once per write rather than once per
+ * read. Returns false, without waiting, when it is there after all. */
+static inline bool uipc_shm_wait_begin(tUIPC_SHM* p_shm, bool writer,
+                                       uint32_t want) {
+  tUIPC_SHM_HDR* hdr = p_shm->hdr;
+  std::atomic<uint32_t>& waiting =
+      writer ? hdr->writer_waiting : hdr->reader_waiting;
+
+  if (want > p_shm->size) want = p_shm->size;
+  if (want == 0) want = 1;
+  waiting = want;
+  uint32_t used = hdr->write_pos - hdr->read_pos;
+  if ((writer ? p_shm->size - used : used) >= want) {
+    waiting = 0;
+    return false;
+  }
+  return true;
+}
+
+static inline void uipc_shm_wait_end(tUIPC_SHM* p_shm, bool writer) {
+  if (writer)
+    p_shm->hdr->writer_waiting = 0;
+  else
+    p_shm->hdr->reader_waiting = 0;
+}
+
+/* Waits up to |timeout_ms| for |event_fd| to be signaled. Returns 1 when it
+ * was, 0 on timeout and -1 when the peer closed or wrote to |skt_fd|. Does
+ * not touch the ring, so it can be called without holding the lock that
+ * protects it. */
+static inline int uipc_shm_wait(int event_fd, int skt_fd, int timeout_ms) {
+  struct pollfd pfd[2] = {{event_fd, POLLIN, 0}, {skt_fd, POLLIN, 0}};
+  int ret;
+
+  do {
+    ret = poll(pfd, 2, timeout_ms);
+  } while (ret == -1 && errno == EINTR);
+  if (ret <= 0) return ret;
+
+  if (pfd[1].revents) return -1;
+
+  uint64_t count;
+  ssize_t n;
+  do {
+    n = read(event_fd, &count, sizeof(count));
+  } while (n == -1 && errno == EINTR);
+  return 1;
+}
+
+#endif /* UIPC_SHM_H */
@@ -55,6 +55,7 @@
 #include "osi/include/osi.h"
 #include "osi/include/socket_utils/sockets.h"
 #include "uipc.h"
+#include "uipc_shm.h"
 
 /*****************************************************************************
  *  Constants & Macros
@@ -91,6 +92,7 @@ typedef struct {
   int read_poll_tmo_ms;
   int task_evt_flags; /* event flags pending to be processed in read task */
   tUIPC_RCV_CBACK* cback;
+  tUIPC_SHM shm; /* ring the HAL writes to, if it took it */
 } tUIPC_CHAN;
 
 typedef struct {
@@ -247,6 +249,7 @@ static int uipc_main_init(void) {
     p->fd = UIPC_DISCONNECTED;
     p->task_evt_flags = 0;
     p->cback = NULL;
+    uipc_shm_init(&p->shm);
   }
 
   return 0;
@@ -278,6 +281,29 @@ static void uipc_check_task_flags_locked(void) {
   }
 }
 
+/* offer a shared memory ring to the HAL that connected the audio channel */
+static void uipc_setup_shm_locked(tUIPC_CH_ID ch_id) {
+#if (UIPC_SHM_INCLUDED == TRUE)
+  tUIPC_CHAN* p_ch = &uipc_main.ch[ch_id];
+
+  if (ch_id != UIPC_CH_ID_AV_AUDIO) return;
+
+  if (!uipc_shm_create(&p_ch->shm)) {
+    BTIF_TRACE_WARNING("%s: no shared memory for ch %d (%s)", __func__, ch_id,
+                       strerror(errno));
+    return;
+  }
+  if (!uipc_shm_send_setup(&p_ch->shm, p_ch->fd)) {
+    BTIF_TRACE_WARNING("%s: failed to send shared memory setup (%s)",
+                       __func__, strerror(errno));
+    uipc_shm_close(&p_ch->shm);
+    return;
+  }
+  BTIF_TRACE_EVENT("%s: ch %d offered %u bytes of shared memory", __func__,
+                   ch_id, p_ch->shm.size);
+#endif
+}
+
 static int uipc_check_fd_locked(tUIPC_CH_ID ch_id) {
   if (ch_id >= UIPC_CH_NUM) return -1;
 
@@ -293,12 +319,15 @@ static int uipc_check_fd_locked(tUIPC_CH_ID ch_id) {
       OSI_NO_INTR(close(uipc_main.ch[ch_id].fd));
       FD_CLR(uipc_main.ch[ch_id].fd, &uipc_main.active_set);
       uipc_main.ch[ch_id].fd = UIPC_DISCONNECTED;
+      uipc_shm_close(&uipc_main.ch[ch_id].shm);
     }
 
     uipc_main.ch[ch_id].fd = accept_server_socket(uipc_main.ch[ch_id].srvfd);
 
     BTIF_TRACE_EVENT("NEW FD %d", uipc_main.ch[ch_id].fd);
 
+    if (uipc_main.ch[ch_id].fd >= 0) uipc_setup_shm_locked(ch_id);
+
     if ((uipc_main.ch[ch_id].fd >= 0) && uipc_main.ch[ch_id].cback) {
       /*  if we have a callback we should add this fd to the active set
           and notify user with callback event */
@@ -397,6 +426,9 @@ static void uipc_flush_ch_locked(tUIPC_CH_ID ch_id) {
     return;
   }
 
+  if (uipc_main.ch[ch_id].shm.hdr != NULL)
+    uipc_shm_flush(&uipc_main.ch[ch_id].shm);
+
   while (1) {
     int ret;
     OSI_NO_INTR(ret = poll(&pfd, 1, 1));
@@ -461,6 +493,8 @@ static int uipc_close_ch_locked(tUIPC_CH_ID ch_id) {
     wakeup = 1;
   }
 
+  uipc_shm_close(&uipc_main.ch[ch_id].shm);
+
   /* notify this connection is closed */
   if (uipc_main.ch[ch_id].cback)
     uipc_main.ch[ch_id].cback(ch_id, UIPC_CLOSE_EVT);
@@ -662,6 +696,62 @@ bool UIPC_Send(tUIPC_CH_ID ch_id, UNUSED_ATTR uint16_t msg_evt,
   return false;
 }
 
+/*******************************************************************************
+ **
+ ** Function         uipc_read_shm
+ **
+ ** Description      Read from the shared memory ring of a channel, waiting up
+ **                  to the read poll timeout for more data like the socket
+ **                  reads do. The lock is only held while the ring is used,
+ **                  so that the channel can be closed during the wait.
+ **
+ ** Returns          the number of bytes read, or -1 when the HAL wrote to
+ **                  the socket instead and the socket has to be read.
+ **
+ ******************************************************************************/
+static int uipc_read_shm(tUIPC_CH_ID ch_id, uint8_t* p_buf, uint32_t len) {
+  tUIPC_CHAN* p_ch = &uipc_main.ch[ch_id];
+  uint32_t n_read = 0;
+
+  while (true) {
+    int data_fd, fd;
+    {
+      std::lock_guard<std::recursive_mutex> lock(uipc_main.mutex);
+      if (p_ch->shm.hdr == NULL) return n_read;
+
+      n_read += uipc_shm_read(&p_ch->shm, p_buf + n_read, len - n_read);
+      if (n_read == len) return n_read;
+      if (!uipc_shm_wait_begin(&p_ch->shm, false, len - n_read)) continue;
+      data_fd = p_ch->shm.data_fd;
+      fd = p_ch->fd;
+    }
+
+    int ret = uipc_shm_wait(data_fd, fd, p_ch->read_poll_tmo_ms);
+
+    std::lock_guard<std::recursive_mutex> lock(uipc_main.mutex);
+    if (p_ch->shm.hdr == NULL) return n_read;
+    uipc_shm_wait_end(&p_ch->shm, false);
+    if (ret == 0) {
+      BTIF_TRACE_WARNING("poll timeout (%d ms)", p_ch->read_poll_tmo_ms);
+      return n_read;
+    }
+    if (ret < 0) {
+      char c;
+      ssize_t n;
+      OSI_NO_INTR(n = recv(fd, &c, sizeof(c), MSG_PEEK | MSG_DONTWAIT));
+      if (n > 0) {
+        BTIF_TRACE_WARNING("UIPC_Read : ch %d data on the socket, stop using "
+                           "shared memory", ch_id);
+        uipc_shm_close(&p_ch->shm);
+        return n_read ? (int)n_read : -1;
+      }
+      BTIF_TRACE_WARNING("UIPC_Read : channel detached remotely");
+      uipc_close_locked(ch_id);
+      return 0;
+    }
+  }
+}
+
 /*******************************************************************************
  **
  ** Function         UIPC_Read
@@ -690,7 +780,33 @@ uint32_t UIPC_Read(tUIPC_CH_ID ch_id, UNUSED_ATTR uint16_t* p_msg_evt,
     return 0;
   }
 
+  if (uipc_main.ch[ch_id].shm.hdr != NULL) {
+    n_read = uipc_read_shm(ch_id, p_buf, len);
+    if (n_read >= 0) return n_read;
+    n_read = 0;
+  }
+
   while (n_read < (int)len) {
+    ssize_t n;
+
+    /* the audio data is usually queued already, so try to get it without the
+       extra poll syscall */
+    OSI_NO_INTR(n = recv(fd, p_buf + n_read, len - n_read, MSG_DONTWAIT));
+    if (n > 0) {
+      n_read += n;
+      continue;
+    }
+    if (n == 0) {
+      BTIF_TRACE_WARNING("UIPC_Read : channel detached remotely");
+      std::lock_guard<std::recursive_mutex> lock(uipc_main.mutex);
+      uipc_close_locked(ch_id);
+      return 0;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      BTIF_TRACE_WARNING("UIPC_Read : read failed (%s)", strerror(errno));
+      return 0;
+    }
+
     pfd.fd = fd;
     pfd.events = POLLIN | POLLHUP;
 
@@ -719,7 +835,6 @@ uint32_t UIPC_Read(tUIPC_CH_ID ch_id, UNUSED_ATTR uint16_t* p_msg_evt,
       return 0;
     }
 
-    ssize_t n;
     OSI_NO_INTR(n = recv(fd, p_buf + n_read, len - n_read, 0));
 
     // BTIF_TRACE_EVENT("read %d bytes", n);
@@ -86,6 +86,15 @@ class AsyncManager {
   // have very simple CriticalCallbacks, preferably using lambda expressions.
   void Synchronize(const CriticalCallback&);
 
+  // Switches the tasks to a simulated clock. In virtual time the clock jumps
+  // to the time of the next task as soon as the previous one returns, so the
+  // tasks run in the same order as in real time but as fast as they can be
+  // processed. Switching back to real time keeps the tasks' relative delays.
+  void SetVirtualTime(bool virtual_time);
+
+  // Returns the current time of the clock the tasks are scheduled with.
+  std::chrono::steady_clock::time_point Now();
+
   AsyncManager();
 
   ~AsyncManager();
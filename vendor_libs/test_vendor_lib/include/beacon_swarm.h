@@ -25,19 +25,26 @@
 
 namespace test_vendor_lib {
 
-// Pretend to be a lot of beacons by changing the advertising address.
+// Pretend to be a lot of beacons, each with its own address counting up from
+// the address of the swarm.
 class BeaconSwarm : public Device {
  public:
   BeaconSwarm();
   virtual ~BeaconSwarm() = default;
 
-  // Set the address and advertising interval from string args.
+  // Set the address, advertising interval and number of beacons from string
+  // args.
   virtual void Initialize(const std::vector<std::string>& args) override;
 
   // Return a string representation of the type of device.
   virtual std::string GetTypeString() const override { return "beacon_swarm"; }
 
-  void TimerTick() override;
+  virtual size_t GetAdvertiserCount() const override { return beacon_count_; }
+
+  virtual BtAddress GetAdvertiserAddress(size_t advertiser) const override;
+
+ private:
+  size_t beacon_count_;
 };
 
 }  // namespace test_vendor_lib
@@ -76,10 +76,25 @@ class Device {
   // Return the scan response data.
   const std::vector<uint8_t>& GetScanResponse() const { return scan_data_; }
 
-  // Returns true if the host could see an advertisement in the next
-  // |scan_time| milliseconds.
+  // Return the number of advertisers simulated by the device, they share the
+  // advertising data and interval.
+  virtual size_t GetAdvertiserCount() const { return 1; }
+
+  // Return the address of the advertiser number |advertiser|.
+  virtual BtAddress GetAdvertiserAddress(size_t advertiser) const {
+    return address_;
+  }
+
+  // Returns true if the host could see an advertisement of the advertiser
+  // number |advertiser| in the |scan_time| milliseconds following |now|.
   virtual bool IsAdvertisementAvailable(
-      std::chrono::milliseconds scan_time) const;
+      std::chrono::steady_clock::time_point now,
+      std::chrono::milliseconds scan_time, size_t advertiser = 0) const;
+
+  // Set the time the device started advertising at.
+  void SetTimeStamp(std::chrono::steady_clock::time_point time_stamp) {
+    time_stamp_ = time_stamp;
+  }
 
   // Returns true if the host could see a page scan now.
   virtual bool IsPageScanAvailable() const;
@@ -190,6 +190,13 @@ class DualModeController {
 
   void RegisterTaskCancel(std::function<void(AsyncTaskId)> cancel);
 
+  // Set the clock the tasks are scheduled with, and the callback switching it
+  // between real and virtual time.
+  void RegisterClock(
+      std::function<std::chrono::steady_clock::time_point()> clock);
+
+  void RegisterVirtualTimeControl(std::function<void(bool)> set_virtual_time);
+
   // Set the callbacks for sending packets to the HCI.
   void RegisterEventChannel(
       const std::function<void(std::unique_ptr<EventPacket>)>& send_event);
@@ -475,6 +482,12 @@ class DualModeController {
   // List the devices that the controller knows about
   void TestChannelList(const std::vector<std::string>& args) const;
 
+  // Run the controller in virtual time ("on") or in real time ("off")
+  void TestChannelSetVirtualTime(const std::vector<std::string>& args);
+
+  // Return the current time of the registered clock
+  std::chrono::steady_clock::time_point Now() const;
+
   void Connections();
 
   void LeScan();
@@ -529,6 +542,9 @@ class DualModeController {
 
   std::function<void(AsyncTaskId)> cancel_task_;
 
+  std::function<std::chrono::steady_clock::time_point()> clock_;
+  std::function<void(bool)> set_virtual_time_;
+
   // Callbacks to send packets back to the HCI.
   std::function<void(std::unique_ptr<AclPacket>)> send_acl_;
   std::function<void(std::unique_ptr<EventPacket>)> send_event_;
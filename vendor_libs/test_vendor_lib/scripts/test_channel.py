@@ -196,6 +196,14 @@ class TestChannelShell(cmd.Cmd):
     """
     self._test_channel.send_command('set', args.split())
 
+  def do_set_virtual_time(self, args):
+    """
+    Arguments: on|off
+    Run the controller tasks on a simulated clock, as fast as they can be
+    processed, or back in real time.
+    """
+    self._test_channel.send_command('set_virtual_time', args.split())
+
   def do_list(self, args):
     """
     Arguments: [dev_num [attr]]
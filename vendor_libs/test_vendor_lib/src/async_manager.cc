@@ -279,15 +279,40 @@ class AsyncManager::AsyncTaskManager {
  public:
   AsyncTaskId ExecAsync(std::chrono::milliseconds delay,
                         const TaskCallback& callback) {
-    return scheduleTask(std::make_shared<Task>(
-        std::chrono::steady_clock::now() + delay, callback));
+    return scheduleTask(std::make_shared<Task>(Now() + delay, callback));
   }
 
   AsyncTaskId ExecAsyncPeriodically(std::chrono::milliseconds delay,
                                     std::chrono::milliseconds period,
                                     const TaskCallback& callback) {
-    return scheduleTask(std::make_shared<Task>(
-        std::chrono::steady_clock::now() + delay, period, callback));
+    return scheduleTask(
+        std::make_shared<Task>(Now() + delay, period, callback));
+  }
+
+  void SetVirtualTime(bool virtual_time) {
+    std::unique_lock<std::mutex> guard(internal_mutex_);
+    if (virtual_time == virtual_time_) return;
+    std::chrono::steady_clock::time_point real_now =
+        std::chrono::steady_clock::now();
+    if (virtual_time) {
+      virtual_now_ = real_now;
+    } else {
+      // Move the tasks to the real clock, they are due as long after now as
+      // they were on the virtual one
+      std::set<std::shared_ptr<Task>, task_p_comparator> tasks;
+      for (const std::shared_ptr<Task>& task_p : task_queue_) {
+        task_p->time = task_p->time - virtual_now_ + real_now;
+        tasks.insert(task_p);
+      }
+      task_queue_.swap(tasks);
+    }
+    virtual_time_ = virtual_time;
+    internal_cond_var_.notify_one();
+  }
+
+  std::chrono::steady_clock::time_point Now() {
+    std::unique_lock<std::mutex> guard(internal_mutex_);
+    return nowLocked();
   }
 
   bool CancelAsyncTask(AsyncTaskId async_task_id) {
@@ -401,6 +426,10 @@ class AsyncManager::AsyncTaskManager {
     return task_id;
   }
 
+  std::chrono::steady_clock::time_point nowLocked() const {
+    return virtual_time_ ? virtual_now_ : std::chrono::steady_clock::now();
+  }
+
   bool isTaskIdInUse(const AsyncTaskId& task_id) const {
     return tasks_by_id.count(task_id) != 0;
   }
@@ -430,7 +459,11 @@ class AsyncManager::AsyncTaskManager {
         std::unique_lock<std::mutex> guard(internal_mutex_);
         if (!task_queue_.empty()) {
           std::shared_ptr<Task> task_p = *(task_queue_.begin());
-          if (task_p->time < std::chrono::steady_clock::now()) {
+          // In virtual time the next task is always due, the clock jumps to it
+          if (virtual_time_ && task_p->time > virtual_now_)
+            virtual_now_ = task_p->time;
+          if (virtual_time_ ||
+              task_p->time < std::chrono::steady_clock::now()) {
             run_it = true;
             callback = task_p->callback;
             task_queue_.erase(task_p);  // need to remove and add again if
@@ -449,10 +482,13 @@ class AsyncManager::AsyncTaskManager {
       }
       {
         std::unique_lock<std::mutex> guard(internal_mutex_);
+        // the stop could have been notified while the callback was running
+        if (!running_) break;
         // wait on condition variable with timeout just in time for next task if
         // any
         if (task_queue_.size() > 0) {
-          internal_cond_var_.wait_until(guard, (*task_queue_.begin())->time);
+          if (!virtual_time_)
+            internal_cond_var_.wait_until(guard, (*task_queue_.begin())->time);
         } else {
           internal_cond_var_.wait(guard);
         }
@@ -463,6 +499,8 @@ class AsyncManager::AsyncTaskManager {
   }
 
   bool running_ = false;
+  bool virtual_time_ = false;
+  std::chrono::steady_clock::time_point virtual_now_;
   std::thread thread_;
   std::mutex internal_mutex_;
   std::condition_variable internal_cond_var_;
@@ -513,6 +551,14 @@ bool AsyncManager::CancelAsyncTask(AsyncTaskId async_task_id) {
   return taskManager_p_->CancelAsyncTask(async_task_id);
 }
 
+void AsyncManager::SetVirtualTime(bool virtual_time) {
+  taskManager_p_->SetVirtualTime(virtual_time);
+}
+
+std::chrono::steady_clock::time_point AsyncManager::Now() {
+  return taskManager_p_->Now();
+}
+
 void AsyncManager::Synchronize(const CriticalCallback& critical) {
   std::unique_lock<std::mutex> guard(synchronization_mutex_);
   critical();
@@ -17,12 +17,18 @@
 #define LOG_TAG "beacon_swarm"
 
 #include "beacon_swarm.h"
+
+#include <algorithm>
+
 #include "stack/include/hcidefs.h"
 
 using std::vector;
 
 namespace test_vendor_lib {
-BeaconSwarm::BeaconSwarm() {
+// The beacons take the two low bytes of the address
+static constexpr size_t kMaxBeaconCount = 65536;
+
+BeaconSwarm::BeaconSwarm() : beacon_count_(256) {
   advertising_interval_ms_ = std::chrono::milliseconds(1280);
   advertising_type_ = BTM_BLE_NON_CONNECT_EVT;
   adv_data_ = {0x02,  // Length
@@ -58,16 +64,24 @@ void BeaconSwarm::Initialize(const vector<std::string>& args) {
   if (args.size() < 3) return;
 
   SetAdvertisementInterval(std::chrono::milliseconds(std::stoi(args[2])));
+
+  if (args.size() < 4) return;
+
+  beacon_count_ = std::min(static_cast<size_t>(std::stoul(args[3])),
+                           kMaxBeaconCount);
+  if (beacon_count_ == 0) beacon_count_ = 1;
 }
 
-void BeaconSwarm::TimerTick() {
+BtAddress BeaconSwarm::GetAdvertiserAddress(size_t advertiser) const {
   std::vector<uint8_t> beacon_addr;
   GetBtAddress().ToVector(beacon_addr);
-  beacon_addr[0]++;
-  BtAddress next_addr;
-  next_addr.FromVector(beacon_addr);
-
-  SetBtAddress(next_addr);
+  uint16_t low = beacon_addr[0] | (beacon_addr[1] << 8);
+  low += advertiser;
+  beacon_addr[0] = low & 0xff;
+  beacon_addr[1] = low >> 8;
+  BtAddress addr;
+  addr.FromVector(beacon_addr);
+  return addr;
 }
 
 }  // namespace test_vendor_lib
@@ -31,15 +31,20 @@ std::string Device::ToString() const {
 }
 
 bool Device::IsAdvertisementAvailable(
-    std::chrono::milliseconds scan_time) const {
+    std::chrono::steady_clock::time_point now,
+    std::chrono::milliseconds scan_time, size_t advertiser) const {
   if (advertising_interval_ms_ == std::chrono::milliseconds(0)) return false;
 
-  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  // The advertisers of a device are spread evenly over the interval
+  std::chrono::milliseconds offset = advertising_interval_ms_ *
+                                    static_cast<int64_t>(advertiser) /
+                                    static_cast<int64_t>(GetAdvertiserCount());
+  std::chrono::steady_clock::time_point start = time_stamp_ + offset;
+  if (now < start) return (now + scan_time) >= start;
 
   std::chrono::steady_clock::time_point last_interval =
-      ((now - time_stamp_) / advertising_interval_ms_) *
-          advertising_interval_ms_ +
-      time_stamp_;
+      ((now - start) / advertising_interval_ms_) * advertising_interval_ms_ +
+      start;
 
   std::chrono::steady_clock::time_point next_interval =
       last_interval + advertising_interval_ms_;
@@ -187,6 +187,7 @@ DualModeController::DualModeController()
   SET_TEST_HANDLER("add", TestChannelAdd);
   SET_TEST_HANDLER("del", TestChannelDel);
   SET_TEST_HANDLER("list", TestChannelList);
+  SET_TEST_HANDLER("set_virtual_time", TestChannelSetVirtualTime);
 #undef SET_TEST_HANDLER
 }
 
@@ -208,6 +209,20 @@ void DualModeController::RegisterTaskCancel(
   cancel_task_ = task_cancel;
 }
 
+void DualModeController::RegisterClock(
+    std::function<std::chrono::steady_clock::time_point()> clock) {
+  clock_ = clock;
+}
+
+void DualModeController::RegisterVirtualTimeControl(
+    std::function<void(bool)> set_virtual_time) {
+  set_virtual_time_ = set_virtual_time;
+}
+
+std::chrono::steady_clock::time_point DualModeController::Now() const {
+  return clock_ ? clock_() : std::chrono::steady_clock::now();
+}
+
 void DualModeController::HandleTestChannelCommand(
     const std::string& name, const vector<std::string>& args) {
   if (active_test_channel_commands_.count(name) == 0) return;
@@ -316,58 +331,62 @@ void DualModeController::LeScan() {
   std::unique_ptr<EventPacket> le_adverts =
       EventPacket::CreateLeAdvertisingReportEvent();
   vector<uint8_t> ad;
+  std::chrono::steady_clock::time_point now = Now();
   for (size_t dev = 0; dev < devices_.size(); dev++) {
-    uint8_t adv_type;
-    const BtAddress addr = devices_[dev]->GetBtAddress();
-    uint8_t addr_type = devices_[dev]->GetAddressType();
-    ad.clear();
-
-    // Listen for Advertisements
-    if (devices_[dev]->IsAdvertisementAvailable(
-            std::chrono::milliseconds(le_scan_window_))) {
-      ad = devices_[dev]->GetAdvertisement();
-      adv_type = devices_[dev]->GetAdvertisementType();
-      if (le_scan_enable_ && !le_adverts->AddLeAdvertisingReport(
-                                 adv_type, addr_type, addr, ad, GetRssi(dev))) {
-        send_event_(std::move(le_adverts));
-        le_adverts = EventPacket::CreateLeAdvertisingReportEvent();
-        CHECK(le_adverts->AddLeAdvertisingReport(adv_type, addr_type, addr, ad,
-                                                 GetRssi(dev)));
-      }
-
-      // Connect
-      if (le_connect_ && (adv_type == BTM_BLE_CONNECT_EVT ||
-                          adv_type == BTM_BLE_CONNECT_DIR_EVT)) {
-        LOG_INFO(LOG_TAG, "Connecting to device %d", static_cast<int>(dev));
-        if (peer_address_ == addr && peer_address_type_ == addr_type &&
-            devices_[dev]->LeConnect()) {
-          uint16_t handle = LeGetHandle();
-          std::unique_ptr<EventPacket> event =
-              EventPacket::CreateLeConnectionCompleteEvent(
-                  kSuccessStatus, handle, HCI_ROLE_MASTER, addr_type, addr,
-                  LeGetConnInterval(), LeGetConnLatency(),
-                  LeGetSupervisionTimeout());
-          send_event_(std::move(event));
-          le_connect_ = false;
-
-          connections_.push_back(
-              std::make_shared<Connection>(devices_[dev], handle));
+    for (size_t adv = 0; adv < devices_[dev]->GetAdvertiserCount(); adv++) {
+      uint8_t adv_type;
+      const BtAddress addr = devices_[dev]->GetAdvertiserAddress(adv);
+      uint8_t addr_type = devices_[dev]->GetAddressType();
+      ad.clear();
+
+      // Listen for Advertisements
+      if (devices_[dev]->IsAdvertisementAvailable(
+              now, std::chrono::milliseconds(le_scan_window_), adv)) {
+        ad = devices_[dev]->GetAdvertisement();
+        adv_type = devices_[dev]->GetAdvertisementType();
+        if (le_scan_enable_ &&
+            !le_adverts->AddLeAdvertisingReport(adv_type, addr_type, addr, ad,
+                                                GetRssi(dev))) {
+          send_event_(std::move(le_adverts));
+          le_adverts = EventPacket::CreateLeAdvertisingReportEvent();
+          CHECK(le_adverts->AddLeAdvertisingReport(adv_type, addr_type, addr,
+                                                   ad, GetRssi(dev)));
         }
 
-        // TODO: Handle the white list (if (InWhiteList(dev)))
-      }
+        // Connect
+        if (le_connect_ && (adv_type == BTM_BLE_CONNECT_EVT ||
+                            adv_type == BTM_BLE_CONNECT_DIR_EVT)) {
+          LOG_INFO(LOG_TAG, "Connecting to device %d", static_cast<int>(dev));
+          if (peer_address_ == addr && peer_address_type_ == addr_type &&
+              devices_[dev]->LeConnect()) {
+            uint16_t handle = LeGetHandle();
+            std::unique_ptr<EventPacket> event =
+                EventPacket::CreateLeConnectionCompleteEvent(
+                    kSuccessStatus, handle, HCI_ROLE_MASTER, addr_type, addr,
+                    LeGetConnInterval(), LeGetConnLatency(),
+                    LeGetSupervisionTimeout());
+            send_event_(std::move(event));
+            le_connect_ = false;
+
+            connections_.push_back(
+                std::make_shared<Connection>(devices_[dev], handle));
+          }
+
+          // TODO: Handle the white list (if (InWhiteList(dev)))
+        }
 
-      // Active scanning
-      if (le_scan_enable_ && le_scan_type_ == 1) {
-        ad.clear();
-        if (devices_[dev]->HasScanResponse()) {
-          ad = devices_[dev]->GetScanResponse();
-          if (!le_adverts->AddLeAdvertisingReport(
-                  BTM_BLE_SCAN_RSP_EVT, addr_type, addr, ad, GetRssi(dev))) {
-            send_event_(std::move(le_adverts));
-            le_adverts = EventPacket::CreateLeAdvertisingReportEvent();
-            CHECK(le_adverts->AddLeAdvertisingReport(
-                BTM_BLE_SCAN_RSP_EVT, addr_type, addr, ad, GetRssi(dev)));
+        // Active scanning
+        if (le_scan_enable_ && le_scan_type_ == 1) {
+          ad.clear();
+          if (devices_[dev]->HasScanResponse()) {
+            ad = devices_[dev]->GetScanResponse();
+            if (!le_adverts->AddLeAdvertisingReport(
+                    BTM_BLE_SCAN_RSP_EVT, addr_type, addr, ad, GetRssi(dev))) {
+              send_event_(std::move(le_adverts));
+              le_adverts = EventPacket::CreateLeAdvertisingReportEvent();
+              CHECK(le_adverts->AddLeAdvertisingReport(
+                  BTM_BLE_SCAN_RSP_EVT, addr_type, addr, ad, GetRssi(dev)));
+            }
           }
         }
       }
@@ -451,6 +470,7 @@ void DualModeController::TestChannelAdd(const vector<std::string>& args) {
     return;
   }
 
+  new_dev->SetTimeStamp(Now());
   devices_.push_back(new_dev);
 }
 
@@ -467,6 +487,21 @@ void DualModeController::TestChannelDel(const vector<std::string>& args) {
   }
 }
 
+void DualModeController::TestChannelSetVirtualTime(
+    const vector<std::string>& args) {
+  LogCommand("TestChannel 'set_virtual_time'");
+
+  if (args.size() < 1 || !set_virtual_time_) {
+    LOG_INFO(LOG_TAG, "TestChannel 'set_virtual_time': not available!");
+    return;
+  }
+
+  bool virtual_time = (args[0] == "on" || args[0] == "1");
+  LOG_INFO(LOG_TAG, "TestChannel 'set_virtual_time': %s",
+           virtual_time ? "on" : "off");
+  set_virtual_time_(virtual_time);
+}
+
 void DualModeController::TestChannelList(
     UNUSED_ATTR const vector<std::string>& args) const {
   LogCommand("TestChannel 'list'");
@@ -16,6 +16,7 @@
 
 #include "async_manager.h"
 #include <gtest/gtest.h>
+#include <condition_variable>
 #include <cstdint>
 #include <cstring>
 #include <vector>
@@ -171,4 +172,51 @@ TEST_F(AsyncManagerSocketTest, TestMultipleConnections) {
   }
 }
 
+TEST(AsyncManagerVirtualTimeTest, TestTasksRunInOrderWithoutWaiting) {
+  AsyncManager async_manager;
+  std::mutex mutex;
+  std::condition_variable done;
+  std::vector<int> order;
+  auto record = [&](int task) {
+    std::unique_lock<std::mutex> guard(mutex);
+    order.push_back(task);
+    done.notify_one();
+  };
+
+  std::chrono::steady_clock::time_point start = async_manager.Now();
+  async_manager.ExecAsync(std::chrono::hours(2), [&]() { record(2); });
+  async_manager.ExecAsync(std::chrono::hours(1), [&]() { record(1); });
+  async_manager.SetVirtualTime(true);
+
+  std::unique_lock<std::mutex> guard(mutex);
+  EXPECT_TRUE(done.wait_for(guard, std::chrono::seconds(5),
+                            [&]() { return order.size() == 2; }));
+  EXPECT_EQ(std::vector<int>({1, 2}), order);
+  EXPECT_GE(async_manager.Now() - start, std::chrono::hours(2));
+}
+
+TEST(AsyncManagerVirtualTimeTest, TestPeriodicTaskRunsAheadOfRealTime) {
+  AsyncManager async_manager;
+  async_manager.SetVirtualTime(true);
+  std::mutex mutex;
+  std::condition_variable done;
+  int ticks = 0;
+
+  std::chrono::steady_clock::time_point start = async_manager.Now();
+  AsyncTaskId task = async_manager.ExecAsyncPeriodically(
+      std::chrono::milliseconds(0), std::chrono::seconds(1), [&]() {
+        std::unique_lock<std::mutex> guard(mutex);
+        ticks++;
+        done.notify_one();
+      });
+
+  {
+    std::unique_lock<std::mutex> guard(mutex);
+    EXPECT_TRUE(done.wait_for(guard, std::chrono::seconds(5),
+                              [&]() { return ticks >= 1000; }));
+  }
+  async_manager.CancelAsyncTask(task);
+  EXPECT_GE(async_manager.Now() - start, std::chrono::seconds(999));
+}
+
 }  // namespace test_vendor_lib